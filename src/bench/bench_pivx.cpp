@@ -9,7 +9,9 @@
 #include <crypto/sha256.h>
 #include <key.h>
 #include <random.h>
+#include <script/sigcache.h>
 #include <utilstrencodings.h>
+#include <txdb.h>
 #include <validation.h>
 
 #include <memory>
@@ -25,6 +27,9 @@ static const int64_t DEFAULT_PLOT_HEIGHT = 768;
 void InitBLSTests();
 void CleanupBLSTests();
 void CleanupBLSDkgTests();
+int RunValidationReplay();
+int RunDeserializeCorpus();
+int RunLLMQSigning();
 
 int main(int argc, char** argv)
 {
@@ -40,20 +45,49 @@ int main(int argc, char** argv)
                   << HelpMessageOpt("-printer=(console|plot)", strprintf(_("Choose printer format. console: print data to console. plot: Print results as HTML graph (default: %s)"), DEFAULT_BENCH_PRINTER))
                   << HelpMessageOpt("-plot-plotlyurl=<uri>", strprintf(_("URL to use for plotly.js (default: %s)"), DEFAULT_PLOT_PLOTLYURL))
                   << HelpMessageOpt("-plot-width=<x>", strprintf(_("Plot width in pixel (default: %u)"), DEFAULT_PLOT_WIDTH))
-                  << HelpMessageOpt("-plot-height=<x>", strprintf(_("Plot height in pixel (default: %u)"), DEFAULT_PLOT_HEIGHT));
+                  << HelpMessageOpt("-plot-height=<x>", strprintf(_("Plot height in pixel (default: %u)"), DEFAULT_PLOT_HEIGHT))
+                  << HelpMessageGroup(_("Validation replay options:"))
+                  << HelpMessageOpt("-replayfile=<file>", _("Instead of the micro-benchmarks, replay the blocks of <file> (in the format of the blk?????.dat files) through ProcessNewBlock on a temporary datadir, and report the throughput and the time of each validation step"))
+                  << HelpMessageOpt("-replaychain=<chain>", _("Chain of the replayed blocks: main, test or regtest (default: main)"))
+                  << HelpMessageOpt("-replaydbcache=<n>", strprintf(_("Database cache size of the replay in megabytes (default: %d)"), nDefaultDbCache))
+                  << HelpMessageOpt("-replaypar=<n>", _("Number of script verification threads of the replay, as -par (default: 0 = auto)"))
+                  << HelpMessageOpt("-replaymaxblocks=<n>", _("Replay at most <n> blocks of the file (default: 0 = all)"))
+                  << HelpMessageOpt("-asyncblockwrites", strprintf(_("Write the block and undo files of the replay on dedicated threads, as the -asyncblockwrites of the node (default: %u)"), DEFAULT_ASYNC_BLOCK_WRITES))
+                  << HelpMessageOpt("-validationcpus=<cpus>", _("Restrict the replay thread and the script verification threads to the CPUs of the list, e.g. 0-7,16-23, as the -validationcpus of the node (default: no restriction)"))
+                  << HelpMessageGroup(_("Deserialization corpus options:"))
+                  << HelpMessageOpt("-deserializecorpus=<dir>", _("Instead of the micro-benchmarks, deserialize the network messages of <dir> (a subdirectory per message command, e.g. block, tx, mnb, qsigsinv, with a payload per file), and report the messages/s and the allocations per message of each command"))
+                  << HelpMessageOpt("-deserializechain=<chain>", _("Chain of the messages: main, test or regtest (default: main)"))
+                  << HelpMessageOpt("-deserializeiters=<n>", _("Number of passes over the payloads of each command (default: 10)"))
+                  << HelpMessageGroup(_("LLMQ signing options:"))
+                  << HelpMessageOpt("-signingrequests=<n>", _("Instead of the micro-benchmarks, sign <n> concurrent requests with a simulated quorum (the local node receiving the sig shares of the other members in-process), and report the recovered signatures/s, the latency percentiles and the time of each signing step"))
+                  << HelpMessageOpt("-signingchain=<chain>", _("Chain of the LLMQ parameters: main, test or regtest (default: main)"))
+                  << HelpMessageOpt("-signingllmqtype=<n>", _("Type of the simulated quorum, as the llmqType of the LLMQ parameters of the chain (default: 1, llmq_50_60)"))
+                  << HelpMessageOpt("-signingpar=<n>", _("Number of threads processing the signing sessions (default: 0 = one per core)"))
+                  << HelpMessageOpt("-signingbatch=<n>", _("Number of signing sessions of each sig shares verification batch (default: 32)"));
 
         return EXIT_SUCCESS;
     }
 
+    SHA256AutoDetect();
     RandomInit();
     ECC_Start();
     ECCVerifyHandle globalVerifyHandle;
+    InitSignatureCache();
     RandomInit();
     BLSInit();
     InitBLSTests();
     SetupEnvironment();
     g_logger->m_print_to_file = false; // don't want to write to debug.log file
 
+    if (gArgs.IsArgSet("-replayfile") || gArgs.IsArgSet("-deserializecorpus") || gArgs.IsArgSet("-signingrequests")) {
+        int ret = gArgs.IsArgSet("-replayfile") ? RunValidationReplay() :
+                  gArgs.IsArgSet("-deserializecorpus") ? RunDeserializeCorpus() : RunLLMQSigning();
+        CleanupBLSDkgTests();
+        CleanupBLSTests();
+        ECC_Stop();
+        return ret;
+    }
+
     int64_t evaluations = gArgs.GetArg("-evals", DEFAULT_BENCH_EVALUATIONS);
     std::string regex_filter = gArgs.GetArg("-filter", DEFAULT_BENCH_FILTER);
     std::string scaling_str = gArgs.GetArg("-scaling", DEFAULT_BENCH_SCALING);
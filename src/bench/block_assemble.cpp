@@ -0,0 +1,262 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "blockassembler.h"
+#include "bls/bls_wrapper.h"
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "consensus/tx_verify.h"
+#include "evo/deterministicmns.h"
+#include "evo/evodb.h"
+#include "evo/providertx.h"
+#include "netbase.h"
+#include "random.h"
+#include "sporkdb.h"
+#include "txdb.h"
+#include "txmempool.h"
+#include "utiltime.h"
+#include "validation.h"
+
+// Shape of the synthetic mempool: chains of unconfirmed txs as long as the default ancestor limit,
+// parents whose outputs are all spent by unconfirmed children, shielded txs, ProRegTx/ProUpServTx
+// special txs, and independent transparent txs.
+static const int CHAIN_COUNT = 40;
+static const int CHAIN_LENGTH = 25;
+static const int FANOUT_COUNT = 20;
+static const int FANOUT_WIDTH = 40;
+static const int SHIELDED_COUNT = 200;
+static const int SPECIAL_COUNT = 100;
+static const int INDEPENDENT_COUNT = 1000;
+static const int SYNTHETIC_CHAIN_HEIGHT = 100;
+
+static CScript RandomP2PKH(FastRandomContext& rng)
+{
+    const std::vector<unsigned char> vch = rng.randbytes(20);
+    return GetScriptForDestination(CKeyID(uint160(vch)));
+}
+
+// A tx spending vin and paying nOutputs P2PKH outputs, with signatures of realistic size
+static CMutableTransaction NewTx(FastRandomContext& rng, const std::vector<COutPoint>& vin, int nOutputs)
+{
+    CMutableTransaction tx;
+    for (const COutPoint& prevout : vin) {
+        tx.vin.emplace_back(prevout);
+        tx.vin.back().scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+    }
+    for (int i = 0; i < nOutputs; i++) {
+        tx.vout.emplace_back(COIN, RandomP2PKH(rng));
+    }
+    return tx;
+}
+
+static COutPoint RandomPrevout(FastRandomContext& rng)
+{
+    return COutPoint(rng.rand256(), 0);
+}
+
+class MempoolSetup
+{
+public:
+    std::vector<CTxMemPoolEntry> vEntries;
+    CScript scriptPubKey;
+
+    MempoolSetup()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        // Sapling is active, so that the shielded outputs end in the block tree root,
+        // and no LLMQ commitment is required in the blocks
+        UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V5_0, 1);
+        UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V6_0, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
+
+        pSporkDB.reset(new CSporkDB(0, true));
+        pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        evoDb.reset(new CEvoDB(1 << 20, true, true));
+        deterministicMNManager.reset(new CDeterministicMNManager(*evoDb));
+
+        AppendSyntheticChain();
+
+        FastRandomContext rng(true);
+        scriptPubKey = RandomP2PKH(rng);
+
+        for (int i = 0; i < CHAIN_COUNT; i++) {
+            COutPoint prevout = RandomPrevout(rng);
+            for (int j = 0; j < CHAIN_LENGTH; j++) {
+                const CMutableTransaction tx = NewTx(rng, {prevout}, 2);
+                AddEntry(rng, tx);
+                prevout = COutPoint(tx.GetHash(), 0);
+            }
+        }
+
+        for (int i = 0; i < FANOUT_COUNT; i++) {
+            const CMutableTransaction parent = NewTx(rng, {RandomPrevout(rng)}, FANOUT_WIDTH);
+            AddEntry(rng, parent);
+            for (int j = 0; j < FANOUT_WIDTH; j++) {
+                AddEntry(rng, NewTx(rng, {COutPoint(parent.GetHash(), j)}, 1));
+            }
+        }
+
+        for (int i = 0; i < SHIELDED_COUNT; i++) {
+            CMutableTransaction tx = NewTx(rng, {RandomPrevout(rng)}, 1);
+            tx.nVersion = CTransaction::TxVersion::SAPLING;
+            tx.sapData->vShieldedSpend.emplace_back();
+            tx.sapData->vShieldedSpend.back().nullifier = rng.rand256();
+            tx.sapData->vShieldedOutput.resize(2);
+            for (OutputDescription& output : tx.sapData->vShieldedOutput) {
+                output.cmu = rng.rand256();
+            }
+            AddEntry(rng, tx);
+        }
+
+        for (int i = 0; i < SPECIAL_COUNT; i++) {
+            CMutableTransaction tx = NewTx(rng, {RandomPrevout(rng)}, 1);
+            tx.nVersion = CTransaction::TxVersion::SAPLING;
+            const CService addr = LookupNumeric(strprintf("1.1.%d.%d", i / 256, i % 256), 51472);
+            if (i % 2 == 0) {
+                tx.nType = CTransaction::TxType::PROREG;
+                CBLSSecretKey operatorKey;
+                operatorKey.MakeNewKey();
+                ProRegPL pl;
+                pl.collateralOutpoint = COutPoint(UINT256_ZERO, 0);
+                pl.addr = addr;
+                pl.keyIDOwner = CKeyID(uint160(rng.randbytes(20)));
+                pl.pubKeyOperator = operatorKey.GetPublicKey();
+                pl.keyIDVoting = pl.keyIDOwner;
+                pl.scriptPayout = RandomP2PKH(rng);
+                pl.vchSig = std::vector<unsigned char>(65, 3);
+                SetTxPayload(tx, pl);
+            } else {
+                tx.nType = CTransaction::TxType::PROUPSERV;
+                ProUpServPL pl;
+                pl.proTxHash = rng.rand256();
+                pl.addr = addr;
+                SetTxPayload(tx, pl);
+            }
+            AddEntry(rng, tx);
+        }
+
+        for (int i = 0; i < INDEPENDENT_COUNT; i++) {
+            AddEntry(rng, NewTx(rng, {RandomPrevout(rng)}, 2));
+        }
+    }
+
+    ~MempoolSetup()
+    {
+        UnloadBlockIndex();
+        deterministicMNManager.reset();
+        evoDb.reset();
+        pcoinsTip.reset();
+        pcoinsdbview.reset();
+        pSporkDB.reset();
+        SelectParams(CBaseChainParams::REGTEST);
+    }
+
+    void FillMempool(CTxMemPool& pool) const
+    {
+        pool.clear();
+        LOCK2(cs_main, pool.cs);
+        for (const CTxMemPoolEntry& entry : vEntries) {
+            pool.addUnchecked(entry.GetTx().GetHash(), entry);
+        }
+    }
+
+private:
+    void AddEntry(FastRandomContext& rng, const CMutableTransaction& mtx)
+    {
+        const CTransactionRef tx = MakeTransactionRef(mtx);
+        // Feerates from 1 to 100 sat/byte
+        const CAmount nFee = (1 + rng.randrange(100)) * ::GetSerializeSize(*tx, PROTOCOL_VERSION);
+        vEntries.emplace_back(tx, nFee, GetTime(), SYNTHETIC_CHAIN_HEIGHT, false, GetLegacySigOpCount(*tx));
+    }
+
+    static void AppendSyntheticChain()
+    {
+        LOCK(cs_main);
+        for (int i = 0; i <= SYNTHETIC_CHAIN_HEIGHT; i++) {
+            CBlock block;
+            CBlockIndex* pindexPrev = chainActive.Tip();
+            if (pindexPrev) block.hashPrevBlock = pindexPrev->GetBlockHash();
+            block.nTime = Params().GenesisBlock().nTime + i * Params().GetConsensus().nTargetSpacing;
+            block.nBits = UintToArith256(Params().GetConsensus().powLimit).GetCompact();
+            block.hashMerkleRoot = BlockMerkleRoot(block);
+            block.hashFinalSaplingRoot = SaplingMerkleTree::empty_root();
+
+            CBlockIndex* pindex = new CBlockIndex(block);
+            pindex->nHeight = i;
+            pindex->pprev = pindexPrev;
+            pindex->BuildSkip();
+            BlockMap::iterator mi = mapBlockIndex.emplace(block.GetHash(), pindex).first;
+            pindex->phashBlock = &((*mi).first);
+            chainActive.SetTip(pindex);
+        }
+    }
+};
+
+// Assembles a block template with the transactions selected by BlockAssembler::addPackageTxs
+static void AssembleBlockFromMempool(benchmark::State& state)
+{
+    MempoolSetup setup;
+    setup.FillMempool(mempool);
+    while (state.KeepRunning()) {
+        std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(Params(), false)
+                .CreateNewBlock(setup.scriptPubKey, nullptr, false, nullptr, false, false);
+        assert(pblocktemplate && pblocktemplate->block.vtx.size() > 1);
+    }
+}
+
+// The fixed cost of the template without mempool transactions, to subtract from AssembleBlockFromMempool
+static void AssembleBlockNoMempoolTxs(benchmark::State& state)
+{
+    MempoolSetup setup;
+    setup.FillMempool(mempool);
+    while (state.KeepRunning()) {
+        std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(Params(), false)
+                .CreateNewBlock(setup.scriptPubKey, nullptr, false, nullptr, true, false);
+        assert(pblocktemplate && pblocktemplate->block.vtx.size() == 1);
+    }
+}
+
+// The cost of filling the mempool, to subtract from MempoolTrimToSize and MempoolRemoveForBlock
+static void MempoolFill(benchmark::State& state)
+{
+    MempoolSetup setup;
+    while (state.KeepRunning()) {
+        setup.FillMempool(mempool);
+    }
+}
+
+// Trims the mempool to half its usage, evicting packages by descendant feerate
+static void MempoolTrimToSize(benchmark::State& state)
+{
+    MempoolSetup setup;
+    setup.FillMempool(mempool);
+    const size_t nLimit = mempool.DynamicMemoryUsage() / 2;
+    while (state.KeepRunning()) {
+        setup.FillMempool(mempool);
+        mempool.TrimToSize(nLimit);
+        mempool.TrimShieldedToSize(mempool.GetShieldedDynamicMemoryUsage() / 2);
+    }
+}
+
+// Removes the transactions of an assembled block, and their conflicts, from the mempool
+static void MempoolRemoveForBlock(benchmark::State& state)
+{
+    MempoolSetup setup;
+    setup.FillMempool(mempool);
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(Params(), false)
+            .CreateNewBlock(setup.scriptPubKey, nullptr, false, nullptr, false, false);
+    assert(pblocktemplate);
+    const std::vector<CTransactionRef>& vtx = pblocktemplate->block.vtx;
+    while (state.KeepRunning()) {
+        setup.FillMempool(mempool);
+        mempool.removeForBlock(vtx, SYNTHETIC_CHAIN_HEIGHT + 1);
+    }
+}
+
+BENCHMARK(AssembleBlockFromMempool, 100);
+BENCHMARK(AssembleBlockNoMempoolTxs, 10000);
+BENCHMARK(MempoolFill, 50);
+BENCHMARK(MempoolTrimToSize, 50);
+BENCHMARK(MempoolRemoveForBlock, 50);
@@ -21,7 +21,7 @@ static const unsigned int QUEUE_BATCH_SIZE = 128;
 // This Benchmark tests the CheckQueue with a slightly realistic workload,
 // where checks all contain a prevector that is indirect 50% of the time
 // and there is a little bit of work done between calls to Add.
-static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
+static void CCheckQueuePrevectorJob(benchmark::State& state, int nThreads)
 {
     struct PrevectorJob {
         prevector<PREVECTOR_SIZE, uint8_t> p;
@@ -38,7 +38,7 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     };
     CCheckQueue<PrevectorJob> queue {QUEUE_BATCH_SIZE};
     boost::thread_group tg;
-    for (auto x = 0; x < std::max(MIN_CORES, GetNumCores()); ++x) {
+    for (auto x = 0; x < nThreads; ++x) {
        tg.create_thread([&]{queue.Thread();});
     }
     while (state.KeepRunning()) {
@@ -59,4 +59,26 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.interrupt_all();
     tg.join_all();
 }
+
+static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
+{
+    CCheckQueuePrevectorJob(state, std::max(MIN_CORES, GetNumCores()));
+}
+
+// Scaling with the number of worker threads
+static void CCheckQueuePrevectorJob_1(benchmark::State& state) { CCheckQueuePrevectorJob(state, 1); }
+static void CCheckQueuePrevectorJob_2(benchmark::State& state) { CCheckQueuePrevectorJob(state, 2); }
+static void CCheckQueuePrevectorJob_4(benchmark::State& state) { CCheckQueuePrevectorJob(state, 4); }
+static void CCheckQueuePrevectorJob_8(benchmark::State& state) { CCheckQueuePrevectorJob(state, 8); }
+static void CCheckQueuePrevectorJob_16(benchmark::State& state) { CCheckQueuePrevectorJob(state, 16); }
+static void CCheckQueuePrevectorJob_32(benchmark::State& state) { CCheckQueuePrevectorJob(state, 32); }
+static void CCheckQueuePrevectorJob_64(benchmark::State& state) { CCheckQueuePrevectorJob(state, 64); }
+
 BENCHMARK(CCheckQueueSpeedPrevectorJob, 1400);
+BENCHMARK(CCheckQueuePrevectorJob_1, 1400);
+BENCHMARK(CCheckQueuePrevectorJob_2, 1400);
+BENCHMARK(CCheckQueuePrevectorJob_4, 1400);
+BENCHMARK(CCheckQueuePrevectorJob_8, 1400);
+BENCHMARK(CCheckQueuePrevectorJob_16, 1400);
+BENCHMARK(CCheckQueuePrevectorJob_32, 1400);
+BENCHMARK(CCheckQueuePrevectorJob_64, 1400);
@@ -0,0 +1,186 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+// Throughput of the deserializers of the network messages: replays a corpus of recorded message
+// payloads through their Unserialize paths, and reports the messages/s, the MB/s and the heap
+// allocations per message of each message type.
+
+#include "bench/bench.h"
+
+#include "budget/budgetvote.h"
+#include "budget/finalizedbudgetvote.h"
+#include "chainparams.h"
+#include "fs.h"
+#include "llmq/quorums_chainlocks.h"
+#include "llmq/quorums_dkgsession.h"
+#include "llmq/quorums_signing_shares.h"
+#include "masternode.h"
+#include "masternode-payments.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "protocol.h"
+#include "streams.h"
+#include "util/system.h"
+#include "utiltime.h"
+#include "version.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+static const char* DEFAULT_DESERIALIZE_CHAIN = "main";
+static const int64_t DEFAULT_DESERIALIZE_ITERS = 10;
+
+// The heap allocations of the bench binary are counted while g_count_allocations is set
+static std::atomic<bool> g_count_allocations{false};
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(std::size_t size)
+{
+    if (g_count_allocations.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    ::operator delete(p);
+}
+
+typedef std::function<void(VectorReader&)> DeserializeFn;
+
+template <typename T>
+static void DeserializeMessage(VectorReader& s)
+{
+    T obj;
+    s >> obj;
+}
+
+static void DeserializeTransaction(VectorReader& s)
+{
+    // as the tx handler, through the (const) transaction deserialize constructor
+    const CTransaction tx(deserialize, s);
+}
+
+/**
+ * The messages of the corpus, as ProcessMessage deserializes them. The corpus directory has a
+ * subdirectory for each of them, named after the message command, with a payload per file
+ * (the layout of the fuzzing corpora).
+ */
+static const std::vector<std::pair<const char*, DeserializeFn>> vCorpusMessages{
+    {NetMsgType::BLOCK, DeserializeMessage<CBlock>},
+    {NetMsgType::TX, DeserializeTransaction},
+    {NetMsgType::MNBROADCAST, DeserializeMessage<CMasternodeBroadcast>},
+    {NetMsgType::MNPING, DeserializeMessage<CMasternodePing>},
+    {NetMsgType::MNWINNER, DeserializeMessage<CMasternodePaymentWinner>},
+    {NetMsgType::BUDGETVOTE, DeserializeMessage<CBudgetVote>},
+    {NetMsgType::FINALBUDGETVOTE, DeserializeMessage<CFinalizedBudgetVote>},
+    {NetMsgType::QSIGSHARESINV, DeserializeMessage<std::vector<llmq::CSigSharesInv>>},
+    {NetMsgType::QBSIGSHARES, DeserializeMessage<std::vector<llmq::CBatchedSigShares>>},
+    {NetMsgType::CLSIG, DeserializeMessage<llmq::CChainLockSig>},
+    {NetMsgType::QCONTRIB, DeserializeMessage<llmq::CDKGContribution>},
+    {NetMsgType::QCOMPLAINT, DeserializeMessage<llmq::CDKGComplaint>},
+    {NetMsgType::QJUSTIFICATION, DeserializeMessage<llmq::CDKGJustification>},
+    {NetMsgType::QPCOMMITMENT, DeserializeMessage<llmq::CDKGPrematureCommitment>},
+};
+
+/** Read the payloads of a message directory, in file name order. */
+static void ReadCorpusPayloads(const fs::path& dir, std::vector<std::vector<unsigned char>>& vPayloads)
+{
+    std::vector<fs::path> vFiles;
+    for (fs::directory_iterator it(dir); it != fs::directory_iterator(); ++it) {
+        if (fs::is_regular_file(it->status())) vFiles.emplace_back(it->path());
+    }
+    std::sort(vFiles.begin(), vFiles.end());
+    for (const fs::path& file : vFiles) {
+        fsbridge::ifstream stream(file, std::ios::in | std::ios::binary);
+        vPayloads.emplace_back((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    }
+}
+
+/** Whether the payload is deserialized entirely, without errors (the fuzzing corpora hold invalid inputs too) */
+static bool IsValidPayload(const DeserializeFn& fn, const std::vector<unsigned char>& payload)
+{
+    try {
+        VectorReader s(SER_NETWORK, PROTOCOL_VERSION, payload, 0);
+        fn(s);
+        return s.empty();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+int RunDeserializeCorpus()
+{
+    const std::string strChain = gArgs.GetArg("-deserializechain", DEFAULT_DESERIALIZE_CHAIN);
+    const int64_t nIters = std::max(gArgs.GetArg("-deserializeiters", DEFAULT_DESERIALIZE_ITERS), (int64_t)1);
+    try {
+        // the sig shares messages are deserialized according to the quorum types of the chain
+        SelectParams(strChain);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    const fs::path pathCorpus = fs::absolute(gArgs.GetArg("-deserializecorpus", ""));
+    if (!fs::is_directory(pathCorpus)) {
+        fprintf(stderr, "Error: the corpus directory %s does not exist\n", pathCorpus.string().c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("Deserializing the corpus %s, %d iterations\n", pathCorpus.string().c_str(), (int)nIters);
+    printf("%-12s %10s %10s %14s %12s %14s\n", "message", "payloads", "rejected", "messages/s", "MB/s", "allocs/msg");
+    bool fFound = false;
+    for (const auto& msg : vCorpusMessages) {
+        const fs::path dir = pathCorpus / msg.first;
+        if (!fs::is_directory(dir)) continue;
+        fFound = true;
+
+        std::vector<std::vector<unsigned char>> vPayloads;
+        ReadCorpusPayloads(dir, vPayloads);
+        const size_t nPayloads = vPayloads.size();
+        vPayloads.erase(std::remove_if(vPayloads.begin(), vPayloads.end(),
+                                       [&msg](const std::vector<unsigned char>& payload) { return !IsValidPayload(msg.second, payload); }),
+                        vPayloads.end());
+        const size_t nRejected = nPayloads - vPayloads.size();
+        if (vPayloads.empty()) {
+            printf("%-12s %10zu %10zu %14s %12s %14s\n", msg.first, nPayloads, nRejected, "-", "-", "-");
+            continue;
+        }
+        uint64_t nBytes = 0;
+        for (const auto& payload : vPayloads) nBytes += payload.size();
+
+        g_allocations = 0;
+        g_count_allocations = true;
+        const int64_t nTimeStart = GetTimeMicros();
+        for (int64_t i = 0; i < nIters; i++) {
+            for (const auto& payload : vPayloads) {
+                VectorReader s(SER_NETWORK, PROTOCOL_VERSION, payload, 0);
+                msg.second(s);
+            }
+        }
+        const int64_t nTime = GetTimeMicros() - nTimeStart;
+        g_count_allocations = false;
+
+        const double dSeconds = std::max(nTime, (int64_t)1) * 0.000001;
+        const double dMessages = (double)vPayloads.size() * nIters;
+        printf("%-12s %10zu %10zu %14.0f %12.2f %14.2f\n", msg.first, nPayloads, nRejected,
+               dMessages / dSeconds, nBytes * nIters * 0.000001 / dSeconds, g_allocations / dMessages);
+    }
+    if (!fFound) {
+        fprintf(stderr, "Error: no message directory (e.g. %s/%s) in the corpus\n", pathCorpus.string().c_str(), NetMsgType::BLOCK);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,261 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+// Stress test of the LLMQ signing sessions: a simulated quorum (with the verification vector and the
+// secret key shares of a generated contribution) signs thousands of concurrent requests. The local node
+// is the first member: it signs its share, receives the shares of the other members as the QBSIGSHARES
+// messages of an in-process network, verifies them in batches, recovers and checks the final signatures,
+// through the steps of CSigSharesManager and CSigningManager. Reports the recovered signatures/s, the
+// latency percentiles of the requests and the time spent in each step.
+
+#include "bench/bench.h"
+
+#include "bls/bls_batchverifier.h"
+#include "bls/bls_worker.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "evo/deterministicmns.h"
+#include "llmq/quorums.h"
+#include "llmq/quorums_signing.h"
+#include "llmq/quorums_signing_shares.h"
+#include "llmq/quorums_utils.h"
+#include "random.h"
+#include "streams.h"
+#include "util/system.h"
+#include "utiltime.h"
+#include "version.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+extern CBLSWorker blsWorker;
+
+static const char* DEFAULT_SIGNING_CHAIN = "main";
+static const int DEFAULT_SIGNING_LLMQ_TYPE = Consensus::LLMQ_50_60;
+static const int DEFAULT_SIGNING_PAR = 0;
+// As CSigSharesManager::ProcessPendingSigShares
+static const int DEFAULT_SIGNING_BATCH = 32;
+
+enum SigningStep {
+    STEP_SIGN_SHARE = 0,
+    STEP_RECEIVE,
+    STEP_VERIFY_SHARES,
+    STEP_RECOVER,
+    STEP_VERIFY_RECOVERED,
+    STEP_COUNT
+};
+static const std::array<const char*, STEP_COUNT> vSigningStepNames{"sign share", "receive", "verify shares", "recover", "verify recsig"};
+
+struct SigningRequest {
+    uint256 id;
+    uint256 msgHash;
+    uint256 signHash;
+    // vector<CBatchedSigShares> sent by the other members, one entry each
+    std::vector<unsigned char> vSharesMessage;
+    // Time since the start of the run at which the signature was recovered
+    int64_t nLatency{0};
+};
+
+static void ParallelFor(int nThreads, size_t nItems, const std::function<void(size_t)>& fn)
+{
+    std::atomic<size_t> nNext{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back([&]() {
+            for (size_t j = nNext++; j < nItems; j = nNext++) fn(j);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+}
+
+static int64_t GetPercentile(const std::vector<int64_t>& vSorted, double dPercentile)
+{
+    return vSorted[std::min(vSorted.size() - 1, (size_t)(dPercentile * vSorted.size()))];
+}
+
+int RunLLMQSigning()
+{
+    const std::string strChain = gArgs.GetArg("-signingchain", DEFAULT_SIGNING_CHAIN);
+    const int64_t nRequests = gArgs.GetArg("-signingrequests", 0);
+    const int nLLMQType = (int)gArgs.GetArg("-signingllmqtype", DEFAULT_SIGNING_LLMQ_TYPE);
+    const int nBatch = std::max((int)gArgs.GetArg("-signingbatch", DEFAULT_SIGNING_BATCH), 1);
+    int nThreads = (int)gArgs.GetArg("-signingpar", DEFAULT_SIGNING_PAR);
+    if (nThreads <= 0) nThreads += GetNumCores();
+    nThreads = std::max(nThreads, 1);
+    if (nRequests <= 0) {
+        fprintf(stderr, "Error: invalid number of requests %d\n", (int)nRequests);
+        return EXIT_FAILURE;
+    }
+    try {
+        SelectParams(strChain);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    const auto& llmqs = Params().GetConsensus().llmqs;
+    const auto itParams = llmqs.find((Consensus::LLMQType)nLLMQType);
+    if (itParams == llmqs.end()) {
+        fprintf(stderr, "Error: no LLMQ of type %d on %s\n", nLLMQType, strChain.c_str());
+        return EXIT_FAILURE;
+    }
+    const Consensus::LLMQParams& params = itParams->second;
+
+    // The quorum, as CQuorumManager builds it from the mined commitment and the DKG contributions
+    const uint256 quorumHash = GetRandHash();
+    CBlockIndex indexQuorum;
+    indexQuorum.phashBlock = &quorumHash;
+    std::vector<CDeterministicMNCPtr> members;
+    BLSIdVector ids;
+    for (int i = 0; i < params.size; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        dmn->proTxHash = GetRandHash();
+        ids.emplace_back(dmn->proTxHash);
+        members.emplace_back(std::move(dmn));
+    }
+    BLSVerificationVectorPtr vvec;
+    BLSSecretKeyVector skShares;
+    if (!blsWorker.GenerateContributions(params.threshold, ids, vvec, skShares)) {
+        fprintf(stderr, "Error: cannot generate the quorum contribution\n");
+        return EXIT_FAILURE;
+    }
+    auto quorum = std::make_shared<llmq::CQuorum>(params, blsWorker);
+    quorum->Init(quorumHash, &indexQuorum, members, std::vector<bool>(members.size(), true), (*vvec)[0]);
+    quorum->quorumVvec = vvec;
+    quorum->skShare = skShares[0];
+    // the public key shares are built by the cache populator of the quorum, before the first sessions
+    for (size_t i = 0; i < members.size(); i++) {
+        quorum->GetPubKeyShare(i);
+    }
+
+    // The shares of the other members (the threshold is reached with the local one), signed on their nodes
+    printf("Signing %d requests with a %s quorum (%d members, threshold %d), %d threads, batches of %d sessions\n",
+           (int)nRequests, params.name.c_str(), params.size, params.threshold, nThreads, nBatch);
+    std::vector<SigningRequest> vRequests(nRequests);
+    ParallelFor(nThreads, vRequests.size(), [&](size_t i) {
+        SigningRequest& req = vRequests[i];
+        req.id = GetRandHash();
+        req.msgHash = GetRandHash();
+        req.signHash = llmq::utils::BuildSignHash(params.type, quorumHash, req.id, req.msgHash);
+        std::vector<llmq::CBatchedSigShares> vBatches(params.threshold - 1);
+        for (size_t j = 0; j < vBatches.size(); j++) {
+            auto& batch = vBatches[j];
+            batch.llmqType = params.type;
+            batch.quorumHash = quorumHash;
+            batch.id = req.id;
+            batch.msgHash = req.msgHash;
+            batch.sigShares.emplace_back(j + 1, skShares[j + 1].Sign(req.signHash));
+        }
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, req.vSharesMessage, 0, vBatches);
+    });
+
+    // All the requests are made at once, the threads take the sessions by batches
+    std::array<std::atomic<int64_t>, STEP_COUNT> vStepTimes{};
+    std::atomic<size_t> nNext{0};
+    std::atomic<bool> fFailed{false};
+    const int64_t nTimeStart = GetTimeMicros();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&]() {
+            std::vector<llmq::CSigShare> vSigShares;
+            for (size_t nFirst = nNext.fetch_add(nBatch); nFirst < vRequests.size(); nFirst = nNext.fetch_add(nBatch)) {
+                const size_t nLast = std::min(nFirst + nBatch, vRequests.size());
+                std::array<int64_t, STEP_COUNT> vTimes{};
+                int64_t nTime = GetTimeMicros();
+                const auto markStep = [&](SigningStep step) {
+                    const int64_t nNow = GetTimeMicros();
+                    vTimes[step] += nNow - nTime;
+                    nTime = nNow;
+                };
+
+                // The local share (CSigSharesManager::PrepareSigShare) and the shares received
+                vSigShares.clear();
+                for (size_t i = nFirst; i < nLast; i++) {
+                    llmq::CSigShare sigShare;
+                    sigShare.llmqType = params.type;
+                    sigShare.quorumHash = quorumHash;
+                    sigShare.quorumMember = 0;
+                    sigShare.id = vRequests[i].id;
+                    sigShare.msgHash = vRequests[i].msgHash;
+                    sigShare.sigShare = quorum->GetSkShare().Sign(vRequests[i].signHash);
+                    sigShare.UpdateKey();
+                    vSigShares.emplace_back(std::move(sigShare));
+                }
+                markStep(STEP_SIGN_SHARE);
+                for (size_t i = nFirst; i < nLast; i++) {
+                    std::vector<llmq::CBatchedSigShares> vBatches;
+                    VectorReader(SER_NETWORK, PROTOCOL_VERSION, vRequests[i].vSharesMessage, 0, vBatches);
+                    for (const auto& batch : vBatches) {
+                        for (size_t j = 0; j < batch.sigShares.size(); j++) {
+                            vSigShares.emplace_back(batch.RebuildSigShare(j));
+                        }
+                    }
+                }
+                markStep(STEP_RECEIVE);
+
+                // CSigSharesManager::ProcessPendingSigShares, the sender of each share being its member
+                CBLSBatchVerifier<NodeId, llmq::SigShareKey> batchVerifier(false, true);
+                for (const auto& sigShare : vSigShares) {
+                    batchVerifier.PushMessage(sigShare.quorumMember, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare,
+                                              quorum->GetPubKeyShare(sigShare.quorumMember));
+                }
+                batchVerifier.Verify();
+                if (!batchVerifier.badSources.empty()) fFailed = true;
+                markStep(STEP_VERIFY_SHARES);
+
+                // CSigSharesManager::TryRecoverSig, with the shares of each session
+                std::vector<llmq::CRecoveredSig> vRecSigs(nLast - nFirst);
+                std::vector<std::vector<CBLSSignature>> vSessionSigs(nLast - nFirst);
+                std::vector<BLSIdVector> vSessionIds(nLast - nFirst);
+                for (size_t i = 0; i < vSigShares.size(); i++) {
+                    // the local shares come first, in the order of the requests, then the received ones
+                    const size_t nSession = i < vRecSigs.size() ? i : (i - vRecSigs.size()) / (params.threshold - 1);
+                    vSessionSigs[nSession].emplace_back(vSigShares[i].sigShare);
+                    vSessionIds[nSession].emplace_back(members[vSigShares[i].quorumMember]->proTxHash);
+                }
+                for (size_t i = 0; i < vRecSigs.size(); i++) {
+                    auto& rs = vRecSigs[i];
+                    rs.llmqType = params.type;
+                    rs.quorumHash = quorumHash;
+                    rs.id = vRequests[nFirst + i].id;
+                    rs.msgHash = vRequests[nFirst + i].msgHash;
+                    if (!rs.sig.Recover(vSessionSigs[i], vSessionIds[i])) fFailed = true;
+                    rs.UpdateHash();
+                }
+                markStep(STEP_RECOVER);
+
+                // CSigningManager::ProcessPendingRecoveredSigs
+                for (size_t i = 0; i < vRecSigs.size(); i++) {
+                    if (!vRecSigs[i].sig.VerifyInsecure(quorum->quorumPublicKey, llmq::utils::BuildSignHash(vRecSigs[i]))) {
+                        fFailed = true;
+                    }
+                    vRequests[nFirst + i].nLatency = GetTimeMicros() - nTimeStart;
+                }
+                markStep(STEP_VERIFY_RECOVERED);
+
+                for (int i = 0; i < STEP_COUNT; i++) vStepTimes[i] += vTimes[i];
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    const int64_t nTimeTotal = GetTimeMicros() - nTimeStart;
+    if (fFailed) {
+        fprintf(stderr, "Error: invalid sig share or recovered signature\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<int64_t> vLatencies;
+    vLatencies.reserve(vRequests.size());
+    for (const auto& req : vRequests) vLatencies.emplace_back(req.nLatency);
+    std::sort(vLatencies.begin(), vLatencies.end());
+    const double dSeconds = std::max(nTimeTotal, (int64_t)1) * 0.000001;
+    printf("Recovered %zu signatures in %.3fs, %.2f recovered sigs/s\n", vRequests.size(), dSeconds, vRequests.size() / dSeconds);
+    printf("Latency (ms): p50 %.2f, p90 %.2f, p99 %.2f, max %.2f\n", GetPercentile(vLatencies, 0.5) * 0.001,
+           GetPercentile(vLatencies, 0.9) * 0.001, GetPercentile(vLatencies, 0.99) * 0.001, vLatencies.back() * 0.001);
+    printf("%-16s %14s %14s\n", "step", "total (ms)", "per sig (us)");
+    for (int i = 0; i < STEP_COUNT; i++) {
+        printf("%-16s %14.2f %14.2f\n", vSigningStepNames[i], vStepTimes[i] * 0.001, (double)vStepTimes[i] / vRequests.size());
+    }
+    return EXIT_SUCCESS;
+}
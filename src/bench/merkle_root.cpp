@@ -0,0 +1,57 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+
+#include "consensus/merkle.h"
+#include "merkleblock.h"
+#include "random.h"
+#include "uint256.h"
+
+static std::vector<uint256> RandomLeaves(size_t nLeaves)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> leaves(nLeaves);
+    for (auto& leaf : leaves) {
+        leaf = rng.rand256();
+    }
+    return leaves;
+}
+
+static void MerkleRoot(benchmark::State& state, size_t nLeaves)
+{
+    const std::vector<uint256>& leaves = RandomLeaves(nLeaves);
+    while (state.KeepRunning()) {
+        bool mutation = false;
+        uint256 hash = ComputeMerkleRoot(leaves, &mutation);
+        assert(!hash.IsNull());
+    }
+}
+
+// Partial tree of a filtered block, with one transaction out of 100 matching
+static void PartialMerkleTree(benchmark::State& state, size_t nLeaves)
+{
+    const std::vector<uint256>& leaves = RandomLeaves(nLeaves);
+    std::vector<bool> vMatch(nLeaves, false);
+    for (size_t i = 0; i < nLeaves; i += 100) {
+        vMatch[i] = true;
+    }
+    while (state.KeepRunning()) {
+        CPartialMerkleTree tree(leaves, vMatch);
+        std::vector<uint256> vMatched;
+        assert(!tree.ExtractMatches(vMatched).IsNull());
+    }
+}
+
+static void MerkleRoot_1k(benchmark::State& state) { MerkleRoot(state, 1000); }
+static void MerkleRoot_10k(benchmark::State& state) { MerkleRoot(state, 10000); }
+static void MerkleRoot_100k(benchmark::State& state) { MerkleRoot(state, 100000); }
+static void PartialMerkleTree_1k(benchmark::State& state) { PartialMerkleTree(state, 1000); }
+static void PartialMerkleTree_10k(benchmark::State& state) { PartialMerkleTree(state, 10000); }
+
+BENCHMARK(MerkleRoot_1k, 5000);
+BENCHMARK(MerkleRoot_10k, 500);
+BENCHMARK(MerkleRoot_100k, 50);
+BENCHMARK(PartialMerkleTree_1k, 1000);
+BENCHMARK(PartialMerkleTree_10k, 100);
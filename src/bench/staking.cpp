@@ -0,0 +1,229 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "kernel.h"
+#include "random.h"
+#include "sapling/incrementalmerkletree.h"
+#include "stakeinput.h"
+#include "txdb.h"
+#include "validation.h"
+#include "wallet/wallet.h"
+
+// Number of synthetic stake inputs hashed by the kernel benchmarks
+static const int KERNEL_STAKES = 1000;
+// Number of coins of the synthetic staking wallet, and how many of them each block confirms
+static const int WALLET_STAKES = 5000;
+static const int WALLET_STAKES_PER_BLOCK = 50;
+// Height of the tip staked on: past UPGRADE_V3_4 and deep enough for every coin of the wallet
+static const int STAKE_TIP_HEIGHT = 300;
+// Target low enough for (almost) every attempt to miss, like most of the time slots on mainnet
+static const unsigned int HARD_STAKE_BITS = 0x1a00ffff;
+
+// Parent and origin blocks of the synthetic stakes. Hashing the kernels needs no chain.
+struct KernelBenchSetup
+{
+    uint256 hashPrev{GetRandHash()};
+    CBlockIndex indexFrom;
+    CBlockIndex indexPrev;
+    std::vector<CPivStake> stakes;
+
+    KernelBenchSetup()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        const int64_t nTimeNow = GetTime();
+        indexFrom.nHeight = 1;
+        indexFrom.nTime = nTimeNow - STAKE_TIP_HEIGHT * Params().GetConsensus().nTargetSpacing;
+        indexPrev.nHeight = STAKE_TIP_HEIGHT;
+        indexPrev.nTime = nTimeNow;
+        indexPrev.phashBlock = &hashPrev;
+        indexPrev.SetStakeModifier(GetRandHash());
+        stakes.reserve(KERNEL_STAKES);
+        for (int i = 0; i < KERNEL_STAKES; i++) {
+            stakes.emplace_back(CTxOut(100 * COIN, CScript() << OP_TRUE), COutPoint(GetRandHash(), 0), &indexFrom);
+        }
+    }
+};
+
+// One time slot for every stake of the set, from scratch each time
+static void StakeKernelHash(benchmark::State& state)
+{
+    KernelBenchSetup setup;
+    int nTimeTx = setup.indexPrev.nTime;
+    while (state.KeepRunning()) {
+        nTimeTx += Params().GetConsensus().nTimeSlotLength;
+        for (CPivStake& stake : setup.stakes) {
+            CStakeKernel kernel(&setup.indexPrev, &stake, HARD_STAKE_BITS, nTimeTx);
+            kernel.CheckKernelHash(true);
+        }
+    }
+}
+
+// Same as above, reusing the hashing state of every stake across the time slots
+static void StakeKernelSearchHash(benchmark::State& state)
+{
+    KernelBenchSetup setup;
+    CStakeKernelSearch kernelSearch;
+    int nTimeTx = setup.indexPrev.nTime;
+    while (state.KeepRunning()) {
+        nTimeTx += Params().GetConsensus().nTimeSlotLength;
+        for (CPivStake& stake : setup.stakes) {
+            kernelSearch.CheckKernelHash(&setup.indexPrev, &stake, HARD_STAKE_BITS, nTimeTx);
+        }
+    }
+}
+
+// Appends pblock to chainActive without validating it (its parent is the current tip)
+static CBlockIndex* AppendSyntheticBlock(const std::shared_ptr<CBlock>& pblock)
+{
+    LOCK(cs_main);
+    CBlockIndex* pindexPrev = chainActive.Tip();
+    if (pindexPrev) pblock->hashPrevBlock = pindexPrev->GetBlockHash();
+    pblock->nBits = UintToArith256(Params().GetConsensus().posLimitV2).GetCompact();
+    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    pblock->hashFinalSaplingRoot = SaplingMerkleTree::empty_root();
+
+    CBlockIndex* pindex = new CBlockIndex(*pblock);
+    pindex->nHeight = pindexPrev ? pindexPrev->nHeight + 1 : 0;
+    pindex->pprev = pindexPrev;
+    pindex->BuildSkip();
+    BlockMap::iterator mi = mapBlockIndex.emplace(pblock->GetHash(), pindex).first;
+    pindex->phashBlock = &((*mi).first);
+    if (pindexPrev) pindex->SetNewStakeModifier(pblock->GetHash());
+    chainActive.SetTip(pindex);
+    return pindex;
+}
+
+// Synthetic large wallet, one coin per transaction, staking on a chain of synthetic blocks
+class StakingWalletSetup
+{
+public:
+    std::unique_ptr<CWallet> pwallet;
+    const CBlockIndex* pindexTip{nullptr};
+
+    StakingWalletSetup()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+
+        pwallet = std::make_unique<CWallet>("staking", WalletDatabase::CreateMock());
+        bool isInit;
+        pwallet->LoadWallet(isInit);
+        pwallet->SetupSPKM(true, true);
+        std::vector<CScript> scripts;
+        for (int i = 0; i < 100; i++) {
+            auto res = pwallet->getNewAddress("");
+            if (!res) throw std::runtime_error("Cannot create staking address");
+            scripts.emplace_back(GetScriptForDestination(*res.getObjResult()));
+        }
+
+        const int64_t nSpacing = Params().GetConsensus().nTargetSpacing;
+        const int64_t nTimeStart = GetTime() - (STAKE_TIP_HEIGHT + 1) * nSpacing;
+        int nCoins = 0;
+        for (int nHeight = 0; nHeight <= STAKE_TIP_HEIGHT; nHeight++) {
+            auto pblock = std::make_shared<CBlock>();
+            pblock->nTime = nTimeStart + nHeight * nSpacing;
+            for (int i = 0; nHeight > 0 && i < WALLET_STAKES_PER_BLOCK && nCoins < WALLET_STAKES; i++, nCoins++) {
+                CMutableTransaction mtx;
+                mtx.vin.emplace_back(COutPoint(GetRandHash(), 0));
+                mtx.vout.emplace_back(100 * COIN, scripts[nCoins % scripts.size()]);
+                CTransactionRef tx = MakeTransactionRef(mtx);
+                pcoinsTip->AddCoin(COutPoint(tx->GetHash(), 0), Coin(tx->vout[0], nHeight, false, false), false);
+                pblock->vtx.emplace_back(tx);
+            }
+            CBlockIndex* pindex = AppendSyntheticBlock(pblock);
+            pwallet->BlockConnected(pblock, pindex);
+            pindexTip = pindex;
+        }
+        assert(nCoins == WALLET_STAKES);
+    }
+
+    ~StakingWalletSetup()
+    {
+        pwallet.reset();
+        UnloadBlockIndex();
+        pcoinsTip.reset();
+        pcoinsdbview.reset();
+    }
+
+    std::vector<CStakeableOutput> GetStakeableCoins()
+    {
+        std::vector<CStakeableOutput> coins;
+        assert(pwallet->StakeableCoins(&coins));
+        assert(coins.size() == (size_t) WALLET_STAKES);
+        return coins;
+    }
+};
+
+static void StakeableCoinsBench(benchmark::State& state)
+{
+    StakingWalletSetup setup;
+    std::vector<CStakeableOutput> coins;
+    while (state.KeepRunning()) {
+        setup.pwallet->StakeableCoins(&coins);
+    }
+}
+
+// A time slot where none of the coins finds a kernel: the whole wallet is tried
+static void CreateCoinStakeNoKernel(benchmark::State& state)
+{
+    StakingWalletSetup setup;
+    std::vector<CStakeableOutput> coins = setup.GetStakeableCoins();
+    while (state.KeepRunning()) {
+        CMutableTransaction txCoinStake;
+        int64_t nTxNewTime = 0;
+        setup.pwallet->CreateCoinStake(setup.pindexTip, HARD_STAKE_BITS, txCoinStake, nTxNewTime, &coins, false);
+    }
+}
+
+// A time slot where a kernel is found: the coinstake is created and signed
+static void CreateCoinStakeBench(benchmark::State& state)
+{
+    StakingWalletSetup setup;
+    std::vector<CStakeableOutput> coins = setup.GetStakeableCoins();
+    while (state.KeepRunning()) {
+        CMutableTransaction txCoinStake;
+        int64_t nTxNewTime = 0;
+        assert(setup.pwallet->CreateCoinStake(setup.pindexTip, setup.pindexTip->nBits, txCoinStake, nTxNewTime, &coins, false));
+        assert(setup.pwallet->SignCoinStake(txCoinStake));
+    }
+}
+
+static void CheckProofOfStakeBench(benchmark::State& state)
+{
+    StakingWalletSetup setup;
+    std::vector<CStakeableOutput> coins = setup.GetStakeableCoins();
+
+    CBlock block;
+    block.hashPrevBlock = setup.pindexTip->GetBlockHash();
+    block.nBits = setup.pindexTip->nBits;
+    CMutableTransaction txCoinbase;
+    txCoinbase.vin.emplace_back();
+    txCoinbase.vin[0].scriptSig = CScript() << (setup.pindexTip->nHeight + 1) << OP_0;
+    txCoinbase.vout.emplace_back();
+    txCoinbase.vout[0].SetEmpty();
+    CMutableTransaction txCoinStake;
+    int64_t nTxNewTime = 0;
+    assert(setup.pwallet->CreateCoinStake(setup.pindexTip, block.nBits, txCoinStake, nTxNewTime, &coins, false));
+    assert(setup.pwallet->SignCoinStake(txCoinStake));
+    block.nTime = nTxNewTime;
+    block.vtx.emplace_back(MakeTransactionRef(txCoinbase));
+    block.vtx.emplace_back(MakeTransactionRef(txCoinStake));
+
+    while (state.KeepRunning()) {
+        std::string strError;
+        assert(WITH_LOCK(cs_main, return CheckProofOfStake(block, strError, setup.pindexTip); ));
+    }
+}
+
+BENCHMARK(StakeKernelHash, 500);
+BENCHMARK(StakeKernelSearchHash, 2000);
+BENCHMARK(StakeableCoinsBench, 200);
+BENCHMARK(CreateCoinStakeNoKernel, 100);
+BENCHMARK(CreateCoinStakeBench, 1000);
+BENCHMARK(CheckProofOfStakeBench, 5000);
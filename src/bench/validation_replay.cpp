@@ -0,0 +1,244 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+// Macro-benchmark of the full validation pipeline: replays a recorded block range through
+// ProcessNewBlock, on a temporary datadir, and reports the throughput and the time spent
+// in each validation step (the per-block profiles kept by ConnectTip).
+
+#include "bench/bench.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "coins.h"
+#include "evo/deterministicmns.h"
+#include "evo/evodb.h"
+#include "llmq/quorums_init.h"
+#include "random.h"
+#include "scheduler.h"
+#include "sporkdb.h"
+#include "streams.h"
+#include "tiertwo/init.h"
+#include "txdb.h"
+#include "util/system.h"
+#include "validation.h"
+#include "validationinterface.h"
+
+#include <boost/thread.hpp>
+
+#include <deque>
+#include <unordered_map>
+
+static const char* DEFAULT_REPLAY_CHAIN = "main";
+static const int DEFAULT_REPLAY_PAR = 0;
+
+/**
+ * Read the blocks of a file in the format of the blk?????.dat files (e.g. a copy of the block files
+ * of a synced node, or the output of linearize-data.py), in the order they connect from the genesis
+ * block. The blocks not connecting to it are left out.
+ */
+static bool ReadReplayBlocks(const fs::path& path, size_t nMaxBlocks,
+                             std::vector<std::shared_ptr<const CBlock>>& vBlocks, uint64_t& nBytes)
+{
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: cannot open the replay file %s\n", path.string().c_str());
+        return false;
+    }
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+
+    // The block files hold the blocks in the order they were received, not the chain order
+    std::unordered_multimap<uint256, std::pair<std::shared_ptr<const CBlock>, unsigned int>, SaltedIdHasher> mapByPrev;
+    const CMessageHeader::MessageStartChars& messageStart = Params().MessageStart();
+    while (true) {
+        unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+        unsigned int nSize = 0;
+        auto pblock = std::make_shared<CBlock>();
+        try {
+            filein.read((char*)buf, CMessageHeader::MESSAGE_START_SIZE);
+            // the block files are preallocated, with zeros after the last block
+            if (memcmp(buf, messageStart, CMessageHeader::MESSAGE_START_SIZE) != 0) break;
+            filein >> nSize;
+            filein >> *pblock;
+        } catch (const std::exception&) {
+            break;
+        }
+        mapByPrev.emplace(pblock->hashPrevBlock, std::make_pair(pblock, nSize));
+    }
+
+    std::deque<uint256> vToConnect{Params().GenesisBlock().GetHash()};
+    while (!vToConnect.empty() && vBlocks.size() < nMaxBlocks) {
+        const auto range = mapByPrev.equal_range(vToConnect.front());
+        vToConnect.pop_front();
+        for (auto it = range.first; it != range.second && vBlocks.size() < nMaxBlocks; ++it) {
+            vBlocks.emplace_back(it->second.first);
+            nBytes += it->second.second;
+            vToConnect.emplace_back(it->second.first->GetHash());
+        }
+    }
+    return true;
+}
+
+/** A node without networking, on a temporary datadir, as AppInitMain sets it up */
+class ReplaySetup
+{
+public:
+    ReplaySetup(int64_t nDbCache, int nPar)
+        : m_path_datadir{fs::temp_directory_path() / "bench_pivx" / std::to_string(GetRand(1u << 31))}
+    {
+        fs::create_directories(m_path_datadir);
+        gArgs.ForceSetArg("-datadir", m_path_datadir.string());
+        ClearDatadirCache();
+
+        // The split of -dbcache of AppInitMain
+        int64_t nTotalCache = std::max(nDbCache, nMinDbCache) << 20;
+        const int64_t nBlockTreeDBCache = std::min(nTotalCache / 8, nMaxBlockDBCache << 20);
+        nTotalCache -= nBlockTreeDBCache;
+        int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23));
+        nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20);
+        nTotalCache -= nCoinDBCache;
+        nCoinCacheUsage = nTotalCache;
+
+        initZKSNARKS(true);
+
+        CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
+        threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+        GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
+        // The -par of AppInitParameterInteraction
+        nScriptCheckThreads = nPar;
+        if (nScriptCheckThreads <= 0) nScriptCheckThreads += GetNumCores();
+        if (nScriptCheckThreads <= 1) {
+            nScriptCheckThreads = 0;
+        } else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS) {
+            nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
+        }
+        for (int i = 0; i < nScriptCheckThreads - 1; i++) {
+            threadGroup.create_thread(&ThreadScriptCheck);
+        }
+        if (gArgs.GetBoolArg("-asyncblockwrites", DEFAULT_ASYNC_BLOCK_WRITES)) {
+            StartBlockFileWriters();
+        }
+
+        InitTierTwoInterfaces();
+        pblocktree.reset(new CBlockTreeDB(nBlockTreeDBCache, false, true));
+        zerocoinDB.reset(new CZerocoinDB(0, false, true));
+        pSporkDB.reset(new CSporkDB(0, false, true));
+        InitTierTwoPreChainLoad(true);
+        if (!LoadGenesisBlock()) {
+            throw std::runtime_error("Error initializing block database");
+        }
+        pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, true));
+        pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+        InitTierTwoPostCoinsCacheLoad(&scheduler);
+        CValidationState state;
+        if (!ActivateBestChain(state)) {
+            throw std::runtime_error("Error connecting the genesis block");
+        }
+    }
+
+    ~ReplaySetup()
+    {
+        scheduler.stop();
+        llmq::InterruptLLMQSystem();
+        threadGroup.interrupt_all();
+        threadGroup.join_all();
+        GetMainSignals().FlushBackgroundCallbacks();
+        ResetTierTwoInterfaces();
+        UnregisterAllValidationInterfaces();
+        GetMainSignals().UnregisterBackgroundSignalScheduler();
+        UnloadBlockIndex();
+        pcoinsTip.reset();
+        pcoinsdbview.reset();
+        pblocktree.reset();
+        zerocoinDB.reset();
+        pSporkDB.reset();
+        StopBlockFileWriters();
+        llmq::DestroyLLMQSystem();
+        deterministicMNManager.reset();
+        evoDb.reset();
+        fs::remove_all(m_path_datadir);
+    }
+
+private:
+    const fs::path m_path_datadir;
+    boost::thread_group threadGroup;
+    CScheduler scheduler;
+};
+
+int RunValidationReplay()
+{
+    const std::string strChain = gArgs.GetArg("-replaychain", DEFAULT_REPLAY_CHAIN);
+    const int64_t nDbCache = gArgs.GetArg("-replaydbcache", nDefaultDbCache);
+    const int nPar = (int)gArgs.GetArg("-replaypar", DEFAULT_REPLAY_PAR);
+    const int64_t nMaxBlocks = gArgs.GetArg("-replaymaxblocks", 0);
+    const std::string strCpus = gArgs.GetArg("-validationcpus", "");
+    if (!SetValidationThreadsCpus(strCpus)) {
+        fprintf(stderr, "Error: invalid CPUs list '%s'\n", strCpus.c_str());
+        return EXIT_FAILURE;
+    }
+    try {
+        SelectParams(strChain);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::shared_ptr<const CBlock>> vBlocks;
+    uint64_t nBytes = 0;
+    const fs::path pathReplay = fs::absolute(gArgs.GetArg("-replayfile", ""));
+    if (!ReadReplayBlocks(pathReplay, nMaxBlocks > 0 ? (size_t)nMaxBlocks : std::numeric_limits<size_t>::max(), vBlocks, nBytes)) {
+        return EXIT_FAILURE;
+    }
+    if (vBlocks.empty()) {
+        fprintf(stderr, "Error: no block connecting to the %s genesis block in %s\n", strChain.c_str(), pathReplay.string().c_str());
+        return EXIT_FAILURE;
+    }
+
+    // This thread connects the blocks, as the message handler of a node: it fills the coins cache
+    ApplyValidationThreadAffinity();
+    ReplaySetup setup(nDbCache, nPar);
+
+    // The profiles are kept for the last blocks only: sum them after each block
+    std::vector<int64_t> vStepTotals(vBlockProfileSteps.size(), 0);
+    size_t nConnected = 0;
+    uint256 hashLastProfile = WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash());
+    int64_t nTimeProcess = 0;
+    for (const auto& pblock : vBlocks) {
+        const int64_t nTimeStart = GetTimeMicros();
+        const bool fAccepted = ProcessNewBlock(pblock, nullptr);
+        nTimeProcess += GetTimeMicros() - nTimeStart;
+        if (!fAccepted) {
+            fprintf(stderr, "Error: block %s rejected\n", pblock->GetHash().ToString().c_str());
+            return EXIT_FAILURE;
+        }
+
+        LOCK(cs_main);
+        const std::vector<BlockValidationProfile> vProfiles = GetBlockValidationProfiles();
+        for (auto it = vProfiles.rbegin(); it != vProfiles.rend() && it->hash != hashLastProfile; ++it) {
+            for (size_t i = 0; i < vBlockProfileSteps.size(); i++) {
+                vStepTotals[i] += (*it).*vBlockProfileSteps[i].second;
+            }
+            nConnected++;
+        }
+        if (!vProfiles.empty()) hashLastProfile = vProfiles.back().hash;
+    }
+    const int64_t nTimeFlushStart = GetTimeMicros();
+    FlushStateToDisk();
+    const int64_t nTimeFlush = GetTimeMicros() - nTimeFlushStart;
+
+    const CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainActive.Tip());
+    const double dSeconds = std::max(nTimeProcess, (int64_t)1) * 0.000001;
+    printf("Replayed %zu blocks (%.2f MB) of %s on %s, -dbcache=%d -par=%d -validationcpus=%s\n",
+           vBlocks.size(), nBytes * 0.000001, pathReplay.string().c_str(), strChain.c_str(), (int)nDbCache, nPar,
+           strCpus.empty() ? "all" : strCpus.c_str());
+    printf("Tip: height %d, %s\n", pindexTip->nHeight, pindexTip->GetBlockHash().ToString().c_str());
+    printf("ProcessNewBlock: %.3fs, %.2f blocks/s, %.3f MB/s, final flush %.3fs\n",
+           dSeconds, vBlocks.size() / dSeconds, nBytes * 0.000001 / dSeconds, nTimeFlush * 0.000001);
+    printf("%-16s %14s %14s\n", "step", "total (ms)", "per block (us)");
+    for (size_t i = 0; i < vBlockProfileSteps.size(); i++) {
+        printf("%-16s %14.2f %14.2f\n", vBlockProfileSteps[i].first, vStepTotals[i] * 0.001,
+               nConnected ? (double)vStepTotals[i] / nConnected : 0.0);
+    }
+    return EXIT_SUCCESS;
+}
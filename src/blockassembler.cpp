@@ -96,7 +96,12 @@ bool SolveProofOfStake(CBlock* pblock, CBlockIndex* pindexPrev, CWallet* pwallet
     FillBlockPayee(txCoinbase, txCoinStake, pindexPrev, true);
 
     // Sign coinstake
-    if (!pwallet->SignCoinStake(txCoinStake)) {
+    bool fSigned;
+    {
+        StakingStepTimer timer(pwallet->pStakerStatus, StakingStep::SIGN_COINSTAKE);
+        fSigned = pwallet->SignCoinStake(txCoinStake);
+    }
+    if (!fSigned) {
         const COutPoint& stakeIn = txCoinStake.vin[0].prevout;
         return error("Unable to sign coinstake with input %s-%d", stakeIn.hash.ToString(), stakeIn.n);
     }
@@ -140,6 +145,7 @@ BlockAssembler::BlockAssembler(const CChainParams& _chainparams, const bool _def
     nBlockMaxSize = gArgs.GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
     // Limit to between 1K and MAX_BLOCK_SIZE-1K for sanity:
     nBlockMaxSize = std::max((unsigned int)1000, std::min((unsigned int)(MAX_BLOCK_SIZE_CURRENT - 1000), nBlockMaxSize));
+    nBlockMaxShieldedCost = gArgs.GetArg("-blockmaxshieldedcost", DEFAULT_BLOCK_MAX_SHIELDED_COST);
 }
 
 void BlockAssembler::resetBlock()
@@ -153,6 +159,7 @@ void BlockAssembler::resetBlock()
     // These counters do not include coinbase tx
     nBlockTx = 0;
     nFees = 0;
+    nShieldedCost = 0;
 }
 
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn,
@@ -174,17 +181,13 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     pblocktemplate->vTxFees.push_back(-1); // updated at end
     pblocktemplate->vTxSigOps.push_back(-1); // updated at end
+    pblocktemplate->vTxShieldedCost.push_back(0);
 
     CBlockIndex* pindexPrev = prevBlock ? prevBlock : WITH_LOCK(cs_main, return chainActive.Tip());
     assert(pindexPrev);
     nHeight = pindexPrev->nHeight + 1;
 
-    pblock->nVersion = ComputeBlockVersion(chainparams.GetConsensus(), nHeight);
-    // -regtest only: allow overriding block.nVersion with
-    // -blockversion=N to test forking scenarios
-    if (Params().IsRegTestNet()) {
-        pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
-    }
+    setBlockVersion();
 
     // Depending on the tip height, try to find a coinstake who solves the block or create a coinbase tx.
     if (!(fProofOfStake ? SolveProofOfStake(pblock, pindexPrev, pwallet, availableCoins, stopPoSOnNewBlock)
@@ -192,27 +195,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
         return nullptr;
     }
 
-    // After v6 enforcement, add LLMQ commitments if needed
-    const Consensus::Params& consensus = Params().GetConsensus();
-    if (consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V6_0) && fIncludeQfc) {
-        LOCK(cs_main);
-        for (const auto& p : Params().GetConsensus().llmqs) {
-            CTransactionRef qcTx;
-            if (llmq::quorumBlockProcessor->GetMinableCommitmentTx(p.first, nHeight, qcTx)) {
-                pblock->vtx.emplace_back(qcTx);
-                pblocktemplate->vTxFees.emplace_back(0);
-                pblocktemplate->vTxSigOps.emplace_back(0);
-                nBlockSize += qcTx->GetTotalSize();
-                ++nBlockTx;
-            }
-        }
-    }
-
-    if (!fNoMempoolTx) {
-        // Add transactions from mempool
-        LOCK2(cs_main,mempool.cs);
-        addPackageTxs();
-    }
+    addBlockTxs(fNoMempoolTx, fIncludeQfc);
 
     if (!fProofOfStake) {
         // Coinbase can get the fees.
@@ -224,12 +207,12 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     nLastBlockTx = nBlockTx;
     nLastBlockSize = nBlockSize;
-    LogPrintf("CreateNewBlock(): total size %u txs: %u fees: %ld sigops %d\n", nBlockSize, nBlockTx, nFees, nBlockSigOps);
+    LogPrintf("CreateNewBlock(): total size %u txs: %u fees: %ld sigops %d shielded cost %u\n", nBlockSize, nBlockTx, nFees, nBlockSigOps, nShieldedCost);
 
 
     // Fill in header
     pblock->hashPrevBlock = pindexPrev->GetBlockHash();
-    if (!fProofOfStake) UpdateTime(pblock, consensus, pindexPrev);
+    if (!fProofOfStake) UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
     pblock->nBits = GetNextWorkRequired(pindexPrev, pblock);
     pblock->nNonce = 0;
     pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(*(pblock->vtx[0]));
@@ -238,6 +221,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     if (fProofOfStake) { // this is only for PoS because the IncrementExtraNonce does it for PoW
         pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
         LogPrintf("CPUMiner : proof-of-stake block found %s \n", pblock->GetHash().GetHex());
+        StakingStepTimer timer(pwallet->pStakerStatus, StakingStep::SIGN_BLOCK);
         if (!SignBlock(*pblock, *pwallet)) {
             LogPrintf("%s: Signing new block with UTXO key failed \n", __func__);
             return nullptr;
@@ -259,6 +243,164 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     return std::move(pblocktemplate);
 }
 
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateStakeTemplate(CBlockIndex* pindexPrev, bool fIncludeQfc)
+{
+    resetBlock();
+
+    pblocktemplate.reset(new CBlockTemplate());
+    pblock = &pblocktemplate->block;
+
+    assert(pindexPrev);
+    nHeight = pindexPrev->nHeight + 1;
+    setBlockVersion();
+    addBlockTxs(false, fIncludeQfc);
+
+    pblock->hashPrevBlock = pindexPrev->GetBlockHash();
+    appendSaplingTreeRoot();
+    LogPrint(BCLog::STAKING, "%s: total size %u txs: %u fees: %ld sigops %d shielded cost %u\n", __func__, nBlockSize, nBlockTx, nFees, nBlockSigOps, nShieldedCost);
+
+    return std::move(pblocktemplate);
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::UpdateStakeTemplate(std::unique_ptr<CBlockTemplate> stakeTemplate, CBlockIndex* pindexPrev)
+{
+    assert(pindexPrev);
+    if (!stakeTemplate || stakeTemplate->block.hashPrevBlock != pindexPrev->GetBlockHash()) {
+        return CreateStakeTemplate(pindexPrev);
+    }
+
+    resetBlock();
+    pblocktemplate = std::move(stakeTemplate);
+    pblock = &pblocktemplate->block;
+    nHeight = pindexPrev->nHeight + 1;
+
+    {
+        LOCK2(cs_main, mempool.cs);
+        // Restore the state of the block from the txs of the template
+        bool fRebuild = false;
+        for (size_t i = 0; i < pblock->vtx.size(); i++) {
+            const CTransactionRef& tx = pblock->vtx[i];
+            nBlockSigOps += pblocktemplate->vTxSigOps[i];
+            nFees += pblocktemplate->vTxFees[i];
+            ++nBlockTx;
+            // The LLMQ commitments are not in the mempool
+            if (tx->IsQuorumCommitmentTx()) {
+                nBlockSize += tx->GetTotalSize();
+                continue;
+            }
+            CTxMemPool::txiter it = mempool.mapTx.find(tx->GetHash());
+            if (it == mempool.mapTx.end()) {
+                fRebuild = true;
+                break;
+            }
+            nBlockSize += it->GetTxSize();
+            inBlock.insert(it);
+            if (it->IsShielded()) {
+                nSizeShielded += it->GetTxSize();
+                nShieldedCost += pblocktemplate->vTxShieldedCost[i];
+            }
+        }
+
+        if (!fRebuild && nBlockSize <= nBlockMaxSize / 2) {
+            // Only the txs not in the block yet are selected
+            const unsigned int nSizeShieldedOld = nSizeShielded;
+            addPackageTxs();
+            if (nSizeShielded != nSizeShieldedOld) {
+                appendSaplingTreeRoot();
+            }
+            LogPrint(BCLog::STAKING, "%s: total size %u txs: %u fees: %ld sigops %d shielded cost %u\n", __func__, nBlockSize, nBlockTx, nFees, nBlockSigOps, nShieldedCost);
+            return std::move(pblocktemplate);
+        }
+    }
+
+    return CreateStakeTemplate(pindexPrev);
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewStakeBlock(const CBlockTemplate& stakeTemplate,
+                                                                    CWallet* pwallet,
+                                                                    std::vector<CStakeableOutput>* availableCoins,
+                                                                    bool stopPoSOnNewBlock)
+{
+    CBlockIndex* pindexPrev = WITH_LOCK(cs_main, return LookupBlockIndex(stakeTemplate.block.hashPrevBlock));
+    if (!pindexPrev) return nullptr;
+
+    resetBlock();
+
+    pblocktemplate.reset(new CBlockTemplate());
+    pblock = &pblocktemplate->block;
+    nHeight = pindexPrev->nHeight + 1;
+    pblock->nVersion = stakeTemplate.block.nVersion;
+
+    if (!SolveProofOfStake(pblock, pindexPrev, pwallet, availableCoins, stopPoSOnNewBlock)) {
+        return nullptr;
+    }
+
+    // Stake found: add the txs selected in advance
+    pblock->vtx.insert(pblock->vtx.end(), stakeTemplate.block.vtx.begin(), stakeTemplate.block.vtx.end());
+    pblocktemplate->vTxFees.push_back(-1);
+    pblocktemplate->vTxFees.insert(pblocktemplate->vTxFees.end(), stakeTemplate.vTxFees.begin(), stakeTemplate.vTxFees.end());
+    pblocktemplate->vTxSigOps.push_back(GetLegacySigOpCount(*(pblock->vtx[0])));
+    pblocktemplate->vTxSigOps.insert(pblocktemplate->vTxSigOps.end(), stakeTemplate.vTxSigOps.begin(), stakeTemplate.vTxSigOps.end());
+    pblocktemplate->vTxShieldedCost.push_back(0);
+    pblocktemplate->vTxShieldedCost.insert(pblocktemplate->vTxShieldedCost.end(), stakeTemplate.vTxShieldedCost.begin(), stakeTemplate.vTxShieldedCost.end());
+
+    // Fill in header. Coinbase and coinstake have no shielded outputs: the Sapling root is the one of the template.
+    pblock->hashPrevBlock = pindexPrev->GetBlockHash();
+    pblock->nBits = GetNextWorkRequired(pindexPrev, pblock);
+    pblock->nNonce = 0;
+    pblock->hashFinalSaplingRoot = stakeTemplate.block.hashFinalSaplingRoot;
+    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    LogPrintf("CPUMiner : proof-of-stake block found %s \n", pblock->GetHash().GetHex());
+    bool fSigned;
+    {
+        StakingStepTimer timer(pwallet->pStakerStatus, StakingStep::SIGN_BLOCK);
+        fSigned = SignBlock(*pblock, *pwallet);
+    }
+    if (!fSigned) {
+        LogPrintf("%s: Signing new block with UTXO key failed \n", __func__);
+        return nullptr;
+    }
+
+    if (WITH_LOCK(cs_main, return chainActive.Tip() != pindexPrev)) return nullptr; // new block came in, move on
+
+    return std::move(pblocktemplate);
+}
+
+void BlockAssembler::setBlockVersion()
+{
+    pblock->nVersion = ComputeBlockVersion(chainparams.GetConsensus(), nHeight);
+    // -regtest only: allow overriding block.nVersion with
+    // -blockversion=N to test forking scenarios
+    if (Params().IsRegTestNet()) {
+        pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
+    }
+}
+
+void BlockAssembler::addBlockTxs(bool fNoMempoolTx, bool fIncludeQfc)
+{
+    // After v6 enforcement, add LLMQ commitments if needed
+    if (chainparams.GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V6_0) && fIncludeQfc) {
+        LOCK(cs_main);
+        for (const auto& p : Params().GetConsensus().llmqs) {
+            CTransactionRef qcTx;
+            if (llmq::quorumBlockProcessor->GetMinableCommitmentTx(p.first, nHeight, qcTx)) {
+                pblock->vtx.emplace_back(qcTx);
+                pblocktemplate->vTxFees.emplace_back(0);
+                pblocktemplate->vTxSigOps.emplace_back(0);
+                pblocktemplate->vTxShieldedCost.emplace_back(0);
+                nBlockSize += qcTx->GetTotalSize();
+                ++nBlockTx;
+            }
+        }
+    }
+
+    if (!fNoMempoolTx) {
+        // Add transactions from mempool
+        LOCK2(cs_main,mempool.cs);
+        addPackageTxs();
+    }
+}
+
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
 {
     for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
@@ -297,6 +439,7 @@ void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
     pblock->vtx.emplace_back(iter->GetSharedTx());
     pblocktemplate->vTxFees.push_back(iter->GetFee());
     pblocktemplate->vTxSigOps.push_back(iter->GetSigOpCount());
+    pblocktemplate->vTxShieldedCost.push_back(GetShieldedValidationCost(iter->GetTx()));
     nBlockSize += iter->GetTxSize();
     ++nBlockTx;
     nBlockSigOps += iter->GetSigOpCount();
@@ -483,8 +626,14 @@ void BlockAssembler::addPackageTxs()
                 if (nSizeShielded + iterSortedEntries->GetTxSize() > MAX_BLOCK_SHIELDED_TXES_SIZE) {
                     break;
                 }
-                // Update cumulative size of SHIELD transactions in this block
+                // Don't add SHIELD transactions that would make the block too expensive to validate
+                const unsigned int nTxShieldedCost = GetShieldedValidationCost(iterSortedEntries->GetTx());
+                if (nShieldedCost + nTxShieldedCost > nBlockMaxShieldedCost) {
+                    break;
+                }
+                // Update cumulative size and validation cost of SHIELD transactions in this block
                 nSizeShielded += iterSortedEntries->GetTxSize();
+                nShieldedCost += nTxShieldedCost;
             }
             AddToBlock(iterSortedEntries);
             // Erase from the modified set, if present
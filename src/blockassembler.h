@@ -29,6 +29,7 @@ struct CBlockTemplate
     CBlock block;
     std::vector<CAmount> vTxFees;
     std::vector<int64_t> vTxSigOps;
+    std::vector<int64_t> vTxShieldedCost;
 };
 
 // Container for tracking updates to ancestor feerate as we include (parent)
@@ -141,6 +142,8 @@ private:
 
     // Configuration parameters for the block max size
     unsigned int nBlockMaxSize{0};
+    // Configuration parameters for the block max validation cost of shield txes
+    unsigned int nBlockMaxShieldedCost{0};
 
     // Information on the current status of the block
     uint64_t nBlockSize{0};
@@ -155,6 +158,8 @@ private:
 
     // Keep track of block space used for shield txes
     unsigned int nSizeShielded{0};
+    // Keep track of the validation cost of the shield txes (see GetShieldedValidationCost)
+    unsigned int nShieldedCost{0};
 
     // Whether should print priority by default or not
     const bool defaultPrintPriority{false};
@@ -172,12 +177,39 @@ public:
                                    bool stopPoSOnNewBlock = true,
                                    bool fIncludeQfc = true);
 
+    /**
+     * Select the mempool txs (and LLMQ commitments) of a PoS block on top of pindexPrev,
+     * and compute its Sapling root, ahead of the kernel search.
+     * The returned template has no coinbase/coinstake: it is completed by CreateNewStakeBlock.
+     */
+    std::unique_ptr<CBlockTemplate> CreateStakeTemplate(CBlockIndex* pindexPrev, bool fIncludeQfc = true);
+    /**
+     * Add the new mempool txs to a template returned by CreateStakeTemplate, keeping the txs
+     * already selected. The template is rebuilt from scratch (with CreateStakeTemplate) instead,
+     * if it's not on top of pindexPrev, if some of its txs left the mempool, or if it's more
+     * than half full (the new txs could then be worth more than the ones selected).
+     */
+    std::unique_ptr<CBlockTemplate> UpdateStakeTemplate(std::unique_ptr<CBlockTemplate> stakeTemplate, CBlockIndex* pindexPrev);
+    /**
+     * Search a kernel on top of the parent of stakeTemplate and, if found, return the
+     * signed PoS block with the txs of stakeTemplate. Only the coinstake (and the payees)
+     * and the signatures are left on the path from the kernel to the block.
+     */
+    std::unique_ptr<CBlockTemplate> CreateNewStakeBlock(const CBlockTemplate& stakeTemplate,
+                                                        CWallet* pwallet,
+                                                        std::vector<CStakeableOutput>* availableCoins,
+                                                        bool stopPoSOnNewBlock = true);
+
 private:
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
+    /** Set the version of the block */
+    void setBlockVersion();
+    /** Add the LLMQ commitments and, unless fNoMempoolTx, the mempool txs to the block */
+    void addBlockTxs(bool fNoMempoolTx, bool fIncludeQfc);
 
     // Methods for how to add transactions to a block.
     /** Add transactions based on feerate including unconfirmed ancestors */
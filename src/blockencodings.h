@@ -0,0 +1,154 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_BLOCKENCODINGS_H
+#define PIVX_BLOCKENCODINGS_H
+
+#include "primitives/block.h"
+
+#include <memory>
+
+class CTxMemPool;
+
+// Version of the compact block encoding, announced in sendcmpct
+static const uint64_t CMPCTBLOCKS_VERSION = 1;
+// Number of peers asked to announce new blocks to us with cmpctblock
+static const unsigned int MAX_CMPCTBLOCK_ANNOUNCERS = 3;
+// Depth up to which we answer with a compact block, or serve the missing transactions of one
+static const int MAX_CMPCTBLOCK_DEPTH = 5;
+static const int MAX_BLOCKTXN_DEPTH = 10;
+
+/** Serializes a sequence of increasing integers as the differences between them */
+class DifferenceFormatter
+{
+    uint64_t m_shift = 0;
+
+public:
+    template<typename Stream, typename I>
+    void Ser(Stream& s, I v)
+    {
+        if (v < m_shift || v >= std::numeric_limits<uint64_t>::max()) throw std::ios_base::failure("differential value overflow");
+        WriteCompactSize(s, v - m_shift);
+        m_shift = uint64_t(v) + 1;
+    }
+    template<typename Stream, typename I>
+    void Unser(Stream& s, I& v)
+    {
+        uint64_t n = ReadCompactSize(s);
+        m_shift += n;
+        if (m_shift < n || m_shift >= std::numeric_limits<uint64_t>::max() || m_shift < std::numeric_limits<I>::min() || m_shift > std::numeric_limits<I>::max())
+            throw std::ios_base::failure("differential value overflow");
+        v = I(m_shift++);
+    }
+};
+
+/** getblocktxn: the transactions of a compact block that could not be found in the mempool */
+class BlockTransactionsRequest
+{
+public:
+    uint256 blockhash;
+    std::vector<uint16_t> indexes;
+
+    SERIALIZE_METHODS(BlockTransactionsRequest, obj)
+    {
+        READWRITE(obj.blockhash, Using<VectorFormatter<DifferenceFormatter>>(obj.indexes));
+    }
+};
+
+/** blocktxn: the answer to a getblocktxn, with the transactions in the requested order */
+class BlockTransactions
+{
+public:
+    uint256 blockhash;
+    std::vector<CTransactionRef> txn;
+
+    BlockTransactions() {}
+    explicit BlockTransactions(const BlockTransactionsRequest& req) :
+        blockhash(req.blockhash), txn(req.indexes.size()) {}
+
+    SERIALIZE_METHODS(BlockTransactions, obj)
+    {
+        READWRITE(obj.blockhash, obj.txn);
+    }
+};
+
+/** A transaction sent in full inside a compact block */
+struct PrefilledTransaction
+{
+    // Serialized as the offset from the previous prefilled transaction,
+    // used as the index in the block by PartiallyDownloadedBlock
+    uint16_t index;
+    CTransactionRef tx;
+
+    SERIALIZE_METHODS(PrefilledTransaction, obj) { READWRITE(COMPACTSIZE(obj.index), obj.tx); }
+};
+
+enum ReadStatus {
+    READ_STATUS_OK,
+    READ_STATUS_INVALID, // Invalid object, peer is sending bogus data
+    READ_STATUS_FAILED,  // Failed to process object, the full block is needed
+};
+
+/**
+ * cmpctblock: a block header with the 6-byte short ids of its transactions.
+ * The coinbase, the coinstake and the quorum commitments are never in the mempool
+ * of the receiver, so they are sent in full. The signature of PoS blocks goes along.
+ */
+class CBlockHeaderAndShortTxIDs
+{
+private:
+    mutable uint64_t shorttxidk0, shorttxidk1;
+    uint64_t nonce;
+
+    void FillShortTxIDSelector() const;
+
+    friend class PartiallyDownloadedBlock;
+
+public:
+    static const int SHORTTXIDS_LENGTH = 6;
+
+    std::vector<uint64_t> shorttxids;
+    std::vector<PrefilledTransaction> prefilledtxn;
+    CBlockHeader header;
+    std::vector<unsigned char> vchBlockSig;
+
+    // Dummy for deserialization
+    CBlockHeaderAndShortTxIDs() {}
+
+    explicit CBlockHeaderAndShortTxIDs(const CBlock& block);
+
+    uint64_t GetShortID(const uint256& txhash) const;
+
+    size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
+
+    SERIALIZE_METHODS(CBlockHeaderAndShortTxIDs, obj)
+    {
+        READWRITE(obj.header, obj.nonce, Using<VectorFormatter<CustomUintFormatter<SHORTTXIDS_LENGTH>>>(obj.shorttxids),
+                  obj.prefilledtxn, obj.vchBlockSig);
+        SER_READ(obj, obj.FillShortTxIDSelector());
+    }
+};
+
+/** A compact block being reconstructed from the mempool and the blocktxn of the peer */
+class PartiallyDownloadedBlock
+{
+protected:
+    std::vector<CTransactionRef> txn_available;
+    size_t prefilled_count = 0, mempool_count = 0;
+    const CTxMemPool* pool;
+
+public:
+    CBlockHeader header;
+    std::vector<unsigned char> vchBlockSig;
+
+    explicit PartiallyDownloadedBlock(const CTxMemPool* poolIn) : pool(poolIn) {}
+
+    ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock);
+    bool IsTxAvailable(size_t index) const;
+    // vtx_missing holds the transactions that were not available, in block order
+    ReadStatus FillBlock(CBlock& block, const std::vector<CTransactionRef>& vtx_missing);
+};
+
+#endif // PIVX_BLOCKENCODINGS_H
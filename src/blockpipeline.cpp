@@ -0,0 +1,151 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "blockpipeline.h"
+
+#include "util/system.h"
+#include "utiltime.h"
+#include "validation.h"
+
+CBlockPipeline g_block_pipeline;
+
+static const std::array<const char*, CBlockPipeline::STAGES_COUNT> vStageNames{"receive", "precheck", "prefetch", "connect"};
+// The names of the stage threads (at most 10 characters, after the "pivx-" prefix)
+static const std::array<const char*, CBlockPipeline::STAGES_COUNT> vStageThreadNames{"", "ibdcheck", "ibdfetch", "ibdconnect"};
+
+CBlockPipeline::~CBlockPipeline()
+{
+    Stop();
+}
+
+void CBlockPipeline::Start(ConnectFunc connectIn)
+{
+    assert(!fRunning);
+    connect = std::move(connectIn);
+    {
+        LOCK(cs);
+        fInterrupted = false;
+        nStartTime = GetTimeMicros();
+        for (int i = 0; i < STAGES_COUNT; i++) {
+            stats[i] = BlockPipelineStageStats();
+            stats[i].name = vStageNames[i];
+        }
+    }
+    for (int i = PRECHECK; i < STAGES_COUNT; i++) {
+        threads.emplace_back(&TraceThread<std::function<void()> >, vStageThreadNames[i],
+                             std::function<void()>(std::bind(&CBlockPipeline::ThreadStage, this, (Stage)i)));
+    }
+    fRunning = true;
+}
+
+void CBlockPipeline::Interrupt()
+{
+    WITH_LOCK(cs, fInterrupted = true);
+    cv.notify_all();
+}
+
+void CBlockPipeline::Stop()
+{
+    if (!fRunning) return;
+    Interrupt();
+    for (std::thread& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+    threads.clear();
+    fRunning = false;
+
+    LOCK(cs);
+    for (auto& queue : queues) queue.clear();
+    nBlocksInPipeline = 0;
+}
+
+bool CBlockPipeline::Push(std::shared_ptr<const CBlock> pblock)
+{
+    if (!fRunning) return false;
+    const int64_t nStart = GetTimeMicros();
+    {
+        WAIT_LOCK(cs, lock);
+        cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return nBlocksInPipeline < MAX_BLOCK_PIPELINE_BLOCKS || fInterrupted; });
+        if (fInterrupted) return false;
+        queues[PRECHECK].emplace_back(std::move(pblock));
+        nBlocksInPipeline++;
+        stats[RECEIVE].nBlocks++;
+        stats[RECEIVE].nBusyMicros += GetTimeMicros() - nStart;
+        stats[RECEIVE].nMaxQueued = std::max(stats[RECEIVE].nMaxQueued, nBlocksInPipeline);
+        stats[PRECHECK].nMaxQueued = std::max(stats[PRECHECK].nMaxQueued, queues[PRECHECK].size());
+    }
+    cv.notify_all();
+    return true;
+}
+
+std::vector<BlockPipelineStageStats> CBlockPipeline::GetStats(int64_t& nUptimeMicros) const
+{
+    LOCK(cs);
+    nUptimeMicros = nStartTime ? GetTimeMicros() - nStartTime : 0;
+    std::vector<BlockPipelineStageStats> ret(stats.begin(), stats.end());
+    ret[RECEIVE].nQueued = nBlocksInPipeline;
+    for (int i = PRECHECK; i < STAGES_COUNT; i++) {
+        ret[i].nQueued = queues[i].size();
+    }
+    return ret;
+}
+
+void CBlockPipeline::ThreadStage(Stage stage)
+{
+    ApplyValidationThreadAffinity();
+    // The blocks are connected one by one, so that the room they leave is available right away
+    const size_t nMaxBatch = stage == CONNECT ? 1 : BLOCK_PIPELINE_BATCH_SIZE;
+    std::vector<std::shared_ptr<const CBlock>> vBlocks;
+    while (true) {
+        {
+            WAIT_LOCK(cs, lock);
+            auto& queue = queues[stage];
+            cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return !queue.empty() || fInterrupted; });
+            if (fInterrupted) return;
+            const size_t nBlocks = std::min(queue.size(), nMaxBatch);
+            vBlocks.assign(queue.begin(), queue.begin() + nBlocks);
+            queue.erase(queue.begin(), queue.begin() + nBlocks);
+        }
+
+        const int64_t nStart = GetTimeMicros();
+        try {
+            ProcessStage(stage, vBlocks);
+        } catch (const std::exception& e) {
+            PrintExceptionContinue(&e, "CBlockPipeline::ThreadStage()");
+        }
+        const int64_t nTime = GetTimeMicros() - nStart;
+
+        {
+            LOCK(cs);
+            stats[stage].nBlocks += vBlocks.size();
+            stats[stage].nBusyMicros += nTime;
+            if (stage == CONNECT) {
+                nBlocksInPipeline -= vBlocks.size();
+            } else {
+                auto& next = queues[stage + 1];
+                next.insert(next.end(), vBlocks.begin(), vBlocks.end());
+                stats[stage + 1].nMaxQueued = std::max(stats[stage + 1].nMaxQueued, next.size());
+            }
+        }
+        cv.notify_all();
+        vBlocks.clear();
+    }
+}
+
+void CBlockPipeline::ProcessStage(Stage stage, std::vector<std::shared_ptr<const CBlock>>& vBlocks)
+{
+    switch (stage) {
+        case PRECHECK:
+            PreValidateBlocks(vBlocks, true);
+            break;
+        case PREFETCH:
+            PrefetchBlocksInputs(vBlocks);
+            break;
+        case CONNECT:
+            for (const auto& pblock : vBlocks) connect(pblock);
+            break;
+        default:
+            assert(false);
+    }
+}
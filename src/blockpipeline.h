@@ -0,0 +1,103 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_BLOCKPIPELINE_H
+#define PIVX_BLOCKPIPELINE_H
+
+#include "primitives/block.h"
+#include "sync.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Default for -blockpipeline, process the blocks of the initial download in the block pipeline */
+static const bool DEFAULT_BLOCK_PIPELINE = true;
+/** Maximum number of blocks in the pipeline, received and not connected yet: the receiver waits above it */
+static const size_t MAX_BLOCK_PIPELINE_BLOCKS = 128;
+/** Maximum number of blocks taken together by the pre-check and the prefetch stages */
+static const size_t BLOCK_PIPELINE_BATCH_SIZE = 16;
+
+/** The activity of a stage of the block pipeline, since it started */
+struct BlockPipelineStageStats {
+    std::string name;
+    // Blocks done by the stage (received, for the first one)
+    uint64_t nBlocks{0};
+    // Blocks waiting for the stage, now and at most (all the blocks of the pipeline, for the first one)
+    size_t nQueued{0};
+    size_t nMaxQueued{0};
+    // Time spent working (waiting for room in the pipeline, for the first one)
+    int64_t nBusyMicros{0};
+};
+
+/**
+ * Processes the blocks of the initial block download in stages, each one on its own thread, so that
+ * the network, the CPUs and the disk are used at the same time instead of in turn (a block being
+ * connected while the next ones are checked and their inputs read):
+ * - receive: the message handler queues the blocks downloaded, and waits while the pipeline is full;
+ * - pre-check: the block signatures, coinstake signatures and Sapling proofs are verified on the
+ *   script check threads, and stored in the verified results caches (PreValidateBlocks);
+ * - prefetch: the inputs are read from the coins database into the coins cache, without cs_main;
+ * - connect: the blocks are given to the connect function (ProcessNewBlock), in the order received.
+ * The first stages only warm the caches: every check still runs when the block is connected. The block
+ * and undo files are then written by their own writer threads (-asyncblockwrites).
+ */
+class CBlockPipeline
+{
+public:
+    using ConnectFunc = std::function<void(const std::shared_ptr<const CBlock>&)>;
+
+    enum Stage {
+        RECEIVE = 0,
+        PRECHECK,
+        PREFETCH,
+        CONNECT,
+        STAGES_COUNT
+    };
+
+    CBlockPipeline() = default;
+    ~CBlockPipeline();
+
+    void Start(ConnectFunc connectIn);
+    void Interrupt();
+    // The blocks not connected yet are dropped
+    void Stop();
+    bool IsRunning() const { return fRunning; }
+
+    /**
+     * Queue a block, waiting while the pipeline is full.
+     * Returns false if the pipeline isn't running (or is interrupted): the caller processes the block then.
+     */
+    bool Push(std::shared_ptr<const CBlock> pblock);
+
+    std::vector<BlockPipelineStageStats> GetStats(int64_t& nUptimeMicros) const;
+
+private:
+    void ThreadStage(Stage stage);
+    void ProcessStage(Stage stage, std::vector<std::shared_ptr<const CBlock>>& vBlocks);
+
+    mutable Mutex cs;
+    std::condition_variable cv;
+    // The blocks waiting for each stage (the receive one is unused)
+    std::array<std::deque<std::shared_ptr<const CBlock>>, STAGES_COUNT> queues GUARDED_BY(cs);
+    // Blocks received and not connected yet
+    size_t nBlocksInPipeline GUARDED_BY(cs){0};
+    std::array<BlockPipelineStageStats, STAGES_COUNT> stats GUARDED_BY(cs);
+    int64_t nStartTime GUARDED_BY(cs){0};
+    bool fInterrupted GUARDED_BY(cs){false};
+    std::atomic<bool> fRunning{false};
+
+    ConnectFunc connect;
+    std::vector<std::thread> threads;
+};
+
+extern CBlockPipeline g_block_pipeline;
+
+#endif // PIVX_BLOCKPIPELINE_H
@@ -4,6 +4,7 @@
 
 #include "blocksignature.h"
 
+#include "script/sigcache.h"
 #include "script/standard.h"
 #include "zpiv/zpivmodule.h"
 
@@ -50,7 +51,7 @@ bool SignBlock(CBlock& block, const CKeyStore& keystore)
     return SignBlockWithKey(block, key);
 }
 
-bool CheckBlockSignature(const CBlock& block)
+bool CheckBlockSignature(const CBlock& block, bool fCacheStore)
 {
     if (block.IsProofOfWork())
         return block.vchBlockSig.empty();
@@ -104,5 +105,5 @@ bool CheckBlockSignature(const CBlock& block)
     if (!pubkey.IsValid())
         return error("%s: invalid pubkey %s", __func__, HexStr(pubkey));
 
-    return pubkey.Verify(block.GetHash(), block.vchBlockSig);
+    return CachingVerifySignature(block.vchBlockSig, pubkey, block.GetHash(), fCacheStore);
 }
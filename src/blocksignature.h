@@ -11,6 +11,7 @@
 
 bool SignBlockWithKey(CBlock& block, const CKey& key);
 bool SignBlock(CBlock& block, const CKeyStore& keystore);
-bool CheckBlockSignature(const CBlock& block);
+// Verify the signature of a PoS block through the signature cache (see CachingVerifySignature)
+bool CheckBlockSignature(const CBlock& block, bool fCacheStore = false);
 
 #endif //PIVX_BLOCKSIGNATURE_H
@@ -5,12 +5,13 @@
 
 #include "bloom.h"
 
+#include "crypto/common.h"
 #include "hash.h"
+#include "memusage.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
 #include "script/standard.h"
 #include "random.h"
-#include "streams.h"
 
 #include <math.h>
 #include <stdlib.h>
@@ -40,13 +41,71 @@ CBloomFilter::CBloomFilter(unsigned int nElements, double nFPRate, unsigned int
 {
 }
 
-inline unsigned int CBloomFilter::Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const
+/** The network serialization of an outpoint, without going through a stream */
+static inline void SerializeOutPoint(const COutPoint& outpoint, unsigned char (&buf)[36])
+{
+    memcpy(buf, outpoint.hash.begin(), 32);
+    WriteLE32(buf + 32, outpoint.n);
+}
+
+CBloomTxElements::CBloomTxElements(const CTransaction& tx) : hash(tx.GetHash())
+{
+    std::vector<unsigned char> data;
+    vOutputs.reserve(tx.vout.size());
+    for (const CTxOut& txout : tx.vout) {
+        CScript::const_iterator pc = txout.scriptPubKey.begin();
+        while (pc < txout.scriptPubKey.end()) {
+            opcodetype opcode;
+            if (!txout.scriptPubKey.GetOp(pc, opcode, data))
+                break;
+            if (data.size() != 0)
+                AddElement(data);
+        }
+        txnouttype type;
+        std::vector<std::vector<unsigned char> > vSolutions;
+        const bool fPubKey = Solver(txout.scriptPubKey, type, vSolutions) && (type == TX_PUBKEY || type == TX_MULTISIG);
+        vOutputs.emplace_back(vElementEnd.size(), fPubKey);
+    }
+
+    for (const CTxIn& txin : tx.vin) {
+        unsigned char prevout[36];
+        SerializeOutPoint(txin.prevout, prevout);
+        AddElement(prevout);
+        CScript::const_iterator pc = txin.scriptSig.begin();
+        while (pc < txin.scriptSig.end()) {
+            opcodetype opcode;
+            if (!txin.scriptSig.GetOp(pc, opcode, data))
+                break;
+            if (data.size() != 0)
+                AddElement(data);
+        }
+    }
+}
+
+void CBloomTxElements::AddElement(Span<const unsigned char> element)
+{
+    vData.insert(vData.end(), element.begin(), element.end());
+    vElementEnd.emplace_back(vData.size());
+}
+
+Span<const unsigned char> CBloomTxElements::Element(uint32_t nIndex) const
+{
+    const uint32_t nBegin = nIndex == 0 ? 0 : vElementEnd[nIndex - 1];
+    return Span<const unsigned char>(vData.data() + nBegin, vElementEnd[nIndex] - nBegin);
+}
+
+size_t CBloomTxElements::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(vData) + memusage::DynamicUsage(vElementEnd) + memusage::DynamicUsage(vOutputs);
+}
+
+inline unsigned int CBloomFilter::Hash(unsigned int nHashNum, Span<const unsigned char> vDataToHash) const
 {
     // 0xFBA4C795 chosen as it guarantees a reasonable bit difference between nHashNum values.
     return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash) % (vData.size() * 8);
 }
 
-void CBloomFilter::insert(const std::vector<unsigned char>& vKey)
+void CBloomFilter::insert(Span<const unsigned char> vKey)
 {
     if (isFull)
         return;
@@ -60,19 +119,17 @@ void CBloomFilter::insert(const std::vector<unsigned char>& vKey)
 
 void CBloomFilter::insert(const COutPoint& outpoint)
 {
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << outpoint;
-    std::vector<unsigned char> data(stream.begin(), stream.end());
-    insert(data);
+    unsigned char data[36];
+    SerializeOutPoint(outpoint, data);
+    insert(MakeSpan(data));
 }
 
 void CBloomFilter::insert(const uint256& hash)
 {
-    std::vector<unsigned char> data(hash.begin(), hash.end());
-    insert(data);
+    insert(Span<const unsigned char>(hash.begin(), hash.size()));
 }
 
-bool CBloomFilter::contains(const std::vector<unsigned char>& vKey) const
+bool CBloomFilter::contains(Span<const unsigned char> vKey) const
 {
     if (isFull) {
         return true;
@@ -91,16 +148,14 @@ bool CBloomFilter::contains(const std::vector<unsigned char>& vKey) const
 
 bool CBloomFilter::contains(const COutPoint& outpoint) const
 {
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << outpoint;
-    std::vector<unsigned char> data(stream.begin(), stream.end());
-    return contains(data);
+    unsigned char data[36];
+    SerializeOutPoint(outpoint, data);
+    return contains(MakeSpan(data));
 }
 
 bool CBloomFilter::contains(const uint256& hash) const
 {
-    std::vector<unsigned char> data(hash.begin(), hash.end());
-    return contains(data);
+    return contains(Span<const unsigned char>(hash.begin(), hash.size()));
 }
 
 void CBloomFilter::clear()
@@ -154,6 +209,15 @@ bool CBloomFilter::Merge(const CBloomFilter& filter) {
 }
 
 bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
+{
+    if (isFull)
+        return true;
+    if (isEmpty)
+        return false;
+    return IsRelevantAndUpdate(CBloomTxElements(tx));
+}
+
+bool CBloomFilter::IsRelevantAndUpdate(const CBloomTxElements& tx)
 {
     bool fFound = false;
     // Match if the filter contains the hash of tx
@@ -162,59 +226,36 @@ bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
         return true;
     if (isEmpty)
         return false;
-    const uint256& hash = tx.GetHash();
-    if (contains(hash))
+    if (contains(tx.hash))
         fFound = true;
 
-    for (unsigned int i = 0; i < tx.vout.size(); i++) {
-        const CTxOut& txout = tx.vout[i];
+    uint32_t nElement = 0;
+    for (uint32_t i = 0; i < tx.vOutputs.size(); i++) {
+        const uint32_t nOutputEnd = tx.vOutputs[i].first;
         // Match if the filter contains any arbitrary script data element in any scriptPubKey in tx
         // If this matches, also add the specific output that was matched.
         // This means clients don't have to update the filter themselves when a new relevant tx
         // is discovered in order to find spending transactions, which avoids round-tripping and race conditions.
-        CScript::const_iterator pc = txout.scriptPubKey.begin();
-        std::vector<unsigned char> data;
-        while (pc < txout.scriptPubKey.end()) {
-            opcodetype opcode;
-            if (!txout.scriptPubKey.GetOp(pc, opcode, data)){
-                break;
-            }
-
-            if (data.size() != 0 && contains(data)) {
+        for (; nElement < nOutputEnd; nElement++) {
+            if (contains(tx.Element(nElement))) {
                 fFound = true;
-                if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL)
-                    insert(COutPoint(hash, i));
-                else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY) {
-                    txnouttype type;
-                    std::vector<std::vector<unsigned char> > vSolutions;
-                    if (Solver(txout.scriptPubKey, type, vSolutions) &&
-                        (type == TX_PUBKEY || type == TX_MULTISIG))
-                        insert(COutPoint(hash, i));
-                }
+                if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL ||
+                    ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY && tx.vOutputs[i].second))
+                    insert(COutPoint(tx.hash, i));
                 break;
             }
         }
+        nElement = nOutputEnd;
     }
 
     if (fFound)
         return true;
 
-    for (const CTxIn& txin : tx.vin) {
-        // Match if the filter contains an outpoint tx spends
-        if (contains(txin.prevout))
+    // Match if the filter contains an outpoint tx spends,
+    // or any arbitrary script data element in any scriptSig in tx
+    for (; nElement < tx.vElementEnd.size(); nElement++) {
+        if (contains(tx.Element(nElement)))
             return true;
-
-        // Match if the filter contains any arbitrary script data element in any scriptSig in tx
-        CScript::const_iterator pc = txin.scriptSig.begin();
-        std::vector<unsigned char> data;
-        while (pc < txin.scriptSig.end()) {
-            opcodetype opcode;
-            if (!txin.scriptSig.GetOp(pc, opcode, data))
-                break;
-            if (data.size() != 0 && contains(data)) {
-                return true;
-            }
-        }
     }
 
     return false;
@@ -7,12 +7,13 @@
 #define BITCOIN_BLOOM_H
 
 #include "serialize.h"
+#include "span.h"
+#include "uint256.h"
 
 #include <vector>
 
 class COutPoint;
 class CTransaction;
-class uint256;
 
 //! 20,000 items with fp rate < 0.1% or 10,000 items and <0.0001%
 static const unsigned int MAX_BLOOM_FILTER_SIZE = 36000; // bytes
@@ -30,6 +31,34 @@ enum bloomflags {
     BLOOM_UPDATE_MASK = 3,
 };
 
+/**
+ * The data elements of a transaction that CBloomFilter::IsRelevantAndUpdate matches: the txid, the
+ * data pushes of the scriptPubKeys, and the serialized prevouts and data pushes of the scriptSigs.
+ * Extracting them once per block saves parsing the scripts for each filter the block is matched with.
+ */
+class CBloomTxElements
+{
+public:
+    explicit CBloomTxElements(const CTransaction& tx);
+
+    size_t DynamicMemoryUsage() const;
+
+private:
+    friend class CBloomFilter;
+
+    uint256 hash;
+    //! The elements, back to back
+    std::vector<unsigned char> vData;
+    //! The end offset in vData of each element
+    std::vector<uint32_t> vElementEnd;
+    //! For each output: the end index in vElementEnd of its pushes, and whether it is a pay-to-pubkey/pay-to-multisig.
+    //! The prevouts and pushes of the inputs follow the last output's.
+    std::vector<std::pair<uint32_t, bool>> vOutputs;
+
+    void AddElement(Span<const unsigned char> element);
+    Span<const unsigned char> Element(uint32_t nIndex) const;
+};
+
 /**
  * BloomFilter is a probabilistic filter which SPV clients provide
  * so that we can filter the transactions we sends them.
@@ -51,7 +80,7 @@ private:
     unsigned int nTweak;
     unsigned char nFlags;
 
-    unsigned int Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const;
+    unsigned int Hash(unsigned int nHashNum, Span<const unsigned char> vDataToHash) const;
 
 public:
     /**
@@ -68,11 +97,13 @@ public:
 
     SERIALIZE_METHODS(CBloomFilter, obj) { READWRITE(obj.vData, obj.nHashFuncs, obj.nTweak, obj.nFlags); }
 
-    void insert(const std::vector<unsigned char>& vKey);
+    void insert(Span<const unsigned char> vKey);
+    void insert(const std::vector<unsigned char>& vKey) { insert(MakeSpan(vKey)); }
     void insert(const COutPoint& outpoint);
     void insert(const uint256& hash);
 
-    bool contains(const std::vector<unsigned char>& vKey) const;
+    bool contains(Span<const unsigned char> vKey) const;
+    bool contains(const std::vector<unsigned char>& vKey) const { return contains(MakeSpan(vKey)); }
     bool contains(const COutPoint& outpoint) const;
     bool contains(const uint256& hash) const;
 
@@ -88,6 +119,7 @@ public:
 
     //! Also adds any outputs which match the filter to the filter (to match their spending txes)
     bool IsRelevantAndUpdate(const CTransaction& tx);
+    bool IsRelevantAndUpdate(const CBloomTxElements& tx);
 
     //! Checks for empty and full filters to avoid wasting cpu
     void UpdateEmptyFull();
@@ -81,45 +81,70 @@ public:
             return;
         }
 
-        // revert to per-source verification
-        for (const auto& p : messagesBySource) {
-            bool batchValid = false;
-
-            // no need to verify it again if there was just one source
-            if (messagesBySource.size() != 1) {
-                byMessageHash.clear();
-                for (auto it = p.second.begin(); it != p.second.end(); ++it) {
-                    byMessageHash[(*it)->second.msgHash].emplace_back(*it);
-                }
-                batchValid = VerifyBatch(byMessageHash);
+        // find the bad sources by bisection: halves of the sources are verified together,
+        // so that a few bad sources in a big batch don't require a verification per source
+        std::vector<typename MessagesBySourceMap::const_iterator> sources;
+        sources.reserve(messagesBySource.size());
+        for (auto it = messagesBySource.cbegin(); it != messagesBySource.cend(); ++it) {
+            sources.emplace_back(it);
+        }
+        BisectSources(sources, 0, sources.size());
+    }
+
+private:
+    // the sources in [start, end) are known to have at least one invalid message
+    void BisectSources(const std::vector<typename MessagesBySourceMap::const_iterator>& sources, size_t start, size_t end)
+    {
+        if (end - start == 1) {
+            MarkBadSource(sources[start]);
+            return;
+        }
+        const size_t mid = start + (end - start) / 2;
+        if (!VerifySources(sources, start, mid)) {
+            BisectSources(sources, start, mid);
+        }
+        if (!VerifySources(sources, mid, end)) {
+            BisectSources(sources, mid, end);
+        }
+    }
+
+    bool VerifySources(const std::vector<typename MessagesBySourceMap::const_iterator>& sources, size_t start, size_t end)
+    {
+        std::map<uint256, std::vector<MessageMapIterator>> byMessageHash;
+        for (size_t i = start; i < end; i++) {
+            for (const auto& msgIt : sources[i]->second) {
+                byMessageHash[msgIt->second.msgHash].emplace_back(msgIt);
             }
-            if (!batchValid) {
-                badSources.emplace(p.first);
-
-                if (perMessageFallback) {
-                    // revert to per-message verification
-                    if (p.second.size() == 1) {
-                        // no need to re-verify a single message
-                        badMessages.emplace(p.second[0]->second.msgId);
-                    } else {
-                        for (const auto& msgIt : p.second) {
-                            if (badMessages.count(msgIt->first)) {
-                                // same message might be invalid from different source, so no need to re-verify it
-                                continue;
-                            }
-
-                            const auto& msg = msgIt->second;
-                            if (!msg.sig.VerifyInsecure(msg.pubKey, msg.msgHash)) {
-                                badMessages.emplace(msg.msgId);
-                            }
-                        }
-                    }
-                }
+        }
+        return VerifyBatch(byMessageHash);
+    }
+
+    void MarkBadSource(typename MessagesBySourceMap::const_iterator source)
+    {
+        badSources.emplace(source->first);
+        if (!perMessageFallback) {
+            return;
+        }
+
+        // revert to per-message verification
+        if (source->second.size() == 1) {
+            // no need to re-verify a single message
+            badMessages.emplace(source->second[0]->second.msgId);
+            return;
+        }
+        for (const auto& msgIt : source->second) {
+            if (badMessages.count(msgIt->first)) {
+                // same message might be invalid from different source, so no need to re-verify it
+                continue;
+            }
+
+            const auto& msg = msgIt->second;
+            if (!msg.sig.VerifyInsecure(msg.pubKey, msg.msgHash)) {
+                badMessages.emplace(msg.msgId);
             }
         }
     }
 
-private:
     // All Verify methods take ownership of the passed byMessageHash map and thus might modify the map. This is to avoid
     // unnecessary copies
 
@@ -188,6 +213,8 @@ private:
         // Loop until the byMessageHash map is empty, which means that all messages were verified
         // The secure form of verification will only aggregate one message for the same message hash, even if multiple
         // exist (signed with different keys). This avoids the rogue public key attack.
+        // Each signature and public key is also weighted by a random coefficient, so that the errors of the
+        // tampered signatures (e.g. sig1 + d and sig2 - d) can't cancel out in the aggregated signature.
         // This is slower than the insecure form as it requires more pairings
         while (!byMessageHash.empty()) {
             if (!VerifyBatchSecureStep(byMessageHash)) {
@@ -213,13 +240,18 @@ private:
             const auto& msg = messageIts.back()->second;
 
             if (dups.emplace(msg.msgId).second) {
+                CBLSSecretKey coefficient;
+                coefficient.MakeNewCoefficient();
+                CBLSSignature sig = msg.sig;
+                sig.Multiply(coefficient);
                 msgHashes.emplace_back(msgHash);
                 pubKeys.emplace_back(msg.pubKey);
+                pubKeys.back().Multiply(coefficient);
 
                 if (!aggSig.IsValid()) {
-                    aggSig = msg.sig;
+                    aggSig = sig;
                 } else {
-                    aggSig.AggregateInsecure(msg.sig);
+                    aggSig.AggregateInsecure(sig);
                 }
             }
 
@@ -4,6 +4,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "bls/bls_worker.h"
+
+#include "bls/bls_batchverifier.h"
 #include "hash.h"
 #include "serialize.h"
 #include "util/system.h"
@@ -60,21 +62,73 @@ CBLSWorker::~CBLSWorker()
     Stop();
 }
 
-void CBLSWorker::Start()
+void CBLSWorker::Start(int workerCount)
 {
-    int workerCount = GetNumCores() / 2;
-    workerCount = std::max(std::min(1, workerCount), 4);
-    workerPool.resize(workerCount);
+    if (workerCount <= 0) {
+        workerCount = std::min(std::max(GetNumCores() / 2, 1), 4);
+    }
+    workerPool.resize(std::min(workerCount, MAX_BLS_WORKER_THREADS));
+    backgroundPool.resize(1);
 
     RenameThreadPool(workerPool, "pivx-bls-worker");
+    RenameThreadPool(backgroundPool, "pivx-bls-bg");
+    RunOnEachPoolThread(workerPool, [](int) { ApplyValidationThreadAffinity(); });
 }
 
 void CBLSWorker::Stop()
 {
+    // the background jobs wait for the workers: stop them first
+    backgroundPool.clear_queue();
+    backgroundPool.stop(true);
     workerPool.clear_queue();
     workerPool.stop(true);
 }
 
+void CBLSWorker::ParallelFor(size_t count, const std::function<void(size_t)>& func, size_t nMaxJobs)
+{
+    if (workerPool.size() == 0 || count < 2) {
+        for (size_t i = 0; i < count; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    // one job per worker thread, each one taking every n-th index
+    size_t nJobs = std::min(count, (size_t)workerPool.size());
+    if (nMaxJobs > 0) {
+        nJobs = std::min(nJobs, nMaxJobs);
+    }
+    std::vector<std::future<void>> futures;
+    futures.reserve(nJobs);
+    for (size_t j = 0; j < nJobs; j++) {
+        futures.emplace_back(workerPool.push([j, nJobs, count, &func](int threadId) {
+            for (size_t i = j; i < count; i += nJobs) {
+                func(i);
+            }
+        }));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+}
+
+void CBLSWorker::PushBackgroundJob(std::function<void()>&& job)
+{
+    if (backgroundPool.size() == 0) {
+        // not started (unit tests): run it right away
+        job();
+        return;
+    }
+    backgroundPool.push([job](int threadId) {
+        job();
+    });
+}
+
+void CBLSWorker::ParallelForBackground(size_t count, const std::function<void(size_t)>& func)
+{
+    ParallelFor(count, func, std::max((size_t)1, (size_t)workerPool.size() / 2));
+}
+
 bool CBLSWorker::GenerateContributions(int quorumThreshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skShares)
 {
     BLSSecretKeyVectorPtr svec = std::make_shared<BLSSecretKeyVector>((size_t)quorumThreshold);
@@ -906,43 +960,22 @@ void CBLSWorker::PushSigVerifyBatch()
             return;
         }
 
-        CBLSSignature aggSig;
+        // the jobs of a batch have distinct message hashes. Each job is its own source, so that the
+        // invalid ones are found by bisection when the aggregated verification fails
+        CBLSBatchVerifier<size_t, size_t> batchVerifier(true, false);
         std::vector<size_t> indexes;
-        std::vector<CBLSPublicKey> pubKeys;
-        std::vector<uint256> msgHashes;
         indexes.reserve(jobs.size());
-        pubKeys.reserve(jobs.size());
-        msgHashes.reserve(jobs.size());
         for (size_t i = 0; i < jobs.size(); i++) {
             auto& job = jobs[i];
             if (job.cancelCond()) {
                 continue;
             }
-            if (pubKeys.empty()) {
-                aggSig = job.sig;
-            } else {
-                aggSig.AggregateInsecure(job.sig);
-            }
             indexes.emplace_back(i);
-            pubKeys.emplace_back(job.pubKey);
-            msgHashes.emplace_back(job.msgHash);
+            batchVerifier.PushMessage(i, i, job.msgHash, job.sig, job.pubKey);
         }
-
-        if (!pubKeys.empty()) {
-            bool allValid = aggSig.VerifyInsecureAggregated(pubKeys, msgHashes);
-            if (allValid) {
-                for (size_t i = 0; i < pubKeys.size(); i++) {
-                    jobs[indexes[i]].doneCallback(true);
-                }
-            } else {
-                // one or more sigs were not valid, revert to per-sig verification
-                // TODO this could be improved if we would cache pairing results in some way as the previous aggregated verification already calculated all the pairings for the hashes
-                for (size_t i = 0; i < pubKeys.size(); i++) {
-                    auto& job = jobs[indexes[i]];
-                    bool valid = job.sig.VerifyInsecure(job.pubKey, job.msgHash);
-                    job.doneCallback(valid);
-                }
-            }
+        batchVerifier.Verify();
+        for (size_t i : indexes) {
+            jobs[i].doneCallback(!batchVerifier.badSources.count(i));
         }
 
         std::unique_lock<std::mutex> l(sigVerifyMutex);
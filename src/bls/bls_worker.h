@@ -12,6 +12,10 @@
 #include <future>
 #include <mutex>
 
+// Worker threads of the BLS operations, 0 means half of the cores with a maximum of 4
+static const int DEFAULT_BLS_WORKER_THREADS = 0;
+static const int MAX_BLS_WORKER_THREADS = 16;
+
 // Low level BLS/DKG stuff. All very compute intensive and optimized for parallelization
 // The worker tries to parallelize as much as possible and utilizes a few properties of BLS aggregation to speed up things
 // For example, public key vectors can be aggregated in parallel if they are split into batches and the batched aggregations are
@@ -25,6 +29,8 @@ public:
 
 private:
     ctpl::thread_pool workerPool;
+    // Runs the long, low priority jobs one at a time, so that they never hold all the workers
+    ctpl::thread_pool backgroundPool;
 
     static const int SIG_VERIFY_BATCH_SIZE = 8;
     struct SigVerifyJob {
@@ -51,9 +57,20 @@ public:
     CBLSWorker();
     ~CBLSWorker();
 
-    void Start();
+    void Start(int workerCount = DEFAULT_BLS_WORKER_THREADS);
     void Stop();
 
+    // Runs func(i) for every i in [0, count) on the worker threads and waits for all of them to finish.
+    // nMaxJobs (0 for no limit) bounds the number of workers used.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& func, size_t nMaxJobs = 0);
+
+    // Queues a low priority job (e.g. the population of a cache) on the background thread. The job should
+    // use ParallelForBackground, and not ParallelFor, to split its work.
+    void PushBackgroundJob(std::function<void()>&& job);
+    // ParallelFor for the background jobs: up to half of the workers, so that the signing and the verification
+    // jobs queued meanwhile still find free workers.
+    void ParallelForBackground(size_t count, const std::function<void(size_t)>& func);
+
     bool GenerateContributions(int threshold, const BLSIdVector& ids, BLSVerificationVectorPtr& vvecRet, BLSSecretKeyVector& skShares);
 
     // The following functions are all used to aggregate verification (public key) vectors
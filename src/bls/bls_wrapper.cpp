@@ -12,7 +12,10 @@
 #include "support/allocators/mt_pooled_secure.h"
 #endif
 
+#include <algorithm>
 #include <assert.h>
+#include <deque>
+#include <map>
 #include <string.h>
 
 static std::unique_ptr<bls::CoreMPL> pScheme(new bls::BasicSchemeMPL);
@@ -65,6 +68,18 @@ void CBLSSecretKey::MakeNewKey()
     fValid = true;
     cachedHash.SetNull();
 }
+
+void CBLSSecretKey::MakeNewCoefficient()
+{
+    // Big endian, below the order of the curve
+    unsigned char buf[32] = {};
+    do {
+        GetRandBytes(buf + 16, 16);
+    } while (std::all_of(buf + 16, buf + 32, [](unsigned char c) { return c == 0; }));
+    impl = bls::PrivateKey::FromBytes(bls::Bytes((const uint8_t*)buf, SerSize));
+    fValid = true;
+    cachedHash.SetNull();
+}
 #endif
 
 bool CBLSSecretKey::SecretKeyShare(const std::vector<CBLSSecretKey>& msk, const CBLSId& _id)
@@ -183,6 +198,13 @@ CBLSPublicKey CBLSPublicKey::AggregateInsecure(const std::vector<CBLSPublicKey>&
     return ret;
 }
 
+void CBLSPublicKey::Multiply(const CBLSSecretKey& k)
+{
+    assert(IsValid() && k.IsValid());
+    impl = impl * k.impl;
+    cachedHash.SetNull();
+}
+
 bool CBLSPublicKey::PublicKeyShare(const std::vector<CBLSPublicKey>& mpk, const CBLSId& _id)
 {
     fValid = false;
@@ -286,6 +308,13 @@ void CBLSSignature::SubInsecure(const CBLSSignature& o)
     cachedHash.SetNull();
 }
 
+void CBLSSignature::Multiply(const CBLSSecretKey& k)
+{
+    assert(IsValid() && k.IsValid());
+    impl = impl * k.impl;
+    cachedHash.SetNull();
+}
+
 bool CBLSSignature::VerifyInsecure(const CBLSPublicKey& pubKey, const uint256& hash) const
 {
     if (!IsValid() || !pubKey.IsValid()) {
@@ -376,6 +405,45 @@ bool CBLSSignature::Recover(const std::vector<CBLSSignature>& sigs, const std::v
 
 #ifndef BUILD_BITCOIN_INTERNAL
 
+static const size_t MAX_BLS_PUBKEY_CACHE_SIZE = 20000;
+static std::mutex cs_pubKeyCache;
+static std::map<std::vector<uint8_t>, CBLSPublicKey> mapPubKeyCache;
+// insertion order of mapPubKeyCache, the oldest keys are evicted first
+static std::deque<std::map<std::vector<uint8_t>, CBLSPublicKey>::iterator> pubKeyCacheOrder;
+
+template<>
+bool SetBLSObjectFromBytes(CBLSPublicKey& obj, const std::vector<uint8_t>& vecBytes)
+{
+    {
+        std::unique_lock<std::mutex> l(cs_pubKeyCache);
+        auto it = mapPubKeyCache.find(vecBytes);
+        if (it != mapPubKeyCache.end()) {
+            obj = it->second;
+            return true;
+        }
+    }
+
+    obj.SetByteVector(vecBytes);
+    if (!obj.CheckMalleable(vecBytes)) {
+        return false;
+    }
+    if (!obj.IsValid()) {
+        // the null key, nothing to decompress
+        return true;
+    }
+
+    std::unique_lock<std::mutex> l(cs_pubKeyCache);
+    auto res = mapPubKeyCache.emplace(vecBytes, obj);
+    if (res.second) {
+        pubKeyCacheOrder.emplace_back(res.first);
+        if (pubKeyCacheOrder.size() > MAX_BLS_PUBKEY_CACHE_SIZE) {
+            mapPubKeyCache.erase(pubKeyCacheOrder.front());
+            pubKeyCacheOrder.pop_front();
+        }
+    }
+    return true;
+}
+
 static std::once_flag init_flag;
 static mt_pooled_secure_allocator<uint8_t>* secure_allocator_instance;
 static void create_secure_allocator()
@@ -200,6 +200,9 @@ public:
 
 class CBLSSecretKey : public CBLSWrapper<bls::PrivateKey, BLS_CURVE_SECKEY_SIZE, CBLSSecretKey>
 {
+    friend class CBLSPublicKey;
+    friend class CBLSSignature;
+
 public:
     using CBLSWrapper::operator=;
     using CBLSWrapper::operator==;
@@ -210,6 +213,8 @@ public:
 
 #ifndef BUILD_BITCOIN_INTERNAL
     void MakeNewKey();
+    // A random 128 bits coefficient, to weight the signatures of a batch verification
+    void MakeNewCoefficient();
 #endif
     bool SecretKeyShare(const std::vector<CBLSSecretKey>& msk, const CBLSId& id);
 
@@ -234,6 +239,8 @@ public:
     void AggregateInsecure(const CBLSPublicKey& o);
     static CBLSPublicKey AggregateInsecure(const std::vector<CBLSPublicKey>& pks);
 
+    void Multiply(const CBLSSecretKey& k);
+
     bool PublicKeyShare(const std::vector<CBLSPublicKey>& mpk, const CBLSId& id);
     bool DHKeyExchange(const CBLSSecretKey& sk, const CBLSPublicKey& pk);
 
@@ -257,6 +264,7 @@ public:
     static CBLSSignature AggregateSecure(const std::vector<CBLSSignature>& sigs, const std::vector<CBLSPublicKey>& pks, const uint256& hash);
 
     void SubInsecure(const CBLSSignature& o);
+    void Multiply(const CBLSSecretKey& k);
 
     bool VerifyInsecure(const CBLSPublicKey& pubKey, const uint256& hash) const;
     bool VerifyInsecureAggregated(const std::vector<CBLSPublicKey>& pubKeys, const std::vector<uint256>& hashes) const;
@@ -268,6 +276,25 @@ public:
 
 #ifndef BUILD_BITCOIN_INTERNAL
 
+/**
+ * Sets obj from its serialization, as CBLSLazyWrapper does on first use, and returns false when vecBytes
+ * is not the canonical serialization of obj.
+ */
+template<typename BLSObject>
+bool SetBLSObjectFromBytes(BLSObject& obj, const std::vector<uint8_t>& vecBytes)
+{
+    obj.SetByteVector(vecBytes);
+    return obj.CheckMalleable(vecBytes);
+}
+
+/**
+ * The same operator public keys are decompressed again and again (the DMN lists of the past blocks loaded
+ * from evodb, the quorum members): they are decompressed once and shared through a bounded cache of the
+ * valid keys, keyed by their bytes.
+ */
+template<>
+bool SetBLSObjectFromBytes(CBLSPublicKey& obj, const std::vector<uint8_t>& vecBytes);
+
 template<typename BLSObject>
 class CBLSLazyWrapper
 {
@@ -355,8 +382,7 @@ public:
             return invalidObj;
         }
         if (!objInitialized) {
-            obj.SetByteVector(vecBytes);
-            if (!obj.CheckMalleable(vecBytes)) {
+            if (!SetBLSObjectFromBytes(obj, vecBytes)) {
                 bufValid = false;
                 objInitialized = false;
                 obj = invalidObj;
@@ -69,13 +69,12 @@ CBudgetDB::ReadResult CBudgetDB::Read(CBudgetManager& objToLoad, bool fDryRun)
     // Don't try to resize to a negative number if file is small
     if (dataSize < 0)
         dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
+    // read data and checksum from file, straight into the stream buffer
+    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+    ssObj.resize(dataSize);
     uint256 hashIn;
-
-    // read data and checksum from file
     try {
-        filein.read((char*)vchData.data(), dataSize);
+        filein.read(ssObj.data(), dataSize);
         filein >> hashIn;
     } catch (const std::exception& e) {
         error("%s : Deserialize or I/O error - %s", __func__, e.what());
@@ -83,8 +82,6 @@ CBudgetDB::ReadResult CBudgetDB::Read(CBudgetManager& objToLoad, bool fDryRun)
     }
     filein.fclose();
 
-    CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
     // verify stored checksum matches input data
     uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
     if (hashIn != hashTmp) {
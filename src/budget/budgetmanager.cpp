@@ -8,11 +8,14 @@
 #include "consensus/validation.h"
 #include "evo/deterministicmns.h"
 #include "masternodeman.h"
+#include "net_processing.h"
 #include "netmessagemaker.h"
 #include "tiertwo/tiertwo_sync_state.h"
 #include "tiertwo/netfulfilledman.h"
+#include "tiertwo/vote_sig_verifier.h"
 #include "util/validation.h"
 #include "validation.h"   // GetTransaction, cs_main
+#include "validationinterface.h"
 
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h" // future: use interface instead.
@@ -22,6 +25,8 @@
 #define BUDGET_ORPHAN_VOTES_CLEANUP_SECONDS (60 * 60) // One hour.
 // Request type used in the net requests manager to block peers asking budget sync too often
 static const std::string BUDGET_SYNC_REQUEST_RECV = "budget-sync-recv";
+// Maximum number of block heights in the cache of the finalized budgets with the highest vote count
+static const size_t MAX_HIGHEST_FIN_BUDGETS_CACHE = 1000;
 
 CBudgetManager g_budgetman;
 
@@ -57,6 +62,7 @@ void CBudgetManager::CheckOrphanVotes()
             if (itProposal != mapProposals.end()) {
                 // Proposal found.
                 CBudgetProposal* bp = &(itProposal->second);
+                ClearCachedBudget();
                 // Try to add orphan votes
                 for (const CBudgetVote& vote : itOrphanVotes->second.first) {
                     std::string strError;
@@ -79,6 +85,7 @@ void CBudgetManager::CheckOrphanVotes()
             if (itFinalBudget != mapFinalizedBudgets.end()) {
                 // Finalized budget found.
                 CFinalizedBudget* fb = &(itFinalBudget->second);
+                ClearHighestFinBudgets();
                 // Try to add orphan votes
                 for (const CFinalizedBudgetVote& vote : itOrphanVotes->second.first) {
                     std::string strError;
@@ -313,6 +320,7 @@ void CBudgetManager::ForceAddFinalizedBudget(const uint256& nHash, const uint256
 {
     LOCK(cs_budgets);
     mapFinalizedBudgets.emplace(nHash, finalizedBudget);
+    ClearHighestFinBudgets();
     // Add to feeTx index
     mapFeeTxToBudget.emplace(feeTxId, nHash);
     // Remove the budget from the unconfirmed map, if it was there
@@ -355,6 +363,7 @@ bool CBudgetManager::AddProposal(CBudgetProposal& budgetProposal)
     {
         LOCK(cs_proposals);
         mapProposals.emplace(nHash, budgetProposal);
+        ClearCachedBudget();
         // Add to feeTx index
         mapFeeTxToProposal.emplace(feeTxId, nHash);
     }
@@ -389,6 +398,7 @@ void CBudgetManager::CheckAndRemove()
         }
         // Remove invalid entries by overwriting complete map
         mapProposals.swap(tmpMapProposals);
+        ClearCachedBudget();
         LogPrint(BCLog::MNBUDGET, "%s: mapProposals cleanup - size after: %d\n", __func__, mapProposals.size());
     }
 
@@ -409,6 +419,7 @@ void CBudgetManager::CheckAndRemove()
         }
         // Remove invalid entries by overwriting complete map
         mapFinalizedBudgets = tmpMapFinalizedBudgets;
+        ClearHighestFinBudgets();
         LogPrint(BCLog::MNBUDGET, "%s: mapFinalizedBudgets cleanup - size after: %d\n", __func__, mapFinalizedBudgets.size());
     }
     // Masternodes vote on valid ones
@@ -437,6 +448,7 @@ void CBudgetManager::RemoveByFeeTxId(const uint256& feeTxId)
                 }
                 // Erase proposal object
                 mapProposals.erase(it->second);
+                ClearCachedBudget();
             }
             // Remove from collateral index
             mapFeeTxToProposal.erase(it);
@@ -462,6 +474,7 @@ void CBudgetManager::RemoveByFeeTxId(const uint256& feeTxId)
                 }
                 // Erase finalized budget object
                 mapFinalizedBudgets.erase(it->second);
+                ClearHighestFinBudgets();
             }
             // Remove from collateral index
             mapFeeTxToBudget.erase(it);
@@ -472,6 +485,11 @@ void CBudgetManager::RemoveByFeeTxId(const uint256& feeTxId)
 CBudgetManager::HighestFinBudget CBudgetManager::GetBudgetWithHighestVoteCount(int chainHeight) const
 {
     LOCK(cs_budgets);
+    const auto itCached = mapHighestFinBudgets.find(chainHeight);
+    if (itCached != mapHighestFinBudgets.end()) {
+        return itCached->second;
+    }
+
     int highestVoteCount = 0;
     const CFinalizedBudget* pHighestBudget = nullptr;
     for (const auto& it: mapFinalizedBudgets) {
@@ -484,7 +502,12 @@ CBudgetManager::HighestFinBudget CBudgetManager::GetBudgetWithHighestVoteCount(i
             highestVoteCount = voteCount;
         }
     }
-    return {pHighestBudget, highestVoteCount};
+    if (mapHighestFinBudgets.size() >= MAX_HIGHEST_FIN_BUDGETS_CACHE) {
+        mapHighestFinBudgets.clear();
+    }
+    const HighestFinBudget ret{pHighestBudget, highestVoteCount};
+    mapHighestFinBudgets.emplace(chainHeight, ret);
+    return ret;
 }
 
 int CBudgetManager::GetHighestVoteCount(int chainHeight) const
@@ -763,6 +786,12 @@ std::vector<CBudgetProposal> CBudgetManager::GetBudget()
     if (nHeight <= 0)
         return {};
 
+    // The winning proposals are computed once per block, unless the proposals or their votes change
+    int mnCount = mnodeman.CountEnabled();
+    if (cachedBudget && cachedBudget->m_height == nHeight && cachedBudget->m_mn_count == mnCount) {
+        return cachedBudget->m_proposals;
+    }
+
     // ------- Get proposals ordered by votes (highest to lowest)
     std::vector<CBudgetProposal*> vProposalsOrdered = GetAllProposalsOrdered();
 
@@ -773,7 +802,6 @@ std::vector<CBudgetProposal> CBudgetManager::GetBudget()
     const int nBlocksPerCycle = Params().GetConsensus().nBudgetCycleBlocks;
     int nBlockStart = nHeight - nHeight % nBlocksPerCycle + nBlocksPerCycle;
     int nBlockEnd = nBlockStart + nBlocksPerCycle - 1;
-    int mnCount = mnodeman.CountEnabled();
     CAmount nTotalBudget = GetTotalBudget(nBlockStart);
 
     for (CBudgetProposal* pbudgetProposal: vProposalsOrdered) {
@@ -803,6 +831,7 @@ std::vector<CBudgetProposal> CBudgetManager::GetBudget()
 
     }
 
+    cachedBudget = WinningProposals{nHeight, mnCount, vBudgetProposalsRet};
     return vBudgetProposalsRet;
 }
 
@@ -882,20 +911,25 @@ void CBudgetManager::RemoveStaleVotesOnProposal(CBudgetProposal* prop)
     LogPrint(BCLog::MNBUDGET, "Cleaning proposal votes for %s. Before: YES=%d, NO=%d\n",
             prop->GetName(), prop->GetYeas(), prop->GetNays());
 
+    const int nYeas = prop->GetYeas(), nNays = prop->GetNays();
+    auto mnList = deterministicMNManager->GetListAtChainTip();
     auto it = prop->mapVotes.begin();
     while (it != prop->mapVotes.end()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
         auto dmn = mnList.GetMNByCollateral(it->first);
         if (dmn) {
-            (*it).second.SetValid(!dmn->IsPoSeBanned());
+            prop->SetVoteValid((*it).second, !dmn->IsPoSeBanned());
         } else {
             // -- Legacy System (!TODO: remove after enforcement) --
             CMasternode* pmn = mnodeman.Find(it->first);
-            (*it).second.SetValid(pmn && pmn->IsEnabled());
+            prop->SetVoteValid((*it).second, pmn && pmn->IsEnabled());
         }
         ++it;
     }
 
+    if (prop->GetYeas() != nYeas || prop->GetNays() != nNays) {
+        ClearCachedBudget();
+    }
+
     LogPrint(BCLog::MNBUDGET, "Cleaned proposal votes for %s. After: YES=%d, NO=%d\n",
             prop->GetName(), prop->GetYeas(), prop->GetNays());
 }
@@ -906,19 +940,23 @@ void CBudgetManager::RemoveStaleVotesOnFinalBudget(CFinalizedBudget* fbud)
     LogPrint(BCLog::MNBUDGET, "Cleaning finalized budget votes for [%s (%s)]. Before: %d\n",
             fbud->GetName(), fbud->GetProposalsStr(), fbud->GetVoteCount());
 
+    const int nVotes = fbud->GetVoteCount();
+    auto mnList = deterministicMNManager->GetListAtChainTip();
     auto it = fbud->mapVotes.begin();
     while (it != fbud->mapVotes.end()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
         auto dmn = mnList.GetMNByCollateral(it->first);
         if (dmn) {
-            (*it).second.SetValid(!dmn->IsPoSeBanned());
+            fbud->SetVoteValid((*it).second, !dmn->IsPoSeBanned());
         } else {
             // -- Legacy System (!TODO: remove after enforcement) --
             CMasternode* pmn = mnodeman.Find(it->first);
-            (*it).second.SetValid(pmn && pmn->IsEnabled());
+            fbud->SetVoteValid((*it).second, pmn && pmn->IsEnabled());
         }
         ++it;
     }
+    if (fbud->GetVoteCount() != nVotes) {
+        ClearHighestFinBudgets();
+    }
     LogPrint(BCLog::MNBUDGET, "Cleaned finalized budget votes for [%s (%s)]. After: %d\n",
             fbud->GetName(), fbud->GetProposalsStr(), fbud->GetVoteCount());
 }
@@ -1040,7 +1078,7 @@ void CBudgetManager::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockI
     LogPrint(BCLog::MNBUDGET,"%s:  PASSED\n", __func__);
 }
 
-int CBudgetManager::ProcessBudgetVoteSync(const uint256& nProp, CNode* pfrom)
+int CBudgetManager::ProcessBudgetVoteSync(const uint256& nProp, CNode* pfrom, const BudgetSyncDigest& peerDigest)
 {
     if (nProp.IsNull()) {
         LOCK2(cs_budgets, cs_proposals);
@@ -1053,7 +1091,7 @@ int CBudgetManager::ProcessBudgetVoteSync(const uint256& nProp, CNode* pfrom)
         }
     }
 
-    if (nProp.IsNull()) Sync(pfrom, false /* fPartial */);
+    if (nProp.IsNull()) Sync(pfrom, false /* fPartial */, peerDigest);
     else SyncSingleItem(pfrom, nProp);
     LogPrint(BCLog::MNBUDGET, "mnvs - Sent Masternode votes to peer %i\n", pfrom->GetId());
     return 0;
@@ -1111,23 +1149,10 @@ bool CBudgetManager::ProcessProposalVote(CBudgetVote& vote, CNode* pfrom, CValid
         }
 
         AddSeenProposalVote(vote);
-
-        if (!vote.CheckSignature(dmn->pdmnState->keyIDVoting)) {
-            err = strprintf("invalid mvote sig from dmn: %s", mn_protx_id);
-            return state.DoS(100, false, REJECT_INVALID, "bad-mvote-sig", false, err);
-        }
-
-        if (!UpdateProposal(vote, pfrom, err)) {
-            return state.DoS(0, false, REJECT_INVALID, "bad-mvote", false, strprintf("%s (%s)", err, mn_protx_id));
-        }
-
-        // Relay only if we are synchronized
-        // Makes no sense to relay votes to the peers from where we are syncing them.
-        if (g_tiertwo_sync_state.IsSynced()) vote.Relay();
-        g_tiertwo_sync_state.AddedBudgetItem(voteID);
-        LogPrint(BCLog::MNBUDGET, "mvote - new vote (%s) for proposal %s from dmn %s\n",
-                voteID.ToString(), vote.GetProposalHash().ToString(), mn_protx_id);
-        return true;
+        return VerifyVoteSignature(vote, pfrom, dmn->pdmnState->keyIDVoting, state, BCLog::MNBUDGET,
+                [this, mn_protx_id](const CBudgetVote& v, CNode* pnode, bool fValidSig, CValidationState& s) {
+                    return ProcessProposalVoteSig(v, pnode, fValidSig, true, mn_protx_id, s);
+                });
     }
 
     // -- Legacy System (!TODO: remove after enforcement) --
@@ -1145,25 +1170,39 @@ bool CBudgetManager::ProcessProposalVote(CBudgetVote& vote, CNode* pfrom, CValid
     }
 
     AddSeenProposalVote(vote);
+    const std::string strVoter = voteVin.prevout.ToString();
+    return VerifyVoteSignature(vote, pfrom, pmn->pubKeyMasternode.GetID(), state, BCLog::MNBUDGET,
+            [this, strVoter](const CBudgetVote& v, CNode* pnode, bool fValidSig, CValidationState& s) {
+                return ProcessProposalVoteSig(v, pnode, fValidSig, false, strVoter, s);
+            });
+}
 
-    if (!vote.CheckSignature(pmn->pubKeyMasternode.GetID())) {
+bool CBudgetManager::ProcessProposalVoteSig(const CBudgetVote& vote, CNode* pfrom, bool fValidSig, bool fDeterministic, const std::string& strVoter, CValidationState& state)
+{
+    std::string err;
+    if (!fValidSig) {
+        if (fDeterministic) {
+            err = strprintf("invalid mvote sig from dmn: %s", strVoter);
+            return state.DoS(100, false, REJECT_INVALID, "bad-mvote-sig", false, err);
+        }
         if (g_tiertwo_sync_state.IsSynced()) {
-            err = strprintf("signature from masternode %s invalid", voteVin.prevout.ToString());
+            err = strprintf("signature from masternode %s invalid", strVoter);
             return state.DoS(20, false, REJECT_INVALID, "bad-mvote-sig", false, err);
         }
         return false;
     }
 
     if (!UpdateProposal(vote, pfrom, err)) {
-        return state.DoS(0, false, REJECT_INVALID, "bad-mvote", false, err);
+        return state.DoS(0, false, REJECT_INVALID, "bad-mvote", false, fDeterministic ? strprintf("%s (%s)", err, strVoter) : err);
     }
 
     // Relay only if we are synchronized
     // Makes no sense to relay votes to the peers from where we are syncing them.
     if (g_tiertwo_sync_state.IsSynced()) vote.Relay();
+    const uint256& voteID = vote.GetHash();
     g_tiertwo_sync_state.AddedBudgetItem(voteID);
-    LogPrint(BCLog::MNBUDGET, "mvote - new vote (%s) for proposal %s from dmn %s\n",
-            voteID.ToString(), vote.GetProposalHash().ToString(), voteVin.prevout.ToString());
+    LogPrint(BCLog::MNBUDGET, "mvote - new vote (%s) for proposal %s from %s %s\n",
+            voteID.ToString(), vote.GetProposalHash().ToString(), fDeterministic ? "dmn" : "mn", strVoter);
     return true;
 }
 
@@ -1220,23 +1259,10 @@ bool CBudgetManager::ProcessFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNod
         }
 
         AddSeenFinalizedBudgetVote(vote);
-
-        if (!vote.CheckSignature(dmn->pdmnState->pubKeyOperator.Get())) {
-            err = strprintf("invalid fbvote sig from dmn: %s", mn_protx_id);
-            return state.DoS(100, false, REJECT_INVALID, "bad-fbvote-sig", false, err);
-        }
-
-        if (!UpdateFinalizedBudget(vote, pfrom, err)) {
-            return state.DoS(0, false, REJECT_INVALID, "bad-fbvote", false, strprintf("%s (%s)", err, mn_protx_id));
-        }
-
-        // Relay only if we are synchronized
-        // Makes no sense to relay votes to the peers from where we are syncing them.
-        if (g_tiertwo_sync_state.IsSynced()) vote.Relay();
-        g_tiertwo_sync_state.AddedBudgetItem(voteID);
-        LogPrint(BCLog::MNBUDGET, "fbvote - new vote (%s) for budget %s from dmn %s\n",
-                voteID.ToString(), vote.GetBudgetHash().ToString(), mn_protx_id);
-        return true;
+        return VerifyVoteSignature(vote, pfrom, dmn->pdmnState->pubKeyOperator.Get(), state, BCLog::MNBUDGET,
+                [this, mn_protx_id](const CFinalizedBudgetVote& v, CNode* pnode, bool fValidSig, CValidationState& s) {
+                    return ProcessFinalizedBudgetVoteSig(v, pnode, fValidSig, true, mn_protx_id, s);
+                });
     }
 
     // -- Legacy System (!TODO: remove after enforcement) --
@@ -1253,25 +1279,39 @@ bool CBudgetManager::ProcessFinalizedBudgetVote(CFinalizedBudgetVote& vote, CNod
     }
 
     AddSeenFinalizedBudgetVote(vote);
+    const std::string strVoter = voteVin.prevout.ToString();
+    return VerifyVoteSignature(vote, pfrom, pmn->pubKeyMasternode.GetID(), state, BCLog::MNBUDGET,
+            [this, strVoter](const CFinalizedBudgetVote& v, CNode* pnode, bool fValidSig, CValidationState& s) {
+                return ProcessFinalizedBudgetVoteSig(v, pnode, fValidSig, false, strVoter, s);
+            });
+}
 
-    if (!vote.CheckSignature(pmn->pubKeyMasternode.GetID())) {
+bool CBudgetManager::ProcessFinalizedBudgetVoteSig(const CFinalizedBudgetVote& vote, CNode* pfrom, bool fValidSig, bool fDeterministic, const std::string& strVoter, CValidationState& state)
+{
+    std::string err;
+    if (!fValidSig) {
+        if (fDeterministic) {
+            err = strprintf("invalid fbvote sig from dmn: %s", strVoter);
+            return state.DoS(100, false, REJECT_INVALID, "bad-fbvote-sig", false, err);
+        }
         if (g_tiertwo_sync_state.IsSynced()) {
-            err = strprintf("signature from masternode %s invalid", voteVin.prevout.ToString());
+            err = strprintf("signature from masternode %s invalid", strVoter);
             return state.DoS(20, false, REJECT_INVALID, "bad-fbvote-sig", false, err);
         }
         return false;
     }
 
     if (!UpdateFinalizedBudget(vote, pfrom, err)) {
-        return state.DoS(0, false, REJECT_INVALID, "bad-fbvote", false, err);
+        return state.DoS(0, false, REJECT_INVALID, "bad-fbvote", false, fDeterministic ? strprintf("%s (%s)", err, strVoter) : err);
     }
 
     // Relay only if we are synchronized
     // Makes no sense to relay votes to the peers from where we are syncing them.
     if (g_tiertwo_sync_state.IsSynced()) vote.Relay();
+    const uint256& voteID = vote.GetHash();
     g_tiertwo_sync_state.AddedBudgetItem(voteID);
-    LogPrint(BCLog::MNBUDGET, "fbvote - new vote (%s) for budget %s from mn %s\n",
-            voteID.ToString(), vote.GetBudgetHash().ToString(), voteVin.prevout.ToString());
+    LogPrint(BCLog::MNBUDGET, "fbvote - new vote (%s) for budget %s from %s %s\n",
+            voteID.ToString(), vote.GetBudgetHash().ToString(), fDeterministic ? "dmn" : "mn", strVoter);
     return true;
 }
 
@@ -1289,7 +1329,12 @@ int CBudgetManager::ProcessMessageInner(CNode* pfrom, std::string& strCommand, C
         // Masternode vote sync
         uint256 nProp;
         vRecv >> nProp;
-        return ProcessBudgetVoteSync(nProp, pfrom);
+        // Optional digest of the items known by the peer (not sent by older versions)
+        BudgetSyncDigest peerDigest;
+        if (nProp.IsNull() && !vRecv.empty()) {
+            vRecv >> peerDigest;
+        }
+        return ProcessBudgetVoteSync(nProp, pfrom, peerDigest);
     }
 
     if (strCommand == NetMsgType::BUDGETPROPOSAL) {
@@ -1409,23 +1454,33 @@ static bool relayItemIfFound(const uint256& itemHash, CNode* pfrom, RecursiveMut
 }
 
 template<typename T>
-static void relayInventoryItems(CNode* pfrom, RecursiveMutex& cs, std::map<uint256, T>& map, bool fPartial, GetDataMsg invType, const int mn_sync_budget_type)
+static void relayInventoryItems(CNode* pfrom, RecursiveMutex& cs, std::map<uint256, T>& map, bool fPartial, GetDataMsg invType, const int mn_sync_budget_type,
+                                const BudgetSyncDigest& peerDigest)
 {
     CNetMsgMaker msgMaker(pfrom->GetSendVersion());
     int nInvCount = 0;
+    int nKnownCount = 0;
     {
         LOCK(cs);
         for (auto& it: map) {
             T* item = &(it.second);
             if (item && item->IsValid()) {
-                pfrom->PushInventory(CInv(invType, item->GetHash()));
-                nInvCount++;
+                const auto& itDigest = peerDigest.find(it.first);
+                if (itDigest != peerDigest.end()) {
+                    // the peer has the item already, send the votes only if it is missing some of them
+                    nKnownCount++;
+                    if (itDigest->second == item->GetVotesDigest()) continue;
+                } else {
+                    pfrom->PushInventory(CInv(invType, item->GetHash()));
+                    nInvCount++;
+                }
                 item->SyncVotes(pfrom, fPartial, nInvCount);
             }
         }
     }
-    g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, mn_sync_budget_type, nInvCount));
-    LogPrint(BCLog::MNBUDGET, "%s: sent %d items\n", __func__, nInvCount);
+    // The items known by the peer are counted as well: it uses the count to see that the sync is progressing
+    g_connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SYNCSTATUSCOUNT, mn_sync_budget_type, nInvCount + nKnownCount));
+    LogPrint(BCLog::MNBUDGET, "%s: sent %d items (%d items already known by peer)\n", __func__, nInvCount, nKnownCount);
 }
 
 void CBudgetManager::SyncSingleItem(CNode* pfrom, const uint256& nProp)
@@ -1443,11 +1498,11 @@ void CBudgetManager::SyncSingleItem(CNode* pfrom, const uint256& nProp)
 }
 
 
-void CBudgetManager::Sync(CNode* pfrom, bool fPartial)
+void CBudgetManager::Sync(CNode* pfrom, bool fPartial, const BudgetSyncDigest& peerDigest)
 {
     // Full budget sync request.
-    relayInventoryItems<CBudgetProposal>(pfrom, cs_proposals, mapProposals, fPartial, MSG_BUDGET_PROPOSAL, MASTERNODE_SYNC_BUDGET_PROP);
-    relayInventoryItems<CFinalizedBudget>(pfrom, cs_budgets, mapFinalizedBudgets, fPartial, MSG_BUDGET_FINALIZED, MASTERNODE_SYNC_BUDGET_FIN);
+    relayInventoryItems<CBudgetProposal>(pfrom, cs_proposals, mapProposals, fPartial, MSG_BUDGET_PROPOSAL, MASTERNODE_SYNC_BUDGET_PROP, peerDigest);
+    relayInventoryItems<CFinalizedBudget>(pfrom, cs_budgets, mapFinalizedBudgets, fPartial, MSG_BUDGET_FINALIZED, MASTERNODE_SYNC_BUDGET_FIN, peerDigest);
 
     if (!fPartial) {
         // We are not going to answer full budget sync requests for an hour (chainparams.FulfilledRequestExpireTime()).
@@ -1456,6 +1511,23 @@ void CBudgetManager::Sync(CNode* pfrom, bool fPartial)
     }
 }
 
+template<typename T>
+static void AppendSyncDigest(RecursiveMutex& cs, const std::map<uint256, T>& map, BudgetSyncDigest& digest)
+{
+    LOCK(cs);
+    for (const auto& it: map) {
+        if (it.second.IsValid()) digest.emplace(it.first, it.second.GetVotesDigest());
+    }
+}
+
+BudgetSyncDigest CBudgetManager::GetSyncDigest() const
+{
+    BudgetSyncDigest digest;
+    AppendSyncDigest<CBudgetProposal>(cs_proposals, mapProposals, digest);
+    AppendSyncDigest<CFinalizedBudget>(cs_budgets, mapFinalizedBudgets, digest);
+    return digest;
+}
+
 template<typename T>
 static void TryAppendOrphanVoteMap(const T& vote,
                                    const uint256& parentHash,
@@ -1512,7 +1584,12 @@ bool CBudgetManager::UpdateProposal(const CBudgetVote& vote, CNode* pfrom, std::
     }
 
     // Add or update vote
-    return itProposal->second.AddOrUpdateVote(vote, strError);
+    if (!itProposal->second.AddOrUpdateVote(vote, strError)) {
+        return false;
+    }
+    ClearCachedBudget();
+    GetMainSignals().NotifyProposalVote(vote);
+    return true;
 }
 
 bool CBudgetManager::UpdateFinalizedBudget(const CFinalizedBudgetVote& vote, CNode* pfrom, std::string& strError)
@@ -1542,7 +1619,12 @@ bool CBudgetManager::UpdateFinalizedBudget(const CFinalizedBudgetVote& vote, CNo
         return false;
     }
     LogPrint(BCLog::MNBUDGET,"%s: Finalized Proposal %s added\n", __func__, nBudgetHash.ToString());
-    return mapFinalizedBudgets[nBudgetHash].AddOrUpdateVote(vote, strError);
+    if (!mapFinalizedBudgets[nBudgetHash].AddOrUpdateVote(vote, strError)) {
+        return false;
+    }
+    ClearHighestFinBudgets();
+    GetMainSignals().NotifyFinalizedBudgetVote(vote);
+    return true;
 }
 
 std::string CBudgetManager::ToString() const
@@ -8,12 +8,17 @@
 
 #include "budget/budgetproposal.h"
 #include "budget/finalizedbudget.h"
+#include "optional.h"
 #include "validationinterface.h"
 
 class CValidationState;
 
 #define ORPHAN_VOTES_CACHE_LIMIT 10000
 
+// Proposal or finalized budget hash --> digest of its votes (GetVotesDigest), sent along the full budget sync
+// requests so that the peer skips the items that are already known with all their votes.
+typedef std::map<uint256, uint256> BudgetSyncDigest;
+
 //
 // Budget Manager : Contains all proposals for the budget
 //
@@ -47,6 +52,24 @@ protected:
         int m_vote_count{0};
     };
 
+    // Memory Only. The finalized budget with the highest vote count, by block height (the superblock
+    // payments of the cycle, asked for again by the block validation and the block creation).
+    // Cleared when a finalized budget or one of its votes changes.
+    mutable std::map<int, HighestFinBudget> mapHighestFinBudgets;          // guarded by cs_budgets
+
+    // Memory Only. The result of GetBudget, for the chain height and the enabled masternodes count
+    // it was computed with. Cleared when a proposal or one of its votes changes.
+    struct WinningProposals {
+        int m_height{0};
+        int m_mn_count{0};
+        std::vector<CBudgetProposal> m_proposals;
+    };
+    Optional<WinningProposals> cachedBudget;                                // guarded by cs_proposals
+
+    // Drop the cached results, need cs_budgets (cs_proposals) locked
+    void ClearHighestFinBudgets() { AssertLockHeld(cs_budgets); mapHighestFinBudgets.clear(); }
+    void ClearCachedBudget() { AssertLockHeld(cs_proposals); cachedBudget = nullopt; }
+
     // Returns a const pointer to the budget with highest vote count
     HighestFinBudget GetBudgetWithHighestVoteCount(int chainHeight) const;
     int GetHighestVoteCount(int chainHeight) const;
@@ -55,6 +78,10 @@ protected:
     // Marks synced all votes in proposals and finalized budgets
     void SetSynced(bool synced);
 
+    // Rest of ProcessProposalVote/ProcessFinalizedBudgetVote, once the signature of the vote is checked
+    bool ProcessProposalVoteSig(const CBudgetVote& vote, CNode* pfrom, bool fValidSig, bool fDeterministic, const std::string& strVoter, CValidationState& state);
+    bool ProcessFinalizedBudgetVoteSig(const CFinalizedBudgetVote& vote, CNode* pfrom, bool fValidSig, bool fDeterministic, const std::string& strVoter, CValidationState& state);
+
 public:
     // critical sections to protect the inner data structures (must be locked in this order)
     mutable RecursiveMutex cs_budgets;
@@ -101,7 +128,9 @@ public:
     void ResetSync() { SetSynced(false); }
     void MarkSynced() { SetSynced(true); }
     // Respond to full budget sync requests and internally triggered partial budget items relay
-    void Sync(CNode* node, bool fPartial);
+    void Sync(CNode* node, bool fPartial, const BudgetSyncDigest& peerDigest = BudgetSyncDigest());
+    // Digest of the valid proposals and finalized budgets, to send along a full budget sync request
+    BudgetSyncDigest GetSyncDigest() const;
     // Respond to single budget item requests (proposals / budget finalization)
     void SyncSingleItem(CNode* pfrom, const uint256& nProp);
     void SetBestHeight(int height) { nBestHeight.store(height, std::memory_order_release); };
@@ -111,7 +140,7 @@ public:
     /// Process the message and returns the ban score (0 if no banning is needed)
     int ProcessMessageInner(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
-    int ProcessBudgetVoteSync(const uint256& nProp, CNode* pfrom);
+    int ProcessBudgetVoteSync(const uint256& nProp, CNode* pfrom, const BudgetSyncDigest& peerDigest = BudgetSyncDigest());
     int ProcessProposal(CBudgetProposal& proposal);
     int ProcessFinalizedBudget(CFinalizedBudget& finalbudget, CNode* pfrom);
 
@@ -161,10 +190,12 @@ public:
             LOCK(cs_proposals);
             mapProposals.clear();
             mapFeeTxToProposal.clear();
+            ClearCachedBudget();
         }
         {
             LOCK(cs_budgets);
             mapFinalizedBudgets.clear();
+            ClearHighestFinBudgets();
             mapFeeTxToBudget.clear();
             mapUnconfirmedFeeTx.clear();
         }
@@ -191,6 +222,7 @@ public:
         {
             LOCK(obj.cs_proposals);
             READWRITE(obj.mapProposals, obj.mapFeeTxToProposal);
+            SER_READ(obj, obj.ClearCachedBudget());
         }
         {
             LOCK(obj.cs_votes);
@@ -199,6 +231,7 @@ public:
         {
             LOCK(obj.cs_budgets);
             READWRITE(obj.mapFinalizedBudgets, obj.mapFeeTxToBudget, obj.mapUnconfirmedFeeTx);
+            SER_READ(obj, obj.ClearHighestFinBudgets());
         }
         {
             LOCK(obj.cs_finalizedvotes);
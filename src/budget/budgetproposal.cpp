@@ -63,6 +63,11 @@ bool CBudgetProposal::ParseBroadcast(CDataStream& broadcast)
     return true;
 }
 
+uint256 CBudgetProposal::GetVotesDigest() const
+{
+    return GetBudgetVotesDigest(mapVotes);
+}
+
 void CBudgetProposal::SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount) const
 {
     for (const auto& it: mapVotes) {
@@ -228,8 +233,9 @@ bool CBudgetProposal::AddOrUpdateVote(const CBudgetVote& vote, std::string& strE
     const COutPoint& mnId = vote.GetVin().prevout;
     const int64_t voteTime = vote.GetTime();
 
-    if (mapVotes.count(mnId)) {
-        const int64_t& oldTime = mapVotes[mnId].GetTime();
+    auto it = mapVotes.find(mnId);
+    if (it != mapVotes.end()) {
+        const int64_t& oldTime = it->second.GetTime();
         if (oldTime > voteTime) {
             strError = strprintf("new vote older than existing vote - %s\n", vote.GetHash().ToString());
             LogPrint(BCLog::MNBUDGET, "%s: %s\n", __func__, strError);
@@ -242,9 +248,12 @@ bool CBudgetProposal::AddOrUpdateVote(const CBudgetVote& vote, std::string& strE
             return false;
         }
         strAction = "Existing vote updated:";
+        CountVote(it->second, -1);
+        it->second = vote;
+    } else {
+        mapVotes.emplace(mnId, vote);
     }
-
-    mapVotes[mnId] = vote;
+    CountVote(vote, 1);
     LogPrint(BCLog::MNBUDGET, "%s: %s %s\n", __func__, strAction.c_str(), vote.GetHash().ToString().c_str());
 
     return true;
@@ -281,15 +290,28 @@ double CBudgetProposal::GetRatio() const
     return ((double)(yeas) / (double)(yeas + nays));
 }
 
-int CBudgetProposal::GetVoteCount(CBudgetVote::VoteDirection vd) const
+void CBudgetProposal::CountVote(const CBudgetVote& vote, int nDelta)
 {
-    int ret = 0;
+    const CBudgetVote::VoteDirection vd = vote.GetDirection();
+    if (vote.IsValid() && vd < vVoteCounts.size()) {
+        vVoteCounts[vd] += nDelta;
+    }
+}
+
+void CBudgetProposal::RecountVotes()
+{
+    vVoteCounts.fill(0);
     for (const auto& it : mapVotes) {
-        const CBudgetVote& vote = it.second;
-        if (vote.GetDirection() == vd && vote.IsValid())
-            ret++;
+        CountVote(it.second, 1);
     }
-    return ret;
+}
+
+void CBudgetProposal::SetVoteValid(CBudgetVote& vote, bool fValidIn)
+{
+    if (vote.IsValid() == fValidIn) return;
+    CountVote(vote, -1);
+    vote.SetValid(fValidIn);
+    CountVote(vote, 1);
 }
 
 int CBudgetProposal::GetBlockStartCycle() const
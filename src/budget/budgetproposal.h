@@ -7,9 +7,13 @@
 #define BUDGET_PROPOSAL_H
 
 #include "budget/budgetvote.h"
+#include "hash.h"
 #include "net.h"
 #include "streams.h"
 
+#include <array>
+#include <map>
+
 static const CAmount PROPOSAL_FEE_TX = (50 * COIN);
 static const CAmount BUDGET_FEE_TX_OLD = (50 * COIN);
 static const CAmount BUDGET_FEE_TX = (5 * COIN);
@@ -24,6 +28,18 @@ static const size_t PROP_NAME_MAX_SIZE = 20;
 
 class CBudgetManager;
 
+// Hash of the valid votes of a proposal or finalized budget. The votes are ordered by voter,
+// so that the digest does not depend on the order they were received.
+template <typename Vote>
+uint256 GetBudgetVotesDigest(const std::map<COutPoint, Vote>& mapVotes)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    for (const auto& it: mapVotes) {
+        if (it.second.IsValid()) ss << it.second.GetHash();
+    }
+    return ss.GetHash();
+}
+
 //
 // Budget Proposal : Contains the masternode votes for each budget
 //
@@ -44,6 +60,13 @@ private:
     bool CheckAddress();
     bool CheckStrings();
 
+    // Number of valid votes for each direction, kept in sync with mapVotes
+    std::array<int, 3> vVoteCounts{};
+    void CountVote(const CBudgetVote& vote, int nDelta);
+    void RecountVotes();
+    // Used by CBudgetManager::RemoveStaleVotesOnProposal
+    void SetVoteValid(CBudgetVote& vote, bool fValidIn);
+
 protected:
     std::map<COutPoint, CBudgetVote> mapVotes;
     std::string strProposalName;
@@ -67,6 +90,8 @@ public:
 
     // sync proposal votes with a node
     void SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount) const;
+    // hash of the valid votes, the same on two nodes holding the same votes (see CBudgetManager::GetSyncDigest)
+    uint256 GetVotesDigest() const;
 
     // sets fValid and strInvalid, returns fValid
     bool UpdateValid(int nHeight, int mnCount);
@@ -93,7 +118,7 @@ public:
     int GetBlockEndCycle() const;
     const uint256& GetFeeTXHash() const { return nFeeTXHash;  }
     double GetRatio() const;
-    int GetVoteCount(CBudgetVote::VoteDirection vd) const;
+    int GetVoteCount(CBudgetVote::VoteDirection vd) const { return vd < vVoteCounts.size() ? vVoteCounts[vd] : 0; }
     std::map<COutPoint, CBudgetVote> GetVotes() const { return mapVotes; }
     int GetYeas() const { return GetVoteCount(CBudgetVote::VOTE_YES); }
     int GetNays() const { return GetVoteCount(CBudgetVote::VOTE_NO); }
@@ -127,6 +152,7 @@ public:
         READWRITE(obj.nFeeTXHash);
         READWRITE(obj.nTime);
         READWRITE(obj.mapVotes);
+        SER_READ(obj, obj.RecountVotes());
     }
 
     // Serialization for network messages.
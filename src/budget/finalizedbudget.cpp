@@ -57,8 +57,9 @@ bool CFinalizedBudget::AddOrUpdateVote(const CFinalizedBudgetVote& vote, std::st
     const int64_t voteTime = vote.GetTime();
     std::string strAction = "New vote inserted:";
 
-    if (mapVotes.count(mnId)) {
-        const int64_t oldTime = mapVotes[mnId].GetTime();
+    auto it = mapVotes.find(mnId);
+    if (it != mapVotes.end()) {
+        const int64_t oldTime = it->second.GetTime();
         if (oldTime > voteTime) {
             strError = strprintf("new vote older than existing vote - %s\n", vote.GetHash().ToString());
             LogPrint(BCLog::MNBUDGET, "%s: %s\n", __func__, strError);
@@ -71,9 +72,12 @@ bool CFinalizedBudget::AddOrUpdateVote(const CFinalizedBudgetVote& vote, std::st
             return false;
         }
         strAction = "Existing vote updated:";
+        if (it->second.IsValid()) nValidVotes--;
+        it->second = vote;
+    } else {
+        mapVotes.emplace(mnId, vote);
     }
-
-    mapVotes[mnId] = vote;
+    if (vote.IsValid()) nValidVotes++;
     LogPrint(BCLog::MNBUDGET, "%s: %s %s\n", __func__, strAction.c_str(), vote.GetHash().ToString().c_str());
     return true;
 }
@@ -168,6 +172,11 @@ std::vector<uint256> CFinalizedBudget::GetProposalsHashes() const
     return vHashes;
 }
 
+uint256 CFinalizedBudget::GetVotesDigest() const
+{
+    return GetBudgetVotesDigest(mapVotes);
+}
+
 void CFinalizedBudget::SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount) const
 {
     for (const auto& it: mapVotes) {
@@ -256,15 +265,21 @@ bool CFinalizedBudget::UpdateValid(int nCurrentHeight)
     return true;
 }
 
-int CFinalizedBudget::GetVoteCount() const
+void CFinalizedBudget::RecountVotes()
 {
-    int ret = 0;
+    nValidVotes = 0;
     for (const auto& it : mapVotes) {
         if (it.second.IsValid()) {
-            ret++;
+            nValidVotes++;
         }
     }
-    return ret;
+}
+
+void CFinalizedBudget::SetVoteValid(CFinalizedBudgetVote& vote, bool fValidIn)
+{
+    if (vote.IsValid() == fValidIn) return;
+    vote.SetValid(fValidIn);
+    nValidVotes += fValidIn ? 1 : -1;
 }
 
 std::vector<uint256> CFinalizedBudget::GetVotesHashes() const
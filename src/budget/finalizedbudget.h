@@ -42,6 +42,12 @@ private:
     bool CheckAmount(const CAmount& nTotalBudget);
     bool CheckName();
 
+    // Number of valid votes, kept in sync with mapVotes
+    int nValidVotes{0};
+    void RecountVotes();
+    // Used by CBudgetManager::RemoveStaleVotesOnFinalBudget
+    void SetVoteValid(CFinalizedBudgetVote& vote, bool fValidIn);
+
 protected:
     std::map<COutPoint, CFinalizedBudgetVote> mapVotes;
     std::string strBudgetName;
@@ -65,6 +71,8 @@ public:
 
     // sync budget votes with a node
     void SyncVotes(CNode* pfrom, bool fPartial, int& nInvCount) const;
+    // hash of the valid votes, the same on two nodes holding the same votes (see CBudgetManager::GetSyncDigest)
+    uint256 GetVotesDigest() const;
 
     // sets fValid and strInvalid, returns fValid
     bool UpdateValid(int nHeight);
@@ -86,7 +94,7 @@ public:
     int GetBlockStart() const { return nBlockStart; }
     int GetBlockEnd() const { return nBlockStart + (int)(vecBudgetPayments.size() - 1); }
     const uint256& GetFeeTXHash() const { return nFeeTXHash;  }
-    int GetVoteCount() const;
+    int GetVoteCount() const { return nValidVotes; }
     std::vector<uint256> GetVotesHashes() const;
     bool IsPaidAlready(const uint256& nProposalHash, const uint256& nBlockHash, int nBlockHeight) const;
     TrxValidationStatus IsTransactionValid(const CTransaction& txNew, const uint256& nBlockHash, int nBlockHeight) const;
@@ -118,6 +126,7 @@ public:
         READWRITE(obj.fAutoChecked);
         READWRITE(obj.mapVotes);
         READWRITE(obj.strProposals);
+        SER_READ(obj, obj.RecountVotes());
     }
 
     // Serialization for network messages.
@@ -0,0 +1,125 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cachebalancer.h"
+
+#include "coins.h"
+#include "evo/deterministicmns.h"
+#include "logging.h"
+#include "memorybudget.h"
+#include "validation.h"
+
+#include <algorithm>
+
+CCacheBalancer g_cache_balancer;
+
+static double GetMissRate(uint64_t nHits, uint64_t nMisses)
+{
+    return nHits + nMisses ? (double)nMisses / (nHits + nMisses) : 0.0;
+}
+
+void CCacheBalancer::Init(size_t nTotalIn, bool fDynamicIn)
+{
+    LOCK(cs);
+    nTotal = nTotalIn;
+    fDynamic = fDynamicIn;
+    nTierTwoTarget = 0;
+    nLastCoinsHits = nLastCoinsMisses = nLastTierTwoHits = nLastTierTwoMisses = 0;
+}
+
+bool CCacheBalancer::IsDynamic() const
+{
+    LOCK(cs);
+    return fDynamic;
+}
+
+size_t CCacheBalancer::GetTotal() const
+{
+    LOCK(cs);
+    return nTotal;
+}
+
+size_t CCacheBalancer::ComputeTierTwoTarget(size_t nTotal, size_t nCurrent, bool fInitialDownload, double dCoinsMissRate, double dTierTwoMissRate)
+{
+    const size_t nStep = nTotal / 16;
+    const size_t nMin = nStep, nMax = nTotal / 2;
+    if (fInitialDownload) return nMin;
+    nCurrent = std::min(std::max(nCurrent, nMin), nMax);
+    if (dTierTwoMissRate > dCoinsMissRate) return std::min(nCurrent + nStep, nMax);
+    if (dTierTwoMissRate < dCoinsMissRate) return std::max(nCurrent - nStep, nMin);
+    return nCurrent;
+}
+
+size_t CCacheBalancer::ComputeBudgetedTotal(size_t nTotal, size_t nLimit, size_t nOtherUsage)
+{
+    if (nLimit == 0) return nTotal;
+    return std::min(nTotal, nLimit > nOtherUsage ? nLimit - nOtherUsage : 0);
+}
+
+void CCacheBalancer::Rebalance()
+{
+    uint64_t nCoinsHits, nCoinsMisses;
+    bool fInitialDownload;
+    {
+        LOCK(cs_main);
+        if (!pcoinsTip || !deterministicMNManager) return;
+        pcoinsTip->GetCacheStats(nCoinsHits, nCoinsMisses);
+        fInitialDownload = IsInitialBlockDownload();
+    }
+    const CDeterministicMNManager::CacheStats mnstats = deterministicMNManager->GetCacheStats();
+
+    // The usage of the components of the memory budget that are not split here
+    const size_t nBudgetLimit = g_memory_budget.GetLimit();
+    size_t nOtherUsage = 0;
+    if (nBudgetLimit != 0) {
+        for (const CMemoryBudget::ComponentUsage& usage : g_memory_budget.GetUsage()) {
+            if (usage.strName != "coins" && usage.strName != "mnlists") nOtherUsage += usage.nUsage;
+        }
+    }
+
+    size_t nCoinsTarget, nTierTwo;
+    {
+        LOCK(cs);
+        if (!fDynamic) return;
+        // the coins cache is created again when the chainstate is reloaded
+        if (nCoinsHits < nLastCoinsHits || nCoinsMisses < nLastCoinsMisses) nLastCoinsHits = nLastCoinsMisses = 0;
+        const double dCoinsMissRate = GetMissRate(nCoinsHits - nLastCoinsHits, nCoinsMisses - nLastCoinsMisses);
+        const double dTierTwoMissRate = GetMissRate(mnstats.nHits - nLastTierTwoHits, mnstats.nMisses - nLastTierTwoMisses);
+        nLastCoinsHits = nCoinsHits;
+        nLastCoinsMisses = nCoinsMisses;
+        nLastTierTwoHits = mnstats.nHits;
+        nLastTierTwoMisses = mnstats.nMisses;
+
+        const size_t nAvailable = ComputeBudgetedTotal(nTotal, nBudgetLimit, nOtherUsage);
+        nTierTwo = ComputeTierTwoTarget(nAvailable, nTierTwoTarget, fInitialDownload, dCoinsMissRate, dTierTwoMissRate);
+        if (nTierTwo != nTierTwoTarget) {
+            LogPrint(BCLog::COINDB, "%s: %.1fMiB for the masternode lists cache, %.1fMiB for the coins cache (miss rates %.4f, %.4f%s)\n",
+                     __func__, nTierTwo * (1.0 / 1024 / 1024), (nAvailable - nTierTwo) * (1.0 / 1024 / 1024),
+                     dTierTwoMissRate, dCoinsMissRate, fInitialDownload ? ", initial download" : "");
+        }
+        nTierTwoTarget = nTierTwo;
+        nCoinsTarget = nAvailable - nTierTwo;
+    }
+    WITH_LOCK(cs_main, nCoinCacheUsage = nCoinsTarget);
+    // The share of the lists cache comes on top of its default cap, never under it
+    deterministicMNManager->SetMaxCacheUsage(std::max(nTierTwo, (size_t)CDeterministicMNManager::LIST_CACHE_MAX_USAGE));
+}
+
+std::vector<CCacheBalancer::CacheStats> CCacheBalancer::GetStats() const
+{
+    std::vector<CacheStats> ret;
+    {
+        LOCK(cs_main);
+        if (pcoinsTip) {
+            CacheStats coins{"coins", nCoinCacheUsage, pcoinsTip->DynamicMemoryUsage(), 0, 0};
+            pcoinsTip->GetCacheStats(coins.nHits, coins.nMisses);
+            ret.emplace_back(coins);
+        }
+    }
+    if (deterministicMNManager) {
+        const CDeterministicMNManager::CacheStats mnstats = deterministicMNManager->GetCacheStats();
+        ret.push_back({"mnlists", mnstats.nMaxCacheUsage, mnstats.nListsUsage + mnstats.nCacheUsage, mnstats.nHits, mnstats.nMisses});
+    }
+    return ret;
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_CACHEBALANCER_H
+#define PIVX_CACHEBALANCER_H
+
+#include "sync.h"
+
+#include <string>
+#include <vector>
+
+/** Default for -dynamicdbcache, move the in-memory part of -dbcache between the caches while running */
+static const bool DEFAULT_DYNAMIC_DBCACHE = true;
+/** How often the caches are rebalanced, in milliseconds */
+static const int64_t CACHE_BALANCE_INTERVAL = 60000;
+
+/**
+ * Splits the in-memory part of -dbcache (what is left after the block caches of the databases, sized
+ * when they are opened) between the coins cache and the masternode lists cache:
+ * - during the initial block download, the coins cache takes nearly everything;
+ * - after it, each rebalance moves a step towards the cache with the highest miss rate since the
+ *   previous one, so that the tier two caches get the memory when they are the ones reading the disk.
+ * The coins cache is flushed by the next FlushStateToDisk when its share shrinks under its usage.
+ * The masternode lists cache keeps at least its default cap (LIST_CACHE_MAX_USAGE). With a memory
+ * budget (-maxmemorybudget), only what the other components of the budget leave is split.
+ */
+class CCacheBalancer
+{
+public:
+    struct CacheStats {
+        std::string strName;
+        size_t nTarget;
+        size_t nUsage;
+        uint64_t nHits;
+        uint64_t nMisses;
+    };
+
+    /** Set the memory to split (nCoinCacheUsage, as computed at startup) */
+    void Init(size_t nTotal, bool fDynamic);
+    bool IsDynamic() const;
+    size_t GetTotal() const;
+
+    /** Observe the caches and move the split, called by the scheduler when -dynamicdbcache is set */
+    void Rebalance();
+
+    std::vector<CacheStats> GetStats() const;
+
+    /**
+     * The share of the masternode lists cache, after nCurrent, for the given sync state and miss rates
+     * since the previous rebalance: between 1/16 and 1/2 of nTotal, by steps of 1/16.
+     */
+    static size_t ComputeTierTwoTarget(size_t nTotal, size_t nCurrent, bool fInitialDownload, double dCoinsMissRate, double dTierTwoMissRate);
+
+    /** The memory to split: nTotal, capped by what the other components leave of a budget nLimit (0 = no budget) */
+    static size_t ComputeBudgetedTotal(size_t nTotal, size_t nLimit, size_t nOtherUsage);
+
+private:
+    mutable Mutex cs;
+    size_t nTotal GUARDED_BY(cs){0};
+    size_t nTierTwoTarget GUARDED_BY(cs){0};
+    bool fDynamic GUARDED_BY(cs){false};
+    // The counters of the caches at the previous rebalance
+    uint64_t nLastCoinsHits GUARDED_BY(cs){0};
+    uint64_t nLastCoinsMisses GUARDED_BY(cs){0};
+    uint64_t nLastTierTwoHits GUARDED_BY(cs){0};
+    uint64_t nLastTierTwoMisses GUARDED_BY(cs){0};
+};
+
+extern CCacheBalancer g_cache_balancer;
+
+#endif // PIVX_CACHEBALANCER_H
@@ -6,6 +6,9 @@
 
 #include "chain.h"
 #include "legacy/stakemodifier.h"  // for ComputeNextStakeModifier
+#include "sync.h"
+
+#include <set>
 
 
 /**
@@ -71,6 +74,15 @@ CBlockIndex* CChain::FindEarliestAtLeast(int64_t nTime) const
     return (lower == vChain.end() ? nullptr : *lower);
 }
 
+std::vector<CBlockIndex*> CChain::GetRange(int nStartHeight, int nEndHeight) const
+{
+    nStartHeight = std::max(nStartHeight, 0);
+    nEndHeight = std::min(nEndHeight, Height());
+    if (nStartHeight > nEndHeight)
+        return {};
+    return std::vector<CBlockIndex*>(vChain.begin() + nStartHeight, vChain.begin() + nEndHeight + 1);
+}
+
 /** Turn the lowest '1' bit in the binary representation of a number into a '0'. */
 int static inline InvertLowestOne(int n) { return n & (n - 1); }
 
@@ -130,7 +142,7 @@ CBlockIndex::CBlockIndex(const CBlock& block):
         nNonce{block.nNonce}
 {
     if(block.nVersion > 3 && block.nVersion < 7)
-        nAccumulatorCheckpoint = block.nAccumulatorCheckpoint;
+        SetAccumulatorCheckpoint(block.nAccumulatorCheckpoint);
     if (block.IsProofOfStake())
         SetProofOfStake();
 }
@@ -172,11 +184,29 @@ CBlockHeader CBlockIndex::GetBlockHeader() const
     block.nTime = nTime;
     block.nBits = nBits;
     block.nNonce = nNonce;
-    if (nVersion > 3 && nVersion < 7) block.nAccumulatorCheckpoint = nAccumulatorCheckpoint;
+    if (nVersion > 3 && nVersion < 7) block.nAccumulatorCheckpoint = GetAccumulatorCheckpoint();
     if (nVersion >= 8) block.hashFinalSaplingRoot = hashFinalSaplingRoot;
     return block;
 }
 
+/**
+ * The distinct accumulator checkpoints of the block index entries. A checkpoint changes every 10 blocks
+ * at most, and is null after the zerocoin era: the entries point to the shared copy instead of holding
+ * one each. Never freed (the entries are copied, e.g. in CDiskBlockIndex), the addresses are stable.
+ */
+static Mutex cs_accumulatorCheckpoints;
+static std::set<uint256> setAccumulatorCheckpoints GUARDED_BY(cs_accumulatorCheckpoints);
+
+void CBlockIndex::SetAccumulatorCheckpoint(const uint256& nAccumulatorCheckpoint)
+{
+    if (nAccumulatorCheckpoint.IsNull()) {
+        pAccumulatorCheckpoint = nullptr;
+        return;
+    }
+    LOCK(cs_accumulatorCheckpoints);
+    pAccumulatorCheckpoint = &*setAccumulatorCheckpoints.insert(nAccumulatorCheckpoint).first;
+}
+
 int64_t CBlockIndex::MaxFutureBlockTime() const
 {
     return GetAdjustedTime() + Params().GetConsensus().FutureBlockTimeDrift(nHeight+1);
@@ -232,10 +262,7 @@ bool CBlockIndex::SetStakeEntropyBit(unsigned int nEntropyBit)
 // Sets V1 stake modifier (uint64_t)
 void CBlockIndex::SetStakeModifier(const uint64_t nStakeModifier, bool fGeneratedStakeModifier)
 {
-    vStakeModifier.clear();
-    const size_t modSize = sizeof(nStakeModifier);
-    vStakeModifier.resize(modSize);
-    std::memcpy(vStakeModifier.data(), &nStakeModifier, modSize);
+    vStakeModifier.assign((const unsigned char*)&nStakeModifier, sizeof(nStakeModifier));
     if (fGeneratedStakeModifier)
         nFlags |= BLOCK_STAKE_MODIFIER;
 
@@ -257,8 +284,7 @@ void CBlockIndex::SetNewStakeModifier()
 // Sets V2 stake modifiers (uint256)
 void CBlockIndex::SetStakeModifier(const uint256& nStakeModifier)
 {
-    vStakeModifier.clear();
-    vStakeModifier.insert(vStakeModifier.begin(), nStakeModifier.begin(), nStakeModifier.end());
+    vStakeModifier.assign(nStakeModifier.begin(), nStakeModifier.size());
 }
 
 // Generates and sets new V2 stake modifier
@@ -309,6 +335,21 @@ void CBlockIndex::SetChainSaplingValue()
     }
 }
 
+void CBlockIndex::SetChainTransparentValue()
+{
+    if (!(nStatus & BLOCK_HAVE_SUPPLY)) {
+        nChainTransparentValue = nullopt;
+    } else if (pprev) {
+        if (pprev->nChainTransparentValue) {
+            nChainTransparentValue = *pprev->nChainTransparentValue + nTransparentValue;
+        } else {
+            nChainTransparentValue = nullopt;
+        }
+    } else {
+        nChainTransparentValue = nTransparentValue;
+    }
+}
+
 //! Check whether this block index entry is valid up to the passed validity level.
 bool CBlockIndex::IsValid(enum BlockStatus nUpTo) const
 {
@@ -20,6 +20,8 @@
 #include "util/system.h"
 #include "libzerocoin/Denominations.h"
 
+#include <array>
+#include <cstring>
 #include <vector>
 
 /**
@@ -121,6 +123,8 @@ enum BlockStatus {
     BLOCK_FAILED_VALID = 32, //! stage after last reached validness failed
     BLOCK_FAILED_CHILD = 64, //! descends from failed block
     BLOCK_FAILED_MASK = BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
+
+    BLOCK_HAVE_SUPPLY = 128, //! nTransparentValue set (the block was connected)
 };
 
 // BlockIndex flags
@@ -130,6 +134,47 @@ enum {
     BLOCK_STAKE_MODIFIER = (1 << 2), // regenerated stake modifier
 };
 
+/**
+ * The stake modifier bytes of a block index entry: 8 for the V1 modifiers, 32 for the V2 ones, none for
+ * the PoW blocks. Kept inline (instead of a heap allocated vector per entry), serialized as a vector.
+ */
+class CStakeModifierBytes
+{
+private:
+    std::array<unsigned char, 32> vch{};
+    uint8_t nSize{0};
+
+public:
+    bool empty() const { return nSize == 0; }
+    size_t size() const { return nSize; }
+    const unsigned char* data() const { return vch.data(); }
+    void clear() { nSize = 0; }
+    void assign(const unsigned char* pch, size_t len)
+    {
+        assert(len <= vch.size());
+        std::memcpy(vch.data(), pch, len);
+        nSize = len;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, nSize);
+        s.write((const char*)vch.data(), nSize);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint64_t len = ReadCompactSize(s);
+        if (len > vch.size()) {
+            throw std::ios_base::failure("invalid stake modifier size");
+        }
+        nSize = len;
+        s.read((char*)vch.data(), nSize);
+    }
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -174,10 +219,7 @@ public:
     //! Verification status of this block. See enum BlockStatus
     uint32_t nStatus{0};
 
-    // proof-of-stake specific fields
-    // char vector holding the stake modifier bytes. It is empty for PoW blocks.
-    // Modifier V1 is 64 bit while modifier V2 is 256 bit.
-    std::vector<unsigned char> vStakeModifier{};
+    //! proof-of-stake specific flags
     unsigned int nFlags{0};
 
     //! Change in value held by the Sapling circuit over this block.
@@ -189,6 +231,14 @@ public:
     //! Will be nullopt if nChainTx is zero.
    Optional<CAmount> nChainSaplingValue{nullopt};
 
+    //! Change in value of the unspent transparent outputs over this block.
+    //! Set when the block is connected (BLOCK_HAVE_SUPPLY), zero until then.
+    CAmount nTransparentValue{0};
+
+    //! (memory only) Total value of the unspent transparent outputs after this block (the transparent supply).
+    //! Will be nullopt if the change of a block up to this one is unknown.
+    Optional<CAmount> nChainTransparentValue{nullopt};
+
     //! block header
     int32_t nVersion{0};
     uint256 hashMerkleRoot{};
@@ -196,7 +246,9 @@ public:
     uint32_t nTime{0};
     uint32_t nBits{0};
     uint32_t nNonce{0};
-    uint256 nAccumulatorCheckpoint{};
+    //! accumulator checkpoint of the zerocoin era headers (nullptr if null), shared by the entries
+    //! with the same one. See GetAccumulatorCheckpoint
+    const uint256* pAccumulatorCheckpoint{nullptr};
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId{0};
@@ -204,6 +256,11 @@ public:
     //! (memory only) Maximum nTime in the chain upto and including this block.
     unsigned int nTimeMax{0};
 
+    // proof-of-stake specific fields
+    // the stake modifier bytes. It is empty for PoW blocks.
+    // Modifier V1 is 64 bit while modifier V2 is 256 bit.
+    CStakeModifierBytes vStakeModifier{};
+
     CBlockIndex() {}
     CBlockIndex(const CBlock& block);
 
@@ -218,6 +275,10 @@ public:
 
     int64_t GetMedianTimePast() const;
 
+    //! The accumulator checkpoint of the header (null after the zerocoin era)
+    const uint256& GetAccumulatorCheckpoint() const { return pAccumulatorCheckpoint ? *pAccumulatorCheckpoint : UINT256_ZERO; }
+    void SetAccumulatorCheckpoint(const uint256& nAccumulatorCheckpoint);
+
     int64_t MaxFutureBlockTime() const;
     int64_t MinPastBlockTime() const;
 
@@ -239,6 +300,9 @@ public:
     // Update Sapling chain value
     void SetChainSaplingValue();
 
+    // Update the transparent supply after this block
+    void SetChainTransparentValue();
+
     //! Check whether this block index entry is valid up to the passed validity level.
     bool IsValid(enum BlockStatus nUpTo = BLOCK_VALID_TRANSACTIONS) const;
     //! Raise the validity level of this block index entry.
@@ -259,6 +323,7 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
 // New serialization introduced with 4.0.99
 static const int DBI_OLD_SER_VERSION = 4009900;
 static const int DBI_SER_VERSION_NO_ZC = 4009902;   // removes mapZerocoinSupply, nMoneySupply
+static const int DBI_SER_VERSION_SUPPLY = 5069900;  // adds nTransparentValue
 
 class CDiskBlockIndex : public CBlockIndex
 {
@@ -297,14 +362,22 @@ public:
             READWRITE(obj.nTime);
             READWRITE(obj.nBits);
             READWRITE(obj.nNonce);
-            if(obj.nVersion > 3 && obj.nVersion < 7)
-                READWRITE(obj.nAccumulatorCheckpoint);
+            if(obj.nVersion > 3 && obj.nVersion < 7) {
+                uint256 nAccumulatorCheckpoint = obj.GetAccumulatorCheckpoint();
+                READWRITE(nAccumulatorCheckpoint);
+                SER_READ(obj, obj.SetAccumulatorCheckpoint(nAccumulatorCheckpoint));
+            }
 
             // Sapling blocks
             if (obj.nVersion >= 8) {
                 READWRITE(obj.hashFinalSaplingRoot);
                 READWRITE(obj.nSaplingValue);
             }
+
+            // Transparent supply change, of the blocks connected
+            if (nSerVersion >= DBI_SER_VERSION_SUPPLY && (obj.nStatus & BLOCK_HAVE_SUPPLY)) {
+                READWRITE(obj.nTransparentValue);
+            }
         } else if (nSerVersion > DBI_OLD_SER_VERSION && ser_action.ForRead()) {
             // Serialization with CLIENT_VERSION = 4009901
             std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
@@ -320,7 +393,11 @@ public:
             READWRITE(obj.nNonce);
             if (obj.nVersion > 3) {
                 READWRITE(mapZerocoinSupply);
-                if (obj.nVersion < 7) READWRITE(obj.nAccumulatorCheckpoint);
+                if (obj.nVersion < 7) {
+                    uint256 nAccumulatorCheckpoint;
+                    READWRITE(nAccumulatorCheckpoint);
+                    SER_READ(obj, obj.SetAccumulatorCheckpoint(nAccumulatorCheckpoint));
+                }
             }
         } else if (ser_action.ForRead()) {
             // Serialization with CLIENT_VERSION = 4009900-
@@ -355,7 +432,9 @@ public:
             if (obj.nVersion > 3) {
                 std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
                 std::vector<libzerocoin::CoinDenomination> vMintDenominationsInBlock;
-                READWRITE(obj.nAccumulatorCheckpoint);
+                uint256 nAccumulatorCheckpoint;
+                READWRITE(nAccumulatorCheckpoint);
+                SER_READ(obj, obj.SetAccumulatorCheckpoint(nAccumulatorCheckpoint));
                 READWRITE(mapZerocoinSupply);
                 READWRITE(vMintDenominationsInBlock);
             }
@@ -372,7 +451,7 @@ public:
         block.nBits = nBits;
         block.nNonce = nNonce;
         if (nVersion > 3 && nVersion < 7)
-            block.nAccumulatorCheckpoint = nAccumulatorCheckpoint;
+            block.nAccumulatorCheckpoint = GetAccumulatorCheckpoint();
         if (nVersion >= 8)
             block.hashFinalSaplingRoot = hashFinalSaplingRoot;
         return block.GetHash();
@@ -463,6 +542,9 @@ public:
 
     /** Find the earliest block with timestamp equal or greater than the given. */
     CBlockIndex* FindEarliestAtLeast(int64_t nTime) const;
+
+    /** Return the entries of the heights [nStartHeight, nEndHeight] of this chain (clamped to the chain), copied from the height array. */
+    std::vector<CBlockIndex*> GetRange(int nStartHeight, int nEndHeight) const;
 };
 
 #endif // BITCOIN_CHAIN_H
@@ -0,0 +1,79 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chaintipsnapshot.h"
+
+#include "chain.h"
+#include "spork.h"
+#include "validation.h"
+
+static Mutex cs_tip_snapshot;
+static ChainTipSnapshotRef g_tip_snapshot GUARDED_BY(cs_tip_snapshot) = std::make_shared<const CChainTipSnapshot>();
+
+int CChainTipSnapshot::Height() const
+{
+    return pindexTip ? pindexTip->nHeight : -1;
+}
+
+bool CChainTipSnapshot::HasChainLock(const CBlockIndex* pindex) const
+{
+    if (!pindexChainLock || pindex->nHeight > pindexChainLock->nHeight ||
+            !sporkManager.IsSporkActive(SPORK_23_CHAINLOCKS_ENFORCEMENT)) {
+        return false;
+    }
+    return pindexChainLock->GetAncestor(pindex->nHeight) == pindex;
+}
+
+ChainTipSnapshotRef GetChainTipSnapshot()
+{
+    LOCK(cs_tip_snapshot);
+    return g_tip_snapshot;
+}
+
+// Copy, update and publish the snapshot atomically, so that the concurrent publishers don't
+// overwrite each other's fields
+template <typename Callable>
+static void UpdateChainTipSnapshot(Callable update)
+{
+    LOCK(cs_tip_snapshot);
+    auto snapshot = std::make_shared<CChainTipSnapshot>(*g_tip_snapshot);
+    update(*snapshot);
+    g_tip_snapshot = std::move(snapshot);
+}
+
+void PublishChainTipSnapshot(const CBlockIndex* pindexTip)
+{
+    AssertLockHeld(cs_main);
+    // Read before cs_tip_snapshot, which is taken last
+    CDeterministicMNList mnList;
+    if (pindexTip && deterministicMNManager) {
+        mnList = deterministicMNManager->GetListForBlock(pindexTip);
+    }
+    UpdateChainTipSnapshot([&](CChainTipSnapshot& snapshot) {
+        snapshot.pindexTip = pindexTip;
+        snapshot.nBestHeaderHeight = pindexBestHeader ? pindexBestHeader->nHeight : -1;
+        snapshot.mnList = std::move(mnList);
+    });
+}
+
+void PublishBestHeaderSnapshot()
+{
+    AssertLockHeld(cs_main);
+    UpdateChainTipSnapshot([&](CChainTipSnapshot& snapshot) {
+        snapshot.nBestHeaderHeight = pindexBestHeader ? pindexBestHeader->nHeight : -1;
+    });
+}
+
+void PublishChainLockSnapshot(const CBlockIndex* pindexChainLock)
+{
+    UpdateChainTipSnapshot([&](CChainTipSnapshot& snapshot) {
+        snapshot.pindexChainLock = pindexChainLock;
+    });
+}
+
+void ResetChainTipSnapshot()
+{
+    LOCK(cs_tip_snapshot);
+    g_tip_snapshot = std::make_shared<const CChainTipSnapshot>();
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_CHAINTIPSNAPSHOT_H
+#define PIVX_CHAINTIPSNAPSHOT_H
+
+#include "evo/deterministicmns.h"
+#include "sync.h"
+
+#include <memory>
+
+class CBlockIndex;
+
+extern RecursiveMutex cs_main;
+
+/**
+ * Immutable view of the chain tip, so that the read-only RPCs don't take cs_main.
+ * A new snapshot is published, under cs_main, each time the tip of the active chain changes,
+ * and when the best header or the best chainlock change. The block indexes are never deleted
+ * while the chain is loaded, so the pointers stay valid as long as the snapshot is referenced.
+ */
+struct CChainTipSnapshot
+{
+    //! Tip of the active chain, nullptr before the chain is loaded
+    const CBlockIndex* pindexTip{nullptr};
+    //! Height of the best header, -1 if none
+    int nBestHeaderHeight{-1};
+    //! Deterministic masternode list at the tip
+    CDeterministicMNList mnList;
+    //! Block of the best chainlock enforced, nullptr if none
+    const CBlockIndex* pindexChainLock{nullptr};
+
+    int Height() const;
+    // Whether the block is the block of the best chainlock or one of its ancestors
+    bool HasChainLock(const CBlockIndex* pindex) const;
+};
+
+typedef std::shared_ptr<const CChainTipSnapshot> ChainTipSnapshotRef;
+
+/** The last snapshot published, never null */
+ChainTipSnapshotRef GetChainTipSnapshot();
+
+/** Publish the tip of the active chain, with its masternode list and the best header */
+void PublishChainTipSnapshot(const CBlockIndex* pindexTip) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/** Publish the best header, when it changes without a tip change */
+void PublishBestHeaderSnapshot() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/** Publish the block of the best chainlock, once it is enforced */
+void PublishChainLockSnapshot(const CBlockIndex* pindexChainLock);
+/** Drop the block index pointers, when the block index is unloaded */
+void ResetChainTipSnapshot();
+
+#endif // PIVX_CHAINTIPSNAPSHOT_H
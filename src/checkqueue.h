@@ -5,7 +5,14 @@
 #ifndef BITCOIN_CHECKQUEUE_H
 #define BITCOIN_CHECKQUEUE_H
 
+#include "sync.h"
+
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -23,12 +30,39 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * The verifications are spread over per-worker queues, so that the workers
+  * don't contend on a single lock: each worker takes batches from the back
+  * of its own queue, and steals from the front of the others' queues when
+  * it runs out. The master only steals.
+  *
+  * The masters of several threads take turns, a CCheckQueueControl holding
+  * the queue for its lifetime.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! Maximum number of per-worker queues, the workers over it share them
+    static const unsigned int MAX_WORKER_QUEUES = 64;
+
+    //! Number of times an idle worker yields, looking for work, before sleeping
+    static const int IDLE_SPINS = 64;
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<T> checks;
+    };
+
+    std::array<WorkerQueue, MAX_WORKER_QUEUES> workerQueues;
+
+    //! Number of worker threads registered, each owning the queue of its index (modulo MAX_WORKER_QUEUES)
+    std::atomic<unsigned int> nWorkers{0};
+
+    //! Queue receiving the next chunk of added verifications
+    unsigned int nNextQueue{0};
+
+    //! Mutex protecting the idle state, the workers and the master sleep under it
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -37,93 +71,118 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
-
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The number of workers (including the master) that are sleeping.
+    int nIdle{0};
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk{true};
 
     /**
      * Number of verifications that haven't completed yet.
-     * This includes elements that are not anymore in queue, but still in
+     * This includes elements that are not anymore in the queues, but still in
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo{0};
+
+    //! Number of verifications in the queues, not taken by a worker yet
+    std::atomic<unsigned int> nQueued{0};
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    /**
+     * Move a batch of verifications of a queue to vChecks. From the own queue, take half
+     * of it, so that the batches get smaller as the work runs out and the others can steal
+     * the rest; from the queue of another worker, take half of it from the other end.
+     */
+    bool TakeBatch(WorkerQueue& wq, bool fOwn, std::vector<T>& vChecks)
+    {
+        std::lock_guard<std::mutex> lock(wq.mutex);
+        if (wq.checks.empty()) return false;
+        const size_t nNow = std::max((size_t)1, std::min((size_t)nBatchSize, wq.checks.size() / 2));
+        vChecks.resize(nNow);
+        for (size_t i = 0; i < nNow; i++) {
+            // swap instead of copying, to keep the lock short
+            if (fOwn) {
+                vChecks[i].swap(wq.checks.back());
+                wq.checks.pop_back();
+            } else {
+                vChecks[i].swap(wq.checks.front());
+                wq.checks.pop_front();
+            }
+        }
+        nQueued -= nNow;
+        return true;
+    }
+
+    //! Find work: in the own queue first (nOwn < 0 for the master), then in the others
+    bool FindBatch(int nOwn, unsigned int& nVictim, std::vector<T>& vChecks)
+    {
+        if (nOwn >= 0 && TakeBatch(workerQueues[nOwn], true, vChecks)) return true;
+        const unsigned int nQueues = std::max(1U, std::min(nWorkers.load(), (unsigned int)MAX_WORKER_QUEUES));
+        for (unsigned int i = 0; i < nQueues; i++) {
+            nVictim = (nVictim + 1) % nQueues;
+            if ((int)nVictim != nOwn && TakeBatch(workerQueues[nVictim], false, vChecks)) return true;
+        }
+        return false;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        const int nOwn = fMaster ? -1 : (int)(nWorkers++ % MAX_WORKER_QUEUES);
+        unsigned int nVictim = fMaster ? 0 : nOwn;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
+        int nSpins = 0;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master he can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+            if (FindBatch(nOwn, nVictim, vChecks)) {
+                // Check whether we need to do work at all
+                bool fOk = fAllOk;
+                for (T& check : vChecks)
+                    if (fOk)
+                        fOk = check();
+                const unsigned int nNow = vChecks.size();
+                vChecks.clear();
+                if (!fOk) fAllOk = false;
+                if (nTodo.fetch_sub(nNow) == nNow && !fMaster) {
+                    // We processed the last element; inform the master it can exit and return the result
+                    boost::unique_lock<boost::mutex> lock(mutex);
+                    condMaster.notify_one();
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
+                nSpins = 0;
+                continue;
+            }
+            // Out of work: look again a few times before going to sleep, new work is often on the way
+            if (nSpins < IDLE_SPINS && !(fMaster && nTodo == 0)) {
+                nSpins++;
+                std::this_thread::yield();
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (nQueued == 0) {
+                if (fMaster && nTodo == 0) {
+                    bool fRet = fAllOk;
+                    // reset the status for new work later
+                    fAllOk = true;
+                    // return the current status
+                    return fRet;
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                nIdle++;
+                cond.wait(lock); // wait
+                nIdle--;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
+            nSpins = 0;
         } while (true);
     }
 
 public:
+    //! Held by the CCheckQueueControl using the queue, there is one master at a time
+    Mutex m_control_mutex;
+
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
@@ -140,15 +199,28 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty()) return;
+        // Spread the checks in contiguous chunks over the worker queues
+        const unsigned int nQueues = std::max(1U, std::min(nWorkers.load(), (unsigned int)MAX_WORKER_QUEUES));
+        const size_t nChunk = (vChecks.size() + nQueues - 1) / nQueues;
+        // counted before they can be taken, so that the counters never underflow
         nTodo += vChecks.size();
+        nQueued += vChecks.size();
+        for (size_t nPos = 0; nPos < vChecks.size(); nPos += nChunk) {
+            WorkerQueue& wq = workerQueues[nNextQueue++ % nQueues];
+            const size_t nEnd = std::min(vChecks.size(), nPos + nChunk);
+            std::lock_guard<std::mutex> lock(wq.mutex);
+            for (size_t i = nPos; i < nEnd; i++) {
+                wq.checks.emplace_back();
+                vChecks[i].swap(wq.checks.back());
+            }
+        }
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (nIdle == 0)
+            return;
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
@@ -156,10 +228,11 @@ public:
     {
     }
 
+    //! Whether no verification is pending, the workers may still be looking for work before sleeping
     bool IsIdle()
     {
         boost::unique_lock<boost::mutex> lock(mutex);
-        return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
+        return (nTodo == 0 && nQueued == 0 && fAllOk == true);
     }
 };
 
@@ -177,13 +250,17 @@ private:
 public:
     CCheckQueueControl(CCheckQueue<T>* pqueueIn) : pqueue(pqueueIn), fDone(false)
     {
-        // passed queue is supposed to be unused, or nullptr
+        // passed queue is supposed to be unused once the previous controller released it, or nullptr
         if (pqueue != nullptr) {
+            ENTER_CRITICAL_SECTION(pqueue->m_control_mutex);
             bool isIdle = pqueue->IsIdle();
             assert(isIdle);
         }
     }
 
+    CCheckQueueControl(const CCheckQueueControl&) = delete;
+    CCheckQueueControl& operator=(const CCheckQueueControl&) = delete;
+
     bool Wait()
     {
         if (pqueue == nullptr)
@@ -203,6 +280,9 @@ public:
     {
         if (!fDone)
             Wait();
+        if (pqueue != nullptr) {
+            LEAVE_CRITICAL_SECTION(pqueue->m_control_mutex);
+        }
     }
 };
 
@@ -12,6 +12,8 @@
 #include "version.h"
 
 #include <assert.h>
+#include <atomic>
+#include <future>
 
 bool CCoinsView::GetCoin(const COutPoint& outpoint, Coin& coin) const { return false; }
 bool CCoinsView::HaveCoin(const COutPoint& outpoint) const { return false; }
@@ -23,7 +25,8 @@ bool CCoinsView::BatchWrite(CCoinsMap& mapCoins,
                             const uint256& hashBlock,
                             const uint256& hashSaplingAnchor,
                             CAnchorsSaplingMap& mapSaplingAnchors,
-                            CNullifiersMap& mapSaplingNullifiers) { return false; }
+                            CNullifiersMap& mapSaplingNullifiers,
+                            bool erase) { return false; }
 
 // Sapling
 bool CCoinsView::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const { return false; }
@@ -43,8 +46,9 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap& mapCoins,
                                   const uint256& hashBlock,
                                   const uint256& hashSaplingAnchor,
                                   CAnchorsSaplingMap& mapSaplingAnchors,
-                                  CNullifiersMap& mapSaplingNullifiers)
-{ return base->BatchWrite(mapCoins, hashBlock, hashSaplingAnchor, mapSaplingAnchors, mapSaplingNullifiers); }
+                                  CNullifiersMap& mapSaplingNullifiers,
+                                  bool erase)
+{ return base->BatchWrite(mapCoins, hashBlock, hashSaplingAnchor, mapSaplingAnchors, mapSaplingNullifiers, erase); }
 
 // Sapling
 bool CCoinsViewBacked::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const { return base->GetSaplingAnchorAt(rt, tree); }
@@ -54,7 +58,12 @@ uint256 CCoinsViewBacked::GetBestAnchor() const { return base->GetBestAnchor();
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 SaltedIdHasher::SaltedIdHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) :
+    CCoinsViewBacked(baseIn),
+    cacheCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &m_cache_coins_memory_resource),
+    cachedCoinsUsage(0)
+{
+}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) +
@@ -66,8 +75,11 @@ size_t CCoinsViewCache::DynamicMemoryUsage() const {
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint& outpoint) const
 {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        nCacheHits++;
         return it;
+    }
+    nCacheMisses++;
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
@@ -93,8 +105,9 @@ bool CCoinsViewCache::GetCoin(const COutPoint& outpoint, Coin& coin) const
 
 void CCoinsViewCache::AddCoin(const COutPoint& outpoint, Coin&& coin, bool possible_overwrite) {
     assert(!coin.IsSpent());
-    if (coin.out.scriptPubKey.IsUnspendable()) return;
-    if (coin.out.IsZerocoinMint()) return;
+    const CScript scriptPubKey = coin.GetScriptPubKey();
+    if (scriptPubKey.IsUnspendable()) return;
+    if (scriptPubKey.IsZerocoinMint()) return;
     CCoinsMap::iterator it;
     bool inserted;
     std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
@@ -241,9 +254,10 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins,
                                  const uint256& hashBlockIn,
                                  const uint256 &hashSaplingAnchorIn,
                                  CAnchorsSaplingMap& mapSaplingAnchors,
-                                 CNullifiersMap& mapSaplingNullifiers)
+                                 CNullifiersMap& mapSaplingNullifiers,
+                                 bool erase)
 {
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it = mapCoins.erase(it)) {
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it = erase ? mapCoins.erase(it) : std::next(it)) {
         // Ignore non-dirty entries (optimization).
         if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
             continue;
@@ -256,7 +270,12 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins,
                 // Otherwise we will need to create it in the parent
                 // and move the data up and mark it as dirty
                 CCoinsCacheEntry& entry = cacheCoins[it->first];
-                entry.coin = std::move(it->second.coin);
+                // The child keeps its coin when not erased
+                if (erase) {
+                    entry.coin = std::move(it->second.coin);
+                } else {
+                    entry.coin = it->second.coin;
+                }
                 cachedCoinsUsage += memusage::DynamicUsage(entry.coin);
                 entry.flags = CCoinsCacheEntry::DIRTY;
                 // We can mark it FRESH in the parent if it was FRESH in the child
@@ -285,7 +304,11 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins,
             } else {
                 // A normal modification.
                 cachedCoinsUsage -= memusage::DynamicUsage(itUs->second.coin);
-                itUs->second.coin = std::move(it->second.coin);
+                if (erase) {
+                    itUs->second.coin = std::move(it->second.coin);
+                } else {
+                    itUs->second.coin = it->second.coin;
+                }
                 cachedCoinsUsage += memusage::DynamicUsage(itUs->second.coin);
                 itUs->second.flags |= CCoinsCacheEntry::DIRTY;
                 // NOTE: It is possible the child has a FRESH flag here in
@@ -314,12 +337,148 @@ bool CCoinsViewCache::Flush()
             cacheSaplingAnchors,
             cacheSaplingNullifiers);
     cacheCoins.clear();
+    ReallocateCache();
     cacheSaplingAnchors.clear();
     cacheSaplingNullifiers.clear();
     cachedCoinsUsage = 0;
+    nFlushes++;
+    return fOk;
+}
+
+bool CCoinsViewCache::Sync()
+{
+    bool fOk = base->BatchWrite(cacheCoins,
+            hashBlock,
+            hashSaplingAnchor,
+            cacheSaplingAnchors,
+            cacheSaplingNullifiers,
+            /* erase */ false);
+    // The base has the cache content now: the spent coins can go, the others are kept, not modified.
+    // The usage is recounted, as the sapling maps were consumed.
+    cachedCoinsUsage = 0;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (it->second.coin.IsSpent()) {
+            it = cacheCoins.erase(it);
+        } else {
+            it->second.flags = 0;
+            cachedCoinsUsage += memusage::DynamicUsage(it->second.coin);
+            ++it;
+        }
+    }
+    cacheSaplingAnchors.clear();
+    cacheSaplingNullifiers.clear();
+    nFlushes++;
     return fOk;
 }
 
+void CCoinsViewCache::ReallocateCache()
+{
+    // The pool keeps the chunks of the coins flushed until destroyed: recreate both, so that the
+    // memory of the cache goes back to the budget
+    assert(cacheCoins.empty());
+    cacheCoins.~CCoinsMap();
+    m_cache_coins_memory_resource.~CCoinsMapMemoryResource();
+    ::new (&m_cache_coins_memory_resource) CCoinsMapMemoryResource();
+    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &m_cache_coins_memory_resource);
+}
+
+void CCoinsPrefetch::Read(const CCoinsView& view, int nThreads)
+{
+    const size_t nTotal = vOutpoints.size() + vNullifiers.size();
+    vCoins.assign(vOutpoints.size(), Coin());
+    vFound.assign(nTotal, false);
+    if (nTotal == 0) return;
+
+    // The reads are taken in order by the threads, and the results gathered by index
+    std::atomic<size_t> nNext{0};
+    auto read = [&]() {
+        for (size_t i = nNext++; i < nTotal; i = nNext++) {
+            if (i < vOutpoints.size()) {
+                vFound[i] = view.GetCoin(vOutpoints[i], vCoins[i]);
+            } else {
+                vFound[i] = view.GetNullifier(vNullifiers[i - vOutpoints.size()]);
+            }
+        }
+    };
+    std::vector<std::future<void>> vWorkers;
+    for (int i = 1; i < std::min(nThreads, (int)nTotal); i++) {
+        vWorkers.emplace_back(std::async(std::launch::async, read));
+    }
+    read();
+    for (auto& worker : vWorkers) {
+        worker.get();
+    }
+}
+
+void CCoinsViewCache::PreparePrefetch(const std::vector<COutPoint>& vOutpoints, const std::vector<uint256>& vNullifiers, CCoinsPrefetch& prefetch) const
+{
+    prefetch.vOutpoints.clear();
+    for (const COutPoint& outpoint : vOutpoints) {
+        if (!cacheCoins.count(outpoint)) prefetch.vOutpoints.emplace_back(outpoint);
+    }
+    prefetch.vNullifiers.clear();
+    for (const uint256& nf : vNullifiers) {
+        if (!cacheSaplingNullifiers.count(nf)) prefetch.vNullifiers.emplace_back(nf);
+    }
+    prefetch.nCacheFlushes = nFlushes;
+}
+
+void CCoinsViewCache::InsertPrefetch(CCoinsPrefetch& prefetch)
+{
+    if (prefetch.nCacheFlushes != nFlushes || prefetch.vFound.size() != prefetch.vOutpoints.size() + prefetch.vNullifiers.size()) {
+        return;
+    }
+    // As inserted by FetchCoin and GetNullifier. The entries cached since the listing (e.g. modified by the
+    // blocks connected meanwhile) are the current ones.
+    for (size_t i = 0; i < prefetch.vOutpoints.size(); i++) {
+        if (!prefetch.vFound[i]) continue;
+        auto ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(prefetch.vOutpoints[i]), std::forward_as_tuple(std::move(prefetch.vCoins[i])));
+        if (!ret.second) continue;
+        if (ret.first->second.coin.IsSpent()) {
+            ret.first->second.flags = CCoinsCacheEntry::FRESH;
+        }
+        cachedCoinsUsage += memusage::DynamicUsage(ret.first->second.coin);
+    }
+    for (size_t i = 0; i < prefetch.vNullifiers.size(); i++) {
+        CNullifiersCacheEntry entry;
+        entry.entered = prefetch.vFound[prefetch.vOutpoints.size() + i];
+        cacheSaplingNullifiers.emplace(prefetch.vNullifiers[i], entry);
+    }
+}
+
+void CCoinsViewCache::Prefetch(const std::vector<COutPoint>& vOutpoints, const std::vector<uint256>& vNullifiers, int nThreads)
+{
+    CCoinsPrefetch prefetch;
+    PreparePrefetch(vOutpoints, vNullifiers, prefetch);
+    if (prefetch.empty()) return;
+    prefetch.Read(*base, nThreads);
+    InsertPrefetch(prefetch);
+}
+
+void CCoinsViewCache::ForEachDirtyCoin(const std::function<void(const COutPoint&, const Coin&, bool)>& func) const
+{
+    for (const auto& entry : cacheCoins) {
+        if (entry.second.flags & CCoinsCacheEntry::DIRTY) {
+            func(entry.first, entry.second.coin, entry.second.flags & CCoinsCacheEntry::FRESH);
+        }
+    }
+}
+
+CAmount CCoinsViewCache::GetDirtyValueDelta() const
+{
+    CAmount nDelta = 0;
+    for (const auto& entry : cacheCoins) {
+        if (!(entry.second.flags & CCoinsCacheEntry::DIRTY)) continue;
+        // A fresh coin is not in the base view, the others replace the one of the base (if not spent)
+        Coin coinOld;
+        if (!(entry.second.flags & CCoinsCacheEntry::FRESH) && base->GetCoin(entry.first, coinOld)) {
+            nDelta -= coinOld.nValue;
+        }
+        if (!entry.second.coin.IsSpent()) nDelta += entry.second.coin.nValue;
+    }
+    return nDelta;
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& outpoint)
 {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
@@ -344,7 +503,7 @@ CAmount CCoinsViewCache::GetValueIn(const CTransaction& tx) const
         if (in.IsZerocoinSpend() || in.IsZerocoinPublicSpend()) {
             nResult += in.nSequence * COIN;
         } else {
-            nResult += AccessCoin(in.prevout).out.nValue;
+            nResult += AccessCoin(in.prevout).nValue;
         }
     }
 
@@ -382,7 +541,7 @@ CAmount CCoinsViewCache::GetTotalAmount() const
     while (pcursor->Valid()) {
         Coin coin;
         if (pcursor->GetValue(coin) && !coin.IsSpent()) {
-            nTotal += coin.out.nValue;
+            nTotal += coin.nValue;
         }
         pcursor->Next();
     }
@@ -14,9 +14,11 @@
 #include "sapling/incrementalmerkletree.h"
 #include "script/standard.h"
 #include "serialize.h"
+#include "support/allocators/pool.h"
 #include "uint256.h"
 
 #include <assert.h>
+#include <functional>
 #include <stdint.h>
 
 #include <unordered_map>
@@ -31,31 +33,55 @@
 class Coin
 {
 public:
+    //! value of the unspent transaction output (-1 when spent)
+    CAmount nValue;
+
+    //! at which height the containing transaction was included in the active block chain
+    uint32_t nHeight;
+
     //! whether the containing transaction was a coinbase
-    bool fCoinBase;
+    bool fCoinBase : 1;
 
     //! whether the containing transaction was a coinstake
-    bool fCoinStake;
-
-    //! unspent transaction output
-    CTxOut out;
+    bool fCoinStake : 1;
 
-    //! at which height the containing transaction was included in the active block chain
-    uint32_t nHeight;
+private:
+    //! scriptPubKey of the unspent transaction output, compressed in memory
+    CCompressedScript script;
 
+public:
     //! construct a Coin from a CTxOut and height/coinbase properties.
-    Coin(CTxOut&& outIn, int nHeightIn, bool fCoinBaseIn, bool fCoinStakeIn) : fCoinBase(fCoinBaseIn), fCoinStake(fCoinStakeIn), out(std::move(outIn)), nHeight(nHeightIn) {}
-    Coin(const CTxOut& outIn, int nHeightIn, bool fCoinBaseIn, bool fCoinStakeIn) : fCoinBase(fCoinBaseIn), fCoinStake(fCoinStakeIn), out(outIn), nHeight(nHeightIn) {}
+    Coin(const CTxOut& outIn, int nHeightIn, bool fCoinBaseIn, bool fCoinStakeIn) : nValue(outIn.nValue), nHeight(nHeightIn), fCoinBase(fCoinBaseIn), fCoinStake(fCoinStakeIn), script(outIn.scriptPubKey) {}
 
     void Clear() {
-        out.SetNull();
+        nValue = -1;
+        nHeight = 0;
         fCoinBase = false;
         fCoinStake = false;
-        nHeight = 0;
+        script.clear();
     }
 
     //! empty constructor
-    Coin() : fCoinBase(false), fCoinStake(false), nHeight(0) { }
+    Coin() : nValue(-1), nHeight(0), fCoinBase(false), fCoinStake(false) { }
+
+    //! the scriptPubKey of the output, decompressed
+    CScript GetScriptPubKey() const {
+        return script.Get();
+    }
+
+    void SetScriptPubKey(const CScript& scriptPubKey) {
+        script.Set(scriptPubKey);
+    }
+
+    //! the unspent transaction output, decompressed
+    CTxOut GetTxOut() const {
+        return CTxOut(nValue, GetScriptPubKey());
+    }
+
+    void SetTxOut(const CTxOut& out) {
+        nValue = out.nValue;
+        script.Set(out.scriptPubKey);
+    }
 
     bool IsCoinBase() const {
         return fCoinBase;
@@ -70,7 +96,7 @@ public:
         assert(!IsSpent());
         uint32_t code = nHeight * 4 + (fCoinBase ? 2 : 0) + (fCoinStake ? 1 : 0);
         ::Serialize(s, VARINT(code));
-        ::Serialize(s, Using<TxOutCompression>(out));
+        ::Serialize(s, Using<TxOutCompression>(GetTxOut()));
     }
 
     template<typename Stream>
@@ -80,15 +106,17 @@ public:
         nHeight = code >> 2;
         fCoinBase = code & 2;
         fCoinStake = code & 1;
+        CTxOut out;
         ::Unserialize(s, Using<TxOutCompression>(out));
+        SetTxOut(out);
     }
 
     bool IsSpent() const {
-        return out.IsNull();
+        return nValue == -1;
     }
 
     size_t DynamicMemoryUsage() const {
-        return memusage::DynamicUsage(out.scriptPubKey);
+        return script.DynamicMemoryUsage();
     }
 };
 
@@ -174,7 +202,16 @@ struct CNullifiersCacheEntry
 typedef std::unordered_map<uint256, CAnchorsSaplingCacheEntry, SaltedIdHasher> CAnchorsSaplingMap;
 typedef std::unordered_map<uint256, CNullifiersCacheEntry, SaltedIdHasher> CNullifiersMap;
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The nodes of the map are allocated from a PoolResource: the nodes of the coins erased are reused by the next ones,
+ * and the memory is accounted for by chunk, as allocated.
+ * The blocks of the pool fit a node, with room for the pointers and the cached hash that the implementations add.
+ */
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>,
+                           PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                                         sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4>>
+    CCoinsMap;
+typedef CCoinsMap::allocator_type::ResourceType CCoinsMapMemoryResource;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -217,12 +254,14 @@ public:
     virtual std::vector<uint256> GetHeadBlocks() const;
 
     //! Do a bulk modification (multiple Coin changes + BestBlock change).
-    //! The passed mapCoins can be modified.
+    //! The passed mapCoins can be modified: its entries are consumed, unless erase is false.
+    //! The sapling maps are always consumed.
     virtual bool BatchWrite(CCoinsMap& mapCoins,
                             const uint256& hashBlock,
                             const uint256& hashSaplingAnchor,
                             CAnchorsSaplingMap& mapSaplingAnchors,
-                            CNullifiersMap& mapSaplingNullifiers);
+                            CNullifiersMap& mapSaplingNullifiers,
+                            bool erase = true);
 
     //! Get a cursor to iterate over the whole state
     virtual CCoinsViewCursor* Cursor() const;
@@ -265,7 +304,8 @@ public:
                     const uint256& hashBlock,
                     const uint256& hashSaplingAnchor,
                     CAnchorsSaplingMap& mapSaplingAnchors,
-                    CNullifiersMap& mapSaplingNullifiers) override;
+                    CNullifiersMap& mapSaplingNullifiers,
+                    bool erase = true) override;
 
     // Sapling
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const override;
@@ -278,6 +318,28 @@ public:
 static const unsigned int STANDARD_LOCKTIME_VERIFY_FLAGS = LOCKTIME_VERIFY_SEQUENCE |
                                                            LOCKTIME_MEDIAN_TIME_PAST;
 
+/**
+ * The coins and the sapling nullifiers missing from a CCoinsViewCache, read from the coins database
+ * without holding the lock of the cache, and inserted in it afterwards (see CCoinsViewCache::Prefetch).
+ */
+struct CCoinsPrefetch
+{
+    std::vector<COutPoint> vOutpoints;
+    std::vector<uint256> vNullifiers;
+    std::vector<Coin> vCoins;
+    std::vector<char> vFound;
+    //! Flushes of the cache when the missing entries were listed: the reads are stale after a flush
+    uint64_t nCacheFlushes{0};
+
+    bool empty() const { return vOutpoints.empty() && vNullifiers.empty(); }
+
+    /**
+     * Read the entries from the view by nThreads threads at once.
+     * The view must be safe to read from several threads: the coins database, not a cache.
+     */
+    void Read(const CCoinsView& view, int nThreads);
+};
+
 /** CCoinsView that adds a memory cache for transactions to another CCoinsView */
 class CCoinsViewCache : public CCoinsViewBacked
 {
@@ -287,6 +349,8 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
+    // Declared before cacheCoins, that allocates from it
+    mutable CCoinsMapMemoryResource m_cache_coins_memory_resource{};
     mutable CCoinsMap cacheCoins;
 
     // Sapling
@@ -297,6 +361,14 @@ protected:
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    /* Number of writes of the cache to its base (Flush and Sync) */
+    uint64_t nFlushes{0};
+
+    /* Coin lookups answered by the cache, and read from the base. The prefetches are not lookups:
+     * the coins they read are counted as hits when they are looked up. */
+    mutable uint64_t nCacheHits{0};
+    mutable uint64_t nCacheMisses{0};
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
@@ -337,7 +409,8 @@ public:
                     const uint256& hashBlock,
                     const uint256& hashSaplingAnchor,
                     CAnchorsSaplingMap& mapSaplingAnchors,
-                    CNullifiersMap& mapSaplingNullifiers) override;
+                    CNullifiersMap& mapSaplingNullifiers,
+                    bool erase = true) override;
 
     /**
      * Check if we have the given utxo already loaded in this cache.
@@ -373,6 +446,38 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push the modifications applied to this cache to its base, like Flush, but keep the coins unspent in the
+     * cache, as not modified: the next blocks find their inputs in memory.
+     * The spent coins are dropped, as well as the sapling anchors and nullifiers.
+     * If false is returned, the state of this cache (and its backing view) will be undefined.
+     */
+    bool Sync();
+
+    /**
+     * Load in the cache the coins and the sapling nullifiers given, not cached yet, read from the base by nThreads
+     * threads at once, so that their lookups are served from memory afterwards.
+     * The base must be safe to read from several threads: the coins database, not a cache.
+     */
+    void Prefetch(const std::vector<COutPoint>& vOutpoints, const std::vector<uint256>& vNullifiers, int nThreads);
+
+    /**
+     * The same in three steps, so that the reads don't hold the lock of the cache: list the entries not cached,
+     * read them from the coins database with CCoinsPrefetch::Read, then insert them. Nothing is inserted if the
+     * cache was written to its base in the meantime, as the database may have changed since the reads.
+     */
+    void PreparePrefetch(const std::vector<COutPoint>& vOutpoints, const std::vector<uint256>& vNullifiers, CCoinsPrefetch& prefetch) const;
+    void InsertPrefetch(CCoinsPrefetch& prefetch);
+
+    /**
+     * Call func for each coin modified in this cache and not flushed yet, spent or not, with whether the base
+     * doesn't have it (fresh).
+     */
+    void ForEachDirtyCoin(const std::function<void(const COutPoint&, const Coin&, bool)>& func) const;
+
+    //! The change of the value of the unspent coins that Flush would make to the base view
+    CAmount GetDirtyValueDelta() const;
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is not modified.
      */
@@ -384,6 +489,9 @@ public:
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    //! Number of coin lookups answered by the cache, and read from the base view, since the cache was created
+    void GetCacheStats(uint64_t& nHitsRet, uint64_t& nMissesRet) const { nHitsRet = nCacheHits; nMissesRet = nCacheMisses; }
+
     /**
      * Amount of pivx coming in to a transaction
      * Note that lightweight clients may not know anything besides the hash of previous transactions,
@@ -416,6 +524,9 @@ public:
 private:
     CCoinsMap::iterator FetchCoin(const COutPoint& outpoint) const;
 
+    //! Releases the memory of the empty cacheCoins, its pool and buckets
+    void ReallocateCache();
+
     //! Generalized interface for popping anchors
     template<typename Tree, typename Cache, typename CacheEntry>
     void AbstractPopAnchor(
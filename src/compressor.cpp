@@ -80,6 +80,48 @@ bool CompressScript(const CScript& script, std::vector<unsigned char> &out)
     return false;
 }
 
+void CCompressedScript::Set(const CScript& script)
+{
+    vch.clear();
+    if (script.IsPayToColdStaking()) {
+        // OP_DUP OP_HASH160 OP_ROT OP_IF <opcode> 20 <staker> OP_ELSE 20 <owner> OP_ENDIF OP_EQUALVERIFY OP_CHECKSIG
+        nType = script[4] == OP_CHECKCOLDSTAKEVERIFY_LOF ? P2CS_LOF : P2CS;
+        vch.insert(vch.end(), script.data() + 6, script.data() + 26);
+        vch.insert(vch.end(), script.data() + 28, script.data() + 48);
+        return;
+    }
+    nType = RAW;
+    if (script.size() > MAX_SCRIPT_SIZE) {
+        vch.push_back(OP_RETURN);
+    } else {
+        vch.insert(vch.end(), script.data(), script.data() + script.size());
+    }
+}
+
+CScript CCompressedScript::Get() const
+{
+    CScript script;
+    if (nType == RAW) {
+        script.insert(script.end(), vch.data(), vch.data() + vch.size());
+        return script;
+    }
+    script.resize(51);
+    script[0] = OP_DUP;
+    script[1] = OP_HASH160;
+    script[2] = OP_ROT;
+    script[3] = OP_IF;
+    script[4] = nType == P2CS_LOF ? OP_CHECKCOLDSTAKEVERIFY_LOF : OP_CHECKCOLDSTAKEVERIFY;
+    script[5] = 20;
+    memcpy(&script[6], vch.data(), 20);
+    script[26] = OP_ELSE;
+    script[27] = 20;
+    memcpy(&script[28], vch.data() + 20, 20);
+    script[48] = OP_ENDIF;
+    script[49] = OP_EQUALVERIFY;
+    script[50] = OP_CHECKSIG;
+    return script;
+}
+
 unsigned int GetSpecialScriptSize(unsigned int nSize)
 {
     if (nSize == 0 || nSize == 1)
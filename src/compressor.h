@@ -7,6 +7,7 @@
 #ifndef BITCOIN_COMPRESSOR_H
 #define BITCOIN_COMPRESSOR_H
 
+#include "memusage.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
 #include "serialize.h"
@@ -88,6 +89,48 @@ struct AmountCompression
     }
 };
 
+/**
+ * A scriptPubKey, as kept in memory by the coins.
+ *
+ * The P2CS scripts (51 bytes) are stored as the 40 bytes of their staker and owner key ids,
+ * so that the scripts of all the common templates (P2PKH, P2SH, P2PK with a compressed key
+ * and P2CS) are held inline, without a heap allocation. The other scripts are stored as they
+ * are, on the heap above 40 bytes, and the overly long ones (unspendable) as a short invalid
+ * one, as ScriptCompression does.
+ */
+class CCompressedScript
+{
+public:
+    //! the most bytes held inline
+    static const unsigned int INLINE_SIZE = 40;
+
+    CCompressedScript() = default;
+    explicit CCompressedScript(const CScript& script) { Set(script); }
+
+    void Set(const CScript& script);
+    //! the decompressed script
+    CScript Get() const;
+
+    void clear()
+    {
+        vch.clear();
+        nType = RAW;
+    }
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(vch); }
+
+private:
+    enum Type : uint8_t {
+        RAW = 0,
+        P2CS,
+        P2CS_LOF,
+    };
+
+    // 16 bits sizes are enough for MAX_SCRIPT_SIZE, and keep the coins in 56 bytes
+    prevector<INLINE_SIZE, unsigned char, uint16_t, int16_t> vch;
+    uint8_t nType{RAW};
+};
+
 /** wrapper for CTxOut that provides a more compact serialization */
 struct TxOutCompression
 {
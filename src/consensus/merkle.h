@@ -12,7 +12,12 @@
 #include "primitives/block.h"
 #include "uint256.h"
 
-uint256 ComputeMerkleRoot(const std::vector<uint256>& leaves, bool* mutated = nullptr);
+uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool* mutated = nullptr);
+/*
+ * Compute every level of the merkle tree of the given leaves: levels[0] are the leaves,
+ * levels.back() holds the root alone (no levels when there are no leaves).
+ */
+std::vector<std::vector<uint256>> ComputeMerkleLevels(std::vector<uint256> leaves);
 std::vector<uint256> ComputeMerkleBranch(const std::vector<uint256>& leaves, uint32_t position);
 uint256 ComputeMerkleRootFromBranch(const uint256& leaf, const std::vector<uint256>& branch, uint32_t position);
 
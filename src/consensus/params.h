@@ -170,6 +170,8 @@ struct LLMQParams {
  */
 struct Params {
     uint256 hashGenesisBlock;
+    //! By default the scripts and the Sapling proofs of this block and its ancestors are not verified (see -assumevalid)
+    uint256 defaultAssumeValid;
     bool fPowAllowMinDifficultyBlocks;
     bool fPowNoRetargeting;
     uint256 powLimit;
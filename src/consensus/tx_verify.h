@@ -21,7 +21,9 @@ class CValidationState;
 /** Context-independent validity checks */
 bool CheckTransaction(const CTransaction& tx, CValidationState& state, bool fColdStakingActive);
 /** Context-dependent validity checks */
-bool ContextualCheckTransaction(const CTransactionRef& tx, CValidationState& state, const CChainParams& chainparams, int nHeight, bool isMined, bool fIBD);
+// If fCheckSaplingProofs is false, the Sapling proofs must be verified by the caller
+bool ContextualCheckTransaction(const CTransactionRef& tx, CValidationState& state, const CChainParams& chainparams, int nHeight, bool isMined, bool fIBD,
+                                bool fCheckSaplingProofs = true);
 
 /**
  * Count ECDSA signature operations the old-fashioned (pre-0.6) way
@@ -6,6 +6,7 @@
 
 #include "chainparams.h"
 #include "consensus/consensus.h"
+#include "index/txindex.h"
 #include "invalid.h"
 #include "script/interpreter.h"
 #include "txdb.h" // for zerocoinDb
@@ -183,18 +184,16 @@ bool ContextualCheckZerocoinTx(const CTransactionRef& tx, CValidationState& stat
     return true;
 }
 
-bool IsSerialInBlockchain(const CBigNum& bnSerial, int& nHeightTx)
+// The height of the block of the spend txHash of the serial hashSerial, if it is in the active chain.
+// The block is recorded with the serial, only the records of the older versions need the transaction index.
+static bool GetSpendHeight(const uint256& hashSerial, const uint256& txHash, int& nHeightTx)
 {
-    uint256 txHash;
-    // if not in zerocoinDB then its not in the blockchain
-    if (!zerocoinDB->ReadCoinSpend(bnSerial, txHash))
-        return false;
-
-    // Now get the chain tx
-    CTransactionRef tx;
     uint256 hashBlock;
-    if (!GetTransaction(txHash, tx, hashBlock, true))
-        return false;
+    if (!zerocoinDB->ReadCoinSpendBlock(hashSerial, hashBlock)) {
+        CTransactionRef tx;
+        if (!GetTransaction(txHash, tx, hashBlock, true))
+            return false;
+    }
 
     if (hashBlock.IsNull() || !mapBlockIndex.count(hashBlock)) {
         return false;
@@ -209,6 +208,81 @@ bool IsSerialInBlockchain(const CBigNum& bnSerial, int& nHeightTx)
     return true;
 }
 
+bool IsSerialInBlockchain(const CBigNum& bnSerial, int& nHeightTx)
+{
+    // The frozen index holds all the spends (of the chain it was built with): the ones at a height not reached yet
+    // are not in the blockchain
+    if (frozenSerials && (chainActive.Height() < frozenSerials->GetHeightEnd() ||
+                          chainActive[frozenSerials->GetHeightEnd()]->GetBlockHash() == frozenSerials->GetBlockEnd())) {
+        Optional<int> nHeightSpend = frozenSerials->Lookup(bnSerial);
+        if (!nHeightSpend || *nHeightSpend > chainActive.Height()) {
+            return false;
+        }
+        nHeightTx = *nHeightSpend;
+        return true;
+    }
+
+    uint256 txHash;
+    // if not in zerocoinDB then its not in the blockchain
+    if (!zerocoinDB->ReadCoinSpend(bnSerial, txHash))
+        return false;
+
+    // Now get the block of the spend
+    return GetSpendHeight(CZerocoinDB::GetSerialHash(bnSerial), txHash, nHeightTx);
+}
+
+bool LoadFrozenSerialIndex()
+{
+    // The spend records of the older versions have no block: the transaction index must have caught up with the chain
+    const bool fTxIndexSynced = g_txindex && g_txindex->BlockUntilSyncedToCurrentChain();
+
+    LOCK(cs_main);
+    const fs::path path = GetDataDir() / "zerocoin_serials.dat";
+    frozenSerials.reset();
+
+    std::unique_ptr<CFrozenSerialIndex> index(new CFrozenSerialIndex());
+    if (fs::exists(path)) {
+        if (index->Read(path)) {
+            LogPrintf("%s: loaded %d zPIV spends up to block %d\n", __func__, index->size(), index->GetHeightEnd());
+            frozenSerials = std::move(index);
+            return true;
+        }
+        // A truncated or corrupted file is rebuilt (overwritten), the lookups go to the DB meanwhile
+        LogPrintf("%s: %s is invalid, rebuilding it\n", __func__, path.string());
+    }
+
+    // Build the index once the last block accepting the spends can no longer be reorganized
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const int nHeightEnd = consensus.vUpgrades[Consensus::UPGRADE_V5_0].nActivationHeight;
+    if (fReindex || !fTxIndexSynced || nHeightEnd <= 0 ||
+        chainActive.Height() < nHeightEnd + gArgs.GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH)) {
+        return true;
+    }
+    LogPrintf("%s: building the index of the zPIV spends...\n", __func__);
+    std::vector<std::pair<uint256, uint256>> vSpendTxes;
+    if (!zerocoinDB->ReadAllCoinSpends(vSpendTxes)) {
+        return false;
+    }
+    std::vector<std::pair<uint256, int>> vSpends;
+    vSpends.reserve(vSpendTxes.size());
+    for (const auto& spend : vSpendTxes) {
+        int nHeightTx = 0;
+        if (!GetSpendHeight(spend.first, spend.second, nHeightTx)) {
+            // The serial records must all be of the active chain, leave the lookups to the DB
+            LogPrintf("%s: spend tx %s not found in the active chain, not building the index\n", __func__, spend.second.ToString());
+            return true;
+        }
+        vSpends.emplace_back(spend.first, nHeightTx);
+    }
+    index.reset(new CFrozenSerialIndex(chainActive[nHeightEnd]->GetBlockHash(), nHeightEnd, std::move(vSpends)));
+    if (!index->Write(path)) {
+        return false;
+    }
+    LogPrintf("%s: wrote %d zPIV spends to %s\n", __func__, index->size(), path.string());
+    frozenSerials = std::move(index);
+    return true;
+}
+
 bool ContextualCheckZerocoinSpend(const CTransaction& tx, const libzerocoin::CoinSpend* spend, int nHeight)
 {
     if(!ContextualCheckZerocoinSpendNoSerialCheck(tx, spend, nHeight)){
@@ -28,6 +28,13 @@ bool ContextualCheckZerocoinSpendNoSerialCheck(const CTransaction& tx, const lib
 
 bool IsSerialInBlockchain(const CBigNum& bnSerial, int& nHeightTx);
 
+/**
+ * Set frozenSerials from zerocoin_serials.dat, or build it from the zerocoin DB and write it if the v5.0 upgrade
+ * (after which the zPIV spends are rejected) is buried in the active chain and the transaction index is synced.
+ * Returns false only on I/O failures.
+ */
+bool LoadFrozenSerialIndex();
+
 // Returns false if coin spend is invalid. Invalidity/DoS causes are treated inside the function.
 bool ParseAndValidateZerocoinSpends(const Consensus::Params& consensus,
                                     const CTransaction& tx, int chainHeight,
@@ -120,6 +120,13 @@ std::string EncodeHexTx(const CTransaction& tx)
     return HexStr(ssTx);
 }
 
+// UniValue::setInt goes through a std::ostringstream, too slow for the fields of every
+// input and output of the large RPC replies
+static UniValue IntValue(int64_t n)
+{
+    return UniValue(UniValue::VNUM, std::to_string(n));
+}
+
 void ScriptPubKeyToUniv(const CScript& scriptPubKey,
     UniValue& out,
     bool fIncludeHex)
@@ -141,7 +148,7 @@ void ScriptPubKeyToUniv(const CScript& scriptPubKey,
         return;
     }
 
-    out.pushKV("reqSigs", nRequired);
+    out.pushKV("reqSigs", IntValue(nRequired));
     out.pushKV("type", GetTxnOutputType(type));
 
     UniValue a(UniValue::VARR);
@@ -165,11 +172,15 @@ static void SpecialTxToJSON(const CTransaction& tx, UniValue& entry)
 
 void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry)
 {
+    // Serialized once, for the size and the hex
+    CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+    ssTx << tx;
+
     entry.pushKV("txid", tx.GetHash().GetHex());
-    entry.pushKV("version", tx.nVersion);
-    entry.pushKV("type", tx.nType);
-    entry.pushKV("size", (int)::GetSerializeSize(tx, PROTOCOL_VERSION));
-    entry.pushKV("locktime", (int64_t)tx.nLockTime);
+    entry.pushKV("version", IntValue(tx.nVersion));
+    entry.pushKV("type", IntValue(tx.nType));
+    entry.pushKV("size", IntValue(ssTx.size()));
+    entry.pushKV("locktime", IntValue(tx.nLockTime));
 
     UniValue vin(UniValue::VARR);
     for (const CTxIn& txin : tx.vin) {
@@ -178,13 +189,13 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry)
             in.pushKV("coinbase", HexStr(txin.scriptSig));
         else {
             in.pushKV("txid", txin.prevout.hash.GetHex());
-            in.pushKV("vout", (int64_t)txin.prevout.n);
+            in.pushKV("vout", IntValue(txin.prevout.n));
             UniValue o(UniValue::VOBJ);
             o.pushKV("asm", ScriptToAsmStr(txin.scriptSig, true));
             o.pushKV("hex", HexStr(txin.scriptSig));
             in.pushKV("scriptSig", o);
         }
-        in.pushKV("sequence", (int64_t)txin.nSequence);
+        in.pushKV("sequence", IntValue(txin.nSequence));
         vin.push_back(in);
     }
     entry.pushKV("vin", vin);
@@ -197,7 +208,7 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry)
 
         UniValue outValue(UniValue::VNUM, FormatMoney(txout.nValue));
         out.pushKV("value", outValue);
-        out.pushKV("n", (int64_t)i);
+        out.pushKV("n", IntValue(i));
 
         UniValue o(UniValue::VOBJ);
         ScriptPubKeyToUniv(txout.scriptPubKey, o, true);
@@ -215,5 +226,5 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry)
     if (!hashBlock.IsNull())
         entry.pushKV("blockhash", hashBlock.GetHex());
 
-    entry.pushKV("hex", EncodeHexTx(tx)); // the hex-encoded transaction. used the name "hex" to be consistent with the verbose output of "getrawtransaction".
+    entry.pushKV("hex", HexStr(ssTx)); // the hex-encoded transaction. used the name "hex" to be consistent with the verbose output of "getrawtransaction".
 }
@@ -0,0 +1,56 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// 8-way double-SHA256 of 64-byte inputs, with AVX2 intrinsics.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+#include "crypto/sha256_multiway.h"
+
+namespace sha256_avx2
+{
+namespace
+{
+struct Ops {
+    typedef __m256i V;
+    static inline V Set1(uint32_t x) { return _mm256_set1_epi32(x); }
+    static inline V Add(V x, V y) { return _mm256_add_epi32(x, y); }
+    static inline V Xor(V x, V y) { return _mm256_xor_si256(x, y); }
+    static inline V Or(V x, V y) { return _mm256_or_si256(x, y); }
+    static inline V And(V x, V y) { return _mm256_and_si256(x, y); }
+    template <int n> static inline V ShR(V x) { return _mm256_srli_epi32(x, n); }
+    template <int n> static inline V ShL(V x) { return _mm256_slli_epi32(x, n); }
+
+    static inline V Load(const unsigned char* in, int i)
+    {
+        return _mm256_set_epi32(ReadBE32(in + 448 + 4 * i), ReadBE32(in + 384 + 4 * i), ReadBE32(in + 320 + 4 * i), ReadBE32(in + 256 + 4 * i),
+                                ReadBE32(in + 192 + 4 * i), ReadBE32(in + 128 + 4 * i), ReadBE32(in + 64 + 4 * i), ReadBE32(in + 4 * i));
+    }
+
+    static inline void Store(unsigned char* out, int i, V v)
+    {
+        WriteBE32(out + 4 * i, _mm256_extract_epi32(v, 0));
+        WriteBE32(out + 32 + 4 * i, _mm256_extract_epi32(v, 1));
+        WriteBE32(out + 64 + 4 * i, _mm256_extract_epi32(v, 2));
+        WriteBE32(out + 96 + 4 * i, _mm256_extract_epi32(v, 3));
+        WriteBE32(out + 128 + 4 * i, _mm256_extract_epi32(v, 4));
+        WriteBE32(out + 160 + 4 * i, _mm256_extract_epi32(v, 5));
+        WriteBE32(out + 192 + 4 * i, _mm256_extract_epi32(v, 6));
+        WriteBE32(out + 224 + 4 * i, _mm256_extract_epi32(v, 7));
+    }
+};
+} // namespace
+
+void TransformD64_8way(unsigned char* out, const unsigned char* in)
+{
+    sha256_multiway::TransformD64<Ops>(out, in);
+}
+
+} // namespace sha256_avx2
+
+#endif // ENABLE_AVX2
@@ -0,0 +1,110 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_CRYPTO_SHA256_MULTIWAY_H
+#define PIVX_CRYPTO_SHA256_MULTIWAY_H
+
+#include <stdint.h>
+
+/**
+ * Double-SHA256 of N independent 64-byte inputs at once (N being the number of lanes of Ops::V), each lane of the vectors holding
+ * one word of one of the hashes. Only included by the translation units compiled with the
+ * matching instruction set (see sha256_sse41.cpp and sha256_avx2.cpp).
+ *
+ * Ops provides the vector type V and:
+ * - Set1(x): x in every lane
+ * - Add, Xor, Or, And: lane-wise operations
+ * - ShR<n>, ShL<n>: lane-wise shifts
+ * - Load(in, i): the i-th big endian word of each of the N inputs (64 bytes apart)
+ * - Store(out, i, v): the i-th big endian word of each of the N outputs (32 bytes apart)
+ */
+namespace sha256_multiway
+{
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint32_t INIT[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+template <typename Ops, int n>
+inline typename Ops::V Rot(typename Ops::V x) { return Ops::Or(Ops::template ShR<n>(x), Ops::template ShL<32 - n>(x)); }
+
+template <typename Ops>
+inline typename Ops::V Ch(typename Ops::V x, typename Ops::V y, typename Ops::V z) { return Ops::Xor(z, Ops::And(x, Ops::Xor(y, z))); }
+template <typename Ops>
+inline typename Ops::V Maj(typename Ops::V x, typename Ops::V y, typename Ops::V z) { return Ops::Or(Ops::And(x, y), Ops::And(z, Ops::Or(x, y))); }
+template <typename Ops>
+inline typename Ops::V Sigma0(typename Ops::V x) { return Ops::Xor(Ops::Xor(Rot<Ops, 2>(x), Rot<Ops, 13>(x)), Rot<Ops, 22>(x)); }
+template <typename Ops>
+inline typename Ops::V Sigma1(typename Ops::V x) { return Ops::Xor(Ops::Xor(Rot<Ops, 6>(x), Rot<Ops, 11>(x)), Rot<Ops, 25>(x)); }
+template <typename Ops>
+inline typename Ops::V sigma0(typename Ops::V x) { return Ops::Xor(Ops::Xor(Rot<Ops, 7>(x), Rot<Ops, 18>(x)), Ops::template ShR<3>(x)); }
+template <typename Ops>
+inline typename Ops::V sigma1(typename Ops::V x) { return Ops::Xor(Ops::Xor(Rot<Ops, 17>(x), Rot<Ops, 19>(x)), Ops::template ShR<10>(x)); }
+
+/** One SHA-256 transformation of the N states s, with the message words w (overwritten by the schedule). */
+template <typename Ops>
+inline void Transform(typename Ops::V* s, typename Ops::V* w)
+{
+    typedef typename Ops::V V;
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; i++) {
+        if (i >= 16) {
+            w[i & 15] = Ops::Add(Ops::Add(sigma1<Ops>(w[(i + 14) & 15]), w[(i + 9) & 15]),
+                                 Ops::Add(sigma0<Ops>(w[(i + 1) & 15]), w[i & 15]));
+        }
+        const V t1 = Ops::Add(Ops::Add(h, Sigma1<Ops>(e)), Ops::Add(Ch<Ops>(e, f, g), Ops::Add(Ops::Set1(K[i]), w[i & 15])));
+        const V t2 = Ops::Add(Sigma0<Ops>(a), Maj<Ops>(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = Ops::Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Ops::Add(t1, t2);
+    }
+    s[0] = Ops::Add(s[0], a);
+    s[1] = Ops::Add(s[1], b);
+    s[2] = Ops::Add(s[2], c);
+    s[3] = Ops::Add(s[3], d);
+    s[4] = Ops::Add(s[4], e);
+    s[5] = Ops::Add(s[5], f);
+    s[6] = Ops::Add(s[6], g);
+    s[7] = Ops::Add(s[7], h);
+}
+
+/** Double-SHA256 of N 64-byte inputs, written to N 32-byte outputs. All the inputs are read before the first write. */
+template <typename Ops>
+void TransformD64(unsigned char* out, const unsigned char* in)
+{
+    typedef typename Ops::V V;
+    V s[8], w[16];
+
+    // First hash: the 64-byte message, then its padding block
+    for (int i = 0; i < 8; i++) s[i] = Ops::Set1(INIT[i]);
+    for (int i = 0; i < 16; i++) w[i] = Ops::Load(in, i);
+    Transform<Ops>(s, w);
+    for (int i = 0; i < 16; i++) w[i] = Ops::Set1(i == 0 ? 0x80000000 : (i == 15 ? 0x200 : 0));
+    Transform<Ops>(s, w);
+
+    // Second hash: the 32-byte first hash and its padding
+    for (int i = 0; i < 8; i++) w[i] = s[i];
+    for (int i = 8; i < 16; i++) w[i] = Ops::Set1(i == 8 ? 0x80000000 : (i == 15 ? 0x100 : 0));
+    for (int i = 0; i < 8; i++) s[i] = Ops::Set1(INIT[i]);
+    Transform<Ops>(s, w);
+
+    for (int i = 0; i < 8; i++) Ops::Store(out, i, s[i]);
+}
+
+} // namespace sha256_multiway
+
+#endif // PIVX_CRYPTO_SHA256_MULTIWAY_H
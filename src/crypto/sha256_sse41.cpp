@@ -0,0 +1,51 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// 4-way double-SHA256 of 64-byte inputs, with SSE4.1 intrinsics.
+
+#ifdef ENABLE_SSE41
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+#include "crypto/sha256_multiway.h"
+
+namespace sha256_sse41
+{
+namespace
+{
+struct Ops {
+    typedef __m128i V;
+    static inline V Set1(uint32_t x) { return _mm_set1_epi32(x); }
+    static inline V Add(V x, V y) { return _mm_add_epi32(x, y); }
+    static inline V Xor(V x, V y) { return _mm_xor_si128(x, y); }
+    static inline V Or(V x, V y) { return _mm_or_si128(x, y); }
+    static inline V And(V x, V y) { return _mm_and_si128(x, y); }
+    template <int n> static inline V ShR(V x) { return _mm_srli_epi32(x, n); }
+    template <int n> static inline V ShL(V x) { return _mm_slli_epi32(x, n); }
+
+    static inline V Load(const unsigned char* in, int i)
+    {
+        return _mm_set_epi32(ReadBE32(in + 192 + 4 * i), ReadBE32(in + 128 + 4 * i), ReadBE32(in + 64 + 4 * i), ReadBE32(in + 4 * i));
+    }
+
+    static inline void Store(unsigned char* out, int i, V v)
+    {
+        WriteBE32(out + 4 * i, _mm_extract_epi32(v, 0));
+        WriteBE32(out + 32 + 4 * i, _mm_extract_epi32(v, 1));
+        WriteBE32(out + 64 + 4 * i, _mm_extract_epi32(v, 2));
+        WriteBE32(out + 96 + 4 * i, _mm_extract_epi32(v, 3));
+    }
+};
+} // namespace
+
+void TransformD64_4way(unsigned char* out, const unsigned char* in)
+{
+    sha256_multiway::TransformD64<Ops>(out, in);
+}
+
+} // namespace sha256_sse41
+
+#endif // ENABLE_SSE41
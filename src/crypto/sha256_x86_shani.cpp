@@ -0,0 +1,92 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// SHA-256 transformation with the x86 SHA extensions (SHA-NI).
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace
+{
+const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+/** Four rounds: the two rounds of each sha256rnds2 take the low two words of the message plus constants. */
+inline void QuadRound(__m128i& abef, __m128i& cdgh, __m128i msg, int i)
+{
+    msg = _mm_add_epi32(msg, _mm_load_si128((const __m128i*)(K + 4 * i)));
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0e));
+}
+
+/** From the A B C D / E F G H state words to the ABEF / CDGH layout of the SHA instructions. */
+inline void Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+inline void Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+} // namespace
+
+namespace sha256_x86_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i abef = _mm_loadu_si128((const __m128i*)s);
+    __m128i cdgh = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(abef, cdgh);
+
+    while (blocks--) {
+        const __m128i abef_save = abef;
+        const __m128i cdgh_save = cdgh;
+
+        // m[j] holds the message words of the rounds 4 * i to 4 * i + 3, with i = j (mod 4)
+        __m128i m[4];
+        for (int j = 0; j < 4; j++) {
+            m[j] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 16 * j)), MASK);
+        }
+        for (int i = 0; i < 16; i++) {
+            __m128i& cur = m[i & 3];
+            QuadRound(abef, cdgh, cur, i);
+            if (i < 12) {
+                // W[t] = sigma1(W[t-2]) + W[t-7] + sigma0(W[t-15]) + W[t-16], for the rounds 4 * (i + 4) to 4 * (i + 4) + 3
+                const __m128i& next = m[(i + 1) & 3];
+                const __m128i& prev2 = m[(i + 2) & 3];
+                const __m128i& prev1 = m[(i + 3) & 3];
+                cur = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(cur, next), _mm_alignr_epi8(prev1, prev2, 4)), prev1);
+            }
+        }
+
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+        chunk += 64;
+    }
+
+    Unshuffle(abef, cdgh);
+    _mm_storeu_si128((__m128i*)s, abef);
+    _mm_storeu_si128((__m128i*)(s + 4), cdgh);
+}
+} // namespace sha256_x86_shani
+
+#endif // ENABLE_SHANI
@@ -4,12 +4,21 @@
 
 #include "dbwrapper.h"
 
+#include "compat/cpuid.h"
+
+#include <atomic>
+#include <set>
+
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
 #include <leveldb/filter_policy.h>
 #include <memenv.h>
 #include <stdint.h>
 
+#if defined(ENABLE_ARM_CRC) && defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
 
 static void SetMaxOpenFiles(leveldb::Options *options) {
     // On most platforms the default setting of max_open_files (which is 1000)
@@ -36,13 +45,21 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static Mutex cs_dbwrappers;
+static std::set<CDBWrapper*> setDBWrappers GUARDED_BY(cs_dbwrappers);
+
+static std::atomic<bool> g_verify_scans{true};
+static std::atomic<int> g_verify_scans_scopes{0};
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBOptions& dbOptions, size_t& nBlockCacheSize)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    nBlockCacheSize = nCacheSize * dbOptions.nBlockCachePercent / 100;
+    options.block_cache = leveldb::NewLRUCache(nBlockCacheSize);
+    options.write_buffer_size = (nCacheSize - nBlockCacheSize) / 2; // up to two write buffers may be held in memory simultaneously
+    options.block_size = dbOptions.nBlockSize;
+    options.filter_policy = leveldb::NewBloomFilterPolicy(dbOptions.nBloomBits);
+    options.compression = dbOptions.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -52,14 +69,15 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, int nVersion)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, int nVersion, const CDBOptions& _dbOptions) :
+    dbOptions(_dbOptions)
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, dbOptions, nBlockCacheSize);
     options.create_if_missing = true;
     this->nVersion = nVersion;
     if (fMemory) {
@@ -77,10 +95,15 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+    LogPrint(BCLog::LEVELDB, "LevelDB %s using block_cache=%u write_buffer=%u block_size=%u bloom_bits=%d compression=%u\n",
+             dbOptions.strName, nBlockCacheSize, options.write_buffer_size, options.block_size,
+             dbOptions.nBloomBits, dbOptions.fCompression);
+    WITH_LOCK(cs_dbwrappers, setDBWrappers.insert(this));
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    WITH_LOCK(cs_dbwrappers, setDBWrappers.erase(this));
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -98,6 +121,140 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     return true;
 }
 
+size_t CDBWrapper::DynamicMemoryUsage() const
+{
+    std::string memory;
+    if (!pdb->GetProperty("leveldb.approximate-memory-usage", &memory)) {
+        LogPrint(BCLog::LEVELDB, "Failed to get approximate-memory-usage property\n");
+        return 0;
+    }
+    return std::stoul(memory);
+}
+
+void ForEachDBWrapper(const std::function<void(CDBWrapper&)>& fn)
+{
+    LOCK(cs_dbwrappers);
+    for (CDBWrapper* pdbwrapper : setDBWrappers) {
+        fn(*pdbwrapper);
+    }
+}
+
+CDBIterator* CDBWrapper::NewIterator()
+{
+    leveldb::ReadOptions options = iteroptions;
+    options.verify_checksums = g_verify_scans || g_verify_scans_scopes > 0;
+    return new CDBIterator(pdb->NewIterator(options), nVersion);
+}
+
+// The checks of the crc32c library, which LevelDB is built with: its accelerated paths are compiled
+// along with the intrinsics, and used if the CPU has the instructions
+std::string GetCRC32CImplementation()
+{
+#if defined(ENABLE_SSE42) && defined(HAVE_GETCPUID) && (defined(__x86_64__) || defined(__amd64__))
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    if ((ecx >> 20) & 1) return "sse4.2";
+#elif defined(ENABLE_ARM_CRC) && defined(__aarch64__) && defined(__linux__)
+    // HWCAP_PMULL | HWCAP_CRC32
+    const unsigned long hwcap = getauxval(AT_HWCAP);
+    if ((hwcap & ((1 << 4) | (1 << 7))) == ((1 << 4) | (1 << 7))) return "arm64 crc32";
+#elif defined(ENABLE_ARM_CRC) && defined(__aarch64__) && defined(__APPLE__)
+    return "arm64 crc32";
+#endif
+    return "portable";
+}
+
+void SetDBVerifyScans(bool fVerify)
+{
+    g_verify_scans = fVerify;
+}
+
+DBVerifyScansScope::DBVerifyScansScope()
+{
+    g_verify_scans_scopes++;
+}
+
+DBVerifyScansScope::~DBVerifyScansScope()
+{
+    g_verify_scans_scopes--;
+}
+
+// The smallest key greater than all the keys starting with prefix, empty if there is none
+static std::string PrefixEnd(std::string prefix)
+{
+    while (!prefix.empty() && (uint8_t)prefix.back() == 0xff) {
+        prefix.pop_back();
+    }
+    if (!prefix.empty()) {
+        prefix.back()++;
+    }
+    return prefix;
+}
+
+size_t CDBWrapper::CompactNextRanges(size_t nMaxBytes)
+{
+    LOCK(cs_compaction);
+    const int64_t nTimeStart = GetTimeMicros();
+    size_t nCompacted = 0;
+    for (int nVisited = 0; nVisited < 0x10000 && nCompacted < nMaxBytes;) {
+        const uint16_t nRange = compactionStats.nNextRange;
+        const bool fWhole = !compactionStats.fSplitRange;
+        // The first range of two bytes also holds the key made of the first byte alone
+        std::string begin(1, (char)(nRange >> 8));
+        std::string end = PrefixEnd(begin);
+        if (!fWhole) {
+            if (nRange & 0xff) begin.push_back((char)(nRange & 0xff));
+            if ((nRange & 0xff) != 0xff) end = begin.substr(0, 1) + (char)((nRange & 0xff) + 1);
+        }
+        leveldb::Slice slBegin(begin), slEnd(end);
+        // The size is estimated up to a key above all the others when the range has no end
+        const std::string limit = end.empty() ? std::string(DBWRAPPER_PREALLOC_KEY_SIZE, '\xff') : end;
+        leveldb::Range range(slBegin, leveldb::Slice(limit));
+        uint64_t nSize = 0;
+        pdb->GetApproximateSizes(&range, 1, &nSize);
+
+        if (fWhole && nSize > nMaxBytes) {
+            // Too big to be compacted at once: go through its ranges of two bytes
+            compactionStats.fSplitRange = true;
+            continue;
+        }
+        if (nSize > 0) {
+            if (nCompacted > 0 && nCompacted + nSize > nMaxBytes) break;
+            pdb->CompactRange(&slBegin, end.empty() ? nullptr : &slEnd);
+            nCompacted += nSize;
+            compactionStats.nRanges++;
+            compactionStats.nBytes += nSize;
+        }
+        const int nStep = fWhole ? 0x100 : 1;
+        compactionStats.nNextRange = nRange + nStep;
+        compactionStats.fSplitRange = compactionStats.fSplitRange && (compactionStats.nNextRange & 0xff) != 0;
+        nVisited += nStep;
+    }
+    if (nCompacted > 0) {
+        const int64_t nTime = GetTimeMicros() - nTimeStart;
+        compactionStats.nTimeMicros += nTime;
+        compactionStats.nLastTime = GetTime();
+        LogPrint(BCLog::LEVELDB, "LevelDB %s compacted %u bytes in %.2fms, next range %04x\n",
+                 dbOptions.strName, nCompacted, nTime * 0.001, compactionStats.nNextRange);
+    }
+    return nCompacted;
+}
+
+CDBCompactionStats CDBWrapper::GetCompactionStats() const
+{
+    LOCK(cs_compaction);
+    return compactionStats;
+}
+
+std::string CDBWrapper::GetLevelDBStats() const
+{
+    std::string stats;
+    if (!pdb->GetProperty("leveldb.stats", &stats)) {
+        return "";
+    }
+    return stats;
+}
+
 bool CDBWrapper::IsEmpty()
 {
     std::unique_ptr<CDBIterator> it(NewIterator());
@@ -9,9 +9,11 @@
 #include "fs.h"
 #include "serialize.h"
 #include "streams.h"
+#include "sync.h"
 #include "util/system.h"
 #include "version.h"
 
+#include <functional>
 #include <typeindex>
 
 #include <leveldb/db.h>
@@ -185,6 +187,12 @@ public:
         return true;
     }
 
+    CDataStream GetValue()
+    {
+        leveldb::Slice slValue = piter->value();
+        return CDataStream(slValue.data(), slValue.data() + slValue.size(), SER_DISK, nVersion);
+    }
+
     unsigned int GetValueSize()
     {
         return piter->value().size();
@@ -192,6 +200,42 @@ public:
 
 };
 
+/**
+ * The LevelDB settings of a database, tuned to its access pattern. The defaults are the
+ * ones of the databases without a profile of their own.
+ */
+struct CDBOptions
+{
+    //! name of the database in the logs and in getmemoryinfo
+    std::string strName;
+    //! compress the table blocks with snappy (stored raw when LevelDB is built without it)
+    bool fCompression{false};
+    //! approximate size of the user data packed per table block
+    size_t nBlockSize{4 * 1024};
+    //! bits per key of the bloom filters, trading memory for fewer disk reads on missing keys
+    int nBloomBits{10};
+    //! share of the cache given to the block cache, the rest goes to the two write buffers
+    int nBlockCachePercent{50};
+
+    explicit CDBOptions(const std::string& _strName) : strName(_strName) {}
+};
+
+/** The work done by the idle compaction of a database */
+struct CDBCompactionStats
+{
+    //! ranges compacted, and the estimated size of their data
+    uint64_t nRanges{0};
+    uint64_t nBytes{0};
+    //! time spent compacting, in microseconds
+    int64_t nTimeMicros{0};
+    //! time of the last compaction
+    int64_t nLastTime{0};
+    //! first two bytes of the keys of the next range to compact, and whether the range of its first byte
+    //! is gone through by its ranges of two bytes
+    uint16_t nNextRange{0};
+    bool fSplitRange{false};
+};
+
 class CDBWrapper
 {
 private:
@@ -219,6 +263,15 @@ private:
     //! the version used to serialize data
     int nVersion;
 
+    //! the profile the database was opened with
+    CDBOptions dbOptions;
+
+    //! capacity of the block cache
+    size_t nBlockCacheSize;
+
+    mutable Mutex cs_compaction;
+    CDBCompactionStats compactionStats GUARDED_BY(cs_compaction);
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -226,10 +279,34 @@ public:
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] nVersion    The version used to serialize data.
+     * @param[in] dbOptions   The LevelDB settings of the database.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, int nVersion = CLIENT_VERSION);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, int nVersion = CLIENT_VERSION,
+               const CDBOptions& dbOptions = CDBOptions("leveldb"));
     ~CDBWrapper();
 
+    const CDBOptions& GetDBOptions() const { return dbOptions; }
+
+    //! Sizes of the block cache and of a write buffer, as configured
+    size_t GetBlockCacheSize() const { return nBlockCacheSize; }
+    size_t GetWriteBufferSize() const { return options.write_buffer_size; }
+
+    //! Approximate memory used by the memtables and the block cache
+    size_t DynamicMemoryUsage() const;
+
+    /**
+     * Compact the next ranges of keys, in turn, until about nMaxBytes of data were compacted or the
+     * whole database was visited. The ranges are the keys sharing their first byte, or their first two
+     * bytes when a range is bigger than nMaxBytes, so that the compaction of the database is spread
+     * over the calls. Returns the estimated size of the data compacted.
+     */
+    size_t CompactNextRanges(size_t nMaxBytes);
+
+    CDBCompactionStats GetCompactionStats() const;
+
+    //! The LevelDB statistics of the files and compactions of each level
+    std::string GetLevelDBStats() const;
+
     template <typename K>
     bool ReadDataStream(const K& key, CDataStream& ssValue) const
     {
@@ -335,10 +412,7 @@ public:
     }
 
     // not exactly clean encapsulation, but it's easiest for now
-    CDBIterator* NewIterator()
-    {
-        return new CDBIterator(pdb->NewIterator(iteroptions), nVersion);
-    }
+    CDBIterator* NewIterator();
 
    /**
     * Return true if the database managed by this class contains no entries.
@@ -384,6 +458,62 @@ public:
 
 };
 
+/** Call fn on each open database, with the list of them locked */
+void ForEachDBWrapper(const std::function<void(CDBWrapper&)>& fn);
+
+/** The CRC32C implementation LevelDB checksums the table blocks with ("sse4.2", "arm64 crc32" or "portable") */
+std::string GetCRC32CImplementation();
+
+/**
+ * Whether the iterators verify the checksums of the table blocks they read. The blocks read by the
+ * lookups of keys (on the block cache misses) and the ones compacted are always verified.
+ */
+void SetDBVerifyScans(bool fVerify);
+
+/** The iterators created while an instance is alive verify the checksums, e.g. for -checkblocks */
+class DBVerifyScansScope
+{
+public:
+    DBVerifyScansScope();
+    ~DBVerifyScansScope();
+};
+
+namespace dbwrapper_private {
+
+struct DataStreamCmp {
+    static bool less(const CDataStream& a, const CDataStream& b)
+    {
+        return std::lexicographical_compare(
+                (const uint8_t*)a.data(), (const uint8_t*)a.data() + a.size(),
+                (const uint8_t*)b.data(), (const uint8_t*)b.data() + b.size());
+    }
+    bool operator()(const CDataStream& a, const CDataStream& b) const { return less(a, b); }
+};
+
+/**
+ * A value written to a CDBTransaction. The holders are shared by all the transactions, whatever their
+ * parent, so that a nested transaction hands its values over to its parent instead of copying them.
+ */
+struct TransactionValueHolder {
+    size_t memoryUsage;
+    explicit TransactionValueHolder(size_t _memoryUsage) : memoryUsage(_memoryUsage) {}
+    virtual ~TransactionValueHolder() = default;
+    virtual void Write(const CDataStream& ssKey, CDBBatch& batch) = 0;
+};
+
+template <typename V>
+struct TransactionValueHolderImpl : TransactionValueHolder {
+    TransactionValueHolderImpl(const V& _value, size_t _memoryUsage) : TransactionValueHolder(_memoryUsage), value(_value) {}
+
+    void Write(const CDataStream& ssKey, CDBBatch& batch) override
+    {
+        batch.Write(ssKey, value);
+    }
+    V value;
+};
+
+} // namespace dbwrapper_private
+
 template<typename CDBTransaction>
 class CDBTransactionIterator
 {
@@ -531,42 +661,18 @@ private:
 template<typename Parent, typename CommitTarget>
 class CDBTransaction {
     friend class CDBTransactionIterator<CDBTransaction>;
+    template <typename P, typename C> friend class CDBTransaction;
 
 protected:
     Parent &parent;
     CommitTarget &commitTarget;
     ssize_t memoryUsage{0}; // signed, just in case we made an error in the calculations so that we don't get an overflow
 
-    struct DataStreamCmp {
-        static bool less(const CDataStream& a, const CDataStream& b)
-        {
-            return std::lexicographical_compare(
-                    (const uint8_t*)a.data(), (const uint8_t*)a.data() + a.size(),
-                    (const uint8_t*)b.data(), (const uint8_t*)b.data() + b.size());
-        }
-        bool operator()(const CDataStream& a, const CDataStream& b) const { return less(a, b); }
-    };
-
-    struct ValueHolder {
-        size_t memoryUsage;
-        ValueHolder(size_t _memoryUsage) : memoryUsage(_memoryUsage) {}
-        virtual ~ValueHolder() = default;
-        virtual void Write(const CDataStream& ssKey, CommitTarget &parent) = 0;
-    };
+    typedef dbwrapper_private::DataStreamCmp DataStreamCmp;
+    typedef dbwrapper_private::TransactionValueHolder ValueHolder;
     typedef std::unique_ptr<ValueHolder> ValueHolderPtr;
-
     template <typename V>
-    struct ValueHolderImpl : ValueHolder {
-        ValueHolderImpl(const V &_value, size_t _memoryUsage) : ValueHolder(_memoryUsage), value(_value) {}
-
-        virtual void Write(const CDataStream& ssKey, CommitTarget &commitTarget)
-        {
-            // we're moving the value instead of copying it. This means that Write() can only be called once per
-            // ValueHolderImpl instance. Commit() clears the write maps, so this ok.
-            commitTarget.Write(ssKey, std::move(value));
-        }
-        V value;
-    };
+    using ValueHolderImpl = dbwrapper_private::TransactionValueHolderImpl<V>;
 
     template <typename K>
     static CDataStream KeyToDataStream(const K& key, int nVersion)
@@ -597,16 +703,7 @@ public:
     void Write(const CDataStream& ssKey, const V& v)
     {
         auto valueMemoryUsage = ::GetSerializeSize(v, nVersion);
-        if (deletes.erase(ssKey)) {
-            memoryUsage -= ssKey.size();
-        }
-        auto it = writes.emplace(ssKey, nullptr).first;
-        if (it->second) {
-            memoryUsage -= ssKey.size() + it->second->memoryUsage;
-        }
-        it->second = std::make_unique<ValueHolderImpl<V>>(v, valueMemoryUsage);
-
-        memoryUsage += ssKey.size() + valueMemoryUsage;
+        WriteHolder(ssKey, std::make_unique<ValueHolderImpl<V>>(v, valueMemoryUsage));
     }
 
     template <typename K, typename V>
@@ -679,15 +776,10 @@ public:
         memoryUsage = 0;
     }
 
-    void Commit()
+    //! Return false if the changes couldn't be written to the database
+    bool Commit()
     {
-        for (const auto &k : deletes) {
-            commitTarget.Erase(k);
-        }
-        for (auto &p : writes) {
-            p.second->Write(p.first, commitTarget);
-        }
-        Clear();
+        return CommitTo(commitTarget);
     }
 
     bool IsClean()
@@ -717,6 +809,61 @@ public:
     {
         return std::make_unique<CDBTransactionIterator<CDBTransaction>>(*this, nVersion);
     }
+
+private:
+    void WriteHolder(const CDataStream& ssKey, ValueHolderPtr&& holder)
+    {
+        if (deletes.erase(ssKey)) {
+            memoryUsage -= ssKey.size();
+        }
+        auto it = writes.emplace(ssKey, nullptr).first;
+        if (it->second) {
+            memoryUsage -= ssKey.size() + it->second->memoryUsage;
+        }
+        memoryUsage += ssKey.size() + holder->memoryUsage;
+        it->second = std::move(holder);
+    }
+
+    bool CommitTo(CDBBatch& batch)
+    {
+        for (const auto &k : deletes) {
+            batch.Erase(k);
+        }
+        for (auto &p : writes) {
+            p.second->Write(p.first, batch);
+        }
+        Clear();
+        return true;
+    }
+
+    bool CommitTo(CDBWrapper& db)
+    {
+        CDBBatch batch(nVersion);
+        CommitTo(batch);
+        return db.WriteBatch(batch);
+    }
+
+    // The values are handed over to the parent transaction, without being copied or measured again.
+    // A clean parent takes the whole maps.
+    template <typename P, typename C>
+    bool CommitTo(CDBTransaction<P, C>& target)
+    {
+        if (target.IsClean()) {
+            target.writes.swap(writes);
+            target.deletes.swap(deletes);
+            target.memoryUsage = memoryUsage;
+            Clear();
+            return true;
+        }
+        for (const auto &k : deletes) {
+            target.Erase(k);
+        }
+        for (auto &p : writes) {
+            target.WriteHolder(p.first, std::move(p.second));
+        }
+        Clear();
+        return true;
+    }
 };
 
 #endif // BITCOIN_DBWRAPPER_H
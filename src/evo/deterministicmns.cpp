@@ -14,6 +14,7 @@
 #include "core_io.h"
 #include "key_io.h"
 #include "guiinterface.h"
+#include "llmq/quorums_utils.h"
 #include "masternodeman.h" // for mnodeman (!TODO: remove)
 #include "script/standard.h"
 #include "spork.h"
@@ -21,11 +22,21 @@
 
 #include <univalue.h>
 
-static const std::string DB_LIST_SNAPSHOT = "dmn_S";
+static const std::string DB_LIST_SNAPSHOT = "dmn_S"; // old encoding, only read
+static const std::string DB_LIST_SNAPSHOT_COMPACT = "dmn_C";
 static const std::string DB_LIST_DIFF = "dmn_D";
 
 std::unique_ptr<CDeterministicMNManager> deterministicMNManager;
 
+std::atomic<size_t> DMNListNodeHeap::nUsage{0};
+
+// Bytes of list nodes allocated since the heap used nUsageBefore
+static size_t ListNodesAllocatedSince(size_t nUsageBefore)
+{
+    const size_t nUsage = DMNListNodeHeap::nUsage.load(std::memory_order_relaxed);
+    return nUsage > nUsageBefore ? nUsage - nUsageBefore : 0;
+}
+
 std::string CDeterministicMNState::ToString() const
 {
     CTxDestination dest;
@@ -183,6 +194,11 @@ CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
         return nullptr;
     }
 
+    LOCK(payeesCache->cs);
+    if (payeesCache->payee) {
+        return payeesCache->payee;
+    }
+
     CDeterministicMNCPtr best;
     ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
         if (!best || CompareByLastPaid(dmn, best)) {
@@ -190,46 +206,54 @@ CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
         }
     });
 
+    payeesCache->payee = best;
     return best;
 }
 
-std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(unsigned int nCount) const
+std::vector<CDeterministicMNCPtr> CDeterministicMNList::RankPayees() const
 {
-    if (nCount > GetValidMNsCount()) {
-        nCount = GetValidMNsCount();
-    }
-
     std::vector<CDeterministicMNCPtr> result;
-    result.reserve(nCount);
-
+    result.reserve(mnMap.size());
     ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
         result.emplace_back(dmn);
     });
     std::sort(result.begin(), result.end(), [&](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
         return CompareByLastPaid(a, b);
     });
+    return result;
+}
 
-    result.resize(nCount);
+std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(unsigned int nCount) const
+{
+    LOCK(payeesCache->cs);
+    if (payeesCache->vecRanked.empty()) {
+        payeesCache->vecRanked = RankPayees();
+        if (!payeesCache->vecRanked.empty()) {
+            payeesCache->payee = payeesCache->vecRanked.front();
+        }
+    }
 
-    return result;
+    const auto& vecRanked = payeesCache->vecRanked;
+    return {vecRanked.begin(), vecRanked.begin() + std::min((size_t)nCount, vecRanked.size())};
 }
 
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t maxSize, const uint256& modifier) const
 {
     auto scores = CalculateScores(modifier);
 
-    // sort is descending order
-    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+    // only the top maxSize entries are sorted, in descending order
+    size_t nResultSize = std::min(maxSize, scores.size());
+    std::partial_sort(scores.begin(), scores.begin() + nResultSize, scores.end(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
         if (a.first == b.first) {
             // this should actually never happen, but we should stay compatible with how the non deterministic MNs did the sorting
-            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+            return b.second->collateralOutpoint < a.second->collateralOutpoint;
         }
-        return a.first < b.first;
+        return b.first < a.first;
     });
 
     // take top maxSize entries and return it
     std::vector<CDeterministicMNCPtr> result;
-    result.resize(std::min(maxSize, scores.size()));
+    result.resize(nResultSize);
     for (size_t i = 0; i < result.size(); i++) {
         result[i] = std::move(scores[i].second);
     }
@@ -391,7 +415,18 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTota
         throw(std::runtime_error(strprintf("%s: can't add a masternode with a duplicate key (%s or %s)", __func__, EncodeDestination(dmn->pdmnState->keyIDOwner), bls::EncodePublic(Params(), dmn->pdmnState->pubKeyOperator.Get()))));
     }
 
+    InsertMN(dmn);
+
+    if (fBumpTotalCount) {
+        // nTotalRegisteredCount acts more like a checkpoint, not as a limit,
+        nTotalRegisteredCount = std::max(dmn->GetInternalId() + 1, (uint64_t)nTotalRegisteredCount);
+    }
+}
+
+void CDeterministicMNList::InsertMN(const CDeterministicMNCPtr& dmn)
+{
     mnMap = mnMap.set(dmn->proTxHash, dmn);
+    ResetPayeesCache();
     mnInternalIdMap = mnInternalIdMap.set(dmn->GetInternalId(), dmn->proTxHash);
     AddUniqueProperty(dmn, dmn->collateralOutpoint);
     if (dmn->pdmnState->addr != CService()) {
@@ -399,13 +434,148 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTota
     }
     AddUniqueProperty(dmn, dmn->pdmnState->keyIDOwner);
     AddUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator);
+}
 
-    if (fBumpTotalCount) {
-        // nTotalRegisteredCount acts more like a checkpoint, not as a limit,
-        nTotalRegisteredCount = std::max(dmn->GetInternalId() + 1, (uint64_t)nTotalRegisteredCount);
+static const uint8_t COMPACT_LIST_VERSION = 1;
+
+// Fields of the state written by SerializeCompact, confirmedHashWithProRegTxHash is computed from confirmedHash
+#define DMN_COMPACT_STATE_FIELDS \
+    DMN_COMPACT_HEIGHT(nRegisteredHeight) \
+    DMN_COMPACT_HEIGHT(nLastPaidHeight) \
+    DMN_COMPACT_VARINT(nPoSePenalty) \
+    DMN_COMPACT_HEIGHT(nPoSeRevivedHeight) \
+    DMN_COMPACT_HEIGHT(nPoSeBanHeight) \
+    DMN_COMPACT_VARINT(nRevocationReason) \
+    DMN_COMPACT_FIELD(confirmedHash) \
+    DMN_COMPACT_FIELD(keyIDOwner) \
+    DMN_COMPACT_FIELD(pubKeyOperator) \
+    DMN_COMPACT_FIELD(keyIDVoting) \
+    DMN_COMPACT_FIELD(addr) \
+    DMN_COMPACT_FIELD(scriptPayout) \
+    DMN_COMPACT_FIELD(scriptOperatorPayout)
+
+template<typename Stream>
+void CDeterministicMNList::SerializeCompact(Stream& s) const
+{
+    s << COMPACT_LIST_VERSION;
+    s << blockHash;
+    s << nHeight;
+    s << nTotalRegisteredCount;
+
+    std::vector<CDeterministicMNCPtr> vecMNs;
+    vecMNs.reserve(mnMap.size());
+    for (const auto& p : mnMap) {
+        vecMNs.emplace_back(p.second);
+    }
+    std::sort(vecMNs.begin(), vecMNs.end(), [](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
+        return a->GetInternalId() < b->GetInternalId();
+    });
+
+    auto heightDistance = [&](int height) {
+        if (height > nHeight) throw std::ios_base::failure("masternode height past the list height");
+        return (uint64_t)(nHeight - height);
+    };
+
+    static const CDeterministicMNState defaultState;
+    WriteCompactSize(s, vecMNs.size());
+    uint64_t nNextInternalId = 0;
+    for (const auto& dmn : vecMNs) {
+        s << dmn->proTxHash;
+        WriteVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s, dmn->GetInternalId() - nNextInternalId);
+        nNextInternalId = dmn->GetInternalId() + 1;
+        // the collateral is usually an output of the ProReg tx itself
+        const bool fOwnCollateral = dmn->collateralOutpoint.hash == dmn->proTxHash;
+        WriteVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s, ((uint64_t)dmn->collateralOutpoint.n << 1) | fOwnCollateral);
+        if (!fOwnCollateral) s << dmn->collateralOutpoint.hash;
+        WriteVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s, dmn->nOperatorReward);
+
+        const CDeterministicMNState& state = *dmn->pdmnState;
+        uint32_t fields = 0;
+#define DMN_COMPACT_FIELD(f) if (state.f != defaultState.f) fields |= CDeterministicMNStateDiff::Field_##f;
+#define DMN_COMPACT_HEIGHT(f) DMN_COMPACT_FIELD(f)
+#define DMN_COMPACT_VARINT(f) DMN_COMPACT_FIELD(f)
+        DMN_COMPACT_STATE_FIELDS
+#undef DMN_COMPACT_FIELD
+#undef DMN_COMPACT_HEIGHT
+#undef DMN_COMPACT_VARINT
+        s << VARINT(fields);
+#define DMN_COMPACT_FIELD(f) if (fields & CDeterministicMNStateDiff::Field_##f) s << state.f;
+#define DMN_COMPACT_HEIGHT(f) if (fields & CDeterministicMNStateDiff::Field_##f) WriteVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s, heightDistance(state.f));
+#define DMN_COMPACT_VARINT(f) if (fields & CDeterministicMNStateDiff::Field_##f) WriteVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s, state.f);
+        DMN_COMPACT_STATE_FIELDS
+#undef DMN_COMPACT_FIELD
+#undef DMN_COMPACT_HEIGHT
+#undef DMN_COMPACT_VARINT
+    }
+}
+
+template<typename Stream>
+void CDeterministicMNList::UnserializeCompact(Stream& s)
+{
+    uint8_t nVersion;
+    s >> nVersion;
+    if (nVersion != COMPACT_LIST_VERSION) {
+        throw std::ios_base::failure(strprintf("unknown masternode list encoding version %d", nVersion));
+    }
+
+    *this = CDeterministicMNList();
+    s >> blockHash;
+    s >> nHeight;
+    s >> nTotalRegisteredCount;
+
+    size_t cnt = ReadCompactSize(s);
+    uint64_t nNextInternalId = 0;
+    for (size_t i = 0; i < cnt; i++) {
+        uint256 proTxHash;
+        s >> proTxHash;
+        const uint64_t internalId = nNextInternalId + ReadVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s);
+        nNextInternalId = internalId + 1;
+        auto dmn = std::make_shared<CDeterministicMN>(internalId);
+        dmn->proTxHash = proTxHash;
+        const uint64_t nCollateral = ReadVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s);
+        dmn->collateralOutpoint.n = (uint32_t)(nCollateral >> 1);
+        if (nCollateral & 1) {
+            dmn->collateralOutpoint.hash = proTxHash;
+        } else {
+            s >> dmn->collateralOutpoint.hash;
+        }
+        dmn->nOperatorReward = (uint16_t)ReadVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s);
+
+        auto state = std::make_shared<CDeterministicMNState>();
+        uint32_t fields;
+        s >> VARINT(fields);
+#define DMN_COMPACT_FIELD(f) if (fields & CDeterministicMNStateDiff::Field_##f) s >> state->f;
+#define DMN_COMPACT_HEIGHT(f) if (fields & CDeterministicMNStateDiff::Field_##f) state->f = nHeight - (int)ReadVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s);
+#define DMN_COMPACT_VARINT(f) if (fields & CDeterministicMNStateDiff::Field_##f) state->f = ReadVarInt<Stream, VarIntMode::DEFAULT, uint64_t>(s);
+        DMN_COMPACT_STATE_FIELDS
+#undef DMN_COMPACT_FIELD
+#undef DMN_COMPACT_HEIGHT
+#undef DMN_COMPACT_VARINT
+        if (!state->confirmedHash.IsNull()) {
+            state->UpdateConfirmedHash(proTxHash, state->confirmedHash);
+        }
+        dmn->pdmnState = state;
+        InsertMN(dmn);
     }
 }
 
+template void CDeterministicMNList::SerializeCompact<CDataStream>(CDataStream& s) const;
+template void CDeterministicMNList::UnserializeCompact<CDataStream>(CDataStream& s);
+
+// A list stored in evodb with its compact encoding
+struct CompactMNList
+{
+    CDeterministicMNList list;
+
+    CompactMNList() {}
+    explicit CompactMNList(const CDeterministicMNList& _list) : list(_list) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const { list.SerializeCompact(s); }
+    template<typename Stream>
+    void Unserialize(Stream& s) { list.UnserializeCompact(s); }
+};
+
 void CDeterministicMNList::UpdateMN(const CDeterministicMNCPtr& oldDmn, const CDeterministicMNStateCPtr& pdmnState)
 {
     assert(oldDmn != nullptr);
@@ -418,6 +588,7 @@ void CDeterministicMNList::UpdateMN(const CDeterministicMNCPtr& oldDmn, const CD
     auto oldState = dmn->pdmnState;
     dmn->pdmnState = pdmnState;
     mnMap = mnMap.set(oldDmn->proTxHash, dmn);
+    ResetPayeesCache();
 
     UpdateUniqueProperty(dmn, oldState->addr, pdmnState->addr);
     UpdateUniqueProperty(dmn, oldState->keyIDOwner, pdmnState->keyIDOwner);
@@ -456,12 +627,16 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
     DeleteUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator);
 
     mnMap = mnMap.erase(proTxHash);
+    ResetPayeesCache();
     mnInternalIdMap = mnInternalIdMap.erase(dmn->GetInternalId());
 }
 
-CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb) :
-    evoDb(_evoDb)
+CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb, int _nDiskSnapshotPeriod) :
+    evoDb(_evoDb),
+    nDiskSnapshotPeriod(_nDiskSnapshotPeriod < MIN_DMN_SNAPSHOT_PERIOD ? MIN_DMN_SNAPSHOT_PERIOD : _nDiskSnapshotPeriod),
+    mnListsCache(LIST_CACHE_SIZE)
 {
+    llmq::utils::InitQuorumsCache(mapQuorumMembers);
 }
 
 bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& _state, bool fJustCheck)
@@ -478,6 +653,7 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
     try {
         LOCK(cs);
 
+        const size_t nNodesUsage = DMNListNodeHeap::nUsage.load(std::memory_order_relaxed);
         if (!BuildNewListFromBlock(block, pindex->pprev, _state, newList, true)) {
             // pass the state returned by the function above
             return false;
@@ -497,9 +673,9 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
         diff = oldList.BuildDiff(newList);
 
         evoDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
-        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1) {
-            evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
-            mnListsCache.emplace(newList.GetBlockHash(), newList);
+        if ((nHeight % nDiskSnapshotPeriod) == 0 || oldList.GetHeight() == -1) {
+            evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT_COMPACT, newList.GetBlockHash()), CompactMNList(newList));
+            CacheList(newList, ListNodesAllocatedSince(nNodesUsage));
             LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d\n",
                 __func__, nHeight, newList.GetAllMNsCount());
         }
@@ -849,19 +1025,27 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
         return {};
     }
 
+    const CBlockIndex* pindexRequested = pindex;
     CDeterministicMNList snapshot;
     std::list<const CBlockIndex*> listDiffIndexes;
 
     while (true) {
         // try using cache before reading from disk
-        auto itLists = mnListsCache.find(pindex->GetBlockHash());
-        if (itLists != mnListsCache.end()) {
-            snapshot = itLists->second;
+        if (mnListsCache.get(pindex->GetBlockHash(), snapshot)) {
+            if (pindex == pindexRequested) nCacheHits++;
             break;
         }
+        if (pindex == pindexRequested) nCacheMisses++;
 
+        const size_t nNodesUsage = DMNListNodeHeap::nUsage.load(std::memory_order_relaxed);
+        CompactMNList compactSnapshot;
+        if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT_COMPACT, pindex->GetBlockHash()), compactSnapshot)) {
+            snapshot = compactSnapshot.list;
+            CacheList(snapshot, ListNodesAllocatedSince(nNodesUsage));
+            break;
+        }
         if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), snapshot)) {
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            CacheList(snapshot, ListNodesAllocatedSince(nNodesUsage));
             break;
         }
 
@@ -883,7 +1067,7 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
                 throw std::runtime_error(err);
             }
             snapshot = CDeterministicMNList(pindex->GetBlockHash(), -1, 0);
-            mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
+            CacheList(snapshot, 0);
             break;
         }
 
@@ -893,6 +1077,8 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
         pindex = pindex->pprev;
     }
 
+    // The nodes allocated replaying the diffs since the last list cached
+    size_t nNodesUsage = DMNListNodeHeap::nUsage.load(std::memory_order_relaxed);
     for (const auto& diffIndex : listDiffIndexes) {
         const auto& diff = mnListDiffsCache.at(diffIndex->GetBlockHash());
         if (diff.HasChanges()) {
@@ -901,15 +1087,17 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
             snapshot.SetBlockHash(diffIndex->GetBlockHash());
             snapshot.SetHeight(diffIndex->nHeight);
         }
+        // keep the lists at the snapshot heights met along the way, so that the next
+        // lookups near this one are not replaying the same diffs again
+        if ((diffIndex->nHeight % nDiskSnapshotPeriod) == 0 && diffIndex != pindexRequested) {
+            CacheList(snapshot, ListNodesAllocatedSince(nNodesUsage));
+            nNodesUsage = DMNListNodeHeap::nUsage.load(std::memory_order_relaxed);
+        }
     }
 
-    if (tipIndex) {
-        // always keep a snapshot for the tip
-        if (snapshot.GetBlockHash() == tipIndex->GetBlockHash()) {
-            mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
-        } else {
-            // !TODO: keep snapshots for yet alive quorums
-        }
+    // keep the requested list too: the tip, the quorum bases and repeated rpc queries
+    if (!listDiffIndexes.empty()) {
+        CacheList(snapshot, ListNodesAllocatedSince(nNodesUsage));
     }
 
     return snapshot;
@@ -946,22 +1134,77 @@ bool CDeterministicMNManager::LegacyMNObsolete() const
     return LegacyMNObsolete(tipHeight);
 }
 
-void CDeterministicMNManager::CleanupCache(int nHeight)
+CDeterministicMNManager::CacheStats CDeterministicMNManager::GetCacheStats()
 {
-    AssertLockHeld(cs);
-
-    std::vector<uint256> toDeleteLists;
-    std::vector<uint256> toDeleteDiffs;
-    for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LIST_DIFFS_CACHE_SIZE < nHeight) {
-            toDeleteLists.emplace_back(p.first);
+    LOCK(cs);
+    CacheStats stats;
+    stats.nLists = mnListsCache.size();
+    stats.nDiffs = mnListDiffsCache.size();
+    stats.nListsNodesUsage = DMNListNodeHeap::nUsage.load(std::memory_order_relaxed);
+    for (auto it = mapListsUsage.begin(); it != mapListsUsage.end();) {
+        if (!mnListsCache.contains(it->first)) {
+            it = mapListsUsage.erase(it);
             continue;
         }
-        // !TODO: llmq cache cleanup
+        stats.nListsUsage += it->second;
+        ++it;
     }
-    for (const auto& h : toDeleteLists) {
-        mnListsCache.erase(h);
+    stats.nCacheUsage = mnListsCache.DynamicMemoryUsage() + memusage::DynamicUsage(mapListsUsage) + memusage::DynamicUsage(mnListDiffsCache);
+    stats.nMaxCacheUsage = nMaxCacheUsage;
+    stats.nHits = nCacheHits;
+    stats.nMisses = nCacheMisses;
+    for (const auto& p : mnListDiffsCache) {
+        const CDeterministicMNListDiff& diff = p.second;
+        stats.nCacheUsage += memusage::DynamicUsage(diff.addedMNs);
+        for (const auto& dmn : diff.addedMNs) {
+            stats.nCacheUsage += memusage::DynamicUsage(dmn);
+        }
+        stats.nCacheUsage += memusage::DynamicUsage(diff.updatedMNs) + memusage::DynamicUsage(diff.removedMns);
     }
+    return stats;
+}
+
+size_t CDeterministicMNManager::GetCacheMemoryUsage()
+{
+    const CacheStats stats = GetCacheStats();
+    return stats.nListsUsage + stats.nCacheUsage;
+}
+
+void CDeterministicMNManager::TrimCache(size_t nTargetUsage)
+{
+    LOCK(cs);
+    if (GetCacheMemoryUsage() <= nTargetUsage) return;
+    mnListDiffsCache.clear();
+    if (tipIndex == nullptr) return;
+    // Keep the tip list, marked as the most recently used one
+    const bool fHaveTip = mnListsCache.exists(tipIndex->GetBlockHash());
+    // Dropping a list releases the nodes allocated to build it, unless they are still held outside
+    // of the cache: only those are counted, the lists held elsewhere can't make the cache thrash
+    while (mnListsCache.size() > (fHaveTip ? 1 : 0) && GetCacheMemoryUsage() > nTargetUsage) {
+        mnListsCache.erase_lru();
+    }
+}
+
+void CDeterministicMNManager::CacheList(const CDeterministicMNList& list, size_t nUsage)
+{
+    AssertLockHeld(cs);
+    mnListsCache.insert(list.GetBlockHash(), list);
+    mapListsUsage[list.GetBlockHash()] = nUsage;
+}
+
+void CDeterministicMNManager::SetMaxCacheUsage(size_t nMaxUsage)
+{
+    LOCK(cs);
+    nMaxCacheUsage = nMaxUsage;
+    TrimCache(nMaxCacheUsage);
+}
+
+void CDeterministicMNManager::CleanupCache(int nHeight)
+{
+    AssertLockHeld(cs);
+
+    // mnListsCache is bounded by its size (least recently used lists are dropped first)
+    std::vector<uint256> toDeleteDiffs;
     for (const auto& p : mnListDiffsCache) {
         if (p.second.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
             toDeleteDiffs.emplace_back(p.first);
@@ -970,14 +1213,27 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
     for (const auto& h : toDeleteDiffs) {
         mnListDiffsCache.erase(h);
     }
+    TrimCache(nMaxCacheUsage);
 }
 
 std::vector<CDeterministicMNCPtr> CDeterministicMNManager::GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
 {
+    std::vector<CDeterministicMNCPtr> members;
+    {
+        LOCK(cs_quorumMembers);
+        if (mapQuorumMembers.at(llmqType).get(pindexQuorum->GetBlockHash(), members)) {
+            return members;
+        }
+    }
+
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
     auto allMns = GetListForBlock(pindexQuorum);
     auto modifier = ::SerializeHash(std::make_pair(static_cast<uint8_t>(llmqType), pindexQuorum->GetBlockHash()));
-    return allMns.CalculateQuorum(params.size, modifier);
+    members = allMns.CalculateQuorum(params.size, modifier);
+
+    LOCK(cs_quorumMembers);
+    mapQuorumMembers.at(llmqType).insert(pindexQuorum->GetBlockHash(), members);
+    return members;
 }
 
 
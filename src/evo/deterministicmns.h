@@ -16,11 +16,14 @@
 #include "saltedhasher.h"
 #include "serialize.h"
 #include "sync.h"
+#include "unordered_lru_cache.h"
 #include "version.h"
 
 #include <immer/map.hpp>
 #include <immer/map_transient.hpp>
+#include <immer/memory_policy.hpp>
 
+#include <atomic>
 #include <unordered_map>
 
 class CBlock;
@@ -228,18 +231,47 @@ typedef std::shared_ptr<const CDeterministicMN> CDeterministicMNCPtr;
 
 class CDeterministicMNListDiff;
 
-template <typename Stream, typename K, typename T, typename Hash, typename Equal>
-void SerializeImmerMap(Stream& os, const immer::map<K, T, Hash, Equal>& m)
+/**
+ * Heap of the nodes of the masternode lists maps. The lists share most of their nodes: the bytes
+ * held here are what all the lists of the process (cached or not) actually retain, each shared
+ * node counted once. It is used without a free list, so that freed nodes are released at once.
+ */
+struct DMNListNodeHeap
+{
+    static std::atomic<size_t> nUsage;
+
+    template <typename... Tags>
+    static void* allocate(size_t size, Tags...)
+    {
+        void* p = ::operator new(size);
+        nUsage.fetch_add(size, std::memory_order_relaxed);
+        return p;
+    }
+
+    template <typename... Tags>
+    static void deallocate(size_t size, void* data, Tags...)
+    {
+        nUsage.fetch_sub(size, std::memory_order_relaxed);
+        ::operator delete(data);
+    }
+};
+
+typedef immer::memory_policy<immer::heap_policy<DMNListNodeHeap>,
+                             immer::default_refcount_policy,
+                             immer::default_lock_policy> DMNListMemoryPolicy;
+
+template <typename Stream, typename K, typename T, typename Hash, typename Equal, typename MemoryPolicy>
+void SerializeImmerMap(Stream& os, const immer::map<K, T, Hash, Equal, MemoryPolicy>& m)
 {
     WriteCompactSize(os, m.size());
-    for (typename immer::map<K, T, Hash, Equal>::const_iterator mi = m.begin(); mi != m.end(); ++mi)
+    for (auto mi = m.begin(); mi != m.end(); ++mi)
         Serialize(os, (*mi));
 }
 
-template <typename Stream, typename K, typename T, typename Hash, typename Equal>
-void UnserializeImmerMap(Stream& is, immer::map<K, T, Hash, Equal>& m)
+template <typename Stream, typename K, typename T, typename Hash, typename Equal, typename MemoryPolicy>
+void UnserializeImmerMap(Stream& is, immer::map<K, T, Hash, Equal, MemoryPolicy>& m)
 {
-    m = immer::map<K, T, Hash, Equal>();
+    m = immer::map<K, T, Hash, Equal, MemoryPolicy>();
     unsigned int nSize = ReadCompactSize(is);
     for (unsigned int i = 0; i < nSize; i++) {
         std::pair<K, T> item;
@@ -250,14 +282,14 @@ void UnserializeImmerMap(Stream& is, immer::map<K, T, Hash, Equal>& m)
 
 // For some reason the compiler is not able to choose the correct Serialize/Deserialize methods without a specialized
 // version of SerReadWrite. It otherwise always chooses the version that calls a.Serialize()
-template<typename Stream, typename K, typename T, typename Hash, typename Equal>
-inline void SerReadWrite(Stream& s, const immer::map<K, T, Hash, Equal>& m, CSerActionSerialize ser_action)
+template<typename Stream, typename K, typename T, typename Hash, typename Equal, typename MemoryPolicy>
+inline void SerReadWrite(Stream& s, const immer::map<K, T, Hash, Equal, MemoryPolicy>& m, CSerActionSerialize ser_action)
 {
     ::SerializeImmerMap(s, m);
 }
 
-template<typename Stream, typename K, typename T, typename Hash, typename Equal>
-inline void SerReadWrite(Stream& s, immer::map<K, T, Hash, Equal>& obj, CSerActionUnserialize ser_action)
+template<typename Stream, typename K, typename T, typename Hash, typename Equal, typename MemoryPolicy>
+inline void SerReadWrite(Stream& s, immer::map<K, T, Hash, Equal, MemoryPolicy>& obj, CSerActionUnserialize ser_action)
 {
     ::UnserializeImmerMap(s, obj);
 }
@@ -265,9 +297,9 @@ inline void SerReadWrite(Stream& s, immer::map<K, T, Hash, Equal>& obj, CSerActi
 class CDeterministicMNList
 {
 public:
-    typedef immer::map<uint256, CDeterministicMNCPtr> MnMap;
-    typedef immer::map<uint64_t, uint256> MnInternalIdMap;
-    typedef immer::map<uint256, std::pair<uint256, uint32_t> > MnUniquePropertyMap;
+    typedef immer::map<uint256, CDeterministicMNCPtr, std::hash<uint256>, std::equal_to<uint256>, DMNListMemoryPolicy> MnMap;
+    typedef immer::map<uint64_t, uint256, std::hash<uint64_t>, std::equal_to<uint64_t>, DMNListMemoryPolicy> MnInternalIdMap;
+    typedef immer::map<uint256, std::pair<uint256, uint32_t>, std::hash<uint256>, std::equal_to<uint256>, DMNListMemoryPolicy> MnUniquePropertyMap;
 
 private:
     uint256 blockHash;
@@ -280,6 +312,22 @@ private:
     // we keep track of this as checking for duplicates would otherwise be painfully slow
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // the payees of this list, computed on first use. Shared by the copies of the list
+    // until one of them is modified: the payee is asked several times for the same list
+    // (block validation, block creation, payments checks)
+    struct PayeesCache {
+        Mutex cs;
+        CDeterministicMNCPtr payee GUARDED_BY(cs);
+        // all the valid masternodes, by payment order. Empty until projected payees are asked
+        std::vector<CDeterministicMNCPtr> vecRanked GUARDED_BY(cs);
+    };
+    std::shared_ptr<PayeesCache> payeesCache{std::make_shared<PayeesCache>()};
+
+    void ResetPayeesCache() { payeesCache = std::make_shared<PayeesCache>(); }
+    // adds a masternode without the duplicates checks, for the lists read from disk
+    void InsertMN(const CDeterministicMNCPtr& dmn);
+    std::vector<CDeterministicMNCPtr> RankPayees() const;
+
 public:
     CDeterministicMNList() {}
     explicit CDeterministicMNList(const uint256& _blockHash, int _height, uint32_t _totalRegisteredCount) :
@@ -313,10 +361,21 @@ public:
         s >> nTotalRegisteredCount;
         size_t cnt = ReadCompactSize(s);
         for (size_t i = 0; i < cnt; i++) {
-            AddMN(std::make_shared<CDeterministicMN>(deserialize, s), false);
+            InsertMN(std::make_shared<CDeterministicMN>(deserialize, s));
         }
     }
 
+    /**
+     * Compact encoding used for the snapshots in evodb: the masternodes are sorted by internal id,
+     * stored as differences, the state fields left to their default value are skipped, the heights
+     * are stored as distances from the list height and confirmedHashWithProRegTxHash is computed
+     * again when loading.
+     */
+    template<typename Stream>
+    void SerializeCompact(Stream& s) const;
+    template<typename Stream>
+    void UnserializeCompact(Stream& s);
+
 public:
     size_t GetAllMNsCount() const
     {
@@ -551,24 +610,43 @@ public:
     }
 };
 
+// A full list is written to disk every period blocks: no list is more than period diffs away from one
+static const int DEFAULT_DMN_SNAPSHOT_PERIOD = 576;
+static const int MIN_DMN_SNAPSHOT_PERIOD = 16;
+
 class CDeterministicMNManager
 {
-    static const int DISK_SNAPSHOT_PERIOD = 1440; // once per day
-    static const int DISK_SNAPSHOTS = 3; // keep cache for 3 disk snapshots to have 2 full days covered
-    static const int LIST_DIFFS_CACHE_SIZE = DISK_SNAPSHOT_PERIOD * DISK_SNAPSHOTS;
+    static const int LIST_DIFFS_CACHE_SIZE = 1440 * 3; // keep the diffs of the last 3 days in memory
+    static const int LIST_CACHE_SIZE = 128; // lists share most of their data, keeping them is cheap
 
 public:
+    static const size_t LIST_CACHE_MAX_USAGE = 64 << 20; // unless they diverge: then the least recently used are dropped
+
     mutable RecursiveMutex cs;
 
 private:
     CEvoDB& evoDb;
+    const int nDiskSnapshotPeriod;
 
-    std::unordered_map<uint256, CDeterministicMNList, StaticSaltedHasher> mnListsCache;
+    unordered_lru_cache<uint256, CDeterministicMNList, StaticSaltedHasher> mnListsCache;
+    // Bytes of list nodes allocated to build each cached list, on top of the list it was built from:
+    // what the cache keeps alive, while the heap usage also counts the lists held outside of it.
+    // The entries of the lists no longer cached are dropped by GetCacheStats.
+    std::unordered_map<uint256, size_t, StaticSaltedHasher> mapListsUsage;
     std::unordered_map<uint256, CDeterministicMNListDiff, StaticSaltedHasher> mnListDiffsCache;
     const CBlockIndex* tipIndex{nullptr};
+    // Memory cap of the cached lists and diffs, rebalanced with the other -dbcache caches
+    size_t nMaxCacheUsage{LIST_CACHE_MAX_USAGE};
+    // Lists asked for to GetListForBlock found in the cache, and built from the evo db
+    uint64_t nCacheHits{0};
+    uint64_t nCacheMisses{0};
+
+    // Members of the quorums of each type, by quorum hash. Computing them sorts the whole list.
+    Mutex cs_quorumMembers;
+    std::map<Consensus::LLMQType, unordered_lru_cache<uint256, std::vector<CDeterministicMNCPtr>, StaticSaltedHasher>> mapQuorumMembers GUARDED_BY(cs_quorumMembers);
 
 public:
-    explicit CDeterministicMNManager(CEvoDB& _evoDb);
+    explicit CDeterministicMNManager(CEvoDB& _evoDb, int _nDiskSnapshotPeriod = DEFAULT_DMN_SNAPSHOT_PERIOD);
 
     bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck);
     bool UndoBlock(const CBlock& block, const CBlockIndex* pindex);
@@ -595,8 +673,32 @@ public:
     // Get the list of members for a given quorum type and index
     std::vector<CDeterministicMNCPtr> GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum);
 
+    struct CacheStats {
+        size_t nLists{0};
+        size_t nDiffs{0};
+        // Bytes of the nodes of all the lists maps of the process
+        size_t nListsNodesUsage{0};
+        // Bytes of the nodes kept alive by the cached lists
+        size_t nListsUsage{0};
+        // Bytes of the cache entries and of the diffs
+        size_t nCacheUsage{0};
+        size_t nMaxCacheUsage{0};
+        uint64_t nHits{0};
+        uint64_t nMisses{0};
+    };
+    CacheStats GetCacheStats();
+    // Memory kept alive by the cached lists and diffs, the nodes shared between the lists counted once
+    size_t GetCacheMemoryUsage();
+    // Drop the cached diffs, then the least recently used lists (never the tip one), until they use
+    // less than nTargetUsage. They are read again from the evo db when needed.
+    void TrimCache(size_t nTargetUsage);
+    // Set the memory cap of the cache (LIST_CACHE_MAX_USAGE by default), trimming it if needed
+    void SetMaxCacheUsage(size_t nMaxUsage);
+
 private:
     void CleanupCache(int nHeight);
+    // Add a list to the cache, with the bytes of list nodes allocated to build it
+    void CacheList(const CDeterministicMNList& list, size_t nUsage);
 };
 
 extern std::unique_ptr<CDeterministicMNManager> deterministicMNManager;
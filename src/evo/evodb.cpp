@@ -34,7 +34,15 @@ void CEvoDBScopedCommitter::Rollback()
     evoDB.RollbackCurTransaction();
 }
 
-CEvoDB::CEvoDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(fMemory ? "" : (GetDataDir() / "evodb"), nCacheSize, fMemory, fWipe, CLIENT_VERSION | ADDRV2_FORMAT),
+// The masternode lists are serialized in full, and compress well
+static CDBOptions EvoDBOptions()
+{
+    CDBOptions dbOptions("evodb");
+    dbOptions.fCompression = true;
+    return dbOptions;
+}
+
+CEvoDB::CEvoDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(fMemory ? "" : (GetDataDir() / "evodb"), nCacheSize, fMemory, fWipe, CLIENT_VERSION | ADDRV2_FORMAT, EvoDBOptions()),
                                                               rootBatch(CLIENT_VERSION | ADDRV2_FORMAT),
                                                               rootDBTransaction(db, rootBatch, CLIENT_VERSION | ADDRV2_FORMAT),
                                                               curDBTransaction(rootDBTransaction, rootDBTransaction, CLIENT_VERSION | ADDRV2_FORMAT)
@@ -56,8 +64,7 @@ void CEvoDB::RollbackCurTransaction()
 bool CEvoDB::CommitRootTransaction()
 {
     assert(curDBTransaction.IsClean());
-    rootDBTransaction.Commit();
-    bool ret = db.WriteBatch(rootBatch);
+    bool ret = rootDBTransaction.Commit() && db.WriteBatch(rootBatch);
     rootBatch.Clear();
     return ret;
 }
@@ -91,11 +91,20 @@ public:
         return db;
     }
 
+    //! Memory used by the changes committed by the blocks, not yet written to the database
     size_t GetMemoryUsage()
     {
+        LOCK(cs);
         return rootDBTransaction.GetMemoryUsage();
     }
 
+    //! Memory used by the changes of the block being processed
+    size_t GetCurTransactionMemoryUsage()
+    {
+        LOCK(cs);
+        return curDBTransaction.GetMemoryUsage();
+    }
+
     bool CommitRootTransaction();
 
     bool VerifyBestBlock(const uint256& hash);
@@ -4,6 +4,7 @@
 
 #include "evo/evonotificationinterface.h"
 
+#include "chaintipsnapshot.h"
 #include "evo/deterministicmns.h"
 #include "evo/mnauth.h"
 #include "llmq/quorums.h"
@@ -15,6 +16,7 @@ void EvoNotificationInterface::InitializeCurrentBlockTip()
 {
     LOCK(cs_main);
     deterministicMNManager->SetTipIndex(chainActive.Tip());
+    PublishChainTipSnapshot(chainActive.Tip());
 }
 
 void EvoNotificationInterface::AcceptedBlockHeader(const CBlockIndex* pindexNew)
@@ -11,6 +11,7 @@
 #include "net.h" // for CSerializedNetMsg
 #include "netmessagemaker.h"
 #include "llmq/quorums_connections.h"
+#include "saltedhasher.h"
 #include "tiertwo/masternode_meta_manager.h"
 #include "tiertwo/net_masternodes.h"
 #include "tiertwo/tiertwo_sync_state.h"
@@ -18,6 +19,14 @@
 
 #include "version.h" // for MNAUTH_NODE_VER_VERSION
 
+#include <unordered_map>
+
+// The connected nodes with a valid MNAUTH, by the proTxHash they authenticated as: the masternode list
+// changes only revisit the nodes of the updated and removed masternodes.
+static Mutex cs_verifiedNodes;
+static std::unordered_map<uint256, std::set<NodeId>, StaticSaltedHasher> mapVerifiedNodes GUARDED_BY(cs_verifiedNodes);
+static std::unordered_map<NodeId, uint256> mapNodeProRegTxHash GUARDED_BY(cs_verifiedNodes);
+
 void CMNAuth::PushMNAUTH(CNode* pnode, CConnman& connman)
 {
     const CActiveMasternodeInfo* activeMnInfo{nullptr};
@@ -179,6 +188,11 @@ bool CMNAuth::ProcessMessage(CNode* pnode, const std::string& strCommand, CDataS
             pnode->verifiedProRegTxHash = mnauth.proRegTxHash;
             pnode->verifiedPubKeyHash = dmn->pdmnState->pubKeyOperator.GetHash();
         }
+        {
+            LOCK(cs_verifiedNodes);
+            mapVerifiedNodes[mnauth.proRegTxHash].emplace(pnode->GetId());
+            mapNodeProRegTxHash.emplace(pnode->GetId(), mnauth.proRegTxHash);
+        }
 
         if (!pnode->m_masternode_iqr_connection && connman.GetTierTwoConnMan()->isMasternodeQuorumRelayMember(pnode->verifiedProRegTxHash)) {
             // Tell our peer that we're interested in plain LLMQ recovered signatures.
@@ -202,31 +216,76 @@ void CMNAuth::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList&
         return;
     }
 
-    g_connman->ForEachNode([&](CNode* pnode) {
-        LOCK(pnode->cs_mnauth);
-        if (pnode->verifiedProRegTxHash.IsNull()) {
+    // the nodes authenticated as the updated/removed MNs
+    std::set<NodeId> nodesToCheck;
+    {
+        LOCK(cs_verifiedNodes);
+        if (mapVerifiedNodes.empty()) {
             return;
         }
-        auto verifiedDmn = oldMNList.GetMN(pnode->verifiedProRegTxHash);
-        if (!verifiedDmn) {
-            return;
+        auto addNodes = [&](uint64_t internalId) EXCLUSIVE_LOCKS_REQUIRED(cs_verifiedNodes) {
+            auto dmn = oldMNList.GetMNByInternalId(internalId);
+            if (!dmn) return;
+            auto it = mapVerifiedNodes.find(dmn->proTxHash);
+            if (it != mapVerifiedNodes.end()) {
+                nodesToCheck.insert(it->second.begin(), it->second.end());
+            }
+        };
+        for (uint64_t internalId : diff.removedMns) {
+            addNodes(internalId);
         }
-        bool doRemove = false;
-        if (diff.removedMns.count(verifiedDmn->GetInternalId())) {
-            doRemove = true;
-        } else {
-            auto it = diff.updatedMNs.find(verifiedDmn->GetInternalId());
-            if (it != diff.updatedMNs.end()) {
-                if ((it->second.fields & CDeterministicMNStateDiff::Field_pubKeyOperator) && it->second.state.pubKeyOperator.GetHash() != pnode->verifiedPubKeyHash) {
-                    doRemove = true;
-                }
+        for (const auto& p : diff.updatedMNs) {
+            if (p.second.fields & CDeterministicMNStateDiff::Field_pubKeyOperator) {
+                addNodes(p.first);
             }
         }
+    }
+
+    for (NodeId nodeId : nodesToCheck) {
+        g_connman->ForNode(nodeId, [&](CNode* pnode) {
+            LOCK(pnode->cs_mnauth);
+            if (pnode->verifiedProRegTxHash.IsNull()) {
+                return true;
+            }
+            auto verifiedDmn = oldMNList.GetMN(pnode->verifiedProRegTxHash);
+            if (!verifiedDmn) {
+                return true;
+            }
+            bool doRemove = false;
+            if (diff.removedMns.count(verifiedDmn->GetInternalId())) {
+                doRemove = true;
+            } else {
+                auto it = diff.updatedMNs.find(verifiedDmn->GetInternalId());
+                if (it != diff.updatedMNs.end()) {
+                    if ((it->second.fields & CDeterministicMNStateDiff::Field_pubKeyOperator) && it->second.state.pubKeyOperator.GetHash() != pnode->verifiedPubKeyHash) {
+                        doRemove = true;
+                    }
+                }
+            }
+
+            if (doRemove) {
+                LogPrint(BCLog::NET_MN, "CMNAuth::NotifyMasternodeListChanged -- Disconnecting MN %s due to key changed/removed, peer=%d\n",
+                         pnode->verifiedProRegTxHash.ToString(), pnode->GetId());
+                pnode->fDisconnect = true;
+            }
+            return true;
+        });
+    }
+}
 
-        if (doRemove) {
-            LogPrint(BCLog::NET_MN, "CMNAuth::NotifyMasternodeListChanged -- Disconnecting MN %s due to key changed/removed, peer=%d\n",
-                     pnode->verifiedProRegTxHash.ToString(), pnode->GetId());
-            pnode->fDisconnect = true;
+void CMNAuth::NotifyNodeRemoved(NodeId nodeId)
+{
+    LOCK(cs_verifiedNodes);
+    auto it = mapNodeProRegTxHash.find(nodeId);
+    if (it == mapNodeProRegTxHash.end()) {
+        return;
+    }
+    auto itNodes = mapVerifiedNodes.find(it->second);
+    if (itNodes != mapVerifiedNodes.end()) {
+        itNodes->second.erase(nodeId);
+        if (itNodes->second.empty()) {
+            mapVerifiedNodes.erase(itNodes);
         }
-    });
+    }
+    mapNodeProRegTxHash.erase(it);
 }
@@ -7,6 +7,7 @@
 #define PIVX_EVO_MNAUTH_H
 
 #include "bls/bls_wrapper.h"
+#include "net.h" // for NodeId
 #include "serialize.h"
 
 class CConnman;
@@ -45,6 +46,8 @@ public:
     static void PushMNAUTH(CNode* pnode, CConnman& connman);
     static bool ProcessMessage(CNode* pnode, const std::string& strCommand, CDataStream& vRecv, CConnman& connman, CValidationState& state);
     static void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff);
+    // Forget the masternode the node authenticated as, if any. Called when the node is removed.
+    static void NotifyNodeRemoved(NodeId nodeId);
 };
 
 
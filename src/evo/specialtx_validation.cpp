@@ -5,6 +5,7 @@
 
 #include "evo/specialtx_validation.h"
 
+#include "bls/bls_worker.h"
 #include "chain.h"
 #include "coins.h"
 #include "chainparams.h"
@@ -13,12 +14,48 @@
 #include "evo/deterministicmns.h"
 #include "evo/providertx.h"
 #include "llmq/quorums_blockprocessor.h"
+#include "llmq/quorums_init.h"
 #include "messagesigner.h"
 #include "primitives/transaction.h"
 #include "primitives/block.h"
+#include "random.h"
+#include "script/sigcache.h" // for CVerifiedResultCache
 #include "script/standard.h"
 #include "spork.h"
 
+namespace {
+/**
+ * Valid special txes signatures cache (ECDSA and BLS payload signatures), to avoid verifying them
+ * again when the transaction, accepted into the mempool, is connected in a block.
+ * Entries are Hash(nonce || txid || verifying key), or Hash(nonce || commitment hash || members keys)
+ * for the LLMQ final commitments, which can be verified before being included in a transaction.
+ */
+CVerifiedResultCache specialTxSigCache("special txes signature", "maxspecialtxsigcachesize", DEFAULT_MAX_SPECIALTX_SIG_CACHE_SIZE, MAX_MAX_SPECIALTX_SIG_CACHE_SIZE);
+
+template <typename Key>
+uint256 ComputeEntry(const uint256& hash, const Key& key)
+{
+    CHashWriter hw(SER_GETHASH, PROTOCOL_VERSION);
+    hw << specialTxSigCache.GetNonce() << hash << key;
+    return hw.GetHash();
+}
+} // anon namespace
+
+// Runs verify(), unless it already succeeded for hash and key
+template <typename Key, typename VerifyFunc>
+static bool CachedVerify(const uint256& hash, const Key& key, VerifyFunc verify)
+{
+    uint256 entry = ComputeEntry(hash, key);
+    if (specialTxSigCache.Get(entry, false)) {
+        return true;
+    }
+    if (!verify()) {
+        return false;
+    }
+    specialTxSigCache.Set(entry);
+    return true;
+}
+
 /* -- Helper static functions -- */
 
 static bool CheckService(const CService& addr, CValidationState& state)
@@ -49,29 +86,29 @@ static bool CheckService(const CService& addr, CValidationState& state)
 }
 
 template <typename Payload>
-static bool CheckHashSig(const Payload& pl, const CKeyID& keyID, CValidationState& state)
+static bool CheckHashSig(const CTransaction& tx, const Payload& pl, const CKeyID& keyID, CValidationState& state)
 {
     std::string strError;
-    if (!CHashSigner::VerifyHash(::SerializeHash(pl), keyID, pl.vchSig, strError)) {
+    if (!CachedVerify(tx.GetHash(), keyID, [&]() { return CHashSigner::VerifyHash(::SerializeHash(pl), keyID, pl.vchSig, strError); })) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false, strError);
     }
     return true;
 }
 
 template <typename Payload>
-static bool CheckHashSig(const Payload& pl, const CBLSPublicKey& pubKey, CValidationState& state)
+static bool CheckHashSig(const CTransaction& tx, const Payload& pl, const CBLSPublicKey& pubKey, CValidationState& state)
 {
-    if (!pl.sig.VerifyInsecure(pubKey, ::SerializeHash(pl))) {
+    if (!CachedVerify(tx.GetHash(), pubKey, [&]() { return pl.sig.VerifyInsecure(pubKey, ::SerializeHash(pl)); })) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false);
     }
     return true;
 }
 
 template <typename Payload>
-static bool CheckStringSig(const Payload& pl, const CKeyID& keyID, CValidationState& state)
+static bool CheckStringSig(const CTransaction& tx, const Payload& pl, const CKeyID& keyID, CValidationState& state)
 {
     std::string strError;
-    if (!CMessageSigner::VerifyMessage(keyID, pl.vchSig, pl.MakeSignString(), strError)) {
+    if (!CachedVerify(tx.GetHash(), keyID, [&]() { return CMessageSigner::VerifyMessage(keyID, pl.vchSig, pl.MakeSignString(), strError); })) {
         return state.DoS(100, false, REJECT_INVALID, "bad-protx-sig", false, strError);
     }
     return true;
@@ -148,7 +185,7 @@ static bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev,
             return state.DoS(10, false, REJECT_INVALID, "bad-protx-collateral");
         }
         CTxDestination collateralTxDest;
-        if (!CheckCollateralOut(coin.out, pl, state, collateralTxDest)) {
+        if (!CheckCollateralOut(coin.GetTxOut(), pl, state, collateralTxDest)) {
             // pass the state returned by the function above
             return false;
         }
@@ -159,7 +196,7 @@ static bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev,
             return state.DoS(10, false, REJECT_INVALID, "bad-protx-collateral-pkh");
         }
         // collateral is not part of this ProRegTx, so we must verify ownership of the collateral
-        if (!CheckStringSig(pl, *keyForPayloadSig, state)) {
+        if (!CheckStringSig(tx, pl, *keyForPayloadSig, state)) {
             // pass the state returned by the function above
             return false;
         }
@@ -231,7 +268,7 @@ static bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPr
         }
 
         // we can only check the signature if pindexPrev != nullptr and the MN is known
-        if (!CheckHashSig(pl, mn->pdmnState->pubKeyOperator.Get(), state)) {
+        if (!CheckHashSig(tx, pl, mn->pdmnState->pubKeyOperator.Get(), state)) {
             // pass the state returned by the function above
             return false;
         }
@@ -293,7 +330,7 @@ static bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPre
 
         // don't allow reuse of collateral key for other keys (don't allow people to put the payee key onto an online server)
         CTxDestination collateralTxDest;
-        if (!ExtractDestination(coin.out.scriptPubKey, collateralTxDest)) {
+        if (!ExtractDestination(coin.GetScriptPubKey(), collateralTxDest)) {
             return state.DoS(100, false, REJECT_INVALID, "bad-protx-collateral-dest");
         }
         if (collateralTxDest == CTxDestination(dmn->pdmnState->keyIDOwner) ||
@@ -308,7 +345,7 @@ static bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPre
             }
         }
 
-        if (!CheckHashSig(pl, dmn->pdmnState->keyIDOwner, state)) {
+        if (!CheckHashSig(tx, pl, dmn->pdmnState->keyIDOwner, state)) {
             // pass the state returned by the function above
             return false;
         }
@@ -339,7 +376,7 @@ static bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPre
         if (!dmn)
             return state.DoS(100, false, REJECT_INVALID, "bad-protx-hash");
 
-        if (!CheckHashSig(pl, dmn->pdmnState->pubKeyOperator.Get(), state)) {
+        if (!CheckHashSig(tx, pl, dmn->pdmnState->pubKeyOperator.Get(), state)) {
             // pass the state returned by the function above
             return false;
         }
@@ -348,6 +385,55 @@ static bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPre
     return true;
 }
 
+static std::vector<CBLSPublicKey> GetQuorumMembersKeys(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
+{
+    std::vector<CBLSPublicKey> allkeys;
+    for (const auto& m : deterministicMNManager->GetAllQuorumMembers(llmqType, pindexQuorum)) {
+        allkeys.emplace_back(m->pdmnState->pubKeyOperator.Get());
+    }
+    return allkeys;
+}
+
+// Verifies the members and quorum signatures of qfc, unless they are in the cache already
+static bool VerifyLLMQCommitmentSigs(const llmq::CFinalCommitment& qfc, const std::vector<CBLSPublicKey>& allkeys, const Consensus::LLMQParams& params)
+{
+    return CachedVerify(::SerializeHash(qfc), allkeys, [&]() { return qfc.Verify(allkeys, params); });
+}
+
+// Verifies the signatures of the final commitments of the block concurrently, on the BLS workers, so that
+// the ones found valid are in the cache when the commitments are checked in order by CheckSpecialTx.
+// The invalid ones are not reported here, CheckSpecialTx rejects them with the proper state.
+static void PreVerifyLLMQCommitments(const CBlock& block, const CBlockIndex* pindexPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+
+    struct Job {
+        llmq::CFinalCommitment qfc;
+        std::vector<CBLSPublicKey> allkeys;
+        Consensus::LLMQParams params;
+    };
+    std::vector<Job> jobs;
+    for (const CTransactionRef& tx : block.vtx) {
+        if (!tx->IsQuorumCommitmentTx()) continue;
+        llmq::LLMQCommPL pl;
+        if (!GetTxPayload(*tx, pl) || pl.commitment.IsNull()) continue;
+        Optional<Consensus::LLMQParams> params = Params().GetConsensus().GetLLMQParams(pl.commitment.llmqType);
+        if (params == nullopt || !pl.commitment.VerifySizes(*params)) continue;
+        const CBlockIndex* pindexQuorum = LookupBlockIndex(pl.commitment.quorumHash);
+        if (!pindexQuorum || pindexQuorum != pindexPrev->GetAncestor(pindexQuorum->nHeight)) continue;
+        std::vector<CBLSPublicKey> allkeys = GetQuorumMembersKeys(params->type, pindexQuorum);
+        jobs.push_back({std::move(pl.commitment), std::move(allkeys), *params});
+    }
+    if (jobs.size() < 2 || !llmq::blsWorker) {
+        // nothing to run in parallel
+        return;
+    }
+
+    llmq::blsWorker->ParallelFor(jobs.size(), [&jobs](size_t i) {
+        VerifyLLMQCommitmentSigs(jobs[i].qfc, jobs[i].allkeys, jobs[i].params);
+    });
+}
+
 // LLMQ final commitment Payload
 bool VerifyLLMQCommitment(const llmq::CFinalCommitment& qfc, const CBlockIndex* pindexPrev, CValidationState& state)
 {
@@ -402,11 +488,8 @@ bool VerifyLLMQCommitment(const llmq::CFinalCommitment& qfc, const CBlockIndex*
 
         // Get members and check signatures (for not-null commitments)
         if (!qfc.IsNull()) {
-            std::vector<CBLSPublicKey> allkeys;
-            for (const auto& m : deterministicMNManager->GetAllQuorumMembers((Consensus::LLMQType)qfc.llmqType, pindexQuorum)) {
-                allkeys.emplace_back(m->pdmnState->pubKeyOperator.Get());
-            }
-            if (!qfc.Verify(allkeys, *params)) {
+            const std::vector<CBLSPublicKey> allkeys = GetQuorumMembersKeys((Consensus::LLMQType)qfc.llmqType, pindexQuorum);
+            if (!VerifyLLMQCommitmentSigs(qfc, allkeys, *params)) {
                 return state.DoS(100, false, REJECT_INVALID, "bad-qc-invalid");
             }
         }
@@ -534,10 +617,16 @@ bool CheckSpecialTxNoContext(const CTransaction& tx, CValidationState& state)
 }
 
 
-bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, const CCoinsViewCache* view, CValidationState& state, bool fJustCheck)
+bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, const CCoinsViewCache* view, CValidationState& state, bool fJustCheck, int64_t* pnTimeQuorums)
 {
     AssertLockHeld(cs_main);
 
+    int64_t nTimeStart = GetTimeMicros();
+    if (pindex->pprev) {
+        PreVerifyLLMQCommitments(block, pindex->pprev);
+    }
+    int64_t nTimeQuorums = GetTimeMicros() - nTimeStart;
+
     // check special txes
     for (const CTransactionRef& tx: block.vtx) {
         if (!CheckSpecialTx(*tx, pindex->pprev, view, state)) {
@@ -546,10 +635,13 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, co
         }
     }
 
+    nTimeStart = GetTimeMicros();
     if (!llmq::quorumBlockProcessor->ProcessBlock(block, pindex, state, fJustCheck)) {
         // pass the state returned by the function above
         return false;
     }
+    nTimeQuorums += GetTimeMicros() - nTimeStart;
+    if (pnTimeQuorums) *pnTimeQuorums += nTimeQuorums;
 
     if (!deterministicMNManager->ProcessBlock(block, pindex, state, fJustCheck)) {
         // pass the state returned by the function above
@@ -20,6 +20,10 @@ class uint256;
 /** The maximum allowed size of the extraPayload (for any TxType) */
 static const unsigned int MAX_SPECIALTX_EXTRAPAYLOAD = 10000;
 
+// Default and maximum size of the special txes signature cache, in MiB
+static const unsigned int DEFAULT_MAX_SPECIALTX_SIG_CACHE_SIZE = 1;
+static const int64_t MAX_MAX_SPECIALTX_SIG_CACHE_SIZE = 256;
+
 /** Payload validity checks (including duplicate unique properties against list at pindexPrev)*/
 // Note: for +v2, if the tx is not a special tx, this method returns true.
 // Note2: This function only performs extra payload related checks, it does NOT checks regular inputs and outputs.
@@ -30,7 +34,8 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, const
 bool CheckSpecialTxNoContext(const CTransaction& tx, CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 // Update internal tiertwo data when blocks containing special txes get connected/disconnected
-bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, const CCoinsViewCache* view, CValidationState& state, bool fJustCheck) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+// (with pnTimeQuorums, adds the time spent on the LLMQ commitments to it, in microseconds)
+bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, const CCoinsViewCache* view, CValidationState& state, bool fJustCheck, int64_t* pnTimeQuorums = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex);
 
 // Validate given LLMQ final commitment with the list at pindexQuorum
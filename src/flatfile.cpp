@@ -3,8 +3,11 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <functional>
 #include <stdexcept>
+#include <string.h>
 
+#include "compat.h"
 #include "flatfile.h"
 #include "logging.h"
 #include "tinyformat.h"
@@ -96,3 +99,238 @@ bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
     fclose(file);
     return true;
 }
+
+// The whole files are mapped, which needs the address space of a 64 bit system
+#if !defined(WIN32) && SIZE_MAX > UINT32_MAX
+#define FLATFILE_USE_MMAP 1
+#include <sys/stat.h>
+#endif
+
+bool FlatFileReader::Read(const fs::path& path, size_t nPos, unsigned char* out, size_t nSize)
+{
+#ifdef FLATFILE_USE_MMAP
+    LOCK(cs);
+    const std::string strPath = path.string();
+    auto it = mapMappings.find(strPath);
+    if (it == mapMappings.end() || nPos + nSize > it->second.size) {
+        if (it != mapMappings.end()) Unmap(it);
+        int fd = open(strPath.c_str(), O_RDONLY);
+        if (fd == -1) {
+            LogPrintf("Unable to open file %s\n", strPath);
+            return false;
+        }
+        struct stat st;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && nPos + nSize <= (size_t)st.st_size) {
+            data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (data == MAP_FAILED) {
+            return error("%s: unable to map %u bytes at position %u of %s", __func__, nSize, nPos, strPath);
+        }
+        it = mapMappings.emplace(strPath, Mapping{(const unsigned char*)data, (size_t)st.st_size, 0}).first;
+
+        if (mapMappings.size() > nMaxFiles) {
+            auto itOldest = mapMappings.end();
+            for (auto itMapping = mapMappings.begin(); itMapping != mapMappings.end(); ++itMapping) {
+                if (itMapping != it && (itOldest == mapMappings.end() || itMapping->second.nLastUse < itOldest->second.nLastUse)) {
+                    itOldest = itMapping;
+                }
+            }
+            Unmap(itOldest);
+        }
+    }
+    it->second.nLastUse = nUseCounter++;
+    memcpy(out, it->second.data + nPos, nSize);
+    return true;
+#else
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        LogPrintf("Unable to open file %s\n", path.string());
+        return false;
+    }
+    bool ret = fseek(file, nPos, SEEK_SET) == 0 && fread(out, 1, nSize, file) == nSize;
+    fclose(file);
+    if (!ret) {
+        return error("%s: unable to read %u bytes at position %u of %s", __func__, nSize, nPos, path.string());
+    }
+    return true;
+#endif
+}
+
+void FlatFileReader::Unmap(std::map<std::string, Mapping>::iterator it)
+{
+    AssertLockHeld(cs);
+#ifdef FLATFILE_USE_MMAP
+    munmap((void*)it->second.data, it->second.size);
+#endif
+    mapMappings.erase(it);
+}
+
+void FlatFileReader::Close(const fs::path& path)
+{
+    LOCK(cs);
+    auto it = mapMappings.find(path.string());
+    if (it != mapMappings.end()) Unmap(it);
+}
+
+void FlatFileReader::Clear()
+{
+    LOCK(cs);
+    while (!mapMappings.empty()) {
+        Unmap(mapMappings.begin());
+    }
+}
+
+FlatFileWriter::~FlatFileWriter()
+{
+    Stop();
+    Close();
+}
+
+void FlatFileWriter::Start(const std::string& strThreadName)
+{
+    assert(!fRunning);
+    WITH_LOCK(cs, fInterrupted = false);
+    writerThread = std::thread(&TraceThread<std::function<void()> >, strThreadName, std::function<void()>(std::bind(&FlatFileWriter::ThreadWrite, this)));
+    fRunning = true;
+}
+
+void FlatFileWriter::Stop()
+{
+    if (!fRunning) return;
+    // The thread writes the queue before exiting
+    WITH_LOCK(cs, fInterrupted = true);
+    cvQueued.notify_all();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+    fRunning = false;
+    Close();
+}
+
+bool FlatFileWriter::WriteData(const PendingWrite& write)
+{
+    AssertLockHeld(cs_file);
+    if (!file || filePath != write.path) {
+        CloseFile();
+        file = fsbridge::fopen(write.path, "rb+");
+        if (!file) file = fsbridge::fopen(write.path, "wb+");
+        if (!file) {
+            return error("%s: unable to open file %s", __func__, write.path.string());
+        }
+        filePath = write.path;
+    }
+    if (fseek(file, write.nPos, SEEK_SET) != 0 ||
+            fwrite(write.data.data(), 1, write.data.size(), file) != write.data.size()) {
+        CloseFile();
+        return error("%s: unable to write %u bytes at position %u of %s", __func__, write.data.size(), write.nPos, write.path.string());
+    }
+    return true;
+}
+
+void FlatFileWriter::CloseFile()
+{
+    AssertLockHeld(cs_file);
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    filePath.clear();
+}
+
+void FlatFileWriter::ThreadWrite()
+{
+    std::vector<const PendingWrite*> vWrites;
+    while (true) {
+        {
+            WAIT_LOCK(cs, lock);
+            cvQueued.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return (!queue.empty() && !fFailed) || fInterrupted; });
+            if (queue.empty() || fFailed) return;
+            // The queued elements stay in place while others are pushed
+            for (const PendingWrite& write : queue) {
+                vWrites.emplace_back(&write);
+            }
+        }
+
+        bool fWritten = true;
+        {
+            LOCK(cs_file);
+            for (const PendingWrite* write : vWrites) {
+                if (!WriteData(*write)) {
+                    fWritten = false;
+                    break;
+                }
+            }
+            if (fWritten && fflush(file) != 0) {
+                fWritten = error("%s: unable to flush file %s", __func__, filePath.string());
+                CloseFile();
+            }
+        }
+
+        {
+            LOCK(cs);
+            if (fWritten) {
+                for (size_t i = 0; i < vWrites.size(); i++) {
+                    nQueueSize -= queue.front().data.size();
+                    queue.pop_front();
+                }
+            } else {
+                fFailed = true;
+            }
+        }
+        cvWritten.notify_all();
+        vWrites.clear();
+    }
+}
+
+bool FlatFileWriter::Write(const fs::path& path, size_t nPos, std::vector<unsigned char>&& data)
+{
+    PendingWrite write{path, nPos, std::move(data)};
+    if (!fRunning) {
+        LOCK(cs_file);
+        if (!WriteData(write)) return false;
+        if (fflush(file) != 0) {
+            CloseFile();
+            return error("%s: unable to flush file %s", __func__, path.string());
+        }
+        return true;
+    }
+    {
+        WAIT_LOCK(cs, lock);
+        cvWritten.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return nQueueSize < nMaxQueueSize || fFailed; });
+        if (fFailed) {
+            return error("%s: a previous write failed, unable to write at position %u of %s", __func__, nPos, path.string());
+        }
+        nQueueSize += write.data.size();
+        queue.emplace_back(std::move(write));
+    }
+    cvQueued.notify_one();
+    return true;
+}
+
+bool FlatFileWriter::Read(const fs::path& path, size_t nPos, unsigned char* out, size_t nSize)
+{
+    LOCK(cs);
+    // The last write of a position is the one read
+    for (auto it = queue.rbegin(); it != queue.rend(); ++it) {
+        if (it->nPos <= nPos && nPos + nSize <= it->nPos + it->data.size() && it->path == path) {
+            memcpy(out, it->data.data() + (nPos - it->nPos), nSize);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FlatFileWriter::Sync()
+{
+    WAIT_LOCK(cs, lock);
+    cvWritten.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return queue.empty() || fFailed; });
+    return !fFailed;
+}
+
+void FlatFileWriter::Close()
+{
+    LOCK(cs_file);
+    CloseFile();
+}
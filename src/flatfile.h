@@ -6,10 +6,17 @@
 #ifndef BITCOIN_FLATFILE_H
 #define BITCOIN_FLATFILE_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "fs.h"
 #include "serialize.h"
+#include "sync.h"
 
 struct FlatFilePos
 {
@@ -87,4 +94,105 @@ public:
     bool Flush(const FlatFilePos& pos, bool finalize = false);
 };
 
+/**
+ * Reads of the data already written in flat files, through read-only memory mappings of the whole files.
+ * The mappings of the last nMaxFiles files read are kept, and a read past the end of a mapping maps the file
+ * again, as the last file of a sequence grows. On Windows and 32 bit systems the reads go through a FILE.
+ * The mappings are left to the process exit, unless dropped with Close or Clear.
+ */
+class FlatFileReader
+{
+private:
+    struct Mapping {
+        const unsigned char* data;
+        size_t size;
+        int64_t nLastUse;
+    };
+
+    const size_t nMaxFiles;
+    Mutex cs;
+    std::map<std::string, Mapping> mapMappings GUARDED_BY(cs);
+    int64_t nUseCounter GUARDED_BY(cs){0};
+
+    void Unmap(std::map<std::string, Mapping>::iterator it) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    explicit FlatFileReader(size_t nMaxFilesIn) : nMaxFiles(nMaxFilesIn) {}
+
+    FlatFileReader(const FlatFileReader&) = delete;
+    FlatFileReader& operator=(const FlatFileReader&) = delete;
+
+    /** Copy the nSize bytes at nPos of the file into out. */
+    bool Read(const fs::path& path, size_t nPos, unsigned char* out, size_t nSize);
+
+    /** Drop the mapping of a file, before it is truncated. */
+    void Close(const fs::path& path);
+
+    /** Drop all the mappings. */
+    void Clear();
+};
+
+/**
+ * Write-behind writes of flat files. Write queues the data to write at a position of a file, and the
+ * thread started by Start writes the queued data in order, flushed to the OS, so that the reads of
+ * the files (e.g. through a FlatFileReader) find it. Until then, Read finds the data in the queue.
+ * Sync waits for the queue to be written: call it before committing a file to disk, and before
+ * writing the positions of its data elsewhere, so that they never refer to missing data after a crash.
+ * When the thread is not running, Write writes the data right away.
+ */
+class FlatFileWriter
+{
+private:
+    struct PendingWrite {
+        fs::path path;
+        size_t nPos;
+        std::vector<unsigned char> data;
+    };
+
+    const size_t nMaxQueueSize;
+    Mutex cs;
+    std::condition_variable cvQueued;
+    std::condition_variable cvWritten;
+    // The elements are popped by the writer thread only, once written
+    std::deque<PendingWrite> queue GUARDED_BY(cs);
+    size_t nQueueSize GUARDED_BY(cs){0};    // bytes queued
+    bool fInterrupted GUARDED_BY(cs){false};
+    bool fFailed GUARDED_BY(cs){false};     // a write failed: the data is kept in the queue
+    std::atomic<bool> fRunning{false};
+    std::thread writerThread;
+
+    // The file written to, kept open between the writes
+    Mutex cs_file;
+    FILE* file GUARDED_BY(cs_file){nullptr};
+    fs::path filePath GUARDED_BY(cs_file);
+
+    bool WriteData(const PendingWrite& write) EXCLUSIVE_LOCKS_REQUIRED(cs_file);
+    void CloseFile() EXCLUSIVE_LOCKS_REQUIRED(cs_file);
+    void ThreadWrite();
+
+public:
+    /** Write blocks while more than nMaxQueueSizeIn bytes are queued */
+    explicit FlatFileWriter(size_t nMaxQueueSizeIn) : nMaxQueueSize(nMaxQueueSizeIn) {}
+    ~FlatFileWriter();
+
+    FlatFileWriter(const FlatFileWriter&) = delete;
+    FlatFileWriter& operator=(const FlatFileWriter&) = delete;
+
+    void Start(const std::string& strThreadName);
+    /** Write the queued data, then stop the thread. */
+    void Stop();
+
+    /** Queue the data to write at nPos of the file. False if the data can't be written. */
+    bool Write(const fs::path& path, size_t nPos, std::vector<unsigned char>&& data);
+
+    /** Copy the nSize bytes at nPos of the file into out, if they are in the queue. */
+    bool Read(const fs::path& path, size_t nPos, unsigned char* out, size_t nSize);
+
+    /** Wait for the queued data to be written. False if a write failed. */
+    bool Sync();
+
+    /** Close the file written to, e.g. before truncating it. */
+    void Close();
+};
+
 #endif // BITCOIN_FLATFILE_H
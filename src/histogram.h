@@ -0,0 +1,55 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_HISTOGRAM_H
+#define PIVX_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+
+/**
+ * Histogram of durations, in microseconds, over fixed buckets. Bounds::VALUES is the sorted array of
+ * the upper bounds (included) of the buckets, and one more bucket, the last one, counts the durations
+ * over the last bound. The negative durations, of a clock going backwards, are counted as 0.
+ */
+template <typename Bounds>
+struct FixedHistogram
+{
+    static constexpr size_t BUCKET_COUNT = std::tuple_size<typename std::remove_const<decltype(Bounds::VALUES)>::type>::value + 1;
+
+    uint64_t nCount{0};
+    int64_t nTotalMicros{0};
+    int64_t nMaxMicros{0};
+    std::array<uint64_t, BUCKET_COUNT> vBuckets{};
+
+    void Add(int64_t nMicros)
+    {
+        nMicros = std::max(nMicros, (int64_t)0);
+        const auto it = std::lower_bound(Bounds::VALUES.begin(), Bounds::VALUES.end(), nMicros);
+        vBuckets[it - Bounds::VALUES.begin()]++;
+        nCount++;
+        nTotalMicros += nMicros;
+        nMaxMicros = std::max(nMaxMicros, nMicros);
+    }
+
+    void Add(const FixedHistogram& other)
+    {
+        for (size_t i = 0; i < BUCKET_COUNT; i++) {
+            vBuckets[i] += other.vBuckets[i];
+        }
+        nCount += other.nCount;
+        nTotalMicros += other.nTotalMicros;
+        nMaxMicros = std::max(nMaxMicros, other.nMaxMicros);
+    }
+
+    int64_t GetAverageMicros() const { return nCount ? nTotalMicros / (int64_t)nCount : 0; }
+};
+
+template <typename Bounds>
+constexpr size_t FixedHistogram<Bounds>::BUCKET_COUNT;
+
+#endif // PIVX_HISTOGRAM_H
@@ -78,6 +78,84 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+/**
+ * Writer of the reply of a successful JSON-RPC request, which serializes the result in parts,
+ * instead of copying it into the reply object and writing that to a single string.
+ * The replies smaller than REPLY_CHUNK_SIZE are sent at once, the larger ones are sent with
+ * chunked transfer encoding, each chunk as soon as it is serialized.
+ */
+class JSONReplyWriter
+{
+private:
+    //! Size of the chunks of the streamed replies
+    static const size_t REPLY_CHUNK_SIZE = 64 * 1024;
+
+    HTTPRequest* req;
+    std::string strBuffer;
+    bool fChunked{false};
+
+    void Flush()
+    {
+        if (!fChunked) {
+            req->WriteHeader("Content-Type", "application/json");
+            fChunked = true;
+        }
+        req->WriteReplyChunk(HTTP_OK, strBuffer);
+        strBuffer.clear();
+    }
+
+    void Append(const std::string& str)
+    {
+        strBuffer += str;
+        if (strBuffer.size() >= REPLY_CHUNK_SIZE) Flush();
+    }
+
+    void WriteValue(const UniValue& val)
+    {
+        if (val.isArray()) {
+            Append("[");
+            for (size_t i = 0; i < val.size(); i++) {
+                if (i > 0) Append(",");
+                WriteValue(val[i]);
+            }
+            Append("]");
+        } else if (val.isObject()) {
+            const std::vector<std::string>& keys = val.getKeys();
+            const std::vector<UniValue>& values = val.getValues();
+            Append("{");
+            for (size_t i = 0; i < keys.size(); i++) {
+                if (i > 0) Append(",");
+                Append(UniValue(keys[i]).write());
+                Append(":");
+                WriteValue(values[i]);
+            }
+            Append("}");
+        } else {
+            Append(val.write());
+        }
+    }
+
+public:
+    explicit JSONReplyWriter(HTTPRequest* _req) : req(_req) {}
+
+    // Same output as JSONRPCReply(result, NullUniValue, id)
+    void WriteReply(const UniValue& result, const UniValue& id)
+    {
+        Append("{\"result\":");
+        WriteValue(result);
+        Append(",\"error\":null,\"id\":");
+        Append(id.write());
+        Append("}\n");
+        if (fChunked) {
+            req->WriteReplyChunk(HTTP_OK, strBuffer);
+            req->WriteReplyEnd();
+        } else {
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, strBuffer);
+        }
+    }
+};
+
 //This function checks username and password against -rpcauth
 //entries from config file.
 static bool multiUserAuthorized(std::string strUserPass)
@@ -139,22 +217,15 @@ static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUserna
     return multiUserAuthorized(strUserPass);
 }
 
-static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
+bool CheckHTTPAuthorization(HTTPRequest* req, std::string& strAuthUsernameOut)
 {
-    // JSONRPC handles only POST
-    if (req->GetRequestMethod() != HTTPRequest::POST) {
-        req->WriteReply(HTTP_BAD_METHOD, "JSONRPC server handles only POST requests");
-        return false;
-    }
-    // Check authorization
     std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
     if (!authHeader.first) {
         req->WriteReply(HTTP_UNAUTHORIZED);
         return false;
     }
 
-    JSONRPCRequest jreq;
-    if (!RPCAuthorized(authHeader.second, jreq.authUser)) {
+    if (!RPCAuthorized(authHeader.second, strAuthUsernameOut)) {
         LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", req->GetPeer().ToString());
 
         /* Deter brute-forcing
@@ -165,6 +236,74 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         req->WriteReply(HTTP_UNAUTHORIZED);
         return false;
     }
+    return true;
+}
+
+//! Largest request body classified by its method, the larger ones are NORMAL
+static const size_t MAX_CLASSIFIED_BODY_SIZE = 4096;
+
+/**
+ * The methods scheduled differently from the NORMAL ones in the work queue: the cheap
+ * monitoring calls are HIGH, so that they keep a low latency under load, and the expensive calls,
+ * which can take a worker for minutes, are LOW and limited in concurrency.
+ */
+static const std::map<std::string, HTTPRequestClass> mapRPCMethodClasses = {
+    {"getbestblockhash",    {HTTPPriority::HIGH, "", 0}},
+    {"getblockchaininfo",   {HTTPPriority::HIGH, "", 0}},
+    {"getblockcount",       {HTTPPriority::HIGH, "", 0}},
+    {"getblockhash",        {HTTPPriority::HIGH, "", 0}},
+    {"getconnectioncount",  {HTTPPriority::HIGH, "", 0}},
+    {"getinfo",             {HTTPPriority::HIGH, "", 0}},
+    {"getmasternodecount",  {HTTPPriority::HIGH, "", 0}},
+    {"getmempoolinfo",      {HTTPPriority::HIGH, "", 0}},
+    {"getnetworkinfo",      {HTTPPriority::HIGH, "", 0}},
+    {"getrpcqueueinfo",     {HTTPPriority::HIGH, "", 0}},
+    {"getstakingstatus",    {HTTPPriority::HIGH, "", 0}},
+    {"mnsync",              {HTTPPriority::HIGH, "", 0}},
+    {"ping",                {HTTPPriority::HIGH, "", 0}},
+    {"dumptxoutset",        {HTTPPriority::LOW, "", 1}},
+    {"dumpwallet",          {HTTPPriority::LOW, "", 1}},
+    {"getblockindexstats",  {HTTPPriority::LOW, "", 1}},
+    {"getsupplyinfo",       {HTTPPriority::LOW, "", 1}},
+    {"gettxoutsetinfo",     {HTTPPriority::LOW, "", 1}},
+    {"importaddress",       {HTTPPriority::LOW, "", 1}},
+    {"importprivkey",       {HTTPPriority::LOW, "", 1}},
+    {"importwallet",        {HTTPPriority::LOW, "", 1}},
+    {"listsinceblock",      {HTTPPriority::LOW, "", 2}},
+    {"listtransactions",    {HTTPPriority::LOW, "", 2}},
+    {"rescanblockchain",    {HTTPPriority::LOW, "", 1}},
+    {"scantxoutset",        {HTTPPriority::LOW, "", 1}},
+    {"verifychain",         {HTTPPriority::LOW, "", 1}},
+    {"verifytxoutset",      {HTTPPriority::LOW, "", 1}},
+};
+
+static HTTPRequestClass ClassifyJSONRPC(HTTPRequest* req)
+{
+    std::string strBody;
+    UniValue valRequest;
+    if (!req->PeekBody(strBody, MAX_CLASSIFIED_BODY_SIZE) || !valRequest.read(strBody) || !valRequest.isObject()) {
+        return HTTPRequestClass();
+    }
+    const UniValue& method = find_value(valRequest.get_obj(), "method");
+    if (!method.isStr()) return HTTPRequestClass();
+    auto it = mapRPCMethodClasses.find(method.get_str());
+    if (it == mapRPCMethodClasses.end()) return HTTPRequestClass();
+    HTTPRequestClass cls = it->second;
+    cls.group = it->first;
+    return cls;
+}
+
+static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
+{
+    // JSONRPC handles only POST
+    if (req->GetRequestMethod() != HTTPRequest::POST) {
+        req->WriteReply(HTTP_BAD_METHOD, "JSONRPC server handles only POST requests");
+        return false;
+    }
+    JSONRPCRequest jreq;
+    if (!CheckHTTPAuthorization(req, jreq.authUser)) {
+        return false;
+    }
 
     try {
         // Parse request
@@ -175,7 +314,6 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
@@ -183,16 +321,15 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            JSONReplyWriter(req).WriteReply(result, jreq.id);
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
+        } else if (valRequest.isArray()) {
+            std::string strReply = JSONRPCExecBatch(valRequest.get_array());
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, strReply);
+        } else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
-
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
@@ -227,10 +364,10 @@ bool StartHTTPRPC()
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, ClassifyJSONRPC);
 #ifdef ENABLE_WALLET
     // ifdef can be removed once we switch to better endpoint support and API versioning
-    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC, ClassifyJSONRPC);
 #endif
     assert(EventBase());
     httpRPCTimerInterface = std::make_unique<HTTPRPCTimerInterface>(EventBase());
@@ -22,6 +22,10 @@ void InterruptHTTPRPC();
  */
 void StopHTTPRPC();
 
+/** Check the RPC credentials of a request. Replies HTTP_UNAUTHORIZED if they are missing or wrong.
+ */
+bool CheckHTTPAuthorization(HTTPRequest* req, std::string& strAuthUsernameOut);
+
 /** Start HTTP REST subsystem.
  * Precondition; HTTP and RPC has been started.
  */
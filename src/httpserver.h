@@ -9,6 +9,7 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -37,13 +38,38 @@ void StopHTTPServer();
  * libevent doesn't support debug logging.*/
 bool UpdateHTTPServerLogging(bool enable);
 
+/** Priority classes of the work queue: the queued requests of a class are handled before the
+ * ones of the following classes, and each class has its own -rpcworkqueue depth.
+ * At most -rpcthreads - 1 LOW requests are handled at once, so that a worker is left for the others.
+ * With -rpcthreads=1 the single worker handles the LOW requests too, after the queued HIGH and
+ * NORMAL ones, and none is left for them while it handles one.
+ */
+enum class HTTPPriority {
+    HIGH,
+    NORMAL,
+    LOW,
+};
+static const int HTTP_PRIORITY_COUNT = 3;
+
+/** How a request is scheduled in the work queue */
+struct HTTPRequestClass
+{
+    HTTPPriority priority{HTTPPriority::NORMAL};
+    //! At most nMaxConcurrent requests of a group are handled at once (0 for no limit)
+    std::string group;
+    int nMaxConcurrent{0};
+};
+
 /** Handler for requests to a certain HTTP path */
 typedef std::function<void(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Classifier of the requests to a certain HTTP path, called on the event loop thread */
+typedef std::function<HTTPRequestClass(HTTPRequest* req)> HTTPRequestClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Without classifier, the requests are NORMAL.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         const HTTPRequestClassifier& classifier = nullptr);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -52,6 +78,20 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** Statistics of the requests of a priority class, since the start of the HTTP server */
+struct HTTPQueueStats
+{
+    size_t nQueued{0};       //! Requests waiting in the queue
+    size_t nRunning{0};      //! Requests being handled
+    uint64_t nHandled{0};    //! Requests dequeued
+    uint64_t nRejected{0};   //! Requests rejected as the queue was full
+    int64_t nTotalWaitMicros{0};
+    int64_t nMaxWaitMicros{0};
+};
+
+/** Statistics of the work queue, indexed by HTTPPriority */
+std::vector<HTTPQueueStats> GetHTTPQueueStats();
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -60,6 +100,7 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    bool replyStarted;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -99,6 +140,12 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Copy the request body if it is not larger than nMaxSize, without consuming it.
+     * Return false if it is larger.
+     */
+    bool PeekBody(std::string& strBody, size_t nMaxSize);
+
     /**
      * Write output header.
      *
@@ -115,6 +162,22 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write a part of a HTTP reply, sent with chunked transfer encoding.
+     * The first call sends the headers, with the status code nStatus.
+     *
+     * @note Call WriteReplyEnd to complete the reply, instead of WriteReply.
+     * Do not call WriteHeader after the first call.
+     */
+    void WriteReplyChunk(int nStatus, const std::string& strChunk);
+
+    /**
+     * Complete the HTTP reply written with WriteReplyChunk.
+     *
+     * @note Same as WriteReply, do not call any other HTTPRequest methods after calling this.
+     */
+    void WriteReplyEnd();
 };
 
 /** Event handler closure.
@@ -0,0 +1,159 @@
+// Copyright (c) 2015-2021 The Bitcoin Core developers
+// Copyright (c) 2018-2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_HTTPWORKQUEUE_H
+#define PIVX_HTTPWORKQUEUE_H
+
+#include "httpserver.h"
+#include "utiltime.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** Work queue for distributing work over multiple threads.
+ * Work items are simply callable objects, queued by priority class. A worker takes the first
+ * item of the highest priority class whose limits of concurrently handled items are not reached.
+ */
+template <typename WorkItem>
+class WorkQueue
+{
+private:
+    struct QueuedItem {
+        WorkItem* item;
+        HTTPRequestClass cls;
+        int64_t nTimeQueued;
+    };
+
+    /** Mutex protects entire object */
+    std::mutex cs;
+    std::condition_variable cond;
+    /* XXX in C++11 we can use std::unique_ptr here and avoid manual cleanup */
+    std::deque<QueuedItem> queue[HTTP_PRIORITY_COUNT];
+    HTTPQueueStats stats[HTTP_PRIORITY_COUNT];
+    //! Items of the limited groups being handled
+    std::map<std::string, int> mapGroupRunning;
+    bool running;
+    size_t maxDepth;
+    //! LOW items being handled at most
+    int maxLowRunning;
+
+    bool CanRun(const QueuedItem& queued) const
+    {
+        if (queued.cls.priority == HTTPPriority::LOW && (int)stats[(int)HTTPPriority::LOW].nRunning >= maxLowRunning) {
+            return false;
+        }
+        if (queued.cls.nMaxConcurrent <= 0) return true;
+        auto it = mapGroupRunning.find(queued.cls.group);
+        return it == mapGroupRunning.end() || it->second < queued.cls.nMaxConcurrent;
+    }
+
+    bool Empty() const
+    {
+        for (const auto& q : queue) {
+            if (!q.empty()) return false;
+        }
+        return true;
+    }
+
+    /** Remove the next item to handle from the queue into out. Return false if none can run. */
+    bool Pop(QueuedItem& out)
+    {
+        for (auto& q : queue) {
+            for (auto it = q.begin(); it != q.end(); ++it) {
+                if (!CanRun(*it)) continue;
+                out = *it;
+                q.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    /** A work queue for nWorkers threads: the LOW items are left one worker, unless it is the only one */
+    WorkQueue(size_t _maxDepth, int nWorkers) : running(true),
+                                 maxDepth(_maxDepth),
+                                 maxLowRunning(nWorkers > 1 ? nWorkers - 1 : 1)
+    {
+    }
+    /** Precondition: worker threads have all stopped (they have been joined).
+     */
+    ~WorkQueue()
+    {
+        for (auto& q : queue) {
+            for (const QueuedItem& queued : q) {
+                delete queued.item;
+            }
+        }
+    }
+    /** Enqueue a work item */
+    bool Enqueue(WorkItem* item, const HTTPRequestClass& cls)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        const int nClass = (int)cls.priority;
+        if (!running || queue[nClass].size() >= maxDepth) {
+            stats[nClass].nRejected++;
+            return false;
+        }
+        queue[nClass].push_back({item, cls, GetTimeMicros()});
+        cond.notify_one();
+        return true;
+    }
+    /** Thread function */
+    void Run()
+    {
+        while (true) {
+            QueuedItem queued;
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                while (!Pop(queued)) {
+                    if (!running && Empty())
+                        return;
+                    cond.wait(lock);
+                }
+                HTTPQueueStats& s = stats[(int)queued.cls.priority];
+                const int64_t nWait = GetTimeMicros() - queued.nTimeQueued;
+                s.nHandled++;
+                s.nRunning++;
+                s.nTotalWaitMicros += nWait;
+                s.nMaxWaitMicros = std::max(s.nMaxWaitMicros, nWait);
+                if (queued.cls.nMaxConcurrent > 0) mapGroupRunning[queued.cls.group]++;
+            }
+            (*queued.item)();
+            delete queued.item;
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                stats[(int)queued.cls.priority].nRunning--;
+                if (queued.cls.nMaxConcurrent > 0 && --mapGroupRunning[queued.cls.group] == 0) {
+                    mapGroupRunning.erase(queued.cls.group);
+                }
+                // The items held back by their limits may run now
+                cond.notify_all();
+            }
+        }
+    }
+    /** Interrupt and exit loops */
+    void Interrupt()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        running = false;
+        cond.notify_all();
+    }
+    std::vector<HTTPQueueStats> GetStats()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        std::vector<HTTPQueueStats> ret(stats, stats + HTTP_PRIORITY_COUNT);
+        for (int i = 0; i < HTTP_PRIORITY_COUNT; i++) {
+            ret[i].nQueued = queue[i].size();
+        }
+        return ret;
+    }
+};
+
+#endif // PIVX_HTTPWORKQUEUE_H
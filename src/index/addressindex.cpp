@@ -0,0 +1,226 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/addressindex.h"
+
+#include "chain.h"
+#include "coins.h"
+#include "crypto/sha256.h"
+#include "invalid.h"
+#include "script/standard.h"
+#include "undo.h"
+#include "util/system.h"
+#include "validation.h"
+
+constexpr char DB_ADDRESSINDEX = 'a';
+constexpr char DB_ADDRESSUNSPENT = 'u';
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+uint256 GetScriptHash(const CScript& script)
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    return hash;
+}
+
+std::vector<uint256> GetIndexedScriptHashes(const CScript& script)
+{
+    std::vector<uint256> vHashes{GetScriptHash(script)};
+    txnouttype type;
+    std::vector<CTxDestination> vDest;
+    int nRequired;
+    if (ExtractDestinations(script, type, vDest, nRequired) && (type == TX_PUBKEY || type == TX_COLDSTAKE)) {
+        for (const CTxDestination& dest : vDest) {
+            const uint256 hash = GetScriptHash(GetScriptForDestination(dest));
+            if (std::find(vHashes.begin(), vHashes.end(), hash) == vHashes.end()) {
+                vHashes.emplace_back(hash);
+            }
+        }
+    }
+    return vHashes;
+}
+
+// The outputs that never enter the UTXO set are not indexed
+static bool IsIndexedOutput(const CTxOut& out, const COutPoint& outpoint, bool fSkipInvalid)
+{
+    return !out.scriptPubKey.IsUnspendable() && !out.IsZerocoinMint() &&
+           !(fSkipInvalid && invalid_out::ContainsOutPoint(outpoint));
+}
+
+/**
+ * Access to the addressindex database (indexes/addressindex/)
+ *
+ * Besides the block locator of the chain the database is synced to, it stores:
+ * - 'a' + script hash + height + txid + index + spending -> amount
+ * - 'u' + script hash + outpoint -> unspent output value
+ */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe, CDBOptions("addressindex"))
+{}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(new AddressIndex::DB(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+static bool ReadBlockUndo(const CBlock& block, const CBlockIndex* pindex, CBlockUndo& blockundo)
+{
+    // The genesis block has no undo data
+    if (!pindex->pprev) {
+        return true;
+    }
+    if (!UndoReadFromDisk(blockundo, pindex->GetUndoPos(), pindex->pprev->GetBlockHash())) {
+        return error("%s: failed to read the undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: undo data mismatch for block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    return true;
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CBlockUndo blockundo;
+    if (!ReadBlockUndo(block, pindex, blockundo)) {
+        return false;
+    }
+
+    const bool fSkipInvalid = SkipInvalidUTXOS(pindex->nHeight);
+    CDBBatch batch(CLIENT_VERSION);
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+
+        // The spent coins are in the undo data, except for the zerocoin spends
+        if (i > 0 && !tx.HasZerocoinSpendInputs()) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            if (txundo.vprevout.size() != tx.vin.size()) {
+                return error("%s: undo data mismatch for tx %s", __func__, txid.ToString());
+            }
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const CTxOut prevout = txundo.vprevout[j].GetTxOut();
+                for (const uint256& hashScript : GetIndexedScriptHashes(prevout.scriptPubKey)) {
+                    batch.Write(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(hashScript, pindex->nHeight, txid, j, true)), -prevout.nValue);
+                    batch.Erase(std::make_pair(DB_ADDRESSUNSPENT, std::make_pair(hashScript, tx.vin[j].prevout)));
+                }
+            }
+        }
+
+        for (size_t j = 0; j < tx.vout.size(); j++) {
+            const CTxOut& out = tx.vout[j];
+            const COutPoint outpoint(txid, j);
+            if (!IsIndexedOutput(out, outpoint, fSkipInvalid)) continue;
+            for (const uint256& hashScript : GetIndexedScriptHashes(out.scriptPubKey)) {
+                batch.Write(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(hashScript, pindex->nHeight, txid, j, false)), out.nValue);
+                batch.Write(std::make_pair(DB_ADDRESSUNSPENT, std::make_pair(hashScript, outpoint)),
+                            CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight));
+            }
+        }
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool AddressIndex::RewindBlock(const CBlockIndex* pindex)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex)) {
+        return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+    }
+    CBlockUndo blockundo;
+    if (!ReadBlockUndo(block, pindex, blockundo)) {
+        return false;
+    }
+
+    // The transactions are undone in reverse order, so that the outputs created and spent in the
+    // block are not restored to the unspent ones.
+    CDBBatch batch(CLIENT_VERSION);
+    for (size_t i = block.vtx.size(); i-- > 0;) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+
+        for (size_t j = 0; j < tx.vout.size(); j++) {
+            const COutPoint outpoint(txid, j);
+            for (const uint256& hashScript : GetIndexedScriptHashes(tx.vout[j].scriptPubKey)) {
+                batch.Erase(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(hashScript, pindex->nHeight, txid, j, false)));
+                batch.Erase(std::make_pair(DB_ADDRESSUNSPENT, std::make_pair(hashScript, outpoint)));
+            }
+        }
+
+        if (i > 0 && !tx.HasZerocoinSpendInputs()) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            if (txundo.vprevout.size() != tx.vin.size()) {
+                return error("%s: undo data mismatch for tx %s", __func__, txid.ToString());
+            }
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const Coin& coin = txundo.vprevout[j];
+                for (const uint256& hashScript : GetIndexedScriptHashes(coin.GetScriptPubKey())) {
+                    batch.Erase(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(hashScript, pindex->nHeight, txid, j, true)));
+                    batch.Write(std::make_pair(DB_ADDRESSUNSPENT, std::make_pair(hashScript, tx.vin[j].prevout)),
+                                CAddressUnspentValue(coin.nValue, coin.GetScriptPubKey(), coin.nHeight));
+                }
+            }
+        }
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        if (!RewindBlock(pindex)) {
+            return false;
+        }
+    }
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::FindHistory(const uint256& script_hash, int start_height, int end_height,
+                               std::vector<std::pair<CAddressIndexKey, CAmount>>& entries) const
+{
+    std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(script_hash, std::max(start_height, 0), UINT256_ZERO, 0, false)));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.hashScript != script_hash ||
+                (end_height > 0 && (int)key.second.nHeight > end_height)) {
+            break;
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue)) {
+            return error("%s: failed to read an address index entry", __func__);
+        }
+        entries.emplace_back(key.second, nValue);
+    }
+    return true;
+}
+
+bool AddressIndex::FindUnspent(const uint256& script_hash, std::vector<std::pair<COutPoint, CAddressUnspentValue>>& unspent) const
+{
+    std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENT, std::make_pair(script_hash, COutPoint(UINT256_ZERO, 0))));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, std::pair<uint256, COutPoint>> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENT || key.second.first != script_hash) {
+            break;
+        }
+        CAddressUnspentValue value;
+        if (!pcursor->GetValue(value)) {
+            return error("%s: failed to read an address unspent entry", __func__);
+        }
+        unspent.emplace_back(key.second.second, value);
+    }
+    return true;
+}
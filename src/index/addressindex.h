@@ -0,0 +1,108 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_INDEX_ADDRESSINDEX_H
+#define PIVX_INDEX_ADDRESSINDEX_H
+
+#include "amount.h"
+#include "index/base.h"
+#include "script/script.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <vector>
+
+//! -addressindex default
+static const bool DEFAULT_ADDRESSINDEX = false;
+
+/** The key of the scripts in the address index: the single SHA256 of the scriptPubKey */
+uint256 GetScriptHash(const CScript& script);
+
+/**
+ * The script hashes an output is indexed under: the one of its scriptPubKey and, for the P2PK and
+ * P2CS outputs, also the ones of the P2PKH scripts of their keys (the owner and staker of a P2CS),
+ * so that they are found looking up the address.
+ */
+std::vector<uint256> GetIndexedScriptHashes(const CScript& script);
+
+/** An entry of the history of a script: an output paying it, or an input spending one of those */
+struct CAddressIndexKey
+{
+    uint256 hashScript;
+    uint32_t nHeight{0};
+    uint256 txid;
+    uint32_t nIndex{0};     // output index, or input index when fSpending
+    bool fSpending{false};
+
+    CAddressIndexKey() {}
+    CAddressIndexKey(const uint256& _hashScript, int _nHeight, const uint256& _txid, uint32_t _nIndex, bool _fSpending) :
+        hashScript(_hashScript), nHeight(_nHeight), txid(_txid), nIndex(_nIndex), fSpending(_fSpending) {}
+
+    // The height is big endian, so that the entries of a script are sorted by height in the database
+    SERIALIZE_METHODS(CAddressIndexKey, obj)
+    {
+        READWRITE(obj.hashScript, Using<BigEndianFormatter<4>>(obj.nHeight), obj.txid, Using<BigEndianFormatter<4>>(obj.nIndex), obj.fSpending);
+    }
+};
+
+/** An unspent output of a script */
+struct CAddressUnspentValue
+{
+    CAmount nValue{0};
+    CScript scriptPubKey;
+    int nHeight{0};
+
+    CAddressUnspentValue() {}
+    CAddressUnspentValue(CAmount _nValue, const CScript& _scriptPubKey, int _nHeight) :
+        nValue(_nValue), scriptPubKey(_scriptPubKey), nHeight(_nHeight) {}
+
+    SERIALIZE_METHODS(CAddressUnspentValue, obj) { READWRITE(obj.nValue, obj.scriptPubKey, obj.nHeight); }
+};
+
+/**
+ * AddressIndex maps the scripts to the outputs paying them, with their spends, and to their
+ * unspent outputs. The index is written to a LevelDB database whose records are keyed by script
+ * hash, so that the history and the unspent outputs of a script are read with a range scan.
+ * It is built from the blocks and their undo data, and rolled back when blocks are disconnected.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// Undo the entries written for the block pindex
+    bool RewindBlock(const CBlockIndex* pindex);
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Look up the history of a script, in the heights range [start_height, end_height] (end_height 0 for
+    /// no upper bound). The values are the amounts received, and spent (negative).
+    bool FindHistory(const uint256& script_hash, int start_height, int end_height,
+                     std::vector<std::pair<CAddressIndexKey, CAmount>>& entries) const;
+
+    /// Look up the unspent outputs of a script.
+    bool FindUnspent(const uint256& script_hash, std::vector<std::pair<COutPoint, CAddressUnspentValue>>& unspent) const;
+};
+
+/// The global address index, used by the address RPCs. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // PIVX_INDEX_ADDRESSINDEX_H
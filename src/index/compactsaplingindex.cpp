@@ -0,0 +1,128 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/compactsaplingindex.h"
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "util/system.h"
+
+constexpr char DB_COMPACT_BLOCK = 'c';
+
+std::unique_ptr<CompactSaplingIndex> g_compactsaplingindex;
+
+// The height is big endian, so that the blocks are sorted by height in the database
+struct CompactBlockKey
+{
+    uint32_t nHeight{0};
+
+    CompactBlockKey() {}
+    explicit CompactBlockKey(int _nHeight) : nHeight(_nHeight) {}
+
+    SERIALIZE_METHODS(CompactBlockKey, obj) { READWRITE(Using<BigEndianFormatter<4>>(obj.nHeight)); }
+};
+
+CCompactSaplingBlock MakeCompactSaplingBlock(const CBlock& block, int nHeight)
+{
+    CCompactSaplingBlock ret;
+    ret.nHeight = nHeight;
+    ret.hash = block.GetHash();
+    ret.hashPrevBlock = block.hashPrevBlock;
+    ret.nTime = block.nTime;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (!tx.IsShieldedTx() || !tx.sapData ||
+                (tx.sapData->vShieldedSpend.empty() && tx.sapData->vShieldedOutput.empty())) {
+            continue;
+        }
+        CCompactSaplingTx ctx;
+        ctx.nIndex = i;
+        ctx.txid = tx.GetHash();
+        ctx.vNullifiers.reserve(tx.sapData->vShieldedSpend.size());
+        for (const SpendDescription& spend : tx.sapData->vShieldedSpend) {
+            ctx.vNullifiers.emplace_back(spend.nullifier);
+        }
+        ctx.vOutputs.resize(tx.sapData->vShieldedOutput.size());
+        for (size_t j = 0; j < tx.sapData->vShieldedOutput.size(); j++) {
+            const OutputDescription& output = tx.sapData->vShieldedOutput[j];
+            CCompactSaplingOutput& compactOutput = ctx.vOutputs[j];
+            compactOutput.cmu = output.cmu;
+            compactOutput.ephemeralKey = output.ephemeralKey;
+            std::copy(output.encCiphertext.begin(), output.encCiphertext.begin() + COMPACT_NOTE_CIPHERTEXT_SIZE, compactOutput.encCiphertext.begin());
+        }
+        ret.vtx.emplace_back(std::move(ctx));
+    }
+    return ret;
+}
+
+/**
+ * Access to the compactsaplingindex database (indexes/compactsaplingindex/)
+ *
+ * Besides the block locator of the chain the database is synced to, it stores:
+ * - 'c' + height -> compact block, for the blocks of the chain with shielded transactions
+ */
+class CompactSaplingIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+CompactSaplingIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "compactsaplingindex", n_cache_size, f_memory, f_wipe, CDBOptions("compactsaplingindex"))
+{}
+
+CompactSaplingIndex::CompactSaplingIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(new CompactSaplingIndex::DB(n_cache_size, f_memory, f_wipe))
+{}
+
+CompactSaplingIndex::~CompactSaplingIndex() {}
+
+bool CompactSaplingIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    const CCompactSaplingBlock compactBlock = MakeCompactSaplingBlock(block, pindex->nHeight);
+    const auto key = std::make_pair(DB_COMPACT_BLOCK, CompactBlockKey(pindex->nHeight));
+    if (compactBlock.vtx.empty()) {
+        // a block of a stale chain may have been indexed at this height (the sync restarts from the fork point)
+        return m_db->Erase(key);
+    }
+    return m_db->Write(key, compactBlock);
+}
+
+bool CompactSaplingIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // The records of the disconnected blocks are the ones above the new tip
+    CDBBatch batch(CLIENT_VERSION);
+    std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+    pcursor->Seek(std::make_pair(DB_COMPACT_BLOCK, CompactBlockKey(new_tip->nHeight + 1)));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, CompactBlockKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_COMPACT_BLOCK || (int)key.second.nHeight > current_tip->nHeight) {
+            break;
+        }
+        batch.Erase(key);
+    }
+    if (!m_db->WriteBatch(batch)) {
+        return error("%s: failed to rewind the compact blocks above height %d", __func__, new_tip->nHeight);
+    }
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& CompactSaplingIndex::GetDB() const { return *m_db; }
+
+bool CompactSaplingIndex::FindBlocks(int start_height, int end_height, std::vector<CDataStream>& blocks) const
+{
+    std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+    pcursor->Seek(std::make_pair(DB_COMPACT_BLOCK, CompactBlockKey(std::max(start_height, 0))));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, CompactBlockKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_COMPACT_BLOCK || (int)key.second.nHeight > end_height) {
+            break;
+        }
+        // served as they are stored
+        blocks.emplace_back(pcursor->GetValue());
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_INDEX_COMPACTSAPLINGINDEX_H
+#define PIVX_INDEX_COMPACTSAPLINGINDEX_H
+
+#include "index/base.h"
+#include "sapling/sapling.h"
+#include "serialize.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include <array>
+#include <vector>
+
+//! -compactsaplingindex default
+static const bool DEFAULT_COMPACTSAPLINGINDEX = false;
+
+/** Size of the compact ciphertext of an output: the leading byte, diversifier, value and rcm of the note */
+static const size_t COMPACT_NOTE_CIPHERTEXT_SIZE = ZC_NOTEPLAINTEXT_LEADING + ZC_DIVERSIFIER_SIZE + ZC_V_SIZE + ZC_R_SIZE;
+
+/**
+ * The part of an OutputDescription a light wallet needs to detect its notes (trial-decrypting the
+ * compact ciphertext, without the memo and the authentication tag) and to update its witnesses.
+ */
+struct CCompactSaplingOutput
+{
+    uint256 cmu;
+    uint256 ephemeralKey;
+    std::array<unsigned char, COMPACT_NOTE_CIPHERTEXT_SIZE> encCiphertext{};
+
+    SERIALIZE_METHODS(CCompactSaplingOutput, obj) { READWRITE(obj.cmu, obj.ephemeralKey, obj.encCiphertext); }
+};
+
+/** The shielded spends and outputs of a transaction: the nullifiers of the spends, and the compact outputs */
+struct CCompactSaplingTx
+{
+    uint32_t nIndex{0};     // position in the block
+    uint256 txid;
+    std::vector<uint256> vNullifiers;
+    std::vector<CCompactSaplingOutput> vOutputs;
+
+    SERIALIZE_METHODS(CCompactSaplingTx, obj) { READWRITE(VARINT(obj.nIndex), obj.txid, obj.vNullifiers, obj.vOutputs); }
+};
+
+/** The shielded transactions of a block, with the header data a light wallet needs to follow the chain */
+struct CCompactSaplingBlock
+{
+    uint32_t nHeight{0};
+    uint256 hash;
+    uint256 hashPrevBlock;
+    uint32_t nTime{0};
+    std::vector<CCompactSaplingTx> vtx;
+
+    SERIALIZE_METHODS(CCompactSaplingBlock, obj) { READWRITE(obj.nHeight, obj.hash, obj.hashPrevBlock, obj.nTime, obj.vtx); }
+};
+
+/** The compact data of the shielded transactions of the block at height nHeight (vtx empty if there are none) */
+CCompactSaplingBlock MakeCompactSaplingBlock(const CBlock& block, int nHeight);
+
+/**
+ * CompactSaplingIndex keeps, for the blocks with shielded transactions, their compact form: the
+ * nullifiers, note commitments, ephemeral keys and compact ciphertexts, a small fraction of the
+ * block size. The records are keyed by height, so that a range of blocks is served with a range
+ * scan of the already serialized data. Used by the /rest/compactsaplingblocks endpoint.
+ */
+class CompactSaplingIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "compactsaplingindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit CompactSaplingIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~CompactSaplingIndex() override;
+
+    /// Look up the serialized compact blocks of the heights range [start_height, end_height], in height
+    /// order. The blocks without shielded transactions are skipped.
+    bool FindBlocks(int start_height, int end_height, std::vector<CDataStream>& blocks) const;
+};
+
+/// The global compact sapling blocks index. May be null.
+extern std::unique_ptr<CompactSaplingIndex> g_compactsaplingindex;
+
+#endif // PIVX_INDEX_COMPACTSAPLINGINDEX_H
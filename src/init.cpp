@@ -17,23 +17,39 @@
 #include "activemasternode.h"
 #include "addrman.h"
 #include "amount.h"
+#include "blockpipeline.h"
 #include "bls/bls_wrapper.h"
+#include "cachebalancer.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/upgrades.h"
+#include "consensus/zerocoin_verify.h"
+#include "crypto/sha256.h"
+#include "evo/deterministicmns.h"
+#include "evo/evodb.h"
+#include "evo/specialtx_validation.h"
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "index/addressindex.h"
+#include "index/compactsaplingindex.h"
+#include "index/blockfilterindex.h"
+#include "index/txindex.h"
 #include "invalid.h"
 #include "key.h"
+#include "llmq/quorums_signing.h"
 #include "mapport.h"
+#include "memorybudget.h"
+#include "metrics.h"
 #include "miner.h"
 #include "netbase.h"
 #include "net_processing.h"
 #include "policy/feerate.h"
 #include "policy/policy.h"
 #include "rpc/register.h"
+#include "rpc/responsecache.h"
 #include "rpc/server.h"
+#include "sapling/sapling_validation.h"
 #include "script/sigcache.h"
 #include "script/standard.h"
 #include "scheduler.h"
@@ -43,11 +59,13 @@
 #include "tiertwo/init.h"
 #include "txdb.h"
 #include "torcontrol.h"
+#include "txreconciliation.h"
 #include "guiinterface.h"
 #include "guiinterfaceutil.h"
 #include "util/system.h"
 #include "utilmoneystr.h"
 #include "util/threadnames.h"
+#include "utxocommitment.h"
 #include "validation.h"
 #include "validationinterface.h"
 #include "warnings.h"
@@ -60,6 +78,7 @@
 
 #include <atomic>
 #include <fstream>
+#include <future>
 #include <stdint.h>
 #include <stdio.h>
 #include <memory>
@@ -77,6 +96,7 @@
 #include <boost/thread.hpp>
 
 #if ENABLE_ZMQ
+#include "zmq/zmqabstractnotifier.h"
 #include "zmq/zmqnotificationinterface.h"
 #endif
 
@@ -86,6 +106,7 @@ static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
 static const bool DEFAULT_DISABLE_SAFEMODE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
+static const bool DEFAULT_LAZY_SAPLING_PARAMS = false;
 
 std::unique_ptr<CConnman> g_connman;
 std::unique_ptr<PeerLogicValidation> peerLogic;
@@ -182,7 +203,19 @@ static std::unique_ptr<CCoinsViewErrorCatcher> pcoinscatcher;
 static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 
 static boost::thread_group threadGroup;
+/**
+ * The scheduled tasks run on independent lanes, each serviced by its own thread, so that a
+ * slow dump doesn't hold back the validation interface callbacks: the validation callbacks
+ * and the light periodic tasks, the tier two maintenance, and the disk dumps and compactions.
+ */
 static CScheduler scheduler;
+static CScheduler schedulerTierTwo;
+static CScheduler schedulerIO;
+
+std::vector<std::pair<std::string, CSchedulerStats>> GetSchedulerLaneStats()
+{
+    return {{"validation", scheduler.GetStats()}, {"tiertwo", schedulerTierTwo.GetStats()}, {"io", schedulerIO.GetStats()}};
+}
 void Interrupt()
 {
     InterruptHTTPServer();
@@ -192,6 +225,17 @@ void Interrupt()
     InterruptTorControl();
     InterruptMapPort();
     InterruptTierTwo();
+    g_block_pipeline.Interrupt();
+    if (g_txindex) {
+        g_txindex->Interrupt();
+    }
+    if (g_addressindex) {
+        g_addressindex->Interrupt();
+    }
+    if (g_compactsaplingindex) {
+        g_compactsaplingindex->Interrupt();
+    }
+    ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
     if (g_connman)
         g_connman->Interrupt();
 }
@@ -213,6 +257,7 @@ void Shutdown()
     mempool.AddTransactionsUpdated(1);
     StopHTTPRPC();
     StopREST();
+    StopMetrics();
     StopRPC();
     StopHTTPServer();
     StopTierTwoThreads();
@@ -228,14 +273,19 @@ void Shutdown()
     // using the other before destroying them.
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
     if (g_connman) g_connman->Stop();
+    // The blocks queued by the message handlers are dropped
+    g_block_pipeline.Stop();
 
     StopTorControl();
 
     // After everything has been shut down, but before things get flushed, stop the
     // CScheduler/checkqueue threadGroup
     scheduler.stop();
+    schedulerTierTwo.stop();
+    schedulerIO.stop();
     threadGroup.interrupt_all();
     threadGroup.join_all();
+    g_memory_budget.Clear();
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
@@ -266,6 +316,22 @@ void Shutdown()
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
 
+    // Stop and delete all indexes only after flushing background callbacks.
+    if (g_txindex) {
+        g_txindex->Stop();
+        g_txindex.reset();
+    }
+    if (g_addressindex) {
+        g_addressindex->Stop();
+        g_addressindex.reset();
+    }
+    if (g_compactsaplingindex) {
+        g_compactsaplingindex->Stop();
+        g_compactsaplingindex.reset();
+    }
+    ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
+    DestroyAllBlockFilterIndexes();
+
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
     // would too. The only reason to do the above flushes is to let the wallet catch
@@ -281,14 +347,18 @@ void Shutdown()
             pblocktree->WriteFlag("shutdown", true);
         }
         pcoinsTip.reset();
+        pUTXOCommitment.reset();
         pcoinscatcher.reset();
         pcoinsdbview.reset();
         pblocktree.reset();
         zerocoinDB.reset();
         accumulatorCache.reset();
+        frozenSerials.reset();
         pSporkDB.reset();
         DeleteTierTwo();
     }
+    // The block and undo data left in the write queues
+    StopBlockFileWriters();
 #ifdef ENABLE_WALLET
     for (CWalletRef pwallet : vpwallets) {
         pwallet->Flush(true);
@@ -329,6 +399,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    g_logger->StopAsyncWriter();
 }
 
 /**
@@ -391,8 +462,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", "This help message");
     strUsage += HelpMessageOpt("-version", "Print version and exit");
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)");
+    strUsage += HelpMessageOpt("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script and Sapling proof verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-asyncblockwrites", strprintf("Write the block and undo files on dedicated threads, out of the validation: the data is read from memory until written, and written before the block index refers to it (default: %u)", DEFAULT_ASYNC_BLOCK_WRITES));
     strUsage += HelpMessageOpt("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)");
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)");
+    strUsage += HelpMessageOpt("-blockpipeline", strprintf("Check the blocks downloaded during the headers first sync, read their inputs and connect them on separate threads, at the same time (default: %u)", DEFAULT_BLOCK_PIPELINE));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS));
     strUsage += HelpMessageOpt("-checklevel=<n>", strprintf("How thorough the block verification of -checkblocks is (0-4, default: %u)", DEFAULT_CHECKLEVEL));
 
@@ -405,21 +479,34 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", "Specify data directory");
     if (showDebug) {
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
+        strUsage += HelpMessageOpt("-dbcompactionrate=<n>", strprintf("Compact up to <n> MiB of each database per minute while the node is idle, 0 to leave the compactions to LevelDB (default: %u)", DEFAULT_DB_COMPACTION_RATE));
+        strUsage += HelpMessageOpt("-dbverifyscans", strprintf("Verify the checksums of the database blocks read by the scans. The blocks read by the lookups and the compactions, and the scans of -checkblocks, are always verified (default: %u)", DEFAULT_DB_VERIFY_SCANS));
     }
     strUsage += HelpMessageOpt("-paramsdir=<dir>", strprintf("Specify zk params directory (default: %s)", ZC_GetParamsDir().string()));
+    strUsage += HelpMessageOpt("-lazysaplingparams", strprintf("Only load the Sapling verifying keys on startup, and the proving parameters when the first shielded transaction is created (default: %u, 1 if the wallet is disabled)", DEFAULT_LAZY_SAPLING_PARAMS));
     strUsage += HelpMessageOpt("-debuglogfile=<file>", strprintf("Specify location of debug log file: this can be an absolute path or a path relative to the data directory (default: %s)", DEFAULT_DEBUGLOGFILE));
     strUsage += HelpMessageOpt("-disablesystemnotifications", strprintf("Disable OS notifications for incoming transactions (default: %u)", 0));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf("Set database cache size in megabytes (%d to %d, default: %d)", nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dynamicdbcache", strprintf("Move the in-memory part of the database cache between the coins cache, during the initial block download, and the masternode lists cache, after it, following their miss rates (default: %u)", DEFAULT_DYNAMIC_DBCACHE));
     strUsage += HelpMessageOpt("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup");
+    strUsage += HelpMessageOpt("-chainlockfinality", strprintf("Release the data kept to disconnect the chainlocked blocks, and write the coins cache back on the chainlocks when it is large (default: %u)", DEFAULT_CHAINLOCK_FINALITY));
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf("Set the Maximum reorg depth (default: %u)", DEFAULT_MAX_REORG_DEPTH));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+    strUsage += HelpMessageOpt("-maxmemorybudget=<n>", strprintf("Keep the memory used by the caches (coins, mempool, masternode lists, databases, signatures) below <n> MiB, trimming the less expensive to rebuild first, 0 = only bounded by their own limits (default: %u)", DEFAULT_MAX_MEMORY_BUDGET));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE));
+    strUsage += HelpMessageOpt("-maxmempoolshielded=<n>", strprintf("Keep the shielded transactions of the memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SHIELDED_SIZE));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY));
+    strUsage += HelpMessageOpt("-mempoolclustereviction", strprintf("When the mempool is full, evict the lowest feerate chunks of the transaction clusters, in the order block assembly would leave them out (default: %u)", DEFAULT_MEMPOOL_CLUSTER_EVICTION));
     strUsage += HelpMessageOpt("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL));
-    strUsage += HelpMessageOpt("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)", -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-par=<n>", strprintf("Set the number of script verification threads (%d to %d, 0 = auto, <0 = leave that many cores free, default: %d)", -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-validationcpus=<cpus>", "Restrict the validation threads (script verification, BLS workers, HTTP workers, message handler and block import) to the CPUs of the list, e.g. 0-7,16-23. "
+            "On a NUMA machine, with the CPUs of a node, the threads and the memory they touch first (e.g. the coins cache) stay on it (default: no restriction)");
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf("Specify pid file (default: %s)", PIVX_PID_FILENAME));
 #endif
+    strUsage += HelpMessageOpt("-prune=<n>", strprintf("Reduce storage requirements by pruning (deleting) old blocks. This mode is incompatible with -txindex and -rescan. "
+            "Warning: Reverting this setting requires re-downloading the entire blockchain. "
+            "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks");
     strUsage += HelpMessageOpt("-reindex", "Rebuild block chain index from current blk000??.dat files on startup");
     strUsage += HelpMessageOpt("-resync", "Delete blockchain folders and resync from scratch on startup");
@@ -427,6 +514,13 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)");
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-addressindex", strprintf("Maintain an index of the outputs and spends of each script, used by the getaddress* rpc calls. "
+            "The P2PK and P2CS outputs are also found by the addresses of their keys. This mode is incompatible with -prune (default: %u)", DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-compactsaplingindex", strprintf("Maintain an index of the compact form of the shielded transactions of each block (nullifiers, note commitments, "
+            "ephemeral keys and compact ciphertexts), served to the light wallets by the /rest/compactsaplingblocks endpoint. This mode is incompatible with -prune (default: %u)", DEFAULT_COMPACTSAPLINGINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex=<type>", strprintf("Maintain an index of compact filters by block (default: %s, values: %s). "
+            "If <type> is not supplied or if <type> = 1, indexes for all known types are enabled. This mode is incompatible with -prune", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()));
+    strUsage += HelpMessageOpt("-utxohash", strprintf("Maintain a MuHash of the UTXO set as the blocks are connected, used by the gettxoutsetinfo rpc call with hash_type \"muhash\" (default: %u)", DEFAULT_UTXOHASH));
     strUsage += HelpMessageOpt("-forcestart", "Attempt to force blockchain corruption recovery on startup");
 
     strUsage += HelpMessageGroup("Connection options:");
@@ -446,10 +540,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf("Maintain at most <n> connections to peers (default: %u)", DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER));
+    strUsage += HelpMessageOpt("-msgthreads=<n>", strprintf("Set the number of threads processing the LLMQ and ChainLocks messages apart from the other peer messages (0 to %d, default: %d)", MAX_ASYNC_MSG_THREADS, DEFAULT_ASYNC_MSG_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)", "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", "Only connect to nodes in network <net> (ipv4, ipv6 or onion)");
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf("Relay non-P2SH multisig (default: %u)", DEFAULT_PERMIT_BAREMULTISIG));
     strUsage += HelpMessageOpt("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS));
+    strUsage += HelpMessageOpt("-peerblockfilters", strprintf("Serve compact block filters to peers per BIP 157 (default: %u)", DEFAULT_PEERBLOCKFILTERS));
     strUsage += HelpMessageOpt("-port=<port>", strprintf("Listen for connections on <port> (default: %u or testnet: %u)", defaultChainParams->GetDefaultPort(), testnetChainParams->GetDefaultPort()));
     strUsage += HelpMessageOpt("-proxy=<ip:port>", "Connect through SOCKS5 proxy");
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE));
@@ -457,6 +553,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf("Tor control port to use if onion listening enabled (default: %s)", DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", "Tor control port password (default: empty)");
+    strUsage += HelpMessageOpt("-txreconciliation", strprintf("Announce the transactions to the peers supporting it by set reconciliation, instead of an inv per transaction (default: %u)", DEFAULT_TXRECONCILIATION_ENABLE));
     strUsage += HelpMessageOpt("-upnp", strprintf("Use UPnP to map the listening port (default: %u)", DEFAULT_UPNP));
 #ifdef USE_NATPMP
     strUsage += HelpMessageOpt("-natpmp", strprintf("Use NAT-PMP to map the listening port (default: %s)", DEFAULT_NATPMP ? "1 when listening and no -proxy" : "0"));
@@ -479,6 +576,16 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", "Enable publish hash transaction in <address>");
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", "Enable publish raw block in <address>");
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>");
+    strUsage += HelpMessageOpt("-zmqpubhashtxremoved=<address>", "Enable publish hash and removal reason of the transactions removed from the mempool, other than by a block, in <address>");
+    strUsage += HelpMessageOpt("-zmqpubhashchainlock=<address>", "Enable publish hash of the chainlocked blocks in <address>");
+    strUsage += HelpMessageOpt("-zmqpubrawchainlocksig=<address>", "Enable publish raw chainlock signature in <address>");
+    strUsage += HelpMessageOpt("-zmqpubrawrecoveredsig=<address>", "Enable publish raw recovered LLMQ signature in <address>");
+    strUsage += HelpMessageOpt("-zmqpubrawmnlistdiff=<address>", "Enable publish raw deterministic masternode list diff in <address>");
+    strUsage += HelpMessageOpt("-zmqpubrawbudgetvote=<address>", "Enable publish raw budget proposal vote in <address>");
+    strUsage += HelpMessageOpt("-zmqpubrawfinalbudgetvote=<address>", "Enable publish raw finalized budget vote in <address>");
+    strUsage += HelpMessageOpt("-zmqpub<type>hwm=<n>", strprintf("Set the outbound message high water mark of the -zmqpub<type> publisher (default: %d)", DEFAULT_ZMQ_SNDHWM));
+    strUsage += HelpMessageOpt("-zmqqueuesize=<n>", strprintf("Queue up to <n> notifications for the ZMQ publisher thread, dropping the next ones (default: %d)", DEFAULT_ZMQ_QUEUE_SIZE));
+    strUsage += HelpMessageOpt("-zmqbatchsize=<n>", strprintf("Send up to <n> messages of a same notification as a single multipart message (default: %d)", DEFAULT_ZMQ_BATCH_SIZE));
 #endif
 
     strUsage += HelpMessageGroup("Debugging/Testing options:");
@@ -499,6 +606,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-sporkkey=<privkey>", "Enable spork administration functionality with the appropriate private key.");
         strUsage += HelpMessageOpt("-nuparams=upgradeName:activationHeight", "Use given activation height for specified network upgrade (regtest-only)");
+        strUsage += HelpMessageOpt("-checkpoint=height:blockHash", "Add a checkpoint of the given block at the given height, synced headers first (regtest-only)");
     }
     strUsage += HelpMessageOpt("-debug=<category>", strprintf("Output debugging information (default: %u, supplying <category> is optional)", 0) + ". " +
         "If <category> is not supplied, output all debugging information. <category> can be: " + ListLogCategories() + ".");
@@ -507,12 +615,17 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-nodebug", "Turn off debugging messages, same as -debug=0");
 
     strUsage += HelpMessageOpt("-help-debug", "Show all debugging options (usage: --help -help-debug)");
+    strUsage += HelpMessageOpt("-logasync", strprintf("Write the debug output from a background thread, dropping messages if it falls behind (default: %u)", DEFAULT_LOGASYNC));
     strUsage += HelpMessageOpt("-logips", strprintf("Include IP addresses in debug output (default: %u)", DEFAULT_LOGIPS));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS));
     strUsage += HelpMessageOpt("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS));
     if (showDebug) {
+        strUsage += HelpMessageOpt("-lockprofiler", strprintf("Profile the lock waits and hold times per lock site, see getlockcontention (default: %u)", DEFAULT_LOCK_PROFILER));
         strUsage += HelpMessageOpt("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)");
         strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxsaplingproofcachesize=<n>", strprintf("Limit size of Sapling proof cache to <n> MiB (default: %u)", DEFAULT_MAX_SAPLING_PROOF_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxspecialtxsigcachesize=<n>", strprintf("Limit size of special transactions signature cache to <n> MiB (default: %u)", DEFAULT_MAX_SPECIALTX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxrecsigcachesize=<n>", strprintf("Limit size of LLMQ recovered signatures cache to <n> MiB (default: %u)", DEFAULT_MAX_RECSIG_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf("Fees (in %s/Kb) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)", CURRENCY_UNIT, FormatMoney(::minRelayTxFee.GetFeePerK())));
@@ -540,6 +653,7 @@ std::string HelpMessage(HelpMessageMode mode)
     }
 
     strUsage += HelpMessageGroup("Block creation options:");
+    strUsage += HelpMessageOpt("-blockmaxshieldedcost=<n>", strprintf("Set maximum validation cost of the shielded transactions in a block, in units of a signature check (default: %d)", DEFAULT_BLOCK_MAX_SHIELDED_COST));
     strUsage += HelpMessageOpt("-blockmaxsize=<n>", strprintf("Set maximum block size in bytes (default: %d)", DEFAULT_BLOCK_MAX_SIZE));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
@@ -547,6 +661,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup("RPC server options:");
     strUsage += HelpMessageOpt("-server", "Accept command line and JSON-RPC commands");
     strUsage += HelpMessageOpt("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE));
+    strUsage += HelpMessageOpt("-metrics", strprintf("Serve the metrics of the node on the /metrics path of the RPC server, in the Prometheus text format, with the RPC authentication (default: %u)", DEFAULT_METRICS_ENABLE));
+    strUsage += HelpMessageOpt("-rpccachesize=<n>", strprintf("Maximum memory usage of the cache of the RPC results on blocks and confirmed transactions, in MiB, 0 to disable (default: %u)", DEFAULT_RPC_CACHE_SIZE));
     strUsage += HelpMessageOpt("-rpcbind=<addr>", "Bind to given address to listen for JSON-RPC connections. Do not expose the RPC server to untrusted networks such as the public internet! This option is ignored unless -rpcallowip is also passed. Port is optional and overrides -rpcport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1 i.e., localhost)");
     strUsage += HelpMessageOpt("-rpccookiefile=<loc>", "Location of the auth cookie (default: data dir)");
     strUsage += HelpMessageOpt("-rpcuser=<user>", "Username for JSON-RPC connections");
@@ -556,7 +672,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times");
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf("Set the number of threads to service RPC calls (default: %d)", DEFAULT_HTTP_THREADS));
     if (showDebug) {
-        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls, for each priority class (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
@@ -637,6 +753,7 @@ void ThreadImport(const std::vector<fs::path>& vImportFiles)
     util::ThreadRename("pivx-loadblk");
     CImportingNow imp;
     ScheduleBatchPriority();
+    ApplyValidationThreadAffinity();
 
     // -reindex
     if (fReindex) {
@@ -740,8 +857,9 @@ static void LoadSaplingParams()
     float elapsed;
     gettimeofday(&tv_start, nullptr);
 
+    const bool fLazyProvingParams = gArgs.GetBoolArg("-lazysaplingparams", DEFAULT_LAZY_SAPLING_PARAMS);
     try {
-        initZKSNARKS();
+        initZKSNARKS(fLazyProvingParams);
     } catch (std::runtime_error &e) {
         std::string strError = strprintf(_("Cannot find the Sapling parameters in the following directory:\n%s"), ZC_GetParamsDir());
         std::string strErrorPosix = strprintf(_("Please run the included %s script and then restart."), "install-params.sh");
@@ -759,7 +877,54 @@ static void LoadSaplingParams()
 
     gettimeofday(&tv_end, nullptr);
     elapsed = float(tv_end.tv_sec-tv_start.tv_sec) + (tv_end.tv_usec-tv_start.tv_usec)/float(1000000);
-    LogPrintf("Loaded Sapling parameters in %fs seconds.\n", elapsed);
+    LogPrintf("Loaded Sapling %s in %fs seconds.\n", fLazyProvingParams ? "verifying keys" : "parameters", elapsed);
+}
+
+// The caches accounted by the memory budget. The fixed size ones are only reported.
+static void RegisterMemoryBudgetComponents()
+{
+    g_memory_budget.Register("coins", MEMORY_PRIORITY_NORMAL, [] {
+        LOCK(cs_main);
+        return pcoinsTip ? pcoinsTip->DynamicMemoryUsage() : 0;
+    }, [](size_t nTargetUsage) {
+        {
+            LOCK(cs_main);
+            if (!pcoinsTip || pcoinsTip->DynamicMemoryUsage() <= nTargetUsage) return;
+            // Lower the cap of the cache too: it's then written by the block connections when it
+            // grows over it again, instead of being refilled and emptied on every enforcement
+            nCoinCacheUsage = std::min(nCoinCacheUsage, std::max(nTargetUsage, (size_t)nMinDbCache << 20));
+        }
+        // The coins cache can only be emptied, by writing it to disk
+        FlushStateToDisk();
+    });
+    g_memory_budget.Register("mempool", MEMORY_PRIORITY_HIGH, [] {
+        return mempool.DynamicMemoryUsage();
+    }, [](size_t nTargetUsage) {
+        LOCK(cs_main);
+        LimitMempoolSize(mempool, nTargetUsage, gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+    });
+    g_memory_budget.Register("mnlists", MEMORY_PRIORITY_LOW, [] {
+        return deterministicMNManager ? deterministicMNManager->GetCacheMemoryUsage() : 0;
+    }, [](size_t nTargetUsage) {
+        if (deterministicMNManager) deterministicMNManager->TrimCache(nTargetUsage);
+    });
+    g_memory_budget.Register("recentblocks", MEMORY_PRIORITY_LOW, [] {
+        return RecentBlocksMemoryUsage();
+    }, [](size_t nTargetUsage) {
+        if (RecentBlocksMemoryUsage() > nTargetUsage) ClearRecentBlocks();
+    });
+    g_memory_budget.Register("evodb", MEMORY_PRIORITY_NORMAL, [] {
+        // Read under the lock of the evo db, taken by GetMemoryUsage
+        return evoDb ? evoDb->GetMemoryUsage() : 0;
+    });
+    g_memory_budget.Register("leveldb", MEMORY_PRIORITY_NORMAL, [] {
+        size_t nUsage = 0;
+        ForEachDBWrapper([&nUsage](CDBWrapper& db) { nUsage += db.DynamicMemoryUsage(); });
+        return nUsage;
+    });
+    g_memory_budget.Register("sigcache", MEMORY_PRIORITY_NORMAL, [] {
+        return GetSignatureCacheMemoryUsage();
+    });
 }
 
 bool AppInitServers()
@@ -775,6 +940,8 @@ bool AppInitServers()
         return false;
     if (gArgs.GetBoolArg("-rest", DEFAULT_REST_ENABLE) && !StartREST())
         return false;
+    if (gArgs.GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE) && !StartMetrics())
+        return false;
     if (!StartHTTPServer())
         return false;
     return true;
@@ -800,6 +967,7 @@ namespace { // Variables internal to initialization process only
     int nUserMaxConnections;
     int nFD;
     ServiceFlags nLocalServices = NODE_NETWORK;
+    std::set<BlockFilterType> g_enabled_filter_types;
 }
 
 bool AppInitBasicSetup()
@@ -941,6 +1109,25 @@ bool InitNUParams()
     return true;
 }
 
+bool InitRegtestCheckpoints()
+{
+    for (const std::string& strCheckpoint : gArgs.GetArgs("-checkpoint")) {
+        if (!Params().IsRegTestNet()) {
+            return UIError(_("Checkpoints may only be added on regtest."));
+        }
+        std::vector<std::string> vCheckpointParams;
+        boost::split(vCheckpointParams, strCheckpoint, boost::is_any_of(":"));
+        int nHeight;
+        if (vCheckpointParams.size() != 2 || !ParseInt32(vCheckpointParams[0], &nHeight) || nHeight <= 0 ||
+                vCheckpointParams[1].size() != 64 || !IsHex(vCheckpointParams[1])) {
+            return UIError(strprintf(_("Checkpoint malformed, expecting %s"), "height:blockHash"));
+        }
+        UpdateRegtestCheckpoint(nHeight, uint256S(vCheckpointParams[1]));
+        LogPrintf("Adding the checkpoint of height=%d %s\n", nHeight, vCheckpointParams[1]);
+    }
+    return true;
+}
+
 static std::string ResolveErrMsg(const char * const optname, const std::string& strBind)
 {
     return strprintf(_("Cannot resolve -%s address: '%s'"), optname, strBind);
@@ -961,6 +1148,7 @@ void InitLogging()
     g_logger->m_log_time_micros = gArgs.GetBoolArg("-logtimemicros", DEFAULT_LOGTIMEMICROS);
 
     fLogIPs = gArgs.GetBoolArg("-logips", DEFAULT_LOGIPS);
+    g_lock_profiler = gArgs.GetBoolArg("-lockprofiler", DEFAULT_LOCK_PROFILER);
 
     std::string version_string = FormatFullVersion();
 #ifdef DEBUG
@@ -1052,15 +1240,78 @@ bool AppInitParameterInteraction()
     if (ratio != 0) {
         mempool.setSanityCheck(1.0 / ratio);
     }
+    mempool.SetClusterEviction(gArgs.GetBoolArg("-mempoolclustereviction", DEFAULT_MEMPOOL_CLUSTER_EVICTION));
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", Params().DefaultConsistencyChecks());
+
+    // parse and validate enabled filter types
+    const std::string blockfilterindex_value = gArgs.GetArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    if (blockfilterindex_value == "" || blockfilterindex_value == "1") {
+        g_enabled_filter_types.insert(AllBlockFilterTypes().begin(), AllBlockFilterTypes().end());
+    } else if (blockfilterindex_value != "0") {
+        for (const auto& name : gArgs.GetArgs("-blockfilterindex")) {
+            BlockFilterType filter_type;
+            if (!BlockFilterTypeByName(name, filter_type)) {
+                return UIError(strprintf(_("Unknown -blockfilterindex value %s."), name));
+            }
+            g_enabled_filter_types.insert(filter_type);
+        }
+    }
+
+    // Signal NODE_COMPACT_FILTERS if peerblockfilters and basic filters index are both enabled.
+    if (gArgs.GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (g_enabled_filter_types.count(BlockFilterType::BASIC_FILTER) != 1) {
+            return UIError(_("Cannot set -peerblockfilters without -blockfilterindex."));
+        }
+        nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
+    }
+
+    // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
+    int64_t nPruneArg = gArgs.GetArg("-prune", 0);
+    if (nPruneArg < 0) {
+        return UIError(_("Prune cannot be configured with a negative value."));
+    }
+    nPruneTarget = (uint64_t) nPruneArg * 1024 * 1024;
+    if (nPruneArg > 0) {
+        if (nPruneTarget < MIN_DISK_SPACE_FOR_BLOCK_FILES) {
+            return UIError(strprintf(_("Prune configured below the minimum of %d MiB.  Please use a higher number."), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+        }
+        if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+            return UIError(strprintf(_("%s is incompatible with %s, set %s."), "-prune", "-txindex", "-txindex=0"));
+        }
+        if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+            return UIError(strprintf(_("%s is incompatible with %s, set %s."), "-prune", "-addressindex", "-addressindex=0"));
+        }
+        if (gArgs.GetBoolArg("-compactsaplingindex", DEFAULT_COMPACTSAPLINGINDEX)) {
+            return UIError(strprintf(_("%s is incompatible with %s, set %s."), "-prune", "-compactsaplingindex", "-compactsaplingindex=0"));
+        }
+        if (!g_enabled_filter_types.empty()) {
+            return UIError(strprintf(_("%s is incompatible with %s, set %s."), "-prune", "-blockfilterindex", "-blockfilterindex=0"));
+        }
+        if (gArgs.GetBoolArg("-reindex-chainstate", false)) {
+            return UIError(strprintf(_("%s is incompatible with %s. Use %s instead."), "-prune", "-reindex-chainstate", "-reindex"));
+        }
+        if (gArgs.GetBoolArg("-rescan", false)) {
+            return UIError(strprintf(_("%s is incompatible with %s."), "-prune", "-rescan"));
+        }
+        LogPrintf("Prune configured to target %uMiB on disk for block and undo files.\n", nPruneTarget / 1024 / 1024);
+        fPruneMode = true;
+    }
     Checkpoints::fEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
+    hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", Params().GetConsensus().defaultAssumeValid.GetHex()));
+    if (!hashAssumeValid.IsNull())
+        LogPrintf("Assuming ancestors of block %s have valid signatures.\n", hashAssumeValid.GetHex());
+    else
+        LogPrintf("Validating signatures for all blocks.\n");
+
     // -mempoollimit limits
     int64_t nMempoolSizeLimit = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t nMempoolDescendantSizeLimit = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000;
     if (nMempoolSizeLimit < 0 || nMempoolSizeLimit < nMempoolDescendantSizeLimit * 40)
         return UIError(strprintf(_("Error: %s must be at least %d MB"), "-maxmempool",
                                  gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) / 25));
+    if (gArgs.GetArg("-maxmempoolshielded", DEFAULT_MAX_MEMPOOL_SHIELDED_SIZE) < 0)
+        return UIError(strprintf(_("Error: %s must be at least %d MB"), "-maxmempoolshielded", 0));
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = gArgs.GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -1071,11 +1322,16 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    if (!SetValidationThreadsCpus(gArgs.GetArg("-validationcpus", "")))
+        return UIError(strprintf(_("Invalid CPUs list: '%s'"), gArgs.GetArg("-validationcpus", "")));
+
     setvbuf(stdout, nullptr, _IOLBF, 0); /// ***TODO*** do we still need this after -printtoconsole is gone?
 
 #ifndef ENABLE_WALLET
     if (gArgs.SoftSetBoolArg("-staking", false))
         LogPrintf("AppInit2 : parameter interaction: wallet functionality not enabled -> setting -staking=0\n");
+    if (gArgs.SoftSetBoolArg("-lazysaplingparams", true))
+        LogPrintf("AppInit2 : parameter interaction: wallet functionality not enabled -> setting -lazysaplingparams=1\n");
 #endif
 
     nConnectTimeout = gArgs.GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
@@ -1127,11 +1383,18 @@ bool AppInitParameterInteraction()
     if (gArgs.GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
 
+    // A pruned node cannot serve the full chain
+    if (fPruneMode)
+        nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
+
     nMaxTipAge = gArgs.GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
     if (!InitNUParams())
         return false;
 
+    if (!InitRegtestCheckpoints())
+        return false;
+
     return true;
 }
 
@@ -1153,6 +1416,9 @@ bool AppInitSanityChecks()
     // ********************************************************* Step 4: sanity checks
 
     // Initialize elliptic curve code
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    LogPrintf("Using the '%s' CRC32C implementation for the database checksums\n", GetCRC32CImplementation());
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1188,6 +1454,9 @@ bool AppInitMain()
         if (!g_logger->OpenDebugLog())
             return UIError(strprintf(_("Could not open debug log file %s"), g_logger->m_file_path.string()));
     }
+    if (gArgs.GetBoolArg("-logasync", DEFAULT_LOGASYNC)) {
+        g_logger->StartAsyncWriter();
+    }
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
 #endif
@@ -1216,25 +1485,52 @@ bool AppInitMain()
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+    if (gArgs.GetBoolArg("-asyncblockwrites", DEFAULT_ASYNC_BLOCK_WRITES)) {
+        StartBlockFileWriters();
+    }
+
     if (gArgs.IsArgSet("-sporkkey")) // spork priv key
     {
         if (!sporkManager.SetPrivKey(gArgs.GetArg("-sporkkey", "")))
             return UIError(_("Unable to sign spork message, wrong key?"));
     }
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads, one per lane
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    CScheduler::Function serviceLoopTierTwo = std::bind(&CScheduler::serviceQueue, &schedulerTierTwo);
+    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "sched-t2", serviceLoopTierTwo));
+    CScheduler::Function serviceLoopIO = std::bind(&CScheduler::serviceQueue, &schedulerIO);
+    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "sched-io", serviceLoopIO));
 
     // Gather some entropy once per minute.
     scheduler.scheduleEvery([]{
         RandAddPeriodic();
     }, 60000);
 
+    SetDBVerifyScans(gArgs.GetBoolArg("-dbverifyscans", DEFAULT_DB_VERIFY_SCANS));
+
+    // Spread the compaction of the databases over the idle periods, once per minute
+    const int64_t nCompactionRate = gArgs.GetArg("-dbcompactionrate", DEFAULT_DB_COMPACTION_RATE);
+    if (nCompactionRate > 0) {
+        const size_t nMaxBytes = (size_t)nCompactionRate << 20;
+        schedulerIO.scheduleEvery([nMaxBytes]{
+            if (IsInitialBlockDownload() || GetTime() - nTimeBestReceived < DB_COMPACTION_IDLE_TIME) return;
+            ForEachDBWrapper([nMaxBytes](CDBWrapper& db) { db.CompactNextRanges(nMaxBytes); });
+        }, 60000);
+    }
+
     GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
 
-    // Initialize Sapling circuit parameters
-    LoadSaplingParams();
+    // Initialize Sapling circuit parameters, in the background while the block index loads.
+    // They are needed from the verification of the last blocks on.
+    std::future<void> saplingParamsLoaded = std::async(std::launch::async, [] {
+        util::ThreadRename("pivx-zkparams");
+        LoadSaplingParams();
+    });
+    const auto WaitSaplingParams = [&saplingParamsLoaded] {
+        if (saplingParamsLoaded.valid()) saplingParamsLoaded.get();
+    };
 
     /* Register RPC commands regardless of -server setting so they will be
      * available in the GUI RPC console even if external calls are disabled.
@@ -1298,6 +1594,9 @@ bool AppInitMain()
 
     peerLogic.reset(new PeerLogicValidation(&connman));
     RegisterValidationInterface(peerLogic.get());
+    if (gArgs.GetBoolArg("-blockpipeline", DEFAULT_BLOCK_PIPELINE)) {
+        StartBlockPipeline();
+    }
 
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
@@ -1435,17 +1734,44 @@ bool AppInitMain()
     int64_t nTotalCache = (gArgs.GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
-    int64_t nBlockTreeDBCache = nTotalCache / 8;
-    nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
+    int64_t nBlockTreeDBCache = std::min(nTotalCache / 8, nMaxBlockDBCache << 20);
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nTxIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
+    nTotalCache -= nTxIndexCache;
+    int64_t nAddressIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ? nMaxAddressIndexCache << 20 : 0);
+    nTotalCache -= nAddressIndexCache;
+    int64_t nCompactSaplingIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-compactsaplingindex", DEFAULT_COMPACTSAPLINGINDEX) ? nMaxCompactSaplingIndexCache << 20 : 0);
+    nTotalCache -= nCompactSaplingIndexCache;
+    int64_t nFilterIndexCache = std::min(nTotalCache / 8, !g_enabled_filter_types.empty() ? nMaxFilterIndexCache << 20 : 0);
+    nTotalCache -= nFilterIndexCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
+    int64_t nSaplingDBCache = std::min(nTotalCache / 16, nMaxSaplingDBCache << 20); // sapling nullifiers filter and anchors cache
+    nTotalCache -= nSaplingDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
+    g_cache_balancer.Init(nCoinCacheUsage, gArgs.GetBoolArg("-dynamicdbcache", DEFAULT_DYNAMIC_DBCACHE));
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        LogPrintf("* Using %.1fMiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        LogPrintf("* Using %.1fMiB for address index database\n", nAddressIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-compactsaplingindex", DEFAULT_COMPACTSAPLINGINDEX)) {
+        LogPrintf("* Using %.1fMiB for compact sapling index database\n", nCompactSaplingIndexCache * (1.0 / 1024 / 1024));
+    }
+    for (BlockFilterType filter_type : g_enabled_filter_types) {
+        LogPrintf("* Using %.1fMiB for %s block filter index database\n",
+                  nFilterIndexCache / g_enabled_filter_types.size() * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
+    }
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for sapling chain state lookups\n", nSaplingDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    if (g_cache_balancer.IsDynamic()) {
+        LogPrintf("* Sharing it with the masternode lists cache after the initial block download\n");
+    }
 
     const CChainParams& chainparams = Params();
     const Consensus::Params& consensus = chainparams.GetConsensus();
@@ -1463,12 +1789,14 @@ bool AppInitMain()
             try {
                 UnloadBlockIndex();
                 pcoinsTip.reset();
+                pUTXOCommitment.reset();
                 pcoinsdbview.reset();
                 pcoinscatcher.reset();
                 pblocktree.reset(new CBlockTreeDB(nBlockTreeDBCache, false, fReset));
 
                 //PIVX specific: zerocoin and spork DB's
                 zerocoinDB.reset(new CZerocoinDB(0, false, fReindex));
+                frozenSerials.reset();
                 pSporkDB.reset(new CSporkDB(0, false, false));
                 accumulatorCache.reset(new AccumulatorCache(zerocoinDB.get()));
 
@@ -1485,9 +1813,8 @@ bool AppInitMain()
                 uiInterface.InitMessage(_("Loading sporks..."));
                 sporkManager.LoadSporksFromDB();
 
-                // LoadBlockIndex will load fTxIndex from the db, or set it if
-                // we're reindexing. It will also load fHavePruned if we've
-                // ever removed a block file from disk.
+                // LoadBlockIndex will load fHavePruned if we've ever removed a
+                // block file from disk.
                 // Note that it also sets fReindex based on the disk flag!
                 // From here on out fReindex and fReset mean something different!
                 uiInterface.InitMessage(_("Loading block index..."));
@@ -1505,9 +1832,10 @@ bool AppInitMain()
                     return UIError(_("Incorrect or no genesis block found. Wrong datadir for network?"));
                 }
 
-                // Check for changed -txindex state
-                if (fTxIndex != gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
-                    strLoadError = strprintf(_("You need to rebuild the database using %s to change %s"), "-reindex-chainstate", "-txindex");
+                // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
+                // in the past, but is now trying to run unpruned.
+                if (fHavePruned && !fPruneMode) {
+                    strLoadError = _("You need to rebuild the database using -reindex to go back to unpruned mode.  This will redownload the entire blockchain");
                     break;
                 }
 
@@ -1522,7 +1850,7 @@ bool AppInitMain()
                 // At this point we're either in reindex or we've loaded a useful
                 // block tree into mapBlockIndex!
 
-                pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, fReset || fReindexChainState));
+                pcoinsdbview.reset(new CCoinsViewDB(nCoinDBCache, false, fReset || fReindexChainState, nSaplingDBCache));
                 pcoinscatcher.reset(new CCoinsViewErrorCatcher(pcoinsdbview.get()));
 
                 // If necessary, upgrade from older database format.
@@ -1543,7 +1871,7 @@ bool AppInitMain()
                 // The on-disk coinsdb is now in a good state, create the cache
                 pcoinsTip.reset(new CCoinsViewCache(pcoinscatcher.get()));
 
-                InitTierTwoPostCoinsCacheLoad(&scheduler);
+                InitTierTwoPostCoinsCacheLoad(&schedulerTierTwo);
 
                 bool is_coinsview_empty = fReset || fReindexChainState || pcoinsTip->GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
@@ -1566,7 +1894,10 @@ bool AppInitMain()
                             strLoadError = _("System error while flushing the chainstate after pruning invalid entries. Possible corrupt database.");
                             break;
                         }
-                        MoneySupply.Update(pcoinsTip->GetTotalAmount(), chainHeight);
+                        // The money supply doesn't need an update here: LoadMoneySupply sets it below, after the
+                        // pruning. The running total of the blocks never counts the invalid outs, which aren't added
+                        // to the coins view, and the total of the blocks connected before the supply changes
+                        // were kept is anchored on a scan of the pruned coins.
                         // No need to keep the invalid outs in memory. Clear the map 100 blocks after the last invalid UTXO
                         if (chainHeight > consensus.height_last_invalid_UTXO + 100) {
                             invalid_out::setInvalidOutPoints.clear();
@@ -1578,7 +1909,16 @@ bool AppInitMain()
                     }
                 }
 
+                if (gArgs.GetBoolArg("-utxohash", DEFAULT_UTXOHASH)) {
+                    uiInterface.InitMessage(_("Loading the UTXO set hash..."));
+                    if (!LoadUTXOCommitment(*pcoinsdbview)) {
+                        strLoadError = _("Error computing the UTXO set hash");
+                        break;
+                    }
+                }
+
                 if (!is_coinsview_empty) {
+                    WaitSaplingParams();
                     uiInterface.InitMessage(_("Verifying blocks..."));
                     CBlockIndex *tip = chainActive.Tip();
                     RPCNotifyBlockChange(true, tip);
@@ -1624,6 +1964,9 @@ bool AppInitMain()
         }
     }
 
+    // A failure to load the Sapling parameters requests the shutdown
+    WaitSaplingParams();
+
     // As LoadBlockIndex can take several minutes, it's possible the user
     // requested to kill the GUI during the last operation. If so, exit.
     // As the program has not fully started yet, Shutdown() is possibly overkill.
@@ -1632,6 +1975,31 @@ bool AppInitMain()
         return false;
     }
 
+    // The transaction, address, compact sapling and block filter indexes follow the chain in the background, catching up from their last block first
+    if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        g_txindex.reset(new TxIndex(nTxIndexCache, false, fReindex));
+        g_txindex->Start();
+    }
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        g_addressindex.reset(new AddressIndex(nAddressIndexCache, false, fReindex));
+        g_addressindex->Start();
+    }
+    if (gArgs.GetBoolArg("-compactsaplingindex", DEFAULT_COMPACTSAPLINGINDEX)) {
+        g_compactsaplingindex.reset(new CompactSaplingIndex(nCompactSaplingIndexCache, false, fReindex));
+        g_compactsaplingindex->Start();
+    }
+    for (const auto& filter_type : g_enabled_filter_types) {
+        InitBlockFilterIndex(filter_type, nFilterIndexCache / g_enabled_filter_types.size(), false, fReindex);
+        GetBlockFilterIndex(filter_type)->Start();
+    }
+
+    uiInterface.InitMessage(_("Loading the zerocoin spends index..."));
+    const int64_t load_frozen_serials_start_time = GetTimeMillis();
+    if (!LoadFrozenSerialIndex()) {
+        return UIError(_("Error building the zerocoin spends index"));
+    }
+    LogPrintf(" zerocoin spends index %15dms\n", GetTimeMillis() - load_frozen_serials_start_time);
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -1646,6 +2014,13 @@ bool AppInitMain()
 #else
     LogPrintf("No wallet compiled in!\n");
 #endif
+
+    // if pruning, perform the initial blockstore prune after any wallet rescanning has taken place
+    if (fPruneMode && !fReindex) {
+        uiInterface.InitMessage(_("Pruning blockstore..."));
+        PruneAndFlush();
+    }
+
     // ********************************************************* Step 9: import blocks
 
     if (!CheckDiskSpace(GetDataDir())) {
@@ -1715,7 +2090,7 @@ bool AppInitMain()
     // Update money supply
     if (!fReindex && !fReindexChainState) {
         uiInterface.InitMessage(_("Calculating money supply..."));
-        MoneySupply.Update(pcoinsTip->GetTotalAmount(), chain_active_height);
+        WITH_LOCK(cs_main, LoadMoneySupply());
     }
 
 
@@ -1730,14 +2105,28 @@ bool AppInitMain()
         }
     }
 
+    const int64_t load_tier_two_start_time = GetTimeMillis();
     LoadTierTwo(chain_active_height, load_cache_files);
+    LogPrintf(" tier two caches %15dms\n", GetTimeMillis() - load_tier_two_start_time);
     RegisterTierTwoValidationInterface();
 
     // set the mode of budget voting for this node
     SetBudgetFinMode(gArgs.GetArg("-budgetvotemode", "auto"));
 
     // Start tier two threads and jobs
-    StartTierTwoThreadsAndScheduleJobs(threadGroup, scheduler);
+    StartTierTwoThreadsAndScheduleJobs(threadGroup, schedulerTierTwo);
+
+    // Account the caches, and keep them under -maxmemorybudget
+    RegisterMemoryBudgetComponents();
+    const int64_t nMemoryBudget = gArgs.GetArg("-maxmemorybudget", DEFAULT_MAX_MEMORY_BUDGET);
+    if (nMemoryBudget > 0) {
+        g_memory_budget.SetLimit((size_t)nMemoryBudget << 20);
+        LogPrintf("Memory budget: %d MiB\n", nMemoryBudget);
+        schedulerIO.scheduleEvery([]{ g_memory_budget.Enforce(); }, MEMORY_BUDGET_INTERVAL);
+    }
+    if (g_cache_balancer.IsDynamic()) {
+        schedulerIO.scheduleEvery([]{ g_cache_balancer.Rebalance(); }, CACHE_BALANCE_INTERVAL);
+    }
 
     if (ShutdownRequested()) {
         LogPrintf("Shutdown requested. Exiting.\n");
@@ -1782,6 +2171,8 @@ bool AppInitMain()
     connOptions.m_msgproc = peerLogic.get();
     connOptions.nSendBufferMaxSize = 1000*gArgs.GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*gArgs.GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.nAsyncMessageThreads = std::max(0, std::min(MAX_ASYNC_MSG_THREADS, (int)gArgs.GetArg("-msgthreads", DEFAULT_ASYNC_MSG_THREADS)));
+    connOptions.m_tx_reconciliation = gArgs.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION_ENABLE);
     connOptions.m_added_nodes = gArgs.GetArgs("-addnode");
 
     if (gArgs.IsArgSet("-bind")) {
@@ -1824,7 +2215,7 @@ bool AppInitMain()
             connOptions.m_specified_outgoing = connect;
         }
     }
-    if (!connman.Start(scheduler, connOptions)) {
+    if (!connman.Start(schedulerIO, schedulerTierTwo, connOptions)) {
         return false;
     }
 
@@ -1837,11 +2228,13 @@ bool AppInitMain()
 #ifdef ENABLE_WALLET
     uiInterface.InitMessage(_("Reaccepting wallet transactions..."));
     for (CWalletRef pwallet : vpwallets) {
-        pwallet->postInitProcess(scheduler);
+        pwallet->postInitProcess(schedulerIO);
     }
-    // StakeMiner thread disabled by default on regtest
-    if (!vpwallets.empty() && gArgs.GetBoolArg("-staking", !Params().IsRegTestNet() && DEFAULT_STAKING)) {
-        threadGroup.create_thread(std::bind(&ThreadStakeMinter));
+    // StakeMiner threads (one per wallet) disabled by default on regtest
+    if (gArgs.GetBoolArg("-staking", !Params().IsRegTestNet() && DEFAULT_STAKING)) {
+        for (CWalletRef pwallet : vpwallets) {
+            threadGroup.create_thread(std::bind(&ThreadStakeMinter, pwallet));
+        }
     }
 #endif
 
@@ -8,8 +8,11 @@
 #define BITCOIN_INIT_H
 
 #include <string>
+#include <utility>
+#include <vector>
 
 class CScheduler;
+struct CSchedulerStats;
 class CWallet;
 
 namespace boost
@@ -22,6 +25,8 @@ void Interrupt();
 void Shutdown();
 //!Initialize the logging infrastructure
 void InitLogging();
+/** Backlog of each scheduler lane, by lane name */
+std::vector<std::pair<std::string, CSchedulerStats>> GetSchedulerLaneStats();
 //!Parameter interaction: change current parameters depending on various rules
 void InitParameterInteraction();
 
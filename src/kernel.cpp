@@ -7,10 +7,12 @@
 
 #include "kernel.h"
 
+#include "crypto/common.h"
 #include "db.h"
 #include "legacy/stakemodifier.h"
 #include "policy/policy.h"
 #include "script/interpreter.h"
+#include "script/sigcache.h"
 #include "stakeinput.h"
 #include "util/system.h"
 #include "utilmoneystr.h"
@@ -49,9 +51,9 @@ CStakeKernel::CStakeKernel(const CBlockIndex* const pindexPrev, CStakeInput* sta
 // Return stake kernel hash
 uint256 CStakeKernel::GetHash() const
 {
-    CDataStream ss(stakeModifier);
-    ss << nTimeBlockFrom << stakeUniqueness << nTime;
-    return Hash(ss.begin(), ss.end());
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << stakeModifier << nTimeBlockFrom << stakeUniqueness << nTime;
+    return ss.GetHash();
 }
 
 // Check that the kernel hash meets the target required
@@ -82,6 +84,77 @@ bool CStakeKernel::CheckKernelHash(bool fSkipLog) const
     return res;
 }
 
+const CStakeKernelSearch::KernelEntry* CStakeKernelSearch::GetKernel(const CBlockIndex* pindexPrev, CPivStake* stakeInput, unsigned int nBits)
+{
+    // Modifier v1 depends on the stake input, not only on the tip
+    if (!Params().GetConsensus().NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_V3_4)) {
+        return nullptr;
+    }
+    if (pindexPrev->GetBlockHash() != hashTip || nBits != nTipBits) {
+        mapKernels.clear();
+        hashTip = pindexPrev->GetBlockHash();
+        nTipBits = nBits;
+    }
+
+    const COutPoint& outpoint = stakeInput->GetOutPoint();
+    auto it = mapKernels.find(outpoint);
+    if (it == mapKernels.end()) {
+        // modifier (32) + nTimeBlockFrom (4) + uniqueness (36). nTime (4) goes last.
+        CDataStream ss(SER_GETHASH, 0);
+        ss << pindexPrev->GetStakeModifierV2() << (int)stakeInput->GetIndexFrom()->nTime << stakeInput->GetUniqueness();
+        assert(ss.size() == 64 + sizeof(KernelEntry::tail));
+        KernelEntry kernel;
+        kernel.midstate.Write((const unsigned char*)ss.data(), 64);
+        memcpy(kernel.tail, ss.data() + 64, sizeof(kernel.tail));
+        kernel.bnTarget.SetCompact(nBits);
+        kernel.bnTarget *= (arith_uint256(stakeInput->GetValue()) / 100);
+        it = mapKernels.emplace(outpoint, kernel).first;
+    }
+    return &it->second;
+}
+
+uint256 CStakeKernelSearch::HashKernel(const KernelEntry& kernel, int nTimeTx)
+{
+    unsigned char time[4];
+    WriteLE32(time, (uint32_t)nTimeTx);
+    unsigned char buf[CSHA256::OUTPUT_SIZE];
+    CSHA256(kernel.midstate).Write(kernel.tail, sizeof(kernel.tail)).Write(time, sizeof(time)).Finalize(buf);
+    uint256 hash;
+    CSHA256().Write(buf, sizeof(buf)).Finalize(hash.begin());
+    return hash;
+}
+
+uint256 CStakeKernelSearch::GetHash(const CBlockIndex* pindexPrev, CPivStake* stakeInput, unsigned int nBits, int nTimeTx)
+{
+    LOCK(cs);
+    const KernelEntry* kernel = GetKernel(pindexPrev, stakeInput, nBits);
+    if (!kernel) {
+        return CStakeKernel(pindexPrev, stakeInput, nBits, nTimeTx).GetHash();
+    }
+    return HashKernel(*kernel, nTimeTx);
+}
+
+bool CStakeKernelSearch::CheckKernelHash(const CBlockIndex* pindexPrev, CPivStake* stakeInput, unsigned int nBits, int nTimeTx)
+{
+    {
+        LOCK(cs);
+        const KernelEntry* kernel = GetKernel(pindexPrev, stakeInput, nBits);
+        if (kernel && UintToArith256(HashKernel(*kernel, nTimeTx)) >= kernel->bnTarget) {
+            return false;
+        }
+    }
+    // Kernel found (or modifier v1): check it (and log it) the regular way
+    return CStakeKernel(pindexPrev, stakeInput, nBits, nTimeTx).CheckKernelHash(true);
+}
+
+void CStakeKernelSearch::Clear()
+{
+    LOCK(cs);
+    mapKernels.clear();
+    hashTip.SetNull();
+    nTipBits = 0;
+}
+
 
 /*
  * PoS Validation
@@ -126,6 +199,19 @@ bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int
     return stakeKernel.CheckKernelHash(true);
 }
 
+bool Stake(const CBlockIndex* pindexPrev, CPivStake* stakeInput, unsigned int nBits, int64_t& nTimeTx, CStakeKernelSearch& kernelSearch)
+{
+    if (!stakeInput) return false;
+
+    // Get the new time slot (and verify it's not the same as previous block)
+    const bool fRegTest = Params().IsRegTestNet();
+    nTimeTx = (fRegTest ? GetAdjustedTime() : GetCurrentTimeSlot());
+    if (nTimeTx <= pindexPrev->nTime && !fRegTest) return false;
+
+    // Verify Proof Of Stake
+    return kernelSearch.CheckKernelHash(pindexPrev, stakeInput, nBits, nTimeTx);
+}
+
 
 /*
  * CheckProofOfStake    Check if block has valid proof of stake
@@ -164,9 +250,11 @@ bool CheckProofOfStake(const CBlock& block, std::string& strError, const CBlockI
     }
     const auto& tx = block.vtx[1];
     const CTxIn& txin = tx->vin[0];
+    // The signature stays in the cache for the script check of the coinstake in ConnectBlock
+    PrecomputedTransactionData txdata(*tx);
     ScriptError serror;
     if (!VerifyScript(txin.scriptSig, stakePrevout.scriptPubKey, STANDARD_SCRIPT_VERIFY_FLAGS,
-             TransactionSignatureChecker(tx.get(), 0, stakePrevout.nValue), tx->GetRequiredSigVersion(), &serror)) {
+             CachingTransactionSignatureChecker(tx.get(), 0, stakePrevout.nValue, true, txdata), tx->GetRequiredSigVersion(), &serror)) {
         strError = strprintf("signature fails: %s", serror ? ScriptErrorString(serror) : "");
         return false;
     }
@@ -8,7 +8,13 @@
 #ifndef PIVX_KERNEL_H
 #define PIVX_KERNEL_H
 
+#include "arith_uint256.h"
+#include "coins.h"
+#include "crypto/sha256.h"
 #include "stakeinput.h"
+#include "sync.h"
+
+#include <unordered_map>
 
 class CStakeKernel {
 public:
@@ -39,6 +45,44 @@ private:
     CAmount stakeValue{0};     // target multiplier
 };
 
+/*
+ * CStakeKernelSearch   Kernel hashing state shared by the stake attempts on the same tip.
+ *
+ * With the v2 stake modifier, everything in the kernel message of a PIV stake but the last
+ * bytes of the outpoint hash and the block time is the same for every time slot tried on top
+ * of a given parent. The SHA256 state after that first 64-byte block, and the weighted target,
+ * are computed once per UTXO and reused, so each attempt only hashes the 12 bytes left (and the
+ * second round of SHA256d). The hashes are the same as CStakeKernel::GetHash().
+ * Before v3.4 (modifier v1) it falls back to CStakeKernel.
+ */
+class CStakeKernelSearch {
+public:
+    // Return the kernel hash of stakeInput on top of pindexPrev at nTimeTx
+    uint256 GetHash(const CBlockIndex* pindexPrev, CPivStake* stakeInput, unsigned int nBits, int nTimeTx);
+
+    // Check that the kernel hash of stakeInput on top of pindexPrev at nTimeTx meets the target required
+    bool CheckKernelHash(const CBlockIndex* pindexPrev, CPivStake* stakeInput, unsigned int nBits, int nTimeTx);
+
+    // Drop the cached kernels
+    void Clear();
+
+private:
+    struct KernelEntry {
+        CSHA256 midstate;               // state after the first 64 bytes of the message
+        unsigned char tail[8];          // last 8 bytes of the outpoint hash
+        arith_uint256 bnTarget;         // weighted target
+    };
+
+    Mutex cs;
+    uint256 hashTip GUARDED_BY(cs);
+    unsigned int nTipBits GUARDED_BY(cs){0};
+    std::unordered_map<COutPoint, KernelEntry, SaltedOutpointHasher> mapKernels GUARDED_BY(cs);
+
+    // Return the cached kernel of stakeInput, or nullptr if the tip uses the v1 modifier
+    const KernelEntry* GetKernel(const CBlockIndex* pindexPrev, CPivStake* stakeInput, unsigned int nBits) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    static uint256 HashKernel(const KernelEntry& kernel, int nTimeTx);
+};
+
 /* PoS Validation */
 
 /*
@@ -52,6 +96,11 @@ private:
  */
 bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int nBits, int64_t& nTimeTx);
 
+/*
+ * Stake                Same as above, reusing the kernel hashing state kept in kernelSearch
+ */
+bool Stake(const CBlockIndex* pindexPrev, CPivStake* stakeInput, unsigned int nBits, int64_t& nTimeTx, CStakeKernelSearch& kernelSearch);
+
 /*
  * CheckProofOfStake    Check if block has valid proof of stake
  *
@@ -6,6 +6,8 @@
 
 #include "keystore.h"
 
+#include "hash.h"
+
 #include "script/script.h"
 #include "script/standard.h"
 #include "util/system.h"
@@ -35,6 +37,7 @@ bool CBasicKeyStore::AddKeyPubKey(const CKey& key, const CPubKey& pubkey)
 {
     LOCK(cs_KeyStore);
     mapKeys[pubkey.GetID()] = key;
+    setKnownIDs.insert(pubkey.GetID());
     return true;
 }
 
@@ -45,6 +48,7 @@ bool CBasicKeyStore::AddCScript(const CScript& redeemScript)
 
     LOCK(cs_KeyStore);
     mapScripts[CScriptID(redeemScript)] = redeemScript;
+    setKnownIDs.insert(CScriptID(redeemScript));
     return true;
 }
 
@@ -113,6 +117,41 @@ bool CBasicKeyStore::HaveWatchOnly() const
     return (!setWatchOnly.empty());
 }
 
+bool CBasicKeyStore::HaveKnownID(const CScript& script, size_t pos) const
+{
+    AssertLockHeld(cs_KeyStore);
+    uint160 id;
+    std::copy(script.begin() + pos, script.begin() + pos + id.size(), id.begin());
+    return setKnownIDs.count(id) > 0;
+}
+
+bool CBasicKeyStore::IsMineCandidate(const CScript& scriptPubKey) const
+{
+    LOCK(cs_KeyStore);
+    if (!setWatchOnly.empty() && setWatchOnly.count(scriptPubKey) > 0) {
+        return true;
+    }
+    if (scriptPubKey.IsPayToPublicKeyHash()) {
+        return HaveKnownID(scriptPubKey, 3);
+    }
+    if (scriptPubKey.IsPayToScriptHash()) {
+        return HaveKnownID(scriptPubKey, 2);
+    }
+    if (scriptPubKey.IsPayToExchangeAddress()) {
+        return HaveKnownID(scriptPubKey, 4);
+    }
+    if (scriptPubKey.IsPayToColdStaking()) {
+        // staker and owner key ids
+        return HaveKnownID(scriptPubKey, 6) || HaveKnownID(scriptPubKey, 28);
+    }
+    const size_t size = scriptPubKey.size();
+    if ((size == CPubKey::COMPRESSED_PUBLIC_KEY_SIZE + 2 || size == CPubKey::PUBLIC_KEY_SIZE + 2) &&
+            scriptPubKey[0] == size - 2 && scriptPubKey.back() == OP_CHECKSIG) {
+        return setKnownIDs.count(Hash160(scriptPubKey.begin() + 1, scriptPubKey.end() - 1)) > 0;
+    }
+    return true;
+}
+
 bool CBasicKeyStore::HaveKey(const CKeyID& address) const
 {
     bool result;
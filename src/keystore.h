@@ -9,10 +9,13 @@
 
 #include "key.h"
 #include "pubkey.h"
+#include "saltedhasher.h"
 #include "sapling/address.h"
 #include "sapling/zip32.h"
 #include "sync.h"
 
+#include <unordered_set>
+
 #include <boost/signals2/signal.hpp>
 
 class CScript;
@@ -48,6 +51,9 @@ public:
     virtual bool HaveWatchOnly(const CScript& dest) const = 0;
     virtual bool HaveWatchOnly() const = 0;
 
+    //! Whether scriptPubKey may pay to the store. False only when it surely doesn't, so that IsMine can skip it.
+    virtual bool IsMineCandidate(const CScript& scriptPubKey) const { return true; }
+
     //! Support for Sapling
     // Add a Sapling spending key to the store.
     virtual bool AddSaplingSpendingKey(const libzcash::SaplingExtendedSpendingKey &sk) = 0;
@@ -81,6 +87,7 @@ typedef std::map<CKeyID, CKey> KeyMap;
 typedef std::map<CKeyID, CPubKey> WatchKeyMap;
 typedef std::map<CScriptID, CScript> ScriptMap;
 typedef std::set<CScript> WatchOnlySet;
+typedef std::unordered_set<uint160, StaticSaltedHasher> KnownIDSet;
 
 // Full viewing key has equivalent functionality to a transparent address
 // When encrypting wallet, encrypt SaplingSpendingKeyMap, while leaving SaplingFullViewingKeyMap unencrypted
@@ -102,6 +109,12 @@ protected:
     WatchKeyMap mapWatchKeys;
     ScriptMap mapScripts;
     WatchOnlySet setWatchOnly;
+    // The key ids of the plain and encrypted keys, and the ids of the redeem scripts. Only ever
+    // grows, so that a hash160 not in the set is surely not in the key and script maps.
+    KnownIDSet setKnownIDs GUARDED_BY(cs_KeyStore);
+
+    //! Whether the 20 bytes of script starting at pos are one of the known ids
+    bool HaveKnownID(const CScript& script, size_t pos) const EXCLUSIVE_LOCKS_REQUIRED(cs_KeyStore);
 
 public:
 
@@ -126,6 +139,12 @@ public:
     virtual bool HaveWatchOnly(const CScript& dest) const;
     virtual bool HaveWatchOnly() const;
 
+    /**
+     * A single lookup in the known ids for the P2PK, P2PKH, P2SH, P2CS and exchange scripts that aren't
+     * watch-only, instead of the Solver and the map lookups of IsMine. The other scripts are candidates.
+     */
+    bool IsMineCandidate(const CScript& scriptPubKey) const override;
+
     //! Sapling
     bool AddSaplingSpendingKey(const libzcash::SaplingExtendedSpendingKey &sk);
     bool HaveSaplingSpendingKey(const libzcash::SaplingExtendedFullViewingKey &extfvk) const;
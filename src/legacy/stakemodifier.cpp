@@ -6,6 +6,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "legacy/stakemodifier.h"
+#include "saltedhasher.h"
+#include "sync.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"   // mapBlockIndex, chainActive
 
 /*
@@ -16,6 +19,13 @@ static const unsigned int MODIFIER_INTERVAL = 60;
 static const int MODIFIER_INTERVAL_RATIO = 3;
 static const int64_t OLD_MODIFIER_INTERVAL = 2087;
 
+// Old modifiers of the blocks of the staked inputs, with the block it was taken from.
+// An entry is valid while that block is in the active chain, checked under cs_main.
+static const size_t OLD_MODIFIER_CACHE_SIZE = 20000;
+static Mutex cs_oldModifierCache;
+static unordered_lru_cache<uint256, std::pair<const CBlockIndex*, uint64_t>, StaticSaltedHasher>
+        oldModifierCache GUARDED_BY(cs_oldModifierCache){OLD_MODIFIER_CACHE_SIZE};
+
 // Get selection interval section (in seconds)
 static int64_t GetStakeModifierSelectionIntervalSection(int nSection)
 {
@@ -63,9 +73,9 @@ static bool SelectBlockFromCandidates(
         else
             hashProof = pindex->IsProofOfStake() ? UINT256_ZERO : pindex->GetBlockHash();
 
-        CDataStream ss(SER_GETHASH, 0);
+        CHashWriter ss(SER_GETHASH, 0);
         ss << hashProof << nStakeModifierPrev;
-        arith_uint256 hashSelection = UintToArith256(Hash(ss.begin(), ss.end()));
+        arith_uint256 hashSelection = UintToArith256(ss.GetHash());
 
         // the selection hash is divided by 2**32 so that proof-of-stake block
         // is always favored over proof-of-work block. this is to preserve
@@ -89,6 +99,14 @@ static bool SelectBlockFromCandidates(
 // modifier about a selection interval later than the coin generating the kernel
 bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier)
 {
+    AssertLockHeld(cs_main);
+    std::pair<const CBlockIndex*, uint64_t> cached;
+    if (WITH_LOCK(cs_oldModifierCache, return oldModifierCache.get(pindexFrom->GetBlockHash(), cached)) &&
+            chainActive.Contains(cached.first)) {
+        nStakeModifier = cached.second;
+        return true;
+    }
+
     int64_t nStakeModifierTime = pindexFrom->GetBlockTime();
     const CBlockIndex* pindex = pindexFrom;
     CBlockIndex* pindexNext = chainActive[pindex->nHeight + 1];
@@ -105,11 +123,13 @@ bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier)
     } while (nStakeModifierTime < pindexFrom->GetBlockTime() + OLD_MODIFIER_INTERVAL);
 
     nStakeModifier = pindex->GetStakeModifierV1();
+    WITH_LOCK(cs_oldModifierCache, oldModifierCache.insert(pindexFrom->GetBlockHash(), std::make_pair(pindex, nStakeModifier)));
     return true;
 }
 
 bool GetOldStakeModifier(CStakeInput* stake, uint64_t& nStakeModifier)
 {
+    AssertLockHeld(cs_main);
     const CBlockIndex* pindexFrom = stake->GetIndexFrom();
     if (!pindexFrom) return error("%s : failed to get index from", __func__);
     if (stake->IsZPIV()) {
@@ -117,7 +137,7 @@ bool GetOldStakeModifier(CStakeInput* stake, uint64_t& nStakeModifier)
         const int nHeightStop = std::min(chainActive.Height(), Params().GetConsensus().height_last_ZC_AccumCheckpoint-1);
         while (pindexFrom && pindexFrom->nHeight + 1 <= nHeightStop) {
             if (pindexFrom->GetBlockTime() - nTimeBlockFrom > 60 * 60) {
-                nStakeModifier = pindexFrom->nAccumulatorCheckpoint.GetCheapHash();
+                nStakeModifier = pindexFrom->GetAccumulatorCheckpoint().GetCheapHash();
                 return true;
             }
             pindexFrom = chainActive.Next(pindexFrom);
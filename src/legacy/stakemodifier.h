@@ -11,7 +11,7 @@
 #include "chain.h"
 #include "stakeinput.h"
 
-// Old Modifier - Only for IBD
+// Old Modifier - Only for IBD. Walks the active chain: requires cs_main
 bool GetOldStakeModifier(CStakeInput* stake, uint64_t& nStakeModifier);
 bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
 
@@ -26,6 +26,7 @@ namespace llmq
 
 static const std::string DB_QUORUM_SK_SHARE = "q_Qsk";
 static const std::string DB_QUORUM_QUORUM_VVEC = "q_Qqvvec";
+static const std::string DB_QUORUM_PUBKEY_SHARES = "q_Qpks";
 
 std::unique_ptr<CQuorumManager> quorumManager{nullptr};
 
@@ -42,13 +43,8 @@ static uint256 MakeQuorumKey(const CQuorum& q)
 
 CQuorum::~CQuorum()
 {
-    // most likely the thread is already done
-    stopCachePopulatorThread = true;
-    // watch out to not join the thread when we're called from inside the thread, which might happen on shutdown. This
-    // is because on shutdown the thread is the last owner of the shared CQuorum instance and thus the destroyer of it.
-    if (cachePopulatorThread.joinable() && cachePopulatorThread.get_id() != std::this_thread::get_id()) {
-        cachePopulatorThread.join();
-    }
+    // the cache populator job holds a reference to the quorum: it is done (or was dropped) by now
+    stopCachePopulator = true;
 }
 
 void CQuorum::Init(const uint256& _minedBlockHash, const CBlockIndex* _pindexQuorum, const std::vector<CDeterministicMNCPtr>& _members, const std::vector<bool>& _validMembers, const CBLSPublicKey& _quorumPublicKey)
@@ -85,10 +81,22 @@ CBLSPublicKey CQuorum::GetPubKeyShare(size_t memberIdx) const
     if (quorumVvec == nullptr || memberIdx >= members.size() || !validMembers[memberIdx]) {
         return CBLSPublicKey();
     }
+    {
+        LOCK(cs_pubKeyShares);
+        if (!pubKeyShares.empty()) {
+            return pubKeyShares[memberIdx];
+        }
+    }
     auto& m = members[memberIdx];
     return blsCache.BuildPubKeyShare(m->proTxHash, quorumVvec, CBLSId(m->proTxHash));
 }
 
+bool CQuorum::HasAllPubKeyShares() const
+{
+    LOCK(cs_pubKeyShares);
+    return !pubKeyShares.empty();
+}
+
 CBLSSecretKey CQuorum::GetSkShare() const
 {
     return skShare;
@@ -131,27 +139,44 @@ bool CQuorum::ReadContributions(CEvoDB& evoDb)
     // member of the quorum but observed the whole DKG process to have the quorum verification vector.
     evoDb.Read(std::make_pair(DB_QUORUM_SK_SHARE, dbKey), skShare);
 
+    // Written by the cache populator, saves rebuilding the public key shares after a restart
+    std::vector<CBLSPublicKey> pks;
+    if (evoDb.Read(std::make_pair(DB_QUORUM_PUBKEY_SHARES, dbKey), pks) && pks.size() == members.size()) {
+        LOCK(cs_pubKeyShares);
+        pubKeyShares = std::move(pks);
+    }
+
     return true;
 }
 
-void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this)
+void CQuorum::StartCachePopulator(std::shared_ptr<CQuorum> _this, CEvoDB& evoDb)
 {
-    if (_this->quorumVvec == nullptr) {
+    if (_this->quorumVvec == nullptr || _this->HasAllPubKeyShares() || _this->cachePopulatorStarted.exchange(true)) {
         return;
     }
 
     cxxtimer::Timer t(true);
-    LogPrintf("CQuorum::StartCachePopulatorThread -- start\n");
+    LogPrintf("CQuorum::StartCachePopulator -- start\n");
 
-    // this thread will exit after some time
+    // the populators of the quorums run one after the other, on part of the workers
     // when then later some other thread tries to get keys, it will be much faster
-    _this->cachePopulatorThread = std::thread(&TraceThread<std::function<void()> >, "quorum-cachepop", [_this, t] {
-        for (size_t i = 0; i < _this->members.size() && !_this->stopCachePopulatorThread && !ShutdownRequested(); i++) {
-            if (_this->validMembers[i]) {
-                _this->GetPubKeyShare(i);
+    _this->blsWorker.PushBackgroundJob([_this, t, &evoDb] {
+        std::vector<CBLSPublicKey> pks(_this->members.size());
+        _this->blsWorker.ParallelForBackground(_this->members.size(), [&](size_t i) {
+            if (_this->validMembers[i] && !_this->stopCachePopulator && !ShutdownRequested()) {
+                pks[i] = _this->GetPubKeyShare(i);
             }
+        });
+        if (_this->stopCachePopulator || ShutdownRequested()) {
+            return;
         }
-        LogPrintf("CQuorum::StartCachePopulatorThread -- done. time=%d\n", t.count());
+
+        evoDb.GetRawDB().Write(std::make_pair(DB_QUORUM_PUBKEY_SHARES, MakeQuorumKey(*_this)), pks);
+        {
+            LOCK(_this->cs_pubKeyShares);
+            _this->pubKeyShares = std::move(pks);
+        }
+        LogPrintf("CQuorum::StartCachePopulator -- done. time=%d\n", t.count());
     });
 }
 
@@ -175,6 +200,13 @@ void CQuorumManager::UpdatedBlockTip(const CBlockIndex* pindexNew, bool fInitial
         auto lastQuorums = ScanQuorums(p.first, pindexNew, (size_t)params.keepOldConnections);
 
         llmq::EnsureLatestQuorumConnections(p.first, pindexNew, activeMasternodeManager->GetProTx(), lastQuorums);
+
+        // pre-populate the public key shares of the quorums which can sign, in the background
+        // recovering public key shares is quite expensive and would result in serious lags for the first few signing
+        // sessions if the shares would be calculated on-demand. Older quorums keep computing them on-demand only.
+        for (size_t i = 0; i < lastQuorums.size() && i < (size_t)params.signingActiveQuorumCount; i++) {
+            CQuorum::StartCachePopulator(std::const_pointer_cast<CQuorum>(lastQuorums[i]), evoDb);
+        }
     }
 }
 
@@ -187,25 +219,15 @@ bool CQuorumManager::BuildQuorumFromCommitment(const CFinalCommitment& qc, const
     auto members = deterministicMNManager->GetAllQuorumMembers((Consensus::LLMQType)qc.llmqType, pindexQuorum);
     quorum->Init(minedBlockHash, pindexQuorum, members, qc.validMembers, qc.quorumPublicKey);
 
-    bool hasValidVvec = false;
-    if (quorum->ReadContributions(evoDb)) {
-        hasValidVvec = true;
-    } else {
+    // the public key shares are pre-populated by UpdatedBlockTip, for the active quorums only
+    if (!quorum->ReadContributions(evoDb)) {
         if (BuildQuorumContributions(qc, quorum)) {
             quorum->WriteContributions(evoDb);
-            hasValidVvec = true;
         } else {
             LogPrintf("CQuorumManager::%s -- quorum.ReadContributions and BuildQuorumContributions for block %s failed\n", __func__, qc.quorumHash.ToString());
         }
     }
 
-    if (hasValidVvec) {
-        // pre-populate caches in the background
-        // recovering public key shares is quite expensive and would result in serious lags for the first few signing
-        // sessions if the shares would be calculated on-demand
-        CQuorum::StartCachePopulatorThread(quorum);
-    }
-
     return true;
 }
 
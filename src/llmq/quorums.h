@@ -46,14 +46,19 @@ public:
     CBLSSecretKey skShare;
 
 private:
-    // Recovery of public key shares is very slow, so we start a background thread that pre-populates a cache so that
-    // the public key shares are ready when needed later
+    // Recovery of public key shares is very slow, so we queue a background job on the BLS worker that pre-populates
+    // a cache so that the public key shares are ready when needed later
+    CBLSWorker& blsWorker;
     mutable CBLSWorkerCache blsCache;
-    std::atomic<bool> stopCachePopulatorThread;
-    std::thread cachePopulatorThread;
+    std::atomic<bool> stopCachePopulator;
+    std::atomic<bool> cachePopulatorStarted{false};
+
+    // The public key shares of all members once they are built (or read from the db), invalid for invalid members
+    mutable Mutex cs_pubKeyShares;
+    std::vector<CBLSPublicKey> pubKeyShares GUARDED_BY(cs_pubKeyShares);
 
 public:
-    CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker) : params(_params), blsCache(_blsWorker), stopCachePopulatorThread(false) {}
+    CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker) : params(_params), blsWorker(_blsWorker), blsCache(_blsWorker), stopCachePopulator(false) {}
     ~CQuorum();
     void Init(const uint256& minedBlockHash, const CBlockIndex* pindexQuorum, const std::vector<CDeterministicMNCPtr>& members, const std::vector<bool>& validMembers, const CBLSPublicKey& quorumPublicKey);
 
@@ -67,7 +72,10 @@ public:
 private:
     void WriteContributions(CEvoDB& evoDb);
     bool ReadContributions(CEvoDB& evoDb);
-    static void StartCachePopulatorThread(std::shared_ptr<CQuorum> _this);
+    bool HasAllPubKeyShares() const;
+    // Builds the public key shares of all members in parallel, on the background job of the BLS worker, and stores
+    // them in evoDb. Does nothing if they are known already or the job was queued before.
+    static void StartCachePopulator(std::shared_ptr<CQuorum> _this, CEvoDB& evoDb);
 };
 typedef std::shared_ptr<CQuorum> CQuorumPtr;
 typedef std::shared_ptr<const CQuorum> CQuorumCPtr;
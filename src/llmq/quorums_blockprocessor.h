@@ -40,6 +40,8 @@ private:
     std::map<uint256, CFinalCommitment> minableCommitments;
     // for each llmqtype map quorum_hash --> (bool final_commitment_mined)
     mutable std::map<Consensus::LLMQType, unordered_lru_cache<uint256, bool, StaticSaltedHasher>> mapHasMinedCommitmentCache GUARDED_BY(minableCommitmentsCs);
+    // for each llmqtype map quorum_hash --> (mined final commitment, mined block hash)
+    mutable std::map<Consensus::LLMQType, unordered_lru_cache<uint256, std::pair<CFinalCommitment, uint256>, StaticSaltedHasher>> mapMinedCommitmentCache GUARDED_BY(minableCommitmentsCs);
 
 public:
     explicit CQuorumBlockProcessor(CEvoDB& _evoDb);
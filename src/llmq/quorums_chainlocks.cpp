@@ -9,11 +9,13 @@
 #include "quorums_utils.h"
 
 #include "chain.h"
+#include "chaintipsnapshot.h"
 #include "net_processing.h"
 #include "scheduler.h"
 #include "spork.h"
 #include "sporkid.h"
 #include "validation.h"
+#include "validationinterface.h"
 
 namespace llmq
 {
@@ -124,9 +126,12 @@ void CChainLocksHandler::ProcessNewChainLock(NodeId from, const llmq::CChainLock
 
         bestChainLockHash = hash;
         bestChainLock = clsig;
+        auto& latencyStats = quorumSigningManager->GetLatencyStats();
+        latencyStats.MarkStage(requestId, CSigningLatencyStats::CLSIG_ACCEPTED);
 
         CInv inv(MSG_CLSIG, hash);
         g_connman->RelayInv(inv);
+        latencyStats.MarkStage(requestId, CSigningLatencyStats::CLSIG_RELAYED);
 
         auto blockIt = mapBlockIndex.find(clsig.blockHash);
         if (blockIt == mapBlockIndex.end()) {
@@ -235,10 +240,11 @@ void CChainLocksHandler::EnforceBestChainLock()
 {
     CChainLockSig clsig;
     const CBlockIndex* pindex;
+    const CBlockIndex* currentBestChainLockBlockIndex;
     {
         LOCK(cs);
         clsig = bestChainLockWithKnownBlock;
-        pindex = bestChainLockBlockIndex;
+        pindex = currentBestChainLockBlockIndex = bestChainLockBlockIndex;
     }
 
     {
@@ -271,6 +277,21 @@ void CChainLocksHandler::EnforceBestChainLock()
         // This should not have happened and we are in a state were it's not safe to continue anymore
         assert(false);
     }
+
+    // Notify the chainlock once, when its block becomes known
+    bool fNotify = false;
+    {
+        LOCK(cs);
+        if (currentBestChainLockBlockIndex && lastNotifyChainLockBlockIndex != currentBestChainLockBlockIndex) {
+            lastNotifyChainLockBlockIndex = currentBestChainLockBlockIndex;
+            fNotify = true;
+        }
+    }
+    if (fNotify) {
+        PublishChainLockSnapshot(currentBestChainLockBlockIndex);
+        FinalizeChainLockedBlock(currentBestChainLockBlockIndex);
+        GetMainSignals().NotifyChainLock(currentBestChainLockBlockIndex, clsig);
+    }
 }
 
 void CChainLocksHandler::HandleNewRecoveredSig(const llmq::CRecoveredSig& recoveredSig)
@@ -336,6 +357,12 @@ void CChainLocksHandler::DoInvalidateBlock(const CBlockIndex* pindex, bool activ
     }
 }
 
+int CChainLocksHandler::GetBestChainLockHeight()
+{
+    LOCK(cs);
+    return bestChainLock.nHeight;
+}
+
 bool CChainLocksHandler::HasChainLock(int nHeight, const uint256& blockHash)
 {
     if (!sporkManager.IsSporkActive(SPORK_23_CHAINLOCKS_ENFORCEMENT)) {
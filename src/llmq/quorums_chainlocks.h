@@ -52,6 +52,7 @@ private:
 
     CChainLockSig bestChainLockWithKnownBlock;
     const CBlockIndex* bestChainLockBlockIndex{nullptr};
+    const CBlockIndex* lastNotifyChainLockBlockIndex{nullptr};
 
     int32_t lastSignedHeight{-1};
     uint256 lastSignedRequestId;
@@ -79,6 +80,8 @@ public:
     virtual void HandleNewRecoveredSig(const CRecoveredSig& recoveredSig);
 
     bool HasChainLock(int nHeight, const uint256& blockHash);
+    // The height of the best chainlock, -1 if none
+    int GetBestChainLockHeight();
     bool HasConflictingChainLock(int nHeight, const uint256& blockHash);
 
 private:
@@ -8,8 +8,10 @@
 #include "evo/deterministicmns.h"
 #include "llmq/quorums.h"
 #include "net.h"
+#include "saltedhasher.h"
 #include "tiertwo/masternode_meta_manager.h" // for g_mmetaman
 #include "tiertwo/net_masternodes.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"
 
 #include <vector>
@@ -17,6 +19,17 @@
 namespace llmq
 {
 
+// The connections of the local masternode to the members of a quorum
+struct QuorumConnections {
+    uint256 myProTxHash;
+    bool isMember{false};
+    std::set<uint256> connections;
+    std::set<uint256> relayMembers;
+};
+
+static Mutex cs_quorumConnectionsCache;
+// the quorums of the kept connections, and the ones of the pending DKG rounds
+static unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, std::shared_ptr<const QuorumConnections>, StaticSaltedHasher, 64> quorumConnectionsCache GUARDED_BY(cs_quorumConnectionsCache);
 
 uint256 DeterministicOutboundConnection(const uint256& proTxHash1, const uint256& proTxHash2)
 {
@@ -116,9 +129,16 @@ void EnsureLatestQuorumConnections(Consensus::LLMQType llmqType, const CBlockInd
 
     // don't remove connections for the currently in-progress DKG round
     int curDkgHeight = pindexNew->nHeight - (pindexNew->nHeight % params.dkgInterval);
-    auto curDkgBlock = pindexNew->GetAncestor(curDkgHeight)->GetBlockHash();
+    const CBlockIndex* pindexCurDkg = pindexNew->GetAncestor(curDkgHeight);
+    auto curDkgBlock = pindexCurDkg->GetBlockHash();
     connmanQuorumsToDelete.erase(curDkgBlock);
 
+    // open them as soon as the quorum block is connected, the phase handler of the round registers them too
+    // but only once it wakes up on it, and the members have the initialization phase to connect to each other
+    if (!connman->hasQuorumNodes(llmqType, curDkgBlock) && deterministicMNManager->IsDIP3Enforced(curDkgHeight)) {
+        EnsureQuorumConnections(llmqType, pindexCurDkg, myProTxHash);
+    }
+
     for (auto& quorum : lastQuorums) {
         if (!quorum->IsMember(myProTxHash)) {
             continue;
@@ -136,30 +156,56 @@ void EnsureLatestQuorumConnections(Consensus::LLMQType llmqType, const CBlockInd
     }
 }
 
-// ensure connection to a given quorum
-void EnsureQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const uint256& myProTxHash)
+static std::shared_ptr<const QuorumConnections> CalcQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const uint256& myProTxHash)
 {
     const auto& members = deterministicMNManager->GetAllQuorumMembers(llmqType, pindexQuorum);
     auto itMember = std::find_if(members.begin(), members.end(), [&](const CDeterministicMNCPtr& dmn) { return dmn->proTxHash == myProTxHash; });
-    bool isMember = itMember != members.end();
 
-    if (!isMember) { // && !CLLMQUtils::IsWatchQuorumsEnabled()) {
-        return;
-    }
-
-    std::set<uint256> connections;
-    std::set<uint256> relayMembers;
-    if (isMember) {
-        connections = GetQuorumConnections(members, myProTxHash, true);
+    auto ret = std::make_shared<QuorumConnections>();
+    ret->myProTxHash = myProTxHash;
+    ret->isMember = itMember != members.end();
+    if (ret->isMember) {
+        ret->connections = GetQuorumConnections(members, myProTxHash, true);
         unsigned int memberIndex = itMember - members.begin();
-        relayMembers = GetQuorumRelayMembers(members, memberIndex);
-    } else {
+        ret->relayMembers = GetQuorumRelayMembers(members, memberIndex);
+    } else if (!members.empty()) {
         auto cindexes = CalcDeterministicWatchConnections(llmqType, pindexQuorum, members.size(), 1);
         for (auto idx : cindexes) {
-            connections.emplace(members[idx]->proTxHash);
+            ret->connections.emplace(members[idx]->proTxHash);
         }
-        relayMembers = connections;
+        ret->relayMembers = ret->connections;
     }
+    return ret;
+}
+
+// the members of a quorum don't change, the connections are computed once per quorum
+static std::shared_ptr<const QuorumConnections> GetQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const uint256& myProTxHash)
+{
+    const auto key = std::make_pair(llmqType, pindexQuorum->GetBlockHash());
+    std::shared_ptr<const QuorumConnections> ret;
+    {
+        LOCK(cs_quorumConnectionsCache);
+        if (quorumConnectionsCache.get(key, ret) && ret->myProTxHash == myProTxHash) {
+            return ret;
+        }
+    }
+    ret = CalcQuorumConnections(llmqType, pindexQuorum, myProTxHash);
+    LOCK(cs_quorumConnectionsCache);
+    quorumConnectionsCache.insert(key, ret);
+    return ret;
+}
+
+// ensure connection to a given quorum
+void EnsureQuorumConnections(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum, const uint256& myProTxHash)
+{
+    const auto quorumConnections = GetQuorumConnections(llmqType, pindexQuorum, myProTxHash);
+
+    if (!quorumConnections->isMember) { // && !CLLMQUtils::IsWatchQuorumsEnabled()) {
+        return;
+    }
+
+    const std::set<uint256>& connections = quorumConnections->connections;
+    const std::set<uint256>& relayMembers = quorumConnections->relayMembers;
     if (!connections.empty()) {
         auto connman = g_connman->GetTierTwoConnMan();
         if (!connman->hasQuorumNodes(llmqType, pindexQuorum->GetBlockHash()) && LogAcceptCategory(BCLog::LLMQ)) {
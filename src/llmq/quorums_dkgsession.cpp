@@ -319,7 +319,16 @@ void CDKGSession::ReceiveMessage(const uint256& hash, const CDKGContribution& qc
 
     bool complain = false;
     CBLSSecretKey skContribution;
-    if (!qc.contributions->Decrypt(myIdx, *activeMasternodeManager->OperatorKey(), skContribution, PROTOCOL_VERSION)) {
+    bool fDecrypted;
+    auto itDecrypted = decryptedSkContributions.find(hash);
+    if (itDecrypted != decryptedSkContributions.end()) {
+        skContribution = itDecrypted->second;
+        fDecrypted = skContribution.IsValid();
+        decryptedSkContributions.erase(itDecrypted);
+    } else {
+        fDecrypted = qc.contributions->Decrypt(myIdx, *activeMasternodeManager->OperatorKey(), skContribution, PROTOCOL_VERSION);
+    }
+    if (!fDecrypted) {
         logger.Batch("contribution from %s could not be decrypted", member->dmn->proTxHash.ToString());
         complain = true;
     } else if (member->idx != myIdx && ShouldSimulateError("complain-lie")) {
@@ -350,6 +359,46 @@ void CDKGSession::ReceiveMessage(const uint256& hash, const CDKGContribution& qc
     }
 }
 
+// Decrypts our shares of a batch of contributions on the worker threads. Decryption needs a
+// (slow) scalar multiplication per contribution, that ReceiveMessage would do one after the other.
+void CDKGSession::DecryptContributions(const std::vector<std::pair<uint256, const CDKGContribution*>>& qcs)
+{
+    if (!AreWeMember()) {
+        return;
+    }
+
+    CDKGLogger logger(*this, __func__);
+    cxxtimer::Timer t1(true);
+
+    std::vector<std::pair<uint256, const CDKGContribution*>> toDecrypt;
+    {
+        LOCK(invCs);
+        for (const auto& p : qcs) {
+            // ReceiveMessage stops before the decryption for the second contribution of a member
+            auto member = GetMember(p.second->proTxHash);
+            if (member && member->contributions.empty() && !decryptedSkContributions.count(p.first)) {
+                toDecrypt.emplace_back(p);
+            }
+        }
+    }
+    if (toDecrypt.empty()) {
+        return;
+    }
+
+    const CBLSSecretKey& skOperator = *activeMasternodeManager->OperatorKey();
+    BLSSecretKeyVector skContributionsRet(toDecrypt.size());
+    blsWorker.ParallelFor(toDecrypt.size(), [&](size_t i) {
+        if (!toDecrypt[i].second->contributions->Decrypt(myIdx, skOperator, skContributionsRet[i], PROTOCOL_VERSION)) {
+            skContributionsRet[i] = CBLSSecretKey();
+        }
+    });
+    for (size_t i = 0; i < toDecrypt.size(); i++) {
+        decryptedSkContributions.emplace(toDecrypt[i].first, skContributionsRet[i]);
+    }
+
+    logger.Batch("decrypted %d contributions. time=%d", toDecrypt.size(), t1.count());
+}
+
 // Verifies all pending secret key contributions in one batch
 // This is done by aggregating the verification vectors belonging to the secret key contributions
 // The resulting aggregated vvec is then used to recover a public key share
@@ -272,6 +272,9 @@ private:
     std::set<uint256> seenMessages;
 
     std::vector<size_t> pendingContributionVerifications;
+    // our shares of the received contributions, decrypted by DecryptContributions ahead of ReceiveMessage.
+    // By msg hash, an invalid key means that the decryption failed. Only used by the phase thread.
+    std::map<uint256, CBLSSecretKey> decryptedSkContributions;
 
     // filled by ReceivePrematureCommitment and used by FinalizeCommitments
     std::set<uint256> validCommitments;
@@ -302,6 +305,7 @@ public:
     void SendContributions(CDKGPendingMessages& pendingMessages);
     bool PreVerifyMessage(const CDKGContribution& qc, bool& retBan) const;
     void ReceiveMessage(const uint256& hash, const CDKGContribution& qc, bool& retBan);
+    void DecryptContributions(const std::vector<std::pair<uint256, const CDKGContribution*>>& qcs);
     void VerifyPendingContributions();
 
     // Phase 2: complaint
@@ -6,6 +6,7 @@
 #include "llmq/quorums_dkgsessionhandler.h"
 
 #include "activemasternode.h"
+#include "bls/bls_batchverifier.h"
 #include "chainparams.h"
 #include "llmq/quorums_blockprocessor.h"
 #include "llmq/quorums_connections.h"
@@ -18,6 +19,11 @@
 namespace llmq
 {
 
+// the phase handler thread is woken up by the events, this only bounds the time to notice a shutdown request
+static const int64_t MAX_WAKEUP_WAIT_MILLIS = 1000;
+// the signatures of a batch are verified at once
+static const size_t MAX_MESSAGE_BATCH_SIZE = 32;
+
 CDKGPendingMessages::CDKGPendingMessages(size_t _maxMessagesPerNode) :
     maxMessagesPerNode(_maxMessagesPerNode)
 {
@@ -126,6 +132,7 @@ void CDKGSessionHandler::UpdatedBlockTip(const CBlockIndex* pindexNew)
 
     LogPrint(BCLog::DKG, "CDKGSessionHandler::%s -- %s - currentHeight=%d, quorumHeight=%d, oldPhase=%d, newPhase=%d\n", __func__,
             params.name, currentHeight, quorumHeight, oldPhase, phase);
+    Wakeup();
 }
 
 void CDKGSessionHandler::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
@@ -139,7 +146,10 @@ void CDKGSessionHandler::ProcessMessage(CNode* pfrom, const std::string& strComm
         pendingJustifications.PushPendingMessage(pfrom->GetId(), vRecv, MSG_QUORUM_JUSTIFICATION);
     } else if (strCommand == NetMsgType::QPCOMMITMENT) {
         pendingPrematureCommitments.PushPendingMessage(pfrom->GetId(), vRecv, MSG_QUORUM_PREMATURE_COMMITMENT);
+    } else {
+        return;
     }
+    Wakeup();
 }
 
 void CDKGSessionHandler::StartThread()
@@ -155,6 +165,7 @@ void CDKGSessionHandler::StartThread()
 void CDKGSessionHandler::StopThread()
 {
     stopRequested = true;
+    Wakeup();
     if (phaseHandlerThread.joinable()) {
         phaseHandlerThread.join();
     }
@@ -185,6 +196,22 @@ CDKGSessionHandler::QuorumPhaseAndHash CDKGSessionHandler::GetPhaseAndQuorumHash
     return {phase, quorumHash};
 }
 
+void CDKGSessionHandler::Wakeup()
+{
+    LOCK(cs_wakeup);
+    fWakeup = true;
+    cvWakeup.notify_one();
+}
+
+void CDKGSessionHandler::WaitForWakeup(int64_t nMaxWaitMillis)
+{
+    WAIT_LOCK(cs_wakeup, lock);
+    cvWakeup.wait_for(lock, std::chrono::milliseconds(std::max(nMaxWaitMillis, (int64_t)0)), [&]() EXCLUSIVE_LOCKS_REQUIRED(cs_wakeup) {
+        return fWakeup;
+    });
+    fWakeup = false;
+}
+
 class AbortPhaseException : public std::exception {
 };
 
@@ -211,7 +238,7 @@ void CDKGSessionHandler::WaitForNextPhase(QuorumPhase curPhase,
             throw AbortPhaseException();
         }
         if (!runWhileWaiting()) {
-            MilliSleep(100);
+            WaitForWakeup(MAX_WAKEUP_WAIT_MILLIS);
         }
     }
 
@@ -241,7 +268,7 @@ void CDKGSessionHandler::WaitForNewQuorum(const uint256& oldQuorumHash)
         if (currState.quorumHash != oldQuorumHash) {
             break;
         }
-        MilliSleep(100);
+        WaitForWakeup(MAX_WAKEUP_WAIT_MILLIS);
     }
 
     LogPrint(BCLog::DKG, "CDKGSessionHandler::%s -- %s - done\n", __func__, params.name);
@@ -309,7 +336,7 @@ void CDKGSessionHandler::SleepBeforePhase(QuorumPhase curPhase,
             }
         }
         if (!runWhileWaiting()) {
-            MilliSleep(100);
+            WaitForWakeup(std::min(endTime - GetTimeMillis(), MAX_WAKEUP_WAIT_MILLIS));
         }
     }
 
@@ -341,16 +368,10 @@ std::set<NodeId> BatchVerifyMessageSigs(CDKGSession& session, const std::vector<
     }
 
     std::set<NodeId> ret;
-    bool revertToSingleVerification = false;
-
-    CBLSSignature aggSig;
-    std::vector<CBLSPublicKey> pubKeys;
-    std::vector<uint256> messageHashes;
-    std::set<uint256> messageHashesSet;
-    pubKeys.reserve(messages.size());
-    messageHashes.reserve(messages.size());
-    bool first = true;
-    for (const auto& p : messages ) {
+    // the operator keys are chosen by the masternodes: secure verification, to not allow the rogue public key
+    // attack when two members sign the same message. The bad nodes are found by bisection.
+    CBLSBatchVerifier<NodeId, uint256> batchVerifier(true, false);
+    for (const auto& p : messages) {
         const auto& msg = *p.second;
 
         auto member = session.GetMember(msg.proTxHash);
@@ -359,72 +380,37 @@ std::set<NodeId> BatchVerifyMessageSigs(CDKGSession& session, const std::vector<
             ret.emplace(p.first);
             continue;
         }
-
-        if (first) {
-            aggSig = msg.sig;
-        } else {
-            aggSig.AggregateInsecure(msg.sig);
-        }
-        first = false;
-
-        auto msgHash = msg.GetSignHash();
-        if (!messageHashesSet.emplace(msgHash).second) {
-            // can only happen in 2 cases:
-            // 1. Someone sent us the same message twice but with differing signature, meaning that at least one of them
-            //    must be invalid. In this case, we'd have to revert to single message verification nevertheless
-            // 2. Someone managed to find a way to create two different binary representations of a message that deserializes
-            //    to the same object representation. This would be some form of malleability. However, this shouldn't be
-            //    possible as only deterministic/unique BLS signatures and very simple data types are involved
-            revertToSingleVerification = true;
-            break;
-        }
-
-        pubKeys.emplace_back(member->dmn->pdmnState->pubKeyOperator.Get());
-        messageHashes.emplace_back(msgHash);
-    }
-    if (!revertToSingleVerification) {
-        bool valid = aggSig.VerifyInsecureAggregated(pubKeys, messageHashes);
-        if (valid) {
-            // all good
-            return ret;
+        const CBLSPublicKey& pubKey = member->dmn->pdmnState->pubKeyOperator.Get();
+        if (!msg.sig.IsValid() || !pubKey.IsValid()) {
+            ret.emplace(p.first);
+            continue;
         }
 
-        // are all messages from the same node?
-        NodeId firstNodeId;
-        first = true;
-        bool nodeIdsAllSame = true;
-        for (auto it = messages.begin(); it != messages.end(); ++it) {
-            if (first) {
-                firstNodeId = it->first;
-            } else {
-                first = false;
-                if (it->first != firstNodeId) {
-                    nodeIdsAllSame = false;
-                    break;
-                }
-            }
-        }
-        // if yes, take a short path and return a set with only him
-        if (nodeIdsAllSame) {
-            ret.emplace(firstNodeId);
-            return ret;
-        }
-        // different nodes, let's figure out who are the bad ones
+        batchVerifier.PushMessage(p.first, ::SerializeHash(msg), msg.GetSignHash(), msg.sig, pubKey);
     }
+    batchVerifier.Verify();
+    ret.insert(batchVerifier.badSources.begin(), batchVerifier.badSources.end());
+    return ret;
+}
 
-    for (const auto& p : messages) {
-        if (ret.count(p.first)) {
-            continue;
-        }
+// the expensive work of a batch of messages that does not depend on the order they are received in
+template<typename Message>
+static void PrepareMessageBatch(CDKGSession& session, const std::vector<uint256>& hashes,
+                                const std::vector<std::pair<NodeId, std::shared_ptr<Message>>>& messages, const std::set<NodeId>& badNodes)
+{
+}
 
-        const auto& msg = *p.second;
-        auto member = session.GetMember(msg.proTxHash);
-        bool valid = msg.sig.VerifyInsecure(member->dmn->pdmnState->pubKeyOperator.Get(), msg.GetSignHash());
-        if (!valid) {
-            ret.emplace(p.first);
+template<>
+void PrepareMessageBatch<CDKGContribution>(CDKGSession& session, const std::vector<uint256>& hashes,
+                                           const std::vector<std::pair<NodeId, std::shared_ptr<CDKGContribution>>>& messages, const std::set<NodeId>& badNodes)
+{
+    std::vector<std::pair<uint256, const CDKGContribution*>> qcs;
+    for (size_t i = 0; i < messages.size(); i++) {
+        if (!badNodes.count(messages[i].first)) {
+            qcs.emplace_back(hashes[i], messages[i].second.get());
         }
     }
-    return ret;
+    session.DecryptContributions(qcs);
 }
 
 template<typename Message>
@@ -479,6 +465,8 @@ static bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages
         }
     }
 
+    PrepareMessageBatch(session, hashes, preverifiedMessages, badNodes);
+
     for (size_t i = 0; i < preverifiedMessages.size(); i++) {
         NodeId nodeId = preverifiedMessages[i].first;
         if (badNodes.count(nodeId)) {
@@ -544,7 +532,7 @@ void CDKGSessionHandler::HandleDKGRound()
         curSession->Contribute(pendingContributions);
     };
     auto fContributeWait = [this] {
-        return ProcessPendingMessageBatch<CDKGContribution>(*curSession, pendingContributions, 8);
+        return ProcessPendingMessageBatch<CDKGContribution>(*curSession, pendingContributions, MAX_MESSAGE_BATCH_SIZE);
     };
     HandlePhase(QuorumPhase_Contribute, QuorumPhase_Complain, curQuorumHash, 0.05, fContributeStart, fContributeWait);
 
@@ -553,7 +541,7 @@ void CDKGSessionHandler::HandleDKGRound()
         curSession->VerifyAndComplain(pendingComplaints);
     };
     auto fComplainWait = [this] {
-        return ProcessPendingMessageBatch<CDKGComplaint>(*curSession, pendingComplaints, 8);
+        return ProcessPendingMessageBatch<CDKGComplaint>(*curSession, pendingComplaints, MAX_MESSAGE_BATCH_SIZE);
     };
     HandlePhase(QuorumPhase_Complain, QuorumPhase_Justify, curQuorumHash, 0.05, fComplainStart, fComplainWait);
 
@@ -562,7 +550,7 @@ void CDKGSessionHandler::HandleDKGRound()
         curSession->VerifyAndJustify(pendingJustifications);
     };
     auto fJustifyWait = [this] {
-        return ProcessPendingMessageBatch<CDKGJustification>(*curSession, pendingJustifications, 8);
+        return ProcessPendingMessageBatch<CDKGJustification>(*curSession, pendingJustifications, MAX_MESSAGE_BATCH_SIZE);
     };
     HandlePhase(QuorumPhase_Justify, QuorumPhase_Commit, curQuorumHash, 0.05, fJustifyStart, fJustifyWait);
 
@@ -571,7 +559,7 @@ void CDKGSessionHandler::HandleDKGRound()
         curSession->VerifyAndCommit(pendingPrematureCommitments);
     };
     auto fCommitWait = [this] {
-        return ProcessPendingMessageBatch<CDKGPrematureCommitment>(*curSession, pendingPrematureCommitments, 8);
+        return ProcessPendingMessageBatch<CDKGPrematureCommitment>(*curSession, pendingPrematureCommitments, MAX_MESSAGE_BATCH_SIZE);
     };
     HandlePhase(QuorumPhase_Commit, QuorumPhase_Finalize, curQuorumHash, 0.1, fCommitStart, fCommitWait);
 
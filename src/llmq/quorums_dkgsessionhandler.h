@@ -10,6 +10,8 @@
 #include "llmq/quorums_dkgsession.h"
 #include "validation.h"
 
+#include <condition_variable>
+
 namespace llmq
 {
 
@@ -116,6 +118,11 @@ private:
     CDKGPendingMessages pendingJustifications;
     CDKGPendingMessages pendingPrematureCommitments;
 
+    // wakes up the phase handler thread when a block or a message is received, or the thread is stopped
+    Mutex cs_wakeup;
+    std::condition_variable cvWakeup;
+    bool fWakeup GUARDED_BY(cs_wakeup){false};
+
 public:
     CDKGSessionHandler(const Consensus::LLMQParams& _params, CEvoDB& _evoDb, CBLSWorker& blsWorker, CDKGSessionManager& _dkgManager);
     ~CDKGSessionHandler();
@@ -135,6 +142,10 @@ private:
     };
     QuorumPhaseAndHash GetPhaseAndQuorumHash() const;
 
+    void Wakeup();
+    // waits for the next Wakeup call, at most nMaxWaitMillis
+    void WaitForWakeup(int64_t nMaxWaitMillis);
+
     typedef std::function<void()> StartPhaseFunc;
     typedef std::function<bool()> WhileWaitFunc;
     void WaitForNextPhase(QuorumPhase curPhase, QuorumPhase nextPhase, const uint256& expectedQuorumHash, const WhileWaitFunc& runWhileWaiting);
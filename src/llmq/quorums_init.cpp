@@ -13,6 +13,7 @@
 #include "quorums_chainlocks.h"
 #include "quorums_signing.h"
 #include "quorums_signing_shares.h"
+#include "util/system.h"
 
 namespace llmq
 {
@@ -48,7 +49,7 @@ void DestroyLLMQSystem()
 void StartLLMQSystem()
 {
     if (blsWorker) {
-        blsWorker->Start();
+        blsWorker->Start(gArgs.GetArg("-parbls", DEFAULT_BLS_WORKER_THREADS));
     }
     if (quorumDKGSessionManager) {
         quorumDKGSessionManager->StartThreads();
@@ -8,12 +8,15 @@
 
 #include "scheduler.h"
 
+class CBLSWorker;
 class CDBWrapper;
 class CEvoDB;
 
 namespace llmq
 {
 
+extern CBLSWorker* blsWorker;
+
 // Init/destroy LLMQ globals
 void InitLLMQSystem(CEvoDB& evoDb, CScheduler* scheduler, bool unitTests);
 void DestroyLLMQSystem();
@@ -13,7 +13,10 @@
 #include "bls/bls_batchverifier.h"
 #include "cxxtimer.h"
 #include "net_processing.h"
+#include "script/sigcache.h"
+#include "univalue.h"
 #include "validation.h"
+#include "validationinterface.h"
 
 #include <algorithm>
 #include <limits>
@@ -23,36 +26,118 @@ namespace llmq
 
 std::unique_ptr<CSigningManager> quorumSigningManager{nullptr};
 
-CRecoveredSigsDb::CRecoveredSigsDb(bool fMemory) : db(fMemory ? "" : (GetDataDir() / "llmq"), 1 << 20, fMemory, false, CLIENT_VERSION | ADDRV2_FORMAT)
+/**
+ * Valid recovered signatures cache: a recovered signature of the chainlocks quorum is verified
+ * (or recovered) by the signing manager, and verified again as the CLSIG of the chainlock.
+ * Entries are Hash(nonce || sign hash || signature).
+ */
+static CVerifiedResultCache recoveredSigsCache("LLMQ recovered signatures", "maxrecsigcachesize", DEFAULT_MAX_RECSIG_CACHE_SIZE, MAX_MAX_RECSIG_CACHE_SIZE);
+
+static uint256 ComputeRecoveredSigEntry(const uint256& signHash, const CBLSSignature& sig)
 {
+    CHashWriter hw(SER_GETHASH, PROTOCOL_VERSION);
+    hw << recoveredSigsCache.GetNonce() << signHash << sig;
+    return hw.GetHash();
+}
+
+// The recovered signatures are written once and seldom read back, a cheap place to trade CPU for disk
+static CDBOptions RecoveredSigsDBOptions()
+{
+    CDBOptions dbOptions("recsigs");
+    dbOptions.fCompression = true;
+    return dbOptions;
+}
+
+CRecoveredSigsDb::CRecoveredSigsDb(bool fMemory) : db(fMemory ? "" : (GetDataDir() / "llmq"), 1 << 20, fMemory, false, CLIENT_VERSION | ADDRV2_FORMAT, RecoveredSigsDBOptions())
+{
+}
+
+CRecoveredSigsDb::~CRecoveredSigsDb()
+{
+    FlushPendingRecoveredSigs(true);
 }
 
 bool CRecoveredSigsDb::HasRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash)
 {
+    {
+        LOCK(cs);
+        auto it = pendingRecSigs.find(std::make_pair(llmqType, id));
+        if (it != pendingRecSigs.end()) {
+            return it->second.msgHash == msgHash;
+        }
+        bool ret;
+        if (hasSigForIdCache.get(std::make_pair(llmqType, id), ret) && !ret) {
+            return false;
+        }
+    }
+
     auto k = std::make_tuple('r', (uint8_t)llmqType, id, msgHash);
     return db.Exists(k);
 }
 
 bool CRecoveredSigsDb::HasRecoveredSigForId(Consensus::LLMQType llmqType, const uint256& id)
 {
+    auto cacheKey = std::make_pair(llmqType, id);
+    LOCK(cs);
+    if (pendingRecSigs.count(cacheKey)) {
+        return true;
+    }
+    bool ret;
+    if (hasSigForIdCache.get(cacheKey, ret)) {
+        return ret;
+    }
+
     auto k = std::make_tuple('r', (uint8_t)llmqType, id);
-    return db.Exists(k);
+    ret = db.Exists(k);
+    hasSigForIdCache.insert(cacheKey, ret);
+    return ret;
 }
 
 bool CRecoveredSigsDb::HasRecoveredSigForSession(const uint256& signHash)
 {
+    LOCK(cs);
+    if (pendingRecSigsBySession.count(signHash)) {
+        return true;
+    }
+    bool ret;
+    if (hasSigForSessionCache.get(signHash, ret)) {
+        return ret;
+    }
+
     auto k = std::make_tuple('s', signHash);
-    return db.Exists(k);
+    ret = db.Exists(k);
+    hasSigForSessionCache.insert(signHash, ret);
+    return ret;
 }
 
 bool CRecoveredSigsDb::HasRecoveredSigForHash(const uint256& hash)
 {
+    LOCK(cs);
+    if (pendingRecSigsByHash.count(hash)) {
+        return true;
+    }
+    bool ret;
+    if (hasSigForHashCache.get(hash, ret)) {
+        return ret;
+    }
+
     auto k = std::make_tuple('h', hash);
-    return db.Exists(k);
+    ret = db.Exists(k);
+    hasSigForHashCache.insert(hash, ret);
+    return ret;
 }
 
 bool CRecoveredSigsDb::ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret)
 {
+    {
+        LOCK(cs);
+        auto it = pendingRecSigs.find(std::make_pair(llmqType, id));
+        if (it != pendingRecSigs.end()) {
+            ret = it->second;
+            return true;
+        }
+    }
+
     auto k = std::make_tuple('r', (uint8_t)llmqType, id);
 
     CDataStream ds(SER_DISK, CLIENT_VERSION);
@@ -70,6 +155,15 @@ bool CRecoveredSigsDb::ReadRecoveredSig(Consensus::LLMQType llmqType, const uint
 
 bool CRecoveredSigsDb::GetRecoveredSigByHash(const uint256& hash, CRecoveredSig& ret)
 {
+    {
+        LOCK(cs);
+        auto it = pendingRecSigsByHash.find(hash);
+        if (it != pendingRecSigsByHash.end()) {
+            ret = pendingRecSigs.at(it->second);
+            return true;
+        }
+    }
+
     auto k1 = std::make_tuple('h', hash);
     std::pair<uint8_t, uint256> k2;
     if (!db.Read(k1, k2)) {
@@ -86,36 +180,79 @@ bool CRecoveredSigsDb::GetRecoveredSigById(Consensus::LLMQType llmqType, const u
 
 void CRecoveredSigsDb::WriteRecoveredSig(const llmq::CRecoveredSig& recSig)
 {
-    CDBBatch batch(CLIENT_VERSION | ADDRV2_FORMAT);
+    auto key = std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.id);
+    auto signHash = llmq::utils::BuildSignHash(recSig);
 
-    // we put these close to each other to leverage leveldb's key compaction
-    // this way, the second key can be used for fast HasRecoveredSig checks while the first key stores the recSig
-    auto k1 = std::make_tuple('r', recSig.llmqType, recSig.id);
-    auto k2 = std::make_tuple('r', recSig.llmqType, recSig.id, recSig.msgHash);
-    batch.Write(k1, recSig);
-    batch.Write(k2, (uint8_t)1);
+    LOCK(cs);
+    pendingRecSigs.emplace(key, recSig);
+    pendingRecSigsByHash.emplace(recSig.GetHash(), key);
+    pendingRecSigsBySession.emplace(signHash, key);
+    hasSigForIdCache.insert(key, true);
+    hasSigForSessionCache.insert(signHash, true);
+    hasSigForHashCache.insert(recSig.GetHash(), true);
 
-    // store by object hash
-    auto k3 = std::make_tuple('h', recSig.GetHash());
-    batch.Write(k3, std::make_pair(recSig.llmqType, recSig.id));
+    if (pendingRecSigs.size() >= MAX_PENDING_RECOVERED_SIGS) {
+        WritePendingRecoveredSigs();
+    }
+}
 
-    // store by signHash
-    auto k4 = std::make_tuple('s', llmq::utils::BuildSignHash(recSig));
-    batch.Write(k4, (uint8_t)1);
+void CRecoveredSigsDb::FlushPendingRecoveredSigs(bool fForce)
+{
+    LOCK(cs);
+    if (pendingRecSigs.empty()) {
+        return;
+    }
+    if (!fForce && GetTimeMillis() - lastFlushTime < FLUSH_INTERVAL) {
+        return;
+    }
+    WritePendingRecoveredSigs();
+}
+
+void CRecoveredSigsDb::WritePendingRecoveredSigs()
+{
+    AssertLockHeld(cs);
 
-    // remove the votedForId entry as we won't need it anymore
-    auto k5 = std::make_tuple('v', recSig.llmqType, recSig.id);
-    batch.Erase(k5);
+    CDBBatch batch(CLIENT_VERSION | ADDRV2_FORMAT);
+    const uint32_t nTime = (uint32_t)GetAdjustedTime();
+    for (const auto& p : pendingRecSigs) {
+        const CRecoveredSig& recSig = p.second;
+
+        // we put these close to each other to leverage leveldb's key compaction
+        // this way, the second key can be used for fast HasRecoveredSig checks while the first key stores the recSig
+        auto k1 = std::make_tuple('r', recSig.llmqType, recSig.id);
+        auto k2 = std::make_tuple('r', recSig.llmqType, recSig.id, recSig.msgHash);
+        batch.Write(k1, recSig);
+        batch.Write(k2, (uint8_t)1);
 
-    // store by current time. Allows fast cleanup of old recSigs
-    auto k6 = std::make_tuple('t', (uint32_t)GetAdjustedTime(), recSig.llmqType, recSig.id);
-    batch.Write(k6, (uint8_t)1);
+        // store by object hash
+        auto k3 = std::make_tuple('h', recSig.GetHash());
+        batch.Write(k3, std::make_pair(recSig.llmqType, recSig.id));
+
+        // store by signHash
+        auto k4 = std::make_tuple('s', llmq::utils::BuildSignHash(recSig));
+        batch.Write(k4, (uint8_t)1);
 
+        // remove the votedForId entry as we won't need it anymore
+        auto k5 = std::make_tuple('v', recSig.llmqType, recSig.id);
+        batch.Erase(k5);
+
+        // store by current time. Allows fast cleanup of old recSigs
+        auto k6 = std::make_tuple('t', nTime, recSig.llmqType, recSig.id);
+        batch.Write(k6, (uint8_t)1);
+    }
     db.WriteBatch(batch);
+
+    pendingRecSigs.clear();
+    pendingRecSigsByHash.clear();
+    pendingRecSigsBySession.clear();
+    lastFlushTime = GetTimeMillis();
 }
 
 void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
 {
+    // the iteration below only sees what is in the db already
+    FlushPendingRecoveredSigs(true);
+
     std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
 
     auto start = std::make_tuple('t', (uint32_t)0, (uint8_t)0, uint256());
@@ -147,6 +284,8 @@ void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
     }
 
     CDBBatch batch(CLIENT_VERSION | ADDRV2_FORMAT);
+    std::vector<uint256> toDeleteHashes;
+    std::vector<uint256> toDeleteSessions;
     for (auto& e : toDelete) {
         CRecoveredSig recSig;
         if (!ReadRecoveredSig(e.first, e.second, recSig)) {
@@ -163,23 +302,43 @@ void CRecoveredSigsDb::CleanupOldRecoveredSigs(int64_t maxAge)
         batch.Erase(k3);
         batch.Erase(k4);
         batch.Erase(k5);
+        toDeleteHashes.emplace_back(recSig.GetHash());
+        toDeleteSessions.emplace_back(std::get<1>(k4));
     }
 
     for (auto& e : toDelete2) {
         batch.Erase(e);
     }
 
+    // hold cs while writing, so that no lookup caches what is being deleted
+    LOCK(cs);
     db.WriteBatch(batch);
+    for (auto& e : toDelete) {
+        hasSigForIdCache.erase(e);
+    }
+    for (auto& k : toDeleteHashes) {
+        hasSigForHashCache.erase(k);
+    }
+    for (auto& k : toDeleteSessions) {
+        hasSigForSessionCache.erase(k);
+    }
 }
 
 bool CRecoveredSigsDb::HasVotedOnId(Consensus::LLMQType llmqType, const uint256& id)
 {
+    // the vote is erased when the pending recovered sig is flushed
+    if (WITH_LOCK(cs, return pendingRecSigs.count(std::make_pair(llmqType, id)) > 0; )) {
+        return false;
+    }
     auto k = std::make_tuple('v', (uint8_t)llmqType, id);
     return db.Exists(k);
 }
 
 bool CRecoveredSigsDb::GetVoteForId(Consensus::LLMQType llmqType, const uint256& id, uint256& msgHashRet)
 {
+    if (WITH_LOCK(cs, return pendingRecSigs.count(std::make_pair(llmqType, id)) > 0; )) {
+        return false;
+    }
     auto k = std::make_tuple('v', (uint8_t)llmqType, id);
     return db.Read(k, msgHashRet);
 }
@@ -192,6 +351,116 @@ void CRecoveredSigsDb::WriteVoteForId(Consensus::LLMQType llmqType, const uint25
 
 //////////////////
 
+constexpr std::array<int64_t, 10> CSigningLatencyStats::HistogramBounds::VALUES;
+
+const char* CSigningLatencyStats::GetStageName(Stage stage)
+{
+    switch (stage) {
+    case SIGN_REQUESTED: return "signRequested";
+    case SHARE_CREATED: return "shareCreated";
+    case SHARES_COLLECTED: return "sharesCollected";
+    case RECOVERED: return "recovered";
+    case CLSIG_ACCEPTED: return "clsigAccepted";
+    case CLSIG_RELAYED: return "clsigRelayed";
+    default: return "unknown";
+    }
+}
+
+void CSigningLatencyStats::StartSession(const uint256& id)
+{
+    int64_t nNow = GetTimeMicros();
+    LOCK(cs);
+    if (sessions.size() >= MAX_SESSIONS) {
+        for (auto it = sessions.begin(); it != sessions.end(); ) {
+            if (nNow - it->second[SIGN_REQUESTED] > SESSION_TIMEOUT) {
+                it = sessions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (sessions.size() >= MAX_SESSIONS) {
+            auto itOldest = std::min_element(sessions.begin(), sessions.end(), [](const auto& a, const auto& b) {
+                return a.second[SIGN_REQUESTED] < b.second[SIGN_REQUESTED];
+            });
+            sessions.erase(itOldest);
+        }
+    }
+
+    std::array<int64_t, STAGE_COUNT> times{};
+    times[SIGN_REQUESTED] = nNow;
+    if (!sessions.emplace(id, times).second) {
+        return;
+    }
+
+    if (++nSessionsStarted % LOG_INTERVAL == 0) {
+        LogPrint(BCLog::LLMQ, "CSigningLatencyStats -- %d sessions: %s\n", nSessionsStarted, ToString());
+    }
+}
+
+void CSigningLatencyStats::MarkStage(const uint256& id, Stage stage)
+{
+    int64_t nNow = GetTimeMicros();
+    LOCK(cs);
+    auto it = sessions.find(id);
+    if (it == sessions.end() || it->second[stage] != 0) {
+        return;
+    }
+    auto& times = it->second;
+    times[stage] = nNow;
+
+    // stages can be skipped, e.g. the recovered sig can come from another node before we collected the shares
+    int prev = (int)stage - 1;
+    while (prev > SIGN_REQUESTED && times[prev] == 0) {
+        prev--;
+    }
+    histograms[stage].Add(nNow - times[prev]);
+
+    LogPrint(BCLog::LLMQ, "CSigningLatencyStats::%s -- id=%s, stage=%s, time=%dms, total=%dms\n", __func__,
+             id.ToString(), GetStageName(stage), (nNow - times[prev]) / 1000, (nNow - times[SIGN_REQUESTED]) / 1000);
+}
+
+std::string CSigningLatencyStats::ToString() const
+{
+    std::string ret;
+    for (int s = SHARE_CREATED; s < STAGE_COUNT; s++) {
+        const Histogram& h = histograms[s];
+        ret += strprintf("%s%s={count=%d, avg=%dms, max=%dms, buckets=[", s == SHARE_CREATED ? "" : ", ",
+                         GetStageName((Stage)s), h.nCount, h.GetAverageMicros() / 1000, h.nMaxMicros / 1000);
+        for (size_t i = 0; i < Histogram::BUCKET_COUNT; i++) {
+            ret += strprintf("%s%d", i ? " " : "", h.vBuckets[i]);
+        }
+        ret += "]}";
+    }
+    return ret;
+}
+
+UniValue CSigningLatencyStats::ToJson() const
+{
+    LOCK(cs);
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("sessions", (int64_t)nSessionsStarted);
+    ret.pushKV("pending", (int64_t)sessions.size());
+    for (int s = SHARE_CREATED; s < STAGE_COUNT; s++) {
+        const Histogram& h = histograms[s];
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("count", (int64_t)h.nCount);
+        obj.pushKV("avg_ms", h.GetAverageMicros() / 1000);
+        obj.pushKV("max_ms", h.nMaxMicros / 1000);
+        const auto& bounds = HistogramBounds::VALUES;
+        UniValue buckets(UniValue::VOBJ);
+        for (size_t i = 0; i < Histogram::BUCKET_COUNT; i++) {
+            std::string strBucket = i < bounds.size() ? strprintf("<=%dms", bounds[i] / 1000)
+                                                      : strprintf(">%dms", bounds.back() / 1000);
+            buckets.pushKV(strBucket, (int64_t)h.vBuckets[i]);
+        }
+        obj.pushKV("histogram", buckets);
+        ret.pushKV(GetStageName((Stage)s), obj);
+    }
+    return ret;
+}
+
+//////////////////
+
 CSigningManager::CSigningManager(bool fMemory) : db(fMemory)
 {
 }
@@ -366,14 +635,20 @@ void CSigningManager::ProcessPendingRecoveredSigs(CConnman& connman)
         auto& v = p.second;
 
         for (auto& recSig : v) {
+            const uint256 signHash = llmq::utils::BuildSignHash(recSig);
+            if (recoveredSigsCache.Get(ComputeRecoveredSigEntry(signHash, recSig.sig), false)) {
+                continue;
+            }
             const auto& quorum = quorums.at(std::make_pair((Consensus::LLMQType)recSig.llmqType, recSig.quorumHash));
-            batchVerifier.PushMessage(nodeId, recSig.GetHash(), llmq::utils::BuildSignHash(recSig), recSig.sig, quorum->quorumPublicKey);
+            batchVerifier.PushMessage(nodeId, recSig.GetHash(), signHash, recSig.sig, quorum->quorumPublicKey);
             verifyCount++;
         }
     }
 
     cxxtimer::Timer verifyTimer;
-    batchVerifier.Verify();
+    if (verifyCount > 0) {
+        batchVerifier.Verify();
+    }
     verifyTimer.stop();
 
     LogPrintf("llmq", "CSigningManager::%s -- verified recovered sig(s). count=%d, vt=%d, nodes=%d\n", __func__, verifyCount, verifyTimer.count(), recSigsByNode.size());
@@ -416,6 +691,8 @@ void CSigningManager::ProcessRecoveredSig(NodeId nodeId, const CRecoveredSig& re
         listeners = recoveredSigsListeners;
 
         auto signHash = llmq::utils::BuildSignHash(recoveredSig);
+        uint256 entry = ComputeRecoveredSigEntry(signHash, recoveredSig.sig);
+        recoveredSigsCache.Set(entry);
 
         LogPrintf("CSigningManager::%s -- valid recSig. signHash=%s, id=%s, msgHash=%s, node=%d\n", __func__,
             signHash.ToString(), recoveredSig.id.ToString(), recoveredSig.msgHash.ToString(), nodeId);
@@ -430,16 +707,21 @@ void CSigningManager::ProcessRecoveredSig(NodeId nodeId, const CRecoveredSig& re
 
         db.WriteRecoveredSig(recoveredSig);
     }
+    latencyStats.MarkStage(recoveredSig.id, CSigningLatencyStats::RECOVERED);
 
     CInv inv(MSG_QUORUM_RECOVERED_SIG, recoveredSig.GetHash());
     g_connman->RelayInv(inv);
     for (auto& l : listeners) {
         l->HandleNewRecoveredSig(recoveredSig);
     }
+
+    GetMainSignals().NotifyRecoveredSig(std::make_shared<const CRecoveredSig>(recoveredSig));
 }
 
 void CSigningManager::Cleanup()
 {
+    db.FlushPendingRecoveredSigs(false);
+
     int64_t now = GetTimeMillis();
     if (now - lastCleanupTime < 5000) {
         return;
@@ -513,6 +795,7 @@ bool CSigningManager::AsyncSignIfMember(Consensus::LLMQType llmqType, const uint
         return false;
     }
 
+    latencyStats.StartSession(id);
     quorumSigSharesManager->AsyncSign(quorum, id, msgHash);
 
     return true;
@@ -591,7 +874,15 @@ bool CSigningManager::VerifyRecoveredSig(Consensus::LLMQType llmqType, int signe
     }
 
     uint256 signHash = llmq::utils::BuildSignHash(llmqParams.type, quorum->pindexQuorum->GetBlockHash(), id, msgHash);
-    return sig.VerifyInsecure(quorum->quorumPublicKey, signHash);
+    uint256 entry = ComputeRecoveredSigEntry(signHash, sig);
+    if (recoveredSigsCache.Get(entry, false)) {
+        return true;
+    }
+    if (!sig.VerifyInsecure(quorum->quorumPublicKey, signHash)) {
+        return false;
+    }
+    recoveredSigsCache.Set(entry);
+    return true;
 }
 
 } // namespace llmq
\ No newline at end of file
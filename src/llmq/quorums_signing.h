@@ -9,8 +9,20 @@
 #include "llmq/quorums.h"
 
 #include "chainparams.h"
+#include "histogram.h"
 #include "net.h"
+#include "saltedhasher.h"
 #include "sync.h"
+#include "unordered_lru_cache.h"
+
+#include <array>
+#include <unordered_map>
+
+class UniValue;
+
+// Default and maximum size of the LLMQ recovered signatures cache, in MiB
+static const unsigned int DEFAULT_MAX_RECSIG_CACHE_SIZE = 1;
+static const int64_t MAX_MAX_RECSIG_CACHE_SIZE = 64;
 
 namespace llmq
 {
@@ -64,14 +76,31 @@ public:
     }
 };
 
-// TODO implement caching to speed things up
 class CRecoveredSigsDb
 {
+    // Recovered sigs are written to the db in batches, at most this many ms after being added
+    static const int64_t FLUSH_INTERVAL = 1000;
+    static const size_t MAX_PENDING_RECOVERED_SIGS = 1000;
+
 private:
     CDBWrapper db;
 
+    Mutex cs;
+    // Written recovered sigs which are not in the db yet, by (llmqType, id), object hash and signHash.
+    // Lookups check these first, so callers can't tell whether a recSig was flushed already.
+    std::map<std::pair<Consensus::LLMQType, uint256>, CRecoveredSig> pendingRecSigs GUARDED_BY(cs);
+    std::unordered_map<uint256, std::pair<Consensus::LLMQType, uint256>, StaticSaltedHasher> pendingRecSigsByHash GUARDED_BY(cs);
+    std::unordered_map<uint256, std::pair<Consensus::LLMQType, uint256>, StaticSaltedHasher> pendingRecSigsBySession GUARDED_BY(cs);
+    int64_t lastFlushTime GUARDED_BY(cs){0};
+
+    // Results (positive and negative) of the db lookups, kept up to date by writes and cleanups
+    unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, bool, StaticSaltedHasher, 30000> hasSigForIdCache GUARDED_BY(cs);
+    unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForSessionCache GUARDED_BY(cs);
+    unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForHashCache GUARDED_BY(cs);
+
 public:
     CRecoveredSigsDb(bool fMemory);
+    ~CRecoveredSigsDb();
 
     bool HasRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash);
     bool HasRecoveredSigForId(Consensus::LLMQType llmqType, const uint256& id);
@@ -80,6 +109,8 @@ public:
     bool GetRecoveredSigByHash(const uint256& hash, CRecoveredSig& ret);
     bool GetRecoveredSigById(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret);
     void WriteRecoveredSig(const CRecoveredSig& recSig);
+    // Writes the pending recovered sigs to the db if the last flush is old enough, or always if fForce is set
+    void FlushPendingRecoveredSigs(bool fForce);
 
     void CleanupOldRecoveredSigs(int64_t maxAge);
 
@@ -90,6 +121,53 @@ public:
 
 private:
     bool ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret);
+    void WritePendingRecoveredSigs() EXCLUSIVE_LOCKS_REQUIRED(cs);
+};
+
+/**
+ * Latency of the signing sessions started by this node, from the sign request to the recovered sig (and for
+ * chainlocks, to the CLSIG being accepted and relayed). Every stage is timed from the previous stage reached by the
+ * session, and aggregated in a histogram per stage.
+ */
+class CSigningLatencyStats
+{
+public:
+    enum Stage {
+        SIGN_REQUESTED,
+        SHARE_CREATED,
+        SHARES_COLLECTED,
+        RECOVERED,
+        CLSIG_ACCEPTED,
+        CLSIG_RELAYED,
+        STAGE_COUNT
+    };
+
+private:
+    static const size_t MAX_SESSIONS = 1000;
+    static const int64_t SESSION_TIMEOUT = 10 * 60 * 1000 * 1000; // in microseconds
+    // Aggregated histograms are logged every this many sessions
+    static const uint64_t LOG_INTERVAL = 100;
+
+    struct HistogramBounds {
+        static constexpr std::array<int64_t, 10> VALUES{{10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000}};
+    };
+    typedef FixedHistogram<HistogramBounds> Histogram;
+
+    mutable Mutex cs;
+    // Time at which each stage was reached, in microseconds, 0 while not reached
+    std::map<uint256, std::array<int64_t, STAGE_COUNT>> sessions GUARDED_BY(cs);
+    std::array<Histogram, STAGE_COUNT> histograms GUARDED_BY(cs);
+    uint64_t nSessionsStarted GUARDED_BY(cs){0};
+
+    std::string ToString() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    static const char* GetStageName(Stage stage);
+
+    void StartSession(const uint256& id);
+    // Does nothing for the sessions not started by StartSession, or if the stage was reached already
+    void MarkStage(const uint256& id, Stage stage);
+    UniValue ToJson() const;
 };
 
 class CRecoveredSigsListener
@@ -125,9 +203,13 @@ private:
 
     std::vector<CRecoveredSigsListener*> recoveredSigsListeners;
 
+    CSigningLatencyStats latencyStats;
+
 public:
     CSigningManager(bool fMemory);
 
+    CSigningLatencyStats& GetLatencyStats() { return latencyStats; }
+
     bool AlreadyHave(const CInv& inv);
     bool GetRecoveredSigForGetData(const uint256& hash, CRecoveredSig& ret);
 
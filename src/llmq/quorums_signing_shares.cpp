@@ -6,11 +6,13 @@
 #include "quorums_signing_shares.h"
 #include "activemasternode.h"
 #include "bls/bls_batchverifier.h"
+#include "bls/bls_worker.h"
 #include "cxxtimer.h"
 #include "init.h"
 #include "net.h"
 #include "net_processing.h"
 #include "netmessagemaker.h"
+#include "quorums_init.h"
 #include "quorums_signing.h"
 #include "quorums_utils.h"
 #include "random.h"
@@ -201,6 +203,8 @@ void CSigSharesManager::StopWorkerThread()
 void CSigSharesManager::Interrupt()
 {
     interruptSigningShare();
+    LOCK(cs_pendingMessages);
+    cvPendingMessages.notify_all();
 }
 
 void CSigSharesManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
@@ -210,18 +214,45 @@ void CSigSharesManager::ProcessMessage(CNode* pfrom, const std::string& strComma
         return;
     }
 
-    if (strCommand == NetMsgType::QSIGSHARESINV) {
-        CSigSharesInv inv;
-        vRecv >> inv;
-        ProcessMessageSigSharesInv(pfrom, inv, connman);
-    } else if (strCommand == NetMsgType::QGETSIGSHARES) {
-        CSigSharesInv inv;
-        vRecv >> inv;
-        ProcessMessageGetSigShares(pfrom, inv, connman);
+    CSigSharesPendingMessage msg;
+    if (strCommand == NetMsgType::QSIGSHARESINV || strCommand == NetMsgType::QGETSIGSHARES) {
+        vRecv >> msg.inv;
     } else if (strCommand == NetMsgType::QBSIGSHARES) {
-        CBatchedSigShares batchedSigShares;
-        vRecv >> batchedSigShares;
-        ProcessMessageBatchedSigShares(pfrom, batchedSigShares, connman);
+        vRecv >> msg.batchedSigShares;
+    } else {
+        return;
+    }
+    msg.strCommand = strCommand;
+
+    // Verification and the update of the session state happen in the worker thread
+    LOCK(cs_pendingMessages);
+    auto& nodeMessages = pendingMessages[pfrom->GetId()];
+    if (nodeMessages.size() >= MAX_PENDING_MESSAGES_PER_NODE) {
+        LogPrint(BCLog::LLMQ, "CSigSharesManager::%s -- too many pending messages, dropping %s from node=%d\n", __func__, strCommand, pfrom->GetId());
+        return;
+    }
+    nodeMessages.emplace_back(std::move(msg));
+    cvPendingMessages.notify_one();
+}
+
+void CSigSharesManager::ProcessPendingMessages()
+{
+    std::map<NodeId, std::vector<CSigSharesPendingMessage>> messages;
+    {
+        LOCK(cs_pendingMessages);
+        messages.swap(pendingMessages);
+    }
+
+    for (const auto& p : messages) {
+        for (const auto& msg : p.second) {
+            if (msg.strCommand == NetMsgType::QSIGSHARESINV) {
+                ProcessMessageSigSharesInv(p.first, msg.inv);
+            } else if (msg.strCommand == NetMsgType::QGETSIGSHARES) {
+                ProcessMessageGetSigShares(p.first, msg.inv);
+            } else {
+                ProcessMessageBatchedSigShares(p.first, msg.batchedSigShares);
+            }
+        }
     }
 }
 
@@ -246,9 +277,9 @@ bool CSigSharesManager::VerifySigSharesInv(NodeId from, const CSigSharesInv& inv
     return true;
 }
 
-void CSigSharesManager::ProcessMessageSigSharesInv(CNode* pfrom, const CSigSharesInv& inv, CConnman& connman)
+void CSigSharesManager::ProcessMessageSigSharesInv(NodeId from, const CSigSharesInv& inv)
 {
-    if (!VerifySigSharesInv(pfrom->GetId(), inv)) {
+    if (!VerifySigSharesInv(from, inv)) {
         return;
     }
 
@@ -257,17 +288,17 @@ void CSigSharesManager::ProcessMessageSigSharesInv(CNode* pfrom, const CSigShare
         return;
     }
 
-    LogPrintf("llmq", "CSigSharesManager::%s -- inv={%s}, node=%d\n", __func__, inv.ToString(), pfrom->GetId());
+    LogPrintf("llmq", "CSigSharesManager::%s -- inv={%s}, node=%d\n", __func__, inv.ToString(), from);
 
     LOCK(cs);
-    auto& nodeState = nodeStates[pfrom->GetId()];
+    auto& nodeState = nodeStates[from];
     nodeState.MarkAnnounced(inv.signHash, inv);
     nodeState.MarkKnows(inv.signHash, inv);
 }
 
-void CSigSharesManager::ProcessMessageGetSigShares(CNode* pfrom, const CSigSharesInv& inv, CConnman& connman)
+void CSigSharesManager::ProcessMessageGetSigShares(NodeId from, const CSigSharesInv& inv)
 {
-    if (!VerifySigSharesInv(pfrom->GetId(), inv)) {
+    if (!VerifySigSharesInv(from, inv)) {
         return;
     }
 
@@ -276,20 +307,20 @@ void CSigSharesManager::ProcessMessageGetSigShares(CNode* pfrom, const CSigShare
         return;
     }
 
-    LogPrintf("llmq", "CSigSharesManager::%s -- inv={%s}, node=%d\n", __func__, inv.ToString(), pfrom->GetId());
+    LogPrintf("llmq", "CSigSharesManager::%s -- inv={%s}, node=%d\n", __func__, inv.ToString(), from);
 
     LOCK(cs);
-    auto& nodeState = nodeStates[pfrom->GetId()];
+    auto& nodeState = nodeStates[from];
     nodeState.MarkRequested(inv.signHash, inv);
     nodeState.MarkKnows(inv.signHash, inv);
 }
 
-void CSigSharesManager::ProcessMessageBatchedSigShares(CNode* pfrom, const CBatchedSigShares& batchedSigShares, CConnman& connman)
+void CSigSharesManager::ProcessMessageBatchedSigShares(NodeId from, const CBatchedSigShares& batchedSigShares)
 {
     bool ban = false;
-    if (!PreVerifyBatchedSigShares(pfrom->GetId(), batchedSigShares, ban)) {
+    if (!PreVerifyBatchedSigShares(from, batchedSigShares, ban)) {
         if (ban) {
-            BanNode(pfrom->GetId());
+            BanNode(from);
             return;
         }
         return;
@@ -300,7 +331,7 @@ void CSigSharesManager::ProcessMessageBatchedSigShares(CNode* pfrom, const CBatc
 
     {
         LOCK(cs);
-        auto& nodeState = nodeStates[pfrom->GetId()];
+        auto& nodeState = nodeStates[from];
 
         for (size_t i = 0; i < batchedSigShares.sigShares.size(); i++) {
             CSigShare sigShare = batchedSigShares.RebuildSigShare(i);
@@ -324,14 +355,14 @@ void CSigSharesManager::ProcessMessageBatchedSigShares(CNode* pfrom, const CBatc
     }
 
     LogPrintf("llmq", "CSigSharesManager::%s -- shares=%d, new=%d, inv={%s}, node=%d\n", __func__,
-        batchedSigShares.sigShares.size(), sigShares.size(), batchedSigShares.ToInv().ToString(), pfrom->GetId());
+        batchedSigShares.sigShares.size(), sigShares.size(), batchedSigShares.ToInv().ToString(), from);
 
     if (sigShares.empty()) {
         return;
     }
 
     LOCK(cs);
-    auto& nodeState = nodeStates[pfrom->GetId()];
+    auto& nodeState = nodeStates[from];
     for (auto& s : sigShares) {
         nodeState.pendingIncomingSigShares.emplace(s.GetKey(), s);
     }
@@ -630,6 +661,8 @@ void CSigSharesManager::TryRecoverSig(const CQuorumCPtr& quorum, const uint256&
         }
     }
 
+    quorumSigningManager->GetLatencyStats().MarkStage(id, CSigningLatencyStats::SHARES_COLLECTED);
+
     // now recover it
     cxxtimer::Timer t(true);
     CBLSSignature recoveredSig;
@@ -1104,6 +1137,7 @@ void CSigSharesManager::WorkThreadMain()
 {
     int64_t lastProcessTime = GetTimeMillis();
     while (!interruptSigningShare) {
+        ProcessPendingMessages();
         RemoveBannedNodeStates();
         quorumSigningManager->ProcessPendingRecoveredSigs(*g_connman);
         ProcessPendingSigShares(*g_connman);
@@ -1113,9 +1147,10 @@ void CSigSharesManager::WorkThreadMain()
         quorumSigningManager->Cleanup();
 
         // TODO Wakeup when pending signing is needed?
-        if (!interruptSigningShare.sleep_for(std::chrono::milliseconds(100))) {
-            return;
-        }
+        WAIT_LOCK(cs_pendingMessages, lock);
+        cvPendingMessages.wait_for(lock, std::chrono::milliseconds(100), [&]() EXCLUSIVE_LOCKS_REQUIRED(cs_pendingMessages) {
+            return !pendingMessages.empty() || interruptSigningShare;
+        });
     }
 }
 
@@ -1133,8 +1168,32 @@ void CSigSharesManager::SignPendingSigShares()
         v = std::move(pendingSigns);
     }
 
-    for (auto& t : v) {
-        Sign(std::get<0>(t), std::get<1>(t), std::get<2>(t));
+    if (v.size() <= 1 || !blsWorker) {
+        for (auto& t : v) {
+            Sign(std::get<0>(t), std::get<1>(t), std::get<2>(t));
+        }
+        return;
+    }
+
+    // Many requests came together (e.g. a chainlock and other signing uses): sign them in parallel on the
+    // BLS worker threads, then process the shares in the order requested, to be announced in the same round
+    cxxtimer::Timer t(true);
+    std::vector<std::pair<CSigShare, CQuorumCPtr>> vSigShares;
+    std::vector<std::future<CBLSSignature>> vSigFutures;
+    vSigShares.reserve(v.size());
+    vSigFutures.reserve(v.size());
+    for (auto& p : v) {
+        CSigShare sigShare;
+        CBLSSecretKey skShare;
+        if (!PrepareSigShare(std::get<0>(p), std::get<1>(p), std::get<2>(p), sigShare, skShare)) {
+            continue;
+        }
+        vSigFutures.emplace_back(blsWorker->AsyncSign(skShare, sigShare.GetSignHash()));
+        vSigShares.emplace_back(std::move(sigShare), std::get<0>(p));
+    }
+    for (size_t i = 0; i < vSigShares.size(); i++) {
+        vSigShares[i].first.sigShare = vSigFutures[i].get();
+        ProcessOwnSigShare(vSigShares[i].first, vSigShares[i].second, t.count());
     }
 }
 
@@ -1142,41 +1201,53 @@ void CSigSharesManager::Sign(const CQuorumCPtr& quorum, const uint256& id, const
 {
     cxxtimer::Timer t(true);
 
-    if (!quorum->IsValidMember(activeMasternodeManager->GetProTx())) {
+    CSigShare sigShare;
+    CBLSSecretKey skShare;
+    if (!PrepareSigShare(quorum, id, msgHash, sigShare, skShare)) {
         return;
     }
+    sigShare.sigShare = skShare.Sign(sigShare.GetSignHash());
+    ProcessOwnSigShare(sigShare, quorum, t.count());
+}
+
+bool CSigSharesManager::PrepareSigShare(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CSigShare& sigShare, CBLSSecretKey& skShare)
+{
+    if (!quorum->IsValidMember(activeMasternodeManager->GetProTx())) {
+        return false;
+    }
 
-    CBLSSecretKey skShare = quorum->GetSkShare();
+    skShare = quorum->GetSkShare();
     if (!skShare.IsValid()) {
         LogPrintf("CSigSharesManager::%s -- we don't have our skShare for quorum %s\n", __func__, quorum->pindexQuorum->GetBlockHash().ToString());
-        return;
+        return false;
     }
 
     int memberIdx = quorum->GetMemberIndex(activeMasternodeManager->GetProTx());
     if (memberIdx == -1) {
         // this should really not happen (IsValidMember gave true)
-        return;
+        return false;
     }
 
-    CSigShare sigShare;
     sigShare.llmqType = quorum->params.type;
     sigShare.quorumHash = quorum->pindexQuorum->GetBlockHash();
     sigShare.id = id;
     sigShare.msgHash = msgHash;
     sigShare.quorumMember = (uint16_t)memberIdx;
-    uint256 signHash = llmq::utils::BuildSignHash(sigShare);
+    sigShare.UpdateKey();
+    return true;
+}
 
-    sigShare.sigShare = skShare.Sign(signHash);
+void CSigSharesManager::ProcessOwnSigShare(const CSigShare& sigShare, const CQuorumCPtr& quorum, int64_t nSignTime)
+{
     if (!sigShare.sigShare.IsValid()) {
         LogPrintf("CSigSharesManager::%s -- failed to sign sigShare. id=%s, msgHash=%s, time=%s\n", __func__,
-            sigShare.id.ToString(), sigShare.msgHash.ToString(), t.count());
+            sigShare.id.ToString(), sigShare.msgHash.ToString(), nSignTime);
         return;
     }
 
-    sigShare.UpdateKey();
-
     LogPrintf("CSigSharesManager::%s -- signed sigShare. id=%s, msgHash=%s, time=%s\n", __func__,
-        sigShare.id.ToString(), sigShare.msgHash.ToString(), t.count());
+        sigShare.id.ToString(), sigShare.msgHash.ToString(), nSignTime);
+    quorumSigningManager->GetLatencyStats().MarkStage(sigShare.id, CSigningLatencyStats::SHARE_CREATED);
     ProcessSigShare(-1, sigShare, *g_connman, quorum);
 }
 } // namespace llmq
\ No newline at end of file
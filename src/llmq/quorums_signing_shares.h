@@ -17,6 +17,7 @@
 
 #include "llmq/quorums.h"
 
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 
@@ -190,10 +191,20 @@ public:
     void RemoveSession(const uint256& signHash);
 };
 
+// A sig shares message received from a peer, waiting to be processed by the worker thread
+struct CSigSharesPendingMessage
+{
+    std::string strCommand;
+    CSigSharesInv inv;
+    CBatchedSigShares batchedSigShares;
+};
+
 class CSigSharesManager
 {
     static const int64_t SIGNING_SESSION_TIMEOUT = 60 * 1000;
     static const int64_t SIG_SHARE_REQUEST_TIMEOUT = 5 * 1000;
+    // Messages of a single peer queued at most before the worker thread picks them up
+    static const size_t MAX_PENDING_MESSAGES_PER_NODE = 1000;
 
 private:
     RecursiveMutex cs;
@@ -201,6 +212,12 @@ private:
     std::thread workThread;
     CThreadInterrupt interruptSigningShare;
 
+    // The message handler only queues the messages of the peers here, the state below is
+    // owned by the worker thread so that the handler never waits for cs
+    Mutex cs_pendingMessages;
+    std::condition_variable cvPendingMessages;
+    std::map<NodeId, std::vector<CSigSharesPendingMessage>> pendingMessages GUARDED_BY(cs_pendingMessages);
+
     std::map<SigShareKey, CSigShare> sigShares;
     std::map<uint256, int64_t> firstSeenForSessions;
 
@@ -230,9 +247,10 @@ public:
     void Sign(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash);
 
 private:
-    void ProcessMessageSigSharesInv(CNode* pfrom, const CSigSharesInv& inv, CConnman& connman);
-    void ProcessMessageGetSigShares(CNode* pfrom, const CSigSharesInv& inv, CConnman& connman);
-    void ProcessMessageBatchedSigShares(CNode* pfrom, const CBatchedSigShares& batchedSigShares, CConnman& connman);
+    void ProcessPendingMessages();
+    void ProcessMessageSigSharesInv(NodeId from, const CSigSharesInv& inv);
+    void ProcessMessageGetSigShares(NodeId from, const CSigSharesInv& inv);
+    void ProcessMessageBatchedSigShares(NodeId from, const CBatchedSigShares& batchedSigShares);
 
     bool VerifySigSharesInv(NodeId from, const CSigSharesInv& inv);
     bool PreVerifyBatchedSigShares(NodeId nodeId, const CBatchedSigShares& batchedSigShares, bool& retBan);
@@ -243,6 +261,11 @@ private:
     void ProcessPendingSigSharesFromNode(NodeId nodeId, const std::vector<CSigShare>& sigShares, const std::map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr>& quorums, CConnman& connman);
 
     void ProcessSigShare(NodeId nodeId, const CSigShare& sigShare, CConnman& connman, const CQuorumCPtr& quorum);
+
+    // Fill our share of the session (but its signature), false if we are not a valid member of the quorum
+    bool PrepareSigShare(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CSigShare& sigShare, CBLSSecretKey& skShare);
+    // Process a share we signed, to be announced to the other members
+    void ProcessOwnSigShare(const CSigShare& sigShare, const CQuorumCPtr& quorum, int64_t nSignTime);
     void TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CConnman& connman);
 
 private:
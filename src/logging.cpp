@@ -5,6 +5,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "logging.h"
+#include "util/threadnames.h"
 #include "utiltime.h"
 
 
@@ -125,6 +126,7 @@ const CLogCategoryDesc LogCategories[] = {
         {BCLog::LLMQ,           "llmq"},
         {BCLog::NET_MN,         "net_mn"},
         {BCLog::DKG,            "dkg"},
+        {BCLog::PRUNE,          "prune"},
         {BCLog::ALL,            "1"},
         {BCLog::ALL,            "all"},
 };
@@ -208,6 +210,25 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
 {
     std::string strTimestamped = LogTimestampStr(str);
 
+    if (m_async) {
+        std::lock_guard<std::mutex> lock(m_async_mutex);
+        // re-check under the lock, StopAsyncWriter may have drained the queue already
+        if (m_async) {
+            if (m_async_queue_bytes + strTimestamped.size() > MAX_ASYNC_LOG_QUEUE_BYTES) {
+                m_async_dropped++;
+                return;
+            }
+            m_async_queue_bytes += strTimestamped.size();
+            m_async_queue.emplace_back(std::move(strTimestamped));
+            m_async_cond.notify_one();
+            return;
+        }
+    }
+    WriteStr(strTimestamped);
+}
+
+void BCLog::Logger::WriteStr(const std::string& strTimestamped)
+{
     if (m_print_to_console) {
         // print to console
         fwrite(strTimestamped.data(), 1, strTimestamped.size(), stdout);
@@ -237,6 +258,73 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
     }
 }
 
+void BCLog::Logger::AsyncWriterThread()
+{
+    util::ThreadRename("pivx-log");
+    std::vector<std::string> batch;
+    uint64_t nDroppedReported = 0;
+    while (true) {
+        bool fStop;
+        {
+            std::unique_lock<std::mutex> lock(m_async_mutex);
+            m_async_cond.wait(lock, [this] { return m_async_stop || !m_async_queue.empty(); });
+            batch.swap(m_async_queue);
+            m_async_queue_bytes = 0;
+            fStop = m_async_stop;
+        }
+
+        // One write for the whole batch
+        std::string strBatch;
+        const uint64_t nDropped = m_async_dropped.load();
+        if (nDropped != nDroppedReported) {
+            strBatch = strprintf("%s %s: %d log messages dropped, the writer could not keep up\n",
+                                 FormatISO8601DateTime(GetTime()), __func__, nDropped - nDroppedReported);
+            nDroppedReported = nDropped;
+        }
+        for (const std::string& str : batch) {
+            strBatch += str;
+        }
+        batch.clear();
+        if (!strBatch.empty()) {
+            WriteStr(strBatch);
+        }
+
+        if (fStop) break;
+    }
+}
+
+void BCLog::Logger::StartAsyncWriter()
+{
+    std::lock_guard<std::mutex> lock(m_async_mutex);
+    if (m_async) return;
+    m_async_stop = false;
+    m_async = true;
+    m_async_thread = std::thread(&BCLog::Logger::AsyncWriterThread, this);
+}
+
+void BCLog::Logger::StopAsyncWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_async_mutex);
+        if (!m_async) return;
+        m_async_stop = true;
+        m_async_cond.notify_one();
+    }
+    m_async_thread.join();
+
+    // Switch back to synchronous writes, and flush what was queued after the last batch
+    std::vector<std::string> leftover;
+    {
+        std::lock_guard<std::mutex> lock(m_async_mutex);
+        m_async = false;
+        leftover.swap(m_async_queue);
+        m_async_queue_bytes = 0;
+    }
+    for (const std::string& str : leftover) {
+        WriteStr(str);
+    }
+}
+
 void BCLog::Logger::ShrinkDebugFile()
 {
     // Amount of debug.log to save at end when shrinking (must fit in memory)
@@ -16,15 +16,20 @@
 #include "tinyformat.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <list>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
+static const bool DEFAULT_LOGASYNC      = false;
+/** Maximum size of the messages waiting for the async log writer, before new ones are dropped */
+static const size_t MAX_ASYNC_LOG_QUEUE_BYTES = 16 * 1024 * 1024;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -66,6 +71,7 @@ namespace BCLog {
         LLMQ        = (1 << 25),
         NET_MN      = (1 << 26),
         DKG         = (1 << 27),
+        PRUNE       = (1 << 28),
         ALL         = ~(uint32_t)0,
     };
 
@@ -86,8 +92,23 @@ namespace BCLog {
         /** Log categories bitfield. */
         std::atomic<uint32_t> m_categories{0};
 
+        /** Async mode: messages waiting for the writer thread, swapped out in batches. */
+        std::mutex m_async_mutex;
+        std::condition_variable m_async_cond;
+        std::vector<std::string> m_async_queue;
+        size_t m_async_queue_bytes{0};
+        bool m_async_stop{false};
+        std::atomic<bool> m_async{false};
+        std::atomic<uint64_t> m_async_dropped{0};
+        std::thread m_async_thread;
+
         std::string LogTimestampStr(const std::string& str);
 
+        /** Write a message to the console and/or the debug log file */
+        void WriteStr(const std::string& str);
+
+        void AsyncWriterThread();
+
     public:
         bool m_print_to_console = false;
         bool m_print_to_file = false;
@@ -107,6 +128,17 @@ namespace BCLog {
         bool OpenDebugLog();
         void ShrinkDebugFile();
 
+        /**
+         * Hand the writes over to a background thread. LogPrintStr then only
+         * queues the messages, dropping them if the queue grows over
+         * MAX_ASYNC_LOG_QUEUE_BYTES.
+         */
+        void StartAsyncWriter();
+        /** Write out the queued messages, stop the thread and go back to synchronous writes */
+        void StopAsyncWriter();
+        /** Number of messages dropped because the async writer fell behind */
+        uint64_t GetDroppedMessages() const { return m_async_dropped.load(); }
+
         uint32_t GetCategoryMask() const { return m_categories.load(); }
 
         void EnableCategory(LogFlags flag);
@@ -15,6 +15,7 @@
 #include "spork.h"
 #include "sync.h"
 #include "tiertwo/tiertwo_sync_state.h"
+#include "tiertwo/vote_sig_verifier.h"
 #include "util/system.h"
 #include "utilmoneystr.h"
 #include "validation.h"
@@ -88,13 +89,12 @@ CMasternodePaymentDB::ReadResult CMasternodePaymentDB::Read(CMasternodePayments&
     // Don't try to resize to a negative number if file is small
     if (dataSize < 0)
         dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
+    // read data and checksum from file, straight into the stream buffer
+    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+    ssObj.resize(dataSize);
     uint256 hashIn;
-
-    // read data and checksum from file
     try {
-        filein.read((char*)vchData.data(), dataSize);
+        filein.read(ssObj.data(), dataSize);
         filein >> hashIn;
     } catch (const std::exception& e) {
         error("%s : Deserialize or I/O error - %s", __func__, e.what());
@@ -102,8 +102,6 @@ CMasternodePaymentDB::ReadResult CMasternodePaymentDB::Read(CMasternodePayments&
     }
     filein.fclose();
 
-    CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
-
     // verify stored checksum matches input data
     uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
     if (hashIn != hashTmp) {
@@ -177,7 +175,7 @@ bool CMasternodePaymentWinner::IsValid(CNode* pnode, CValidationState& state, in
     return true;
 }
 
-void CMasternodePaymentWinner::Relay()
+void CMasternodePaymentWinner::Relay() const
 {
     CInv inv(MSG_MASTERNODE_WINNER, GetHash());
     g_connman->RelayInv(inv);
@@ -410,6 +408,11 @@ bool CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
         //Masternode Payments Request Sync
         int nCountNeeded;
         vRecv >> nCountNeeded;
+        // Optional digest of the winners known by the peer (not sent by older versions)
+        MNWinnersSyncDigest peerDigest;
+        if (!vRecv.empty()) {
+            vRecv >> peerDigest;
+        }
 
         if (Params().NetworkIDString() == CBaseChainParams::MAIN) {
             if (g_netfulfilledman.HasFulfilledRequest(pfrom->addr, NetMsgType::GETMNWINNERS)) {
@@ -419,7 +422,7 @@ bool CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, std::st
         }
 
         g_netfulfilledman.AddFulfilledRequest(pfrom->addr, NetMsgType::GETMNWINNERS);
-        Sync(pfrom, nCountNeeded);
+        Sync(pfrom, nCountNeeded, peerDigest);
         LogPrint(BCLog::MASTERNODE, "mnget - Sent Masternode winners to peer %i\n", pfrom->GetId());
     } else if (strCommand == NetMsgType::MNWINNER) {
         //Masternode Payments Declare Winner
@@ -491,15 +494,32 @@ bool CMasternodePayments::ProcessMNWinner(CMasternodePaymentWinner& winner, CNod
     }
 
     // Check signature
-    bool is_valid_sig = dmn ? winner.CheckSignature(dmn->pdmnState->pubKeyOperator.Get())
-                            : winner.CheckSignature(pmn->pubKeyMasternode.GetID());
+    const bool fDeterministic = dmn != nullptr;
+    const auto process = [this, fDeterministic](const CMasternodePaymentWinner& w, CNode* pnode, bool fValidSig, CValidationState& s) {
+        return ProcessMNWinnerSig(w, fValidSig, fDeterministic, s);
+    };
+    return dmn ? VerifyVoteSignature(winner, pfrom, dmn->pdmnState->pubKeyOperator.Get(), state, BCLog::MASTERNODE, process)
+               : VerifyVoteSignature(winner, pfrom, pmn->pubKeyMasternode.GetID(), state, BCLog::MASTERNODE, process);
+}
 
-    if (!is_valid_sig) {
+bool CMasternodePayments::ProcessMNWinnerSig(const CMasternodePaymentWinner& winner, bool fValidSig, bool fDeterministic, CValidationState& state)
+{
+    if (!fValidSig) {
         LogPrint(BCLog::MASTERNODE, "%s : mnw - invalid signature for %s masternode: %s\n",
-                __func__, (dmn ? "deterministic" : "legacy"), winner.vinMasternode.prevout.hash.ToString());
+                __func__, (fDeterministic ? "deterministic" : "legacy"), winner.vinMasternode.prevout.hash.ToString());
         return state.DoS(20, false, REJECT_INVALID, "invalid voter mnwinner signature");
     }
 
+    // A copy of the winner, or another vote of the masternode, could have been accepted
+    // while the signature was verified
+    if (WITH_LOCK(cs_mapMasternodePayeeVotes, return mapMasternodePayeeVotes.count(winner.GetHash()))) {
+        g_tiertwo_sync_state.AddedMasternodeWinner(winner.GetHash());
+        return false;
+    }
+    if (!CanVote(winner.vinMasternode.prevout, winner.nBlockHeight)) {
+        return state.Error("MN already voted");
+    }
+
     // Record vote
     RecordWinnerVote(winner.vinMasternode.prevout, winner.nBlockHeight);
 
@@ -549,23 +569,20 @@ bool CMasternodePayments::IsScheduled(const CMasternode& mn, int nNotBlockHeight
     return false;
 }
 
-void CMasternodePayments::AddWinningMasternode(CMasternodePaymentWinner& winnerIn)
+void CMasternodePayments::AddWinningMasternode(const CMasternodePaymentWinner& winnerIn)
 {
-    {
-        LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
-
-        mapMasternodePayeeVotes[winnerIn.GetHash()] = winnerIn;
-
-        if (!mapMasternodeBlocks.count(winnerIn.nBlockHeight)) {
-            CMasternodeBlockPayees blockPayees(winnerIn.nBlockHeight);
-            mapMasternodeBlocks[winnerIn.nBlockHeight] = blockPayees;
-        }
-    }
-
     CTxDestination addr;
     ExtractDestination(winnerIn.payee, addr);
     LogPrint(BCLog::MASTERNODE, "mnw - Adding winner %s for block %d\n", EncodeDestination(addr), winnerIn.nBlockHeight);
-    mapMasternodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, 1);
+
+    // The winners are also added from the vote signature verifier thread
+    LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
+    mapMasternodePayeeVotes[winnerIn.GetHash()] = winnerIn;
+    auto it = mapMasternodeBlocks.find(winnerIn.nBlockHeight);
+    if (it == mapMasternodeBlocks.end()) {
+        it = mapMasternodeBlocks.emplace(winnerIn.nBlockHeight, CMasternodeBlockPayees(winnerIn.nBlockHeight)).first;
+    }
+    it->second.AddPayee(winnerIn.payee, 1);
 }
 
 bool CMasternodeBlockPayees::IsTransactionValid(const CTransaction& txNew, int nBlockHeight)
@@ -778,25 +795,63 @@ void CMasternodePayments::ProcessBlock(int nBlockHeight)
     nLastBlockHeight = nBlockHeight;
 }
 
-void CMasternodePayments::Sync(CNode* node, int nCountNeeded)
+std::map<int, std::vector<uint256>> CMasternodePayments::GetSyncWinnerHashes(int nCountNeeded) const
 {
-    LOCK(cs_mapMasternodePayeeVotes);
-
     int nHeight = mnodeman.GetBestHeight();
     int nCount = (mnodeman.CountEnabled() * 1.25);
     if (nCountNeeded > nCount) nCountNeeded = nCount;
 
+    std::map<int, std::vector<uint256>> mapHashes;
+    {
+        LOCK(cs_mapMasternodePayeeVotes);
+        for (const auto& it : mapMasternodePayeeVotes) {
+            const CMasternodePaymentWinner& winner = it.second;
+            if (winner.nBlockHeight >= nHeight - nCountNeeded && winner.nBlockHeight <= nHeight + 20) {
+                mapHashes[winner.nBlockHeight].emplace_back(it.first);
+            }
+        }
+    }
+    for (auto& it : mapHashes) {
+        std::sort(it.second.begin(), it.second.end());
+    }
+    return mapHashes;
+}
+
+static uint256 GetWinnersDigest(const std::vector<uint256>& vHashes)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << vHashes;
+    return ss.GetHash();
+}
+
+MNWinnersSyncDigest CMasternodePayments::GetSyncDigest(int nCountNeeded) const
+{
+    MNWinnersSyncDigest digest;
+    for (const auto& it : GetSyncWinnerHashes(nCountNeeded)) {
+        digest.emplace(it.first, GetWinnersDigest(it.second));
+    }
+    return digest;
+}
+
+void CMasternodePayments::Sync(CNode* node, int nCountNeeded, const MNWinnersSyncDigest& peerDigest)
+{
     int nInvCount = 0;
-    std::map<uint256, CMasternodePaymentWinner>::iterator it = mapMasternodePayeeVotes.begin();
-    while (it != mapMasternodePayeeVotes.end()) {
-        CMasternodePaymentWinner winner = (*it).second;
-        if (winner.nBlockHeight >= nHeight - nCountNeeded && winner.nBlockHeight <= nHeight + 20) {
-            node->PushInventory(CInv(MSG_MASTERNODE_WINNER, winner.GetHash()));
+    int nKnownCount = 0;
+    for (const auto& it : GetSyncWinnerHashes(nCountNeeded)) {
+        const auto& itDigest = peerDigest.find(it.first);
+        if (itDigest != peerDigest.end() && itDigest->second == GetWinnersDigest(it.second)) {
+            // the peer has all the votes for this height already
+            nKnownCount += it.second.size();
+            continue;
+        }
+        for (const uint256& hash : it.second) {
+            node->PushInventory(CInv(MSG_MASTERNODE_WINNER, hash));
             nInvCount++;
         }
-        ++it;
     }
-    g_connman->PushMessage(node, CNetMsgMaker(node->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_MNW, nInvCount));
+    // The votes known by the peer are counted as well: it uses the count to see that the sync is progressing
+    g_connman->PushMessage(node, CNetMsgMaker(node->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_MNW, nInvCount + nKnownCount));
+    LogPrint(BCLog::MASTERNODE, "%s: sent %d winners (%d winners already known by peer)\n", __func__, nInvCount, nKnownCount);
 }
 
 std::string CMasternodePayments::ToString() const
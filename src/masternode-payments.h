@@ -38,6 +38,10 @@ bool IsCoinbaseValueValid(const CTransactionRef& tx, CAmount nBudgetAmt, CValida
 
 void DumpMasternodePayments();
 
+// Block height --> digest of the winner votes for that height, sent along the mnw sync requests
+// so that the peer skips the heights whose votes are all known already.
+typedef std::map<int, uint256> MNWinnersSyncDigest;
+
 /** Save Masternode Payment Data (mnpayments.dat)
  */
 class CMasternodePaymentDB
@@ -178,7 +182,7 @@ public:
     CTxIn GetVin() const { return vinMasternode; };
 
     bool IsValid(CNode* pnode, CValidationState& state, int chainHeight);
-    void Relay();
+    void Relay() const;
 
     void AddPayee(const CScript& payeeIn)
     {
@@ -226,10 +230,12 @@ public:
 
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
 
-    void AddWinningMasternode(CMasternodePaymentWinner& winner);
+    void AddWinningMasternode(const CMasternodePaymentWinner& winner);
     void ProcessBlock(int nBlockHeight);
 
-    void Sync(CNode* node, int nCountNeeded);
+    void Sync(CNode* node, int nCountNeeded, const MNWinnersSyncDigest& peerDigest = MNWinnersSyncDigest());
+    // Digest of the winner votes, for the heights a mnw sync request for nCountNeeded blocks returns
+    MNWinnersSyncDigest GetSyncDigest(int nCountNeeded) const;
     void CleanPaymentList(int mnCount, int nHeight);
 
     // get the masternode payment outs for block built on top of pindexPrev
@@ -243,6 +249,8 @@ public:
     bool IsScheduled(const CMasternode& mn, int nNotBlockHeight);
 
     bool ProcessMNWinner(CMasternodePaymentWinner& winner, CNode* pfrom, CValidationState& state);
+    // Rest of ProcessMNWinner, once the signature of the winner is checked
+    bool ProcessMNWinnerSig(const CMasternodePaymentWinner& winner, bool fValidSig, bool fDeterministic, CValidationState& state);
     bool ProcessMessageMasternodePayments(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, CValidationState& state);
     std::string GetRequiredPaymentsString(int nBlockHeight);
     void FillBlockPayee(CMutableTransaction& txCoinbase, CMutableTransaction& txCoinstake, const CBlockIndex* pindexPrev, bool fProofOfStake) const;
@@ -255,6 +263,8 @@ private:
     std::map<COutPoint, int> mapMasternodesLastVote; //prevout, nBlockHeight
 
     bool CanVote(const COutPoint& outMasternode, int nBlockHeight) const;
+    // Hashes of the winner votes for each height in [nHeight - nCountNeeded, nHeight + 20], sorted
+    std::map<int, std::vector<uint256>> GetSyncWinnerHashes(int nCountNeeded) const;
     void RecordWinnerVote(const COutPoint& outMasternode, int nBlockHeight);
 };
 
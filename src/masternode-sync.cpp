@@ -8,6 +8,7 @@
 #include "addrman.h"
 #include "budget/budgetmanager.h"
 #include "evo/deterministicmns.h"
+#include "masternode-payments.h"
 #include "masternode-sync.h"
 #include "masternode.h"
 #include "masternodeman.h"
@@ -71,6 +72,45 @@ void CMasternodeSync::Reset()
     g_tiertwo_sync_state.SetCurrentSyncPhase(MASTERNODE_SYNC_INITIAL);
     RequestedMasternodeAttempt = 0;
     nAssetSyncStarted = GetTime();
+    fResumed = false;
+    ClearPendingRequests();
+}
+
+void CMasternodeSync::CheckResume()
+{
+    const int64_t nSinceSynced = GetTime() - nLastSynced;
+    fResumed = nLastSynced > 0 && nSinceSynced >= 0 && nSinceSynced < MASTERNODE_SYNC_RESUME_TIME;
+    if (fResumed) {
+        LogPrintf("%s: last synced %d seconds ago, resuming the tier two sync\n", __func__, nSinceSynced);
+    }
+}
+
+std::string CMasternodeSync::ToString() const
+{
+    return strprintf("Last synced: %d", nLastSynced);
+}
+
+bool CMasternodeSync::AddPendingRequest(NodeId nodeId)
+{
+    WITH_LOCK(cs_requests, mapPendingRequests[nodeId] = GetTimeMillis());
+    return ++nRoundRequests < MASTERNODE_SYNC_PARALLEL_REQUESTS;
+}
+
+void CMasternodeSync::ClearPendingRequests()
+{
+    LOCK(cs_requests);
+    mapPendingRequests.clear();
+    nAnsweredRequests = 0;
+}
+
+int64_t CMasternodeSync::GetIdleWindow(int64_t nMaxWindow)
+{
+    LOCK(cs_requests);
+    // The node resuming the sync has the data of the caches, it doesn't wait for the slower peers
+    const bool fQuorumAnswered = fResumed && nAnsweredRequests >= MASTERNODE_SYNC_THRESHOLD;
+    if (!mapPendingRequests.empty() && !fQuorumAnswered) return nMaxWindow;
+    // Leave time to the peers for the items they announced with their count
+    return std::min(nMaxWindow, MASTERNODE_SYNC_TIMEOUT + 2 * nAvgResponseTime / 1000);
 }
 
 bool CMasternodeSync::IsBudgetPropEmpty()
@@ -119,6 +159,7 @@ void CMasternodeSync::SwitchToNextAsset()
     g_tiertwo_sync_state.SetCurrentSyncPhase(nextAsset);
     RequestedMasternodeAttempt = 0;
     nAssetSyncStarted = GetTime();
+    ClearPendingRequests();
 }
 
 std::string CMasternodeSync::GetSyncStatus()
@@ -142,11 +183,24 @@ std::string CMasternodeSync::GetSyncStatus()
     return "";
 }
 
-void CMasternodeSync::ProcessSyncStatusMsg(int nItemID, int nCount)
+void CMasternodeSync::ProcessSyncStatusMsg(NodeId nodeId, int nItemID, int nCount)
 {
     int RequestedMasternodeAssets = g_tiertwo_sync_state.GetSyncPhase();
     if (RequestedMasternodeAssets >= MASTERNODE_SYNC_FINISHED) return;
 
+    // The count is the last message answering a sync request (the finalized budgets come after the proposals)
+    if ((nItemID == MASTERNODE_SYNC_LIST || nItemID == MASTERNODE_SYNC_MNW) ? nItemID == RequestedMasternodeAssets :
+            (nItemID == MASTERNODE_SYNC_BUDGET_FIN && RequestedMasternodeAssets == MASTERNODE_SYNC_BUDGET)) {
+        LOCK(cs_requests);
+        const auto it = mapPendingRequests.find(nodeId);
+        if (it != mapPendingRequests.end()) {
+            const int64_t nResponseTime = GetTimeMillis() - it->second;
+            nAvgResponseTime = nAvgResponseTime == 0 ? nResponseTime : (3 * nAvgResponseTime + nResponseTime) / 4;
+            mapPendingRequests.erase(it);
+            nAnsweredRequests++;
+        }
+    }
+
     //this means we will receive no further communication
     switch (nItemID) {
         case (MASTERNODE_SYNC_LIST):
@@ -158,16 +212,21 @@ void CMasternodeSync::ProcessSyncStatusMsg(int nItemID, int nCount)
             if (nItemID != RequestedMasternodeAssets) return;
             sumMasternodeWinner += nCount;
             countMasternodeWinner++;
+            // the count includes the winners we have already, which are not sent again
+            if (nCount > 0) g_tiertwo_sync_state.KnownMasternodeWinners();
             break;
         case (MASTERNODE_SYNC_BUDGET_PROP):
             if (RequestedMasternodeAssets != MASTERNODE_SYNC_BUDGET) return;
             sumBudgetItemProp += nCount;
             countBudgetItemProp++;
+            // the count includes the items we have already, which are not sent again
+            if (nCount > 0) g_tiertwo_sync_state.KnownBudgetItems();
             break;
         case (MASTERNODE_SYNC_BUDGET_FIN):
             if (RequestedMasternodeAssets != MASTERNODE_SYNC_BUDGET) return;
             sumBudgetItemFin += nCount;
             countBudgetItemFin++;
+            if (nCount > 0) g_tiertwo_sync_state.KnownBudgetItems();
             break;
         default:
             break;
@@ -195,11 +254,13 @@ void CMasternodeSync::Process()
         Reset();
     }
     lastProcess = now;
+    nRoundRequests = 0;
 
     // Update chain sync status using the 'lastProcess' time
     UpdateBlockchainSynced(isRegTestNet);
 
     if (g_tiertwo_sync_state.IsSynced()) {
+        nLastSynced = now;
         if (isRegTestNet) {
             return;
         }
@@ -255,6 +316,7 @@ void CMasternodeSync::syncTimeout(const std::string& reason)
     RequestedMasternodeAttempt = 0;
     lastFailure = GetTime();
     nCountFailures++;
+    fResumed = false;
 }
 
 bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
@@ -277,7 +339,8 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
 
         g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETSPORKS));
         RequestedMasternodeAttempt++;
-        return false;
+        // ask the other peers in the same round (no sync status count is sent for the sporks)
+        return RequestedMasternodeAttempt < MASTERNODE_SYNC_THRESHOLD && ++nRoundRequests < MASTERNODE_SYNC_PARALLEL_REQUESTS;
     }
 
     if (pnode->nVersion < ActiveProtocol() || !pnode->CanRelay()) {
@@ -292,9 +355,9 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
 
         int lastMasternodeList = g_tiertwo_sync_state.GetlastMasternodeList();
         LogPrint(BCLog::MASTERNODE, "CMasternodeSync::Process() - lastMasternodeList %lld (GetTime() - MASTERNODE_SYNC_TIMEOUT) %lld\n", lastMasternodeList, GetTime() - MASTERNODE_SYNC_TIMEOUT);
-        if (lastMasternodeList > 0 && lastMasternodeList < GetTime() - MASTERNODE_SYNC_TIMEOUT * 8 && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) {
-            // hasn't received a new item in the last 40 seconds AND has sent at least a minimum of MASTERNODE_SYNC_THRESHOLD GETMNLIST requests,
-            // so we'll move to the next asset.
+        if (lastMasternodeList > 0 && lastMasternodeList < GetTime() - GetIdleWindow(MASTERNODE_SYNC_TIMEOUT * 8) && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) {
+            // hasn't received a new item in the last 40 seconds (or since all the peers answered) AND has sent at least a minimum
+            // of MASTERNODE_SYNC_THRESHOLD GETMNLIST requests, so we'll move to the next asset.
             SwitchToNextAsset();
             return false;
         }
@@ -326,7 +389,8 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
         // Increase the sync attempt count
         RequestedMasternodeAttempt++;
 
-        return false; // sleep 1 second before do another request round.
+        // ask other peers in the same round, up to MASTERNODE_SYNC_PARALLEL_REQUESTS
+        return AddPendingRequest(pnode->GetId());
     }
 
     if (RequestedMasternodeAssets == MASTERNODE_SYNC_MNW) {
@@ -336,7 +400,7 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
         }
 
         int lastMasternodeWinner = g_tiertwo_sync_state.GetlastMasternodeWinner();
-        if (lastMasternodeWinner > 0 && lastMasternodeWinner < GetTime() - MASTERNODE_SYNC_TIMEOUT * 2 && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) { //hasn't received a new item in the last five seconds, so we'll move to the
+        if (lastMasternodeWinner > 0 && lastMasternodeWinner < GetTime() - GetIdleWindow(MASTERNODE_SYNC_TIMEOUT * 2) && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) { //hasn't received a new item in the last five seconds, so we'll move to the
             SwitchToNextAsset();
             // in case we received a budget item while we were syncing the mnw, let's reset the last budget item received time.
             // reason: if we received for example a single proposal +50 seconds ago, then once the budget sync starts (right after this call),
@@ -372,17 +436,18 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
 
         // Sync mn winners
         int nMnCount = mnodeman.CountEnabled(true /* only_legacy */);
-        g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETMNWINNERS, nMnCount));
+        g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::GETMNWINNERS, nMnCount, masternodePayments.GetSyncDigest(nMnCount)));
         RequestedMasternodeAttempt++;
 
-        return false; // sleep 1 second before do another request round.
+        // ask other peers in the same round, up to MASTERNODE_SYNC_PARALLEL_REQUESTS
+        return AddPendingRequest(pnode->GetId());
     }
 
     if (RequestedMasternodeAssets == MASTERNODE_SYNC_BUDGET) {
         int lastBudgetItem = g_tiertwo_sync_state.GetlastBudgetItem();
         // We'll start rejecting votes if we accidentally get set as synced too soon
-        if (lastBudgetItem > 0 && lastBudgetItem < GetTime() - MASTERNODE_SYNC_TIMEOUT * 10 && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) {
-            // Hasn't received a new item in the last fifty seconds and more than MASTERNODE_SYNC_THRESHOLD requests were sent,
+        if (lastBudgetItem > 0 && lastBudgetItem < GetTime() - GetIdleWindow(MASTERNODE_SYNC_TIMEOUT * 10) && RequestedMasternodeAttempt >= MASTERNODE_SYNC_THRESHOLD) {
+            // Hasn't received a new item in the last fifty seconds (or since all the peers answered) and more than MASTERNODE_SYNC_THRESHOLD requests were sent,
             // so we'll move to the next asset
             SwitchToNextAsset();
 
@@ -409,12 +474,13 @@ bool CMasternodeSync::SyncWithNode(CNode* pnode, bool fLegacyMnObsolete)
         // Mark sync requested.
         g_netfulfilledman.AddFulfilledRequest(pnode->addr, "busync");
 
-        // Sync proposals, finalizations and votes
+        // Sync proposals, finalizations and votes, skipping the ones we have already
         uint256 n;
-        g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BUDGETVOTESYNC, n));
+        g_connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BUDGETVOTESYNC, n, g_budgetman.GetSyncDigest()));
         RequestedMasternodeAttempt++;
 
-        return false; // sleep 1 second before do another request round.
+        // ask other peers in the same round, up to MASTERNODE_SYNC_PARALLEL_REQUESTS
+        return AddPendingRequest(pnode->GetId());
     }
 
     return true;
@@ -7,6 +7,8 @@
 #define MASTERNODE_SYNC_H
 
 #include "net.h"    // for NodeId
+#include "serialize.h"
+#include "sync.h"
 #include "uint256.h"
 
 #include <atomic>
@@ -14,6 +16,13 @@
 #include <map>
 
 #define MASTERNODE_SYNC_TIMEOUT 5
+// Sync requests of the current asset sent to different peers in the same round
+#define MASTERNODE_SYNC_PARALLEL_REQUESTS 3
+// A node restarted within this time after it was last synced resumes the sync (see CMasternodeSync::CheckResume)
+#define MASTERNODE_SYNC_RESUME_TIME (60 * 60)
+
+static const std::string MN_SYNC_CACHE_FILENAME = "mnsync.dat";
+static const std::string MN_SYNC_CACHE_FILE_ID = "magicMasternodeSyncCache";
 
 class CMasternodeSync;
 extern CMasternodeSync masternodeSync;
@@ -54,13 +63,22 @@ public:
 
     CMasternodeSync();
 
+    // Only the last time the node was synced is persisted, to resume the sync after a restart
+    SERIALIZE_METHODS(CMasternodeSync, obj) { READWRITE(obj.nLastSynced); }
+    void Clear() { nLastSynced = 0; }
+    std::string ToString() const;
+
     void SwitchToNextAsset();
     std::string GetSyncStatus();
-    void ProcessSyncStatusMsg(int nItemID, int itemCount);
+    void ProcessSyncStatusMsg(NodeId nodeId, int nItemID, int itemCount);
     bool IsBudgetFinEmpty();
     bool IsBudgetPropEmpty();
 
     void Reset();
+    // Called once the persisted state is loaded: a node that was synced shortly before being restarted
+    // has most of the tier two data already, and doesn't wait for the slower peers once the usual quorum
+    // of peers answered the requests of an asset.
+    void CheckResume();
     void Process();
     /*
      * Process sync with a single node.
@@ -76,6 +94,30 @@ public:
     bool MessageDispatcher(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
 private:
+    friend class CMasternodeSyncTest;
+
+    // Last time Process() found the node synced
+    int64_t nLastSynced{0};
+    // The node was synced shortly before being restarted (see CheckResume)
+    bool fResumed{false};
+    // Sync requests sent in the current round of Process()
+    int nRoundRequests{0};
+
+    Mutex cs_requests;
+    // Requests of the current asset not answered yet with a sync status count: nodeID --> request time in milliseconds
+    std::map<NodeId, int64_t> mapPendingRequests GUARDED_BY(cs_requests);
+    // Requests of the current asset answered with a sync status count
+    int nAnsweredRequests GUARDED_BY(cs_requests){0};
+    // Moving average of the time the peers take to answer a sync request, in milliseconds
+    int64_t nAvgResponseTime GUARDED_BY(cs_requests){0};
+
+    // Records a sync request of the current asset; returns whether the same round can go on with another peer
+    bool AddPendingRequest(NodeId nodeId);
+    void ClearPendingRequests();
+    // Time without new items after which the current asset is complete, in seconds. This is nMaxWindow while
+    // some requests are not answered, and a few response times once all the peers answered (once
+    // MASTERNODE_SYNC_THRESHOLD peers answered, when resuming).
+    int64_t GetIdleWindow(int64_t nMaxWindow);
 
     // Tier two sync node state
     // map of nodeID --> TierTwoPeerData
@@ -145,7 +145,7 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb)
         int nDoS = 0;
         if (mnb.lastPing.IsNull() || (!mnb.lastPing.IsNull() && mnb.lastPing.CheckAndUpdate(nDoS, false))) {
             lastPing = mnb.lastPing;
-            mnodeman.mapSeenMasternodePing.emplace(lastPing.GetHash(), lastPing);
+            mnodeman.AddSeenPing(lastPing);
         }
         return true;
     }
@@ -576,7 +576,7 @@ bool CMasternodePing::CheckAndUpdate(int& nDos, bool fRequireAvailable, bool fCh
             }
 
             // ping have passed the basic checks, can be updated now
-            mnodeman.mapSeenMasternodePing.emplace(GetHash(), *this);
+            mnodeman.AddSeenPing(*this);
 
             // SetLastPing locks masternode cs. Be careful with the lock ordering.
             pmn->SetLastPing(*this);
@@ -102,13 +102,12 @@ CMasternodeDB::ReadResult CMasternodeDB::Read(CMasternodeMan& mnodemanToLoad)
     // Don't try to resize to a negative number if file is small
     if (dataSize < 0)
         dataSize = 0;
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
+    // read data and checksum from file, straight into the stream buffer
+    CDataStream ssMasternodes(SER_DISK, CLIENT_VERSION);
+    ssMasternodes.resize(dataSize);
     uint256 hashIn;
-
-    // read data and checksum from file
     try {
-        filein.read((char*)vchData.data(), dataSize);
+        filein.read(ssMasternodes.data(), dataSize);
         filein >> hashIn;
     } catch (const std::exception& e) {
         error("%s : Deserialize or I/O error - %s", __func__, e.what());
@@ -117,8 +116,6 @@ CMasternodeDB::ReadResult CMasternodeDB::Read(CMasternodeMan& mnodemanToLoad)
     filein.fclose();
 
     const auto& params = Params();
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssMasternodes(vchData, SER_DISK,  CLIENT_VERSION);
 
     // verify stored checksum matches input data
     uint256 hashTmp = Hash(ssMasternodes.begin(), ssMasternodes.end());
@@ -207,6 +204,7 @@ bool CMasternodeMan::Add(CMasternode& mn)
     if (it == mapMasternodes.end()) {
         LogPrint(BCLog::MASTERNODE, "Adding new Masternode %s\n", mn.vin.prevout.ToString());
         mapMasternodes.emplace(mn.vin.prevout, std::make_shared<CMasternode>(mn));
+        nLegacyGeneration++;
         LogPrint(BCLog::MASTERNODE, "Masternode added. New total count: %d\n", mapMasternodes.size());
         return true;
     }
@@ -282,14 +280,15 @@ int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
             // clean MN pings right away.
             auto itPing = mapSeenMasternodePing.begin();
             while (itPing != mapSeenMasternodePing.end()) {
-                if (itPing->second.GetVin().prevout == it->first) {
-                    itPing = mapSeenMasternodePing.erase(itPing);
+                if (itPing->second.collateral == it->first) {
+                    EraseSeenPing(itPing++);
                 } else {
                     ++itPing;
                 }
             }
 
             it = mapMasternodes.erase(it);
+            nLegacyGeneration++;
             LogPrint(BCLog::MASTERNODE, "Masternode removed.\n");
         } else {
             ++it;
@@ -339,10 +338,10 @@ int CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
     }
 
     // remove expired mapSeenMasternodePing
-    std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
+    auto it4 = mapSeenMasternodePing.begin();
     while (it4 != mapSeenMasternodePing.end()) {
         if ((*it4).second.sigTime < GetTime() - (MasternodeRemovalSeconds() * 2)) {
-            it4 = mapSeenMasternodePing.erase(it4);
+            EraseSeenPing(it4++);
         } else {
             ++it4;
         }
@@ -355,14 +354,71 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
+    nLegacyGeneration++;
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
+    mapLastSeenPing.clear();
     nDsqCount = 0;
 }
 
+bool CMasternodeMan::GetSeenPing(const uint256& hash, CMasternodePing& mnpRet) const
+{
+    const auto it = mapSeenMasternodePing.find(hash);
+    if (it == mapSeenMasternodePing.end() || !it->second.ping) return false;
+    mnpRet = *it->second.ping;
+    return true;
+}
+
+void CMasternodeMan::AddSeenPing(const CMasternodePing& mnp)
+{
+    const uint256& hash = mnp.GetHash();
+    const COutPoint& collateral = mnp.vin.prevout;
+    const auto res = mapSeenMasternodePing.emplace(hash, SeenPing{collateral, mnp.sigTime, nullptr});
+    if (!res.second) return;
+
+    // Keep the ping whole only if it is the last one of the masternode
+    const auto itLast = mapLastSeenPing.find(collateral);
+    if (itLast != mapLastSeenPing.end()) {
+        const auto itPrev = mapSeenMasternodePing.find(itLast->second);
+        if (itPrev != mapSeenMasternodePing.end()) {
+            if (itPrev->second.sigTime > mnp.sigTime) return;
+            itPrev->second.ping.reset();
+        }
+    }
+    res.first->second.ping = std::make_shared<const CMasternodePing>(mnp);
+    mapLastSeenPing[collateral] = hash;
+}
+
+void CMasternodeMan::EraseSeenPing(std::map<uint256, SeenPing>::iterator it)
+{
+    const auto itLast = mapLastSeenPing.find(it->second.collateral);
+    if (itLast != mapLastSeenPing.end() && itLast->second == it->first) {
+        mapLastSeenPing.erase(itLast);
+    }
+    mapSeenMasternodePing.erase(it);
+}
+
+std::map<uint256, CMasternodePing> CMasternodeMan::GetSeenPingsToSave() const
+{
+    std::map<uint256, CMasternodePing> mapPings;
+    for (const auto& it : mapSeenMasternodePing) {
+        if (it.second.ping) mapPings.emplace(it.first, *it.second.ping);
+    }
+    return mapPings;
+}
+
+void CMasternodeMan::LoadSeenPings(const std::map<uint256, CMasternodePing>& mapPings)
+{
+    mapSeenMasternodePing.clear();
+    mapLastSeenPing.clear();
+    for (const auto& it : mapPings) {
+        AddSeenPing(it.second);
+    }
+}
+
 static void CountNetwork(const CService& addr, int& ipv4, int& ipv6, int& onion)
 {
     std::string strHost;
@@ -594,11 +650,13 @@ MasternodeRef CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeigh
     int nCountTenth = 0;
     arith_uint256 nHigh = ARITH_UINT256_ZERO;
     const uint256& hash = GetHashAtHeight(nBlockHeight - 101);
+    const auto scoreTable = GetScoreTable(hash);
     for (const auto& s: vecMasternodeLastPaid) {
         const MasternodeRef pmn = s.second;
         if (!pmn) break;
 
-        const arith_uint256& n = pmn->CalculateScore(hash);
+        const auto it = scoreTable->mapScores.find(pmn->vin.prevout);
+        const arith_uint256& n = it != scoreTable->mapScores.end() ? it->second : pmn->CalculateScore(hash);
         if (n > nHigh) {
             nHigh = n;
             pBestMasternode = pmn;
@@ -609,41 +667,61 @@ MasternodeRef CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeigh
     return pBestMasternode;
 }
 
-MasternodeRef CMasternodeMan::GetCurrentMasterNode(const uint256& hash) const
+std::shared_ptr<const CMasternodeMan::MNScoreTable> CMasternodeMan::GetScoreTable(const uint256& hash) const
 {
-    int minProtocol = ActiveProtocol();
-    int64_t score = 0;
-    MasternodeRef winner = nullptr;
-
-    // scan for winner
-    for (const auto& it : mapMasternodes) {
-        const MasternodeRef& mn = it.second;
-        if (mn->protocolVersion < minProtocol || !mn->IsEnabled()) continue;
-        // calculate the score of the masternode
-        const int64_t n = mn->CalculateScore(hash).GetCompact(false);
-        // determine the winner
-        if (n > score) {
-            score = n;
-            winner = mn;
+    CDeterministicMNList mnList;
+    if (deterministicMNManager->IsDIP3Enforced()) {
+        mnList = deterministicMNManager->GetListAtChainTip();
+    }
+    const uint64_t nGeneration = nLegacyGeneration;
+    {
+        LOCK(cs_score_tables);
+        std::shared_ptr<const MNScoreTable> table;
+        if (scoreTables.get(hash, table) && table->nLegacyGeneration == nGeneration && table->hashMNList == mnList.GetBlockHash()) {
+            return table;
         }
     }
 
-    // scan also dmns
-    if (deterministicMNManager->IsDIP3Enforced()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
-        mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-            const MasternodeRef mn = MakeMasternodeRefForDMN(dmn);
-            // calculate the score of the masternode
-            const int64_t n = mn->CalculateScore(hash).GetCompact(false);
-            // determine the winner
-            if (n > score) {
-                score = n;
-                winner = mn;
-            }
-        });
+    // A change of the masternodes while the table is built makes it stale for the next lookup
+    auto table = std::make_shared<MNScoreTable>();
+    table->nLegacyGeneration = nGeneration;
+    table->hashMNList = mnList.GetBlockHash();
+    const auto addScore = [&](const MasternodeRef& mn, const CDeterministicMNCPtr& dmn) {
+        const arith_uint256 score = mn->CalculateScore(hash);
+        table->vScores.push_back({score, score.GetCompact(false), mn, dmn});
+        table->mapScores.emplace(mn->vin.prevout, score);
+    };
+    {
+        LOCK(cs);
+        for (const auto& it : mapMasternodes) {
+            addScore(it.second, nullptr);
+        }
     }
+    mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        addScore(MakeMasternodeRefForDMN(dmn), dmn);
+    });
+    std::stable_sort(table->vScores.begin(), table->vScores.end(), [](const MNScore& a, const MNScore& b) {
+        return a.nCompactScore > b.nCompactScore;
+    });
 
-    return winner;
+    LOCK(cs_score_tables);
+    scoreTables.insert(hash, table);
+    return table;
+}
+
+MasternodeRef CMasternodeMan::GetCurrentMasterNode(const uint256& hash) const
+{
+    int minProtocol = ActiveProtocol();
+
+    // The first enabled masternode of the table has the highest score
+    const auto scoreTable = GetScoreTable(hash);
+    LOCK(cs);
+    for (const MNScore& s : scoreTable->vScores) {
+        if (s.nCompactScore <= 0) break;
+        if (s.dmn ? s.dmn->IsPoSeBanned() : (s.mn->protocolVersion < minProtocol || !s.mn->IsEnabled())) continue;
+        return s.mn;
+    }
+    return nullptr;
 }
 
 std::vector<std::pair<MasternodeRef, int>> CMasternodeMan::GetMnScores(int nLast) const
@@ -668,13 +746,17 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight) co
     // height outside range
     if (hash == UINT256_ZERO) return -1;
 
-    // scan for winner
     int minProtocol = ActiveProtocol();
-    std::vector<std::pair<int64_t, CTxIn> > vecMasternodeScores;
-    {
-        LOCK(cs);
-        for (const auto& it : mapMasternodes) {
-            const MasternodeRef& mn = it.second;
+    const bool fCheckAge = sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT);
+    const int64_t nNow = GetAdjustedTime();
+    int rank = 0;
+    const auto scoreTable = GetScoreTable(hash);
+    LOCK(cs);
+    for (const MNScore& s : scoreTable->vScores) {
+        if (s.dmn) {
+            if (s.dmn->IsPoSeBanned()) continue;
+        } else {
+            const MasternodeRef& mn = s.mn;
             if (!mn->IsEnabled()) {
                 continue; // Skip not enabled
             }
@@ -682,29 +764,12 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight) co
                 LogPrint(BCLog::MASTERNODE,"Skipping Masternode with obsolete version %d\n", mn->protocolVersion);
                 continue; // Skip obsolete versions
             }
-            if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT) &&
-                    GetAdjustedTime() - mn->sigTime < MN_WINNER_MINIMUM_AGE) {
+            if (fCheckAge && nNow - mn->sigTime < MN_WINNER_MINIMUM_AGE) {
                 continue; // Skip masternodes younger than (default) 1 hour
             }
-            vecMasternodeScores.emplace_back(mn->CalculateScore(hash).GetCompact(false), mn->vin);
         }
-    }
-
-    // scan also dmns
-    if (deterministicMNManager->IsDIP3Enforced()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
-        mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-            const MasternodeRef mn = MakeMasternodeRefForDMN(dmn);
-            vecMasternodeScores.emplace_back(mn->CalculateScore(hash).GetCompact(false), mn->vin);
-        });
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
-
-    int rank = 0;
-    for (std::pair<int64_t, CTxIn> & s : vecMasternodeScores) {
         rank++;
-        if (s.second.prevout == vin.prevout) {
+        if (s.mn->vin.prevout == vin.prevout) {
             return rank;
         }
     }
@@ -718,27 +783,20 @@ std::vector<std::pair<int64_t, MasternodeRef>> CMasternodeMan::GetMasternodeRank
     const uint256& hash = GetHashAtHeight(nBlockHeight - 1);
     // height outside range
     if (hash == UINT256_ZERO) return vecMasternodeScores;
-    {
-        LOCK(cs);
-        // scan for winner
-        for (const auto& it : mapMasternodes) {
-            const MasternodeRef mn = it.second;
-            const uint32_t score = mn->IsEnabled() ? mn->CalculateScore(hash).GetCompact(false) : 9999;
 
-            vecMasternodeScores.emplace_back(score, mn);
+    // The enabled masternodes by score, then the others with a score of 9999
+    std::vector<std::pair<int64_t, MasternodeRef>> vecDisabled;
+    const auto scoreTable = GetScoreTable(hash);
+    LOCK(cs);
+    for (const MNScore& s : scoreTable->vScores) {
+        const bool fEnabled = s.dmn ? !s.dmn->IsPoSeBanned() : s.mn->IsEnabled();
+        if (fEnabled) {
+            vecMasternodeScores.emplace_back(s.nCompactScore, s.mn);
+        } else {
+            vecDisabled.emplace_back(9999, s.mn);
         }
     }
-    // scan also dmns
-    if (deterministicMNManager->IsDIP3Enforced()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
-        mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
-            const MasternodeRef mn = MakeMasternodeRefForDMN(dmn);
-            const uint32_t score = dmn->IsPoSeBanned() ? 9999 : mn->CalculateScore(hash).GetCompact(false);
-
-            vecMasternodeScores.emplace_back(score, mn);
-        });
-    }
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
+    vecMasternodeScores.insert(vecMasternodeScores.end(), vecDisabled.begin(), vecDisabled.end());
     return vecMasternodeScores;
 }
 
@@ -767,7 +825,7 @@ bool CMasternodeMan::CheckInputs(CMasternodeBroadcast& mnb, int nChainHeight, in
     }
 
     // Check collateral value
-    if (collateralUtxo.out.nValue != consensus.nMNCollateralAmt) {
+    if (collateralUtxo.nValue != consensus.nMNCollateralAmt) {
         LogPrint(BCLog::MASTERNODE,"mnb - invalid amount for mnb collateral %s\n", mnb.vin.prevout.ToString());
         nDoS = 33;
         return false;
@@ -775,7 +833,7 @@ bool CMasternodeMan::CheckInputs(CMasternodeBroadcast& mnb, int nChainHeight, in
 
     // Check collateral association with mnb pubkey
     CScript payee = GetScriptForDestination(mnb.pubKeyCollateralAddress.GetID());
-    if (collateralUtxo.out.scriptPubKey != payee) {
+    if (collateralUtxo.GetScriptPubKey() != payee) {
         LogPrint(BCLog::MASTERNODE,"mnb - collateral %s not associated with mnb pubkey\n", mnb.vin.prevout.ToString());
         nDoS = 33;
         return false;
@@ -860,7 +918,7 @@ int CMasternodeMan::ProcessMNBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb)
 int CMasternodeMan::ProcessMNPing(CNode* pfrom, CMasternodePing& mnp)
 {
     const uint256& mnpHash = mnp.GetHash();
-    if (mapSeenMasternodePing.count(mnpHash)) return 0; //seen
+    if (HasSeenPing(mnpHash)) return 0; //seen
 
     int nDoS = 0;
     if (mnp.CheckAndUpdate(nDoS)) return 0;
@@ -1018,6 +1076,7 @@ void CMasternodeMan::Remove(const COutPoint& collateralOut)
     const auto it = mapMasternodes.find(collateralOut);
     if (it != mapMasternodes.end()) {
         mapMasternodes.erase(it);
+        nLegacyGeneration++;
     }
 }
 
@@ -1028,7 +1087,7 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast& mnb)
         return;
     }
 
-    mapSeenMasternodePing.emplace(mnb.lastPing.GetHash(), mnb.lastPing);
+    AddSeenPing(mnb.lastPing);
     mapSeenMasternodeBroadcast.emplace(mnb.GetHash(), mnb);
     g_tiertwo_sync_state.AddedMasternodeList(mnb.GetHash());
 
@@ -7,18 +7,23 @@
 #define MASTERNODEMAN_H
 
 #include "activemasternode.h"
+#include "arith_uint256.h"
 #include "cyclingvector.h"
 #include "key.h"
 #include "key_io.h"
 #include "masternode.h"
 #include "net.h"
+#include "saltedhasher.h"
 #include "sync.h"
+#include "unordered_lru_cache.h"
 #include "util/system.h"
 
 #define MASTERNODES_REQUEST_SECONDS (60 * 60) // One hour.
 
 /** Maximum number of block hashes to cache */
 static const unsigned int CACHED_BLOCK_HASHES = 200;
+/** Number of block hashes whose masternode scores are cached */
+static const size_t MN_SCORE_TABLES_CACHE_SIZE = 32;
 
 class CMasternodeMan;
 class CActiveMasternode;
@@ -77,6 +82,29 @@ private:
     // Memory Only. Cache last block hashes. Used to verify mn pings and winners.
     CyclingVector<uint256> cvLastBlockHashes;
 
+    // Scores of all the known masternodes (legacy and deterministic) for a block hash, sorted high
+    // to low, the ties in the order of the lists. The legacy entries point to the live objects,
+    // whose state is checked by the rank queries, so a table is only rebuilt when the set of
+    // legacy masternodes or the deterministic list change.
+    struct MNScore {
+        arith_uint256 score;
+        int64_t nCompactScore;
+        MasternodeRef mn;
+        CDeterministicMNCPtr dmn; // nullptr for the legacy masternodes
+    };
+    struct MNScoreTable {
+        uint64_t nLegacyGeneration{0};
+        uint256 hashMNList;
+        std::vector<MNScore> vScores;
+        std::map<COutPoint, arith_uint256> mapScores;
+    };
+    // Bumped when a legacy masternode is added or removed
+    std::atomic<uint64_t> nLegacyGeneration{0};
+    mutable Mutex cs_score_tables;
+    mutable unordered_lru_cache<uint256, std::shared_ptr<const MNScoreTable>, StaticSaltedHasher, MN_SCORE_TABLES_CACHE_SIZE> scoreTables GUARDED_BY(cs_score_tables);
+
+    std::shared_ptr<const MNScoreTable> GetScoreTable(const uint256& hash) const;
+
     // Return the banning score (0 if no ban score increase is needed).
     int ProcessMNBroadcast(CNode* pfrom, CMasternodeBroadcast& mnb);
     int ProcessMNPing(CNode* pfrom, CMasternodePing& mnp);
@@ -85,14 +113,33 @@ private:
     // Relay a MN
     void BroadcastInvMN(CMasternode* mn, CNode* pfrom);
 
+    // A ping seen from the network. Only the last ping of each masternode is kept whole, to answer
+    // the peers requesting it: the older ones are only known by hash, until they expire.
+    struct SeenPing {
+        COutPoint collateral;
+        int64_t sigTime;
+        std::shared_ptr<const CMasternodePing> ping; // nullptr once superseded
+    };
+    // Keep track of all pings I've seen
+    std::map<uint256, SeenPing> mapSeenMasternodePing;
+    // Hash of the last ping seen of each masternode (the one kept whole in mapSeenMasternodePing)
+    std::map<COutPoint, uint256> mapLastSeenPing;
+
+    void EraseSeenPing(std::map<uint256, SeenPing>::iterator it);
+    std::map<uint256, CMasternodePing> GetSeenPingsToSave() const;
+    void LoadSeenPings(const std::map<uint256, CMasternodePing>& mapPings);
+
     // Validation
     bool CheckInputs(CMasternodeBroadcast& mnb, int nChainHeight, int& nDoS);
 
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
-    // Keep track of all pings I've seen
-    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
+
+    bool HasSeenPing(const uint256& hash) const { return mapSeenMasternodePing.count(hash); }
+    // Returns false if the ping is unknown, or known by hash only (superseded by a later ping)
+    bool GetSeenPing(const uint256& hash, CMasternodePing& mnpRet) const;
+    void AddSeenPing(const CMasternodePing& mnp);
 
     // keep track of dsq count to prevent masternodes from gaming obfuscation queue
     // TODO: Remove this from serialization
@@ -102,13 +149,18 @@ public:
     {
         LOCK(obj.cs);
         READWRITE(obj.mapMasternodes);
+        SER_READ(obj, obj.nLegacyGeneration++);
         READWRITE(obj.mAskedUsForMasternodeList);
         READWRITE(obj.mWeAskedForMasternodeList);
         READWRITE(obj.mWeAskedForMasternodeListEntry);
         READWRITE(obj.nDsqCount);
 
         READWRITE(obj.mapSeenMasternodeBroadcast);
-        READWRITE(obj.mapSeenMasternodePing);
+        // Only the pings kept whole are saved, in the same format as the full map
+        std::map<uint256, CMasternodePing> mapPings;
+        SER_WRITE(obj, mapPings = obj.GetSeenPingsToSave());
+        READWRITE(mapPings);
+        SER_READ(obj, obj.LoadSeenPings(mapPings));
     }
 
     CMasternodeMan();
@@ -0,0 +1,124 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "memorybudget.h"
+
+#include "logging.h"
+
+#include <algorithm>
+
+CMemoryBudget g_memory_budget;
+
+void CMemoryBudget::SetLimit(size_t nLimitIn)
+{
+    LOCK(cs);
+    nLimit = nLimitIn;
+}
+
+size_t CMemoryBudget::GetLimit() const
+{
+    LOCK(cs);
+    return nLimit;
+}
+
+void CMemoryBudget::Register(const std::string& strName, int nPriority, UsageFunc usage, TrimFunc trim)
+{
+    LOCK(cs);
+    for (Component& component : vComponents) {
+        if (component.strName == strName) {
+            component.nPriority = nPriority;
+            component.usage = std::move(usage);
+            component.trim = std::move(trim);
+            return;
+        }
+    }
+    Component component;
+    component.strName = strName;
+    component.nPriority = nPriority;
+    component.usage = std::move(usage);
+    component.trim = std::move(trim);
+    vComponents.emplace_back(std::move(component));
+}
+
+void CMemoryBudget::Unregister(const std::string& strName)
+{
+    LOCK(cs);
+    vComponents.erase(std::remove_if(vComponents.begin(), vComponents.end(),
+                                     [&strName](const Component& component) { return component.strName == strName; }),
+                      vComponents.end());
+}
+
+void CMemoryBudget::Clear()
+{
+    LOCK(cs);
+    vComponents.clear();
+}
+
+size_t CMemoryBudget::Enforce()
+{
+    size_t nMaxUsage;
+    std::vector<Component> vCopy;
+    {
+        LOCK(cs);
+        if (nLimit == 0) return 0;
+        nMaxUsage = nLimit;
+        vCopy = vComponents;
+    }
+
+    std::vector<size_t> vUsage(vCopy.size());
+    size_t nTotal = 0;
+    for (size_t i = 0; i < vCopy.size(); i++) {
+        vUsage[i] = vCopy[i].usage();
+        nTotal += vUsage[i];
+    }
+    if (nTotal <= nMaxUsage) return 0;
+
+    // Trim the lowest priorities first, the components of a priority by registration order
+    std::vector<size_t> vOrder;
+    for (size_t i = 0; i < vCopy.size(); i++) {
+        if (vCopy[i].trim) vOrder.emplace_back(i);
+    }
+    std::stable_sort(vOrder.begin(), vOrder.end(),
+                     [&vCopy](size_t a, size_t b) { return vCopy[a].nPriority < vCopy[b].nPriority; });
+
+    size_t nReleased = 0;
+    std::vector<std::string> vTrimmed;
+    for (size_t i : vOrder) {
+        const size_t nExcess = nTotal - nMaxUsage;
+        const size_t nTarget = vUsage[i] > nExcess ? vUsage[i] - nExcess : 0;
+        vCopy[i].trim(nTarget);
+        const size_t nNewUsage = vCopy[i].usage();
+        if (nNewUsage < vUsage[i]) {
+            LogPrint(BCLog::BENCHMARK, "Memory budget: trimmed %s from %u to %u bytes (target %u)\n",
+                     vCopy[i].strName, vUsage[i], nNewUsage, nTarget);
+            nReleased += vUsage[i] - nNewUsage;
+            nTotal -= vUsage[i] - nNewUsage;
+            vTrimmed.emplace_back(vCopy[i].strName);
+        }
+        if (nTotal <= nMaxUsage) break;
+    }
+
+    LOCK(cs);
+    for (Component& component : vComponents) {
+        if (std::find(vTrimmed.begin(), vTrimmed.end(), component.strName) != vTrimmed.end()) {
+            component.nTrims++;
+        }
+    }
+    return nReleased;
+}
+
+std::vector<CMemoryBudget::ComponentUsage> CMemoryBudget::GetUsage() const
+{
+    std::vector<Component> vCopy;
+    {
+        LOCK(cs);
+        vCopy = vComponents;
+    }
+    std::vector<ComponentUsage> vRet;
+    vRet.reserve(vCopy.size());
+    for (const Component& component : vCopy) {
+        vRet.push_back({component.strName, component.nPriority, component.usage(), (bool)component.trim, component.nTrims});
+    }
+    return vRet;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_MEMORYBUDGET_H
+#define PIVX_MEMORYBUDGET_H
+
+#include "sync.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/** Default for -maxmemorybudget, in MiB (0 = no global cap) */
+static const int64_t DEFAULT_MAX_MEMORY_BUDGET = 0;
+/** How often the budget is enforced, in milliseconds */
+static const int64_t MEMORY_BUDGET_INTERVAL = 10000;
+
+/** The order in which the caches are trimmed over the budget: the lowest priority first */
+enum MemoryPriority {
+    MEMORY_PRIORITY_LOW = 0,    //! cheap to rebuild
+    MEMORY_PRIORITY_NORMAL = 1, //! costs disk activity to rebuild
+    MEMORY_PRIORITY_HIGH = 2,   //! loses data the node can't rebuild (e.g. transactions)
+};
+
+/**
+ * Keeps the memory usage of the registered caches, and trims them to keep their total under a
+ * global cap. Each component reports its DynamicMemoryUsage, and the ones that can shrink give
+ * a function trimming them to a target size. The fixed size caches are registered for reporting.
+ */
+class CMemoryBudget
+{
+public:
+    typedef std::function<size_t()> UsageFunc;
+    typedef std::function<void(size_t nTargetUsage)> TrimFunc;
+
+    struct ComponentUsage {
+        std::string strName;
+        int nPriority;
+        size_t nUsage;
+        bool fTrimmable;
+        uint64_t nTrims;
+    };
+
+    /** Set the global cap in bytes, 0 to only report the usage. */
+    void SetLimit(size_t nLimit);
+    size_t GetLimit() const;
+
+    /** Register (or replace) a component. trim can be empty for the caches with a fixed size. */
+    void Register(const std::string& strName, int nPriority, UsageFunc usage, TrimFunc trim = nullptr);
+    void Unregister(const std::string& strName);
+    void Clear();
+
+    /**
+     * Trim the components, the lowest priority first, until their total usage is under the cap.
+     * The callbacks are called without holding the budget lock, they take the locks of their cache.
+     * Returns the number of bytes released.
+     */
+    size_t Enforce();
+
+    /** Usage of each component, by registration order */
+    std::vector<ComponentUsage> GetUsage() const;
+
+private:
+    struct Component {
+        std::string strName;
+        int nPriority;
+        UsageFunc usage;
+        TrimFunc trim;
+        uint64_t nTrims{0};
+    };
+
+    mutable Mutex cs;
+    size_t nLimit GUARDED_BY(cs){0};
+    std::vector<Component> vComponents GUARDED_BY(cs);
+};
+
+extern CMemoryBudget g_memory_budget;
+
+#endif // PIVX_MEMORYBUDGET_H
@@ -7,6 +7,7 @@
 
 #include "indirectmap.h"
 #include "prevector.h"
+#include "support/allocators/pool.h"
 
 #include <stdlib.h>
 
@@ -221,6 +222,17 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+// The chunks of the pool, whether their blocks are in use or free, and the buckets
+template<typename X, typename Y, typename Z, typename P, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z, P, PoolAllocator<std::pair<const X, Y>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>>& m)
+{
+    const auto* pool_resource = m.get_allocator().resource();
+    // the chunks are listed in a std::list: a node holds two links and the pointer to the chunk
+    const size_t usage_list = MallocUsage(sizeof(void*) * 3) * pool_resource->NumAllocatedChunks();
+    const size_t usage_chunks = MallocUsage(pool_resource->ChunkSizeBytes()) * pool_resource->NumAllocatedChunks();
+    return usage_list + usage_chunks + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 // Dispatch to class method as fallback
 
 template<typename X>
@@ -7,7 +7,9 @@
 #include "merkleblock.h"
 
 #include "consensus/consensus.h"
+#include "consensus/merkle.h"
 #include "hash.h"
+#include "memusage.h"
 #include "primitives/block.h" // for MAX_BLOCK_SIZE
 #include "utilstrencodings.h"
 
@@ -56,25 +58,44 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter* filter, const std:
     txn = CPartialMerkleTree(vHashes, vMatch);
 }
 
-uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::vector<uint256>& vTxid)
+CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter, const CFilteredBlockData& data)
 {
-    if (height == 0) {
-        // hash at height 0 is the txids themself
-        return vTxid[pos];
-    } else {
-        // calculate left hash
-        uint256 left = CalcHash(height - 1, pos * 2, vTxid), right;
-        // calculate right hash if not beyond the end of the array - copy left hash otherwise1
-        if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            right = CalcHash(height - 1, pos * 2 + 1, vTxid);
-        else
-            right = left;
-        // combine subhashes
-        return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
+    assert(data.vTxElements.size() == block.vtx.size());
+    header = block.GetBlockHeader();
+
+    std::vector<bool> vMatch;
+    vMatch.reserve(block.vtx.size());
+
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const bool fMatch = filter.IsRelevantAndUpdate(data.vTxElements[i]);
+        if (fMatch) vMatchedTxn.emplace_back(i, block.vtx[i]->GetHash());
+        vMatch.push_back(fMatch);
     }
+
+    txn = CPartialMerkleTree(data.vMerkleLevels, vMatch);
 }
 
-void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch)
+CFilteredBlockData::CFilteredBlockData(const CBlock& block)
+{
+    std::vector<uint256> vHashes;
+    vHashes.reserve(block.vtx.size());
+    vTxElements.reserve(block.vtx.size());
+    for (const CTransactionRef& tx : block.vtx) {
+        vHashes.push_back(tx->GetHash());
+        vTxElements.emplace_back(*tx);
+    }
+    vMerkleLevels = ComputeMerkleLevels(std::move(vHashes));
+}
+
+size_t CFilteredBlockData::DynamicMemoryUsage() const
+{
+    size_t nUsage = memusage::DynamicUsage(vTxElements) + memusage::DynamicUsage(vMerkleLevels);
+    for (const CBloomTxElements& tx : vTxElements) nUsage += tx.DynamicMemoryUsage();
+    for (const std::vector<uint256>& level : vMerkleLevels) nUsage += memusage::DynamicUsage(level);
+    return nUsage;
+}
+
+void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<std::vector<uint256>>& vLevels, const std::vector<bool>& vMatch)
 {
     // determine whether this node is the parent of at least one matched txid
     bool fParentOfMatch = false;
@@ -84,12 +105,12 @@ void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const st
     vBits.push_back(fParentOfMatch);
     if (height == 0 || !fParentOfMatch) {
         // if at height 0, or nothing interesting below, store hash and stop
-        vHash.push_back(CalcHash(height, pos, vTxid));
+        vHash.push_back(vLevels[height][pos]);
     } else {
         // otherwise, don't store any hash, but descend into the subtrees
-        TraverseAndBuild(height - 1, pos * 2, vTxid, vMatch);
+        TraverseAndBuild(height - 1, pos * 2, vLevels, vMatch);
         if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            TraverseAndBuild(height - 1, pos * 2 + 1, vTxid, vMatch);
+            TraverseAndBuild(height - 1, pos * 2 + 1, vLevels, vMatch);
     }
 }
 
@@ -124,7 +145,12 @@ uint256 CPartialMerkleTree::TraverseAndExtract(int height, unsigned int pos, uns
     }
 }
 
-CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch) : nTransactions(vTxid.size()), fBad(false)
+CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch) :
+    // hash the whole tree once, level by level, instead of once per stored node
+    CPartialMerkleTree(ComputeMerkleLevels(vTxid), vMatch) {}
+
+CPartialMerkleTree::CPartialMerkleTree(const std::vector<std::vector<uint256>>& vLevels, const std::vector<bool>& vMatch) :
+    nTransactions(vLevels.empty() ? 0 : vLevels[0].size()), fBad(false)
 {
     // reset state
     vBits.clear();
@@ -136,7 +162,7 @@ CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256>& vTxid, const
         nHeight++;
 
     // traverse the partial tree
-    TraverseAndBuild(nHeight, 0, vTxid, vMatch);
+    TraverseAndBuild(nHeight, 0, vLevels, vMatch);
 }
 
 CPartialMerkleTree::CPartialMerkleTree() : nTransactions(0), fBad(true) {}
@@ -73,11 +73,11 @@ protected:
         return (nTransactions + (1 << height) - 1) >> height;
     }
 
-    /** calculate the hash of a node in the merkle tree (at leaf level: the txid's themselves) */
-    uint256 CalcHash(int height, unsigned int pos, const std::vector<uint256>& vTxid);
-
-    /** recursive function that traverses tree nodes, storing the data as bits and hashes */
-    void TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch);
+    /**
+     * recursive function that traverses tree nodes, storing the data as bits and hashes.
+     * vLevels are the hashes of the nodes at each height (at leaf level: the txid's themselves).
+     */
+    void TraverseAndBuild(int height, unsigned int pos, const std::vector<std::vector<uint256>>& vLevels, const std::vector<bool>& vMatch);
 
     /**
      * recursive function that traverses tree nodes, consuming the bits and hashes produced by TraverseAndBuild.
@@ -100,6 +100,9 @@ public:
     /** Construct a partial merkle tree from a list of transaction id's, and a mask that selects a subset of them */
     CPartialMerkleTree(const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch);
 
+    /** Same, from the levels of the full merkle tree (see ComputeMerkleLevels) */
+    CPartialMerkleTree(const std::vector<std::vector<uint256>>& vLevels, const std::vector<bool>& vMatch);
+
     CPartialMerkleTree();
 
     /**
@@ -110,6 +113,20 @@ public:
 };
 
 
+/**
+ * The data of a block that the bloom filters are matched with, computed once
+ * for all the peers requesting the block filtered.
+ */
+struct CFilteredBlockData
+{
+    explicit CFilteredBlockData(const CBlock& block);
+
+    std::vector<CBloomTxElements> vTxElements;
+    std::vector<std::vector<uint256>> vMerkleLevels;
+
+    size_t DynamicMemoryUsage() const;
+};
+
 /**
  * Used to relay blocks as header + vector<merkle branch>
  * to filtered nodes.
@@ -136,6 +153,9 @@ public:
      */
     CMerkleBlock(const CBlock& block, CBloomFilter& filter) : CMerkleBlock(block, &filter, nullptr) { }
 
+    // Same, with the filtered block data of block
+    CMerkleBlock(const CBlock& block, CBloomFilter& filter, const CFilteredBlockData& data);
+
     // Create from a CBlock, matching the txids in the set
     CMerkleBlock(const CBlock& block, const std::set<uint256>& txids) : CMerkleBlock(block, nullptr, &txids) { }
 
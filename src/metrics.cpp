@@ -0,0 +1,236 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "metrics.h"
+
+#include "chain.h"
+#include "evo/deterministicmns.h"
+#include "httprpc.h"
+#include "httpserver.h"
+#include "init.h"
+#include "llmq/quorums_chainlocks.h"
+#include "rpc/protocol.h"
+#include "rpc/responsecache.h"
+#include "scheduler.h"
+#include "tinyformat.h"
+#include "txmempool.h"
+#include "validation.h"
+
+CMetrics g_metrics;
+
+constexpr std::array<int64_t, 14> CMetrics::HistogramBounds::VALUES;
+
+static std::string Seconds(int64_t nMicros)
+{
+    return strprintf("%.6f", nMicros * 0.000001);
+}
+
+static void WriteHeader(std::string& out, const std::string& name, const char* type, const char* help)
+{
+    out += strprintf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void WriteSample(std::string& out, const std::string& name, const std::string& labels, const std::string& value)
+{
+    out += labels.empty() ? strprintf("%s %s\n", name, value) : strprintf("%s{%s} %s\n", name, labels, value);
+}
+
+template <typename T>
+static void WriteMetric(std::string& out, const std::string& name, const char* type, const char* help, T value)
+{
+    WriteHeader(out, name, type, help);
+    WriteSample(out, name, "", strprintf("%d", value));
+}
+
+void CMetrics::WriteHistogram(std::string& out, const Histogram& h, const std::string& name, const std::string& labels)
+{
+    const auto& bounds = HistogramBounds::VALUES;
+    const std::string strPrefix = labels.empty() ? "" : labels + ",";
+    uint64_t nCumulated = 0;
+    for (size_t i = 0; i < bounds.size(); i++) {
+        nCumulated += h.vBuckets[i];
+        WriteSample(out, name + "_bucket", strPrefix + strprintf("le=\"%g\"", bounds[i] * 0.000001), strprintf("%d", nCumulated));
+    }
+    WriteSample(out, name + "_bucket", strPrefix + "le=\"+Inf\"", strprintf("%d", h.nCount));
+    WriteSample(out, name + "_sum", labels, Seconds(h.nTotalMicros));
+    WriteSample(out, name + "_count", labels, strprintf("%d", h.nCount));
+}
+
+void CMetrics::RecordRPCCall(const std::string& strMethod, int64_t nMicros, bool fError)
+{
+    LOCK(cs);
+    RPCStats& stats = mapRPCStats[strMethod];
+    stats.latency.Add(nMicros);
+    if (fError) stats.nErrors++;
+}
+
+void CMetrics::RecordBlockConnect(int64_t nMicros)
+{
+    LOCK(cs);
+    blockConnect.Add(nMicros);
+}
+
+std::string CMetrics::ToText() const
+{
+    std::string out;
+
+    // The stats recorded here, copied so that the other locks are not taken with cs held
+    std::map<std::string, RPCStats> rpcStats;
+    Histogram blockConnectCopy;
+    {
+        LOCK(cs);
+        rpcStats = mapRPCStats;
+        blockConnectCopy = blockConnect;
+    }
+
+    WriteHeader(out, "pivx_rpc_calls_total", "counter", "RPC calls, by method");
+    for (const auto& it : rpcStats) {
+        WriteSample(out, "pivx_rpc_calls_total", strprintf("method=\"%s\"", it.first), strprintf("%d", it.second.latency.nCount));
+    }
+    WriteHeader(out, "pivx_rpc_errors_total", "counter", "RPC calls which returned an error, by method");
+    for (const auto& it : rpcStats) {
+        WriteSample(out, "pivx_rpc_errors_total", strprintf("method=\"%s\"", it.first), strprintf("%d", it.second.nErrors));
+    }
+    WriteHeader(out, "pivx_rpc_duration_seconds", "histogram", "Execution time of the RPC calls, by method");
+    for (const auto& it : rpcStats) {
+        WriteHistogram(out, it.second.latency, "pivx_rpc_duration_seconds", strprintf("method=\"%s\"", it.first));
+    }
+
+    const RPCResponseCacheStats cacheStats = g_rpc_response_cache.GetStats();
+    WriteMetric(out, "pivx_rpc_cache_hits_total", "counter", "RPC calls answered from the cache", cacheStats.nHits);
+    WriteMetric(out, "pivx_rpc_cache_misses_total", "counter", "Cacheable RPC calls which were executed", cacheStats.nMisses);
+    WriteMetric(out, "pivx_rpc_cache_evictions_total", "counter", "RPC results evicted from the cache", cacheStats.nEvictions);
+    WriteMetric(out, "pivx_rpc_cache_entries", "gauge", "RPC results in the cache", cacheStats.nEntries);
+    WriteMetric(out, "pivx_rpc_cache_usage_bytes", "gauge", "Estimated memory usage of the RPC cache", cacheStats.nUsage);
+
+    // HTTP work queue, by priority class
+    static const char* const classNames[HTTP_PRIORITY_COUNT] = {"high", "normal", "low"};
+    const std::vector<HTTPQueueStats> vQueueStats = GetHTTPQueueStats();
+    const struct {
+        const char* name;
+        const char* type;
+        const char* help;
+        std::string (*value)(const HTTPQueueStats&);
+    } httpMetrics[] = {
+        {"pivx_http_queue_depth", "gauge", "HTTP requests waiting in the work queue", [](const HTTPQueueStats& s) { return strprintf("%d", s.nQueued); }},
+        {"pivx_http_requests_running", "gauge", "HTTP requests being handled", [](const HTTPQueueStats& s) { return strprintf("%d", s.nRunning); }},
+        {"pivx_http_requests_total", "counter", "HTTP requests dequeued from the work queue", [](const HTTPQueueStats& s) { return strprintf("%d", s.nHandled); }},
+        {"pivx_http_requests_rejected_total", "counter", "HTTP requests rejected as the work queue was full", [](const HTTPQueueStats& s) { return strprintf("%d", s.nRejected); }},
+        {"pivx_http_queue_wait_seconds_total", "counter", "Time spent by the HTTP requests in the work queue", [](const HTTPQueueStats& s) { return Seconds(s.nTotalWaitMicros); }},
+    };
+    for (const auto& metric : httpMetrics) {
+        WriteHeader(out, metric.name, metric.type, metric.help);
+        for (size_t i = 0; i < vQueueStats.size() && i < HTTP_PRIORITY_COUNT; i++) {
+            WriteSample(out, metric.name, strprintf("priority=\"%s\"", classNames[i]), metric.value(vQueueStats[i]));
+        }
+    }
+
+    // Scheduler lanes
+    const auto vLaneStats = GetSchedulerLaneStats();
+    const struct {
+        const char* name;
+        const char* type;
+        const char* help;
+        std::string (*value)(const CSchedulerStats&);
+    } schedulerMetrics[] = {
+        {"pivx_scheduler_tasks", "gauge", "Tasks scheduled", [](const CSchedulerStats& s) { return strprintf("%d", s.nTasks); }},
+        {"pivx_scheduler_tasks_overdue", "gauge", "Tasks due, waiting for the lane thread", [](const CSchedulerStats& s) { return strprintf("%d", s.nOverdue); }},
+        {"pivx_scheduler_max_delay_seconds", "gauge", "How late the most overdue task is", [](const CSchedulerStats& s) { return Seconds(s.nMaxDelayMicros); }},
+        {"pivx_scheduler_tasks_run_total", "counter", "Tasks run", [](const CSchedulerStats& s) { return strprintf("%d", s.nRun); }},
+        {"pivx_scheduler_delay_seconds_total", "counter", "Time the tasks run waited past their due time", [](const CSchedulerStats& s) { return Seconds(s.nTotalDelayMicros); }},
+    };
+    for (const auto& metric : schedulerMetrics) {
+        WriteHeader(out, metric.name, metric.type, metric.help);
+        for (const auto& lane : vLaneStats) {
+            WriteSample(out, metric.name, strprintf("lane=\"%s\"", lane.first), metric.value(lane.second));
+        }
+    }
+
+    // Lock contention, by lock, from the lock profiler
+    if (g_lock_profiler) {
+        std::map<std::string, LockTimeHistogram> mapLockWaits;
+        for (const LockSiteProfile& site : GetLockProfile(false)) {
+            mapLockWaits[site.strName].Add(site.wait);
+        }
+        WriteHeader(out, "pivx_lock_contentions_total", "counter", "Locks which had to wait");
+        for (const auto& it : mapLockWaits) {
+            WriteSample(out, "pivx_lock_contentions_total", strprintf("lock=\"%s\"", it.first), strprintf("%d", it.second.nCount));
+        }
+        WriteHeader(out, "pivx_lock_wait_seconds_total", "counter", "Time spent waiting for the locks");
+        for (const auto& it : mapLockWaits) {
+            WriteSample(out, "pivx_lock_wait_seconds_total", strprintf("lock=\"%s\"", it.first), Seconds(it.second.nTotalMicros));
+        }
+    }
+
+    WriteMetric(out, "pivx_mempool_transactions", "gauge", "Transactions in the mempool", mempool.size());
+    WriteMetric(out, "pivx_mempool_bytes", "gauge", "Serialized size of the transactions in the mempool", mempool.GetTotalTxSize());
+    WriteMetric(out, "pivx_mempool_usage_bytes", "gauge", "Memory usage of the mempool", mempool.DynamicMemoryUsage());
+
+    // Validation
+    int nHeight;
+    ValidationTimings timings;
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height();
+        timings = GetValidationTimings();
+    }
+    WriteMetric(out, "pivx_chain_height", "gauge", "Height of the active chain", nHeight);
+    WriteMetric(out, "pivx_blocks_connected_total", "counter", "Blocks connected to the tip", timings.nBlocksConnected);
+    const std::pair<const char*, int64_t> vSteps[] = {
+        {"read_from_disk", timings.nTimeReadFromDisk},
+        {"connect", timings.nTimeConnect},
+        {"verify", timings.nTimeVerify},
+        {"process_special", timings.nTimeProcessSpecial},
+        {"index", timings.nTimeIndex},
+        {"connect_total", timings.nTimeConnectTotal},
+        {"flush", timings.nTimeFlush},
+        {"chainstate", timings.nTimeChainState},
+        {"post_connect", timings.nTimePostConnect},
+        {"total", timings.nTimeTotal},
+    };
+    WriteHeader(out, "pivx_block_connect_step_seconds_total", "counter",
+                "Time spent in the steps of the block connections (verify includes connect, connect_total includes verify, process_special and index)");
+    for (const auto& step : vSteps) {
+        WriteSample(out, "pivx_block_connect_step_seconds_total", strprintf("step=\"%s\"", step.first), Seconds(step.second));
+    }
+    WriteHeader(out, "pivx_block_connect_duration_seconds", "histogram", "Time spent connecting a block to the tip");
+    WriteHistogram(out, blockConnectCopy, "pivx_block_connect_duration_seconds", "");
+
+    // Tier two
+    if (deterministicMNManager) {
+        const CDeterministicMNList mnList = deterministicMNManager->GetListAtChainTip();
+        WriteMetric(out, "pivx_dmn_count", "gauge", "Deterministic masternodes in the list of the tip", mnList.GetAllMNsCount());
+        WriteMetric(out, "pivx_dmn_valid_count", "gauge", "Deterministic masternodes not PoSe banned", mnList.GetValidMNsCount());
+    }
+    if (llmq::chainLocksHandler) {
+        WriteMetric(out, "pivx_chainlock_height", "gauge", "Height of the best chainlock, -1 if none", llmq::chainLocksHandler->GetBestChainLockHeight());
+    }
+
+    return out;
+}
+
+static void metrics_handler(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET requests are supported");
+        return;
+    }
+    std::string strAuthUser;
+    if (!CheckHTTPAuthorization(req, strAuthUser)) {
+        return;
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, g_metrics.ToText());
+}
+
+bool StartMetrics()
+{
+    RegisterHTTPHandler("/metrics", true, metrics_handler);
+    return true;
+}
+
+void StopMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_METRICS_H
+#define PIVX_METRICS_H
+
+#include "histogram.h"
+#include "sync.h"
+
+#include <array>
+#include <map>
+#include <string>
+
+//! -metrics default
+static const bool DEFAULT_METRICS_ENABLE = false;
+
+/**
+ * Metrics of the node for monitoring, served in the Prometheus text exposition format on the
+ * /metrics HTTP path (with -metrics), to the clients holding the RPC credentials. The call counts
+ * and latency histograms of the RPC methods, and the latency histogram of the block connections,
+ * are recorded here. The gauges and the counters of the other modules (HTTP work queue, scheduler
+ * lanes, lock contention with -lockprofiler, mempool, validation timings, deterministic masternodes
+ * and chainlocks) are read when the metrics are scraped.
+ * Only the methods of the RPC table are recorded, so that the clients can't grow the stats.
+ */
+class CMetrics
+{
+private:
+    struct HistogramBounds {
+        static constexpr std::array<int64_t, 14> VALUES{{500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+                                                          250000, 500000, 1000000, 2500000, 5000000, 10000000}};
+    };
+    typedef FixedHistogram<HistogramBounds> Histogram;
+
+    // Appends the cumulative _bucket, the _sum and the _count samples of a histogram, with the labels given
+    static void WriteHistogram(std::string& out, const Histogram& h, const std::string& name, const std::string& labels);
+
+    struct RPCStats {
+        uint64_t nErrors{0};
+        Histogram latency;
+    };
+
+    mutable Mutex cs;
+    std::map<std::string, RPCStats> mapRPCStats GUARDED_BY(cs);
+    Histogram blockConnect GUARDED_BY(cs);
+
+public:
+    void RecordRPCCall(const std::string& strMethod, int64_t nMicros, bool fError);
+    void RecordBlockConnect(int64_t nMicros);
+
+    // All the metrics, in the text exposition format
+    std::string ToText() const;
+};
+
+extern CMetrics g_metrics;
+
+/** Register the /metrics HTTP handler */
+bool StartMetrics();
+/** Unregister the /metrics HTTP handler */
+void StopMetrics();
+
+#endif // PIVX_METRICS_H
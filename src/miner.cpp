@@ -80,10 +80,15 @@ bool ProcessBlockFound(const std::shared_ptr<const CBlock>& pblock, CWallet& wal
     // Process this block the same as if we had received it from another node
     BlockStateCatcher sc(pblock->GetHash());
     sc.registerEvent();
-    bool res = ProcessNewBlock(pblock, nullptr);
+    bool res;
+    {
+        StakingStepTimer timer(pblock->IsProofOfStake() ? wallet.pStakerStatus : nullptr, StakingStep::PROCESS_BLOCK);
+        res = ProcessNewBlock(pblock, nullptr);
+    }
     if (!res || sc.stateErrorFound()) {
         return error("PIVXMiner : ProcessNewBlock, block not accepted");
     }
+    if (pblock->IsProofOfStake() && wallet.pStakerStatus) wallet.pStakerStatus->AddStakedBlock();
 
     g_connman->ForEachNode([&pblock](CNode* node)
     {
@@ -94,9 +99,9 @@ bool ProcessBlockFound(const std::shared_ptr<const CBlock>& pblock, CWallet& wal
 }
 
 bool fGenerateBitcoins = false;
-bool fStakeableCoins = false;
 
-void CheckForCoins(CWallet* pwallet, std::vector<CStakeableOutput>* availableCoins)
+// Update fStakeableCoins (and availableCoins) once per block. Each staking thread has its own.
+void CheckForCoins(CWallet* pwallet, std::vector<CStakeableOutput>* availableCoins, bool& fStakeableCoins)
 {
     if (!pwallet || !pwallet->pStakerStatus)
         return;
@@ -107,6 +112,7 @@ void CheckForCoins(CWallet* pwallet, std::vector<CStakeableOutput>* availableCoi
         if (g_best_block == pwallet->pStakerStatus->GetLastHash())
             return;
     }
+    StakingStepTimer timer(pwallet->pStakerStatus, StakingStep::STAKEABLE_COINS);
     fStakeableCoins = pwallet->StakeableCoins(availableCoins);
 }
 
@@ -123,8 +129,13 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
 
     // Available UTXO set
     std::vector<CStakeableOutput> availableCoins;
+    bool fStakeableCoins = false;
     unsigned int nExtraNonce = 0;
 
+    // PoS: mempool txs of the next block, selected while waiting for the next time slot
+    std::unique_ptr<CBlockTemplate> pStakeTemplate;
+    unsigned int nStakeTemplateTxUpdated = 0;
+
     while (fGenerateBitcoins || fProofOfStake) {
         CBlockIndex* pindexPrev = GetChainTip();
         if (!pindexPrev) {
@@ -139,23 +150,35 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
             }
 
             // update fStakeableCoins
-            CheckForCoins(pwallet, &availableCoins);
+            CheckForCoins(pwallet, &availableCoins, fStakeableCoins);
 
             while ((g_connman && g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 && Params().MiningRequiresPeers())
                     || pwallet->IsLocked() || !fStakeableCoins || masternodeSync.NotCompleted()) {
                 MilliSleep(5000);
                 // Do another check here to ensure fStakeableCoins is updated
-                if (!fStakeableCoins) CheckForCoins(pwallet, &availableCoins);
+                if (!fStakeableCoins) CheckForCoins(pwallet, &availableCoins, fStakeableCoins);
             }
 
             //search our map of hashed blocks, see if bestblock has been hashed yet
             if (pwallet->pStakerStatus &&
                     pwallet->pStakerStatus->GetLastHash() == pindexPrev->GetBlockHash() &&
                     pwallet->pStakerStatus->GetLastTime() >= GetCurrentTimeSlot()) {
+                // refresh the template with the new mempool txs meanwhile
+                if (pStakeTemplate && mempool.GetTransactionsUpdated() != nStakeTemplateTxUpdated) {
+                    StakingStepTimer timer(pwallet->pStakerStatus, StakingStep::BLOCK_TEMPLATE);
+                    nStakeTemplateTxUpdated = mempool.GetTransactionsUpdated();
+                    pStakeTemplate = BlockAssembler(Params(), DEFAULT_PRINTPRIORITY).UpdateStakeTemplate(std::move(pStakeTemplate), pindexPrev);
+                }
                 MilliSleep(2000);
                 continue;
             }
 
+            if (!pStakeTemplate || pStakeTemplate->block.hashPrevBlock != pindexPrev->GetBlockHash()) {
+                StakingStepTimer timer(pwallet->pStakerStatus, StakingStep::BLOCK_TEMPLATE);
+                nStakeTemplateTxUpdated = mempool.GetTransactionsUpdated();
+                pStakeTemplate = BlockAssembler(Params(), DEFAULT_PRINTPRIORITY).CreateStakeTemplate(pindexPrev);
+            }
+
         } else if (pindexPrev->nHeight > 6 && consensus.NetworkUpgradeActive(pindexPrev->nHeight - 6, Consensus::UPGRADE_POS)) {
             // Late PoW: run for a little while longer, just in case there is a rewind on the chain.
             LogPrintf("%s: Exiting PoW Mining Thread at height: %d\n", __func__, pindexPrev->nHeight);
@@ -168,7 +191,7 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
         unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
 
         std::unique_ptr<CBlockTemplate> pblocktemplate((fProofOfStake ?
-                                                        BlockAssembler(Params(), DEFAULT_PRINTPRIORITY).CreateNewBlock(CScript(), pwallet, true, &availableCoins) :
+                                                        BlockAssembler(Params(), DEFAULT_PRINTPRIORITY).CreateNewStakeBlock(*pStakeTemplate, pwallet, &availableCoins) :
                                                         CreateNewBlockWithKey(pReservekey, pwallet)));
         if (!pblocktemplate) continue;
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(pblocktemplate->block);
@@ -301,11 +324,10 @@ void GenerateBitcoins(bool fGenerate, CWallet* pwallet, int nThreads)
         minerThreads->create_thread(std::bind(&ThreadBitcoinMiner, pwallet));
 }
 
-void ThreadStakeMinter()
+void ThreadStakeMinter(CWallet* pwallet)
 {
     boost::this_thread::interruption_point();
-    LogPrintf("ThreadStakeMinter started. Using wallet-0\n");
-    CWallet* pwallet = vpwallets[0];
+    LogPrintf("ThreadStakeMinter started. Using wallet %s\n", pwallet->GetName());
     try {
         BitcoinMiner(pwallet, true);
         boost::this_thread::interruption_point();
@@ -31,7 +31,8 @@ static const bool DEFAULT_PRINTPRIORITY = false;
     std::unique_ptr<CBlockTemplate> CreateNewBlockWithScript(const CScript& coinbaseScript, CWallet* pwallet);
 
     void BitcoinMiner(CWallet* pwallet, bool fProofOfStake);
-    void ThreadStakeMinter();
+    /** Stake with pwallet (one thread per wallet) */
+    void ThreadStakeMinter(CWallet* pwallet);
 #endif // ENABLE_WALLET
 
 extern double dHashesPerSec;
@@ -18,17 +18,22 @@
 #include "guiinterface.h"
 #include "netaddress.h"
 #include "netbase.h"
+#include "netbuffers.h"
+#include "netmsgstats.h"
 #include "netmessagemaker.h"
 #include "optional.h"
 #include "primitives/transaction.h"
 #include "scheduler.h"
 #include "tiertwo/net_masternodes.h"
+#include "txrequest.h"
+#include "txreconciliation.h"
 #include "validation.h"
 
 #ifdef WIN32
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
 #if HAVE_DECL_GETIFADDRS && HAVE_DECL_FREEIFADDRS
@@ -39,7 +44,14 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 #include <cstdint>
+#include <future>
 #include <unordered_map>
 
 #include <math.h>
@@ -77,7 +89,13 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
-const static std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
+#ifdef USE_EPOLL
+// Maximum number of events collected by a single epoll_wait call
+static const int MAX_EPOLL_EVENTS = 512;
+#endif
+
+// The received message data is allocated up to this size ahead of the bytes received
+static const unsigned int RECV_DATA_AHEAD = 256 * 1024;
 
 constexpr const CConnman::CFullyConnectedOnly CConnman::FullyConnectedOnly;
 constexpr const CConnman::CAllNodes CConnman::AllNodes;
@@ -94,8 +112,6 @@ std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 static bool vfLimited[NET_MAX] = {};
 std::string strSubVersion;
 
-limitedmap<CInv, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
-
 void CConnman::AddOneShot(const std::string& strDest)
 {
     LOCK(cs_vOneShots);
@@ -799,6 +815,27 @@ int CNode::GetSendVersion() const
     return nSendVersion;
 }
 
+CNetMessage::CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn)
+{
+    CSerializeData buf = CNetBufferPool::Instance().Get(CMessageHeader::HEADER_SIZE);
+    hdrbuf.SwapData(buf);
+    hdrbuf.resize(24);
+    in_data = false;
+    nHdrPos = 0;
+    nDataPos = 0;
+    nTime = 0;
+}
+
+CNetMessage::~CNetMessage()
+{
+    CSerializeData buf;
+    hdrbuf.SwapData(buf);
+    CNetBufferPool::Instance().Put(std::move(buf));
+    CSerializeData data;
+    vRecv.SwapData(data);
+    CNetBufferPool::Instance().Put(std::move(data));
+}
+
 int CNetMessage::readHeader(const char* pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -823,7 +860,9 @@ int CNetMessage::readHeader(const char* pch, unsigned int nBytes)
     if (hdr.nMessageSize > MAX_SIZE)
         return -1;
 
-    // switch state to reading message data
+    // switch state to reading message data, into a recycled buffer
+    CSerializeData data = CNetBufferPool::Instance().Get(std::min(hdr.nMessageSize, RECV_DATA_AHEAD));
+    vRecv.SwapData(data);
     in_data = true;
 
     return nCopy;
@@ -836,7 +875,7 @@ int CNetMessage::readData(const char* pch, unsigned int nBytes)
 
     if (vRecv.size() < nDataPos + nCopy) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + RECV_DATA_AHEAD));
     }
 
     hasher.Write((const unsigned char*)pch, nCopy);
@@ -854,6 +893,23 @@ const uint256& CNetMessage::GetMessageHash() const
     return data_hash;
 }
 
+// Maximum number of buffers of vSendMsg written by a single send call
+static const size_t MAX_SEND_BUFFERS = 64;
+
+static bool HeaderHasPayload(const std::vector<unsigned char>& header)
+{
+    return ReadLE32(header.data() + CMessageHeader::MESSAGE_SIZE_OFFSET) != 0;
+}
+
+// requires LOCK(cs_vSend)
+// Index of the first message boundary of vSendMsg, after the message whose sending started
+static size_t FirstSendBoundary(const CNode* pnode)
+{
+    if (pnode->fSendPayloadFirst) return 1;
+    if (pnode->nSendOffset == 0) return 0;
+    return HeaderHasPayload(*pnode->vSendMsg.front()) ? 2 : 1;
+}
+
 // requires LOCK(cs_vSend)
 size_t CConnman::SocketSendData(CNode* pnode)
 {
@@ -861,27 +917,57 @@ size_t CConnman::SocketSendData(CNode* pnode)
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto& data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert((*it)->size() > pnode->nSendOffset);
+        // Gather the queued buffers, so that the headers and the payloads go in the same call
+        size_t nToSend = 0;
         int nBytes = 0;
+#ifndef WIN32
+        struct iovec iov[MAX_SEND_BUFFERS];
+        size_t nBuffers = 0;
+        for (auto itBuf = it; itBuf != pnode->vSendMsg.end() && nBuffers < MAX_SEND_BUFFERS; ++itBuf, ++nBuffers) {
+            const size_t nOffset = (itBuf == it) ? pnode->nSendOffset : 0;
+            iov[nBuffers].iov_base = const_cast<unsigned char*>((*itBuf)->data()) + nOffset;
+            iov[nBuffers].iov_len = (*itBuf)->size() - nOffset;
+            nToSend += iov[nBuffers].iov_len;
+        }
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = nBuffers;
+#else
+        nToSend = (*it)->size() - pnode->nSendOffset;
+#endif
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifndef WIN32
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>((*it)->data()) + pnode->nSendOffset, nToSend, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // Pop the buffers sent in full
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                const size_t nBufferLeft = (*it)->size() - pnode->nSendOffset;
+                if (nLeft < nBufferLeft) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nBufferLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= (*it)->size();
+                pnode->fSendPayloadFirst = !pnode->fSendPayloadFirst && HeaderHasPayload(**it);
+                if (pnode->nSendPriorityEnd) pnode->nSendPriorityEnd--;
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nToSend) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -1148,6 +1234,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    RegisterSocketEvents(hSocket, false);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -1415,10 +1502,136 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
+void CConnman::RegisterSocketEvents(SOCKET hSocket, bool fListen)
+{
+#ifdef USE_EPOLL
+    if (epollfd == -1 || hSocket == INVALID_SOCKET) {
+        return;
+    }
+    struct epoll_event event;
+    event.data.fd = hSocket;
+    // Listening sockets are level-triggered, as only one connection is accepted per iteration.
+    // The registration is removed by the kernel when the socket is closed.
+    event.events = fListen ? EPOLLIN : (EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &event) != 0) {
+        LogPrintf("%s: epoll_ctl failed for socket %d: %s\n", __func__, hSocket, NetworkErrorString(WSAGetLastError()));
+    }
+#endif
+}
+
+void CConnman::WakeSelect()
+{
+#ifdef USE_EPOLL
+    if (wakeupfd == -1) {
+        return;
+    }
+    uint64_t n = 1;
+    if (write(wakeupfd, &n, sizeof(n)) != sizeof(n)) {
+        // the counter is already set, the socket handler will wake up anyway
+    }
+#endif
+}
+
+#ifdef USE_EPOLL
+bool CConnman::GenerateEpollSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set)
+{
+    LOCK(cs_vNodes);
+    for (CNode* pnode : vNodes) {
+        // Same logic as GenerateSelectSet, restricted to the sockets which are ready
+        bool select_recv = !pnode->fPauseRecv;
+        bool select_send;
+        {
+            LOCK(pnode->cs_vSend);
+            select_send = !pnode->vSendMsg.empty();
+        }
+
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            continue;
+
+        if (select_send) {
+            if (setEpollSendable.count(pnode->hSocket)) {
+                send_set.insert(pnode->hSocket);
+            }
+            continue;
+        }
+        if (select_recv && setEpollReceivable.count(pnode->hSocket)) {
+            recv_set.insert(pnode->hSocket);
+        }
+    }
+    return !recv_set.empty() || !send_set.empty();
+}
+
+void CConnman::SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    // Sockets still ready from earlier events are served without waiting for new ones
+    std::set<SOCKET> recv_ready, send_ready;
+    bool fReady = GenerateEpollSet(recv_ready, send_ready);
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int nEvents = epoll_wait(epollfd, events, MAX_EPOLL_EVENTS, fReady ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        if (WSAGetLastError() != WSAEINTR) {
+            LogPrintf("socket epoll error %s\n", NetworkErrorString(WSAGetLastError()));
+        }
+        nEvents = 0;
+    }
+
+    bool fNodeEvents = false;
+    for (int i = 0; i < nEvents; i++) {
+        const uint32_t flags = events[i].events;
+        if (events[i].data.fd == wakeupfd) {
+            uint64_t n;
+            if (read(wakeupfd, &n, sizeof(n)) != sizeof(n)) {
+                // nothing to reset
+            }
+            continue;
+        }
+
+        const SOCKET hSocket = (SOCKET)events[i].data.fd;
+        bool fListenSocket = false;
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (hListenSocket.socket == hSocket) {
+                fListenSocket = true;
+                break;
+            }
+        }
+        if (fListenSocket) {
+            recv_set.insert(hSocket);
+            continue;
+        }
+
+        fNodeEvents = true;
+        if (flags & (EPOLLERR | EPOLLHUP)) error_set.insert(hSocket);
+        if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) setEpollReceivable.insert(hSocket);
+        if (flags & EPOLLOUT) setEpollSendable.insert(hSocket);
+    }
+
+    if (fNodeEvents) {
+        recv_ready.clear();
+        send_ready.clear();
+        GenerateEpollSet(recv_ready, send_ready);
+    }
+    recv_set.insert(recv_ready.begin(), recv_ready.end());
+    send_set.insert(send_ready.begin(), send_ready.end());
+}
+#endif
+
 void CConnman::SocketHandler()
 {
     std::set<SOCKET> recv_set, send_set, error_set;
+#ifdef USE_EPOLL
+    if (epollfd != -1) {
+        SocketEventsEpoll(recv_set, send_set, error_set);
+    } else {
+        SocketEvents(recv_set, send_set, error_set);
+    }
+#else
     SocketEvents(recv_set, send_set, error_set);
+#endif
 
     if (interruptNet) return;
 
@@ -1441,6 +1654,10 @@ void CConnman::SocketHandler()
         for (CNode* pnode : vNodesCopy)
             pnode->AddRef();
     }
+    // The quorum connections first, so that their messages don't wait behind the block and tx relay
+    std::stable_partition(vNodesCopy.begin(), vNodesCopy.end(), [](const CNode* pnode) {
+        return pnode->m_masternode_connection.load();
+    });
     for (CNode* pnode : vNodesCopy) {
         if (interruptNet)
             return;
@@ -1451,10 +1668,16 @@ void CConnman::SocketHandler()
         bool recvSet = false;
         bool sendSet = false;
         bool errorSet = false;
+#ifdef USE_EPOLL
+        SOCKET hSocket;
+#endif
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
+#ifdef USE_EPOLL
+            hSocket = pnode->hSocket;
+#endif
             recvSet = recv_set.count(pnode->hSocket) > 0;
             sendSet = send_set.count(pnode->hSocket) > 0;
             errorSet = error_set.count(pnode->hSocket) > 0;
@@ -1495,6 +1718,10 @@ void CConnman::SocketHandler()
                 if (!pnode->fDisconnect)
                     LogPrint(BCLog::NET, "socket closed\n");
                 pnode->CloseSocketDisconnect();
+#ifdef USE_EPOLL
+                setEpollReceivable.erase(hSocket);
+                setEpollSendable.erase(hSocket);
+#endif
             } else if (nBytes < 0) {
                 // error
                 int nErr = WSAGetLastError();
@@ -1503,6 +1730,10 @@ void CConnman::SocketHandler()
                         LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
                     pnode->CloseSocketDisconnect();
                 }
+#ifdef USE_EPOLL
+                // drained, the next event tells when there is more to receive
+                if (nErr == WSAEWOULDBLOCK) setEpollReceivable.erase(hSocket);
+#endif
             }
         }
 
@@ -1514,6 +1745,10 @@ void CConnman::SocketHandler()
             size_t nBytes = SocketSendData(pnode);
             if (nBytes)
                 RecordBytesSent(nBytes);
+#ifdef USE_EPOLL
+            // the send buffer of the socket is full, the next event tells when it can take more
+            if (!pnode->vSendMsg.empty()) setEpollSendable.erase(hSocket);
+#endif
         }
 
         InactivityCheck(pnode);
@@ -1556,8 +1791,35 @@ static std::string GetDNSHost(const CDNSSeedData& data, ServiceFlags* requiredSe
 }
 
 
+void CConnman::ThreadLoadAddresses()
+{
+    int64_t nStart = GetTimeMillis();
+    CAddrDB adb;
+    const bool fRead = adb.Read(addrman);
+    if (fRead) {
+        LogPrintf("Loaded %i addresses from peers.dat  %dms\n", addrman.size(), GetTimeMillis() - nStart);
+    } else {
+        addrman.Clear(); // Addrman can be in an inconsistent state after failure, reset it
+        LogPrintf("Invalid or missing peers.dat; recreating\n");
+    }
+    fAddressesLoaded = true;
+    if (!fRead) DumpAddresses();
+}
+
+bool CConnman::WaitAddressesLoaded()
+{
+    while (!fAddressesLoaded) {
+        if (!interruptNet.sleep_for(std::chrono::milliseconds(100)))
+            return false;
+    }
+    return true;
+}
+
 void CConnman::ThreadDNSAddressSeed()
 {
+    if (!WaitAddressesLoaded())
+        return;
+
     // goal: only query DNS seeds if address need is acute
     if ((addrman.size() > 0) &&
         (!gArgs.GetBoolArg("-forcednsseed", DEFAULT_FORCEDNSSEED))) {
@@ -1580,32 +1842,46 @@ void CConnman::ThreadDNSAddressSeed()
 
     LogPrintf("Loading addresses from DNS seeds (could take a while)\n");
 
+    // The seeds are resolved in parallel, the slowest one doesn't delay the others
+    struct SeedLookup {
+        CNetAddr resolveSource;
+        ServiceFlags requiredServiceBits;
+        std::future<std::vector<CNetAddr>> vIPs;
+    };
+    std::vector<SeedLookup> lookups;
     for (const CDNSSeedData& seed : vSeeds) {
+        if (HaveNameProxy()) {
+            AddOneShot(seed.host);
+            continue;
+        }
+        ServiceFlags requiredServiceBits = nRelevantServices;
+        std::string host = GetDNSHost(seed, &requiredServiceBits);
+        CNetAddr resolveSource;
+        if (!resolveSource.SetInternal(host)) {
+            continue;
+        }
+        auto vIPs = std::async(std::launch::async, [host]() {
+            std::vector<CNetAddr> ret;
+            LookupHost(host, ret, 0, true);
+            return ret;
+        });
+        lookups.push_back({resolveSource, requiredServiceBits, std::move(vIPs)});
+    }
+
+    for (SeedLookup& lookup : lookups) {
+        std::vector<CNetAddr> vIPs = lookup.vIPs.get();
         if (interruptNet) {
             return;
         }
-        if (HaveNameProxy()) {
-            AddOneShot(seed.host);
-        } else {
-            std::vector<CNetAddr> vIPs;
-            std::vector<CAddress> vAdd;
-            ServiceFlags requiredServiceBits = nRelevantServices;
-            std::string host = GetDNSHost(seed, &requiredServiceBits);
-            CNetAddr resolveSource;
-            if (!resolveSource.SetInternal(host)) {
-                continue;
-            }
-            if (LookupHost(host, vIPs, 0, true)) {
-                for (CNetAddr& ip : vIPs) {
-                    int nOneDay = 24*3600;
-                    CAddress addr = CAddress(CService(ip, Params().GetDefaultPort()), requiredServiceBits);
-                    addr.nTime = GetTime() - 3 * nOneDay - GetRand(4 * nOneDay); // use a random age between 3 and 7 days old
-                    vAdd.push_back(addr);
-                    found++;
-                }
-                addrman.Add(vAdd, resolveSource);
-            }
+        std::vector<CAddress> vAdd;
+        for (CNetAddr& ip : vIPs) {
+            int nOneDay = 24*3600;
+            CAddress addr = CAddress(CService(ip, Params().GetDefaultPort()), lookup.requiredServiceBits);
+            addr.nTime = GetTime() - 3 * nOneDay - GetRand(4 * nOneDay); // use a random age between 3 and 7 days old
+            vAdd.push_back(addr);
+            found++;
         }
+        if (!vAdd.empty()) addrman.Add(vAdd, lookup.resolveSource);
     }
 
     LogPrintf("%d addresses found from DNS seeds\n", found);
@@ -1624,6 +1900,8 @@ void CConnman::ThreadDNSAddressSeed()
 
 void CConnman::DumpAddresses()
 {
+    // Not to overwrite peers.dat with the addresses received while it loads
+    if (!fAddressesLoaded) return;
     int64_t nStart = GetTimeMillis();
 
     CAddrDB adb;
@@ -1675,11 +1953,18 @@ void CConnman::ThreadOpenConnections(const std::vector<std::string> connect)
         }
     }
 
+    if (!WaitAddressesLoaded())
+        return;
+
     // Initiate network connections
     int64_t nStart = GetTime();
 
     // Minimum time before next feeler connection (in microseconds).
     int64_t nNextFeeler = PoissonNextSend(nStart * 1000 * 1000, FEELER_INTERVAL);
+    // The connection attempts in flight, with the network group of their address. They hold their
+    // outbound grant, so there are at most as many as the outbound and feeler slots.
+    // They are waited for when leaving.
+    std::list<std::pair<std::vector<unsigned char>, std::future<void>>> attempts;
     while (!interruptNet) {
         ProcessOneShot();
 
@@ -1690,6 +1975,15 @@ void CConnman::ThreadOpenConnections(const std::vector<std::string> connect)
         if (interruptNet)
             return;
 
+        for (auto it = attempts.begin(); it != attempts.end(); ) {
+            if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                it->second.get();
+                it = attempts.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
         // Add seed nodes if DNS seeds are all down (an infrastructure attack?).
         if (addrman.size() == 0 && (GetTime() - nStart > 60)) {
             static bool done = false;
@@ -1725,6 +2019,11 @@ void CConnman::ThreadOpenConnections(const std::vector<std::string> connect)
                 }
             }
         }
+        // The attempts in flight take their slot and network group already
+        for (const auto& attempt : attempts) {
+            setConnected.insert(attempt.first);
+            nOutbound++;
+        }
 
         // Feeler Connections
         //
@@ -1806,7 +2105,13 @@ void CConnman::ThreadOpenConnections(const std::vector<std::string> connect)
                 LogPrint(BCLog::NET, "Making feeler connection to %s\n", addrConnect.ToString());
             }
 
-            OpenNetworkConnection(addrConnect, (int)setConnected.size() >= std::min(nMaxConnections - 1, 2), &grant, nullptr, false, fFeeler);
+            // Connect in the background, so that the other slots are filled meanwhile
+            const bool fCountFailure = (int)setConnected.size() >= std::min(nMaxConnections - 1, 2);
+            auto pgrant = std::make_shared<CSemaphoreGrant>();
+            grant.MoveTo(*pgrant);
+            attempts.emplace_back(addrConnect.GetGroup(addrman.m_asmap), std::async(std::launch::async, [=]() {
+                OpenNetworkConnection(addrConnect, fCountFailure, pgrant.get(), nullptr, false, fFeeler);
+            }));
         }
     }
 }
@@ -1936,14 +2241,67 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->m_masternode_probe_connection = true;
 
     m_msgproc->InitializeNode(pnode);
+    WITH_LOCK(pnode->cs_hSocket, RegisterSocketEvents(pnode->hSocket, false); );
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
 }
 
+void CConnman::PushAsyncMessage(CNode* pnode, const std::string& strCommand, CDataStream&& vRecv, int64_t nTimeReceived)
+{
+    assert(!vAsyncMessageWorkers.empty());
+    const size_t nSize = vRecv.size() + CMessageHeader::HEADER_SIZE;
+    {
+        LOCK(pnode->cs_vProcessMsg);
+        pnode->nProcessQueueSize += nSize;
+        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+    }
+    AsyncMessageWorker& worker = *vAsyncMessageWorkers[pnode->GetId() % vAsyncMessageWorkers.size()];
+    {
+        LOCK(worker.cs);
+        worker.queue.push_back({pnode->AddRef(), strCommand, std::move(vRecv), nSize, nTimeReceived});
+    }
+    worker.cv.notify_one();
+}
+
+void CConnman::ThreadAsyncMessageHandler(AsyncMessageWorker& worker)
+{
+    std::deque<AsyncMessage> msgs;
+    while (!flagInterruptMsgProc) {
+        {
+            WAIT_LOCK(worker.cs, lock);
+            worker.cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(worker.cs) {
+                return !worker.queue.empty() || flagInterruptMsgProc;
+            });
+            msgs.swap(worker.queue);
+        }
+
+        for (AsyncMessage& msg : msgs) {
+            CNode* pnode = msg.pnode;
+            if (!pnode->fDisconnect && !flagInterruptMsgProc) {
+                const int64_t nTimeStart = GetTimeMicros();
+                m_msgproc->ProcessAsyncMessage(pnode, msg.strCommand, msg.vRecv);
+                m_msgstats->Record(msg.strCommand, msg.nSize, nTimeStart - msg.nTimeReceived, GetTimeMicros() - nTimeStart);
+            }
+            bool fUnpaused;
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->nProcessQueueSize -= msg.nSize;
+                bool fWasPaused = pnode->fPauseRecv;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+                fUnpaused = fWasPaused && !pnode->fPauseRecv;
+            }
+            if (fUnpaused) WakeSelect();
+            pnode->Release();
+        }
+        msgs.clear();
+    }
+}
+
 void CConnman::ThreadMessageHandler()
 {
+    ApplyValidationThreadAffinity();
     int64_t nLastSendMessagesTimeMasternodes = 0;
 
     while (!flagInterruptMsgProc) {
@@ -2137,6 +2495,9 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     Init(connOptions);
     // init tier two connections manager
     m_tiertwo_conn_man = std::make_unique<TierTwoConnMan>(this);
+    m_txrequest = std::make_unique<TxRequestTracker>();
+    m_txreconciliation = std::make_unique<TxReconciliationTracker>();
+    m_msgstats = std::make_unique<CNetMsgStats>();
 }
 
 NodeId CConnman::GetNewNodeId()
@@ -2174,7 +2535,7 @@ bool CConnman::InitBinds(const std::vector<CService>& binds, const std::vector<C
     return fBound;
 }
 
-bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
+bool CConnman::Start(CScheduler& schedulerIO, CScheduler& schedulerTierTwo, const Options& connOptions)
 {
     Init(connOptions);
 
@@ -2196,29 +2557,41 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollfd != -1) {
+        wakeupfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        struct epoll_event event;
+        event.data.fd = wakeupfd;
+        event.events = EPOLLIN;
+        if (wakeupfd == -1 || epoll_ctl(epollfd, EPOLL_CTL_ADD, wakeupfd, &event) != 0) {
+            close(epollfd);
+            epollfd = -1;
+        }
+    }
+    if (epollfd == -1) {
+        LogPrintf("Failed to initialize epoll (%s), using poll\n", NetworkErrorString(WSAGetLastError()));
+        if (wakeupfd != -1) close(wakeupfd);
+        wakeupfd = -1;
+    }
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        RegisterSocketEvents(hListenSocket.socket, true);
+    }
+#endif
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
 
-    if (clientInterface)
-        clientInterface->InitMessage(_("Loading addresses..."));
     m_msgproc = connOptions.m_msgproc;
-    // Load addresses from peers.dat
-    int64_t nStart = GetTimeMillis();
-    {
-        CAddrDB adb;
-        if (adb.Read(addrman))
-            LogPrintf("Loaded %i addresses from peers.dat  %dms\n", addrman.size(), GetTimeMillis() - nStart);
-        else {
-            addrman.Clear(); // Addrman can be in an inconsistent state after failure, reset it
-            LogPrintf("Invalid or missing peers.dat; recreating\n");
-            DumpAddresses();
-        }
-    }
+    // Load addresses from peers.dat, without delaying the startup
+    fAddressesLoaded = false;
+    threadLoadAddresses = std::thread(&TraceThread<std::function<void()> >, "loadaddr", std::function<void()>(std::bind(&CConnman::ThreadLoadAddresses, this)));
+
     if (clientInterface)
         clientInterface->InitMessage(_("Loading banlist..."));
     // Load addresses from banlist.dat
-    nStart = GetTimeMillis();
+    int64_t nStart = GetTimeMillis();
     CBanDB bandb;
     banmap_t banmap;
     if (bandb.Read(banmap)) {
@@ -2277,7 +2650,7 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     if (m_tiertwo_conn_man) {
         TierTwoConnMan::Options opts;
         opts.m_has_specified_outgoing = !connOptions.m_specified_outgoing.empty();
-        m_tiertwo_conn_man->start(scheduler, opts);
+        m_tiertwo_conn_man->start(schedulerTierTwo, opts);
     }
 
     if (connOptions.m_use_addrman_outgoing && !connOptions.m_specified_outgoing.empty()) {
@@ -2294,10 +2667,17 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     }
 
     // Process messages
+    for (int i = 0; i < nAsyncMessageThreads; i++) {
+        vAsyncMessageWorkers.emplace_back(std::make_unique<AsyncMessageWorker>());
+    }
+    for (size_t i = 0; i < vAsyncMessageWorkers.size(); i++) {
+        AsyncMessageWorker& worker = *vAsyncMessageWorkers[i];
+        worker.thread = std::thread(&TraceThread<std::function<void()> >, strprintf("asyncmsg.%d", i), std::function<void()>(std::bind(&CConnman::ThreadAsyncMessageHandler, this, std::ref(worker))));
+    }
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
 
     // Dump network addresses
-    scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
+    schedulerIO.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
 
     return true;
 }
@@ -2332,8 +2712,14 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    for (auto& worker : vAsyncMessageWorkers) {
+        // Taken so that a worker can't miss the interrupt between its check and its wait
+        { LOCK(worker->cs); }
+        worker->cv.notify_all();
+    }
 
     interruptNet();
+    WakeSelect();
     if (m_tiertwo_conn_man) m_tiertwo_conn_man->interrupt();
     InterruptSocks5(true);
 
@@ -2354,6 +2740,15 @@ void CConnman::Stop()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (auto& worker : vAsyncMessageWorkers) {
+        if (worker->thread.joinable())
+            worker->thread.join();
+        // Release the nodes of the messages left in the queue, they are deleted below
+        for (AsyncMessage& msg : WITH_LOCK(worker->cs, return std::move(worker->queue); )) {
+            msg.pnode->Release();
+        }
+    }
+    vAsyncMessageWorkers.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2364,11 +2759,15 @@ void CConnman::Stop()
         threadSocketHandler.join();
     // Stop tier two connection manager
     if (m_tiertwo_conn_man) m_tiertwo_conn_man->stop();
+    // peers.dat is dumped below once loaded
+    if (threadLoadAddresses.joinable())
+        threadLoadAddresses.join();
 
     if (fAddressesInitialized)
     {
         DumpData();
         fAddressesInitialized = false;
+        fAddressesLoaded = false;
     }
 
     // Close sockets
@@ -2391,6 +2790,14 @@ void CConnman::Stop()
     vhListenSocket.clear();
     semOutbound.reset();
     semAddnode.reset();
+
+#ifdef USE_EPOLL
+    if (epollfd != -1) close(epollfd);
+    if (wakeupfd != -1) close(wakeupfd);
+    epollfd = wakeupfd = -1;
+    setEpollReceivable.clear();
+    setEpollSendable.clear();
+#endif
 }
 
 void CConnman::DeleteNode(CNode* pnode)
@@ -2531,12 +2938,7 @@ void CConnman::RelayInv(CInv& inv)
 
 void CConnman::RemoveAskFor(const uint256& invHash, int invType)
 {
-    mapAlreadyAskedFor.erase(CInv(invType, invHash));
-
-    LOCK(cs_vNodes);
-    for (const auto& pnode : vNodes) {
-        pnode->AskForInvReceived(invHash);
-    }
+    m_txrequest->ForgetInv(CInv(invType, invHash));
 }
 
 void CConnman::UpdateQuorumRelayMemberIfNeeded(CNode* pnode)
@@ -2625,6 +3027,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
+    nSendPriorityEnd = 0;
+    fSendPayloadFirst = false;
     hashContinue = UINT256_ZERO;
     nStartingHeight = -1;
     filterInventoryKnown.reset();
@@ -2657,63 +3061,14 @@ CNode::~CNode()
     CloseSocket(hSocket);
 }
 
-void CNode::AskFor(const CInv& inv, int64_t doubleRequestDelay)
-{
-    if (mapAskFor.size() > MAPASKFOR_MAX_SZ || setAskFor.size() > SETASKFOR_MAX_SZ)
-        return;
-    // a peer may not have multiple non-responded queue positions for a single inv item
-    if (!setAskFor.insert(inv.hash).second)
-        return;
-
-    // We're using mapAskFor as a priority queue,
-    // the key is the earliest time the request can be sent
-    int64_t nRequestTime;
-    limitedmap<CInv, int64_t>::const_iterator it = mapAlreadyAskedFor.find(inv);
-    if (it != mapAlreadyAskedFor.end())
-        nRequestTime = it->second;
-    else
-        nRequestTime = 0;
-    LogPrint(BCLog::NET, "askfor %s  %d (%s) peer=%d\n", inv.ToString(), nRequestTime, FormatISO8601Time(nRequestTime / 1000000), id);
-
-    // Make sure not to reuse time indexes to keep things in the same order
-    int64_t nNow = GetTimeMicros() - 1000000;
-    static int64_t nLastTime;
-    ++nLastTime;
-    nNow = std::max(nNow, nLastTime);
-    nLastTime = nNow;
-
-    // Each retry is 2 minutes after the last
-    nRequestTime = std::max(nRequestTime + doubleRequestDelay, nNow);
-    if (it != mapAlreadyAskedFor.end())
-        mapAlreadyAskedFor.update(it, nRequestTime);
-    else
-        mapAlreadyAskedFor.insert(std::make_pair(inv, nRequestTime));
-    mapAskFor.insert(std::make_pair(nRequestTime, inv));
-}
-
-void CNode::AskForInvReceived(const uint256& invHash)
-{
-    setAskFor.erase(invHash);
-    for (auto it = mapAskFor.begin(); it != mapAskFor.end();) {
-        if (it->second.hash == invHash) {
-            it = mapAskFor.erase(it);
-        } else {
-            ++it;
-        }
-    }
-}
-
 bool CConnman::NodeFullyConnected(const CNode* pnode)
 {
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+CSharedNetMsg CConnman::ShareMessage(CSerializedNetMsg&& msg) const
 {
-    size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
-
+    const size_t nMessageSize = msg.data.size();
     std::vector<unsigned char> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
     uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
@@ -2722,6 +3077,24 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
 
+    CSharedNetMsg shared;
+    shared.header = std::make_shared<const std::vector<unsigned char>>(std::move(serializedHeader));
+    shared.data = std::make_shared<const std::vector<unsigned char>>(std::move(msg.data));
+    shared.command = std::move(msg.command);
+    return shared;
+}
+
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+{
+    PushMessage(pnode, ShareMessage(std::move(msg)));
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSharedNetMsg& msg)
+{
+    size_t nMessageSize = msg.data->size();
+    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
+
     size_t nBytesSent = 0;
     {
         LOCK(pnode->cs_vSend);
@@ -2733,9 +3106,18 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        if (IsQuorumNetMessageType(msg.command)) {
+            // Ahead of the other messages, but not of the priority ones queued before
+            auto itPos = pnode->vSendMsg.begin() + std::max(pnode->nSendPriorityEnd, FirstSendBoundary(pnode));
+            itPos = pnode->vSendMsg.insert(itPos, msg.header) + 1;
+            if (nMessageSize)
+                itPos = pnode->vSendMsg.insert(itPos, msg.data) + 1;
+            pnode->nSendPriorityEnd = itPos - pnode->vSendMsg.begin();
+        } else {
+            pnode->vSendMsg.push_back(msg.header);
+            if (nMessageSize)
+                pnode->vSendMsg.push_back(msg.data);
+        }
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
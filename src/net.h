@@ -38,8 +38,11 @@
 class CAddrMan;
 class CBlockIndex;
 class CScheduler;
+class CNetMsgStats;
 class CNode;
 class TierTwoConnMan;
+class TxRequestTracker;
+class TxReconciliationTracker;
 
 /** Time between pings automatically sent out for latency probing and keepalive (in seconds). */
 static const int PING_INTERVAL = 2 * 60;
@@ -71,10 +74,6 @@ static const int MAX_ADDNODE_CONNECTIONS = 16;
 static const int INBOUND_EVICTION_PROTECTION_TIME = 1;
 /** -listen default */
 static const bool DEFAULT_LISTEN = true;
-/** The maximum number of entries in mapAskFor */
-static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
-/** The maximum number of entries in setAskFor (larger due to getdata latency)*/
-static const size_t SETASKFOR_MAX_SZ = 2 * MAX_INV_SZ;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 125;
 /** Disconnected peers are added to setOffsetDisconnectedPeers only if node has less than ENOUGH_CONNECTIONS */
@@ -87,6 +86,9 @@ static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Threads processing the tier two messages that don't need to wait for the message handler thread */
+static const int DEFAULT_ASYNC_MSG_THREADS = 2;
+static const int MAX_ASYNC_MSG_THREADS = 8;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
@@ -125,6 +127,14 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/** An immutable serialized message, header included. It is queued to many peers without being copied. */
+struct CSharedNetMsg
+{
+    std::shared_ptr<const std::vector<unsigned char>> header;
+    std::shared_ptr<const std::vector<unsigned char>> data;
+    std::string command;
+};
+
 class NetEventsInterface;
 class CConnman
 {
@@ -150,6 +160,8 @@ public:
         NetEventsInterface* m_msgproc = nullptr;
         unsigned int nSendBufferMaxSize = 0;
         unsigned int nReceiveFloodSize = 0;
+        int nAsyncMessageThreads = 0;
+        bool m_tx_reconciliation = false;
         std::vector<bool> m_asmap;
         std::vector<std::string> vSeedNodes;
         std::vector<CSubNet> vWhitelistedRange;
@@ -170,6 +182,8 @@ public:
         clientInterface = connOptions.uiInterface;
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
+        nAsyncMessageThreads = connOptions.nAsyncMessageThreads;
+        m_tx_reconciliation = connOptions.m_tx_reconciliation;
         vWhitelistedRange = connOptions.vWhitelistedRange;
         {
             LOCK(cs_vAddedNodes);
@@ -179,7 +193,8 @@ public:
 
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
-    bool Start(CScheduler& scheduler, const Options& options);
+    /** The addresses are dumped from the I/O scheduler, the tier two maintenance runs on its own scheduler */
+    bool Start(CScheduler& schedulerIO, CScheduler& schedulerTierTwo, const Options& options);
     void Stop();
     void Interrupt();
     bool GetNetworkActive() const { return fNetworkActive; };
@@ -210,6 +225,9 @@ public:
     bool ForNode(const CService& addr, const std::function<bool(const CNode* pnode)>& cond, const std::function<bool(CNode* pnode)>& func);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    void PushMessage(CNode* pnode, const CSharedNetMsg& msg);
+    // Builds the header of msg, to push it to several peers
+    CSharedNetMsg ShareMessage(CSerializedNetMsg&& msg) const;
 
     template<typename Callable>
     bool ForEachNodeContinueIf(Callable&& func)
@@ -280,8 +298,14 @@ public:
         post();
     };
 
-    // Clears AskFor requests for every known peer
+    // Forgets the announcements of the item by every peer, it is not requested anymore
     void RemoveAskFor(const uint256& invHash, int invType);
+    /** The getdata requests of the announced items, other than the blocks */
+    TxRequestTracker& GetTxRequestTracker() { return *m_txrequest; }
+    /** The transactions announced by set reconciliation, nullptr unless -txreconciliation */
+    TxReconciliationTracker* GetTxReconciliationTracker() { return m_tx_reconciliation ? m_txreconciliation.get() : nullptr; }
+    /** The wait and processing times of the received messages */
+    CNetMsgStats& GetMsgStats() { return *m_msgstats; }
 
     void RelayInv(CInv& inv);
     bool IsNodeConnected(const CAddress& addr);
@@ -351,6 +375,16 @@ public:
     CSipHasher GetDeterministicRandomizer(uint64_t id);
 
     unsigned int GetReceiveFloodSize() const;
+    // Interrupts the wait for socket events, e.g. when a node can receive again
+    void WakeSelect();
+
+    bool HasAsyncMessageWorkers() const { return !vAsyncMessageWorkers.empty(); }
+    /**
+     * Queues a message to be processed by the async message workers. All the messages of a node
+     * go to the same worker, so they are processed in the order they were received.
+     * The message keeps counting in the receive flood size until it is processed.
+     */
+    void PushAsyncMessage(CNode* pnode, const std::string& strCommand, CDataStream&& vRecv, int64_t nTimeReceived);
 
     void SetAsmap(std::vector<bool> asmap) { addrman.m_asmap = std::move(asmap); }
     /** Unique tier two connections manager */
@@ -379,9 +413,17 @@ private:
     void InactivityCheck(CNode* pnode);
     bool GenerateSelectSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
     void SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#ifdef USE_EPOLL
+    bool GenerateEpollSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set);
+    void SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#endif
+    void RegisterSocketEvents(SOCKET hSocket, bool fListen);
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
+    // Loads peers.dat in the background, the threads using the addresses wait for it
+    void ThreadLoadAddresses();
+    bool WaitAddressesLoaded();
 
     void WakeMessageHandler();
 
@@ -437,6 +479,7 @@ private:
     RecursiveMutex cs_setBanned;
     bool setBannedIsDirty{false};
     bool fAddressesInitialized{false};
+    std::atomic<bool> fAddressesLoaded{false};
     CAddrMan addrman;
     std::deque<std::string> vOneShots;
     RecursiveMutex cs_vOneShots;
@@ -476,6 +519,40 @@ private:
 
     CThreadInterrupt interruptNet;
 
+    struct AsyncMessage {
+        CNode* pnode;
+        std::string strCommand;
+        CDataStream vRecv;
+        // Counted in the node's nProcessQueueSize while queued
+        size_t nSize;
+        // Reception time, in microseconds
+        int64_t nTimeReceived;
+    };
+    struct AsyncMessageWorker {
+        Mutex cs;
+        std::condition_variable cv;
+        std::deque<AsyncMessage> queue GUARDED_BY(cs);
+        std::thread thread;
+    };
+    void ThreadAsyncMessageHandler(AsyncMessageWorker& worker);
+
+    int nAsyncMessageThreads{0};
+    std::vector<std::unique_ptr<AsyncMessageWorker>> vAsyncMessageWorkers;
+
+    bool m_tx_reconciliation{false};
+
+#ifdef USE_EPOLL
+    // -1 when epoll is not available, the poll() loop is used then
+    int epollfd{-1};
+    // eventfd registered in epollfd, written by WakeSelect
+    int wakeupfd{-1};
+    // The sockets are registered edge-triggered: they stay ready, once an event reported it, until recv() or send()
+    // would block. Only used by the socket handler thread.
+    std::set<SOCKET> setEpollReceivable;
+    std::set<SOCKET> setEpollSendable;
+#endif
+
+    std::thread threadLoadAddresses;
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
@@ -483,6 +560,9 @@ private:
     std::thread threadMessageHandler;
 
     std::unique_ptr<TierTwoConnMan> m_tiertwo_conn_man;
+    std::unique_ptr<TxRequestTracker> m_txrequest;
+    std::unique_ptr<TxReconciliationTracker> m_txreconciliation;
+    std::unique_ptr<CNetMsgStats> m_msgstats;
 };
 extern std::unique_ptr<CConnman> g_connman;
 void Discover();
@@ -541,8 +621,6 @@ bool validateMasternodeIP(const std::string& addrStr);          // valid, reacha
 extern bool fDiscover;
 extern bool fListen;
 
-extern limitedmap<CInv, int64_t> mapAlreadyAskedFor;
-
 /** Subversion as sent to the P2P network in `version` messages */
 extern std::string strSubVersion;
 
@@ -609,13 +687,9 @@ public:
 
     int64_t nTime; // time (in microseconds) of message receipt.
 
-    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
-        hdrbuf.resize(24);
-        in_data = false;
-        nHdrPos = 0;
-        nDataPos = 0;
-        nTime = 0;
-    }
+    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn);
+    // Gives the buffers back to CNetBufferPool
+    ~CNetMessage();
 
     bool complete() const
     {
@@ -649,7 +723,13 @@ public:
     size_t nSendSize;   // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    // Headers and payloads, some shared with other nodes. Empty payloads are not queued.
+    std::deque<std::shared_ptr<const std::vector<unsigned char>>> vSendMsg;
+    // The quorum messages are queued ahead of the others, after the message being sent: the priority lane
+    // ends at this index of vSendMsg (0 when empty)
+    size_t nSendPriorityEnd;
+    // Whether vSendMsg starts with the payload of a message whose header was sent
+    bool fSendPayloadFirst;
     RecursiveMutex cs_vSend;
     RecursiveMutex cs_hSocket;
     RecursiveMutex cs_vRecv;
@@ -746,8 +826,6 @@ public:
     // Set of tier two messages ids we still have to announce.
     std::vector<CInv> vInventoryTierTwoToSend;
     RecursiveMutex cs_inventory;
-    std::multimap<int64_t, CInv> mapAskFor;
-    std::set<uint256> setAskFor;
     std::vector<uint256> vBlockRequested;
     std::chrono::microseconds nNextInvSend{0};
     // Used for BIP35 mempool sending, also protected by cs_inventory
@@ -898,10 +976,6 @@ public:
         }
     }
 
-    void AskFor(const CInv& inv, int64_t doubleRequestDelay = 2 * 60 * 1000000);
-    // inv response received, clear it from the waiting inv set.
-    void AskForInvReceived(const uint256& invHash);
-
     void CloseSocketDisconnect();
     bool DisconnectOldProtocol(int nVersionIn, int nVersionRequired);
 
@@ -932,6 +1006,7 @@ class NetEventsInterface
 {
 public:
     virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
+    virtual void ProcessAsyncMessage(CNode* pnode, const std::string& strCommand, CDataStream& vRecv) = 0;
     virtual bool SendMessages(CNode* pnode, std::atomic<bool>& interrupt) EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_sendProcessing) = 0;
     virtual void InitializeNode(CNode* pnode) = 0;
     virtual void FinalizeNode(NodeId id, bool& update_connection_time) = 0;
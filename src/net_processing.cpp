@@ -7,10 +7,15 @@
 
 #include "net_processing.h"
 
+#include "blockencodings.h"
+#include "blockfilter.h"
+#include "blockpipeline.h"
 #include "budget/budgetmanager.h"
 #include "chain.h"
+#include "checkpoints.h"
 #include "evo/deterministicmns.h"
 #include "evo/mnauth.h"
+#include "index/blockfilterindex.h"
 #include "llmq/quorums_blockprocessor.h"
 #include "llmq/quorums_chainlocks.h"
 #include "llmq/quorums_dkgsessionmgr.h"
@@ -20,6 +25,7 @@
 #include "masternodeman.h"
 #include "merkleblock.h"
 #include "netbase.h"
+#include "netmsgstats.h"
 #include "netmessagemaker.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
@@ -27,6 +33,8 @@
 #include "sporkdb.h"
 #include "streams.h"
 #include "tiertwo/tiertwo_sync_state.h"
+#include "txreconciliation.h"
+#include "txrequest.h"
 #include "util/validation.h"
 #include "validation.h"
 
@@ -40,6 +48,26 @@ static const uint64_t RANDOMIZER_ID_ADDRESS_RELAY = 0x3cac0035b5866b90ULL; // SH
 
 /** the maximum percentage of addresses from our addrman to return in response to a getaddr message. */
 static constexpr size_t MAX_PCT_ADDR_TO_SEND = 23;
+/** Maximum number of announced items (non-blocks) tracked per peer, the others are dropped */
+static constexpr size_t MAX_PEER_TX_ANNOUNCEMENTS = MAX_INV_SZ;
+/** Maximum number of items (non-blocks) requested from a peer at a time, before its announcements are delayed */
+static constexpr size_t MAX_PEER_TX_IN_FLIGHT = 100;
+/** Delay of the announcements of the non-preferred peers, giving the preferred ones the time to announce too */
+static constexpr auto NONPREF_PEER_TX_DELAY = 2s;
+/** Delay of the announcements of the peers with too many requests in flight */
+static constexpr auto OVERLOADED_PEER_TX_DELAY = 2s;
+/** Time before an item is requested from the next peer, when the requested one doesn't answer */
+static constexpr auto GETDATA_TX_INTERVAL = 2min;
+/** Same for the items that are needed quickly: the recovered sigs and the chainlocks */
+static constexpr auto GETDATA_FAST_INTERVAL = 5s;
+/** Maximum number of compact filters that may be requested with one getcfilters. See BIP 157. */
+static constexpr uint32_t MAX_GETCFILTERS_SIZE = 1000;
+/** Maximum number of cf hashes that may be requested with one getcfheaders. See BIP 157. */
+static constexpr uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+/** CPU time (in microseconds) per second that a peer can make us spend on the filtered blocks it requests */
+static constexpr int64_t FILTERED_BLOCK_CPU_PER_SECOND = 100 * 1000;
+/** CPU time (in microseconds) that a peer can bank for a burst of filtered block requests */
+static constexpr int64_t MAX_FILTERED_BLOCK_CPU_CREDIT = 1000 * 1000;
 
 struct IteratorComparator
 {
@@ -106,15 +134,52 @@ struct QueuedBlock {
     int64_t nTime;              //! Time of "getdata" request in microseconds.
     int nValidatedQueuedBefore; //! Number of blocks queued with validated headers (globally) at the time this one is requested.
     bool fValidatedHeaders;     //! Whether this block has validated headers at the time of request.
+    std::unique_ptr<PartiallyDownloadedBlock> partialBlock; //! Optional, used for cmpctblocks
 };
 std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
 /** Number of blocks in flight with validated headers. */
 int nQueuedValidatedHeaders = 0;
 
+/**
+ * Blocks of the download window received before their parent, by parent hash. They are processed
+ * once the parent is, as the PoS checks need the parent connected. Protected by cs_main.
+ */
+struct WaitingBlock {
+    uint256 hash;
+    NodeId nodeid;
+    std::shared_ptr<const CBlock> pblock;
+};
+std::map<uint256, WaitingBlock> mapBlocksWaitingParent;
+
+/** Blocks received and queued to g_block_pipeline, not processed yet. Protected by cs_main. */
+std::set<uint256> setBlocksInPipeline;
+
 /** Number of preferable block download peers. */
 int nPreferredDownload = 0;
 
+/** The peers we asked to announce new blocks with cmpctblock, oldest first. Protected by cs_main. */
+std::list<NodeId> lNodesAnnouncingHeaderAndIDs;
+
+/** The last block connected, announced with cmpctblock to the peers that asked for it. */
+Mutex cs_most_recent_block;
+std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent_block);
+uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
+std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block GUARDED_BY(cs_most_recent_block);
+
+/** The block messages of the recent blocks, serialized once for all the peers requesting them. Newest last. */
+struct RecentBlockMsg {
+    uint256 hash;
+    int nSendVersion;
+    CSharedNetMsg msg;
+};
+static const size_t MAX_RECENT_BLOCK_MSGS = 4;
+std::deque<RecentBlockMsg> recent_block_msgs GUARDED_BY(cs_most_recent_block);
+
+/** The filtered block data of the recent blocks, shared by all the bloom filter peers requesting them. Newest last. */
+static const size_t MAX_RECENT_FILTERED_BLOCKS = 8;
+std::deque<std::pair<uint256, std::shared_ptr<const CFilteredBlockData>>> recent_filtered_blocks GUARDED_BY(cs_most_recent_block);
+
 } // anon namespace
 
 namespace
@@ -219,6 +284,13 @@ struct CNodeState {
     const CBlockIndex* pindexLastCommonBlock;
     //! Whether we've started headers synchronization with this peer.
     bool fSyncStarted;
+    //! Whether the sync with this peer was started with getheaders, below the last checkpoint.
+    bool fHeadersFirstSync;
+    //! Number of the branches of PoS header-only entries this peer has forked off the index.
+    int nHeadersBranches;
+    //! The tip of the chain of headers this peer extends: it only moves forward on that chain, the
+    //! other branches of the peer can't become it.
+    const CBlockIndex* pindexHeadersTip;
     //! Since when we're stalling block download progress (in microseconds), or 0.
     int64_t nStallingSince;
     std::list<QueuedBlock> vBlocksInFlight;
@@ -229,6 +301,14 @@ struct CNodeState {
     uint64_t amt_addr_processed = 0;
     //! Addresses rate limited
     uint64_t amt_addr_rate_limited = 0;
+    //! Whether this peer can provide and reconstruct blocks with cmpctblock (it sent sendcmpct).
+    bool fSupportsCompactBlocks;
+    //! Whether this peer wants new blocks announced with cmpctblock instead of inv.
+    bool fPreferCompactBlocks;
+    //! The CPU time (in microseconds) this peer can still make us spend on filtered blocks.
+    int64_t nFilteredBlockCredit;
+    //! When nFilteredBlockCredit was last refilled (in microseconds), or 0.
+    int64_t nFilteredBlockCreditTime;
 
     CNodeBlocks nodeBlocks;
 
@@ -240,9 +320,16 @@ struct CNodeState {
         hashLastUnknownBlock.SetNull();
         pindexLastCommonBlock = nullptr;
         fSyncStarted = false;
+        fHeadersFirstSync = false;
+        nHeadersBranches = 0;
+        pindexHeadersTip = nullptr;
         nStallingSince = 0;
         nBlocksInFlight = 0;
         fPreferredDownload = false;
+        fSupportsCompactBlocks = false;
+        fPreferCompactBlocks = false;
+        nFilteredBlockCredit = MAX_FILTERED_BLOCK_CPU_CREDIT;
+        nFilteredBlockCreditTime = 0;
     }
 };
 
@@ -315,19 +402,117 @@ void MarkBlockAsReceived(const uint256& hash)
 }
 
 // Requires cs_main.
-void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const CBlockIndex* pindex = nullptr)
+// Returns false if the block was already in flight from this peer. With pit, returns there
+// the queue entry of the block, getting a PartiallyDownloadedBlock if it is a new one.
+bool MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const CBlockIndex* pindex = nullptr, std::list<QueuedBlock>::iterator** pit = nullptr)
 {
     CNodeState* state = State(nodeid);
     assert(state != nullptr);
 
+    // Short-circuit most stuff in case it is from the same node
+    auto itInFlight = mapBlocksInFlight.find(hash);
+    if (itInFlight != mapBlocksInFlight.end() && itInFlight->second.first == nodeid) {
+        if (pit) {
+            *pit = &itInFlight->second.second;
+        }
+        return false;
+    }
+
     // Make sure it's not listed somewhere already.
     MarkBlockAsReceived(hash);
 
-    QueuedBlock newentry = {hash, pindex, GetTimeMicros(), nQueuedValidatedHeaders, pindex != nullptr};
-    nQueuedValidatedHeaders += newentry.fValidatedHeaders;
-    std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(), newentry);
+    std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(),
+            {hash, pindex, GetTimeMicros(), nQueuedValidatedHeaders, pindex != nullptr,
+             std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&mempool) : nullptr)});
+    nQueuedValidatedHeaders += it->fValidatedHeaders;
     state->nBlocksInFlight++;
-    mapBlocksInFlight[hash] = std::make_pair(nodeid, it);
+    itInFlight = mapBlocksInFlight.insert(std::make_pair(hash, std::make_pair(nodeid, it))).first;
+    if (pit) {
+        *pit = &itInFlight->second.second;
+    }
+    return true;
+}
+
+/** Processes in order the blocks received before their parent, once hashParent was processed. */
+static void ProcessBlocksWaitingParent(uint256 hashParent)
+{
+    while (true) {
+        std::shared_ptr<const CBlock> pblock;
+        {
+            LOCK(cs_main);
+            auto it = mapBlocksWaitingParent.find(hashParent);
+            if (it == mapBlocksWaitingParent.end())
+                return;
+            pblock = it->second.pblock;
+            hashParent = it->second.hash;
+            const CBlockIndex* pindexParent = LookupBlockIndex(pblock->hashPrevBlock);
+            if (!pindexParent || !(pindexParent->nStatus & BLOCK_HAVE_DATA)) {
+                // The parent was rejected. The block is requested again if still needed.
+                mapBlocksWaitingParent.erase(it);
+                return;
+            }
+            mapBlockSource.emplace(hashParent, it->second.nodeid);
+            mapBlocksWaitingParent.erase(it);
+        }
+        ProcessNewBlock(pblock, nullptr);
+    }
+}
+
+/** The connect stage of g_block_pipeline: processes a block received, then the blocks waiting for it. */
+static void ConnectPipelineBlock(const std::shared_ptr<const CBlock>& pblock)
+{
+    const uint256& hash = pblock->GetHash();
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindexParent = LookupBlockIndex(pblock->hashPrevBlock);
+        if (!pindexParent || !(pindexParent->nStatus & BLOCK_HAVE_DATA)) {
+            // The parent was rejected. The block is requested again if still needed.
+            setBlocksInPipeline.erase(hash);
+            mapBlockSource.erase(hash);
+            return;
+        }
+    }
+    try {
+        ProcessNewBlock(pblock, nullptr);
+    } catch (...) {
+        // Not in the pipeline anymore, so that the block can be received again
+        WITH_LOCK(cs_main, setBlocksInPipeline.erase(hash); mapBlockSource.erase(hash));
+        throw;
+    }
+    WITH_LOCK(cs_main, setBlocksInPipeline.erase(hash));
+    ProcessBlocksWaitingParent(hash);
+}
+
+/**
+ * When a peer sends us a valid block, ask it to announce the next ones with cmpctblock,
+ * saving us the getdata round trip. Only the last MAX_CMPCTBLOCK_ANNOUNCERS peers doing
+ * so are kept: the oldest one is told to go back to inv.
+ */
+static void MaybeSetPeerAsAnnouncingHeaderAndIDs(NodeId nodeid, CConnman* connman) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CNodeState* nodestate = State(nodeid);
+    if (!nodestate || !nodestate->fSupportsCompactBlocks) {
+        return;
+    }
+    for (auto it = lNodesAnnouncingHeaderAndIDs.begin(); it != lNodesAnnouncingHeaderAndIDs.end(); it++) {
+        if (*it == nodeid) {
+            lNodesAnnouncingHeaderAndIDs.erase(it);
+            lNodesAnnouncingHeaderAndIDs.push_back(nodeid);
+            return;
+        }
+    }
+    connman->ForNode(nodeid, [connman](CNode* pfrom) {
+        if (lNodesAnnouncingHeaderAndIDs.size() >= MAX_CMPCTBLOCK_ANNOUNCERS) {
+            connman->ForNode(lNodesAnnouncingHeaderAndIDs.front(), [connman](CNode* pnodeStop) {
+                connman->PushMessage(pnodeStop, CNetMsgMaker(pnodeStop->GetSendVersion()).Make(NetMsgType::SENDCMPCT, false, CMPCTBLOCKS_VERSION));
+                return true;
+            });
+            lNodesAnnouncingHeaderAndIDs.pop_front();
+        }
+        connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SENDCMPCT, true, CMPCTBLOCKS_VERSION));
+        lNodesAnnouncingHeaderAndIDs.push_back(pfrom->GetId());
+        return true;
+    });
 }
 
 /** Check whether the last unknown block a peer advertised is not yet known. */
@@ -369,6 +554,41 @@ static void UpdateBlockAvailability(NodeId nodeid, const uint256& hash) EXCLUSIV
     }
 }
 
+/**
+ * Whether the chain is synced headers first: below the last checkpoint, that pins the header chain.
+ * Above it, a PoS header can't be checked without its block, and the blocks are synced with getblocks.
+ */
+static bool IsHeadersFirstSync() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    return chainActive.Height() < Checkpoints::GetTotalBlocksEstimate();
+}
+
+/**
+ * The active chain entries answering a getblocks/getheaders: at most nLimit of them from nStartHeight,
+ * ending at the hashStop block if it is one of them (included in the answer if fIncludeStop).
+ * The range is resolved with a single lookup, and copied from the height array of the chain, so
+ * that the answer is then built without cs_main.
+ */
+static std::vector<CBlockIndex*> GetActiveChainRange(int nStartHeight, int nLimit, const uint256& hashStop, bool fIncludeStop, bool& fStopped) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    int nEndHeight = std::min(chainActive.Height(), nStartHeight + nLimit - 1);
+    fStopped = false;
+    const CBlockIndex* pindexStop = hashStop.IsNull() ? nullptr : LookupBlockIndex(hashStop);
+    if (pindexStop && pindexStop->nHeight >= nStartHeight && pindexStop->nHeight <= nEndHeight &&
+            chainActive.Contains(pindexStop)) {
+        nEndHeight = fIncludeStop ? pindexStop->nHeight : pindexStop->nHeight - 1;
+        fStopped = true;
+    }
+    return chainActive.GetRange(nStartHeight, nEndHeight);
+}
+
+static bool IsBlockWaitingParent(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    auto it = mapBlocksWaitingParent.find(pindex->pprev->GetBlockHash());
+    return it != mapBlocksWaitingParent.end() && it->second.hash == pindex->GetBlockHash();
+}
+
 /** Update pindexLastCommonBlock and add not-in-flight missing successors to vBlocks, until it has
  *  at most count entries. */
 static void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, NodeId& nodeStaller) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
@@ -430,9 +650,12 @@ static void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vec
                 // We consider the chain that this peer is on invalid.
                 return;
             }
-            if (pindex->nStatus & BLOCK_HAVE_DATA) {
+            if (pindex->nStatus & BLOCK_HAVE_DATA || chainActive.Contains(pindex)) {
                 if (pindex->nChainTx)
                     state->pindexLastCommonBlock = pindex;
+            } else if (IsBlockWaitingParent(pindex) || setBlocksInPipeline.count(pindex->GetBlockHash())) {
+                // Downloaded already, waiting for the blocks before it.
+                continue;
             } else if (mapBlocksInFlight.count(pindex->GetBlockHash()) == 0) {
                 // The block is not already downloaded, and not yet in flight.
                 if (pindex->nHeight > nWindowEnd) {
@@ -457,6 +680,11 @@ static void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vec
 
 } // anon namespace
 
+void StartBlockPipeline()
+{
+    g_block_pipeline.Start(ConnectPipelineBlock);
+}
+
 void PeerLogicValidation::InitializeNode(CNode *pnode) {
     CAddress addr = pnode->addr;
     std::string addrName = pnode->GetAddrName();
@@ -484,10 +712,16 @@ void PeerLogicValidation::FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTim
 
     for (const QueuedBlock& entry : state->vBlocksInFlight)
         mapBlocksInFlight.erase(entry.hash);
+    lNodesAnnouncingHeaderAndIDs.remove(nodeid);
     EraseOrphansFor(nodeid);
+    connman->GetTxRequestTracker().DisconnectedPeer(nodeid);
+    if (TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker()) {
+        txreconciliation->ForgetPeer(nodeid);
+    }
     nPreferredDownload -= state->fPreferredDownload;
 
     mapNodeState.erase(nodeid);
+    CMNAuth::NotifyNodeRemoved(nodeid);
 }
 
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats)
@@ -646,6 +880,15 @@ void Misbehaving(NodeId pnode, int howmuch, const std::string& message) EXCLUSIV
 }
 
 // Requires cs_main.
+int GetHeadersBranchLength(const CBlockIndex* pindexPrev, const CBlockIndex* pindexHeadersTip)
+{
+    if (!pindexHeadersTip || pindexPrev->GetAncestor(pindexHeadersTip->nHeight) == pindexHeadersTip) {
+        return 0;
+    }
+    const CBlockIndex* pindexFork = LastCommonAncestor(pindexPrev, pindexHeadersTip);
+    return pindexPrev->nHeight + 1 - (pindexFork ? pindexFork->nHeight : 0);
+}
+
 bool IsBanned(NodeId pnode)
 {
     CNodeState* state = State(pnode);
@@ -710,6 +953,13 @@ PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn) :
 
 void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
 {
+    {
+        LOCK(cs_most_recent_block);
+        most_recent_block = pblock;
+        most_recent_block_hash = pindex->GetBlockHash();
+        most_recent_compact_block.reset();
+    }
+
     LOCK(g_cs_orphans);
 
     std::vector<uint256> vOrphanErase;
@@ -746,12 +996,50 @@ void PeerLogicValidation::UpdatedBlockTip(const CBlockIndex* pindexNew, const CB
 
     if (!fInitialDownload) {
         const uint256& hashNewTip = pindexNew->GetBlockHash();
+
+        // A block extending our previous tip goes as a cmpctblock to the peers that asked
+        // for it, which can reconstruct it from their mempool without any getdata.
+        std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock;
+        if (pindexNew->pprev == pindexFork) {
+            LOCK(cs_most_recent_block);
+            if (most_recent_block && most_recent_block_hash == hashNewTip) {
+                if (!most_recent_compact_block) {
+                    most_recent_compact_block = std::make_shared<const CBlockHeaderAndShortTxIDs>(*most_recent_block);
+                }
+                pcmpctblock = most_recent_compact_block;
+            }
+        }
+        std::set<NodeId> setCompactPeers;
+        if (pcmpctblock) {
+            LOCK(cs_main);
+            for (const auto& it : mapNodeState) {
+                if (it.second.fPreferCompactBlocks) setCompactPeers.emplace(it.first);
+            }
+        }
+
+        // The cmpctblock is serialized once per send version
+        std::map<int, CSharedNetMsg> mapCmpctBlockMsgs;
+
         // Relay inventory, but don't relay old inventory during initial block download.
-        connman->ForEachNode([nNewHeight, hashNewTip](CNode* pnode) {
+        connman->ForEachNode([this, nNewHeight, &hashNewTip, &pcmpctblock, &setCompactPeers, &mapCmpctBlockMsgs](CNode* pnode) {
             // Don't sync from MN only connections.
             if (!pnode->CanRelay()) {
                 return;
             }
+            if (setCompactPeers.count(pnode->GetId())) {
+                const CInv inv(MSG_BLOCK, hashNewTip);
+                if (!WITH_LOCK(pnode->cs_inventory, return pnode->filterInventoryKnown.contains(inv.hash))) {
+                    LogPrint(BCLog::NET, "%s sending cmpctblock %s to peer=%d\n", __func__, hashNewTip.ToString(), pnode->GetId());
+                    const int nSendVersion = pnode->GetSendVersion();
+                    auto it = mapCmpctBlockMsgs.find(nSendVersion);
+                    if (it == mapCmpctBlockMsgs.end()) {
+                        it = mapCmpctBlockMsgs.emplace(nSendVersion, connman->ShareMessage(CNetMsgMaker(nSendVersion).Make(NetMsgType::CMPCTBLOCK, *pcmpctblock))).first;
+                    }
+                    connman->PushMessage(pnode, it->second);
+                    pnode->AddInventoryKnown(inv);
+                }
+                return;
+            }
             if (nNewHeight > (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : 0)) {
                 pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
             }
@@ -779,6 +1067,9 @@ void PeerLogicValidation::BlockChecked(const CBlock& block, const CValidationSta
             // Spam filter
             CheckBlockSpam(it->second, block.GetHash());
         }
+    } else if (state.IsValid() && it != mapBlockSource.end() && !IsInitialBlockDownload()) {
+        // The peer is a good source of new blocks
+        MaybeSetPeerAsAnnouncingHeaderAndIDs(it->second, connman);
     }
 
     if (it != mapBlockSource.end())
@@ -862,7 +1153,7 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
         }
         return false;
     case MSG_MASTERNODE_PING:
-        return mnodeman.mapSeenMasternodePing.count(inv.hash);
+        return mnodeman.HasSeenPing(inv.hash);
     case MSG_QUORUM_FINAL_COMMITMENT:
         return llmq::quorumBlockProcessor->HasMinableCommitment(inv.hash);
     case MSG_QUORUM_CONTRIB:
@@ -889,6 +1180,23 @@ static void RelayTransaction(const CTransaction& tx, CConnman* connman)
     });
 }
 
+/** Announces with inv the transactions a reconciliation found the peer lacks */
+static void AnnounceReconciledTxs(CNode* pto, const std::vector<uint256>& vTxs, CConnman* connman)
+{
+    std::vector<CInv> vInv;
+    {
+        LOCK(pto->cs_inventory);
+        for (const uint256& txid : vTxs) {
+            if (!mempool.exists(txid)) continue;
+            pto->filterInventoryKnown.insert(txid);
+            vInv.emplace_back(MSG_TX, txid);
+        }
+    }
+    if (!vInv.empty()) {
+        connman->PushMessage(pto, CNetMsgMaker(pto->GetSendVersion()).Make(NetMsgType::INV, vInv));
+    }
+}
+
 static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connman)
 {
     if (!fReachable && !addr.IsRelayable()) return;
@@ -1046,10 +1354,11 @@ bool static PushTierTwoGetDataRequest(const CInv& inv,
 
     // !TODO: remove when transition to DMN is complete
     if (inv.type == MSG_MASTERNODE_PING && !deterministicMNManager->LegacyMNObsolete()) {
-        if (mnodeman.mapSeenMasternodePing.count(inv.hash)) {
+        CMasternodePing mnp;
+        if (mnodeman.GetSeenPing(inv.hash, mnp)) {
             CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
             ss.reserve(1000);
-            ss << mnodeman.mapSeenMasternodePing[inv.hash];
+            ss << mnp;
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNPING, ss));
             return true;
         }
@@ -1072,6 +1381,71 @@ bool static PushTierTwoGetDataRequest(const CInv& inv,
     return false;
 }
 
+// The block message of pindex at nSendVersion, serialized on the first request
+static CSharedNetMsg GetRecentBlockMsg(const CBlockIndex* pindex, int nSendVersion, CConnman* connman) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const uint256& hash = pindex->GetBlockHash();
+    std::shared_ptr<const CBlock> pblock;
+    {
+        LOCK(cs_most_recent_block);
+        for (const RecentBlockMsg& recent : recent_block_msgs) {
+            if (recent.hash == hash && recent.nSendVersion == nSendVersion) return recent.msg;
+        }
+        if (most_recent_block_hash == hash) pblock = most_recent_block;
+    }
+    if (!pblock) {
+        pblock = ReadSharedBlockFromDisk(pindex);
+        if (!pblock)
+            assert(!"cannot load block from disk");
+    }
+    CSharedNetMsg msg = connman->ShareMessage(CNetMsgMaker(nSendVersion).Make(NetMsgType::BLOCK, *pblock));
+    LOCK(cs_most_recent_block);
+    recent_block_msgs.push_back({hash, nSendVersion, msg});
+    if (recent_block_msgs.size() > MAX_RECENT_BLOCK_MSGS) recent_block_msgs.pop_front();
+    return msg;
+}
+
+// The filtered block data of the block of pindex, computed on the first request
+static std::shared_ptr<const CFilteredBlockData> GetRecentFilteredBlockData(const CBlockIndex* pindex, const CBlock& block)
+{
+    const uint256& hash = pindex->GetBlockHash();
+    {
+        LOCK(cs_most_recent_block);
+        for (const auto& recent : recent_filtered_blocks) {
+            if (recent.first == hash) return recent.second;
+        }
+    }
+    auto data = std::make_shared<const CFilteredBlockData>(block);
+    LOCK(cs_most_recent_block);
+    recent_filtered_blocks.emplace_back(hash, data);
+    if (recent_filtered_blocks.size() > MAX_RECENT_FILTERED_BLOCKS) recent_filtered_blocks.pop_front();
+    return data;
+}
+
+// Whether the peer has CPU time left for a filtered block, refilling its credit with the time elapsed
+static bool HasFilteredBlockCredit(NodeId nodeid, int64_t nNow) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CNodeState* state = State(nodeid);
+    if (!state) return true;
+    if (state->nFilteredBlockCreditTime != 0 && nNow > state->nFilteredBlockCreditTime) {
+        state->nFilteredBlockCredit = std::min(MAX_FILTERED_BLOCK_CPU_CREDIT,
+                state->nFilteredBlockCredit + (nNow - state->nFilteredBlockCreditTime) * FILTERED_BLOCK_CPU_PER_SECOND / 1000000);
+    }
+    state->nFilteredBlockCreditTime = nNow;
+    return state->nFilteredBlockCredit > 0;
+}
+
+static bool BlockRequestAllowed(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    if (chainActive.Contains(pindex)) return true;
+    // To prevent fingerprinting attacks, only send blocks outside of the active
+    // chain if they are valid, and no more than a max reorg depth than the best header
+    // chain we know about.
+    return pindex->IsValid(BLOCK_VALID_SCRIPTS) && pindexBestHeader &&
+           (chainActive.Height() - pindex->nHeight < gArgs.GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH));
+}
+
 void static ProcessGetBlockData(CNode* pfrom, const CInv& inv, CConnman* connman, const std::atomic<bool>& interruptMsgProc)
 {
     LOCK(cs_main);
@@ -1080,38 +1454,53 @@ void static ProcessGetBlockData(CNode* pfrom, const CInv& inv, CConnman* connman
     bool send = false;
     CBlockIndex* pindex = LookupBlockIndex(inv.hash);
     if (pindex) {
-        if (chainActive.Contains(pindex)) {
-            send = true;
-        } else {
-            // To prevent fingerprinting attacks, only send blocks outside of the active
-            // chain if they are valid, and no more than a max reorg depth than the best header
-            // chain we know about.
-            send = pindex->IsValid(BLOCK_VALID_SCRIPTS) && pindexBestHeader &&
-                   (chainActive.Height() - pindex->nHeight < gArgs.GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH));
-            if (!send) {
-                LogPrint(BCLog::NET, "ProcessGetData(): ignoring request from peer=%i for old block that isn't in the main chain\n", pfrom->GetId());
-            }
+        send = BlockRequestAllowed(pindex);
+        if (!send) {
+            LogPrint(BCLog::NET, "ProcessGetData(): ignoring request from peer=%i for old block that isn't in the main chain\n", pfrom->GetId());
         }
     }
     // Don't send not-validated blocks
     if (send && (pindex->nStatus & BLOCK_HAVE_DATA)) {
-        // Send block from disk
+        const bool fRecent = pindex->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH;
+        // Send block from disk, the recent ones are shared by all the peers
         CBlock block;
-        if (!ReadBlockFromDisk(block, pindex))
-            assert(!"cannot load block from disk");
-        if (inv.type == MSG_BLOCK)
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
+        if (inv.type != MSG_BLOCK || !fRecent) {
+            if (!ReadBlockFromDisk(block, pindex))
+                assert(!"cannot load block from disk");
+        }
+        if (inv.type == MSG_BLOCK) {
+            if (fRecent) {
+                connman->PushMessage(pfrom, GetRecentBlockMsg(pindex, pfrom->GetSendVersion(), connman));
+            } else {
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
+            }
+        } else if (inv.type == MSG_CMPCT_BLOCK) {
+            // Older blocks are unlikely to be in the mempool of the peer: send them in full
+            if (fRecent) {
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, CBlockHeaderAndShortTxIDs(block)));
+            } else {
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
+            }
+        }
         else // MSG_FILTERED_BLOCK)
         {
             bool send_ = false;
             CMerkleBlock merkleBlock;
+            const int64_t nTimeStart = GetTimeMicros();
             {
+                // The recent blocks are matched with the filters of all the peers syncing the tip
+                std::shared_ptr<const CFilteredBlockData> data;
+                if (fRecent && WITH_LOCK(pfrom->cs_filter, return pfrom->pfilter != nullptr)) {
+                    data = GetRecentFilteredBlockData(pindex, block);
+                }
                 LOCK(pfrom->cs_filter);
                 if (pfrom->pfilter) {
                     send_ = true;
-                    merkleBlock = CMerkleBlock(block, *pfrom->pfilter);
+                    merkleBlock = data ? CMerkleBlock(block, *pfrom->pfilter, *data) : CMerkleBlock(block, *pfrom->pfilter);
                 }
             }
+            CNodeState* nodestate = State(pfrom->GetId());
+            if (nodestate) nodestate->nFilteredBlockCredit -= GetTimeMicros() - nTimeStart;
             if (send_) {
                 connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
                 // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
@@ -1160,7 +1549,8 @@ bool static IsTierTwoInventoryTypeKnown(int type)
            type == MSG_CLSIG;
 }
 
-void static ProcessGetData(CNode* pfrom, CConnman* connman, const std::atomic<bool>& interruptMsgProc)
+// Returns false if the next request waits for the peer's filtered block credit (see HasFilteredBlockCredit)
+bool static ProcessGetData(CNode* pfrom, CConnman* connman, const std::atomic<bool>& interruptMsgProc)
 {
     AssertLockNotHeld(cs_main);
 
@@ -1172,7 +1562,7 @@ void static ProcessGetData(CNode* pfrom, CConnman* connman, const std::atomic<bo
 
         while (it != pfrom->vRecvGetData.end() && (it->type == MSG_TX || IsTierTwoInventoryTypeKnown(it->type))) {
             if (interruptMsgProc)
-                return;
+                return true;
             // Don't bother if send buffer is too full to respond anyway
             if (pfrom->fPauseSend)
                 break;
@@ -1206,9 +1596,14 @@ void static ProcessGetData(CNode* pfrom, CConnman* connman, const std::atomic<bo
         }
     } // release cs_main
 
+    bool fThrottled = false;
     if (it != pfrom->vRecvGetData.end() && !pfrom->fPauseSend) {
         const CInv &inv = *it;
-        if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
+        if (inv.type == MSG_FILTERED_BLOCK && !pfrom->fWhitelisted &&
+            !WITH_LOCK(cs_main, return HasFilteredBlockCredit(pfrom->GetId(), GetTimeMicros()))) {
+            // Keep it, and the requests after it, to answer in order once the credit is refilled
+            fThrottled = true;
+        } else if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
             it++;
             ProcessGetBlockData(pfrom, inv, connman, interruptMsgProc);
         }
@@ -1226,9 +1621,237 @@ void static ProcessGetData(CNode* pfrom, CConnman* connman, const std::atomic<bo
         // having to download the entire memory pool.
         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::NOTFOUND, vNotFound));
     }
+    return !fThrottled;
 }
 
 bool fRequestedSporksIDB = false;
+static void AddInvAnnouncement(const CNode* pfrom, const CInv& inv, std::chrono::microseconds current_time,
+                               TxRequestTracker& txrequest) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const NodeId nodeid = pfrom->GetId();
+    if (txrequest.Count(nodeid) >= MAX_PEER_TX_ANNOUNCEMENTS) return;
+    const bool preferred = State(nodeid)->fPreferredDownload;
+    auto delay = std::chrono::microseconds::zero();
+    if (!preferred) delay += NONPREF_PEER_TX_DELAY;
+    if (txrequest.CountInFlight(nodeid) >= MAX_PEER_TX_IN_FLIGHT) delay += OVERLOADED_PEER_TX_DELAY;
+    txrequest.ReceivedInv(nodeid, inv, preferred, current_time + delay);
+}
+
+static std::chrono::microseconds GetRequestExpiry(const CInv& inv, std::chrono::microseconds current_time)
+{
+    // The first peer announcing these must answer quickly, or the next one is asked
+    if (inv.type == MSG_QUORUM_RECOVERED_SIG || inv.type == MSG_CLSIG) {
+        return current_time + GETDATA_FAST_INTERVAL;
+    }
+    return current_time + GETDATA_TX_INTERVAL;
+}
+
+/**
+ * Validation logic for compact filters request handling.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ *
+ * @param[in]   pfrom           The peer that we received the request from
+ * @param[in]   filter_type     The filter type the request is for. Must be basic filters.
+ * @param[in]   start_height    The start height for the request
+ * @param[in]   stop_hash       The stop_hash for the request
+ * @param[in]   max_height_diff The maximum number of items permitted to request, as specified in BIP 157
+ * @param[out]  stop_index      The CBlockIndex for the stop_hash block, if the request can be serviced.
+ * @param[out]  filter_index    The filter index, if the request can be serviced.
+ * @return                      True if the request can be serviced.
+ */
+static bool PrepareBlockFilterRequest(CNode* pfrom, BlockFilterType filter_type, uint32_t start_height,
+                                      const uint256& stop_hash, uint32_t max_height_diff,
+                                      const CBlockIndex*& stop_index, BlockFilterIndex*& filter_index)
+{
+    const bool supported_filter_type =
+        (filter_type == BlockFilterType::BASIC_FILTER &&
+         (pfrom->GetLocalServices() & NODE_COMPACT_FILTERS));
+    if (!supported_filter_type) {
+        LogPrint(BCLog::NET, "peer %d requested unsupported block filter type: %d\n",
+                 pfrom->GetId(), static_cast<uint8_t>(filter_type));
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    {
+        LOCK(cs_main);
+        stop_index = LookupBlockIndex(stop_hash);
+
+        // Check that the stop block exists and the peer would be allowed to fetch it.
+        if (!stop_index || !BlockRequestAllowed(stop_index)) {
+            LogPrint(BCLog::NET, "peer %d requested invalid block hash: %s\n",
+                     pfrom->GetId(), stop_hash.ToString());
+            pfrom->fDisconnect = true;
+            return false;
+        }
+    }
+
+    uint32_t stop_height = stop_index->nHeight;
+    if (start_height > stop_height) {
+        LogPrint(BCLog::NET, "peer %d sent invalid getcfilters/getcfheaders with "
+                 "start height %d and stop height %d\n",
+                 pfrom->GetId(), start_height, stop_height);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    if (stop_height - start_height >= max_height_diff) {
+        LogPrint(BCLog::NET, "peer %d requested too many cfilters/cfheaders: %d / %d\n",
+                 pfrom->GetId(), stop_height - start_height + 1, max_height_diff);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    filter_index = GetBlockFilterIndex(filter_type);
+    if (!filter_index) {
+        LogPrint(BCLog::NET, "Filter index for supported type %s not found\n", BlockFilterTypeName(filter_type));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Handle a cfilters request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFilters(CNode* pfrom, CDataStream& vRecv, CConnman* connman)
+{
+    uint8_t filter_type_ser;
+    uint32_t start_height;
+    uint256 stop_hash;
+
+    vRecv >> filter_type_ser >> start_height >> stop_hash;
+
+    const BlockFilterType filter_type = static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex* stop_index;
+    BlockFilterIndex* filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, filter_type, start_height, stop_hash,
+                                   MAX_GETCFILTERS_SIZE, stop_index, filter_index)) {
+        return;
+    }
+
+    std::vector<BlockFilter> filters;
+    if (!filter_index->LookupFilterRange(start_height, stop_index, filters)) {
+        LogPrint(BCLog::NET, "Failed to find block filter in index: filter_type=%s, start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filter_type), start_height, stop_hash.ToString());
+        return;
+    }
+
+    CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    for (const auto& filter : filters) {
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CFILTER, filter));
+    }
+}
+
+/**
+ * Handle a cfheaders request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFHeaders(CNode* pfrom, CDataStream& vRecv, CConnman* connman)
+{
+    uint8_t filter_type_ser;
+    uint32_t start_height;
+    uint256 stop_hash;
+
+    vRecv >> filter_type_ser >> start_height >> stop_hash;
+
+    const BlockFilterType filter_type = static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex* stop_index;
+    BlockFilterIndex* filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, filter_type, start_height, stop_hash,
+                                   MAX_GETCFHEADERS_SIZE, stop_index, filter_index)) {
+        return;
+    }
+
+    uint256 prev_header;
+    if (start_height > 0) {
+        const CBlockIndex* const prev_block =
+            stop_index->GetAncestor(static_cast<int>(start_height - 1));
+        if (!filter_index->LookupFilterHeader(prev_block, prev_header)) {
+            LogPrint(BCLog::NET, "Failed to find block filter header in index: filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filter_type), prev_block->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    std::vector<uint256> filter_hashes;
+    if (!filter_index->LookupFilterHashRange(start_height, stop_index, filter_hashes)) {
+        LogPrint(BCLog::NET, "Failed to find block filter hashes in index: filter_type=%s, start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filter_type), start_height, stop_hash.ToString());
+        return;
+    }
+
+    connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::CFHEADERS,
+                                                                            filter_type_ser,
+                                                                            stop_index->GetBlockHash(),
+                                                                            prev_header,
+                                                                            filter_hashes));
+}
+
+/**
+ * Handle a getcfcheckpt request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ */
+static void ProcessGetCFCheckPt(CNode* pfrom, CDataStream& vRecv, CConnman* connman)
+{
+    uint8_t filter_type_ser;
+    uint256 stop_hash;
+
+    vRecv >> filter_type_ser >> stop_hash;
+
+    const BlockFilterType filter_type = static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex* stop_index;
+    BlockFilterIndex* filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, filter_type, /*start_height=*/0, stop_hash,
+                                   /*max_height_diff=*/std::numeric_limits<uint32_t>::max(),
+                                   stop_index, filter_index)) {
+        return;
+    }
+
+    std::vector<uint256> headers(stop_index->nHeight / CFCHECKPT_INTERVAL);
+
+    // Populate headers.
+    const CBlockIndex* block_index = stop_index;
+    for (int i = headers.size() - 1; i >= 0; i--) {
+        int height = (i + 1) * CFCHECKPT_INTERVAL;
+        block_index = block_index->GetAncestor(height);
+
+        if (!filter_index->LookupFilterHeader(block_index, headers[i])) {
+            LogPrint(BCLog::NET, "Failed to find block filter header in index: filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filter_type), block_index->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::CFCHECKPT,
+                                                                            filter_type_ser,
+                                                                            stop_index->GetBlockHash(),
+                                                                            headers));
+}
+
+// Tier two messages whose handlers do their own locking and hold cs_main only briefly, if at all.
+// They are processed by the async message workers when there are some: in order among themselves,
+// but not with the other messages of the peer.
+static bool IsAsyncTierTwoMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::QSIGSHARESINV ||
+           strCommand == NetMsgType::QGETSIGSHARES ||
+           strCommand == NetMsgType::QBSIGSHARES ||
+           strCommand == NetMsgType::QSIGREC ||
+           strCommand == NetMsgType::CLSIG ||
+           strCommand == NetMsgType::QCONTRIB ||
+           strCommand == NetMsgType::QCOMPLAINT ||
+           strCommand == NetMsgType::QJUSTIFICATION ||
+           strCommand == NetMsgType::QPCOMMITMENT;
+}
+
 bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vRecv, int64_t nTimeReceived, CConnman* connman, std::atomic<bool>& interruptMsgProc)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
@@ -1330,6 +1953,12 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             connman->PushMessage(pfrom, msg_maker.Make(NetMsgType::SENDADDRV2));
         }
 
+        TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker();
+        if (txreconciliation && nVersion >= TXRECONCILIATION_PROTO_VERSION && fRelay && pfrom->CanRelay()) {
+            const uint64_t nReconSalt = txreconciliation->PreRegisterPeer(pfrom->GetId());
+            connman->PushMessage(pfrom, msg_maker.Make(NetMsgType::SENDTXRCNCL, TXRECONCILIATION_VERSION, nReconSalt));
+        }
+
         connman->PushMessage(pfrom, msg_maker.Make(NetMsgType::VERACK));
 
         pfrom->nServices = nServices;
@@ -1450,6 +2079,12 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             CMNAuth::PushMNAUTH(pfrom, *connman);
         }
 
+        if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION && pfrom->CanRelay()) {
+            // Tell the peer we can take cmpctblocks, announcing with inv for now.
+            // It is asked for cmpctblock announcements once it sends us a valid block.
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDCMPCT, false, CMPCTBLOCKS_VERSION));
+        }
+
         pfrom->fSuccessfullyConnected = true;
         LogPrintf("New outbound peer connected: version: %d, blocks=%d, peer=%d%s\n",
                   pfrom->nVersion.load(), pfrom->nStartingHeight, pfrom->GetId(),
@@ -1462,6 +2097,31 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         return true;
     }
 
+    else if (strCommand == NetMsgType::SENDCMPCT) {
+        bool fAnnounceUsingCMPCTBLOCK = false;
+        uint64_t nCMPCTBLOCKVersion = 0;
+        vRecv >> fAnnounceUsingCMPCTBLOCK >> nCMPCTBLOCKVersion;
+        if (nCMPCTBLOCKVersion == CMPCTBLOCKS_VERSION) {
+            LOCK(cs_main);
+            CNodeState* nodestate = State(pfrom->GetId());
+            nodestate->fSupportsCompactBlocks = true;
+            nodestate->fPreferCompactBlocks = fAnnounceUsingCMPCTBLOCK;
+        }
+        return true;
+    }
+
+    else if (strCommand == NetMsgType::SENDTXRCNCL) {
+        uint32_t nReconVersion;
+        uint64_t nReconSalt;
+        vRecv >> nReconVersion >> nReconSalt;
+        TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker();
+        // Only before verack. The side that opened the connection initiates the reconciliations.
+        if (txreconciliation && !pfrom->fSuccessfullyConnected) {
+            txreconciliation->RegisterPeer(pfrom->GetId(), !pfrom->fInbound, nReconVersion, nReconSalt);
+        }
+        return true;
+    }
+
     else if (!pfrom->fSuccessfullyConnected)
     {
         // Must have a verack message before anything else
@@ -1595,6 +2255,12 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         LOCK(cs_main);
 
         std::vector<CInv> vToFetch;
+        const auto current_time = GetTime<std::chrono::microseconds>();
+        TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker();
+
+        // A single new block announced by a peer at the tip: ask for it as a cmpctblock
+        const bool fFetchCompact = State(pfrom->GetId())->fSupportsCompactBlocks && !IsInitialBlockDownload() &&
+                std::count_if(vInv.begin(), vInv.end(), [](const CInv& inv) { return inv.type == MSG_BLOCK; }) == 1;
 
         for (unsigned int nInv = 0; nInv < vInv.size(); nInv++) {
             const CInv& inv = vInv[nInv];
@@ -1609,6 +2275,9 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             }
 
             pfrom->AddInventoryKnown(inv);
+            if (inv.type == MSG_TX && txreconciliation) {
+                txreconciliation->TryRemovingFromSet(pfrom->GetId(), inv.hash);
+            }
 
             bool fAlreadyHave = AlreadyHave(inv);
             LogPrint(BCLog::NET, "got inv: %s  %s peer=%d\n", inv.ToString(), fAlreadyHave ? "have" : "new", pfrom->GetId());
@@ -1617,7 +2286,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                 UpdateBlockAvailability(pfrom->GetId(), inv.hash);
                 if (!fAlreadyHave && !fImporting && !fReindex && !mapBlocksInFlight.count(inv.hash)) {
                     // Add this to the list of blocks to request
-                    vToFetch.push_back(inv);
+                    vToFetch.emplace_back(fFetchCompact ? MSG_CMPCT_BLOCK : MSG_BLOCK, inv.hash);
                     LogPrint(BCLog::NET, "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->GetId());
                 }
             } else {
@@ -1641,17 +2310,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                 if (!fAlreadyHave) {
                     bool allowWhileInIBD = allowWhileInIBDObjs.count(inv.type);
                     if (allowWhileInIBD || !IsInitialBlockDownload()) {
-                        int64_t doubleRequestDelay = 2 * 60 * 1000000;
-                        // some messages need to be re-requested faster when the first announcing peer did not answer to GETDATA
-                        switch (inv.type) {
-                        case MSG_QUORUM_RECOVERED_SIG:
-                            doubleRequestDelay = 5 * 1000000;
-                            break;
-                        case MSG_CLSIG:
-                            doubleRequestDelay = 5 * 1000000;
-                            break;
-                        }
-                        pfrom->AskFor(inv, doubleRequestDelay);
+                        AddInvAnnouncement(pfrom, inv, current_time, connman->GetTxRequestTracker());
                     }
                 }
             }
@@ -1683,7 +2342,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     }
 
 
-    else if (strCommand == NetMsgType::GETBLOCKS || strCommand == NetMsgType::GETHEADERS) {
+    else if (strCommand == NetMsgType::GETBLOCKS) {
 
         // Don't relay blocks inv to masternode-only connections
         if (!pfrom->CanRelay()) {
@@ -1701,70 +2360,74 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             return true;
         }
 
-        LOCK(cs_main);
+        const int nLimit = 500;
+        bool fStopped = false;
+        std::vector<CBlockIndex*> vBlocks;
+        {
+            LOCK(cs_main);
+            // Find the last block the caller has in the main chain, and send the rest of the chain
+            const CBlockIndex* pindexFork = FindForkInGlobalIndex(chainActive, locator);
+            const int nStartHeight = pindexFork ? pindexFork->nHeight + 1 : chainActive.Height() + 1;
+            LogPrint(BCLog::NET, "getblocks %d to %s limit %d from peer=%d\n", (nStartHeight <= chainActive.Height() ? nStartHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), nLimit, pfrom->GetId());
+            vBlocks = GetActiveChainRange(nStartHeight, nLimit, hashStop, false, fStopped);
+        }
 
-        // Find the last block the caller has in the main chain
-        CBlockIndex* pindex = FindForkInGlobalIndex(chainActive, locator);
-
-        // Send the rest of the chain
-        if (pindex)
-            pindex = chainActive.Next(pindex);
-        int nLimit = 500;
-        LogPrint(BCLog::NET, "getblocks %d to %s limit %d from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), nLimit, pfrom->GetId());
-        for (; pindex; pindex = chainActive.Next(pindex)) {
-            if (pindex->GetBlockHash() == hashStop) {
-                LogPrint(BCLog::NET, "  getblocks stopping at %d %s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-                break;
-            }
+        for (const CBlockIndex* pindex : vBlocks) {
             pfrom->PushInventory(CInv(MSG_BLOCK, pindex->GetBlockHash()));
-            if (--nLimit <= 0) {
-                // When this block is requested, we'll send an inv that'll make them
-                // getblocks the next batch of inventory.
-                LogPrint(BCLog::NET, "  getblocks stopping at limit %d %s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-                pfrom->hashContinue = pindex->GetBlockHash();
-                break;
-            }
+        }
+        if (fStopped) {
+            LogPrint(BCLog::NET, "  getblocks stopping at %s\n", hashStop.ToString());
+        } else if ((int)vBlocks.size() == nLimit) {
+            // When this block is requested, we'll send an inv that'll make them
+            // getblocks the next batch of inventory.
+            const CBlockIndex* pindexLast = vBlocks.back();
+            LogPrint(BCLog::NET, "  getblocks stopping at limit %d %s\n", pindexLast->nHeight, pindexLast->GetBlockHash().ToString());
+            pfrom->hashContinue = pindexLast->GetBlockHash();
         }
     }
 
 
-    else if (strCommand == NetMsgType::HEADERS && Params().HeadersFirstSyncingActive()) {
+    else if (strCommand == NetMsgType::GETHEADERS) {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
 
         if (locator.vHave.size() > MAX_LOCATOR_SZ) {
-            LogPrint(BCLog::NET, "getblocks locator size %lld > %d, disconnect peer=%d\n", locator.vHave.size(), MAX_LOCATOR_SZ, pfrom->GetId());
+            LogPrint(BCLog::NET, "getheaders locator size %lld > %d, disconnect peer=%d\n", locator.vHave.size(), MAX_LOCATOR_SZ, pfrom->GetId());
             pfrom->fDisconnect = true;
             return true;
         }
 
-        LOCK(cs_main);
-
-        if (IsInitialBlockDownload())
-            return true;
+        // Answered during our own IBD too: only the headers of the active chain are sent, which
+        // are those of validated blocks.
+        std::vector<CBlockIndex*> vBlocks;
+        {
+            LOCK(cs_main);
 
-        CBlockIndex* pindex = nullptr;
-        if (locator.IsNull()) {
-            // If locator is null, return the hashStop block
-            CBlockIndex* pindex = LookupBlockIndex(hashStop);
-            if (!pindex)
-                return true;
-        } else {
-            // Find the last block the caller has in the main chain
-            pindex = FindForkInGlobalIndex(chainActive, locator);
-            if (pindex)
-                pindex = chainActive.Next(pindex);
+            int nStartHeight;
+            if (locator.IsNull()) {
+                // If locator is null, return the hashStop block
+                const CBlockIndex* pindex = LookupBlockIndex(hashStop);
+                if (!pindex || !chainActive.Contains(pindex))
+                    return true;
+                nStartHeight = pindex->nHeight;
+            } else {
+                // Find the last block the caller has in the main chain
+                const CBlockIndex* pindexFork = FindForkInGlobalIndex(chainActive, locator);
+                nStartHeight = pindexFork ? pindexFork->nHeight + 1 : chainActive.Height() + 1;
+            }
+            LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", (nStartHeight <= chainActive.Height() ? nStartHeight : -1), hashStop.ToString(), pfrom->GetId());
+            bool fStopped;
+            vBlocks = GetActiveChainRange(nStartHeight, MAX_HEADERS_RESULTS, hashStop, true, fStopped);
         }
 
+        // The header fields of the block index entries don't change, and the entries are never deleted:
+        // the headers are built out of cs_main.
         // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
         std::vector<CBlock> vHeaders;
-        int nLimit = MAX_HEADERS_RESULTS;
-        LogPrintf("getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.ToString(), pfrom->GetId());
-        for (; pindex; pindex = chainActive.Next(pindex)) {
-            vHeaders.push_back(pindex->GetBlockHeader());
-            if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
-                break;
+        vHeaders.reserve(vBlocks.size());
+        for (const CBlockIndex* pindex : vBlocks) {
+            vHeaders.emplace_back(pindex->GetBlockHeader());
         }
         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
     }
@@ -1778,6 +2441,9 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
+        if (TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker()) {
+            txreconciliation->TryRemovingFromSet(pfrom->GetId(), inv.hash);
+        }
 
         LOCK2(cs_main, g_cs_orphans);
 
@@ -1785,8 +2451,8 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         bool fMissingInputs = false;
         CValidationState state;
 
-        pfrom->setAskFor.erase(inv.hash);
-        mapAlreadyAskedFor.erase(inv);
+        TxRequestTracker& txrequest = connman->GetTxRequestTracker();
+        txrequest.ReceivedResponse(pfrom->GetId(), inv);
 
         if (ptx->ContainsZerocoins()) {
             // Don't even try to check zerocoins at all.
@@ -1796,6 +2462,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
         if (AcceptToMemoryPool(mempool, state, ptx, true, &fMissingInputs, false, ignoreFees)) {
             mempool.check(pcoinsTip.get());
+            txrequest.ForgetInv(inv);
             RelayTransaction(tx, connman);
             for (unsigned int i = 0; i < tx.vout.size(); i++) {
                 vWorkQueue.emplace_back(inv.hash, i);
@@ -1878,7 +2545,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                 for (const uint256& parent_txid : unique_parents) {
                     CInv _inv(MSG_TX, parent_txid);
                     pfrom->AddInventoryKnown(_inv);
-                    if (!AlreadyHave(_inv)) pfrom->AskFor(_inv);
+                    if (!AlreadyHave(_inv)) AddInvAnnouncement(pfrom, _inv, GetTime<std::chrono::microseconds>(), txrequest);
                 }
                 AddOrphanTx(ptx, pfrom->GetId());
 
@@ -1921,7 +2588,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         }
     }
 
-    else if (strCommand == NetMsgType::HEADERS && Params().HeadersFirstSyncingActive() && !fImporting && !fReindex) // Ignore headers received while importing
+    else if (strCommand == NetMsgType::HEADERS && !fImporting && !fReindex) // Ignore headers received while importing
     {
         std::vector<CBlockHeader> headers;
 
@@ -1944,6 +2611,10 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             // Nothing interesting. Stop asking this peers for more headers.
             return true;
         }
+
+        // Only the headers up to the last checkpoint are accepted: the checkpoints pin them,
+        // while the PoS headers after it can't be checked without their block.
+        const int nLastCheckpointHeight = Checkpoints::GetTotalBlocksEstimate();
         CBlockIndex* pindexLast = nullptr;
         for (const CBlockHeader& header : headers) {
             CValidationState state;
@@ -1951,11 +2622,33 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                 Misbehaving(pfrom->GetId(), 20, "non-continuous headers sequence");
                 return false;
             }
+            CBlockIndex* pindexPrev = pindexLast ? pindexLast : LookupBlockIndex(header.hashPrevBlock);
+            if (!pindexPrev) {
+                LogPrint(BCLog::NET, "peer=%d: headers not connecting to our chain\n", pfrom->GetId());
+                return true;
+            }
+            if (pindexPrev->nHeight >= nLastCheckpointHeight) {
+                break;
+            }
+            // A PoS header is free to make: the new branches of header-only entries are capped per peer,
+            // and so is their length off the chain of headers the peer extends
+            const int nHeight = pindexPrev->nHeight + 1;
+            const uint256& hash = header.GetHash();
+            CNodeState* nodestate = State(pfrom->GetId());
+            if (Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_POS) &&
+                    !LookupBlockIndex(hash) && !(Checkpoints::fEnabled && Checkpoints::CheckBlock(nHeight, hash, true))) {
+                if (mapPrevBlockIndex.count(header.hashPrevBlock) && ++nodestate->nHeadersBranches > MAX_HEADERS_BRANCHES_PER_PEER) {
+                    Misbehaving(pfrom->GetId(), 20, strprintf("too many header branches (%d)", nodestate->nHeadersBranches));
+                    return false;
+                }
+                const int nBranchLength = GetHeadersBranchLength(pindexPrev, nodestate->pindexHeadersTip);
+                if (nBranchLength > MAX_HEADERS_BRANCH_LENGTH) {
+                    Misbehaving(pfrom->GetId(), 20, strprintf("header branch too long (%d)", nBranchLength));
+                    return false;
+                }
+            }
 
-            /*TODO: this has a CBlock cast on it so that it will compile. There should be a solution for this
-             * before headers are reimplemented on mainnet
-             */
-            if (!AcceptBlockHeader((CBlock)header, state, &pindexLast)) {
+            if (!AcceptBlockHeader(CBlock(header), state, &pindexLast, pindexPrev)) {
                 int nDoS;
                 if (state.IsInvalid(nDoS)) {
                     if (nDoS > 0) {
@@ -1966,17 +2659,26 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                     return false;
                 }
             }
+            if (pindexLast && GetHeadersBranchLength(pindexPrev, nodestate->pindexHeadersTip) == 0) {
+                nodestate->pindexHeadersTip = pindexLast;
+            }
         }
 
-        if (pindexLast)
-            UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
+        if (!pindexLast)
+            return true;
 
-        if (nCount == MAX_HEADERS_RESULTS && pindexLast) {
-            // Headers message had its maximum size; the peer may have more headers.
-            // TODO: optimize: if pindexLast is an ancestor of chainActive.Tip or pindexBestHeader, continue
-            // from there instead.
-            LogPrintf("more getheaders (%d) to end to peer=%d (startheight:%d)\n", pindexLast->nHeight, pfrom->GetId(), pfrom->nStartingHeight);
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexLast), UINT256_ZERO));
+        UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
+
+        if (pindexLast->nHeight < nLastCheckpointHeight) {
+            if (nCount == MAX_HEADERS_RESULTS) {
+                // Headers message had its maximum size; the peer may have more headers.
+                LogPrint(BCLog::NET, "more getheaders (%d) to end to peer=%d (startheight:%d)\n", pindexLast->nHeight, pfrom->GetId(), pfrom->nStartingHeight);
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexLast), UINT256_ZERO));
+            } else if (State(pfrom->GetId())->fHeadersFirstSync) {
+                // The chain up to the checkpoints is fixed: the peer doesn't have the one it advertised
+                LogPrintf("peer=%d has no headers after %d, below the last checkpoint, disconnecting\n", pfrom->GetId(), pindexLast->nHeight);
+                pfrom->fDisconnect = true;
+            }
         }
     }
 
@@ -1990,7 +2692,12 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
         // sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
         if (!mapBlockIndex.count(pblock->hashPrevBlock)) {
-            CBlockLocator locator = WITH_LOCK(cs_main, return chainActive.GetLocator(););
+            LOCK(cs_main);
+            if (IsHeadersFirstSync()) {
+                // The headers drive the download until the last checkpoint
+                return true;
+            }
+            CBlockLocator locator = chainActive.GetLocator();
             if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
                 // we already asked for this block, so lets work backwards and ask for the previous block
                 connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKS, locator, pblock->hashPrevBlock));
@@ -2002,13 +2709,45 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             }
         } else {
             pfrom->AddInventoryKnown(inv);
-            if (!mapBlockIndex.count(hashBlock)) {
-                {
-                    LOCK(cs_main);
+            bool fProcess = false;
+            bool fPipeline = false;
+            {
+                LOCK(cs_main);
+                const CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+                if ((!pindex || !(pindex->nStatus & BLOCK_HAVE_DATA)) && !setBlocksInPipeline.count(hashBlock)) {
+                    auto itInFlight = mapBlocksInFlight.find(hashBlock);
+                    const bool fRequested = itInFlight != mapBlocksInFlight.end() && itInFlight->second.first == pfrom->GetId();
                     MarkBlockAsReceived(hashBlock);
-                    mapBlockSource.emplace(hashBlock, pfrom->GetId());
+                    // The blocks of the headers first sync go through the pipeline, as well as the children
+                    // of the blocks in it (queued after them)
+                    const bool fParentInPipeline = setBlocksInPipeline.count(pblock->hashPrevBlock);
+                    if (pindex && !(pindex->pprev->nStatus & BLOCK_HAVE_DATA) && !fParentInPipeline) {
+                        // Downloaded ahead of its parent, from the header. If we didn't ask for it, it
+                        // will be requested again when the window gets to it.
+                        if (fRequested) {
+                            LogPrint(BCLog::NET, "block %s (%d) received before its parent, peer=%d\n", hashBlock.ToString(), pindex->nHeight, pfrom->GetId());
+                            mapBlocksWaitingParent.emplace(pblock->hashPrevBlock, WaitingBlock{hashBlock, pfrom->GetId(), pblock});
+                        }
+                        return true;
+                    } else {
+                        mapBlockSource.emplace(hashBlock, pfrom->GetId());
+                        fProcess = true;
+                        fPipeline = g_block_pipeline.IsRunning() && (IsHeadersFirstSync() || fParentInPipeline);
+                        if (fPipeline) setBlocksInPipeline.emplace(hashBlock);
+                    }
+                }
+            }
+            if (fPipeline && !g_block_pipeline.Push(pblock)) {
+                // Interrupted: processed here
+                WITH_LOCK(cs_main, setBlocksInPipeline.erase(hashBlock));
+                fPipeline = false;
+            }
+            if (fProcess) {
+                // Processed by the pipeline threads, or here
+                if (!fPipeline) {
+                    ProcessNewBlock(pblock, nullptr);
+                    ProcessBlocksWaitingParent(hashBlock);
                 }
-                ProcessNewBlock(pblock, nullptr);
 
                 // Disconnect node if its running an old protocol version,
                 // used during upgrades, when the node is already connected.
@@ -2019,6 +2758,191 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         }
     }
 
+    else if (strCommand == NetMsgType::CMPCTBLOCK && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+        const uint256& hashBlock = cmpctblock.header.GetHash();
+        CInv inv(MSG_BLOCK, hashBlock);
+        LogPrint(BCLog::NET, "received cmpctblock %s peer=%d\n", hashBlock.ToString(), pfrom->GetId());
+
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        {
+            LOCK(cs_main);
+            CBlockIndex* pindexPrev = LookupBlockIndex(cmpctblock.header.hashPrevBlock);
+            if (!pindexPrev) {
+                // Doesn't connect to our chain: sync to it with getblocks, as for full blocks
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKS, chainActive.GetLocator(), hashBlock));
+                pfrom->vBlockRequested.emplace_back(hashBlock);
+                return true;
+            }
+            pfrom->AddInventoryKnown(inv);
+            if (LookupBlockIndex(hashBlock)) {
+                LogPrint(BCLog::NET, "%s : Already processed block %s, skipping cmpctblock\n", __func__, hashBlock.ToString());
+                return true;
+            }
+
+            CNodeState* nodestate = State(pfrom->GetId());
+            auto itInFlight = mapBlocksInFlight.find(hashBlock);
+            const bool fInFlightFromPeer = itInFlight != mapBlocksInFlight.end() && itInFlight->second.first == pfrom->GetId();
+            const bool fInFlightFromOther = itInFlight != mapBlocksInFlight.end() && !fInFlightFromPeer;
+            const bool fCanRequest = fInFlightFromPeer || nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+
+            // The reconstruction from the mempool is only worth it for the next blocks of the chain:
+            // the other ones are downloaded in full, as announced with inv
+            const int nTipHeight = chainActive.Height();
+            if (!(pindexPrev->nStatus & BLOCK_HAVE_DATA) || pindexPrev->nHeight > nTipHeight ||
+                    pindexPrev->nHeight < nTipHeight - MAX_CMPCTBLOCK_DEPTH) {
+                if (itInFlight == mapBlocksInFlight.end() && fCanRequest) {
+                    MarkBlockAsInFlight(pfrom->GetId(), hashBlock);
+                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, std::vector<CInv>{inv}));
+                }
+                return true;
+            }
+
+            // The header is checked before the mempool is scanned for its transactions
+            CValidationState state;
+            if (!ContextualCheckBlockHeader(cmpctblock.header, state, pindexPrev)) {
+                int nDoS;
+                if (state.IsInvalid(nDoS) && nDoS > 0) {
+                    Misbehaving(pfrom->GetId(), nDoS, strprintf("invalid cmpctblock header %s", hashBlock.ToString()));
+                } else {
+                    LogPrint(BCLog::NET, "peer=%d: invalid cmpctblock header %s\n", pfrom->GetId(), hashBlock.ToString());
+                }
+                return true;
+            }
+
+            // A single partial block in flight per peer: the next ones are requested in full
+            bool fPartialInFlight = false;
+            for (const QueuedBlock& queued : nodestate->vBlocksInFlight) {
+                if (queued.partialBlock) {
+                    if (queued.hash == hashBlock) return true; // already reconstructing it
+                    fPartialInFlight = true;
+                }
+            }
+
+            PartiallyDownloadedBlock partialBlock(&mempool);
+            ReadStatus status = partialBlock.InitData(cmpctblock);
+            if (status == READ_STATUS_INVALID) {
+                MarkBlockAsReceived(hashBlock); // Reset in-flight state in case of whitelist
+                Misbehaving(pfrom->GetId(), 100, strprintf("invalid cmpctblock %s", hashBlock.ToString()));
+                return true;
+            }
+
+            BlockTransactionsRequest req;
+            if (status == READ_STATUS_OK) {
+                for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+                    if (!partialBlock.IsTxAvailable(i)) req.indexes.push_back(i);
+                }
+            }
+
+            if ((fInFlightFromOther || !fCanRequest) && (status != READ_STATUS_OK || !req.indexes.empty())) {
+                // Not reconstructed from the mempool alone: wait for the other download, or for room
+                // among the blocks in flight from this peer
+                return true;
+            }
+
+            if (status == READ_STATUS_OK && req.indexes.empty()) {
+                // Every transaction is known: the block is complete without any round trip
+                status = partialBlock.FillBlock(*pblock, {});
+            }
+
+            if (status != READ_STATUS_OK || (!req.indexes.empty() && fPartialInFlight)) {
+                // Short id collision, or another partial block in flight: get the full block
+                MarkBlockAsInFlight(pfrom->GetId(), hashBlock);
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, std::vector<CInv>{inv}));
+                return true;
+            }
+
+            if (!req.indexes.empty()) {
+                std::list<QueuedBlock>::iterator* queuedBlockIt = nullptr;
+                MarkBlockAsInFlight(pfrom->GetId(), hashBlock, nullptr, &queuedBlockIt);
+                (*queuedBlockIt)->partialBlock.reset(new PartiallyDownloadedBlock(std::move(partialBlock)));
+                req.blockhash = hashBlock;
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKTXN, req));
+                return true;
+            }
+
+            MarkBlockAsReceived(hashBlock);
+            mapBlockSource.emplace(hashBlock, pfrom->GetId());
+        }
+        ProcessNewBlock(pblock, nullptr);
+        ProcessBlocksWaitingParent(hashBlock);
+
+        // Disconnect node if its running an old protocol version,
+        // used during upgrades, when the node is already connected.
+        pfrom->DisconnectOldProtocol(pfrom->nVersion, ActiveProtocol());
+    }
+
+    else if (strCommand == NetMsgType::GETBLOCKTXN) {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        CBlock block;
+        {
+            LOCK(cs_main);
+            CBlockIndex* pindex = LookupBlockIndex(req.blockhash);
+            if (!pindex || !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block we don't have\n", pfrom->GetId());
+                return true;
+            }
+            if (!ReadBlockFromDisk(block, pindex))
+                assert(!"cannot load block from disk");
+            if (chainActive.Height() - pindex->nHeight > MAX_BLOCKTXN_DEPTH) {
+                // Only recent blocks are served in parts: the peer gets the whole block
+                LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block > %i deep\n", pfrom->GetId(), MAX_BLOCKTXN_DEPTH);
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
+                return true;
+            }
+        }
+
+        BlockTransactions resp(req);
+        for (size_t i = 0; i < req.indexes.size(); i++) {
+            if (req.indexes[i] >= block.vtx.size()) {
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), 100, strprintf("getblocktxn with out-of-bounds tx indices from peer=%d", pfrom->GetId()));
+                return true;
+            }
+            resp.txn[i] = block.vtx[req.indexes[i]];
+        }
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCKTXN, resp));
+    }
+
+    else if (strCommand == NetMsgType::BLOCKTXN && !fImporting && !fReindex) // Ignore blocks received while importing
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        {
+            LOCK(cs_main);
+            auto it = mapBlocksInFlight.find(resp.blockhash);
+            if (it == mapBlocksInFlight.end() || !it->second.second->partialBlock || it->second.first != pfrom->GetId()) {
+                LogPrint(BCLog::NET, "Peer %d sent us block transactions for block we weren't expecting\n", pfrom->GetId());
+                return true;
+            }
+
+            PartiallyDownloadedBlock& partialBlock = *it->second.second->partialBlock;
+            ReadStatus status = partialBlock.FillBlock(*pblock, resp.txn);
+            if (status == READ_STATUS_INVALID) {
+                MarkBlockAsReceived(resp.blockhash); // Reset in-flight state in case of whitelist
+                Misbehaving(pfrom->GetId(), 100, strprintf("invalid compact block/non-matching block transactions from peer=%d", pfrom->GetId()));
+                return true;
+            } else if (status == READ_STATUS_FAILED) {
+                // Might have collided, fall back to getdata now :(
+                it->second.second->partialBlock.reset();
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, std::vector<CInv>{CInv(MSG_BLOCK, resp.blockhash)}));
+                return true;
+            }
+
+            MarkBlockAsReceived(resp.blockhash);
+            mapBlockSource.emplace(resp.blockhash, pfrom->GetId());
+        }
+        LogPrint(BCLog::NET, "reconstructed block %s with %d transactions from peer=%d\n", resp.blockhash.ToString(), resp.txn.size(), pfrom->GetId());
+        ProcessNewBlock(pblock, nullptr);
+        ProcessBlocksWaitingParent(resp.blockhash);
+    }
+
     // This asymmetric behavior for inbound and outbound connections was introduced
     // to prevent a fingerprinting attack: an attacker can send specific fake addresses
     // to users' AddrMan and later request them by sending getaddr messages.
@@ -2036,6 +2960,56 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     }
 
 
+    else if (strCommand == NetMsgType::REQRECON) {
+        uint16_t nPeerSetSize, nPeerQ;
+        vRecv >> nPeerSetSize >> nPeerQ;
+        TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker();
+        ReconSketch sketch;
+        if (!txreconciliation || !txreconciliation->HandleReconciliationRequest(pfrom->GetId(), GetTime<std::chrono::microseconds>(),
+                                                                                 nPeerSetSize, nPeerQ, sketch)) {
+            // Out of sequence or too frequent: each request costs a sketch of the whole set, so it isn't
+            // answered. An honest peer can send it early (clock drift, request crossing our sketch), so
+            // ignoring it is enough.
+            LogPrint(BCLog::NET, "ignoring unexpected reqrecon from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SKETCH, sketch));
+    }
+
+
+    else if (strCommand == NetMsgType::SKETCH) {
+        ReconSketch sketch;
+        vRecv >> sketch;
+        TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker();
+        std::vector<uint256> vTxToAnnounce;
+        std::vector<uint32_t> vAskShortIds;
+        bool fSuccess = false;
+        if (!txreconciliation || !txreconciliation->HandleSketch(pfrom->GetId(), sketch, vTxToAnnounce, vAskShortIds, fSuccess)) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 20, "unexpected sketch");
+            return false;
+        }
+        AnnounceReconciledTxs(pfrom, vTxToAnnounce, connman);
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, fSuccess, vAskShortIds));
+    }
+
+
+    else if (strCommand == NetMsgType::RECONCILDIFF) {
+        bool fSuccess;
+        std::vector<uint32_t> vAskShortIds;
+        vRecv >> fSuccess >> vAskShortIds;
+        TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker();
+        std::vector<uint256> vTxToAnnounce;
+        if (!txreconciliation || vAskShortIds.size() > MAX_SKETCH_CELLS ||
+                !txreconciliation->HandleReconciliationDiff(pfrom->GetId(), fSuccess, vAskShortIds, vTxToAnnounce)) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 20, "unexpected reconcildiff");
+            return false;
+        }
+        AnnounceReconciledTxs(pfrom, vTxToAnnounce, connman);
+    }
+
+
     else if (strCommand == NetMsgType::MEMPOOL) {
 
         if (!(pfrom->GetLocalServices() & NODE_BLOOM) && !pfrom->fWhitelisted) {
@@ -2181,9 +3155,28 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         pfrom->fRelayTxes = true;
     }
 
+    else if (strCommand == NetMsgType::GETCFILTERS) {
+        ProcessGetCFilters(pfrom, vRecv, connman);
+    }
+
+    else if (strCommand == NetMsgType::GETCFHEADERS) {
+        ProcessGetCFHeaders(pfrom, vRecv, connman);
+    }
+
+    else if (strCommand == NetMsgType::GETCFCHECKPT) {
+        ProcessGetCFCheckPt(pfrom, vRecv, connman);
+    }
+
     else if (strCommand == NetMsgType::NOTFOUND) {
-        // We do not care about the NOTFOUND message (for now), but logging an Unknown Command
-        // message is undesirable as we transmit it ourselves.
+        // Ask the next peer announcing the items, instead of waiting for the requests to expire
+        std::vector<CInv> vInv;
+        vRecv >> vInv;
+        if (vInv.size() <= MAX_INV_SZ) {
+            TxRequestTracker& txrequest = connman->GetTxRequestTracker();
+            for (const CInv& inv : vInv) {
+                if (inv.type != MSG_BLOCK) txrequest.ReceivedResponse(pfrom->GetId(), inv);
+            }
+        }
         return true;
     }
 
@@ -2191,6 +3184,10 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         // Tier two msg type search
         const std::vector<std::string>& allMessages = getTierTwoNetMessageTypes();
         if (std::find(allMessages.begin(), allMessages.end(), strCommand) != allMessages.end()) {
+            if (connman->HasAsyncMessageWorkers() && IsAsyncTierTwoMessage(strCommand)) {
+                connman->PushAsyncMessage(pfrom, strCommand, std::move(vRecv), nTimeReceived);
+                return true;
+            }
             // Check if the dispatcher can process this message first. If not, try going with the old flow.
             if (!masternodeSync.MessageDispatcher(pfrom, strCommand, vRecv)) {
                 // Probably one the extensions, future: encapsulate all of this inside tiertwo_networksync.
@@ -2267,15 +3264,17 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     //  (x) data
     //
     bool fMoreWork = false;
+    bool fThrottled = false;
 
     if (!pfrom->vRecvGetData.empty())
-        ProcessGetData(pfrom, connman, interruptMsgProc);
+        fThrottled = !ProcessGetData(pfrom, connman, interruptMsgProc);
 
     if (pfrom->fDisconnect)
         return false;
 
     // this maintains the order of responses
-    if (!pfrom->vRecvGetData.empty()) return true;
+    // (a throttled peer has no more work until its filtered block credit is refilled)
+    if (!pfrom->vRecvGetData.empty()) return !fThrottled;
 
     // Don't bother if send buffer is too full to respond anyway
     if (pfrom->fPauseSend)
@@ -2289,7 +3288,10 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         // Just take one message
         msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
         pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+        bool fWasPaused = pfrom->fPauseRecv;
         pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+        // the socket may already hold more data, which signals no new event
+        if (fWasPaused && !pfrom->fPauseRecv) connman->WakeSelect();
         fMoreWork = !pfrom->vProcessMsg.empty();
     }
     CNetMessage& msg(msgs.front());
@@ -2327,6 +3329,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
 
     // Process message
     bool fRet = false;
+    const int64_t nTimeStart = GetTimeMicros();
     try {
         fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, connman, interruptMsgProc);
         if (interruptMsgProc)
@@ -2348,6 +3351,11 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     } catch (...) {
         PrintExceptionContinue(nullptr, "ProcessMessages()");
     }
+    // The async workers record the messages they process
+    if (!connman->HasAsyncMessageWorkers() || !IsAsyncTierTwoMessage(strCommand)) {
+        connman->GetMsgStats().Record(strCommand, nMessageSize + CMessageHeader::HEADER_SIZE, nTimeStart - msg.nTime,
+                                      GetTimeMicros() - nTimeStart);
+    }
 
     if (!fRet) {
         LogPrint(BCLog::NET, "ProcessMessage(%s, %u bytes) FAILED peer=%d\n", SanitizeString(strCommand), nMessageSize,
@@ -2360,6 +3368,27 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     return fMoreWork;
 }
 
+void PeerLogicValidation::ProcessAsyncMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
+{
+    try {
+        std::string command = strCommand;
+        masternodeSync.MessageDispatcher(pfrom, command, vRecv);
+    } catch (const std::ios_base::failure& e) {
+        if (strstr(e.what(), "end of data") || strstr(e.what(), "size too large")) {
+            LogPrint(BCLog::NET, "ProcessAsyncMessage(%s): Exception '%s' caught\n", SanitizeString(strCommand), e.what());
+        } else {
+            PrintExceptionContinue(&e, "ProcessAsyncMessage()");
+        }
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessAsyncMessage()");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "ProcessAsyncMessage()");
+    }
+
+    LOCK(cs_main);
+    DisconnectIfBanned(pfrom, connman);
+}
+
 class CompareInvMempoolOrder
 {
     CTxMemPool *mp;
@@ -2472,11 +3501,20 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
             if ((nSyncStarted == 0 && fFetch) || pindexBestHeader->GetBlockTime() > GetAdjustedTime() - 6 * 60 * 60) { // NOTE: was "close to today" and 24h in Bitcoin
                 state.fSyncStarted = true;
                 nSyncStarted++;
-                //CBlockIndex *pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
-                //LogPrint(BCLog::NET, "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->GetId(), pto->nStartingHeight);
-                //pto->PushMessage(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexStart), UINT256_ZERO);
-                connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETBLOCKS, chainActive.GetLocator(chainActive.Tip()), UINT256_ZERO));
+                if (IsHeadersFirstSync() && pto->nVersion >= HEADERS_FIRST_VERSION &&
+                        pto->nStartingHeight >= Checkpoints::GetTotalBlocksEstimate()) {
+                    state.fHeadersFirstSync = true;
+                    const CBlockIndex* pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
+                    LogPrint(BCLog::NET, "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->GetId(), pto->nStartingHeight);
+                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexStart), UINT256_ZERO));
+                } else {
+                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETBLOCKS, chainActive.GetLocator(chainActive.Tip()), UINT256_ZERO));
+                }
             }
+        } else if (state.fHeadersFirstSync && !IsHeadersFirstSync()) {
+            // Past the last checkpoint, go on with getblocks
+            state.fHeadersFirstSync = false;
+            connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETBLOCKS, chainActive.GetLocator(chainActive.Tip()), UINT256_ZERO));
         }
 
         // Resend wallet transactions that haven't gotten in a block yet
@@ -2556,6 +3594,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
 
             // Determine transactions to relay
             if (fSendTrickle) {
+                TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker();
                 // Produce a vector with all candidates for sending
                 std::vector<std::set<uint256>::iterator> vInvTx;
                 vInvTx.reserve(pto->setInventoryTxToSend.size());
@@ -2589,6 +3628,11 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                     }
                     // todo: back port feerate filter.
                     if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
+                    // Announced by the next reconciliation, unless the set is full
+                    if (txreconciliation && txreconciliation->AddToSet(pto->GetId(), hash)) {
+                        pto->filterInventoryKnown.insert(hash);
+                        continue;
+                    }
                     // Send
                     vInv.emplace_back(CInv(MSG_TX, hash));
                     nRelayedTransactions++;
@@ -2603,6 +3647,19 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         if (!vInv.empty())
             connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
 
+        // Message: reqrecon
+        if (TxReconciliationTracker* txreconciliation = connman->GetTxReconciliationTracker()) {
+            if (txreconciliation->HasReconciliationTimedOut(pto->GetId(), current_time)) {
+                LogPrintf("Timeout waiting for the sketch of peer=%d, disconnecting\n", pto->GetId());
+                pto->fDisconnect = true;
+                return true;
+            }
+            const auto request = txreconciliation->InitiateReconciliationRequest(pto->GetId(), current_time);
+            if (request) {
+                connman->PushMessage(pto, msgMaker.Make(NetMsgType::REQRECON, request->first, request->second));
+            }
+        }
+
         // Detect whether we're stalling
         current_time = GetTime<std::chrono::microseconds>();
         nNow = GetTimeMicros();
@@ -2630,6 +3687,16 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         //
         std::vector<CInv> vGetData;
         if (!pto->fClient && pto->CanRelay() && fFetch && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+            if (IsHeadersFirstSync()) {
+                // Below the checkpoints there is a single chain: a peer that started past our highest
+                // checkpointed header has its block, and can serve the window up to it. If it doesn't,
+                // it stalls the download and is disconnected.
+                const CBlockIndex* pcheckpoint = GetLastCheckpoint();
+                if (pcheckpoint && pto->nStartingHeight >= pcheckpoint->nHeight &&
+                        (!state.pindexBestKnownBlock || state.pindexBestKnownBlock->nChainWork < pcheckpoint->nChainWork)) {
+                    state.pindexBestKnownBlock = pcheckpoint;
+                }
+            }
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
             FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
@@ -2650,8 +3717,9 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         //
         // Message: getdata (non-blocks)
         //
-        while (!pto->mapAskFor.empty() && (*pto->mapAskFor.begin()).first <= nNow) {
-            const CInv& inv = (*pto->mapAskFor.begin()).second;
+        TxRequestTracker& txrequest = connman->GetTxRequestTracker();
+        std::vector<std::pair<NodeId, CInv>> expired;
+        for (const CInv& inv : txrequest.GetRequestable(pto->GetId(), current_time, &expired)) {
             if (!AlreadyHave(inv)) {
                 LogPrint(BCLog::NET, "Requesting %s peer=%d\n", inv.ToString(), pto->GetId());
                 vGetData.push_back(inv);
@@ -2659,11 +3727,14 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                     connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETDATA, vGetData));
                     vGetData.clear();
                 }
+                txrequest.RequestedTx(pto->GetId(), inv, GetRequestExpiry(inv, current_time));
             } else {
-                //If we're not going to ask, don't expect a response.
-                pto->setAskFor.erase(inv.hash);
+                // Nobody needs to be asked
+                txrequest.ForgetInv(inv);
             }
-            pto->mapAskFor.erase(pto->mapAskFor.begin());
+        }
+        for (const auto& entry : expired) {
+            LogPrint(BCLog::NET, "timeout of inflight %s from peer=%d\n", entry.second.ToString(), entry.first);
         }
         if (!vGetData.empty())
             connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETDATA, vGetData));
@@ -49,6 +49,8 @@ public:
     void FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTime) override;
     /** Process protocol messages received from a given node */
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override;
+    /** Process a tier two message queued by ProcessMessages to the async message workers */
+    void ProcessAsyncMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv) override;
     /**
     * Send queued protocol messages to be sent to a give node.
     *
@@ -73,6 +75,13 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch, const std::string& message="") EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 bool IsBanned(NodeId nodeid);
+/**
+ * Length of the branch of the header on top of pindexPrev, from its fork with the chain of headers
+ * pindexHeadersTip a peer extends (0 when it extends that chain).
+ */
+int GetHeadersBranchLength(const CBlockIndex* pindexPrev, const CBlockIndex* pindexHeadersTip);
+/** Start g_block_pipeline, connecting the blocks of the headers first sync downloaded from the peers (-blockpipeline) */
+void StartBlockPipeline();
 
 
 using SecondsDouble = std::chrono::duration<double, std::chrono::seconds::period>;
@@ -11,6 +11,8 @@
 #endif
 
 #include "compat.h"
+#include "crypto/siphash.h"
+#include "random.h"
 #include "serialize.h"
 #include "span.h"
 #include "prevector.h"
@@ -246,6 +248,7 @@ public:
     }
 
 friend class CSubNet;
+friend class CNetAddrHash;
 
 private:
     /**
@@ -511,4 +514,27 @@ public:
     }
 };
 
+/** Salted hasher of the addresses, for the unordered containers */
+class CNetAddrHash
+{
+public:
+    CNetAddrHash()
+        : m_salt_k0{GetRand(std::numeric_limits<uint64_t>::max())},
+          m_salt_k1{GetRand(std::numeric_limits<uint64_t>::max())}
+    {
+    }
+
+    size_t operator()(const CNetAddr& a) const noexcept
+    {
+        CSipHasher hasher(m_salt_k0, m_salt_k1);
+        hasher.Write(a.m_net);
+        hasher.Write(a.m_addr.data(), a.m_addr.size());
+        return static_cast<size_t>(hasher.Finalize());
+    }
+
+private:
+    const uint64_t m_salt_k0;
+    const uint64_t m_salt_k1;
+};
+
 #endif // PIVX_NETADDRESS_H
@@ -0,0 +1,64 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netbuffers.h"
+
+// The class of the buffers able to hold nSize bytes
+static size_t ClassForSize(size_t nSize)
+{
+    size_t nClass = 0;
+    while (nClass < CNetBufferPool::CLASS_COUNT && (CNetBufferPool::MIN_CLASS_SIZE << nClass) < nSize) {
+        nClass++;
+    }
+    return nClass;
+}
+
+CSerializeData CNetBufferPool::Get(size_t nSize)
+{
+    const size_t nClass = ClassForSize(nSize);
+    {
+        LOCK(cs);
+        // the larger ones fit too
+        for (size_t i = nClass; i < CLASS_COUNT; i++) {
+            if (vFree[i].empty()) continue;
+            CSerializeData data = std::move(vFree[i].back());
+            vFree[i].pop_back();
+            stats.nReused++;
+            stats.nBuffers--;
+            stats.nBytes -= data.capacity();
+            return data;
+        }
+        stats.nAllocated++;
+    }
+    CSerializeData data;
+    // rounded up to the class, for the next messages
+    data.reserve(nClass < CLASS_COUNT ? MIN_CLASS_SIZE << nClass : nSize);
+    return data;
+}
+
+void CNetBufferPool::Put(CSerializeData&& data)
+{
+    const size_t nCapacity = data.capacity();
+    if (nCapacity < MIN_CLASS_SIZE) return;
+    // The class of the buffers this one can hold, the capacity is rounded down
+    size_t nClass = ClassForSize(nCapacity);
+    if (nClass < CLASS_COUNT && (MIN_CLASS_SIZE << nClass) > nCapacity) nClass--;
+
+    // Not kept, the buffer is freed by the caller, out of the lock
+    LOCK(cs);
+    if (nClass == CLASS_COUNT || vFree[nClass].size() >= MAX_BUFFERS_PER_CLASS || stats.nBytes + nCapacity > MAX_POOLED_BYTES) {
+        stats.nFreed++;
+        return;
+    }
+    data.clear();
+    vFree[nClass].emplace_back(std::move(data));
+    stats.nBuffers++;
+    stats.nBytes += nCapacity;
+}
+
+CNetBufferPool::Stats CNetBufferPool::GetStats() const
+{
+    LOCK(cs);
+    return stats;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_NETBUFFERS_H
+#define PIVX_NETBUFFERS_H
+
+#include "support/allocators/zeroafterfree.h"
+#include "sync.h"
+
+#include <array>
+#include <vector>
+
+/**
+ * Recycles the storage of the buffers of the received network messages, so that the socket thread
+ * doesn't allocate (and the message handler thread free and zero) the buffers of every message.
+ * The free buffers are kept by size class, the powers of two of their capacity from 256 B to 4 MiB,
+ * up to a number per class and a total size: the others are freed as usual.
+ */
+class CNetBufferPool
+{
+public:
+    static const size_t MIN_CLASS_SIZE = 256;
+    static const size_t CLASS_COUNT = 15;
+    static const size_t MAX_BUFFERS_PER_CLASS = 64;
+    static const size_t MAX_POOLED_BYTES = 16 << 20;
+
+    struct Stats {
+        uint64_t nReused{0};    //! buffers handed out from the free ones
+        uint64_t nAllocated{0}; //! buffers allocated, with no free one of the size
+        uint64_t nFreed{0};     //! buffers given back and freed, over the limits
+        size_t nBuffers{0};     //! free buffers kept
+        size_t nBytes{0};       //! capacity of the free buffers kept
+    };
+
+    static CNetBufferPool& Instance()
+    {
+        static CNetBufferPool instance;
+        return instance;
+    }
+
+    //! An empty buffer with a capacity of at least nSize
+    CSerializeData Get(size_t nSize);
+    //! Give back the storage of a buffer, to be reused
+    void Put(CSerializeData&& data);
+
+    Stats GetStats() const;
+
+private:
+    mutable Mutex cs;
+    std::array<std::vector<CSerializeData>, CLASS_COUNT> vFree GUARDED_BY(cs);
+    Stats stats GUARDED_BY(cs);
+};
+
+#endif // PIVX_NETBUFFERS_H
@@ -0,0 +1,123 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netmsgstats.h"
+
+#include "protocol.h"
+#include "tinyformat.h"
+
+static const std::string NET_COMPONENT_CORE = "core";
+
+constexpr std::array<int64_t, 12> CNetMsgStats::HistogramBounds::VALUES;
+
+static std::string BucketName(int64_t nMicros)
+{
+    return nMicros < 1000 ? strprintf("%dus", nMicros) : strprintf("%dms", nMicros / 1000);
+}
+
+UniValue CNetMsgStats::HistogramToJson(const Histogram& h)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("count", (int64_t)h.nCount);
+    obj.pushKV("avg_us", h.GetAverageMicros());
+    obj.pushKV("max_us", h.nMaxMicros);
+    obj.pushKV("total_ms", h.nTotalMicros / 1000);
+    const auto& bounds = HistogramBounds::VALUES;
+    UniValue histogram(UniValue::VOBJ);
+    for (size_t i = 0; i < Histogram::BUCKET_COUNT; i++) {
+        std::string strBucket = i < bounds.size() ? "<=" + BucketName(bounds[i]) : ">" + BucketName(bounds.back());
+        histogram.pushKV(strBucket, (int64_t)h.vBuckets[i]);
+    }
+    obj.pushKV("histogram", histogram);
+    return obj;
+}
+
+void CNetMsgStats::MsgStats::Add(size_t nSize, int64_t nWaitMicros, int64_t nProcessMicros)
+{
+    nBytes += nSize;
+    wait.Add(nWaitMicros);
+    process.Add(nProcessMicros);
+}
+
+UniValue CNetMsgStats::MsgStats::ToJson() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("count", (int64_t)process.nCount);
+    obj.pushKV("bytes", (int64_t)nBytes);
+    obj.pushKV("wait", HistogramToJson(wait));
+    obj.pushKV("process", HistogramToJson(process));
+    return obj;
+}
+
+CNetMsgStats::CNetMsgStats()
+{
+    // The map doesn't grow past the known message types
+    for (const std::string& strCommand : getAllNetMessageTypes()) {
+        mapMsgStats[strCommand];
+        mapComponentStats[GetComponentName(strCommand)];
+    }
+    mapMsgStats[NET_MESSAGE_COMMAND_OTHER];
+}
+
+const char* CNetMsgStats::GetComponentName(const std::string& strCommand)
+{
+    static const std::map<std::string, const char*> mapComponents = {
+        {NetMsgType::SPORK, "sporks"},
+        {NetMsgType::GETSPORKS, "sporks"},
+        {NetMsgType::MNBROADCAST, "masternodes"},
+        {NetMsgType::MNBROADCAST2, "masternodes"},
+        {NetMsgType::MNPING, "masternodes"},
+        {NetMsgType::GETMNLIST, "masternodes"},
+        {NetMsgType::MNWINNER, "payments"},
+        {NetMsgType::GETMNWINNERS, "payments"},
+        {NetMsgType::BUDGETPROPOSAL, "budget"},
+        {NetMsgType::BUDGETVOTE, "budget"},
+        {NetMsgType::BUDGETVOTESYNC, "budget"},
+        {NetMsgType::FINALBUDGET, "budget"},
+        {NetMsgType::FINALBUDGETVOTE, "budget"},
+        {NetMsgType::SYNCSTATUSCOUNT, "sync"},
+        {NetMsgType::MNAUTH, "mnauth"},
+        {NetMsgType::QFCOMMITMENT, "quorums"},
+        {NetMsgType::QSENDRECSIGS, "quorums"},
+        {NetMsgType::QCONTRIB, "dkg"},
+        {NetMsgType::QCOMPLAINT, "dkg"},
+        {NetMsgType::QJUSTIFICATION, "dkg"},
+        {NetMsgType::QPCOMMITMENT, "dkg"},
+        {NetMsgType::QSIGSHARESINV, "sigshares"},
+        {NetMsgType::QGETSIGSHARES, "sigshares"},
+        {NetMsgType::QBSIGSHARES, "sigshares"},
+        {NetMsgType::QSIGREC, "signing"},
+        {NetMsgType::CLSIG, "chainlocks"},
+    };
+    auto it = mapComponents.find(strCommand);
+    return it != mapComponents.end() ? it->second : NET_COMPONENT_CORE.c_str();
+}
+
+void CNetMsgStats::Record(const std::string& strCommand, size_t nSize, int64_t nWaitMicros, int64_t nProcessMicros)
+{
+    LOCK(cs);
+    auto it = mapMsgStats.find(strCommand);
+    if (it == mapMsgStats.end()) {
+        it = mapMsgStats.find(NET_MESSAGE_COMMAND_OTHER);
+    }
+    it->second.Add(nSize, nWaitMicros, nProcessMicros);
+    mapComponentStats[GetComponentName(strCommand)].Add(nSize, nWaitMicros, nProcessMicros);
+}
+
+UniValue CNetMsgStats::ToJson() const
+{
+    LOCK(cs);
+    UniValue messages(UniValue::VOBJ);
+    for (const auto& p : mapMsgStats) {
+        if (p.second.process.nCount) messages.pushKV(p.first, p.second.ToJson());
+    }
+    UniValue components(UniValue::VOBJ);
+    for (const auto& p : mapComponentStats) {
+        if (p.second.process.nCount) components.pushKV(p.first, p.second.ToJson());
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("messages", messages);
+    ret.pushKV("components", components);
+    return ret;
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_NETMSGSTATS_H
+#define PIVX_NETMSGSTATS_H
+
+#include "histogram.h"
+#include "sync.h"
+
+#include <univalue.h>
+
+#include <array>
+#include <map>
+#include <string>
+
+// The message types the node doesn't know, recorded together
+const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
+
+/**
+ * Time spent by the received messages waiting in the process queues, from their reception to the start of their
+ * processing, and time spent processing them, aggregated in a histogram per message type and per component handling
+ * it (the tier two managers, or the core for the other messages).
+ * The messages processed by the async message workers are recorded by the worker only, their wait includes the queue
+ * of the message handler thread.
+ * The unknown message types are recorded together as "*other*", so that the peers can't grow the stats.
+ */
+class CNetMsgStats
+{
+private:
+    struct HistogramBounds {
+        static constexpr std::array<int64_t, 12> VALUES{{50, 100, 250, 500, 1000, 2000, 5000, 10000, 25000,
+                                                          100000, 500000, 1000000}};
+    };
+    typedef FixedHistogram<HistogramBounds> Histogram;
+
+    static UniValue HistogramToJson(const Histogram& h);
+
+    struct MsgStats {
+        uint64_t nBytes{0};
+        Histogram wait;
+        Histogram process;
+
+        void Add(size_t nSize, int64_t nWaitMicros, int64_t nProcessMicros);
+        UniValue ToJson() const;
+    };
+
+    mutable Mutex cs;
+    std::map<std::string, MsgStats> mapMsgStats GUARDED_BY(cs);
+    std::map<std::string, MsgStats> mapComponentStats GUARDED_BY(cs);
+
+public:
+    CNetMsgStats();
+
+    // The component handling a message type, for the aggregated stats
+    static const char* GetComponentName(const std::string& strCommand);
+
+    void Record(const std::string& strCommand, size_t nSize, int64_t nWaitMicros, int64_t nProcessMicros);
+    UniValue ToJson() const;
+};
+
+#endif // PIVX_NETMSGSTATS_H
@@ -21,13 +21,19 @@
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
 
+#include <atomic>
+#include <fstream>
+#include <iostream>
 #include <stdio.h>
+#include <thread>
 
 #include <boost/algorithm/string.hpp>
 
 static bool fCreateBlank;
 static std::map<std::string, UniValue> registers;
 static const int CONTINUE_EXECUTION=-1;
+// Inputs of a transaction below which they are signed in the calling thread
+static const size_t MIN_PARALLEL_SIGN_INPUTS = 4;
 
 //
 // This function returns either one of EXIT_ codes when it's expected to stop the process or
@@ -55,12 +61,16 @@ static int AppInitRawTx(int argc, char* argv[])
         std::string strUsage = PACKAGE_NAME " pivx-tx utility version " + FormatFullVersion() + "\n\n" +
                                "Usage:  pivx-tx [options] <hex-tx> [commands]  Update hex-encoded pivx transaction\n" +
                                "or:     pivx-tx [options] -create [commands]   Create hex-encoded pivx transaction\n" +
+                               "or:     pivx-tx [options] -batch=<file>        Process the transactions of <file>, one per line\n" +
                                "\n";
 
         fprintf(stdout, "%s", strUsage.c_str());
 
         strUsage = HelpMessageGroup("Options:");
         strUsage += HelpMessageOpt("-?", "This help message");
+        strUsage += HelpMessageOpt("-batch=<file>", "Read the transactions to process from <file> (\"-\" for standard input), one per line: "
+            "<hex-tx> [commands] or -create [commands], separated by spaces. A line of register commands only sets the "
+            "registers for the next lines. Outputs one transaction per line.");
         strUsage += HelpMessageOpt("-create", "Create new, empty TX.");
         strUsage += HelpMessageOpt("-json", "Select JSON output");
         strUsage += HelpMessageOpt("-txid", "Output only the hex-encoded transaction id of the resultant transaction.");
@@ -439,6 +449,57 @@ static CAmount AmountFromValue(const UniValue& value)
     return nAmount;
 }
 
+// Run func for each input, on a thread per core if the transaction has enough of them
+static void ForEachInput(size_t nInputs, const std::function<void(size_t)>& func)
+{
+    const size_t nThreads = nInputs < MIN_PARALLEL_SIGN_INPUTS ? 1 : std::min(nInputs, (size_t)std::max(GetNumCores(), 1));
+    if (nThreads <= 1) {
+        for (size_t i = 0; i < nInputs; i++) {
+            func(i);
+        }
+        return;
+    }
+    std::atomic<size_t> nNext{0};
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads);
+    for (size_t t = 0; t < nThreads; t++) {
+        threads.emplace_back([&]() {
+            for (size_t i = nNext++; i < nInputs; i = nNext++) {
+                func(i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// The keystore of the privatekeys register, kept while the register is unchanged (-batch)
+static std::string strCachedPrivateKeys;
+static std::unique_ptr<CBasicKeyStore> cachedKeystore;
+
+static CBasicKeyStore& GetPrivateKeysKeystore(const UniValue& keysObj)
+{
+    std::string strKeys = keysObj.write();
+    if (cachedKeystore && strKeys == strCachedPrivateKeys) {
+        return *cachedKeystore;
+    }
+
+    std::unique_ptr<CBasicKeyStore> keystore(new CBasicKeyStore());
+    for (unsigned int kidx = 0; kidx < keysObj.size(); kidx++) {
+        if (!keysObj[kidx].isStr())
+            throw std::runtime_error("privatekey not a string");
+        CKey key = KeyIO::DecodeSecret(keysObj[kidx].getValStr());
+        if (!key.IsValid()) {
+            throw std::runtime_error("privatekey not valid");
+        }
+        keystore->AddKey(key);
+    }
+    cachedKeystore = std::move(keystore);
+    strCachedPrivateKeys = std::move(strKeys);
+    return *cachedKeystore;
+}
+
 static void MutateTxSign(CMutableTransaction& tx, const std::string& flagStr)
 {
     int nHashType = SIGHASH_ALL;
@@ -460,20 +521,9 @@ static void MutateTxSign(CMutableTransaction& tx, const std::string& flagStr)
     if (!registers.count("privatekeys"))
         throw std::runtime_error("privatekeys register variable must be set.");
     bool fGivenKeys = false;
-    CBasicKeyStore tempKeystore;
-    UniValue keysObj = registers["privatekeys"];
+    CBasicKeyStore& tempKeystore = GetPrivateKeysKeystore(registers["privatekeys"]);
     fGivenKeys = true;
 
-    for (unsigned int kidx = 0; kidx < keysObj.size(); kidx++) {
-        if (!keysObj[kidx].isStr())
-            throw std::runtime_error("privatekey not a string");
-        CKey key = KeyIO::DecodeSecret(keysObj[kidx].getValStr());
-        if (!key.IsValid()) {
-            throw std::runtime_error("privatekey not valid");
-        }
-        tempKeystore.AddKey(key);
-    }
-
     // Add previous txouts given in the RPC call:
     if (!registers.count("prevtxs"))
         throw std::runtime_error("prevtxs register variable must be set.");
@@ -504,19 +554,19 @@ static void MutateTxSign(CMutableTransaction& tx, const std::string& flagStr)
 
             {
                 const Coin& coin = view.AccessCoin(out);
-                if (!coin.IsSpent() && coin.out.scriptPubKey != scriptPubKey) {
+                if (!coin.IsSpent() && coin.GetScriptPubKey() != scriptPubKey) {
                     std::string err("Previous output scriptPubKey mismatch:\n");
-                    err = err + ScriptToAsmStr(coin.out.scriptPubKey) + "\nvs:\n"+
+                    err = err + ScriptToAsmStr(coin.GetScriptPubKey()) + "\nvs:\n"+
                         ScriptToAsmStr(scriptPubKey);
                     throw std::runtime_error(err);
                 }
 
                 Coin newcoin;
-                newcoin.out.scriptPubKey = scriptPubKey;
-                newcoin.out.nValue = 0;
+                newcoin.SetScriptPubKey(scriptPubKey);
+                newcoin.nValue = 0;
                 newcoin.nHeight = 1;
                 if (prevOut.exists("amount")) {
-                    newcoin.out.nValue = AmountFromValue(prevOut["amount"]);
+                    newcoin.nValue = AmountFromValue(prevOut["amount"]);
                 }
             }
 
@@ -536,38 +586,53 @@ static void MutateTxSign(CMutableTransaction& tx, const std::string& flagStr)
 
     bool fHashSingle = ((nHashType & ~SIGHASH_ANYONECANPAY) == SIGHASH_SINGLE);
 
-    // Sign what we can:
-    for (unsigned int i = 0; i < mergedTx.vin.size(); i++) {
-        CTxIn& txin = mergedTx.vin[i];
-        const Coin& coin = view.AccessCoin(txin.prevout);
-        if (coin.IsSpent()) {
-            fComplete = false;
-            continue;
-        }
-
-        const CScript& prevPubKey = coin.out.scriptPubKey;
-        const CAmount& amount = coin.out.nValue;
+    const size_t nInputs = mergedTx.vin.size();
+    const SigVersion sigversion = mergedTx.GetRequiredSigVersion();
+    std::vector<Coin> coins(nInputs);
+    for (size_t i = 0; i < nInputs; i++) {
+        coins[i] = view.AccessCoin(mergedTx.vin[i].prevout);
+    }
 
-        SignatureData sigdata;
-        SigVersion sigversion =  mergedTx.GetRequiredSigVersion();
+    // Sign what we can. The signature of an input doesn't depend on the scriptSig of the others,
+    // so the inputs are signed in parallel, then their scriptSigs are updated.
+    std::vector<SignatureData> sigdatas(nInputs);
+    ForEachInput(nInputs, [&](size_t i) {
         // Only sign SIGHASH_SINGLE if there's a corresponding output:
-        if (!fHashSingle || (i < mergedTx.vout.size()))
+        if (!coins[i].IsSpent() && (!fHashSingle || (i < mergedTx.vout.size())))
             ProduceSignature(
-                    MutableTransactionSignatureCreator(&keystore, &mergedTx, i, amount, nHashType),
-                    prevPubKey,
-                    sigdata,
+                    MutableTransactionSignatureCreator(&keystore, &mergedTx, i, coins[i].nValue, nHashType),
+                    coins[i].GetScriptPubKey(),
+                    sigdatas[i],
                     sigversion,
                     false // no cold stake
             );
+    });
+
+    for (size_t i = 0; i < nInputs; i++) {
+        if (coins[i].IsSpent()) {
+            fComplete = false;
+            continue;
+        }
+
+        const CScript& prevPubKey = coins[i].GetScriptPubKey();
+        const CAmount& amount = coins[i].nValue;
 
         // ... and merge in other signatures:
+        SignatureData& sigdata = sigdatas[i];
         for (const CTransaction& txv : txVariants) {
             sigdata = CombineSignatures(prevPubKey, MutableTransactionSignatureChecker(&mergedTx, i, amount), sigdata, DataFromTransaction(txv, i));
         }
         UpdateTransaction(mergedTx, i, sigdata);
-        if (!VerifyScript(txin.scriptSig, prevPubKey, STANDARD_SCRIPT_VERIFY_FLAGS,
-                MutableTransactionSignatureChecker(&mergedTx, i, amount), sigversion))
-            fComplete = false;
+    }
+
+    std::vector<char> vVerified(nInputs, false);
+    ForEachInput(nInputs, [&](size_t i) {
+        vVerified[i] = !coins[i].IsSpent() &&
+                VerifyScript(mergedTx.vin[i].scriptSig, coins[i].GetScriptPubKey(), STANDARD_SCRIPT_VERIFY_FLAGS,
+                             MutableTransactionSignatureChecker(&mergedTx, i, coins[i].nValue), sigversion);
+    });
+    if (std::find(vVerified.begin(), vVerified.end(), false) != vVerified.end()) {
+        fComplete = false;
     }
 
     if (fComplete) {
@@ -591,9 +656,16 @@ public:
     }
 };
 
+// Started by the first command needing it, and kept for the next ones (-batch)
+static std::unique_ptr<Secp256k1Init> ecc;
+
+static void StartECC()
+{
+    if (!ecc) ecc.reset(new Secp256k1Init());
+}
+
 static void MutateTx(CMutableTransaction& tx, const std::string& command, const std::string& commandVal)
 {
-    std::unique_ptr<Secp256k1Init> ecc;
     if (command == "nversion") {
         MutateTxVersion(tx, commandVal);
     } else if (command == "locktime") {
@@ -607,15 +679,15 @@ static void MutateTx(CMutableTransaction& tx, const std::string& command, const
     } else if (command == "outaddr") {
         MutateTxAddOutAddr(tx, commandVal);
     } else if (command == "outpubkey") {
-        ecc.reset(new Secp256k1Init());
+        StartECC();
         MutateTxAddOutPubKey(tx, commandVal);
     } else if (command == "outmultisig") {
-        ecc.reset(new Secp256k1Init());
+        StartECC();
         MutateTxAddOutMultiSig(tx, commandVal);
     } else if (command == "outscript") {
         MutateTxAddOutScript(tx, commandVal);
     } else if (command == "sign") {
-        ecc.reset(new Secp256k1Init());
+        StartECC();
         MutateTxSign(tx, commandVal);
     } else if (command == "load") {
         RegisterLoad(commandVal);
@@ -679,6 +751,87 @@ static std::string readStdin()
     return ret;
 }
 
+static bool IsRegisterCommand(const std::string& command)
+{
+    return command == "load" || command == "set";
+}
+
+// Apply the commands of a line of -batch. Returns false if it only sets registers.
+static bool BatchLineRawTx(const std::vector<std::string>& tokens, CMutableTransaction& tx)
+{
+    size_t startArg = 1;
+    bool fHasTx = true;
+    if (tokens[0] == "-create") {
+        tx = CMutableTransaction();
+    } else if (tokens[0].find('=') == std::string::npos) {
+        if (!DecodeHexTx(tx, tokens[0]))
+            throw std::runtime_error("invalid transaction encoding");
+    } else {
+        startArg = 0;
+        fHasTx = false;
+    }
+
+    for (size_t i = startArg; i < tokens.size(); i++) {
+        const std::string& arg = tokens[i];
+        std::string key, value;
+        size_t eqpos = arg.find('=');
+        if (eqpos == std::string::npos)
+            key = arg;
+        else {
+            key = arg.substr(0, eqpos);
+            value = arg.substr(eqpos + 1);
+        }
+
+        if (!fHasTx && !IsRegisterCommand(key))
+            throw std::runtime_error("command " + key + " without a transaction");
+        MutateTx(tx, key, value);
+    }
+    return fHasTx;
+}
+
+// Process the lines of -batch, in a single process: the ECC context and the keystore of the
+// privatekeys register are set up once. A failed line is reported and the next ones processed.
+static int BatchRawTx(const std::string& strFile)
+{
+    std::ifstream file;
+    if (strFile != "-") {
+        file.open(strFile);
+        if (!file.is_open()) {
+            fprintf(stderr, "error: cannot open file %s\n", strFile.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    std::istream& in = strFile == "-" ? std::cin : file;
+
+    int nRet = 0;
+    int nLine = 0;
+    std::string strLine;
+    while (std::getline(in, strLine)) {
+        nLine++;
+        boost::algorithm::trim(strLine);
+        if (strLine.empty() || strLine[0] == '#') continue;
+
+        std::vector<std::string> tokens;
+        boost::algorithm::split(tokens, strLine, boost::algorithm::is_space(), boost::algorithm::token_compress_on);
+        try {
+            CMutableTransaction tx;
+            if (BatchLineRawTx(tokens, tx)) {
+                OutputTx(tx);
+            }
+        } catch (const boost::thread_interrupted&) {
+            throw;
+        } catch (const std::exception& e) {
+            fprintf(stderr, "error: line %d: %s\n", nLine, e.what());
+            nRet = EXIT_FAILURE;
+        }
+    }
+    if (in.bad()) {
+        fprintf(stderr, "error: cannot read %s\n", strFile.c_str());
+        nRet = EXIT_FAILURE;
+    }
+    return nRet;
+}
+
 static int CommandLineRawTx(int argc, char* argv[])
 {
     std::string strPrint;
@@ -762,11 +915,17 @@ int main(int argc, char* argv[])
 
     int ret = EXIT_FAILURE;
     try {
-        ret = CommandLineRawTx(argc, argv);
+        if (gArgs.IsArgSet("-batch")) {
+            const std::string strFile = gArgs.GetArg("-batch", "");
+            ret = BatchRawTx(strFile.empty() ? "-" : strFile);
+        } else {
+            ret = CommandLineRawTx(argc, argv);
+        }
     } catch (const std::exception& e) {
         PrintExceptionContinue(&e, "CommandLineRawTx()");
     } catch (...) {
         PrintExceptionContinue(nullptr, "CommandLineRawTx()");
     }
+    ecc.reset();
     return ret;
 }
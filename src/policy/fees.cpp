@@ -11,6 +11,8 @@
 #include "txmempool.h"
 #include "util/system.h"
 
+#include <algorithm>
+
 void TxConfirmStats::Initialize(std::vector<double>& defaultBuckets,
                                 unsigned int maxConfirms, double _decay)
 {
@@ -19,12 +21,9 @@ void TxConfirmStats::Initialize(std::vector<double>& defaultBuckets,
         buckets.push_back(defaultBuckets[i]);
         bucketMap[defaultBuckets[i]] = i;
     }
-    confAvg.resize(maxConfirms);
-    curBlockConf.resize(maxConfirms);
+    ResizeConf(maxConfirms);
     unconfTxs.resize(maxConfirms);
     for (unsigned int i = 0; i < maxConfirms; i++) {
-        confAvg[i].resize(buckets.size());
-        curBlockConf[i].resize(buckets.size());
         unconfTxs[i].resize(buckets.size());
     }
 
@@ -35,17 +34,23 @@ void TxConfirmStats::Initialize(std::vector<double>& defaultBuckets,
     avg.resize(buckets.size());
 }
 
+void TxConfirmStats::ResizeConf(unsigned int _maxConfirms)
+{
+    maxConfirms = _maxConfirms;
+    confAvg.resize(ConfIndex(maxConfirms, 0));
+    curBlockConf.resize(ConfIndex(maxConfirms, 0));
+}
+
 // Zero out the data for the current block
 void TxConfirmStats::ClearCurrent(unsigned int nBlockHeight)
 {
     for (unsigned int j = 0; j < buckets.size(); j++) {
         oldUnconfTxs[j] += unconfTxs[nBlockHeight%unconfTxs.size()][j];
         unconfTxs[nBlockHeight%unconfTxs.size()][j] = 0;
-        for (unsigned int i = 0; i < curBlockConf.size(); i++)
-            curBlockConf[i][j] = 0;
         curBlockTxCt[j] = 0;
         curBlockVal[j] = 0;
     }
+    std::fill(curBlockConf.begin(), curBlockConf.end(), 0);
 }
 
 
@@ -55,8 +60,8 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
     if (blocksToConfirm < 1)
         return;
     unsigned int bucketindex = bucketMap.lower_bound(val)->second;
-    for (size_t i = blocksToConfirm; i <= curBlockConf.size(); i++) {
-        curBlockConf[i - 1][bucketindex]++;
+    for (size_t i = blocksToConfirm; i <= maxConfirms; i++) {
+        curBlockConf[ConfIndex(i - 1, bucketindex)]++;
     }
     curBlockTxCt[bucketindex]++;
     curBlockVal[bucketindex] += val;
@@ -64,9 +69,13 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
 
 void TxConfirmStats::UpdateMovingAverages()
 {
+    // Plain loops over contiguous arrays, which the compiler vectorizes
+    const size_t nConf = confAvg.size();
+    double* pConfAvg = confAvg.data();
+    const int* pCurBlockConf = curBlockConf.data();
+    for (size_t k = 0; k < nConf; k++)
+        pConfAvg[k] = pConfAvg[k] * decay + pCurBlockConf[k];
     for (unsigned int j = 0; j < buckets.size(); j++) {
-        for (unsigned int i = 0; i < confAvg.size(); i++)
-            confAvg[i][j] = confAvg[i][j] * decay + curBlockConf[i][j];
         avg[j] = avg[j] * decay + curBlockVal[j];
         txCtAvg[j] = txCtAvg[j] * decay + curBlockTxCt[j];
     }
@@ -107,7 +116,7 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     // Start counting from highest(default) or lowest feerate transactions
     for (int bucket = startbucket; bucket >= 0 && bucket <= maxbucketindex; bucket += step) {
         curFarBucket = bucket;
-        nConf += confAvg[confTarget - 1][bucket];
+        nConf += confAvg[ConfIndex(confTarget - 1, bucket)];
         totalNum += txCtAvg[bucket];
         for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
             extraNum += unconfTxs[(nBlockHeight - confct)%bins][bucket];
@@ -177,7 +186,12 @@ void TxConfirmStats::Write(CAutoFile& fileout)
     fileout << buckets;
     fileout << avg;
     fileout << txCtAvg;
-    fileout << confAvg;
+    // The file keeps the confAvg[Y][X] layout
+    std::vector<std::vector<double> > fileConfAvg(maxConfirms);
+    for (unsigned int i = 0; i < maxConfirms; i++) {
+        fileConfAvg[i].assign(confAvg.begin() + ConfIndex(i, 0), confAvg.begin() + ConfIndex(i + 1, 0));
+    }
+    fileout << fileConfAvg;
 }
 
 void TxConfirmStats::Read(CAutoFile& filein)
@@ -188,7 +202,7 @@ void TxConfirmStats::Read(CAutoFile& filein)
     std::vector<std::vector<double> > fileConfAvg;
     std::vector<double> fileTxCtAvg;
     double fileDecay;
-    size_t maxConfirms;
+    size_t fileMaxConfirms;
     size_t numBuckets;
 
     filein >> fileDecay;
@@ -205,10 +219,10 @@ void TxConfirmStats::Read(CAutoFile& filein)
     if (fileTxCtAvg.size() != numBuckets)
         throw std::runtime_error("Corrupt estimates file. Mismatch in tx count bucket count");
     filein >> fileConfAvg;
-    maxConfirms = fileConfAvg.size();
-    if (maxConfirms <= 0 || maxConfirms > 6 * 24 * 7) // one week
+    fileMaxConfirms = fileConfAvg.size();
+    if (fileMaxConfirms <= 0 || fileMaxConfirms > 6 * 24 * 7) // one week
         throw std::runtime_error("Corrupt estimates file.  Must maintain estimates for between 1 and 1008 (one week) confirms");
-    for (unsigned int i = 0; i < maxConfirms; i++) {
+    for (unsigned int i = 0; i < fileMaxConfirms; i++) {
         if (fileConfAvg[i].size() != numBuckets)
             throw std::runtime_error("Corrupt estimates file. Mismatch in feerate conf average bucket count");
     }
@@ -217,15 +231,14 @@ void TxConfirmStats::Read(CAutoFile& filein)
     decay = fileDecay;
     buckets = fileBuckets;
     avg = fileAvg;
-    confAvg = fileConfAvg;
     txCtAvg = fileTxCtAvg;
     bucketMap.clear();
 
     // Resize the current block variables which aren't stored in the data file
     // to match the number of confirms and buckets
-    curBlockConf.resize(maxConfirms);
+    ResizeConf(fileMaxConfirms);
     for (unsigned int i = 0; i < maxConfirms; i++) {
-        curBlockConf[i].resize(buckets.size());
+        std::copy(fileConfAvg[i].begin(), fileConfAvg[i].end(), confAvg.begin() + ConfIndex(i, 0));
     }
     curBlockTxCt.resize(buckets.size());
     curBlockVal.resize(buckets.size());
@@ -240,7 +253,7 @@ void TxConfirmStats::Read(CAutoFile& filein)
         bucketMap[buckets[i]] = i;
 
     LogPrint(BCLog::ESTIMATEFEE, "Reading estimates: %u buckets counting confirms up to %u blocks\n",
-            numBuckets, maxConfirms);
+            numBuckets, fileMaxConfirms);
 }
 
 unsigned int TxConfirmStats::NewTx(unsigned int nBlockHeight, double val)
@@ -288,8 +301,10 @@ bool CBlockPolicyEstimator::removeTx(const uint256& hash)
 {
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
-        feeStats.removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex);
+        TxConfirmStats& stats = pos->second.fShielded ? shieldedFeeStats : feeStats;
+        stats.removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex);
         mapMemPoolTxs.erase(hash);
+        ClearCachedEstimates();
         return true;
     }
     return false;
@@ -306,11 +321,31 @@ CBlockPolicyEstimator::CBlockPolicyEstimator(const CFeeRate& _minRelayFee)
     }
     vfeelist.push_back(INF_FEERATE);
     feeStats.Initialize(vfeelist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY);
+    shieldedFeeStats.Initialize(vfeelist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY);
+    ClearCachedEstimates();
+}
+
+constexpr double CBlockPolicyEstimator::NOT_CACHED;
+
+void CBlockPolicyEstimator::ClearCachedEstimates()
+{
+    cachedMedians.assign(feeStats.GetMaxConfirms(), NOT_CACHED);
+    cachedShieldedMedians.assign(shieldedFeeStats.GetMaxConfirms(), NOT_CACHED);
+}
+
+double CBlockPolicyEstimator::EstimateMedianVal(int confTarget, bool fShielded)
+{
+    double& median = (fShielded ? cachedShieldedMedians : cachedMedians)[confTarget - 1];
+    if (median == NOT_CACHED) {
+        TxConfirmStats& stats = fShielded ? shieldedFeeStats : feeStats;
+        median = stats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+    }
+    return median;
 }
 
 void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate)
 {
-    if(entry.HasZerocoins() || entry.IsShielded()) {
+    if(entry.HasZerocoins()) {
         // Zerocoin spends/mints had fixed feerate. Skip them for the estimates.
         return;
     }
@@ -342,13 +377,16 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     // Feerates are stored and reported as PIV-per-kb:
     CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
 
-    mapMemPoolTxs[hash].blockHeight = txHeight;
-    mapMemPoolTxs[hash].bucketIndex = feeStats.NewTx(txHeight, (double)feeRate.GetFeePerK());
+    TxStatsInfo& info = mapMemPoolTxs[hash];
+    info.blockHeight = txHeight;
+    info.fShielded = entry.IsShielded();
+    info.bucketIndex = (info.fShielded ? shieldedFeeStats : feeStats).NewTx(txHeight, (double)feeRate.GetFeePerK());
+    ClearCachedEstimates();
 }
 
 bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
 {
-    if(entry->HasZerocoins() || entry->IsShielded()) {
+    if(entry->HasZerocoins()) {
         // Zerocoin spends/mints had fixed feerate. Skip them for the estimates.
         return false;
     }
@@ -372,7 +410,7 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
     // Feerates are stored and reported as PIV-per-kb:
     CFeeRate feeRate(entry->GetFee(), entry->GetTxSize());
 
-    feeStats.Record(blocksToConfirm, (double)feeRate.GetFeePerK());
+    (entry->IsShielded() ? shieldedFeeStats : feeStats).Record(blocksToConfirm, (double)feeRate.GetFeePerK());
     return true;
 }
 
@@ -395,6 +433,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
     // Clear the current block state and update unconfirmed circular buffer
     feeStats.ClearCurrent(nBlockHeight);
+    shieldedFeeStats.ClearCurrent(nBlockHeight);
 
     unsigned int countedTxs = 0;
     // Repopulate the current block state
@@ -405,6 +444,8 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
     // Update all exponential averages with the current block state
     feeStats.UpdateMovingAverages();
+    shieldedFeeStats.UpdateMovingAverages();
+    ClearCachedEstimates();
 
     LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy after updating estimates for %u of %u txs in block, since last block %u of %u tracked, new mempool map size %u\n",
              countedTxs, entries.size(), trackedTxs, trackedTxs + untrackedTxs, mapMemPoolTxs.size());
@@ -413,13 +454,14 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     untrackedTxs = 0;
 }
 
-CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget)
+CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget, bool fShielded)
 {
+    const TxConfirmStats& stats = fShielded ? shieldedFeeStats : feeStats;
     // Return failure if trying to analyze a target we're not tracking
-    if (confTarget <= 0 || (unsigned int)confTarget > feeStats.GetMaxConfirms())
+    if (confTarget <= 0 || (unsigned int)confTarget > stats.GetMaxConfirms())
         return CFeeRate(0);
 
-    double median = feeStats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+    double median = EstimateMedianVal(confTarget, fShielded);
 
     if (median < 0)
         return CFeeRate(0);
@@ -427,17 +469,18 @@ CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget)
     return CFeeRate(median);
 }
 
-CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, int *answerFoundAtTarget, const CTxMemPool& pool)
+CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, int *answerFoundAtTarget, const CTxMemPool& pool, bool fShielded)
 {
     if (answerFoundAtTarget)
         *answerFoundAtTarget = confTarget;
+    const TxConfirmStats& stats = fShielded ? shieldedFeeStats : feeStats;
     // Return failure if trying to analyze a target we're not tracking
-    if (confTarget <= 0 || (unsigned int)confTarget > feeStats.GetMaxConfirms())
+    if (confTarget <= 0 || (unsigned int)confTarget > stats.GetMaxConfirms())
         return CFeeRate(0);
 
     double median = -1;
-    while (median < 0 && (unsigned int)confTarget <= feeStats.GetMaxConfirms()) {
-        median = feeStats.EstimateMedianVal(confTarget++, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+    while (median < 0 && (unsigned int)confTarget <= stats.GetMaxConfirms()) {
+        median = EstimateMedianVal(confTarget++, fShielded);
     }
 
     if (answerFoundAtTarget)
@@ -458,6 +501,8 @@ void CBlockPolicyEstimator::Write(CAutoFile& fileout)
 {
     fileout << nBestSeenHeight;
     feeStats.Write(fileout);
+    // Appended, so that the files stay readable by the versions not tracking the shielded txs
+    shieldedFeeStats.Write(fileout);
 }
 
 void CBlockPolicyEstimator::Read(CAutoFile& filein, int nFileVersion)
@@ -466,8 +511,13 @@ void CBlockPolicyEstimator::Read(CAutoFile& filein, int nFileVersion)
     filein >> nFileBestSeenHeight;
     feeStats.Read(filein);
     nBestSeenHeight = nFileBestSeenHeight;
+    ClearCachedEstimates();
     if (nFileVersion < 4029900) {
         TxConfirmStats priStats;
         priStats.Read(filein);
     }
+    if (nFileVersion >= SHIELDED_FEE_ESTIMATES_VERSION) {
+        shieldedFeeStats.Read(filein);
+        ClearCachedEstimates();
+    }
 }
@@ -83,9 +83,12 @@ private:
 
     // Count the total # of txs confirmed within Y blocks in each bucket
     // Track the historical moving average of these totals over blocks
-    std::vector<std::vector<double> > confAvg; // confAvg[Y][X]
+    // The Y rows are stored contiguously in a single vector, so that the moving averages
+    // are decayed in one pass over it: the value of Y,X is at Y * buckets.size() + X.
+    std::vector<double> confAvg; // confAvg[ConfIndex(Y, X)]
     // and calculate the totals for the current block to update the moving averages
-    std::vector<std::vector<int> > curBlockConf; // curBlockConf[Y][X]
+    std::vector<int> curBlockConf; // curBlockConf[ConfIndex(Y, X)]
+    unsigned int maxConfirms{0};
 
     // Sum the total feerate of all tx's in each bucket
     // Track the historical moving average of this total over blocks
@@ -105,6 +108,12 @@ private:
     // transactions still unconfirmed after MAX_CONFIRMS for each bucket
     std::vector<int> oldUnconfTxs;
 
+    /** Index of the confirms Y (0-based) of the bucket X into confAvg and curBlockConf */
+    size_t ConfIndex(unsigned int confirms, unsigned int bucket) const { return (size_t)confirms * buckets.size() + bucket; }
+
+    /** Size confAvg and curBlockConf for maxConfirms and the buckets */
+    void ResizeConf(unsigned int _maxConfirms);
+
 public:
     /**
      * Initialize the data structures.  This is called by BlockPolicyEstimator's
@@ -152,7 +161,7 @@ public:
                              double minSuccess, bool requireGreater, unsigned int nBlockHeight);
 
     /** Return the max number of confirms we're tracking */
-    unsigned int GetMaxConfirms() { return confAvg.size(); }
+    unsigned int GetMaxConfirms() const { return maxConfirms; }
 
     /** Write state of estimation data to a file*/
     void Write(CAutoFile& fileout);
@@ -190,6 +199,9 @@ static const double INF_FEERATE = 1e16;
 /** Spacing of FeeRate buckets */
 static const double FEE_SPACING = 1.1;
 
+/** First client version writing the shielded txs stats to the fee estimates file */
+static const int SHIELDED_FEE_ESTIMATES_VERSION = 5069900;
+
 
 /**
  *  We want to be able to estimate feerates or priorities that are needed on tx's to be included in
@@ -215,14 +227,14 @@ public:
     /** Remove a transaction from the mempool tracking stats*/
     bool removeTx(const uint256& hash);
 
-    /** Return a feerate estimate */
-    CFeeRate estimateFee(int confTarget);
+    /** Return a feerate estimate (for the shielded txs if fShielded) */
+    CFeeRate estimateFee(int confTarget, bool fShielded = false);
 
     /** Estimate feerate needed to get be included in a block within
      *  confTarget blocks. If no answer can be given at confTarget, return an
      *  estimate at the lowest target where one can be given.
      */
-    CFeeRate estimateSmartFee(int confTarget, int *answerFoundAtTarget, const CTxMemPool& pool);
+    CFeeRate estimateSmartFee(int confTarget, int *answerFoundAtTarget, const CTxMemPool& pool, bool fShielded = false);
 
     /** Write estimation data to a file */
     void Write(CAutoFile& fileout);
@@ -237,7 +249,8 @@ private:
     {
         unsigned int blockHeight;
         unsigned int bucketIndex;
-        TxStatsInfo() : blockHeight(0), bucketIndex(0) {}
+        bool fShielded;
+        TxStatsInfo() : blockHeight(0), bucketIndex(0), fShielded(false) {}
     };
 
     // map of txids to information about that transaction
@@ -245,8 +258,25 @@ private:
 
     /** Classes to track historical data on transaction confirmations */
     TxConfirmStats feeStats;
+    /** The shielded txs are tracked apart, as their fees follow their own rules */
+    TxConfirmStats shieldedFeeStats;
 
     unsigned int trackedTxs;
     unsigned int untrackedTxs;
+
+    /**
+     * The estimates already computed for each target (index confTarget - 1), or NOT_CACHED.
+     * They only depend on the stats, so they are cleared whenever a block or a tracked mempool
+     * tx updates them, and the estimate RPCs between two updates don't scan the buckets again.
+     */
+    std::vector<double> cachedMedians;
+    std::vector<double> cachedShieldedMedians;
+    static constexpr double NOT_CACHED = -2;
+
+    /** Return the estimate of feeStats (or shieldedFeeStats) for confTarget, from the cache if already computed */
+    double EstimateMedianVal(int confTarget, bool fShielded);
+
+    /** Clear the estimates cache, to be called whenever feeStats is modified */
+    void ClearCachedEstimates();
 };
 #endif /*BITCOIN_POLICYESTIMATOR_H */
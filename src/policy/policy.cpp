@@ -55,6 +55,14 @@ CAmount GetShieldedDustThreshold(const CFeeRate& dustRelayFeeIn)
                                      BINDINGSIG_SIZE);
 }
 
+unsigned int GetShieldedValidationCost(const CTransaction& tx)
+{
+    if (!tx.IsShieldedTx()) return 0;
+    return tx.sapData->vShieldedSpend.size() * SAPLING_SPEND_VALIDATION_COST +
+           tx.sapData->vShieldedOutput.size() * SAPLING_OUTPUT_VALIDATION_COST +
+           SAPLING_BINDING_SIG_VALIDATION_COST;
+}
+
 /**
  * Check transaction inputs to mitigate two
  * potential denial-of-service attacks:
@@ -75,11 +83,12 @@ CAmount GetShieldedDustThreshold(const CFeeRate& dustRelayFeeIn)
  *   DUP CHECKSIG DROP ... repeated 100 times... OP_1
  */
 
-bool IsStandard(const CScript& scriptPubKey, txnouttype& whichType)
+static bool IsStandard(const CScript& scriptPubKey, const CScriptSolution& solution)
 {
-    std::vector<valtype> vSolutions;
-    if (!Solver(scriptPubKey, whichType, vSolutions))
+    if (!solution.fSolved)
         return false;
+    const txnouttype whichType = solution.type;
+    const std::vector<valtype>& vSolutions = solution.vSolutions;
 
     if (whichType == TX_MULTISIG)
     {
@@ -97,6 +106,14 @@ bool IsStandard(const CScript& scriptPubKey, txnouttype& whichType)
     return whichType != TX_NONSTANDARD;
 }
 
+bool IsStandard(const CScript& scriptPubKey, txnouttype& whichType)
+{
+    CScriptSolution solution;
+    solution.fSolved = Solver(scriptPubKey, solution.type, solution.vSolutions);
+    whichType = solution.type;
+    return IsStandard(scriptPubKey, solution);
+}
+
 bool IsStandardTx(const CTransactionRef& tx, int nBlockHeight, std::string& reason)
 {
     AssertLockHeld(cs_main);
@@ -161,13 +178,15 @@ bool IsStandardTx(const CTransactionRef& tx, int nBlockHeight, std::string& reas
     }
 
     unsigned int nDataOut = 0;
-    txnouttype whichType;
-    for (const CTxOut& txout : tx->vout) {
-        if (!::IsStandard(txout.scriptPubKey, whichType)) {
+    const std::vector<CScriptSolution>& vSolutions = GetOutputSolutions(*tx);
+    for (size_t i = 0; i < tx->vout.size(); i++) {
+        const CTxOut& txout = tx->vout[i];
+        if (!::IsStandard(txout.scriptPubKey, vSolutions[i])) {
             reason = "scriptpubkey";
             return false;
         }
 
+        const txnouttype whichType = vSolutions[i].type;
         if (whichType == TX_NULL_DATA)
             nDataOut++;
         else if ((whichType == TX_MULTISIG) && (!fIsBareMultisigStd)) {
@@ -195,7 +214,7 @@ bool AreInputsStandard(const CTransaction& tx, const CCoinsViewCache& mapInputs)
     }
 
     for (unsigned int i = 0; i < tx.vin.size(); i++) {
-        const CTxOut& prev = mapInputs.AccessCoin(tx.vin[i].prevout).out;
+        const CTxOut prev = mapInputs.AccessCoin(tx.vin[i].prevout).GetTxOut();
 
         std::vector<std::vector<unsigned char> > vSolutions;
         txnouttype whichType;
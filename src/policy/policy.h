@@ -15,14 +15,25 @@
 
 class CChainParams;
 class CCoinsViewCache;
+class CTransaction;
 class CTxOut;
 
 /** Default for -blockmaxsize, which controls the maximum size of block the mining code will create **/
 static const unsigned int DEFAULT_BLOCK_MAX_SIZE = 750000;
+/** Validation cost of the Sapling descriptions, in units of an ECDSA signature check.
+ * A spend is a Groth16 proof and a RedJubjub signature, an output a Groth16 proof. */
+static const unsigned int SAPLING_SPEND_VALIDATION_COST = 40;
+static const unsigned int SAPLING_OUTPUT_VALIDATION_COST = 35;
+static const unsigned int SAPLING_BINDING_SIG_VALIDATION_COST = 1;
+/** Default for -blockmaxshieldedcost, the maximum validation cost of the Sapling
+ * descriptions in a block created by the mining code */
+static const unsigned int DEFAULT_BLOCK_MAX_SHIELDED_COST = 25000;
 /** Maximum number of signature check operations in an IsStandard() P2SH script */
 static const unsigned int MAX_P2SH_SIGOPS = 15;
 /** Default for -maxmempool, maximum megabytes of mempool memory usage */
 static const unsigned int DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** Default for -maxmempoolshielded, maximum megabytes of mempool memory usage of the shielded txs */
+static const unsigned int DEFAULT_MAX_MEMPOOL_SHIELDED_SIZE = 100;
 /** Default for -permitbaremultisig */
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 extern bool fIsBareMultisigStd;
@@ -61,6 +72,9 @@ bool IsDust(const CTxOut& txout, const CFeeRate& dustRelayFeeIn);
 CAmount GetDustThreshold(const CFeeRate& dustRelayFeeIn);
 CAmount GetShieldedDustThreshold(const CFeeRate& dustRelayFeeIn);
 
+/** Validation cost of the Sapling spends, outputs and binding signature of a transaction */
+unsigned int GetShieldedValidationCost(const CTransaction& tx);
+
 bool IsStandard(const CScript& scriptPubKey, txnouttype& whichType);
 
 /** Check for standard transaction types
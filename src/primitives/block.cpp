@@ -12,10 +12,48 @@
 #include "utilstrencodings.h"
 #include "util/system.h"
 
+namespace {
+/**
+ * The Quark hashes of the legacy headers are expensive, and the hash of a block is asked for many
+ * times while it is checked and connected (reindex, headers sync): the last ones computed on each
+ * thread are remembered, with the 80 bytes they were computed from.
+ * This only saves the repeated hashing of the same header: each header is still hashed once, with
+ * the portable sph functions, and nothing is kept across restarts.
+ */
+struct QuarkHashCache {
+    static const size_t SIZE = 8;
+    struct Entry {
+        uint8_t data[80];
+        uint256 hash;
+        bool fSet{false};
+    };
+    Entry entries[SIZE];
+    size_t nNext{0};
+
+    const uint256* Get(const uint8_t* data) const
+    {
+        for (const Entry& e : entries) {
+            if (e.fSet && memcmp(e.data, data, sizeof(e.data)) == 0) return &e.hash;
+        }
+        return nullptr;
+    }
+
+    void Put(const uint8_t* data, const uint256& hash)
+    {
+        Entry& e = entries[nNext];
+        memcpy(e.data, data, sizeof(e.data));
+        e.hash = hash;
+        e.fSet = true;
+        nNext = (nNext + 1) % SIZE;
+    }
+};
+
+thread_local QuarkHashCache g_quark_hash_cache;
+} // namespace
+
 uint256 CBlockHeader::GetHash() const
 {
     if (nVersion < 4)  {
-#if defined(WORDS_BIGENDIAN)
         uint8_t data[80];
         WriteLE32(&data[0], nVersion);
         memcpy(&data[4], hashPrevBlock.begin(), hashPrevBlock.size());
@@ -23,10 +61,11 @@ uint256 CBlockHeader::GetHash() const
         WriteLE32(&data[68], nTime);
         WriteLE32(&data[72], nBits);
         WriteLE32(&data[76], nNonce);
-        return HashQuark(data, data + 80);
-#else // Can take shortcut for little endian
-        return HashQuark(BEGIN(nVersion), END(nNonce));
-#endif
+        const uint256* pcached = g_quark_hash_cache.Get(data);
+        if (pcached) return *pcached;
+        const uint256& hash = HashQuark(data, data + 80);
+        g_quark_hash_cache.Put(data, hash);
+        return hash;
     }
     // version >= 4
     return SerializeHash(*this);
@@ -7,6 +7,7 @@
 #include "primitives/transaction.h"
 
 #include "hash.h"
+#include "script/standard.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 
@@ -103,15 +104,32 @@ uint256 CTransaction::ComputeHash() const
     return SerializeHash(*this);
 }
 
+unsigned int CTransaction::ComputeTotalSize() const
+{
+    return ::GetSerializeSize(*this, PROTOCOL_VERSION);
+}
+
 size_t CTransaction::DynamicMemoryUsage() const
 {
-    return memusage::RecursiveDynamicUsage(vin) + memusage::RecursiveDynamicUsage(vout);
+    size_t usage = memusage::RecursiveDynamicUsage(vin) + memusage::RecursiveDynamicUsage(vout);
+    // The Solver results of the outputs, once cached
+    const std::shared_ptr<const std::vector<CScriptSolution>> solutions = std::atomic_load(&m_output_solutions);
+    if (solutions) {
+        usage += memusage::DynamicUsage(solutions) + memusage::DynamicUsage(*solutions);
+        for (const CScriptSolution& solution : *solutions) {
+            usage += memusage::DynamicUsage(solution.vSolutions);
+            for (const std::vector<unsigned char>& vch : solution.vSolutions) {
+                usage += memusage::DynamicUsage(vch);
+            }
+        }
+    }
+    return usage;
 }
 
 /* For backward compatibility, the hash is initialized to 0. TODO: remove the need for this default constructor entirely. */
-CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nType(TxType::NORMAL), nLockTime(0), hash() {}
-CTransaction::CTransaction(const CMutableTransaction &tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nType(tx.nType), nLockTime(tx.nLockTime), sapData(tx.sapData), extraPayload(tx.extraPayload), hash(ComputeHash()) {}
-CTransaction::CTransaction(CMutableTransaction &&tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nType(tx.nType), nLockTime(tx.nLockTime), sapData(tx.sapData), extraPayload(tx.extraPayload), hash(ComputeHash()) {}
+CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nType(TxType::NORMAL), nLockTime(0), hash(), nTotalSize(ComputeTotalSize()) {}
+CTransaction::CTransaction(const CMutableTransaction &tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nType(tx.nType), nLockTime(tx.nLockTime), sapData(tx.sapData), extraPayload(tx.extraPayload), hash(ComputeHash()), nTotalSize(ComputeTotalSize()) {}
+CTransaction::CTransaction(CMutableTransaction &&tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nType(tx.nType), nLockTime(tx.nLockTime), sapData(std::move(tx.sapData)), extraPayload(std::move(tx.extraPayload)), hash(ComputeHash()), nTotalSize(ComputeTotalSize()) {}
 
 bool CTransaction::HasZerocoinSpendInputs() const
 {
@@ -200,11 +218,6 @@ CAmount CTransaction::GetShieldedValueIn() const
     return nValue;
 }
 
-unsigned int CTransaction::GetTotalSize() const
-{
-    return ::GetSerializeSize(*this, PROTOCOL_VERSION);
-}
-
 std::string CTransaction::ToString() const
 {
     std::ostringstream ss;
@@ -19,6 +19,7 @@
 
 #include <atomic>
 #include <list>
+#include <memory>
 
 class CTransaction;
 
@@ -194,6 +195,7 @@ public:
 };
 
 struct CMutableTransaction;
+struct CScriptSolution;
 
 /**
  * Transaction serialization format:
@@ -275,6 +277,9 @@ public:
     Optional<SaplingTxData> sapData{SaplingTxData()}; // Future: Don't initialize it by default
     Optional<std::vector<uint8_t>> extraPayload{nullopt};     // only available for special transaction types
 
+    //! (memory only) The Solver results of the outputs, set on first use. See GetOutputSolutions
+    mutable std::shared_ptr<const std::vector<CScriptSolution>> m_output_solutions;
+
     /** Construct a CTransaction that qualifies as IsNull() */
     CTransaction();
 
@@ -392,7 +397,8 @@ public:
         return a.hash != b.hash;
     }
 
-    unsigned int GetTotalSize() const;
+    /** Serialized size, computed once at construction. */
+    unsigned int GetTotalSize() const { return nTotalSize; }
 
     std::string ToString() const;
 
@@ -401,7 +407,9 @@ public:
 private:
     /** Memory only. */
     const uint256 hash;
+    const unsigned int nTotalSize;
     uint256 ComputeHash() const;
+    unsigned int ComputeTotalSize() const;
 };
 
 /** A mutable version of CTransaction. */
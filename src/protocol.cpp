@@ -39,6 +39,20 @@ const char* FILTERLOAD = "filterload";
 const char* FILTERADD = "filteradd";
 const char* FILTERCLEAR = "filterclear";
 const char* SENDHEADERS = "sendheaders";
+const char* SENDCMPCT = "sendcmpct";
+const char* CMPCTBLOCK = "cmpctblock";
+const char* GETBLOCKTXN = "getblocktxn";
+const char* BLOCKTXN = "blocktxn";
+const char* SENDTXRCNCL = "sendtxrcncl";
+const char* REQRECON = "reqrecon";
+const char* SKETCH = "sketch";
+const char* RECONCILDIFF = "reconcildiff";
+const char* GETCFILTERS = "getcfilters";
+const char* CFILTER = "cfilter";
+const char* GETCFHEADERS = "getcfheaders";
+const char* CFHEADERS = "cfheaders";
+const char* GETCFCHECKPT = "getcfcheckpt";
+const char* CFCHECKPT = "cfcheckpt";
 const char* SPORK = "spork";
 const char* GETSPORKS = "getsporks";
 const char* MNBROADCAST = "mnb";
@@ -95,6 +109,20 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::FILTERADD,
     NetMsgType::FILTERCLEAR,
     NetMsgType::SENDHEADERS,
+    NetMsgType::SENDCMPCT,
+    NetMsgType::CMPCTBLOCK,
+    NetMsgType::GETBLOCKTXN,
+    NetMsgType::BLOCKTXN,
+    NetMsgType::SENDTXRCNCL,
+    NetMsgType::REQRECON,
+    NetMsgType::SKETCH,
+    NetMsgType::RECONCILDIFF,
+    NetMsgType::GETCFILTERS,
+    NetMsgType::CFILTER,
+    NetMsgType::GETCFHEADERS,
+    NetMsgType::CFHEADERS,
+    NetMsgType::GETCFCHECKPT,
+    NetMsgType::CFCHECKPT,
     "filtered block",  // Should never occur
     "ix",              // deprecated
     "txlvote",         // deprecated
@@ -232,6 +260,7 @@ std::string CInv::GetCommand() const
         case MSG_QUORUM_PREMATURE_COMMITMENT: return cmd.append(NetMsgType::QPCOMMITMENT);
         case MSG_QUORUM_RECOVERED_SIG: return cmd.append(NetMsgType::QSIGREC);
         case MSG_CLSIG: return cmd.append(NetMsgType::CLSIG);
+        case MSG_CMPCT_BLOCK: return cmd.append(NetMsgType::CMPCTBLOCK);
         default:
             throw std::out_of_range(strprintf("%s: type=%d unknown type", __func__, type));
     }
@@ -252,3 +281,16 @@ const std::vector<std::string>& getTierTwoNetMessageTypes()
 {
     return tiertwoNetMessageTypesVec;
 }
+
+bool IsQuorumNetMessageType(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::QCONTRIB ||
+           strCommand == NetMsgType::QCOMPLAINT ||
+           strCommand == NetMsgType::QJUSTIFICATION ||
+           strCommand == NetMsgType::QPCOMMITMENT ||
+           strCommand == NetMsgType::QSIGSHARESINV ||
+           strCommand == NetMsgType::QGETSIGSHARES ||
+           strCommand == NetMsgType::QBSIGSHARES ||
+           strCommand == NetMsgType::QSIGREC ||
+           strCommand == NetMsgType::CLSIG;
+}
@@ -215,6 +215,94 @@ extern const char* FILTERCLEAR;
  * @see https://bitcoin.org/en/developer-reference#sendheaders
  */
 extern const char* SENDHEADERS;
+/**
+ * Contains a 1-byte bool and 8-byte LE version number.
+ * Indicates that a node is willing to provide blocks via "cmpctblock" messages.
+ * May indicate that a node prefers to receive new block announcements via a
+ * "cmpctblock" message rather than an "inv", depending on message contents.
+ * @since protocol version 70928, as described by BIP152.
+ */
+extern const char* SENDCMPCT;
+/**
+ * Contains a CBlockHeaderAndShortTxIDs object - providing a header, the
+ * signature of PoS blocks and a list of "short txids".
+ * @since protocol version 70928, as described by BIP152.
+ */
+extern const char* CMPCTBLOCK;
+/**
+ * Contains a BlockTransactionsRequest
+ * Peer should respond with "blocktxn" message.
+ * @since protocol version 70928, as described by BIP152.
+ */
+extern const char* GETBLOCKTXN;
+/**
+ * Contains a BlockTransactions.
+ * Sent in response to a "getblocktxn" message.
+ * @since protocol version 70928, as described by BIP152.
+ */
+extern const char* BLOCKTXN;
+/**
+ * Contains a 4-byte version number and an 8-byte salt.
+ * Indicates that a node is willing to announce its transactions by reconciling
+ * the sets of transactions to announce. Sent before verack.
+ * @since protocol version 70930.
+ */
+extern const char* SENDTXRCNCL;
+/**
+ * Contains the 2-byte size of the set of the initiator and the 2-byte q.
+ * Peer should respond with "sketch" message.
+ * @since protocol version 70930.
+ */
+extern const char* REQRECON;
+/**
+ * Contains a ReconSketch of the set of the responder.
+ * Sent in response to a "reqrecon" message.
+ * @since protocol version 70930.
+ */
+extern const char* SKETCH;
+/**
+ * Contains a 1-byte bool telling whether the difference decoded, and the
+ * short ids of the transactions the initiator asks to be announced.
+ * Sent in response to a "sketch" message.
+ * @since protocol version 70930.
+ */
+extern const char* RECONCILDIFF;
+/**
+ * getcfilters requests compact filters for a range of blocks.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by
+ * BIP 157 & 158.
+ */
+extern const char* GETCFILTERS;
+/**
+ * cfilter is a response to a getcfilters request containing a single compact
+ * filter.
+ */
+extern const char* CFILTER;
+/**
+ * getcfheaders requests a compact filter header and the filter hashes for a
+ * range of blocks, which can then be used to reconstruct the filter headers
+ * for those blocks.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by
+ * BIP 157 & 158.
+ */
+extern const char* GETCFHEADERS;
+/**
+ * cfheaders is a response to a getcfheaders request containing a filter header
+ * and a vector of filter hashes for each subsequent block in the requested range.
+ */
+extern const char* CFHEADERS;
+/**
+ * getcfcheckpt requests evenly spaced compact filter headers, enabling
+ * parallelized download and validation of the headers between them.
+ * Only available with service bit NODE_COMPACT_FILTERS as described by
+ * BIP 157 & 158.
+ */
+extern const char* GETCFCHECKPT;
+/**
+ * cfcheckpt is a response to a getcfcheckpt request containing a vector of
+ * evenly spaced filter headers for blocks on the requested chain.
+ */
+extern const char* CFCHECKPT;
 /**
  * The spork message is used to send spork values to connected
  * peers
@@ -306,6 +394,9 @@ const std::vector<std::string>& getAllNetMessageTypes();
 /* Get a vector of all tier two valid message types (see above) */
 const std::vector<std::string>& getTierTwoNetMessageTypes();
 
+/* Whether the message type is one of the LLMQ sessions (DKG, signing and chainlocks), sent in the priority lane */
+bool IsQuorumNetMessageType(const std::string& strCommand);
+
 /** nServices flags */
 enum ServiceFlags : uint64_t {
     // Nothing
@@ -322,6 +413,10 @@ enum ServiceFlags : uint64_t {
     // that the node doesn't want to receive master nodes messages. (the 1<<3 was not picked as constant because on bitcoin 0.14 is witness and we want that update here )
     NODE_BLOOM_WITHOUT_MN = (1 << 4),
 
+    // NODE_COMPACT_FILTERS means the node will service basic block filter
+    // requests. See BIP157 and BIP158 for details on how this is implemented.
+    NODE_COMPACT_FILTERS = (1 << 6),
+
     // Bits 24-31 are reserved for temporary experiments. Just pick a bit that
     // isn't getting used, or one not being used much, and notify the
     // bitcoin-development mailing list. Remember that service bits are just
@@ -456,7 +551,9 @@ enum GetDataMsg {
     MSG_QUORUM_PREMATURE_COMMITMENT,
     MSG_QUORUM_RECOVERED_SIG,
     MSG_CLSIG,
-    MSG_TYPE_MAX = MSG_CLSIG,
+    // Only used in getdata, to request a block as a cmpctblock
+    MSG_CMPCT_BLOCK,
+    MSG_TYPE_MAX = MSG_CMPCT_BLOCK,
 };
 
 /** inv message data */
@@ -469,6 +566,8 @@ public:
     SERIALIZE_METHODS(CInv, obj) { READWRITE(obj.type, obj.hash); }
 
     friend bool operator<(const CInv& a, const CInv& b);
+    friend bool operator==(const CInv& a, const CInv& b) { return a.type == b.type && a.hash == b.hash; }
+    friend bool operator!=(const CInv& a, const CInv& b) { return !(a == b); }
 
     bool IsMasterNodeType() const;
     std::string ToString() const;
@@ -452,6 +452,7 @@ void BitcoinApplication::requestShutdown()
     startThread();
     window->hide();
     if (govModel) govModel->stop();
+    if (mnModel) mnModel->stop();
     if (walletModel) walletModel->stop();
     window->setClientModel(nullptr);
     pollShutdownTimer->stop();
@@ -480,60 +480,74 @@ void DashboardWidget::changeChartColors()
     if (set1) set1->setBorderColor(gridLineColorX);
 }
 
-void DashboardWidget::updateStakeFilter()
+// Add the amount of a stake row to its day (pair PIV, MN Reward)
+static void addStakeAmount(QMap<QDate, std::pair<qint64, qint64>>& amountsByDay, const QModelIndex& modelIndex)
 {
-    if (!stakesFilter) return;
-    if (chartShow != ALL) {
-        bool filterByMonth = false;
-        if (monthFilter != 0 && chartShow == MONTH) {
-            filterByMonth = true;
-        }
-        if (yearFilter != 0) {
-            if (filterByMonth) {
-                QDate monthFirst = QDate(yearFilter, monthFilter, 1);
-                QDate monthLast = QDate(yearFilter, monthFilter, monthFirst.daysInMonth());
-                stakesFilter->setDateRange(
-                        QDateTime(monthFirst),
-                        QDateTime(monthLast).addSecs(86399) // last second of the day
-                );
-            } else {
-                stakesFilter->setDateRange(
-                        QDateTime(QDate(yearFilter, 1, 1)),
-                        QDateTime(QDate(yearFilter, 12, 31))
-                );
-            }
-        } else if (filterByMonth) {
-            QDate currentDate = QDate::currentDate();
-            QDate monthFirst = QDate(currentDate.year(), monthFilter, 1);
-            stakesFilter->setDateRange(
-                    QDateTime(monthFirst),
-                    QDateTime(QDate(currentDate.year(), monthFilter, monthFirst.daysInMonth()))
-            );
-            ui->comboBoxYears->setCurrentText(QString::number(currentDate.year()));
-        } else {
-            stakesFilter->clearDateRange();
-        }
+    qint64 amount = llabs(modelIndex.data(TransactionTableModel::AmountRole).toLongLong());
+    QDate date = modelIndex.data(TransactionTableModel::DateRole).toDateTime().date();
+    bool isPiv = modelIndex.data(TransactionTableModel::TypeRole).toInt() != TransactionRecord::MNReward;
+
+    std::pair<qint64, qint64>& amounts = amountsByDay[date];
+    if (isPiv) {
+        amounts.first += amount;
     } else {
-        stakesFilter->clearDateRange();
+        amounts.second += amount;
+    }
+}
+
+void DashboardWidget::loadAmountsByDay()
+{
+    fReloadAmountsByDay = false;
+    QMap<QDate, std::pair<qint64, qint64>> amounts;
+    // Get all the stakes
+    const int size = stakesFilter->rowCount();
+    for (int i = 0; i < size; ++i) {
+        addStakeAmount(amounts, stakesFilter->index(i, TransactionTableModel::ToAddress));
+    }
+    QMutexLocker locker(&amountsByDayMutex);
+    amountsByDay.swap(amounts);
+}
+
+void DashboardWidget::onStakesInserted(const QModelIndex& parent, int start, int end)
+{
+    // A chart load in progress may or may not see the new rows, load them all again on the next one
+    if (isLoading) {
+        fReloadAmountsByDay = true;
+        return;
+    }
+    QMutexLocker locker(&amountsByDayMutex);
+    for (int i = start; i <= end; ++i) {
+        addStakeAmount(amountsByDay, stakesFilter->index(i, TransactionTableModel::ToAddress, parent));
     }
 }
 
+void DashboardWidget::onStakesRemoved()
+{
+    fReloadAmountsByDay = true;
+}
+
 // pair PIV, MN Reward
 QMap<int, std::pair<qint64, qint64>> DashboardWidget::getAmountBy()
 {
-    if (filterUpdateNeeded) {
-        filterUpdateNeeded = false;
-        updateStakeFilter();
+    if (fReloadAmountsByDay) {
+        loadAmountsByDay();
+    }
+
+    // The days of the chart period (unbounded if invalid)
+    QDate dateFrom, dateTo;
+    if (chartShow == MONTH && monthFilter != 0) {
+        dateFrom = QDate(yearFilter != 0 ? yearFilter : QDate::currentDate().year(), monthFilter, 1);
+        dateTo = dateFrom.addMonths(1).addDays(-1);
+    } else if (chartShow != ALL && yearFilter != 0) {
+        dateFrom = QDate(yearFilter, 1, 1);
+        dateTo = QDate(yearFilter, 12, 31);
     }
-    const int size = stakesFilter->rowCount();
-    QMap<int, std::pair<qint64, qint64>> amountBy;
-    // Get all the stakes
-    for (int i = 0; i < size; ++i) {
-        QModelIndex modelIndex = stakesFilter->index(i, TransactionTableModel::ToAddress);
-        qint64 amount = llabs(modelIndex.data(TransactionTableModel::AmountRole).toLongLong());
-        QDate date = modelIndex.data(TransactionTableModel::DateRole).toDateTime().date();
-        bool isPiv = modelIndex.data(TransactionTableModel::TypeRole).toInt() != TransactionRecord::MNReward;
 
+    QMap<int, std::pair<qint64, qint64>> amountBy;
+    QMutexLocker locker(&amountsByDayMutex);
+    auto it = dateFrom.isValid() ? amountsByDay.lowerBound(dateFrom) : amountsByDay.begin();
+    for (; it != amountsByDay.end() && !(dateTo.isValid() && it.key() > dateTo); ++it) {
+        const QDate& date = it.key();
         int time = 0;
         switch (chartShow) {
             case YEAR: {
@@ -552,19 +566,10 @@ QMap<int, std::pair<qint64, qint64>> DashboardWidget::getAmountBy()
                 inform(tr("Error loading chart, invalid show option"));
                 return amountBy;
         }
-        if (amountBy.contains(time)) {
-            if (isPiv) {
-                amountBy[time].first += amount;
-            } else
-                amountBy[time].second += amount;
-        } else {
-            if (isPiv) {
-                amountBy[time] = std::make_pair(amount, 0);
-            } else {
-                amountBy[time] = std::make_pair(0, amount);
-                hasMNRewards = true;
-            }
-        }
+        std::pair<qint64, qint64>& amounts = amountBy[time];
+        amounts.first += it.value().first;
+        amounts.second += it.value().second;
+        if (it.value().second != 0) hasMNRewards = true;
     }
     return amountBy;
 }
@@ -620,7 +625,6 @@ void DashboardWidget::onChartYearChanged(const QString& yearStr)
         int newYear = yearStr.toInt();
         if (newYear != yearFilter) {
             yearFilter = newYear;
-            filterUpdateNeeded = true;
             refreshChart();
         }
     }
@@ -632,7 +636,6 @@ void DashboardWidget::onChartMonthChanged(const QString& monthStr)
         int newMonth = ui->comboBoxMonths->currentData().toInt();
         if (newMonth != monthFilter) {
             monthFilter = newMonth;
-            filterUpdateNeeded = true;
             refreshChart();
 #ifndef Q_OS_MAC
         // quick hack to re paint the chart view.
@@ -825,7 +828,6 @@ void DashboardWidget::onChartArrowClicked(bool goLeft)
             }
         }
     }
-    filterUpdateNeeded = true;
     refreshChart();
     //Check if data end day is current date and monthfilter is current month
     bool fEndDayisCurrent = dataenddate  == currentDate.day() && monthFilter == currentDate.month();
@@ -888,10 +890,15 @@ void DashboardWidget::onHideChartsChanged(bool fHide)
                                         TransactionFilterProxy::TYPE(TransactionRecord::StakeZPIV) |
                                         TransactionFilterProxy::TYPE(TransactionRecord::StakeDelegated) |
                                         TransactionFilterProxy::TYPE(TransactionRecord::MNReward));
+            // Keep the amounts per day up to date with the new stakes only
+            connect(stakesFilter, &TransactionFilterProxy::rowsInserted, this, &DashboardWidget::onStakesInserted);
+            connect(stakesFilter, &TransactionFilterProxy::rowsRemoved, this, &DashboardWidget::onStakesRemoved);
+            connect(stakesFilter, &TransactionFilterProxy::modelReset, this, &DashboardWidget::onStakesRemoved);
+            connect(stakesFilter, &TransactionFilterProxy::layoutChanged, this, &DashboardWidget::onStakesRemoved);
         }
         stakesFilter->setSourceModel(txModel);
         hasStakes = stakesFilter->rowCount() > 0;
-        filterUpdateNeeded = true;
+        fReloadAmountsByDay = true;
     } else {
         if (stakesFilter) {
             stakesFilter->setSourceModel(nullptr);
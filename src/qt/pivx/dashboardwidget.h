@@ -15,8 +15,10 @@
 #include <atomic>
 #include <cstdlib>
 #include <QWidget>
+#include <QDate>
 #include <QLineEdit>
 #include <QMap>
+#include <QMutex>
 
 #if defined(HAVE_CONFIG_H)
 #include "config/pivx-config.h" /* for USE_QTCHARTS */
@@ -170,13 +172,17 @@ private:
     ChartData* chartData{nullptr};
     bool hasStakes{false};
     bool fShowCharts{true};
-    std::atomic<bool> filterUpdateNeeded{false};
+    // The stakes and MN rewards per day (pair PIV, MN Reward), loaded once in the background
+    // and then updated with the stakes added to stakesFilter. getAmountBy sums them per chart period.
+    QMap<QDate, std::pair<qint64, qint64>> amountsByDay;
+    QMutex amountsByDayMutex;
+    std::atomic<bool> fReloadAmountsByDay{true};
 
     void initChart();
     void showHideEmptyChart(bool show, bool loading, bool forceView = false);
     bool refreshChart();
     void tryChartRefresh();
-    void updateStakeFilter();
+    void loadAmountsByDay();
     QMap<int, std::pair<qint64, qint64>> getAmountBy();
     bool loadChartData(bool withMonthNames);
     void updateAxisX(const QStringList *arg = nullptr);
@@ -186,6 +192,8 @@ private:
 private Q_SLOTS:
     void onChartRefreshed();
     void onHideChartsChanged(bool fHide);
+    void onStakesInserted(const QModelIndex& parent, int start, int end);
+    void onStakesRemoved();
 
 #endif
 
@@ -17,7 +17,9 @@
 #include "walletmodel.h"
 
 #include <algorithm>
+#include <set>
 #include <QTimer>
+#include <QtConcurrent/QtConcurrent>
 
 std::string ProposalInfo::statusToStr() const
 {
@@ -36,8 +38,24 @@ std::string ProposalInfo::statusToStr() const
     return "";
 }
 
-GovernanceModel::GovernanceModel(ClientModel* _clientModel, MNModel* _mnModel) : clientModel(_clientModel), mnModel(_mnModel) {}
-GovernanceModel::~GovernanceModel() {}
+static bool SameProposalInfo(const ProposalInfo& a, const ProposalInfo& b)
+{
+    return a.id == b.id && a.name == b.name && a.url == b.url && a.votesYes == b.votesYes &&
+           a.votesNo == b.votesNo && a.recipientAdd == b.recipientAdd && a.amount == b.amount &&
+           a.totalPayments == b.totalPayments && a.remainingPayments == b.remainingPayments &&
+           a.status == b.status && a.startBlock == b.startBlock && a.endBlock == b.endBlock;
+}
+
+GovernanceModel::GovernanceModel(ClientModel* _clientModel, MNModel* _mnModel) : clientModel(_clientModel), mnModel(_mnModel)
+{
+    proposalsWatcher = new QFutureWatcher<ProposalsResult>(this);
+    connect(proposalsWatcher, &QFutureWatcher<ProposalsResult>::finished, this, &GovernanceModel::onProposalsLoaded);
+}
+
+GovernanceModel::~GovernanceModel()
+{
+    proposalsWatcher->waitForFinished();
+}
 
 void GovernanceModel::setWalletModel(WalletModel* _walletModel)
 {
@@ -45,7 +63,8 @@ void GovernanceModel::setWalletModel(WalletModel* _walletModel)
     connect(walletModel->getTransactionTableModel(), &TransactionTableModel::txLoaded, this, &GovernanceModel::txLoaded);
 }
 
-ProposalInfo GovernanceModel::buildProposalInfo(const CBudgetProposal* prop, bool isPassing, bool isPending)
+ProposalInfo GovernanceModel::buildProposalInfo(const CBudgetProposal* prop, bool isPassing, bool isPending,
+                                                CAmount allocatedAmount, const BudgetContext& context)
 {
     CTxDestination recipient;
     ExtractDestination(prop->GetPayee(), recipient);
@@ -53,8 +72,8 @@ ProposalInfo GovernanceModel::buildProposalInfo(const CBudgetProposal* prop, boo
     // Calculate status
     int votesYes = prop->GetYeas();
     int votesNo = prop->GetNays();
-    int mnCount = clientModel->getMasternodesCount();
-    int remainingPayments = prop->GetRemainingPaymentCount(clientModel->getLastBlockProcessedHeight());
+    int mnCount = context.mnCount;
+    int remainingPayments = prop->GetRemainingPaymentCount(context.chainHeight);
     ProposalInfo::Status status;
 
     if (isPending) {
@@ -65,7 +84,7 @@ ProposalInfo GovernanceModel::buildProposalInfo(const CBudgetProposal* prop, boo
             status = ProposalInfo::FINISHED;
         } else if (isPassing) {
             status = ProposalInfo::PASSING;
-        } else if (allocatedAmount + prop->GetAmount() > getMaxAvailableBudgetAmount() && votesYes - votesNo > mnCount / 10) {
+        } else if (allocatedAmount + prop->GetAmount() > context.maxBudget && votesYes - votesNo > mnCount / 10) {
             status = ProposalInfo::PASSING_NOT_FUNDED;
         } else {
             status = ProposalInfo::NOT_PASSING;
@@ -86,26 +105,75 @@ ProposalInfo GovernanceModel::buildProposalInfo(const CBudgetProposal* prop, boo
             prop->GetBlockEnd());
 }
 
+GovernanceModel::BudgetContext GovernanceModel::getBudgetContext() const
+{
+    BudgetContext context;
+    context.mnCount = clientModel->getMasternodesCount();
+    context.chainHeight = clientModel->getLastBlockProcessedHeight();
+    context.maxBudget = getMaxAvailableBudgetAmount();
+    return context;
+}
+
+GovernanceModel::ProposalsResult GovernanceModel::loadProposals(const BudgetContext& context)
+{
+    std::set<uint256> budget;
+    for (const CBudgetProposal& prop : g_budgetman.GetBudget()) {
+        budget.emplace(prop.GetHash());
+    }
+    ProposalsResult ret;
+    CAmount& allocated = ret.second;
+    allocated = 0;
+    for (const auto& prop : g_budgetman.GetAllProposalsOrdered()) {
+        bool isPassing = budget.count(prop->GetHash()) > 0;
+        ret.first.emplace_back(buildProposalInfo(prop, isPassing, false, allocated, context));
+        if (isPassing) allocated += prop->GetAmount();
+    }
+    return ret;
+}
+
+void GovernanceModel::refreshProposals()
+{
+    if (!clientModel || proposalsWatcher->isRunning()) return;
+    proposalsWatcher->setFuture(QtConcurrent::run(&GovernanceModel::loadProposals, getBudgetContext()));
+}
+
+void GovernanceModel::onProposalsLoaded()
+{
+    ProposalsResult result = proposalsWatcher->result();
+    bool changed = !proposalsLoaded || result.second != allocatedAmount ||
+                   !std::equal(result.first.begin(), result.first.end(), cachedProposals.begin(), cachedProposals.end(), SameProposalInfo);
+    proposalsLoaded = true;
+    if (!changed) return;
+    cachedProposals.swap(result.first);
+    allocatedAmount = result.second;
+    refreshNeeded = true;
+    Q_EMIT proposalsChanged();
+}
+
 std::list<ProposalInfo> GovernanceModel::getProposals(const ProposalInfo::Status* filterByStatus, bool filterFinished)
 {
     if (!clientModel) return {};
-    std::list<ProposalInfo> ret;
-    std::vector<CBudgetProposal> budget = g_budgetman.GetBudget();
-    allocatedAmount = 0;
-    for (const auto& prop : g_budgetman.GetAllProposalsOrdered()) {
-        bool isPassing = std::find(budget.begin(), budget.end(), *prop) != budget.end();
-        ProposalInfo propInfo = buildProposalInfo(prop, isPassing, false);
+    if (!proposalsLoaded) {
+        // First call, nothing to show yet: load them here
+        ProposalsResult result = loadProposals(getBudgetContext());
+        cachedProposals.swap(result.first);
+        allocatedAmount = result.second;
+        proposalsLoaded = true;
+    }
+    refreshNeeded = false;
 
+    std::list<ProposalInfo> ret;
+    for (const auto& propInfo : cachedProposals) {
         if (filterFinished && propInfo.isFinished()) continue;
         if (!filterByStatus || propInfo.status == *filterByStatus) {
             ret.emplace_back(propInfo);
         }
-        if (isPassing) allocatedAmount += prop->GetAmount();
     }
 
     // Add pending proposals
+    const BudgetContext context = getBudgetContext();
     for (const auto& prop : waitingPropsForConfirmations) {
-        ProposalInfo propInfo = buildProposalInfo(&prop, false, true);
+        ProposalInfo propInfo = buildProposalInfo(&prop, false, true, allocatedAmount, context);
         if (!filterByStatus || propInfo.status == *filterByStatus) {
             ret.emplace_back(propInfo);
         }
@@ -343,6 +411,7 @@ void GovernanceModel::stop()
     if (pollTimer && pollTimer->isActive()) {
         pollTimer->stop();
     }
+    proposalsWatcher->waitForFinished();
 }
 
 void GovernanceModel::txLoaded(const QString& id, const int txType, const int txStatus)
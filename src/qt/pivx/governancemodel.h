@@ -14,6 +14,7 @@
 #include <list>
 #include <utility>
 
+#include <QFutureWatcher>
 #include <QObject>
 
 struct ProposalInfo {
@@ -88,13 +89,14 @@ QT_END_NAMESPACE
 
 class GovernanceModel : public QObject
 {
+    Q_OBJECT
 
 public:
     explicit GovernanceModel(ClientModel* _clientModel, MNModel* _mnModel);
     ~GovernanceModel() override;
     void setWalletModel(WalletModel* _walletModel);
 
-    // Return proposals ordered by net votes.
+    // Return proposals ordered by net votes, as of the last refresh.
     // By default, do not return zombie finished proposals that haven't been cleared yet (backend removal sources need a cleanup).
     std::list<ProposalInfo> getProposals(const ProposalInfo::Status* filterByStatus = nullptr, bool filterFinished = true);
     // Returns true if there is at least one proposal cached
@@ -138,14 +140,31 @@ public:
                                     bool isVotePositive,
                                     const std::vector<std::string>& mnVotingAlias);
 
+    // Reload the proposals in a background thread, proposalsChanged is emitted if any changed
+    void refreshProposals();
+
     // Stop internal timers
     void stop();
 
+Q_SIGNALS:
+    void proposalsChanged();
+
 public Q_SLOTS:
     void pollGovernanceChanged();
     void txLoaded(const QString& hash, const int txType, const int txStatus);
 
+private Q_SLOTS:
+    void onProposalsLoaded();
+
 private:
+    // The chain data the proposals status depends on, read in the GUI thread
+    struct BudgetContext {
+        int mnCount{0};
+        int chainHeight{0};
+        CAmount maxBudget{0};
+    };
+    typedef std::pair<std::list<ProposalInfo>, CAmount> ProposalsResult;
+
     ClientModel* clientModel{nullptr};
     WalletModel* walletModel{nullptr};
     MNModel* mnModel{nullptr};
@@ -153,6 +172,10 @@ private:
 
     // Cached amount
     CAmount allocatedAmount{0};
+    // All the proposals, ordered by net votes, of the last refresh
+    std::list<ProposalInfo> cachedProposals;
+    bool proposalsLoaded{false};
+    QFutureWatcher<ProposalsResult>* proposalsWatcher{nullptr};
 
     QTimer* pollTimer{nullptr};
     // Cached proposals waiting for the minimum required confirmations
@@ -161,8 +184,12 @@ private:
 
     void scheduleBroadcast(const CBudgetProposal& proposal);
 
+    BudgetContext getBudgetContext() const;
+    // Read the proposals of the budget manager, off the GUI thread
+    static ProposalsResult loadProposals(const BudgetContext& context);
     // Util function to create a ProposalInfo object
-    ProposalInfo buildProposalInfo(const CBudgetProposal* prop, bool isPassing, bool isPending);
+    static ProposalInfo buildProposalInfo(const CBudgetProposal* prop, bool isPassing, bool isPending,
+                                          CAmount allocatedAmount, const BudgetContext& context);
 };
 
 #endif // GOVERNANCEMODEL_H
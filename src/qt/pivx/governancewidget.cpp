@@ -138,8 +138,8 @@ void GovernanceWidget::onVoteForPropClicked(const ProposalInfo& proposalInfo)
     VoteDialog* dialog = new VoteDialog(window, governanceModel, mnModel);
     dialog->setProposal(proposalInfo);
     if (openDialogWithOpaqueBackgroundY(dialog, window, 4.5, 5)) {
-        // future: make this refresh atomic, no need to refresh the entire grid.
-        tryGridRefresh(true);
+        // The grid is refreshed when the new votes are loaded
+        governanceModel->refreshProposals();
         inform(tr("Vote emitted successfully!"));
     }
     dialog->deleteLater();
@@ -260,6 +260,9 @@ void GovernanceWidget::chainHeightChanged(int height)
 void GovernanceWidget::setGovModel(GovernanceModel* _model)
 {
     governanceModel = _model;
+    connect(governanceModel, &GovernanceModel::proposalsChanged, [this]() {
+        if (isVisible()) tryGridRefresh(true);
+    });
 }
 
 void GovernanceWidget::setMNModel(MNModel* _mnModel)
@@ -275,10 +278,11 @@ void GovernanceWidget::loadWalletModel()
 void GovernanceWidget::showEvent(QShowEvent *event)
 {
     clientModel->startMasternodesTimer();
-    tryGridRefresh(true); // future: move to background worker
+    tryGridRefresh(true);
+    governanceModel->refreshProposals();
     if (!refreshTimer) refreshTimer = new QTimer(this);
     if (!refreshTimer->isActive()) {
-        connect(refreshTimer, &QTimer::timeout, [this]() { tryGridRefresh(true); });
+        connect(refreshTimer, &QTimer::timeout, [this]() { governanceModel->refreshProposals(); });
         refreshTimer->start(1000 * 60 * 3.5); // Try to refresh screen 3.5 minutes
     }
 }
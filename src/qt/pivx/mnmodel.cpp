@@ -17,39 +17,144 @@
 #include "tiertwo/tiertwo_sync_state.h"
 #include "uint256.h"
 
+#include <algorithm>
+
 #include <QFile>
 #include <QHostAddress>
+#include <QtConcurrent/QtConcurrent>
+
+bool MNModel::MNEntry::operator==(const MNEntry& other) const
+{
+    return alias == other.alias && ip == other.ip && collateral == other.collateral &&
+           isAvailable == other.isAvailable && pubKeyHash == other.pubKeyHash && status == other.status &&
+           activeState == other.activeState && wasCollateralAccepted == other.wasCollateralAccepted;
+}
 
-MNModel::MNModel(QObject *parent) : QAbstractTableModel(parent) {}
+MNModel::MNModel(QObject *parent) : QAbstractTableModel(parent)
+{
+    loadWatcher = new QFutureWatcher<QList<MNEntry>>(this);
+    connect(loadWatcher, &QFutureWatcher<QList<MNEntry>>::finished, this, &MNModel::onMNListLoaded);
+}
+
+MNModel::~MNModel()
+{
+    stop();
+}
+
+void MNModel::stop()
+{
+    // The refresh reads the wallet model, wait for it
+    loadWatcher->waitForFinished();
+}
 
 void MNModel::init()
 {
-    updateMNList();
+    // First load in the GUI thread, the screens read the nodes right after
+    applyMNList(loadMNList(masternodeConfig.getEntries(), walletModel, getMasternodeCollateralMinConf()));
 }
 
-void MNModel::updateMNList()
+MNModel::MNEntry MNModel::loadMNEntry(const CMasternodeConfig::CMasternodeEntry& mne, const COutPoint& collateral,
+                                      bool createMissing, WalletModel* walletModel, int mnMinConf)
 {
-    int mnMinConf = getMasternodeCollateralMinConf();
-    int end = nodes.size();
-    nodes.clear();
-    collateralTxAccepted.clear();
-    for (const CMasternodeConfig::CMasternodeEntry& mne : masternodeConfig.getEntries()) {
+    MNEntry entry;
+    entry.alias = QString::fromStdString(mne.getAlias());
+    entry.ip = QString::fromStdString(mne.getIp());
+    entry.collateral = collateral;
+
+    CMasternode mn;
+    const CMasternode* pmn = mnodeman.Find(collateral);
+    if (pmn) {
+        mn = *pmn;
+    } else {
+        mn.vin = CTxIn(collateral);
+    }
+    entry.isAvailable = pmn || createMissing;
+    entry.pubKeyHash = QString::fromStdString(mn.pubKeyMasternode.GetHash().GetHex());
+    entry.activeState = mn.GetActiveState();
+    std::string status = mn.Status();
+    // Quick workaround to the current Masternode status types.
+    // If the status is REMOVE and there is no pubkey associated to the Masternode
+    // means that the MN is not in the network list and was created here.
+    // Which.. denotes a not started masternode.
+    // This will change in the future with the MasternodeWrapper introduction.
+    if (!pmn || (status == "REMOVE" && !mn.pubKeyCollateralAddress.IsValid())) {
+        status = "MISSING";
+    }
+    entry.status = QString::fromStdString(status);
+    entry.wasCollateralAccepted = walletModel && walletModel->getWalletTxDepth(collateral.hash) >= mnMinConf;
+    return entry;
+}
+
+QList<MNModel::MNEntry> MNModel::loadMNList(const std::vector<CMasternodeConfig::CMasternodeEntry>& entries,
+                                            WalletModel* walletModel, int mnMinConf)
+{
+    QList<MNEntry> list;
+    for (const CMasternodeConfig::CMasternodeEntry& mne : entries) {
         int nIndex;
         if (!mne.castOutputIndex(nIndex))
             continue;
-        const uint256& txHash = uint256S(mne.getTxHash());
-        CTxIn txIn(txHash, uint32_t(nIndex));
-        CMasternode* pmn = mnodeman.Find(txIn.prevout);
-        if (!pmn) {
-            pmn = new CMasternode();
-            pmn->vin = txIn;
-        }
-        nodes.insert(QString::fromStdString(mne.getAlias()), std::make_pair(QString::fromStdString(mne.getIp()), pmn));
-        if (walletModel) {
-            collateralTxAccepted.insert(mne.getTxHash(), walletModel->getWalletTxDepth(txHash) >= mnMinConf);
+        list.append(loadMNEntry(mne, COutPoint(uint256S(mne.getTxHash()), uint32_t(nIndex)), true, walletModel, mnMinConf));
+    }
+    std::stable_sort(list.begin(), list.end(), [](const MNEntry& a, const MNEntry& b) { return a.alias < b.alias; });
+    // One row per alias
+    list.erase(std::unique(list.begin(), list.end(), [](const MNEntry& a, const MNEntry& b) { return a.alias == b.alias; }), list.end());
+    return list;
+}
+
+void MNModel::updateMNList()
+{
+    if (loadWatcher->isRunning()) {
+        // Already refreshing, redone when it ends if the nodes were edited meanwhile
+        return;
+    }
+    loadGeneration = nodesGeneration;
+    // Copy the entries here, masternodeConfig is edited in the GUI thread only
+    loadWatcher->setFuture(QtConcurrent::run(&MNModel::loadMNList, masternodeConfig.getEntries(),
+                                             walletModel, getMasternodeCollateralMinConf()));
+}
+
+void MNModel::onMNListLoaded()
+{
+    if (loadGeneration != nodesGeneration) {
+        // addMn or removeMn ran meanwhile, the result may have the old entries
+        updateMNList();
+        return;
+    }
+    applyMNList(loadWatcher->result());
+}
+
+void MNModel::applyMNList(QList<MNEntry> list)
+{
+    // Both lists are sorted by alias: merge them, removing, inserting and updating the rows in place
+    int row = 0;
+    int i = 0;
+    while (row < nodes.size() || i < list.size()) {
+        if (i == list.size() || (row < nodes.size() && nodes[row].alias < list[i].alias)) {
+            beginRemoveRows(QModelIndex(), row, row);
+            nodes.removeAt(row);
+            endRemoveRows();
+        } else if (row == nodes.size() || list[i].alias < nodes[row].alias) {
+            beginInsertRows(QModelIndex(), row, row);
+            nodes.insert(row, list[i]);
+            endInsertRows();
+            row++;
+            i++;
+        } else {
+            if (!(nodes[row] == list[i])) {
+                nodes[row] = list[i];
+                Q_EMIT dataChanged(index(row, 0, QModelIndex()), index(row, columnCount() - 1, QModelIndex()));
+            }
+            row++;
+            i++;
         }
     }
-    Q_EMIT dataChanged(index(0, 0, QModelIndex()), index(end, 5, QModelIndex()) );
+}
+
+const MNModel::MNEntry* MNModel::findMN(const QString& alias) const
+{
+    auto it = std::lower_bound(nodes.begin(), nodes.end(), alias,
+                               [](const MNEntry& entry, const QString& key) { return entry.alias < key; });
+    return it != nodes.end() && it->alias == alias ? &(*it) : nullptr;
 }
 
 int MNModel::rowCount(const QModelIndex &parent) const
@@ -69,45 +174,28 @@ int MNModel::columnCount(const QModelIndex &parent) const
 
 QVariant MNModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid())
+    if (!index.isValid() || index.row() >= nodes.size())
             return QVariant();
 
-    // rec could be null, always verify it.
-    CMasternode* rec = static_cast<CMasternode*>(index.internalPointer());
-    bool isAvailable = rec;
-    int row = index.row();
+    const MNEntry& rec = nodes[index.row()];
     if (role == Qt::DisplayRole || role == Qt::EditRole) {
         switch (index.column()) {
             case ALIAS:
-                return nodes.uniqueKeys().value(row);
+                return rec.alias;
             case ADDRESS:
-                return nodes.values().value(row).first;
+                return rec.ip;
             case PUB_KEY:
-                return (isAvailable) ? QString::fromStdString(nodes.values().value(row).second->pubKeyMasternode.GetHash().GetHex()) : "Not available";
+                return (rec.isAvailable) ? rec.pubKeyHash : "Not available";
             case COLLATERAL_ID:
-                return (isAvailable) ? QString::fromStdString(rec->vin.prevout.hash.GetHex()) : "Not available";
+                return (rec.isAvailable) ? QString::fromStdString(rec.collateral.hash.GetHex()) : "Not available";
             case COLLATERAL_OUT_INDEX:
-                return (isAvailable) ? QString::number(rec->vin.prevout.n) : "Not available";
-            case STATUS: {
-                std::pair<QString, CMasternode*> pair = nodes.values().value(row);
-                std::string status = "MISSING";
-                if (pair.second) {
-                    status = pair.second->Status();
-                    // Quick workaround to the current Masternode status types.
-                    // If the status is REMOVE and there is no pubkey associated to the Masternode
-                    // means that the MN is not in the network list and was created in
-                    // updateMNList(). Which.. denotes a not started masternode.
-                    // This will change in the future with the MasternodeWrapper introduction.
-                    if (status == "REMOVE" && !pair.second->pubKeyCollateralAddress.IsValid()) {
-                        return "MISSING";
-                    }
-                }
-                return QString::fromStdString(status);
-            }
+                return (rec.isAvailable) ? QString::number(rec.collateral.n) : "Not available";
+            case STATUS:
+                return rec.status;
             case PRIV_KEY: {
-                if (isAvailable) {
-                    for (CMasternodeConfig::CMasternodeEntry mne : masternodeConfig.getEntries()) {
-                        if (mne.getTxHash().compare(rec->vin.prevout.hash.GetHex()) == 0) {
+                if (rec.isAvailable) {
+                    for (const CMasternodeConfig::CMasternodeEntry& mne : masternodeConfig.getEntries()) {
+                        if (mne.getTxHash().compare(rec.collateral.hash.GetHex()) == 0) {
                             return QString::fromStdString(mne.getPrivKey());
                         }
                     }
@@ -115,7 +203,7 @@ QVariant MNModel::data(const QModelIndex &index, int role) const
                 return "Not available";
             }
             case WAS_COLLATERAL_ACCEPTED:{
-                return isAvailable && collateralTxAccepted.value(rec->vin.prevout.hash.GetHex());
+                return rec.isAvailable && rec.wasCollateralAccepted;
             }
         }
     }
@@ -125,46 +213,51 @@ QVariant MNModel::data(const QModelIndex &index, int role) const
 QModelIndex MNModel::index(int row, int column, const QModelIndex& parent) const
 {
     Q_UNUSED(parent);
-    std::pair<QString, CMasternode*> pair = nodes.values().value(row);
-    CMasternode* data = pair.second;
-    if (data) {
-        return createIndex(row, column, data);
-    } else if (!pair.first.isEmpty()) {
-        return createIndex(row, column, nullptr);
-    } else {
+    if (row < 0 || row >= nodes.size()) {
         return QModelIndex();
     }
+    return createIndex(row, column, nullptr);
 }
 
 
 bool MNModel::removeMn(const QModelIndex& modelIndex)
 {
-    QString alias = modelIndex.data(Qt::DisplayRole).toString();
     int idx = modelIndex.row();
+    if (idx < 0 || idx >= nodes.size()) return false;
     beginRemoveRows(QModelIndex(), idx, idx);
-    nodes.take(alias);
+    nodes.removeAt(idx);
+    nodesGeneration++;
     endRemoveRows();
-    Q_EMIT dataChanged(index(idx, 0, QModelIndex()), index(idx, 5, QModelIndex()) );
     return true;
 }
 
 bool MNModel::addMn(CMasternodeConfig::CMasternodeEntry* mne)
 {
-    beginInsertRows(QModelIndex(), nodes.size(), nodes.size());
     int nIndex;
     if (!mne->castOutputIndex(nIndex))
         return false;
 
-    CMasternode* pmn = mnodeman.Find(COutPoint(uint256S(mne->getTxHash()), uint32_t(nIndex)));
-    nodes.insert(QString::fromStdString(mne->getAlias()), std::make_pair(QString::fromStdString(mne->getIp()), pmn));
-    endInsertRows();
+    MNEntry entry = loadMNEntry(*mne, COutPoint(uint256S(mne->getTxHash()), uint32_t(nIndex)), false,
+                                walletModel, getMasternodeCollateralMinConf());
+    auto it = std::lower_bound(nodes.begin(), nodes.end(), entry.alias,
+                               [](const MNEntry& e, const QString& key) { return e.alias < key; });
+    int row = it - nodes.begin();
+    if (it != nodes.end() && it->alias == entry.alias) {
+        nodes[row] = entry;
+        Q_EMIT dataChanged(index(row, 0, QModelIndex()), index(row, columnCount() - 1, QModelIndex()));
+    } else {
+        beginInsertRows(QModelIndex(), row, row);
+        nodes.insert(row, entry);
+        endInsertRows();
+    }
+    nodesGeneration++;
     return true;
 }
 
 int MNModel::getMNState(const QString& mnAlias)
 {
-    QMap<QString, std::pair<QString, CMasternode*>>::const_iterator it = nodes.find(mnAlias);
-    if (it != nodes.end()) return it.value().second->GetActiveState();
+    const MNEntry* entry = findMN(mnAlias);
+    if (entry) return entry->activeState;
     throw std::runtime_error(std::string("Masternode alias not found"));
 }
 
@@ -182,8 +275,8 @@ bool MNModel::isMNActive(const QString& mnAlias)
 
 bool MNModel::isMNCollateralMature(const QString& mnAlias)
 {
-    QMap<QString, std::pair<QString, CMasternode*>>::const_iterator it = nodes.find(mnAlias);
-    if (it != nodes.end()) return collateralTxAccepted.value(it.value().second->vin.prevout.hash.GetHex());
+    const MNEntry* entry = findMN(mnAlias);
+    if (entry) return entry->wasCollateralAccepted;
     throw std::runtime_error(std::string("Masternode alias not found"));
 }
 
@@ -6,21 +6,18 @@
 #define MNMODEL_H
 
 #include <QAbstractTableModel>
+#include <QFutureWatcher>
 #include "masternodeconfig.h"
+#include "primitives/transaction.h"
 #include "qt/walletmodel.h"
 
-class CMasternode;
-
 class MNModel : public QAbstractTableModel
 {
     Q_OBJECT
 
 public:
     explicit MNModel(QObject *parent);
-    ~MNModel() override {
-        nodes.clear();
-        collateralTxAccepted.clear();
-    }
+    ~MNModel() override;
     void init();
     void setWalletModel(WalletModel* _model) { walletModel = _model; };
 
@@ -43,7 +40,10 @@ public:
     QModelIndex index(int row, int column, const QModelIndex& parent) const override;
     bool removeMn(const QModelIndex& index);
     bool addMn(CMasternodeConfig::CMasternodeEntry* entry);
+    // Refresh the state of the masternodes in a background thread, the changed rows are updated when done
     void updateMNList();
+    // Wait for the running refresh
+    void stop();
 
 
     bool isMNsNetworkSynced();
@@ -80,12 +80,41 @@ public:
     void setCoinControl(CCoinControl* coinControl);
     void resetCoinControl();
 
+private Q_SLOTS:
+    void onMNListLoaded();
+
 private:
-    WalletModel* walletModel;
-    CCoinControl* coinControl;
-    // alias mn node ---> pair <ip, master node>
-    QMap<QString, std::pair<QString, CMasternode*>> nodes;
-    QMap<std::string, bool> collateralTxAccepted;
+    // The state of a masternode.conf entry, as of the last refresh
+    struct MNEntry {
+        QString alias;
+        QString ip;
+        COutPoint collateral;
+        // Whether the masternode was found, or created (not started yet)
+        bool isAvailable{false};
+        QString pubKeyHash;
+        QString status;
+        int activeState{0};
+        bool wasCollateralAccepted{false};
+
+        bool operator==(const MNEntry& other) const;
+    };
+
+    static MNEntry loadMNEntry(const CMasternodeConfig::CMasternodeEntry& mne, const COutPoint& collateral,
+                               bool createMissing, WalletModel* walletModel, int mnMinConf);
+    static QList<MNEntry> loadMNList(const std::vector<CMasternodeConfig::CMasternodeEntry>& entries,
+                                     WalletModel* walletModel, int mnMinConf);
+    // Apply a refreshed list, signaling only the changed rows
+    void applyMNList(QList<MNEntry> list);
+    const MNEntry* findMN(const QString& alias) const;
+
+    WalletModel* walletModel{nullptr};
+    CCoinControl* coinControl{nullptr};
+    // Sorted by alias
+    QList<MNEntry> nodes;
+    QFutureWatcher<QList<MNEntry>>* loadWatcher{nullptr};
+    // Changed on each local update of the nodes, discarding the refresh running at that time
+    int nodesGeneration{0};
+    int loadGeneration{0};
 };
 
 #endif // MNMODEL_H
@@ -654,6 +654,11 @@ bool TransactionRecord::statusUpdateNeeded(int blockHeight) const
     return status.cur_num_blocks != blockHeight || status.needsUpdate;
 }
 
+bool TransactionRecord::statusSettled(int nSettledDepth) const
+{
+    return !status.needsUpdate && status.status == TransactionStatus::Confirmed && status.depth > nSettledDepth;
+}
+
 int TransactionRecord::getOutputIndex() const
 {
     return idx;
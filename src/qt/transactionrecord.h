@@ -191,6 +191,10 @@ public:
      */
     bool statusUpdateNeeded(int blockHeight) const;
 
+    /** Return whether the status can't change anymore (confirmed, deeper than nSettledDepth).
+     */
+    bool statusSettled(int nSettledDepth) const;
+
     /** Return transaction status
      */
     std::string statusToString();
@@ -7,6 +7,7 @@
 #include "transactiontablemodel.h"
 
 #include "addresstablemodel.h"
+#include "consensus/consensus.h"
 #include "guiconstants.h"
 #include "guiutil.h"
 #include "optionsmodel.h"
@@ -280,6 +281,24 @@ public:
         return cachedWallet.size();
     }
 
+    /* The row ranges of the records whose status can still change with the new blocks.
+     * The records deeper than the max reorg depth keep their status, no need to invalidate them.
+     */
+    QList<std::pair<int, int>> unsettledRanges()
+    {
+        const int nSettledDepth = gArgs.GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH);
+        QList<std::pair<int, int>> ranges;
+        for (int i = 0; i < cachedWallet.size(); i++) {
+            if (cachedWallet[i].statusSettled(nSettledDepth)) continue;
+            if (!ranges.isEmpty() && ranges.back().second == i - 1) {
+                ranges.back().second = i;
+            } else {
+                ranges.append(std::make_pair(i, i));
+            }
+        }
+        return ranges;
+    }
+
     TransactionRecord* index(int cur_block_num, const uint256& cur_block_hash, int idx)
     {
         if (idx >= 0 && idx < cachedWallet.size()) {
@@ -348,10 +367,13 @@ void TransactionTableModel::updateConfirmations()
 {
     // Blocks came in since last poll.
     // Invalidate status (number of confirmations) and (possibly) description
-    //  for all rows. Qt is smart enough to only actually request the data for the
-    //  visible rows.
-    Q_EMIT dataChanged(index(0, Status), index(priv->size() - 1, Status));
-    Q_EMIT dataChanged(index(0, ToAddress), index(priv->size() - 1, ToAddress));
+    //  for the rows that can still change. Qt is smart enough to only actually
+    //  request the data for the visible rows, but the filter proxies re-filter
+    //  all the invalidated rows, updating their status from the wallet.
+    for (const auto& range : priv->unsettledRanges()) {
+        Q_EMIT dataChanged(index(range.first, Status), index(range.second, Status));
+        Q_EMIT dataChanged(index(range.first, ToAddress), index(range.second, ToAddress));
+    }
 }
 
 int TransactionTableModel::rowCount(const QModelIndex& parent) const
@@ -9,10 +9,12 @@
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "httpserver.h"
+#include "index/compactsaplingindex.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
 #include "txmempool.h"
+#include "undo.h"
 #include "utilstrencodings.h"
 #include "validation.h"
 #include "version.h"
@@ -24,6 +26,8 @@
 
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const int32_t MAX_REST_BLOCKS = 1000; //allow a max of 1000 blocks to be queried at once
+static const int32_t MAX_REST_COMPACT_SAPLING_HEIGHTS = 10000; //allow a max of 10000 heights of compact sapling blocks at once
 
 enum RetFormat {
     RF_UNDEF,
@@ -47,7 +51,7 @@ struct CCoin {
     CTxOut out;
 
     CCoin() : nHeight(0) {}
-    CCoin(Coin&& in) : nHeight(in.nHeight), out(std::move(in.out)) {}
+    CCoin(Coin&& in) : nHeight(in.nHeight), out(in.GetTxOut()) {}
 
     SERIALIZE_METHODS(CCoin, obj)
     {
@@ -191,7 +195,6 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
-    CBlock block;
     const CBlockIndex* pblockindex;
     const CBlockIndex* tip;
     {
@@ -204,31 +207,34 @@ static bool rest_block(HTTPRequest* req,
 
         if (!(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
-
-        if (!ReadBlockFromDisk(block, pblockindex))
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
-
     switch (rf) {
     case RF_BINARY: {
-        std::string binaryBlock = ssBlock.str();
+        std::shared_ptr<const std::vector<unsigned char>> pblockRaw = ReadRawBlockFromDisk(pblockindex);
+        if (!pblockRaw)
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        std::string binaryBlock(pblockRaw->begin(), pblockRaw->end());
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
         return true;
     }
 
     case RF_HEX: {
-        std::string strHex = HexStr(ssBlock) + "\n";
+        std::shared_ptr<const std::vector<unsigned char>> pblockRaw = ReadRawBlockFromDisk(pblockindex);
+        if (!pblockRaw)
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        std::string strHex = HexStr(*pblockRaw) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, tip, pblockindex, showTxDetails);
+        std::shared_ptr<const CBlock> pblock = ReadSharedBlockFromDisk(pblockindex);
+        if (!pblock)
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        UniValue objBlock = blockToJSON(*pblock, tip, pblockindex, showTxDetails);
         std::string strJSON = objBlock.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strJSON);
@@ -251,6 +257,294 @@ static bool rest_block_notxdetails(HTTPRequest* req, const std::string& strURIPa
     return rest_block(req, strURIPart, false);
 }
 
+/**
+ * The blocks of the active chain from a height: /rest/blocks/<start height>/<count>.<bin|hex>
+ * The raw blocks are streamed one after the other, as they are read from the block files, without
+ * deserializing them. If a block is pruned meanwhile, the reply is truncated before it.
+ */
+static bool rest_blocks(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block count specified. Use /rest/blocks/<start height>/<count>.<ext>.");
+
+    int32_t nStart;
+    if (!ParseInt32(path[0], &nStart) || nStart < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + SanitizeString(path[0]));
+    int32_t count;
+    if (!ParseInt32(path[1], &count) || count < 1 || count > MAX_REST_BLOCKS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + SanitizeString(path[1]));
+    if (rf != RF_BINARY && rf != RF_HEX)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex)");
+
+    std::vector<const CBlockIndex*> blocks;
+    blocks.reserve(count);
+    {
+        LOCK(cs_main);
+        if (nStart > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+        for (const CBlockIndex* pindex = chainActive[nStart]; pindex && (int32_t)blocks.size() < count; pindex = chainActive.Next(pindex)) {
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA) && pindex->nTx > 0)
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+            blocks.push_back(pindex);
+        }
+    }
+
+    req->WriteHeader("Content-Type", rf == RF_BINARY ? "application/octet-stream" : "text/plain");
+    for (const CBlockIndex* pindex : blocks) {
+        std::shared_ptr<const std::vector<unsigned char>> pblockRaw = ReadRawBlockFromDisk(pindex);
+        if (!pblockRaw) {
+            if (pindex == blocks.front())
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not found");
+            LogPrint(BCLog::HTTP, "%s: block %s not found, truncating the reply\n", __func__, pindex->GetBlockHash().GetHex());
+            req->WriteReplyEnd();
+            return false;
+        }
+        if (rf == RF_BINARY) {
+            req->WriteReplyChunk(HTTP_OK, std::string(pblockRaw->begin(), pblockRaw->end()));
+        } else {
+            req->WriteReplyChunk(HTTP_OK, HexStr(*pblockRaw));
+        }
+    }
+    if (rf == RF_HEX)
+        req->WriteReplyChunk(HTTP_OK, "\n");
+    req->WriteReplyEnd();
+    return true;
+}
+
+static UniValue CompactSaplingBlockToJSON(const CCompactSaplingBlock& block)
+{
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("height", (int64_t)block.nHeight);
+    entry.pushKV("hash", block.hash.GetHex());
+    entry.pushKV("previousblockhash", block.hashPrevBlock.GetHex());
+    entry.pushKV("time", (int64_t)block.nTime);
+    UniValue txs(UniValue::VARR);
+    for (const CCompactSaplingTx& tx : block.vtx) {
+        UniValue txEntry(UniValue::VOBJ);
+        txEntry.pushKV("index", (int64_t)tx.nIndex);
+        txEntry.pushKV("txid", tx.txid.GetHex());
+        UniValue nullifiers(UniValue::VARR);
+        for (const uint256& nullifier : tx.vNullifiers) {
+            nullifiers.push_back(nullifier.GetHex());
+        }
+        txEntry.pushKV("nullifiers", nullifiers);
+        UniValue outputs(UniValue::VARR);
+        for (const CCompactSaplingOutput& output : tx.vOutputs) {
+            UniValue outputEntry(UniValue::VOBJ);
+            outputEntry.pushKV("cmu", output.cmu.GetHex());
+            outputEntry.pushKV("ephemeralKey", output.ephemeralKey.GetHex());
+            outputEntry.pushKV("ciphertext", HexStr(output.encCiphertext));
+            outputs.push_back(outputEntry);
+        }
+        txEntry.pushKV("outputs", outputs);
+        txs.push_back(txEntry);
+    }
+    entry.pushKV("vtx", txs);
+    return entry;
+}
+
+static bool rest_compact_sapling_blocks(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No height count specified. Use /rest/compactsaplingblocks/<start height>/<count>.<ext>.");
+
+    int32_t nStart;
+    if (!ParseInt32(path[0], &nStart) || nStart < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + SanitizeString(path[0]));
+    int32_t count;
+    if (!ParseInt32(path[1], &count) || count < 1 || count > MAX_REST_COMPACT_SAPLING_HEIGHTS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Height count out of range: " + SanitizeString(path[1]));
+    if (!g_compactsaplingindex)
+        return RESTERR(req, HTTP_NOT_FOUND, "Compact sapling blocks not available (requires -compactsaplingindex)");
+
+    // Only the heights the index is synced to: the client asks for the next ones later
+    const CBlockIndex* pindexBest = g_compactsaplingindex->GetBestBlockIndex();
+    if (!pindexBest || nStart > pindexBest->nHeight)
+        return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+    const int nEnd = (int)std::min((int64_t)nStart + count - 1, (int64_t)pindexBest->nHeight);
+
+    std::vector<CDataStream> blocks;
+    if (!g_compactsaplingindex->FindBlocks(nStart, nEnd, blocks))
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Error reading the compact sapling blocks");
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        // One compact block after the other, as they are stored in the index
+        req->WriteHeader("Content-Type", rf == RF_BINARY ? "application/octet-stream" : "text/plain");
+        std::string strReply;
+        for (const CDataStream& ss : blocks) {
+            strReply += rf == RF_BINARY ? ss.str() : HexStr(ss);
+        }
+        if (rf == RF_HEX)
+            strReply += "\n";
+        req->WriteReply(HTTP_OK, strReply);
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("start", nStart);
+        result.pushKV("end", nEnd);
+        UniValue jsonBlocks(UniValue::VARR);
+        for (CDataStream& ss : blocks) {
+            CCompactSaplingBlock block;
+            ss >> block;
+            jsonBlocks.push_back(CompactSaplingBlockToJSON(block));
+        }
+        result.pushKV("blocks", jsonBlocks);
+        std::string strJSON = result.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_blockhash_by_height(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    int32_t nHeight;
+    if (!ParseInt32(params[0], &nHeight) || nHeight < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + SanitizeString(params[0]));
+
+    uint256 hash;
+    {
+        LOCK(cs_main);
+        if (nHeight > chainActive.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+        hash = chainActive[nHeight]->GetBlockHash();
+    }
+
+    switch (rf) {
+    case RF_BINARY: {
+        CDataStream ssHash(SER_NETWORK, PROTOCOL_VERSION);
+        ssHash << hash;
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ssHash.str());
+        return true;
+    }
+
+    case RF_HEX: {
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, hash.GetHex() + "\n");
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue objHash(UniValue::VOBJ);
+        objHash.pushKV("blockhash", hash.GetHex());
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, objHash.write() + "\n");
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+/**
+ * The outputs spent by the transactions of a block, from its undo data: /rest/spenttxouts/<hash>.<ext>
+ * One list of spent outputs for each transaction but the coinbase, in the order of the inputs.
+ * The zerocoin spends have no spent outputs.
+ */
+static bool rest_spent_txouts(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+
+    std::string hashStr = params[0];
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    const CBlockIndex* pblockindex;
+    {
+        LOCK(cs_main);
+        pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex) {
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        }
+        if (pblockindex->pprev && !(pblockindex->nStatus & BLOCK_HAVE_UNDO))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " undo data not available");
+    }
+
+    // The genesis block has no undo data
+    CBlockUndo blockundo;
+    if (pblockindex->pprev && !UndoReadFromDisk(blockundo, pblockindex->GetUndoPos(), pblockindex->pprev->GetBlockHash()))
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " undo data not found");
+
+    switch (rf) {
+    case RF_BINARY: {
+        CDataStream ssUndo(SER_NETWORK, PROTOCOL_VERSION);
+        ssUndo << blockundo;
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ssUndo.str());
+        return true;
+    }
+
+    case RF_HEX: {
+        CDataStream ssUndo(SER_NETWORK, PROTOCOL_VERSION);
+        ssUndo << blockundo;
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, HexStr(ssUndo) + "\n");
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue result(UniValue::VARR);
+        for (const CTxUndo& txundo : blockundo.vtxundo) {
+            UniValue txPrevouts(UniValue::VARR);
+            for (const Coin& coin : txundo.vprevout) {
+                UniValue prevout(UniValue::VOBJ);
+                prevout.pushKV("value", ValueFromAmount(coin.nValue));
+                prevout.pushKV("height", (int64_t)coin.nHeight);
+                prevout.pushKV("coinbase", coin.fCoinBase);
+                prevout.pushKV("coinstake", coin.fCoinStake);
+                UniValue o(UniValue::VOBJ);
+                ScriptPubKeyToUniv(coin.GetScriptPubKey(), o, true);
+                prevout.pushKV("scriptPubKey", o);
+                txPrevouts.push_back(prevout);
+            }
+            result.push_back(txPrevouts);
+        }
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 // A bit of a hack - dependency on a function defined in rpc/blockchain.cpp
 UniValue getblockchaininfo(const JSONRPCRequest& request);
 
@@ -567,6 +861,10 @@ static const struct {
       {"/rest/tx/", rest_tx},
       {"/rest/block/notxdetails/", rest_block_notxdetails},
       {"/rest/block/", rest_block_extended},
+      {"/rest/blocks/", rest_blocks},
+      {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/compactsaplingblocks/", rest_compact_sapling_blocks},
+      {"/rest/spenttxouts/", rest_spent_txouts},
       {"/rest/chaininfo", rest_chaininfo},
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
@@ -5,13 +5,18 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or https://www.opensource.org/licenses/mit-license.php.
 
+#include "blockfilter.h"
+#include "blockpipeline.h"
 #include "budget/budgetmanager.h"
 #include "chainparams.h"
+#include "chaintipsnapshot.h"
 #include "checkpoints.h"
 #include "clientversion.h"
 #include "consensus/upgrades.h"
 #include "core_io.h"
+#include "evo/evodb.h"
 #include "hash.h"
+#include "index/blockfilterindex.h"
 #include "kernel.h"
 #include "key_io.h"
 #include "llmq/quorums_chainlocks.h"
@@ -25,6 +30,8 @@
 #include "util/system.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
+#include "utxocommitment.h"
+#include "utxosnapshot.h"
 #include "validation.h"
 #include "validationinterface.h"
 #include "wallet/wallet.h"
@@ -69,7 +76,7 @@ double GetDifficulty(const CBlockIndex* blockindex)
     // Floating point number that is a multiple of the minimum difficulty,
     // minimum difficulty = 1.0.
     if (blockindex == nullptr) {
-        const CBlockIndex* pChainTip = GetChainTip();
+        const CBlockIndex* pChainTip = GetChainTipSnapshot()->pindexTip;
         if (!pChainTip)
             return 1.0;
         else
@@ -129,14 +136,14 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     result.pushKV("bits", strprintf("%08x", blockindex->nBits));
     result.pushKV("difficulty", GetDifficulty(blockindex));
     result.pushKV("chainwork", blockindex->nChainWork.GetHex());
-    result.pushKV("acc_checkpoint", blockindex->nAccumulatorCheckpoint.GetHex());
+    result.pushKV("acc_checkpoint", blockindex->GetAccumulatorCheckpoint().GetHex());
     // Sapling shield pool value
     result.pushKV("shield_pool_value", ValuePoolDesc(blockindex->nChainSaplingValue, blockindex->nSaplingValue));
     if (blockindex->pprev)
         result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     if (pnext)
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
-    result.pushKV("chainlock", llmq::chainLocksHandler->HasChainLock(blockindex->nHeight, blockindex->GetBlockHash()));
+    result.pushKV("chainlock", GetChainTipSnapshot()->HasChainLock(blockindex));
     return result;
 }
 
@@ -181,7 +188,8 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
     /////////
     if (block.IsProofOfStake()) {
         uint256 hashProofOfStakeRet{UINT256_ZERO};
-        if (blockindex->pprev && !GetStakeKernelHash(hashProofOfStakeRet, block, blockindex->pprev))
+        // The stake input is looked up in the coins tip, the chain and the block index
+        if (blockindex->pprev && !WITH_LOCK(cs_main, return GetStakeKernelHash(hashProofOfStakeRet, block, blockindex->pprev)))
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Cannot get proof of stake hash");
 
         std::string stakeModifier = (Params().GetConsensus().NetworkUpgradeActive(blockindex->nHeight, Consensus::UPGRADE_V3_4) ?
@@ -190,7 +198,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
         result.pushKV("stakeModifier", stakeModifier);
         result.pushKV("hashProofOfStake", hashProofOfStakeRet.GetHex());
     }
-    result.pushKV("chainlock", llmq::chainLocksHandler->HasChainLock(blockindex->nHeight, blockindex->GetBlockHash()));
+    result.pushKV("chainlock", GetChainTipSnapshot()->HasChainLock(blockindex));
 
     return result;
 }
@@ -208,8 +216,7 @@ UniValue getblockcount(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getblockcount", "") + HelpExampleRpc("getblockcount", ""));
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainTipSnapshot()->Height();
 }
 
 UniValue getbestblockhash(const JSONRPCRequest& request)
@@ -225,8 +232,9 @@ UniValue getbestblockhash(const JSONRPCRequest& request)
             "\nExamples\n" +
             HelpExampleCli("getbestblockhash", "") + HelpExampleRpc("getbestblockhash", ""));
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    const CBlockIndex* pindexTip = GetChainTipSnapshot()->pindexTip;
+    if (!pindexTip) throw JSONRPCError(RPC_IN_WARMUP, "Try again after active chain is loaded");
+    return pindexTip->GetBlockHash().GetHex();
 }
 
 UniValue getbestsaplinganchor(const JSONRPCRequest& request)
@@ -399,7 +407,6 @@ UniValue getdifficulty(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getdifficulty", "") + HelpExampleRpc("getdifficulty", ""));
 
-    LOCK(cs_main);
     return GetDifficulty();
 }
 
@@ -418,23 +425,19 @@ static std::string EntryDescriptionString()
            "       ... ]\n";
 }
 
-static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e)
+static void entryToJSON(UniValue &info, const TxMempoolEntrySnapshot &e)
 {
-    AssertLockHeld(mempool.cs);
-
-    info.pushKV("size", (int)e.GetTxSize());
-    info.pushKV("fee", ValueFromAmount(e.GetFee()));
-    info.pushKV("modifiedfee", ValueFromAmount(e.GetModifiedFee()));
-    info.pushKV("time", e.GetTime());
-    info.pushKV("height", (int)e.GetHeight());
-    info.pushKV("descendantcount", e.GetCountWithDescendants());
-    info.pushKV("descendantsize", e.GetSizeWithDescendants());
-    info.pushKV("descendantfees", e.GetModFeesWithDescendants());
-    const CTransaction& tx = e.GetTx();
+    info.pushKV("size", (int)e.nTxSize);
+    info.pushKV("fee", ValueFromAmount(e.nFee));
+    info.pushKV("modifiedfee", ValueFromAmount(e.nModifiedFee));
+    info.pushKV("time", e.nTime);
+    info.pushKV("height", (int)e.nHeight);
+    info.pushKV("descendantcount", e.nCountWithDescendants);
+    info.pushKV("descendantsize", e.nSizeWithDescendants);
+    info.pushKV("descendantfees", e.nModFeesWithDescendants);
     std::set<std::string> setDepends;
-    for (const CTxIn& txin : tx.vin) {
-        if (mempool.exists(txin.prevout.hash))
-            setDepends.insert(txin.prevout.hash.ToString());
+    for (const uint256& parent : e.vParents) {
+        setDepends.insert(parent.ToString());
     }
 
     UniValue depends(UniValue::VARR);
@@ -447,23 +450,20 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e)
 
 UniValue mempoolToJSON(bool fVerbose = false)
 {
+    // The snapshot is iterated without the mempool lock, not to stall the mempool updates
+    const std::shared_ptr<const MempoolSnapshot> snapshot = mempool.GetSnapshot();
     if (fVerbose) {
-        LOCK(mempool.cs);
         UniValue o(UniValue::VOBJ);
-        for (const CTxMemPoolEntry& e : mempool.mapTx) {
-            const uint256& hash = e.GetTx().GetHash();
+        for (const TxMempoolEntrySnapshot& e : *snapshot) {
             UniValue info(UniValue::VOBJ);
             entryToJSON(info, e);
-            o.pushKV(hash.ToString(), info);
+            o.pushKV(e.txid.ToString(), info);
         }
         return o;
     } else {
-        std::vector<uint256> vtxid;
-        mempool.queryHashes(vtxid);
-
         UniValue a(UniValue::VARR);
-        for (const uint256& hash : vtxid)
-            a.push_back(hash.ToString());
+        for (const TxMempoolEntrySnapshot& e : *snapshot)
+            a.push_back(e.txid.ToString());
 
         return a;
     }
@@ -494,8 +494,6 @@ UniValue getrawmempool(const JSONRPCRequest& request)
             "\nExamples\n" +
             HelpExampleCli("getrawmempool", "true") + HelpExampleRpc("getrawmempool", "true"));
 
-    LOCK(cs_main);
-
     bool fVerbose = false;
     if (request.params.size() > 0)
         fVerbose = request.params[0].get_bool();
@@ -583,8 +581,6 @@ UniValue getblock(const JSONRPCRequest& request)
             HelpExampleCli("getblock", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\"") +
             HelpExampleRpc("getblock", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\""));
 
-    LOCK(cs_main);
-
     uint256 hash(ParseHashV(request.params[0], "blockhash"));
 
     int verbosity = 1;
@@ -595,22 +591,30 @@ UniValue getblock(const JSONRPCRequest& request)
             verbosity = request.params[1].get_bool() ? 1 : 0;
     }
 
-    CBlockIndex* pblockindex = LookupBlockIndex(hash);
-    if (pblockindex == nullptr)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    const CBlockIndex* pblockindex;
+    {
+        LOCK(cs_main);
+        pblockindex = LookupBlockIndex(hash);
+        if (pblockindex == nullptr)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
-    if (!ReadBlockFromDisk(block, pblockindex))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+    }
 
     if (verbosity <= 0) {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock);
-        return strHex;
+        std::shared_ptr<const std::vector<unsigned char>> pblockRaw = ReadRawBlockFromDisk(pblockindex);
+        if (!pblockRaw)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        return HexStr(*pblockRaw);
     }
 
-    return blockToJSON(block, chainActive.Tip(), pblockindex, verbosity >= 2);
+    std::shared_ptr<const CBlock> pblock = ReadSharedBlockFromDisk(pblockindex);
+    if (!pblock)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+
+    // The block is read and converted against the tip snapshot, cs_main is only taken for the stake data
+    return blockToJSON(*pblock, GetChainTipSnapshot()->pindexTip, pblockindex, verbosity >= 2);
 }
 
 UniValue getblockheader(const JSONRPCRequest& request)
@@ -656,9 +660,7 @@ UniValue getblockheader(const JSONRPCRequest& request)
     if (request.params.size() > 1)
         fVerbose = request.params[1].get_bool();
 
-    LOCK(cs_main);
-
-    CBlockIndex* pblockindex = LookupBlockIndex(hash);
+    const CBlockIndex* pblockindex = WITH_LOCK(cs_main, return LookupBlockIndex(hash));
     if (pblockindex == nullptr)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
@@ -669,7 +671,84 @@ UniValue getblockheader(const JSONRPCRequest& request)
         return strHex;
     }
 
-    return blockheaderToJSON(chainActive.Tip(), pblockindex);
+    return blockheaderToJSON(GetChainTipSnapshot()->pindexTip, pblockindex);
+}
+
+UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nRetrieve a BIP 157 content filter for a particular block.\n"
+
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The hash of the block\n"
+            "2. \"filtertype\"    (string, optional, default=basic) The type name of the filter\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",    (string) the hex-encoded filter data\n"
+            "  \"header\" : \"hex\"     (string) the hex-encoded filter header\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\"") +
+            HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\", \"basic\""));
+
+    uint256 block_hash = ParseHashV(request.params[0], "blockhash");
+    std::string filtertype_name = "basic";
+    if (request.params.size() > 1) {
+        filtertype_name = request.params[1].get_str();
+    }
+
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(filtertype_name, filtertype)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+    }
+
+    BlockFilterIndex* index = GetBlockFilterIndex(filtertype);
+    if (!index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + filtertype_name);
+    }
+
+    const CBlockIndex* block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        block_was_connected = block_index->IsValid(BLOCK_VALID_SCRIPTS);
+    }
+
+    bool index_ready = index->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!index->LookupFilter(block_index, filter) ||
+        !index->LookupFilterHeader(block_index, filter_header)) {
+        int err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("filter", HexStr(filter.GetEncodedFilter()));
+    ret.pushKV("header", filter_header.GetHex());
+    return ret;
 }
 
 UniValue getsupplyinfo(const JSONRPCRequest& request)
@@ -679,7 +758,8 @@ UniValue getsupplyinfo(const JSONRPCRequest& request)
             "getsupplyinfo ( force_update )\n"
             "\nIf force_update=false (default if no argument is given): return the last cached money supply"
             "\n(sum of spendable transaction outputs) and the height of the chain when it was last updated"
-            "\n(it is updated periodically, whenever the chainstate is flushed)."
+            "\n(it is updated with the supply change of each block connected, or, if the one of a block"
+            "\nis unknown, periodically, whenever the chainstate is flushed)."
             "\n"
             "\nIf force_update=true: Flush the chainstate to disk and return the money supply updated to"
             "\nthe current chain height.\n"
@@ -710,7 +790,8 @@ UniValue getsupplyinfo(const JSONRPCRequest& request)
     const CAmount tSupply = MoneySupply.Get();
     ret.pushKV("updateheight", MoneySupply.GetCacheHeight());
     ret.pushKV("transparentsupply", ValueFromAmount(tSupply));
-    Optional<CAmount> shieldedPoolValue = WITH_LOCK(cs_main, return (chainActive.Tip() ? chainActive.Tip()->nChainSaplingValue : nullopt); );
+    const CBlockIndex* pindexTip = GetChainTipSnapshot()->pindexTip;
+    Optional<CAmount> shieldedPoolValue = pindexTip ? pindexTip->nChainSaplingValue : nullopt;
     ret.pushKV("shieldsupply", ValuePoolDesc(shieldedPoolValue, nullopt)["chainValue"]);
     const CAmount totalSupply = tSupply + (shieldedPoolValue ? *shieldedPoolValue : 0);
     ret.pushKV("totalsupply", ValueFromAmount(totalSupply));
@@ -738,10 +819,10 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash,
     stats.nTransactions++;
     for (const auto& output : outputs) {
         ss << VARINT(output.first + 1);
-        ss << output.second.out.scriptPubKey;
-        ss << VARINT_MODE(output.second.out.nValue, VarIntMode::NONNEGATIVE_SIGNED);
+        ss << output.second.GetScriptPubKey();
+        ss << VARINT_MODE(output.second.nValue, VarIntMode::NONNEGATIVE_SIGNED);
         stats.nTransactionOutputs++;
-        stats.nTotalAmount += output.second.out.nValue;
+        stats.nTotalAmount += output.second.nValue;
     }
     ss << VARINT(0u);
 }
@@ -787,30 +868,59 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
 
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time, unless the MuHash is maintained with -utxohash.\n"
+
+            "\nArguments:\n"
+            "1. \"hash_type\"   (string, optional, default=\"hash_serialized_2\") Which UTXO set hash should be calculated. Options: 'hash_serialized_2', 'muhash'.\n"
 
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"transactions\": n,      (numeric) The number of transactions (only with hash_serialized_2)\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"hash_serialized_2\": \"hash\",   (string) The serialized hash\n"
+            "  \"hash_serialized_2\": \"hash\",   (string) The serialized hash (only with hash_serialized_2)\n"
+            "  \"muhash\": \"hash\",      (string) The MuHash of the set (only with muhash)\n"
             "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
 
             "\nExamples:\n" +
-            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleRpc("gettxoutsetinfo", ""));
+            HelpExampleCli("gettxoutsetinfo", "") + HelpExampleCli("gettxoutsetinfo", "\"muhash\"") +
+            HelpExampleRpc("gettxoutsetinfo", ""));
+
+    const std::string strHashType = request.params.size() > 0 ? request.params[0].get_str() : "hash_serialized_2";
+    if (strHashType != "hash_serialized_2" && strHashType != "muhash") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s is not a valid hash_type", strHashType));
+    }
 
     UniValue ret(UniValue::VOBJ);
 
-    CCoinsStats stats;
     FlushStateToDisk();
+    if (strHashType == "muhash") {
+        CUTXOCommitment commitment;
+        {
+            LOCK(cs_main);
+            if (pUTXOCommitment) {
+                commitment = *pUTXOCommitment;
+            } else if (!commitment.Rebuild(*pcoinsdbview)) {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+            }
+            ret.pushKV("height", (int64_t)LookupBlockIndex(commitment.hashBlock)->nHeight);
+        }
+        ret.pushKV("bestblock", commitment.hashBlock.GetHex());
+        ret.pushKV("txouts", (int64_t)commitment.nTransactionOutputs);
+        ret.pushKV("muhash", commitment.GetHash().GetHex());
+        ret.pushKV("total_amount", ValueFromAmount(commitment.nTotalAmount));
+        ret.pushKV("disk_size", (uint64_t)pcoinsTip->EstimateSize());
+        return ret;
+    }
+
+    CCoinsStats stats;
     if (GetUTXOStats(pcoinsTip.get(), stats)) {
         ret.pushKV("height", (int64_t)stats.nHeight);
         ret.pushKV("bestblock", stats.hashBlock.GetHex());
@@ -823,6 +933,135 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue SnapshotToJSON(const SnapshotMetadata& metadata, const SnapshotStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("network", metadata.strNetwork);
+    ret.pushKV("base_hash", metadata.hashBaseBlock.GetHex());
+    ret.pushKV("base_height", metadata.nBaseHeight);
+    ret.pushKV("sapling_anchor", metadata.hashSaplingAnchor.GetHex());
+    ret.pushKV("coins", (int64_t)stats.nCoins);
+    ret.pushKV("nullifiers", (int64_t)stats.nNullifiers);
+    ret.pushKV("anchors", (int64_t)stats.nAnchors);
+    ret.pushKV("evo_records", (int64_t)stats.nEvoRecords);
+    ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+    ret.pushKV("snapshot_hash", stats.hashContent.GetHex());
+    return ret;
+}
+
+UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrite a snapshot of the chain state at the current tip to a file: the unspent transaction outputs,\n"
+            "the Sapling nullifiers and anchors, and the evo db (masternode lists and LLMQ commitments).\n"
+            "The chain is not advanced while the snapshot is written, this call may take some time.\n"
+
+            "\nArguments:\n"
+            "1. \"path\"     (string, required) The output file, absolute or relative to the data directory\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"network\": \"xxx\",          (string) The network of the chain\n"
+            "  \"base_hash\": \"hash\",       (string) The hash of the block at the snapshot\n"
+            "  \"base_height\": n,          (numeric) The height of the block at the snapshot\n"
+            "  \"sapling_anchor\": \"hash\",  (string) The best Sapling anchor\n"
+            "  \"coins\": n,                (numeric) The number of coins written\n"
+            "  \"nullifiers\": n,           (numeric) The number of Sapling nullifiers written\n"
+            "  \"anchors\": n,              (numeric) The number of Sapling anchors written\n"
+            "  \"evo_records\": n,          (numeric) The number of evo db records written\n"
+            "  \"total_amount\": x.xxx,     (numeric) The total amount of the coins\n"
+            "  \"snapshot_hash\": \"hash\",   (string) The hash of the snapshot content\n"
+            "  \"path\": \"xxx\"              (string) The absolute path of the file\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("dumptxoutset", "\"utxo.dat\"") + HelpExampleRpc("dumptxoutset", "\"utxo.dat\""));
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+    }
+    // Written to a temporary file first, so that an incomplete snapshot can't be mistaken for a complete one
+    const fs::path temppath = path.string() + ".incomplete";
+    CAutoFile file(fsbridge::fopen(temppath, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Couldn't open file " + temppath.string() + " for writing");
+    }
+
+    SnapshotMetadata metadata;
+    SnapshotStats stats;
+    std::string strError;
+    bool fOk;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        metadata.strNetwork = Params().NetworkIDString();
+        metadata.hashBaseBlock = chainActive.Tip()->GetBlockHash();
+        metadata.nBaseHeight = chainActive.Height();
+        metadata.hashSaplingAnchor = pcoinsdbview->GetBestAnchor();
+        fOk = WriteUTXOSnapshot(file, metadata, *pcoinsdbview, *evoDb, stats, strError);
+    }
+    file.fclose();
+    if (!fOk) {
+        fs::remove(temppath);
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+    }
+    fs::rename(temppath, path);
+
+    UniValue ret = SnapshotToJSON(metadata, stats);
+    ret.pushKV("path", path.string());
+    return ret;
+}
+
+UniValue verifytxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "verifytxoutset \"path\"\n"
+            "\nRead a snapshot written by dumptxoutset and check its content against its hash. The MuHash of its\n"
+            "coins is compared with the one of the base block, if it was connected with -utxohash (at any height,\n"
+            "not only at the tip).\n"
+
+            "\nArguments:\n"
+            "1. \"path\"     (string, required) The snapshot file, absolute or relative to the data directory\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  ...                        The fields of the dumptxoutset result\n"
+            "  \"muhash\": \"hash\",          (string) The MuHash of the coins of the snapshot\n"
+            "  \"matches_chain\": true|false (boolean, only if the MuHash of the base block is stored) Whether the coins\n"
+            "                             of the snapshot are the UTXO set of the base block\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("verifytxoutset", "\"utxo.dat\"") + HelpExampleRpc("verifytxoutset", "\"utxo.dat\""));
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Couldn't open file " + path.string() + " for reading");
+    }
+
+    SnapshotMetadata metadata;
+    SnapshotStats stats;
+    CUTXOCommitment commitment;
+    std::string strError;
+    if (!ReadUTXOSnapshot(file, metadata, stats, strError, &commitment)) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strError);
+    }
+
+    UniValue ret = SnapshotToJSON(metadata, stats);
+    const CUTXOCommitmentStats snapshotStats = commitment.GetStats();
+    ret.pushKV("muhash", snapshotStats.hashMuHash.GetHex());
+    CUTXOCommitmentStats chainStats;
+    if (WITH_LOCK(cs_main, return GetUTXOCommitmentStats(metadata.hashBaseBlock, chainStats))) {
+        ret.pushKV("matches_chain", chainStats == snapshotStats);
+    }
+    return ret;
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -892,9 +1131,9 @@ UniValue gettxout(const JSONRPCRequest& request)
     } else {
         ret.pushKV("confirmations", (int64_t)(pindex->nHeight - coin.nHeight + 1));
     }
-    ret.pushKV("value", ValueFromAmount(coin.out.nValue));
+    ret.pushKV("value", ValueFromAmount(coin.nValue));
     UniValue o(UniValue::VOBJ);
-    ScriptPubKeyToUniv(coin.out.scriptPubKey, o, true);
+    ScriptPubKeyToUniv(coin.GetScriptPubKey(), o, true);
     ret.pushKV("scriptPubKey", o);
     ret.pushKV("coinbase", (bool)coin.fCoinBase);
 
@@ -1019,6 +1258,8 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "    \"valueDelta\":        (numeric) Change in value held by the Sapling circuit over the chain tip block\n"
             "  },\n"
             "  \"initial_block_downloading\": true|false, (boolean) whether the node is in initial block downloading state or not\n"
+            "  \"pruned\": xx,             (boolean) if the blocks are subject to pruning\n"
+            "  \"pruneheight\": xxxxxx,    (numeric) lowest-height complete block stored (only present if pruning is enabled)\n"
             "  \"softforks\": [            (array) status of softforks in progress\n"
             "     {\n"
             "        \"id\": \"xxxx\",        (string) name of softfork\n"
@@ -1040,23 +1281,30 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getblockchaininfo", "") + HelpExampleRpc("getblockchaininfo", ""));
 
-    LOCK(cs_main);
-
+    const ChainTipSnapshotRef snapshot = GetChainTipSnapshot();
     const Consensus::Params& consensusParams = Params().GetConsensus();
-    const CBlockIndex* pChainTip = chainActive.Tip();
-    int nTipHeight = pChainTip ? pChainTip->nHeight : -1;
+    const CBlockIndex* pChainTip = snapshot->pindexTip;
+    int nTipHeight = snapshot->Height();
 
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("chain", Params().NetworkIDString());
     obj.pushKV("blocks", nTipHeight);
-    obj.pushKV("headers", pindexBestHeader ? pindexBestHeader->nHeight : -1);
+    obj.pushKV("headers", snapshot->nBestHeaderHeight);
     obj.pushKV("bestblockhash", pChainTip ? pChainTip->GetBlockHash().GetHex() : "");
-    obj.pushKV("difficulty", (double)GetDifficulty());
+    obj.pushKV("difficulty", (double)GetDifficulty(pChainTip));
     obj.pushKV("verificationprogress", Checkpoints::GuessVerificationProgress(pChainTip));
     obj.pushKV("chainwork", pChainTip ? pChainTip->nChainWork.GetHex() : "");
     // Sapling shield pool value
     obj.pushKV("shield_pool_value", pChainTip ? ValuePoolDesc(pChainTip->nChainSaplingValue, pChainTip->nSaplingValue) : 0);
     obj.pushKV("initial_block_downloading", IsInitialBlockDownload());
+    obj.pushKV("pruned", fPruneMode);
+    if (fPruneMode && pChainTip) {
+        LOCK(cs_main);
+        const CBlockIndex* block = pChainTip;
+        while (block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA))
+            block = block->pprev;
+        obj.pushKV("pruneheight", block->nHeight);
+    }
     UniValue softforks(UniValue::VARR);
     softforks.push_back(SoftForkDesc("bip65", 5, pChainTip));
     obj.pushKV("softforks",             softforks);
@@ -1180,6 +1428,8 @@ UniValue mempoolInfoToJSON()
     ret.pushKV("size", (int64_t) mempool.size());
     ret.pushKV("bytes", (int64_t) mempool.GetTotalTxSize());
     ret.pushKV("usage", (int64_t) mempool.DynamicMemoryUsage());
+    ret.pushKV("shieldedusage", (int64_t) mempool.GetShieldedDynamicMemoryUsage());
+    ret.pushKV("maxmempoolshielded", (int64_t) gArgs.GetArg("-maxmempoolshielded", DEFAULT_MAX_MEMPOOL_SHIELDED_SIZE) * 1000000);
     size_t maxmempool = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     ret.pushKV("mempoolminfee", ValueFromAmount(std::max(mempool.GetMinFee(maxmempool), ::minRelayTxFee).GetFeePerK()));
     ret.pushKV("minrelaytxfee", ValueFromAmount(::minRelayTxFee.GetFeePerK()));
@@ -1200,6 +1450,8 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
             "  \"usage\": xxxxx               (numeric) Total memory usage for the mempool\n"
+            "  \"shieldedusage\": xxxxx       (numeric) Memory usage of the shielded transactions\n"
+            "  \"maxmempoolshielded\": xxxxx  (numeric) Maximum memory usage for the shielded transactions\n"
             "  \"maxmempool\": xxxxx,         (numeric) Maximum memory usage for the mempool\n"
             "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee rate in " + CURRENCY_UNIT + "/kB for tx to be accepted. Is the maximum of minrelaytxfee and minimum mempool fee\n"
             "  \"minrelaytxfee\": xxxxx       (numeric) Current minimum relay fee for transactions\n"
@@ -1397,7 +1649,7 @@ UniValue getblockindexstats(const JSONRPCRequest& request) {
                 continue;
 
             // Transaction size
-            nBytes += GetSerializeSize(tx, CLIENT_VERSION);
+            nBytes += tx.GetTotalSize();
 
             // Transparent inputs
             for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -1474,6 +1726,139 @@ UniValue getfeeinfo(const JSONRPCRequest& request)
     return getblockindexstats(newRequest);
 }
 
+UniValue getblockpipelineinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || !request.params.empty())
+        throw std::runtime_error(
+            "getblockpipelineinfo\n"
+            "\nReturns the activity of the stages of the block pipeline (-blockpipeline), that processes the blocks\n"
+            "downloaded during the headers first sync, since it started.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"running\": true|false,    (boolean) whether the pipeline is running\n"
+            "  \"uptime\": n,              (numeric) the seconds since it started\n"
+            "  \"stages\": [               (array) the stages, in order: receive, precheck, prefetch, connect\n"
+            "    {\n"
+            "      \"name\": \"name\",       (string) the stage name\n"
+            "      \"blocks\": n,          (numeric) the blocks done by the stage (received, for receive)\n"
+            "      \"queued\": n,          (numeric) the blocks waiting for the stage (in the pipeline, for receive)\n"
+            "      \"max_queued\": n,      (numeric) the most blocks that waited for the stage\n"
+            "      \"busy_ms\": n,         (numeric) the time spent working (waiting for room in the pipeline, for receive)\n"
+            "      \"occupancy\": x.xxx    (numeric) the fraction of the uptime spent working\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getblockpipelineinfo", "") + HelpExampleRpc("getblockpipelineinfo", ""));
+
+    int64_t nUptimeMicros = 0;
+    const std::vector<BlockPipelineStageStats> vStats = g_block_pipeline.GetStats(nUptimeMicros);
+    UniValue stages(UniValue::VARR);
+    for (const BlockPipelineStageStats& stage : vStats) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", stage.name);
+        entry.pushKV("blocks", stage.nBlocks);
+        entry.pushKV("queued", (uint64_t)stage.nQueued);
+        entry.pushKV("max_queued", (uint64_t)stage.nMaxQueued);
+        entry.pushKV("busy_ms", stage.nBusyMicros / 1000);
+        entry.pushKV("occupancy", nUptimeMicros > 0 ? (double)stage.nBusyMicros / nUptimeMicros : 0.0);
+        stages.push_back(entry);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("running", g_block_pipeline.IsRunning());
+    ret.pushKV("uptime", nUptimeMicros / 1000000);
+    ret.pushKV("stages", stages);
+    return ret;
+}
+
+UniValue getblockvalidationstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getblockvalidationstats ( count )\n"
+            "\nReturns the durations of the validation steps of the last blocks connected to the tip, in microseconds.\n"
+            "The profiles of the last " + std::to_string(BLOCK_PROFILE_HISTORY) + " blocks are kept.\n"
+
+            "\nArguments:\n"
+            "1. count      (numeric, optional, default=" + std::to_string(BLOCK_PROFILE_HISTORY) + ") the number of blocks to return\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": [               (array) the profiles, the most recent first\n"
+            "    {\n"
+            "      \"hash\": \"hash\",       (string) the block hash\n"
+            "      \"height\": n,          (numeric) the block height\n"
+            "      \"time\": ttt,          (numeric) the time of the connection (seconds since epoch)\n"
+            "      \"txs\": n,             (numeric) the number of transactions\n"
+            "      \"inputs\": n,          (numeric) the number of transparent inputs\n"
+            "      \"steps\": {\n"
+            "        \"read_from_disk\": n,  (numeric) block and inputs loaded\n"
+            "        \"check_block\": n,     (numeric) context-free checks, with the PoS block signature\n"
+            "        \"connect\": n,         (numeric) transactions connected, scripts checks queued\n"
+            "        \"payments\": n,        (numeric) block value, masternode/budget payee and coinbase checks\n"
+            "        \"verify\": n,          (numeric) connect, payments and the wait for the script and Sapling checks\n"
+            "        \"sapling_proofs\": n,  (numeric) Sapling proofs verification, summed over the workers\n"
+            "        \"process_special\": n, (numeric) special transactions, deterministic masternodes and LLMQ\n"
+            "        \"quorums\": n,         (numeric) LLMQ commitments, part of process_special\n"
+            "        \"index\": n,           (numeric) undo data and index writing\n"
+            "        \"connect_total\": n,   (numeric) the whole block connection, from check_block to index\n"
+            "        \"flush\": n,           (numeric) coins cache flush\n"
+            "        \"chainstate\": n,      (numeric) chain state written to disk, if needed\n"
+            "        \"post_connect\": n,    (numeric) mempool, tip and tier two updates\n"
+            "        \"total\": n            (numeric) the whole connection to the tip\n"
+            "      }\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"average\": {             (object) the average of the steps over the returned blocks\n"
+            "    \"read_from_disk\": n, ...\n"
+            "  }\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getblockvalidationstats", "10") + HelpExampleRpc("getblockvalidationstats", "10"));
+
+    size_t nCount = BLOCK_PROFILE_HISTORY;
+    if (!request.params[0].isNull()) {
+        const int nParam = request.params[0].get_int();
+        if (nParam < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+        nCount = nParam;
+    }
+
+    const std::vector<BlockValidationProfile> vProfiles = WITH_LOCK(cs_main, return GetBlockValidationProfiles());
+    UniValue blocks(UniValue::VARR);
+    std::vector<int64_t> vTotals(vBlockProfileSteps.size(), 0);
+    for (auto it = vProfiles.rbegin(); it != vProfiles.rend() && blocks.size() < nCount; ++it) {
+        UniValue steps(UniValue::VOBJ);
+        for (size_t i = 0; i < vBlockProfileSteps.size(); i++) {
+            const int64_t nTime = (*it).*vBlockProfileSteps[i].second;
+            steps.pushKV(vBlockProfileSteps[i].first, nTime);
+            vTotals[i] += nTime;
+        }
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("hash", it->hash.GetHex());
+        entry.pushKV("height", it->nHeight);
+        entry.pushKV("time", it->nTimeConnected);
+        entry.pushKV("txs", (int64_t)it->nTx);
+        entry.pushKV("inputs", it->nInputs);
+        entry.pushKV("steps", steps);
+        blocks.push_back(entry);
+    }
+
+    UniValue average(UniValue::VOBJ);
+    for (size_t i = 0; i < vBlockProfileSteps.size(); i++) {
+        average.pushKV(vBlockProfileSteps[i].first, blocks.empty() ? 0 : vTotals[i] / (int64_t)blocks.size());
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("blocks", blocks);
+    ret.pushKV("average", average);
+    return ret;
+}
+
 //! Search for a given set of pubkey scripts
 bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results) {
     scan_progress = 0;
@@ -1494,7 +1879,7 @@ bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>&
             uint32_t high = 0x100 * *key.hash.begin() + *(key.hash.begin() + 1);
             scan_progress = (int)(high * 100.0 / 65536.0 + 0.5);
         }
-        if (needles.count(coin.out.scriptPubKey)) {
+        if (needles.count(coin.GetScriptPubKey())) {
             out_results.emplace(key, coin);
         }
         cursor->Next();
@@ -1664,7 +2049,7 @@ UniValue scantxoutset(const JSONRPCRequest& request)
         for (const auto& it : coins) {
             const COutPoint& outpoint = it.first;
             const Coin& coin = it.second;
-            const CTxOut& txo = coin.out;
+            const CTxOut txo = coin.GetTxOut();
             input_txos.push_back(txo);
             total_in += txo.nValue;
 
@@ -1689,24 +2074,29 @@ UniValue scantxoutset(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ --------
-    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  {} },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true,  {"path"} },
+    { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  {}, true },
     { "blockchain",         "getbestsaplinganchor",   &getbestsaplinganchor,   true,  {} },
-    { "blockchain",         "getblock",               &getblock,               true,  {"blockhash","verbose|verbosity"} },
+    { "blockchain",         "getblock",               &getblock,               true,  {"blockhash","verbose|verbosity"}, true },
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,  {} },
-    { "blockchain",         "getblockcount",          &getblockcount,          true,  {} },
-    { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"} },
-    { "blockchain",         "getblockheader",         &getblockheader,         false, {"blockhash","verbose"} },
+    { "blockchain",         "getblockcount",          &getblockcount,          true,  {}, true },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true,  {"blockhash","filtertype"}, true },
+    { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"}, true },
+    { "blockchain",         "getblockheader",         &getblockheader,         false, {"blockhash","verbose"}, true },
     { "blockchain",         "getblockindexstats",     &getblockindexstats,     true,  {"height","range"} },
+    { "blockchain",         "getblockpipelineinfo",   &getblockpipelineinfo,   true,  {} },
+    { "blockchain",         "getblockvalidationstats", &getblockvalidationstats, true, {"count"} },
     { "blockchain",         "getchaintips",           &getchaintips,           true,  {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true,  {} },
     { "blockchain",         "getfeeinfo",             &getfeeinfo,             true,  {"blocks"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
     { "blockchain",         "getsupplyinfo",          &getsupplyinfo,          true,  {"force_update"} },
-    { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
+    { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"}, true },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {"hash_type"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           true,  {"action", "scanobjects"} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"nblocks"} },
+    { "blockchain",         "verifytxoutset",         &verifytxoutset,         true,  {"path"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        true,  {"blockhash"} },
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "chaintipsnapshot.h"
 #include "budget/budgetmanager.h"
 #include "budget/budgetutil.h"
 #include "db.h"
@@ -74,7 +75,7 @@ void checkBudgetInputs(const UniValue& params, std::string &strProposalName, std
                 strprintf("Invalid payment count, must be <= %d", nMaxPayments));
     }
 
-    CBlockIndex* pindexPrev = GetChainTip();
+    const CBlockIndex* pindexPrev = GetChainTipSnapshot()->pindexTip;
     if (!pindexPrev)
         throw JSONRPCError(RPC_IN_WARMUP, "Try again after active chain is loaded");
 
@@ -348,7 +349,7 @@ UniValue getnextsuperblock(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getnextsuperblock", "") + HelpExampleRpc("getnextsuperblock", ""));
 
-    int nChainHeight = WITH_LOCK(cs_main, return chainActive.Height());
+    int nChainHeight = GetChainTipSnapshot()->Height();
     if (nChainHeight < 0) return "unknown";
 
     const int nBlocksPerCycle = Params().GetConsensus().nBudgetCycleBlocks;
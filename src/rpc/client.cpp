@@ -43,11 +43,18 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "delegatestake", 4, "include_delegated" },
     { "delegatestake", 5, "from_shield" },
     { "estimatefee", 0, "nblocks" },
+    { "estimatefee", 1, "shielded" },
     { "estimatesmartfee", 0, "nblocks" },
+    { "estimatesmartfee", 1, "shielded" },
     { "fundrawtransaction", 1, "options" },
     { "generate", 0, "nblocks" },
     { "generatetoaddress", 0, "nblocks" },
     { "getaddednodeinfo", 0, "dummy" },
+    { "getaddressbalance", 0, "addresses" },
+    { "getaddresstxids", 0, "addresses" },
+    { "getaddresstxids", 1, "start" },
+    { "getaddresstxids", 2, "end" },
+    { "getaddressutxos", 0, "addresses" },
     { "getbalance", 0, "minconf" },
     { "getbalance", 1, "include_watchonly" },
     { "getbalance", 2, "include_delegated" },
@@ -58,7 +65,9 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "getblockheader", 1, "verbose" },
     { "getblockindexstats", 0, "height" },
     { "getblockindexstats", 1, "range" },
+    { "getblockvalidationstats", 0, "count" },
     { "getblocktemplate", 0, "template_request" },
+    { "getdbcompactioninfo", 0, "verbose" },
     { "getfeeinfo", 0, "blocks" },
     { "getshieldbalance", 1, "minconf" },
     { "getshieldbalance", 2, "include_watchonly" },
@@ -72,6 +81,7 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "getreceivedbyaddress", 1, "minconf" },
     { "getreceivedbylabel", 1, "minconf" },
     { "getsaplingnotescount", 0, "minconf" },
+    { "getstakingperf", 0, "reset" },
     { "getsupplyinfo", 0, "force_update" },
     { "gettransaction", 1, "include_watchonly" },
     { "gettxout", 1, "n" },
@@ -118,6 +128,8 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "lockunspent", 0, "unlock" },
     { "lockunspent", 1, "transparent" },
     { "lockunspent", 2, "transactions" },
+    { "getlockcontention", 0, "enable" },
+    { "getlockcontention", 1, "reset" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
     { "mnbudgetvote", 4, "legacy" },
@@ -149,8 +161,13 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     { "sendmany", 2, "minconf" },
     { "sendmany", 4, "include_delegated" },
     { "sendmany", 5, "subtract_fee_from" },
+    { "sendmanybatch", 0, "payouts" },
+    { "sendmanybatch", 1, "minconf" },
+    { "sendmanybatch", 2, "include_delegated" },
     { "scantxoutset", 1, "scanobjects" },
     { "sendrawtransaction", 1, "allowhighfees" },
+    { "submitpackage", 0, "hexstrings" },
+    { "submitpackage", 1, "allowhighfees" },
     { "sendtoaddress", 1, "amount" },
     { "sendtoaddress", 4, "subtract_fee" },
     { "setautocombinethreshold", 0, "enable" },
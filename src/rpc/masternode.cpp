@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "activemasternode.h"
+#include "chaintipsnapshot.h"
 #include "db.h"
 #include "evo/deterministicmns.h"
 #include "key_io.h"
@@ -33,7 +34,7 @@ static UniValue DmnToJson(const CDeterministicMNCPtr dmn)
         return ret;
     }
     CTxDestination dest;
-    if (!ExtractDestination(coin.out.scriptPubKey, dest)) {
+    if (!ExtractDestination(coin.GetScriptPubKey(), dest)) {
         return ret;
     }
     ret.pushKV("collateralAddress", EncodeDestination(dest));
@@ -194,9 +195,10 @@ UniValue listmasternodes(const JSONRPCRequest& request)
     const std::string& strFilter = request.params.size() > 0 ? request.params[0].get_str() : "";
     UniValue ret(UniValue::VARR);
 
+    // The masternode list of the snapshot is the one of its tip
+    const ChainTipSnapshotRef snapshot = GetChainTipSnapshot();
     if (deterministicMNManager->LegacyMNObsolete()) {
-        auto mnList = deterministicMNManager->GetListAtChainTip();
-        mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        snapshot->mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
             UniValue obj = DmnToJson(dmn);
             if (filterMasternode(obj, strFilter, !dmn->IsPoSeBanned())) {
                 ret.push_back(obj);
@@ -206,10 +208,10 @@ UniValue listmasternodes(const JSONRPCRequest& request)
     }
 
     // Legacy masternodes (!TODO: remove when transition to dmn is complete)
-    const CBlockIndex* chainTip = GetChainTip();
+    const CBlockIndex* chainTip = snapshot->pindexTip;
     if (!chainTip) return "[]";
     int nHeight = chainTip->nHeight;
-    auto mnList = deterministicMNManager->GetListAtChainTip();
+    const CDeterministicMNList& mnList = snapshot->mnList;
 
     int count_enabled = mnodeman.CountEnabled();
     std::vector<std::pair<int64_t, MasternodeRef>> vMasternodeRanks = mnodeman.GetMasternodeRanks(nHeight);
@@ -295,7 +297,7 @@ UniValue getmasternodecount (const JSONRPCRequest& request)
 
     UniValue obj(UniValue::VOBJ);
     int nCount = 0;
-    const CBlockIndex* pChainTip = GetChainTip();
+    const CBlockIndex* pChainTip = GetChainTipSnapshot()->pindexTip;
     if (!pChainTip) return "unknown";
 
     mnodeman.GetNextMasternodeInQueueForPayment(pChainTip->nHeight, true, nCount, pChainTip);
@@ -331,7 +333,7 @@ UniValue masternodecurrent(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("masternodecurrent", "") + HelpExampleRpc("masternodecurrent", ""));
 
-    const CBlockIndex* pChainTip = GetChainTip();
+    const CBlockIndex* pChainTip = GetChainTipSnapshot()->pindexTip;
     if (!pChainTip) return "unknown";
 
     int nCount = 0;
@@ -781,7 +783,7 @@ UniValue getmasternodewinners(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getmasternodewinners", "") + HelpExampleRpc("getmasternodewinners", ""));
 
-    int nHeight = WITH_LOCK(cs_main, return chainActive.Height());
+    int nHeight = GetChainTipSnapshot()->Height();
     if (nHeight < 0) return "[]";
 
     int nLast = 10;
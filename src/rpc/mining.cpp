@@ -12,6 +12,7 @@
 #include "key_io.h"
 #include "miner.h"
 #include "net.h"
+#include "policy/policy.h"
 #include "rpc/server.h"
 #include "shutdown.h"
 #include "util/blockstatecatcher.h"
@@ -491,6 +492,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             "         ],\n"
             "         \"fee\": n,                   (numeric) difference in value between transaction inputs and outputs (in upiv); for coinbase transactions, this is a negative Number of the total collected block fees (ie, not including the block subsidy); if key is not present, fee is unknown and clients MUST NOT assume there isn't one\n"
             "         \"sigops\" : n,               (numeric) total number of SigOps, as counted for purposes of block limits; if key is not present, sigop count is unknown and clients MUST NOT assume there aren't any\n"
+            "         \"shieldedcost\" : n,         (numeric) validation cost of the Sapling proofs and signatures, in units of a signature check\n"
             "         \"required\" : true|false     (boolean) if provided and true, this transaction must be in the final block\n"
             "      }\n"
             "      ,...\n"
@@ -509,6 +511,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             "  \"noncerange\" : \"00000000ffffffff\",   (string) A range of valid nonces\n"
             "  \"sigoplimit\" : n,                 (numeric) limit of sigops in blocks\n"
             "  \"sizelimit\" : n,                  (numeric) limit of block size\n"
+            "  \"shieldedcost\" : n,               (numeric) total validation cost of the Sapling proofs and signatures in the block\n"
+            "  \"shieldedcostlimit\" : n,          (numeric) limit of the Sapling validation cost set with -blockmaxshieldedcost\n"
             "  \"curtime\" : ttt,                  (numeric) current timestamp in seconds since epoch (Jan 1 1970 GMT)\n"
             "  \"bits\" : \"xxx\",                 (string) compressed target of next block\n"
             "  \"height\" : n                      (numeric) The height of the next block\n"
@@ -660,6 +664,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
 
     UniValue transactions(UniValue::VARR);
     std::map<uint256, int64_t> setTxIndex;
+    int64_t nShieldedCost = 0;
     int i = 0;
     for (const auto& txIn : pblock->vtx) {
         const CTransaction& tx = *txIn;
@@ -685,6 +690,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         int index_in_template = i - 1;
         entry.pushKV("fee", pblocktemplate->vTxFees[index_in_template]);
         entry.pushKV("sigops", pblocktemplate->vTxSigOps[index_in_template]);
+        entry.pushKV("shieldedcost", pblocktemplate->vTxShieldedCost[index_in_template]);
+        nShieldedCost += pblocktemplate->vTxShieldedCost[index_in_template];
 
         transactions.push_back(entry);
     }
@@ -717,6 +724,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     result.pushKV("noncerange", "00000000ffffffff");
 //    result.pushKV("sigoplimit", (int64_t)MAX_BLOCK_SIGOPS);
 //    result.pushKV("sizelimit", (int64_t)MAX_BLOCK_SIZE);
+    result.pushKV("shieldedcost", nShieldedCost);
+    result.pushKV("shieldedcostlimit", gArgs.GetArg("-blockmaxshieldedcost", DEFAULT_BLOCK_MAX_SHIELDED_COST));
     result.pushKV("curtime", pblock->GetBlockTime());
     result.pushKV("bits", strprintf("%08x", pblock->nBits));
     result.pushKV("height", (int64_t)(pindexPrev->nHeight + 1));
@@ -789,15 +798,16 @@ UniValue submitblock(const JSONRPCRequest& request)
 
 UniValue estimatefee(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 1)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
         throw std::runtime_error(
-            "estimatefee nblocks\n"
+            "estimatefee nblocks ( shielded )\n"
             "\nEstimates the approximate fee per kilobyte\n"
             "needed for a transaction to begin confirmation\n"
             "within nblocks blocks.\n"
 
             "\nArguments:\n"
             "1. nblocks     (numeric)\n"
+            "2. shielded    (boolean, optional, default=false) Estimate the fee of a shielded transaction\n"
 
             "\nResult:\n"
             "n :    (numeric) estimated fee-per-kilobyte\n"
@@ -808,13 +818,14 @@ UniValue estimatefee(const JSONRPCRequest& request)
             "\nExample:\n" +
             HelpExampleCli("estimatefee", "6"));
 
-    RPCTypeCheck(request.params, {UniValue::VNUM});
+    RPCTypeCheck(request.params, {UniValue::VNUM, UniValue::VBOOL});
 
     int nBlocks = request.params[0].get_int();
     if (nBlocks < 1)
         nBlocks = 1;
+    const bool fShielded = request.params.size() > 1 && request.params[1].get_bool();
 
-    CFeeRate feeRate = mempool.estimateFee(nBlocks);
+    CFeeRate feeRate = mempool.estimateFee(nBlocks, fShielded);
     if (feeRate == CFeeRate(0))
         return -1.0;
 
@@ -823,15 +834,16 @@ UniValue estimatefee(const JSONRPCRequest& request)
 
 UniValue estimatesmartfee(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 1)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
         throw std::runtime_error(
-                "estimatesmartfee nblocks\n"
+                "estimatesmartfee nblocks ( shielded )\n"
                 "\nDEPRECATED. WARNING: This interface is unstable and may disappear or change!\n"
                 "\nEstimates the approximate fee per kilobyte needed for a transaction to begin\n"
                 "confirmation within nblocks blocks if possible and return the number of blocks\n"
                 "for which the estimate is valid.\n"
                 "\nArguments:\n"
                 "1. nblocks     (numeric)\n"
+                "2. shielded    (boolean, optional, default=false) Estimate the fee of a shielded transaction\n"
                 "\nResult:\n"
                 "{\n"
                 "  \"feerate\" : x.x,     (numeric) estimate fee-per-kilobyte (in BTC)\n"
@@ -845,13 +857,14 @@ UniValue estimatesmartfee(const JSONRPCRequest& request)
                 + HelpExampleCli("estimatesmartfee", "6")
         );
 
-    RPCTypeCheck(request.params, {UniValue::VNUM});
+    RPCTypeCheck(request.params, {UniValue::VNUM, UniValue::VBOOL});
 
     int nBlocks = request.params[0].get_int();
+    const bool fShielded = request.params.size() > 1 && request.params[1].get_bool();
 
     UniValue result(UniValue::VOBJ);
     int answerFound;
-    CFeeRate feeRate = mempool.estimateSmartFee(nBlocks, &answerFound);
+    CFeeRate feeRate = mempool.estimateSmartFee(nBlocks, &answerFound, fShielded);
     result.pushKV("feerate", feeRate == CFeeRate(0) ? -1.0 : ValueFromAmount(feeRate.GetFeePerK()));
     result.pushKV("blocks", answerFound);
     return result;
@@ -861,8 +874,8 @@ UniValue estimatesmartfee(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ --------
-    { "util",               "estimatefee",            &estimatefee,            true,  {"nblocks"} },
-    { "util",               "estimatesmartfee",       &estimatesmartfee,       true,  {"nblocks"} },
+    { "util",               "estimatefee",            &estimatefee,            true,  {"nblocks","shielded"} },
+    { "util",               "estimatesmartfee",       &estimatesmartfee,       true,  {"nblocks","shielded"} },
     { "mining",             "prioritisetransaction",  &prioritisetransaction,  true,  {"txid","priority_delta","fee_delta"} },
 
     /** Not shown in help */
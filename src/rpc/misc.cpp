@@ -5,14 +5,21 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "cachebalancer.h"
 #include "clientversion.h"
+#include "dbwrapper.h"
+#include "evo/deterministicmns.h"
+#include "evo/evodb.h"
 #include "httpserver.h"
+#include "index/addressindex.h"
 #include "key_io.h"
 #include "sapling/key_io_sapling.h"
 #include "masternode-sync.h"
+#include "memorybudget.h"
 #include "messagesigner.h"
 #include "net.h"
 #include "netbase.h"
+#include "netbuffers.h"
 #include "tiertwo/net_masternodes.h"
 #include "rpc/server.h"
 #include "spork.h"
@@ -25,6 +32,7 @@
 #endif
 #include "warnings.h"
 
+#include <set>
 #include <stdint.h>
 
 #include <univalue.h>
@@ -725,6 +733,19 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCDBMemoryInfo()
+{
+    UniValue obj(UniValue::VOBJ);
+    ForEachDBWrapper([&obj](const CDBWrapper& db) {
+        UniValue dbobj(UniValue::VOBJ);
+        dbobj.pushKV("blockcache", uint64_t(db.GetBlockCacheSize()));
+        dbobj.pushKV("writebuffer", uint64_t(db.GetWriteBufferSize()));
+        dbobj.pushKV("usage", uint64_t(db.DynamicMemoryUsage()));
+        obj.pushKV(db.GetDBOptions().strName, dbobj);
+    });
+    return obj;
+}
+
 UniValue getmemoryinfo(const JSONRPCRequest& request)
 {
     /* Please, avoid using the word "pool" here in the RPC interface or help,
@@ -743,6 +764,55 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"leveldb\": {              (json object) Information about the open databases, by name\n"
+            "    \"name\": {\n"
+            "      \"blockcache\": xxxxx,    (numeric) Capacity of the block cache, in bytes\n"
+            "      \"writebuffer\": xxxxx,   (numeric) Size of a write buffer (up to two are held), in bytes\n"
+            "      \"usage\": xxxxx          (numeric) Approximate memory used by the write buffers and the block cache, in bytes\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"evodb\": {                (json object) Information about the changes of the evo database not yet written\n"
+            "    \"pending\": xxxxx,       (numeric) Bytes of the changes of the connected blocks, written at the next flush\n"
+            "    \"current\": xxxxx        (numeric) Bytes of the changes of the block being processed\n"
+            "  },\n"
+            "  \"mnlists\": {              (json object) Information about the cached deterministic masternode lists\n"
+            "    \"lists\": xxxxx,         (numeric) Number of lists cached\n"
+            "    \"diffs\": xxxxx,         (numeric) Number of list diffs cached\n"
+            "    \"nodes\": xxxxx,         (numeric) Bytes of the nodes of all the lists, shared between them (counted once)\n"
+            "    \"retained\": xxxxx,      (numeric) Bytes of the nodes kept alive by the cached lists\n"
+            "    \"cache\": xxxxx          (numeric) Bytes of the cache entries and of the diffs\n"
+            "  },\n"
+            "  \"netbuffers\": {           (json object) Information about the recycled buffers of the received network messages\n"
+            "    \"buffers\": xxxxx,       (numeric) Number of free buffers kept for the next messages\n"
+            "    \"bytes\": xxxxx,         (numeric) Capacity of the free buffers kept, in bytes\n"
+            "    \"reused\": xxxxx,        (numeric) Number of buffers reused since the start\n"
+            "    \"allocated\": xxxxx,     (numeric) Number of buffers allocated, with no free one of the size\n"
+            "    \"freed\": xxxxx          (numeric) Number of buffers freed, over the limits of the free ones kept\n"
+            "  },\n"
+            "  \"budget\": {               (json object) Memory used by the caches, against -maxmemorybudget\n"
+            "    \"limit\": xxxxx,         (numeric) Global cap of the caches, in bytes (0 = not enforced)\n"
+            "    \"usage\": xxxxx,         (numeric) Total memory used by the caches, in bytes\n"
+            "    \"components\": {\n"
+            "      \"name\": {\n"
+            "        \"usage\": xxxxx,       (numeric) Memory used by the cache, in bytes\n"
+            "        \"priority\": n,        (numeric) The caches with the lowest priority are trimmed first\n"
+            "        \"trimmable\": true|false, (boolean) Whether the cache is trimmed over the cap, or has a fixed size\n"
+            "        \"trims\": xxxxx        (numeric) Number of times the cache was trimmed since the start\n"
+            "      }, ...\n"
+            "    }\n"
+            "  },\n"
+            "  \"dbcache\": {              (json object) The in-memory part of -dbcache, split between the caches\n"
+            "    \"dynamic\": true|false,  (boolean) Whether the split follows the sync state and the miss rates (-dynamicdbcache)\n"
+            "    \"total\": xxxxx,         (numeric) Memory split between the caches, in bytes\n"
+            "    \"caches\": {\n"
+            "      \"name\": {\n"
+            "        \"target\": xxxxx,      (numeric) Memory given to the cache, in bytes\n"
+            "        \"usage\": xxxxx,       (numeric) Memory used by the cache, in bytes\n"
+            "        \"hits\": xxxxx,        (numeric) Lookups answered by the cache since the start\n"
+            "        \"misses\": xxxxx       (numeric) Lookups reading the database since the start\n"
+            "      }, ...\n"
+            "    }\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -751,9 +821,183 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
         );
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("locked", RPCLockedMemoryInfo());
+    obj.pushKV("leveldb", RPCDBMemoryInfo());
+    if (evoDb) {
+        UniValue evoobj(UniValue::VOBJ);
+        evoobj.pushKV("pending", uint64_t(evoDb->GetMemoryUsage()));
+        evoobj.pushKV("current", uint64_t(evoDb->GetCurTransactionMemoryUsage()));
+        obj.pushKV("evodb", evoobj);
+    }
+    if (deterministicMNManager) {
+        const CDeterministicMNManager::CacheStats mnstats = deterministicMNManager->GetCacheStats();
+        UniValue mnobj(UniValue::VOBJ);
+        mnobj.pushKV("lists", (uint64_t)mnstats.nLists);
+        mnobj.pushKV("diffs", (uint64_t)mnstats.nDiffs);
+        mnobj.pushKV("nodes", (uint64_t)mnstats.nListsNodesUsage);
+        mnobj.pushKV("retained", (uint64_t)mnstats.nListsUsage);
+        mnobj.pushKV("cache", (uint64_t)mnstats.nCacheUsage);
+        obj.pushKV("mnlists", mnobj);
+    }
+    const CNetBufferPool::Stats bufstats = CNetBufferPool::Instance().GetStats();
+    UniValue bufobj(UniValue::VOBJ);
+    bufobj.pushKV("buffers", (uint64_t)bufstats.nBuffers);
+    bufobj.pushKV("bytes", (uint64_t)bufstats.nBytes);
+    bufobj.pushKV("reused", bufstats.nReused);
+    bufobj.pushKV("allocated", bufstats.nAllocated);
+    bufobj.pushKV("freed", bufstats.nFreed);
+    obj.pushKV("netbuffers", bufobj);
+    UniValue budgetobj(UniValue::VOBJ);
+    UniValue componentsobj(UniValue::VOBJ);
+    size_t nTotalUsage = 0;
+    for (const CMemoryBudget::ComponentUsage& usage : g_memory_budget.GetUsage()) {
+        UniValue componentobj(UniValue::VOBJ);
+        componentobj.pushKV("usage", (uint64_t)usage.nUsage);
+        componentobj.pushKV("priority", usage.nPriority);
+        componentobj.pushKV("trimmable", usage.fTrimmable);
+        componentobj.pushKV("trims", usage.nTrims);
+        componentsobj.pushKV(usage.strName, componentobj);
+        nTotalUsage += usage.nUsage;
+    }
+    budgetobj.pushKV("limit", (uint64_t)g_memory_budget.GetLimit());
+    budgetobj.pushKV("usage", (uint64_t)nTotalUsage);
+    budgetobj.pushKV("components", componentsobj);
+    obj.pushKV("budget", budgetobj);
+    UniValue dbcacheobj(UniValue::VOBJ);
+    UniValue cachesobj(UniValue::VOBJ);
+    for (const CCacheBalancer::CacheStats& stats : g_cache_balancer.GetStats()) {
+        UniValue cacheobj(UniValue::VOBJ);
+        cacheobj.pushKV("target", (uint64_t)stats.nTarget);
+        cacheobj.pushKV("usage", (uint64_t)stats.nUsage);
+        cacheobj.pushKV("hits", stats.nHits);
+        cacheobj.pushKV("misses", stats.nMisses);
+        cachesobj.pushKV(stats.strName, cacheobj);
+    }
+    dbcacheobj.pushKV("dynamic", g_cache_balancer.IsDynamic());
+    dbcacheobj.pushKV("total", (uint64_t)g_cache_balancer.GetTotal());
+    dbcacheobj.pushKV("caches", cachesobj);
+    obj.pushKV("dbcache", dbcacheobj);
+    return obj;
+}
+
+UniValue getdbcompactioninfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getdbcompactioninfo ( verbose )\n"
+            "Returns an object containing information about the compaction of the databases while the node is idle.\n"
+
+            "\nArguments:\n"
+            "1. verbose        (boolean, optional, default=false) Include the LevelDB statistics of each database\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                 (json object) The statistics of a database, by name\n"
+            "    \"ranges\": n,            (numeric) Number of key ranges compacted\n"
+            "    \"bytes\": n,             (numeric) Estimated size of the data compacted\n"
+            "    \"time_ms\": n,           (numeric) Time spent compacting, in milliseconds\n"
+            "    \"lasttime\": ttt,        (numeric) Time of the last compaction, in seconds since epoch (Jan 1 1970 GMT)\n"
+            "    \"nextrange\": \"xxxx\",   (string) Hex of the first key bytes of the next range to compact\n"
+            "    \"leveldb\": \"xxxx\"      (string, verbose only) The LevelDB statistics of the files and compactions of each level\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbcompactioninfo", "")
+            + HelpExampleRpc("getdbcompactioninfo", "")
+        );
+
+    const bool fVerbose = request.params.size() > 0 && request.params[0].get_bool();
+    UniValue obj(UniValue::VOBJ);
+    ForEachDBWrapper([&obj, fVerbose](const CDBWrapper& db) {
+        const CDBCompactionStats stats = db.GetCompactionStats();
+        UniValue dbobj(UniValue::VOBJ);
+        dbobj.pushKV("ranges", stats.nRanges);
+        dbobj.pushKV("bytes", stats.nBytes);
+        dbobj.pushKV("time_ms", stats.nTimeMicros / 1000);
+        dbobj.pushKV("lasttime", stats.nLastTime);
+        dbobj.pushKV("nextrange", strprintf(stats.fSplitRange ? "%04x" : "%02x", stats.fSplitRange ? stats.nNextRange : stats.nNextRange >> 8));
+        if (fVerbose) {
+            dbobj.pushKV("leveldb", db.GetLevelDBStats());
+        }
+        obj.pushKV(db.GetDBOptions().strName, dbobj);
+    });
+    return obj;
+}
+
+static UniValue LockHistogramToJSON(const LockTimeHistogram& hist)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("count", hist.nCount);
+    obj.pushKV("total_us", hist.nTotalMicros);
+    obj.pushKV("max_us", hist.nMaxMicros);
+    UniValue buckets(UniValue::VOBJ);
+    for (int i = 0; i < LOCK_PROFILE_BUCKETS; i++) {
+        if (hist.vBuckets[i] == 0) continue;
+        buckets.pushKV(i < LOCK_PROFILE_BUCKETS - 1 ? strprintf("<%d", (int64_t)1 << i) : "inf", hist.vBuckets[i]);
+    }
+    obj.pushKV("histogram", buckets);
     return obj;
 }
 
+UniValue getlockcontention(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 2)
+        throw std::runtime_error(
+            "getlockcontention ( enable reset )\n"
+            "Returns the waits on the contended locks and the sampled hold times, per lock site, recorded by the lock profiler.\n"
+            "The profiler is off unless the node is started with -lockprofiler or it is enabled here.\n"
+
+            "\nArguments:\n"
+            "1. enable         (boolean, optional) Turn the profiler on or off\n"
+            "2. reset          (boolean, optional, default=false) Clear the recorded profile after returning it\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"enabled\": true|false,      (boolean) Whether the profiler is running\n"
+            "  \"sites\": [                  (array) The lock sites, by total wait time, descending\n"
+            "    {\n"
+            "      \"lock\": \"xxxx\",          (string) The locked mutex\n"
+            "      \"location\": \"file:line\", (string) The source location of the lock\n"
+            "      \"wait\": {                 (json object) The waits of the contended acquisitions\n"
+            "        \"count\": n,             (numeric) Number of waits\n"
+            "        \"total_us\": n,          (numeric) Total time waited, in microseconds\n"
+            "        \"max_us\": n,            (numeric) Longest wait, in microseconds\n"
+            "        \"histogram\": {          (json object) Counts by upper bound of the duration, in microseconds\n"
+            "          \"<n\": n, ...\n"
+            "        }\n"
+            "      },\n"
+            "      \"hold\": { ... }           (json object) The sampled hold times, same format as \"wait\"\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockcontention", "true")
+            + HelpExampleRpc("getlockcontention", "true, false")
+        );
+
+    if (request.params.size() > 0 && !request.params[0].isNull()) {
+        g_lock_profiler = request.params[0].get_bool();
+    }
+    const bool fReset = request.params.size() > 1 && request.params[1].get_bool();
+
+    std::vector<LockSiteProfile> vSites = GetLockProfile(fReset);
+    std::sort(vSites.begin(), vSites.end(), [](const LockSiteProfile& a, const LockSiteProfile& b) {
+        return a.wait.nTotalMicros > b.wait.nTotalMicros;
+    });
+    UniValue sites(UniValue::VARR);
+    for (const LockSiteProfile& site : vSites) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("lock", site.strName);
+        obj.pushKV("location", strprintf("%s:%d", site.strFile, site.nLine));
+        obj.pushKV("wait", LockHistogramToJSON(site.wait));
+        obj.pushKV("hold", LockHistogramToJSON(site.hold));
+        sites.push_back(obj);
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("enabled", g_lock_profiler.load());
+    ret.pushKV("sites", sites);
+    return ret;
+}
+
 UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -844,15 +1088,180 @@ UniValue mnconnect(const JSONRPCRequest& request)
     return false;
 }
 
+// The script hashes of the addresses of the array param, and the address of each
+static std::vector<std::pair<uint256, std::string>> GetAddressesScriptHashes(const UniValue& param)
+{
+    if (!g_addressindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled, restart with -addressindex");
+    }
+    if (!g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index still being built, try again later");
+    }
+
+    std::vector<std::pair<uint256, std::string>> vScripts;
+    const UniValue& addresses = param.get_array();
+    for (unsigned int i = 0; i < addresses.size(); i++) {
+        const std::string& strAddress = addresses[i].get_str();
+        CTxDestination dest = DecodeDestination(strAddress);
+        if (!IsValidDestination(dest)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address: " + strAddress);
+        }
+        const uint256 hashScript = GetScriptHash(GetScriptForDestination(dest));
+        if (std::none_of(vScripts.begin(), vScripts.end(), [&](const std::pair<uint256, std::string>& p) { return p.first == hashScript; })) {
+            vScripts.emplace_back(hashScript, strAddress);
+        }
+    }
+    return vScripts;
+}
+
+UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressutxos [\"address\",...]\n"
+            "\nReturns the unspent outputs of the addresses (requires -addressindex).\n"
+            "The P2PK and P2CS outputs are returned for the addresses of their keys (owner and staker of a P2CS).\n"
+
+            "\nArguments:\n"
+            "1. \"addresses\"      (string, required) A json array of pivx addresses\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\": \"xxx\",      (string) The address looked up\n"
+            "    \"txid\": \"hash\",        (string) The transaction id\n"
+            "    \"vout\": n,             (numeric) The output index\n"
+            "    \"scriptPubKey\": \"hex\", (string) The script of the output\n"
+            "    \"amount\": x.xxx,       (numeric) The output value in " + CURRENCY_UNIT + "\n"
+            "    \"height\": n            (numeric) The height of the block of the output\n"
+            "  },...\n"
+            "]\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getaddressutxos", "\"[\\\"DAD3Y6ivr8nPQLT1NEPX84DxGCw9jz9Jvg\\\"]\"") +
+            HelpExampleRpc("getaddressutxos", "[\"DAD3Y6ivr8nPQLT1NEPX84DxGCw9jz9Jvg\"]"));
+
+    UniValue ret(UniValue::VARR);
+    for (const auto& script : GetAddressesScriptHashes(request.params[0])) {
+        std::vector<std::pair<COutPoint, CAddressUnspentValue>> vUnspent;
+        if (!g_addressindex->FindUnspent(script.first, vUnspent)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        }
+        for (const auto& it : vUnspent) {
+            UniValue output(UniValue::VOBJ);
+            output.pushKV("address", script.second);
+            output.pushKV("txid", it.first.hash.GetHex());
+            output.pushKV("vout", (int)it.first.n);
+            output.pushKV("scriptPubKey", HexStr(it.second.scriptPubKey));
+            output.pushKV("amount", ValueFromAmount(it.second.nValue));
+            output.pushKV("height", it.second.nHeight);
+            ret.push_back(output);
+        }
+    }
+    return ret;
+}
+
+UniValue getaddresstxids(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.empty() || request.params.size() > 3)
+        throw std::runtime_error(
+            "getaddresstxids [\"address\",...] ( start end )\n"
+            "\nReturns the ids of the transactions paying or spending from the addresses, sorted by height (requires -addressindex).\n"
+
+            "\nArguments:\n"
+            "1. \"addresses\"      (string, required) A json array of pivx addresses\n"
+            "2. start              (numeric, optional, default=0) The first block height\n"
+            "3. end                (numeric, optional, default=0) The last block height, 0 for the chain tip\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  \"txid\"               (string) The transaction id\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getaddresstxids", "\"[\\\"DAD3Y6ivr8nPQLT1NEPX84DxGCw9jz9Jvg\\\"]\" 1000 2000") +
+            HelpExampleRpc("getaddresstxids", "[\"DAD3Y6ivr8nPQLT1NEPX84DxGCw9jz9Jvg\"], 1000, 2000"));
+
+    const int nStart = request.params.size() > 1 ? request.params[1].get_int() : 0;
+    const int nEnd = request.params.size() > 2 ? request.params[2].get_int() : 0;
+    if (nStart < 0 || nEnd < 0 || (nEnd > 0 && nEnd < nStart)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid heights range");
+    }
+
+    // (height, txid) of all the entries, sorted and without duplicates
+    std::set<std::pair<int, uint256>> setTxids;
+    for (const auto& script : GetAddressesScriptHashes(request.params[0])) {
+        std::vector<std::pair<CAddressIndexKey, CAmount>> vEntries;
+        if (!g_addressindex->FindHistory(script.first, nStart, nEnd, vEntries)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        }
+        for (const auto& it : vEntries) {
+            setTxids.emplace(it.first.nHeight, it.first.txid);
+        }
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const auto& it : setTxids) {
+        ret.push_back(it.second.GetHex());
+    }
+    return ret;
+}
+
+UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressbalance [\"address\",...]\n"
+            "\nReturns the balance of the addresses (requires -addressindex).\n"
+
+            "\nArguments:\n"
+            "1. \"addresses\"      (string, required) A json array of pivx addresses\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\": x.xxx,    (numeric) The current balance in " + CURRENCY_UNIT + "\n"
+            "  \"received\": x.xxx    (numeric) The total amount received in " + CURRENCY_UNIT + "\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getaddressbalance", "\"[\\\"DAD3Y6ivr8nPQLT1NEPX84DxGCw9jz9Jvg\\\"]\"") +
+            HelpExampleRpc("getaddressbalance", "[\"DAD3Y6ivr8nPQLT1NEPX84DxGCw9jz9Jvg\"]"));
+
+    CAmount nBalance = 0;
+    CAmount nReceived = 0;
+    for (const auto& script : GetAddressesScriptHashes(request.params[0])) {
+        std::vector<std::pair<CAddressIndexKey, CAmount>> vEntries;
+        if (!g_addressindex->FindHistory(script.first, 0, 0, vEntries)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        }
+        for (const auto& it : vEntries) {
+            nBalance += it.second;
+            if (!it.first.fSpending) nReceived += it.second;
+        }
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("balance", ValueFromAmount(nBalance));
+    ret.pushKV("received", ValueFromAmount(nReceived));
+    return ret;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ --------
     { "control",            "getinfo",                &getinfo,                true,  {} }, /* uses wallet if enabled */
+    { "control",            "getdbcompactioninfo",    &getdbcompactioninfo,    true,  {"verbose"} },
+    { "control",            "getlockcontention",      &getlockcontention,      true,  {"enable","reset"} },
     { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {} },
     { "control",            "mnsync",                 &mnsync,                 true,  {"mode"} },
     { "control",            "spork",                  &spork,                  true,  {"name","value"} },
 
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      true,  {"addresses"}, true },
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        true,  {"addresses","start","end"}, true },
+    { "addressindex",       "getaddressutxos",        &getaddressutxos,        true,  {"addresses"}, true },
+
     { "util",               "createmultisig",         &createmultisig,         true,  {"nrequired","keys"} },
     { "util",               "logging",                &logging,                true,  {"include", "exclude"} },
     { "util",               "validateaddress",        &validateaddress,        true,  {"pivxaddress"} }, /* uses wallet if enabled */
@@ -9,6 +9,7 @@
 #include "clientversion.h"
 #include "net.h"
 #include "netbase.h"
+#include "netmsgstats.h"
 #include "net_processing.h"
 #include "optional.h"
 #include "protocol.h"
@@ -363,6 +364,50 @@ UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+UniValue getnetstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getnetstats\n"
+            "\nReturns the time spent by the received messages waiting to be processed, and processing them,\n"
+            "per message type and per component handling them, since the node started.\n"
+            "The waits are measured from the reception of the message.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"messages\": {          (json object) The received message types\n"
+            "    \"msg\": {             (json object) The stats of the message type, if received at least once\n"
+            "      \"count\": n,        (numeric) Number of messages processed\n"
+            "      \"bytes\": n,        (numeric) Bytes received, headers included\n"
+            "      \"wait\": {          (json object) Times in the process queues\n"
+            "        \"count\": n,      (numeric) Number of messages\n"
+            "        \"avg_us\": n,     (numeric) Average time, in microseconds\n"
+            "        \"max_us\": n,     (numeric) Maximum time, in microseconds\n"
+            "        \"total_ms\": n,   (numeric) Total time, in milliseconds\n"
+            "        \"histogram\": {   (json object) Number of messages per bucket of time\n"
+            "          \"<=50us\": n,\n"
+            "          ...\n"
+            "          \">1000ms\": n\n"
+            "        }\n"
+            "      },\n"
+            "      \"process\": {...}   (json object) Processing times, same as wait\n"
+            "    },\n"
+            "    ...\n"
+            "  },\n"
+            "  \"components\": {        (json object) The same stats, aggregated per component: core, sporks,\n"
+            "    ...                    masternodes, payments, budget, sync, mnauth, quorums, dkg, sigshares,\n"
+            "  }                        signing, chainlocks\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getnetstats", "") + HelpExampleRpc("getnetstats", ""));
+
+    if (!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    return g_connman->GetMsgStats().ToJson();
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -714,6 +759,7 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         true,  {"node"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true,  {"dummy","node"} },
     { "network",            "getconnectioncount",     &getconnectioncount,     true,  {} },
+    { "network",            "getnetstats",            &getnetstats,            true,  {} },
     { "network",            "getnettotals",           &getnettotals,           true,  {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  {} },
     { "network",            "getnodeaddresses",       &getnodeaddresses,       true,  {"count"} },
@@ -7,6 +7,7 @@
 
 #include "core_io.h"
 #include "evo/providertx.h"
+#include "index/txindex.h"
 #include "key_io.h"
 #include "keystore.h"
 #include "llmq/quorums_chainlocks.h"
@@ -28,7 +29,6 @@
 #include "wallet/wallet.h"
 #endif
 
-#include <future>
 #include <stdint.h>
 
 #include <univalue.h>
@@ -232,6 +232,12 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             + HelpExampleCli("getrawtransaction", "\"mytxid\" true \"myblockhash\"")
         );
 
+    // Let the index process the blocks already connected
+    bool f_txindex_ready = false;
+    if (g_txindex && request.params[2].isNull()) {
+        f_txindex_ready = g_txindex->BlockUntilSyncedToCurrentChain();
+    }
+
     LOCK(cs_main);
 
     bool in_active_chain = true;
@@ -262,9 +268,13 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             }
             errmsg = "No such transaction found in the provided block";
         } else {
-            errmsg = fTxIndex
-              ? "No such mempool or blockchain transaction"
-              : "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+            if (!g_txindex) {
+                errmsg = "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+            } else if (!f_txindex_ready) {
+                errmsg = "No such mempool transaction. Blockchain transactions are still in the process of being indexed";
+            } else {
+                errmsg = "No such mempool or blockchain transaction";
+            }
         }
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, errmsg + ". Use gettransaction for wallet transactions.");
     }
@@ -669,19 +679,19 @@ UniValue signrawtransaction(const JSONRPCRequest& request)
 
             {
                 const Coin& coin = view.AccessCoin(out);
-                if (!coin.IsSpent() && coin.out.scriptPubKey != scriptPubKey) {
+                if (!coin.IsSpent() && coin.GetScriptPubKey() != scriptPubKey) {
                     std::string err("Previous output scriptPubKey mismatch:\n");
-                    err = err + ScriptToAsmStr(coin.out.scriptPubKey) + "\nvs:\n"+
+                    err = err + ScriptToAsmStr(coin.GetScriptPubKey()) + "\nvs:\n"+
                         ScriptToAsmStr(scriptPubKey);
                     throw JSONRPCError(RPC_DESERIALIZATION_ERROR, err);
                 }
 
                 Coin newcoin;
-                newcoin.out.scriptPubKey = scriptPubKey;
-                newcoin.out.nValue = 0;
+                newcoin.SetScriptPubKey(scriptPubKey);
+                newcoin.nValue = 0;
                 newcoin.nHeight = 1;
                 if (prevOut.exists("amount")) {
-                    newcoin.out.nValue = AmountFromValue(find_value(prevOut, "amount"));
+                    newcoin.nValue = AmountFromValue(find_value(prevOut, "amount"));
                 }
                 view.AddCoin(out, std::move(newcoin), true);
             }
@@ -754,8 +764,8 @@ UniValue signrawtransaction(const JSONRPCRequest& request)
             }
         }
 
-        const CScript& prevPubKey = (Params().IsRegTestNet() && mapPrevOut.count(txin.prevout) != 0 ? mapPrevOut[txin.prevout].first : coin.out.scriptPubKey);
-        const CAmount& amount = (Params().IsRegTestNet() && mapPrevOut.count(txin.prevout) != 0 ? mapPrevOut[txin.prevout].second : coin.out.nValue);
+        const CScript& prevPubKey = (Params().IsRegTestNet() && mapPrevOut.count(txin.prevout) != 0 ? mapPrevOut[txin.prevout].first : coin.GetScriptPubKey());
+        const CAmount& amount = (Params().IsRegTestNet() && mapPrevOut.count(txin.prevout) != 0 ? mapPrevOut[txin.prevout].second : coin.nValue);
 
         txin.scriptSig.clear();
 
@@ -801,7 +811,6 @@ UniValue signrawtransaction(const JSONRPCRequest& request)
 void TryATMP(const CMutableTransaction& mtx, bool fOverrideFees)
 {
     const uint256& hashTx = mtx.GetHash();
-    std::promise<void> promise;
     bool fLimitFree = true;
 
     { // cs_main scope
@@ -825,15 +834,6 @@ void TryATMP(const CMutableTransaction& mtx, bool fOverrideFees)
                     }
                     throw JSONRPCError(RPC_TRANSACTION_ERROR, strprintf("%s: %s", state.GetRejectReason(), state.GetDebugMessage()));
                 }
-            } else {
-                // If wallet is enabled, ensure that the wallet has been made aware
-                // of the new transaction prior to returning. This prevents a race
-                // where a user might call sendrawtransaction with a transaction
-                // to/from their wallet, immediately call some wallet RPC, and get
-                // a stale result because callbacks have not yet been processed.
-                CallFunctionInValidationInterfaceQueue([&promise] {
-                    promise.set_value();
-                });
             }
         } else if (fHaveChain) {
             throw JSONRPCError(RPC_TRANSACTION_ALREADY_IN_CHAIN, "transaction already in block chain");
@@ -841,7 +841,13 @@ void TryATMP(const CMutableTransaction& mtx, bool fOverrideFees)
 
     } // cs_main
 
-    promise.get_future().wait();
+    // If wallet is enabled, ensure that the wallet has been made aware
+    // of the new transaction prior to returning. This prevents a race
+    // where a user might call sendrawtransaction with a transaction
+    // to/from their wallet, immediately call some wallet RPC, and get
+    // a stale result because callbacks have not yet been processed.
+    // The wallets process them on their own queues, which this waits for too.
+    SyncWithValidationInterfaceQueue();
 }
 
 void RelayTx(const uint256& hashTx)
@@ -896,15 +902,99 @@ UniValue sendrawtransaction(const JSONRPCRequest& request)
     return hashTx.GetHex();
 }
 
+UniValue submitpackage(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "submitpackage [\"hexstring\",...] ( allowhighfees )\n"
+            "\nSubmits a package of raw transactions (serialized, hex-encoded) to local node and network.\n"
+            "The package is validated in a single pass: the transactions must be sorted, with the parents\n"
+            "of a transaction before it. The accepted transactions are relayed.\n"
+
+            "\nArguments:\n"
+            "1. [\"hexstring\",...]  (array, required) The hex strings of the raw transactions, at most " + std::to_string(MAX_PACKAGE_COUNT) + "\n"
+            "2. allowhighfees       (boolean, optional, default=false) Allow high fees\n"
+
+            "\nResult:\n"
+            "[                      (array) The result of each transaction, in the package order\n"
+            "  {\n"
+            "    \"txid\": \"hex\",       (string) The transaction hash in hex\n"
+            "    \"accepted\": true|false, (boolean) Whether the transaction is in the mempool\n"
+            "    \"reject-reason\": \"str\" (string, optional) The reason the transaction was rejected\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("submitpackage", "\"[\\\"parenthex\\\",\\\"childhex\\\"]\"") +
+            HelpExampleRpc("submitpackage", "[\"parenthex\",\"childhex\"]"));
+
+    RPCTypeCheck(request.params, {UniValue::VARR, UniValue::VBOOL});
+
+    const UniValue& txs = request.params[0].get_array();
+    if (txs.empty() || txs.size() > MAX_PACKAGE_COUNT) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("The package must have between 1 and %d transactions", MAX_PACKAGE_COUNT));
+    }
+    std::vector<CTransactionRef> package;
+    package.reserve(txs.size());
+    for (size_t i = 0; i < txs.size(); i++) {
+        CMutableTransaction mtx;
+        if (!DecodeHexTx(mtx, txs[i].get_str()))
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strprintf("TX decode failed for transaction %d", i));
+        package.emplace_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    bool fOverrideFees = false;
+    if (request.params.size() > 1)
+        fOverrideFees = request.params[1].get_bool();
+
+    std::vector<CValidationState> vTxStates;
+    std::vector<bool> vAccepted;
+    { // cs_main scope
+        LOCK(cs_main);
+        CValidationState state;
+        AcceptPackageToMemoryPool(mempool, state, package, vTxStates, !fOverrideFees);
+        if (state.IsInvalid()) {
+            throw JSONRPCError(RPC_TRANSACTION_REJECTED, strprintf("%s: %s", state.GetRejectReason(), state.GetDebugMessage()));
+        }
+        for (const CTransactionRef& tx : package) {
+            vAccepted.push_back(mempool.exists(tx->GetHash()));
+        }
+    }
+
+    // Make the wallet aware of the accepted transactions before returning (see TryATMP)
+    SyncWithValidationInterfaceQueue();
+
+    UniValue result(UniValue::VARR);
+    for (size_t i = 0; i < package.size(); i++) {
+        const uint256& hashTx = package[i]->GetHash();
+        const bool fAccepted = vAccepted[i];
+        if (fAccepted) {
+            RelayTx(hashTx);
+        }
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("txid", hashTx.GetHex());
+        entry.pushKV("accepted", fAccepted);
+        if (!fAccepted) {
+            const CValidationState& txState = vTxStates[i];
+            entry.pushKV("reject-reason", txState.GetDebugMessage().empty() ? txState.GetRejectReason() :
+                                          strprintf("%s: %s", txState.GetRejectReason(), txState.GetDebugMessage()));
+        }
+        result.push_back(entry);
+    }
+    return result;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ --------
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true,  {"inputs","outputs","locktime"} },
-    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,  {"hexstring"}  },
-    { "rawtransactions",    "decodescript",           &decodescript,           true,  {"hexstring"} },
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  {"txid","verbose","blockhash"} },
+    { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,  {"hexstring"}, true },
+    { "rawtransactions",    "decodescript",           &decodescript,           true,  {"hexstring"}, true },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  {"txid","verbose","blockhash"}, true },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false, {"hexstring","allowhighfees"} },
+    { "rawtransactions",    "submitpackage",          &submitpackage,          false, {"hexstrings","allowhighfees"} },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false, {"hexstring","prevtxs","privkeys","sighashtype"} }, /* uses wallet if enabled */
 };
 // clang-format on
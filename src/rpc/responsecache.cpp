@@ -0,0 +1,97 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/responsecache.h"
+
+RPCResponseCache g_rpc_response_cache;
+
+size_t EstimateUniValueUsage(const UniValue& value)
+{
+    size_t nUsage = sizeof(UniValue) + value.getValStr().size();
+    for (const std::string& key : value.getKeys()) {
+        nUsage += sizeof(std::string) + key.size();
+    }
+    for (const UniValue& child : value.getValues()) {
+        nUsage += EstimateUniValueUsage(child);
+    }
+    return nUsage;
+}
+
+void RPCResponseCache::ClearEntries()
+{
+    AssertLockHeld(cs);
+    mapEntries.clear();
+    lruEntries.clear();
+    nUsage = 0;
+}
+
+void RPCResponseCache::SetMaxUsage(size_t nMaxUsageIn)
+{
+    LOCK(cs);
+    nMaxUsage = nMaxUsageIn;
+    ClearEntries();
+}
+
+bool RPCResponseCache::IsEnabled() const
+{
+    LOCK(cs);
+    return nMaxUsage > 0;
+}
+
+bool RPCResponseCache::Lookup(const std::string& strKey, const uint256& hashChainStateIn, UniValue& result)
+{
+    LOCK(cs);
+    if (hashChainStateIn != hashChainState) {
+        ClearEntries();
+        hashChainState = hashChainStateIn;
+    }
+    auto it = mapEntries.find(strKey);
+    if (it == mapEntries.end()) {
+        nMisses++;
+        return false;
+    }
+    lruEntries.splice(lruEntries.begin(), lruEntries, it->second);
+    result = it->second->result;
+    nHits++;
+    return true;
+}
+
+void RPCResponseCache::Insert(const std::string& strKey, const uint256& hashChainStateIn, const UniValue& result)
+{
+    LOCK(cs);
+    if (hashChainStateIn != hashChainState || mapEntries.count(strKey)) return;
+
+    // The key is stored in the map and in the entry
+    const size_t nEntryUsage = EstimateUniValueUsage(result) + 2 * (sizeof(std::string) + strKey.size());
+    if (nEntryUsage > nMaxUsage) return;
+    while (nUsage + nEntryUsage > nMaxUsage) {
+        const Entry& last = lruEntries.back();
+        nUsage -= last.nUsage;
+        mapEntries.erase(last.strKey);
+        lruEntries.pop_back();
+        nEvictions++;
+    }
+    lruEntries.push_front(Entry{strKey, result, nEntryUsage});
+    mapEntries.emplace(strKey, lruEntries.begin());
+    nUsage += nEntryUsage;
+}
+
+void RPCResponseCache::Clear()
+{
+    LOCK(cs);
+    ClearEntries();
+}
+
+RPCResponseCacheStats RPCResponseCache::GetStats() const
+{
+    LOCK(cs);
+    RPCResponseCacheStats stats;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    stats.nEvictions = nEvictions;
+    stats.nEntries = mapEntries.size();
+    stats.nUsage = nUsage;
+    stats.nMaxUsage = nMaxUsage;
+    return stats;
+}
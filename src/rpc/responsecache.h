@@ -0,0 +1,78 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_RPC_RESPONSECACHE_H
+#define PIVX_RPC_RESPONSECACHE_H
+
+#include "sync.h"
+#include "uint256.h"
+
+#include <univalue.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+//! -rpccachesize default, in MiB
+static const int64_t DEFAULT_RPC_CACHE_SIZE = 32;
+
+struct RPCResponseCacheStats {
+    uint64_t nHits{0};
+    uint64_t nMisses{0};
+    uint64_t nEvictions{0};
+    size_t nEntries{0};
+    size_t nUsage{0};
+    size_t nMaxUsage{0};
+};
+
+/** Rough estimate of the memory used by a UniValue tree */
+size_t EstimateUniValueUsage(const UniValue& value);
+
+/**
+ * LRU cache of the results of the RPC calls on immutable chain data, by method and params.
+ * The results may still depend on the tip (e.g. the confirmations of a block) and on the chainlocks,
+ * so the cache is tied to a hash of that chain state and is cleared the first time it is looked
+ * up with another one.
+ * The memory used by the entries is bounded by nMaxUsage; the cache is disabled when it is 0.
+ */
+class RPCResponseCache
+{
+private:
+    struct Entry {
+        std::string strKey;
+        UniValue result;
+        size_t nUsage;
+    };
+
+    mutable Mutex cs;
+    size_t nMaxUsage GUARDED_BY(cs);
+    uint256 hashChainState GUARDED_BY(cs);
+    // Most recently used first
+    std::list<Entry> lruEntries GUARDED_BY(cs);
+    std::unordered_map<std::string, std::list<Entry>::iterator> mapEntries GUARDED_BY(cs);
+    size_t nUsage GUARDED_BY(cs){0};
+    uint64_t nHits GUARDED_BY(cs){0};
+    uint64_t nMisses GUARDED_BY(cs){0};
+    uint64_t nEvictions GUARDED_BY(cs){0};
+
+    void ClearEntries() EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+    explicit RPCResponseCache(size_t nMaxUsageIn = 0) : nMaxUsage(nMaxUsageIn) {}
+
+    void SetMaxUsage(size_t nMaxUsageIn);
+    bool IsEnabled() const;
+
+    // Copies the cached result of strKey to result; a different hashChainStateIn clears the cache
+    bool Lookup(const std::string& strKey, const uint256& hashChainStateIn, UniValue& result);
+    // Caches the result computed at hashChainStateIn, unless the chain state of the cache changed meanwhile
+    void Insert(const std::string& strKey, const uint256& hashChainStateIn, const UniValue& result);
+    void Clear();
+
+    RPCResponseCacheStats GetStats() const;
+};
+
+extern RPCResponseCache g_rpc_response_cache;
+
+#endif // PIVX_RPC_RESPONSECACHE_H
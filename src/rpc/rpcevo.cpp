@@ -253,7 +253,7 @@ static UniValue DmnToJson(const CDeterministicMNCPtr dmn)
         return ret;
     }
     CTxDestination dest;
-    if (!ExtractDestination(coin.out.scriptPubKey, dest)) {
+    if (!ExtractDestination(coin.GetScriptPubKey(), dest)) {
         return ret;
     }
     ret.pushKV("collateralAddress", EncodeDestination(dest));
@@ -355,8 +355,8 @@ static OperationResult SignTransaction(CWallet* const pwallet, CMutableTransacti
         SigVersion sv = tx.GetRequiredSigVersion();
         txin.scriptSig.clear();
         SignatureData sigdata;
-        if (!ProduceSignature(MutableTransactionSignatureCreator(pwallet, &tx, i, coin.out.nValue, SIGHASH_ALL),
-                              coin.out.scriptPubKey, sigdata, sv, false)) {
+        if (!ProduceSignature(MutableTransactionSignatureCreator(pwallet, &tx, i, coin.nValue, SIGHASH_ALL),
+                              coin.GetScriptPubKey(), sigdata, sv, false)) {
             return errorOut(TxInErrorToString(i, txin, "signature failed"));
         }
         UpdateTransaction(tx, i, sigdata);
@@ -515,11 +515,11 @@ static UniValue ProTxRegister(const JSONRPCRequest& request, bool fSignAndSend)
     if (!WITH_LOCK(cs_main, return pcoinsTip->GetUTXOCoin(pl.collateralOutpoint, coin); )) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("collateral not found: %s-%d", collateralHash.ToString(), collateralIndex));
     }
-    if (coin.out.nValue != Params().GetConsensus().nMNCollateralAmt) {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("collateral %s-%d with invalid value %d", collateralHash.ToString(), collateralIndex, coin.out.nValue));
+    if (coin.nValue != Params().GetConsensus().nMNCollateralAmt) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("collateral %s-%d with invalid value %d", collateralHash.ToString(), collateralIndex, coin.nValue));
     }
     CTxDestination txDest;
-    ExtractDestination(coin.out.scriptPubKey, txDest);
+    ExtractDestination(coin.GetScriptPubKey(), txDest);
     const CKeyID* keyID = boost::get<CKeyID>(&txDest);
     if (!keyID) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("collateral type not supported: %s-%d", collateralHash.ToString(), collateralIndex));
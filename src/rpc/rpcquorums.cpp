@@ -376,6 +376,39 @@ UniValue quorumdkgsimerror(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+UniValue quorumsigninglatency(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0) {
+        throw std::runtime_error(
+                "quorumsigninglatency\n"
+                "Return the latency of the signing sessions (e.g. chainlocks) started by the active masternode,\n"
+                "per stage of the signing process. Each stage is timed from the previous stage reached by a session.\n"
+                "\nResult:\n"
+                "{\n"
+                "  \"sessions\": n,           (numeric) Number of signing sessions started\n"
+                "  \"pending\": n,            (numeric) Number of sessions still tracked\n"
+                "  \"stage\": {               (object) One entry per stage: shareCreated, sharesCollected, recovered,\n"
+                "                                  clsigAccepted and clsigRelayed\n"
+                "    \"count\": n,            (numeric) Number of sessions which reached the stage\n"
+                "    \"avg_ms\": n,           (numeric) Average time to reach the stage, in milliseconds\n"
+                "    \"max_ms\": n,           (numeric) Maximum time to reach the stage, in milliseconds\n"
+                "    \"histogram\": {...}     (object) Number of sessions per time bucket\n"
+                "  },\n"
+                "  ...\n"
+                "}\n"
+                "\nExamples:\n"
+                + HelpExampleRpc("quorumsigninglatency", "")
+                + HelpExampleCli("quorumsigninglatency", "")
+        );
+    }
+
+    if (!fMasterNode || !activeMasternodeManager) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "This is not a (deterministic) masternode");
+    }
+
+    return llmq::quorumSigningManager->GetLatencyStats().ToJson();
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category       name                      actor (function)      okSafe argNames
@@ -384,6 +417,7 @@ static const CRPCCommand commands[] =
     { "evo",         "getquorummembers",       &getquorummembers,    true,  {"llmq_type", "quorum_hash"}  },
     { "evo",         "quorumdkgsimerror",      &quorumdkgsimerror,   true,  {"error_type", "rate"}  },
     { "evo",         "quorumdkgstatus",        &quorumdkgstatus,     true,  {"detail_level"}  },
+    { "evo",         "quorumsigninglatency",   &quorumsigninglatency,true,  {}  },
     { "evo",         "listquorums",            &listquorums,         true,  {"count"}  },
     { "evo",         "getquoruminfo",          &getquoruminfo,       true,  {"llmqType", "quorumHash", "includeSkShare"}  },
 
@@ -7,13 +7,22 @@
 
 #include "rpc/server.h"
 
+#include "ctpl_stl.h"
+#include "chain.h"
+#include "chaintipsnapshot.h"
 #include "fs.h"
+#include "hash.h"
+#include "httpserver.h"
 #include "key_io.h"
+#include "metrics.h"
 #include "random.h"
+#include "rpc/responsecache.h"
 #include "shutdown.h"
+#include "spork.h"
 #include "sync.h"
 #include "guiinterface.h"
 #include "util/system.h"
+#include "utilmoneystr.h"
 #include "utilstrencodings.h"
 
 #ifdef ENABLE_WALLET
@@ -25,9 +34,14 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 
+#include <future>
 #include <memory> // for unique_ptr
+#include <set>
 #include <unordered_map>
 
+//! Maximum number of threads executing the requests of the JSON-RPC batches
+static const int MAX_RPC_BATCH_THREADS = 16;
+
 static std::atomic<bool> g_rpc_running{false};
 static bool fRPCInWarmup = true;
 static std::string rpcWarmupStatus("RPC server started");
@@ -127,12 +141,7 @@ CAmount AmountFromValue(const UniValue& value)
 
 UniValue ValueFromAmount(const CAmount& amount)
 {
-    bool sign = amount < 0;
-    int64_t n_abs = (sign ? -amount : amount);
-    int64_t quotient = n_abs / COIN;
-    int64_t remainder = n_abs % COIN;
-    return UniValue(UniValue::VNUM,
-            strprintf("%s%d.%08d", sign ? "-" : "", quotient, remainder));
+    return UniValue(UniValue::VNUM, FormatMoneyFixed(amount));
 }
 
 uint256 ParseHashV(const UniValue& v, std::string strName)
@@ -279,6 +288,76 @@ UniValue stop(const JSONRPCRequest& jsonRequest)
     return "PIVX server stopping";
 }
 
+UniValue getrpcqueueinfo(const JSONRPCRequest& jsonRequest)
+{
+    if (jsonRequest.fHelp || !jsonRequest.params.empty())
+        throw std::runtime_error(
+            "getrpcqueueinfo\n"
+            "\nReturns the statistics of the RPC work queue, by priority class, since the start of the server.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"high\": {                (json object) The cheap monitoring calls\n"
+            "    \"queued\": n,           (numeric) The requests waiting in the queue\n"
+            "    \"running\": n,          (numeric) The requests being handled\n"
+            "    \"handled\": n,          (numeric) The requests taken from the queue\n"
+            "    \"rejected\": n,         (numeric) The requests rejected as the queue was full\n"
+            "    \"avg_wait_us\": n,      (numeric) The average time spent in the queue, in microseconds\n"
+            "    \"max_wait_us\": n       (numeric) The maximum time spent in the queue, in microseconds\n"
+            "  },\n"
+            "  \"normal\": {...},         (json object) The other calls\n"
+            "  \"low\": {...}             (json object) The expensive calls\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrpcqueueinfo", "") + HelpExampleRpc("getrpcqueueinfo", ""));
+
+    static const char* const classNames[HTTP_PRIORITY_COUNT] = {"high", "normal", "low"};
+    const std::vector<HTTPQueueStats> vStats = GetHTTPQueueStats();
+    UniValue ret(UniValue::VOBJ);
+    for (int i = 0; i < HTTP_PRIORITY_COUNT; i++) {
+        const HTTPQueueStats& stats = vStats[i];
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("queued", (uint64_t)stats.nQueued);
+        obj.pushKV("running", (uint64_t)stats.nRunning);
+        obj.pushKV("handled", stats.nHandled);
+        obj.pushKV("rejected", stats.nRejected);
+        obj.pushKV("avg_wait_us", stats.nHandled ? stats.nTotalWaitMicros / (int64_t)stats.nHandled : 0);
+        obj.pushKV("max_wait_us", stats.nMaxWaitMicros);
+        ret.pushKV(classNames[i], obj);
+    }
+    return ret;
+}
+
+UniValue getrpccacheinfo(const JSONRPCRequest& jsonRequest)
+{
+    if (jsonRequest.fHelp || !jsonRequest.params.empty())
+        throw std::runtime_error(
+            "getrpccacheinfo\n"
+            "\nReturns the statistics of the cache of the RPC results on chain data, since the start of the server.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"entries\": n,          (numeric) The cached results\n"
+            "  \"usage\": n,            (numeric) The estimated memory usage of the cached results, in bytes\n"
+            "  \"max_usage\": n,        (numeric) The memory limit of the cache, in bytes (-rpccachesize)\n"
+            "  \"hits\": n,             (numeric) The calls answered from the cache\n"
+            "  \"misses\": n,           (numeric) The cacheable calls which were executed\n"
+            "  \"evictions\": n,        (numeric) The results evicted to stay within the memory limit\n"
+            "  \"hit_rate\": x.xxx      (numeric) The ratio of the hits to the cacheable calls\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrpccacheinfo", "") + HelpExampleRpc("getrpccacheinfo", ""));
+
+    const RPCResponseCacheStats stats = g_rpc_response_cache.GetStats();
+    const uint64_t nCalls = stats.nHits + stats.nMisses;
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("entries", (uint64_t)stats.nEntries);
+    ret.pushKV("usage", (uint64_t)stats.nUsage);
+    ret.pushKV("max_usage", (uint64_t)stats.nMaxUsage);
+    ret.pushKV("hits", stats.nHits);
+    ret.pushKV("misses", stats.nMisses);
+    ret.pushKV("evictions", stats.nEvictions);
+    ret.pushKV("hit_rate", nCalls ? (double)stats.nHits / nCalls : 0.0);
+    return ret;
+}
 
 /**
  * Call Table
@@ -288,6 +367,8 @@ static const CRPCCommand vRPCCommands[] =
   //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ ----------
     /* Overall control/query calls */
+    { "control",            "getrpccacheinfo",        &getrpccacheinfo,        true,  {}  },
+    { "control",            "getrpcqueueinfo",        &getrpcqueueinfo,        true,  {}  },
     { "control",            "help",                   &help,                   true,  {"command"}  },
     { "control",            "stop",                   &stop,                   true,  {"wait"}  },
 };
@@ -329,6 +410,7 @@ bool StartRPC()
 {
     LogPrint(BCLog::RPC, "Starting RPC\n");
     g_rpc_running = true;
+    g_rpc_response_cache.SetMaxUsage(std::max<int64_t>(0, gArgs.GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE)) << 20);
     g_rpcSignals.Started();
     return true;
 }
@@ -431,12 +513,48 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
+static ctpl::thread_pool& GetBatchPool()
+{
+    static ctpl::thread_pool batchPool;
+    static std::once_flag startFlag;
+    std::call_once(startFlag, [] {
+        int nThreads = gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS);
+        batchPool.resize(std::max(1, std::min(nThreads, MAX_RPC_BATCH_THREADS)));
+        RenameThreadPool(batchPool, "pivx-rpc-batch");
+    });
+    return batchPool;
+}
+
+static bool IsParallelRequest(const UniValue& req)
+{
+    if (!req.isObject()) return false;
+    const UniValue& method = find_value(req.get_obj(), "method");
+    if (!method.isStr()) return false;
+    const CRPCCommand* pcmd = tableRPC[method.get_str()];
+    return pcmd && pcmd->okParallel;
+}
+
 std::string JSONRPCExecBatch(const UniValue& vReq)
 {
-    UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    // The consecutive requests of commands flagged okParallel run concurrently on the batch pool.
+    // The other ones run alone, in order, once the preceding ones are completed.
+    std::vector<UniValue> vReply(vReq.size());
+    std::vector<std::future<void>> vRunning;
+    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++) {
+        if (IsParallelRequest(vReq[reqIdx])) {
+            vRunning.emplace_back(GetBatchPool().push([&vReq, &vReply, reqIdx](int) {
+                vReply[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+            }));
+            continue;
+        }
+        for (std::future<void>& f : vRunning) f.get();
+        vRunning.clear();
+        vReply[reqIdx] = JSONRPCExecOne(vReq[reqIdx]);
+    }
+    for (std::future<void>& f : vRunning) f.get();
 
+    UniValue ret(UniValue::VARR);
+    for (const UniValue& reply : vReply) ret.push_back(reply);
     return ret.write() + "\n";
 }
 
@@ -490,6 +608,38 @@ static inline JSONRPCRequest transformNamedArguments(const JSONRPCRequest& in, c
     return out;
 }
 
+/**
+ * The methods whose results depend only on their params and on the tip, cached by
+ * g_rpc_response_cache. getbudgetprojection and the other tier two calls are not, as their
+ * results change with the votes and the messages received at the same tip.
+ */
+static const std::set<std::string> setCacheableMethods = {
+    "getblock",
+    "getblockfilter",
+    "getblockheader",
+    "getrawtransaction",
+};
+
+static bool IsCacheableResult(const std::string& strMethod, const UniValue& result)
+{
+    // The mempool transactions may be removed without a tip change
+    if (strMethod == "getrawtransaction") {
+        return result.isObject() && !find_value(result, "blockhash").isNull();
+    }
+    return true;
+}
+
+// The results include the confirmations and the chainlock status of the blocks
+static uint256 GetCacheChainState()
+{
+    const ChainTipSnapshotRef snapshot = GetChainTipSnapshot();
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << (snapshot->pindexTip ? snapshot->pindexTip->GetBlockHash() : UINT256_ZERO);
+    ss << (snapshot->pindexChainLock ? snapshot->pindexChainLock->GetBlockHash() : UINT256_ZERO);
+    ss << sporkManager.IsSporkActive(SPORK_23_CHAINLOCKS_ENFORCEMENT);
+    return ss.GetHash();
+}
+
 UniValue CRPCTable::execute(const JSONRPCRequest &request) const
 {
     // Return immediately if in warmup
@@ -505,15 +655,38 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
 
     g_rpcSignals.PreCommand(*pcmd);
 
+    const int64_t nTimeStart = GetTimeMicros();
+
+    // The result is cached with the chain state read before the execution, and only if it didn't
+    // change meanwhile, so that a result computed on a previous tip is never served.
+    const bool fCacheable = !request.fHelp && setCacheableMethods.count(pcmd->name) && g_rpc_response_cache.IsEnabled();
+    std::string strCacheKey;
+    uint256 hashCacheState;
+    if (fCacheable) {
+        strCacheKey = pcmd->name + " " + request.params.write();
+        hashCacheState = GetCacheChainState();
+        UniValue result;
+        if (g_rpc_response_cache.Lookup(strCacheKey, hashCacheState, result)) {
+            g_metrics.RecordRPCCall(pcmd->name, GetTimeMicros() - nTimeStart, false);
+            return result;
+        }
+    }
+
     try {
         // Execute, convert arguments to array if necessary
-        if (request.params.isObject()) {
-            return pcmd->actor(transformNamedArguments(request, pcmd->argNames));
-        } else {
-            return pcmd->actor(request);
+        UniValue result = request.params.isObject() ? pcmd->actor(transformNamedArguments(request, pcmd->argNames))
+                                                    : pcmd->actor(request);
+        if (fCacheable && IsCacheableResult(pcmd->name, result) && GetCacheChainState() == hashCacheState) {
+            g_rpc_response_cache.Insert(strCacheKey, hashCacheState, result);
         }
+        g_metrics.RecordRPCCall(pcmd->name, GetTimeMicros() - nTimeStart, false);
+        return result;
     } catch (const std::exception& e) {
+        g_metrics.RecordRPCCall(pcmd->name, GetTimeMicros() - nTimeStart, true);
         throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    } catch (...) {
+        g_metrics.RecordRPCCall(pcmd->name, GetTimeMicros() - nTimeStart, true);
+        throw;
     }
 }
 
@@ -138,6 +138,8 @@ public:
     rpcfn_type actor;
     bool okSafeMode;
     std::vector<std::string> argNames;
+    //! Whether the command can run concurrently with the neighbouring ones of a JSON-RPC batch
+    bool okParallel{false};
 };
 
 /**
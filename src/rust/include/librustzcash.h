@@ -24,6 +24,9 @@ extern "C" {
 
     /// Loads the zk-SNARK parameters into memory and saves
     /// paths as necessary. Only called once.
+    /// With `lazy_proving_params`, only the Sapling verifying keys are
+    /// loaded: the proving parameters are read the first time a proof
+    /// is created (or by `librustzcash_sapling_load_proving_params`).
     void librustzcash_init_zksnark_params(
         const codeunit* spend_path,
         size_t spend_path_len,
@@ -33,9 +36,14 @@ extern "C" {
         const char* output_hash,
         const codeunit* sprout_path,
         size_t sprout_path_len,
-        const char* sprout_hash
+        const char* sprout_hash,
+        bool lazy_proving_params
     );
 
+    /// Loads the Sapling proving parameters, if they are not in memory yet.
+    /// Safe to call concurrently.
+    void librustzcash_sapling_load_proving_params();
+
     /// Validates the provided Equihash solution against
     /// the given parameters, input and nonce.
     bool librustzcash_eh_isvalid(
@@ -133,6 +141,51 @@ extern "C" {
     /// `librustzcash_sapling_proving_ctx_init`.
     void librustzcash_sapling_proving_ctx_free(void *);
 
+    /// Constructs a Spend proof like `librustzcash_sapling_spend_proof`,
+    /// without a proving context: the caller provides the value commitment
+    /// trapdoor `rcv` (see `librustzcash_sapling_generate_r`) and keeps it
+    /// for the binding signature. Safe to call concurrently.
+    bool librustzcash_sapling_spend_proof_with_rcv(
+        const unsigned char *ak,
+        const unsigned char *nsk,
+        const unsigned char *diversifier,
+        const unsigned char *rcm,
+        const unsigned char *ar,
+        const uint64_t value,
+        const unsigned char *anchor,
+        const unsigned char *witness,
+        const unsigned char *rcv,
+        unsigned char *cv,
+        unsigned char *rk,
+        unsigned char *zkproof
+    );
+
+    /// Constructs an Output proof like `librustzcash_sapling_output_proof`,
+    /// without a proving context: the caller provides the value commitment
+    /// trapdoor `rcv`. Safe to call concurrently.
+    bool librustzcash_sapling_output_proof_with_rcv(
+        const unsigned char *esk,
+        const unsigned char *payment_address,
+        const unsigned char *rcm,
+        const uint64_t value,
+        const unsigned char *rcv,
+        unsigned char *cv,
+        unsigned char *zkproof
+    );
+
+    /// Constructs the binding signature of a transaction whose proofs were
+    /// created with the `_with_rcv` functions, from the 32-byte trapdoors
+    /// of its `spendsLen` spends and `outputsLen` outputs.
+    bool librustzcash_sapling_binding_sig_with_rcvs(
+        const unsigned char *spend_rcvs,
+        size_t spendsLen,
+        const unsigned char *output_rcvs,
+        size_t outputsLen,
+        int64_t valueBalance,
+        const unsigned char *sighash,
+        unsigned char *result
+    );
+
     /// Creates a Sapling verification context. Please free this
     /// when you're done.
     void * librustzcash_sapling_verification_ctx_init();
@@ -173,6 +226,54 @@ extern "C" {
     /// `librustzcash_sapling_verification_ctx_init`.
     void librustzcash_sapling_verification_ctx_free(void *);
 
+    /// Creates a Sapling batch verification context. Please free this
+    /// when you're done.
+    void * librustzcash_sapling_batch_validator_init();
+
+    /// Check the signature of a Sapling Spend description, accumulating
+    /// the value commitment and deferring the proof to the batch.
+    bool librustzcash_sapling_batch_validator_check_spend(
+        void *ctx,
+        const unsigned char *cv,
+        const unsigned char *anchor,
+        const unsigned char *nullifier,
+        const unsigned char *rk,
+        const unsigned char *zkproof,
+        const unsigned char *spendAuthSig,
+        const unsigned char *sighashValue
+    );
+
+    /// Check a Sapling Output description, accumulating the value
+    /// commitment and deferring the proof to the batch.
+    bool librustzcash_sapling_batch_validator_check_output(
+        void *ctx,
+        const unsigned char *cv,
+        const unsigned char *cm,
+        const unsigned char *ephemeralKey,
+        const unsigned char *zkproof
+    );
+
+    /// Check the binding signature of the transaction whose descriptions
+    /// were added since the last call, and queue its proofs for the batch.
+    /// On failure the pending descriptions are discarded.
+    bool librustzcash_sapling_batch_validator_final_check(
+        void *ctx,
+        int64_t valueBalance,
+        const unsigned char *bindingSig,
+        const unsigned char *sighashValue
+    );
+
+    /// Discard the descriptions added since the last final check.
+    void librustzcash_sapling_batch_validator_discard(void *ctx);
+
+    /// Verify all the queued proofs with a single randomized batch
+    /// check. The queue is emptied and the context can be reused.
+    bool librustzcash_sapling_batch_validator_validate(void *ctx);
+
+    /// Frees a Sapling batch verification context returned from
+    /// `librustzcash_sapling_batch_validator_init`.
+    void librustzcash_sapling_batch_validator_free(void *ctx);
+
     /// Compute a Sapling nullifier.
     ///
     /// The `diversifier` parameter must be 11 bytes in length.
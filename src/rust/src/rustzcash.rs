@@ -3,29 +3,34 @@
 
 use bellman::{
     gadgets::multipack,
-    groth16::{create_random_proof, verify_proof, Parameters, PreparedVerifyingKey, Proof},
+    groth16::{self, create_random_proof, verify_proof, Parameters, PreparedVerifyingKey, Proof},
 };
+use blake2b_simd::State as Blake2bState;
 use blake2s_simd::Params as Blake2sParams;
 use bls12_381::{Bls12, Scalar};
 use byteorder::{LittleEndian, ReadBytesExt, WriteBytesExt};
 use ff::{Field, PrimeField};
-use group::GroupEncoding;
+use group::{Group, GroupEncoding};
 use jubjub::Fr;
 use libc::{c_char, c_uchar, size_t};
 use rand_core::OsRng;
 use std::{
     ffi::CStr,
     fs::File,
-    io::BufReader,
+    io::{self, BufReader, Read},
     ops::Mul,
     path::{Path, PathBuf},
     slice,
+    sync::Once,
 };
 use zcash_note_encryption::Domain;
 use zcash_primitives::{
     block::equihash,
     consensus::TestNetwork,
-    constants::{CRH_IVK_PERSONALIZATION, PROOF_GENERATION_KEY_GENERATOR, SPENDING_KEY_GENERATOR},
+    constants::{
+        CRH_IVK_PERSONALIZATION, PROOF_GENERATION_KEY_GENERATOR, SPENDING_KEY_GENERATOR,
+        VALUE_COMMITMENT_RANDOMNESS_GENERATOR, VALUE_COMMITMENT_VALUE_GENERATOR,
+    },
     merkle_tree::MerklePath,
     sapling::{
         keys::{DiversifiedTransmissionKey, EphemeralSecretKey, NullifierDerivingKey},
@@ -43,7 +48,7 @@ use zcash_primitives::{
     zip32,
 };
 use zcash_proofs::{
-    circuit::sprout,
+    circuit::{sapling as sapling_circuit, sprout},
     load_parameters,
     sapling::{SaplingProvingContext, SaplingVerificationContext},
     ZcashParameters,
@@ -69,8 +74,16 @@ static mut SAPLING_SPEND_VK: Option<PreparedVerifyingKey<Bls12>> = None;
 static mut SAPLING_OUTPUT_VK: Option<PreparedVerifyingKey<Bls12>> = None;
 static mut SPROUT_GROTH16_VK: Option<PreparedVerifyingKey<Bls12>> = None;
 
+// Non-prepared verifying keys, for batch verification
+static mut SAPLING_SPEND_BATCH_VK: Option<groth16::VerifyingKey<Bls12>> = None;
+static mut SAPLING_OUTPUT_BATCH_VK: Option<groth16::VerifyingKey<Bls12>> = None;
+
+// The proving parameters are only read from SAPLING_PARAMS_PATHS when first
+// needed if librustzcash_init_zksnark_params was called with lazy_proving_params.
 static mut SAPLING_SPEND_PARAMS: Option<Parameters<Bls12>> = None;
 static mut SAPLING_OUTPUT_PARAMS: Option<Parameters<Bls12>> = None;
+static mut SAPLING_PARAMS_PATHS: Option<(PathBuf, PathBuf)> = None;
+static SAPLING_PROVING_PARAMS_INIT: Once = Once::new();
 static mut SPROUT_GROTH16_PARAMS_PATH: Option<PathBuf> = None;
 
 /// Reads an FrRepr from [u8] of length 32
@@ -100,6 +113,7 @@ pub extern "system" fn librustzcash_init_zksnark_params(
     sprout_path: *const u8,
     sprout_path_len: usize,
     sprout_hash: *const c_char,
+    lazy_proving_params: bool,
 ) {
     let spend_path = Path::new(OsStr::from_bytes(unsafe {
         slice::from_raw_parts(spend_path, spend_path_len)
@@ -122,6 +136,7 @@ pub extern "system" fn librustzcash_init_zksnark_params(
         output_hash,
         sprout_path,
         sprout_hash,
+        lazy_proving_params,
     )
 }
 
@@ -137,6 +152,7 @@ pub extern "system" fn librustzcash_init_zksnark_params(
     sprout_path: *const u16,
     sprout_path_len: usize,
     sprout_hash: *const c_char,
+    lazy_proving_params: bool,
 ) {
     let spend_path =
         OsString::from_wide(unsafe { slice::from_raw_parts(spend_path, spend_path_len) });
@@ -157,9 +173,41 @@ pub extern "system" fn librustzcash_init_zksnark_params(
         output_hash,
         sprout_path.as_ref().map(|p| Path::new(p)),
         sprout_hash,
+        lazy_proving_params,
     )
 }
 
+/// Hashes with BLAKE2b everything read from the inner reader.
+struct HashReader<R: Read> {
+    reader: R,
+    hasher: Blake2bState,
+}
+
+impl<R: Read> HashReader<R> {
+    fn new(reader: R) -> Self {
+        HashReader {
+            reader,
+            hasher: Blake2bState::new(),
+        }
+    }
+
+    /// Reads what is left, and returns the hex hash of all the data.
+    fn into_hash(mut self) -> String {
+        io::copy(&mut self, &mut io::sink()).expect("couldn't read Sapling parameters file");
+        self.hasher.finalize().to_hex().to_string()
+    }
+}
+
+impl<R: Read> Read for HashReader<R> {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        let bytes = self.reader.read(buf)?;
+        if bytes > 0 {
+            self.hasher.update(&buf[0..bytes]);
+        }
+        Ok(bytes)
+    }
+}
+
 fn init_zksnark_params(
     spend_path: &Path,
     spend_hash: *const c_char,
@@ -167,12 +215,13 @@ fn init_zksnark_params(
     output_hash: *const c_char,
     sprout_path: Option<&Path>,
     sprout_hash: *const c_char,
+    lazy_proving_params: bool,
 ) {
-    let _spend_hash = unsafe { CStr::from_ptr(spend_hash) }
+    let spend_hash = unsafe { CStr::from_ptr(spend_hash) }
         .to_str()
         .expect("hash should be a valid string");
 
-    let _output_hash = unsafe { CStr::from_ptr(output_hash) }
+    let output_hash = unsafe { CStr::from_ptr(output_hash) }
         .to_str()
         .expect("hash should be a valid string");
 
@@ -186,6 +235,42 @@ fn init_zksnark_params(
         )
     };
 
+    // Caller is responsible for calling this function once, so
+    // these global mutations are safe.
+    unsafe {
+        SAPLING_PARAMS_PATHS = Some((spend_path.to_owned(), output_path.to_owned()));
+        SPROUT_GROTH16_PARAMS_PATH = sprout_path.map(|p| p.to_owned());
+    }
+
+    // The Sprout verifying key only comes with the full parameters
+    if lazy_proving_params && sprout_path.is_none() {
+        // The verifying key is at the start of the parameters file, the rest of
+        // the file is only read for its hash, checked as load_parameters does
+        let read_vk = |path: &Path, expected_hash: &str| {
+            let file = File::open(path).expect("couldn't load Sapling parameters file");
+            let mut reader = HashReader::new(BufReader::with_capacity(1024 * 1024, file));
+            let vk = groth16::VerifyingKey::<Bls12>::read(&mut reader)
+                .expect("couldn't deserialize Sapling verifying key");
+            if reader.into_hash() != expected_hash {
+                panic!(
+                    "Sapling parameters file {} is not valid: its hash doesn't match",
+                    path.display()
+                );
+            }
+            vk
+        };
+        let spend_vk = read_vk(spend_path, spend_hash);
+        let output_vk = read_vk(output_path, output_hash);
+
+        unsafe {
+            SAPLING_SPEND_VK = Some(groth16::prepare_verifying_key(&spend_vk));
+            SAPLING_OUTPUT_VK = Some(groth16::prepare_verifying_key(&output_vk));
+            SAPLING_SPEND_BATCH_VK = Some(spend_vk);
+            SAPLING_OUTPUT_BATCH_VK = Some(output_vk);
+        }
+        return;
+    }
+
     // Load params
     let ZcashParameters {
         spend_params,
@@ -195,17 +280,47 @@ fn init_zksnark_params(
         sprout_vk,
     } = load_parameters(spend_path, output_path, sprout_path);
 
-    // Caller is responsible for calling this function once, so
-    // these global mutations are safe.
     unsafe {
-        SAPLING_SPEND_PARAMS = Some(spend_params);
-        SAPLING_OUTPUT_PARAMS = Some(output_params);
-        SPROUT_GROTH16_PARAMS_PATH = sprout_path.map(|p| p.to_owned());
+        SAPLING_SPEND_BATCH_VK = Some(spend_params.vk.clone());
+        SAPLING_OUTPUT_BATCH_VK = Some(output_params.vk.clone());
 
         SAPLING_SPEND_VK = Some(spend_vk);
         SAPLING_OUTPUT_VK = Some(output_vk);
         SPROUT_GROTH16_VK = sprout_vk;
     }
+    SAPLING_PROVING_PARAMS_INIT.call_once(move || unsafe {
+        SAPLING_SPEND_PARAMS = Some(spend_params);
+        SAPLING_OUTPUT_PARAMS = Some(output_params);
+    });
+}
+
+/// Makes sure that the Sapling proving parameters are in memory, reading
+/// them from disk if they were not loaded at initialization.
+fn load_sapling_proving_params() {
+    SAPLING_PROVING_PARAMS_INIT.call_once(|| {
+        let (spend_path, output_path) = unsafe { SAPLING_PARAMS_PATHS.as_ref() }
+            .expect("parameters should have been initialized");
+        let params = load_parameters(spend_path, output_path, None);
+        unsafe {
+            SAPLING_SPEND_PARAMS = Some(params.spend_params);
+            SAPLING_OUTPUT_PARAMS = Some(params.output_params);
+        }
+    });
+}
+
+fn sapling_spend_params() -> &'static Parameters<Bls12> {
+    load_sapling_proving_params();
+    unsafe { SAPLING_SPEND_PARAMS.as_ref() }.unwrap()
+}
+
+fn sapling_output_params() -> &'static Parameters<Bls12> {
+    load_sapling_proving_params();
+    unsafe { SAPLING_OUTPUT_PARAMS.as_ref() }.unwrap()
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_load_proving_params() {
+    load_sapling_proving_params();
 }
 
 #[no_mangle]
@@ -687,6 +802,278 @@ pub extern "system" fn librustzcash_sapling_final_check(
     unsafe { &*ctx }.final_check(value_balance, unsafe { &*sighash_value }, binding_sig)
 }
 
+/// Accumulates the Groth16 proofs of many Sapling transactions so that they
+/// can be checked with a single randomized batch verification. Signatures
+/// are verified eagerly; the proofs of a transaction are only queued once
+/// its binding signature has been checked.
+pub struct SaplingBatchValidator {
+    cv_sum: jubjub::ExtendedPoint,
+    pending_spends: Vec<(Proof<Bls12>, Vec<Scalar>)>,
+    pending_outputs: Vec<(Proof<Bls12>, Vec<Scalar>)>,
+    spend_proofs: groth16::batch::Verifier<Bls12>,
+    output_proofs: groth16::batch::Verifier<Bls12>,
+}
+
+impl SaplingBatchValidator {
+    fn new() -> Self {
+        SaplingBatchValidator {
+            cv_sum: jubjub::ExtendedPoint::identity(),
+            pending_spends: vec![],
+            pending_outputs: vec![],
+            spend_proofs: groth16::batch::Verifier::new(),
+            output_proofs: groth16::batch::Verifier::new(),
+        }
+    }
+
+    fn discard_pending(&mut self) {
+        self.cv_sum = jubjub::ExtendedPoint::identity();
+        self.pending_spends.clear();
+        self.pending_outputs.clear();
+    }
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validator_init() -> *mut SaplingBatchValidator {
+    let ctx = Box::new(SaplingBatchValidator::new());
+
+    Box::into_raw(ctx)
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validator_free(ctx: *mut SaplingBatchValidator) {
+    drop(unsafe { Box::from_raw(ctx) });
+}
+
+/// Constructs the public input of the spend circuit
+fn spend_public_input(
+    rk: &redjubjub::PublicKey,
+    cv: &jubjub::ExtendedPoint,
+    anchor: Scalar,
+    nullifier: &[u8; 32],
+) -> Vec<Scalar> {
+    let mut public_input = vec![Scalar::ZERO; 7];
+    {
+        let affine = jubjub::AffinePoint::from(rk.0);
+        public_input[0] = affine.get_u();
+        public_input[1] = affine.get_v();
+    }
+    {
+        let affine = jubjub::AffinePoint::from(*cv);
+        public_input[2] = affine.get_u();
+        public_input[3] = affine.get_v();
+    }
+    public_input[4] = anchor;
+    {
+        let nullifier = multipack::bytes_to_bits_le(&nullifier[..]);
+        let nullifier = multipack::compute_multipacking(&nullifier);
+        assert_eq!(nullifier.len(), 2);
+        public_input[5] = nullifier[0];
+        public_input[6] = nullifier[1];
+    }
+    public_input
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validator_check_spend(
+    ctx: *mut SaplingBatchValidator,
+    cv: *const [c_uchar; 32],
+    anchor: *const [c_uchar; 32],
+    nullifier: *const [c_uchar; 32],
+    rk: *const [c_uchar; 32],
+    zkproof: *const [c_uchar; GROTH_PROOF_SIZE],
+    spend_auth_sig: *const [c_uchar; 64],
+    sighash_value: *const [c_uchar; 32],
+) -> bool {
+    let ctx = unsafe { &mut *ctx };
+
+    let cv = {
+        let cv = ValueCommitment::from_bytes_not_small_order(&(unsafe { *cv }));
+        if cv.is_some().into() {
+            cv.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let anchor = {
+        let anchor = Scalar::from_repr(unsafe { *anchor });
+        if anchor.is_some().into() {
+            anchor.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let rk = match redjubjub::PublicKey::read(&(unsafe { &*rk })[..]) {
+        Ok(p) => p,
+        Err(_) => return false,
+    };
+    if rk.0.is_small_order().into() {
+        return false;
+    }
+
+    let spend_auth_sig = match Signature::read(&(unsafe { &*spend_auth_sig })[..]) {
+        Ok(sig) => sig,
+        Err(_) => return false,
+    };
+
+    let zkproof = match Proof::<Bls12>::read(&(unsafe { &*zkproof })[..]) {
+        Ok(p) => p,
+        Err(_) => return false,
+    };
+
+    // The spend authorization signature is cheap compared to the proof,
+    // check it right away.
+    let mut data_to_be_signed = [0u8; 64];
+    data_to_be_signed[0..32].copy_from_slice(&rk.0.to_bytes());
+    data_to_be_signed[32..64].copy_from_slice(&(unsafe { &*sighash_value })[..]);
+    if !rk.verify_with_zip216(&data_to_be_signed, &spend_auth_sig, SPENDING_KEY_GENERATOR, true) {
+        return false;
+    }
+
+    let public_input = spend_public_input(&rk, cv.as_inner(), anchor, unsafe { &*nullifier });
+
+    ctx.cv_sum += cv.as_inner();
+    ctx.pending_spends.push((zkproof, public_input));
+    true
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validator_check_output(
+    ctx: *mut SaplingBatchValidator,
+    cv: *const [c_uchar; 32],
+    cm: *const [c_uchar; 32],
+    epk: *const [c_uchar; 32],
+    zkproof: *const [c_uchar; GROTH_PROOF_SIZE],
+) -> bool {
+    let ctx = unsafe { &mut *ctx };
+
+    let cv = {
+        let cv = ValueCommitment::from_bytes_not_small_order(&(unsafe { *cv }));
+        if cv.is_some().into() {
+            cv.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let cm = {
+        let cm = Scalar::from_repr(unsafe { *cm });
+        if cm.is_some().into() {
+            cm.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let epk = {
+        let epk = jubjub::SubgroupPoint::from_bytes(&(unsafe { *epk }));
+        if epk.is_some().into() {
+            jubjub::ExtendedPoint::from(epk.unwrap())
+        } else {
+            return false;
+        }
+    };
+    if epk.is_small_order().into() {
+        return false;
+    }
+
+    let zkproof = match Proof::<Bls12>::read(&(unsafe { &*zkproof })[..]) {
+        Ok(p) => p,
+        Err(_) => return false,
+    };
+
+    // Construct the public input of the output circuit
+    let mut public_input = vec![Scalar::ZERO; 5];
+    {
+        let affine = jubjub::AffinePoint::from(*cv.as_inner());
+        public_input[0] = affine.get_u();
+        public_input[1] = affine.get_v();
+    }
+    {
+        let affine = jubjub::AffinePoint::from(epk);
+        public_input[2] = affine.get_u();
+        public_input[3] = affine.get_v();
+    }
+    public_input[4] = cm;
+
+    ctx.cv_sum -= cv.as_inner();
+    ctx.pending_outputs.push((zkproof, public_input));
+    true
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validator_final_check(
+    ctx: *mut SaplingBatchValidator,
+    value_balance: i64,
+    binding_sig: *const [c_uchar; 64],
+    sighash_value: *const [c_uchar; 32],
+) -> bool {
+    let ctx = unsafe { &mut *ctx };
+
+    let value_ok = Amount::from_i64(value_balance).is_ok();
+    let binding_sig = Signature::read(&(unsafe { &*binding_sig })[..]);
+    if !value_ok || binding_sig.is_err() {
+        ctx.discard_pending();
+        return false;
+    }
+
+    // bvk = sum(cv_spends) - sum(cv_outputs) - valueBalance * G_v
+    let mut value = Fr::from(value_balance.unsigned_abs());
+    if value_balance < 0 {
+        value = -value;
+    }
+    let bvk = redjubjub::PublicKey(
+        ctx.cv_sum - jubjub::ExtendedPoint::from(VALUE_COMMITMENT_VALUE_GENERATOR * value),
+    );
+
+    let mut data_to_be_signed = [0u8; 64];
+    data_to_be_signed[0..32].copy_from_slice(&bvk.0.to_bytes());
+    data_to_be_signed[32..64].copy_from_slice(&(unsafe { &*sighash_value })[..]);
+    if !bvk.verify_with_zip216(
+        &data_to_be_signed,
+        &binding_sig.unwrap(),
+        VALUE_COMMITMENT_RANDOMNESS_GENERATOR,
+        true,
+    ) {
+        ctx.discard_pending();
+        return false;
+    }
+
+    // The transaction is well formed: move its proofs to the batch
+    for (proof, inputs) in ctx.pending_spends.drain(..) {
+        ctx.spend_proofs.queue((proof, inputs));
+    }
+    for (proof, inputs) in ctx.pending_outputs.drain(..) {
+        ctx.output_proofs.queue((proof, inputs));
+    }
+    ctx.cv_sum = jubjub::ExtendedPoint::identity();
+    true
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validator_discard(
+    ctx: *mut SaplingBatchValidator,
+) {
+    unsafe { &mut *ctx }.discard_pending();
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_batch_validator_validate(
+    ctx: *mut SaplingBatchValidator,
+) -> bool {
+    let ctx = unsafe { &mut *ctx };
+    ctx.discard_pending();
+
+    let spend_proofs = std::mem::replace(&mut ctx.spend_proofs, groth16::batch::Verifier::new());
+    let output_proofs = std::mem::replace(&mut ctx.output_proofs, groth16::batch::Verifier::new());
+
+    let spend_vk = unsafe { SAPLING_SPEND_BATCH_VK.as_ref() }.unwrap();
+    let output_vk = unsafe { SAPLING_OUTPUT_BATCH_VK.as_ref() }.unwrap();
+
+    spend_proofs.verify(OsRng, spend_vk).is_ok() && output_proofs.verify(OsRng, output_vk).is_ok()
+}
+
 #[no_mangle]
 pub extern "system" fn librustzcash_sprout_prove(
     proof_out: *mut [c_uchar; GROTH_PROOF_SIZE],
@@ -926,7 +1313,7 @@ pub extern "system" fn librustzcash_sapling_output_proof(
         payment_address,
         rcm,
         value,
-        unsafe { SAPLING_OUTPUT_PARAMS.as_ref() }.unwrap(),
+        sapling_output_params(),
     );
 
     // Write the cv out to the caller
@@ -1093,7 +1480,7 @@ pub extern "system" fn librustzcash_sapling_spend_proof(
             value,
             anchor,
             witness,
-            unsafe { SAPLING_SPEND_PARAMS.as_ref() }.unwrap(),
+            sapling_spend_params(),
             unsafe { SAPLING_SPEND_VK.as_ref() }.unwrap(),
         )
         .expect("proving should not fail");
@@ -1125,6 +1512,274 @@ pub extern "system" fn librustzcash_sapling_proving_ctx_free(ctx: *mut SaplingPr
     drop(unsafe { Box::from_raw(ctx) });
 }
 
+/// Reads a value commitment trapdoor provided by the caller
+fn read_rcv(rcv: *const [c_uchar; 32]) -> Option<Fr> {
+    let rcv = Fr::from_repr(unsafe { *rcv });
+    if rcv.is_some().into() {
+        Some(rcv.unwrap())
+    } else {
+        None
+    }
+}
+
+/// cv = [value] G_v + [rcv] G_r
+fn value_commitment(value: u64, rcv: Fr) -> jubjub::ExtendedPoint {
+    jubjub::ExtendedPoint::from(
+        (VALUE_COMMITMENT_VALUE_GENERATOR * Fr::from(value))
+            + (VALUE_COMMITMENT_RANDOMNESS_GENERATOR * rcv),
+    )
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_spend_proof_with_rcv(
+    ak: *const [c_uchar; 32],
+    nsk: *const [c_uchar; 32],
+    diversifier: *const [c_uchar; 11],
+    rcm: *const [c_uchar; 32],
+    ar: *const [c_uchar; 32],
+    value: u64,
+    anchor: *const [c_uchar; 32],
+    witness: *const [c_uchar; 1 + 33 * SAPLING_TREE_DEPTH + 8],
+    rcv: *const [c_uchar; 32],
+    cv: *mut [c_uchar; 32],
+    rk_out: *mut [c_uchar; 32],
+    zkproof: *mut [c_uchar; GROTH_PROOF_SIZE],
+) -> bool {
+    let ak = {
+        let ak = jubjub::SubgroupPoint::from_bytes(&(unsafe { *ak }));
+        if ak.is_some().into() {
+            ak.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let nsk = {
+        let nsk = Fr::from_repr(unsafe { *nsk });
+        if nsk.is_some().into() {
+            nsk.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let proof_generation_key = ProofGenerationKey { ak, nsk };
+
+    let diversifier = Diversifier(unsafe { *diversifier });
+
+    let rcm = {
+        let rcm = Fr::from_repr(unsafe { *rcm });
+        if rcm.is_some().into() {
+            rcm.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let ar = {
+        let ar = Fr::from_repr(unsafe { *ar });
+        if ar.is_some().into() {
+            ar.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let anchor = {
+        let anchor = Scalar::from_bytes(&unsafe { *anchor });
+        if anchor.is_some().into() {
+            anchor.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let witness = match MerklePath::from_slice(unsafe { &(&*witness)[..] }) {
+        Ok(w) => w,
+        Err(_) => return false,
+    };
+
+    let rcv = match read_rcv(rcv) {
+        Some(rcv) => rcv,
+        None => return false,
+    };
+
+    // This mirrors SaplingProvingContext::spend_proof, except for the
+    // trapdoor which is chosen (and summed) by the caller.
+    let viewing_key = proof_generation_key.to_viewing_key();
+    let payment_address = match viewing_key.to_payment_address(diversifier) {
+        Some(pa) => pa,
+        None => return false,
+    };
+    let rk = redjubjub::PublicKey(ak.into()).randomize(ar, SPENDING_KEY_GENERATOR);
+    let note = Note::from_parts(
+        payment_address,
+        NoteValue::from_raw(value),
+        Rseed::BeforeZip212(rcm),
+    );
+    let nullifier = note.nf(&viewing_key.nk, witness.position);
+    let value_commitment = value_commitment(value, rcv);
+
+    let instance = sapling_circuit::Spend {
+        value_commitment_opening: Some(sapling_circuit::ValueCommitmentOpening {
+            value,
+            randomness: rcv,
+        }),
+        proof_generation_key: Some(proof_generation_key),
+        payment_address: Some(payment_address),
+        commitment_randomness: Some(rcm),
+        ar: Some(ar),
+        auth_path: witness
+            .auth_path
+            .iter()
+            .map(|(node, b)| Some(((*node).into(), *b)))
+            .collect(),
+        anchor: Some(anchor),
+    };
+    let spend_params = sapling_spend_params();
+    let proof = match create_random_proof(instance, spend_params, &mut OsRng) {
+        Ok(p) => p,
+        Err(_) => return false,
+    };
+
+    // Check the proof, as the proving context does
+    let public_input = spend_public_input(&rk, &value_commitment, anchor, &nullifier.0);
+    if verify_proof(
+        unsafe { SAPLING_SPEND_VK.as_ref() }.unwrap(),
+        &proof,
+        &public_input[..],
+    )
+    .is_err()
+    {
+        return false;
+    }
+
+    *unsafe { &mut *cv } = value_commitment.to_bytes();
+
+    proof
+        .write(&mut (unsafe { &mut *zkproof })[..])
+        .expect("should be able to serialize a proof");
+
+    rk.write(&mut unsafe { &mut *rk_out }[..])
+        .expect("should be able to write to rk_out");
+
+    true
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_output_proof_with_rcv(
+    esk: *const [c_uchar; 32],
+    payment_address: *const [c_uchar; 43],
+    rcm: *const [c_uchar; 32],
+    value: u64,
+    rcv: *const [c_uchar; 32],
+    cv: *mut [c_uchar; 32],
+    zkproof: *mut [c_uchar; GROTH_PROOF_SIZE],
+) -> bool {
+    let esk = {
+        let esk = Fr::from_repr(unsafe { *esk });
+        if esk.is_some().into() {
+            esk.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let payment_address = match PaymentAddress::from_bytes(unsafe { &*payment_address }) {
+        Some(pa) => pa,
+        None => return false,
+    };
+
+    let rcm = {
+        let rcm = Fr::from_repr(unsafe { *rcm });
+        if rcm.is_some().into() {
+            rcm.unwrap()
+        } else {
+            return false;
+        }
+    };
+
+    let rcv = match read_rcv(rcv) {
+        Some(rcv) => rcv,
+        None => return false,
+    };
+
+    // This mirrors SaplingProvingContext::output_proof
+    let instance = sapling_circuit::Output {
+        value_commitment_opening: Some(sapling_circuit::ValueCommitmentOpening {
+            value,
+            randomness: rcv,
+        }),
+        payment_address: Some(payment_address),
+        commitment_randomness: Some(rcm),
+        esk: Some(esk),
+    };
+    let output_params = sapling_output_params();
+    let proof = match create_random_proof(instance, output_params, &mut OsRng) {
+        Ok(p) => p,
+        Err(_) => return false,
+    };
+
+    *unsafe { &mut *cv } = value_commitment(value, rcv).to_bytes();
+
+    proof
+        .write(&mut (unsafe { &mut *zkproof })[..])
+        .expect("should be able to serialize a proof");
+
+    true
+}
+
+#[no_mangle]
+pub extern "system" fn librustzcash_sapling_binding_sig_with_rcvs(
+    spend_rcvs: *const [c_uchar; 32],
+    spends_len: size_t,
+    output_rcvs: *const [c_uchar; 32],
+    outputs_len: size_t,
+    value_balance: i64,
+    sighash: *const [c_uchar; 32],
+    result: *mut [c_uchar; 64],
+) -> bool {
+    if Amount::from_i64(value_balance).is_err() {
+        return false;
+    }
+
+    // bsk = sum(rcv_spends) - sum(rcv_outputs)
+    let mut bsk = Fr::ZERO;
+    if spends_len > 0 {
+        for rcv in unsafe { slice::from_raw_parts(spend_rcvs, spends_len) } {
+            match read_rcv(rcv) {
+                Some(rcv) => bsk += rcv,
+                None => return false,
+            }
+        }
+    }
+    if outputs_len > 0 {
+        for rcv in unsafe { slice::from_raw_parts(output_rcvs, outputs_len) } {
+            match read_rcv(rcv) {
+                Some(rcv) => bsk -= rcv,
+                None => return false,
+            }
+        }
+    }
+
+    let bsk = redjubjub::PrivateKey(bsk);
+    let bvk = redjubjub::PublicKey::from_private(&bsk, VALUE_COMMITMENT_RANDOMNESS_GENERATOR);
+
+    let mut data_to_be_signed = [0u8; 64];
+    data_to_be_signed[0..32].copy_from_slice(&bvk.0.to_bytes());
+    data_to_be_signed[32..64].copy_from_slice(&(unsafe { &*sighash })[..]);
+
+    let sig = bsk.sign(
+        &data_to_be_signed,
+        &mut OsRng,
+        VALUE_COMMITMENT_RANDOMNESS_GENERATOR,
+    );
+    sig.write(&mut (unsafe { &mut *result })[..])
+        .expect("result should be 64 bytes");
+
+    true
+}
+
 #[no_mangle]
 pub extern "system" fn librustzcash_zip32_xsk_master(
     seed: *const c_uchar,
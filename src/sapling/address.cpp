@@ -21,9 +21,9 @@ namespace libzcash {
 
 //! Sapling
 uint256 SaplingPaymentAddress::GetHash() const {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    CHashWriter ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << *this;
-    return Hash(ss.begin(), ss.end());
+    return ss.GetHash();
 }
 
 SaplingFullViewingKey SaplingExpandedSpendingKey::full_viewing_key() const {
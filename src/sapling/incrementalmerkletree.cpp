@@ -925,6 +925,8 @@ void IncrementalMerkleTree<Depth, Hash>::append(Hash obj) {
         throw std::runtime_error("tree is full");
     }
 
+    cachedRoot = nullopt;
+
     if (!left) {
         // Set the left leaf
         left = obj;
@@ -1019,6 +1021,11 @@ size_t IncrementalMerkleTree<Depth, Hash>::next_depth(size_t skip) const {
 template<size_t Depth, typename Hash>
 Hash IncrementalMerkleTree<Depth, Hash>::root(size_t depth,
                                               std::deque<Hash> filler_hashes) const {
+    const bool fCacheable = filler_hashes.empty();
+    if (fCacheable && cachedRoot && cachedRoot->first == depth) {
+        return cachedRoot->second;
+    }
+
     PathFiller<Depth, Hash> filler(filler_hashes);
 
     Hash combine_left =  left  ? *left  : filler.next(0);
@@ -1045,6 +1052,9 @@ Hash IncrementalMerkleTree<Depth, Hash>::root(size_t depth,
         d++;
     }
 
+    if (fCacheable) {
+        cachedRoot = std::make_pair(depth, root);
+    }
     return root;
 }
 
@@ -1115,6 +1125,8 @@ std::deque<Hash> IncrementalWitness<Depth, Hash>::partial_path() const {
 
 template<size_t Depth, typename Hash>
 void IncrementalWitness<Depth, Hash>::append(Hash obj) {
+    cachedRoot = nullopt;
+
     if (cursor) {
         cursor->append(obj);
 
@@ -1138,6 +1150,96 @@ void IncrementalWitness<Depth, Hash>::append(Hash obj) {
     }
 }
 
+template<size_t Depth, typename Hash>
+uint64_t IncrementalWitness<Depth, Hash>::next_position() const {
+    uint64_t next = tree.size();
+    // filled[i] is the root of a complete subtree of depth next_depth(i)
+    for (size_t i = 0; i < filled.size(); i++) {
+        next += (uint64_t)1 << tree.next_depth(i);
+    }
+    if (cursor) {
+        next += cursor->size();
+    }
+    return next;
+}
+
+template<size_t Depth, typename Hash>
+void IncrementalWitness<Depth, Hash>::append(IncrementalMerkleBatch<Depth, Hash>& batch) {
+    const uint64_t next = next_position();
+    if (next < batch.firstPosition) {
+        throw std::runtime_error("witness is behind the batch");
+    }
+    if (next - batch.firstPosition >= batch.leaves.size()) {
+        return;
+    }
+    cachedRoot = nullopt;
+
+    size_t i = next - batch.firstPosition;
+    while (i < batch.leaves.size()) {
+        if (!cursor) {
+            cursor_depth = tree.next_depth(filled.size());
+
+            if (cursor_depth >= Depth) {
+                throw std::runtime_error("tree is full");
+            }
+
+            // The whole subtree is in the batch: take its (shared) root
+            const size_t span = (size_t)1 << cursor_depth;
+            if (batch.leaves.size() - i >= span) {
+                filled.push_back(batch.subtree_root(cursor_depth, i));
+                i += span;
+                continue;
+            }
+        }
+
+        // Advance the cursor, which ends either completed or with the batch.
+        // Witnesses with the same cursor at the same offset end up in the same state.
+        const auto key = std::make_tuple(i, cursor_depth, (uint64_t)(cursor ? cursor->size() : 0));
+        auto it = batch.cursors.find(key);
+        if (it == batch.cursors.end()) {
+            typename IncrementalMerkleBatch<Depth, Hash>::CursorState state;
+            IncrementalMerkleTree<Depth, Hash> c = cursor ? *cursor : IncrementalMerkleTree<Depth, Hash>();
+            size_t j = i;
+            while (j < batch.leaves.size()) {
+                c.append(batch.leaves[j++]);
+                if (c.is_complete(cursor_depth)) {
+                    state.root = c.root(cursor_depth);
+                    break;
+                }
+            }
+            state.end = j;
+            if (!state.root) {
+                state.cursor = c;
+            }
+            it = batch.cursors.emplace(key, std::move(state)).first;
+        }
+        const auto& state = it->second;
+        if (state.root) {
+            filled.push_back(*state.root);
+            cursor = nullopt;
+        } else {
+            cursor = state.cursor;
+        }
+        i = state.end;
+    }
+}
+
+template<size_t Depth, typename Hash>
+Hash IncrementalMerkleBatch<Depth, Hash>::subtree_root(size_t depth, size_t offset) {
+    if (depth == 0) {
+        return leaves[offset];
+    }
+    const auto key = std::make_pair(depth, offset);
+    auto it = subtreeRoots.find(key);
+    if (it != subtreeRoots.end()) {
+        return it->second;
+    }
+    const size_t half = (size_t)1 << (depth - 1);
+    Hash root = Hash::combine(subtree_root(depth - 1, offset), subtree_root(depth - 1, offset + half), depth - 1);
+    subtreeRoots.emplace(key, root);
+    return root;
+}
+
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
 template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
 
@@ -1150,4 +1252,9 @@ template class IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, Pede
 template class IncrementalWitness<SAPLING_INCREMENTAL_MERKLE_TREE_DEPTH, PedersenHash>;
 template class IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, PedersenHash>;
 
+template class IncrementalMerkleBatch<INCREMENTAL_MERKLE_TREE_DEPTH, SHA256Compress>;
+template class IncrementalMerkleBatch<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, SHA256Compress>;
+template class IncrementalMerkleBatch<SAPLING_INCREMENTAL_MERKLE_TREE_DEPTH, PedersenHash>;
+template class IncrementalMerkleBatch<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, PedersenHash>;
+
 } // end namespace `libzcash`
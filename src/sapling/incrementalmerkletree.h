@@ -15,6 +15,8 @@
 
 #include <array>
 #include <deque>
+#include <map>
+#include <tuple>
 
 namespace libzcash {
 
@@ -115,6 +117,7 @@ public:
     SERIALIZE_METHODS(IncrementalMerkleTree, obj)
     {
         READWRITE(obj.left, obj.right, obj.parents);
+        SER_READ(obj, obj.cachedRoot = nullopt);
         obj.wfcheck();
     }
 
@@ -133,6 +136,9 @@ private:
 
     // Collapsed "left" subtrees ordered toward the root of the tree.
     std::vector<Optional<Hash>> parents;
+    // Last (depth, root) computed without filler hashes, reset by append().
+    // Saves the Depth hashes of root() when it is queried again on the same tree.
+    mutable Optional<std::pair<size_t, Hash>> cachedRoot;
     MerklePath path(std::deque<Hash> filler_hashes = std::deque<Hash>()) const;
     Hash root(size_t depth, std::deque<Hash> filler_hashes = std::deque<Hash>()) const;
     bool is_complete(size_t depth = Depth) const;
@@ -149,6 +155,45 @@ bool operator==(const IncrementalMerkleTree<Depth, Hash>& a,
             a.parents == b.parents);
 }
 
+/**
+ * A run of leaves (e.g. the note commitments of one or more blocks) appended at
+ * once to many witnesses of the same tree.
+ * Every witness needs the same subtree roots and builds the same cursors on top
+ * of these leaves, so they are hashed once here and shared by all the witnesses,
+ * instead of appending each leaf to each witness.
+ * Not thread safe: a batch is meant to be used by a single thread.
+ */
+template <size_t Depth, typename Hash>
+class IncrementalMerkleBatch {
+friend class IncrementalWitness<Depth, Hash>;
+
+public:
+    // Leaves appended to the tree, the first one at position firstPosition
+    IncrementalMerkleBatch(std::vector<Hash> _leaves, uint64_t _firstPosition) :
+        leaves(std::move(_leaves)), firstPosition(_firstPosition) {}
+
+    size_t size() const { return leaves.size(); }
+    uint64_t first_position() const { return firstPosition; }
+
+private:
+    // What a cursor becomes after consuming the batch from a given offset:
+    // either a completed subtree root, or a partial subtree.
+    struct CursorState {
+        size_t end;
+        Optional<Hash> root;
+        Optional<IncrementalMerkleTree<Depth, Hash>> cursor;
+    };
+
+    std::vector<Hash> leaves;
+    uint64_t firstPosition;
+    // Roots of the complete subtrees made of batch leaves, by (depth, offset)
+    std::map<std::pair<size_t, size_t>, Hash> subtreeRoots;
+    // Shared cursor updates, by (offset, cursor depth, cursor size)
+    std::map<std::tuple<size_t, size_t, uint64_t>, CursorState> cursors;
+
+    Hash subtree_root(size_t depth, size_t offset);
+};
+
 template <size_t Depth, typename Hash>
 class IncrementalWitness {
 friend class IncrementalMerkleTree<Depth, Hash>;
@@ -172,15 +217,22 @@ public:
     }
 
     Hash root() const {
-        return tree.root(Depth, partial_path());
+        if (!cachedRoot) {
+            cachedRoot = tree.root(Depth, partial_path());
+        }
+        return *cachedRoot;
     }
 
     void append(Hash obj);
 
+    // Append the batch leaves that come after the witnessed element
+    void append(IncrementalMerkleBatch<Depth, Hash>& batch);
+
     SERIALIZE_METHODS(IncrementalWitness, obj)
     {
         READWRITE(obj.tree, obj.filled, obj.cursor);
         SER_READ(obj, obj.cursor_depth = obj.tree.next_depth(obj.filled.size()));
+        SER_READ(obj, obj.cachedRoot = nullopt);
     }
 
     template <size_t D, typename H>
@@ -192,7 +244,10 @@ private:
     std::vector<Hash> filled;
     Optional<IncrementalMerkleTree<Depth, Hash>> cursor;
     size_t cursor_depth = 0;
+    // Root of the witness, reset by append()
+    mutable Optional<Hash> cachedRoot;
     std::deque<Hash> partial_path() const;
+    uint64_t next_position() const;
     IncrementalWitness(IncrementalMerkleTree<Depth, Hash> tree) : tree(tree) {}
 };
 
@@ -248,4 +303,7 @@ typedef libzcash::IncrementalMerkleTree<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, l
 typedef libzcash::IncrementalWitness<SAPLING_INCREMENTAL_MERKLE_TREE_DEPTH, libzcash::PedersenHash> SaplingWitness;
 typedef libzcash::IncrementalWitness<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, libzcash::PedersenHash> SaplingTestingWitness;
 
+typedef libzcash::IncrementalMerkleBatch<SAPLING_INCREMENTAL_MERKLE_TREE_DEPTH, libzcash::PedersenHash> SaplingMerkleBatch;
+typedef libzcash::IncrementalMerkleBatch<INCREMENTAL_MERKLE_TREE_DEPTH_TESTING, libzcash::PedersenHash> SaplingTestingMerkleBatch;
+
 #endif /* INCREMENTALMERKLETREE_H_ */
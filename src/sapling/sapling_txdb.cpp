@@ -4,11 +4,124 @@
 
 #include "txdb.h"
 
+#include "hash.h"
+#include "random.h"
+#include "util/system.h"
+#include "utiltime.h"
+
 // Db keys
 static const char DB_SAPLING_ANCHOR = 'Z';
 static const char DB_SAPLING_NULLIFIER = 'S';
 static const char DB_BEST_SAPLING_ANCHOR = 'z';
 
+CSaplingNullifierFilter::CSaplingNullifierFilter() :
+    k0(GetRand(std::numeric_limits<uint64_t>::max())),
+    k1(GetRand(std::numeric_limits<uint64_t>::max()))
+{}
+
+void CSaplingNullifierFilter::Reset(size_t nCapacityIn, size_t nMaxBytes)
+{
+    const size_t nMaxWords = std::max((size_t)1, nMaxBytes / sizeof(uint64_t));
+    const size_t nWords = std::min(nMaxWords, std::max((size_t)1, (nCapacityIn * BITS_PER_ELEMENT + 63) / 64));
+    vData.assign(nWords, 0);
+    nCapacity = nWords * 64 / BITS_PER_ELEMENT;
+    fMaxSize = nWords == nMaxWords;
+    nElements = 0;
+    fLoaded = false;
+}
+
+void CSaplingNullifierFilter::insert(const uint256& nf)
+{
+    if (vData.empty()) return;
+    const uint64_t nBits = vData.size() * 64;
+    const uint64_t h1 = SipHashUint256(k0, k1, nf);
+    const uint64_t h2 = SipHashUint256(k1, k0, nf) | 1;
+    for (unsigned int i = 0; i < HASH_FUNCS; i++) {
+        const uint64_t bit = (h1 + i * h2) % nBits;
+        vData[bit >> 6] |= (uint64_t)1 << (bit & 63);
+    }
+    nElements++;
+}
+
+bool CSaplingNullifierFilter::contains(const uint256& nf) const
+{
+    if (vData.empty()) return true;
+    const uint64_t nBits = vData.size() * 64;
+    const uint64_t h1 = SipHashUint256(k0, k1, nf);
+    const uint64_t h2 = SipHashUint256(k1, k0, nf) | 1;
+    for (unsigned int i = 0; i < HASH_FUNCS; i++) {
+        const uint64_t bit = (h1 + i * h2) % nBits;
+        if (!(vData[bit >> 6] & ((uint64_t)1 << (bit & 63)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t CSaplingNullifierFilter::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(vData);
+}
+
+void CCoinsViewDB::LoadNullifiersFilter(size_t nNew)
+{
+    const int64_t nStart = GetTimeMillis();
+    nullifiersFilter.SetLoaded(false);
+
+    // Count the nullifiers first, to size the filter.
+    size_t nCount = 0;
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_SAPLING_NULLIFIER, UINT256_ZERO));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_SAPLING_NULLIFIER) break;
+        nCount++;
+    }
+    // Leave room to grow, so that the filter is not rebuilt too often
+    nullifiersFilter.Reset(std::max((size_t)1 << 16, 2 * (nCount + nNew)), nSaplingCacheSize / 4 * 3);
+
+    pcursor->Seek(std::make_pair(DB_SAPLING_NULLIFIER, UINT256_ZERO));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_SAPLING_NULLIFIER) break;
+        nullifiersFilter.insert(key.second);
+    }
+    nullifiersFilter.SetLoaded(true);
+    LogPrint(BCLog::COINDB, "Loaded %u Sapling nullifiers into a %.1f KiB filter in %dms\n",
+             (unsigned int) nullifiersFilter.size(), nullifiersFilter.DynamicMemoryUsage() * (1.0 / 1024), GetTimeMillis() - nStart);
+}
+
+size_t CCoinsViewDB::SaplingCacheUsage() const
+{
+    return nullifiersFilter.DynamicMemoryUsage() + anchorsCache.size() * SAPLING_ANCHOR_CACHE_ENTRY_USAGE;
+}
+
+bool CCoinsViewDB::ForEachSaplingNullifier(const std::function<void(const uint256&)>& func) const
+{
+    std::unique_ptr<CDBIterator> pcursor(const_cast<CDBWrapper&>(db).NewIterator());
+    for (pcursor->Seek(std::make_pair(DB_SAPLING_NULLIFIER, UINT256_ZERO)); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_SAPLING_NULLIFIER) break;
+        func(key.second);
+    }
+    return true;
+}
+
+bool CCoinsViewDB::ForEachSaplingAnchor(const std::function<void(const uint256&, const SaplingMerkleTree&)>& func) const
+{
+    std::unique_ptr<CDBIterator> pcursor(const_cast<CDBWrapper&>(db).NewIterator());
+    for (pcursor->Seek(std::make_pair(DB_SAPLING_ANCHOR, UINT256_ZERO)); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_SAPLING_ANCHOR) break;
+        SaplingMerkleTree tree;
+        if (!pcursor->GetValue(tree)) {
+            return error("%s: unable to read the anchor %s", __func__, key.second.ToString());
+        }
+        func(key.second, tree);
+    }
+    return true;
+}
+
 // Sapling
 bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const {
     if (rt == SaplingMerkleTree::empty_root()) {
@@ -17,12 +130,23 @@ bool CCoinsViewDB::GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree
         return true;
     }
 
+    if (nSaplingCacheSize > 0 && anchorsCache.get(rt, tree)) {
+        return true;
+    }
+
     bool read = db.Read(std::make_pair(DB_SAPLING_ANCHOR, rt), tree);
+    if (read && nSaplingCacheSize > 0) {
+        anchorsCache.insert(rt, tree);
+    }
 
     return read;
 }
 
 bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
+    // Most nullifiers looked up are not spent: skip the disk for them
+    if (nullifiersFilter.IsLoaded() && !nullifiersFilter.contains(nf)) {
+        return false;
+    }
     bool spent = false;
     return db.Read(std::make_pair(DB_SAPLING_NULLIFIER, nf), spent);
 }
@@ -81,6 +205,32 @@ bool CCoinsViewDB::BatchWriteSapling(const uint256& hashSaplingAnchor,
                               CNullifiersMap& mapSaplingNullifiers,
                               CDBBatch& batch) {
 
+    if (nSaplingCacheSize > 0) {
+        // Keep the lookup caches in sync with what is about to be written
+        for (const auto& it : mapSaplingAnchors) {
+            if (!(it.second.flags & CAnchorsSaplingCacheEntry::DIRTY)) continue;
+            if (it.second.entered) {
+                anchorsCache.insert(it.first, it.second.tree);
+            } else {
+                anchorsCache.erase(it.first);
+            }
+        }
+        if (nullifiersFilter.IsLoaded()) {
+            std::vector<uint256> vNew;
+            for (const auto& it : mapSaplingNullifiers) {
+                if ((it.second.flags & CNullifiersCacheEntry::DIRTY) && it.second.entered) {
+                    vNew.emplace_back(it.first);
+                }
+            }
+            if (nullifiersFilter.NeedsResize(vNew.size())) {
+                LoadNullifiersFilter(vNew.size());
+            }
+            for (const uint256& nf : vNew) {
+                nullifiersFilter.insert(nf);
+            }
+        }
+    }
+
     ::BatchWriteAnchors<CAnchorsSaplingMap, CAnchorsSaplingMap::iterator, CAnchorsSaplingCacheEntry, SaplingMerkleTree>(batch, mapSaplingAnchors, DB_SAPLING_ANCHOR);
     ::BatchWriteNullifiers(batch, mapSaplingNullifiers, DB_SAPLING_NULLIFIER);
     if (!hashSaplingAnchor.IsNull())
@@ -10,11 +10,122 @@
 #include "consensus/validation.h" // for CValidationState
 #include "util/system.h" // for error()
 #include "consensus/upgrades.h" // for CurrentEpochBranchId()
+#include "crypto/sha256.h"
+#include "script/sigcache.h" // for CVerifiedResultCache
 
 #include <librustzcash.h>
 
 namespace SaplingValidation {
 
+namespace {
+/**
+ * Valid Sapling proofs cache, keyed by transaction (the spend, output and binding signatures, and the
+ * proofs, are verified together).
+ * Entries are SHA256(nonce || txid || shielded signature hash).
+ */
+CVerifiedResultCache proofCache("Sapling proof", "maxsaplingproofcachesize", DEFAULT_MAX_SAPLING_PROOF_CACHE_SIZE, MAX_MAX_SAPLING_PROOF_CACHE_SIZE);
+
+void ComputeEntry(uint256& entry, const uint256& txid, const uint256& sighash)
+{
+    CSHA256().Write(proofCache.GetNonce().begin(), 32).Write(txid.begin(), 32).Write(sighash.begin(), 32).Finalize(entry.begin());
+}
+} // anon namespace
+
+// Signature hash of the shielded part of the transaction (empty script code, not an input)
+static bool GetShieldedSighash(const CTransaction& tx, uint256& hashRet)
+{
+    CScript scriptCode;
+    try {
+        hashRet = SignatureHash(scriptCode, tx, NOT_AN_INPUT, SIGHASH_ALL, 0, SIGVERSION_SAPLING);
+    } catch (const std::logic_error& ex) {
+        // A logic error should never occur because we pass NOT_AN_INPUT and
+        // SIGHASH_ALL to SignatureHash().
+        return false;
+    }
+    return true;
+}
+
+BatchValidator::BatchValidator(bool fCacheStoreIn) :
+    ctx(librustzcash_sapling_batch_validator_init()),
+    fCacheStore(fCacheStoreIn)
+{}
+
+BatchValidator::~BatchValidator()
+{
+    librustzcash_sapling_batch_validator_free(ctx);
+}
+
+bool BatchValidator::Add(const CTransaction& tx, bool fEraseCached)
+{
+    assert(tx.sapData);
+    uint256 sighash;
+    if (!GetShieldedSighash(tx, sighash)) {
+        return false;
+    }
+
+    uint256 entry;
+    ComputeEntry(entry, tx.GetHash(), sighash);
+    if (proofCache.Get(entry, fEraseCached)) {
+        return true;
+    }
+
+    for (const SpendDescription& spend : tx.sapData->vShieldedSpend) {
+        if (!librustzcash_sapling_batch_validator_check_spend(
+                ctx,
+                spend.cv.begin(),
+                spend.anchor.begin(),
+                spend.nullifier.begin(),
+                spend.rk.begin(),
+                spend.zkproof.begin(),
+                spend.spendAuthSig.begin(),
+                sighash.begin())) {
+            librustzcash_sapling_batch_validator_discard(ctx);
+            return false;
+        }
+    }
+
+    for (const OutputDescription& output : tx.sapData->vShieldedOutput) {
+        if (!librustzcash_sapling_batch_validator_check_output(
+                ctx,
+                output.cv.begin(),
+                output.cmu.begin(),
+                output.ephemeralKey.begin(),
+                output.zkproof.begin())) {
+            librustzcash_sapling_batch_validator_discard(ctx);
+            return false;
+        }
+    }
+
+    // On failure, the pending descriptions are discarded by the final check itself
+    if (!librustzcash_sapling_batch_validator_final_check(
+            ctx,
+            tx.sapData->valueBalance,
+            tx.sapData->bindingSig.begin(),
+            sighash.begin())) {
+        return false;
+    }
+
+    nQueuedTxes++;
+    if (fCacheStore) vQueuedEntries.emplace_back(entry);
+    return true;
+}
+
+bool BatchValidator::Validate()
+{
+    if (nQueuedTxes == 0) {
+        return true;
+    }
+    nQueuedTxes = 0;
+    const int64_t nStart = GetTimeMicros();
+    const bool fValid = librustzcash_sapling_batch_validator_validate(ctx);
+    nValidateMicros += GetTimeMicros() - nStart;
+    if (fValid) {
+        for (uint256& entry : vQueuedEntries) proofCache.Set(entry);
+    }
+    vQueuedEntries.clear();
+    return fValid;
+}
+
 // Verifies that Shielded txs are properly formed and performs content-independent checks
 bool CheckTransaction(const CTransaction& tx, CValidationState& state, CAmount& nValueOut)
 {
@@ -116,7 +227,8 @@ bool ContextualCheckTransaction(
         const CChainParams& chainparams,
         const int nHeight,
         const bool isMined,
-        bool isInitBlockDownload)
+        bool isInitBlockDownload,
+        bool fCheckProofs)
 {
     const int DOS_LEVEL_BLOCK = 100;
     // DoS level set to 10 to be more forgiving.
@@ -159,77 +271,86 @@ bool ContextualCheckTransaction(
     }
 
     if (hasShieldedData) {
-        uint256 dataToBeSigned;
-
         if (tx.HasExchangeAddr() && Params().GetConsensus().NetworkUpgradeActive(nHeight, Consensus::UPGRADE_V5_6)) {
             return state.DoS(100, error("%s: Sapling version with invalid data", __func__),
                 REJECT_INVALID, "bad-txns-exchange-addr-has-sapling");
         }
 
-        // Empty output script.
-        CScript scriptCode;
-        try {
-            dataToBeSigned = SignatureHash(scriptCode, tx, NOT_AN_INPUT, SIGHASH_ALL, 0, SIGVERSION_SAPLING);
-        } catch (const std::logic_error& ex) {
-            // A logic error should never occur because we pass NOT_AN_INPUT and
-            // SIGHASH_ALL to SignatureHash().
-            return state.DoS(100, error("%s: error computing signature hash", __func__ ),
-                             REJECT_INVALID, "error-computing-signature-hash");
+        if (fCheckProofs && !CheckTransactionProofs(tx, state, dosLevelPotentiallyRelaxing, !isMined)) {
+            return false; // Failure reason has been set in validation state object
         }
+    }
+    return true;
+}
 
-        // Sapling verification process
-        auto ctx = librustzcash_sapling_verification_ctx_init();
-
-        for (const SpendDescription &spend : tx.sapData->vShieldedSpend) {
-            if (!librustzcash_sapling_check_spend(
-                    ctx,
-                    spend.cv.begin(),
-                    spend.anchor.begin(),
-                    spend.nullifier.begin(),
-                    spend.rk.begin(),
-                    spend.zkproof.begin(),
-                    spend.spendAuthSig.begin(),
-                    dataToBeSigned.begin())) {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(
-                        dosLevelPotentiallyRelaxing,
-                        error("%s: Sapling spend description invalid", __func__ ),
-                        REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
-            }
-        }
+bool CheckTransactionProofs(const CTransaction& tx, CValidationState& state, int nDoSRelaxing, bool fCacheStore)
+{
+    uint256 dataToBeSigned;
+    if (!GetShieldedSighash(tx, dataToBeSigned)) {
+        return state.DoS(100, error("%s: error computing signature hash", __func__ ),
+                         REJECT_INVALID, "error-computing-signature-hash");
+    }
 
-        for (const OutputDescription &output : tx.sapData->vShieldedOutput) {
-            if (!librustzcash_sapling_check_output(
-                    ctx,
-                    output.cv.begin(),
-                    output.cmu.begin(),
-                    output.ephemeralKey.begin(),
-                    output.zkproof.begin())) {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                // This should be a non-contextual check, but we check it here
-                // as we need to pass over the outputs anyway in order to then
-                // call librustzcash_sapling_final_check().
-                return state.DoS(100, error("%s: Sapling output description invalid", __func__ ),
-                                 REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
-            }
-        }
+    uint256 entry;
+    ComputeEntry(entry, tx.GetHash(), dataToBeSigned);
+    if (proofCache.Get(entry, false)) {
+        return true;
+    }
+
+    // Sapling verification process
+    auto ctx = librustzcash_sapling_verification_ctx_init();
 
-        if (!librustzcash_sapling_final_check(
+    for (const SpendDescription &spend : tx.sapData->vShieldedSpend) {
+        if (!librustzcash_sapling_check_spend(
                 ctx,
-                tx.sapData->valueBalance,
-                tx.sapData->bindingSig.begin(),
+                spend.cv.begin(),
+                spend.anchor.begin(),
+                spend.nullifier.begin(),
+                spend.rk.begin(),
+                spend.zkproof.begin(),
+                spend.spendAuthSig.begin(),
                 dataToBeSigned.begin())) {
             librustzcash_sapling_verification_ctx_free(ctx);
             return state.DoS(
-                    dosLevelPotentiallyRelaxing,
-                    error("%s: Sapling binding signature invalid", __func__ ),
-                    REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+                    nDoSRelaxing,
+                    error("%s: Sapling spend description invalid", __func__ ),
+                    REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
         }
+    }
 
+    for (const OutputDescription &output : tx.sapData->vShieldedOutput) {
+        if (!librustzcash_sapling_check_output(
+                ctx,
+                output.cv.begin(),
+                output.cmu.begin(),
+                output.ephemeralKey.begin(),
+                output.zkproof.begin())) {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            // This should be a non-contextual check, but we check it here
+            // as we need to pass over the outputs anyway in order to then
+            // call librustzcash_sapling_final_check().
+            return state.DoS(100, error("%s: Sapling output description invalid", __func__ ),
+                             REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
+        }
+    }
+
+    if (!librustzcash_sapling_final_check(
+            ctx,
+            tx.sapData->valueBalance,
+            tx.sapData->bindingSig.begin(),
+            dataToBeSigned.begin())) {
         librustzcash_sapling_verification_ctx_free(ctx);
+        return state.DoS(
+                nDoSRelaxing,
+                error("%s: Sapling binding signature invalid", __func__ ),
+                REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+    }
+
+    librustzcash_sapling_verification_ctx_free(ctx);
+    if (fCacheStore) {
+        proofCache.Set(entry);
     }
     return true;
 }
 
-
 } // End SaplingValidation namespace
@@ -11,8 +11,45 @@
 class CTransaction;
 class CValidationState;
 
+// Default and maximum size of the Sapling proof cache, in MiB
+static const unsigned int DEFAULT_MAX_SAPLING_PROOF_CACHE_SIZE = 4;
+static const int64_t MAX_MAX_SAPLING_PROOF_CACHE_SIZE = 1024;
+
 namespace SaplingValidation {
 
+/**
+ * Collects the spend and output proofs of several transactions so that they
+ * can be verified together with a single randomized batch check.
+ * Signatures are verified right away when a transaction is added, only the
+ * (expensive) Groth16 proofs are deferred to Validate().
+ */
+class BatchValidator
+{
+private:
+    void* ctx;
+    size_t nQueuedTxes{0};
+    int64_t nValidateMicros{0};
+    // Proof cache entries of the queued txes, stored by Validate() on success (if fCacheStore)
+    bool fCacheStore{false};
+    std::vector<uint256> vQueuedEntries;
+
+public:
+    explicit BatchValidator(bool fCacheStoreIn = false);
+    ~BatchValidator();
+    BatchValidator(const BatchValidator&) = delete;
+    BatchValidator& operator=(const BatchValidator&) = delete;
+
+    // Checks the signatures of the shielded tx and queues its proofs, unless the tx
+    // is found in the proof cache (then the entry is removed from it if fEraseCached).
+    // Returns false (queuing nothing) if the tx could not be added.
+    bool Add(const CTransaction& tx, bool fEraseCached = false);
+    // Verifies every queued proof, emptying the queue.
+    bool Validate();
+    size_t Size() const { return nQueuedTxes; }
+    // Time spent verifying the proofs, in microseconds
+    int64_t GetValidateMicros() const { return nValidateMicros; }
+};
+
 /** Context-independent validity checks */
 // Note: for v3+, if the tx has no shielded data, this method returns true.
 // Note2: This function only performs shielded data related checks, it does NOT checks regular inputs and outputs.
@@ -21,9 +58,17 @@ bool CheckTransactionWithoutProofVerification(const CTransaction& tx, CValidatio
 
 /** Check a transaction contextually against a set of consensus rules */
 // Note: if v5 upgrade wasn't enforced, this method returns true without performing any check.
+// Note2: if fCheckProofs is false, signatures and proofs are not verified here.
+// When verified for a non-mined tx, the result is stored in the proof cache.
+// The caller must then run CheckTransactionProofs or a BatchValidator on the tx.
 bool ContextualCheckTransaction(const CTransaction &tx, CValidationState &state,
                                 const CChainParams &chainparams, int nHeight, bool isMined,
-                                bool sInitBlockDownload);
+                                bool sInitBlockDownload, bool fCheckProofs = true);
+
+/** Verify the proofs and the signatures of a shielded transaction */
+// nDoSRelaxing is the DoS score for failures of rules that might be relaxed in the future.
+// The proof cache is consulted first; valid txes are added to it if fCacheStore.
+bool CheckTransactionProofs(const CTransaction& tx, CValidationState& state, int nDoSRelaxing, bool fCacheStore = false);
 
 }; // End SaplingValidation namespace
 
@@ -9,7 +9,10 @@
 #include "primitives/transaction.h"
 #include "consensus/params.h"
 #include "primitives/block.h"
+#include "ctpl_stl.h"
 #include "sapling/incrementalmerkletree.h"
+#include "sapling/transaction_builder.h"
+#include "sapling/trialdecryption.h"
 #include "uint256.h"
 #include "validation.h" // for ReadBlockFromDisk()
 #include "wallet/wallet.h"
@@ -158,7 +161,7 @@ void CopyPreviousWitnesses(NoteDataMap& noteDataMap, int indexHeight, int64_t nW
     }
 }
 
-void AppendNoteCommitment(SaplingNoteData* nd, int indexHeight, int64_t nWitnessCacheSize, const uint256& note_commitment)
+void AppendNoteCommitments(SaplingNoteData* nd, int indexHeight, int64_t nWitnessCacheSize, SaplingMerkleBatch& batch)
 {
     // skip externally sent notes
     if (!nd->IsMyNote()) return;
@@ -167,7 +170,8 @@ void AppendNoteCommitment(SaplingNoteData* nd, int indexHeight, int64_t nWitness
         // Check the validity of the cache
         // See comment in CopyPreviousWitnesses about validity.
         assert(nWitnessCacheSize >= (int64_t) nd->witnesses.size());
-        nd->witnesses.front().append(note_commitment);
+        // Only the commitments following the witnessed note are appended
+        nd->witnesses.front().append(batch);
     }
 }
 
@@ -263,7 +267,8 @@ bool SaplingScriptPubKeyMan::BuildWitnessChain(const CBlockIndex* pTargetBlock,
     int height = minHeight;
     for (CBlock& block : cblocks) {
         // Finally build the witness cache for each sapling note
-        std::vector<uint256> noteCommitments;
+        const uint64_t firstPosition = initialSaplingTree.size();
+        std::vector<libzcash::PedersenHash> noteCommitments;
         std::vector<SaplingNoteData*> inBlockArrivingNotes;
         for (const auto& tx : block.vtx) {
             const auto& hash = tx->GetHash();
@@ -274,9 +279,6 @@ bool SaplingScriptPubKeyMan::BuildWitnessChain(const CBlockIndex* pTargetBlock,
             for (uint32_t i = 0; i < tx->sapData->vShieldedOutput.size(); i++) {
                 const auto& cmu = tx->sapData->vShieldedOutput[i].cmu;
                 noteCommitments.emplace_back(cmu);
-                for (auto& item : inBlockArrivingNotes) {
-                    item->witnesses.front().append(cmu);
-                }
                 initialSaplingTree.append(cmu);
                 if (txIsOurs) {
                     CWalletTx* wtx = &it->second;
@@ -289,14 +291,16 @@ bool SaplingScriptPubKeyMan::BuildWitnessChain(const CBlockIndex* pTargetBlock,
                 }
             }
         }
+        SaplingMerkleBatch batch(std::move(noteCommitments), firstPosition);
+        for (auto& item : inBlockArrivingNotes) {
+            item->witnesses.front().append(batch);
+        }
         for (auto& it2 : cachedWitnessMap) {
             // Don't duplicate if the block is too old
             if (height >= rollbackTargetHeight) {
                 it2.second.emplace_front(it2.second.front());
             }
-            for (auto& noteComm : noteCommitments) {
-                it2.second.front().append(noteComm);
-            }
+            it2.second.front().append(batch);
         }
         for (auto nd : inBlockArrivingNotes) {
             if (nd->nullifier) {
@@ -315,6 +319,7 @@ void SaplingScriptPubKeyMan::IncrementNoteWitnesses(const CBlockIndex* pindex,
                                                     SaplingMerkleTree& saplingTreeRes)
 {
     LOCK(wallet->cs_wallet);
+    FlushNoteWitnessesRange();
     int chainHeight = pindex->nHeight;
 
     // Set the update cache flag.
@@ -325,8 +330,9 @@ void SaplingScriptPubKeyMan::IncrementNoteWitnesses(const CBlockIndex* pindex,
     }
 
     // 1) Loop over the block txs and gather the note commitments ordered.
-    // If the wtx is from this wallet, witness it and append the following block note commitments on top.
-    std::vector<uint256> noteCommitments;
+    // If the wtx is from this wallet, witness it (the following block note commitments are appended below).
+    const uint64_t firstPosition = saplingTreeRes.size();
+    std::vector<libzcash::PedersenHash> noteCommitments;
     std::vector<std::pair<CWalletTx*, SaplingNoteData*>> inBlockArrivingNotes;
     for (const auto& tx : pblock->vtx) {
         if (!tx->IsShieldedTx()) continue;
@@ -339,14 +345,6 @@ void SaplingScriptPubKeyMan::IncrementNoteWitnesses(const CBlockIndex* pindex,
             const auto& cmu = tx->sapData->vShieldedOutput[i].cmu;
             noteCommitments.emplace_back(cmu);
 
-            // Append note commitment to the in-block wallet's notes.
-            // This is processed here because we already looked for the wtx on
-            // the WitnessNoteIfMine call and only need to append the follow-up block notes,
-            // not every block note (check below).
-            for (auto& item : inBlockArrivingNotes) {
-                ::AppendNoteCommitment(item.second, chainHeight, nWitnessCacheSize, cmu);
-            }
-
             // If tx is from this wallet, try to witness the note for the first time (if exists).
             // And add it to the in-block arriving txs.
             saplingTreeRes.append(cmu);
@@ -362,7 +360,14 @@ void SaplingScriptPubKeyMan::IncrementNoteWitnesses(const CBlockIndex* pindex,
         }
     }
 
-    // 2) Mark already sync wtx, so we don't process them again.
+    // All the witnesses share the hashing of the block note commitments.
+    SaplingMerkleBatch batch(std::move(noteCommitments), firstPosition);
+
+    // 2) Append the follow-up block note commitments to the in-block wallet's notes,
+    // and mark already sync wtx, so we don't process them again.
+    for (auto& item : inBlockArrivingNotes) {
+        ::AppendNoteCommitments(item.second, chainHeight, nWitnessCacheSize, batch);
+    }
     for (auto& item : inBlockArrivingNotes) {
         ::UpdateWitnessHeights(item.first->mapSaplingNoteData, chainHeight, nWitnessCacheSize);
     }
@@ -378,10 +383,8 @@ void SaplingScriptPubKeyMan::IncrementNoteWitnesses(const CBlockIndex* pindex,
             ::CopyPreviousWitnesses(wtx.mapSaplingNoteData, chainHeight, prevWitCacheSize);
 
             // Append new notes commitments.
-            for (auto& noteComm : noteCommitments) {
-                for (auto& item : wtx.mapSaplingNoteData) {
-                    AppendNoteCommitment(&(item.second), chainHeight, nWitnessCacheSize, noteComm);
-                }
+            for (auto& item : wtx.mapSaplingNoteData) {
+                ::AppendNoteCommitments(&(item.second), chainHeight, nWitnessCacheSize, batch);
             }
 
             // Set last processed height.
@@ -393,6 +396,77 @@ void SaplingScriptPubKeyMan::IncrementNoteWitnesses(const CBlockIndex* pindex,
     // CWallet::SetBestChain() (which also ensures that overall consistency
     // of the wallet.dat is maintained).
 }
+
+void SaplingScriptPubKeyMan::IncrementNoteWitnessesRange(const CBlockIndex* pindex,
+                                                         const CBlock* pblock,
+                                                         SaplingMerkleTree& saplingTreeRes)
+{
+    LOCK(wallet->cs_wallet);
+    int chainHeight = pindex->nHeight;
+
+    // The range must be contiguous
+    if (witnessRangeHeight != -1 &&
+            (chainHeight != witnessRangeHeight + 1 ||
+             saplingTreeRes.size() != witnessRangeFirstPosition + witnessRangeCommitments.size())) {
+        FlushNoteWitnessesRange();
+    }
+    if (witnessRangeHeight == -1) {
+        witnessRangeFirstPosition = saplingTreeRes.size();
+    }
+
+    // Witness the notes arriving in this block. The range note commitments
+    // are appended to them, and to every other note, at flush time.
+    const int64_t cacheSize = std::max(nWitnessCacheSize, (int64_t) 1);
+    for (const auto& tx : pblock->vtx) {
+        if (!tx->IsShieldedTx()) continue;
+
+        const auto& hash = tx->GetHash();
+        auto it = wallet->mapWallet.find(hash);
+        bool txIsOurs = it != wallet->mapWallet.end();
+
+        for (uint32_t i = 0; i < tx->sapData->vShieldedOutput.size(); i++) {
+            const auto& cmu = tx->sapData->vShieldedOutput[i].cmu;
+            witnessRangeCommitments.emplace_back(cmu);
+            saplingTreeRes.append(cmu);
+            if (txIsOurs) {
+                auto ndIt = it->second.mapSaplingNoteData.find({hash, i});
+                if (ndIt != it->second.mapSaplingNoteData.end()) {
+                    ::WitnessNoteIfMine(&ndIt->second, chainHeight, cacheSize, saplingTreeRes.witness());
+                }
+            }
+        }
+    }
+    witnessRangeHeight = chainHeight;
+}
+
+void SaplingScriptPubKeyMan::FlushNoteWitnessesRange()
+{
+    LOCK(wallet->cs_wallet);
+    if (witnessRangeHeight == -1) return;
+
+    // The whole range is older than the witness cache: only the latest witness
+    // of each note is kept, and brought up to the end of the range at once.
+    SaplingMerkleBatch batch(std::move(witnessRangeCommitments), witnessRangeFirstPosition);
+    for (auto& it : wallet->mapWallet) {
+        for (auto& item : it.second.mapSaplingNoteData) {
+            SaplingNoteData* nd = &(item.second);
+            // skip externally sent notes
+            if (!nd->IsMyNote() || nd->witnessHeight >= witnessRangeHeight) continue;
+            if (!nd->witnesses.empty()) {
+                nd->witnesses.resize(1);
+                nd->witnesses.front().append(batch);
+            }
+            nd->witnessHeight = witnessRangeHeight;
+        }
+    }
+    nWitnessCacheSize = 1;
+    nWitnessCacheNeedsUpdate = true;
+
+    witnessRangeCommitments.clear();
+    witnessRangeFirstPosition = 0;
+    witnessRangeHeight = -1;
+}
+
 /*
  * Clear and eventually reset each witness of noteDataMap with the corresponding front-value of cachedWitnessMap, indexHeight is the blockHeight being invalidated
  */
@@ -468,6 +542,7 @@ void SaplingScriptPubKeyMan::DecrementNoteWitnesses(const CBlockIndex* pindex)
 {
     assert(pindex);
     LOCK(wallet->cs_wallet);
+    FlushNoteWitnessesRange();
     int nChainHeight = pindex->nHeight;
     // if the targetHeight is different from -1 we have a cache to use
     if (rollbackTargetHeight != -1) {
@@ -503,6 +578,17 @@ void SaplingScriptPubKeyMan::DecrementNoteWitnesses(const CBlockIndex* pindex)
     // of the wallet.dat is maintained).
 }
 
+std::vector<libzcash::SaplingIncomingViewingKey> SaplingScriptPubKeyMan::GetSaplingIvksSnapshot() const
+{
+    AssertLockHeld(wallet->cs_KeyStore);
+    std::vector<libzcash::SaplingIncomingViewingKey> ivks;
+    ivks.reserve(wallet->mapSaplingFullViewingKeys.size());
+    for (const auto& it : wallet->mapSaplingFullViewingKeys) {
+        ivks.emplace_back(it.first);
+    }
+    return ivks;
+}
+
 /**
  * Finds all output notes in the given transaction that have been sent to
  * SaplingPaymentAddresses in this wallet.
@@ -525,35 +611,33 @@ std::pair<mapSaplingNoteData_t, SaplingIncomingViewingKeyMap> SaplingScriptPubKe
     SaplingIncomingViewingKeyMap viewingKeysToAdd;
 
     // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
-    for (uint32_t i = 0; i < tx.sapData->vShieldedOutput.size(); ++i) {
-        const OutputDescription output = tx.sapData->vShieldedOutput[i];
-        for (auto it = wallet->mapSaplingFullViewingKeys.begin(); it != wallet->mapSaplingFullViewingKeys.end(); ++it) {
-            libzcash::SaplingIncomingViewingKey ivk = it->first;
-            auto result = libzcash::SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cmu);
-            if (!result) {
-                continue;
-            }
+    const std::vector<libzcash::SaplingIncomingViewingKey> ivks = GetSaplingIvksSnapshot();
+    const auto& decrypted = SaplingTrialDecryption::TryDecryptOutputs(tx.sapData->vShieldedOutput, ivks);
+    for (uint32_t i = 0; i < decrypted.size(); ++i) {
+        if (!decrypted[i]) {
+            continue;
+        }
+        const libzcash::SaplingIncomingViewingKey& ivk = ivks[decrypted[i]->ivkIndex];
+        const libzcash::SaplingNotePlaintext& result = decrypted[i]->plaintext;
 
-            // Check if we already have it.
-            Optional<libzcash::SaplingPaymentAddress> address = ivk.address(result.get().d);
-            if (address && wallet->mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
-                viewingKeysToAdd[address.get()] = ivk;
-            }
-            // We don't cache the nullifier here as computing it requires knowledge of the note position
-            // in the commitment tree, which can only be determined when the transaction has been mined.
-            SaplingOutPoint op {hash, i};
-            SaplingNoteData nd;
-            nd.ivk = ivk;
-            nd.amount = result->value();
-            nd.address = address;
-            const auto& memo = result->memo();
-            // don't save empty memo (starting with 0xF6)
-            if (memo[0] < 0xF6) {
-                nd.memo = memo;
-            }
-            noteData.insert(std::make_pair(op, nd));
-            break;
+        // Check if we already have it.
+        Optional<libzcash::SaplingPaymentAddress> address = ivk.address(result.d);
+        if (address && wallet->mapSaplingIncomingViewingKeys.count(address.get()) == 0) {
+            viewingKeysToAdd[address.get()] = ivk;
+        }
+        // We don't cache the nullifier here as computing it requires knowledge of the note position
+        // in the commitment tree, which can only be determined when the transaction has been mined.
+        SaplingOutPoint op {hash, i};
+        SaplingNoteData nd;
+        nd.ivk = ivk;
+        nd.amount = result.value();
+        nd.address = address;
+        const auto& memo = result.memo();
+        // don't save empty memo (starting with 0xF6)
+        if (memo[0] < 0xF6) {
+            nd.memo = memo;
         }
+        noteData.insert(std::make_pair(op, nd));
     }
 
     return std::make_pair(noteData, viewingKeysToAdd);
@@ -566,29 +650,74 @@ std::vector<libzcash::SaplingPaymentAddress> SaplingScriptPubKeyMan::FindMySapli
     if (!tx.sapData) return ret;
 
     // Protocol Spec: 4.19 Block Chain Scanning (Sapling)
-    for (const OutputDescription& output : tx.sapData->vShieldedOutput) {
-        for (auto it = wallet->mapSaplingFullViewingKeys.begin(); it != wallet->mapSaplingFullViewingKeys.end(); ++it) {
-            libzcash::SaplingIncomingViewingKey ivk = it->first;
-            auto result = libzcash::SaplingNotePlaintext::decrypt(output.encCiphertext, ivk, output.ephemeralKey, output.cmu);
-            if (!result) {
-                continue;
-            }
-            Optional<libzcash::SaplingPaymentAddress> address = ivk.address(result.get().d);
-            if (address && wallet->mapSaplingIncomingViewingKeys.count(address.get()) != 0) {
-                ret.emplace_back(address.get());
-            }
+    const std::vector<libzcash::SaplingIncomingViewingKey> ivks = GetSaplingIvksSnapshot();
+    for (const auto& decrypted : SaplingTrialDecryption::TryDecryptOutputs(tx.sapData->vShieldedOutput, ivks)) {
+        if (!decrypted) {
+            continue;
+        }
+        Optional<libzcash::SaplingPaymentAddress> address = ivks[decrypted->ivkIndex].address(decrypted->plaintext.d);
+        if (address && wallet->mapSaplingIncomingViewingKeys.count(address.get()) != 0) {
+            ret.emplace_back(address.get());
         }
     }
     return ret;
 }
 
+SaplingIndexedNote* SaplingScriptPubKeyMan::IndexSaplingNote(const CWalletTx& wtx, const SaplingOutPoint& op, const SaplingNoteData& nd) const
+{
+    AssertLockHeld(wallet->cs_wallet);
+    SaplingIndexedNote indexed;
+    if (nd.address && nd.amount) {
+        indexed.address = *nd.address;
+        indexed.value = *nd.amount;
+    } else {
+        // Not cached by the older wallets
+        auto optNotePtAndAddress = wtx.DecryptSaplingNote(op);
+        if (!optNotePtAndAddress) return nullptr;
+        indexed.address = optNotePtAndAddress->second;
+        indexed.value = optNotePtAndAddress->first.value();
+        indexed.note = optNotePtAndAddress->first.note(*nd.ivk);
+        indexed.memo = optNotePtAndAddress->first.memo();
+    }
+    mapIndexedNotesByAddress[indexed.address].emplace(op);
+    return &mapIndexedNotes.emplace(op, std::move(indexed)).first->second;
+}
+
+void SaplingScriptPubKeyMan::AddToSaplingNotesIndex(const CWalletTx& wtx)
+{
+    AssertLockHeld(wallet->cs_wallet);
+    for (const auto& it : wtx.mapSaplingNoteData) {
+        if (it.second.IsMyNote() && !mapIndexedNotes.count(it.first)) {
+            IndexSaplingNote(wtx, it.first, it.second);
+        }
+    }
+}
+
+const SaplingIndexedNote* SaplingScriptPubKeyMan::GetDecryptedNote(const CWalletTx& wtx, const SaplingOutPoint& op, const SaplingNoteData& nd) const
+{
+    AssertLockHeld(wallet->cs_wallet);
+    auto it = mapIndexedNotes.find(op);
+    SaplingIndexedNote* indexed = it != mapIndexedNotes.end() ? &it->second : IndexSaplingNote(wtx, op, nd);
+    if (indexed && !indexed->note) {
+        // recover plaintext
+        auto optNotePtAndAddress = wtx.DecryptSaplingNote(op);
+        if (!optNotePtAndAddress) return nullptr;
+        const libzcash::SaplingNotePlaintext& notePt = optNotePtAndAddress->first;
+        indexed->note = notePt.note(*nd.ivk);
+        indexed->memo = notePt.memo();
+        if (!indexed->note) return nullptr;
+    }
+    return indexed;
+}
+
 void SaplingScriptPubKeyMan::GetNotes(const std::vector<SaplingOutPoint>& saplingOutpoints,
                                       std::vector<SaplingNoteEntry>& saplingEntriesRet) const
 {
+    LOCK(wallet->cs_wallet);
     for (const auto& outpoint : saplingOutpoints) {
         const auto* wtx = wallet->GetWalletTx(outpoint.hash);
         if (!wtx) throw std::runtime_error("No transaction available for hash " + outpoint.hash.GetHex());
-        const int depth = WITH_LOCK(wallet->cs_wallet, return wtx->GetDepthInMainChain(); );
+        const int depth = wtx->GetDepthInMainChain();
         const auto& it = wtx->mapSaplingNoteData.find(outpoint);
         if (it != wtx->mapSaplingNoteData.end()) {
             const SaplingOutPoint& op = it->first;
@@ -597,16 +726,10 @@ void SaplingScriptPubKeyMan::GetNotes(const std::vector<SaplingOutPoint>& saplin
             // skip sent notes
             if (!nd.IsMyNote()) continue;
 
-            // recover plaintext and address
-            auto optNotePtAndAddress = wtx->DecryptSaplingNote(op);
-            assert(static_cast<bool>(optNotePtAndAddress));
+            const SaplingIndexedNote* indexed = GetDecryptedNote(*wtx, op, nd);
+            assert(indexed);
 
-            const libzcash::SaplingIncomingViewingKey& ivk = *(nd.ivk);
-            const libzcash::SaplingNotePlaintext& notePt = optNotePtAndAddress->first;
-            const libzcash::SaplingPaymentAddress& pa = optNotePtAndAddress->second;
-            auto note = notePt.note(ivk).get();
-
-            saplingEntriesRet.emplace_back(op, pa, note, notePt.memo(), depth);
+            saplingEntriesRet.emplace_back(op, indexed->address, *indexed->note, indexed->memo, depth);
         }
     }
 }
@@ -647,57 +770,85 @@ void SaplingScriptPubKeyMan::GetFilteredNotes(
         bool ignoreLocked) const
 {
     LOCK(wallet->cs_wallet);
+    const int nNextHeight = wallet->GetLastBlockHeight() + 1;
+    const int64_t nAdjustedTime = GetAdjustedTime();
 
-    for (auto& p : wallet->mapWallet) {
-        const CWalletTx& wtx = p.second;
-
+    // Filter the transactions before checking for notes
+    auto isSelectedTx = [&](const CWalletTx& wtx, int& depth) {
         // Filter coinbase/coinstakes transactions that don't have Sapling outputs
         if ((wtx.IsCoinBase() || wtx.IsCoinStake()) && wtx.mapSaplingNoteData.empty()) {
-            continue;
+            return false;
         }
+        depth = wtx.GetDepthInMainChain();
+        return IsFinalTx(wtx.tx, nNextHeight, nAdjustedTime) && depth >= minDepth && depth <= maxDepth;
+    };
 
-        // Filter the transactions before checking for notes
-        const int depth = wtx.GetDepthInMainChain();
-        if (!IsFinalTx(wtx.tx, wallet->GetLastBlockHeight() + 1, GetAdjustedTime()) ||
-            depth < minDepth || depth > maxDepth) {
-            continue;
-        }
+    auto addNote = [&](const CWalletTx& wtx, int depth, const SaplingOutPoint& op, const SaplingNoteData& nd) {
+        // skip sent notes
+        if (!nd.IsMyNote()) return;
 
-        for (const auto& it : wtx.mapSaplingNoteData) {
-            const SaplingOutPoint& op = it.first;
-            const SaplingNoteData& nd = it.second;
-            // skip sent notes
-            if (!nd.IsMyNote()) continue;
+        const SaplingIndexedNote* indexed = GetDecryptedNote(wtx, op, nd);
+        assert(indexed);
+        const libzcash::SaplingPaymentAddress& pa = indexed->address;
 
-            // recover plaintext and address
-            auto optNotePtAndAddress = wtx.DecryptSaplingNote(op);
-            assert(static_cast<bool>(optNotePtAndAddress));
+        // skip notes which belong to a different payment address in the wallet
+        if (!(filterAddresses.empty() || filterAddresses.count(pa))) {
+            return;
+        }
 
-            const libzcash::SaplingIncomingViewingKey& ivk = *(nd.ivk);
-            const libzcash::SaplingNotePlaintext& notePt = optNotePtAndAddress->first;
-            const libzcash::SaplingPaymentAddress& pa = optNotePtAndAddress->second;
-            auto note = notePt.note(ivk).get();
+        if (ignoreSpent && nd.nullifier && IsSaplingSpent(*nd.nullifier)) {
+            return;
+        }
 
-            // skip notes which belong to a different payment address in the wallet
-            if (!(filterAddresses.empty() || filterAddresses.count(pa))) {
-                continue;
-            }
+        // skip notes which cannot be spent
+        if (requireSpendingKey && !HaveSpendingKeyForPaymentAddress(pa)) {
+            return;
+        }
 
-            if (ignoreSpent && nd.nullifier && IsSaplingSpent(*nd.nullifier)) {
-                continue;
-            }
+        // skip locked notes.
+        if (ignoreLocked && wallet->IsLockedNote(op)) {
+            return;
+        }
 
-            // skip notes which cannot be spent
-            if (requireSpendingKey && !HaveSpendingKeyForPaymentAddress(pa)) {
-                continue;
-            }
+        saplingEntries.emplace_back(op, pa, *indexed->note, indexed->memo, depth);
+    };
 
-            // skip locked notes.
-            if (ignoreLocked && wallet->IsLockedNote(op)) {
-                continue;
+    if (filterAddresses.empty()) {
+        for (auto& p : wallet->mapWallet) {
+            const CWalletTx& wtx = p.second;
+            int depth;
+            if (!isSelectedTx(wtx, depth)) continue;
+            for (const auto& it : wtx.mapSaplingNoteData) {
+                addNote(wtx, depth, it.first, it.second);
             }
+        }
+        return;
+    }
 
-            saplingEntries.emplace_back(op, pa, note, notePt.memo(), depth);
+    // The notes of the addresses, from the index, in the order of mapWallet
+    std::vector<SaplingOutPoint> vOutPoints;
+    for (const libzcash::PaymentAddress& address : filterAddresses) {
+        const auto* pa = boost::get<libzcash::SaplingPaymentAddress>(&address);
+        auto it = pa ? mapIndexedNotesByAddress.find(*pa) : mapIndexedNotesByAddress.end();
+        if (it != mapIndexedNotesByAddress.end()) {
+            vOutPoints.insert(vOutPoints.end(), it->second.begin(), it->second.end());
+        }
+    }
+    std::sort(vOutPoints.begin(), vOutPoints.end());
+    const CWalletTx* pwtx = nullptr;
+    bool fSelectedTx = false;
+    int depth = 0;
+    for (const SaplingOutPoint& op : vOutPoints) {
+        if (!pwtx || pwtx->GetHash() != op.hash) {
+            // the transactions zapped from the wallet are left in the index
+            auto itTx = wallet->mapWallet.find(op.hash);
+            pwtx = itTx != wallet->mapWallet.end() ? &itTx->second : nullptr;
+            fSelectedTx = pwtx && isSelectedTx(*pwtx, depth);
+        }
+        if (!fSelectedTx) continue;
+        auto itNote = pwtx->mapSaplingNoteData.find(op);
+        if (itNote != pwtx->mapSaplingNoteData.end()) {
+            addNote(*pwtx, depth, op, itNote->second);
         }
     }
 }
@@ -982,23 +1133,44 @@ void SaplingScriptPubKeyMan::GetSaplingNoteWitnesses(const std::vector<SaplingOu
 {
     LOCK(wallet->cs_wallet);
     witnesses.resize(notes.size());
-    Optional<uint256> rt;
-    int i = 0;
-    for (SaplingOutPoint note : notes) {
-        auto it = wallet->mapWallet.find(note.hash);
+    // The latest witnesses of the notes, looked up at once
+    std::vector<const SaplingWitness*> vLatest(notes.size(), nullptr);
+    for (size_t i = 0; i < notes.size(); i++) {
+        auto it = wallet->mapWallet.find(notes[i].hash);
         if (it != wallet->mapWallet.end()) {
-            auto nit = it->second.mapSaplingNoteData.find(note);
+            auto nit = it->second.mapSaplingNoteData.find(notes[i]);
             if (nit != it->second.mapSaplingNoteData.end() &&
                     nit->second.witnesses.size() > 0) {
-                witnesses[i] = nit->second.witnesses.front();
-                if (!rt) {
-                    rt = witnesses[i]->root();
-                } else {
-                    assert(*rt == witnesses[i]->root());
-                }
+                vLatest[i] = &nit->second.witnesses.front();
             }
         }
-        i++;
+    }
+
+    // Each root (the Depth hashes of the witness) is computed once and cached by its witness.
+    // For the spends of many notes, the roots are computed in parallel: each job only touches its
+    // own witness, and cs_wallet is held until they are done.
+    std::vector<size_t> vToHash;
+    for (size_t i = 0; i < notes.size(); i++) {
+        if (vLatest[i]) vToHash.emplace_back(i);
+    }
+    if (vToHash.size() > 1) {
+        ctpl::thread_pool& pool = GetSaplingProverPool();
+        std::vector<std::future<void>> jobs;
+        jobs.reserve(vToHash.size());
+        for (size_t i : vToHash) {
+            jobs.emplace_back(pool.push([&vLatest, i](int threadId) { vLatest[i]->root(); }));
+        }
+        for (auto& f : jobs) f.get();
+    }
+
+    Optional<uint256> rt;
+    for (size_t i : vToHash) {
+        witnesses[i] = *vLatest[i];
+        if (!rt) {
+            rt = witnesses[i]->root();
+        } else {
+            assert(*rt == witnesses[i]->root());
+        }
     }
     // All returned witnesses have the same anchor
     if (rt) {
@@ -40,6 +40,16 @@ struct SaplingNoteEntry
     int confirmations;
 };
 
+/** A received note of the wallet, in the notes index of SaplingScriptPubKeyMan */
+struct SaplingIndexedNote
+{
+    libzcash::SaplingPaymentAddress address;
+    CAmount value{0};
+    //! The note and its memo, decrypted the first time they are read
+    Optional<libzcash::SaplingNote> note{nullopt};
+    std::array<unsigned char, ZC_MEMO_SIZE> memo;
+};
+
 class SaplingNoteData
 {
 public:
@@ -169,6 +179,16 @@ public:
     void IncrementNoteWitnesses(const CBlockIndex* pindex,
                                 const CBlock* pblock,
                                 SaplingMerkleTree& saplingTree);
+    /**
+     * Same as IncrementNoteWitnesses, for consecutive blocks too deep to be part of the
+     * witness cache (e.g. during a rescan). The notes arriving in pblock are witnessed
+     * right away, the note commitments of the whole range are appended to the witnesses
+     * at once by FlushNoteWitnessesRange (or by the next Increment/DecrementNoteWitnesses).
+     */
+    void IncrementNoteWitnessesRange(const CBlockIndex* pindex,
+                                     const CBlock* pblock,
+                                     SaplingMerkleTree& saplingTree);
+    void FlushNoteWitnessesRange();
     /**
      * pindex is the old tip being disconnected.
      */
@@ -283,6 +303,9 @@ public:
     //! Find all of the addresses in the given tx that have been sent to a SaplingPaymentAddress in this wallet.
     std::vector<libzcash::SaplingPaymentAddress> FindMySaplingAddresses(const CTransaction& tx) const;
 
+    //! Add the received notes of the transaction to the notes index
+    void AddToSaplingNotesIndex(const CWalletTx& wtx);
+
     //! Find notes for the outpoints
     void GetNotes(const std::vector<SaplingOutPoint>& saplingOutpoints,
                   std::vector<SaplingNoteEntry>& saplingEntriesRet) const;
@@ -419,6 +442,10 @@ private:
     /* Map hash nullifiers, list Sapling Witness*/
     std::map<uint256, std::list<SaplingWitness>> cachedWitnessMap;
     int rollbackTargetHeight = -1;
+    /* Note commitments of the blocks passed to IncrementNoteWitnessesRange, not yet flushed */
+    std::vector<libzcash::PedersenHash> witnessRangeCommitments;
+    uint64_t witnessRangeFirstPosition{0};
+    int witnessRangeHeight{-1};
     /* Parent wallet */
     CWallet* wallet{nullptr};
     /* the HD chain data model (external/internal chain counters) */
@@ -426,6 +453,23 @@ private:
     /* cached common OVK for sapling spends from t addresses */
     Optional<uint256> commonOVK;
     uint256 getCommonOVKFromSeed() const;
+    /* Incoming viewing keys of the wallet, in mapSaplingFullViewingKeys order */
+    std::vector<libzcash::SaplingIncomingViewingKey> GetSaplingIvksSnapshot() const;
+
+    /**
+     * Index of the received notes of the wallet transactions: their data by outpoint, and their
+     * outpoints by address. The notes are added when their transaction is added to the wallet or
+     * loaded, with the address and the value cached in their SaplingNoteData. The note itself is
+     * decrypted once, the first time that GetFilteredNotes or GetNotes returns it, instead of each
+     * time. The spent, depth and lock filters depend on the chain and are applied on read.
+     * Guarded by the wallet cs_wallet.
+     */
+    mutable std::map<SaplingOutPoint, SaplingIndexedNote> mapIndexedNotes;
+    mutable std::map<libzcash::SaplingPaymentAddress, std::set<SaplingOutPoint>> mapIndexedNotesByAddress;
+    /* Index the received note op of wtx (nullptr if it can't be decrypted) */
+    SaplingIndexedNote* IndexSaplingNote(const CWalletTx& wtx, const SaplingOutPoint& op, const SaplingNoteData& nd) const;
+    /* The indexed note op of wtx, decrypted (nullptr if it can't be decrypted) */
+    const SaplingIndexedNote* GetDecryptedNote(const CWalletTx& wtx, const SaplingOutPoint& op, const SaplingNoteData& nd) const;
 
 
     /**
@@ -5,12 +5,18 @@
 
 #include "sapling/transaction_builder.h"
 
+#include "ctpl_stl.h"
 #include "script/sign.h"
+#include "util/system.h"
+#include "util/threadnames.h"
 #include "utilmoneystr.h"
 #include "consensus/upgrades.h"
 #include "policy/policy.h"
 #include "validation.h"
 
+#include <future>
+#include <mutex>
+
 #include <librustzcash.h>
 
 SpendDescriptionInfo::SpendDescriptionInfo(const libzcash::SaplingExpandedSpendingKey& _expsk,
@@ -23,9 +29,20 @@ SpendDescriptionInfo::SpendDescriptionInfo(const libzcash::SaplingExpandedSpendi
    witness(_witness)
 {
     librustzcash_sapling_generate_r(alpha.begin());
+    librustzcash_sapling_generate_r(rcv.begin());
 }
 
-Optional<OutputDescription> OutputDescriptionInfo::Build(void* ctx) {
+OutputDescriptionInfo::OutputDescriptionInfo(const uint256& _ovk,
+                                             const libzcash::SaplingNote& _note,
+                                             const std::array<unsigned char, ZC_MEMO_SIZE>& _memo):
+    ovk(_ovk),
+    note(_note),
+    memo(_memo)
+{
+    librustzcash_sapling_generate_r(rcv.begin());
+}
+
+Optional<OutputDescription> OutputDescriptionInfo::Build() const {
     auto cmu = this->note.cmu();
     if (!cmu) {
         return nullopt;
@@ -46,12 +63,12 @@ Optional<OutputDescription> OutputDescriptionInfo::Build(void* ctx) {
     std::vector<unsigned char> addressBytes(ss.begin(), ss.end());
 
     OutputDescription odesc;
-    if (!librustzcash_sapling_output_proof(
-            ctx,
+    if (!librustzcash_sapling_output_proof_with_rcv(
             encryptor.get_esk().begin(),
             addressBytes.data(),
             this->note.r.begin(),
             this->note.value(),
+            this->rcv.begin(),
             odesc.cv.begin(),
             odesc.zkproof.begin())) {
         return nullopt;
@@ -231,6 +248,22 @@ void TransactionBuilder::SendChangeTo(const CTxDestination& changeAddr)
     saplingChangeAddr = nullopt;
 }
 
+ctpl::thread_pool& GetSaplingProverPool()
+{
+    static ctpl::thread_pool proverPool;
+    static std::once_flag startFlag;
+    std::call_once(startFlag, [] {
+        // -saplingprovethreads=0 means autodetect, <0 leaves that many cores free
+        int nThreads = gArgs.GetArg("-saplingprovethreads", DEFAULT_SAPLING_PROVE_THREADS);
+        if (nThreads <= 0) {
+            nThreads += GetNumCores();
+        }
+        proverPool.resize(std::max(1, std::min(nThreads, MAX_SAPLING_PROVE_THREADS)));
+        RenameThreadPool(proverPool, "pivx-sapling-prove");
+    });
+    return proverPool;
+}
+
 TransactionBuilderResult TransactionBuilder::ProveAndSign()
 {
     //
@@ -238,42 +271,42 @@ TransactionBuilderResult TransactionBuilder::ProveAndSign()
     //
     if (!spends.empty() || !outputs.empty()) {
 
-        auto ctx = librustzcash_sapling_proving_ctx_init();
-
-        // Create Sapling OutputDescriptions
-        for (auto output : outputs) {
-            // Check this out here as well to provide better logging.
-            if (!output.note.cmu()) {
-                librustzcash_sapling_proving_ctx_free(ctx);
-                return TransactionBuilderResult("Output is invalid");
-            }
-
-            auto odesc = output.Build(ctx);
-            if (!odesc) {
-                librustzcash_sapling_proving_ctx_free(ctx);
-                return TransactionBuilderResult("Failed to create output description");
-            }
-
-            mtx.sapData->vShieldedOutput.push_back(odesc.get());
-        }
-
-        // Create Sapling SpendDescriptions
-        for (auto spend : spends) {
+        // Check the descriptions before proving: the proofs are created in parallel,
+        // and each job only writes its own description.
+        mtx.sapData->vShieldedSpend.resize(spends.size());
+        for (size_t i = 0; i < spends.size(); i++) {
+            const SpendDescriptionInfo& spend = spends[i];
             auto cm = spend.note.cmu();
             auto nf = spend.note.nullifier(
                     spend.expsk.full_viewing_key(), spend.witness.position());
             if (!cm || !nf) {
-                librustzcash_sapling_proving_ctx_free(ctx);
                 return TransactionBuilderResult("Spend is invalid");
             }
-
-            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-            ss << spend.witness.path();
-            std::vector<unsigned char> witness(ss.begin(), ss.end());
-
-            SpendDescription sdesc;
-            if (!librustzcash_sapling_spend_proof(
-                    ctx,
+            mtx.sapData->vShieldedSpend[i].anchor = spend.anchor;
+            mtx.sapData->vShieldedSpend[i].nullifier = *nf;
+        }
+        for (const auto& output : outputs) {
+            // Check this out here as well to provide better logging.
+            if (!output.note.cmu()) {
+                return TransactionBuilderResult("Output is invalid");
+            }
+        }
+        mtx.sapData->vShieldedOutput.resize(outputs.size());
+
+        auto proveOutput = [this](size_t i) {
+            auto odesc = outputs[i].Build();
+            if (!odesc) return false;
+            mtx.sapData->vShieldedOutput[i] = *odesc;
+            return true;
+        };
+        auto proveSpend = [this](size_t i) {
+            const SpendDescriptionInfo& spend = spends[i];
+            SpendDescription& sdesc = mtx.sapData->vShieldedSpend[i];
+            // the merkle path of the note (Depth hashes), computed by the job as well
+            CDataStream ssPath(SER_NETWORK, PROTOCOL_VERSION);
+            ssPath << spend.witness.path();
+            std::vector<unsigned char> witness(ssPath.begin(), ssPath.end());
+            return librustzcash_sapling_spend_proof_with_rcv(
                     spend.expsk.full_viewing_key().ak.begin(),
                     spend.expsk.nsk.begin(),
                     spend.note.d.data(),
@@ -282,16 +315,40 @@ TransactionBuilderResult TransactionBuilder::ProveAndSign()
                     spend.note.value(),
                     spend.anchor.begin(),
                     witness.data(),
+                    spend.rcv.begin(),
                     sdesc.cv.begin(),
                     sdesc.rk.begin(),
-                    sdesc.zkproof.data())) {
-                librustzcash_sapling_proving_ctx_free(ctx);
-                return TransactionBuilderResult("Spend proof failed");
+                    sdesc.zkproof.data());
+        };
+
+        // With -lazysaplingparams, the first shielded transaction reads the proving parameters
+        librustzcash_sapling_load_proving_params();
+
+        bool fOutputsOk = true;
+        bool fSpendsOk = true;
+        if (spends.size() + outputs.size() == 1) {
+            // Not worth a context switch
+            fOutputsOk = outputs.empty() || proveOutput(0);
+            fSpendsOk = spends.empty() || proveSpend(0);
+        } else {
+            ctpl::thread_pool& proverPool = GetSaplingProverPool();
+            std::vector<std::future<bool>> outputJobs;
+            std::vector<std::future<bool>> spendJobs;
+            for (size_t i = 0; i < outputs.size(); i++) {
+                outputJobs.emplace_back(proverPool.push([&proveOutput, i](int threadId) { return proveOutput(i); }));
             }
-
-            sdesc.anchor = spend.anchor;
-            sdesc.nullifier = *nf;
-            mtx.sapData->vShieldedSpend.push_back(sdesc);
+            for (size_t i = 0; i < spends.size(); i++) {
+                spendJobs.emplace_back(proverPool.push([&proveSpend, i](int threadId) { return proveSpend(i); }));
+            }
+            // Wait for every job, the lambdas reference this frame
+            for (auto& f : outputJobs) fOutputsOk &= f.get();
+            for (auto& f : spendJobs) fSpendsOk &= f.get();
+        }
+        if (!fOutputsOk) {
+            return TransactionBuilderResult("Failed to create output description");
+        }
+        if (!fSpendsOk) {
+            return TransactionBuilderResult("Spend proof failed");
         }
 
         //
@@ -304,26 +361,34 @@ TransactionBuilderResult TransactionBuilder::ProveAndSign()
         try {
             dataToBeSigned = SignatureHash(scriptCode, mtx, NOT_AN_INPUT, SIGHASH_ALL, 0, SIGVERSION_SAPLING);
         } catch (const std::logic_error& ex) {
-            librustzcash_sapling_proving_ctx_free(ctx);
             return TransactionBuilderResult("Could not construct signature hash: " + std::string(ex.what()));
         }
 
         // Create Sapling spendAuth and binding signatures
+        std::vector<unsigned char> spendRcvs;
         for (size_t i = 0; i < spends.size(); i++) {
             librustzcash_sapling_spend_sig(
                     spends[i].expsk.ask.begin(),
                     spends[i].alpha.begin(),
                     dataToBeSigned.begin(),
                     mtx.sapData->vShieldedSpend[i].spendAuthSig.data());
+            spendRcvs.insert(spendRcvs.end(), spends[i].rcv.begin(), spends[i].rcv.end());
+        }
+        std::vector<unsigned char> outputRcvs;
+        for (const auto& output : outputs) {
+            outputRcvs.insert(outputRcvs.end(), output.rcv.begin(), output.rcv.end());
         }
 
-        librustzcash_sapling_binding_sig(
-                ctx,
+        if (!librustzcash_sapling_binding_sig_with_rcvs(
+                spendRcvs.data(),
+                spends.size(),
+                outputRcvs.data(),
+                outputs.size(),
                 mtx.sapData->valueBalance,
                 dataToBeSigned.begin(),
-                mtx.sapData->bindingSig.data());
-
-        librustzcash_sapling_proving_ctx_free(ctx);
+                mtx.sapData->bindingSig.data())) {
+            return TransactionBuilderResult("Failed to create binding signature");
+        }
     }
 
     // Transparent signatures
@@ -19,11 +19,18 @@
 #include "sapling/note.h"
 #include "sapling/noteencryption.h"
 
+//! -saplingprovethreads default (number of Sapling proving threads, 0 = auto)
+static const int DEFAULT_SAPLING_PROVE_THREADS = 0;
+//! Maximum number of Sapling proving threads (each proof holds its own circuit in memory)
+static const int MAX_SAPLING_PROVE_THREADS = 16;
+
 struct SpendDescriptionInfo {
     libzcash::SaplingExpandedSpendingKey expsk;
     libzcash::SaplingNote note;
     uint256 alpha;
     uint256 anchor;
+    // Value commitment trapdoor, summed into the binding signing key
+    uint256 rcv;
     SaplingWitness witness;
 
     SpendDescriptionInfo(
@@ -37,17 +44,16 @@ struct OutputDescriptionInfo {
     uint256 ovk;
     libzcash::SaplingNote note;
     std::array<unsigned char, ZC_MEMO_SIZE> memo;
+    // Value commitment trapdoor, subtracted from the binding signing key
+    uint256 rcv;
 
     OutputDescriptionInfo(
         const uint256& _ovk,
         const libzcash::SaplingNote& _note,
-        const std::array<unsigned char, ZC_MEMO_SIZE>& _memo):
-            ovk(_ovk),
-            note(_note),
-            memo(_memo)
-    {}
+        const std::array<unsigned char, ZC_MEMO_SIZE>& _memo);
 
-    Optional<OutputDescription> Build(void* ctx);
+    // Thread safe: the proof only depends on this output
+    Optional<OutputDescription> Build() const;
 };
 
 struct TransparentInputInfo {
@@ -62,6 +68,16 @@ struct TransparentInputInfo {
 
 // Dummy constants used during fee-calculation loop
 extern const OutputDescription DUMMY_SHIELD_OUT;
+namespace ctpl {
+class thread_pool;
+}
+
+/**
+ * The threads of the Sapling proofs (-saplingprovethreads), started on first use.
+ * Also used for the merkle paths and roots of the notes being spent.
+ */
+ctpl::thread_pool& GetSaplingProverPool();
+
 extern const SpendDescription DUMMY_SHIELD_SPEND;
 extern const SaplingTxData::binding_sig_t DUMMY_SHIELD_BINDSIG;
 
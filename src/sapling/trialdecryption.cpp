@@ -0,0 +1,96 @@
+// Copyright (c) 2021 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "sapling/trialdecryption.h"
+
+#include "ctpl_stl.h"
+#include "sapling/sapling_transaction.h"
+#include "util/system.h"
+#include "util/threadnames.h"
+
+#include <future>
+#include <mutex>
+
+namespace SaplingTrialDecryption {
+
+typedef std::vector<std::pair<size_t, DecryptedOutput>> ShardMatches;
+
+// Tries the flattened (output, ivk) pairs in [begin, end), where pair k is
+// (outputs[k / ivks.size()], ivks[k % ivks.size()]). Once an output is decrypted,
+// its remaining keys within the shard are skipped.
+static ShardMatches DecryptShard(const std::vector<OutputDescription>& outputs,
+                                 const std::vector<libzcash::SaplingIncomingViewingKey>& ivks,
+                                 size_t begin, size_t end)
+{
+    ShardMatches matches;
+    const size_t nIvks = ivks.size();
+    size_t k = begin;
+    while (k < end) {
+        const size_t o = k / nIvks;
+        const size_t i = k % nIvks;
+        const OutputDescription& output = outputs[o];
+        auto result = libzcash::SaplingNotePlaintext::decrypt(output.encCiphertext, ivks[i], output.ephemeralKey, output.cmu);
+        if (result) {
+            matches.emplace_back(o, DecryptedOutput(i, std::move(*result)));
+            k = (o + 1) * nIvks;
+        } else {
+            k++;
+        }
+    }
+    return matches;
+}
+
+static ctpl::thread_pool& GetWorkerPool()
+{
+    static ctpl::thread_pool workerPool;
+    static std::once_flag startFlag;
+    std::call_once(startFlag, [] {
+        workerPool.resize(std::max(1, GetNumCores()));
+        RenameThreadPool(workerPool, "pivx-sapling-decrypt");
+    });
+    return workerPool;
+}
+
+std::vector<Optional<DecryptedOutput>> TryDecryptOutputs(const std::vector<OutputDescription>& outputs,
+                                                         const std::vector<libzcash::SaplingIncomingViewingKey>& ivks)
+{
+    std::vector<Optional<DecryptedOutput>> results(outputs.size());
+    const size_t nPairs = outputs.size() * ivks.size();
+    if (nPairs == 0) {
+        return results;
+    }
+
+    std::vector<ShardMatches> shards;
+    if (nPairs < MIN_PARALLEL_TRIAL_DECRYPTIONS) {
+        shards.emplace_back(DecryptShard(outputs, ivks, 0, nPairs));
+    } else {
+        ctpl::thread_pool& workerPool = GetWorkerPool();
+        const size_t nShards = std::min((size_t)workerPool.size(), nPairs / MIN_PARALLEL_TRIAL_DECRYPTIONS * 4);
+        const size_t shardSize = (nPairs + nShards - 1) / nShards;
+        std::vector<std::future<ShardMatches>> futures;
+        futures.reserve(nShards);
+        for (size_t begin = 0; begin < nPairs; begin += shardSize) {
+            const size_t end = std::min(begin + shardSize, nPairs);
+            futures.emplace_back(workerPool.push([&outputs, &ivks, begin, end](int threadId) {
+                return DecryptShard(outputs, ivks, begin, end);
+            }));
+        }
+        for (auto& f : futures) {
+            shards.emplace_back(f.get());
+        }
+    }
+
+    // Shards cover increasing ranges of pairs, so the first match found for an
+    // output is the one with the lowest key index.
+    for (ShardMatches& matches : shards) {
+        for (auto& m : matches) {
+            if (!results[m.first]) {
+                results[m.first].emplace(std::move(m.second));
+            }
+        }
+    }
+    return results;
+}
+
+} // namespace SaplingTrialDecryption
@@ -0,0 +1,42 @@
+// Copyright (c) 2021 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_SAPLING_TRIALDECRYPTION_H
+#define PIVX_SAPLING_TRIALDECRYPTION_H
+
+#include "optional.h"
+#include "sapling/address.h"
+#include "sapling/note.h"
+
+#include <vector>
+
+class OutputDescription;
+
+// Below this many (output, ivk) pairs, trial decryption runs on the calling thread
+static const size_t MIN_PARALLEL_TRIAL_DECRYPTIONS = 64;
+
+namespace SaplingTrialDecryption {
+
+struct DecryptedOutput {
+    // Position of the matching key in the ivk vector passed to TryDecryptOutputs
+    size_t ivkIndex;
+    libzcash::SaplingNotePlaintext plaintext;
+
+    DecryptedOutput(size_t _ivkIndex, libzcash::SaplingNotePlaintext&& _plaintext) :
+        ivkIndex(_ivkIndex), plaintext(std::move(_plaintext)) {}
+};
+
+/**
+ * Trial-decrypts every output with every incoming viewing key (Protocol Spec: 4.19).
+ * The (output, ivk) pairs are sharded across a pool of worker threads when there
+ * are enough of them to pay for the dispatch.
+ * Returns one entry per output, in the same order, set to the first key (in ivks order)
+ * that decrypts it, exactly like trying the keys serially would.
+ */
+std::vector<Optional<DecryptedOutput>> TryDecryptOutputs(const std::vector<OutputDescription>& outputs,
+                                                         const std::vector<libzcash::SaplingIncomingViewingKey>& ivks);
+
+} // namespace SaplingTrialDecryption
+
+#endif // PIVX_SAPLING_TRIALDECRYPTION_H
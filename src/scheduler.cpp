@@ -7,7 +7,9 @@
 
 #include "random.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <iterator>
 #include <utility>
 
 CScheduler::CScheduler() : nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
@@ -53,7 +55,10 @@ void CScheduler::serviceQueue()
                 continue;
 
             Function f = taskQueue.begin()->second;
+            const auto delay = std::chrono::system_clock::now() - taskQueue.begin()->first;
             taskQueue.erase(taskQueue.begin());
+            nTasksRun++;
+            nTotalDelayMicros += std::max((int64_t)0, (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(delay).count());
 
             {
                 // Unlock before calling f, so it can reschedule itself or another task
@@ -124,6 +129,21 @@ bool CScheduler::AreThreadsServicingQueue() const {
     return nThreadsServicingQueue;
 }
 
+CSchedulerStats CScheduler::GetStats() const
+{
+    const auto now = std::chrono::system_clock::now();
+    CSchedulerStats stats;
+    LOCK(newTaskMutex);
+    stats.nTasks = taskQueue.size();
+    stats.nOverdue = std::distance(taskQueue.begin(), taskQueue.upper_bound(now));
+    if (stats.nOverdue > 0) {
+        stats.nMaxDelayMicros = std::chrono::duration_cast<std::chrono::microseconds>(now - taskQueue.begin()->first).count();
+    }
+    stats.nRun = nTasksRun;
+    stats.nTotalDelayMicros = nTotalDelayMicros;
+    return stats;
+}
+
 void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue() {
     {
         LOCK(m_cs_callbacks_pending);
@@ -18,6 +18,16 @@
 
 #include "sync.h"
 
+/** Backlog of a scheduler: the tasks due but not started yet, and the delays of the tasks run */
+struct CSchedulerStats
+{
+    size_t nTasks{0};               //! Tasks scheduled
+    size_t nOverdue{0};             //! Tasks due, waiting for a thread
+    int64_t nMaxDelayMicros{0};     //! How late the most overdue task is
+    uint64_t nRun{0};               //! Tasks run
+    int64_t nTotalDelayMicros{0};   //! Time the tasks run waited past their due time
+};
+
 //
 // Simple class for background tasks that should be run
 // periodically or once "after a while"
@@ -76,6 +86,8 @@ public:
     // Returns true if there are threads actively running in serviceQueue()
     bool AreThreadsServicingQueue() const;
 
+    CSchedulerStats GetStats() const;
+
 private:
     mutable Mutex newTaskMutex;
     std::condition_variable newTaskScheduled;
@@ -83,6 +95,8 @@ private:
     int nThreadsServicingQueue GUARDED_BY(newTaskMutex);
     bool stopRequested GUARDED_BY(newTaskMutex);
     bool stopWhenEmpty GUARDED_BY(newTaskMutex);
+    uint64_t nTasksRun GUARDED_BY(newTaskMutex){0};
+    int64_t nTotalDelayMicros GUARDED_BY(newTaskMutex){0};
     bool shouldStop() const EXCLUSIVE_LOCKS_REQUIRED(newTaskMutex) { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
 };
 
@@ -12,6 +12,7 @@
 #include "crypto/sha256.h"
 #include "pubkey.h"
 #include "script/script.h"
+#include "streams.h"
 
 
 typedef std::vector<unsigned char> valtype;
@@ -1103,6 +1104,9 @@ public:
     }
 };
 
+// Size of a serialized input with its scriptSig blanked: prevout, empty script and nSequence
+const size_t LEGACY_BLANKED_INPUT_SIZE = 36 + 1 + 4;
+
 const unsigned char PIVX_PREVOUTS_HASH_PERSONALIZATION[crypto_generichash_blake2b_PERSONALBYTES] =
         {'P','I','V','X','P','r','e','v','o','u','t','H','a','s','h'};
 const unsigned char PIVX_SEQUENCE_HASH_PERSONALIZATION[crypto_generichash_blake2b_PERSONALBYTES] =
@@ -1175,6 +1179,17 @@ PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
         hashShieldedSpends = GetShieldedSpendsHash(txTo);
         hashShieldedOutputs = GetShieldedOutputsHash(txTo);
     }
+    if (!txTo.isSaplingVersion() && txTo.vin.size() > 1) {
+        CVectorWriter(SER_GETHASH, 0, legacyBlankedTx, 0) << CTransactionSignatureSerializer(txTo, CScript(), NOT_AN_INPUT, SIGHASH_ALL);
+        nLegacyInputsPos = sizeof(txTo.nVersion) + sizeof(txTo.nType) + GetSizeOfCompactSize(txTo.vin.size());
+        vLegacyPrefixes.reserve(txTo.vin.size());
+        CHashWriter ss(SER_GETHASH, 0);
+        ss.write((const char*)legacyBlankedTx.data(), nLegacyInputsPos);
+        for (unsigned int n = 0; n < txTo.vin.size(); n++) {
+            vLegacyPrefixes.push_back(ss);
+            ss.write((const char*)&legacyBlankedTx[nLegacyInputsPos + n * LEGACY_BLANKED_INPUT_SIZE], LEGACY_BLANKED_INPUT_SIZE);
+        }
+    }
 }
 
 uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
@@ -1285,6 +1300,17 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
+    if (cache && !cache->vLegacyPrefixes.empty() && nIn < txTo.vin.size() &&
+            !(nHashType & SIGHASH_ANYONECANPAY) && (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        // Same serialization as below: the (blanked) inputs before and after the one signed come from the cache
+        CHashWriter ss(cache->vLegacyPrefixes[nIn]);
+        txTmp.SerializeInput(ss, nIn);
+        const size_t nSuffixPos = cache->nLegacyInputsPos + (nIn + 1) * LEGACY_BLANKED_INPUT_SIZE;
+        ss.write((const char*)&cache->legacyBlankedTx[nSuffixPos], cache->legacyBlankedTx.size() - nSuffixPos);
+        ss << nHashType;
+        return ss.GetHash();
+    }
+
     // Serialize and hash
     CHashWriter ss(SER_GETHASH, 0);
     ss << txTmp << nHashType;
@@ -7,6 +7,7 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include "hash.h"
 #include "primitives/transaction.h"
 #include "script_error.h"
 #include "uint256.h"
@@ -93,6 +94,16 @@ struct PrecomputedTransactionData
 {
     uint256 hashPrevouts, hashSequence, hashOutputs, hashShieldedSpends, hashShieldedOutputs;
 
+    /**
+     * The legacy sighash of the SIGHASH_ALL signatures hashes the whole tx, with the scriptSigs blanked but the one
+     * of the input signed. For the legacy txs with several inputs, this keeps that serialization with every scriptSig
+     * blanked, where its inputs start, and the hash states before each of them: each input is then hashed from the
+     * state before it, with the serialization after it written at once.
+     */
+    std::vector<unsigned char> legacyBlankedTx;
+    size_t nLegacyInputsPos{0};
+    std::vector<CHashWriter> vLegacyPrefixes;
+
     PrecomputedTransactionData(const CTransaction& tx);
 };
 
@@ -131,7 +142,7 @@ protected:
     virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 
 public:
-    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn) : txTo(txToIn), nIn(nInIn), amount(amountIn), precomTxData(nullptr) {}
+    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData* cachedHashesIn = nullptr) : txTo(txToIn), nIn(nInIn), amount(amountIn), precomTxData(cachedHashesIn) {}
     TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& cachedHashesIn) : txTo(txToIn), nIn(nInIn), amount(amountIn), precomTxData(&cachedHashesIn) {}
 
     bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const override ;
@@ -71,17 +71,17 @@ isminetype IsMine(const CKeyStore& keystore, const CWDestination& dest)
     return boost::apply_visitor(CWDestinationVisitor(keystore), dest);
 }
 
-isminetype IsMine(const CKeyStore& keystore, const CScript& scriptPubKey)
+static isminetype IsMineSolved(const CKeyStore& keystore, const CScript& scriptPubKey, const CScriptSolution& solution)
 {
-    std::vector<valtype> vSolutions;
-    txnouttype whichType;
-    if(!Solver(scriptPubKey, whichType, vSolutions)) {
+    if(!solution.fSolved) {
         if(keystore.HaveWatchOnly(scriptPubKey)) {
             return ISMINE_WATCH_ONLY;
         }
 
         return ISMINE_NO;
     }
+    const txnouttype whichType = solution.type;
+    const std::vector<valtype>& vSolutions = solution.vSolutions;
 
     CKeyID keyID;
     switch (whichType) {
@@ -145,3 +145,23 @@ isminetype IsMine(const CKeyStore& keystore, const CScript& scriptPubKey)
 
     return ISMINE_NO;
 }
+
+isminetype IsMine(const CKeyStore& keystore, const CScript& scriptPubKey)
+{
+    // Most of the scanned outputs pay to keys and scripts that the keystore doesn't know
+    if (!keystore.IsMineCandidate(scriptPubKey)) {
+        return ISMINE_NO;
+    }
+
+    CScriptSolution solution;
+    solution.fSolved = Solver(scriptPubKey, solution.type, solution.vSolutions);
+    return IsMineSolved(keystore, scriptPubKey, solution);
+}
+
+isminetype IsMine(const CKeyStore& keystore, const CScript& scriptPubKey, const CScriptSolution& solution)
+{
+    if (!keystore.IsMineCandidate(scriptPubKey)) {
+        return ISMINE_NO;
+    }
+    return IsMineSolved(keystore, scriptPubKey, solution);
+}
@@ -10,7 +10,8 @@
 #include "destination_io.h"
 #include "key.h"
 #include "script/standard.h"
-#include <bitset>
+
+#include <vector>
 
 class CKeyStore;
 class CScript;
@@ -39,25 +40,49 @@ enum isminetype {
 typedef uint8_t isminefilter;
 
 isminetype IsMine(const CKeyStore& keystore, const CScript& scriptPubKey);
+//! IsMine of a scriptPubKey already parsed by Solver (e.g. one of GetOutputSolutions)
+isminetype IsMine(const CKeyStore& keystore, const CScript& scriptPubKey, const CScriptSolution& solution);
 isminetype IsMine(const CKeyStore& keystore, const CTxDestination& dest);
 isminetype IsMine(const CKeyStore& keystore, const libzcash::SaplingPaymentAddress& pa);
 isminetype IsMine(const CKeyStore& keystore, const CWDestination& dest);
 /**
- * Cacheable amount subdivided into watchonly and spendable parts.
+ * Cacheable amount subdivided by isminefilter.
+ * Only the filters that were queried are stored: every wallet tx has four of these, and the
+ * history txs are asked for a couple of filters at most, so a value slot for each of the
+ * ISMINE_ENUM_ELEMENTS filters would take most of the memory of a large wallet.
  */
 struct CachableAmount
 {
-    // NO and ALL are never (supposed to be) cached
-    std::bitset<ISMINE_ENUM_ELEMENTS> m_cached;
-    CAmount m_value[ISMINE_ENUM_ELEMENTS];
+    std::vector<std::pair<isminefilter, CAmount>> m_values;
     inline void Reset()
     {
-        m_cached.reset();
+        m_values.clear();
+    }
+    bool IsCached(isminefilter filter) const
+    {
+        CAmount value;
+        return Get(filter, value);
+    }
+    //! Return whether filter is cached, and its value in value
+    bool Get(isminefilter filter, CAmount& value) const
+    {
+        for (const auto& v : m_values) {
+            if (v.first == filter) {
+                value = v.second;
+                return true;
+            }
+        }
+        return false;
     }
     void Set(isminefilter filter, CAmount value)
     {
-        m_cached.set(filter);
-        m_value[filter] = value;
+        for (auto& v : m_values) {
+            if (v.first == filter) {
+                v.second = value;
+                return;
+            }
+        }
+        m_values.emplace_back(filter, value);
     }
 };
 
@@ -6,85 +6,85 @@
 
 #include "sigcache.h"
 
-#include "cuckoocache.h"
 #include "memusage.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
 #include "util/system.h"
 
-#include <boost/thread/thread.hpp>
+#include <algorithm>
 
 namespace {
+//! The partitions of the verified results caches, registered by their constructors (at static init time)
+std::vector<CVerifiedResultCache*>& GetVerifiedResultCaches()
+{
+    static std::vector<CVerifiedResultCache*> vCaches;
+    return vCaches;
+}
+
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
- * again when accepted into the block chain)
+ * again when accepted into the block chain).
+ * Entries are SHA256(nonce || signature hash || public key || signature).
  */
-class CSignatureCache
-{
-private:
-     //! Entries are SHA256(nonce || signature hash || public key || signature):
-    uint256 nonce;
-    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+CVerifiedResultCache signatureCache("signature", "maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE, MAX_MAX_SIG_CACHE_SIZE);
 
-public:
-    CSignatureCache()
-    {
-        GetRandBytes(nonce.begin(), 32);
-    }
-
-    void
-    ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
-    {
-        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(pubkey.data(), pubkey.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
-    }
+void ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
+{
+    CSHA256().Write(signatureCache.GetNonce().begin(), 32).Write(hash.begin(), 32).Write(pubkey.data(), pubkey.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+}
+} // anon namespace
 
-    bool
-    Get(const uint256& entry, const bool erase)
-    {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
-    }
+CVerifiedResultCache::CVerifiedResultCache(const std::string& strNameIn, const std::string& strArgIn, int64_t nDefaultSizeIn, int64_t nMaxSizeIn) :
+    strName(strNameIn),
+    strArg(strArgIn),
+    nDefaultSize(nDefaultSizeIn),
+    nMaxSize(nMaxSizeIn)
+{
+    GetRandBytes(nonce.begin(), 32);
+    GetVerifiedResultCaches().emplace_back(this);
+}
 
-    void Set(uint256& entry)
-    {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
-    }
-    uint32_t setup_bytes(size_t n)
-    {
-        return setValid.setup_bytes(n);
-    }
-};
+CVerifiedResultCache::~CVerifiedResultCache()
+{
+    std::vector<CVerifiedResultCache*>& vCaches = GetVerifiedResultCaches();
+    vCaches.erase(std::remove(vCaches.begin(), vCaches.end(), this), vCaches.end());
+}
 
-/* In previous versions of this code, signatureCache was a local static variable
- * in CachingTransactionSignatureChecker::VerifySignature.  We initialize
- * signatureCache outside of VerifySignature to avoid the atomic operation per
- * call overhead associated with local static variables even though
- * signatureCache could be made local to VerifySignature.
-*/
-static CSignatureCache signatureCache;
+void CVerifiedResultCache::Init()
+{
+    // nMaxCacheSize is unsigned. If the size is set to zero,
+    // setup_bytes creates the minimum possible cache (2 elements).
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-" + strArg, nDefaultSize)), nMaxSize) * ((size_t) 1 << 20);
+    boost::unique_lock<boost::shared_mutex> lock(cs_cache);
+    nElems = setValid.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for %s cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, strName, nElems);
 }
 
 // To be called once in AppInitMain/BasicTestingSetup to initialize the
-// signatureCache.
+// verified results caches.
 void InitSignatureCache()
 {
-    // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
-    // setup_bytes creates the minimum possible cache (2 elements).
-    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
-    size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
-    LogPrintf("Using %zu MiB out of %zu requested for signature cache, able to store %zu elements\n",
-            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+    for (CVerifiedResultCache* cache : GetVerifiedResultCaches()) {
+        cache->Init();
+    }
+}
+
+size_t GetSignatureCacheMemoryUsage()
+{
+    size_t nUsage = 0;
+    for (const CVerifiedResultCache* cache : GetVerifiedResultCaches()) {
+        nUsage += cache->DynamicMemoryUsage();
+    }
+    return nUsage;
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
-    signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
+    ComputeEntry(entry, sighash, vchSig, pubkey);
     if (signatureCache.Get(entry, !store))
         return true;
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
@@ -93,3 +93,16 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
         signatureCache.Set(entry);
     return true;
 }
+
+bool CachingVerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& hash, bool store)
+{
+    uint256 entry;
+    ComputeEntry(entry, hash, vchSig, pubkey);
+    if (signatureCache.Get(entry, !store))
+        return true;
+    if (!pubkey.Verify(hash, vchSig))
+        return false;
+    if (store)
+        signatureCache.Set(entry);
+    return true;
+}
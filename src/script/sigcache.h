@@ -6,8 +6,12 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include "cuckoocache.h"
 #include "script/interpreter.h"
 
+#include <boost/thread/shared_mutex.hpp>
+
+#include <atomic>
 #include <vector>
 
 // DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
@@ -40,6 +44,50 @@ public:
     }
 };
 
+/**
+ * A partition of the verified results caches: the successful verifications of one kind of signatures
+ * or proofs (ECDSA signatures, Sapling proofs, special txes signatures, ...), sized by its own -arg.
+ * Entries are hashes of the nonce of the partition and of the verified data, computed by the users.
+ * All the partitions are set up by InitSignatureCache, and accounted by GetSignatureCacheMemoryUsage.
+ */
+class CVerifiedResultCache
+{
+private:
+    const std::string strName;
+    const std::string strArg;
+    const int64_t nDefaultSize;
+    const int64_t nMaxSize;
+
+    uint256 nonce;
+    CuckooCache::cache<uint256, SignatureCacheHasher> setValid;
+    boost::shared_mutex cs_cache;
+    std::atomic<size_t> nElems{0};
+
+public:
+    //! Size given by -<strArg>=<n> (in MiB, default nDefaultSize, at most nMaxSize)
+    CVerifiedResultCache(const std::string& strName, const std::string& strArg, int64_t nDefaultSize, int64_t nMaxSize);
+    ~CVerifiedResultCache();
+
+    const uint256& GetNonce() const { return nonce; }
+
+    //! Whether entry was stored (erasing it if erase)
+    bool Get(const uint256& entry, bool erase)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_cache);
+        return setValid.contains(entry, erase);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_cache);
+        setValid.insert(entry);
+    }
+
+    void Init();
+
+    size_t DynamicMemoryUsage() const { return nElems * sizeof(uint256); }
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -51,6 +99,16 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/**
+ * Verify vchSig of hash by pubkey, unless the signature cache already has it.
+ * With store, a valid signature is added to the cache (and kept there on a hit),
+ * otherwise a hit is erased from it.
+ */
+bool CachingVerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& hash, bool store);
+
+/** Set up the partitions of the verified results caches */
 void InitSignatureCache();
+/** Bytes allocated by the verified results caches (all the partitions) */
+size_t GetSignatureCacheMemoryUsage();
 
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
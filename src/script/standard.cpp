@@ -6,6 +6,7 @@
 
 #include "script/standard.h"
 
+#include "primitives/transaction.h"
 #include "pubkey.h"
 #include "script/script.h"
 
@@ -159,12 +160,38 @@ bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::v
     return false;
 }
 
+const std::vector<CScriptSolution>& GetOutputSolutions(const CTransaction& tx)
+{
+    std::shared_ptr<const std::vector<CScriptSolution>> solutions = std::atomic_load(&tx.m_output_solutions);
+    if (solutions) {
+        return *solutions;
+    }
+    auto computed = std::make_shared<std::vector<CScriptSolution>>(tx.vout.size());
+    for (size_t i = 0; i < tx.vout.size(); i++) {
+        CScriptSolution& solution = (*computed)[i];
+        solution.fSolved = Solver(tx.vout[i].scriptPubKey, solution.type, solution.vSolutions);
+    }
+    // Set once: if another thread was first, use its (identical) results, so that the returned
+    // reference stays valid as long as the transaction
+    if (std::atomic_compare_exchange_strong(&tx.m_output_solutions, &solutions, std::shared_ptr<const std::vector<CScriptSolution>>(computed))) {
+        return *computed;
+    }
+    return *solutions;
+}
+
 bool ExtractDestination(const CScript& scriptPubKey, CTxDestination& addressRet, bool fColdStake)
 {
-    std::vector<valtype> vSolutions;
-    txnouttype whichType;
-    if (!Solver(scriptPubKey, whichType, vSolutions))
+    CScriptSolution solution;
+    solution.fSolved = Solver(scriptPubKey, solution.type, solution.vSolutions);
+    return ExtractDestination(solution, addressRet, fColdStake);
+}
+
+bool ExtractDestination(const CScriptSolution& solution, CTxDestination& addressRet, bool fColdStake)
+{
+    if (!solution.fSolved)
         return false;
+    const txnouttype whichType = solution.type;
+    const std::vector<valtype>& vSolutions = solution.vSolutions;
 
     if (whichType == TX_PUBKEY) {
         CPubKey pubKey(vSolutions[0]);
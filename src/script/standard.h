@@ -18,6 +18,7 @@ static const bool DEFAULT_ACCEPT_DATACARRIER = true;
 
 class CKeyID;
 class CScript;
+class CTransaction;
 
 /** A reference to a CScript: the Hash160 of its serialization (see script.h) */
 class CScriptID : public uint160
@@ -89,6 +90,21 @@ const char* GetTxnOutputType(txnouttype t);
  */
 bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet);
 
+/** The result of Solver for a scriptPubKey */
+struct CScriptSolution
+{
+    bool fSolved{false};
+    txnouttype type{TX_NONSTANDARD};
+    std::vector<std::vector<unsigned char>> vSolutions;
+};
+
+/**
+ * The Solver results of the outputs of a transaction. Computed on the first call, and kept with the
+ * transaction for the next ones (IsMine, ExtractDestination, policy checks and coin selection parse
+ * the same outputs many times).
+ */
+const std::vector<CScriptSolution>& GetOutputSolutions(const CTransaction& tx);
+
 /**
  * Parse a standard scriptPubKey for the destination address. Assigns result to
  * the addressRet parameter and returns true if successful. For multisig
@@ -96,6 +112,7 @@ bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::v
  * P2PKH, P2SH and P2CS scripts.
  */
 bool ExtractDestination(const CScript& scriptPubKey, CTxDestination& addressRet, bool fColdStake = false);
+bool ExtractDestination(const CScriptSolution& solution, CTxDestination& addressRet, bool fColdStake = false);
 
 /**
  * Parse a standard scriptPubKey with one or more destination addresses. For
@@ -35,12 +35,35 @@ CSporkManager::CSporkManager()
         sporkDefsById.emplace(sporkDef.sporkId, &sporkDef);
         sporkDefsByName.emplace(sporkDef.name, &sporkDef);
     }
+    PublishSporkValues();
+}
+
+void CSporkManager::PublishSporkValue(SporkId nSporkID, int64_t nValue)
+{
+    const int32_t nIndex = nSporkID - SPORK_VALUES_BASE;
+    if (nIndex >= 0 && nIndex < SPORK_VALUES_SIZE) {
+        sporkValues[nIndex].store(nValue, std::memory_order_release);
+    }
+}
+
+void CSporkManager::PublishSporkValues()
+{
+    LOCK(cs);
+    for (auto& value : sporkValues) {
+        value.store(-1, std::memory_order_release);
+    }
+    for (const auto& it : sporkDefsById) {
+        const auto itActive = mapSporksActive.find(it.first);
+        PublishSporkValue(it.first, itActive != mapSporksActive.end() ? itActive->second.nValue : it.second->defaultValue);
+    }
 }
 
 void CSporkManager::Clear()
 {
+    LOCK(cs);
     strMasterPrivKey = "";
     mapSporksActive.clear();
+    PublishSporkValues();
 }
 
 // PIVX: on startup load spork values from previous session if they exist in the sporkDB
@@ -209,6 +232,7 @@ void CSporkManager::AddOrUpdateSporkMessage(const CSporkMessage& spork, bool flu
         LOCK(cs);
         mapSporks[spork.GetHash()] = spork;
         mapSporksActive[spork.nSporkID] = spork;
+        if (sporkDefsById.count(spork.nSporkID)) PublishSporkValue(spork.nSporkID, spork.nValue);
     }
     if (flush) {
         // add to spork database.
@@ -225,6 +249,12 @@ bool CSporkManager::IsSporkActive(SporkId nSporkID)
 // grab the value of the spork on the network, or the default
 int64_t CSporkManager::GetSporkValue(SporkId nSporkID)
 {
+    const int32_t nIndex = nSporkID - SPORK_VALUES_BASE;
+    if (nIndex >= 0 && nIndex < SPORK_VALUES_SIZE) {
+        const int64_t nValue = sporkValues[nIndex].load(std::memory_order_acquire);
+        if (nValue != -1) return nValue;
+    }
+
     LOCK(cs);
 
     if (mapSporksActive.count(nSporkID)) {
@@ -17,6 +17,8 @@
 
 #include "protocol.h"
 
+#include <array>
+#include <atomic>
 
 class CSporkMessage;
 class CSporkManager;
@@ -76,15 +78,30 @@ private:
     std::map<std::string, CSporkDef*> sporkDefsByName;
     std::map<SporkId, CSporkMessage> mapSporksActive;
 
+    // Copy of the spork values (the network value, or the default) for the lookups without cs,
+    // indexed by SporkId - SPORK_VALUES_BASE, -1 for the unknown sporks.
+    // Written under cs, together with mapSporksActive.
+    static constexpr int32_t SPORK_VALUES_BASE = SPORK_2_SWIFTTX;
+    static constexpr int32_t SPORK_VALUES_SIZE = SPORK_23_CHAINLOCKS_ENFORCEMENT - SPORK_VALUES_BASE + 1;
+    std::array<std::atomic<int64_t>, SPORK_VALUES_SIZE> sporkValues;
+
+    void PublishSporkValue(SporkId nSporkID, int64_t nValue);
+    void PublishSporkValues();
+
 public:
     CSporkManager();
 
-    SERIALIZE_METHODS(CSporkManager, obj) { READWRITE(obj.mapSporksActive); }
+    SERIALIZE_METHODS(CSporkManager, obj)
+    {
+        READWRITE(obj.mapSporksActive);
+        SER_READ(obj, obj.PublishSporkValues());
+    }
 
     void Clear();
     void LoadSporksFromDB();
 
     bool ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStream& vRecv, int& dosScore);
+    // Lock-free for the known sporks
     int64_t GetSporkValue(SporkId nSporkID);
     // Create/Sign/Relay the spork message, and update the maps
     bool UpdateSpork(SporkId nSporkID, int64_t nValue);
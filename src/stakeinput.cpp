@@ -35,7 +35,7 @@ CPivStake* CPivStake::NewPivStake(const CTxIn& txin, int nHeight, uint32_t nTime
             return nullptr;
         }
         // All good
-        return new CPivStake(coin.out, txin.prevout, pindexFrom);
+        return new CPivStake(coin.GetTxOut(), txin.prevout, pindexFrom);
     }
 
     // Otherwise find the previous transaction in database
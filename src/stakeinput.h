@@ -46,6 +46,7 @@ public:
     CAmount GetValue() const override;
     CDataStream GetUniqueness() const override;
     CTxIn GetTxIn() const;
+    const COutPoint& GetOutPoint() const { return outpointFrom; }
     bool IsZPIV() const override { return false; }
 };
 
@@ -10,10 +10,12 @@
 #include "util/threadnames.h"
 
 #include <stdio.h>
+#include <algorithm>
 #include <system_error>
 #include <map>
 #include <memory>
 #include <set>
+#include <tuple>
 
 #ifdef DEBUG_LOCKCONTENTION
 #if !defined(HAVE_THREAD_LOCAL)
@@ -26,6 +28,113 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+std::atomic<bool> g_lock_profiler{DEFAULT_LOCK_PROFILER};
+
+namespace {
+typedef std::tuple<const char*, const char*, int> LockSiteKey;
+typedef std::map<LockSiteKey, LockSiteProfile> LockSiteMap;
+
+LockSiteProfile& GetLockSite(LockSiteMap& mapSites, const char* pszName, const char* pszFile, int nLine)
+{
+    auto it = mapSites.find(LockSiteKey(pszName, pszFile, nLine));
+    if (it == mapSites.end()) {
+        // the names are string literals, the key only compares their addresses
+        LockSiteProfile site;
+        site.strName = pszName;
+        site.strFile = pszFile;
+        site.nLine = nLine;
+        it = mapSites.emplace(LockSiteKey(pszName, pszFile, nLine), std::move(site)).first;
+    }
+    return it->second;
+}
+
+void MergeLockSites(LockSiteMap& mapTo, const LockSiteMap& mapFrom)
+{
+    for (const auto& it : mapFrom) {
+        LockSiteProfile& site = GetLockSite(mapTo, std::get<0>(it.first), std::get<1>(it.first), std::get<2>(it.first));
+        site.wait.Add(it.second.wait);
+        site.hold.Add(it.second.hold);
+    }
+}
+
+struct ThreadLockProfile;
+
+// Plain mutexes, the profiler must not go through the profiled locks.
+// The registry of the threads' profiles, and the profile of the threads which exited
+std::mutex g_lock_profile_mutex;
+std::set<ThreadLockProfile*> g_thread_lock_profiles;
+LockSiteMap g_exited_lock_profile;
+
+// Each thread records in its own profile, so that the contended locks don't meet on a shared one.
+// Its mutex is only contended by GetLockProfile.
+struct ThreadLockProfile {
+    std::mutex cs;
+    LockSiteMap mapSites;
+
+    ThreadLockProfile()
+    {
+        std::lock_guard<std::mutex> lock(g_lock_profile_mutex);
+        g_thread_lock_profiles.insert(this);
+    }
+
+    ~ThreadLockProfile()
+    {
+        std::lock_guard<std::mutex> lock(g_lock_profile_mutex);
+        g_thread_lock_profiles.erase(this);
+        MergeLockSites(g_exited_lock_profile, mapSites);
+    }
+};
+
+ThreadLockProfile& GetThreadLockProfile()
+{
+    static thread_local ThreadLockProfile profile;
+    return profile;
+}
+} // namespace
+
+constexpr std::array<int64_t, LOCK_PROFILE_BUCKETS - 1> LockTimeBounds::VALUES;
+
+bool SampleLockHold()
+{
+    static thread_local unsigned int nAcquisitions = 0;
+    return ++nAcquisitions % LOCK_PROFILE_HOLD_SAMPLING == 0;
+}
+
+void RecordLockWait(const char* pszName, const char* pszFile, int nLine, int64_t nMicros)
+{
+    ThreadLockProfile& profile = GetThreadLockProfile();
+    std::lock_guard<std::mutex> lock(profile.cs);
+    GetLockSite(profile.mapSites, pszName, pszFile, nLine).wait.Add(nMicros);
+}
+
+void RecordLockHold(const char* pszName, const char* pszFile, int nLine, int64_t nMicros)
+{
+    ThreadLockProfile& profile = GetThreadLockProfile();
+    std::lock_guard<std::mutex> lock(profile.cs);
+    GetLockSite(profile.mapSites, pszName, pszFile, nLine).hold.Add(nMicros);
+}
+
+std::vector<LockSiteProfile> GetLockProfile(bool fReset)
+{
+    LockSiteMap mapSites;
+    {
+        std::lock_guard<std::mutex> lock(g_lock_profile_mutex);
+        MergeLockSites(mapSites, g_exited_lock_profile);
+        if (fReset) g_exited_lock_profile.clear();
+        for (ThreadLockProfile* profile : g_thread_lock_profiles) {
+            std::lock_guard<std::mutex> lockThread(profile->cs);
+            MergeLockSites(mapSites, profile->mapSites);
+            if (fReset) profile->mapSites.clear();
+        }
+    }
+    std::vector<LockSiteProfile> vRet;
+    vRet.reserve(mapSites.size());
+    for (auto& it : mapSites) {
+        vRet.emplace_back(std::move(it.second));
+    }
+    return vRet;
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
@@ -7,13 +7,18 @@
 #ifndef BITCOIN_SYNC_H
 #define BITCOIN_SYNC_H
 
+#include "histogram.h"
 #include "threadsafety.h"
 #include "util/macros.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 
 /////////////////////////////////////////////////
@@ -118,14 +123,82 @@ typedef AnnotatedMixin<std::mutex> Mutex;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Runtime lock contention profiler. When enabled, the wait of every contended LOCK and the
+ * hold time of one in LOCK_PROFILE_HOLD_SAMPLING acquisitions are aggregated per lock site.
+ * Each thread aggregates its own, GetLockProfile merges them. The time a lock is released by
+ * a REVERSE_LOCK isn't counted in its hold time.
+ */
+static const bool DEFAULT_LOCK_PROFILER = false;
+static const unsigned int LOCK_PROFILE_HOLD_SAMPLING = 16;
+static const int LOCK_PROFILE_BUCKETS = 24;
+
+struct LockTimeBounds {
+    // bucket 0 counts the durations under 1us, bucket i the ones in [2^(i-1), 2^i) us
+    static constexpr std::array<int64_t, LOCK_PROFILE_BUCKETS - 1> VALUES{{
+        0, 1, 3, 7, 15, 31, 63, 127, 255, 511, 1023, 2047, 4095, 8191, 16383, 32767, 65535,
+        131071, 262143, 524287, 1048575, 2097151, 4194303}};
+};
+
+typedef FixedHistogram<LockTimeBounds> LockTimeHistogram;
+
+struct LockSiteProfile {
+    std::string strName;
+    std::string strFile;
+    int nLine;
+    LockTimeHistogram wait;
+    LockTimeHistogram hold;
+};
+
+extern std::atomic<bool> g_lock_profiler;
+
+inline int64_t LockProfileMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+/** Whether the hold time of the current acquisition should be sampled */
+bool SampleLockHold();
+void RecordLockWait(const char* pszName, const char* pszFile, int nLine, int64_t nMicros);
+void RecordLockHold(const char* pszName, const char* pszFile, int nLine, int64_t nMicros);
+/** Return the profile of the lock sites, optionally clearing it */
+std::vector<LockSiteProfile> GetLockProfile(bool fReset);
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock  : public Base
 {
 private:
+    // Set when the hold time of this acquisition is sampled by the lock profiler
+    const char* pszHoldName{nullptr};
+    const char* pszHoldFile{nullptr};
+    int nHoldLine{0};
+    int64_t nHoldStart{0};
+
+    void EnterProfiled(const char* pszName, const char* pszFile, int nLine)
+    {
+        if (!Base::try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
+            PrintLockContention(pszName, pszFile, nLine);
+#endif
+            const int64_t nStart = LockProfileMicros();
+            Base::lock();
+            RecordLockWait(pszName, pszFile, nLine, LockProfileMicros() - nStart);
+        }
+        if (SampleLockHold()) {
+            pszHoldName = pszName;
+            pszHoldFile = pszFile;
+            nHoldLine = nLine;
+            nHoldStart = LockProfileMicros();
+        }
+    }
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()));
+        if (g_lock_profiler.load(std::memory_order_relaxed)) {
+            EnterProfiled(pszName, pszFile, nLine);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!Base::try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -136,6 +209,12 @@ private:
 #endif
     }
 
+    // Records the sampled hold time up to now, for the lock to be released
+    void RecordHold()
+    {
+        if (pszHoldName) RecordLockHold(pszHoldName, pszHoldFile, nHoldLine, LockProfileMicros() - nHoldStart);
+    }
+
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()), true);
@@ -167,8 +246,10 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
+            RecordHold();
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -188,6 +269,7 @@ public:
     public:
         explicit reverse_lock(UniqueLock& _lock, const char* _guardname, const char* _file, int _line) : lock(_lock), file(_file), line(_line) {
             CheckLastCritical((void*)lock.mutex(), lockname, _guardname, _file, _line);
+            lock.RecordHold();
             lock.unlock();
             LeaveCritical();
             lock.swap(templock);
@@ -197,6 +279,8 @@ public:
             templock.swap(lock);
             EnterCritical(lockname.c_str(), file.c_str(), line, (void*)lock.mutex());
             lock.lock();
+            // the hold sampled after the relock is recorded on its own
+            if (lock.pszHoldName) lock.nHoldStart = LockProfileMicros();
         }
 
      private:
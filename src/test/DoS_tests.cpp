@@ -261,4 +261,36 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(mapOrphanTransactions.empty());
 }
 
+BOOST_AUTO_TEST_CASE(DoS_headers_branch_length)
+{
+    // The best chain of headers of a peer, and a branch forking off it at height 10
+    const int nBestHeight = 100;
+    const int nForkHeight = 10;
+    std::vector<CBlockIndex> vBest(nBestHeight + 1);
+    std::vector<CBlockIndex> vBranch(MAX_HEADERS_BRANCH_LENGTH + 2);
+    for (int i = 0; i < (int)vBest.size(); i++) {
+        vBest[i].nHeight = i;
+        vBest[i].pprev = i ? &vBest[i - 1] : nullptr;
+        vBest[i].BuildSkip();
+    }
+    for (int i = 0; i < (int)vBranch.size(); i++) {
+        vBranch[i].nHeight = nForkHeight + 1 + i;
+        vBranch[i].pprev = i ? &vBranch[i - 1] : &vBest[nForkHeight];
+        vBranch[i].BuildSkip();
+    }
+    const CBlockIndex* pindexBest = &vBest.back();
+
+    // Extending the best chain, or without a best chain yet, is no branch
+    BOOST_CHECK_EQUAL(GetHeadersBranchLength(pindexBest, pindexBest), 0);
+    BOOST_CHECK_EQUAL(GetHeadersBranchLength(&vBranch.back(), nullptr), 0);
+    // A new header on top of a block of the best chain, below its tip
+    BOOST_CHECK_EQUAL(GetHeadersBranchLength(&vBest[nForkHeight], pindexBest), 1);
+    BOOST_CHECK_EQUAL(GetHeadersBranchLength(&vBranch[0], pindexBest), 2);
+
+    // The branch is extended up to the cap, then past it, even once it is longer than the best chain
+    BOOST_CHECK_EQUAL(GetHeadersBranchLength(&vBranch[MAX_HEADERS_BRANCH_LENGTH - 2], pindexBest), MAX_HEADERS_BRANCH_LENGTH);
+    BOOST_CHECK(GetHeadersBranchLength(&vBranch[MAX_HEADERS_BRANCH_LENGTH - 1], pindexBest) > MAX_HEADERS_BRANCH_LENGTH);
+    BOOST_CHECK(GetHeadersBranchLength(&vBranch.back(), pindexBest) > MAX_HEADERS_BRANCH_LENGTH);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
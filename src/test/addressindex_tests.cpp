@@ -0,0 +1,100 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "consensus/validation.h"
+#include "index/addressindex.h"
+#include "script/sign.h"
+#include "script/standard.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+static size_t CountUnspent(const AddressIndex& index, const uint256& hashScript, const COutPoint& outpoint, bool& fFound)
+{
+    std::vector<std::pair<COutPoint, CAddressUnspentValue>> vUnspent;
+    BOOST_CHECK(index.FindUnspent(hashScript, vUnspent));
+    fFound = std::any_of(vUnspent.begin(), vUnspent.end(), [&](const std::pair<COutPoint, CAddressUnspentValue>& it) { return it.first == outpoint; });
+    return vUnspent.size();
+}
+
+static CAmount GetBalance(const AddressIndex& index, const uint256& hashScript)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount>> vEntries;
+    BOOST_CHECK(index.FindHistory(hashScript, 0, 0, vEntries));
+    CAmount nBalance = 0;
+    for (const auto& it : vEntries) nBalance += it.second;
+    return nBalance;
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_connect_disconnect, TestChain100Setup)
+{
+    AddressIndex addressindex(1 << 20, true);
+    addressindex.Start();
+
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!addressindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // The P2PK coinbase outputs are found by their script, and by the P2PKH script of their key
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const uint256 hashP2PK = GetScriptHash(scriptPubKey);
+    const uint256 hashP2PKH = GetScriptHash(GetScriptForDestination(coinbaseKey.GetPubKey().GetID()));
+    const COutPoint spentOutpoint(coinbaseTxns[0].GetHash(), 0);
+    bool fFound;
+    const size_t nUnspent = CountUnspent(addressindex, hashP2PK, spentOutpoint, fFound);
+    BOOST_CHECK(fFound);
+    BOOST_CHECK_EQUAL(CountUnspent(addressindex, hashP2PKH, spentOutpoint, fFound), nUnspent);
+    BOOST_CHECK(fFound);
+    const CAmount nBalance = GetBalance(addressindex, hashP2PK);
+    BOOST_CHECK_EQUAL(GetBalance(addressindex, hashP2PKH), nBalance);
+
+    // Spend a coinbase output to another key
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript scriptDest = GetScriptForDestination(key.GetPubKey().GetID());
+    const CAmount nValue = coinbaseTxns[0].vout[0].nValue;
+    CMutableTransaction spend;
+    spend.vin.emplace_back(spentOutpoint);
+    spend.vout.emplace_back(nValue - CENT, scriptDest);
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    // The block is paid to the new key too, so that its coinbase doesn't change the balance of the coinbase key
+    CreateAndProcessBlock({spend}, scriptDest);
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK_EQUAL(CountUnspent(addressindex, hashP2PKH, spentOutpoint, fFound), nUnspent - 1);
+    BOOST_CHECK(!fFound);
+    BOOST_CHECK_EQUAL(GetBalance(addressindex, hashP2PKH), nBalance - nValue);
+    BOOST_CHECK_EQUAL(CountUnspent(addressindex, GetScriptHash(scriptDest), COutPoint(spend.GetHash(), 0), fFound), 2);
+    BOOST_CHECK(fFound);
+
+    // Disconnecting the block rewinds the index
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK_EQUAL(CountUnspent(addressindex, hashP2PKH, spentOutpoint, fFound), nUnspent);
+    BOOST_CHECK(fFound);
+    BOOST_CHECK_EQUAL(GetBalance(addressindex, hashP2PKH), nBalance);
+    BOOST_CHECK_EQUAL(CountUnspent(addressindex, GetScriptHash(scriptDest), COutPoint(spend.GetHash(), 0), fFound), 0);
+    BOOST_CHECK_EQUAL(GetBalance(addressindex, GetScriptHash(scriptDest)), 0);
+
+    addressindex.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
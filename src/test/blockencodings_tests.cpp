@@ -0,0 +1,168 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "blockencodings.h"
+#include "consensus/merkle.h"
+#include "streams.h"
+#include "txmempool.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockencodings_tests, TestingSetup)
+
+// A PoS block: coinbase, coinstake and three transactions, the last one spending the second
+static CBlock BuildPoSBlock()
+{
+    CBlock block;
+    block.nVersion = CBlockHeader::CURRENT_VERSION;
+    block.hashPrevBlock = InsecureRand256();
+    block.nTime = 1650000000;
+    block.nBits = 0x207fffff;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << 300 << OP_0;
+    coinbase.vout.resize(1);
+    coinbase.vout[0].SetEmpty();
+    block.vtx.emplace_back(MakeTransactionRef(coinbase));
+
+    CMutableTransaction coinstake;
+    coinstake.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+    coinstake.vout.resize(2);
+    coinstake.vout[0].SetEmpty();
+    coinstake.vout[1] = CTxOut(250 * COIN, CScript() << OP_TRUE);
+    block.vtx.emplace_back(MakeTransactionRef(coinstake));
+
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+    tx.vin[0].scriptSig = CScript() << OP_11;
+    tx.vout.emplace_back(10 * COIN, CScript() << OP_11 << OP_EQUAL);
+    block.vtx.emplace_back(MakeTransactionRef(tx));
+    tx.vin[0].prevout.hash = InsecureRand256();
+    block.vtx.emplace_back(MakeTransactionRef(tx));
+    tx.vin[0].prevout.hash = block.vtx[3]->GetHash();
+    block.vtx.emplace_back(MakeTransactionRef(tx));
+
+    block.vchBlockSig = {0x30, 0x44, 0x02, 0x20};
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    return block;
+}
+
+// Round trip through the network serialization
+static CBlockHeaderAndShortTxIDs Relay(const CBlockHeaderAndShortTxIDs& cmpctblock)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << cmpctblock;
+    CBlockHeaderAndShortTxIDs cmpctblockRead;
+    stream >> cmpctblockRead;
+    return cmpctblockRead;
+}
+
+BOOST_AUTO_TEST_CASE(SimpleRoundTripTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CBlock block = BuildPoSBlock();
+    {
+        LOCK(pool.cs);
+        for (size_t i = 2; i < block.vtx.size(); i++) {
+            pool.addUnchecked(block.vtx[i]->GetHash(), entry.FromTx(*block.vtx[i]));
+        }
+    }
+
+    CBlockHeaderAndShortTxIDs cmpctblock = Relay(CBlockHeaderAndShortTxIDs(block));
+    // The coinbase and the coinstake go in full
+    BOOST_CHECK_EQUAL(cmpctblock.prefilledtxn.size(), 2);
+    BOOST_CHECK_EQUAL(cmpctblock.shorttxids.size(), 3);
+    BOOST_CHECK_EQUAL(cmpctblock.BlockTxCount(), block.vtx.size());
+    BOOST_CHECK(cmpctblock.header.GetHash() == block.GetHash());
+
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(cmpctblock) == READ_STATUS_OK);
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        BOOST_CHECK(partialBlock.IsTxAvailable(i));
+    }
+
+    CBlock block2;
+    BOOST_CHECK(partialBlock.FillBlock(block2, {}) == READ_STATUS_OK);
+    BOOST_CHECK(block2.GetHash() == block.GetHash());
+    BOOST_CHECK(block2.hashMerkleRoot == block.hashMerkleRoot);
+    BOOST_CHECK(block2.vchBlockSig == block.vchBlockSig);
+    BOOST_CHECK(block2.IsProofOfStake());
+    BOOST_CHECK_EQUAL(block2.vtx.size(), block.vtx.size());
+}
+
+BOOST_AUTO_TEST_CASE(MissingTransactionsTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+    CBlock block = BuildPoSBlock();
+    {
+        LOCK(pool.cs);
+        pool.addUnchecked(block.vtx[3]->GetHash(), entry.FromTx(*block.vtx[3]));
+    }
+
+    CBlockHeaderAndShortTxIDs cmpctblock = Relay(CBlockHeaderAndShortTxIDs(block));
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(cmpctblock) == READ_STATUS_OK);
+    BlockTransactionsRequest req;
+    req.blockhash = block.GetHash();
+    for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+        if (!partialBlock.IsTxAvailable(i)) req.indexes.push_back(i);
+    }
+    BOOST_CHECK(req.indexes == std::vector<uint16_t>({2, 4}));
+
+    // The indexes are sent as differences
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << req;
+    BlockTransactionsRequest reqRead;
+    stream >> reqRead;
+    BOOST_CHECK(reqRead.blockhash == req.blockhash);
+    BOOST_CHECK(reqRead.indexes == req.indexes);
+
+    BlockTransactions resp(reqRead);
+    for (size_t i = 0; i < reqRead.indexes.size(); i++) {
+        resp.txn[i] = block.vtx[reqRead.indexes[i]];
+    }
+
+    // Wrong transactions give a different merkle root, like a short id collision
+    PartiallyDownloadedBlock partialBlockCopy = partialBlock;
+    CBlock block2;
+    BOOST_CHECK(partialBlockCopy.FillBlock(block2, {resp.txn[1], resp.txn[0]}) == READ_STATUS_FAILED);
+    // Missing or extra transactions are bogus
+    partialBlockCopy = partialBlock;
+    BOOST_CHECK(partialBlockCopy.FillBlock(block2, {resp.txn[0]}) == READ_STATUS_INVALID);
+    partialBlockCopy = partialBlock;
+    BOOST_CHECK(partialBlockCopy.FillBlock(block2, {resp.txn[0], resp.txn[1], resp.txn[1]}) == READ_STATUS_INVALID);
+
+    BOOST_CHECK(partialBlock.FillBlock(block2, resp.txn) == READ_STATUS_OK);
+    BOOST_CHECK(block2.GetHash() == block.GetHash());
+    bool mutated;
+    BOOST_CHECK(BlockMerkleRoot(block2, &mutated) == block.hashMerkleRoot);
+    BOOST_CHECK(!mutated);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidCompactBlockTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    CBlock block = BuildPoSBlock();
+    CBlockHeaderAndShortTxIDs cmpctblock(block);
+
+    // A prefilled transaction past the end of the block
+    CBlockHeaderAndShortTxIDs badIndex = cmpctblock;
+    badIndex.prefilledtxn[1].index = 10;
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(Relay(badIndex)) == READ_STATUS_INVALID);
+
+    // Two transactions with the same short id
+    CBlockHeaderAndShortTxIDs duplicated = cmpctblock;
+    duplicated.shorttxids[1] = duplicated.shorttxids[0];
+    PartiallyDownloadedBlock partialBlock2(&pool);
+    BOOST_CHECK(partialBlock2.InitData(Relay(duplicated)) == READ_STATUS_FAILED);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -452,6 +452,38 @@ BOOST_AUTO_TEST_CASE(merkle_block_4_test_update_none)
     BOOST_CHECK(!filter.contains(COutPoint(uint256S("0x02981fa052f0481dbc5868f4fc2166035a10f27a03cfd2de67326471df5bc041"), 0)));
 }
 
+BOOST_AUTO_TEST_CASE(merkle_block_filtered_block_data)
+{
+    // The filtered block data must match and update the filters exactly as the transactions do
+    CBlock block = getBlock13b8a();
+    const CFilteredBlockData data(block);
+    BOOST_CHECK(data.DynamicMemoryUsage() > 0);
+
+    // The first push of the scriptPubKey of the first output of the last transaction
+    std::vector<unsigned char> vPush;
+    opcodetype opcode;
+    CScript::const_iterator pc = block.vtx.back()->vout[0].scriptPubKey.begin();
+    BOOST_CHECK(block.vtx.back()->vout[0].scriptPubKey.GetOp(pc, opcode, vPush));
+
+    for (unsigned char nFlags : {BLOOM_UPDATE_NONE, BLOOM_UPDATE_ALL, BLOOM_UPDATE_P2PUBKEY_ONLY}) {
+        CBloomFilter filter(10, 0.000001, 0, nFlags);
+        filter.insert(block.vtx[1]->GetHash());
+        filter.insert(block.vtx[3]->vin[0].prevout);
+        filter.insert(vPush);
+        CBloomFilter filterPrecomputed = filter;
+
+        CMerkleBlock merkleBlock(block, filter);
+        CMerkleBlock merkleBlockPrecomputed(block, filterPrecomputed, data);
+        BOOST_CHECK(merkleBlock.vMatchedTxn == merkleBlockPrecomputed.vMatchedTxn);
+        BOOST_CHECK(!merkleBlock.vMatchedTxn.empty());
+
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION), ssPrecomputed(SER_NETWORK, PROTOCOL_VERSION);
+        ss << merkleBlock << filter;
+        ssPrecomputed << merkleBlockPrecomputed << filterPrecomputed;
+        BOOST_CHECK_EQUAL(HexStr(ss), HexStr(ssPrecomputed));
+    }
+}
+
 static std::vector<unsigned char> RandomData()
 {
     uint256 r = InsecureRand256();
@@ -187,6 +187,21 @@ BOOST_AUTO_TEST_CASE(dkg)
     worker.Stop();
 }
 
+BOOST_AUTO_TEST_CASE(bls_worker_parallel_for)
+{
+    CBLSWorker worker;
+    std::vector<int> vec(101, 0);
+    // Runs inline when the worker is not started
+    worker.ParallelFor(vec.size(), [&](size_t i) { vec[i] += (int)i; });
+    worker.Start(3);
+    worker.ParallelFor(vec.size(), [&](size_t i) { vec[i] += (int)i; });
+    worker.ParallelFor(0, [&](size_t i) { BOOST_ERROR("no index expected"); });
+    worker.Stop();
+    for (size_t i = 0; i < vec.size(); i++) {
+        BOOST_CHECK_EQUAL(vec[i], 2 * (int)i);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(bls_ies_tests)
 {
     // Test basic encryption and decryption of the BLS Integrated Encryption Scheme.
@@ -295,6 +310,35 @@ BOOST_AUTO_TEST_CASE(bls_pk_io_tests)
     BOOST_CHECK(oppk4 == nullopt);
 }
 
+BOOST_AUTO_TEST_CASE(bls_lazy_pk_tests)
+{
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+    const CBLSPublicKey& pk = sk.GetPublicKey();
+
+    // Twice the same key: the second one comes from the decompressed keys cache
+    for (int i = 0; i < 2; i++) {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << pk;
+        CBLSLazyPublicKey lazyPk;
+        ss >> lazyPk;
+        BOOST_CHECK(lazyPk.Get().IsValid());
+        BOOST_CHECK(lazyPk.Get() == pk);
+    }
+
+    // The null key and bytes that are not a point stay invalid
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CBLSPublicKey();
+    CBLSLazyPublicKey nullPk;
+    ss >> nullPk;
+    BOOST_CHECK(!nullPk.Get().IsValid());
+    std::vector<uint8_t> badBytes(BLS_CURVE_PUBKEY_SIZE, 0xff);
+    ss.write((const char*)badBytes.data(), badBytes.size());
+    CBLSLazyPublicKey badPk;
+    ss >> badPk;
+    BOOST_CHECK(!badPk.Get().IsValid());
+}
+
 struct Message {
     uint32_t sourceId;
     uint32_t msgId;
@@ -400,6 +444,44 @@ BOOST_AUTO_TEST_CASE(batch_verifier_tests)
     // last message invalid from one source
     AddMessage(msgs, 1, 7, 1, false);
     Verify(msgs);
+
+    msgs.clear();
+    // a few invalid sigs among many sources
+    for (uint32_t i = 1; i <= 20; i++) {
+        AddMessage(msgs, i, i, i, i != 5 && i != 17);
+    }
+    Verify(msgs);
+}
+
+BOOST_AUTO_TEST_CASE(batch_verifier_cancellation_tests)
+{
+    // Two tampered signatures, whose errors cancel out in their sum
+    std::vector<Message> msgs;
+    AddMessage(msgs, 1, 1, 1, true);
+    AddMessage(msgs, 2, 2, 2, true);
+    AddMessage(msgs, 3, 3, 3, true);
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+    const CBLSSignature delta = sk.Sign(uint256S("0xde17a"));
+    msgs[0].sig.AggregateInsecure(delta);
+    msgs[1].sig.SubInsecure(delta);
+    BOOST_CHECK(!msgs[0].sig.VerifyInsecure(msgs[0].pk, msgs[0].msgHash));
+    BOOST_CHECK(!msgs[1].sig.VerifyInsecure(msgs[1].pk, msgs[1].msgHash));
+    msgs[0].valid = msgs[1].valid = false;
+
+    // The plain aggregate doesn't see them
+    {
+        CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(false, true);
+        for (auto& m : msgs) {
+            batchVerifier.PushMessage(m.sourceId, m.msgId, m.msgHash, m.sig, m.pk);
+        }
+        batchVerifier.Verify();
+        BOOST_CHECK(batchVerifier.badMessages.empty());
+    }
+
+    // The secure verification weights each signature and finds both
+    Verify(msgs, true, false);
+    Verify(msgs, true, true);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include "spork.h"
 #include "test/util/blocksutil.h"
 #include "tiertwo/tiertwo_sync_state.h"
+#include "tiertwo/vote_sig_verifier.h"
 #include "tinyformat.h"
 #include "utilmoneystr.h"
 #include "validation.h"
@@ -525,4 +526,178 @@ BOOST_AUTO_TEST_CASE(fbv_signverify_bls)
     BOOST_CHECK(!vote3_3.CheckSignature(sk1.GetPublicKey()));
 }
 
+BOOST_FIXTURE_TEST_CASE(vote_sig_verifier_batch, BasicTestingSetup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+
+    // Valid and invalid ECDSA and BLS signatures, mixed in one batch
+    std::vector<std::shared_ptr<CSignedMessage>> vVotes;
+    std::vector<bool> vExpected;
+    for (int i = 0; i < 20; i++) {
+        const CTxIn vin(GetRandHash(), 0);
+        const bool fValid = i % 3 != 0;
+        if (i % 2 == 0) {
+            auto vote = std::make_shared<CBudgetVote>(vin, GetRandHash(), CBudgetVote::VOTE_YES);
+            BOOST_CHECK(vote->Sign(key, key.GetPubKey().GetID()));
+            if (!fValid) vote->SetTime(vote->GetTime() + 1);
+            vVotes.emplace_back(vote);
+        } else {
+            auto vote = std::make_shared<CFinalizedBudgetVote>(vin, GetRandHash());
+            BOOST_CHECK(vote->Sign(sk));
+            if (!fValid) vote->SetTime(vote->GetTime() + 1);
+            vVotes.emplace_back(vote);
+        }
+        vExpected.emplace_back(fValid);
+    }
+
+    CVoteSigVerifier verifier;
+    BOOST_CHECK(!verifier.CanQueue());
+    verifier.Start(2);
+    BOOST_CHECK(verifier.CanQueue());
+
+    CNode dummyNode(0, NODE_NETWORK, 0, INVALID_SOCKET, CAddress(CService(), NODE_NONE), 0, 0, "", true);
+    Mutex cs;
+    std::vector<std::pair<size_t, bool>> vResults;
+    for (size_t i = 0; i < vVotes.size(); i++) {
+        const auto callback = [&, i](CNode* pnode, bool fValidSig) {
+            BOOST_CHECK(pnode == &dummyNode);
+            LOCK(cs);
+            vResults.emplace_back(i, fValidSig);
+        };
+        if (i % 2 == 0) {
+            verifier.PushVote(&dummyNode, vVotes[i], key.GetPubKey().GetID(), callback);
+        } else {
+            verifier.PushVote(&dummyNode, vVotes[i], sk.GetPublicKey(), callback);
+        }
+    }
+
+    const int64_t nTimeStart = GetTimeMillis();
+    while (WITH_LOCK(cs, return vResults.size()) < vVotes.size()) {
+        BOOST_REQUIRE(GetTimeMillis() < nTimeStart + 10 * 1000);
+        MilliSleep(10);
+    }
+    verifier.Stop();
+
+    // The results are given in the order of the votes, and match the single signature checks
+    for (size_t i = 0; i < vResults.size(); i++) {
+        BOOST_CHECK_EQUAL(vResults[i].first, i);
+        BOOST_CHECK_EQUAL(vResults[i].second, vExpected[i]);
+    }
+    BOOST_CHECK_EQUAL(dummyNode.GetRefCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(budget_vote_counts)
+{
+    const CScript payee = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    CBudgetProposal prop("prop-a", "https://forum.pivx.org/t/test", 2, payee, 100 * COIN, 144, GetRandHash());
+    const CTxIn mnVin1(GetRandHash(), 0), mnVin2(GetRandHash(), 0), mnVin3(GetRandHash(), 0);
+    std::string strError;
+    BOOST_CHECK(prop.AddOrUpdateVote(CBudgetVote(mnVin1, prop.GetHash(), CBudgetVote::VOTE_YES), strError));
+    BOOST_CHECK(prop.AddOrUpdateVote(CBudgetVote(mnVin2, prop.GetHash(), CBudgetVote::VOTE_YES), strError));
+    BOOST_CHECK(prop.AddOrUpdateVote(CBudgetVote(mnVin3, prop.GetHash(), CBudgetVote::VOTE_ABSTAIN), strError));
+    BOOST_CHECK_EQUAL(prop.GetYeas(), 2);
+    BOOST_CHECK_EQUAL(prop.GetNays(), 0);
+    BOOST_CHECK_EQUAL(prop.GetAbstains(), 1);
+
+    // An update too soon is rejected, a later one moves the vote to the new direction
+    CBudgetVote vote(mnVin2, prop.GetHash(), CBudgetVote::VOTE_NO);
+    BOOST_CHECK(!prop.AddOrUpdateVote(vote, strError));
+    BOOST_CHECK_EQUAL(prop.GetYeas(), 2);
+    vote.SetTime(vote.GetTime() + BUDGET_VOTE_UPDATE_MIN);
+    BOOST_CHECK(prop.AddOrUpdateVote(vote, strError));
+    BOOST_CHECK_EQUAL(prop.GetYeas(), 1);
+    BOOST_CHECK_EQUAL(prop.GetNays(), 1);
+    BOOST_CHECK_EQUAL(prop.GetAbstains(), 1);
+
+    // The counts are rebuilt when the proposal is read from disk
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << prop;
+    CBudgetProposal prop2;
+    ss >> prop2;
+    BOOST_CHECK_EQUAL(prop2.GetYeas(), 1);
+    BOOST_CHECK_EQUAL(prop2.GetNays(), 1);
+    BOOST_CHECK_EQUAL(prop2.GetAbstains(), 1);
+
+    const CTxBudgetPayment txBudgetPayment(prop.GetHash(), payee, 100 * COIN);
+    CFinalizedBudget fin("main (test)", 144, {txBudgetPayment}, GetRandHash());
+    BOOST_CHECK(fin.AddOrUpdateVote(CFinalizedBudgetVote(mnVin1, fin.GetHash()), strError));
+    BOOST_CHECK(fin.AddOrUpdateVote(CFinalizedBudgetVote(mnVin2, fin.GetHash()), strError));
+    BOOST_CHECK_EQUAL(fin.GetVoteCount(), 2);
+    ss << fin;
+    CFinalizedBudget fin2;
+    ss >> fin2;
+    BOOST_CHECK_EQUAL(fin2.GetVoteCount(), 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(budget_payee_cache, TestingSetup)
+{
+    const CScript payee1 = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    const CScript payee2 = GetScriptForDestination(CKeyID(uint160(ParseHex("d9386e8ac9cbe8b1a7ba0cb9a0a0a9dfd1c5ad50"))));
+    const CTxBudgetPayment txBudgetPayment1(GetRandHash(), payee1, 100 * COIN);
+    const CTxBudgetPayment txBudgetPayment2(GetRandHash(), payee2, 200 * COIN);
+    CBudgetManager budgetman;
+    std::string strError;
+    CAmount nAmount;
+
+    // One finalization with one vote: it pays the superblock, the other heights pay nothing
+    CFinalizedBudget fin1("main (test)", 144, {txBudgetPayment1}, GetRandHash());
+    BOOST_CHECK(fin1.AddOrUpdateVote(CFinalizedBudgetVote(CTxIn(GetRandHash(), 0), fin1.GetHash()), strError));
+    budgetman.ForceAddFinalizedBudget(fin1.GetHash(), fin1.GetFeeTXHash(), fin1);
+    BOOST_CHECK(budgetman.GetExpectedPayeeAmount(144, nAmount));
+    BOOST_CHECK_EQUAL(nAmount, 100 * COIN);
+    BOOST_CHECK(!budgetman.GetExpectedPayeeAmount(145, nAmount));
+
+    // A finalization with more votes replaces the cached one
+    CFinalizedBudget fin2("main2 (test)", 144, {txBudgetPayment2}, GetRandHash());
+    BOOST_CHECK(fin2.AddOrUpdateVote(CFinalizedBudgetVote(CTxIn(GetRandHash(), 0), fin2.GetHash()), strError));
+    BOOST_CHECK(fin2.AddOrUpdateVote(CFinalizedBudgetVote(CTxIn(GetRandHash(), 0), fin2.GetHash()), strError));
+    budgetman.ForceAddFinalizedBudget(fin2.GetHash(), fin2.GetFeeTXHash(), fin2);
+    BOOST_CHECK(budgetman.GetExpectedPayeeAmount(144, nAmount));
+    BOOST_CHECK_EQUAL(nAmount, 200 * COIN);
+
+    // So do the new votes on the first one
+    BOOST_CHECK(budgetman.UpdateFinalizedBudget(CFinalizedBudgetVote(CTxIn(GetRandHash(), 0), fin1.GetHash()), nullptr, strError));
+    BOOST_CHECK(budgetman.UpdateFinalizedBudget(CFinalizedBudgetVote(CTxIn(GetRandHash(), 0), fin1.GetHash()), nullptr, strError));
+    BOOST_CHECK(budgetman.GetExpectedPayeeAmount(144, nAmount));
+    BOOST_CHECK_EQUAL(nAmount, 100 * COIN);
+    CMutableTransaction txCoinbase, txCoinstake;
+    txCoinbase.vout.resize(1);
+    BOOST_CHECK(budgetman.FillBlockPayee(txCoinbase, txCoinstake, 144, false));
+    BOOST_CHECK(txCoinbase.vout[1].scriptPubKey == payee1);
+    BOOST_CHECK_EQUAL(txCoinbase.vout[1].nValue, 100 * COIN);
+
+    // And the removal of the budgets
+    budgetman.Clear();
+    BOOST_CHECK(!budgetman.GetExpectedPayeeAmount(144, nAmount));
+}
+
+BOOST_AUTO_TEST_CASE(budget_votes_digest)
+{
+    const CScript payee = GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))));
+    CBudgetProposal prop("prop-a", "https://forum.pivx.org/t/test", 2, payee, 100 * COIN, 144, GetRandHash());
+    CBudgetProposal prop2 = prop;
+    const CBudgetVote vote1(CTxIn(GetRandHash(), 0), prop.GetHash(), CBudgetVote::VOTE_YES);
+    const CBudgetVote vote2(CTxIn(GetRandHash(), 0), prop.GetHash(), CBudgetVote::VOTE_NO);
+    std::string strError;
+    BOOST_CHECK_EQUAL(prop.GetVotesDigest(), prop2.GetVotesDigest());
+
+    // The digest does not depend on the order the votes are received
+    BOOST_CHECK(prop.AddOrUpdateVote(vote1, strError));
+    BOOST_CHECK(prop.AddOrUpdateVote(vote2, strError));
+    BOOST_CHECK(prop.GetVotesDigest() != prop2.GetVotesDigest());
+    BOOST_CHECK(prop2.AddOrUpdateVote(vote2, strError));
+    BOOST_CHECK(prop.GetVotesDigest() != prop2.GetVotesDigest());
+    BOOST_CHECK(prop2.AddOrUpdateVote(vote1, strError));
+    BOOST_CHECK_EQUAL(prop.GetVotesDigest(), prop2.GetVotesDigest());
+
+    // An updated vote changes the digest
+    CBudgetVote vote3(vote1.GetVin(), prop.GetHash(), CBudgetVote::VOTE_NO);
+    vote3.SetTime(vote1.GetTime() + BUDGET_VOTE_UPDATE_MIN);
+    BOOST_CHECK(prop2.AddOrUpdateVote(vote3, strError));
+    BOOST_CHECK(prop.GetVotesDigest() != prop2.GetVotesDigest());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
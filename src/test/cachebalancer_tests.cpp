@@ -0,0 +1,72 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "cachebalancer.h"
+#include "coins.h"
+#include "random.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(cachebalancer_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(cache_balancer_tier_two_target)
+{
+    const size_t nTotal = 1600, nStep = 100;
+
+    // The initial download gives nearly everything to the coins cache
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeTierTwoTarget(nTotal, 0, true, 0.0, 0.5), nStep);
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeTierTwoTarget(nTotal, 800, true, 0.0, 0.5), nStep);
+
+    // After it, a step towards the cache missing the most
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeTierTwoTarget(nTotal, nStep, false, 0.01, 0.2), 2 * nStep);
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeTierTwoTarget(nTotal, 4 * nStep, false, 0.2, 0.01), 3 * nStep);
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeTierTwoTarget(nTotal, 4 * nStep, false, 0.0, 0.0), 4 * nStep);
+
+    // Within the bounds
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeTierTwoTarget(nTotal, nTotal / 2, false, 0.0, 0.2), nTotal / 2);
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeTierTwoTarget(nTotal, nStep, false, 0.2, 0.0), nStep);
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeTierTwoTarget(nTotal, 0, false, 0.0, 0.0), nStep);
+}
+
+BOOST_AUTO_TEST_CASE(cache_balancer_budgeted_total)
+{
+    // No budget, or a budget with room for everything
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeBudgetedTotal(1600, 0, 5000), 1600);
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeBudgetedTotal(1600, 3000, 1000), 1600);
+    // Only what the other components leave
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeBudgetedTotal(1600, 2000, 1000), 1000);
+    BOOST_CHECK_EQUAL(CCacheBalancer::ComputeBudgetedTotal(1600, 2000, 2500), 0);
+}
+
+BOOST_AUTO_TEST_CASE(coins_cache_hit_stats)
+{
+    CCoinsView base;
+    CCoinsViewCache cache(&base);
+    uint64_t nHits, nMisses;
+    const COutPoint outpoint(InsecureRand256(), 0);
+
+    // Not in the cache: looked up in the base view
+    BOOST_CHECK(!cache.HaveCoin(outpoint));
+    cache.GetCacheStats(nHits, nMisses);
+    BOOST_CHECK_EQUAL(nHits, 0U);
+    BOOST_CHECK_EQUAL(nMisses, 1U);
+
+    CScript script;
+    script << OP_TRUE;
+    cache.AddCoin(outpoint, Coin(CTxOut(COIN, script), 1, false, false), false);
+    BOOST_CHECK(cache.HaveCoin(outpoint));
+    cache.GetCacheStats(nHits, nMisses);
+    BOOST_CHECK_EQUAL(nHits, 1U);
+    BOOST_CHECK_EQUAL(nMisses, 1U);
+
+    // The prefetches are not counted as misses
+    cache.Prefetch({COutPoint(InsecureRand256(), 0)}, {}, 1);
+    cache.GetCacheStats(nHits, nMisses);
+    BOOST_CHECK_EQUAL(nHits, 1U);
+    BOOST_CHECK_EQUAL(nMisses, 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
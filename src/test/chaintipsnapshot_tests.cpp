@@ -0,0 +1,43 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "chaintipsnapshot.h"
+#include "consensus/validation.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(chaintipsnapshot_tests)
+
+BOOST_FIXTURE_TEST_CASE(snapshot_follows_tip, TestChain100Setup)
+{
+    const ChainTipSnapshotRef snapshot = GetChainTipSnapshot();
+    const CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainActive.Tip());
+    BOOST_CHECK(snapshot->pindexTip == pindexTip);
+    BOOST_CHECK_EQUAL(snapshot->Height(), pindexTip->nHeight);
+    BOOST_CHECK_EQUAL(snapshot->nBestHeaderHeight, pindexTip->nHeight);
+
+    // A connected block publishes a new snapshot, the previous one is unchanged
+    CreateAndProcessBlock({}, CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG);
+    const ChainTipSnapshotRef snapshotNext = GetChainTipSnapshot();
+    BOOST_CHECK_EQUAL(snapshotNext->Height(), pindexTip->nHeight + 1);
+    BOOST_CHECK(snapshotNext->pindexTip->pprev == pindexTip);
+    BOOST_CHECK(snapshot->pindexTip == pindexTip);
+
+    // And so does a disconnected one
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    BOOST_CHECK(GetChainTipSnapshot()->pindexTip == pindexTip);
+    BOOST_CHECK_EQUAL(GetChainTipSnapshot()->nBestHeaderHeight, pindexTip->nHeight + 1);
+
+    // No chainlock in the unit tests
+    BOOST_CHECK(!GetChainTipSnapshot()->HasChainLock(pindexTip));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
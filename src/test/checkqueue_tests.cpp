@@ -0,0 +1,146 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "checkqueue.h"
+#include "test/test_pivx.h"
+
+#include <thread>
+
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(checkqueue_tests, BasicTestingSetup)
+
+namespace {
+
+std::atomic<uint64_t> nChecksSum{0};
+
+struct SumCheck {
+    uint64_t nValue{0};
+    bool fOk{true};
+
+    SumCheck() {}
+    SumCheck(uint64_t nValueIn, bool fOkIn) : nValue(nValueIn), fOk(fOkIn) {}
+
+    bool operator()()
+    {
+        nChecksSum += nValue;
+        return fOk;
+    }
+
+    void swap(SumCheck& x)
+    {
+        std::swap(nValue, x.nValue);
+        std::swap(fOk, x.fOk);
+    }
+};
+
+void RunChecks(int nThreads)
+{
+    CCheckQueue<SumCheck> queue(128);
+    boost::thread_group threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.create_thread([&queue] { queue.Thread(); });
+    }
+
+    for (int nRound = 0; nRound < 200; nRound++) {
+        nChecksSum = 0;
+        uint64_t nExpected = 0;
+        // one failing check every few rounds, in the last batch added
+        const bool fFail = nRound % 5 == 3;
+        {
+            CCheckQueueControl<SumCheck> control(&queue);
+            for (int nAdd = 0; nAdd < 10; nAdd++) {
+                std::vector<SumCheck> vChecks;
+                for (int i = 0; i < (nAdd * 37 + nRound) % 50 + 1; i++) {
+                    vChecks.emplace_back(i + 1, !(fFail && nAdd == 9 && i == 0));
+                    nExpected += i + 1;
+                }
+                control.Add(vChecks);
+            }
+            BOOST_CHECK_EQUAL(control.Wait(), !fFail);
+        }
+        // after a failure, the remaining checks may be skipped
+        if (!fFail) BOOST_CHECK_EQUAL(nChecksSum, nExpected);
+        BOOST_CHECK(queue.IsIdle());
+    }
+
+    threads.interrupt_all();
+    threads.join_all();
+}
+
+struct CountCheck {
+    std::atomic<uint64_t>* pCount{nullptr};
+    bool fOk{true};
+
+    CountCheck() {}
+    CountCheck(std::atomic<uint64_t>* pCountIn, bool fOkIn) : pCount(pCountIn), fOk(fOkIn) {}
+
+    bool operator()()
+    {
+        (*pCount)++;
+        return fOk;
+    }
+
+    void swap(CountCheck& x)
+    {
+        std::swap(pCount, x.pCount);
+        std::swap(fOk, x.fOk);
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(checkqueue_no_workers)
+{
+    RunChecks(0);
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_workers)
+{
+    RunChecks(1);
+    RunChecks(4);
+    RunChecks(16);
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_concurrent_controls)
+{
+    CCheckQueue<CountCheck> queue(16);
+    boost::thread_group threads;
+    for (int i = 0; i < 4; i++) {
+        threads.create_thread([&queue] { queue.Thread(); });
+    }
+
+    // The masters take turns: each one gets the result of its own checks only
+    std::atomic<int> nErrors{0};
+    std::vector<std::thread> masters;
+    for (int nMaster = 0; nMaster < 4; nMaster++) {
+        masters.emplace_back([&queue, &nErrors, nMaster] {
+            for (int nRound = 0; nRound < 50; nRound++) {
+                std::atomic<uint64_t> nCount{0};
+                const bool fFail = nMaster == 0 && nRound % 5 == 3;
+                {
+                    CCheckQueueControl<CountCheck> control(&queue);
+                    std::vector<CountCheck> vChecks;
+                    for (int i = 0; i < 100; i++) {
+                        vChecks.emplace_back(&nCount, !(fFail && i == 99));
+                    }
+                    control.Add(vChecks);
+                    if (control.Wait() == fFail) nErrors++;
+                }
+                if (!fFail && nCount != 100) nErrors++;
+            }
+        });
+    }
+    for (std::thread& master : masters) {
+        master.join();
+    }
+    BOOST_CHECK_EQUAL(nErrors, 0);
+    BOOST_CHECK(queue.IsIdle());
+
+    threads.interrupt_all();
+    threads.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
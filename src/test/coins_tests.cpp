@@ -7,6 +7,7 @@
 
 #include "coins.h"
 #include "script/standard.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "undo.h"
 #include "utilstrencodings.h"
@@ -31,7 +32,7 @@ bool operator==(const Coin &a, const Coin &b) {
     return a.fCoinBase == b.fCoinBase &&
            a.fCoinStake == b.fCoinStake &&
            a.nHeight == b.nHeight &&
-           a.out == b.out;
+           a.GetTxOut() == b.GetTxOut();
 }
 
 class CCoinsViewTest : public CCoinsView
@@ -144,7 +145,8 @@ public:
                     const uint256& hashBlock,
                     const uint256& hashSaplingAnchor,
                     CAnchorsSaplingMap& mapSaplingAnchors,
-                    CNullifiersMap& mapSaplingNullifiers)
+                    CNullifiersMap& mapSaplingNullifiers,
+                    bool erase = true)
     {
         for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ) {
             if (it->second.flags & CCoinsCacheEntry::DIRTY) {
@@ -155,7 +157,7 @@ public:
                     map_.erase(it->first);
                 }
             }
-            mapCoins.erase(it++);
+            it = erase ? mapCoins.erase(it) : std::next(it);
         }
 
         BatchWriteAnchors<SaplingMerkleTree, CAnchorsSaplingMap, CAnchorsSaplingCacheEntry>(mapSaplingAnchors, mapSaplingAnchors_);
@@ -661,14 +663,17 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
             BOOST_CHECK(coin == entry);
             if (InsecureRandRange(5) == 0 || coin.IsSpent()) {
                 Coin newcoin;
-                newcoin.out.nValue = InsecureRand32();
+                CScript scriptPubKey;
+                newcoin.nValue = InsecureRand32();
                 newcoin.nHeight = 1;
                 if (InsecureRandRange(16) == 0 && coin.IsSpent()) {
-                    newcoin.out.scriptPubKey.assign(1 + (InsecureRand32() & 0x3F), OP_RETURN);
-                    BOOST_CHECK(newcoin.out.scriptPubKey.IsUnspendable());
+                    scriptPubKey.assign(1 + (InsecureRand32() & 0x3F), OP_RETURN);
+                    newcoin.SetScriptPubKey(scriptPubKey);
+                    BOOST_CHECK(newcoin.GetScriptPubKey().IsUnspendable());
                     added_an_unspendable_entry = true;
                 } else {
-                    newcoin.out.scriptPubKey.assign(InsecureRand32() & 0x3F, 0); // Random sizes so we can test memory usage accounting
+                    scriptPubKey.assign(InsecureRand32() & 0x3F, 0); // Random sizes so we can test memory usage accounting
+                    newcoin.SetScriptPubKey(scriptPubKey);
                     (coin.IsSpent() ? added_an_entry : updated_an_entry) = true;
                     coin = newcoin;
                 }
@@ -941,8 +946,8 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     CDataStream ss1(ParseHex("00835800816115944e077fe7c803cfa57f29b36bf87c1d35"), SER_DISK, CLIENT_VERSION);
     Coin cc1;
     ss1 >> cc1;
-    BOOST_CHECK_EQUAL(cc1.out.nValue, 60000000000ULL);
-    BOOST_CHECK_EQUAL(HexStr(cc1.out.scriptPubKey), HexStr(GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))))));
+    BOOST_CHECK_EQUAL(cc1.nValue, 60000000000ULL);
+    BOOST_CHECK_EQUAL(HexStr(cc1.GetScriptPubKey()), HexStr(GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))))));
 
     // Good example
     CDataStream ss2(ParseHex("8dcb7ebbd123008c988f1a4a4de2161e0f50aac7f17e7f9555caa4"), SER_DISK, CLIENT_VERSION);
@@ -950,8 +955,8 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     ss2 >> cc2;
     BOOST_CHECK_EQUAL(cc2.fCoinBase, true);
     BOOST_CHECK_EQUAL(cc2.nHeight, 59807);
-    BOOST_CHECK_EQUAL(cc2.out.nValue, 110397);
-    BOOST_CHECK_EQUAL(HexStr(cc2.out.scriptPubKey), HexStr(GetScriptForDestination(CKeyID(uint160(ParseHex("8c988f1a4a4de2161e0f50aac7f17e7f9555caa4"))))));
+    BOOST_CHECK_EQUAL(cc2.nValue, 110397);
+    BOOST_CHECK_EQUAL(HexStr(cc2.GetScriptPubKey()), HexStr(GetScriptForDestination(CKeyID(uint160(ParseHex("8c988f1a4a4de2161e0f50aac7f17e7f9555caa4"))))));
 
     // PIVX: Example with fCoinStake
     CDataStream ss2b(ParseHex("97b401808b63008c988f1a4a4de2161e0f50aac7f17e7f9555caa4"), SER_DISK, CLIENT_VERSION);
@@ -960,8 +965,8 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     BOOST_CHECK_EQUAL(cc2b.fCoinBase, false);
     BOOST_CHECK_EQUAL(cc2b.fCoinStake, true);
     BOOST_CHECK_EQUAL(cc2b.nHeight, 100000);
-    BOOST_CHECK_EQUAL(cc2b.out.nValue, 2002 * COIN);
-    BOOST_CHECK_EQUAL(HexStr(cc2b.out.scriptPubKey), HexStr(GetScriptForDestination(CKeyID(uint160(ParseHex("8c988f1a4a4de2161e0f50aac7f17e7f9555caa4"))))));
+    BOOST_CHECK_EQUAL(cc2b.nValue, 2002 * COIN);
+    BOOST_CHECK_EQUAL(HexStr(cc2b.GetScriptPubKey()), HexStr(GetScriptForDestination(CKeyID(uint160(ParseHex("8c988f1a4a4de2161e0f50aac7f17e7f9555caa4"))))));
 
     // Smallest possible example
     CDataStream ss3(ParseHex("000006"), SER_DISK, CLIENT_VERSION);
@@ -969,8 +974,8 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     ss3 >> cc3;
     BOOST_CHECK_EQUAL(cc3.fCoinBase, false);
     BOOST_CHECK_EQUAL(cc3.nHeight, 0);
-    BOOST_CHECK_EQUAL(cc3.out.nValue, 0);
-    BOOST_CHECK_EQUAL(cc3.out.scriptPubKey.size(), 0);
+    BOOST_CHECK_EQUAL(cc3.nValue, 0);
+    BOOST_CHECK_EQUAL(cc3.GetScriptPubKey().size(), 0);
 
     // scriptPubKey that ends beyond the end of the stream
     CDataStream ss4(ParseHex("000007"), SER_DISK, CLIENT_VERSION);
@@ -995,6 +1000,54 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_compressed_script)
+{
+    const CKeyID stakerId(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35")));
+    const CKeyID ownerId(uint160(ParseHex("8c988f1a4a4de2161e0f50aac7f17e7f9555caa4")));
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptLong;
+    scriptLong.assign(MAX_SCRIPT_SIZE + 1, OP_NOP);
+
+    // The scripts of the common templates are held inline (P2CS compressed), and read back as they are
+    const std::vector<CScript> vScripts{
+        GetScriptForDestination(ownerId),
+        GetScriptForDestination(CScriptID(GetScriptForDestination(ownerId))),
+        GetScriptForRawPubKey(key.GetPubKey()),
+        GetScriptForStakeDelegation(stakerId, ownerId),
+        GetScriptForStakeDelegationLOF(stakerId, ownerId),
+        CScript()};
+    for (const CScript& script : vScripts) {
+        Coin coin(CTxOut(COIN, script), 1, false, false);
+        BOOST_CHECK_EQUAL(coin.DynamicMemoryUsage(), 0);
+        BOOST_CHECK(coin.GetScriptPubKey() == script);
+        BOOST_CHECK(coin.GetTxOut() == CTxOut(COIN, script));
+
+        // the serialization is unchanged
+        const uint32_t nCode = 1 * 4; // height 1, neither coinbase nor coinstake
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        CDataStream ssExpected(SER_DISK, CLIENT_VERSION);
+        ss << coin;
+        ssExpected << VARINT(nCode) << Using<TxOutCompression>(CTxOut(COIN, script));
+        BOOST_CHECK_EQUAL(HexStr(ss), HexStr(ssExpected));
+        Coin coin2;
+        ss >> coin2;
+        BOOST_CHECK(coin2.GetScriptPubKey() == script);
+    }
+    BOOST_CHECK(Coin(CTxOut(COIN, GetScriptForStakeDelegationLOF(stakerId, ownerId)), 1, false, false).GetScriptPubKey().IsPayToColdStakingLOF());
+
+    // The other scripts are stored as they are, on the heap above the inline size
+    CScript scriptMultisig = GetScriptForMultisig(1, {key.GetPubKey(), key.GetPubKey()});
+    Coin coinMultisig(CTxOut(COIN, scriptMultisig), 1, false, false);
+    BOOST_CHECK(coinMultisig.DynamicMemoryUsage() > 0);
+    BOOST_CHECK(coinMultisig.GetScriptPubKey() == scriptMultisig);
+
+    // The overly long scripts (unspendable) are replaced with a short invalid one
+    Coin coinLong(CTxOut(COIN, scriptLong), 1, false, false);
+    BOOST_CHECK(coinLong.GetScriptPubKey() == CScript() << OP_RETURN);
+    BOOST_CHECK_EQUAL(coinLong.DynamicMemoryUsage(), 0);
+}
+
 const static COutPoint OUTPOINT;
 const static CAmount PRUNED = -1;
 const static CAmount ABSENT = -2;
@@ -1016,7 +1069,7 @@ void SetCoinsValue(CAmount value, Coin& coin)
     coin.Clear();
     assert(coin.IsSpent());
     if (value != PRUNED) {
-        coin.out.nValue = value;
+        coin.nValue = value;
         coin.nHeight = 1;
         assert(!coin.IsSpent());
     }
@@ -1047,7 +1100,7 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
         if (it->second.coin.IsSpent()) {
             value = PRUNED;
         } else {
-            value = it->second.coin.out.nValue;
+            value = it->second.coin.nValue;
         }
         flags = it->second.flags;
         assert(flags != NO_ENTRY);
@@ -1056,7 +1109,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
     InsertCoinsMapEntry(map, value, flags);
     CAnchorsSaplingMap mapSaplingAnchors;
     CNullifiersMap mapSaplingNullifiers;
@@ -1320,4 +1374,207 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_sync)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    CCoinsViewCacheTest cache(&db);
+    const COutPoint outKept(InsecureRand256(), 0);
+    const COutPoint outSpent(InsecureRand256(), 1);
+    const CTxOut out(InsecureRand32(), CScript() << OP_TRUE);
+    cache.AddCoin(outKept, Coin(out, 1, false, false), false);
+    cache.AddCoin(outSpent, Coin(out, 1, false, false), false);
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache.Flush());
+
+    // A child cache spends a coin and adds another one, then syncs to the parent without losing its coins
+    const COutPoint outNew(InsecureRand256(), 2);
+    {
+        CCoinsViewCacheTest child(&cache);
+        child.SpendCoin(outSpent);
+        child.AddCoin(outNew, Coin(out, 2, false, false), false);
+        BOOST_CHECK(child.Sync());
+        child.SelfTest();
+        BOOST_CHECK(child.HaveCoinInCache(outNew));
+        BOOST_CHECK(!child.HaveCoinInCache(outSpent));
+        BOOST_CHECK_EQUAL(child.map().at(outNew).flags, 0);
+    }
+    BOOST_CHECK(cache.AccessCoin(outNew).GetTxOut() == out);
+    BOOST_CHECK(cache.AccessCoin(outSpent).IsSpent());
+
+    // The coins are written to the db, the unspent ones kept in the cache, clean
+    BOOST_CHECK(cache.Sync());
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 2);
+    BOOST_CHECK(cache.HaveCoinInCache(outKept) && cache.HaveCoinInCache(outNew));
+    BOOST_CHECK(!cache.HaveCoinInCache(outSpent));
+    for (const auto& entry : cache.map()) {
+        BOOST_CHECK_EQUAL(entry.second.flags, 0);
+    }
+    BOOST_CHECK(db.HaveCoin(outKept) && db.HaveCoin(outNew));
+    BOOST_CHECK(!db.HaveCoin(outSpent));
+    BOOST_CHECK(db.GetBestBlock() == cache.GetBestBlock());
+
+    // The clean entries can still be uncached, unlike the modified ones
+    cache.Uncache(outKept);
+    BOOST_CHECK(!cache.HaveCoinInCache(outKept));
+    BOOST_CHECK(cache.HaveCoin(outKept));
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_prefetch)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    const CTxOut out(InsecureRand32(), CScript() << OP_TRUE);
+    std::vector<COutPoint> vOutpoints;
+    {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 100; i++) {
+            vOutpoints.emplace_back(InsecureRand256(), i);
+            cache.AddCoin(vOutpoints.back(), Coin(out, i, false, false), false);
+        }
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(cache.Flush());
+    }
+    const uint256 nfSpent = InsecureRand256();
+    const uint256 nfUnspent = InsecureRand256();
+    {
+        CCoinsMapMemoryResource resource;
+        CCoinsMap mapCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
+        CAnchorsSaplingMap mapAnchors;
+        CNullifiersMap mapNullifiers;
+        mapNullifiers[nfSpent].entered = true;
+        mapNullifiers[nfSpent].flags = CNullifiersCacheEntry::DIRTY;
+        BOOST_CHECK(db.BatchWrite(mapCoins, InsecureRand256(), UINT256_ZERO, mapAnchors, mapNullifiers));
+    }
+
+    CCoinsViewCacheTest cache(&db);
+    // A coin modified in the cache is not read again
+    cache.SpendCoin(vOutpoints[0]);
+    const COutPoint outMissing(InsecureRand256(), 0);
+    std::vector<COutPoint> vPrefetch(vOutpoints);
+    vPrefetch.emplace_back(outMissing);
+    cache.Prefetch(vPrefetch, {nfSpent, nfUnspent}, 4);
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), vOutpoints.size());
+    BOOST_CHECK(cache.AccessCoin(vOutpoints[0]).IsSpent());
+    for (size_t i = 1; i < vOutpoints.size(); i++) {
+        BOOST_CHECK(cache.HaveCoinInCache(vOutpoints[i]));
+        BOOST_CHECK_EQUAL(cache.map().at(vOutpoints[i]).flags, 0);
+        BOOST_CHECK(cache.AccessCoin(vOutpoints[i]).GetTxOut() == out);
+    }
+    BOOST_CHECK(!cache.HaveCoinInCache(outMissing));
+    BOOST_CHECK(cache.GetNullifier(nfSpent));
+    BOOST_CHECK(!cache.GetNullifier(nfUnspent));
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_prefetch_unlocked)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    const CTxOut out(InsecureRand32(), CScript() << OP_TRUE);
+    std::vector<COutPoint> vOutpoints;
+    {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 10; i++) {
+            vOutpoints.emplace_back(InsecureRand256(), i);
+            cache.AddCoin(vOutpoints.back(), Coin(out, i, false, false), false);
+        }
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(cache.Flush());
+    }
+
+    CCoinsViewCacheTest cache(&db);
+    CCoinsPrefetch prefetch;
+    cache.PreparePrefetch(vOutpoints, {}, prefetch);
+    BOOST_CHECK_EQUAL(prefetch.vOutpoints.size(), vOutpoints.size());
+    prefetch.Read(db, 2);
+    // Modified by the cache between the reads and the insertion: the cache entry is kept
+    cache.SpendCoin(vOutpoints[0]);
+    cache.InsertPrefetch(prefetch);
+    cache.SelfTest();
+    BOOST_CHECK(cache.AccessCoin(vOutpoints[0]).IsSpent());
+    for (size_t i = 1; i < vOutpoints.size(); i++) {
+        BOOST_CHECK(cache.HaveCoinInCache(vOutpoints[i]));
+    }
+
+    // Written to the database between the reads and the insertion: the reads are stale
+    cache.Uncache(vOutpoints[1]);
+    cache.PreparePrefetch(vOutpoints, {}, prefetch);
+    BOOST_CHECK_EQUAL(prefetch.vOutpoints.size(), 1);
+    prefetch.Read(db, 2);
+    cache.SpendCoin(vOutpoints[1]);
+    BOOST_CHECK(cache.Sync());
+    cache.InsertPrefetch(prefetch);
+    BOOST_CHECK(!cache.HaveCoinInCache(vOutpoints[1]));
+    BOOST_CHECK(!cache.HaveCoin(vOutpoints[1]));
+}
+
+static void WriteSaplingToDB(CCoinsViewDB& db, const std::vector<uint256>& nullifiers, bool spent, const SaplingMerkleTree* tree = nullptr)
+{
+    CCoinsMapMemoryResource resource;
+    CCoinsMap mapCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
+    CAnchorsSaplingMap mapAnchors;
+    CNullifiersMap mapNullifiers;
+    for (const uint256& nf : nullifiers) {
+        CNullifiersCacheEntry& entry = mapNullifiers[nf];
+        entry.entered = spent;
+        entry.flags = CNullifiersCacheEntry::DIRTY;
+    }
+    uint256 bestAnchor;
+    if (tree) {
+        bestAnchor = tree->root();
+        CAnchorsSaplingCacheEntry& entry = mapAnchors[bestAnchor];
+        entry.entered = true;
+        entry.tree = *tree;
+        entry.flags = CAnchorsSaplingCacheEntry::DIRTY;
+    }
+    BOOST_CHECK(db.BatchWrite(mapCoins, InsecureRand256(), bestAnchor, mapAnchors, mapNullifiers));
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_db_sapling_cache)
+{
+    CCoinsViewDB db(1 << 20, true, true, 1 << 20);
+    BOOST_CHECK(db.SaplingCacheUsage() > 0);
+
+    // Unknown nullifiers and anchors
+    const uint256 nf = InsecureRand256();
+    BOOST_CHECK(!db.GetNullifier(nf));
+    SaplingMerkleTree tree;
+    tree.append(InsecureRand256());
+    SaplingMerkleTree treeRead;
+    BOOST_CHECK(!db.GetSaplingAnchorAt(tree.root(), treeRead));
+
+    WriteSaplingToDB(db, {nf}, true, &tree);
+    BOOST_CHECK(db.GetNullifier(nf));
+    BOOST_CHECK(!db.GetNullifier(InsecureRand256()));
+    BOOST_CHECK(db.GetSaplingAnchorAt(tree.root(), treeRead));
+    BOOST_CHECK(treeRead == tree);
+    BOOST_CHECK(db.GetBestAnchor() == tree.root());
+
+    // Enough nullifiers to rebuild the filter
+    std::vector<uint256> nullifiers;
+    for (int i = 0; i < 100000; i++) {
+        nullifiers.emplace_back(InsecureRand256());
+    }
+    const size_t usage = db.SaplingCacheUsage();
+    WriteSaplingToDB(db, nullifiers, true);
+    BOOST_CHECK(db.SaplingCacheUsage() > usage);
+    BOOST_CHECK(db.GetNullifier(nf));
+    for (const uint256& n : nullifiers) {
+        BOOST_CHECK(db.GetNullifier(n));
+    }
+    for (int i = 0; i < 1000; i++) {
+        BOOST_CHECK(!db.GetNullifier(InsecureRand256()));
+    }
+
+    // Erased nullifiers are no longer found, even if still in the filter
+    WriteSaplingToDB(db, {nf}, false);
+    BOOST_CHECK(!db.GetNullifier(nf));
+
+    // Without cache
+    CCoinsViewDB db2(1 << 20, true, true);
+    BOOST_CHECK_EQUAL(db2.SaplingCacheUsage(), 0);
+    WriteSaplingToDB(db2, {nf}, true, &tree);
+    BOOST_CHECK(db2.GetNullifier(nf));
+    BOOST_CHECK(db2.GetSaplingAnchorAt(tree.root(), treeRead));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,97 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "index/compactsaplingindex.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(compactsaplingindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(compact_sapling_block, BasicTestingSetup)
+{
+    CBlock block;
+    block.nTime = 1234567;
+    block.hashPrevBlock = GetRandHash();
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.resize(1);
+    block.vtx.emplace_back(MakeTransactionRef(coinbase));
+
+    CMutableTransaction shielded;
+    shielded.nVersion = CTransaction::TxVersion::SAPLING;
+    shielded.sapData->vShieldedSpend.resize(1);
+    shielded.sapData->vShieldedSpend[0].nullifier = GetRandHash();
+    shielded.sapData->vShieldedOutput.resize(2);
+    for (OutputDescription& output : shielded.sapData->vShieldedOutput) {
+        output.cmu = GetRandHash();
+        output.ephemeralKey = GetRandHash();
+        GetRandBytes(output.encCiphertext.data(), output.encCiphertext.size());
+    }
+    block.vtx.emplace_back(MakeTransactionRef(shielded));
+
+    const CCompactSaplingBlock compactBlock = MakeCompactSaplingBlock(block, 42);
+    BOOST_CHECK_EQUAL(compactBlock.nHeight, 42);
+    BOOST_CHECK(compactBlock.hash == block.GetHash());
+    BOOST_CHECK(compactBlock.hashPrevBlock == block.hashPrevBlock);
+    BOOST_CHECK_EQUAL(compactBlock.nTime, block.nTime);
+    // the transparent transactions are left out
+    BOOST_REQUIRE_EQUAL(compactBlock.vtx.size(), 1);
+    const CCompactSaplingTx& ctx = compactBlock.vtx[0];
+    BOOST_CHECK_EQUAL(ctx.nIndex, 1);
+    BOOST_CHECK(ctx.txid == block.vtx[1]->GetHash());
+    BOOST_REQUIRE_EQUAL(ctx.vNullifiers.size(), 1);
+    BOOST_CHECK(ctx.vNullifiers[0] == shielded.sapData->vShieldedSpend[0].nullifier);
+    BOOST_REQUIRE_EQUAL(ctx.vOutputs.size(), 2);
+    for (size_t i = 0; i < ctx.vOutputs.size(); i++) {
+        const OutputDescription& output = shielded.sapData->vShieldedOutput[i];
+        BOOST_CHECK(ctx.vOutputs[i].cmu == output.cmu);
+        BOOST_CHECK(ctx.vOutputs[i].ephemeralKey == output.ephemeralKey);
+        BOOST_CHECK(std::equal(ctx.vOutputs[i].encCiphertext.begin(), ctx.vOutputs[i].encCiphertext.end(), output.encCiphertext.begin()));
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << compactBlock;
+    // a fraction of the block (the proofs, signatures, memos and out ciphertexts are left out)
+    BOOST_CHECK_LT(ss.size() * 4, ::GetSerializeSize(block, PROTOCOL_VERSION));
+    CCompactSaplingBlock compactBlock2;
+    ss >> compactBlock2;
+    BOOST_CHECK(compactBlock2.hash == compactBlock.hash);
+    BOOST_REQUIRE_EQUAL(compactBlock2.vtx.size(), 1);
+    BOOST_CHECK(compactBlock2.vtx[0].vOutputs[1].cmu == ctx.vOutputs[1].cmu);
+
+    // No compact block for the blocks without shielded transactions
+    block.vtx.pop_back();
+    BOOST_CHECK(MakeCompactSaplingBlock(block, 42).vtx.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(compactsaplingindex_sync, TestChain100Setup)
+{
+    CompactSaplingIndex index(1 << 20, true);
+    index.Start();
+
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+    BOOST_CHECK(index.GetBestBlockIndex() == WITH_LOCK(cs_main, return chainActive.Tip()));
+
+    // The chain has no shielded transactions
+    std::vector<CDataStream> blocks;
+    BOOST_CHECK(index.FindBlocks(0, chainActive.Height(), blocks));
+    BOOST_CHECK(blocks.empty());
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
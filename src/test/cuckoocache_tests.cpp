@@ -365,4 +365,29 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+BOOST_AUTO_TEST_CASE(verified_result_cache_partitions)
+{
+    const size_t nUsage = GetSignatureCacheMemoryUsage();
+    {
+        gArgs.ForceSetArg("-testpartitionsize", "1");
+        CVerifiedResultCache cache1("test partition", "testpartitionsize", 0, 2);
+        CVerifiedResultCache cache2("other test partition", "othertestpartitionsize", 0, 2);
+        cache1.Init();
+        cache2.Init();
+        // Sized independently (cache2 gets the minimum), accounted together
+        BOOST_CHECK(cache1.DynamicMemoryUsage() > cache2.DynamicMemoryUsage());
+        BOOST_CHECK(cache1.DynamicMemoryUsage() <= (1 << 20));
+        BOOST_CHECK_EQUAL(GetSignatureCacheMemoryUsage(), nUsage + cache1.DynamicMemoryUsage() + cache2.DynamicMemoryUsage());
+        BOOST_CHECK(cache1.GetNonce() != cache2.GetNonce());
+
+        uint256 entry = InsecureRand256();
+        BOOST_CHECK(!cache1.Get(entry, false));
+        cache1.Set(entry);
+        BOOST_CHECK(cache1.Get(entry, false));
+        BOOST_CHECK(!cache2.Get(entry, false));
+    }
+    // The destroyed partitions are not accounted anymore
+    BOOST_CHECK_EQUAL(GetSignatureCacheMemoryUsage(), nUsage);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
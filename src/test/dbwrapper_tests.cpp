@@ -37,6 +37,73 @@ BOOST_AUTO_TEST_CASE(dbwrapper)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_options)
+{
+    fs::path ph = SetDataDir(std::string("dbwrapper_options"));
+    CDBOptions dbOptions("dbwrapper_options");
+    dbOptions.fCompression = true;
+    dbOptions.nBlockSize = 16 * 1024;
+    dbOptions.nBloomBits = 16;
+    dbOptions.nBlockCachePercent = 25;
+    CDBWrapper dbw(ph, (1 << 20), true, false, CLIENT_VERSION, dbOptions);
+
+    // The cache is split between the block cache and the two write buffers
+    BOOST_CHECK_EQUAL(dbw.GetBlockCacheSize(), (1 << 20) / 4);
+    BOOST_CHECK_EQUAL(dbw.GetWriteBufferSize(), (1 << 20) * 3 / 8);
+
+    // The data is read back, whether or not snappy is available
+    std::vector<unsigned char> in(1024, 'x'), res;
+    BOOST_CHECK(dbw.Write('k', in));
+    BOOST_CHECK(dbw.Read('k', res));
+    BOOST_CHECK(res == in);
+    BOOST_CHECK(dbw.DynamicMemoryUsage() > 0);
+
+    // The database is reported while it is open
+    bool fFound = false;
+    ForEachDBWrapper([&fFound](const CDBWrapper& db) {
+        if (db.GetDBOptions().strName == "dbwrapper_options") fFound = true;
+    });
+    BOOST_CHECK(fFound);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_compact_next_ranges)
+{
+    fs::path ph = SetDataDir(std::string("dbwrapper_compact_next_ranges"));
+    CDBWrapper dbw(ph, (1 << 20), true, false);
+
+    // Two ranges of keys, flushed to the table files
+    const std::vector<unsigned char> value(1000, 'x');
+    for (uint32_t i = 0; i < 100; i++) {
+        BOOST_CHECK(dbw.Write(std::make_pair('a', i), value));
+        BOOST_CHECK(dbw.Write(std::make_pair('b', i), value));
+    }
+    dbw.CompactFull();
+
+    const size_t nSizeA = dbw.EstimateSize('a', 'b');
+    BOOST_REQUIRE(nSizeA > 0);
+
+    // A budget bigger than the ranges compacts them whole, and goes through the whole database
+    BOOST_CHECK(dbw.CompactNextRanges(1 << 30) >= nSizeA);
+    CDBCompactionStats stats = dbw.GetCompactionStats();
+    BOOST_CHECK_EQUAL(stats.nRanges, 2);
+    BOOST_CHECK_EQUAL(stats.nNextRange, 0);
+    BOOST_CHECK(!stats.fSplitRange);
+    BOOST_CHECK(stats.nLastTime > 0);
+
+    // A range bigger than the budget is compacted in ranges of two bytes, over the calls
+    BOOST_CHECK(dbw.CompactNextRanges(nSizeA / 2) > 0);
+    stats = dbw.GetCompactionStats();
+    BOOST_CHECK(stats.fSplitRange);
+    BOOST_CHECK_EQUAL(stats.nNextRange >> 8, 'a');
+
+    // The data is left untouched
+    std::vector<unsigned char> res;
+    for (uint32_t i = 0; i < 100; i++) {
+        BOOST_CHECK(dbw.Read(std::make_pair('a', i), res) && res == value);
+        BOOST_CHECK(dbw.Read(std::make_pair('b', i), res) && res == value);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(dbwrapper_basic_data)
 {
     fs::path ph = SetDataDir(std::string("dbwrapper_basic_data"));
@@ -313,6 +380,63 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbtransaction_nested_commit)
+{
+    typedef CDBTransaction<CDBWrapper, CDBBatch> RootTransaction;
+    typedef CDBTransaction<RootTransaction, RootTransaction> CurTransaction;
 
+    fs::path ph = SetDataDir(std::string("dbtransaction_nested_commit"));
+    CDBWrapper dbw(ph, (1 << 20), true, false);
+    BOOST_CHECK(dbw.Write('a', (uint32_t)1));
+    BOOST_CHECK(dbw.Write('b', (uint32_t)2));
+
+    CDBBatch rootBatch(CLIENT_VERSION);
+    RootTransaction rootTx(dbw, rootBatch, CLIENT_VERSION);
+    CurTransaction curTx(rootTx, rootTx, CLIENT_VERSION);
+    uint32_t value;
+
+    // A clean parent takes the changes as a whole
+    curTx.Write('c', (uint32_t)3);
+    curTx.Erase('a');
+    const size_t nCurUsage = curTx.GetMemoryUsage();
+    curTx.Commit();
+    BOOST_CHECK(curTx.IsClean());
+    BOOST_CHECK_EQUAL(curTx.GetMemoryUsage(), 0);
+    BOOST_CHECK_EQUAL(rootTx.GetMemoryUsage(), nCurUsage);
+    BOOST_CHECK(rootTx.Read('c', value) && value == 3);
+    BOOST_CHECK(!rootTx.Exists('a'));
+
+    // The changes override the ones of the parent
+    curTx.Write('a', (uint32_t)4);
+    curTx.Erase('c');
+    curTx.Write('b', (uint32_t)5);
+    curTx.Commit();
+    BOOST_CHECK(rootTx.Read('a', value) && value == 4);
+    BOOST_CHECK(!rootTx.Exists('c'));
+    BOOST_CHECK(rootTx.Read('b', value) && value == 5);
+
+    // The accounting matches the one of writing the same changes directly
+    RootTransaction expectedTx(dbw, rootBatch, CLIENT_VERSION);
+    expectedTx.Write('c', (uint32_t)3);
+    expectedTx.Erase('a');
+    expectedTx.Write('a', (uint32_t)4);
+    expectedTx.Erase('c');
+    expectedTx.Write('b', (uint32_t)5);
+    BOOST_CHECK_EQUAL(rootTx.GetMemoryUsage(), expectedTx.GetMemoryUsage());
+    expectedTx.Clear();
+
+    // A rollback leaves the parent untouched
+    curTx.Write('a', (uint32_t)6);
+    curTx.Clear();
+    BOOST_CHECK(rootTx.Read('a', value) && value == 4);
+
+    // The root commit writes to the batch
+    rootTx.Commit();
+    BOOST_CHECK(rootTx.IsClean());
+    BOOST_CHECK(dbw.WriteBatch(rootBatch));
+    BOOST_CHECK(dbw.Read('a', value) && value == 4);
+    BOOST_CHECK(dbw.Read('b', value) && value == 5);
+    BOOST_CHECK(!dbw.Exists('c'));
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -427,7 +427,7 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         BOOST_CHECK_EQUAL(chainTip->nHeight, ++nHeight);
         Coin coll_coin;
         BOOST_CHECK(view->GetUTXOCoin(coll_out, coll_coin));
-        BOOST_CHECK_EQUAL(coll_coin.out.nValue, Params().GetConsensus().nMNCollateralAmt-1);
+        BOOST_CHECK_EQUAL(coll_coin.nValue, Params().GetConsensus().nMNCollateralAmt-1);
 
         // create the ProReg tx referencing the invalid collateral
         auto tx = CreateProRegTx(Optional<COutPoint>(coll_out), utxos, port, GenerateRandomAddress(), coinbaseKey, GetRandomKey(), GetRandomBLSKey().GetPublicKey());
@@ -436,7 +436,7 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-protx-collateral-amount");
 
         // add the coin back to the utxo map
-        utxos.emplace(coll_out, std::make_pair(coll_coin.nHeight, coll_coin.out.nValue));
+        utxos.emplace(coll_out, std::make_pair(coll_coin.nHeight, coll_coin.nValue));
     }
     // Try to register with spent external collateral
     {
@@ -448,7 +448,7 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         BOOST_CHECK_EQUAL(chainTip->nHeight, ++nHeight);
         Coin coll_coin;
         BOOST_CHECK(view->GetUTXOCoin(coll_out, coll_coin));
-        BOOST_CHECK_EQUAL(coll_coin.out.nValue, Params().GetConsensus().nMNCollateralAmt);
+        BOOST_CHECK_EQUAL(coll_coin.nValue, Params().GetConsensus().nMNCollateralAmt);
 
         // spend it
         CMutableTransaction spendTx;
@@ -486,7 +486,7 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         BOOST_CHECK_EQUAL(chainTip->nHeight, ++nHeight);
         Coin coll_coin;
         BOOST_CHECK(view->GetUTXOCoin(coll_out, coll_coin));
-        BOOST_CHECK_EQUAL(coll_coin.out.nValue, Params().GetConsensus().nMNCollateralAmt);
+        BOOST_CHECK_EQUAL(coll_coin.nValue, Params().GetConsensus().nMNCollateralAmt);
 
         // create the ProReg tx reusing the collateral key
         auto tx = CreateProRegTx(Optional<COutPoint>(coll_out), utxos, port, GenerateRandomAddress(), coinbaseKey, coll_key, GetRandomBLSKey().GetPublicKey());
@@ -610,6 +610,24 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
     // 30 blocks, 15 masternodes. Must have been paid exactly 2 times each.
     CheckPayments(mapPayments, 15, 2);
 
+    // The compact encoding of the snapshots gives back the same list, in less space
+    {
+        auto mnList = deterministicMNManager->GetListAtChainTip();
+        CDataStream ssFull(SER_DISK, CLIENT_VERSION), ssCompact(SER_DISK, CLIENT_VERSION);
+        ssFull << mnList;
+        mnList.SerializeCompact(ssCompact);
+        BOOST_CHECK_LT(ssCompact.size(), ssFull.size());
+        CDeterministicMNList mnListRead;
+        mnListRead.UnserializeCompact(ssCompact);
+        BOOST_CHECK(ssCompact.empty());
+        BOOST_CHECK(mnListRead.GetBlockHash() == mnList.GetBlockHash());
+        BOOST_CHECK_EQUAL(mnListRead.GetHeight(), mnList.GetHeight());
+        BOOST_CHECK_EQUAL(mnListRead.GetTotalRegisteredCount(), mnList.GetTotalRegisteredCount());
+        BOOST_CHECK_EQUAL(mnListRead.GetAllMNsCount(), mnList.GetAllMNsCount());
+        BOOST_CHECK(!mnList.BuildDiff(mnListRead).HasChanges());
+        BOOST_CHECK(mnListRead.GetMNPayee()->proTxHash == mnList.GetMNPayee()->proTxHash);
+    }
+
     // Check that the prev DMN winner is different that the tip one
     std::vector<CTxOut> vecMnOutsPrev;
     BOOST_CHECK(masternodePayments.GetMasternodeTxOuts(chainTip->pprev, vecMnOutsPrev));
@@ -910,6 +928,23 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChain400Setup)
         BOOST_CHECK_EQUAL(dmn->pdmnState->nPoSeBanHeight, nHeight);
     }
 
+    // The lists cache counts only the nodes it keeps alive: a map held outside of it doesn't
+    // make it drop its lists
+    {
+        CDeterministicMNList::MnInternalIdMap external;
+        for (uint64_t i = 0; i < 1000; i++) {
+            external = external.set(i, GetRandHash());
+        }
+        const CDeterministicMNManager::CacheStats stats = deterministicMNManager->GetCacheStats();
+        BOOST_CHECK(stats.nLists > 0);
+        BOOST_CHECK(stats.nListsUsage < stats.nListsNodesUsage);
+        deterministicMNManager->TrimCache(stats.nListsUsage + stats.nCacheUsage);
+        BOOST_CHECK_EQUAL(deterministicMNManager->GetCacheStats().nLists, stats.nLists);
+        // Only the tip list is kept when trimming all
+        deterministicMNManager->TrimCache(0);
+        BOOST_CHECK_EQUAL(deterministicMNManager->GetCacheStats().nLists, 1);
+    }
+
     UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V6_0, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
 }
 
@@ -1333,4 +1368,26 @@ BOOST_FIXTURE_TEST_CASE(dkg_pose_and_qfc_invalid_paths, TestChain400Setup)
     UpdateNetworkUpgradeParameters(Consensus::UPGRADE_V6_0, Consensus::NetworkUpgrade::NO_ACTIVATION_HEIGHT);
 }
 
+BOOST_FIXTURE_TEST_CASE(dmn_list_nodes_usage, BasicTestingSetup)
+{
+    CDeterministicMNList::MnInternalIdMap map;
+    const size_t nUsageStart = DMNListNodeHeap::nUsage;
+    for (uint64_t i = 0; i < 1000; i++) {
+        map = map.set(i, GetRandHash());
+    }
+    const size_t nUsageMap = DMNListNodeHeap::nUsage;
+    BOOST_CHECK_GT(nUsageMap, nUsageStart);
+
+    // A copy doesn't hold more nodes, a modified copy only the ones on the path of the change
+    CDeterministicMNList::MnInternalIdMap copy = map;
+    BOOST_CHECK_EQUAL(DMNListNodeHeap::nUsage, nUsageMap);
+    copy = copy.set(0, GetRandHash());
+    BOOST_CHECK_GT(DMNListNodeHeap::nUsage, nUsageMap);
+    BOOST_CHECK_LT(DMNListNodeHeap::nUsage - nUsageMap, (nUsageMap - nUsageStart) / 4);
+
+    // Dropping the modified copy releases the nodes it held alone
+    copy = map;
+    BOOST_CHECK_EQUAL(DMNListNodeHeap::nUsage, nUsageMap);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -120,4 +120,93 @@ BOOST_AUTO_TEST_CASE(flatfile_flush)
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+BOOST_AUTO_TEST_CASE(flatfile_reader)
+{
+    auto data_dir = SetDataDir("flatfile_test");
+    FlatFileSeq seq(data_dir, "a", 100);
+    FlatFileReader reader(1);
+
+    const std::vector<unsigned char> data1{1, 2, 3, 4, 5};
+    const std::vector<unsigned char> data2{6, 7, 8};
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, 0)), SER_DISK, CLIENT_VERSION);
+        file.write((const char*)data1.data(), data1.size());
+    }
+    std::vector<unsigned char> out(3);
+    BOOST_CHECK(reader.Read(seq.FileName(FlatFilePos(0, 0)), 1, out.data(), 3));
+    BOOST_CHECK(out == std::vector<unsigned char>({2, 3, 4}));
+
+    // Past the end of the file
+    BOOST_CHECK(!reader.Read(seq.FileName(FlatFilePos(0, 0)), 3, out.data(), 3));
+    BOOST_CHECK(!reader.Read(seq.FileName(FlatFilePos(2, 0)), 0, out.data(), 1));
+
+    // The data appended after the file was mapped is read
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, data1.size())), SER_DISK, CLIENT_VERSION);
+        file.write((const char*)data2.data(), data2.size());
+    }
+    BOOST_CHECK(reader.Read(seq.FileName(FlatFilePos(0, 0)), 5, out.data(), 3));
+    BOOST_CHECK(out == data2);
+
+    // Another file takes the mapping, the first one is mapped again when read
+    {
+        CAutoFile file(seq.Open(FlatFilePos(1, 0)), SER_DISK, CLIENT_VERSION);
+        file.write((const char*)data2.data(), data2.size());
+    }
+    BOOST_CHECK(reader.Read(seq.FileName(FlatFilePos(1, 0)), 0, out.data(), 3));
+    BOOST_CHECK(out == data2);
+    BOOST_CHECK(reader.Read(seq.FileName(FlatFilePos(0, 0)), 0, out.data(), 3));
+    BOOST_CHECK(out == std::vector<unsigned char>({1, 2, 3}));
+
+    // Truncated files are mapped again once closed
+    seq.Flush(FlatFilePos(0, 4), true);
+    reader.Close(seq.FileName(FlatFilePos(0, 0)));
+    BOOST_CHECK(!reader.Read(seq.FileName(FlatFilePos(0, 0)), 3, out.data(), 3));
+    BOOST_CHECK(reader.Read(seq.FileName(FlatFilePos(0, 0)), 1, out.data(), 3));
+    BOOST_CHECK(out == std::vector<unsigned char>({2, 3, 4}));
+    reader.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(flatfile_writer)
+{
+    auto data_dir = SetDataDir("flatfile_writer");
+    FlatFileSeq seq(data_dir, "a", 100);
+    FlatFileReader reader(1);
+    const fs::path path = seq.FileName(FlatFilePos(0, 0));
+    std::vector<unsigned char> out(3);
+
+    // Without the thread, the data is written right away
+    {
+        FlatFileWriter writer(1 << 20);
+        BOOST_CHECK(writer.Write(path, 0, {1, 2, 3, 4, 5}));
+        BOOST_CHECK(!writer.Read(path, 0, out.data(), 3));
+        BOOST_CHECK(reader.Read(path, 1, out.data(), 3));
+        BOOST_CHECK(out == std::vector<unsigned char>({2, 3, 4}));
+        BOOST_CHECK(writer.Sync());
+    }
+
+    // The queued data is read from the queue or from the file, then written in order
+    {
+        FlatFileWriter writer(1 << 20);
+        writer.Start("test-writer");
+        BOOST_CHECK(writer.Write(path, 5, {6, 7, 8}));
+        BOOST_CHECK(writer.Write(path, 6, {9, 10}));
+        BOOST_CHECK(writer.Read(path, 6, out.data(), 2) || reader.Read(path, 6, out.data(), 2));
+        BOOST_CHECK(out[0] == 9 && out[1] == 10);
+        // Across the two writes: in none of them
+        BOOST_CHECK(!writer.Read(path, 4, out.data(), 3));
+        BOOST_CHECK(writer.Sync());
+        BOOST_CHECK(!writer.Read(path, 5, out.data(), 3));
+        BOOST_CHECK(reader.Read(path, 5, out.data(), 3));
+        BOOST_CHECK(out == std::vector<unsigned char>({6, 9, 10}));
+
+        // Stop writes the queue
+        BOOST_CHECK(writer.Write(seq.FileName(FlatFilePos(1, 0)), 0, {11, 12, 13}));
+        writer.Stop();
+    }
+    BOOST_CHECK(reader.Read(seq.FileName(FlatFilePos(1, 0)), 0, out.data(), 3));
+    BOOST_CHECK(out == std::vector<unsigned char>({11, 12, 13}));
+    reader.Clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
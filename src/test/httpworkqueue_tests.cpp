@@ -0,0 +1,128 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "httpworkqueue.h"
+#include "test/test_pivx.h"
+#include "utiltime.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+typedef WorkQueue<std::function<void()>> TestWorkQueue;
+
+namespace {
+
+/** Holds the items which wait on it until it is opened */
+class Gate
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    bool fOpen{false};
+
+public:
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [this] { return fOpen; });
+    }
+    void Open()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        fOpen = true;
+        cond.notify_all();
+    }
+};
+
+bool WaitFor(const std::function<bool()>& pred)
+{
+    for (int i = 0; i < 10000; i++) {
+        if (pred()) return true;
+        MilliSleep(1);
+    }
+    return pred();
+}
+
+HTTPQueueStats GetStats(TestWorkQueue& queue, HTTPPriority priority)
+{
+    return queue.GetStats()[(int)priority];
+}
+
+void Enqueue(TestWorkQueue& queue, HTTPPriority priority, std::function<void()> func)
+{
+    HTTPRequestClass cls;
+    cls.priority = priority;
+    BOOST_REQUIRE(queue.Enqueue(new std::function<void()>(std::move(func)), cls));
+}
+
+void Stop(TestWorkQueue& queue, std::vector<std::thread>& workers)
+{
+    queue.Interrupt();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(httpworkqueue_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(low_priority_reservation)
+{
+    TestWorkQueue queue(16, 2);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 2; i++) {
+        workers.emplace_back([&queue] { queue.Run(); });
+    }
+
+    // A single LOW item is handled at once, the other one waits
+    Gate gate;
+    Enqueue(queue, HTTPPriority::LOW, [&gate] { gate.Wait(); });
+    Enqueue(queue, HTTPPriority::LOW, [&gate] { gate.Wait(); });
+    BOOST_CHECK(WaitFor([&queue] { return GetStats(queue, HTTPPriority::LOW).nRunning == 1; }));
+    BOOST_CHECK_EQUAL(GetStats(queue, HTTPPriority::LOW).nQueued, 1U);
+
+    // The worker left handles the others
+    std::atomic<bool> fHandled{false};
+    Enqueue(queue, HTTPPriority::HIGH, [&fHandled] { fHandled = true; });
+    BOOST_CHECK(WaitFor([&fHandled] { return fHandled.load(); }));
+    BOOST_CHECK_EQUAL(GetStats(queue, HTTPPriority::LOW).nRunning, 1U);
+    BOOST_CHECK_EQUAL(GetStats(queue, HTTPPriority::LOW).nQueued, 1U);
+
+    gate.Open();
+    Stop(queue, workers);
+    BOOST_CHECK_EQUAL(GetStats(queue, HTTPPriority::LOW).nHandled, 2U);
+    BOOST_CHECK_EQUAL(GetStats(queue, HTTPPriority::LOW).nRunning, 0U);
+    BOOST_CHECK_EQUAL(GetStats(queue, HTTPPriority::HIGH).nHandled, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(single_worker)
+{
+    TestWorkQueue queue(16, 1);
+    std::vector<std::thread> workers;
+    workers.emplace_back([&queue] { queue.Run(); });
+
+    // The only worker handles the LOW items too
+    std::atomic<bool> fHandled{false};
+    Enqueue(queue, HTTPPriority::LOW, [&fHandled] { fHandled = true; });
+    BOOST_CHECK(WaitFor([&fHandled] { return fHandled.load(); }));
+
+    // ...after the queued items of the higher classes
+    Gate gate;
+    std::string strOrder;
+    Enqueue(queue, HTTPPriority::NORMAL, [&gate] { gate.Wait(); });
+    BOOST_CHECK(WaitFor([&queue] { return GetStats(queue, HTTPPriority::NORMAL).nRunning == 1; }));
+    Enqueue(queue, HTTPPriority::LOW, [&strOrder] { strOrder += "L"; });
+    Enqueue(queue, HTTPPriority::HIGH, [&strOrder] { strOrder += "H"; });
+    Enqueue(queue, HTTPPriority::NORMAL, [&strOrder] { strOrder += "N"; });
+
+    gate.Open();
+    Stop(queue, workers);
+    BOOST_CHECK_EQUAL(strOrder, "HNL");
+    BOOST_CHECK_EQUAL(GetStats(queue, HTTPPriority::LOW).nHandled, 2U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
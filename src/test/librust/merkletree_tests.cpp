@@ -164,6 +164,98 @@ BOOST_AUTO_TEST_CASE(EmptyrootsSapling) {
     BOOST_CHECK(INCREMENTAL_MERKLE_TREE_DEPTH <= 62);
 }
 
+template<typename Tree, typename Witness, typename Batch>
+void test_batch_append(size_t numLeaves, const std::vector<size_t>& batchSizes)
+{
+    Tree tree;
+    std::vector<Witness> serial;
+    std::vector<Witness> batched;
+
+    size_t nextBatch = 0;
+    while (tree.size() < numLeaves) {
+        const size_t batchSize = std::min(batchSizes[nextBatch++ % batchSizes.size()], numLeaves - tree.size());
+        std::vector<libzcash::PedersenHash> leaves;
+        const uint64_t firstPosition = tree.size();
+        for (size_t i = 0; i < batchSize; i++) {
+            libzcash::PedersenHash leaf(InsecureRand256());
+            leaves.emplace_back(leaf);
+            for (Witness& wit : serial) {
+                wit.append(leaf);
+            }
+            tree.append(leaf);
+            // new witnesses get the rest of the batch on top
+            serial.emplace_back(tree.witness());
+            batched.emplace_back(tree.witness());
+        }
+
+        Batch batch(leaves, firstPosition);
+        for (Witness& wit : batched) {
+            wit.append(batch);
+        }
+        // appending twice is a no-op
+        batched.front().append(batch);
+
+        BOOST_CHECK_EQUAL(serial.size(), batched.size());
+        for (size_t i = 0; i < serial.size(); i++) {
+            BOOST_CHECK(serial[i] == batched[i]);
+            BOOST_CHECK(batched[i].root() == tree.root());
+            BOOST_CHECK_EQUAL(batched[i].position(), i);
+        }
+    }
+
+    // a witness that missed some leaves cannot take a later batch
+    const uint64_t lastPosition = tree.size() - 1;
+    Batch batch({libzcash::PedersenHash(InsecureRand256())}, lastPosition + 2);
+    BOOST_CHECK_THROW(batched.front().append(batch), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(WitnessBatchAppend) {
+    // the testing tree gets full
+    test_batch_append<SaplingTestingMerkleTree, SaplingTestingWitness, SaplingTestingMerkleBatch>(16, {1});
+    test_batch_append<SaplingTestingMerkleTree, SaplingTestingWitness, SaplingTestingMerkleBatch>(16, {3, 5});
+    test_batch_append<SaplingTestingMerkleTree, SaplingTestingWitness, SaplingTestingMerkleBatch>(16, {16});
+    test_batch_append<SaplingMerkleTree, SaplingWitness, SaplingMerkleBatch>(150, {7, 1, 32, 13, 64});
+}
+
+BOOST_AUTO_TEST_CASE(CachedRoots) {
+    SaplingMerkleTree tree;
+    std::vector<SaplingWitness> witnesses;
+    BOOST_CHECK(tree.root() == SaplingMerkleTree::empty_root());
+
+    for (size_t i = 0; i < 20; i++) {
+        const uint256 emptyRoot = tree.root();
+        libzcash::PedersenHash leaf(InsecureRand256());
+        tree.append(leaf);
+        for (SaplingWitness& wit : witnesses) {
+            wit.append(leaf);
+        }
+        witnesses.emplace_back(tree.witness());
+
+        // appending resets the cached root
+        const uint256 root = tree.root();
+        BOOST_CHECK(root != emptyRoot);
+        BOOST_CHECK(tree.root() == root);
+
+        // a copy shares it, a deserialized tree computes the same one
+        SaplingMerkleTree treeCopy = tree;
+        BOOST_CHECK(treeCopy.root() == root);
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << tree;
+        SaplingMerkleTree treeRead;
+        ss >> treeRead;
+        BOOST_CHECK(treeRead.root() == root);
+
+        for (const SaplingWitness& wit : witnesses) {
+            BOOST_CHECK(wit.root() == root);
+            BOOST_CHECK(wit.root() == root);
+            ss << wit;
+            SaplingWitness witRead;
+            ss >> witRead;
+            BOOST_CHECK(witRead.root() == root);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(EmptyrootSapling) {
     // This literal is the depth-32 empty tree root with the bytes reversed to
     // account for the fact that uint256S() loads a big-endian representation of
@@ -19,6 +19,7 @@
 #include "consensus/merkle.h"
 #include "sapling/note.h"
 #include "sapling/noteencryption.h"
+#include "sapling/trialdecryption.h"
 
 #include <boost/filesystem.hpp>
 
@@ -174,6 +175,68 @@ BOOST_AUTO_TEST_CASE(FindMySaplingNotes)
     BOOST_CHECK_EQUAL(2, noteMap.size());
 }
 
+BOOST_AUTO_TEST_CASE(ParallelTrialDecryption)
+{
+    auto consensusParams = Params().GetConsensus();
+
+    auto sk = GetTestMasterSaplingSpendingKey();
+    auto testNote = GetTestSaplingNote(sk.DefaultAddress(), 50000000);
+    auto sk1 = sk.Derive(1);
+    auto sk2 = sk.Derive(2);
+
+    // Two outputs to two different keys, plus the change back to sk
+    auto builder = TransactionBuilder(consensusParams);
+    builder.AddSaplingSpend(sk.expsk, testNote.note, testNote.tree.root(), testNote.tree.witness());
+    builder.AddSaplingOutput(sk.expsk.ovk, sk1.DefaultAddress(), 10000000, {});
+    builder.AddSaplingOutput(sk.expsk.ovk, sk2.DefaultAddress(), 20000000, {});
+    builder.SetFee(10000000);
+    auto tx = builder.Build().GetTxOrThrow();
+    const auto& outputs = tx.sapData->vShieldedOutput;
+    BOOST_CHECK_EQUAL(outputs.size(), 3);
+
+    const auto ivk = sk.ToXFVK().fvk.in_viewing_key();
+    const auto ivk1 = sk1.ToXFVK().fvk.in_viewing_key();
+    const auto ivk2 = sk2.ToXFVK().fvk.in_viewing_key();
+
+    // Few pairs: decrypted on the calling thread
+    std::vector<libzcash::SaplingIncomingViewingKey> ivks = {ivk2, ivk1};
+    auto res = SaplingTrialDecryption::TryDecryptOutputs(outputs, ivks);
+    BOOST_CHECK_EQUAL(res.size(), 3);
+    BOOST_CHECK_EQUAL(std::count_if(res.begin(), res.end(), [](const Optional<SaplingTrialDecryption::DecryptedOutput>& r) { return (bool)r; }), 2);
+
+    // Many pairs: sharded across the worker pool, the wallet keys scattered among unrelated ones
+    ivks.clear();
+    for (int i = 0; i < 200; i++) {
+        ivks.emplace_back(GetTestMasterSaplingSpendingKey().Derive(1000 + i).ToXFVK().fvk.in_viewing_key());
+    }
+    ivks[17] = ivk1;
+    ivks[123] = ivk2;
+    ivks[199] = ivk;
+    BOOST_CHECK(outputs.size() * ivks.size() >= MIN_PARALLEL_TRIAL_DECRYPTIONS);
+    res = SaplingTrialDecryption::TryDecryptOutputs(outputs, ivks);
+    BOOST_CHECK_EQUAL(res.size(), 3);
+    std::vector<size_t> found;
+    CAmount total = 0;
+    for (const auto& r : res) {
+        BOOST_REQUIRE(r);
+        found.emplace_back(r->ivkIndex);
+        total += r->plaintext.value();
+    }
+    std::sort(found.begin(), found.end());
+    BOOST_CHECK(found == std::vector<size_t>({17, 123, 199}));
+    BOOST_CHECK_EQUAL(total, 40000000);
+
+    // A duplicated key always resolves to its first position
+    ivks[5] = ivk2;
+    res = SaplingTrialDecryption::TryDecryptOutputs(outputs, ivks);
+    BOOST_CHECK_EQUAL(std::count_if(res.begin(), res.end(), [](const Optional<SaplingTrialDecryption::DecryptedOutput>& r) { return r && r->ivkIndex == 5; }), 1);
+    BOOST_CHECK_EQUAL(std::count_if(res.begin(), res.end(), [](const Optional<SaplingTrialDecryption::DecryptedOutput>& r) { return r && r->ivkIndex == 123; }), 0);
+
+    // No keys, no outputs
+    BOOST_CHECK(!SaplingTrialDecryption::TryDecryptOutputs(outputs, {})[0]);
+    BOOST_CHECK(SaplingTrialDecryption::TryDecryptOutputs({}, ivks).empty());
+}
+
 // Generate note A and spend to create note B, from which we spend to create two conflicting transactions
 BOOST_AUTO_TEST_CASE(GetConflictedSaplingNotes)
 {
@@ -860,6 +923,65 @@ BOOST_AUTO_TEST_CASE(CachedWitnessesCleanIndex)
     }
 }
 
+BOOST_AUTO_TEST_CASE(CachedWitnessesRange)
+{
+    libzcash::SaplingExtendedSpendingKey sk = GetTestMasterSaplingSpendingKey();
+    CWallet& wallet = m_wallet;
+    {
+        LOCK(wallet.cs_wallet);
+        setupWallet(wallet);
+        BOOST_CHECK(wallet.AddSaplingZKey(sk));
+    }
+
+    std::vector<CBlock> blocks;
+    std::vector<CBlockIndex> indices;
+    std::vector<SaplingOutPoint> saplingNotes;
+    std::vector<SaplingMerkleTree> saplingTrees;
+    SaplingMerkleTree saplingTree;
+    std::vector<Optional<SaplingWitness>> saplingWitnesses;
+
+    // Generate a chain, incrementing the witnesses block by block
+    size_t numBlocks = 30;
+    blocks.resize(numBlocks);
+    indices.resize(numBlocks);
+    for (size_t i = 0; i < numBlocks; i++) {
+        indices[i].nHeight = i;
+        saplingTrees.push_back(saplingTree);
+        saplingNotes.push_back(CreateValidBlock(wallet, sk, indices[i], blocks[i], saplingTree));
+    }
+    const uint256& anchor = GetWitnessesAndAnchors(wallet, saplingNotes, saplingWitnesses);
+    const std::vector<Optional<SaplingWitness>> expectedWitnesses = saplingWitnesses;
+
+    // Now rebuild the witnesses from scratch, appending most of the blocks as ranges
+    wallet.ClearNoteWitnessCache();
+    SaplingScriptPubKeyMan* sspkm = wallet.GetSaplingScriptPubKeyMan();
+    for (size_t i = 0; i < numBlocks; i++) {
+        SaplingMerkleTree tree = saplingTrees[i];
+        if (i < numBlocks - 5) {
+            sspkm->IncrementNoteWitnessesRange(&indices[i], &blocks[i], tree);
+        } else {
+            wallet.IncrementNoteWitnesses(&indices[i], &blocks[i], tree);
+        }
+        if (i == 10) {
+            // split the range
+            sspkm->FlushNoteWitnessesRange();
+            GetWitnessesAndAnchors(wallet, saplingNotes, saplingWitnesses);
+            for (size_t j = 0; j <= i; j++) {
+                BOOST_CHECK(saplingWitnesses[j]->root() == saplingTrees[i + 1].root());
+            }
+        }
+    }
+
+    BOOST_CHECK(GetWitnessesAndAnchors(wallet, saplingNotes, saplingWitnesses) == anchor);
+    BOOST_CHECK(saplingWitnesses == expectedWitnesses);
+    BOOST_CHECK_EQUAL(sspkm->nWitnessCacheSize, 6);
+
+    // The blocks connected one by one can still be disconnected
+    wallet.DecrementNoteWitnesses(&indices[numBlocks - 1]);
+    GetWitnessesAndAnchors(wallet, saplingNotes, saplingWitnesses);
+    BOOST_CHECK(saplingWitnesses[0]->root() == saplingTrees[numBlocks - 1].root());
+}
+
 BOOST_AUTO_TEST_CASE(ClearNoteWitnessCache)
 {
     auto consensusParams = Params().GetConsensus();
@@ -1201,9 +1323,24 @@ BOOST_AUTO_TEST_CASE(GetNotes)
     for (int i=0; i<5; i++) {
         BOOST_CHECK(entries[i].op == saplingOutpoints[i]);
         BOOST_CHECK(entries[i].address == pk);
+        BOOST_CHECK_EQUAL(entries[i].note.value(), 100000000);
         BOOST_CHECK_EQUAL(entries[i].confirmations, 1);
     }
 
+    // The notes of the index are the ones of the unfiltered scan, and none for other addresses
+    std::vector<SaplingNoteEntry> entriesAll;
+    Optional<libzcash::SaplingPaymentAddress> noAddress = nullopt;
+    wallet.GetSaplingScriptPubKeyMan()->GetFilteredNotes(entriesAll, noAddress, 0, true, false);
+    BOOST_REQUIRE_EQUAL(entriesAll.size(), entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        BOOST_CHECK(entriesAll[i].op == entries[i].op);
+        BOOST_CHECK_EQUAL(entriesAll[i].note.r, entries[i].note.r);
+    }
+    std::vector<SaplingNoteEntry> entriesOther;
+    Optional<libzcash::SaplingPaymentAddress> otherAddress = GetTestMasterSaplingSpendingKey().Derive(1).DefaultAddress();
+    wallet.GetSaplingScriptPubKeyMan()->GetFilteredNotes(entriesOther, otherAddress, 0, true, false);
+    BOOST_CHECK(entriesOther.empty());
+
     // Check GetNotes
     std::vector<SaplingNoteEntry> entries2;
     wallet.GetSaplingScriptPubKeyMan()->GetNotes(saplingOutpoints, entries2);
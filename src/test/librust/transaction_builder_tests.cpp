@@ -6,6 +6,7 @@
 #include "test/librust/sapling_test_fixture.h"
 #include "test/librust/utiltest.h"
 
+#include "policy/policy.h"
 #include "sapling/sapling.h"
 #include "sapling/transaction_builder.h"
 #include "sapling/sapling_validation.h"
@@ -101,6 +102,165 @@ BOOST_AUTO_TEST_CASE(SaplingToSapling)
     BOOST_CHECK_EQUAL(state.GetRejectReason(), "");
 }
 
+BOOST_AUTO_TEST_CASE(ParallelProving)
+{
+    auto consensusParams = Params().GetConsensus();
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = sk.full_viewing_key();
+    auto pa = sk.default_address();
+
+    // Two notes in the same tree, spent with the same anchor
+    libzcash::SaplingNote note1(pa, 40000000);
+    libzcash::SaplingNote note2(pa, 60000000);
+    SaplingMerkleTree tree;
+    tree.append(note1.cmu().get());
+    SaplingWitness witness1 = tree.witness();
+    tree.append(note2.cmu().get());
+    witness1.append(note2.cmu().get());
+    SaplingWitness witness2 = tree.witness();
+
+    // --- 1 shielded-PIV in, 8 x 0.1 shielded-PIV out, 0.1 shielded-PIV fee, 0.1 shielded-PIV change
+    auto builder = TransactionBuilder(consensusParams);
+    builder.AddSaplingSpend(expsk, note1, tree.root(), witness1);
+    builder.AddSaplingSpend(expsk, note2, tree.root(), witness2);
+    for (int i = 0; i < 8; i++) {
+        builder.AddSaplingOutput(fvk.ovk, pa, 10000000, {});
+    }
+    builder.SetFee(10000000);
+    auto tx = builder.Build().GetTxOrThrow();
+
+    BOOST_CHECK_EQUAL(tx.sapData->vShieldedSpend.size(), 2);
+    BOOST_CHECK_EQUAL(tx.sapData->vShieldedOutput.size(), 9);
+    BOOST_CHECK_EQUAL(tx.sapData->valueBalance, 10000000);
+    // Each proof was created with its own value commitment trapdoor
+    std::set<uint256> cvs;
+    for (const auto& spend : tx.sapData->vShieldedSpend) cvs.insert(spend.cv);
+    for (const auto& output : tx.sapData->vShieldedOutput) cvs.insert(output.cv);
+    BOOST_CHECK_EQUAL(cvs.size(), 11);
+
+    CValidationState state;
+    BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(tx, state, Params(), 3, true, false));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "");
+}
+
+BOOST_AUTO_TEST_CASE(ShieldedValidationCost)
+{
+    auto consensusParams = Params().GetConsensus();
+
+    CBasicKeyStore keystore;
+    CKey tsk = AddTestCKeyToKeyStore(keystore);
+    auto scriptPubKey = GetScriptForDestination(tsk.GetPubKey().GetID());
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = sk.full_viewing_key();
+    auto pa = sk.default_address();
+
+    // Transparent only
+    auto builder = TransactionBuilder(consensusParams, &keystore);
+    builder.AddTransparentInput(COutPoint(uint256S("1234"), 0), scriptPubKey, 50000000);
+    builder.AddTransparentOutput(tsk.GetPubKey().GetID(), 40000000);
+    builder.SetFee(10000000);
+    BOOST_CHECK_EQUAL(GetShieldedValidationCost(builder.Build(true).GetTxOrThrow()), 0);
+
+    // 1 spend, 3 outputs (with change)
+    auto testNote = GetTestSaplingNote(pa, 100000000);
+    auto builder2 = TransactionBuilder(consensusParams);
+    builder2.AddSaplingSpend(expsk, testNote.note, testNote.tree.root(), testNote.tree.witness());
+    builder2.AddSaplingOutput(fvk.ovk, pa, 20000000, {});
+    builder2.AddSaplingOutput(fvk.ovk, pa, 20000000, {});
+    builder2.SetFee(10000000);
+    BOOST_CHECK_EQUAL(GetShieldedValidationCost(builder2.Build(true).GetTxOrThrow()),
+                      SAPLING_SPEND_VALIDATION_COST + 3 * SAPLING_OUTPUT_VALIDATION_COST + SAPLING_BINDING_SIG_VALIDATION_COST);
+}
+
+BOOST_AUTO_TEST_CASE(SaplingBatchValidation)
+{
+    auto consensusParams = Params().GetConsensus();
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = sk.full_viewing_key();
+    auto pa = sk.default_address();
+
+    std::vector<CTransaction> txes;
+    for (int i = 0; i < 3; i++) {
+        auto testNote = GetTestSaplingNote(pa, 40000000);
+        auto builder = TransactionBuilder(consensusParams);
+        builder.AddSaplingSpend(expsk, testNote.note, testNote.tree.root(), testNote.tree.witness());
+        builder.AddSaplingOutput(fvk.ovk, pa, 29900000, {});
+        builder.SetFee(10000000);
+        txes.emplace_back(builder.Build().GetTxOrThrow());
+    }
+
+    // Empty batch
+    SaplingValidation::BatchValidator batch;
+    BOOST_CHECK(batch.Validate());
+
+    // All the proofs of the "block" pass together
+    CValidationState state;
+    for (const auto& tx : txes) {
+        BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(tx, state, Params(), 3, true, false, false /* fCheckProofs */));
+        BOOST_CHECK(batch.Add(tx));
+    }
+    BOOST_CHECK_EQUAL(batch.Size(), txes.size());
+    BOOST_CHECK(batch.Validate());
+    BOOST_CHECK_EQUAL(batch.Size(), 0);
+
+    // Corrupt one output proof: the binding signature no longer matches, so the tx is
+    // not queued and the per-tx check reports the exact failure.
+    CMutableTransaction mtx(txes[1]);
+    mtx.sapData->vShieldedOutput[0].zkproof = txes[0].sapData->vShieldedOutput[0].zkproof;
+    CTransaction badTx(mtx);
+    BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(badTx, state, Params(), 3, true, false, false /* fCheckProofs */));
+    BOOST_CHECK(batch.Add(txes[0]));
+    BOOST_CHECK(!batch.Add(badTx));
+    BOOST_CHECK_EQUAL(batch.Size(), 1);
+    BOOST_CHECK(!SaplingValidation::CheckTransactionProofs(badTx, state, 100));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-txns-sapling-output-description-invalid");
+
+    // Nothing of the rejected tx was left in the batch
+    BOOST_CHECK(batch.Add(txes[2]));
+    BOOST_CHECK_EQUAL(batch.Size(), 2);
+    BOOST_CHECK(batch.Validate());
+}
+
+BOOST_AUTO_TEST_CASE(SaplingProofCache)
+{
+    auto consensusParams = Params().GetConsensus();
+
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto pa = sk.default_address();
+
+    auto testNote = GetTestSaplingNote(pa, 40000000);
+    auto builder = TransactionBuilder(consensusParams);
+    builder.AddSaplingSpend(expsk, testNote.note, testNote.tree.root(), testNote.tree.witness());
+    builder.SetFee(10000000);
+    auto tx = builder.Build().GetTxOrThrow();
+
+    // Not cached yet: the proofs are queued
+    SaplingValidation::BatchValidator batch;
+    BOOST_CHECK(batch.Add(tx));
+    BOOST_CHECK_EQUAL(batch.Size(), 1);
+    BOOST_CHECK(batch.Validate());
+
+    // Mempool acceptance verifies the tx and caches the result
+    CValidationState state;
+    BOOST_CHECK(SaplingValidation::ContextualCheckTransaction(tx, state, Params(), 3, false /* isMined */, false));
+    BOOST_CHECK(batch.Add(tx));
+    BOOST_CHECK_EQUAL(batch.Size(), 0);
+
+    // Block connection consults and erases the entry
+    BOOST_CHECK(batch.Add(tx, true));
+    BOOST_CHECK_EQUAL(batch.Size(), 0);
+    BOOST_CHECK(batch.Add(tx));
+    BOOST_CHECK_EQUAL(batch.Size(), 1);
+    BOOST_CHECK(batch.Validate());
+}
+
 BOOST_AUTO_TEST_CASE(ThrowsOnTransparentInputWithoutKeyStore)
 {
     auto builder = TransactionBuilder(Params().GetConsensus());
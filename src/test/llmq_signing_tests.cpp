@@ -0,0 +1,104 @@
+// Copyright (c) 2023 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "llmq/quorums_signing.h"
+#include "llmq/quorums_utils.h"
+#include "random.h"
+#include "univalue.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace llmq;
+
+BOOST_FIXTURE_TEST_SUITE(llmq_signing_tests, BasicTestingSetup)
+
+static CRecoveredSig CreateRecoveredSig(const uint256& id, const uint256& msgHash)
+{
+    CBLSSecretKey sk;
+    sk.MakeNewKey();
+
+    CRecoveredSig recSig;
+    recSig.llmqType = Consensus::LLMQ_TEST;
+    recSig.quorumHash = InsecureRand256();
+    recSig.id = id;
+    recSig.msgHash = msgHash;
+    recSig.sig = sk.Sign(llmq::utils::BuildSignHash(recSig));
+    recSig.UpdateHash();
+    return recSig;
+}
+
+// The recovered sig must be found in the same way before and after the flush to the db
+static void CheckHasRecoveredSig(CRecoveredSigsDb& db, const CRecoveredSig& recSig)
+{
+    BOOST_CHECK(db.HasRecoveredSigForId(Consensus::LLMQ_TEST, recSig.id));
+    BOOST_CHECK(db.HasRecoveredSig(Consensus::LLMQ_TEST, recSig.id, recSig.msgHash));
+    BOOST_CHECK(!db.HasRecoveredSig(Consensus::LLMQ_TEST, recSig.id, InsecureRand256()));
+    BOOST_CHECK(db.HasRecoveredSigForSession(llmq::utils::BuildSignHash(recSig)));
+    BOOST_CHECK(db.HasRecoveredSigForHash(recSig.GetHash()));
+    BOOST_CHECK(!db.HasVotedOnId(Consensus::LLMQ_TEST, recSig.id));
+
+    CRecoveredSig recSig2;
+    BOOST_CHECK(db.GetRecoveredSigByHash(recSig.GetHash(), recSig2));
+    BOOST_CHECK(recSig2.msgHash == recSig.msgHash && recSig2.sig == recSig.sig);
+    BOOST_CHECK(db.GetRecoveredSigById(Consensus::LLMQ_TEST, recSig.id, recSig2));
+    BOOST_CHECK(recSig2.quorumHash == recSig.quorumHash);
+}
+
+BOOST_AUTO_TEST_CASE(recovered_sigs_db_pending_writes)
+{
+    CRecoveredSigsDb db(true);
+    const uint256 id = InsecureRand256();
+    const uint256 msgHash = InsecureRand256();
+
+    // negative lookups are cached, the write must replace them
+    BOOST_CHECK(!db.HasRecoveredSigForId(Consensus::LLMQ_TEST, id));
+    db.WriteVoteForId(Consensus::LLMQ_TEST, id, msgHash);
+    BOOST_CHECK(db.HasVotedOnId(Consensus::LLMQ_TEST, id));
+
+    CRecoveredSig recSig = CreateRecoveredSig(id, msgHash);
+    BOOST_CHECK(!db.HasRecoveredSigForHash(recSig.GetHash()));
+    db.WriteRecoveredSig(recSig);
+    CheckHasRecoveredSig(db, recSig);
+
+    // not old enough for the timed flush, then forced
+    db.FlushPendingRecoveredSigs(false);
+    CheckHasRecoveredSig(db, recSig);
+    db.FlushPendingRecoveredSigs(true);
+    CheckHasRecoveredSig(db, recSig);
+
+    // a negative age cleans up everything, including the cached lookups
+    db.CleanupOldRecoveredSigs(-3600);
+    BOOST_CHECK(!db.HasRecoveredSigForId(Consensus::LLMQ_TEST, id));
+    BOOST_CHECK(!db.HasRecoveredSig(Consensus::LLMQ_TEST, id, msgHash));
+    BOOST_CHECK(!db.HasRecoveredSigForSession(llmq::utils::BuildSignHash(recSig)));
+    BOOST_CHECK(!db.HasRecoveredSigForHash(recSig.GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(signing_latency_stats)
+{
+    CSigningLatencyStats stats;
+    const uint256 id = InsecureRand256();
+
+    // sessions which were not started are not tracked
+    stats.MarkStage(id, CSigningLatencyStats::RECOVERED);
+    BOOST_CHECK_EQUAL(stats.ToJson()["recovered"]["count"].get_int(), 0);
+
+    stats.StartSession(id);
+    stats.MarkStage(id, CSigningLatencyStats::SHARE_CREATED);
+    // skipping the collection of the shares, and reaching a stage twice
+    stats.MarkStage(id, CSigningLatencyStats::RECOVERED);
+    stats.MarkStage(id, CSigningLatencyStats::RECOVERED);
+
+    UniValue json = stats.ToJson();
+    BOOST_CHECK_EQUAL(json["sessions"].get_int(), 1);
+    BOOST_CHECK_EQUAL(json["shareCreated"]["count"].get_int(), 1);
+    BOOST_CHECK_EQUAL(json["sharesCollected"]["count"].get_int(), 0);
+    BOOST_CHECK_EQUAL(json["recovered"]["count"].get_int(), 1);
+    BOOST_CHECK_EQUAL(json["recovered"]["histogram"]["<=10ms"].get_int(), 1);
+    BOOST_CHECK_EQUAL(json["clsigRelayed"]["count"].get_int(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,160 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "clientversion.h"
+#include "masternode-sync.h"
+#include "streams.h"
+#include "test/test_pivx.h"
+#include "tiertwo/tiertwo_sync_state.h"
+#include "utiltime.h"
+
+#include <boost/test/unit_test.hpp>
+
+// Access to the sync state of the requests, set by Process() and SyncWithNode() otherwise
+class CMasternodeSyncTest : public CMasternodeSync
+{
+public:
+    void StartRound() { nRoundRequests = 0; }
+    bool AddRequest(NodeId nodeId) { return AddPendingRequest(nodeId); }
+    int64_t IdleWindow(int64_t nMaxWindow) { return GetIdleWindow(nMaxWindow); }
+    size_t PendingRequests() { return WITH_LOCK(cs_requests, return mapPendingRequests.size()); }
+    int AnsweredRequests() { return WITH_LOCK(cs_requests, return nAnsweredRequests); }
+    bool IsResumed() const { return fResumed; }
+    void SetLastSynced(int64_t nTime) { nLastSynced = nTime; }
+};
+
+BOOST_FIXTURE_TEST_SUITE(masternode_sync_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(parallel_requests)
+{
+    CMasternodeSyncTest sync;
+    g_tiertwo_sync_state.SetCurrentSyncPhase(MASTERNODE_SYNC_LIST);
+
+    // A round goes on with other peers up to MASTERNODE_SYNC_PARALLEL_REQUESTS
+    sync.StartRound();
+    for (int i = 0; i < MASTERNODE_SYNC_PARALLEL_REQUESTS - 1; i++) {
+        BOOST_CHECK(sync.AddRequest(i));
+    }
+    BOOST_CHECK(!sync.AddRequest(MASTERNODE_SYNC_PARALLEL_REQUESTS - 1));
+    BOOST_CHECK_EQUAL(sync.PendingRequests(), (size_t)MASTERNODE_SYNC_PARALLEL_REQUESTS);
+
+    // The next round starts over
+    sync.StartRound();
+    BOOST_CHECK(sync.AddRequest(MASTERNODE_SYNC_PARALLEL_REQUESTS));
+    BOOST_CHECK_EQUAL(sync.PendingRequests(), (size_t)MASTERNODE_SYNC_PARALLEL_REQUESTS + 1);
+
+    // Only the count of the current asset, from a peer which was asked, answers a request
+    sync.ProcessSyncStatusMsg(0, MASTERNODE_SYNC_MNW, 10);
+    sync.ProcessSyncStatusMsg(100, MASTERNODE_SYNC_LIST, 10);
+    BOOST_CHECK_EQUAL(sync.PendingRequests(), (size_t)MASTERNODE_SYNC_PARALLEL_REQUESTS + 1);
+    sync.ProcessSyncStatusMsg(0, MASTERNODE_SYNC_LIST, 10);
+    BOOST_CHECK_EQUAL(sync.PendingRequests(), (size_t)MASTERNODE_SYNC_PARALLEL_REQUESTS);
+    BOOST_CHECK_EQUAL(sync.AnsweredRequests(), 1);
+    BOOST_CHECK_EQUAL(sync.sumMasternodeList, 20);
+    BOOST_CHECK_EQUAL(sync.countMasternodeList, 2);
+
+    // Moving to the next asset drops the requests
+    sync.SwitchToNextAsset();
+    BOOST_CHECK_EQUAL(g_tiertwo_sync_state.GetSyncPhase(), MASTERNODE_SYNC_MNW);
+    BOOST_CHECK_EQUAL(sync.PendingRequests(), 0U);
+    BOOST_CHECK_EQUAL(sync.AnsweredRequests(), 0);
+
+    sync.Reset();
+}
+
+BOOST_AUTO_TEST_CASE(idle_window)
+{
+    CMasternodeSyncTest sync;
+    g_tiertwo_sync_state.SetCurrentSyncPhase(MASTERNODE_SYNC_MNW);
+    const int64_t nMaxWindow = MASTERNODE_SYNC_TIMEOUT * 2;
+
+    // No request answered yet
+    sync.StartRound();
+    sync.AddRequest(1);
+    sync.AddRequest(2);
+    BOOST_CHECK_EQUAL(sync.IdleWindow(nMaxWindow), nMaxWindow);
+
+    // Some requests still unanswered
+    sync.ProcessSyncStatusMsg(1, MASTERNODE_SYNC_MNW, 0);
+    BOOST_CHECK_EQUAL(sync.IdleWindow(nMaxWindow), nMaxWindow);
+
+    // All the peers answered (in less than half a second): a few response times, never more than the max window
+    sync.ProcessSyncStatusMsg(2, MASTERNODE_SYNC_MNW, 0);
+    BOOST_CHECK_EQUAL(sync.IdleWindow(nMaxWindow), MASTERNODE_SYNC_TIMEOUT);
+    BOOST_CHECK_EQUAL(sync.IdleWindow(MASTERNODE_SYNC_TIMEOUT - 1), MASTERNODE_SYNC_TIMEOUT - 1);
+
+    // A new request waits for the max window again
+    sync.AddRequest(3);
+    BOOST_CHECK_EQUAL(sync.IdleWindow(nMaxWindow), nMaxWindow);
+
+    sync.Reset();
+}
+
+BOOST_AUTO_TEST_CASE(resume_after_restart)
+{
+    const int64_t now = GetTime();
+    SetMockTime(now);
+
+    // Only the last synced time is persisted
+    CMasternodeSyncTest synced;
+    synced.SetLastSynced(now - MASTERNODE_SYNC_RESUME_TIME + 60);
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << synced;
+
+    CMasternodeSyncTest sync;
+    BOOST_CHECK(!sync.IsResumed());
+    ss >> sync;
+    sync.CheckResume();
+    BOOST_CHECK(sync.IsResumed());
+
+    // The usual quorum of peers must answer before the slower ones are skipped
+    g_tiertwo_sync_state.SetCurrentSyncPhase(MASTERNODE_SYNC_LIST);
+    const int64_t nMaxWindow = MASTERNODE_SYNC_TIMEOUT * 8;
+    sync.StartRound();
+    for (NodeId id = 0; id < MASTERNODE_SYNC_THRESHOLD + 1; id++) {
+        sync.AddRequest(id);
+    }
+    for (NodeId id = 0; id < MASTERNODE_SYNC_THRESHOLD - 1; id++) {
+        sync.ProcessSyncStatusMsg(id, MASTERNODE_SYNC_LIST, 0);
+    }
+    BOOST_CHECK_EQUAL(sync.IdleWindow(nMaxWindow), nMaxWindow);
+    sync.ProcessSyncStatusMsg(MASTERNODE_SYNC_THRESHOLD - 1, MASTERNODE_SYNC_LIST, 0);
+    BOOST_CHECK_EQUAL(sync.PendingRequests(), 1U);
+    BOOST_CHECK_EQUAL(sync.IdleWindow(nMaxWindow), MASTERNODE_SYNC_TIMEOUT);
+
+    // A node which wasn't resumed waits for all the peers
+    CMasternodeSyncTest fresh;
+    g_tiertwo_sync_state.SetCurrentSyncPhase(MASTERNODE_SYNC_LIST);
+    fresh.StartRound();
+    for (NodeId id = 0; id < MASTERNODE_SYNC_THRESHOLD + 1; id++) {
+        fresh.AddRequest(id);
+    }
+    for (NodeId id = 0; id < MASTERNODE_SYNC_THRESHOLD; id++) {
+        fresh.ProcessSyncStatusMsg(id, MASTERNODE_SYNC_LIST, 0);
+    }
+    BOOST_CHECK_EQUAL(fresh.IdleWindow(nMaxWindow), nMaxWindow);
+
+    // A reset drops the resumed state
+    sync.Reset();
+    BOOST_CHECK(!sync.IsResumed());
+
+    // Synced too long before the restart
+    synced.SetLastSynced(now - MASTERNODE_SYNC_RESUME_TIME - 1);
+    ss << synced;
+    ss >> sync;
+    sync.CheckResume();
+    BOOST_CHECK(!sync.IsResumed());
+
+    // Never synced
+    synced.SetLastSynced(0);
+    ss << synced;
+    ss >> sync;
+    sync.CheckResume();
+    BOOST_CHECK(!sync.IsResumed());
+
+    sync.Reset();
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
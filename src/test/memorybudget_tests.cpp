@@ -0,0 +1,64 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "memorybudget.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(memorybudget_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(memory_budget_trims_by_priority)
+{
+    CMemoryBudget budget;
+    size_t nLow = 3000, nNormal = 4000, nHigh = 5000, nFixed = 1000;
+    budget.Register("low", MEMORY_PRIORITY_LOW, [&nLow] { return nLow; },
+                    [&nLow](size_t nTarget) { nLow = std::min(nLow, nTarget); });
+    budget.Register("high", MEMORY_PRIORITY_HIGH, [&nHigh] { return nHigh; },
+                    [&nHigh](size_t nTarget) { nHigh = std::min(nHigh, nTarget); });
+    budget.Register("normal", MEMORY_PRIORITY_NORMAL, [&nNormal] { return nNormal; },
+                    [&nNormal](size_t nTarget) { nNormal = std::min(nNormal, nTarget); });
+    budget.Register("fixed", MEMORY_PRIORITY_LOW, [&nFixed] { return nFixed; });
+
+    // No cap: only reported
+    BOOST_CHECK_EQUAL(budget.Enforce(), 0U);
+    std::vector<CMemoryBudget::ComponentUsage> vUsage = budget.GetUsage();
+    BOOST_CHECK_EQUAL(vUsage.size(), 4U);
+    BOOST_CHECK_EQUAL(vUsage[0].strName, "low");
+    BOOST_CHECK_EQUAL(vUsage[3].nUsage, 1000U);
+    BOOST_CHECK(!vUsage[3].fTrimmable);
+
+    // Under the cap
+    budget.SetLimit(13000);
+    BOOST_CHECK_EQUAL(budget.Enforce(), 0U);
+
+    // 2000 bytes over: only the lowest priority is trimmed, the fixed cache left alone
+    budget.SetLimit(11000);
+    BOOST_CHECK_EQUAL(budget.Enforce(), 2000U);
+    BOOST_CHECK_EQUAL(nLow, 1000U);
+    BOOST_CHECK_EQUAL(nNormal, 4000U);
+    BOOST_CHECK_EQUAL(nFixed, 1000U);
+
+    // 3000 bytes over: the lowest priority is emptied, then the normal one
+    budget.SetLimit(8000);
+    BOOST_CHECK_EQUAL(budget.Enforce(), 3000U);
+    BOOST_CHECK_EQUAL(nLow, 0U);
+    BOOST_CHECK_EQUAL(nNormal, 2000U);
+    BOOST_CHECK_EQUAL(nHigh, 5000U);
+
+    vUsage = budget.GetUsage();
+    BOOST_CHECK_EQUAL(vUsage[0].nTrims, 2U);
+    BOOST_CHECK_EQUAL(vUsage[1].nTrims, 0U);
+    BOOST_CHECK_EQUAL(vUsage[2].nTrims, 1U);
+
+    // Re-registering replaces the component, unregistering removes it
+    budget.Register("fixed", MEMORY_PRIORITY_LOW, [] { return (size_t)10; });
+    BOOST_CHECK_EQUAL(budget.GetUsage().size(), 4U);
+    BOOST_CHECK_EQUAL(budget.GetUsage()[3].nUsage, 10U);
+    budget.Unregister("fixed");
+    BOOST_CHECK_EQUAL(budget.GetUsage().size(), 3U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
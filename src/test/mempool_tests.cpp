@@ -579,4 +579,210 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolClusterTest)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    TestMemPoolEntryHelper entry;
+    LOCK(pool.cs);
+
+    // tx1 alone, and a cluster of tx2 with its children tx3 (paying for it) and tx4
+    std::vector<CMutableTransaction> txs(4);
+    for (size_t i = 0; i < txs.size(); i++) {
+        txs[i].vin.resize(1);
+        txs[i].vin[0].scriptSig = CScript() << (int64_t)i;
+        txs[i].vout.resize(2);
+        txs[i].vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        txs[i].vout[0].nValue = COIN;
+        txs[i].vout[1] = txs[i].vout[0];
+    }
+    txs[2].vin[0].prevout = COutPoint(txs[1].GetHash(), 0);
+    txs[3].vin[0].prevout = COutPoint(txs[1].GetHash(), 1);
+    pool.addUnchecked(txs[0].GetHash(), entry.Fee(10000LL).FromTx(txs[0]));
+    pool.addUnchecked(txs[1].GetHash(), entry.Fee(1000LL).FromTx(txs[1]));
+    pool.addUnchecked(txs[2].GetHash(), entry.Fee(50000LL).FromTx(txs[2]));
+    pool.addUnchecked(txs[3].GetHash(), entry.Fee(0LL).FromTx(txs[3]));
+
+    CTxMemPool::setEntries setCluster;
+    pool.CalculateCluster(pool.mapTx.find(txs[2].GetHash()), setCluster);
+    BOOST_CHECK_EQUAL(setCluster.size(), 3);
+    CTxMemPool::setEntries setAlone;
+    pool.CalculateCluster(pool.mapTx.find(txs[0].GetHash()), setAlone);
+    BOOST_CHECK_EQUAL(setAlone.size(), 1);
+
+    // The parent is mined with the child paying for it, the other child comes last
+    std::vector<CTxMemPool::ClusterChunk> vChunks;
+    pool.LinearizeCluster(setCluster, vChunks);
+    BOOST_REQUIRE_EQUAL(vChunks.size(), 2);
+    BOOST_REQUIRE_EQUAL(vChunks[0].vTxs.size(), 2);
+    BOOST_CHECK(vChunks[0].vTxs[0]->GetTx().GetHash() == txs[1].GetHash());
+    BOOST_CHECK(vChunks[0].vTxs[1]->GetTx().GetHash() == txs[2].GetHash());
+    BOOST_CHECK_EQUAL(vChunks[0].nModFees, 51000);
+    BOOST_REQUIRE_EQUAL(vChunks[1].vTxs.size(), 1);
+    BOOST_CHECK(vChunks[1].vTxs[0]->GetTx().GetHash() == txs[3].GetHash());
+
+    // The chunks are evicted from the lowest feerate: tx4, then tx1 (paying less than tx2 with tx3)
+    pool.SetClusterEviction(true);
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!pool.exists(txs[3].GetHash()));
+    BOOST_CHECK_EQUAL(pool.size(), 3);
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!pool.exists(txs[0].GetHash()));
+    BOOST_CHECK(pool.exists(txs[1].GetHash()));
+    BOOST_CHECK(pool.exists(txs[2].GetHash()));
+
+    // The eviction order is kept across the calls, and updated by the new txs: tx3 gets a child
+    // paying nothing (now the last chunk of the cluster), and a new tx is alone
+    CMutableTransaction txChild = txs[2];
+    txChild.vin[0].prevout = COutPoint(txs[2].GetHash(), 0);
+    CMutableTransaction txAlone = txs[0];
+    txAlone.vin[0].scriptSig = CScript() << (int64_t)txs.size();
+    pool.addUnchecked(txChild.GetHash(), entry.Fee(0LL).FromTx(txChild));
+    pool.addUnchecked(txAlone.GetHash(), entry.Fee(20000LL).FromTx(txAlone));
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!pool.exists(txChild.GetHash()));
+    BOOST_CHECK(pool.exists(txAlone.GetHash()));
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!pool.exists(txAlone.GetHash()));
+    BOOST_CHECK_EQUAL(pool.size(), 2);
+    pool.TrimToSize(0);
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolShieldedSizeLimitTest)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    TestMemPoolEntryHelper entry;
+    LOCK(pool.cs);
+
+    // A transparent tx paying the lowest fee, and two shielded txs
+    std::vector<CMutableTransaction> txs(3);
+    for (size_t i = 0; i < txs.size(); i++) {
+        txs[i].vin.resize(1);
+        txs[i].vin[0].scriptSig = CScript() << (int64_t)i;
+        txs[i].vout.resize(1);
+        txs[i].vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        txs[i].vout[0].nValue = COIN;
+        if (i > 0) {
+            txs[i].nVersion = CTransaction::TxVersion::SAPLING;
+            txs[i].sapData->valueBalance = -COIN;
+        }
+    }
+    pool.addUnchecked(txs[0].GetHash(), entry.Fee(1000LL).FromTx(txs[0]));
+    BOOST_CHECK_EQUAL(pool.GetShieldedDynamicMemoryUsage(), 0);
+    pool.addUnchecked(txs[1].GetHash(), entry.Fee(20000LL).FromTx(txs[1]));
+    const uint64_t nUsage = pool.GetShieldedDynamicMemoryUsage();
+    BOOST_CHECK(nUsage > 0);
+    pool.addUnchecked(txs[2].GetHash(), entry.Fee(30000LL).FromTx(txs[2]));
+    BOOST_CHECK(pool.GetShieldedDynamicMemoryUsage() > nUsage);
+
+    // The shielded txs are evicted from the lowest score, without touching the transparent one
+    pool.TrimShieldedToSize(pool.GetShieldedDynamicMemoryUsage() - 1);
+    BOOST_CHECK(!pool.exists(txs[1].GetHash()));
+    BOOST_CHECK(pool.exists(txs[2].GetHash()));
+    BOOST_CHECK(pool.exists(txs[0].GetHash()));
+    pool.TrimShieldedToSize(0);
+    BOOST_CHECK_EQUAL(pool.size(), 1);
+    BOOST_CHECK(pool.exists(txs[0].GetHash()));
+    BOOST_CHECK_EQUAL(pool.GetShieldedDynamicMemoryUsage(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolRemoveForBlockTest)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    TestMemPoolEntryHelper entry;
+    LOCK(pool.cs);
+
+    // txs[1] and txs[2] spend the same output of txs[0], txs[3] is a child of txs[2],
+    // txs[4] a child of txs[1], and txs[5] and txs[6] spend the same nullifier.
+    std::vector<CMutableTransaction> txs(7);
+    for (size_t i = 0; i < txs.size(); i++) {
+        txs[i].vin.resize(1);
+        txs[i].vin[0].scriptSig = CScript() << (int64_t)i;
+        txs[i].vout.resize(1);
+        txs[i].vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        txs[i].vout[0].nValue = COIN;
+    }
+    txs[1].vin[0].prevout = COutPoint(txs[0].GetHash(), 0);
+    txs[2].vin[0].prevout = COutPoint(txs[0].GetHash(), 0);
+    txs[3].vin[0].prevout = COutPoint(txs[2].GetHash(), 0);
+    txs[4].vin[0].prevout = COutPoint(txs[1].GetHash(), 0);
+    SpendDescription sd;
+    sd.nullifier = GetRandHash();
+    for (size_t i : {5, 6}) {
+        txs[i].nVersion = CTransaction::TxVersion::SAPLING;
+        txs[i].sapData->vShieldedSpend.push_back(sd);
+    }
+    for (size_t i : {0, 1, 4, 5}) {
+        pool.addUnchecked(txs[i].GetHash(), entry.Fee(10000LL).FromTx(txs[i]));
+    }
+    BOOST_CHECK_EQUAL(pool.size(), 4);
+    BOOST_CHECK(pool.nullifierExists(sd.nullifier));
+
+    std::vector<CTransactionRef> block;
+    for (size_t i : {0, 1, 6}) {
+        block.emplace_back(MakeTransactionRef(txs[i]));
+    }
+    // The block confirms txs[0] and txs[1], and conflicts with txs[5] through the nullifier.
+    pool.removeForBlock(block, 1);
+    // txs[4] spends an output of the block, so it stays, with no in-mempool ancestors
+    BOOST_CHECK_EQUAL(pool.size(), 1);
+    BOOST_CHECK(pool.exists(txs[4].GetHash()));
+    BOOST_CHECK_EQUAL(pool.mapTx.find(txs[4].GetHash())->GetCountWithAncestors(), 1);
+    BOOST_CHECK(!pool.nullifierExists(sd.nullifier));
+
+    // A mempool tx spending an input of a block tx is removed with its descendants
+    pool.addUnchecked(txs[2].GetHash(), entry.Fee(10000LL).FromTx(txs[2]));
+    pool.addUnchecked(txs[3].GetHash(), entry.Fee(10000LL).FromTx(txs[3]));
+    CMutableTransaction blockTx = txs[1];
+    blockTx.vin[0].scriptSig = CScript() << OP_11;
+    pool.removeForBlock({MakeTransactionRef(blockTx)}, 2);
+    BOOST_CHECK_EQUAL(pool.size(), 1);
+    BOOST_CHECK(!pool.exists(txs[2].GetHash()));
+    BOOST_CHECK(!pool.exists(txs[3].GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolSnapshotTest)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx1;
+    tx1.vin.resize(1);
+    tx1.vin[0].scriptSig = CScript() << OP_11;
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    CMutableTransaction tx2;
+    tx2.vin.resize(1);
+    tx2.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+    tx2.vout.resize(1);
+    tx2.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx2.vout[0].nValue = 9 * COIN;
+
+    pool.addUnchecked(tx1.GetHash(), entry.Fee(10000LL).FromTx(tx1));
+    auto snapshot = pool.GetSnapshot();
+    BOOST_REQUIRE_EQUAL(snapshot->size(), 1);
+    BOOST_CHECK((*snapshot)[0].txid == tx1.GetHash());
+    BOOST_CHECK_EQUAL((*snapshot)[0].nFee, 10000);
+    // The snapshot is shared until the mempool changes
+    BOOST_CHECK(pool.GetSnapshot() == snapshot);
+
+    pool.addUnchecked(tx2.GetHash(), entry.Fee(20000LL).FromTx(tx2));
+    auto snapshot2 = pool.GetSnapshot();
+    BOOST_CHECK(snapshot2 != snapshot);
+    BOOST_CHECK_EQUAL(snapshot->size(), 1);
+    BOOST_REQUIRE_EQUAL(snapshot2->size(), 2);
+    BOOST_CHECK((*snapshot2)[0].txid == tx1.GetHash());
+    BOOST_CHECK_EQUAL((*snapshot2)[0].nCountWithDescendants, 2);
+    BOOST_CHECK((*snapshot2)[1].txid == tx2.GetHash());
+    BOOST_CHECK_EQUAL((*snapshot2)[1].nCountWithAncestors, 2);
+    BOOST_REQUIRE_EQUAL((*snapshot2)[1].vParents.size(), 1);
+    BOOST_CHECK((*snapshot2)[1].vParents[0] == tx1.GetHash());
+
+    pool.PrioritiseTransaction(tx2.GetHash(), 5000);
+    BOOST_CHECK_EQUAL((*pool.GetSnapshot())[1].nModifiedFee, 25000);
+    pool.clear();
+    BOOST_CHECK(pool.GetSnapshot()->empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -115,6 +115,14 @@ BOOST_AUTO_TEST_CASE(merkle_test)
             BOOST_CHECK((newRoot == uint256()) == (ntx == 0));
             BOOST_CHECK(oldMutated == newMutated);
             BOOST_CHECK(newMutated == !!mutate);
+            // The levels of the tree, one after the other, are the old merkle tree.
+            std::vector<uint256> leaves;
+            for (const auto& tx : block.vtx) leaves.push_back(tx->GetHash());
+            std::vector<uint256> levelsTree;
+            for (const auto& level : ComputeMerkleLevels(leaves)) {
+                levelsTree.insert(levelsTree.end(), level.begin(), level.end());
+            }
+            BOOST_CHECK(levelsTree == merkleTree);
             // If no mutation was done (once for every ntx value), try up to 16 branches.
             if (mutate == 0) {
                 for (int loop = 0; loop < std::min(ntx, 16); loop++) {
@@ -304,6 +304,11 @@ BOOST_FIXTURE_TEST_CASE(mnwinner_test, TestChain100Setup)
     mnodeman.Remove(mnToPay->vin.prevout);
     BOOST_CHECK_MESSAGE(!mnodeman.Find(mnToPay->vin.prevout), "error: removed MN is still available");
 
+    // The cached ranks of the block follow the removal
+    std::vector<std::pair<int64_t, MasternodeRef>> mnRankAfterRemoval = mnodeman.GetMasternodeRanks(nextBlockHeight - 100);
+    BOOST_CHECK_EQUAL(mnRankAfterRemoval.size(), mnRank.size() - 1);
+    BOOST_CHECK(mnRankAfterRemoval[0].second == mnRank[1].second);
+
     // Now emit the vote from MN7
     auto voterMn = findMNData(mnList, mnRank[7].second);
     CMasternode* pVoterMN = mnodeman.Find(voterMn.mn.vin.prevout);
@@ -314,4 +319,43 @@ BOOST_FIXTURE_TEST_CASE(mnwinner_test, TestChain100Setup)
     BOOST_CHECK_MESSAGE(stateInternal.IsValid(), stateInternal.GetRejectReason());
 }
 
+BOOST_AUTO_TEST_CASE(mnping_seen_test)
+{
+    CMasternodeMan man;
+    const CTxIn vin(GetRandHash(), 0);
+    const int64_t nTime = GetTime();
+    std::vector<CMasternodePing> vPings;
+    for (int i = 0; i < 3; i++) {
+        vPings.emplace_back(vin, GetRandHash(), nTime + i * 60);
+    }
+
+    // Only the last ping of the masternode is kept whole, also when an older one arrives later
+    man.AddSeenPing(vPings[0]);
+    man.AddSeenPing(vPings[2]);
+    man.AddSeenPing(vPings[1]);
+    CMasternodePing mnp;
+    for (const CMasternodePing& ping : vPings) {
+        BOOST_CHECK(man.HasSeenPing(ping.GetHash()));
+    }
+    BOOST_CHECK(!man.GetSeenPing(vPings[0].GetHash(), mnp));
+    BOOST_CHECK(!man.GetSeenPing(vPings[1].GetHash(), mnp));
+    BOOST_CHECK(man.GetSeenPing(vPings[2].GetHash(), mnp));
+    BOOST_CHECK(mnp.GetHash() == vPings[2].GetHash());
+
+    // The pings of other masternodes are kept apart
+    const CMasternodePing otherPing(CTxIn(GetRandHash(), 0), GetRandHash(), nTime);
+    man.AddSeenPing(otherPing);
+    BOOST_CHECK(man.GetSeenPing(otherPing.GetHash(), mnp));
+    BOOST_CHECK(man.GetSeenPing(vPings[2].GetHash(), mnp));
+
+    // The cache keeps the whole pings only
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << man;
+    CMasternodeMan man2;
+    ss >> man2;
+    BOOST_CHECK(!man2.HasSeenPing(vPings[0].GetHash()));
+    BOOST_CHECK(man2.GetSeenPing(vPings[2].GetHash(), mnp));
+    BOOST_CHECK(man2.GetSeenPing(otherPing.GetHash(), mnp));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
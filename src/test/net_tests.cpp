@@ -7,6 +7,9 @@
 #include "hash.h"
 #include "net.h"
 #include "netbase.h"
+#include "netbuffers.h"
+#include "netmessagemaker.h"
+#include "netmsgstats.h"
 #include "serialize.h"
 #include "span.h"
 #include "streams.h"
@@ -702,4 +705,124 @@ BOOST_AUTO_TEST_CASE(PoissonNextSend)
     g_mock_deterministic_tests = false;
 }
 
+// The commands of the messages queued to send
+static std::vector<std::string> GetSendCommands(CNode& node)
+{
+    LOCK(node.cs_vSend);
+    std::vector<std::string> ret;
+    for (auto it = node.vSendMsg.begin(); it != node.vSendMsg.end(); ++it) {
+        const std::vector<unsigned char>& header = **it;
+        const char* pchCommand = (const char*)header.data() + CMessageHeader::MESSAGE_START_SIZE;
+        ret.emplace_back(pchCommand, strnlen(pchCommand, CMessageHeader::COMMAND_SIZE));
+        if (ReadLE32(header.data() + CMessageHeader::MESSAGE_SIZE_OFFSET) != 0) ++it;
+    }
+    return ret;
+}
+
+BOOST_AUTO_TEST_CASE(send_priority_lane)
+{
+    CConnman connman(0x1337, 0x1337);
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    const CAddress addr(CService(ipv4Addr, 7777), NODE_NETWORK);
+    CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+
+    // Without socket, nothing is sent
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, "", false);
+    connman.PushMessage(&node, msgMaker.Make(NetMsgType::PING, (uint64_t)1));
+    connman.PushMessage(&node, msgMaker.Make(NetMsgType::GETADDR));
+    connman.PushMessage(&node, msgMaker.Make(NetMsgType::QSIGREC, (uint64_t)2));
+    connman.PushMessage(&node, msgMaker.Make(NetMsgType::GETADDR));
+    connman.PushMessage(&node, msgMaker.Make(NetMsgType::CLSIG, (uint64_t)3));
+    // The quorum messages first, in order
+    std::vector<std::string> expected{NetMsgType::QSIGREC, NetMsgType::CLSIG, NetMsgType::PING,
+                                      NetMsgType::GETADDR, NetMsgType::GETADDR};
+    BOOST_CHECK(GetSendCommands(node) == expected);
+
+    // Not before a message partially sent
+    CNode node2(1, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, "", false);
+    connman.PushMessage(&node2, msgMaker.Make(NetMsgType::PING, (uint64_t)1));
+    connman.PushMessage(&node2, msgMaker.Make(NetMsgType::GETADDR));
+    WITH_LOCK(node2.cs_vSend, node2.nSendOffset = 1);
+    connman.PushMessage(&node2, msgMaker.Make(NetMsgType::CLSIG, (uint64_t)3));
+    expected = {NetMsgType::PING, NetMsgType::CLSIG, NetMsgType::GETADDR};
+    BOOST_CHECK(GetSendCommands(node2) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(net_msg_stats)
+{
+    CNetMsgStats stats;
+    BOOST_CHECK(stats.ToJson()["messages"].empty());
+
+    stats.Record(NetMsgType::TX, 100, 30, 2000);
+    stats.Record(NetMsgType::TX, 200, 2000000, 30);
+    stats.Record(NetMsgType::BUDGETVOTE, 50, 10, 10);
+    stats.Record(NetMsgType::QSIGSHARESINV, 50, 10, 10);
+    // the unknown ones are recorded together
+    stats.Record("unknown1", 10, 0, 0);
+    stats.Record("unknown2", 10, 0, 0);
+
+    UniValue json = stats.ToJson();
+    const UniValue& tx = json["messages"][NetMsgType::TX];
+    BOOST_CHECK_EQUAL(tx["count"].get_int(), 2);
+    BOOST_CHECK_EQUAL(tx["bytes"].get_int(), 300);
+    BOOST_CHECK_EQUAL(tx["wait"]["max_us"].get_int(), 2000000);
+    BOOST_CHECK_EQUAL(tx["wait"]["histogram"]["<=50us"].get_int(), 1);
+    BOOST_CHECK_EQUAL(tx["wait"]["histogram"][">1000ms"].get_int(), 1);
+    BOOST_CHECK_EQUAL(tx["process"]["avg_us"].get_int(), 1015);
+    BOOST_CHECK_EQUAL(tx["process"]["histogram"]["<=2ms"].get_int(), 1);
+    BOOST_CHECK_EQUAL(json["messages"]["*other*"]["count"].get_int(), 2);
+    BOOST_CHECK(json["messages"]["unknown1"].isNull());
+    BOOST_CHECK(json["messages"][NetMsgType::BLOCK].isNull());
+
+    const UniValue& components = json["components"];
+    BOOST_CHECK_EQUAL(components["core"]["count"].get_int(), 4);
+    BOOST_CHECK_EQUAL(components["budget"]["count"].get_int(), 1);
+    BOOST_CHECK_EQUAL(components["sigshares"]["count"].get_int(), 1);
+    BOOST_CHECK(components["masternodes"].isNull());
+}
+
+BOOST_AUTO_TEST_CASE(net_buffer_pool)
+{
+    CNetBufferPool pool;
+    // rounded up to the size class
+    CSerializeData data = pool.Get(1000);
+    BOOST_CHECK(data.empty());
+    BOOST_CHECK_EQUAL(data.capacity(), 1024);
+    data.resize(1000);
+    const char* pBuffer = data.data();
+    pool.Put(std::move(data));
+    BOOST_CHECK_EQUAL(pool.GetStats().nBuffers, 1);
+    BOOST_CHECK_EQUAL(pool.GetStats().nBytes, 1024);
+
+    // the buffer is reused for a smaller size, empty
+    CSerializeData reused = pool.Get(300);
+    BOOST_CHECK(reused.empty());
+    BOOST_CHECK(reused.data() == pBuffer);
+    BOOST_CHECK_EQUAL(pool.GetStats().nReused, 1);
+    // not for a larger one
+    CSerializeData larger = pool.Get(2000);
+    BOOST_CHECK_EQUAL(larger.capacity(), 2048);
+    BOOST_CHECK_EQUAL(pool.GetStats().nAllocated, 2);
+
+    // the buffers too small, or over the largest class, are not kept
+    CSerializeData small;
+    small.reserve(100);
+    pool.Put(std::move(small));
+    CSerializeData huge;
+    huge.reserve((CNetBufferPool::MIN_CLASS_SIZE << CNetBufferPool::CLASS_COUNT) + 1);
+    pool.Put(std::move(huge));
+    BOOST_CHECK_EQUAL(pool.GetStats().nBuffers, 0);
+    BOOST_CHECK_EQUAL(pool.GetStats().nFreed, 1);
+
+    // nor over the count of a class
+    for (size_t i = 0; i <= CNetBufferPool::MAX_BUFFERS_PER_CLASS; i++) {
+        pool.Put(pool.Get(0));
+        CSerializeData buf;
+        buf.reserve(CNetBufferPool::MIN_CLASS_SIZE);
+        pool.Put(std::move(buf));
+    }
+    BOOST_CHECK_EQUAL(pool.GetStats().nBuffers, CNetBufferPool::MAX_BUFFERS_PER_CLASS);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -62,4 +62,73 @@ BOOST_AUTO_TEST_CASE(netfulfilledman_simple_add_and_expire)
     BOOST_CHECK(!fulfilledMan.HasItemRequest(service, item));
 }
 
+BOOST_AUTO_TEST_CASE(netfulfilledman_expiry_order_and_bound)
+{
+    int64_t now = GetTime();
+    SetMockTime(now);
+
+    CNetFulfilledRequestManager fulfilledMan(DEFAULT_ITEMS_FILTER_SIZE);
+    CService service = LookupNumeric("1.1.1.1", 9999);
+    fulfilledMan.AddFulfilledRequest(service, "first");
+    SetMockTime(now + 30 * 60);
+    fulfilledMan.AddFulfilledRequest(service, "second");
+    // Adding it again renews the expiration of the request
+    SetMockTime(now + 40 * 60);
+    fulfilledMan.AddFulfilledRequest(service, "first");
+    BOOST_CHECK_EQUAL(fulfilledMan.Size(), 1);
+
+    // Only the second request expired
+    SetMockTime(now + 90 * 60 + 1);
+    fulfilledMan.CheckAndRemove();
+    BOOST_CHECK(fulfilledMan.HasFulfilledRequest(service, "first"));
+    BOOST_CHECK(!fulfilledMan.HasFulfilledRequest(service, "second"));
+    SetMockTime(now + 100 * 60 + 1);
+    fulfilledMan.CheckAndRemove();
+    BOOST_CHECK_EQUAL(fulfilledMan.Size(), 0);
+
+    // Above the limit, the oldest requests are removed first
+    fulfilledMan.AddFulfilledRequest(service, "oldest");
+    for (size_t i = 0; i < MAX_FULFILLED_REQUESTS; i++) {
+        fulfilledMan.AddFulfilledRequest(LookupNumeric(strprintf("2.2.%d.%d", i / 256, i % 256), 9999), "request");
+    }
+    BOOST_CHECK(!fulfilledMan.HasFulfilledRequest(service, "oldest"));
+    BOOST_CHECK_EQUAL(fulfilledMan.Size(), (int)MAX_FULFILLED_REQUESTS);
+}
+
+BOOST_AUTO_TEST_CASE(netfulfilledman_lru)
+{
+    int64_t now = GetTime();
+    SetMockTime(now);
+
+    CNetFulfilledRequestManager fulfilledMan(DEFAULT_ITEMS_FILTER_SIZE);
+    CService service = LookupNumeric("1.1.1.1", 9999);
+    fulfilledMan.AddFulfilledRequest(service, "first");
+    SetMockTime(now + 1);
+    fulfilledMan.AddFulfilledRequest(service, "second");
+    // Adding a request again, even many times, makes it the most recent one
+    for (int i = 0; i < 1000; i++) {
+        SetMockTime(now + 2 + i);
+        fulfilledMan.AddFulfilledRequest(service, "first");
+    }
+
+    // Above the limit, the least recently added requests are removed
+    SetMockTime(now + 1002);
+    for (size_t i = 0; i < MAX_FULFILLED_REQUESTS - 1; i++) {
+        fulfilledMan.AddFulfilledRequest(LookupNumeric(strprintf("2.2.%d.%d", i / 256, i % 256), 9999), "request");
+    }
+    BOOST_CHECK_EQUAL(fulfilledMan.Size(), (int)MAX_FULFILLED_REQUESTS);
+    BOOST_CHECK(fulfilledMan.HasFulfilledRequest(service, "first"));
+    BOOST_CHECK(!fulfilledMan.HasFulfilledRequest(service, "second"));
+    fulfilledMan.AddFulfilledRequest(LookupNumeric("3.3.3.3", 9999), "request");
+    BOOST_CHECK(!fulfilledMan.HasFulfilledRequest(service, "first"));
+    BOOST_CHECK(fulfilledMan.HasFulfilledRequest(LookupNumeric("2.2.0.0", 9999), "request"));
+
+    // The removed requests can be added again, and expire in order
+    fulfilledMan.AddFulfilledRequest(service, "second");
+    BOOST_CHECK(fulfilledMan.HasFulfilledRequest(service, "second"));
+    SetMockTime(GetTime() + 60 * 60 + 1);
+    fulfilledMan.CheckAndRemove();
+    BOOST_CHECK_EQUAL(fulfilledMan.Size(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
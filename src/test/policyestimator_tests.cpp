@@ -2,9 +2,12 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "clientversion.h"
+#include "fs.h"
 #include "policy/feerate.h"
 #include "policy/fees.h"
 #include "txmempool.h"
+#include "streams.h"
 #include "uint256.h"
 #include "util/system.h"
 
@@ -184,6 +187,21 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
         BOOST_CHECK(mpool.estimateSmartFee(i).GetFeePerK() >= mpool.estimateFee(i).GetFeePerK());
         BOOST_CHECK(mpool.estimateSmartFee(i).GetFeePerK() >= mpool.GetMinFee(1).GetFeePerK());
     }
+
+    // The estimates read back from the fee estimates file are the same
+    const fs::path path = GetDataDir() / "fee_estimates_test.dat";
+    {
+        CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(mpool.WriteFeeEstimates(fileout));
+    }
+    CTxMemPool mpool2(CFeeRate(1000));
+    {
+        CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(mpool2.ReadFeeEstimates(filein));
+    }
+    for (int i = 1; i <= (int)MAX_BLOCK_CONFIRMS; i++) {
+        BOOST_CHECK(mpool2.estimateFee(i) == mpool.estimateFee(i));
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "memusage.h"
+#include "support/allocators/pool.h"
+
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    PoolResource<8, 8> resource(64);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 64);
+
+    // The freed blocks are reused first
+    void* block = resource.Allocate(8, 8);
+    resource.Deallocate(block, 8, 8);
+    BOOST_CHECK_EQUAL(resource.Allocate(8, 8), block);
+
+    // Zero bytes take a block too
+    void* zero = resource.Allocate(0, 1);
+    BOOST_CHECK(zero != block);
+
+    // The chunk is handed out in order, then a new one is allocated
+    std::vector<void*> blocks;
+    for (int i = 0; i < 6; i++) {
+        blocks.push_back(resource.Allocate(8, 8));
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1);
+    BOOST_CHECK_EQUAL((char*)blocks[5] - (char*)blocks[4], 8);
+    void* next = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2);
+    resource.Deallocate(next, 8, 8);
+    for (void* p : blocks) {
+        resource.Deallocate(p, 8, 8);
+    }
+    resource.Deallocate(zero, 0, 1);
+    resource.Deallocate(block, 8, 8);
+
+    // Too large, or too aligned, for the pool: from operator new
+    void* large = resource.Allocate(16, 8);
+    void* aligned = resource.Allocate(8, 16);
+    BOOST_CHECK(large != nullptr && aligned != nullptr);
+    resource.Deallocate(large, 16, 8);
+    resource.Deallocate(aligned, 8, 16);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(sizes_and_rest_of_chunk)
+{
+    PoolResource<32, 8> resource(40);
+    // The blocks are rounded up to the alignment
+    void* a = resource.Allocate(1, 1);
+    void* b = resource.Allocate(9, 1);
+    BOOST_CHECK_EQUAL((char*)b - (char*)a, 8);
+    // 16 bytes left, not enough for 32: a new chunk, the rest goes to the free list of 16 bytes
+    resource.Allocate(32, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2);
+    void* c = resource.Allocate(16, 8);
+    BOOST_CHECK_EQUAL((char*)c - (char*)b, 16);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2);
+    // Each size has its free list
+    resource.Deallocate(a, 1, 1);
+    resource.Deallocate(c, 16, 8);
+    BOOST_CHECK_EQUAL(resource.Allocate(16, 8), c);
+    BOOST_CHECK_EQUAL(resource.Allocate(8, 8), a);
+}
+
+BOOST_AUTO_TEST_CASE(unordered_map_accounting)
+{
+    using Map = std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                   PoolAllocator<std::pair<const uint64_t, uint64_t>, sizeof(std::pair<const uint64_t, uint64_t>) + sizeof(void*) * 4>>;
+    Map::allocator_type::ResourceType resource(1024);
+    Map map(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), &resource);
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        map[i] = i;
+    }
+    const size_t nChunks = resource.NumAllocatedChunks();
+    BOOST_CHECK(nChunks > 1);
+    BOOST_CHECK(memusage::DynamicUsage(map) >= nChunks * 1024);
+
+    // The nodes erased are reused
+    for (uint64_t i = 0; i < 1000; i++) {
+        map.erase(i);
+        map[i + 1000] = i;
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), nChunks);
+    BOOST_CHECK_EQUAL(map.size(), 1000);
+    BOOST_CHECK_EQUAL(map[1500], 500);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,77 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "chain.h"
+#include "consensus/consensus.h"
+#include "flatfile.h"
+#include "fs.h"
+#include "tinyformat.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(pruning_tests)
+
+BOOST_FIXTURE_TEST_CASE(prune_keep_depth, BasicTestingSetup)
+{
+    // At least MIN_BLOCKS_TO_KEEP, more if a deeper reorg is allowed
+    BOOST_CHECK_EQUAL(GetPruneKeepDepth(), (int)MIN_BLOCKS_TO_KEEP);
+    gArgs.ForceSetArg("-maxreorg", std::to_string(MIN_BLOCKS_TO_KEEP + 100));
+    BOOST_CHECK_EQUAL(GetPruneKeepDepth(), (int)MIN_BLOCKS_TO_KEEP + 101);
+    gArgs.ForceSetArg("-maxreorg", std::to_string(DEFAULT_MAX_REORG_DEPTH));
+}
+
+BOOST_FIXTURE_TEST_CASE(prune_one_block_file, TestChain100Setup)
+{
+    LOCK(cs_main);
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    BOOST_CHECK_EQUAL(pindexTip->nFile, 0);
+    BOOST_CHECK(GetBlockFileInfo(0)->nBlocks > 0);
+
+    PruneOneBlockFile(0);
+
+    // The blocks lose their data, but are still part of the active chain
+    for (int nHeight = 0; nHeight <= chainActive.Height(); nHeight++) {
+        const CBlockIndex* pindex = chainActive[nHeight];
+        BOOST_CHECK(!(pindex->nStatus & BLOCK_HAVE_DATA));
+        BOOST_CHECK(!(pindex->nStatus & BLOCK_HAVE_UNDO));
+        BOOST_CHECK_EQUAL(pindex->nDataPos, 0U);
+        BOOST_CHECK_EQUAL(pindex->nUndoPos, 0U);
+        BOOST_CHECK(pindex->nTx > 0);
+    }
+    BOOST_CHECK_EQUAL(chainActive.Tip(), pindexTip);
+    BOOST_CHECK_EQUAL(chainActive.Height(), 100);
+    BOOST_CHECK_EQUAL(GetBlockFileInfo(0)->nBlocks, 0U);
+    BOOST_CHECK_EQUAL(GetBlockFileInfo(0)->nSize, 0U);
+    BOOST_CHECK_EQUAL(GetBlockFileInfo(0)->nUndoSize, 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE(unlink_pruned_files, TestChain100Setup)
+{
+    const int nPrunedFile = 5;
+    const FlatFilePos pos(nPrunedFile, 0);
+    const fs::path pathBlock = GetBlockPosFilename(pos);
+    const fs::path pathUndo = pathBlock.parent_path() / strprintf("rev%05u.dat", nPrunedFile);
+    for (const fs::path& path : {pathBlock, pathUndo}) {
+        FILE* file = fsbridge::fopen(path, "wb");
+        BOOST_REQUIRE(file);
+        fclose(file);
+    }
+    const fs::path pathCurrent = GetBlockPosFilename(FlatFilePos(0, 0));
+    BOOST_CHECK(fs::exists(pathCurrent));
+
+    // Only the block and undo files of the pruned indices are deleted
+    UnlinkPrunedFiles({nPrunedFile});
+    BOOST_CHECK(!fs::exists(pathBlock));
+    BOOST_CHECK(!fs::exists(pathUndo));
+    BOOST_CHECK(fs::exists(pathCurrent));
+
+    // The files are written to again after the unlink
+    CreateAndProcessBlock({}, coinbaseKey);
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return chainActive.Height()), 101);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,9 +5,14 @@
 
 #include "rpc/server.h"
 #include "rpc/client.h"
+#include "rpc/responsecache.h"
 
+#include "chainparams.h"
+#include "core_io.h"
 #include "netbase.h"
+#include "script/sign.h"
 #include "util/system.h"
+#include "validationinterface.h"
 
 #include "test/test_pivx.h"
 
@@ -225,6 +230,55 @@ BOOST_AUTO_TEST_CASE(json_parse_errors)
     BOOST_CHECK_THROW(ParseNonRFCJSONValue("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNL"), std::runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_batch_order)
+{
+    SetRPCWarmupFinished();
+    const std::string strGenesis = Params().GenesisBlock().GetHash().GetHex();
+
+    // Runs of parallel requests, split by requests that run alone
+    UniValue vReq(UniValue::VARR);
+    for (int i = 0; i < 40; i++) {
+        UniValue req(UniValue::VOBJ);
+        req.pushKV("id", i);
+        if (i % 10 == 9) {
+            req.pushKV("method", "getblockchaininfo");
+            req.pushKV("params", UniValue(UniValue::VARR));
+        } else if (i % 10 == 8) {
+            // out of range
+            req.pushKV("method", "getblockhash");
+            UniValue params(UniValue::VARR);
+            params.push_back(1000);
+            req.pushKV("params", params);
+        } else {
+            req.pushKV("method", "getblockhash");
+            UniValue params(UniValue::VARR);
+            params.push_back(0);
+            req.pushKV("params", params);
+        }
+        vReq.push_back(req);
+    }
+    BOOST_CHECK(tableRPC["getblockhash"]->okParallel);
+    BOOST_CHECK(!tableRPC["getblockchaininfo"]->okParallel);
+
+    // The replies are in the order of the requests
+    UniValue vReply;
+    BOOST_CHECK(vReply.read(JSONRPCExecBatch(vReq)));
+    BOOST_REQUIRE_EQUAL(vReply.size(), vReq.size());
+    for (int i = 0; i < 40; i++) {
+        const UniValue& reply = vReply[i];
+        BOOST_CHECK_EQUAL(find_value(reply, "id").get_int(), i);
+        if (i % 10 == 9) {
+            BOOST_CHECK(find_value(reply, "error").isNull());
+            BOOST_CHECK(find_value(reply, "result").isObject());
+        } else if (i % 10 == 8) {
+            BOOST_CHECK(find_value(reply, "result").isNull());
+            BOOST_CHECK(find_value(reply, "error").isObject());
+        } else {
+            BOOST_CHECK_EQUAL(find_value(reply, "result").get_str(), strGenesis);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(rpc_ban)
 {
     BOOST_CHECK_NO_THROW(CallRPC(std::string("clearbanned")));
@@ -307,4 +361,88 @@ BOOST_AUTO_TEST_CASE(rpc_ban)
     BOOST_CHECK_EQUAL(adr.get_str(), "2001:4d48:ac57:400:cacf:e9ff:fe1d:9c63/128");
 }
 
+BOOST_AUTO_TEST_CASE(rpc_response_cache)
+{
+    UniValue value(UniValue::VOBJ);
+    value.pushKV("hash", std::string(64, 'a'));
+    value.pushKV("height", 100);
+    const size_t nEntryUsage = EstimateUniValueUsage(value) + 2 * (sizeof(std::string) + std::string("key0").size());
+
+    // Room for two entries
+    RPCResponseCache cache(2 * nEntryUsage);
+    const uint256 tip1 = uint256S("01");
+    const uint256 tip2 = uint256S("02");
+    UniValue result;
+    BOOST_CHECK(!cache.Lookup("key0", tip1, result));
+    cache.Insert("key0", tip1, value);
+    BOOST_CHECK(cache.Lookup("key0", tip1, result));
+    BOOST_CHECK_EQUAL(result.write(), value.write());
+
+    // The least recently used entry is evicted
+    cache.Insert("key1", tip1, value);
+    BOOST_CHECK(cache.Lookup("key0", tip1, result));
+    cache.Insert("key2", tip1, value);
+    BOOST_CHECK(cache.Lookup("key0", tip1, result));
+    BOOST_CHECK(!cache.Lookup("key1", tip1, result));
+    BOOST_CHECK(cache.Lookup("key2", tip1, result));
+
+    RPCResponseCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 2U);
+    BOOST_CHECK_EQUAL(stats.nUsage, 2 * nEntryUsage);
+    BOOST_CHECK_EQUAL(stats.nHits, 4U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 2U);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 1U);
+
+    // A new tip clears the cache, and the results computed on the previous one are not cached
+    BOOST_CHECK(!cache.Lookup("key0", tip2, result));
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 0U);
+    cache.Insert("key0", tip1, value);
+    BOOST_CHECK(!cache.Lookup("key0", tip2, result));
+
+    // The results larger than the cache are not cached
+    cache.SetMaxUsage(nEntryUsage - 1);
+    cache.Insert("key0", tip2, value);
+    BOOST_CHECK(!cache.Lookup("key0", tip2, result));
+    BOOST_CHECK_EQUAL(cache.GetStats().nUsage, 0U);
+}
+
+struct MempoolSubscriber : public CValidationInterface {
+    Mutex m_mutex;
+    std::set<uint256> m_txids GUARDED_BY(m_mutex);
+
+    void TransactionAddedToMempool(const CTransactionRef& ptx)
+    {
+        // Slower than the hand over of the background scheduler thread
+        MilliSleep(100);
+        LOCK(m_mutex);
+        m_txids.insert(ptx->GetHash());
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(rpc_sendrawtransaction_notifies_subscriber_queues, TestChain100Setup)
+{
+    // A subscriber on its own queue, as the wallets
+    MempoolSubscriber sub;
+    RegisterValidationInterface(&sub, true);
+
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    spend.vout.emplace_back(coinbaseTxns[0].vout[0].nValue - CENT, scriptPubKey);
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    const std::string strHex = EncodeHexTx(CTransaction(spend));
+
+    // The subscriber is aware of the transaction when the call returns
+    BOOST_CHECK_EQUAL(CallRPC("sendrawtransaction " + strHex).get_str(), spend.GetHash().GetHex());
+    BOOST_CHECK(WITH_LOCK(sub.m_mutex, return sub.m_txids.count(spend.GetHash())));
+
+    // A transaction already in the mempool is accepted again
+    BOOST_CHECK_EQUAL(CallRPC("sendrawtransaction " + strHex).get_str(), spend.GetHash().GetHex());
+    UnregisterValidationInterface(&sub);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -144,4 +144,35 @@ BOOST_AUTO_TEST_CASE(singlethreadedscheduler_ordered)
     BOOST_CHECK_EQUAL(counter2, 100);
 }
 
+BOOST_AUTO_TEST_CASE(scheduler_stats)
+{
+    CScheduler scheduler;
+    const auto now = std::chrono::system_clock::now();
+    scheduler.schedule([]{}, now - std::chrono::seconds(2));
+    scheduler.schedule([]{}, now - std::chrono::seconds(1));
+    scheduler.schedule([]{}, now + std::chrono::hours(1));
+
+    // No thread is servicing the queue yet: two tasks are overdue
+    CSchedulerStats stats = scheduler.GetStats();
+    BOOST_CHECK_EQUAL(stats.nTasks, 3);
+    BOOST_CHECK_EQUAL(stats.nOverdue, 2);
+    BOOST_CHECK(stats.nMaxDelayMicros >= 2000000);
+    BOOST_CHECK_EQUAL(stats.nRun, 0);
+
+    // Run the due tasks, then stop before the last one
+    std::atomic<bool> fDone{false};
+    scheduler.schedule([&fDone]{ fDone = true; }, now);
+    boost::thread thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    while (!fDone) MilliSleep(1);
+    scheduler.stop();
+    thread.join();
+
+    stats = scheduler.GetStats();
+    BOOST_CHECK_EQUAL(stats.nTasks, 1);
+    BOOST_CHECK_EQUAL(stats.nOverdue, 0);
+    BOOST_CHECK_EQUAL(stats.nMaxDelayMicros, 0);
+    BOOST_CHECK_EQUAL(stats.nRun, 3);
+    BOOST_CHECK(stats.nTotalDelayMicros >= 3000000);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
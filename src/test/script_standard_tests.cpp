@@ -4,6 +4,7 @@
 
 #include "key.h"
 #include "keystore.h"
+#include "primitives/transaction.h"
 #include "script/ismine.h"
 #include "script/script.h"
 #include "script/standard.h"
@@ -522,4 +523,96 @@ BOOST_AUTO_TEST_CASE(script_standard_IsMine)
     }
 }
 
+BOOST_AUTO_TEST_CASE(script_standard_IsMineCandidate)
+{
+    CKey keys[2];
+    CPubKey pubkeys[2];
+    for (int i = 0; i < 2; i++) {
+        keys[i].MakeNewKey(true);
+        pubkeys[i] = keys[i].GetPubKey();
+    }
+    CKey uncompressedKey;
+    uncompressedKey.MakeNewKey(false);
+
+    CBasicKeyStore keystore;
+    keystore.AddKey(keys[0]);
+    keystore.AddKey(uncompressedKey);
+
+    // The standard scripts paying to the known keys are candidates
+    BOOST_CHECK(keystore.IsMineCandidate(GetScriptForRawPubKey(pubkeys[0])));
+    BOOST_CHECK(keystore.IsMineCandidate(GetScriptForRawPubKey(uncompressedKey.GetPubKey())));
+    BOOST_CHECK(keystore.IsMineCandidate(GetScriptForDestination(pubkeys[0].GetID())));
+    BOOST_CHECK(keystore.IsMineCandidate(GetScriptForDestination(CExchangeKeyID(pubkeys[0].GetID()))));
+    BOOST_CHECK(keystore.IsMineCandidate(GetScriptForStakeDelegation(pubkeys[0].GetID(), pubkeys[1].GetID())));
+    BOOST_CHECK(keystore.IsMineCandidate(GetScriptForStakeDelegation(pubkeys[1].GetID(), pubkeys[0].GetID())));
+    BOOST_CHECK(keystore.IsMineCandidate(GetScriptForStakeDelegationLOF(pubkeys[1].GetID(), pubkeys[0].GetID())));
+
+    // and the ones paying to unknown keys aren't
+    BOOST_CHECK(!keystore.IsMineCandidate(GetScriptForRawPubKey(pubkeys[1])));
+    BOOST_CHECK(!keystore.IsMineCandidate(GetScriptForDestination(pubkeys[1].GetID())));
+    BOOST_CHECK(!keystore.IsMineCandidate(GetScriptForDestination(CExchangeKeyID(pubkeys[1].GetID()))));
+    BOOST_CHECK(!keystore.IsMineCandidate(GetScriptForStakeDelegation(pubkeys[1].GetID(), pubkeys[1].GetID())));
+    BOOST_CHECK_EQUAL(IsMine(keystore, GetScriptForDestination(pubkeys[1].GetID())), ISMINE_NO);
+
+    // P2SH, once the redeem script is added
+    const CScript redeemScript = GetScriptForDestination(pubkeys[0].GetID());
+    const CScript scriptP2SH = GetScriptForDestination(CScriptID(redeemScript));
+    BOOST_CHECK(!keystore.IsMineCandidate(scriptP2SH));
+    keystore.AddCScript(redeemScript);
+    BOOST_CHECK(keystore.IsMineCandidate(scriptP2SH));
+    BOOST_CHECK_EQUAL(IsMine(keystore, scriptP2SH), ISMINE_SPENDABLE);
+
+    // Watch-only scripts of unknown keys
+    const CScript scriptWatched = GetScriptForDestination(pubkeys[1].GetID());
+    keystore.AddWatchOnly(scriptWatched);
+    BOOST_CHECK(keystore.IsMineCandidate(scriptWatched));
+    BOOST_CHECK_EQUAL(IsMine(keystore, scriptWatched), ISMINE_WATCH_ONLY);
+
+    // The other scripts are solved by IsMine
+    BOOST_CHECK(keystore.IsMineCandidate(GetScriptForMultisig(1, {pubkeys[1]})));
+    BOOST_CHECK(keystore.IsMineCandidate(CScript() << OP_9 << OP_ADD << OP_11 << OP_EQUAL));
+}
+
+BOOST_AUTO_TEST_CASE(script_standard_GetOutputSolutions)
+{
+    CKey keys[2];
+    for (int i = 0; i < 2; i++) {
+        keys[i].MakeNewKey(true);
+    }
+    CBasicKeyStore keystore;
+    keystore.AddKey(keys[0]);
+
+    CMutableTransaction mtx;
+    mtx.vout.emplace_back(1, GetScriptForDestination(keys[0].GetPubKey().GetID()));
+    mtx.vout.emplace_back(2, GetScriptForStakeDelegation(keys[1].GetPubKey().GetID(), keys[0].GetPubKey().GetID()));
+    mtx.vout.emplace_back(3, CScript() << OP_9 << OP_ADD << OP_11 << OP_EQUAL);
+    const CTransaction tx(mtx);
+
+    const size_t nUsage = tx.DynamicMemoryUsage();
+    const std::vector<CScriptSolution>& vSolutions = GetOutputSolutions(tx);
+    BOOST_REQUIRE_EQUAL(vSolutions.size(), tx.vout.size());
+    // The cached results are part of the memory usage of the tx
+    BOOST_CHECK(tx.DynamicMemoryUsage() > nUsage);
+    // Computed once
+    BOOST_CHECK(&GetOutputSolutions(tx) == &vSolutions);
+    // and shared by the copies of the transaction
+    const CTransaction txCopy(tx);
+    BOOST_CHECK(&GetOutputSolutions(txCopy) == &vSolutions);
+
+    for (size_t i = 0; i < tx.vout.size(); i++) {
+        CScriptSolution solution;
+        solution.fSolved = Solver(tx.vout[i].scriptPubKey, solution.type, solution.vSolutions);
+        BOOST_CHECK_EQUAL(vSolutions[i].fSolved, solution.fSolved);
+        BOOST_CHECK_EQUAL(vSolutions[i].type, solution.type);
+        BOOST_CHECK(vSolutions[i].vSolutions == solution.vSolutions);
+        BOOST_CHECK_EQUAL(IsMine(keystore, tx.vout[i].scriptPubKey, vSolutions[i]), IsMine(keystore, tx.vout[i].scriptPubKey));
+        CTxDestination dest1, dest2;
+        BOOST_CHECK_EQUAL(ExtractDestination(vSolutions[i], dest1), ExtractDestination(tx.vout[i].scriptPubKey, dest2));
+        BOOST_CHECK(dest1 == dest2);
+    }
+    BOOST_CHECK_EQUAL(vSolutions[1].type, TX_COLDSTAKE);
+    BOOST_CHECK_EQUAL(IsMine(keystore, tx.vout[1].scriptPubKey, vSolutions[1]), ISMINE_SPENDABLE_DELEGATED);
+    BOOST_CHECK(!vSolutions[2].fSolved);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -184,6 +184,10 @@ BOOST_AUTO_TEST_CASE(sighash_test)
         #endif
         if (txTo.nVersion < CTransaction::TxVersion::SAPLING) { // Sapling has a different signature.
             BOOST_CHECK(sh == sho);
+            // The legacy sighash from the precomputed data must match too
+            const CTransaction tx(txTo);
+            PrecomputedTransactionData txdata(tx);
+            BOOST_CHECK(SignatureHash(scriptCode, tx, nIn, nHashType, 0, tx.GetRequiredSigVersion(), &txdata) == sho);
         }
     }
     #if defined(PRINT_SIGHASH_JSON)
@@ -144,4 +144,79 @@ BOOST_AUTO_TEST_CASE(findearliestatleast_test)
         BOOST_CHECK(vBlocksMain[r].GetAncestor(ret->nHeight) == ret);
     }
 }
+
+BOOST_AUTO_TEST_CASE(getrange_test)
+{
+    std::vector<uint256> vHashMain(1000);
+    std::vector<CBlockIndex> vBlocksMain(1000);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vHashMain[i] = ArithToUint256(i); // Set the hash equal to the height
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : nullptr;
+        vBlocksMain[i].phashBlock = &vHashMain[i];
+        vBlocksMain[i].BuildSkip();
+    }
+    CChain chain;
+    chain.SetTip(&vBlocksMain.back());
+
+    std::vector<CBlockIndex*> vRange = chain.GetRange(100, 199);
+    BOOST_REQUIRE_EQUAL(vRange.size(), 100);
+    for (unsigned int i=0; i<vRange.size(); i++) {
+        BOOST_CHECK(vRange[i] == &vBlocksMain[100 + i]);
+    }
+    // Clamped to the chain
+    vRange = chain.GetRange(-10, 9);
+    BOOST_REQUIRE_EQUAL(vRange.size(), 10);
+    BOOST_CHECK(vRange.front() == chain.Genesis());
+    vRange = chain.GetRange(990, 2000);
+    BOOST_REQUIRE_EQUAL(vRange.size(), 10);
+    BOOST_CHECK(vRange.back() == chain.Tip());
+    BOOST_CHECK(chain.GetRange(1000, 2000).empty());
+    BOOST_CHECK(chain.GetRange(500, 499).empty());
+}
+
+BOOST_AUTO_TEST_CASE(blockindex_side_fields_test)
+{
+    // The entries with the same accumulator checkpoint share it
+    const uint256 nAccumulatorCheckpoint = InsecureRand256();
+    CBlockIndex index1, index2;
+    index1.SetAccumulatorCheckpoint(nAccumulatorCheckpoint);
+    index2.SetAccumulatorCheckpoint(nAccumulatorCheckpoint);
+    BOOST_CHECK(index1.GetAccumulatorCheckpoint() == nAccumulatorCheckpoint);
+    BOOST_CHECK(index1.pAccumulatorCheckpoint == index2.pAccumulatorCheckpoint);
+    index2.SetAccumulatorCheckpoint(UINT256_ZERO);
+    BOOST_CHECK(index2.pAccumulatorCheckpoint == nullptr);
+    BOOST_CHECK(index2.GetAccumulatorCheckpoint().IsNull());
+
+    // Disk roundtrip, with a V1 stake modifier
+    index1.nVersion = 5;
+    index1.nHeight = 1;
+    index1.SetProofOfStake();
+    index1.SetStakeModifier(g_insecure_rand_ctx.rand64(), true);
+    BOOST_CHECK_EQUAL(index1.vStakeModifier.size(), 8);
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CDiskBlockIndex(&index1);
+    CDiskBlockIndex diskindex;
+    ss >> diskindex;
+    BOOST_CHECK(diskindex.pAccumulatorCheckpoint == index1.pAccumulatorCheckpoint);
+    BOOST_CHECK_EQUAL(diskindex.vStakeModifier.size(), 8);
+    BOOST_CHECK(std::memcmp(diskindex.vStakeModifier.data(), index1.vStakeModifier.data(), 8) == 0);
+    BOOST_CHECK(diskindex.GeneratedStakeModifier());
+
+    // V2 stake modifier
+    const uint256 nStakeModifier = InsecureRand256();
+    index2.SetStakeModifier(nStakeModifier);
+    BOOST_CHECK_EQUAL(index2.vStakeModifier.size(), 32);
+    BOOST_CHECK(std::memcmp(index2.vStakeModifier.data(), nStakeModifier.begin(), 32) == 0);
+    ss << CDiskBlockIndex(&index2);
+    CDiskBlockIndex diskindex2;
+    ss >> diskindex2;
+    BOOST_CHECK_EQUAL(diskindex2.vStakeModifier.size(), 32);
+    BOOST_CHECK(diskindex2.pAccumulatorCheckpoint == nullptr);
+
+    // A modifier larger than 32 bytes is rejected
+    ss << std::vector<unsigned char>(33);
+    CStakeModifierBytes stakeModifier;
+    BOOST_CHECK_THROW(ss >> stakeModifier, std::ios_base::failure);
+}
 BOOST_AUTO_TEST_SUITE_END()
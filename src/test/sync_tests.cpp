@@ -49,4 +49,81 @@ BOOST_AUTO_TEST_CASE(potential_deadlock_detected)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(lock_profiler)
+{
+    LockTimeHistogram hist;
+    hist.Add(0);
+    hist.Add(1);
+    hist.Add(3);
+    hist.Add(1000000000);
+    BOOST_CHECK_EQUAL(hist.nCount, 4);
+    BOOST_CHECK_EQUAL(hist.nMaxMicros, 1000000000);
+    BOOST_CHECK_EQUAL(hist.vBuckets[0], 1);
+    BOOST_CHECK_EQUAL(hist.vBuckets[1], 1);
+    BOOST_CHECK_EQUAL(hist.vBuckets[2], 1);
+    BOOST_CHECK_EQUAL(hist.vBuckets[LOCK_PROFILE_BUCKETS - 1], 1);
+
+    GetLockProfile(true);
+    const bool prev = g_lock_profiler;
+    g_lock_profiler = true;
+
+    // The sites of this file: the other threads of the tests may be profiled too
+    const auto GetTestSites = [] {
+        std::vector<LockSiteProfile> vSites;
+        for (const LockSiteProfile& site : GetLockProfile(false)) {
+            if (site.strFile == __FILE__) vSites.push_back(site);
+        }
+        return vSites;
+    };
+
+    // A thread waiting for the mutex held by this one. It may reach the lock only once the mutex is
+    // released, so try again until the wait is recorded.
+    Mutex mutex;
+    uint64_t nWaits = 0;
+    for (int nTry = 0; nTry < 100 && nWaits == 0; nTry++) {
+        std::atomic<bool> fLocked{false};
+        std::thread waiter;
+        {
+            LOCK(mutex);
+            waiter = std::thread([&mutex, &fLocked] {
+                fLocked = true;
+                LOCK(mutex);
+            });
+            while (!fLocked) std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        waiter.join();
+        nWaits = 0;
+        for (const LockSiteProfile& site : GetTestSites()) {
+            BOOST_CHECK_EQUAL(site.strName, "mutex");
+            nWaits += site.wait.nCount;
+        }
+    }
+    BOOST_CHECK_EQUAL(nWaits, 1U);
+
+    // The hold of the acquisition sampled by a new thread, its last one, doesn't count the time
+    // the lock is released by REVERSE_LOCK: it is recorded in two parts
+    GetLockProfile(true);
+    std::thread holder([&mutex] {
+        for (unsigned int i = 1; i < LOCK_PROFILE_HOLD_SAMPLING; i++) {
+            LOCK(mutex);
+        }
+        WAIT_LOCK(mutex, lock);
+        REVERSE_LOCK(lock);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    holder.join();
+    g_lock_profiler = prev;
+
+    const std::vector<LockSiteProfile> vSites = GetTestSites();
+    BOOST_CHECK_EQUAL(vSites.size(), 1U);
+    for (const LockSiteProfile& site : vSites) {
+        BOOST_CHECK_EQUAL(site.hold.nCount, 2U);
+        BOOST_CHECK(site.hold.nMaxMicros < 100000);
+        BOOST_CHECK_EQUAL(site.wait.nCount, 0U);
+    }
+    GetLockProfile(true);
+    BOOST_CHECK(GetLockProfile(false).empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include "blockassembler.h"
 #include "consensus/merkle.h"
 #include "bls/bls_wrapper.h"
+#include "crypto/sha256.h"
 #include "guiinterface.h"
 #include "evo/deterministicmns.h"
 #include "evo/evodb.h"
@@ -20,6 +21,7 @@
 #include "rpc/server.h"
 #include "rpc/register.h"
 #include "pow.h"
+#include "sapling/sapling_validation.h"
 #include "script/sigcache.h"
 #include "sporkdb.h"
 #include "streams.h"
@@ -67,6 +69,7 @@ std::ostream& operator<<(std::ostream& os, const uint256& num)
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     : m_path_root{fs::temp_directory_path() / "test_pivx" / std::to_string(g_insecure_rand_ctx_temp_path.rand32())}
 {
+    SHA256AutoDetect();
     ECC_Start();
     BLSInit();
     SetupEnvironment();
@@ -121,7 +124,7 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
         zerocoinDB.reset(new CZerocoinDB(0, true));
         pSporkDB.reset(new CSporkDB(0, true));
         pblocktree.reset(new CBlockTreeDB(1 << 20, true));
-        pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true));
+        pcoinsdbview.reset(new CCoinsViewDB(1 << 23, true, false, 1 << 20));
         pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
         llmq::InitLLMQSystem(*evoDb, &scheduler, true);
         if (!LoadGenesisBlock()) {
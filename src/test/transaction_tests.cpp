@@ -249,6 +249,15 @@ BOOST_AUTO_TEST_CASE(basic_transaction_tests)
     CValidationState state;
     BOOST_CHECK_MESSAGE(CheckTransaction(tx, state, false) && state.IsValid(), "Simple deserialized transaction should be valid.");
 
+    // The cached size matches the serialized one, also for sapling transactions
+    BOOST_CHECK_EQUAL(CTransaction(tx).GetTotalSize(), vch.size());
+    CMutableTransaction saplingTx(tx);
+    saplingTx.nVersion = CTransaction::TxVersion::SAPLING;
+    saplingTx.sapData->valueBalance = 1;
+    saplingTx.sapData->vShieldedSpend.emplace_back();
+    BOOST_CHECK_EQUAL(CTransaction(saplingTx).GetTotalSize(), ::GetSerializeSize(saplingTx, PROTOCOL_VERSION));
+    BOOST_CHECK(CTransaction(saplingTx).GetTotalSize() > vch.size());
+
     // Check that duplicate txins fail
     tx.vin.push_back(tx.vin[0]);
     BOOST_CHECK_MESSAGE(!CheckTransaction(tx, state, false) || !state.IsValid(), "Transaction with duplicate txins should be invalid.");
@@ -376,14 +385,14 @@ BOOST_AUTO_TEST_CASE(test_big_witness_transaction) {
     for(uint32_t i = 0; i < mtx.vin.size(); i++) {
         Coin coin;
         coin.nHeight = 1;
-        coin.out.nValue = 1000;
-        coin.out.scriptPubKey = scriptPubKey;
+        coin.nValue = 1000;
+        coin.SetScriptPubKey(scriptPubKey);
         coins.emplace_back(std::move(coin));
     }
 
     for(uint32_t i = 0; i < mtx.vin.size(); i++) {
         std::vector<CScriptCheck> vChecks;
-        CScriptCheck check(coins[tx.vin[i].prevout.n].out, tx, i, SCRIPT_VERIFY_P2SH, false, &precomTxData);
+        CScriptCheck check(coins[tx.vin[i].prevout.n].GetTxOut(), tx, i, SCRIPT_VERIFY_P2SH, false, &precomTxData);
         vChecks.emplace_back();
         check.swap(vChecks.back());
         control.Add(vChecks);
@@ -0,0 +1,131 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "index/txindex.h"
+#include "script/interpreter.h"
+#include "script/standard.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(txindex_tests)
+
+static void SignP2PK(CMutableTransaction& tx, const CScript& scriptPubKey, const CKey& key)
+{
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig = CScript() << vchSig;
+}
+
+BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
+{
+    TxIndex txindex(1 << 20, true);
+
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+
+    // Transaction should not be found in the index before it is started.
+    for (const auto& txn : coinbaseTxns) {
+        BOOST_CHECK(!txindex.FindTx(txn.GetHash(), block_hash, tx_disk));
+    }
+
+    // BlockUntilSyncedToCurrentChain should return false before txindex is started.
+    BOOST_CHECK(!txindex.BlockUntilSyncedToCurrentChain());
+
+    txindex.Start();
+
+    // Allow tx index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Check that txindex has all txs that were in the chain before it started.
+    for (const auto& txn : coinbaseTxns) {
+        if (!txindex.FindTx(txn.GetHash(), block_hash, tx_disk)) {
+            BOOST_ERROR("FindTx failed");
+        } else if (tx_disk->GetHash() != txn.GetHash()) {
+            BOOST_ERROR("Read incorrect tx");
+        }
+    }
+
+    // Check that new transactions in new blocks make it into the index.
+    for (int i = 0; i < 10; i++) {
+        CScript coinbase_script_pub_key = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+        std::vector<CMutableTransaction> no_txns;
+        const CBlock& block = CreateAndProcessBlock(no_txns, coinbase_script_pub_key);
+        const CTransaction& txn = *block.vtx[0];
+
+        BOOST_CHECK(txindex.BlockUntilSyncedToCurrentChain());
+        if (!txindex.FindTx(txn.GetHash(), block_hash, tx_disk)) {
+            BOOST_ERROR("FindTx failed");
+        } else if (tx_disk->GetHash() != txn.GetHash()) {
+            BOOST_ERROR("Read incorrect tx");
+        } else {
+            BOOST_CHECK(block_hash == block.GetHash());
+        }
+    }
+
+    txindex.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(txindex_lagging_lookups, TestChain100Setup)
+{
+    g_txindex.reset(new TxIndex(1 << 20, true));
+    g_txindex->Start();
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!g_txindex->BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+    // The index doesn't follow the next blocks
+    g_txindex->Stop();
+
+    // A parent spending a mature coinbase, and its child: the parent is fully spent,
+    // so only the index (or the blocks after it) can find it
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction parent;
+    parent.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    parent.vout.emplace_back(coinbaseTxns[0].vout[0].nValue - CENT, scriptPubKey);
+    SignP2PK(parent, scriptPubKey, coinbaseKey);
+    CMutableTransaction child;
+    child.vin.emplace_back(COutPoint(parent.GetHash(), 0));
+    child.vout.emplace_back(parent.vout[0].nValue - CENT, scriptPubKey);
+    SignP2PK(child, scriptPubKey, coinbaseKey);
+    const CBlock& block = CreateAndProcessBlock({parent, child}, scriptPubKey);
+    BOOST_CHECK(block.vtx.size() == 3);
+
+    // The index lags behind the tip: the blocks not indexed yet are scanned
+    std::vector<CMutableTransaction> no_txns;
+    for (int i = 0; i < TXINDEX_MAX_PENDING_SCAN - 1; i++) {
+        CreateAndProcessBlock(no_txns, scriptPubKey);
+    }
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return chainActive.Height() - g_txindex->GetBestBlockIndex()->nHeight), TXINDEX_MAX_PENDING_SCAN);
+
+    CTransactionRef tx;
+    uint256 hashBlock;
+    BOOST_CHECK(!g_txindex->FindTx(parent.GetHash(), hashBlock, tx));
+    BOOST_CHECK(GetTransaction(parent.GetHash(), tx, hashBlock, true));
+    BOOST_CHECK(tx && tx->GetHash() == parent.GetHash());
+    BOOST_CHECK(hashBlock == block.GetHash());
+
+    // Further behind, the index is catching up: the lookup fails instead of scanning the chain
+    CreateAndProcessBlock(no_txns, scriptPubKey);
+    tx.reset();
+    BOOST_CHECK(!GetTransaction(parent.GetHash(), tx, hashBlock, true));
+    BOOST_CHECK(!tx);
+
+    g_txindex.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,178 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "streams.h"
+#include "txreconciliation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sketch_decode_test)
+{
+    // Fixed ids, that decode with the sketch sizes of CellsForDiff
+    SeedInsecureRand(SeedRand::ZEROS);
+    for (size_t nDiff : {0, 1, 5, 50, 500}) {
+        ReconSketch sketch(ReconSketch::CellsForDiff(nDiff));
+        ReconSketch other(sketch.Size());
+        BOOST_CHECK_EQUAL(sketch.Size() % 3, 0);
+        // The common ids cancel out
+        for (int i = 0; i < 1000; i++) {
+            const uint32_t id = InsecureRand32();
+            sketch.Add(id);
+            other.Add(id);
+        }
+        std::set<uint32_t> onlyOurs, onlyTheirs;
+        for (size_t i = 0; i < nDiff; i++) {
+            const uint32_t id = InsecureRand32();
+            if (i % 3) {
+                sketch.Add(id);
+                onlyOurs.insert(id);
+            } else {
+                other.Add(id);
+                onlyTheirs.insert(id);
+            }
+        }
+
+        // Through the network serialization
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << other;
+        ReconSketch otherRead;
+        stream >> otherRead;
+        BOOST_CHECK_EQUAL(otherRead.Size(), other.Size());
+
+        sketch -= otherRead;
+        std::vector<uint32_t> added, removed;
+        BOOST_REQUIRE(sketch.Decode(added, removed));
+        BOOST_CHECK(std::set<uint32_t>(added.begin(), added.end()) == onlyOurs);
+        BOOST_CHECK(std::set<uint32_t>(removed.begin(), removed.end()) == onlyTheirs);
+    }
+
+    // Too many differences for the table
+    ReconSketch sketch(ReconSketch::CellsForDiff(10));
+    for (int i = 0; i < 100; i++) {
+        sketch.Add(InsecureRand32());
+    }
+    std::vector<uint32_t> added, removed;
+    BOOST_CHECK(!sketch.Decode(added, removed));
+}
+
+// Registers the peers 1 of the initiator and 2 of the responder, the two ends of a connection,
+// with fixed salts so that the short ids are the same in each run
+static void RegisterPeers(TxReconciliationTracker& initiator, TxReconciliationTracker& responder)
+{
+    const uint64_t salt1 = 1, salt2 = 2;
+    initiator.PreRegisterPeer(1, salt1);
+    responder.PreRegisterPeer(2, salt2);
+    BOOST_CHECK(initiator.RegisterPeer(1, true, TXRECONCILIATION_VERSION, salt2));
+    BOOST_CHECK(responder.RegisterPeer(2, false, TXRECONCILIATION_VERSION, salt1));
+}
+
+BOOST_AUTO_TEST_CASE(register_test)
+{
+    TxReconciliationTracker tracker;
+    const uint256 txid = InsecureRand256();
+
+    // Not pre-registered, or unknown version
+    BOOST_CHECK(!tracker.RegisterPeer(1, true, TXRECONCILIATION_VERSION, 1));
+    tracker.PreRegisterPeer(1);
+    BOOST_CHECK(!tracker.IsPeerRegistered(1));
+    BOOST_CHECK(!tracker.AddToSet(1, txid));
+    BOOST_CHECK(!tracker.RegisterPeer(1, true, 0, 1));
+    BOOST_CHECK(tracker.RegisterPeer(1, true, TXRECONCILIATION_VERSION, 1));
+    BOOST_CHECK(!tracker.RegisterPeer(1, true, TXRECONCILIATION_VERSION, 1));
+    BOOST_CHECK(tracker.IsPeerRegistered(1));
+
+    BOOST_CHECK(tracker.AddToSet(1, txid));
+    BOOST_CHECK(tracker.AddToSet(1, txid));
+    BOOST_CHECK_EQUAL(tracker.GetSetSize(1), 1);
+    tracker.TryRemovingFromSet(1, txid);
+    BOOST_CHECK_EQUAL(tracker.GetSetSize(1), 0);
+
+    // The set is bounded
+    for (size_t i = 0; i < MAX_RECON_SET_SIZE; i++) {
+        tracker.AddToSet(1, InsecureRand256());
+    }
+    BOOST_CHECK(!tracker.AddToSet(1, txid));
+
+    tracker.ForgetPeer(1);
+    BOOST_CHECK(!tracker.IsPeerRegistered(1));
+}
+
+BOOST_AUTO_TEST_CASE(reconciliation_test)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    TxReconciliationTracker initiator, responder;
+    RegisterPeers(initiator, responder);
+    const std::chrono::microseconds now{1000000000000};
+
+    std::set<uint256> onlyInitiator, onlyResponder;
+    for (int i = 0; i < 200; i++) {
+        const uint256 txid = InsecureRand256();
+        BOOST_CHECK(initiator.AddToSet(1, txid));
+        BOOST_CHECK(responder.AddToSet(2, txid));
+    }
+    for (int i = 0; i < 10; i++) {
+        onlyInitiator.insert(InsecureRand256());
+        onlyResponder.insert(InsecureRand256());
+    }
+    for (const uint256& txid : onlyInitiator) initiator.AddToSet(1, txid);
+    for (const uint256& txid : onlyResponder) responder.AddToSet(2, txid);
+
+    // Only the initiator requests, once per interval
+    BOOST_CHECK(!responder.InitiateReconciliationRequest(2, now));
+    const auto request = initiator.InitiateReconciliationRequest(1, now);
+    BOOST_CHECK(request);
+    BOOST_CHECK_EQUAL(request->first, 210);
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(1, now + RECON_REQUEST_INTERVAL));
+
+    BOOST_CHECK(!initiator.HasReconciliationTimedOut(1, now + RECON_RESPONSE_TIMEOUT));
+    BOOST_CHECK(initiator.HasReconciliationTimedOut(1, now + RECON_RESPONSE_TIMEOUT + std::chrono::seconds{1}));
+
+    ReconSketch sketch;
+    BOOST_CHECK(!initiator.HandleReconciliationRequest(1, now, request->first, request->second, sketch));
+    BOOST_CHECK(responder.HandleReconciliationRequest(2, now, request->first, request->second, sketch));
+    BOOST_CHECK(!responder.HandleReconciliationRequest(2, now, request->first, request->second, sketch));
+    BOOST_CHECK_EQUAL(responder.GetSetSize(2), 0);
+
+    std::vector<uint256> initiatorAnnounces, responderAnnounces;
+    std::vector<uint32_t> ask;
+    bool success = false;
+    BOOST_CHECK(initiator.HandleSketch(1, sketch, initiatorAnnounces, ask, success));
+    BOOST_CHECK(!initiator.HasReconciliationTimedOut(1, now + RECON_RESPONSE_TIMEOUT + std::chrono::seconds{1}));
+    BOOST_CHECK(responder.HandleReconciliationDiff(2, success, ask, responderAnnounces));
+    BOOST_CHECK_EQUAL(initiator.GetSetSize(1), 0);
+    BOOST_REQUIRE(success);
+    BOOST_CHECK(std::set<uint256>(initiatorAnnounces.begin(), initiatorAnnounces.end()) == onlyInitiator);
+    BOOST_CHECK(std::set<uint256>(responderAnnounces.begin(), responderAnnounces.end()) == onlyResponder);
+
+    // Out of sequence messages
+    BOOST_CHECK(!initiator.HandleSketch(1, sketch, initiatorAnnounces, ask, success));
+    BOOST_CHECK(!responder.HandleReconciliationDiff(2, success, ask, responderAnnounces));
+
+    // The responder rejects the requests sooner than the interval allows
+    BOOST_CHECK(!responder.HandleReconciliationRequest(2, now + std::chrono::seconds{1}, 0, 0, sketch));
+    BOOST_CHECK(!responder.HandleReconciliationRequest(2, now + RECON_REQUEST_INTERVAL - RECON_REQUEST_TOLERANCE - std::chrono::seconds{1}, 0, 0, sketch));
+
+    // The next reconciliation
+    BOOST_CHECK(initiator.InitiateReconciliationRequest(1, now + RECON_REQUEST_INTERVAL));
+    BOOST_CHECK(responder.HandleReconciliationRequest(2, now + RECON_REQUEST_INTERVAL, 0, 0, sketch));
+}
+
+BOOST_AUTO_TEST_CASE(request_size_test)
+{
+    TxReconciliationTracker initiator, responder;
+    RegisterPeers(initiator, responder);
+    const std::chrono::microseconds now{1000000000000};
+
+    // A set size above the limit is sketched as the largest possible set, not as the declared one
+    ReconSketch sketch;
+    BOOST_CHECK(responder.HandleReconciliationRequest(2, now, std::numeric_limits<uint16_t>::max(), 0, sketch));
+    BOOST_CHECK_EQUAL(sketch.Size(), ReconSketch::CellsForDiff(MAX_RECON_SET_SIZE + 1));
+    BOOST_CHECK_LE(sketch.Size(), MAX_SKETCH_CELLS);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,151 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "txrequest.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std::chrono_literals;
+
+BOOST_FIXTURE_TEST_SUITE(txrequest_tests, BasicTestingSetup)
+
+static const std::chrono::microseconds TIME_START{1000000000000};
+
+BOOST_AUTO_TEST_CASE(preferred_first_test)
+{
+    TxRequestTracker tracker(true);
+    const CInv inv(MSG_TX, InsecureRand256());
+    auto now = TIME_START;
+
+    // The non-preferred peer announced first, the preferred one is asked
+    tracker.ReceivedInv(1, inv, false, now);
+    tracker.ReceivedInv(2, inv, true, now);
+    tracker.ReceivedInv(2, inv, true, now); // duplicate, ignored
+    BOOST_CHECK_EQUAL(tracker.Size(), 2);
+    BOOST_CHECK(tracker.GetRequestable(1, now).empty());
+    BOOST_CHECK(tracker.GetRequestable(2, now) == std::vector<CInv>{inv});
+    tracker.RequestedTx(2, inv, now + 1min);
+    BOOST_CHECK_EQUAL(tracker.CountInFlight(2), 1);
+    tracker.SanityCheck();
+
+    // Nothing else is requested while the request is in flight
+    BOOST_CHECK(tracker.GetRequestable(1, now + 30s).empty());
+
+    // The request expires: the other peer is asked
+    std::vector<std::pair<NodeId, CInv>> expired;
+    BOOST_CHECK(tracker.GetRequestable(1, now + 1min, &expired) == std::vector<CInv>{inv});
+    BOOST_CHECK_EQUAL(expired.size(), 1);
+    BOOST_CHECK_EQUAL(expired[0].first, 2);
+    BOOST_CHECK_EQUAL(tracker.CountInFlight(2), 0);
+    tracker.SanityCheck();
+
+    // Once received, nothing is left
+    tracker.RequestedTx(1, inv, now + 2min);
+    tracker.ForgetInv(inv);
+    BOOST_CHECK_EQUAL(tracker.Size(), 0);
+    BOOST_CHECK_EQUAL(tracker.Count(1), 0);
+    tracker.SanityCheck();
+}
+
+BOOST_AUTO_TEST_CASE(delay_and_notfound_test)
+{
+    TxRequestTracker tracker(true);
+    const CInv inv(MSG_BUDGET_VOTE, InsecureRand256());
+    auto now = TIME_START;
+
+    tracker.ReceivedInv(1, inv, false, now + 2s);
+    tracker.ReceivedInv(2, inv, false, now + 4s);
+    BOOST_CHECK(tracker.GetRequestable(1, now).empty());
+    BOOST_CHECK_EQUAL(tracker.CountCandidates(1), 1);
+    BOOST_CHECK(tracker.GetRequestable(1, now + 2s) == std::vector<CInv>{inv});
+    tracker.RequestedTx(1, inv, now + 1min);
+    BOOST_CHECK(tracker.GetRequestable(2, now + 4s).empty());
+
+    // A notfound moves on to the next peer, without waiting for the expiry
+    tracker.ReceivedResponse(1, inv);
+    BOOST_CHECK(tracker.GetRequestable(2, now + 4s) == std::vector<CInv>{inv});
+    tracker.SanityCheck();
+
+    // The last peer answering without it forgets the inv
+    tracker.RequestedTx(2, inv, now + 1min);
+    tracker.ReceivedResponse(2, inv);
+    BOOST_CHECK_EQUAL(tracker.Size(), 0);
+    tracker.SanityCheck();
+}
+
+BOOST_AUTO_TEST_CASE(disconnect_test)
+{
+    TxRequestTracker tracker(true);
+    auto now = TIME_START;
+    std::vector<CInv> invs;
+    for (int i = 0; i < 10; i++) {
+        invs.emplace_back(i % 2 ? MSG_TX : MSG_QUORUM_RECOVERED_SIG, InsecureRand256());
+        tracker.ReceivedInv(1, invs.back(), true, now);
+        tracker.ReceivedInv(2, invs.back(), false, now);
+    }
+    // In announcement order
+    BOOST_CHECK(tracker.GetRequestable(1, now) == invs);
+    for (const CInv& inv : invs) tracker.RequestedTx(1, inv, now + 1min);
+    BOOST_CHECK_EQUAL(tracker.CountInFlight(1), invs.size());
+
+    tracker.DisconnectedPeer(1);
+    BOOST_CHECK_EQUAL(tracker.Count(1), 0);
+    BOOST_CHECK(tracker.GetRequestable(2, now) == invs);
+    tracker.SanityCheck();
+
+    tracker.DisconnectedPeer(2);
+    BOOST_CHECK_EQUAL(tracker.Size(), 0);
+    tracker.SanityCheck();
+}
+
+BOOST_AUTO_TEST_CASE(random_operations_test)
+{
+    TxRequestTracker tracker;
+    auto now = TIME_START;
+    std::vector<CInv> invs;
+    for (int i = 0; i < 20; i++) {
+        invs.emplace_back(MSG_TX, InsecureRand256());
+    }
+
+    for (int i = 0; i < 5000; i++) {
+        const NodeId peer = InsecureRandRange(8);
+        const CInv& inv = invs[InsecureRandRange(invs.size())];
+        switch (InsecureRandRange(7)) {
+        case 0:
+        case 1:
+            tracker.ReceivedInv(peer, inv, InsecureRandBool(), now + std::chrono::microseconds{InsecureRandRange(3000000)});
+            break;
+        case 2:
+            for (const CInv& req : tracker.GetRequestable(peer, now)) {
+                tracker.RequestedTx(peer, req, now + std::chrono::microseconds{InsecureRandRange(5000000)});
+            }
+            break;
+        case 3:
+            tracker.ReceivedResponse(peer, inv);
+            break;
+        case 4:
+            if (InsecureRandRange(10) == 0) tracker.DisconnectedPeer(peer);
+            break;
+        case 5:
+            if (InsecureRandRange(5) == 0) tracker.ForgetInv(inv);
+            break;
+        case 6:
+            now += std::chrono::microseconds{InsecureRandRange(1000000)};
+            break;
+        }
+        tracker.SanityCheck();
+    }
+
+    // Requested at most once per inv
+    std::set<CInv> requested;
+    for (NodeId peer = 0; peer < 8; peer++) {
+        for (const CInv& req : tracker.GetRequestable(peer, now)) {
+            BOOST_CHECK(requested.insert(req).second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -86,4 +86,60 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_block_doublespend, TestChain100Setup)
     BOOST_CHECK_EQUAL(mempool.size(), 0);
 }
 
+static void SignP2PK(CMutableTransaction& tx, const CScript& scriptPubKey, const CKey& key)
+{
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig = CScript() << vchSig;
+}
+
+BOOST_FIXTURE_TEST_CASE(tx_mempool_package, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() <<  ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // A parent spending a mature coinbase, and its child
+    CMutableTransaction parent;
+    parent.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    parent.vout.emplace_back(coinbaseTxns[0].vout[0].nValue - CENT, scriptPubKey);
+    SignP2PK(parent, scriptPubKey, coinbaseKey);
+    CMutableTransaction child;
+    child.vin.emplace_back(COutPoint(parent.GetHash(), 0));
+    child.vout.emplace_back(parent.vout[0].nValue - CENT, scriptPubKey);
+    SignP2PK(child, scriptPubKey, coinbaseKey);
+    const CTransactionRef parentRef = MakeTransactionRef(parent);
+    const CTransactionRef childRef = MakeTransactionRef(child);
+
+    LOCK(cs_main);
+    CValidationState state;
+    std::vector<CValidationState> vTxStates;
+
+    // The parents must come first
+    BOOST_CHECK(!AcceptPackageToMemoryPool(mempool, state, {childRef, parentRef}, vTxStates));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "package-not-sorted");
+    BOOST_CHECK_EQUAL(mempool.size(), 0);
+
+    state = CValidationState();
+    BOOST_CHECK(!AcceptPackageToMemoryPool(mempool, state, {parentRef, parentRef}, vTxStates));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "package-contains-duplicates");
+
+    // A sorted package is accepted in one pass
+    state = CValidationState();
+    BOOST_CHECK(AcceptPackageToMemoryPool(mempool, state, {parentRef, childRef}, vTxStates));
+    BOOST_CHECK(state.IsValid());
+    BOOST_CHECK_EQUAL(vTxStates.size(), 2);
+    BOOST_CHECK(mempool.exists(parent.GetHash()));
+    BOOST_CHECK(mempool.exists(child.GetHash()));
+
+    // Resubmitting it leaves the transactions in the mempool, while a child without its parent
+    // is reported as missing its inputs
+    BOOST_CHECK(AcceptPackageToMemoryPool(mempool, state, {parentRef, childRef}, vTxStates));
+    mempool.clear();
+    BOOST_CHECK(!AcceptPackageToMemoryPool(mempool, state, {childRef}, vTxStates));
+    BOOST_CHECK(state.IsValid());
+    BOOST_CHECK_EQUAL(vTxStates[0].GetRejectReason(), "missing-inputs");
+    BOOST_CHECK_EQUAL(mempool.size(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
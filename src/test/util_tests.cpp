@@ -14,8 +14,11 @@
 #include "util/vector.h"
 
 #include <stdint.h>
+#include <thread>
 #include <vector>
 #ifndef WIN32
+#include <pthread.h>
+#include <sched.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #endif
@@ -572,6 +575,13 @@ BOOST_AUTO_TEST_CASE(util_FormatMoney)
     BOOST_CHECK_EQUAL(FormatMoney(COIN/1000000, false), "0.000001");
     BOOST_CHECK_EQUAL(FormatMoney(COIN/10000000, false), "0.0000001");
     BOOST_CHECK_EQUAL(FormatMoney(COIN/100000000, false), "0.00000001");
+
+    BOOST_CHECK_EQUAL(FormatMoneyFixed(0), "0.00000000");
+    BOOST_CHECK_EQUAL(FormatMoneyFixed(1), "0.00000001");
+    BOOST_CHECK_EQUAL(FormatMoneyFixed(-COIN/10), "-0.10000000");
+    BOOST_CHECK_EQUAL(FormatMoneyFixed(COIN*100000000 + 1), "100000000.00000001");
+    BOOST_CHECK_EQUAL(FormatMoneyFixed(std::numeric_limits<CAmount>::max()), "92233720368.54775807");
+    BOOST_CHECK_EQUAL(FormatMoneyFixed(std::numeric_limits<CAmount>::min()), "-92233720368.54775808");
 }
 
 BOOST_AUTO_TEST_CASE(util_ParseMoney)
@@ -1143,6 +1153,40 @@ BOOST_AUTO_TEST_CASE(test_DirIsWritable)
     fs::remove(tmpdirname);
 }
 
+BOOST_AUTO_TEST_CASE(logging_async_writer)
+{
+    BCLog::Logger logger;
+    logger.m_print_to_file = true;
+    logger.m_log_timestamps = false;
+    logger.m_file_path = SetDataDir("logging_async_writer") / "debug.log";
+    BOOST_CHECK(logger.OpenDebugLog());
+
+    // Messages from concurrent threads are all written, each on its own line
+    logger.StartAsyncWriter();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&logger, t] {
+            for (int i = 0; i < 1000; i++) logger.LogPrintStr(strprintf("thread %d message %d\n", t, i));
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    logger.StopAsyncWriter();
+    // Back to synchronous writes
+    logger.LogPrintStr("last message\n");
+
+    fsbridge::ifstream file(logger.m_file_path);
+    std::string line, lastLine;
+    int nLines = 0;
+    while (std::getline(file, line)) {
+        BOOST_CHECK(line.compare(0, 7, "thread ") == 0 || line == "last message");
+        lastLine = line;
+        nLines++;
+    }
+    BOOST_CHECK_EQUAL(nLines, 4 * 1000 + 1);
+    BOOST_CHECK_EQUAL(lastLine, "last message");
+    BOOST_CHECK_EQUAL(logger.GetDroppedMessages(), 0);
+}
+
 namespace {
 
     struct Tracker
@@ -1248,4 +1292,29 @@ BOOST_AUTO_TEST_CASE(test_tracked_vector)
     BOOST_CHECK_EQUAL(v8[2].copies, 0);
 }
 
+BOOST_AUTO_TEST_CASE(validation_threads_cpus)
+{
+    BOOST_CHECK(SetValidationThreadsCpus("0"));
+    BOOST_CHECK(SetValidationThreadsCpus("0-7,16-23"));
+    BOOST_CHECK(SetValidationThreadsCpus("3,1,2-2"));
+    BOOST_CHECK(!SetValidationThreadsCpus("a"));
+    BOOST_CHECK(!SetValidationThreadsCpus("0,"));
+    BOOST_CHECK(!SetValidationThreadsCpus("7-0"));
+    BOOST_CHECK(!SetValidationThreadsCpus("-1"));
+    BOOST_CHECK(!SetValidationThreadsCpus("0-1024"));
+
+#if defined(__linux__) && defined(CPU_SET)
+    BOOST_CHECK(SetValidationThreadsCpus("0"));
+    std::thread([] {
+        ApplyValidationThreadAffinity();
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        BOOST_CHECK_EQUAL(pthread_getaffinity_np(pthread_self(), sizeof(cpuset), &cpuset), 0);
+        BOOST_CHECK_EQUAL(CPU_COUNT(&cpuset), 1);
+        BOOST_CHECK(CPU_ISSET(0, &cpuset));
+    }).join();
+#endif
+    BOOST_CHECK(SetValidationThreadsCpus(""));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
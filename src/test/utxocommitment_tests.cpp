@@ -0,0 +1,124 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "clientversion.h"
+#include "consensus/validation.h"
+#include "evo/evodb.h"
+#include "script/sign.h"
+#include "streams.h"
+#include "txdb.h"
+#include "utxocommitment.h"
+#include "utxosnapshot.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(utxocommitment_tests, TestChain100Setup)
+
+// The commitment is not maintained by the other tests: reset it even when a check throws
+struct UTXOCommitmentReset {
+    ~UTXOCommitmentReset() { WITH_LOCK(cs_main, pUTXOCommitment.reset()); }
+};
+
+// The commitment maintained must be the one computed from scratch
+static void CheckCommitment()
+{
+    FlushStateToDisk();
+    LOCK(cs_main);
+    CUTXOCommitment rebuilt;
+    BOOST_CHECK(rebuilt.Rebuild(*pcoinsdbview));
+    BOOST_CHECK(pUTXOCommitment->hashBlock == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK(rebuilt.hashBlock == pUTXOCommitment->hashBlock);
+    BOOST_CHECK_EQUAL(rebuilt.nTransactionOutputs, pUTXOCommitment->nTransactionOutputs);
+    BOOST_CHECK_EQUAL(rebuilt.nTotalAmount, pUTXOCommitment->nTotalAmount);
+    BOOST_CHECK(rebuilt.GetHash() == pUTXOCommitment->GetHash());
+    // and the one stored for the tip
+    CUTXOCommitmentStats stats;
+    BOOST_CHECK(GetUTXOCommitmentStats(chainActive.Tip()->GetBlockHash(), stats));
+    BOOST_CHECK(stats == rebuilt.GetStats());
+}
+
+BOOST_AUTO_TEST_CASE(commitment_connect_disconnect)
+{
+    UTXOCommitmentReset reset;
+    BOOST_CHECK(WITH_LOCK(cs_main, return LoadUTXOCommitment(*pcoinsdbview)));
+    const uint256 hashStart = WITH_LOCK(cs_main, return pUTXOCommitment->GetHash());
+
+    // Spend a coinbase output
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    spend.vout.emplace_back(11 * CENT, scriptPubKey);
+    spend.vout.emplace_back(coinbaseTxns[0].vout[0].nValue - 12 * CENT, scriptPubKey);
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    CBlock block = CreateAndProcessBlock({spend}, scriptPubKey);
+    BOOST_CHECK(WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash()) == block.GetHash());
+    CheckCommitment();
+    BOOST_CHECK(WITH_LOCK(cs_main, return pUTXOCommitment->GetHash()) != hashStart);
+
+    // Disconnecting the block restores the previous set
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    CheckCommitment();
+    BOOST_CHECK(WITH_LOCK(cs_main, return pUTXOCommitment->GetHash()) == hashStart);
+
+    // The commitment of the disconnected block is kept
+    CUTXOCommitmentStats stats;
+    BOOST_CHECK(GetUTXOCommitmentStats(block.GetHash(), stats));
+    BOOST_CHECK(stats.hashMuHash != hashStart);
+
+    // The commitment written with the coins is loaded back
+    {
+        LOCK(cs_main);
+        CUTXOCommitment stored;
+        BOOST_CHECK(pcoinsdbview->ReadUTXOCommitment(stored));
+        BOOST_CHECK(stored.GetHash() == hashStart);
+        BOOST_CHECK(LoadUTXOCommitment(*pcoinsdbview));
+        BOOST_CHECK(pUTXOCommitment->GetHash() == hashStart);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(commitment_snapshot)
+{
+    UTXOCommitmentReset reset;
+    BOOST_CHECK(WITH_LOCK(cs_main, return LoadUTXOCommitment(*pcoinsdbview)));
+    FlushStateToDisk();
+
+    // The coins of a snapshot are checked against the commitment stored for its base block
+    SnapshotMetadata metadata;
+    SnapshotStats stats;
+    std::string strError;
+    const fs::path path = GetDataDir() / "utxo_commitment.dat";
+    {
+        LOCK(cs_main);
+        metadata.strNetwork = Params().NetworkIDString();
+        metadata.hashBaseBlock = chainActive.Tip()->GetBlockHash();
+        metadata.nBaseHeight = chainActive.Height();
+        metadata.hashSaplingAnchor = pcoinsdbview->GetBestAnchor();
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(WriteUTXOSnapshot(file, metadata, *pcoinsdbview, *evoDb, stats, strError));
+    }
+    CUTXOCommitment commitment;
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(ReadUTXOSnapshot(file, metadata, stats, strError, &commitment));
+    }
+    fs::remove(path);
+    CUTXOCommitmentStats chainStats;
+    BOOST_CHECK(GetUTXOCommitmentStats(metadata.hashBaseBlock, chainStats));
+    BOOST_CHECK(chainStats == commitment.GetStats());
+    BOOST_CHECK_EQUAL(chainStats.nTransactionOutputs, stats.nCoins);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
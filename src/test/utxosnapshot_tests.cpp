@@ -0,0 +1,79 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_pivx.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "evo/evodb.h"
+#include "streams.h"
+#include "txdb.h"
+#include "utxosnapshot.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(utxosnapshot_tests, TestChain100Setup)
+
+static bool WriteSnapshot(const fs::path& path, const SnapshotMetadata& metadata, SnapshotStats& stats)
+{
+    std::string strError;
+    CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+    return WITH_LOCK(cs_main, return WriteUTXOSnapshot(file, metadata, *pcoinsdbview, *evoDb, stats, strError));
+}
+
+static bool ReadSnapshot(const fs::path& path, SnapshotMetadata& metadata, SnapshotStats& stats)
+{
+    std::string strError;
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    return ReadUTXOSnapshot(file, metadata, stats, strError);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_roundtrip)
+{
+    FlushStateToDisk();
+    SnapshotMetadata metadata;
+    {
+        LOCK(cs_main);
+        metadata.strNetwork = Params().NetworkIDString();
+        metadata.hashBaseBlock = chainActive.Tip()->GetBlockHash();
+        metadata.nBaseHeight = chainActive.Height();
+        metadata.hashSaplingAnchor = pcoinsdbview->GetBestAnchor();
+    }
+    const fs::path path = GetDataDir() / "utxo.dat";
+    SnapshotStats stats;
+    BOOST_CHECK(WriteSnapshot(path, metadata, stats));
+    BOOST_CHECK(stats.nCoins > 0);
+    BOOST_CHECK(stats.nEvoRecords > 0);
+    BOOST_CHECK_EQUAL(stats.nTotalAmount, pcoinsTip->GetTotalAmount());
+
+    SnapshotMetadata metadataRead;
+    SnapshotStats statsRead;
+    BOOST_CHECK(ReadSnapshot(path, metadataRead, statsRead));
+    BOOST_CHECK(statsRead == stats);
+    BOOST_CHECK(metadataRead.hashBaseBlock == metadata.hashBaseBlock);
+    BOOST_CHECK_EQUAL(metadataRead.nBaseHeight, metadata.nBaseHeight);
+    BOOST_CHECK_EQUAL(metadataRead.strNetwork, metadata.strNetwork);
+
+    // The databases are not at that block
+    SnapshotMetadata metadataOld(metadata);
+    metadataOld.hashBaseBlock = WITH_LOCK(cs_main, return chainActive.Tip()->pprev->GetBlockHash());
+    BOOST_CHECK(!WriteSnapshot(GetDataDir() / "utxo_old.dat", metadataOld, stats));
+
+    // A corrupted file is rejected
+    std::vector<char> vData;
+    {
+        std::ifstream in(path.string(), std::ios::binary);
+        vData.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    vData[vData.size() / 2] ^= 0x01;
+    {
+        std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+        out.write(vData.data(), vData.size());
+    }
+    BOOST_CHECK(!ReadSnapshot(path, metadataRead, statsRead));
+    fs::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
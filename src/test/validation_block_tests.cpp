@@ -5,6 +5,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include "blockassembler.h"
+#include "blockpipeline.h"
 #include "chainparams.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
@@ -15,6 +16,9 @@
 #include "validation.h"
 #include "validationinterface.h"
 
+#include <atomic>
+#include <future>
+
 
 #define ASSERT_WITH_MSG(cond, msg) if (!cond) { BOOST_ERROR(msg); }
 
@@ -125,6 +129,9 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
     const CBlockIndex* initial_tip = WITH_LOCK(cs_main, return chainActive.Tip());
     TestSubscriber sub(initial_tip->GetBlockHash());
     RegisterValidationInterface(&sub);
+    // ...the same, on its own queue
+    TestSubscriber sub_own_queue(initial_tip->GetBlockHash());
+    RegisterValidationInterface(&sub_own_queue, true);
 
     // create a bunch of threads that repeatedly process a block generated above at random
     // this will create parallelism and randomness inside validation - the ValidationInterface
@@ -161,8 +168,254 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
 
     SyncWithValidationInterfaceQueue();
     UnregisterValidationInterface(&sub);
+    UnregisterValidationInterface(&sub_own_queue);
 
     BOOST_CHECK_EQUAL(sub.m_expected_tip, WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash()));
+    BOOST_CHECK_EQUAL(sub_own_queue.m_expected_tip, sub.m_expected_tip);
+}
+
+BOOST_AUTO_TEST_CASE(block_validation_profiles)
+{
+    BOOST_CHECK(ProcessNewBlock(std::make_shared<CBlock>(Params().GenesisBlock()), nullptr));
+    const auto pblock = GoodBlock(Params().GenesisBlock().GetHash());
+    BOOST_CHECK(ProcessNewBlock(pblock, nullptr));
+
+    // The connected blocks are profiled, the most recent last
+    std::vector<BlockValidationProfile> vProfiles = WITH_LOCK(cs_main, return GetBlockValidationProfiles());
+    BOOST_REQUIRE(!vProfiles.empty() && vProfiles.size() <= BLOCK_PROFILE_HISTORY);
+    const BlockValidationProfile& profile = vProfiles.back();
+    BOOST_CHECK_EQUAL(profile.hash, pblock->GetHash());
+    BOOST_CHECK_EQUAL(profile.nHeight, 1);
+    BOOST_CHECK_EQUAL(profile.nTx, 1);
+    BOOST_CHECK(profile.nTimeVerify >= profile.nTimeConnect + profile.nTimePayments);
+    BOOST_CHECK(profile.nTimeConnectTotal >= profile.nTimeCheckBlock + profile.nTimeVerify + profile.nTimeProcessSpecial + profile.nTimeIndex);
+    BOOST_CHECK(profile.nTimeTotal >= profile.nTimeReadFromDisk + profile.nTimeConnectTotal + profile.nTimeFlush);
+}
+
+BOOST_AUTO_TEST_CASE(block_pipeline_processes_blocks)
+{
+    ProcessNewBlock(std::make_shared<CBlock>(Params().GenesisBlock()), nullptr);
+    uint256 hashPrev = WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash());
+    std::vector<std::shared_ptr<const CBlock>> vChain;
+    for (int i = 0; i < 20; i++) {
+        vChain.emplace_back(GoodBlock(hashPrev));
+        hashPrev = vChain.back()->GetHash();
+    }
+    const std::shared_ptr<const CBlock> pblockInvalid = BadBlock(vChain[14]->GetHash());
+    const std::shared_ptr<const CBlock> pblockOrphan = GoodBlock(GetRandHash());
+
+    // Block 11 arrives before its parent, and is received again after it. The invalid block
+    // extends the tip when it is connected. The orphan doesn't connect to anything.
+    std::vector<std::shared_ptr<const CBlock>> vPushed(vChain.begin(), vChain.begin() + 10);
+    vPushed.insert(vPushed.end(), {vChain[11], vChain[10], vChain[11], vChain[12], vChain[13], vChain[14], pblockInvalid, pblockOrphan});
+    vPushed.insert(vPushed.end(), vChain.begin() + 15, vChain.end());
+
+    Mutex cs_connected;
+    std::vector<uint256> vConnected;
+    g_block_pipeline.Start([&cs_connected, &vConnected](const std::shared_ptr<const CBlock>& pblock) {
+        ProcessNewBlock(pblock, nullptr);
+        LOCK(cs_connected);
+        vConnected.emplace_back(pblock->GetHash());
+    });
+    for (const auto& pblock : vPushed) {
+        BOOST_CHECK(g_block_pipeline.Push(pblock));
+    }
+
+    // Wait for the connect stage to process them all
+    const int64_t nTimeout = GetTimeMillis() + 30 * 1000;
+    int64_t nUptime;
+    while (g_block_pipeline.GetStats(nUptime)[CBlockPipeline::CONNECT].nBlocks < vPushed.size() && GetTimeMillis() < nTimeout) {
+        MilliSleep(10);
+    }
+    const std::vector<BlockPipelineStageStats> vStats = g_block_pipeline.GetStats(nUptime);
+    g_block_pipeline.Stop();
+    SyncWithValidationInterfaceQueue();
+
+    // Every block went through each stage once, and they were connected in the order received
+    for (int i = CBlockPipeline::RECEIVE; i < CBlockPipeline::STAGES_COUNT; i++) {
+        BOOST_CHECK_EQUAL(vStats[i].nBlocks, vPushed.size());
+        BOOST_CHECK_EQUAL(vStats[i].nQueued, 0);
+    }
+    std::vector<uint256> vPushedHashes;
+    for (const auto& pblock : vPushed) {
+        vPushedHashes.emplace_back(pblock->GetHash());
+    }
+    BOOST_CHECK(WITH_LOCK(cs_connected, return vConnected) == vPushedHashes);
+
+    // The invalid and the orphan blocks didn't stop the next ones
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(chainActive.Tip()->GetBlockHash(), vChain.back()->GetHash());
+    const CBlockIndex* pindexInvalid = LookupBlockIndex(pblockInvalid->GetHash());
+    BOOST_CHECK(pindexInvalid && (pindexInvalid->nStatus & BLOCK_FAILED_MASK));
+    BOOST_CHECK(!LookupBlockIndex(pblockOrphan->GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(header_only_entries_and_best_header)
+{
+    ProcessNewBlock(std::make_shared<CBlock>(Params().GenesisBlock()), nullptr);
+    uint256 hashTip = WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash());
+    for (int i = 0; i < 3; i++) {
+        const std::shared_ptr<const CBlock> pblock = GoodBlock(hashTip);
+        BOOST_CHECK(ProcessNewBlock(pblock, nullptr));
+        hashTip = pblock->GetHash();
+    }
+    SyncWithValidationInterfaceQueue();
+
+    LOCK(cs_main);
+    CBlockIndex* pindexTip = chainActive.Tip();
+    BOOST_CHECK_EQUAL(pindexTip->GetBlockHash(), hashTip);
+
+    // A PoW header with the wrong work is rejected
+    CBlockHeader headerBadBits = GoodBlock(hashTip)->GetBlockHeader();
+    headerBadBits.nBits++;
+    CValidationState state;
+    int nDoS = 0;
+    BOOST_CHECK(!AcceptBlockHeader(CBlock(headerBadBits), state, nullptr, pindexTip));
+    BOOST_CHECK(state.IsInvalid(nDoS) && nDoS == 100);
+    BOOST_CHECK(!LookupBlockIndex(headerBadBits.GetHash()));
+
+    // A valid PoW header is the best header, before its block
+    const CBlockHeader headerPoW = GoodBlock(hashTip)->GetBlockHeader();
+    CBlockIndex* pindexPoW = nullptr;
+    BOOST_CHECK(AcceptBlockHeader(CBlock(headerPoW), state, &pindexPoW, pindexTip));
+    BOOST_CHECK(pindexPoW && !(pindexPoW->nStatus & BLOCK_HAVE_DATA));
+    BOOST_CHECK_EQUAL(pindexBestHeader, pindexPoW);
+
+    // A PoS header can't be checked without its block: it doesn't move the best header
+    const int nPoSHeight = Params().GetConsensus().vUpgrades[Consensus::UPGRADE_POS].nActivationHeight;
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_POS, pindexPoW->nHeight + 1);
+    const CBlockHeader headerPoS = GoodBlock(headerPoW.GetHash())->GetBlockHeader();
+    CBlockIndex* pindexPoS = nullptr;
+    BOOST_CHECK(AcceptBlockHeader(CBlock(headerPoS), state, &pindexPoS, pindexPoW));
+    BOOST_CHECK(pindexPoS && pindexPoS->pprev == pindexPoW);
+    BOOST_CHECK_EQUAL(pindexBestHeader, pindexPoW);
+    UpdateNetworkUpgradeParameters(Consensus::UPGRADE_POS, nPoSHeight);
+}
+
+struct LocatorSubscriber : public CValidationInterface {
+    std::promise<void> m_started;
+    std::shared_future<void> m_release;
+    std::vector<uint256> m_locators;
+
+    LocatorSubscriber(std::shared_future<void> release) : m_release(std::move(release)) {}
+
+    void SetBestChain(const CBlockLocator& locator)
+    {
+        // The first notification blocks the queue, until the next ones are queued
+        if (m_locators.empty()) {
+            m_started.set_value();
+            m_release.wait();
+        }
+        m_locators.emplace_back(locator.vHave.front());
+    }
+};
+
+BOOST_AUTO_TEST_CASE(subscriber_queue_coalesces_best_chain)
+{
+    std::promise<void> release;
+    LocatorSubscriber sub(release.get_future().share());
+    RegisterValidationInterface(&sub, true);
+
+    const std::vector<uint256> vHashes{GetRandHash(), GetRandHash(), GetRandHash()};
+    GetMainSignals().SetBestChain(CBlockLocator({vHashes[0]}));
+    sub.m_started.get_future().wait();
+    GetMainSignals().SetBestChain(CBlockLocator({vHashes[1]}));
+    GetMainSignals().SetBestChain(CBlockLocator({vHashes[2]}));
+
+    // Wait for the background scheduler thread to hand the notifications over
+    std::promise<void> handed_over;
+    CallFunctionInValidationInterfaceQueue([&handed_over] { handed_over.set_value(); });
+    handed_over.get_future().wait();
+
+    // The notification superseded by a later one, in the same batch, is skipped
+    release.set_value();
+    SyncWithValidationInterfaceQueue();
+    UnregisterValidationInterface(&sub);
+    BOOST_CHECK(sub.m_locators == std::vector<uint256>({vHashes[0], vHashes[2]}));
+}
+
+struct SlowSubscriber : public CValidationInterface {
+    std::atomic<size_t> m_txs{0};
+
+    void TransactionAddedToMempool(const CTransactionRef& ptx)
+    {
+        MilliSleep(50);
+        m_txs++;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(subscriber_queue_unregister_joins)
+{
+    SlowSubscriber sub;
+    RegisterValidationInterface(&sub, true);
+
+    const CTransactionRef tx = MakeTransactionRef(CMutableTransaction());
+    GetMainSignals().TransactionAddedToMempool(tx);
+    GetMainSignals().TransactionAddedToMempool(tx);
+    GetMainSignals().TransactionAddedToMempool(tx);
+
+    // Wait for the background scheduler thread to hand the notifications over
+    std::promise<void> handed_over;
+    CallFunctionInValidationInterfaceQueue([&handed_over] { handed_over.set_value(); });
+    handed_over.get_future().wait();
+
+    // The pending callbacks have run when it returns...
+    UnregisterValidationInterface(&sub);
+    BOOST_CHECK_EQUAL(sub.m_txs, 3);
+
+    // ...and no later one runs
+    GetMainSignals().TransactionAddedToMempool(tx);
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(sub.m_txs, 3);
+}
+
+struct BatchSubscriber : public CValidationInterface {
+    std::vector<size_t> m_batches;
+    std::vector<std::pair<const CBlockIndex*, const CBlockIndex*>> m_tips;
+
+    void TransactionsAddedToMempool(const std::vector<CTransactionRef>& vtx)
+    {
+        m_batches.emplace_back(vtx.size());
+    }
+
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+    {
+        m_tips.emplace_back(pindexNew, pindexFork);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(validation_interface_batches_events)
+{
+    BatchSubscriber sub;
+    RegisterValidationInterface(&sub);
+
+    std::vector<uint256> vHashes(4);
+    std::vector<CBlockIndex> vIndexes(4);
+    for (size_t i = 0; i < vIndexes.size(); i++) {
+        vHashes[i] = GetRandHash();
+        vIndexes[i].phashBlock = &vHashes[i];
+        vIndexes[i].nHeight = i;
+    }
+    const CTransactionRef tx = MakeTransactionRef(CMutableTransaction());
+
+    // Block the queue, until the next events are queued
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    CallFunctionInValidationInterfaceQueue([released] { released.wait(); });
+    GetMainSignals().TransactionAddedToMempool(tx);
+    GetMainSignals().TransactionAddedToMempool(tx);
+    GetMainSignals().TransactionAddedToMempool(tx);
+    // a reorg to 2 from 0, then 3 connected, in the initial download
+    GetMainSignals().UpdatedBlockTip(&vIndexes[2], &vIndexes[0], true);
+    GetMainSignals().UpdatedBlockTip(&vIndexes[3], &vIndexes[2], true);
+    GetMainSignals().TransactionAddedToMempool(tx);
+    release.set_value();
+    SyncWithValidationInterfaceQueue();
+    UnregisterValidationInterface(&sub);
+
+    // The consecutive transactions are delivered in one batch, the superseded tip is skipped
+    BOOST_CHECK(sub.m_batches == std::vector<size_t>({3, 1}));
+    BOOST_CHECK(sub.m_tips == (std::vector<std::pair<const CBlockIndex*, const CBlockIndex*>>{{&vIndexes[3], &vIndexes[0]}}));
 }
 
 BOOST_AUTO_TEST_SUITE_END()
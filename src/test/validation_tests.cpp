@@ -6,6 +6,7 @@
 #include "blockassembler.h"
 #include "primitives/transaction.h"
 #include "sapling/sapling_validation.h"
+#include "script/sign.h"
 #include "test/librust/utiltest.h"
 #include "util/blockstatecatcher.h"
 #include "wallet/test/wallet_test_fixture.h"
@@ -159,4 +160,114 @@ BOOST_FIXTURE_TEST_CASE(zerocoin_rejection_tests, WalletRegTestingSetup)
     CheckMempoolZcRejection(mtx, "bad-txns-zc-public-spend");
 }
 
+BOOST_FIXTURE_TEST_CASE(read_shared_block_tests, TestChain100Setup)
+{
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return chainActive.Tip(); );
+    CBlock block;
+    BOOST_CHECK(ReadBlockFromDisk(block, pindex));
+
+    // The readers of a recent block share it
+    std::shared_ptr<const CBlock> pblock = ReadSharedBlockFromDisk(pindex);
+    BOOST_REQUIRE(pblock);
+    BOOST_CHECK(pblock->GetHash() == block.GetHash());
+    BOOST_CHECK(ReadSharedBlockFromDisk(pindex) == pblock);
+
+    // The raw block is the block serialized, as sent to the peers
+    std::shared_ptr<const std::vector<unsigned char>> pblockRaw = ReadRawBlockFromDisk(pindex);
+    BOOST_REQUIRE(pblockRaw);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    BOOST_CHECK(std::vector<unsigned char>(ss.begin(), ss.end()) == *pblockRaw);
+    BOOST_CHECK(ReadRawBlockFromDisk(pindex) == pblockRaw);
+
+    // The blocks of the cache are found by ReadBlockFromDisk too
+    CBlock blockCached;
+    BOOST_CHECK(ReadBlockFromDisk(blockCached, pindex));
+    BOOST_CHECK(blockCached.vtx[0] == pblock->vtx[0]);
+}
+
+BOOST_FIXTURE_TEST_CASE(reload_block_index_tests, TestChain100Setup)
+{
+    FlushStateToDisk();
+    LOCK(cs_main);
+    const size_t nEntries = mapBlockIndex.size();
+    const uint256 hashTip = chainActive.Tip()->GetBlockHash();
+    const arith_uint256 nChainWork = chainActive.Tip()->nChainWork;
+
+    // The entries decoded from the block tree DB are linked back into the same chain
+    UnloadBlockIndex();
+    BOOST_CHECK(mapBlockIndex.empty());
+    std::string strError;
+    BOOST_CHECK(LoadBlockIndex(strError));
+    BOOST_CHECK(LoadChainTip(Params()));
+    BOOST_CHECK_EQUAL(mapBlockIndex.size(), nEntries);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == hashTip);
+    BOOST_CHECK(chainActive.Tip()->nChainWork == nChainWork);
+    BOOST_CHECK_EQUAL(chainActive.Height(), 100);
+    for (const CBlockIndex* pindex = chainActive.Tip(); pindex->pprev; pindex = pindex->pprev) {
+        BOOST_CHECK_EQUAL(pindex->pprev->nHeight, pindex->nHeight - 1);
+        BOOST_CHECK(LookupBlockIndex(pindex->GetBlockHash()) == pindex);
+    }
+}
+
+// The running total of the supply changes of the blocks must be the value of the coins
+static void CheckTransparentSupply()
+{
+    LOCK(cs_main);
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    BOOST_REQUIRE(pindexTip->nChainTransparentValue);
+    BOOST_CHECK_EQUAL(*pindexTip->nChainTransparentValue, pcoinsTip->GetTotalAmount());
+    BOOST_CHECK_EQUAL(MoneySupply.Get(), *pindexTip->nChainTransparentValue);
+    BOOST_CHECK_EQUAL(MoneySupply.GetCacheHeight(), pindexTip->nHeight);
+}
+
+BOOST_FIXTURE_TEST_CASE(transparent_supply_tests, TestChain100Setup)
+{
+    CheckTransparentSupply();
+    const CAmount nSupplyStart = WITH_LOCK(cs_main, return *chainActive.Tip()->nChainTransparentValue);
+
+    // Burn a part of a coinbase output, the rest going to the fee
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    spend.vout.emplace_back(11 * CENT, CScript() << OP_RETURN);
+    spend.vout.emplace_back(coinbaseTxns[0].vout[0].nValue - 12 * CENT, scriptPubKey);
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    CBlock block = CreateAndProcessBlock({spend}, scriptPubKey);
+    BOOST_CHECK(WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash()) == block.GetHash());
+    CheckTransparentSupply();
+    {
+        LOCK(cs_main);
+        // The new coinbase and change, less the coin spent (the value burnt is not in the coins)
+        BOOST_CHECK_EQUAL(chainActive.Tip()->nTransparentValue,
+                          block.vtx[0]->GetValueOut() + spend.vout[1].nValue - coinbaseTxns[0].vout[0].nValue);
+        BOOST_CHECK(chainActive.Tip()->nStatus & BLOCK_HAVE_SUPPLY);
+    }
+
+    // The changes are written with the block index
+    FlushStateToDisk();
+    {
+        LOCK(cs_main);
+        UnloadBlockIndex();
+        std::string strError;
+        BOOST_CHECK(LoadBlockIndex(strError));
+        BOOST_CHECK(LoadChainTip(Params()));
+    }
+    CheckTransparentSupply();
+
+    // Disconnecting the block restores the previous supply
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    CheckTransparentSupply();
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return *chainActive.Tip()->nChainTransparentValue), nSupplyStart);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
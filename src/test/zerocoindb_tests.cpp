@@ -4,6 +4,7 @@
 
 #include "test/test_pivx.h"
 
+#include "consensus/zerocoin_verify.h"
 #include "txdb.h"
 #include "validation.h"
 
@@ -41,4 +42,81 @@ BOOST_FIXTURE_TEST_CASE(accumulator_checksums_db, TestingSetup)
     BOOST_CHECK(empty_map.empty());
 }
 
+BOOST_FIXTURE_TEST_CASE(frozen_serial_index, TestingSetup)
+{
+    // write random spends in the DB
+    std::vector<std::pair<CBigNum, uint256>> vSpends;
+    for (int i = 0; i < 50; i++) {
+        vSpends.emplace_back(CBigNum(InsecureRand256()), InsecureRand256());
+    }
+    BOOST_CHECK(zerocoinDB->WriteCoinSpendBatch(vSpends, InsecureRand256()));
+
+    // test ReadAllCoinSpends
+    std::vector<std::pair<uint256, uint256>> vSpendTxes;
+    BOOST_CHECK(zerocoinDB->ReadAllCoinSpends(vSpendTxes));
+    BOOST_CHECK_EQUAL(vSpendTxes.size(), vSpends.size());
+    for (const auto& spend : vSpends) {
+        auto it = std::find(vSpendTxes.begin(), vSpendTxes.end(),
+                            std::make_pair(CZerocoinDB::GetSerialHash(spend.first), spend.second));
+        BOOST_CHECK(it != vSpendTxes.end());
+    }
+
+    // build the index with a height for each serial, and read it back from disk
+    std::vector<std::pair<uint256, int>> vHeights;
+    for (size_t i = 0; i < vSpends.size(); i++) {
+        vHeights.emplace_back(CZerocoinDB::GetSerialHash(vSpends[i].first), (int)i + 1);
+    }
+    const uint256 hashBlockEnd = InsecureRand256();
+    const fs::path path = GetDataDir() / "zerocoin_serials.dat";
+    BOOST_CHECK(CFrozenSerialIndex(hashBlockEnd, 100, std::move(vHeights)).Write(path));
+    CFrozenSerialIndex index;
+    BOOST_CHECK(index.Read(path));
+    BOOST_CHECK(index.GetBlockEnd() == hashBlockEnd);
+    BOOST_CHECK_EQUAL(index.GetHeightEnd(), 100);
+    BOOST_CHECK_EQUAL(index.size(), vSpends.size());
+    for (size_t i = 0; i < vSpends.size(); i++) {
+        Optional<int> nHeight = index.Lookup(vSpends[i].first);
+        BOOST_CHECK(nHeight && *nHeight == (int)i + 1);
+    }
+    BOOST_CHECK(!index.Lookup(CBigNum(InsecureRand256())));
+
+    // a corrupted file is rejected
+    {
+        FILE* file = fsbridge::fopen(path, "rb+");
+        BOOST_REQUIRE(file);
+        fseek(file, 40, SEEK_SET);
+        int c = fgetc(file);
+        fseek(file, 40, SEEK_SET);
+        fputc(c ^ 0xff, file);
+        fclose(file);
+    }
+    BOOST_CHECK(!CFrozenSerialIndex().Read(path));
+}
+
+BOOST_FIXTURE_TEST_CASE(serial_spend_block, TestingSetup)
+{
+    // The spends are found with the block recorded with them, without the transaction index
+    LOCK(cs_main);
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    const CBigNum bnSerial(InsecureRand256());
+    const CBigNum bnSerialFork(InsecureRand256());
+    BOOST_CHECK(zerocoinDB->WriteCoinSpendBatch({{bnSerial, InsecureRand256()}}, pindexTip->GetBlockHash()));
+    BOOST_CHECK(zerocoinDB->WriteCoinSpendBatch({{bnSerialFork, InsecureRand256()}}, InsecureRand256()));
+
+    uint256 hashBlock;
+    BOOST_CHECK(zerocoinDB->ReadCoinSpendBlock(CZerocoinDB::GetSerialHash(bnSerial), hashBlock));
+    BOOST_CHECK(hashBlock == pindexTip->GetBlockHash());
+    int nHeightTx = -1;
+    BOOST_CHECK(IsSerialInBlockchain(bnSerial, nHeightTx));
+    BOOST_CHECK_EQUAL(nHeightTx, pindexTip->nHeight);
+
+    // A spend in a block out of the active chain is not in the blockchain
+    BOOST_CHECK(!IsSerialInBlockchain(bnSerialFork, nHeightTx));
+
+    // Erasing the spend erases its block too
+    BOOST_CHECK(zerocoinDB->EraseCoinSpend(bnSerial));
+    BOOST_CHECK(!zerocoinDB->ReadCoinSpendBlock(CZerocoinDB::GetSerialHash(bnSerial), hashBlock));
+    BOOST_CHECK(!IsSerialInBlockchain(bnSerial, nHeightTx));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
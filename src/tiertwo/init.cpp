@@ -4,19 +4,24 @@
 
 #include "tiertwo/init.h"
 
+#include "bls/bls_worker.h"
 #include "budget/budgetdb.h"
+#include "evo/deterministicmns.h"
 #include "evo/evodb.h"
 #include "evo/evonotificationinterface.h"
 #include "flatdb.h"
 #include "guiinterface.h"
 #include "guiinterfaceutil.h"
+#include "index/txindex.h"
 #include "masternodeman.h"
 #include "masternode-payments.h"
+#include "masternode-sync.h"
 #include "masternodeconfig.h"
 #include "llmq/quorums_init.h"
 #include "scheduler.h"
 #include "tiertwo/masternode_meta_manager.h"
 #include "tiertwo/netfulfilledman.h"
+#include "tiertwo/vote_sig_verifier.h"
 #include "validation.h"
 #include "wallet/wallet.h"
 
@@ -34,10 +39,16 @@ std::string GetTierTwoHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-masternodeaddr=<n>", strprintf("Set external address:port to get to this masternode (example: %s). Only for Legacy Masternodes", "128.127.106.235:51472"));
     strUsage += HelpMessageOpt("-budgetvotemode=<mode>", "Change automatic finalized budget voting behavior. mode=auto: Vote for only exact finalized budget match to my generated budget. (string, default: auto)");
     strUsage += HelpMessageOpt("-mnoperatorprivatekey=<bech32>", "Set the masternode operator private key. Only valid with -masternode=1. When set, the masternode acts as a deterministic masternode.");
+    strUsage += HelpMessageOpt("-votesigthreads=<n>", strprintf("Set the number of threads verifying the signatures of the budget votes and masternode winners received from the network (0 to verify them in the message handler, maximum: %d, default: %d)",
+                                                                MAX_VOTE_SIG_THREADS, DEFAULT_VOTE_SIG_THREADS));
     if (showDebug) {
         strUsage += HelpMessageOpt("-pushversion", strprintf("Modifies the mnauth serialization if the version is lower than %d."
                                                              "testnet/regtest only; ", MNAUTH_NODE_VER_VERSION));
         strUsage += HelpMessageOpt("-disabledkg", "Disable the DKG sessions process threads for the entire lifecycle. testnet/regtest only.");
+        strUsage += HelpMessageOpt("-parbls=<n>", strprintf("Set the number of threads of the BLS operations of the quorums (0 = half of the cores up to 4, maximum: %d, default: %d)",
+                                                            MAX_BLS_WORKER_THREADS, DEFAULT_BLS_WORKER_THREADS));
+        strUsage += HelpMessageOpt("-dmnsnapshotperiod=<n>", strprintf("Write the full deterministic masternode list to disk every <n> blocks (minimum: %d, default: %d)",
+                                                                       MIN_DMN_SNAPSHOT_PERIOD, DEFAULT_DMN_SNAPSHOT_PERIOD));
     }
     return strUsage;
 }
@@ -68,7 +79,7 @@ void InitTierTwoPreChainLoad(bool fReindex)
     deterministicMNManager.reset();
     evoDb.reset();
     evoDb.reset(new CEvoDB(nEvoDbCache, false, fReindex));
-    deterministicMNManager.reset(new CDeterministicMNManager(*evoDb));
+    deterministicMNManager.reset(new CDeterministicMNManager(*evoDb, gArgs.GetArg("-dmnsnapshotperiod", DEFAULT_DMN_SNAPSHOT_PERIOD)));
 }
 
 void InitTierTwoPostCoinsCacheLoad(CScheduler* scheduler)
@@ -97,8 +108,17 @@ static void LoadBlockHashesCache(CMasternodeMan& man)
     }
 }
 
+// Once the legacy masternodes are obsolete, their managers are not used anymore: the
+// (possibly large) cache files are neither parsed at startup nor serialized at shutdown.
+static bool LegacyMNCachesObsolete(int nHeight)
+{
+    return deterministicMNManager && deterministicMNManager->LegacyMNObsolete(nHeight);
+}
+
 bool LoadTierTwo(int chain_active_height, bool load_cache_files)
 {
+    const bool fLegacyObsolete = LegacyMNCachesObsolete(chain_active_height);
+
     // ################################# //
     // ## Legacy Masternodes Manager ### //
     // ################################# //
@@ -106,12 +126,16 @@ bool LoadTierTwo(int chain_active_height, bool load_cache_files)
 
     mnodeman.SetBestHeight(chain_active_height);
     LoadBlockHashesCache(mnodeman);
-    CMasternodeDB mndb;
-    CMasternodeDB::ReadResult readResult = mndb.Read(mnodeman);
-    if (readResult == CMasternodeDB::FileError)
-        LogPrintf("Missing masternode cache file - mncache.dat, will try to recreate\n");
-    else if (readResult != CMasternodeDB::Ok) {
-        LogPrintf("Error reading mncache.dat - cached data discarded\n");
+    if (fLegacyObsolete) {
+        LogPrintf("Legacy masternodes obsolete - skipping mncache.dat\n");
+    } else {
+        CMasternodeDB mndb;
+        CMasternodeDB::ReadResult readResult = mndb.Read(mnodeman);
+        if (readResult == CMasternodeDB::FileError)
+            LogPrintf("Missing masternode cache file - mncache.dat, will try to recreate\n");
+        else if (readResult != CMasternodeDB::Ok) {
+            LogPrintf("Error reading mncache.dat - cached data discarded\n");
+        }
     }
 
     // ##################### //
@@ -139,12 +163,16 @@ bool LoadTierTwo(int chain_active_height, bool load_cache_files)
     // ######################################### //
     uiInterface.InitMessage(_("Loading masternode payment cache..."));
 
-    CMasternodePaymentDB mnpayments;
-    CMasternodePaymentDB::ReadResult readResult3 = mnpayments.Read(masternodePayments);
-    if (readResult3 == CMasternodePaymentDB::FileError)
-        LogPrintf("Missing masternode payment cache - mnpayments.dat, will try to recreate\n");
-    else if (readResult3 != CMasternodePaymentDB::Ok) {
-        LogPrintf("Error reading mnpayments.dat - cached data discarded\n");
+    if (fLegacyObsolete) {
+        LogPrintf("Legacy masternodes obsolete - skipping mnpayments.dat\n");
+    } else {
+        CMasternodePaymentDB mnpayments;
+        CMasternodePaymentDB::ReadResult readResult3 = mnpayments.Read(masternodePayments);
+        if (readResult3 == CMasternodePaymentDB::FileError)
+            LogPrintf("Missing masternode payment cache - mnpayments.dat, will try to recreate\n");
+        else if (readResult3 != CMasternodePaymentDB::Ok) {
+            LogPrintf("Error reading mnpayments.dat - cached data discarded\n");
+        }
     }
 
     // ###################################### //
@@ -187,6 +215,18 @@ bool LoadTierTwo(int chain_active_height, bool load_cache_files)
         }
     }
 
+    // ########################## //
+    // ## Tier two sync state  ## //
+    // ########################## //
+    CFlatDB<CMasternodeSync> syncDb(MN_SYNC_CACHE_FILENAME, MN_SYNC_CACHE_FILE_ID);
+    if (load_cache_files) {
+        if (syncDb.Load(masternodeSync)) {
+            masternodeSync.CheckResume();
+        } else {
+            LogPrintf("Failed to load tier two sync state from %s", syncDb.GetDbPath().string());
+        }
+    }
+
     return true;
 }
 
@@ -199,11 +239,13 @@ void RegisterTierTwoValidationInterface()
 
 void DumpTierTwo()
 {
-    DumpMasternodes();
+    const bool fLegacyObsolete = deterministicMNManager && deterministicMNManager->LegacyMNObsolete();
+    if (!fLegacyObsolete) DumpMasternodes();
     DumpBudgets(g_budgetman);
-    DumpMasternodePayments();
+    if (!fLegacyObsolete) DumpMasternodePayments();
     CFlatDB<CMasternodeMetaMan>(MN_META_CACHE_FILENAME, MN_META_CACHE_FILE_ID).Dump(g_mmetaman);
     CFlatDB<CNetFulfilledRequestManager>(NET_REQUESTS_CACHE_FILENAME, NET_REQUESTS_CACHE_FILE_ID).Dump(g_netfulfilledman);
+    CFlatDB<CMasternodeSync>(MN_SYNC_CACHE_FILENAME, MN_SYNC_CACHE_FILE_ID).Dump(masternodeSync);
 }
 
 void SetBudgetFinMode(const std::string& mode)
@@ -215,9 +257,9 @@ void SetBudgetFinMode(const std::string& mode)
 bool InitActiveMN()
 {
     fMasterNode = gArgs.GetBoolArg("-masternode", DEFAULT_MASTERNODE);
-    if ((fMasterNode || masternodeConfig.getCount() > -1) && fTxIndex == false) {
-        return UIError(strprintf(_("Enabling Masternode support requires turning on transaction indexing."
-                                   "Please add %s to your configuration and start with %s"), "txindex=1", "-reindex"));
+    if ((fMasterNode || masternodeConfig.getCount() > -1) && !g_txindex) {
+        return UIError(strprintf(_("Enabling Masternode support requires turning on transaction indexing. "
+                                   "Please add %s to your configuration"), "txindex=1"));
     }
 
     if (fMasterNode) {
@@ -303,6 +345,7 @@ bool InitActiveMN()
 void StartTierTwoThreadsAndScheduleJobs(boost::thread_group& threadGroup, CScheduler& scheduler)
 {
     threadGroup.create_thread(std::bind(&ThreadCheckMasternodes));
+    g_vote_sig_verifier.Start(std::max(0, std::min(MAX_VOTE_SIG_THREADS, (int)gArgs.GetArg("-votesigthreads", DEFAULT_VOTE_SIG_THREADS))));
     scheduler.scheduleEvery(std::bind(&CNetFulfilledRequestManager::DoMaintenance, std::ref(g_netfulfilledman)), 60 * 1000);
 
     // Start LLMQ system
@@ -319,6 +362,7 @@ void StartTierTwoThreadsAndScheduleJobs(boost::thread_group& threadGroup, CSched
 
 void StopTierTwoThreads()
 {
+    g_vote_sig_verifier.Stop();
     llmq::StopLLMQSystem();
 }
 
@@ -331,5 +375,6 @@ void DeleteTierTwo()
 
 void InterruptTierTwo()
 {
+    g_vote_sig_verifier.Interrupt();
     llmq::InterruptLLMQSystem();
 }
@@ -13,15 +13,40 @@ const std::string CMasternodeMetaMan::SERIALIZATION_VERSION_STRING = "CMasternod
 CMasternodeMetaInfoPtr CMasternodeMetaMan::GetMetaInfo(const uint256& proTxHash, bool fCreate)
 {
     LOCK(cs_metaman);
+    const int64_t now = GetTime();
     auto it = metaInfos.find(proTxHash);
     if (it != metaInfos.end()) {
-        return it->second;
+        it->second.nLastAccess = now;
+        lruList.splice(lruList.begin(), lruList, it->second.itLru);
+        return it->second.info;
     }
     if (!fCreate) {
         return nullptr;
     }
-    it = metaInfos.emplace(proTxHash, std::make_shared<CMasternodeMetaInfo>(proTxHash)).first;
-    return it->second;
+    auto info = std::make_shared<CMasternodeMetaInfo>(proTxHash);
+    AddMetaInfo(info, now);
+    RemoveExpired(now);
+    return info;
+}
+
+void CMasternodeMetaMan::AddMetaInfo(CMasternodeMetaInfoPtr info, int64_t now)
+{
+    AssertLockHeld(cs_metaman);
+    const uint256 proTxHash = info->GetProTxHash();
+    lruList.emplace_front(proTxHash);
+    metaInfos.emplace(proTxHash, MetaEntry{std::move(info), now, lruList.begin()});
+}
+
+void CMasternodeMetaMan::RemoveExpired(int64_t now)
+{
+    AssertLockHeld(cs_metaman);
+    while (!lruList.empty()) {
+        auto it = metaInfos.find(lruList.back());
+        assert(it != metaInfos.end());
+        if (metaInfos.size() <= MN_META_MAX_ENTRIES && now - it->second.nLastAccess <= MN_META_EXPIRE_TIME) break;
+        metaInfos.erase(it);
+        lruList.pop_back();
+    }
 }
 
 
@@ -29,6 +54,7 @@ void CMasternodeMetaMan::Clear()
 {
     LOCK(cs_metaman);
     metaInfos.clear();
+    lruList.clear();
 }
 
 std::string CMasternodeMetaMan::ToString()
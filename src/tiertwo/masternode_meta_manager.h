@@ -9,12 +9,19 @@
 #include "serialize.h"
 #include "sync.h"
 #include "uint256.h"
+#include "utiltime.h"
 
+#include <list>
 #include <memory>
 
 static const std::string MN_META_CACHE_FILENAME = "mnmetacache.dat";
 static const std::string MN_META_CACHE_FILE_ID = "magicMasternodeMetaCache";
 
+// The meta infos not accessed for this long are removed
+static const int64_t MN_META_EXPIRE_TIME = 7 * 24 * 60 * 60;
+// Above this number of meta infos, the least recently accessed ones are removed
+static const size_t MN_META_MAX_ENTRIES = 10000;
+
 // Holds extra (non-deterministic) information about masternodes
 // This is mostly local information, e.g. last connection attempt
 class CMasternodeMetaInfo
@@ -53,7 +60,19 @@ class CMasternodeMetaMan
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
     mutable RecursiveMutex cs_metaman;
-    std::map<uint256, CMasternodeMetaInfoPtr> metaInfos;
+
+    struct MetaEntry {
+        CMasternodeMetaInfoPtr info;
+        int64_t nLastAccess;
+        std::list<uint256>::iterator itLru;
+    };
+    std::map<uint256, MetaEntry> metaInfos GUARDED_BY(cs_metaman);
+    // The proTxHash of the meta infos, most recently accessed first
+    std::list<uint256> lruList GUARDED_BY(cs_metaman);
+
+    void AddMetaInfo(CMasternodeMetaInfoPtr info, int64_t now) EXCLUSIVE_LOCKS_REQUIRED(cs_metaman);
+    // Removes the expired meta infos from the back of lruList. The users holding one keep it valid.
+    void RemoveExpired(int64_t now) EXCLUSIVE_LOCKS_REQUIRED(cs_metaman);
 
 public:
     // Return the stored metadata info from an specific MN
@@ -67,7 +86,7 @@ public:
         s << SERIALIZATION_VERSION_STRING;
         std::vector<CMasternodeMetaInfo> tmpMetaInfo;
         for (auto& p : metaInfos) {
-            tmpMetaInfo.emplace_back(*p.second);
+            tmpMetaInfo.emplace_back(*p.second.info);
         }
         s << tmpMetaInfo;
     }
@@ -84,9 +103,12 @@ public:
 
         std::vector<CMasternodeMetaInfo> tmpMetaInfo;
         s >> tmpMetaInfo;
+        const int64_t now = GetTime();
         for (auto& mm : tmpMetaInfo) {
-            metaInfos.emplace(mm.GetProTxHash(), std::make_shared<CMasternodeMetaInfo>(std::move(mm)));
+            if (metaInfos.count(mm.GetProTxHash())) continue;
+            AddMetaInfo(std::make_shared<CMasternodeMetaInfo>(std::move(mm)), now);
         }
+        RemoveExpired(now);
     }
 };
 
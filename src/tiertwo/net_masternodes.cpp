@@ -13,6 +13,10 @@
 #include "tiertwo/masternode_meta_manager.h" // for g_mmetaman
 #include "tiertwo/tiertwo_sync_state.h"
 
+// Max quorum members connected to at once: the connections of a new quorum are opened together, so
+// that an unreachable member (waiting for the connect timeout) doesn't delay the others
+static const size_t MAX_CONCURRENT_QUORUM_CONNECTIONS = 8;
+
 TierTwoConnMan::TierTwoConnMan(CConnman* _connman) : connman(_connman) {}
 TierTwoConnMan::~TierTwoConnMan() { connman = nullptr; }
 
@@ -250,8 +254,9 @@ void TierTwoConnMan::ThreadOpenMasternodeConnections()
             }
         });
 
-        // Try to connect to a single MN per cycle
+        // Try to connect to a single MN per cycle, or to a few quorum members at once
         CDeterministicMNCPtr dmnToConnect{nullptr};
+        std::vector<CDeterministicMNCPtr> vQuorumMembersToConnect;
         // Current list
         auto mnList = deterministicMNManager->GetListAtChainTip();
         int64_t currentTime = GetAdjustedTime();
@@ -308,16 +313,25 @@ void TierTwoConnMan::ThreadOpenMasternodeConnections()
                         pending.emplace_back(dmn);
                     }
                 }
-                // Select a random node to connect
-                if (!pending.empty()) {
-                    dmnToConnect = pending[GetRandInt((int) pending.size())];
+                // Select random nodes to connect (a member can be in several quorums)
+                std::sort(pending.begin(), pending.end());
+                pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+                Shuffle(pending.begin(), pending.end(), FastRandomContext());
+                for (const auto& dmn : pending) {
+                    if (vQuorumMembersToConnect.size() >= MAX_CONCURRENT_QUORUM_CONNECTIONS) break;
+                    // different members on the same service
+                    if (std::any_of(vQuorumMembersToConnect.begin(), vQuorumMembersToConnect.end(),
+                                    [&](const CDeterministicMNCPtr& other) { return other->pdmnState->addr == dmn->pdmnState->addr; })) {
+                        continue;
+                    }
+                    vQuorumMembersToConnect.emplace_back(dmn);
                     LogPrint(BCLog::NET_MN, "TierTwoConnMan::%s -- opening quorum connection to %s, service=%s\n",
-                             __func__, dmnToConnect->proTxHash.ToString(), dmnToConnect->pdmnState->addr.ToString());
+                             __func__, dmn->proTxHash.ToString(), dmn->pdmnState->addr.ToString());
                 }
             }
 
             // If no node was selected, let's try to probe nodes connection
-            if (!dmnToConnect) {
+            if (!dmnToConnect && vQuorumMembersToConnect.empty()) {
                 std::vector<CDeterministicMNCPtr> pending;
                 for (auto it = masternodePendingProbes.begin(); it != masternodePendingProbes.end(); ) {
                     auto dmn = mnList.GetMN(*it);
@@ -358,30 +372,51 @@ void TierTwoConnMan::ThreadOpenMasternodeConnections()
             }
         }
 
+        if (dmnToConnect) {
+            vQuorumMembersToConnect.emplace_back(dmnToConnect);
+        }
         // No DMN to connect
-        if (!dmnToConnect || interruptNet) {
+        if (vQuorumMembersToConnect.empty() || interruptNet) {
             continue;
         }
 
         // Update last attempt and try connection
-        g_mmetaman.GetMetaInfo(dmnToConnect->proTxHash)->SetLastOutboundAttempt(currentTime);
+        for (const auto& dmn : vQuorumMembersToConnect) {
+            g_mmetaman.GetMetaInfo(dmn->proTxHash)->SetLastOutboundAttempt(currentTime);
+        }
         triedConnect = true;
 
         // Now connect
-        openConnection(CAddress(dmnToConnect->pdmnState->addr, NODE_NETWORK), isProbe);
-        // should be in the list now if connection was opened
-        bool connected = connman->ForNode(dmnToConnect->pdmnState->addr, CConnman::AllNodes, [&](CNode* pnode) {
-            if (pnode->fDisconnect) { LogPrintf("about to be disconnected\n");
-                return false;
+        if (vQuorumMembersToConnect.size() == 1) {
+            connectMasternode(vQuorumMembersToConnect.front(), isProbe);
+        } else {
+            std::vector<std::thread> threads;
+            threads.reserve(vQuorumMembersToConnect.size());
+            for (const auto& dmn : vQuorumMembersToConnect) {
+                threads.emplace_back(&TierTwoConnMan::connectMasternode, this, dmn, isProbe);
             }
-            return true;
-        });
-        if (!connected) {
-            LogPrint(BCLog::NET_MN, "TierTwoConnMan::%s -- connection failed for masternode  %s, service=%s\n",
-                     __func__, dmnToConnect->proTxHash.ToString(), dmnToConnect->pdmnState->addr.ToString());
-            // reset last outbound success
-            g_mmetaman.GetMetaInfo(dmnToConnect->proTxHash)->SetLastOutboundSuccess(0);
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+    }
+}
+
+void TierTwoConnMan::connectMasternode(const CDeterministicMNCPtr& dmn, bool isProbe)
+{
+    openConnection(CAddress(dmn->pdmnState->addr, NODE_NETWORK), isProbe);
+    // should be in the list now if connection was opened
+    bool connected = connman->ForNode(dmn->pdmnState->addr, CConnman::AllNodes, [&](CNode* pnode) {
+        if (pnode->fDisconnect) { LogPrintf("about to be disconnected\n");
+            return false;
         }
+        return true;
+    });
+    if (!connected) {
+        LogPrint(BCLog::NET_MN, "TierTwoConnMan::%s -- connection failed for masternode  %s, service=%s\n",
+                 __func__, dmn->proTxHash.ToString(), dmn->pdmnState->addr.ToString());
+        // reset last outbound success
+        g_mmetaman.GetMetaInfo(dmn->proTxHash)->SetLastOutboundSuccess(0);
     }
 }
 
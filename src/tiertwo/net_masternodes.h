@@ -19,6 +19,8 @@ class CConnman;
 class CChainParams;
 class CNode;
 class CScheduler;
+class CDeterministicMN;
+typedef std::shared_ptr<const CDeterministicMN> CDeterministicMNCPtr;
 
 class TierTwoConnMan
 {
@@ -92,6 +94,8 @@ private:
     CConnman* connman;
 
     void openConnection(const CAddress& addrConnect, bool isProbe);
+    // Open a connection to the masternode, and reset its last outbound success if it fails
+    void connectMasternode(const CDeterministicMNCPtr& dmn, bool isProbe);
     void doMaintenance();
 };
 
@@ -22,7 +22,41 @@ CNetFulfilledRequestManager::CNetFulfilledRequestManager(unsigned int _itemsFilt
 void CNetFulfilledRequestManager::AddFulfilledRequest(const CService& addr, const std::string& strRequest)
 {
     LOCK(cs_mapFulfilledRequests);
-    mapFulfilledRequests[addr][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
+    const int64_t now = GetTime();
+    const int64_t nExpireTime = now + Params().FulfilledRequestExpireTime();
+    auto res = mapFulfilledRequests[addr].emplace(strRequest, nExpireTime);
+    if (!res.second) {
+        expiryQueue.erase({res.first->second, addr, strRequest});
+        res.first->second = nExpireTime;
+    }
+    expiryQueue.insert({nExpireTime, addr, strRequest});
+    RemoveExpired(now);
+}
+
+void CNetFulfilledRequestManager::RemoveExpired(int64_t now)
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+    while (!expiryQueue.empty()) {
+        const ExpiryEntry& entry = *expiryQueue.begin();
+        if (now <= entry.nExpireTime && expiryQueue.size() <= MAX_FULFILLED_REQUESTS) break;
+        auto it = mapFulfilledRequests.find(entry.addr);
+        if (it != mapFulfilledRequests.end()) {
+            it->second.erase(entry.strRequest);
+            if (it->second.empty()) mapFulfilledRequests.erase(it);
+        }
+        expiryQueue.erase(expiryQueue.begin());
+    }
+}
+
+void CNetFulfilledRequestManager::RebuildExpiryQueue()
+{
+    AssertLockHeld(cs_mapFulfilledRequests);
+    expiryQueue.clear();
+    for (const auto& it : mapFulfilledRequests) {
+        for (const auto& itReq : it.second) {
+            expiryQueue.insert({itReq.second, it.first, itReq.first});
+        }
+    }
 }
 
 bool CNetFulfilledRequestManager::HasFulfilledRequest(const CService& addr, const std::string& strRequest) const
@@ -65,20 +99,7 @@ void CNetFulfilledRequestManager::CheckAndRemove()
 {
     LOCK(cs_mapFulfilledRequests);
     int64_t now = GetTime();
-    for (auto it = mapFulfilledRequests.begin(); it != mapFulfilledRequests.end();) {
-        for (auto it_entry = it->second.begin(); it_entry != it->second.end();) {
-            if (now > it_entry->second) {
-                it_entry = it->second.erase(it_entry);
-            } else {
-                it_entry++;
-            }
-        }
-        if (it->second.empty()) {
-            it = mapFulfilledRequests.erase(it);
-        } else {
-            it++;
-        }
-    }
+    RemoveExpired(now);
 
     if (now > lastFilterCleanup ||  itemsFilterCount >= itemsFilterSize) {
         itemsFilter->clear();
@@ -91,6 +112,7 @@ void CNetFulfilledRequestManager::Clear()
 {
     LOCK(cs_mapFulfilledRequests);
     mapFulfilledRequests.clear();
+    expiryQueue.clear();
 }
 
 std::string CNetFulfilledRequestManager::ToString() const
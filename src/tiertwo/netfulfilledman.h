@@ -7,19 +7,23 @@
 #define PIVX_NETFULFILLEDMAN_H
 
 #include "bloom.h"
+#include "netaddress.h"
 #include "serialize.h"
 #include "sync.h"
 
 #include <map>
+#include <set>
+#include <tuple>
 
 class CBloomFilter;
-class CService;
 
 static const std::string NET_REQUESTS_CACHE_FILENAME = "netrequests.dat";
 static const std::string NET_REQUESTS_CACHE_FILE_ID = "magicNetRequestsCache";
 
 static const unsigned int DEFAULT_ITEMS_FILTER_SIZE = 250;
 static const unsigned int DEFAULT_ITEMS_FILTER_CLEANUP = 60 * 60;
+// Above this number of fulfilled requests, the ones expiring first are removed
+static const size_t MAX_FULFILLED_REQUESTS = 50000;
 
 // Fulfilled requests are used to prevent nodes from asking the same data on sync
 // and being banned for doing it too often.
@@ -33,6 +37,25 @@ private:
     fulfilledreqmap_t mapFulfilledRequests GUARDED_BY(cs_mapFulfilledRequests);
     mutable Mutex cs_mapFulfilledRequests;
 
+    // The requests in expiration order, one entry each: a request added again is moved to its new expiration
+    // time. They all expire FulfilledRequestExpireTime() after being added, so the expired ones, and the least
+    // recently added ones above MAX_FULFILLED_REQUESTS, are removed from the front.
+    struct ExpiryEntry {
+        int64_t nExpireTime;
+        CService addr;
+        std::string strRequest;
+
+        bool operator<(const ExpiryEntry& other) const
+        {
+            return std::tie(nExpireTime, addr, strRequest) < std::tie(other.nExpireTime, other.addr, other.strRequest);
+        }
+    };
+    std::set<ExpiryEntry> expiryQueue GUARDED_BY(cs_mapFulfilledRequests);
+
+    // Removes the expired requests, and the ones expiring first above MAX_FULFILLED_REQUESTS
+    void RemoveExpired(int64_t now) EXCLUSIVE_LOCKS_REQUIRED(cs_mapFulfilledRequests);
+    void RebuildExpiryQueue() EXCLUSIVE_LOCKS_REQUIRED(cs_mapFulfilledRequests);
+
     std::unique_ptr<CBloomFilter> itemsFilter GUARDED_BY(cs_mapFulfilledRequests){nullptr};
     unsigned int itemsFilterSize{0};
     unsigned int itemsFilterCount{0};
@@ -45,6 +68,7 @@ public:
     SERIALIZE_METHODS(CNetFulfilledRequestManager, obj) {
         LOCK(obj.cs_mapFulfilledRequests);
         READWRITE(obj.mapFulfilledRequests);
+        SER_READ(obj, obj.RebuildExpiryQueue());
     }
 
     void AddFulfilledRequest(const CService& addr, const std::string& strRequest);
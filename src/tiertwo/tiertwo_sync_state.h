@@ -5,6 +5,8 @@
 #ifndef PIVX_TIERTWO_SYNC_STATE_H
 #define PIVX_TIERTWO_SYNC_STATE_H
 
+#include "sync.h"
+
 #include <atomic>
 #include <map>
 
@@ -38,6 +40,9 @@ public:
     void AddedMasternodeList(const uint256& hash);
     void AddedMasternodeWinner(const uint256& hash);
     void AddedBudgetItem(const uint256& hash);
+    // A peer reported items that we have already (see the sync digests): the sync is progressing
+    void KnownMasternodeWinners();
+    void KnownBudgetItems();
 
     int64_t GetlastMasternodeList() const { return lastMasternodeList; }
     int64_t GetlastMasternodeWinner() const { return lastMasternodeWinner; }
@@ -45,9 +50,9 @@ public:
 
     void ResetLastBudgetItem() { lastBudgetItem = 0; }
 
-    void EraseSeenMNB(const uint256& hash) { mapSeenSyncMNB.erase(hash); }
-    void EraseSeenMNW(const uint256& hash) { mapSeenSyncMNW.erase(hash); }
-    void EraseSeenSyncBudget(const uint256& hash) { mapSeenSyncBudget.erase(hash); }
+    void EraseSeenMNB(const uint256& hash) { WITH_LOCK(cs_seen, mapSeenSyncMNB.erase(hash)); }
+    void EraseSeenMNW(const uint256& hash) { WITH_LOCK(cs_seen, mapSeenSyncMNW.erase(hash)); }
+    void EraseSeenSyncBudget(const uint256& hash) { WITH_LOCK(cs_seen, mapSeenSyncBudget.erase(hash)); }
 
     // Reset seen data
     void ResetData();
@@ -68,14 +73,15 @@ private:
     std::atomic<int64_t> last_blockchain_sync_update_time{0};
     std::atomic<int> m_current_sync_phase{0};
 
-    // Seen elements
-    std::map<uint256, int> mapSeenSyncMNB;
-    std::map<uint256, int> mapSeenSyncMNW;
-    std::map<uint256, int> mapSeenSyncBudget;
+    // Seen elements. The votes are also added from the vote signature verifier thread.
+    Mutex cs_seen;
+    std::map<uint256, int> mapSeenSyncMNB GUARDED_BY(cs_seen);
+    std::map<uint256, int> mapSeenSyncMNW GUARDED_BY(cs_seen);
+    std::map<uint256, int> mapSeenSyncBudget GUARDED_BY(cs_seen);
     // Last seen time
-    int64_t lastMasternodeList{0};
-    int64_t lastMasternodeWinner{0};
-    int64_t lastBudgetItem{0};
+    std::atomic<int64_t> lastMasternodeList{0};
+    std::atomic<int64_t> lastMasternodeWinner{0};
+    std::atomic<int64_t> lastBudgetItem{0};
 };
 
 extern TierTwoSyncState g_tiertwo_sync_state;
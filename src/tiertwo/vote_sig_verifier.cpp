@@ -0,0 +1,153 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include "tiertwo/vote_sig_verifier.h"
+
+#include "bls/bls_batchverifier.h"
+#include "net.h"
+#include "util/system.h"
+#include "util/threadnames.h"
+
+CVoteSigVerifier g_vote_sig_verifier;
+
+CVoteSigVerifier::~CVoteSigVerifier()
+{
+    Stop();
+}
+
+void CVoteSigVerifier::Start(int nThreads)
+{
+    assert(!fRunning);
+    if (nThreads <= 0) return;
+    WITH_LOCK(cs, fInterrupted = false);
+    workerPool.resize(nThreads);
+    RenameThreadPool(workerPool, "pivx-votesig-worker");
+    verifierThread = std::thread(&TraceThread<std::function<void()> >, "votesig", std::function<void()>(std::bind(&CVoteSigVerifier::ThreadVerify, this)));
+    fRunning = true;
+}
+
+void CVoteSigVerifier::Interrupt()
+{
+    WITH_LOCK(cs, fInterrupted = true);
+    cv.notify_all();
+}
+
+void CVoteSigVerifier::Stop()
+{
+    if (!fRunning) return;
+    Interrupt();
+    if (verifierThread.joinable()) {
+        verifierThread.join();
+    }
+    workerPool.stop(true);
+    fRunning = false;
+
+    // Release the nodes of the votes left in the queue, they are dropped
+    for (VoteJob& job : WITH_LOCK(cs, return std::move(queue); )) {
+        if (job.pnode) job.pnode->Release();
+    }
+}
+
+bool CVoteSigVerifier::CanQueue() const
+{
+    return fRunning && WITH_LOCK(cs, return !fInterrupted && queue.size() < MAX_VOTE_SIG_QUEUE_SIZE);
+}
+
+void CVoteSigVerifier::PushVote(CNode* pfrom, std::shared_ptr<const CSignedMessage> msg, const CKeyID& keyID, ResultCallback callback)
+{
+    Push({pfrom, std::move(msg), keyID, CBLSPublicKey(), std::move(callback)});
+}
+
+void CVoteSigVerifier::PushVote(CNode* pfrom, std::shared_ptr<const CSignedMessage> msg, const CBLSPublicKey& pubKey, ResultCallback callback)
+{
+    Push({pfrom, std::move(msg), CKeyID(), pubKey, std::move(callback)});
+}
+
+void CVoteSigVerifier::Push(VoteJob&& job)
+{
+    assert(job.pnode);
+    job.pnode->AddRef();
+    WITH_LOCK(cs, queue.emplace_back(std::move(job)));
+    cv.notify_one();
+}
+
+void CVoteSigVerifier::ThreadVerify()
+{
+    std::vector<VoteJob> jobs;
+    std::vector<bool> vValid;
+    while (true) {
+        {
+            WAIT_LOCK(cs, lock);
+            cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return !queue.empty() || fInterrupted; });
+            if (fInterrupted) return;
+            const size_t nJobs = std::min(queue.size(), VOTE_SIG_BATCH_SIZE);
+            jobs.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.begin() + nJobs));
+            queue.erase(queue.begin(), queue.begin() + nJobs);
+        }
+
+        VerifyBatch(jobs, vValid);
+        for (size_t i = 0; i < jobs.size(); i++) {
+            VoteJob& job = jobs[i];
+            try {
+                job.callback(job.pnode, vValid[i]);
+            } catch (const std::exception& e) {
+                PrintExceptionContinue(&e, "CVoteSigVerifier::ThreadVerify()");
+            }
+            job.pnode->Release();
+        }
+        jobs.clear();
+    }
+}
+
+void CVoteSigVerifier::VerifyBatch(std::vector<VoteJob>& jobs, std::vector<bool>& vValid)
+{
+    vValid.assign(jobs.size(), false);
+
+    // BLS signatures: one aggregated verification, with the bad votes found per peer.
+    // The votes come from any peer: the secure verification weights each signature, so that two
+    // tampered signatures can't compensate each other in the aggregate.
+    CBLSBatchVerifier<NodeId, size_t> batchVerifier(true, true);
+    std::vector<size_t> vECDSA, vBLS;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const VoteJob& job = jobs[i];
+        if (!job.keyID.IsNull()) {
+            vECDSA.emplace_back(i);
+            continue;
+        }
+        // Only MESS_VER_HASH is allowed with BLS, see CSignedMessage::CheckSignature
+        if (job.msg->nMessVersion != MessageVersion::MESS_VER_HASH || !job.blsPubKey.IsValid()) continue;
+        const CBLSSignature sig(job.msg->GetVchSig());
+        if (!sig.IsValid()) continue;
+        batchVerifier.PushMessage(job.pnode->GetId(), i, job.msg->GetSignatureHash(), sig, job.blsPubKey);
+        vBLS.emplace_back(i);
+    }
+
+    // ECDSA signatures: split across the workers, each one taking every n-th vote
+    const size_t nTasks = std::min(vECDSA.size(), (size_t)workerPool.size());
+    std::vector<std::future<void>> futures;
+    futures.reserve(nTasks);
+    std::vector<char> vECDSAValid(vECDSA.size(), 0);
+    for (size_t t = 0; t < nTasks; t++) {
+        futures.emplace_back(workerPool.push([&, t](int threadId) {
+            for (size_t j = t; j < vECDSA.size(); j += nTasks) {
+                const VoteJob& job = jobs[vECDSA[j]];
+                vECDSAValid[j] = job.msg->CheckSignature(job.keyID);
+            }
+        }));
+    }
+
+    if (!vBLS.empty()) {
+        batchVerifier.Verify();
+        for (size_t i : vBLS) {
+            vValid[i] = !batchVerifier.badMessages.count(i);
+        }
+    }
+
+    for (auto& f : futures) {
+        f.get();
+    }
+    for (size_t j = 0; j < vECDSA.size(); j++) {
+        vValid[vECDSA[j]] = vECDSAValid[j];
+    }
+}
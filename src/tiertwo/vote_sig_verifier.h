@@ -0,0 +1,111 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_TIERTWO_VOTE_SIG_VERIFIER_H
+#define PIVX_TIERTWO_VOTE_SIG_VERIFIER_H
+
+#include "bls/bls_wrapper.h"
+#include "consensus/validation.h"
+#include "ctpl_stl.h"
+#include "logging.h"
+#include "messagesigner.h"
+#include "net_processing.h"
+#include "pubkey.h"
+#include "sync.h"
+#include "util/validation.h"
+#include "validation.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+
+class CNode;
+
+/** Threads verifying the signatures of the votes received from the network (0 to verify them in the message handler) */
+static const int DEFAULT_VOTE_SIG_THREADS = 2;
+static const int MAX_VOTE_SIG_THREADS = 8;
+/** Maximum number of votes verified in one batch */
+static const size_t VOTE_SIG_BATCH_SIZE = 1000;
+/** Above this number of queued votes, the new ones are verified in the message handler again */
+static const size_t MAX_VOTE_SIG_QUEUE_SIZE = 20000;
+
+/**
+ * Verifies the signatures of the budget votes and of the masternode winners received from the
+ * network, away from the message handler thread.
+ * The queued votes are taken in batches: the ECDSA signatures are checked in parallel on the
+ * worker threads, the BLS ones are aggregated and checked together (CBLSBatchVerifier).
+ * The result callbacks are then run in the order the votes were queued, on the verifier thread.
+ * The node of a vote is referenced until its callback has run.
+ */
+class CVoteSigVerifier
+{
+public:
+    using ResultCallback = std::function<void(CNode* pfrom, bool fValidSig)>;
+
+    CVoteSigVerifier() = default;
+    ~CVoteSigVerifier();
+
+    void Start(int nThreads);
+    void Interrupt();
+    void Stop();
+
+    // False when not started, or when the queue is full: the caller verifies the signature itself then
+    bool CanQueue() const;
+    void PushVote(CNode* pfrom, std::shared_ptr<const CSignedMessage> msg, const CKeyID& keyID, ResultCallback callback);
+    void PushVote(CNode* pfrom, std::shared_ptr<const CSignedMessage> msg, const CBLSPublicKey& pubKey, ResultCallback callback);
+
+    size_t GetQueueSize() const { return WITH_LOCK(cs, return queue.size()); }
+
+private:
+    struct VoteJob {
+        CNode* pnode;
+        std::shared_ptr<const CSignedMessage> msg;
+        // Set for the ECDSA signatures, otherwise the signature is a BLS one
+        CKeyID keyID;
+        CBLSPublicKey blsPubKey;
+        ResultCallback callback;
+    };
+
+    void Push(VoteJob&& job);
+    void ThreadVerify();
+    void VerifyBatch(std::vector<VoteJob>& jobs, std::vector<bool>& vValid);
+
+    mutable Mutex cs;
+    std::condition_variable cv;
+    std::deque<VoteJob> queue GUARDED_BY(cs);
+    bool fInterrupted GUARDED_BY(cs){false};
+    std::atomic<bool> fRunning{false};
+
+    std::thread verifierThread;
+    ctpl::thread_pool workerPool;
+};
+
+extern CVoteSigVerifier g_vote_sig_verifier;
+
+/**
+ * Checks the signature of a vote, signed with key, then calls process(vote, pfrom, fValidSig, state).
+ * The votes received from the network go to g_vote_sig_verifier when it can take them: this returns
+ * true then, and process runs later on the verifier thread, where the ban score it sets is applied.
+ */
+template <typename Vote, typename Key, typename ProcessFunc>
+bool VerifyVoteSignature(const Vote& vote, CNode* pfrom, const Key& key, CValidationState& state, BCLog::LogFlags category, ProcessFunc process)
+{
+    if (pfrom && g_vote_sig_verifier.CanQueue()) {
+        auto pvote = std::make_shared<const Vote>(vote);
+        g_vote_sig_verifier.PushVote(pfrom, pvote, key, [pvote, category, process](CNode* pnode, bool fValidSig) {
+            CValidationState stateVote;
+            int nDos = 0;
+            if (!process(*pvote, pnode, fValidSig, stateVote) && stateVote.IsInvalid(nDos)) {
+                LogPrint(category, "%s: %s\n", "VerifyVoteSignature", FormatStateMessage(stateVote));
+                if (nDos > 0) WITH_LOCK(cs_main, Misbehaving(pnode->GetId(), nDos));
+            }
+        });
+        return true;
+    }
+    return process(vote, pfrom, vote.CheckSignature(key), state);
+}
+
+#endif // PIVX_TIERTWO_VOTE_SIG_VERIFIER_H
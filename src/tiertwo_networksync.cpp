@@ -4,11 +4,13 @@
 
 #include "masternode-sync.h"
 
+#include "budget/budgetmanager.h"
 #include "llmq/quorums_blockprocessor.h"
 #include "llmq/quorums_chainlocks.h"
 #include "llmq/quorums_dkgsessionmgr.h"
 #include "llmq/quorums_signing.h"
 #include "llmq/quorums_signing_shares.h"
+#include "masternode-payments.h"
 #include "masternodeman.h"  // for mnodeman
 #include "net_processing.h" // for Misbehaving
 #include "netmessagemaker.h"
@@ -133,7 +135,7 @@ bool CMasternodeSync::MessageDispatcher(CNode* pfrom, std::string& strCommand, C
         vRecv >> nItemID >> nCount;
 
         // Update stats
-        ProcessSyncStatusMsg(nItemID, nCount);
+        ProcessSyncStatusMsg(pfrom->GetId(), nItemID, nCount);
 
         // this means we will receive no further communication on the first sync
         switch (nItemID) {
@@ -226,10 +228,11 @@ void CMasternodeSync::SyncRegtest(CNode* pnode)
     } else if (syncPhase == MASTERNODE_SYNC_LIST) {
         RequestDataTo(pnode, NetMsgType::GETMNLIST, false, CTxIn());
     } else if (syncPhase == MASTERNODE_SYNC_MNW) {
-        RequestDataTo(pnode, NetMsgType::GETMNWINNERS, false, mnodeman.CountEnabled());
+        const int nMnCount = mnodeman.CountEnabled();
+        RequestDataTo(pnode, NetMsgType::GETMNWINNERS, false, nMnCount, masternodePayments.GetSyncDigest(nMnCount));
     } else if (syncPhase == MASTERNODE_SYNC_BUDGET) {
         // sync masternode votes
-        RequestDataTo(pnode, NetMsgType::BUDGETVOTESYNC, false, uint256());
+        RequestDataTo(pnode, NetMsgType::BUDGETVOTESYNC, false, uint256(), g_budgetman.GetSyncDigest());
     } else if (syncPhase == MASTERNODE_SYNC_FINISHED) {
         LogPrintf("REGTEST SYNC FINISHED!\n");
     }
@@ -6,11 +6,16 @@
 
 #include "txdb.h"
 
+#include "chainparams.h"
 #include "clientversion.h"
+#include "ctpl_stl.h"
+#include "hash.h"
 #include "pow.h"
 #include "random.h"
 #include "uint256.h"
 #include "util/system.h"
+#include "util/threadnames.h"
+#include "utxocommitment.h"
 #include "util/vector.h"
 
 #include <stdint.h>
@@ -20,7 +25,6 @@
 static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
-static const char DB_TXINDEX = 't';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -28,6 +32,8 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_UTXO_COMMITMENT = 'U';
+static const char DB_UTXO_COMMITMENT_STATS = 'u';
 // static const char DB_MONEY_SUPPLY = 'M';
 
 namespace {
@@ -44,8 +50,34 @@ struct CoinEntry
 }
 
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+// The coins are looked up by outpoint, and most of the lookups of the outputs being created miss: a larger
+// bloom filter saves those disk reads. The hot coins are held by the coins cache already, so the space is
+// better spent on the write buffers, which absorb the flushes.
+static CDBOptions ChainstateDBOptions()
 {
+    CDBOptions dbOptions("chainstate");
+    dbOptions.nBloomBits = 16;
+    dbOptions.nBlockCachePercent = 25;
+    return dbOptions;
+}
+
+// The block index is read sequentially at startup, and written in batches
+static CDBOptions BlockTreeDBOptions()
+{
+    CDBOptions dbOptions("blocktree");
+    dbOptions.nBlockSize = 16 * 1024;
+    return dbOptions;
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe, size_t nSaplingCacheSizeIn) :
+    db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, CLIENT_VERSION, ChainstateDBOptions()),
+    nSaplingCacheSize(nSaplingCacheSizeIn),
+    // A quarter of the Sapling cache goes to the anchors (which can take twice the lru max size before truncation)
+    anchorsCache(std::max((size_t)1, nSaplingCacheSizeIn / 8 / SAPLING_ANCHOR_CACHE_ENTRY_USAGE))
+{
+    if (nSaplingCacheSize > 0) {
+        LoadNullifiersFilter();
+    }
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint& outpoint, Coin& coin) const
@@ -78,7 +110,8 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
                               const uint256& hashBlock,
                               const uint256& hashSaplingAnchor,
                               CAnchorsSaplingMap& mapSaplingAnchors,
-                              CNullifiersMap& mapSaplingNullifiers)
+                              CNullifiersMap& mapSaplingNullifiers,
+                              bool erase)
 {
     CDBBatch batch(CLIENT_VERSION);
     size_t count = 0;
@@ -114,8 +147,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        it = erase ? mapCoins.erase(it) : std::next(it);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -143,12 +175,22 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins,
     return ret;
 }
 
+bool CCoinsViewDB::ReadUTXOCommitment(CUTXOCommitment& commitment) const
+{
+    return db.Read(DB_UTXO_COMMITMENT, commitment);
+}
+
+bool CCoinsViewDB::WriteUTXOCommitment(const CUTXOCommitment& commitment)
+{
+    return db.Write(DB_UTXO_COMMITMENT, commitment);
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe)
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, CLIENT_VERSION, BlockTreeDBOptions())
 {
 }
 
@@ -236,7 +278,7 @@ void CCoinsViewDBCursor::Next()
     }
 }
 
-bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
+bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo, bool fSync) {
     CDBBatch batch(CLIENT_VERSION);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_FILES, it->first), *it->second);
@@ -245,20 +287,7 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
     }
-    return WriteBatch(batch, true);
-}
-
-bool CBlockTreeDB::ReadTxIndex(const uint256& txid, CDiskTxPos& pos)
-{
-    return Read(std::make_pair(DB_TXINDEX, txid), pos);
-}
-
-bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >& vect)
-{
-    CDBBatch batch(CLIENT_VERSION);
-    for (std::vector<std::pair<uint256, CDiskTxPos> >::const_iterator it = vect.begin(); it != vect.end(); it++)
-        batch.Write(std::make_pair(DB_TXINDEX, it->first), it->second);
-    return WriteBatch(batch);
+    return WriteBatch(batch, fSync);
 }
 
 bool CBlockTreeDB::WriteFlag(const std::string& name, bool fValue)
@@ -285,76 +314,142 @@ bool CBlockTreeDB::ReadInt(const std::string& name, int& nValue)
     return Read(std::make_pair('I', name), nValue);
 }
 
+bool CBlockTreeDB::ReadUTXOCommitmentStats(const uint256& hashBlock, CUTXOCommitmentStats& stats) const
+{
+    return Read(std::make_pair(DB_UTXO_COMMITMENT_STATS, hashBlock), stats);
+}
+
+bool CBlockTreeDB::WriteUTXOCommitmentStats(const uint256& hashBlock, const CUTXOCommitmentStats& stats)
+{
+    return Write(std::make_pair(DB_UTXO_COMMITMENT_STATS, hashBlock), stats);
+}
+
+namespace {
+struct DecodedBlockIndex {
+    CDiskBlockIndex diskindex;
+    uint256 hash;
+    bool fRead{false};
+    bool fKeyMatch{false};
+    bool fValid{false};
+};
+} // namespace
+
 bool CBlockTreeDB::LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, UINT256_ZERO));
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
+    // The records are read from the cursor in ranges of BLOCK_INDEX_LOAD_BATCH, decoded (and their headers
+    // hashed and checked) in parallel on the workers, and then linked into mapBlockIndex in order.
+    ctpl::thread_pool workerPool(std::max(1, GetNumCores()));
+    RenameThreadPool(workerPool, "pivx-loadidx");
+
+    std::vector<CDataStream> vRaw;
+    std::vector<uint256> vKeyHashes;
+    std::vector<DecodedBlockIndex> vDecoded;
+    bool fEnd = false;
+    while (!fEnd) {
         boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight = diskindex.nHeight;
-                pindexNew->nFile = diskindex.nFile;
-                pindexNew->nDataPos = diskindex.nDataPos;
-                pindexNew->nUndoPos = diskindex.nUndoPos;
-                pindexNew->nVersion = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime = diskindex.nTime;
-                pindexNew->nBits = diskindex.nBits;
-                pindexNew->nNonce = diskindex.nNonce;
-                pindexNew->nStatus = diskindex.nStatus;
-                pindexNew->nTx = diskindex.nTx;
-
-                // sapling
-                pindexNew->nSaplingValue  = diskindex.nSaplingValue;
-                pindexNew->hashFinalSaplingRoot = diskindex.hashFinalSaplingRoot;
-
-                //zerocoin
-                pindexNew->nAccumulatorCheckpoint = diskindex.nAccumulatorCheckpoint;
-
-                //Proof Of Stake
-                pindexNew->nFlags = diskindex.nFlags;
-                pindexNew->vStakeModifier = diskindex.vStakeModifier;
-
-                if (!Params().GetConsensus().NetworkUpgradeActive(pindexNew->nHeight, Consensus::UPGRADE_POS)) {
-                    if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits))
-                        return error("%s : CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+        vRaw.clear();
+        vKeyHashes.clear();
+        while (vRaw.size() < BLOCK_INDEX_LOAD_BATCH) {
+            std::pair<char, uint256> key;
+            if (!pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX) {
+                fEnd = true;
+                break;
+            }
+            vRaw.emplace_back(pcursor->GetValue());
+            vKeyHashes.emplace_back(key.second);
+            pcursor->Next();
+        }
+
+        vDecoded.clear();
+        vDecoded.resize(vRaw.size());
+        const size_t nShardSize = (vRaw.size() + workerPool.size() - 1) / workerPool.size();
+        std::vector<std::future<void>> futures;
+        for (size_t begin = 0; begin < vRaw.size(); begin += nShardSize) {
+            const size_t end = std::min(begin + nShardSize, vRaw.size());
+            futures.emplace_back(workerPool.push([&vRaw, &vKeyHashes, &vDecoded, begin, end](int threadId) {
+                const Consensus::Params& consensus = Params().GetConsensus();
+                for (size_t i = begin; i < end; i++) {
+                    DecodedBlockIndex& decoded = vDecoded[i];
+                    try {
+                        vRaw[i] >> decoded.diskindex;
+                    } catch (const std::exception&) {
+                        continue;
+                    }
+                    decoded.fRead = true;
+                    // The header is hashed from the record, so that a corrupted one doesn't match its key
+                    decoded.hash = decoded.diskindex.GetBlockHash();
+                    decoded.fKeyMatch = decoded.hash == vKeyHashes[i];
+                    decoded.fValid = consensus.NetworkUpgradeActive(decoded.diskindex.nHeight, Consensus::UPGRADE_POS) ||
+                                     CheckProofOfWork(decoded.hash, decoded.diskindex.nBits);
                 }
+            }));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
 
-                pcursor->Next();
-            } else {
+        for (DecodedBlockIndex& decoded : vDecoded) {
+            CDiskBlockIndex& diskindex = decoded.diskindex;
+            if (!decoded.fRead) {
                 return error("%s : failed to read value", __func__);
             }
-        } else {
-            break;
+            if (!decoded.fKeyMatch) {
+                return error("%s : block index record doesn't match its key: %s", __func__, diskindex.ToString());
+            }
+            if (!decoded.fValid) {
+                return error("%s : CheckProofOfWork failed: %s", __func__, diskindex.ToString());
+            }
+
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(decoded.hash);
+            pindexNew->pprev = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight = diskindex.nHeight;
+            pindexNew->nFile = diskindex.nFile;
+            pindexNew->nDataPos = diskindex.nDataPos;
+            pindexNew->nUndoPos = diskindex.nUndoPos;
+            pindexNew->nVersion = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime = diskindex.nTime;
+            pindexNew->nBits = diskindex.nBits;
+            pindexNew->nNonce = diskindex.nNonce;
+            pindexNew->nStatus = diskindex.nStatus;
+            pindexNew->nTx = diskindex.nTx;
+
+            // sapling
+            pindexNew->nSaplingValue  = diskindex.nSaplingValue;
+            pindexNew->hashFinalSaplingRoot = diskindex.hashFinalSaplingRoot;
+
+            // supply
+            pindexNew->nTransparentValue = diskindex.nTransparentValue;
+
+            //zerocoin
+            pindexNew->pAccumulatorCheckpoint = diskindex.pAccumulatorCheckpoint;
+
+            //Proof Of Stake
+            pindexNew->nFlags = diskindex.nFlags;
+            pindexNew->vStakeModifier = diskindex.vStakeModifier;
         }
     }
 
     return true;
 }
 
-CZerocoinDB::CZerocoinDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "zerocoin", nCacheSize, fMemory, fWipe)
+CZerocoinDB::CZerocoinDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "zerocoin", nCacheSize, fMemory, fWipe, CLIENT_VERSION, CDBOptions("zerocoin"))
 {
 }
 
-bool CZerocoinDB::WriteCoinSpendBatch(const std::vector<std::pair<CBigNum, uint256> >& spendInfo)
+bool CZerocoinDB::WriteCoinSpendBatch(const std::vector<std::pair<CBigNum, uint256> >& spendInfo, const uint256& hashBlock)
 {
     CDBBatch batch(CLIENT_VERSION);
     size_t count = 0;
     for (std::vector<std::pair<CBigNum, uint256> >::const_iterator it=spendInfo.begin(); it != spendInfo.end(); it++) {
-        CBigNum bnSerial = it->first;
-        CDataStream ss(SER_GETHASH, 0);
-        ss << bnSerial;
-        uint256 hash = Hash(ss.begin(), ss.end());
-        batch.Write(std::make_pair('s', hash), it->second);
+        const uint256& hashSerial = GetSerialHash(it->first);
+        batch.Write(std::make_pair('s', hashSerial), it->second);
+        batch.Write(std::make_pair('b', hashSerial), hashBlock);
         ++count;
     }
 
@@ -364,20 +459,50 @@ bool CZerocoinDB::WriteCoinSpendBatch(const std::vector<std::pair<CBigNum, uint2
 
 bool CZerocoinDB::ReadCoinSpend(const CBigNum& bnSerial, uint256& txHash)
 {
-    CDataStream ss(SER_GETHASH, 0);
-    ss << bnSerial;
-    uint256 hash = Hash(ss.begin(), ss.end());
+    return Read(std::make_pair('s', GetSerialHash(bnSerial)), txHash);
+}
 
-    return Read(std::make_pair('s', hash), txHash);
+bool CZerocoinDB::ReadCoinSpendBlock(const uint256& hashSerial, uint256& hashBlock)
+{
+    return Read(std::make_pair('b', hashSerial), hashBlock);
 }
 
 bool CZerocoinDB::EraseCoinSpend(const CBigNum& bnSerial)
 {
-    CDataStream ss(SER_GETHASH, 0);
-    ss << bnSerial;
-    uint256 hash = Hash(ss.begin(), ss.end());
+    const uint256& hashSerial = GetSerialHash(bnSerial);
+    CDBBatch batch(CLIENT_VERSION);
+    batch.Erase(std::make_pair('s', hashSerial));
+    batch.Erase(std::make_pair('b', hashSerial));
+    return WriteBatch(batch);
+}
+
+bool CZerocoinDB::ReadAllCoinSpends(std::vector<std::pair<uint256, uint256>>& vSpends)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair('s', UINT256_ZERO));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        if (pcursor->GetKey(key) && key.first == 's') {
+            uint256 txHash;
+            if (pcursor->GetValue(txHash)) {
+                vSpends.emplace_back(key.second, txHash);
+                pcursor->Next();
+            } else {
+                return error("%s : failed to read value", __func__);
+            }
+        } else {
+            break;
+        }
+    }
+    return true;
+}
 
-    return Erase(std::make_pair('s', hash));
+uint256 CZerocoinDB::GetSerialHash(const CBigNum& bnSerial)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << bnSerial;
+    return ss.GetHash();
 }
 
 // Legacy Zerocoin Database
@@ -600,3 +725,81 @@ void AccumulatorCache::Wipe()
     mapCheckpoints.clear();
     db->WipeAccChecksums();
 }
+
+CFrozenSerialIndex::CFrozenSerialIndex(const uint256& _hashBlockEnd, int _nHeightEnd, std::vector<std::pair<uint256, int>>&& _vSpends) :
+        hashBlockEnd(_hashBlockEnd),
+        nHeightEnd(_nHeightEnd),
+        vSpends(std::move(_vSpends))
+{
+    std::sort(vSpends.begin(), vSpends.end());
+}
+
+Optional<int> CFrozenSerialIndex::Lookup(const CBigNum& bnSerial) const
+{
+    const uint256& hash = CZerocoinDB::GetSerialHash(bnSerial);
+    auto it = std::lower_bound(vSpends.begin(), vSpends.end(), hash,
+                               [](const std::pair<uint256, int>& spend, const uint256& h) { return spend.first < h; });
+    if (it == vSpends.end() || it->first != hash) {
+        return nullopt;
+    }
+    return Optional<int>(it->second);
+}
+
+bool CFrozenSerialIndex::Read(const fs::path& path)
+{
+    CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return false;
+    }
+    try {
+        CHashVerifier<CAutoFile> verifier(&filein);
+        unsigned char pchMsgTmp[4];
+        verifier >> pchMsgTmp;
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)) != 0) {
+            return error("%s: Invalid network magic number", __func__);
+        }
+        verifier >> *this;
+        uint256 hashTmp;
+        filein >> hashTmp;
+        if (hashTmp != verifier.GetHash()) {
+            return error("%s: Checksum mismatch, data corrupted", __func__);
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    if (!std::is_sorted(vSpends.begin(), vSpends.end())) {
+        return error("%s: the serials are not sorted", __func__);
+    }
+    return true;
+}
+
+bool CFrozenSerialIndex::Write(const fs::path& path) const
+{
+    fs::path pathTmp = path;
+    pathTmp += ".new";
+    CAutoFile fileout(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        return error("%s: Failed to open file %s", __func__, pathTmp.string());
+    }
+    try {
+        CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+        fileout << Params().MessageStart() << *this;
+        hasher << Params().MessageStart() << *this;
+        fileout << hasher.GetHash();
+    } catch (const std::exception& e) {
+        fileout.fclose();
+        fs::remove(pathTmp);
+        return error("%s: Serialize or I/O error - %s", __func__, e.what());
+    }
+    if (!FileCommit(fileout.Get())) {
+        fileout.fclose();
+        fs::remove(pathTmp);
+        return error("%s: Failed to flush file %s", __func__, pathTmp.string());
+    }
+    fileout.fclose();
+    if (!RenameOver(pathTmp, path)) {
+        fs::remove(pathTmp);
+        return error("%s: Rename-into-place failed", __func__);
+    }
+    return true;
+}
@@ -12,13 +12,17 @@
 #include "dbwrapper.h"
 #include "libzerocoin/Coin.h"
 #include "libzerocoin/CoinSpend.h"
+#include "unordered_lru_cache.h"
 
+#include <functional>
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
 class CCoinsViewDBCursor;
+class CUTXOCommitment;
+class CUTXOCommitmentStats;
 class uint256;
 
 //! No need to periodic flush if at least this much space still available.
@@ -27,53 +31,93 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
 static const int64_t nDefaultDbCache = 300;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -dbcompactionrate default (MiB compacted per minute while idle)
+static const int64_t DEFAULT_DB_COMPACTION_RATE = 8;
+//! -dbverifyscans default
+static const bool DEFAULT_DB_VERIFY_SCANS = true;
+//! Time without a new tip after which the node is idle, for the database compaction (seconds)
+static const int64_t DB_COMPACTION_IDLE_TIME = 30;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
 static const int64_t nMinDbCache = 4;
-//! Max memory allocated to block tree DB specific cache, if no -txindex (MiB)
+//! Number of block index records decoded together in parallel when loading the block tree DB
+static const size_t BLOCK_INDEX_LOAD_BATCH = 16384;
+//! Max memory allocated to block tree DB specific cache (MiB)
 static const int64_t nMaxBlockDBCache = 2;
-//! Max memory allocated to block tree DB specific cache, if -txindex (MiB)
+//! Max memory allocated to the txindex DB specific cache, if -txindex (MiB)
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
-static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
+static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to the address index DB specific cache, if -addressindex (MiB)
+static const int64_t nMaxAddressIndexCache = 1024;
+//! Max memory allocated to the compact sapling blocks index DB specific cache, if -compactsaplingindex (MiB)
+static const int64_t nMaxCompactSaplingIndexCache = 64;
+//! Max memory allocated to all the block filter index caches combined, if -blockfilterindex (MiB)
+static const int64_t nMaxFilterIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
-
-struct CDiskTxPos : public FlatFilePos
+//! Max memory allocated to the Sapling nullifiers filter and anchors cache of the coin DB (MiB)
+static const int64_t nMaxSaplingDBCache = 32;
+
+/**
+ * Bloom filter of the Sapling nullifiers stored in the coin database, to answer
+ * most negative lookups (the common case: an unspent note) without a disk read.
+ * Nullifiers erased from the database (on block disconnection) stay in the filter,
+ * a false positive only costs the database read that would have happened anyway.
+ */
+class CSaplingNullifierFilter
 {
-    unsigned int nTxOffset; // after header
-
-    SERIALIZE_METHODS(CDiskTxPos, obj)
-    {
-        READWRITEAS(FlatFilePos, obj);
-        READWRITE(VARINT(obj.nTxOffset));
-    }
-
-    CDiskTxPos(const FlatFilePos& blockIn, unsigned int nTxOffsetIn) : FlatFilePos(blockIn.nFile, blockIn.nPos), nTxOffset(nTxOffsetIn)
-    {
-    }
+private:
+    // ~1% false positives when the filter is at capacity
+    static const unsigned int BITS_PER_ELEMENT = 10;
+    static const unsigned int HASH_FUNCS = 7;
 
-    CDiskTxPos()
-    {
-        SetNull();
-    }
+    const uint64_t k0, k1;
+    std::vector<uint64_t> vData;
+    size_t nElements{0};
+    size_t nCapacity{0};
+    bool fMaxSize{false};
+    bool fLoaded{false};
 
-    void SetNull()
-    {
-        FlatFilePos::SetNull();
-        nTxOffset = 0;
-    }
+public:
+    CSaplingNullifierFilter();
+
+    // Empty the filter and size it for nCapacityIn elements, using at most nMaxBytes
+    void Reset(size_t nCapacityIn, size_t nMaxBytes);
+    void insert(const uint256& nf);
+    bool contains(const uint256& nf) const;
+
+    // A loaded filter has every nullifier of the database
+    bool IsLoaded() const { return fLoaded; }
+    void SetLoaded(bool fLoadedIn) { fLoaded = fLoadedIn; }
+    // Whether adding nNew elements would exceed the capacity of a filter that can still grow
+    bool NeedsResize(size_t nNew) const { return !fMaxSize && nElements + nNew > nCapacity; }
+    size_t size() const { return nElements; }
+    size_t DynamicMemoryUsage() const;
 };
 
+//! Upper bound of the memory used by an anchor in the coin DB cache (a full depth tree)
+static const size_t SAPLING_ANCHOR_CACHE_ENTRY_USAGE = sizeof(uint256) + sizeof(std::pair<SaplingMerkleTree, int64_t>) +
+        SAPLING_INCREMENTAL_MERKLE_TREE_DEPTH * sizeof(Optional<libzcash::PedersenHash>) + 64;
+
 /** CCoinsView backed by the LevelDB coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
 
+    // Sapling lookup caches, kept across the flushes of the CCoinsViewCache on top.
+    // Sized with nSaplingCacheSize, disabled if zero.
+    size_t nSaplingCacheSize;
+    CSaplingNullifierFilter nullifiersFilter;
+    mutable unordered_lru_cache<uint256, SaplingMerkleTree, SaltedIdHasher> anchorsCache;
+
+    // (Re)build the nullifiers filter from the database, with room for nNew more nullifiers
+    void LoadNullifiersFilter(size_t nNew = 0);
+
 public:
-    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, size_t nSaplingCacheSizeIn = 0);
 
     bool GetCoin(const COutPoint& outpoint, Coin& coin) const override;
     bool HaveCoin(const COutPoint& outpoint) const override;
@@ -85,11 +129,16 @@ public:
     bool Upgrade();
     size_t EstimateSize() const override;
 
+    //! The commitment to the coins (-utxohash), written after them
+    bool ReadUTXOCommitment(CUTXOCommitment& commitment) const;
+    bool WriteUTXOCommitment(const CUTXOCommitment& commitment);
+
     bool BatchWrite(CCoinsMap& mapCoins,
                     const uint256& hashBlock,
                     const uint256& hashSaplingAnchor,
                     CAnchorsSaplingMap& mapSaplingAnchors,
-                    CNullifiersMap& mapSaplingNullifiers) override;
+                    CNullifiersMap& mapSaplingNullifiers,
+                    bool erase = true) override;
 
     // Sapling, the implementation of the following functions can be found in sapling_txdb.cpp.
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const override;
@@ -99,6 +148,11 @@ public:
                            CAnchorsSaplingMap& mapSaplingAnchors,
                            CNullifiersMap& mapSaplingNullifiers,
                            CDBBatch& batch);
+    //! Memory used by the Sapling lookup caches
+    size_t SaplingCacheUsage() const;
+    //! Iterate over the Sapling nullifiers and anchors of the database, in key order
+    bool ForEachSaplingNullifier(const std::function<void(const uint256&)>& func) const;
+    bool ForEachSaplingAnchor(const std::function<void(const uint256&, const SaplingMerkleTree&)>& func) const;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -133,17 +187,22 @@ public:
     CBlockTreeDB& operator=(const CBlockTreeDB&) = delete;
 
     bool WriteBlockIndex(const CDiskBlockIndex& blockindex);
-    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    /**
+     * Write the dirty block file infos and block index entries in a single batch.
+     * Without fSync the batch is only appended to the LevelDB log: it becomes durable with the next
+     * synchronous write to the database, as the log is synced up to that point.
+     */
+    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo, bool fSync = true);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo& info);
     bool ReadLastBlockFile(int& nFile);
     bool WriteReindexing(bool fReindexing);
     bool ReadReindexing(bool& fReindexing);
-    bool ReadTxIndex(const uint256& txid, CDiskTxPos& pos);
-    bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >& vect);
     bool WriteFlag(const std::string& name, bool fValue);
     bool ReadFlag(const std::string& name, bool& fValue);
     bool WriteInt(const std::string& name, int nValue);
     bool ReadInt(const std::string& name, int& nValue);
+    bool ReadUTXOCommitmentStats(const uint256& hashBlock, CUTXOCommitmentStats& stats) const;
+    bool WriteUTXOCommitmentStats(const uint256& hashBlock, const CUTXOCommitmentStats& stats);
     bool LoadBlockIndexGuts(std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
 
@@ -159,11 +218,17 @@ private:
 
 public:
     /** Write zPIV spends to the zerocoinDB in a batch
-     * Pair of: CBigNum -> coinSerialNumber and uint256 -> txHash.
+     * Pair of: CBigNum -> coinSerialNumber and uint256 -> txHash, all spent in block hashBlock.
      */
-    bool WriteCoinSpendBatch(const std::vector<std::pair<CBigNum, uint256> >& spendInfo);
+    bool WriteCoinSpendBatch(const std::vector<std::pair<CBigNum, uint256> >& spendInfo, const uint256& hashBlock);
     bool ReadCoinSpend(const CBigNum& bnSerial, uint256& txHash);
+    /** The block of a spend, from the hash of its coinSerialNumber (not recorded by the older versions) */
+    bool ReadCoinSpendBlock(const uint256& hashSerial, uint256& hashBlock);
     bool EraseCoinSpend(const CBigNum& bnSerial);
+    /** All the zPIV spends: pair of hash of the coinSerialNumber -> txHash */
+    bool ReadAllCoinSpends(std::vector<std::pair<uint256, uint256>>& vSpends);
+    /** The key of a coinSerialNumber in the spends records */
+    static uint256 GetSerialHash(const CBigNum& bnSerial);
 
     /** Accumulators (only for zPoS IBD): [checksum, denom] --> block height **/
     bool WriteAccChecksum(const uint32_t nChecksum, const libzerocoin::CoinDenomination denom, const int nHeight);
@@ -196,4 +261,35 @@ public:
     void Wipe();
 };
 
+/**
+ * Read-only index of the zPIV spends of the chain: [hash of the coinSerialNumber --> height of the spend], sorted.
+ * The zerocoin spends are rejected since the v5.0 upgrade, so once its activation is buried the set is final: it is
+ * written once to zerocoin_serials.dat, and then the serials are searched in memory instead of being read from the
+ * zerocoin DB along with their spending transaction.
+ */
+class CFrozenSerialIndex
+{
+private:
+    //! The chain the index was built with: the block at nHeightEnd, where the spends were no longer accepted
+    uint256 hashBlockEnd;
+    int nHeightEnd{-1};
+    std::vector<std::pair<uint256, int>> vSpends;
+
+public:
+    CFrozenSerialIndex() {}
+    CFrozenSerialIndex(const uint256& _hashBlockEnd, int _nHeightEnd, std::vector<std::pair<uint256, int>>&& _vSpends);
+
+    const uint256& GetBlockEnd() const { return hashBlockEnd; }
+    int GetHeightEnd() const { return nHeightEnd; }
+    size_t size() const { return vSpends.size(); }
+
+    //! The height of the spend of the serial, if it was spent
+    Optional<int> Lookup(const CBigNum& bnSerial) const;
+
+    bool Read(const fs::path& path);
+    bool Write(const fs::path& path) const;
+
+    SERIALIZE_METHODS(CFrozenSerialIndex, obj) { READWRITE(obj.hashBlockEnd, obj.nHeightEnd, obj.vSpends); }
+};
+
 #endif // BITCOIN_TXDB_H
@@ -13,6 +13,7 @@
 #include "evo/providertx.h"
 #include "policy/fees.h"
 #include "reverse_iterate.h"
+#include "script/standard.h"
 #include "streams.h"
 #include "timedata.h"
 #include "util/system.h"
@@ -23,14 +24,18 @@
 #include "validationinterface.h"
 
 
+
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbaseOrCoinstake, unsigned int _sigOps) :
      tx(MakeTransactionRef(_tx)), nFee(_nFee), nTime(_nTime), entryHeight(_entryHeight),
      spendsCoinbaseOrCoinstake(_spendsCoinbaseOrCoinstake), sigOpCount(_sigOps)
 {
-    nTxSize = ::GetSerializeSize(*_tx, PROTOCOL_VERSION);
-    nUsageSize = _tx->DynamicMemoryUsage();
+    nTxSize = _tx->GetTotalSize();
+    // The Solver results are cached with the tx by the policy checks or the wallet: count
+    // them from the start, so that the usage of the entry doesn't depend on who came first
+    GetOutputSolutions(*tx);
+    nUsageSize = tx->DynamicMemoryUsage();
     hasZerocoins = _tx->ContainsZerocoins();
     m_isShielded = _tx->IsShieldedTx();
 
@@ -106,6 +111,7 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
 void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashesToUpdate)
 {
     LOCK(cs);
+    m_snapshot.reset();
     // For each entry in vHashesToUpdate, store the set of in-mempool, but not
     // in-vHashesToUpdate transactions, so that we don't have to recalculate
     // descendants when we come across a previously seen entry.
@@ -435,6 +441,9 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     // (When we update the entry for in-mempool parents, memory usage will be
     // further updated.)
     cachedInnerUsage += entry.DynamicMemoryUsage();
+    if (entry.IsShielded()) {
+        cachedShieldedUsage += entry.DynamicMemoryUsage();
+    }
 
     const CTransaction& tx = newit->GetTx();
     std::set<uint256> setParentTransactions;
@@ -460,6 +469,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     }
     UpdateAncestorsOf(true, newit, setAncestors);
     UpdateEntryForAncestors(newit, setAncestors);
+    InvalidateEvictionCluster(newit);
 
     // Save spent nullifiers
     if (tx.IsShieldedTx()) {
@@ -469,6 +479,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     }
 
     nTransactionsUpdated++;
+    m_snapshot.reset();
     totalTxSize += entry.GetTxSize();
     minerPolicyEstimator->processTransaction(entry, validFeeEstimate);
 
@@ -563,9 +574,15 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
+    if (it->IsShielded()) {
+        cachedShieldedUsage -= it->DynamicMemoryUsage();
+    }
+    InvalidateEvictionCluster(it);
+    setEvictionDirty.erase(it);
     mapLinks.erase(it);
     mapTx.erase(it);
     nTransactionsUpdated++;
+    m_snapshot.reset();
     minerPolicyEstimator->removeTx(tx.GetHash());
 }
 
@@ -685,34 +702,49 @@ void CTxMemPool::removeWithAnchor(const uint256& invalidRoot)
     }
 }
 
-void CTxMemPool::removeConflicts(const CTransaction& tx)
+void CTxMemPool::removeConflicts(const std::vector<CTransactionRef>& vtx)
 {
-    // Remove transactions which depend on inputs of tx, recursively
-    std::list<CTransaction> result;
+    // Collect the transactions which spend the inputs or the nullifiers of the txs,
+    // then remove them with their descendants in a single pass
     LOCK(cs);
-    for (const CTxIn& txin : tx.vin) {
-        auto it = mapNextTx.find(txin.prevout);
-        if (it != mapNextTx.end()) {
-            const CTransaction& txConflict = *it->second;
-            if (txConflict != tx) {
-                removeRecursive(txConflict, MemPoolRemovalReason::CONFLICT);
-                ClearPrioritisation(txConflict.GetHash());
+    setEntries setConflicts;
+    auto addConflict = [&](const CTransactionRef& txConflict, const CTransaction& tx) {
+        if (*txConflict != tx) {
+            txiter it = mapTx.find(txConflict->GetHash());
+            assert(it != mapTx.end());
+            setConflicts.insert(it);
+        }
+    };
+    for (const auto& tx : vtx) {
+        for (const CTxIn& txin : tx->vin) {
+            auto it = mapNextTx.find(txin.prevout);
+            if (it != mapNextTx.end()) {
+                addConflict(it->second, *tx);
             }
         }
-    }
-    // Remove txes with conflicting nullifier
-    if (tx.IsShieldedTx()) {
-        for (const SpendDescription& sd : tx.sapData->vShieldedSpend) {
-            const auto& it = mapSaplingNullifiers.find(sd.nullifier);
-            if (it != mapSaplingNullifiers.end()) {
-                const CTransaction& txConflict = *it->second;
-                if (txConflict != tx) {
-                    removeRecursive(txConflict, MemPoolRemovalReason::CONFLICT);
-                    ClearPrioritisation(txConflict.GetHash());
+        // Txes with conflicting nullifier
+        if (tx->IsShieldedTx()) {
+            for (const SpendDescription& sd : tx->sapData->vShieldedSpend) {
+                const auto& it = mapSaplingNullifiers.find(sd.nullifier);
+                if (it != mapSaplingNullifiers.end()) {
+                    addConflict(it->second, *tx);
                 }
             }
         }
     }
+    if (setConflicts.empty()) return;
+
+    std::vector<uint256> vConflictHashes;
+    vConflictHashes.reserve(setConflicts.size());
+    setEntries setAllRemoves;
+    for (txiter it : setConflicts) {
+        vConflictHashes.emplace_back(it->GetTx().GetHash());
+        CalculateDescendants(it, setAllRemoves);
+    }
+    RemoveStaged(setAllRemoves, false, MemPoolRemovalReason::CONFLICT);
+    for (const uint256& hash : vConflictHashes) {
+        ClearPrioritisation(hash);
+    }
 }
 
 void CTxMemPool::removeProTxPubKeyConflicts(const CTransaction& tx, const CKeyID& keyId)
@@ -853,14 +885,18 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
     }
     // Before the txs in the new block have been removed from the mempool, update policy estimates
     minerPolicyEstimator->processBlock(nBlockHeight, entries);
+    // The txs of the block are removed at once (updating the state of their in-mempool
+    // descendants), then the ones conflicting with any of them
+    setEntries stage;
     for (const auto& tx : vtx) {
         txiter it = mapTx.find(tx->GetHash());
         if (it != mapTx.end()) {
-            setEntries stage;
             stage.insert(it);
-            RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
         }
-        removeConflicts(*tx);
+    }
+    RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
+    removeConflicts(vtx);
+    for (const auto& tx : vtx) {
         removeProTxConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
     }
@@ -874,14 +910,18 @@ void CTxMemPool::_clear()
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
+    mapSaplingNullifiers.clear();
     mapProTxAddresses.clear();
     mapProTxPubKeyIDs.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
+    cachedShieldedUsage = 0;
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = false;
     rollingMinimumFeeRate = 0;
     ++nTransactionsUpdated;
+    m_snapshot.reset();
+    ResetEvictionOrder();
 }
 
 void CTxMemPool::clear()
@@ -902,6 +942,7 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
 
     uint64_t checkTotal = 0;
     uint64_t innerUsage = 0;
+    uint64_t shieldedUsage = 0;
 
     CCoinsViewCache mempoolDuplicate(const_cast<CCoinsViewCache*>(pcoins));
 
@@ -911,6 +952,7 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
         unsigned int i = 0;
         checkTotal += it->GetTxSize();
         innerUsage += it->DynamicMemoryUsage();
+        if (it->IsShielded()) shieldedUsage += it->DynamicMemoryUsage();
         const CTransaction& tx = it->GetTx();
         txlinksMap::const_iterator linksiter = mapLinks.find(it);
         assert(linksiter != mapLinks.end());
@@ -1027,6 +1069,7 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
 
     assert(totalTxSize == checkTotal);
     assert(innerUsage == cachedInnerUsage);
+    assert(shieldedUsage == cachedShieldedUsage);
 }
 
 void CTxMemPool::checkNullifiers() const
@@ -1098,6 +1141,37 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
     }
 }
 
+std::shared_ptr<const MempoolSnapshot> CTxMemPool::GetSnapshot() const
+{
+    LOCK(cs);
+    if (m_snapshot) {
+        return m_snapshot;
+    }
+    auto snapshot = std::make_shared<MempoolSnapshot>();
+    snapshot->reserve(mapTx.size());
+    for (txiter it : GetSortedDepthAndScore()) {
+        TxMempoolEntrySnapshot e;
+        e.txid = it->GetTx().GetHash();
+        e.nFee = it->GetFee();
+        e.nModifiedFee = it->GetModifiedFee();
+        e.nTxSize = it->GetTxSize();
+        e.nTime = it->GetTime();
+        e.nHeight = it->GetHeight();
+        e.nCountWithAncestors = it->GetCountWithAncestors();
+        e.nSizeWithAncestors = it->GetSizeWithAncestors();
+        e.nModFeesWithAncestors = it->GetModFeesWithAncestors();
+        e.nCountWithDescendants = it->GetCountWithDescendants();
+        e.nSizeWithDescendants = it->GetSizeWithDescendants();
+        e.nModFeesWithDescendants = it->GetModFeesWithDescendants();
+        for (txiter parent : GetMemPoolParents(it)) {
+            e.vParents.emplace_back(parent->GetTx().GetHash());
+        }
+        snapshot->emplace_back(std::move(e));
+    }
+    m_snapshot = std::move(snapshot);
+    return m_snapshot;
+}
+
 static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator it) {
     return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee()};
 }
@@ -1197,16 +1271,16 @@ bool CTxMemPool::existsProviderTxConflict(const CTransaction &tx) const
     return false;
 }
 
-CFeeRate CTxMemPool::estimateFee(int nBlocks) const
+CFeeRate CTxMemPool::estimateFee(int nBlocks, bool fShielded) const
 {
     LOCK(cs);
-    return minerPolicyEstimator->estimateFee(nBlocks);
+    return minerPolicyEstimator->estimateFee(nBlocks, fShielded);
 }
 
-CFeeRate CTxMemPool::estimateSmartFee(int nBlocks, int *answerFoundAtBlocks) const
+CFeeRate CTxMemPool::estimateSmartFee(int nBlocks, int *answerFoundAtBlocks, bool fShielded) const
 {
     LOCK(cs);
-    return minerPolicyEstimator->estimateSmartFee(nBlocks, answerFoundAtBlocks, *this);
+    return minerPolicyEstimator->estimateSmartFee(nBlocks, answerFoundAtBlocks, *this, fShielded);
 }
 
 bool CTxMemPool::WriteFeeEstimates(CAutoFile& fileout) const
@@ -1248,6 +1322,8 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
         delta += nFeeDelta;
         txiter it = mapTx.find(hash);
         if (it != mapTx.end()) {
+            m_snapshot.reset();
+            InvalidateEvictionCluster(it);
             mapTx.modify(it, update_fee_delta(delta));
             // Now update all ancestors' modified fees with descendants
             setEntries setAncestors;
@@ -1327,9 +1403,9 @@ bool CCoinsViewMemPool::GetNullifier(const uint256& nullifier) const
 size_t CTxMemPool::DynamicMemoryUsage() const
 {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for
+    // Estimate the overhead of mapTx to be 18 pointers + an allocation, as no exact formula for
     // boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() +
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 18 * sizeof(void*)) * mapTx.size() +
             memusage::DynamicUsage(mapNextTx) +
             memusage::DynamicUsage(mapDeltas) +
             memusage::DynamicUsage(mapLinks) +
@@ -1375,6 +1451,8 @@ bool CTxMemPool::addUnchecked(const uint256&hash, const CTxMemPoolEntry &entry,
 
 void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
 {
+    InvalidateEvictionCluster(entry);
+    InvalidateEvictionCluster(child);
     setEntries s;
     if (add && mapLinks[entry].children.insert(child).second) {
         cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
@@ -1385,6 +1463,8 @@ void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
+    InvalidateEvictionCluster(entry);
+    InvalidateEvictionCluster(parent);
     setEntries s;
     if (add && mapLinks[entry].parents.insert(parent).second) {
         cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
@@ -1443,48 +1523,231 @@ void CTxMemPool::trackPackageRemoved(const CFeeRate& rate)
     }
 }
 
+void CTxMemPool::CalculateCluster(txiter it, setEntries& setCluster) const
+{
+    AssertLockHeld(cs);
+    std::vector<txiter> vStack{it};
+    setCluster.insert(it);
+    while (!vStack.empty()) {
+        txiter cur = vStack.back();
+        vStack.pop_back();
+        for (const setEntries* links : {&GetMemPoolParents(cur), &GetMemPoolChildren(cur)}) {
+            for (txiter linked : *links) {
+                if (setCluster.insert(linked).second) vStack.push_back(linked);
+            }
+        }
+    }
+}
+
+// Whether fees1/size1 > fees2/size2
+static bool HigherFeeRate(CAmount nFees1, int64_t nSize1, CAmount nFees2, int64_t nSize2)
+{
+    return (double)nFees1 * nSize2 > (double)nFees2 * nSize1;
+}
+
+void CTxMemPool::LinearizeCluster(const setEntries& setCluster, std::vector<ClusterChunk>& vChunks) const
+{
+    AssertLockHeld(cs);
+    vChunks.clear();
+    setEntries setRemaining(setCluster);
+    while (!setRemaining.empty()) {
+        // Select the remaining tx with the best feerate including its remaining ancestors
+        setEntries setBest;
+        CAmount nBestFees = 0;
+        int64_t nBestSize = 0;
+        for (txiter candidate : setRemaining) {
+            setEntries setAncestors{candidate};
+            std::vector<txiter> vStack{candidate};
+            CAmount nFees = 0;
+            int64_t nSize = 0;
+            while (!vStack.empty()) {
+                txiter cur = vStack.back();
+                vStack.pop_back();
+                nFees += cur->GetModifiedFee();
+                nSize += cur->GetTxSize();
+                for (txiter parent : GetMemPoolParents(cur)) {
+                    if (setRemaining.count(parent) && setAncestors.insert(parent).second) vStack.push_back(parent);
+                }
+            }
+            if (setBest.empty() || HigherFeeRate(nFees, nSize, nBestFees, nBestSize)) {
+                setBest.swap(setAncestors);
+                nBestFees = nFees;
+                nBestSize = nSize;
+            }
+        }
+
+        // The ancestors are sorted before their descendants by ancestor count
+        ClusterChunk chunk;
+        chunk.vTxs.assign(setBest.begin(), setBest.end());
+        std::sort(chunk.vTxs.begin(), chunk.vTxs.end(), [](const txiter& a, const txiter& b) {
+            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+        });
+        chunk.nModFees = nBestFees;
+        chunk.nSize = nBestSize;
+        for (txiter selected : setBest) {
+            setRemaining.erase(selected);
+        }
+
+        // A chunk paying more than the previous one is mined together with it
+        while (!vChunks.empty() && !HigherFeeRate(vChunks.back().nModFees, vChunks.back().nSize, chunk.nModFees, chunk.nSize)) {
+            ClusterChunk& prev = vChunks.back();
+            prev.vTxs.insert(prev.vTxs.end(), chunk.vTxs.begin(), chunk.vTxs.end());
+            prev.nModFees += chunk.nModFees;
+            prev.nSize += chunk.nSize;
+            chunk = std::move(prev);
+            vChunks.pop_back();
+        }
+        vChunks.emplace_back(std::move(chunk));
+    }
+}
+
+bool CTxMemPool::CompareEvictionFeeRate::operator()(const EvictionCandidate& a, const EvictionCandidate& b) const
+{
+    // The lowest feerate first
+    return HigherFeeRate(b.chunk.nModFees, b.chunk.nSize, a.chunk.nModFees, a.chunk.nSize);
+}
+
+void CTxMemPool::InvalidateEvictionCluster(txiter it)
+{
+    AssertLockHeld(cs);
+    if (!fEvictionOrderBuilt) return;
+    auto itCandidate = mapEvictionCandidates.find(it);
+    if (itCandidate == mapEvictionCandidates.end()) {
+        setEvictionDirty.insert(it);
+        return;
+    }
+    // The whole cluster is linearized again
+    const evictionSet::iterator candidate = itCandidate->second;
+    for (txiter dirty : candidate->chunk.vTxs) {
+        mapEvictionCandidates.erase(dirty);
+        setEvictionDirty.insert(dirty);
+    }
+    for (txiter dirty : candidate->setRest) {
+        mapEvictionCandidates.erase(dirty);
+        setEvictionDirty.insert(dirty);
+    }
+    setEvictionOrder.erase(candidate);
+}
+
+void CTxMemPool::UpdateEvictionOrder()
+{
+    AssertLockHeld(cs);
+    if (!fEvictionOrderBuilt) {
+        for (txiter it = mapTx.begin(); it != mapTx.end(); ++it) {
+            setEvictionDirty.insert(it);
+        }
+        fEvictionOrderBuilt = true;
+    }
+    for (txiter it : setEvictionDirty) {
+        if (mapEvictionCandidates.count(it)) continue;
+        setEntries setCluster;
+        CalculateCluster(it, setCluster);
+        std::vector<ClusterChunk> vChunks;
+        LinearizeCluster(setCluster, vChunks);
+        EvictionCandidate candidate;
+        candidate.chunk = std::move(vChunks.back());
+        for (txiter evicted : candidate.chunk.vTxs) {
+            setCluster.erase(evicted);
+        }
+        candidate.setRest.swap(setCluster);
+        const evictionSet::iterator inserted = setEvictionOrder.insert(std::move(candidate));
+        for (txiter tx : inserted->chunk.vTxs) {
+            mapEvictionCandidates.emplace(tx, inserted);
+        }
+        for (txiter tx : inserted->setRest) {
+            mapEvictionCandidates.emplace(tx, inserted);
+        }
+    }
+    setEvictionDirty.clear();
+}
+
+void CTxMemPool::ResetEvictionOrder()
+{
+    AssertLockHeld(cs);
+    fEvictionOrderBuilt = false;
+    setEvictionOrder.clear();
+    mapEvictionCandidates.clear();
+    setEvictionDirty.clear();
+}
+
 void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining)
 {
     LOCK(cs);
     unsigned nTxnRemoved = 0;
     CFeeRate maxFeeRateRemoved(0);
+
     while (DynamicMemoryUsage() > sizelimit) {
-        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+        setEntries stage;
+        CFeeRate removed;
+        if (fClusterEviction) {
+            // Only the clusters changed since the last call (or by the last eviction) are linearized
+            UpdateEvictionOrder();
+            if (setEvictionOrder.empty()) break;
+            const EvictionCandidate& candidate = *setEvictionOrder.begin();
+            stage.insert(candidate.chunk.vTxs.begin(), candidate.chunk.vTxs.end());
+            removed = CFeeRate(candidate.chunk.nModFees, candidate.chunk.nSize);
+            // The rest of the cluster (possibly split in several ones) gets a new last chunk
+            InvalidateEvictionCluster(candidate.chunk.vTxs.front());
+        } else {
+            indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+            removed = CFeeRate(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+            CalculateDescendants(mapTx.project<0>(it), stage);
+        }
 
         // We set the new mempool min fee to the feerate of the removed set, plus the
         // "minimum reasonable fee rate" (ie some value under which we consider txn
         // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
         // equal to txn which were removed with no block in between.
-        CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
         removed += minReasonableRelayFee;
         trackPackageRemoved(removed);
         maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
 
+        nTxnRemoved += stage.size();
+        RemoveStagedForSize(stage, pvNoSpendsRemaining);
+    }
+
+    if (maxFeeRateRemoved > CFeeRate(0))
+        LogPrint(BCLog::MEMPOOL, "Removed %u txn, rolling minimum fee bumped to %s\n", nTxnRemoved, maxFeeRateRemoved.ToString());
+}
+
+void CTxMemPool::TrimShieldedToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining)
+{
+    LOCK(cs);
+    unsigned nTxnRemoved = 0;
+    const auto& index = mapTx.get<shielded_score>();
+    while (cachedShieldedUsage > sizelimit) {
+        auto it = index.begin();
+        if (it == index.end() || !it->IsShielded()) break;
         setEntries stage;
         CalculateDescendants(mapTx.project<0>(it), stage);
         nTxnRemoved += stage.size();
+        RemoveStagedForSize(stage, pvNoSpendsRemaining);
+    }
 
-        std::vector<CTransaction> txn;
-        if (pvNoSpendsRemaining) {
-            txn.reserve(stage.size());
-            for (txiter it: stage)
-                txn.push_back(it->GetTx());
-        }
-        RemoveStaged(stage, false, MemPoolRemovalReason::SIZELIMIT);
-        if (pvNoSpendsRemaining) {
-            for (const CTransaction& tx: txn) {
-                for (const CTxIn& txin: tx.vin) {
-                    if (exists(txin.prevout.hash)) continue;
-                    if (!mapNextTx.count(txin.prevout)) {
-                        pvNoSpendsRemaining->push_back(txin.prevout);
-                    }
+    if (nTxnRemoved > 0)
+        LogPrint(BCLog::MEMPOOL, "Removed %u txn to limit the shielded txs usage\n", nTxnRemoved);
+}
+
+void CTxMemPool::RemoveStagedForSize(setEntries& stage, std::vector<COutPoint>* pvNoSpendsRemaining)
+{
+    AssertLockHeld(cs);
+    std::vector<CTransaction> txn;
+    if (pvNoSpendsRemaining) {
+        txn.reserve(stage.size());
+        for (txiter it: stage)
+            txn.push_back(it->GetTx());
+    }
+    RemoveStaged(stage, false, MemPoolRemovalReason::SIZELIMIT);
+    if (pvNoSpendsRemaining) {
+        for (const CTransaction& tx: txn) {
+            for (const CTxIn& txin: tx.vin) {
+                if (exists(txin.prevout.hash)) continue;
+                if (!mapNextTx.count(txin.prevout)) {
+                    pvNoSpendsRemaining->push_back(txin.prevout);
                 }
             }
         }
     }
-
-    if (maxFeeRateRemoved > CFeeRate(0))
-        LogPrint(BCLog::MEMPOOL, "Removed %u txn, rolling minimum fee bumped to %s\n", nTxnRemoved, maxFeeRateRemoved.ToString());
 }
 
 bool CTxMemPool::TransactionWithinChainLimit(const uint256& txid, size_t chainLimit) const {
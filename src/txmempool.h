@@ -10,6 +10,7 @@
 #include <list>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 #include "amount.h"
 #include "coins.h"
@@ -213,6 +214,22 @@ public:
     }
 };
 
+/** \class CompareTxMemPoolEntryByShieldedDescendantScore
+ *
+ *  Sort the shielded entries first, then by descendant score: the shielded entries to evict come first.
+ */
+class CompareTxMemPoolEntryByShieldedDescendantScore
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        if (a.IsShielded() != b.IsShielded()) {
+            return a.IsShielded();
+        }
+        return CompareTxMemPoolEntryByDescendantScore()(a, b);
+    }
+};
+
 /** \class CompareTxMemPoolEntryByScore
  *
  *  Sort by score of entry ((fee+delta)/size) in descending order
@@ -268,6 +285,7 @@ struct descendant_score {};
 struct entry_time {};
 struct mining_score {};
 struct ancestor_score {};
+struct shielded_score {};
 
 class CBlockPolicyEstimator;
 
@@ -289,6 +307,27 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/** A copy of the data of a mempool entry, held by the mempool read snapshots */
+struct TxMempoolEntrySnapshot
+{
+    uint256 txid;
+    CAmount nFee;
+    CAmount nModifiedFee;
+    size_t nTxSize;
+    int64_t nTime;
+    unsigned int nHeight;
+    uint64_t nCountWithAncestors;
+    uint64_t nSizeWithAncestors;
+    CAmount nModFeesWithAncestors;
+    uint64_t nCountWithDescendants;
+    uint64_t nSizeWithDescendants;
+    CAmount nModFeesWithDescendants;
+    std::vector<uint256> vParents; //! the txids of the in-mempool parents
+};
+
+/** The entries of the mempool, sorted as by CTxMemPool::queryHashes */
+typedef std::vector<TxMempoolEntrySnapshot> MempoolSnapshot;
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -390,6 +429,7 @@ private:
     CFeeRate minRelayFee; //! Passed to constructor to avoid dependency on main
     uint64_t totalTxSize; //! sum of all mempool tx' byte sizes
     uint64_t cachedInnerUsage; //! sum of dynamic memory usage of all the map elements (NOT the maps themselves)
+    uint64_t cachedShieldedUsage{0}; //! sum of dynamic memory usage of the shielded txs
 
     CFeeRate minReasonableRelayFee;
 
@@ -399,12 +439,18 @@ private:
 
     void trackPackageRemoved(const CFeeRate& rate);
 
-    // Shielded txes
-    std::map<uint256, CTransactionRef> mapSaplingNullifiers;
+    // Shielded txes: the mempool txs spending each nullifier
+    std::unordered_map<uint256, CTransactionRef, SaltedIdHasher> mapSaplingNullifiers;
     void checkNullifiers() const;
 
     bool m_is_loaded GUARDED_BY(cs){false};
 
+    //! Whether TrimToSize evicts the worst chunks of the clusters, instead of using the descendant score
+    bool fClusterEviction{false};
+
+    //! The read snapshot of the entries, reset by any change of the mempool and built again on demand
+    mutable std::shared_ptr<const MempoolSnapshot> m_snapshot GUARDED_BY(cs);
+
 public:
 
     static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12; // public only for testing
@@ -437,6 +483,12 @@ public:
                 boost::multi_index::tag<ancestor_score>,
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByAncestorFee
+            >,
+            // shielded first, sorted by fee rate (for the shielded size limit)
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<shielded_score>,
+                boost::multi_index::identity<CTxMemPoolEntry>,
+                CompareTxMemPoolEntryByShieldedDescendantScore
             >
         >
     > indexed_transaction_set;
@@ -483,6 +535,13 @@ public:
     const setEntries & GetMemPoolParents(txiter entry) const;
     const setEntries & GetMemPoolChildren(txiter entry) const;
 
+    /** A set of consecutive txs of a cluster linearization, to be mined (or evicted) together */
+    struct ClusterChunk {
+        std::vector<txiter> vTxs;
+        CAmount nModFees{0};
+        int64_t nSize{0};
+    };
+
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
@@ -505,6 +564,28 @@ private:
 
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const;
 
+    /** The last chunk of a cluster, in the eviction order of TrimToSize */
+    struct EvictionCandidate {
+        ClusterChunk chunk;
+        setEntries setRest;     // the other txs of the cluster
+    };
+    struct CompareEvictionFeeRate {
+        bool operator()(const EvictionCandidate& a, const EvictionCandidate& b) const;
+    };
+    typedef std::multiset<EvictionCandidate, CompareEvictionFeeRate> evictionSet;
+
+    //! With cluster eviction, the last chunks of the clusters, lowest feerate first. It's built when
+    //! the limit is first exceeded, then a change of a cluster only marks its txs dirty, and only
+    //! the dirty clusters are linearized again by the next TrimToSize.
+    bool fEvictionOrderBuilt{false};
+    evictionSet setEvictionOrder;
+    std::map<txiter, evictionSet::iterator, CompareIteratorByHash> mapEvictionCandidates;
+    setEntries setEvictionDirty;
+
+    void InvalidateEvictionCluster(txiter it);
+    void UpdateEvictionOrder();
+    void ResetEvictionOrder();
+
 public:
     indirectmap<COutPoint, CTransactionRef> mapNextTx;
     std::map<uint256, CAmount> mapDeltas;
@@ -525,6 +606,12 @@ public:
      */
     void check(const CCoinsViewCache *pcoins) const;
     void setSanityCheck(double dFrequency = 1.0) { nCheckFrequency = dFrequency * 4294967295.0; }
+    void SetClusterEviction(bool fEnable)
+    {
+        LOCK(cs);
+        fClusterEviction = fEnable;
+        ResetEvictionOrder();
+    }
 
     // addUnchecked must updated state for all ancestors of a given transaction,
     // to track size/count of descendant transactions.  First version of
@@ -539,13 +626,17 @@ public:
     void removeRecursive(const CTransaction& tx, MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN);
     void removeForReorg(const CCoinsViewCache* pcoins, unsigned int nMemPoolHeight, int flags);
     void removeWithAnchor(const uint256& invalidRoot);
-    void removeConflicts(const CTransaction& tx);
+    /** Remove the txs (with their descendants) conflicting with the ones of vtx, all at once */
+    void removeConflicts(const std::vector<CTransactionRef>& vtx);
     void removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight);
 
     void clear();
     void _clear();  // lock-free
     bool CompareDepthAndScore(const uint256& hasha, const uint256& hashb);
     void queryHashes(std::vector<uint256>& vtxid);
+    /** Return a read snapshot of the entries. It is built once after each change of the mempool and
+     *  shared by the following readers, that iterate it without holding the mempool lock. */
+    std::shared_ptr<const MempoolSnapshot> GetSnapshot() const;
     void getTransactions(std::set<uint256>& setTxid);
     bool isSpent(const COutPoint& outpoint);
     unsigned int GetTransactionsUpdated() const;
@@ -600,6 +691,16 @@ public:
      *  already in it.  */
     void CalculateDescendants(txiter it, setEntries &setDescendants);
 
+    /** Populate setCluster with the connected component of it: the txs linked to it through
+     *  chains of in-mempool parents and children. */
+    void CalculateCluster(txiter it, setEntries& setCluster) const;
+
+    /** Linearize a cluster the way block assembly selects its txs (the remaining tx with the best
+     *  ancestor feerate first, after its ancestors), then group the linearization into chunks of
+     *  decreasing feerate. The last chunk holds the descendants of its txs, and is the first part
+     *  of the cluster the miners would leave out. */
+    void LinearizeCluster(const setEntries& setCluster, std::vector<ClusterChunk>& vChunks) const;
+
     /** The minimum fee to get into the mempool, which may itself not be enough
      *  for larger-sized transactions.
      *  The minReasonableRelayFee constructor arg is used to bound the time it
@@ -611,9 +712,20 @@ public:
     /** Remove transactions from the mempool until its dynamic size is <= sizelimit.
       *  pvNoSpendsRemaining, if set, will be populated with the list of transactions
       *  which are not in mempool which no longer have any spends in this mempool.
+      *  With cluster eviction, the chunk of lowest feerate among the last chunks of
+      *  the clusters is removed first, otherwise the tx (with its descendants) of
+      *  lowest descendant score.
       */
     void TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining = nullptr);
 
+    /** Remove shielded transactions (with their descendants) from the mempool, lowest descendant
+      *  score first, until the dynamic size of the shielded ones is <= sizelimit.
+      *  The shielded txs have their own budget, being much more expensive to verify, so that
+      *  they can't crowd the transparent ones out of the mempool.
+      *  pvNoSpendsRemaining is populated as in TrimToSize.
+      */
+    void TrimShieldedToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining = nullptr);
+
     /** Expire all transaction (and their dependencies) in the mempool older than time. Return the number of removed transactions. */
     int Expire(int64_t time);
 
@@ -636,6 +748,11 @@ public:
         LOCK(cs);
         return totalTxSize;
     }
+    uint64_t GetShieldedDynamicMemoryUsage() const
+    {
+        LOCK(cs);
+        return cachedShieldedUsage;
+    }
 
     bool exists(uint256 hash) const
     {
@@ -661,10 +778,10 @@ public:
      *  If no answer can be given at nBlocks, return an estimate
      *  at the lowest number of blocks where one can be given
      */
-    CFeeRate estimateSmartFee(int nBlocks, int *answerFoundAtBlocks = nullptr) const;
+    CFeeRate estimateSmartFee(int nBlocks, int *answerFoundAtBlocks = nullptr, bool fShielded = false) const;
 
-    /** Estimate fee rate needed to get into the next nBlocks */
-    CFeeRate estimateFee(int nBlocks) const;
+    /** Estimate fee rate needed to get into the next nBlocks (for a shielded tx if fShielded) */
+    CFeeRate estimateFee(int nBlocks, bool fShielded = false) const;
 
     /** Write/Read estimates to disk */
     bool WriteFeeEstimates(CAutoFile& fileout) const;
@@ -709,6 +826,9 @@ private:
      *  removal.
      */
     void removeUnchecked(txiter entry, MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN);
+    /** Remove a set of transactions evicted for the size limits, collecting the outpoints
+     *  no longer spent in the mempool into pvNoSpendsRemaining (if set) */
+    void RemoveStagedForSize(setEntries& stage, std::vector<COutPoint>* pvNoSpendsRemaining);
 
     /** Special txes **/
     void addUncheckedSpecialTx(const CTransaction& tx);
@@ -0,0 +1,384 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txreconciliation.h"
+
+#include "crypto/siphash.h"
+#include "hash.h"
+#include "logging.h"
+#include "random.h"
+
+#include <cassert>
+#include <limits>
+#include <map>
+
+// Finalizer of murmur3: the short ids are salted already, it only has to spread them
+static inline uint32_t Mix(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x85ebca6b;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35;
+    x ^= x >> 16;
+    return x;
+}
+
+static inline uint32_t CellCheck(uint32_t id)
+{
+    return Mix(id ^ 0x5bd1e995);
+}
+
+// Cell of the id in the part-th third of the table
+static inline size_t CellIndex(uint32_t id, int part, size_t nPartSize)
+{
+    return part * nPartSize + (((uint64_t)Mix(id + part * 0x9e3779b9) * nPartSize) >> 32);
+}
+
+void ReconSketch::Add(uint32_t id)
+{
+    const size_t nPartSize = cells.size() / 3;
+    if (nPartSize == 0) return;
+    for (int part = 0; part < 3; part++) {
+        Cell& cell = cells[CellIndex(id, part, nPartSize)];
+        cell.count++;
+        cell.keys ^= id;
+        cell.checks ^= CellCheck(id);
+    }
+}
+
+ReconSketch& ReconSketch::operator-=(const ReconSketch& other)
+{
+    assert(cells.size() == other.cells.size());
+    for (size_t i = 0; i < cells.size(); i++) {
+        cells[i].count -= other.cells[i].count;
+        cells[i].keys ^= other.cells[i].keys;
+        cells[i].checks ^= other.cells[i].checks;
+    }
+    return *this;
+}
+
+bool ReconSketch::Decode(std::vector<uint32_t>& added, std::vector<uint32_t>& removed) const
+{
+    std::vector<Cell> table(cells);
+    const size_t nPartSize = table.size() / 3;
+    auto isPure = [&table](size_t i) {
+        const Cell& cell = table[i];
+        return (cell.count == 1 || cell.count == -1) && cell.checks == CellCheck(cell.keys);
+    };
+
+    // Peel the cells holding a single id, until none is left
+    std::vector<size_t> pure;
+    for (size_t i = 0; i < table.size(); i++) {
+        if (isPure(i)) pure.push_back(i);
+    }
+    while (!pure.empty()) {
+        const size_t i = pure.back();
+        pure.pop_back();
+        if (!isPure(i)) continue;
+        const uint32_t id = table[i].keys;
+        const int16_t sign = table[i].count;
+        (sign > 0 ? added : removed).push_back(id);
+        if (added.size() + removed.size() > table.size()) return false;
+        for (int part = 0; part < 3; part++) {
+            const size_t j = CellIndex(id, part, nPartSize);
+            Cell& cell = table[j];
+            cell.count -= sign;
+            cell.keys ^= id;
+            cell.checks ^= CellCheck(id);
+            if (isPure(j)) pure.push_back(j);
+        }
+    }
+
+    for (const Cell& cell : table) {
+        if (cell.count != 0 || cell.keys != 0 || cell.checks != 0) return false;
+    }
+    return true;
+}
+
+size_t ReconSketch::CellsForDiff(size_t nDiff)
+{
+    // Small tables need proportionally more cells to peel
+    return std::min(MAX_SKETCH_CELLS, 3 * ((2 * nDiff + 2) / 3 + 2));
+}
+
+namespace {
+
+struct ReconPeer {
+    uint64_t local_salt;
+    bool registered{false};
+    // Whether we opened the connection, and request the reconciliations
+    bool is_initiator{false};
+    uint64_t k0{0};
+    uint64_t k1{0};
+    // Transactions to announce to the peer, by short id
+    std::map<uint32_t, uint256> set;
+    // Responder: the set sketched, until the reconcildiff
+    std::map<uint32_t, uint256> snapshot;
+    bool sketch_sent{false};
+    std::chrono::microseconds last_request{0};
+    // Initiator
+    bool requested{false};
+    std::chrono::microseconds request_time{0};
+    std::chrono::microseconds next_request{0};
+    double q{RECON_Q_DEFAULT};
+
+    uint32_t ShortId(const uint256& txid) const { return (uint32_t)SipHashUint256(k0, k1, txid); }
+};
+
+} // anon namespace
+
+class TxReconciliationTracker::Impl
+{
+    std::map<NodeId, ReconPeer> m_peers;
+
+public:
+    ReconPeer* GetRegistered(NodeId peer)
+    {
+        auto it = m_peers.find(peer);
+        return it != m_peers.end() && it->second.registered ? &it->second : nullptr;
+    }
+
+    void PreRegisterPeer(NodeId peer, uint64_t local_salt)
+    {
+        ReconPeer& state = m_peers[peer];
+        state = ReconPeer();
+        state.local_salt = local_salt;
+    }
+
+    bool RegisterPeer(NodeId peer, bool is_initiator, uint32_t peer_version, uint64_t peer_salt)
+    {
+        auto it = m_peers.find(peer);
+        if (it == m_peers.end() || it->second.registered || peer_version < TXRECONCILIATION_VERSION) {
+            return false;
+        }
+        ReconPeer& state = it->second;
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << std::string("PIVX tx reconciliation") << std::min(state.local_salt, peer_salt) << std::max(state.local_salt, peer_salt);
+        const uint256 key = ss.GetHash();
+        state.k0 = key.GetUint64(0);
+        state.k1 = key.GetUint64(1);
+        state.is_initiator = is_initiator;
+        state.registered = true;
+        LogPrint(BCLog::NET, "Registered peer=%d for tx reconciliation, %s\n", peer, is_initiator ? "initiator" : "responder");
+        return true;
+    }
+
+    void ForgetPeer(NodeId peer) { m_peers.erase(peer); }
+
+    bool AddToSet(NodeId peer, const uint256& txid)
+    {
+        ReconPeer* state = GetRegistered(peer);
+        if (!state || state->set.size() >= MAX_RECON_SET_SIZE) return false;
+        // A short id collision is announced with inv
+        const auto res = state->set.emplace(state->ShortId(txid), txid);
+        return res.second || res.first->second == txid;
+    }
+
+    void TryRemovingFromSet(NodeId peer, const uint256& txid)
+    {
+        ReconPeer* state = GetRegistered(peer);
+        if (!state) return;
+        auto it = state->set.find(state->ShortId(txid));
+        if (it != state->set.end() && it->second == txid) state->set.erase(it);
+    }
+
+    size_t GetSetSize(NodeId peer)
+    {
+        ReconPeer* state = GetRegistered(peer);
+        return state ? state->set.size() : 0;
+    }
+
+    Optional<std::pair<uint16_t, uint16_t>> InitiateReconciliationRequest(NodeId peer, std::chrono::microseconds now)
+    {
+        ReconPeer* state = GetRegistered(peer);
+        if (!state || !state->is_initiator || state->requested || now < state->next_request) return nullopt;
+        state->requested = true;
+        state->request_time = now;
+        state->next_request = now + RECON_REQUEST_INTERVAL;
+        return std::make_pair((uint16_t)std::min<size_t>(state->set.size(), std::numeric_limits<uint16_t>::max()),
+                              (uint16_t)(state->q * Q_PRECISION));
+    }
+
+    bool HasReconciliationTimedOut(NodeId peer, std::chrono::microseconds now)
+    {
+        ReconPeer* state = GetRegistered(peer);
+        return state && state->requested && now > state->request_time + RECON_RESPONSE_TIMEOUT;
+    }
+
+    bool HandleReconciliationRequest(NodeId peer, std::chrono::microseconds now, uint16_t peer_set_size, uint16_t peer_q,
+                                     ReconSketch& sketch)
+    {
+        ReconPeer* state = GetRegistered(peer);
+        if (!state || state->is_initiator || state->sketch_sent) return false;
+        // Each request costs a sketch of the whole set
+        if (state->last_request.count() && now < state->last_request + RECON_REQUEST_INTERVAL - RECON_REQUEST_TOLERANCE) {
+            return false;
+        }
+
+        // The difference is estimated from the one of the previous reconciliation. The peer set
+        // can't be larger than ours could be.
+        const double q = (double)peer_q / Q_PRECISION;
+        const size_t nLocal = state->set.size();
+        const size_t nPeer = std::min<size_t>(peer_set_size, MAX_RECON_SET_SIZE);
+        const size_t nMin = std::min(nLocal, nPeer);
+        const size_t nDiff = std::max(nLocal, nPeer) - nMin + (size_t)(q * nMin) + 1;
+
+        state->snapshot = std::move(state->set);
+        state->set.clear();
+        state->sketch_sent = true;
+        state->last_request = now;
+        sketch = ReconSketch(ReconSketch::CellsForDiff(nDiff));
+        for (const auto& it : state->snapshot) {
+            sketch.Add(it.first);
+        }
+        return true;
+    }
+
+    bool HandleSketch(NodeId peer, const ReconSketch& sketch, std::vector<uint256>& txs_to_announce,
+                      std::vector<uint32_t>& ask_shortids, bool& success)
+    {
+        ReconPeer* state = GetRegistered(peer);
+        if (!state || !state->is_initiator || !state->requested) return false;
+        if (sketch.Size() == 0 || sketch.Size() > MAX_SKETCH_CELLS || sketch.Size() % 3 != 0) return false;
+        state->requested = false;
+
+        ReconSketch diff(sketch.Size());
+        for (const auto& it : state->set) {
+            diff.Add(it.first);
+        }
+        diff -= sketch;
+        std::vector<uint32_t> added;
+        success = diff.Decode(added, ask_shortids);
+        if (success) {
+            for (const uint32_t id : added) {
+                auto it = state->set.find(id);
+                if (it != state->set.end()) txs_to_announce.push_back(it->second);
+            }
+            // Adapt q to the difference found
+            const size_t nLocal = state->set.size();
+            const size_t nRemote = nLocal + ask_shortids.size() - std::min(nLocal, added.size());
+            const size_t nMin = std::min(nLocal, nRemote);
+            if (nMin > 0) {
+                const size_t nSizeDiff = std::max(nLocal, nRemote) - nMin;
+                const size_t nDiff = added.size() + ask_shortids.size();
+                state->q = std::min(1.999, (double)(nDiff - std::min(nDiff, nSizeDiff)) / nMin);
+            }
+        } else {
+            ask_shortids.clear();
+            for (const auto& it : state->set) {
+                txs_to_announce.push_back(it.second);
+            }
+        }
+        LogPrint(BCLog::NET, "Reconciliation with peer=%d %s: %d cells, %d txs to announce, %d asked\n", peer,
+                 success ? "succeeded" : "failed", sketch.Size(), txs_to_announce.size(), ask_shortids.size());
+        state->set.clear();
+        return true;
+    }
+
+    bool HandleReconciliationDiff(NodeId peer, bool success, const std::vector<uint32_t>& ask_shortids,
+                                  std::vector<uint256>& txs_to_announce)
+    {
+        ReconPeer* state = GetRegistered(peer);
+        if (!state || state->is_initiator || !state->sketch_sent) return false;
+        state->sketch_sent = false;
+        if (success) {
+            for (const uint32_t id : ask_shortids) {
+                auto it = state->snapshot.find(id);
+                if (it != state->snapshot.end()) txs_to_announce.push_back(it->second);
+            }
+        } else {
+            for (const auto& it : state->snapshot) {
+                txs_to_announce.push_back(it.second);
+            }
+        }
+        state->snapshot.clear();
+        return true;
+    }
+};
+
+TxReconciliationTracker::TxReconciliationTracker() : m_impl(std::make_unique<Impl>()) {}
+
+TxReconciliationTracker::~TxReconciliationTracker() = default;
+
+uint64_t TxReconciliationTracker::PreRegisterPeer(NodeId peer)
+{
+    const uint64_t local_salt = GetRand(std::numeric_limits<uint64_t>::max());
+    PreRegisterPeer(peer, local_salt);
+    return local_salt;
+}
+
+void TxReconciliationTracker::PreRegisterPeer(NodeId peer, uint64_t local_salt)
+{
+    LOCK(cs);
+    m_impl->PreRegisterPeer(peer, local_salt);
+}
+
+bool TxReconciliationTracker::RegisterPeer(NodeId peer, bool is_initiator, uint32_t peer_version, uint64_t peer_salt)
+{
+    LOCK(cs);
+    return m_impl->RegisterPeer(peer, is_initiator, peer_version, peer_salt);
+}
+
+void TxReconciliationTracker::ForgetPeer(NodeId peer)
+{
+    LOCK(cs);
+    m_impl->ForgetPeer(peer);
+}
+
+bool TxReconciliationTracker::IsPeerRegistered(NodeId peer) const
+{
+    LOCK(cs);
+    return m_impl->GetRegistered(peer) != nullptr;
+}
+
+bool TxReconciliationTracker::AddToSet(NodeId peer, const uint256& txid)
+{
+    LOCK(cs);
+    return m_impl->AddToSet(peer, txid);
+}
+
+void TxReconciliationTracker::TryRemovingFromSet(NodeId peer, const uint256& txid)
+{
+    LOCK(cs);
+    m_impl->TryRemovingFromSet(peer, txid);
+}
+
+size_t TxReconciliationTracker::GetSetSize(NodeId peer) const
+{
+    LOCK(cs);
+    return m_impl->GetSetSize(peer);
+}
+
+Optional<std::pair<uint16_t, uint16_t>> TxReconciliationTracker::InitiateReconciliationRequest(NodeId peer, std::chrono::microseconds now)
+{
+    LOCK(cs);
+    return m_impl->InitiateReconciliationRequest(peer, now);
+}
+
+bool TxReconciliationTracker::HasReconciliationTimedOut(NodeId peer, std::chrono::microseconds now) const
+{
+    LOCK(cs);
+    return m_impl->HasReconciliationTimedOut(peer, now);
+}
+
+bool TxReconciliationTracker::HandleReconciliationRequest(NodeId peer, std::chrono::microseconds now, uint16_t peer_set_size,
+                                                          uint16_t peer_q, ReconSketch& sketch)
+{
+    LOCK(cs);
+    return m_impl->HandleReconciliationRequest(peer, now, peer_set_size, peer_q, sketch);
+}
+
+bool TxReconciliationTracker::HandleSketch(NodeId peer, const ReconSketch& sketch, std::vector<uint256>& txs_to_announce,
+                                           std::vector<uint32_t>& ask_shortids, bool& success)
+{
+    LOCK(cs);
+    return m_impl->HandleSketch(peer, sketch, txs_to_announce, ask_shortids, success);
+}
+
+bool TxReconciliationTracker::HandleReconciliationDiff(NodeId peer, bool success, const std::vector<uint32_t>& ask_shortids,
+                                                       std::vector<uint256>& txs_to_announce)
+{
+    LOCK(cs);
+    return m_impl->HandleReconciliationDiff(peer, success, ask_shortids, txs_to_announce);
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_TXRECONCILIATION_H
+#define PIVX_TXRECONCILIATION_H
+
+#include "net.h" // for NodeId
+#include "optional.h"
+#include "serialize.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+/** Default for -txreconciliation */
+static const bool DEFAULT_TXRECONCILIATION_ENABLE = false;
+/** Version of the reconciliation protocol, sent in sendtxrcncl */
+static const uint32_t TXRECONCILIATION_VERSION = 1;
+/** Interval between two reconciliations initiated with a peer */
+static constexpr std::chrono::seconds RECON_REQUEST_INTERVAL{8};
+/** Margin of the responder on the interval, for the latency variations of the requests */
+static constexpr std::chrono::seconds RECON_REQUEST_TOLERANCE{2};
+/** Time the initiator waits for the sketch before disconnecting the peer */
+static constexpr std::chrono::seconds RECON_RESPONSE_TIMEOUT{60};
+/** Maximum number of transactions waiting in the set of a peer. The next ones are announced with inv. */
+static const size_t MAX_RECON_SET_SIZE = 3000;
+/** Maximum number of cells of a sketch */
+static const size_t MAX_SKETCH_CELLS = 3 * MAX_RECON_SET_SIZE;
+/** Fixed point precision of q, in [0, 2), in reqrecon */
+static const uint16_t Q_PRECISION = (2 << 14) - 1;
+/** Initial q: the expected difference of two sets, in proportion of the smallest one */
+static const double RECON_Q_DEFAULT = 0.25;
+
+/**
+ * Invertible bloom lookup table of 32 bits short ids. Each id is added to one cell of each
+ * third of the table. The sketches of two sets with the same number of cells subtract to
+ * the one of their symmetric difference, that decodes when it is small enough for the table.
+ */
+class ReconSketch
+{
+public:
+    struct Cell {
+        int16_t count{0};
+        uint32_t keys{0};
+        uint32_t checks{0};
+
+        SERIALIZE_METHODS(Cell, obj) { READWRITE(obj.count, obj.keys, obj.checks); }
+    };
+
+    ReconSketch() = default;
+    // The number of cells is rounded up to a multiple of 3
+    explicit ReconSketch(size_t nCells) : cells((nCells + 2) / 3 * 3) {}
+
+    void Add(uint32_t id);
+    // Both sketches must have the same size
+    ReconSketch& operator-=(const ReconSketch& other);
+    // Lists the ids added to this sketch only, and those to the subtracted one only
+    bool Decode(std::vector<uint32_t>& added, std::vector<uint32_t>& removed) const;
+
+    size_t Size() const { return cells.size(); }
+    // Number of cells fitting a difference of nDiff ids
+    static size_t CellsForDiff(size_t nDiff);
+
+    SERIALIZE_METHODS(ReconSketch, obj) { READWRITE(obj.cells); }
+
+private:
+    std::vector<Cell> cells;
+};
+
+/**
+ * Announces the transactions to the peers supporting it by reconciling the sets of transactions
+ * each side would have announced to the other, instead of an inv per transaction, so that the
+ * cost of an announcement does not grow with the number of peers that have the transaction already.
+ *
+ * The peers negotiate it with sendtxrcncl, before verack. The side that opened the connection
+ * (the initiator) sends reqrecon every RECON_REQUEST_INTERVAL with the size of its set and q.
+ * The responder answers with a sketch of its set, sized after the estimated difference, and keeps
+ * a snapshot of it. The initiator subtracts the sketch of its own set, announces with inv what the
+ * responder lacks and asks in reconcildiff for what it lacks. When the difference doesn't decode,
+ * both sides announce their whole set.
+ * The tracker is thread safe.
+ */
+class TxReconciliationTracker
+{
+    class Impl;
+    mutable Mutex cs;
+    const std::unique_ptr<Impl> m_impl GUARDED_BY(cs);
+
+public:
+    TxReconciliationTracker();
+    ~TxReconciliationTracker();
+
+    // Returns the salt to send in sendtxrcncl
+    uint64_t PreRegisterPeer(NodeId peer);
+    // For testing only: pre-registers the peer with the given local salt
+    void PreRegisterPeer(NodeId peer, uint64_t local_salt);
+    // Enables the reconciliation with a pre-registered peer, on its sendtxrcncl. False if not applicable.
+    bool RegisterPeer(NodeId peer, bool is_initiator, uint32_t peer_version, uint64_t peer_salt);
+    void ForgetPeer(NodeId peer);
+    bool IsPeerRegistered(NodeId peer) const;
+
+    // Adds a transaction to announce to the peer. False if it must be announced with inv.
+    bool AddToSet(NodeId peer, const uint256& txid);
+    // The peer has the transaction already
+    void TryRemovingFromSet(NodeId peer, const uint256& txid);
+    size_t GetSetSize(NodeId peer) const;
+
+    // Initiator: returns the set size and q to send in reqrecon, when a reconciliation is due
+    Optional<std::pair<uint16_t, uint16_t>> InitiateReconciliationRequest(NodeId peer, std::chrono::microseconds now);
+    // Initiator: whether the sketch of the last request is overdue
+    bool HasReconciliationTimedOut(NodeId peer, std::chrono::microseconds now) const;
+    // Responder: sketches the set, kept as a snapshot until the reconcildiff. False on a protocol violation,
+    // including a request sooner than RECON_REQUEST_INTERVAL after the previous one.
+    bool HandleReconciliationRequest(NodeId peer, std::chrono::microseconds now, uint16_t peer_set_size, uint16_t peer_q,
+                                     ReconSketch& sketch);
+    // Initiator: returns the transactions to announce and the short ids to ask in reconcildiff.
+    // False on a protocol violation.
+    bool HandleSketch(NodeId peer, const ReconSketch& sketch, std::vector<uint256>& txs_to_announce,
+                      std::vector<uint32_t>& ask_shortids, bool& success);
+    // Responder: returns the transactions to announce. False on a protocol violation.
+    bool HandleReconciliationDiff(NodeId peer, bool success, const std::vector<uint32_t>& ask_shortids,
+                                  std::vector<uint256>& txs_to_announce);
+};
+
+#endif // PIVX_TXRECONCILIATION_H
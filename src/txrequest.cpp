@@ -0,0 +1,461 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txrequest.h"
+
+#include "crypto/siphash.h"
+#include "random.h"
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <cassert>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+
+/** The states of an announcement, in the order of the ByInv index */
+enum class State : uint8_t {
+    // Waiting for its request time
+    CANDIDATE_DELAYED,
+    // Can be requested, but another announcement of the inv is the best one or is requested
+    CANDIDATE_READY,
+    // The best candidate of the inv, and none is requested: it is the one to request
+    CANDIDATE_BEST,
+    // Requested, waiting for an answer until its expiry
+    REQUESTED,
+    // Answered, notfound or expired. Kept until the inv is forgotten, so the peer isn't asked again.
+    COMPLETED,
+};
+
+using SequenceNumber = uint64_t;
+using Priority = uint64_t;
+
+struct Announcement {
+    const CInv m_inv;
+    // The request time for CANDIDATE_DELAYED, the expiry for REQUESTED
+    std::chrono::microseconds m_time;
+    const NodeId m_peer;
+    // Announcement order, used to return the requestable invs in the order they were announced
+    const SequenceNumber m_sequence;
+    const bool m_preferred;
+    State m_state{State::CANDIDATE_DELAYED};
+
+    Announcement(const CInv& inv, NodeId peer, bool preferred, std::chrono::microseconds reqtime, SequenceNumber sequence) :
+        m_inv(inv), m_time(reqtime), m_peer(peer), m_sequence(sequence), m_preferred(preferred) {}
+
+    bool IsWaiting() const { return m_state == State::CANDIDATE_DELAYED || m_state == State::REQUESTED; }
+    bool IsSelected() const { return m_state == State::CANDIDATE_BEST || m_state == State::REQUESTED; }
+};
+
+/** The random order of the candidates, fixed per (inv, peer). The preferred ones come first. */
+class PriorityComputer
+{
+    const uint64_t m_k0, m_k1;
+
+public:
+    explicit PriorityComputer(bool deterministic) :
+        m_k0{deterministic ? 0 : GetRand(std::numeric_limits<uint64_t>::max())},
+        m_k1{deterministic ? 0 : GetRand(std::numeric_limits<uint64_t>::max())} {}
+
+    Priority operator()(const CInv& inv, NodeId peer, bool preferred) const
+    {
+        uint64_t low_bits = CSipHasher(m_k0, m_k1).Write(inv.hash.begin(), inv.hash.size()).Write(inv.type).Write(peer).Finalize() >> 1;
+        return low_bits | uint64_t{preferred} << 63;
+    }
+
+    Priority operator()(const Announcement& ann) const { return operator()(ann.m_inv, ann.m_peer, ann.m_preferred); }
+};
+
+// ByPeer: (peer, state == CANDIDATE_BEST, inv). Unique, finds the invs to request from a peer.
+using ByPeerView = std::tuple<NodeId, bool, const CInv&>;
+struct ByPeerViewExtractor
+{
+    using result_type = ByPeerView;
+    result_type operator()(const Announcement& ann) const
+    {
+        return ByPeerView{ann.m_peer, ann.m_state == State::CANDIDATE_BEST, ann.m_inv};
+    }
+};
+
+// ByInv: (inv, state, priority of the CANDIDATE_READY). The best CANDIDATE_READY of an inv is
+// right before its CANDIDATE_BEST or REQUESTED announcement, if there is one.
+using ByInvView = std::tuple<const CInv&, State, Priority>;
+class ByInvViewExtractor
+{
+    const PriorityComputer& m_computer;
+
+public:
+    explicit ByInvViewExtractor(const PriorityComputer& computer) : m_computer(computer) {}
+    using result_type = ByInvView;
+    result_type operator()(const Announcement& ann) const
+    {
+        const Priority prio = (ann.m_state == State::CANDIDATE_READY) ? m_computer(ann) : 0;
+        return ByInvView{ann.m_inv, ann.m_state, prio};
+    }
+};
+
+// ByTime: (not waiting, time). The CANDIDATE_DELAYED and REQUESTED announcements first, the next one due on top.
+using ByTimeView = std::pair<bool, std::chrono::microseconds>;
+struct ByTimeViewExtractor
+{
+    using result_type = ByTimeView;
+    result_type operator()(const Announcement& ann) const
+    {
+        return ann.IsWaiting() ? ByTimeView{false, ann.m_time} : ByTimeView{true, std::chrono::microseconds::zero()};
+    }
+};
+
+struct ByPeer {};
+struct ByInv {};
+struct ByTime {};
+
+using Index = boost::multi_index_container<
+    Announcement,
+    boost::multi_index::indexed_by<
+        boost::multi_index::ordered_unique<boost::multi_index::tag<ByPeer>, ByPeerViewExtractor>,
+        boost::multi_index::ordered_non_unique<boost::multi_index::tag<ByInv>, ByInvViewExtractor>,
+        boost::multi_index::ordered_non_unique<boost::multi_index::tag<ByTime>, ByTimeViewExtractor>
+    >
+>;
+
+template<typename Tag>
+using Iter = typename Index::index<Tag>::type::iterator;
+
+struct PeerInfo {
+    size_t m_total = 0;
+    size_t m_completed = 0;
+    size_t m_requested = 0;
+};
+
+} // namespace
+
+class TxRequestTracker::Impl
+{
+    SequenceNumber m_current_sequence{0};
+    const PriorityComputer m_computer;
+    Index m_index;
+    std::unordered_map<NodeId, PeerInfo> m_peerinfo;
+
+    // Modifies an announcement, keeping the counters of its peer up to date
+    template<typename Tag, typename Modifier>
+    void Modify(Iter<Tag> it, Modifier modifier)
+    {
+        auto peerit = m_peerinfo.find(it->m_peer);
+        peerit->second.m_completed -= it->m_state == State::COMPLETED;
+        peerit->second.m_requested -= it->m_state == State::REQUESTED;
+        m_index.get<Tag>().modify(it, std::move(modifier));
+        peerit->second.m_completed += it->m_state == State::COMPLETED;
+        peerit->second.m_requested += it->m_state == State::REQUESTED;
+    }
+
+    template<typename Tag>
+    Iter<Tag> Erase(Iter<Tag> it)
+    {
+        auto peerit = m_peerinfo.find(it->m_peer);
+        peerit->second.m_completed -= it->m_state == State::COMPLETED;
+        peerit->second.m_requested -= it->m_state == State::REQUESTED;
+        if (--peerit->second.m_total == 0) m_peerinfo.erase(peerit);
+        return m_index.get<Tag>().erase(it);
+    }
+
+    static void SetState(Announcement& ann, State state) { ann.m_state = state; }
+
+    // Turns a CANDIDATE_DELAYED into a CANDIDATE_READY, or the CANDIDATE_BEST if it is better than the current one
+    void PromoteCandidateReady(Iter<ByInv> it)
+    {
+        assert(it->m_state == State::CANDIDATE_DELAYED);
+        Modify<ByInv>(it, [](Announcement& ann) { SetState(ann, State::CANDIDATE_READY); });
+        // If it is the best CANDIDATE_READY, the selected announcement of the inv, if any, follows it
+        auto it_next = std::next(it);
+        if (it_next == m_index.get<ByInv>().end() || it_next->m_inv != it->m_inv || it_next->m_state == State::COMPLETED) {
+            // Nothing selected yet
+            Modify<ByInv>(it, [](Announcement& ann) { SetState(ann, State::CANDIDATE_BEST); });
+        } else if (it_next->m_state == State::CANDIDATE_BEST && m_computer(*it) > m_computer(*it_next)) {
+            Modify<ByInv>(it_next, [](Announcement& ann) { SetState(ann, State::CANDIDATE_READY); });
+            Modify<ByInv>(it, [](Announcement& ann) { SetState(ann, State::CANDIDATE_BEST); });
+        }
+    }
+
+    // Completes an announcement, selecting the next best candidate if it was the selected one
+    void ChangeAndReselect(Iter<ByInv> it)
+    {
+        if (it->IsSelected() && it != m_index.get<ByInv>().begin()) {
+            auto it_prev = std::prev(it);
+            if (it_prev->m_inv == it->m_inv && it_prev->m_state == State::CANDIDATE_READY) {
+                Modify<ByInv>(it_prev, [](Announcement& ann) { SetState(ann, State::CANDIDATE_BEST); });
+            }
+        }
+        Modify<ByInv>(it, [](Announcement& ann) { SetState(ann, State::COMPLETED); });
+    }
+
+    // Whether all the other announcements of the inv are completed. it must not be completed.
+    bool IsOnlyNonCompleted(Iter<ByInv> it)
+    {
+        assert(it->m_state != State::COMPLETED);
+        // The completed ones come last
+        if (it != m_index.get<ByInv>().begin() && std::prev(it)->m_inv == it->m_inv) return false;
+        auto it_next = std::next(it);
+        return it_next == m_index.get<ByInv>().end() || it_next->m_inv != it->m_inv || it_next->m_state == State::COMPLETED;
+    }
+
+    // Completes an announcement. Returns false if that deleted all the announcements of the inv, it included.
+    bool MakeCompleted(Iter<ByInv> it)
+    {
+        if (it->m_state == State::COMPLETED) return true;
+        if (IsOnlyNonCompleted(it)) {
+            const CInv inv = it->m_inv;
+            do {
+                it = Erase<ByInv>(it);
+            } while (it != m_index.get<ByInv>().end() && it->m_inv == inv);
+            return false;
+        }
+        ChangeAndReselect(it);
+        return true;
+    }
+
+    // Promotes the candidates due, and completes the requests expired, at now
+    void SetTimePoint(std::chrono::microseconds now, std::vector<std::pair<NodeId, CInv>>* expired)
+    {
+        while (!m_index.empty()) {
+            auto it = m_index.get<ByTime>().begin();
+            if (!it->IsWaiting() || it->m_time > now) break;
+            if (it->m_state == State::CANDIDATE_DELAYED) {
+                PromoteCandidateReady(m_index.project<ByInv>(it));
+            } else {
+                if (expired) expired->emplace_back(it->m_peer, it->m_inv);
+                MakeCompleted(m_index.project<ByInv>(it));
+            }
+        }
+    }
+
+public:
+    explicit Impl(bool deterministic) :
+        m_computer(deterministic),
+        m_index(boost::make_tuple(
+            boost::make_tuple(ByPeerViewExtractor(), std::less<ByPeerView>()),
+            boost::make_tuple(ByInvViewExtractor(m_computer), std::less<ByInvView>()),
+            boost::make_tuple(ByTimeViewExtractor(), std::less<ByTimeView>())
+        )) {}
+
+    void ReceivedInv(NodeId peer, const CInv& inv, bool preferred, std::chrono::microseconds reqtime)
+    {
+        // The CANDIDATE_BEST announcements have a different ByPeer key, the others fail the emplace
+        if (m_index.get<ByPeer>().count(ByPeerView{peer, true, inv})) return;
+        auto ret = m_index.get<ByPeer>().emplace(inv, peer, preferred, reqtime, m_current_sequence);
+        if (!ret.second) return;
+        ++m_peerinfo[peer].m_total;
+        ++m_current_sequence;
+    }
+
+    void DisconnectedPeer(NodeId peer)
+    {
+        static const CInv INV_MIN;
+        auto& index = m_index.get<ByPeer>();
+        auto it = index.lower_bound(ByPeerView{peer, false, INV_MIN});
+        while (it != index.end() && it->m_peer == peer) {
+            // MakeCompleted may move it (CANDIDATE_BEST to COMPLETED) or delete the other announcements of
+            // its inv, which belong to other peers: pick the next one of the peer before.
+            auto it_next = std::next(it);
+            if (it_next != index.end() && it_next->m_peer != peer) it_next = index.end();
+            if (MakeCompleted(m_index.project<ByInv>(it))) {
+                Erase<ByPeer>(it);
+            }
+            it = it_next;
+        }
+    }
+
+    void ForgetInv(const CInv& inv)
+    {
+        auto it = m_index.get<ByInv>().lower_bound(ByInvView{inv, State::CANDIDATE_DELAYED, 0});
+        while (it != m_index.get<ByInv>().end() && it->m_inv == inv) {
+            it = Erase<ByInv>(it);
+        }
+    }
+
+    std::vector<CInv> GetRequestable(NodeId peer, std::chrono::microseconds now, std::vector<std::pair<NodeId, CInv>>* expired)
+    {
+        static const CInv INV_MIN;
+        SetTimePoint(now, expired);
+
+        std::map<SequenceNumber, CInv> selected;
+        auto it = m_index.get<ByPeer>().lower_bound(ByPeerView{peer, true, INV_MIN});
+        while (it != m_index.get<ByPeer>().end() && it->m_peer == peer && it->m_state == State::CANDIDATE_BEST) {
+            selected.emplace(it->m_sequence, it->m_inv);
+            ++it;
+        }
+
+        std::vector<CInv> ret;
+        ret.reserve(selected.size());
+        for (const auto& p : selected) {
+            ret.emplace_back(p.second);
+        }
+        return ret;
+    }
+
+    void RequestedTx(NodeId peer, const CInv& inv, std::chrono::microseconds expiry)
+    {
+        // Only the CANDIDATE_BEST, returned by GetRequestable, can be requested
+        auto it = m_index.get<ByPeer>().find(ByPeerView{peer, true, inv});
+        if (it == m_index.get<ByPeer>().end()) return;
+        Modify<ByPeer>(it, [expiry](Announcement& ann) {
+            SetState(ann, State::REQUESTED);
+            ann.m_time = expiry;
+        });
+    }
+
+    void ReceivedResponse(NodeId peer, const CInv& inv)
+    {
+        auto it = m_index.get<ByPeer>().find(ByPeerView{peer, false, inv});
+        if (it == m_index.get<ByPeer>().end()) {
+            it = m_index.get<ByPeer>().find(ByPeerView{peer, true, inv});
+        }
+        if (it != m_index.get<ByPeer>().end()) MakeCompleted(m_index.project<ByInv>(it));
+    }
+
+    size_t CountInFlight(NodeId peer) const
+    {
+        auto it = m_peerinfo.find(peer);
+        return it != m_peerinfo.end() ? it->second.m_requested : 0;
+    }
+
+    size_t CountCandidates(NodeId peer) const
+    {
+        auto it = m_peerinfo.find(peer);
+        return it != m_peerinfo.end() ? it->second.m_total - it->second.m_requested - it->second.m_completed : 0;
+    }
+
+    size_t Count(NodeId peer) const
+    {
+        auto it = m_peerinfo.find(peer);
+        return it != m_peerinfo.end() ? it->second.m_total : 0;
+    }
+
+    size_t Size() const { return m_index.size(); }
+
+    void SanityCheck() const
+    {
+        // The peer counters match the index
+        std::unordered_map<NodeId, PeerInfo> peerinfo;
+        for (const Announcement& ann : m_index) {
+            PeerInfo& info = peerinfo[ann.m_peer];
+            ++info.m_total;
+            info.m_completed += ann.m_state == State::COMPLETED;
+            info.m_requested += ann.m_state == State::REQUESTED;
+        }
+        assert(peerinfo.size() == m_peerinfo.size());
+        for (const auto& p : peerinfo) {
+            auto it = m_peerinfo.find(p.first);
+            assert(it != m_peerinfo.end());
+            assert(it->second.m_total == p.second.m_total);
+            assert(it->second.m_completed == p.second.m_completed);
+            assert(it->second.m_requested == p.second.m_requested);
+        }
+
+        // Per inv: at most one selected, the best candidate when nothing is requested, never only completed ones
+        auto& index = m_index.get<ByInv>();
+        for (auto it = index.begin(); it != index.end();) {
+            const CInv inv = it->m_inv;
+            size_t candidates_ready = 0, selected = 0, completed = 0, total = 0;
+            Priority best_ready = 0;
+            bool has_best = false;
+            Priority priority_best = 0;
+            for (; it != index.end() && it->m_inv == inv; ++it) {
+                ++total;
+                if (it->m_state == State::CANDIDATE_READY) {
+                    ++candidates_ready;
+                    best_ready = std::max(best_ready, m_computer(*it));
+                } else if (it->IsSelected()) {
+                    ++selected;
+                    if (it->m_state == State::CANDIDATE_BEST) {
+                        has_best = true;
+                        priority_best = m_computer(*it);
+                    }
+                } else if (it->m_state == State::COMPLETED) {
+                    ++completed;
+                }
+            }
+            assert(selected <= 1);
+            assert(completed < total);
+            if (candidates_ready > 0) assert(selected == 1);
+            if (has_best && candidates_ready > 0) assert(priority_best > best_ready);
+        }
+    }
+};
+
+TxRequestTracker::TxRequestTracker(bool deterministic) :
+    m_impl(std::make_unique<TxRequestTracker::Impl>(deterministic)) {}
+
+TxRequestTracker::~TxRequestTracker() = default;
+
+void TxRequestTracker::ReceivedInv(NodeId peer, const CInv& inv, bool preferred, std::chrono::microseconds reqtime)
+{
+    LOCK(cs);
+    m_impl->ReceivedInv(peer, inv, preferred, reqtime);
+}
+
+void TxRequestTracker::DisconnectedPeer(NodeId peer)
+{
+    LOCK(cs);
+    m_impl->DisconnectedPeer(peer);
+}
+
+void TxRequestTracker::ForgetInv(const CInv& inv)
+{
+    LOCK(cs);
+    m_impl->ForgetInv(inv);
+}
+
+std::vector<CInv> TxRequestTracker::GetRequestable(NodeId peer, std::chrono::microseconds now,
+                                                   std::vector<std::pair<NodeId, CInv>>* expired)
+{
+    LOCK(cs);
+    return m_impl->GetRequestable(peer, now, expired);
+}
+
+void TxRequestTracker::RequestedTx(NodeId peer, const CInv& inv, std::chrono::microseconds expiry)
+{
+    LOCK(cs);
+    m_impl->RequestedTx(peer, inv, expiry);
+}
+
+void TxRequestTracker::ReceivedResponse(NodeId peer, const CInv& inv)
+{
+    LOCK(cs);
+    m_impl->ReceivedResponse(peer, inv);
+}
+
+size_t TxRequestTracker::CountInFlight(NodeId peer) const
+{
+    LOCK(cs);
+    return m_impl->CountInFlight(peer);
+}
+
+size_t TxRequestTracker::CountCandidates(NodeId peer) const
+{
+    LOCK(cs);
+    return m_impl->CountCandidates(peer);
+}
+
+size_t TxRequestTracker::Count(NodeId peer) const
+{
+    LOCK(cs);
+    return m_impl->Count(peer);
+}
+
+size_t TxRequestTracker::Size() const
+{
+    LOCK(cs);
+    return m_impl->Size();
+}
+
+void TxRequestTracker::SanityCheck() const
+{
+    LOCK(cs);
+    m_impl->SanityCheck();
+}
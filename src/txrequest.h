@@ -0,0 +1,74 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_TXREQUEST_H
+#define PIVX_TXREQUEST_H
+
+#include "net.h" // for NodeId
+#include "protocol.h"
+#include "sync.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+/**
+ * Schedules the getdata requests of the items announced by the peers: transactions and
+ * tier two objects (masternode, budget and LLMQ items), one (peer, inv) announcement at a time.
+ *
+ * An announcement is a candidate from its request time on. For every inv:
+ * - At most one announcement is requested at a time. The peer is picked among the candidates:
+ *   the preferred ones first, then in a random order fixed per (peer, inv).
+ * - When the request expires, or the peer answers without the item (notfound), the announcement
+ *   is completed and the next candidate is picked. A completed peer is never asked again.
+ * - ForgetInv drops every announcement of the inv, once it is received or not needed anymore.
+ *   Same when all of them are completed.
+ *
+ * All the operations are O(log n) in the number of announcements, apart from GetRequestable
+ * and DisconnectedPeer which are linear in the number of announcements of the peer.
+ * The time is assumed to never go back: the announcements due are not delayed again.
+ * The tracker is thread safe.
+ */
+class TxRequestTracker
+{
+    class Impl;
+    mutable Mutex cs;
+    const std::unique_ptr<Impl> m_impl GUARDED_BY(cs);
+
+public:
+    // deterministic makes the candidate selection order the same across runs, for the tests
+    explicit TxRequestTracker(bool deterministic = false);
+    ~TxRequestTracker();
+
+    // Adds an announcement, requestable from reqtime on. Ignored if the peer already announced the inv.
+    void ReceivedInv(NodeId peer, const CInv& inv, bool preferred, std::chrono::microseconds reqtime);
+    // Deletes all the announcements of the peer
+    void DisconnectedPeer(NodeId peer);
+    // Deletes all the announcements of the inv
+    void ForgetInv(const CInv& inv);
+    /**
+     * Returns the invs to request from the peer at now, in the order they were announced.
+     * The requests that expired until now are completed, and appended to expired.
+     */
+    std::vector<CInv> GetRequestable(NodeId peer, std::chrono::microseconds now,
+                                     std::vector<std::pair<NodeId, CInv>>* expired = nullptr);
+    // Marks an inv returned by GetRequestable as requested from the peer, until expiry
+    void RequestedTx(NodeId peer, const CInv& inv, std::chrono::microseconds expiry);
+    // The peer answered with the inv, or a notfound for it
+    void ReceivedResponse(NodeId peer, const CInv& inv);
+
+    // Number of requested announcements of the peer, not answered nor expired yet
+    size_t CountInFlight(NodeId peer) const;
+    // Number of announcements of the peer that can still be requested
+    size_t CountCandidates(NodeId peer) const;
+    // Number of announcements of the peer, including the completed ones
+    size_t Count(NodeId peer) const;
+    size_t Size() const;
+
+    // Checks the internal consistency, asserting on failure. Test only, this is O(n).
+    void SanityCheck() const;
+};
+
+#endif // PIVX_TXREQUEST_H
@@ -30,7 +30,7 @@ struct TxInUndoFormatter
             // Required to maintain compatibility with older undo format.
             ::Serialize(s, (unsigned char)0);
         }
-        ::Serialize(s, Using<TxOutCompression>(txout.out));
+        ::Serialize(s, Using<TxOutCompression>(txout.GetTxOut()));
     }
 
     template<typename Stream>
@@ -47,7 +47,9 @@ struct TxInUndoFormatter
             unsigned int nVersionDummy;
             ::Unserialize(s, VARINT(nVersionDummy));
         }
-        ::Unserialize(s, Using<TxOutCompression>(txout.out));
+        CTxOut out;
+        ::Unserialize(s, Using<TxOutCompression>(out));
+        txout.SetTxOut(out);
     }
 };
 
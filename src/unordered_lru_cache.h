@@ -6,6 +6,8 @@
 #ifndef PIVX_UNORDERED_LRU_CACHE_H
 #define PIVX_UNORDERED_LRU_CACHE_H
 
+#include "memusage.h"
+
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
@@ -32,6 +34,9 @@ public:
     }
 
     size_t max_size() const { return maxSize; }
+    size_t size() const { return cacheMap.size(); }
+    // Memory used by the entries, not counting the storage owned by the values
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(cacheMap); }
 
     template<typename Value2>
     void _emplace(const Key& key, Value2&& v)
@@ -56,6 +61,12 @@ public:
         _emplace(key, v);
     }
 
+    // Whether the key is cached, without marking it as used
+    bool contains(const Key& key) const
+    {
+        return cacheMap.count(key) != 0;
+    }
+
     bool get(const Key& key, Value& value)
     {
         auto it = cacheMap.find(key);
@@ -82,6 +93,15 @@ public:
         cacheMap.erase(key);
     }
 
+    // Drop the least recently used entry
+    void erase_lru()
+    {
+        auto lru = std::min_element(cacheMap.begin(), cacheMap.end(), [](const typename MapType::value_type& a, const typename MapType::value_type& b) {
+            return a.second.second < b.second.second;
+        });
+        if (lru != cacheMap.end()) cacheMap.erase(lru);
+    }
+
     void clear()
     {
         cacheMap.clear();
@@ -20,6 +20,7 @@
 #include <librustzcash.h>
 
 #include <stdarg.h>
+#include <sstream>
 #include <thread>
 
 #ifndef WIN32
@@ -621,7 +622,7 @@ const fs::path &ZC_GetParamsDir()
     return path;
 }
 
-void initZKSNARKS()
+void initZKSNARKS(bool fLazyProvingParams)
 {
     const fs::path& path = ZC_GetParamsDir();
     fs::path sapling_spend = path / "sapling-spend.params";
@@ -687,7 +688,8 @@ void initZKSNARKS()
         "657e3d38dbb5cb5e7dd2970e8b03d69b4787dd907285b5a7f0790dcc8072f60bf593b32cc2d1c030e00ff5ae64bf84c5c3beb84ddc841d48264b4a171744d028",
         nullptr,    // sprout_path
         0,          // sprout_path_len
-        ""          // sprout_hash
+        "",         // sprout_hash
+        fLazyProvingParams
     );
 
     //std::cout << "### Sapling params initialized ###" << std::endl;
@@ -1112,6 +1114,54 @@ int ScheduleBatchPriority(void)
 #endif
 }
 
+// The maximum CPU index of a cpu_set_t (CPU_SETSIZE of glibc)
+static const int MAX_AFFINITY_CPU = 1023;
+
+static std::mutex cs_validation_cpus;
+static std::vector<int> g_validation_cpus;
+
+bool SetValidationThreadsCpus(const std::string& strCpus)
+{
+    std::vector<int> vCpus;
+    if (!strCpus.empty()) {
+        std::istringstream ss(strCpus);
+        std::string strRange;
+        while (std::getline(ss, strRange, ',')) {
+            const size_t nDash = strRange.find('-');
+            int nFirst, nLast;
+            if (!ParseInt32(strRange.substr(0, nDash), &nFirst) ||
+                    !ParseInt32(nDash == std::string::npos ? strRange : strRange.substr(nDash + 1), &nLast) ||
+                    nFirst < 0 || nLast < nFirst || nLast > MAX_AFFINITY_CPU) {
+                return false;
+            }
+            for (int i = nFirst; i <= nLast; i++) vCpus.emplace_back(i);
+        }
+    }
+    std::lock_guard<std::mutex> lock(cs_validation_cpus);
+    g_validation_cpus = std::move(vCpus);
+    return true;
+}
+
+void ApplyValidationThreadAffinity()
+{
+    std::vector<int> vCpus;
+    {
+        std::lock_guard<std::mutex> lock(cs_validation_cpus);
+        vCpus = g_validation_cpus;
+    }
+    if (vCpus.empty()) return;
+#if defined(__linux__) && defined(CPU_SET)
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (int cpu : vCpus) {
+        CPU_SET(cpu, &cpuset);
+    }
+    if (int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) {
+        LogPrintf("Failed to pthread_setaffinity_np: %s\n", strerror(ret));
+    }
+#endif
+}
+
 namespace util {
 #ifdef WIN32
     WinCmdLineArgs::WinCmdLineArgs()
@@ -104,8 +104,9 @@ const fs::path &GetDataDir(bool fNetSpecific = true);
 bool CheckDataDirOption();
 // Sapling network dir
 const fs::path &ZC_GetParamsDir();
-// Init sapling library
-void initZKSNARKS();
+// Init sapling library. With fLazyProvingParams, only the verifying keys are loaded
+// and the proving parameters are read when the first shielded transaction is created.
+void initZKSNARKS(bool fLazyProvingParams = false);
 void ClearDatadirCache();
 fs::path GetConfigFile(const std::string& confPath);
 fs::path GetMasternodeConfigFile();
@@ -298,6 +299,22 @@ fs::path AbsPathForConfigVal(const fs::path& path, bool net_specific = true);
  */
 int ScheduleBatchPriority(void);
 
+/**
+ * Set the CPUs the validation threads (script check, BLS workers, HTTP workers, message handler
+ * and block import) are restricted to, from a list like "0-7,16-23" (empty for no restriction).
+ * With the CPUs of a NUMA node, the threads stay on it, along with the memory they touch first
+ * (e.g. the coins cache, filled by the threads connecting the blocks).
+ *
+ * @return false if the list is invalid
+ */
+bool SetValidationThreadsCpus(const std::string& strCpus);
+
+/**
+ * On platforms that support it, restrict the calling thread to the CPUs set by
+ * SetValidationThreadsCpus. See sched_setaffinity(2) for details.
+ */
+void ApplyValidationThreadAffinity();
+
 namespace util {
 
 #ifdef WIN32
@@ -70,21 +70,32 @@ void util::ThreadSetInternalName(std::string&& name)
     SetInternalName(std::move(name));
 }
 
-void RenameThreadPool(ctpl::thread_pool& tp, const char* baseName)
+void RunOnEachPoolThread(ctpl::thread_pool& tp, const std::function<void(int)>& func)
 {
+    // each job waits for all the others to start, so that every thread of the pool runs one
     auto cond = std::make_shared<std::condition_variable>();
     auto mutex = std::make_shared<std::mutex>();
+    auto fDone = std::make_shared<bool>(false);
     std::atomic<int> doneCnt(0);
     for (int i = 0; i < tp.size(); i++) {
-        tp.push([baseName, i, cond, mutex, &doneCnt](int threadId) {
-            util::ThreadRename(strprintf("%s-%d", baseName, i).c_str());
+        tp.push([&func, i, cond, mutex, fDone, &doneCnt](int threadId) {
+            func(i);
             doneCnt++;
             std::unique_lock<std::mutex> l(*mutex);
-            cond->wait(l);
+            cond->wait(l, [&fDone] { return *fDone; });
         });
     }
     while (doneCnt != tp.size()) {
         MilliSleep(10);
     }
+    {
+        std::unique_lock<std::mutex> l(*mutex);
+        *fDone = true;
+    }
     cond->notify_all();
 }
+
+void RenameThreadPool(ctpl::thread_pool& tp, const char* baseName)
+{
+    RunOnEachPoolThread(tp, [baseName](int i) { util::ThreadRename(strprintf("%s-%d", baseName, i).c_str()); });
+}
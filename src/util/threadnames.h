@@ -5,6 +5,7 @@
 #ifndef BITCOIN_UTIL_THREADNAMES_H
 #define BITCOIN_UTIL_THREADNAMES_H
 
+#include <functional>
 #include <string>
 
 namespace util {
@@ -26,6 +27,8 @@ const std::string& ThreadGetInternalName();
 namespace ctpl {
     class thread_pool;
 }
+//! Run func on each thread of the pool, with the index of the thread, and wait for them.
+void RunOnEachPoolThread(ctpl::thread_pool& tp, const std::function<void(int)>& func);
 void RenameThreadPool(ctpl::thread_pool& tp, const char* baseName);
 
 #endif // BITCOIN_UTIL_THREADNAMES_H
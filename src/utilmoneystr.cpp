@@ -11,14 +11,32 @@
 #include "utilstrencodings.h"
 
 
-std::string FormatMoney(const CAmount& n, bool fPlus)
+std::string FormatMoneyFixed(const CAmount& n)
 {
     // Note: not using straight sprintf here because we do NOT want
-    // localized number formatting.
-    int64_t n_abs = (n > 0 ? n : -n);
-    int64_t quotient = n_abs / COIN;
-    int64_t remainder = n_abs % COIN;
-    std::string str = strprintf("%d.%08d", quotient, remainder);
+    // localized number formatting. The digits are written from the last one,
+    // as this is called for every amount of the large RPC replies.
+    static_assert(COIN == 100000000, "8 decimals");
+    uint64_t n_abs = (n < 0 ? 0 - (uint64_t)n : (uint64_t)n);
+    char buf[32];
+    char* const end = buf + sizeof(buf);
+    char* p = end;
+    for (int i = 0; i < 8; i++) {
+        *--p = '0' + n_abs % 10;
+        n_abs /= 10;
+    }
+    *--p = '.';
+    do {
+        *--p = '0' + n_abs % 10;
+        n_abs /= 10;
+    } while (n_abs > 0);
+    if (n < 0) *--p = '-';
+    return std::string(p, end);
+}
+
+std::string FormatMoney(const CAmount& n, bool fPlus)
+{
+    std::string str = FormatMoneyFixed(n);
 
     // Right-trim excess zeros before the decimal point:
     int nTrim = 0;
@@ -27,9 +45,7 @@ std::string FormatMoney(const CAmount& n, bool fPlus)
     if (nTrim)
         str.erase(str.size() - nTrim, nTrim);
 
-    if (n < 0)
-        str.insert((unsigned int)0, 1, '-');
-    else if (fPlus && n > 0)
+    if (fPlus && n > 0)
         str.insert((unsigned int)0, 1, '+');
     return str;
 }
@@ -15,6 +15,8 @@
 #include "amount.h"
 
 std::string FormatMoney(const CAmount& n, bool fPlus = false);
+/** Format an amount with all its 8 decimals, e.g. "-1.00000000" */
+std::string FormatMoneyFixed(const CAmount& n);
 bool ParseMoney(const std::string& str, CAmount& nRet);
 bool ParseMoney(const char* pszIn, CAmount& nRet);
 
@@ -0,0 +1,110 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxocommitment.h"
+
+#include "coins.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util/system.h"
+#include "validation.h"
+#include "version.h"
+
+std::unique_ptr<CUTXOCommitment> pUTXOCommitment;
+
+// The element of the set for a coin: its outpoint, height and kind (as in hash_serialized_2) and output
+static CDataStream CoinElement(const COutPoint& outpoint, const Coin& coin)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << outpoint;
+    ss << (uint32_t)(coin.nHeight * 4 + (coin.fCoinBase ? 2u : 0u) + (coin.fCoinStake ? 1u : 0u));
+    ss << coin.GetTxOut();
+    return ss;
+}
+
+void CUTXOCommitment::AddCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    muhash.Insert(MakeUCharSpan(CoinElement(outpoint, coin)));
+    nTransactionOutputs++;
+    nTotalAmount += coin.nValue;
+}
+
+void CUTXOCommitment::RemoveCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    muhash.Remove(MakeUCharSpan(CoinElement(outpoint, coin)));
+    nTransactionOutputs--;
+    nTotalAmount -= coin.nValue;
+}
+
+void CUTXOCommitment::ApplyCacheChanges(const CCoinsViewCache& view, const CCoinsViewCache& base)
+{
+    // The coins replaced are read from the base: an undo may rewrite a coin without it being spent first,
+    // and the invalid outputs are never added to the set.
+    view.ForEachDirtyCoin([&](const COutPoint& outpoint, const Coin& coin, bool fFresh) {
+        if (!fFresh) {
+            const Coin& coinOld = base.AccessCoin(outpoint);
+            if (!coinOld.IsSpent()) RemoveCoin(outpoint, coinOld);
+        }
+        if (!coin.IsSpent()) AddCoin(outpoint, coin);
+    });
+    hashBlock = view.GetBestBlock();
+}
+
+bool CUTXOCommitment::Rebuild(const CCoinsView& view)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor(view.Cursor());
+    *this = CUTXOCommitment();
+    hashBlock = pcursor->GetBestBlock();
+    for (; pcursor->Valid(); pcursor->Next()) {
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            return error("%s: unable to read a coin", __func__);
+        }
+        AddCoin(key, coin);
+    }
+    return true;
+}
+
+uint256 CUTXOCommitment::GetHash() const
+{
+    // Finalize divides the numerator by the denominator, work on a copy
+    MuHash3072 muhashTmp(muhash);
+    uint256 hash;
+    muhashTmp.Finalize(hash);
+    return hash;
+}
+
+CUTXOCommitmentStats CUTXOCommitment::GetStats() const
+{
+    CUTXOCommitmentStats stats;
+    stats.hashMuHash = GetHash();
+    stats.nTransactionOutputs = nTransactionOutputs;
+    stats.nTotalAmount = nTotalAmount;
+    return stats;
+}
+
+bool LoadUTXOCommitment(CCoinsViewDB& coinsdb)
+{
+    pUTXOCommitment.reset(new CUTXOCommitment());
+    if (!coinsdb.ReadUTXOCommitment(*pUTXOCommitment) || pUTXOCommitment->hashBlock != coinsdb.GetBestBlock()) {
+        LogPrintf("Computing the UTXO set hash at block %s...\n", coinsdb.GetBestBlock().ToString());
+        if (!pUTXOCommitment->Rebuild(coinsdb) || !coinsdb.WriteUTXOCommitment(*pUTXOCommitment)) {
+            pUTXOCommitment.reset();
+            return false;
+        }
+    }
+    CUTXOCommitmentStats stats;
+    if (!pblocktree->ReadUTXOCommitmentStats(pUTXOCommitment->hashBlock, stats) &&
+        !pblocktree->WriteUTXOCommitmentStats(pUTXOCommitment->hashBlock, pUTXOCommitment->GetStats())) {
+        pUTXOCommitment.reset();
+        return error("%s: unable to write the UTXO set hash of block %s", __func__, coinsdb.GetBestBlock().ToString());
+    }
+    return true;
+}
+
+bool GetUTXOCommitmentStats(const uint256& hashBlock, CUTXOCommitmentStats& stats)
+{
+    return pblocktree && pblocktree->ReadUTXOCommitmentStats(hashBlock, stats);
+}
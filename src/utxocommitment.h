@@ -0,0 +1,89 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_UTXOCOMMITMENT_H
+#define PIVX_UTXOCOMMITMENT_H
+
+#include "amount.h"
+#include "crypto/muhash.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <memory>
+
+class CCoinsView;
+class CCoinsViewCache;
+class CCoinsViewDB;
+class COutPoint;
+class Coin;
+
+//! -utxohash default
+static const bool DEFAULT_UTXOHASH = false;
+
+/** The commitment to the UTXO set after a block, stored per block in the block tree database with -utxohash */
+class CUTXOCommitmentStats
+{
+public:
+    uint256 hashMuHash;
+    uint64_t nTransactionOutputs{0};
+    CAmount nTotalAmount{0};
+
+    SERIALIZE_METHODS(CUTXOCommitmentStats, obj) { READWRITE(obj.hashMuHash, obj.nTransactionOutputs, obj.nTotalAmount); }
+
+    bool operator==(const CUTXOCommitmentStats& other) const
+    {
+        return hashMuHash == other.hashMuHash && nTransactionOutputs == other.nTransactionOutputs && nTotalAmount == other.nTotalAmount;
+    }
+};
+
+/**
+ * Rolling MuHash3072 commitment to the UTXO set at hashBlock.
+ * The spent coins are removed from it, and the created ones added, as the blocks are connected and disconnected,
+ * so that the hash of the set is available at any time without scanning the coins database.
+ */
+class CUTXOCommitment
+{
+private:
+    MuHash3072 muhash;
+
+public:
+    uint256 hashBlock;
+    uint64_t nTransactionOutputs{0};
+    CAmount nTotalAmount{0};
+
+    void AddCoin(const COutPoint& outpoint, const Coin& coin);
+    void RemoveCoin(const COutPoint& outpoint, const Coin& coin);
+
+    /**
+     * Apply the changes of the coins of view, not flushed yet to its base, and move the commitment to the best block
+     * of view. Must be called before view.Flush().
+     */
+    void ApplyCacheChanges(const CCoinsViewCache& view, const CCoinsViewCache& base);
+
+    //! Compute the commitment from scratch, reading all the coins of view
+    bool Rebuild(const CCoinsView& view);
+
+    //! The hash of the set
+    uint256 GetHash() const;
+
+    //! The hash and the totals of the set, as stored for hashBlock
+    CUTXOCommitmentStats GetStats() const;
+
+    SERIALIZE_METHODS(CUTXOCommitment, obj) { READWRITE(obj.hashBlock, obj.muhash, obj.nTransactionOutputs, obj.nTotalAmount); }
+};
+
+/** The commitment to the coins of pcoinsTip, maintained with -utxohash (protected by cs_main) */
+extern std::unique_ptr<CUTXOCommitment> pUTXOCommitment;
+
+/**
+ * Set pUTXOCommitment from the one stored in the coins database, or rebuild it with a full scan of the coins if it is
+ * missing or at another block (written out of sync with the coins, or -utxohash disabled meanwhile).
+ * Its stats are stored for its block in pblocktree, if they are not already.
+ */
+bool LoadUTXOCommitment(CCoinsViewDB& coinsdb);
+
+/** The stats of the commitment stored for a block (connected with -utxohash), from pblocktree */
+bool GetUTXOCommitmentStats(const uint256& hashBlock, CUTXOCommitmentStats& stats);
+
+#endif // PIVX_UTXOCOMMITMENT_H
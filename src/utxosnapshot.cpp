@@ -0,0 +1,168 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxosnapshot.h"
+
+#include "evo/evodb.h"
+#include "hash.h"
+#include "streams.h"
+#include "tinyformat.h"
+#include "txdb.h"
+#include "utxocommitment.h"
+
+// Record types
+static const char SNAPSHOT_COIN = 'c';
+static const char SNAPSHOT_NULLIFIER = 'n';
+static const char SNAPSHOT_ANCHOR = 'a';
+static const char SNAPSHOT_EVO = 'e';
+static const char SNAPSHOT_END = 'x';
+
+namespace {
+
+// Writes the records to the file, and hashes them
+class SnapshotWriter
+{
+private:
+    CAutoFile& file;
+    CHashWriter hasher{SER_GETHASH, 0};
+
+public:
+    explicit SnapshotWriter(CAutoFile& fileIn, const SnapshotMetadata& metadata) : file(fileIn)
+    {
+        file << metadata;
+        hasher << metadata;
+    }
+
+    template <typename... Args>
+    void Write(char type, const Args&... args)
+    {
+        ::SerializeMany(file, type, args...);
+        ::SerializeMany(hasher, type, args...);
+    }
+
+    uint256 GetHash() { return hasher.GetHash(); }
+};
+
+} // namespace
+
+bool WriteUTXOSnapshot(CAutoFile& file, const SnapshotMetadata& metadata, const CCoinsViewDB& coinsdb, CEvoDB& evodb,
+                       SnapshotStats& stats, std::string& strError)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor(coinsdb.Cursor());
+    if (pcursor->GetBestBlock() != metadata.hashBaseBlock || !evodb.VerifyBestBlock(metadata.hashBaseBlock)) {
+        strError = "the databases are not flushed at the base block";
+        return false;
+    }
+
+    try {
+        SnapshotWriter writer(file, metadata);
+        stats = SnapshotStats();
+        for (; pcursor->Valid(); pcursor->Next()) {
+            COutPoint key;
+            Coin coin;
+            if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+                strError = "unable to read a coin";
+                return false;
+            }
+            writer.Write(SNAPSHOT_COIN, key, coin);
+            stats.nCoins++;
+            stats.nTotalAmount += coin.nValue;
+        }
+
+        bool fOk = coinsdb.ForEachSaplingNullifier([&](const uint256& nf) {
+            writer.Write(SNAPSHOT_NULLIFIER, nf);
+            stats.nNullifiers++;
+        });
+        fOk &= coinsdb.ForEachSaplingAnchor([&](const uint256& rt, const SaplingMerkleTree& tree) {
+            writer.Write(SNAPSHOT_ANCHOR, rt, tree);
+            stats.nAnchors++;
+        });
+        if (!fOk) {
+            strError = "unable to read the Sapling state";
+            return false;
+        }
+
+        // The evo db records are copied as they are stored
+        std::unique_ptr<CDBIterator> pevocursor(evodb.GetRawDB().NewIterator());
+        for (pevocursor->SeekToFirst(); pevocursor->Valid(); pevocursor->Next()) {
+            const CDataStream ssKey = pevocursor->GetKey();
+            const CDataStream ssValue = pevocursor->GetValue();
+            writer.Write(SNAPSHOT_EVO, std::vector<unsigned char>(ssKey.begin(), ssKey.end()),
+                         std::vector<unsigned char>(ssValue.begin(), ssValue.end()));
+            stats.nEvoRecords++;
+        }
+
+        writer.Write(SNAPSHOT_END);
+        stats.hashContent = writer.GetHash();
+        file << stats;
+    } catch (const std::exception& e) {
+        strError = strprintf("unable to write the snapshot: %s", e.what());
+        return false;
+    }
+    return true;
+}
+
+bool ReadUTXOSnapshot(CAutoFile& file, SnapshotMetadata& metadata, SnapshotStats& stats, std::string& strError,
+                      CUTXOCommitment* pcommitment)
+{
+    try {
+        file >> metadata;
+        if (metadata.nVersion != UTXO_SNAPSHOT_VERSION) {
+            strError = strprintf("unknown snapshot version %d", metadata.nVersion);
+            return false;
+        }
+        CHashWriter hasher(SER_GETHASH, 0);
+        hasher << metadata;
+        if (pcommitment) {
+            *pcommitment = CUTXOCommitment();
+            pcommitment->hashBlock = metadata.hashBaseBlock;
+        }
+
+        SnapshotStats read;
+        char type = 0;
+        while (type != SNAPSHOT_END) {
+            file >> type;
+            hasher << type;
+            if (type == SNAPSHOT_COIN) {
+                COutPoint key;
+                Coin coin;
+                file >> key >> coin;
+                hasher << key << coin;
+                read.nCoins++;
+                read.nTotalAmount += coin.nValue;
+                if (pcommitment) pcommitment->AddCoin(key, coin);
+            } else if (type == SNAPSHOT_NULLIFIER) {
+                uint256 nf;
+                file >> nf;
+                hasher << nf;
+                read.nNullifiers++;
+            } else if (type == SNAPSHOT_ANCHOR) {
+                uint256 rt;
+                SaplingMerkleTree tree;
+                file >> rt >> tree;
+                hasher << rt << tree;
+                read.nAnchors++;
+            } else if (type == SNAPSHOT_EVO) {
+                std::vector<unsigned char> vchKey, vchValue;
+                file >> vchKey >> vchValue;
+                hasher << vchKey << vchValue;
+                read.nEvoRecords++;
+            } else if (type != SNAPSHOT_END) {
+                strError = strprintf("unknown record type %d", type);
+                return false;
+            }
+        }
+        read.hashContent = hasher.GetHash();
+
+        file >> stats;
+        if (!(read == stats)) {
+            strError = "the content doesn't match the snapshot trailer";
+            return false;
+        }
+    } catch (const std::exception& e) {
+        strError = strprintf("unable to read the snapshot: %s", e.what());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2022 The PIVX Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PIVX_UTXOSNAPSHOT_H
+#define PIVX_UTXOSNAPSHOT_H
+
+#include "amount.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <string>
+
+class CAutoFile;
+class CCoinsViewDB;
+class CEvoDB;
+class CUTXOCommitment;
+
+static const uint32_t UTXO_SNAPSHOT_VERSION = 1;
+
+/**
+ * Header of a UTXO set snapshot file, written by dumptxoutset.
+ * The file holds the chain state at the base block: the coins, the Sapling nullifiers and anchors, and the records
+ * of the evo db (deterministic masternode lists, LLMQ commitments), followed by a SnapshotStats trailer.
+ */
+class SnapshotMetadata
+{
+public:
+    uint32_t nVersion{UTXO_SNAPSHOT_VERSION};
+    std::string strNetwork;
+    uint256 hashBaseBlock;
+    int nBaseHeight{0};
+    uint256 hashSaplingAnchor;
+
+    SERIALIZE_METHODS(SnapshotMetadata, obj) { READWRITE(obj.nVersion, obj.strNetwork, obj.hashBaseBlock, obj.nBaseHeight, obj.hashSaplingAnchor); }
+};
+
+/** Trailer of a snapshot file: the number of records of each kind, and the hash of the metadata and records */
+class SnapshotStats
+{
+public:
+    uint64_t nCoins{0};
+    uint64_t nNullifiers{0};
+    uint64_t nAnchors{0};
+    uint64_t nEvoRecords{0};
+    CAmount nTotalAmount{0};
+    uint256 hashContent;
+
+    SERIALIZE_METHODS(SnapshotStats, obj) { READWRITE(obj.nCoins, obj.nNullifiers, obj.nAnchors, obj.nEvoRecords, obj.nTotalAmount, obj.hashContent); }
+
+    bool operator==(const SnapshotStats& other) const
+    {
+        return nCoins == other.nCoins && nNullifiers == other.nNullifiers && nAnchors == other.nAnchors &&
+               nEvoRecords == other.nEvoRecords && nTotalAmount == other.nTotalAmount && hashContent == other.hashContent;
+    }
+};
+
+/**
+ * Write the snapshot of the coins db and the evo db, both flushed at metadata.hashBaseBlock, and fill the stats.
+ * The databases must not be written during the call (cs_main held).
+ */
+bool WriteUTXOSnapshot(CAutoFile& file, const SnapshotMetadata& metadata, const CCoinsViewDB& coinsdb, CEvoDB& evodb,
+                       SnapshotStats& stats, std::string& strError);
+
+/**
+ * Read a snapshot, and check its records against the stats of its trailer.
+ * With pcommitment, also compute the commitment to its coins, to compare with the one stored for the base block.
+ */
+bool ReadUTXOSnapshot(CAutoFile& file, SnapshotMetadata& metadata, SnapshotStats& stats, std::string& strError,
+                      CUTXOCommitment* pcommitment = nullptr);
+
+#endif // PIVX_UTXOSNAPSHOT_H
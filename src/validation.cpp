@@ -14,6 +14,7 @@
 #include "blocksignature.h"
 #include "budget/budgetmanager.h"
 #include "chainparams.h"
+#include "chaintipsnapshot.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/consensus.h"
@@ -21,10 +22,12 @@
 #include "consensus/tx_verify.h"
 #include "consensus/validation.h"
 #include "consensus/zerocoin_verify.h"
+#include "ctpl_stl.h"
 #include "evo/evodb.h"
 #include "evo/specialtx_validation.h"
 #include "flatfile.h"
 #include "guiinterface.h"
+#include "index/txindex.h"
 #include "interfaces/handler.h"
 #include "invalid.h"
 #include "kernel.h"
@@ -32,9 +35,11 @@
 #include "llmq/quorums_chainlocks.h"
 #include "masternode-payments.h"
 #include "masternodeman.h"
+#include "metrics.h"
 #include "policy/policy.h"
 #include "pow.h"
 #include "reverse_iterate.h"
+#include "sapling/sapling_validation.h"
 #include "script/sigcache.h"
 #include "shutdown.h"
 #include "spork.h"
@@ -42,14 +47,18 @@
 #include "tiertwo/tiertwo_sync_state.h"
 #include "txdb.h"
 #include "undo.h"
+#include "unordered_lru_cache.h"
 #include "util/blockstatecatcher.h"
 #include "util/system.h"
+#include "util/threadnames.h"
 #include "util/validation.h"
 #include "utilmoneystr.h"
+#include "utxocommitment.h"
 #include "validationinterface.h"
 #include "warnings.h"
 #include "zpiv/zpivmodule.h"
 
+#include <deque>
 #include <future>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -91,11 +100,16 @@ uint256 g_best_block;
 int64_t g_best_block_time = 0;
 
 int nScriptCheckThreads = 0;
+// The checks of the blocks and of the mempool txes, used under cs_main (one control at a time)
+static CCheckQueue<CBlockCheck> scriptcheckqueue(128);
 std::atomic<bool> fImporting{false};
 std::atomic<bool> fReindex{false};
-bool fTxIndex = true;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
+bool fHavePruned = false;
+bool fPruneMode = false;
+uint64_t nPruneTarget = 0;
+uint256 hashAssumeValid;
 size_t nCoinCacheUsage = 5000 * 300;
 
 /* If the tip is older than this (in seconds), the node is considered to be in initial block download. */
@@ -159,9 +173,56 @@ Mutex m_cs_chainstate;
 /** All pairs A->B, where A (or one if its ancestors) misses transactions, but B has transactions. */
 std::multimap<CBlockIndex*, CBlockIndex*> mapBlocksUnlinked;
 
+/**
+ * Storage of the entries of mapBlockIndex, allocated by chunks of contiguous objects instead of one by one
+ * (protected by cs_main). The entries live until the block index is unloaded.
+ */
+class CBlockIndexArena
+{
+private:
+    static const size_t CHUNK_SIZE = 4096;
+    std::vector<std::unique_ptr<CBlockIndex[]>> vChunks;
+    //! The first entry of each chunk, to tell the entries of the arena from the ones allocated elsewhere
+    std::set<const CBlockIndex*> setChunkBegins;
+    size_t nChunkUsed{CHUNK_SIZE};
+
+public:
+    CBlockIndex* New()
+    {
+        if (nChunkUsed == CHUNK_SIZE) {
+            vChunks.emplace_back(new CBlockIndex[CHUNK_SIZE]);
+            setChunkBegins.insert(vChunks.back().get());
+            nChunkUsed = 0;
+        }
+        return &vChunks.back()[nChunkUsed++];
+    }
+
+    bool Contains(const CBlockIndex* pindex) const
+    {
+        auto it = setChunkBegins.upper_bound(pindex);
+        if (it == setChunkBegins.begin()) return false;
+        --it;
+        return std::less<const CBlockIndex*>()(pindex, *it + CHUNK_SIZE);
+    }
+
+    void Clear()
+    {
+        vChunks.clear();
+        setChunkBegins.clear();
+        nChunkUsed = CHUNK_SIZE;
+    }
+};
+
+CBlockIndexArena blockIndexArena;
+
 RecursiveMutex cs_LastBlockFile;
 std::vector<CBlockFileInfo> vinfoBlockFile;
 int nLastBlockFile = 0;
+/** Global flag to indicate we should check to see if there are
+ *  block/undo files that should be deleted.  Set on startup
+ *  or if we allocate more file space when we're in prune mode
+ */
+bool fCheckForPruning = false;
 
 /**
      * Every received block is assigned a unique and increasing identifier, so we
@@ -208,16 +269,19 @@ std::unique_ptr<CBlockTreeDB> pblocktree;
 std::unique_ptr<CZerocoinDB> zerocoinDB;
 std::unique_ptr<CSporkDB> pSporkDB;
 std::unique_ptr<AccumulatorCache> accumulatorCache;
+std::unique_ptr<CFrozenSerialIndex> frozenSerials;
 
 enum FlushStateMode {
     FLUSH_STATE_NONE,
     FLUSH_STATE_IF_NEEDED,
     FLUSH_STATE_PERIODIC,
+    FLUSH_STATE_FINALIZED,
     FLUSH_STATE_ALWAYS
 };
 
 // See definition for documentation
 bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode);
+static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
 
@@ -258,6 +322,7 @@ void LimitMempoolSize(CTxMemPool& pool, size_t limit, unsigned long age) {
 
     std::vector<COutPoint> vNoSpendsRemaining;
     pool.TrimToSize(limit, &vNoSpendsRemaining);
+    pool.TrimShieldedToSize(gArgs.GetArg("-maxmempoolshielded", DEFAULT_MAX_MEMPOOL_SHIELDED_SIZE) * 1000000, &vNoSpendsRemaining);
     for (const COutPoint& removed: vNoSpendsRemaining)
         pcoinsTip->Uncache(removed);
 }
@@ -402,8 +467,9 @@ static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state,
         return error("%s : transaction checks for %s failed with %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
 
     int nextBlockHeight = chainHeight + 1;
-    // Check transaction contextually against consensus rules at block height
-    if (!ContextualCheckTransaction(_tx, state, params, nextBlockHeight, false /* isMined */, IsInitialBlockDownload())) {
+    // Check transaction contextually against consensus rules at block height.
+    // The sapling proofs are verified later, along with the scripts.
+    if (!ContextualCheckTransaction(_tx, state, params, nextBlockHeight, false /* isMined */, IsInitialBlockDownload(), false /* fCheckSaplingProofs */)) {
         return error("AcceptToMemoryPool: ContextualCheckTransaction failed");
     }
 
@@ -579,10 +645,33 @@ static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state,
             flags |= SCRIPT_VERIFY_EXCHANGEADDR;
 
 
+        // With script check threads, the input scripts are verified by the workers while this thread
+        // verifies the sapling proofs, then joins them. A script failure is checked again serially,
+        // to report it with its (non-)mandatory flags state.
         PrecomputedTransactionData precomTxData(tx);
-        if (!CheckInputs(tx, state, view, true, flags, true, precomTxData)) {
+        std::vector<CScriptCheck> vChecks;
+        CCheckQueueControl<CBlockCheck> control(nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+        if (!CheckInputs(tx, state, view, true, flags, true, precomTxData, nScriptCheckThreads ? &vChecks : nullptr)) {
+            return false;
+        }
+        std::vector<CBlockCheck> vBlockChecks;
+        vBlockChecks.reserve(vChecks.size());
+        for (CScriptCheck& check : vChecks) {
+            vBlockChecks.emplace_back(check);
+        }
+        control.Add(vBlockChecks);
+
+        // Same DoS level of the proofs failures as in SaplingValidation::ContextualCheckTransaction
+        if (tx.hasSaplingData() &&
+                !SaplingValidation::CheckTransactionProofs(tx, state, IsInitialBlockDownload() ? 0 : 10, true /* fCacheStore */)) {
             return false;
         }
+        if (!control.Wait()) {
+            if (!CheckInputs(tx, state, view, true, flags, true, precomTxData)) {
+                return false;
+            }
+            return error("%s: script checks of %s failed only on the check threads", __func__, hash.ToString());
+        }
 
         // Check again against just the consensus-critical mandatory script
         // verification flags, in case of bugs in the standard flags that cause
@@ -653,6 +742,80 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
     return AcceptToMemoryPoolWithTime(pool, state, tx, fLimitFree, pfMissingInputs, GetTime(), fOverrideMempoolLimit, fRejectInsaneFee, ignoreFees);
 }
 
+bool AcceptPackageToMemoryPool(CTxMemPool& pool, CValidationState& state, const std::vector<CTransactionRef>& package,
+                               std::vector<CValidationState>& vTxStates, bool fRejectInsaneFee)
+{
+    AssertLockHeld(cs_main);
+
+    vTxStates.assign(package.size(), CValidationState());
+    if (package.empty()) {
+        return state.Invalid(false, REJECT_INVALID, "package-empty");
+    }
+    if (package.size() > MAX_PACKAGE_COUNT) {
+        return state.Invalid(false, REJECT_INVALID, "package-too-many-transactions",
+                             strprintf("%d > %d", package.size(), MAX_PACKAGE_COUNT));
+    }
+
+    // An input can only refer to the transactions that come before it
+    std::map<uint256, size_t> mapPackageIndex;
+    for (size_t i = 0; i < package.size(); i++) {
+        if (!mapPackageIndex.emplace(package[i]->GetHash(), i).second) {
+            return state.Invalid(false, REJECT_INVALID, "package-contains-duplicates");
+        }
+    }
+    for (size_t i = 0; i < package.size(); i++) {
+        for (const CTxIn& txin : package[i]->vin) {
+            auto it = mapPackageIndex.find(txin.prevout.hash);
+            if (it != mapPackageIndex.end() && it->second >= i) {
+                return state.Invalid(false, REJECT_INVALID, "package-not-sorted");
+            }
+        }
+    }
+
+    // The mempool is limited (and expired) once for the whole package, then the evicted
+    // transactions are reported.
+    const int64_t nAcceptTime = GetTime();
+    std::vector<bool> vAccepted(package.size(), false);
+    bool fAddedAny = false;
+    for (size_t i = 0; i < package.size(); i++) {
+        const CTransactionRef& tx = package[i];
+        if (pool.exists(tx->GetHash())) {
+            vAccepted[i] = true;
+            continue;
+        }
+        std::vector<COutPoint> coins_to_uncache;
+        bool fMissingInputs = false;
+        if (AcceptToMemoryPoolWorker(pool, vTxStates[i], tx, true /* fLimitFree */, &fMissingInputs, nAcceptTime,
+                                     true /* fOverrideMempoolLimit */, fRejectInsaneFee, false /* ignoreFees */, coins_to_uncache)) {
+            vAccepted[i] = fAddedAny = true;
+            continue;
+        }
+        for (const COutPoint& outpoint : coins_to_uncache) {
+            pcoinsTip->Uncache(outpoint);
+        }
+        if (fMissingInputs) {
+            vTxStates[i].Invalid(false, REJECT_INVALID, "missing-inputs");
+        }
+    }
+
+    if (fAddedAny) {
+        LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+    }
+    bool fAllAccepted = true;
+    for (size_t i = 0; i < package.size(); i++) {
+        if (vAccepted[i] && !pool.exists(package[i]->GetHash())) {
+            vAccepted[i] = false;
+            vTxStates[i].DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
+        }
+        fAllAccepted &= vAccepted[i];
+    }
+
+    // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
+    CValidationState stateDummy;
+    FlushStateToDisk(stateDummy, FLUSH_STATE_PERIODIC);
+    return fAllAccepted;
+}
+
 bool GetOutput(const uint256& hash, unsigned int index, CValidationState& state, CTxOut& out)
 {
     CTransactionRef txPrev;
@@ -682,34 +845,35 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, uint256& hashBl
             return true;
         }
 
-        if (fTxIndex) {
-            CDiskTxPos postx;
-            if (pblocktree->ReadTxIndex(hash, postx)) {
-                CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-                if (file.IsNull())
-                    return error("%s: OpenBlockFile failed", __func__);
-                CBlockHeader header;
-                try {
-                    file >> header;
-                    fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                    file >> txOut;
-                } catch (const std::exception& e) {
-                    return error("%s : Deserialize or I/O error - %s", __func__, e.what());
-                }
-                hashBlock = header.GetHash();
-                if (txOut->GetHash() != hash)
-                    return error("%s : txid mismatch", __func__);
-                return true;
-            }
-
-            // transaction not found in the index, nothing more can be done
-            return false;
+        if (g_txindex && g_txindex->FindTx(hash, hashBlock, txOut)) {
+            return true;
         }
 
         if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
             const Coin& coin = AccessByTxid(*pcoinsTip, hash);
             if (!coin.IsSpent()) pindexSlow = chainActive[coin.nHeight];
         }
+
+        if (fAllowSlow && !pindexSlow && g_txindex) {
+            // The index follows the chain in the background: look in the blocks connected after the last one
+            // indexed, whose notifications are still queued. The peers reach this lookup, so the scan is
+            // bounded: further behind, the index is catching up and the lookup fails.
+            const CBlockIndex* pindexIndexed = g_txindex->GetBestBlockIndex();
+            const CBlockIndex* pindexFork = pindexIndexed ? chainActive.FindFork(pindexIndexed) : nullptr;
+            if (pindexFork && chainActive.Height() - pindexFork->nHeight <= TXINDEX_MAX_PENDING_SCAN) {
+                for (const CBlockIndex* pindex = chainActive.Next(pindexFork); pindex; pindex = chainActive.Next(pindex)) {
+                    CBlock block;
+                    if (!ReadBlockFromDisk(block, pindex)) continue;
+                    for (const auto& tx : block.vtx) {
+                        if (tx->GetHash() == hash) {
+                            txOut = tx;
+                            hashBlock = pindex->GetBlockHash();
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
     }
 
     if (pindexSlow) {
@@ -734,39 +898,167 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, uint256& hashBl
 // CBlock and CBlockIndex
 //
 
-bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos)
+//! The writes of the block and undo files, behind the validation (-asyncblockwrites)
+static const size_t MAX_BLOCK_FILE_WRITE_QUEUE_SIZE = 64 << 20;
+static FlatFileWriter blockFileWriter(MAX_BLOCK_FILE_WRITE_QUEUE_SIZE);
+static FlatFileWriter undoFileWriter(MAX_BLOCK_FILE_WRITE_QUEUE_SIZE);
+
+void StartBlockFileWriters()
 {
-    // Open history file to append
-    CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("WriteBlockToDisk : OpenBlockFile failed");
+    blockFileWriter.Start("blkwriter");
+    undoFileWriter.Start("undowriter");
+}
 
-    // Write index header
-    unsigned int nSize = GetSerializeSize(block, fileout.GetVersion());
-    fileout << Params().MessageStart() << nSize;
+void StopBlockFileWriters()
+{
+    blockFileWriter.Stop();
+    undoFileWriter.Stop();
+}
 
-    // Write block
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0)
-        return error("WriteBlockToDisk : ftell failed");
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos)
+{
+    // Index header and block, queued to the block files writer
+    std::vector<unsigned char> vchBlock;
+    CVectorWriter writer(SER_DISK, CLIENT_VERSION, vchBlock, 0);
+    const unsigned int nSize = GetSerializeSize(block, CLIENT_VERSION);
+    vchBlock.reserve(CMessageHeader::MESSAGE_START_SIZE + sizeof(nSize) + nSize);
+    writer << Params().MessageStart() << nSize << block;
+
+    const fs::path path = BlockFileSeq().FileName(pos);
+    if (!blockFileWriter.Write(path, pos.nPos, std::move(vchBlock)))
+        return error("WriteBlockToDisk : unable to write the block at %s", pos.ToString());
+    pos.nPos += CMessageHeader::MESSAGE_START_SIZE + sizeof(nSize);
 
     return true;
 }
 
+//! Mapped block files, and blocks recently read (decoded and serialized) by ReadSharedBlockFromDisk/ReadRawBlockFromDisk
+static const size_t MAX_MAPPED_BLOCK_FILES = 8;
+static const size_t BLOCK_READ_CACHE_SIZE = 8;
+static FlatFileReader blockFileReader(MAX_MAPPED_BLOCK_FILES);
+
+//! Mapped undo files: the undo data of the blocks disconnected in a row is read from the same mapping
+static const size_t MAX_MAPPED_UNDO_FILES = 4;
+static FlatFileReader undoFileReader(MAX_MAPPED_UNDO_FILES);
+
+// Read data of the block or undo files, found in the write queue until it is written
+static bool ReadFlatFile(FlatFileWriter& writer, FlatFileReader& reader, const fs::path& path, size_t nPos, unsigned char* out, size_t nSize)
+{
+    return writer.Read(path, nPos, out, nSize) || reader.Read(path, nPos, out, nSize);
+}
+
+struct CachedBlock {
+    std::shared_ptr<const CBlock> pblock;
+    std::shared_ptr<const std::vector<unsigned char>> praw;
+};
+static Mutex cs_block_read_cache;
+static unordered_lru_cache<uint256, CachedBlock, SaltedIdHasher> blockReadCache GUARDED_BY(cs_block_read_cache){BLOCK_READ_CACHE_SIZE, BLOCK_READ_CACHE_SIZE + 4};
+
+//! The last connected blocks, with their undo data, and the blocks received recently on the other
+//! chains: the short reorgs, and the checks of the blocks on a fork, don't read them from disk.
+//! The oldest are dropped first.
+struct RecentBlock {
+    int nHeight{0};
+    std::shared_ptr<const CBlock> pblock;
+    std::shared_ptr<const CBlockUndo> pundo;
+    size_t nUsage{0}; //! serialized size of the block and of the undo data
+    size_t nUndoUsage{0};
+};
+static Mutex cs_recent_blocks;
+static std::unordered_map<uint256, RecentBlock, SaltedIdHasher> mapRecentBlocks GUARDED_BY(cs_recent_blocks);
+static std::deque<uint256> recentBlocksOrder GUARDED_BY(cs_recent_blocks);
+static size_t nRecentBlocksUsage GUARDED_BY(cs_recent_blocks) = 0;
+
+static void AddRecentBlock(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& pblock, const std::shared_ptr<const CBlockUndo>& pundo)
+{
+    const uint256& hash = pindex->GetBlockHash();
+    LOCK(cs_recent_blocks);
+    auto it = mapRecentBlocks.find(hash);
+    if (it == mapRecentBlocks.end()) {
+        it = mapRecentBlocks.emplace(hash, RecentBlock()).first;
+        it->second.nHeight = pindex->nHeight;
+        recentBlocksOrder.emplace_back(hash);
+    }
+    RecentBlock& recent = it->second;
+    if (pblock && !recent.pblock) {
+        recent.pblock = pblock;
+        const size_t nSize = GetSerializeSize(*pblock, PROTOCOL_VERSION);
+        recent.nUsage += nSize;
+        nRecentBlocksUsage += nSize;
+    }
+    if (pundo && !recent.pundo) {
+        recent.pundo = pundo;
+        const size_t nSize = GetSerializeSize(*pundo, CLIENT_VERSION);
+        recent.nUsage += nSize;
+        recent.nUndoUsage = nSize;
+        nRecentBlocksUsage += nSize;
+    }
+    while (recentBlocksOrder.size() > RECENT_BLOCKS_RING_SIZE) {
+        auto itOldest = mapRecentBlocks.find(recentBlocksOrder.front());
+        nRecentBlocksUsage -= itOldest->second.nUsage;
+        mapRecentBlocks.erase(itOldest);
+        recentBlocksOrder.pop_front();
+    }
+}
+
+static std::shared_ptr<const CBlock> GetRecentBlock(const uint256& hash)
+{
+    LOCK(cs_recent_blocks);
+    auto it = mapRecentBlocks.find(hash);
+    return it != mapRecentBlocks.end() ? it->second.pblock : nullptr;
+}
+
+static std::shared_ptr<const CBlockUndo> GetRecentBlockUndo(const uint256& hash)
+{
+    LOCK(cs_recent_blocks);
+    auto it = mapRecentBlocks.find(hash);
+    return it != mapRecentBlocks.end() ? it->second.pundo : nullptr;
+}
+
+size_t RecentBlocksMemoryUsage()
+{
+    LOCK(cs_recent_blocks);
+    return nRecentBlocksUsage;
+}
+
+void ClearRecentBlocks()
+{
+    LOCK(cs_recent_blocks);
+    mapRecentBlocks.clear();
+    recentBlocksOrder.clear();
+    nRecentBlocksUsage = 0;
+}
+
+// Read the serialized block at pos, after the network magic and the size written before it
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const FlatFilePos& pos)
+{
+    if (pos.IsNull() || pos.nPos < 8) {
+        return error("%s : invalid position %s", __func__, pos.ToString());
+    }
+    const fs::path path = BlockFileSeq().FileName(pos);
+    unsigned char header[8];
+    if (!ReadFlatFile(blockFileWriter, blockFileReader, path, pos.nPos - 8, header, sizeof(header))) {
+        return error("%s : unable to read the header at %s", __func__, pos.ToString());
+    }
+    const unsigned int nSize = ReadLE32(header + 4);
+    if (memcmp(header, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0 || nSize > MAX_BLOCK_SIZE_CURRENT) {
+        return error("%s : invalid header at %s", __func__, pos.ToString());
+    }
+    vchBlock.resize(nSize);
+    return ReadFlatFile(blockFileWriter, blockFileReader, path, pos.nPos, vchBlock.data(), nSize);
+}
+
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk : OpenBlockFile failed");
-
     // Read block
+    std::vector<unsigned char> vchBlock;
+    if (!ReadRawBlockFromDisk(vchBlock, pos))
+        return error("ReadBlockFromDisk : unable to read the block at %s", pos.ToString());
     try {
-        filein >> block;
+        CDataStream ss(vchBlock, SER_DISK, CLIENT_VERSION);
+        ss >> block;
     } catch (const std::exception& e) {
         return error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
@@ -782,6 +1074,18 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos)
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
 {
+    if (std::shared_ptr<const CBlock> precent = GetRecentBlock(pindex->GetBlockHash())) {
+        block = *precent;
+        return true;
+    }
+    {
+        LOCK(cs_block_read_cache);
+        CachedBlock cached;
+        if (blockReadCache.get(pindex->GetBlockHash(), cached) && cached.pblock) {
+            block = *cached.pblock;
+            return true;
+        }
+    }
     FlatFilePos blockPos = WITH_LOCK(cs_main, return pindex->GetBlockPos(); );
     if (!ReadBlockFromDisk(block, blockPos)) {
         return false;
@@ -793,6 +1097,56 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
     return true;
 }
 
+std::shared_ptr<const CBlock> ReadSharedBlockFromDisk(const CBlockIndex* pindex)
+{
+    const uint256& hash = pindex->GetBlockHash();
+    if (std::shared_ptr<const CBlock> precent = GetRecentBlock(hash)) return precent;
+    CachedBlock cached;
+    {
+        LOCK(cs_block_read_cache);
+        if (blockReadCache.get(hash, cached) && cached.pblock) return cached.pblock;
+    }
+    auto pblock = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*pblock, pindex)) return nullptr;
+    LOCK(cs_block_read_cache);
+    // Keep the serialized block read meanwhile by another thread, if any
+    blockReadCache.get(hash, cached);
+    cached.pblock = pblock;
+    blockReadCache.insert(hash, cached);
+    return cached.pblock;
+}
+
+std::shared_ptr<const std::vector<unsigned char>> ReadRawBlockFromDisk(const CBlockIndex* pindex)
+{
+    const uint256& hash = pindex->GetBlockHash();
+    CachedBlock cached;
+    {
+        LOCK(cs_block_read_cache);
+        if (blockReadCache.get(hash, cached) && cached.praw) return cached.praw;
+    }
+    auto praw = std::make_shared<std::vector<unsigned char>>();
+    FlatFilePos blockPos = WITH_LOCK(cs_main, return pindex->GetBlockPos(); );
+    if (!ReadRawBlockFromDisk(*praw, blockPos)) return nullptr;
+    // Only the header is decoded, to check that it is the block of pindex
+    try {
+        CBlockHeader header;
+        CDataStream ss(*praw, SER_DISK, CLIENT_VERSION);
+        ss >> header;
+        if (header.GetHash() != hash) {
+            error("%s : GetHash() doesn't match index for %s", __func__, hash.GetHex());
+            return nullptr;
+        }
+    } catch (const std::exception& e) {
+        error("%s : Deserialize error - %s", __func__, e.what());
+        return nullptr;
+    }
+    LOCK(cs_block_read_cache);
+    blockReadCache.get(hash, cached);
+    cached.praw = praw;
+    blockReadCache.insert(hash, cached);
+    return cached.praw;
+}
+
 
 double ConvertBitsToDouble(unsigned int nBits)
 {
@@ -1001,7 +1355,7 @@ void static InvalidBlockFound(CBlockIndex* pindex, const CValidationState& state
     }
 }
 
-static bool SkipInvalidUTXOS(int nHeight)
+bool SkipInvalidUTXOS(int nHeight)
 {
     const Consensus::Params& consensus = Params().GetConsensus();
     return Params().NetworkIDString() == CBaseChainParams::MAIN &&
@@ -1039,6 +1393,16 @@ bool CScriptCheck::operator()()
     return VerifyScript(scriptSig, m_tx_out.scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *precomTxData), ptxTo->GetRequiredSigVersion(), &error);
 }
 
+bool CSaplingProofCheck::operator()()
+{
+    return batch->Validate();
+}
+
+bool CBlockSignatureCheck::operator()()
+{
+    return CheckBlockSignature(*block, true);
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -1074,8 +1438,8 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoins
         }
 
         // Check for negative or overflow input values
-        nValueIn += coin.out.nValue;
-        if (!consensus.MoneyRange(coin.out.nValue) || !consensus.MoneyRange(nValueIn))
+        nValueIn += coin.nValue;
+        if (!consensus.MoneyRange(coin.nValue) || !consensus.MoneyRange(nValueIn))
             return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputvalues-outofrange");
     }
 
@@ -1129,7 +1493,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                 // spent being checked as a part of CScriptCheck.
 
                 // Verify signature
-                CScriptCheck check(coin.out, tx, i, flags, cacheStore, &precomTxData);
+                CScriptCheck check(coin.GetTxOut(), tx, i, flags, cacheStore, &precomTxData);
                 if (pvChecks) {
                     pvChecks->emplace_back();
                     check.swap(pvChecks->back());
@@ -1141,7 +1505,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                         // arguments; if so, don't trigger DoS protection to
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
-                        CScriptCheck check2(coin.out, tx, i,
+                        CScriptCheck check2(coin.GetTxOut(), tx, i,
                             flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore, &precomTxData);
                         if (check2())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
@@ -1182,60 +1546,68 @@ static bool AbortNode(CValidationState& state, const std::string& strMessage, co
 
 namespace {
 
-bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock)
+// Write the serialized undo data at pos, with its header and checksum. pos is moved past the header, to the data.
+bool UndoWriteToDisk(const CDataStream& ssUndo, FlatFilePos& pos, const uint256& hashBlock)
 {
-    // Open history file to append
-    CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s : OpenUndoFile failed", __func__);
-
-    // Write index header
-    unsigned int nSize = GetSerializeSize(blockundo, fileout.GetVersion());
-    fileout << Params().MessageStart() << nSize;
-
-    // Write undo data
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0)
-        return error("%s : ftell failed", __func__);
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
-
-    // calculate & write checksum
+    // calculate checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << hashBlock;
-    hasher << blockundo;
-    fileout << hasher.GetHash();
+    hasher.write(ssUndo.data(), ssUndo.size());
+    const uint256 hashChecksum = hasher.GetHash();
+
+    // Index header, undo data and checksum, queued to the undo files writer
+    std::vector<unsigned char> vchUndo(8 + ssUndo.size() + hashChecksum.size());
+    memcpy(vchUndo.data(), Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE);
+    WriteLE32(vchUndo.data() + 4, ssUndo.size());
+    memcpy(vchUndo.data() + 8, ssUndo.data(), ssUndo.size());
+    memcpy(vchUndo.data() + 8 + ssUndo.size(), hashChecksum.begin(), hashChecksum.size());
+    if (!undoFileWriter.Write(UndoFileSeq().FileName(pos), pos.nPos, std::move(vchUndo))) {
+        return error("%s : write failed", __func__);
+    }
+    pos.nPos += 8;
 
     return true;
 }
 
+} // anon namespace
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const FlatFilePos& pos, const uint256& hashBlock)
 {
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("%s : OpenBlockFile failed", __func__);
+    if (pos.IsNull() || pos.nPos < 8) {
+        return error("%s : invalid position %s", __func__, pos.ToString());
+    }
+    const fs::path path = UndoFileSeq().FileName(pos);
+    unsigned char header[8];
+    if (!ReadFlatFile(undoFileWriter, undoFileReader, path, pos.nPos - 8, header, sizeof(header))) {
+        return error("%s : unable to read the header at %s", __func__, pos.ToString());
+    }
+    const unsigned int nSize = ReadLE32(header + 4);
+    if (memcmp(header, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0 || nSize > MAX_SIZE) {
+        return error("%s : invalid header at %s", __func__, pos.ToString());
+    }
 
-    // Read block
-    uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
-    try {
-        verifier << hashBlock;
-        verifier >> blockundo;
-        filein >> hashChecksum;
-    } catch (const std::exception& e) {
-        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    // Read the undo data and its checksum at once
+    std::vector<unsigned char> vchUndo(nSize + sizeof(uint256));
+    if (!ReadFlatFile(undoFileWriter, undoFileReader, path, pos.nPos, vchUndo.data(), vchUndo.size())) {
+        return error("%s : unable to read the undo data at %s", __func__, pos.ToString());
     }
 
     // Verify checksum
-    if (hashChecksum != verifier.GetHash())
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    hasher << hashBlock;
+    hasher.write((const char*)vchUndo.data(), nSize);
+    if (memcmp(hasher.GetHash().begin(), vchUndo.data() + nSize, sizeof(uint256)) != 0)
         return error("%s : Checksum mismatch", __func__);
 
+    try {
+        VectorReader(SER_DISK, CLIENT_VERSION, vchUndo, 0) >> blockundo;
+    } catch (const std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
     return true;
 }
 
-} // anon namespace
-
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1281,7 +1653,7 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
 {
     AssertLockHeld(cs_main);
 
@@ -1301,7 +1673,10 @@ DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoin
         error("%s: no undo data available", __func__);
         return DISCONNECT_FAILED;
     }
-    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
+    if (std::shared_ptr<const CBlockUndo> pundo = GetRecentBlockUndo(pindex->GetBlockHash())) {
+        // the coins are moved out of the undo data below
+        blockUndo = *pundo;
+    } else if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
         error("%s: failure reading undo data", __func__);
         return DISCONNECT_FAILED;
     }
@@ -1334,7 +1709,7 @@ DisconnectResult DisconnectBlock(CBlock& block, const CBlockIndex* pindex, CCoin
                 COutPoint out(hash, o);
                 Coin coin;
                 view.SpendCoin(out, &coin);
-                if (tx.vout[o] != coin.out) {
+                if (tx.vout[o] != coin.GetTxOut()) {
                     fClean = false; // transaction output mismatch
                 }
             }
@@ -1396,8 +1771,15 @@ void static FlushBlockFile(bool fFinalize = false)
     FlatFilePos block_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nSize);
     FlatFilePos undo_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nUndoSize);
 
-    bool status = true;
+    // The queued writes are done first: the block index written after this flush refers to them.
+    // The files written to are closed before their sync and truncation.
+    bool status = blockFileWriter.Sync() && undoFileWriter.Sync();
+    blockFileWriter.Close();
+    undoFileWriter.Close();
     status &= BlockFileSeq().Flush(block_pos_old, fFinalize);
+    // The mapping of the file extends past its end once truncated
+    if (fFinalize) blockFileReader.Close(BlockFileSeq().FileName(block_pos_old));
+    if (fFinalize) undoFileReader.Close(UndoFileSeq().FileName(undo_pos_old));
     status &= UndoFileSeq().Flush(undo_pos_old, fFinalize);
     if (!status) {
         AbortNode("Flushing block file to disk failed. This is likely the result of an I/O error.");
@@ -1406,26 +1788,106 @@ void static FlushBlockFile(bool fFinalize = false)
 
 bool FindUndoPos(CValidationState& state, int nFile, FlatFilePos& pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck()
 {
     util::ThreadRename("pivx-scriptch");
+    ApplyValidationThreadAffinity();
     scriptcheckqueue.Thread();
 }
 
+void PreValidateBlocks(const std::vector<std::shared_ptr<const CBlock>>& vBlocks, bool fSaplingProofs)
+{
+    if (!nScriptCheckThreads) return;
+
+    std::vector<CBlockCheck> vChecks;
+    if (fSaplingProofs) {
+        // A batch of proofs per block, stored in the proof cache when valid
+        for (const auto& pblock : vBlocks) {
+            auto batch = std::make_shared<SaplingValidation::BatchValidator>(true);
+            for (const auto& tx : pblock->vtx) {
+                if (tx->IsShieldedTx() && tx->sapData) batch->Add(*tx);
+            }
+            if (batch->Size() == 0) continue;
+            CSaplingProofCheck saplingCheck(batch);
+            vChecks.emplace_back(saplingCheck);
+        }
+    }
+
+    // Stake prevouts: the outputs created by the batch first, then the coins of the tip
+    std::vector<std::shared_ptr<const CBlock>> vPoSBlocks;
+    std::unordered_map<COutPoint, CTxOut, SaltedOutpointHasher> mapStakePrevouts;
+    for (const auto& pblock : vBlocks) {
+        if (!pblock->IsProofOfStake()) continue;
+        vPoSBlocks.emplace_back(pblock);
+        const CTxIn& txin = pblock->vtx[1]->vin[0];
+        if (!txin.IsZerocoinSpend()) mapStakePrevouts.emplace(txin.prevout, CTxOut());
+    }
+    if (vPoSBlocks.empty() && vChecks.empty()) return;
+
+    for (const auto& pblock : vBlocks) {
+        for (const auto& tx : pblock->vtx) {
+            for (unsigned int i = 0; i < tx->vout.size(); i++) {
+                auto it = mapStakePrevouts.find(COutPoint(tx->GetHash(), i));
+                if (it != mapStakePrevouts.end()) it->second = tx->vout[i];
+            }
+        }
+    }
+    if (!mapStakePrevouts.empty()) {
+        LOCK(cs_main);
+        for (auto& it : mapStakePrevouts) {
+            if (!it.second.IsNull()) continue;
+            const Coin& coin = pcoinsTip->AccessCoin(it.first);
+            if (!coin.IsSpent()) it.second = coin.GetTxOut();
+        }
+    }
+
+    std::vector<PrecomputedTransactionData> vTxData;
+    vTxData.reserve(vPoSBlocks.size());
+    for (const auto& pblock : vPoSBlocks) {
+        CBlockSignatureCheck sigCheck(pblock);
+        vChecks.emplace_back(sigCheck);
+
+        const CTransaction& txCoinStake = *pblock->vtx[1];
+        auto it = mapStakePrevouts.find(txCoinStake.vin[0].prevout);
+        if (it == mapStakePrevouts.end() || it->second.IsNull()) continue;
+        vTxData.emplace_back(txCoinStake);
+        CScriptCheck scriptCheck(it->second, txCoinStake, 0, STANDARD_SCRIPT_VERIFY_FLAGS, true, &vTxData.back());
+        vChecks.emplace_back(scriptCheck);
+    }
+
+    // The result doesn't matter here: the blocks are fully checked when processed. Without cs_main:
+    // the block connections only wait for the queue, while it is busy with these checks.
+    CCheckQueueControl<CBlockCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
 static int64_t nTimeVerify = 0;
 static int64_t nTimeProcessSpecial = 0;
 static int64_t nTimeConnect = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeTotal = 0;
 
+// Whether pindex is the -assumevalid block or one of its ancestors, with the block in the best headers chain
+static bool IsAssumedValid(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (hashAssumeValid.IsNull() || !pindexBestHeader)
+        return false;
+    const CBlockIndex* pindexAssumeValid = LookupBlockIndex(hashAssumeValid);
+    return pindexAssumeValid &&
+           pindexAssumeValid->GetAncestor(pindex->nHeight) == pindex &&
+           pindexBestHeader->GetAncestor(pindexAssumeValid->nHeight) == pindexAssumeValid;
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
-static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck = false, BlockValidationProfile* pprofile = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
+    BlockValidationProfile profileDummy;
+    BlockValidationProfile& profile = pprofile ? *pprofile : profileDummy;
+    int64_t nTimeCheckStart = GetTimeMicros();
     // Check it again in case a previous version let a bad block in
     if (!CheckBlock(block, state, !fJustCheck, !fJustCheck, !fJustCheck)) {
         if (state.CorruptionPossible()) {
@@ -1436,6 +1898,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
         return error("%s: CheckBlock failed for %s: %s", __func__, block.GetHash().ToString(), FormatStateMessage(state));
     }
+    profile.nTimeCheckBlock = GetTimeMicros() - nTimeCheckStart;
 
     if (pindex->pprev && pindex->phashBlock && llmq::chainLocksHandler->HasConflictingChainLock(pindex->nHeight, pindex->GetBlockHash())) {
         return state.DoS(10, error("%s: conflicting with chainlock", __func__), REJECT_INVALID, "bad-chainlock");
@@ -1497,7 +1960,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
     }
 
-    bool fScriptChecks = pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate();
+    // The scripts are not verified below the checkpoints, and neither are the Sapling proofs below -assumevalid.
+    // The coins, the value pools and the Sapling tree are always checked.
+    const bool fAssumeValid = IsAssumedValid(pindex);
+    bool fScriptChecks = !fAssumeValid && pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate();
 
     // If scripts won't be checked anyways, don't bother seeing if CLTV is activated
     bool fCLTVIsActivated = false;
@@ -1507,16 +1973,18 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         exchangeAddrActivated = consensus.NetworkUpgradeActive(pindex->pprev->nHeight, Consensus::UPGRADE_V5_6);
     }
 
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    // Sapling proofs are checked also below the checkpoints, so use the queue when there are workers
+    CCheckQueueControl<CBlockCheck> control(nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    // The Sapling proofs of the block are batch-verified, split in one batch per worker
+    const size_t nMaxSaplingBatches = std::max(1, nScriptCheckThreads);
+    std::vector<std::shared_ptr<SaplingValidation::BatchValidator>> vSaplingBatches;
+    size_t nShieldedTxes = 0;
 
     int64_t nTimeStart = GetTimeMicros();
     CAmount nFees = 0;
     int nInputs = 0;
     unsigned int nSigOps = 0;
-    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
     std::vector<std::pair<CBigNum, uint256> > vSpends;
-    vPos.reserve(block.vtx.size());
     CBlockUndo blockundo;
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
     CAmount nValueOut = 0;
@@ -1568,6 +2036,22 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
         }
 
+        // Queue the Sapling proofs (unless already verified on mempool entry). The signatures are checked right away.
+        if (tx.IsShieldedTx() && !fAssumeValid) {
+            if (vSaplingBatches.size() < nMaxSaplingBatches) {
+                vSaplingBatches.emplace_back(std::make_shared<SaplingValidation::BatchValidator>());
+            }
+            // Like the sigcache, consult the proof cache but only erase entries when actually connecting
+            if (!vSaplingBatches[nShieldedTxes++ % nMaxSaplingBatches]->Add(tx, !fJustCheck)) {
+                // Get the exact reject reason
+                if (!SaplingValidation::CheckTransactionProofs(tx, state, 100)) {
+                    return error("%s: Sapling checks on %s failed with %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
+                }
+                return state.DoS(100, error("%s: cannot verify Sapling tx %s", __func__, tx.GetHash().ToString()),
+                                 REJECT_INVALID, "bad-txns-sapling-invalid");
+            }
+        }
+
         // Cache the sig ser hashes
         precomTxData.emplace_back(tx);
 
@@ -1588,7 +2072,12 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
             if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, precomTxData[i], nScriptCheckThreads ? &vChecks : nullptr))
                 return error("%s: Check inputs on %s failed with %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
-            control.Add(vChecks);
+            std::vector<CBlockCheck> vBlockChecks;
+            vBlockChecks.reserve(vChecks.size());
+            for (CScriptCheck& check : vChecks) {
+                vBlockChecks.emplace_back(check);
+            }
+            control.Add(vBlockChecks);
         }
         nValueOut += txValueOut;
 
@@ -1605,14 +2094,26 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 sapling_tree.append(outputDescription.cmu);
             }
         }
-
-        vPos.emplace_back(tx.GetHash(), pos);
-        pos.nTxOffset += ::GetSerializeSize(tx, CLIENT_VERSION);
     }
 
     // Push new tree anchor
     view.PushAnchor(sapling_tree);
 
+    // The queue is a LIFO, the (longer) proof batches added last are picked up first
+    bool fSaplingProofsOk = true;
+    if (nScriptCheckThreads) {
+        std::vector<CBlockCheck> vBlockChecks;
+        for (auto& batch : vSaplingBatches) {
+            CSaplingProofCheck check(batch);
+            vBlockChecks.emplace_back(check);
+        }
+        control.Add(vBlockChecks);
+    } else {
+        for (auto& batch : vSaplingBatches) {
+            fSaplingProofsOk &= batch->Validate();
+        }
+    }
+
     // Verify header correctness
     if (isV5UpgradeEnforced) {
         // If Sapling is active, block.hashFinalSaplingRoot must be the
@@ -1630,6 +2131,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     int64_t nTime1 = GetTimeMicros();
     nTimeConnect += nTime1 - nTimeStart;
+    profile.nTx = block.vtx.size();
+    profile.nInputs = nInputs;
+    profile.nTimeConnect = nTime1 - nTimeStart;
     LogPrint(BCLog::BENCHMARK, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs - 1), nTimeConnect * 0.000001);
 
     //PoW phase redistributed fees to miner. PoS stage destroys fees.
@@ -1659,18 +2163,31 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         // pass the state returned by the function above
         return false;
     }
+    profile.nTimePayments = GetTimeMicros() - nTime1;
 
-    if (!control.Wait())
+    if (!control.Wait() || !fSaplingProofsOk) {
+        // If a Sapling batch failed, check the shielded txs one by one to find the invalid one
+        for (const auto& tx : block.vtx) {
+            if (tx->IsShieldedTx() && !SaplingValidation::CheckTransactionProofs(*tx, state, 100)) {
+                return error("%s: Sapling checks on %s failed with %s", __func__, tx->GetHash().ToString(), FormatStateMessage(state));
+            }
+        }
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
+    }
     int64_t nTime2 = GetTimeMicros();
     nTimeVerify += nTime2 - nTimeStart;
+    profile.nTimeVerify = nTime2 - nTimeStart;
+    for (const auto& batch : vSaplingBatches) {
+        profile.nTimeSaplingProofs += batch->GetValidateMicros();
+    }
     LogPrint(BCLog::BENCHMARK, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs - 1), nTimeVerify * 0.000001);
 
-    if (!ProcessSpecialTxsInBlock(block, pindex, &view, state, fJustCheck)) {
+    if (!ProcessSpecialTxsInBlock(block, pindex, &view, state, fJustCheck, &profile.nTimeQuorums)) {
         return error("%s: Special tx processing failed with %s", __func__, FormatStateMessage(state));
     }
     int64_t nTime3 = GetTimeMicros();
     nTimeProcessSpecial += nTime3 - nTime2;
+    profile.nTimeProcessSpecial = nTime3 - nTime2;
     LogPrint(BCLog::BENCHMARK, "    - Process special tx: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeProcessSpecial * 0.000001);
 
     //IMPORTANT NOTE: Nothing before this point should actually store to disk (or even memory)
@@ -1681,14 +2198,19 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     if (pindex->GetUndoPos().IsNull() || !pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
         if (pindex->GetUndoPos().IsNull()) {
             FlatFilePos diskPosBlock;
-            if (!FindUndoPos(state, pindex->nFile, diskPosBlock, ::GetSerializeSize(blockundo, CLIENT_VERSION) + 40))
+            CDataStream ssUndo(SER_DISK, CLIENT_VERSION);
+            ssUndo << blockundo;
+            if (!FindUndoPos(state, pindex->nFile, diskPosBlock, ssUndo.size() + 40))
                 return error("ConnectBlock() : FindUndoPos failed");
-            if (!UndoWriteToDisk(blockundo, diskPosBlock, pindex->pprev->GetBlockHash()))
+            if (!UndoWriteToDisk(ssUndo, diskPosBlock, pindex->pprev->GetBlockHash()))
                 return AbortNode(state, "Failed to write undo data");
 
             // update nUndoPos in block index
             pindex->nUndoPos = diskPosBlock.nPos;
             pindex->nStatus |= BLOCK_HAVE_UNDO;
+            if (!IsInitialBlockDownload()) {
+                AddRecentBlock(pindex, nullptr, std::make_shared<const CBlockUndo>(std::move(blockundo)));
+            }
         }
 
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
@@ -1696,19 +2218,16 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     }
 
     // Flush spend/mint info to disk
-    if (!vSpends.empty() && !zerocoinDB->WriteCoinSpendBatch(vSpends))
+    if (!vSpends.empty() && !zerocoinDB->WriteCoinSpendBatch(vSpends, pindex->GetBlockHash()))
         return AbortNode(state, "Failed to record coin serials to database");
 
-    if (fTxIndex)
-        if (!pblocktree->WriteTxIndex(vPos))
-            return AbortNode(state, "Failed to write transaction index");
-
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
     evoDb->WriteBestBlock(pindex->GetBlockHash());
 
     int64_t nTime4 = GetTimeMicros();
     nTimeIndex += nTime4 - nTime3;
+    profile.nTimeIndex = nTime4 - nTime3;
     LogPrint(BCLog::BENCHMARK, "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeIndex * 0.000001);
 
     if (consensus.NetworkUpgradeActive(pindex->nHeight, Consensus::UPGRADE_ZC_V2) &&
@@ -1738,6 +2257,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
  * Update the on-disk chain state.
  * The caches and indexes are flushed if either they're too large, forceWrite is set, or
  * fast is not set and it's been a while since the last write.
+ * The coins cache is emptied only if it's too large or the flush is forced, otherwise its
+ * unspent coins are kept after the write.
  * Full flush also updates the money supply from disk (except during shutdown)
  */
 bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
@@ -1747,7 +2268,20 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
     static int64_t nLastWrite = 0;
     static int64_t nLastFlush = 0;
     static int64_t nLastSetChain = 0;
+    std::set<int> setFilesToPrune;
+    bool fFlushForPrune = false;
     try {
+        if (fPruneMode && fCheckForPruning && !fReindex) {
+            FindFilesToPrune(setFilesToPrune, Params().PruneAfterHeight());
+            fCheckForPruning = false;
+            if (!setFilesToPrune.empty()) {
+                fFlushForPrune = true;
+                if (!fHavePruned) {
+                    pblocktree->WriteFlag("prunedblockfiles", true);
+                    fHavePruned = true;
+                }
+            }
+        }
         int64_t nNow = GetTimeMicros();
         // Avoid writing/flushing immediately after startup.
         if (nLastWrite == 0) {
@@ -1775,8 +2309,15 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
         bool fPeriodicWrite = mode == FLUSH_STATE_PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
+        // A block was chainlocked, between two blocks: write the dirty coins back while they are final,
+        // if the cache is half full (the cache is kept, the critical flush will have less to write)
+        bool fFinalizedFlush = mode == FLUSH_STATE_FINALIZED && cacheSize > nTotalSpace / 2 &&
+                nNow > nLastFlush + (int64_t)FINALIZED_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
-        bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fEvoDbCacheCritical || fPeriodicFlush;
+        bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fEvoDbCacheCritical || fPeriodicFlush || fFlushForPrune || fFinalizedFlush;
+        // The coins cache is emptied only when it's too large, or on demand. Otherwise the dirty coins are
+        // written and the others kept, so that the next blocks don't have to read their inputs from disk.
+        bool fEmptyCoinsCache = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical;
         // Write blocks and block index to disk.
         if (fDoFullFlush || fPeriodicWrite) {
             // Depend on nMinDiskSpace to ensure we can write block index
@@ -1799,12 +2340,19 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
                     vBlocks.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
-                if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
+                // The block index must be on disk before the chainstate that refers to it is written.
+                // The periodic writes that don't flush the chainstate are only appended to the log of
+                // the block tree database, and made durable by the next synchronous write.
+                if ((fDoFullFlush || !vFiles.empty() || !vBlocks.empty()) &&
+                        !pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks, fDoFullFlush)) {
                     return AbortNode(state, "Files to write to block index database");
                 }
             }
             // Flush zerocoin accumulator checkpoints cache
             if (accumulatorCache) accumulatorCache->Flush();
+            // Finally remove any pruned files
+            if (fFlushForPrune)
+                UnlinkPrunedFiles(setFilesToPrune);
 
             nLastWrite = nNow;
         }
@@ -1820,14 +2368,16 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
                 return AbortNode(state, "Disk space is low!", _("Error: Disk space is low!"));
             }
             // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            if (!(fEmptyCoinsCache ? pcoinsTip->Flush() : pcoinsTip->Sync()))
                 return AbortNode(state, "Failed to write to coin database");
+            if (pUTXOCommitment && !pcoinsdbview->WriteUTXOCommitment(*pUTXOCommitment))
+                return AbortNode(state, "Failed to write the UTXO set hash");
             if (!evoDb->CommitRootTransaction()) {
                 return AbortNode(state, "Failed to commit EvoDB");
             }
             nLastFlush = nNow;
-            // Update money supply on memory, reading data from disk
-            if (!ShutdownRequested() && !IsInitialBlockDownload()) {
+            // Update money supply on memory, reading data from disk, if not kept by the tip updates
+            if (!ShutdownRequested() && !IsInitialBlockDownload() && !chainActive.Tip()->nChainTransparentValue) {
                 MoneySupply.Update(pcoinsTip->GetTotalAmount(), chainActive.Height());
             }
         }
@@ -1849,6 +2399,13 @@ void FlushStateToDisk()
     FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
 }
 
+void PruneAndFlush()
+{
+    CValidationState state;
+    fCheckForPruning = true;
+    FlushStateToDisk(state, FLUSH_STATE_NONE);
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex* pindexNew)
 {
@@ -1857,6 +2414,9 @@ void static UpdateTip(CBlockIndex* pindexNew)
 
     // New best block
     mempool.AddTransactionsUpdated(1);
+    if (pindexNew->nChainTransparentValue) {
+        MoneySupply.Update(*pindexNew->nChainTransparentValue, pindexNew->nHeight);
+    }
 
     {
         LOCK(g_best_block_mutex);
@@ -1914,10 +2474,10 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     CBlockIndex* pindexDelete = chainActive.Tip();
     assert(pindexDelete);
     // Read block from disk.
-    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-    CBlock& block = *pblock;
-    if (!ReadBlockFromDisk(block, pindexDelete))
+    std::shared_ptr<const CBlock> pblock = ReadSharedBlockFromDisk(pindexDelete);
+    if (!pblock)
         return error("%s: Failed to read block", __func__);
+    const CBlock& block = *pblock;
     // Apply the block atomically to the chain state.
     const uint256& saplingAnchorBeforeDisconnect = pcoinsTip->GetBestAnchor();
     int64_t nStart = GetTimeMicros();
@@ -1928,6 +2488,7 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
         if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
             return error("DisconnectTip() : DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
+        if (pUTXOCommitment) pUTXOCommitment->ApplyCacheChanges(view, *pcoinsTip);
         bool flushed = view.Flush();
         assert(flushed);
         dbTx->Commit();
@@ -1956,6 +2517,10 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
         // in which case we don't want to evict from the mempool yet!
         mempool.removeWithAnchor(saplingAnchorBeforeDisconnect);
     }
+    // The supply before the block follows from the one after it, if it wasn't known (as when anchored by LoadMoneySupply)
+    if (pindexDelete->nChainTransparentValue && !pindexDelete->pprev->nChainTransparentValue) {
+        pindexDelete->pprev->nChainTransparentValue = *pindexDelete->nChainTransparentValue - pindexDelete->nTransparentValue;
+    }
     // Update chainActive and related variables.
     UpdateTip(pindexDelete->pprev);
     // Let wallets know transactions went from 1-confirmed to
@@ -1964,6 +2529,7 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
 
     // Update MN manager cache
     deterministicMNManager->SetTipIndex(pindexDelete->pprev);
+    PublishChainTipSnapshot(pindexDelete->pprev);
     // replace the cached hash of pindexDelete with the hash of the block
     // at depth CACHED_BLOCK_HASHES if it exists, or empty hash otherwise.
     if ((unsigned) pindexDelete->nHeight >= CACHED_BLOCK_HASHES) {
@@ -1980,6 +2546,8 @@ static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
+static int64_t nBlocksConnected = 0;
+static std::deque<BlockValidationProfile> g_block_profiles GUARDED_BY(cs_main);
 
 struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
@@ -2021,6 +2589,69 @@ public:
     }
 };
 
+/**
+ * The inputs and the sapling nullifiers of the blocks, to load in the coins cache before connecting them.
+ * The outputs created in the blocks are skipped, they are not in the database.
+ */
+static void GetBlocksInputs(const std::vector<const CBlock*>& vBlocks, std::vector<COutPoint>& vOutpoints, std::vector<uint256>& vNullifiers)
+{
+    std::set<uint256> setBlockTxids;
+    for (const CBlock* pblock : vBlocks) {
+        for (const auto& tx : pblock->vtx) {
+            setBlockTxids.insert(tx->GetHash());
+        }
+    }
+    for (const CBlock* pblock : vBlocks) {
+        for (const auto& tx : pblock->vtx) {
+            if (!tx->IsCoinBase() && !tx->HasZerocoinSpendInputs()) {
+                for (const CTxIn& txin : tx->vin) {
+                    if (!setBlockTxids.count(txin.prevout.hash)) vOutpoints.emplace_back(txin.prevout);
+                }
+            }
+            if (tx->IsShieldedTx()) {
+                for (const auto& sd : tx->sapData->vShieldedSpend) {
+                    vNullifiers.emplace_back(sd.nullifier);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Load the inputs and the sapling nullifiers of the block in the coins cache, with parallel reads of the
+ * coins database, so that ConnectBlock doesn't wait on the disk for each of them in turn.
+ */
+static void PrefetchBlockInputs(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    std::vector<COutPoint> vOutpoints;
+    std::vector<uint256> vNullifiers;
+    GetBlocksInputs({&block}, vOutpoints, vNullifiers);
+    pcoinsTip->Prefetch(vOutpoints, vNullifiers, COINS_PREFETCH_THREADS);
+}
+
+void PrefetchBlocksInputs(const std::vector<std::shared_ptr<const CBlock>>& vBlocks)
+{
+    std::vector<const CBlock*> vBlockPtrs;
+    for (const auto& pblock : vBlocks) vBlockPtrs.emplace_back(pblock.get());
+    std::vector<COutPoint> vOutpoints;
+    std::vector<uint256> vNullifiers;
+    GetBlocksInputs(vBlockPtrs, vOutpoints, vNullifiers);
+
+    CCoinsPrefetch prefetch;
+    const CCoinsView* pcoinsdb;
+    {
+        LOCK(cs_main);
+        if (!pcoinsTip || !pcoinsdbview) return;
+        pcoinsTip->PreparePrefetch(vOutpoints, vNullifiers, prefetch);
+        pcoinsdb = pcoinsdbview.get();
+    }
+    if (prefetch.empty()) return;
+    prefetch.Read(*pcoinsdb, COINS_PREFETCH_THREADS);
+    LOCK(cs_main);
+    pcoinsTip->InsertPrefetch(prefetch);
+}
+
 /**
  * Connect a new block to chainActive. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
@@ -2037,25 +2668,27 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew))
+        pthisBlock = ReadSharedBlockFromDisk(pindexNew);
+        if (!pthisBlock)
             return AbortNode(state, "Failed to read block");
-        pthisBlock = pblockNew;
     } else {
         pthisBlock = pblock;
     }
     const CBlock& blockConnecting = *pthisBlock;
+    PrefetchBlockInputs(blockConnecting);
 
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros();
     nTimeReadFromDisk += nTime2 - nTime1;
+    BlockValidationProfile profile;
+    profile.nTimeReadFromDisk = nTime2 - nTime1;
     int64_t nTime3;
-    LogPrint(BCLog::BENCHMARK, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    LogPrint(BCLog::BENCHMARK, "  - Load block and inputs from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
         auto dbTx = evoDb->BeginTransaction();
 
         CCoinsViewCache view(pcoinsTip.get());
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, false);
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, false, &profile);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -2064,13 +2697,26 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
         }
         nTime3 = GetTimeMicros();
         nTimeConnectTotal += nTime3 - nTime2;
+        profile.nTimeConnectTotal = nTime3 - nTime2;
         LogPrint(BCLog::BENCHMARK, "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
+        if (pUTXOCommitment) {
+            pUTXOCommitment->ApplyCacheChanges(view, *pcoinsTip);
+            // The commitment after each block stays available, for the snapshots at that block
+            if (!pblocktree->WriteUTXOCommitmentStats(pindexNew->GetBlockHash(), pUTXOCommitment->GetStats()))
+                return AbortNode(state, "Failed to write the UTXO set hash");
+        }
+        // Keep the change of the transparent supply, for the running total
+        pindexNew->nTransparentValue = view.GetDirtyValueDelta();
+        pindexNew->nStatus |= BLOCK_HAVE_SUPPLY;
+        pindexNew->SetChainTransparentValue();
+        setDirtyBlockIndex.insert(pindexNew);
         bool flushed = view.Flush();
         assert(flushed);
         dbTx->Commit();
     }
     int64_t nTime4 = GetTimeMicros();
     nTimeFlush += nTime4 - nTime3;
+    profile.nTimeFlush = nTime4 - nTime3;
     LogPrint(BCLog::BENCHMARK, "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
 
     // Write the chain state to disk, if necessary. Always write to disk if this is the first of a new file.
@@ -2081,6 +2727,7 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
         return false;
     int64_t nTime5 = GetTimeMicros();
     nTimeChainState += nTime5 - nTime4;
+    profile.nTimeChainState = nTime5 - nTime4;
     LogPrint(BCLog::BENCHMARK, "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
 
     // Remove conflicting transactions from the mempool.
@@ -2095,13 +2742,24 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const st
     mnodeman.CacheBlockHash(pindexNew);
     mnodeman.CheckSpentCollaterals(blockConnecting.vtx);
     deterministicMNManager->SetTipIndex(pindexNew);
+    PublishChainTipSnapshot(pindexNew);
 
     int64_t nTime6 = GetTimeMicros();
     nTimePostConnect += nTime6 - nTime5;
     nTimeTotal += nTime6 - nTime1;
+    nBlocksConnected++;
+    g_metrics.RecordBlockConnect(nTime6 - nTime1);
+    profile.hash = pindexNew->GetBlockHash();
+    profile.nHeight = pindexNew->nHeight;
+    profile.nTimeConnected = GetTime();
+    profile.nTimePostConnect = nTime6 - nTime5;
+    profile.nTimeTotal = nTime6 - nTime1;
+    g_block_profiles.emplace_back(profile);
+    if (g_block_profiles.size() > BLOCK_PROFILE_HISTORY) g_block_profiles.pop_front();
     LogPrint(BCLog::BENCHMARK, "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint(BCLog::BENCHMARK, "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
 
+    if (!IsInitialBlockDownload()) AddRecentBlock(pindexNew, pthisBlock, nullptr);
     connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
     return true;
 }
@@ -2448,6 +3106,39 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex* pindex)
     return true;
 }
 
+static void SetBlockStakeModifier(CBlockIndex* pindex, const CBlock& block)
+{
+    if (!Params().GetConsensus().NetworkUpgradeActive(pindex->nHeight, Consensus::UPGRADE_V3_4)) {
+        // compute and set new V1 stake modifier (entropy bits)
+        pindex->SetNewStakeModifier();
+
+    } else {
+        // compute and set new V2 stake modifier (hash of prevout and prevModifier)
+        pindex->SetNewStakeModifier(block.vtx[1]->vin[0].prevout.hash);
+    }
+}
+
+/**
+ * Whether an index entry without its block data can be the best header: a PoS
+ * header can't be checked without its coinstake, unless a checkpoint pins it.
+ * The PoW ones are checked in AcceptBlockHeader.
+ */
+static bool IsCheckedHeader(const CBlockIndex* pindex)
+{
+    if (!Params().GetConsensus().NetworkUpgradeActive(pindex->nHeight, Consensus::UPGRADE_POS))
+        return true;
+    return Checkpoints::fEnabled && Checkpoints::CheckBlock(pindex->nHeight, pindex->GetBlockHash(), true);
+}
+
+static void UpdateBestHeader(CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindex->nChainWork) {
+        pindexBestHeader = pindex;
+        PublishBestHeaderSnapshot();
+    }
+}
+
 static CBlockIndex* AddToBlockIndex(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
@@ -2459,7 +3150,8 @@ static CBlockIndex* AddToBlockIndex(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRE
         return pindex;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = blockIndexArena.New();
+    *pindexNew = CBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -2472,22 +3164,16 @@ static CBlockIndex* AddToBlockIndex(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRE
         pindexNew->pprev = pprev;
         pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
         pindexNew->BuildSkip();
-
-        const Consensus::Params& consensus = Params().GetConsensus();
-        if (!consensus.NetworkUpgradeActive(pindexNew->nHeight, Consensus::UPGRADE_V3_4)) {
-            // compute and set new V1 stake modifier (entropy bits)
-            pindexNew->SetNewStakeModifier();
-
-        } else {
-            // compute and set new V2 stake modifier (hash of prevout and prevModifier)
-            pindexNew->SetNewStakeModifier(block.vtx[1]->vin[0].prevout.hash);
-        }
+        // A header alone doesn't have the coinstake: its modifier is set with the block data
+        if (!block.vtx.empty())
+            SetBlockStakeModifier(pindexNew, block);
     }
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
-    if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindexNew->nChainWork)
-        pindexBestHeader = pindexNew;
+    // A header alone moves the best header only once it is checked (or with its block)
+    if (!block.vtx.empty() || IsCheckedHeader(pindexNew))
+        UpdateBestHeader(pindexNew);
 
     setDirtyBlockIndex.insert(pindexNew);
     // track prevBlockHash -> pindex (multimap)
@@ -2526,6 +3212,8 @@ bool ReceivedBlockTransactions(const CBlock& block, CValidationState& state, CBl
     pindexNew->nStatus |= BLOCK_HAVE_DATA;
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
     setDirtyBlockIndex.insert(pindexNew);
+    // The header received before its block can be the best one now
+    UpdateBestHeader(pindexNew);
 
     if (pindexNew->pprev == nullptr || pindexNew->pprev->nChainTx) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
@@ -2601,11 +3289,13 @@ bool FindBlockPos(CValidationState& state, FlatFilePos& pos, unsigned int nAddSi
 
     if (!fKnown) {
         bool out_of_space;
-        BlockFileSeq().Allocate(pos, nAddSize, out_of_space);
+        size_t bytes_allocated = BlockFileSeq().Allocate(pos, nAddSize, out_of_space);
         if (out_of_space) {
             return AbortNode("Disk space is low!", _("Error: Disk space is low!"));
         }
-        // future: add prunning flag check
+        if (bytes_allocated != 0 && fPruneMode) {
+            fCheckForPruning = true;
+        }
     }
 
     setDirtyFileInfo.insert(nFile);
@@ -2623,15 +3313,157 @@ bool FindUndoPos(CValidationState& state, int nFile, FlatFilePos& pos, unsigned
     setDirtyFileInfo.insert(nFile);
 
     bool out_of_space;
-    UndoFileSeq().Allocate(pos, nAddSize, out_of_space);
+    size_t bytes_allocated = UndoFileSeq().Allocate(pos, nAddSize, out_of_space);
     if (out_of_space) {
         return AbortNode(state, "Disk space is low!", _("Error: Disk space is low!"));
     }
-    // future: add prunning flag check
+    if (bytes_allocated != 0 && fPruneMode) {
+        fCheckForPruning = true;
+    }
 
     return true;
 }
 
+uint64_t CalculateCurrentUsage()
+{
+    LOCK(cs_LastBlockFile);
+
+    uint64_t retval = 0;
+    for (const CBlockFileInfo& file : vinfoBlockFile) {
+        retval += file.nSize + file.nUndoSize;
+    }
+    return retval;
+}
+
+void PruneOneBlockFile(const int fileNumber)
+{
+    AssertLockHeld(cs_main);
+    LOCK(cs_LastBlockFile);
+
+    for (const auto& entry : mapBlockIndex) {
+        CBlockIndex* pindex = entry.second;
+        if (pindex->nFile == fileNumber) {
+            pindex->nStatus &= ~BLOCK_HAVE_DATA;
+            pindex->nStatus &= ~BLOCK_HAVE_UNDO;
+            pindex->nFile = 0;
+            pindex->nDataPos = 0;
+            pindex->nUndoPos = 0;
+            setDirtyBlockIndex.insert(pindex);
+
+            // Prune from mapBlocksUnlinked -- any block we prune would have
+            // to be downloaded again in order to consider its chain, at which
+            // point it would be considered as a candidate for
+            // mapBlocksUnlinked or setBlockIndexCandidates.
+            auto range = mapBlocksUnlinked.equal_range(pindex->pprev);
+            while (range.first != range.second) {
+                std::multimap<CBlockIndex*, CBlockIndex*>::iterator _it = range.first;
+                range.first++;
+                if (_it->second == pindex) {
+                    mapBlocksUnlinked.erase(_it);
+                }
+            }
+        }
+    }
+
+    vinfoBlockFile[fileNumber].SetNull();
+    setDirtyFileInfo.insert(fileNumber);
+}
+
+void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
+{
+    // No write left to the files removed
+    const bool fSynced = blockFileWriter.Sync();
+    if (!undoFileWriter.Sync() || !fSynced) {
+        AbortNode("Writing the block files to disk failed. This is likely the result of an I/O error.");
+    }
+    blockFileWriter.Close();
+    undoFileWriter.Close();
+    for (const int nFile : setFilesToPrune) {
+        FlatFilePos pos(nFile, 0);
+        const fs::path pathBlock = BlockFileSeq().FileName(pos);
+        blockFileReader.Close(pathBlock);
+        fs::remove(pathBlock);
+        const fs::path pathUndo = UndoFileSeq().FileName(pos);
+        undoFileReader.Close(pathUndo);
+        fs::remove(pathUndo);
+        LogPrint(BCLog::PRUNE, "Prune: %s deleted blk/rev (%05u)\n", __func__, nFile);
+    }
+}
+
+int GetPruneKeepDepth()
+{
+    // The undo data is needed to disconnect the blocks of a reorg, up to -maxreorg deep
+    return std::max<int>(MIN_BLOCKS_TO_KEEP, gArgs.GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH) + 1);
+}
+
+/**
+ * Find the block and undo files (blk?????.dat and rev?????.dat) to delete so that the disk space they use,
+ * plus a buffer for the next allocation, stays below the -prune target.
+ *
+ * Called from FlushStateToDisk when fCheckForPruning has been set (at startup and whenever new space is
+ * allocated in a block or undo file). Nothing is pruned until the tip is above nPruneAfterHeight, and a file
+ * is only pruned if its last block is more than GetPruneKeepDepth() blocks below the tip. The oldest files go
+ * first; during the initial block download the buffer is raised by 10% of the target to prune less often.
+ * Block and undo files are pruned together, PruneOneBlockFile updates the block index entries they held.
+ *
+ * @param[out]   setFilesToPrune   The indices of the files that can be unlinked
+ * @param[in]    nPruneAfterHeight The chain height under which nothing is pruned
+ */
+static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight)
+{
+    LOCK2(cs_main, cs_LastBlockFile);
+    if (chainActive.Tip() == nullptr || nPruneTarget == 0) {
+        return;
+    }
+    if ((uint64_t)chainActive.Tip()->nHeight <= nPruneAfterHeight) {
+        return;
+    }
+
+    const int nLastBlockWeCanPrune = chainActive.Tip()->nHeight - GetPruneKeepDepth();
+    uint64_t nCurrentUsage = CalculateCurrentUsage();
+    // We don't check to prune until after we've allocated new space for files
+    // So we should leave a buffer under our target to account for another allocation
+    // before the next pruning.
+    uint64_t nBuffer = BLOCKFILE_CHUNK_SIZE + UNDOFILE_CHUNK_SIZE;
+    int count = 0;
+
+    if (nCurrentUsage + nBuffer >= nPruneTarget) {
+        // On a prune event, the chainstate DB is flushed.
+        // To avoid excessive prune events negating the benefit of high dbcache
+        // values, we should not prune too rapidly.
+        // So when pruning in IBD, increase the buffer a bit to avoid a re-prune too soon.
+        if (IsInitialBlockDownload()) {
+            // Since this is only relevant during IBD, we use a fixed 10%
+            nBuffer += nPruneTarget / 10;
+        }
+
+        for (int fileNumber = 0; fileNumber < nLastBlockFile; fileNumber++) {
+            const uint64_t nBytesToPrune = vinfoBlockFile[fileNumber].nSize + vinfoBlockFile[fileNumber].nUndoSize;
+
+            if (vinfoBlockFile[fileNumber].nSize == 0)
+                continue;
+
+            if (nCurrentUsage + nBuffer < nPruneTarget) // are we below our target?
+                break;
+
+            // don't prune files that could have a block within the keep depth of the main chain's tip but keep scanning
+            if ((int)vinfoBlockFile[fileNumber].nHeightLast > nLastBlockWeCanPrune)
+                continue;
+
+            PruneOneBlockFile(fileNumber);
+            // Queue up the files for removal
+            setFilesToPrune.insert(fileNumber);
+            nCurrentUsage -= nBytesToPrune;
+            count++;
+        }
+    }
+
+    LogPrint(BCLog::PRUNE, "Prune: target=%dMiB actual=%dMiB diff=%dMiB max_prune_height=%d removed %d blk/rev pairs\n",
+             nPruneTarget / 1024 / 1024, nCurrentUsage / 1024 / 1024,
+             ((int64_t)nPruneTarget - (int64_t)nCurrentUsage) / 1024 / 1024,
+             nLastBlockWeCanPrune, count);
+}
+
 bool CheckColdStakeFreeOutput(const CTransaction& tx, const int nHeight)
 {
     assert(tx.IsCoinStake());
@@ -2658,11 +3490,17 @@ bool CheckColdStakeFreeOutput(const CTransaction& tx, const int nHeight)
         // if mnsync is incomplete, we cannot verify if this is a budget block.
         // so we check that the staker is not transferring value to the free output
         if (!g_tiertwo_sync_state.IsSynced()) {
-            // First try finding the previous transaction in database
-            CTransactionRef txPrev; uint256 hashBlock;
-            if (!GetTransaction(tx.vin[0].prevout.hash, txPrev, hashBlock, true))
-                return error("%s : read txPrev failed: %s",  __func__, tx.vin[0].prevout.hash.GetHex());
-            CAmount amtIn = txPrev->vout[tx.vin[0].prevout.n].nValue + GetBlockValue(nHeight);
+            // First look for the stake input in the coins cache, then find the previous transaction in database
+            const COutPoint& prevout = tx.vin[0].prevout;
+            CAmount amtIn = WITH_LOCK(cs_main, return pcoinsTip->AccessCoin(prevout).nValue);
+            if (amtIn < 0) {
+                // Spent in the active chain: the stake of a fork
+                CTransactionRef txPrev; uint256 hashBlock;
+                if (!GetTransaction(prevout.hash, txPrev, hashBlock, true) || prevout.n >= txPrev->vout.size())
+                    return error("%s : read txPrev failed: %s",  __func__, prevout.hash.GetHex());
+                amtIn = txPrev->vout[prevout.n].nValue;
+            }
+            amtIn += GetBlockValue(nHeight);
             CAmount amtOut = 0;
             for (unsigned int i = 1; i < outs-1; i++) amtOut += tx.vout[i].nValue;
             if (amtOut != amtIn)
@@ -2885,8 +3723,7 @@ bool CheckBlockTime(const CBlockHeader& block, CValidationState& state, CBlockIn
     return true;
 }
 
-//! Returns last CBlockIndex* that is a checkpoint
-static const CBlockIndex* GetLastCheckpoint() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+const CBlockIndex* GetLastCheckpoint()
 {
     AssertLockHeld(cs_main);
 
@@ -2961,8 +3798,9 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     // Check that all transactions are finalized
     for (const auto& tx : block.vtx) {
 
-        // Check transaction contextually against consensus rules at block height
-        if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, true /* isMined */, IsInitialBlockDownload())) {
+        // Check transaction contextually against consensus rules at block height.
+        // The Sapling proofs are verified in ConnectBlock, together with the scripts.
+        if (!ContextualCheckTransaction(tx, state, chainparams, nHeight, true /* isMined */, IsInitialBlockDownload(), false /* fCheckSaplingProofs */)) {
             return false;
         }
 
@@ -3051,6 +3889,14 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
         return false;
     }
 
+    // A header alone has no coinstake, but the PoW era ones carry their work
+    if (block.vtx.empty() && hash != Params().GetConsensus().hashGenesisBlock &&
+            !Params().GetConsensus().NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_POS)) {
+        if (!CheckProofOfWork(hash, block.nBits) || !CheckWork(block, pindexPrev))
+            return state.DoS(100, error("%s : proof of work failed for header %s", __func__, hash.ToString()),
+                             REJECT_INVALID, "high-hash");
+    }
+
     if (!ContextualCheckBlockHeader(block, state, pindexPrev))
         return error("%s: ContextualCheckBlockHeader failed for block %s: %s", __func__, hash.ToString(), FormatStateMessage(state));
 
@@ -3155,6 +4001,120 @@ static bool CheckInBlockDoubleSpends(const CBlock& block, int nHeight, CValidati
     return true;
 }
 
+/*
+ * The inputs spent and the outputs created by a block, so that the checks of the PoS blocks
+ * on a fork are lookups instead of reads of the blocks between the split and the tips.
+ */
+struct BlockSpends {
+    int nHeight{0};
+    std::unordered_set<COutPoint, SaltedOutpointHasher> spentOutpoints;
+    std::set<CBigNum> spentSerials;
+    std::vector<std::pair<uint256, uint32_t>> createdOutputs; //! txid and number of outputs
+};
+
+/*
+ * The spends of the recent blocks, on any chain, by block hash. The blocks deeper than
+ * -maxreorg below the tip are dropped (the forks from there are rejected anyway).
+ * The blocks not seen since the start are read from disk once.
+ */
+static std::unordered_map<uint256, std::shared_ptr<const BlockSpends>, SaltedIdHasher> g_block_spends GUARDED_BY(cs_main);
+
+static std::shared_ptr<const BlockSpends> MakeBlockSpends(const CBlock& block, int nHeight)
+{
+    auto spends = std::make_shared<BlockSpends>();
+    spends->nHeight = nHeight;
+    spends->createdOutputs.reserve(block.vtx.size());
+    for (const CTransactionRef& tx : block.vtx) {
+        for (const CTxIn& in : tx->vin) {
+            if (!in.IsZerocoinSpend()) {
+                spends->spentOutpoints.emplace(in.prevout);
+            } else {
+                spends->spentSerials.emplace(ZPIVModule::TxInToZerocoinSpend(in).getCoinSerialNumber());
+            }
+        }
+        spends->createdOutputs.emplace_back(tx->GetHash(), (uint32_t)tx->vout.size());
+    }
+    return spends;
+}
+
+//! Height of the last chainlocked block of the active chain (-chainlockfinality), -1 if none
+static int g_finalized_height GUARDED_BY(cs_main) = -1;
+
+static int BlockSpendsMinHeight() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    // No fork can split from below a chainlocked block
+    return std::max(chainActive.Height() - (int)gArgs.GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH), g_finalized_height + 1);
+}
+
+static void CacheBlockSpends(const uint256& hash, const std::shared_ptr<const BlockSpends>& spends) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const int nMinHeight = BlockSpendsMinHeight();
+    if (spends->nHeight < nMinHeight) return;
+    for (auto it = g_block_spends.begin(); it != g_block_spends.end(); ) {
+        if (it->second->nHeight < nMinHeight) {
+            it = g_block_spends.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    g_block_spends[hash] = spends;
+}
+
+void FinalizeChainLockedBlock(const CBlockIndex* pindex)
+{
+    if (!gArgs.GetBoolArg("-chainlockfinality", DEFAULT_CHAINLOCK_FINALITY)) return;
+    {
+        LOCK(cs_main);
+        if (!chainActive.Contains(pindex) || pindex->nHeight <= g_finalized_height) return;
+        g_finalized_height = pindex->nHeight;
+
+        const int nMinHeight = BlockSpendsMinHeight();
+        for (auto it = g_block_spends.begin(); it != g_block_spends.end(); ) {
+            if (it->second->nHeight < nMinHeight) {
+                it = g_block_spends.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // The blocks up to it won't be disconnected, and the ones of the other chains connected
+        LOCK(cs_recent_blocks);
+        for (auto it = mapRecentBlocks.begin(); it != mapRecentBlocks.end(); ) {
+            RecentBlock& recent = it->second;
+            if (recent.nHeight > pindex->nHeight) {
+                ++it;
+            } else if (chainActive[recent.nHeight]->GetBlockHash() != it->first) {
+                nRecentBlocksUsage -= recent.nUsage;
+                recentBlocksOrder.erase(std::find(recentBlocksOrder.begin(), recentBlocksOrder.end(), it->first));
+                it = mapRecentBlocks.erase(it);
+            } else {
+                if (recent.pundo) {
+                    recent.pundo.reset();
+                    recent.nUsage -= recent.nUndoUsage;
+                    nRecentBlocksUsage -= recent.nUndoUsage;
+                    recent.nUndoUsage = 0;
+                }
+                ++it;
+            }
+        }
+    }
+
+    CValidationState state;
+    FlushStateToDisk(state, FLUSH_STATE_FINALIZED);
+}
+
+static std::shared_ptr<const BlockSpends> GetBlockSpends(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    auto it = g_block_spends.find(pindex->GetBlockHash());
+    if (it != g_block_spends.end()) return it->second;
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex)) return nullptr;
+    std::shared_ptr<const BlockSpends> spends = MakeBlockSpends(block, pindex->nHeight);
+    CacheBlockSpends(pindex->GetBlockHash(), spends);
+    return spends;
+}
+
 /*
  * Check whether ALL the provided inputs (outpoints and zerocoin serials) are UNSPENT on
  * a forked (non currently active) chain.
@@ -3184,39 +4144,39 @@ static bool IsUnspentOnFork(std::unordered_set<COutPoint, SaltedOutpointHasher>&
             return error("%s: null pprev for block %s", __func__, pindexFork->GetBlockHash().GetHex());
         }
 
-        // if there are no coins left, don't read the block
+        // if there are no coins left, don't look at the block
         if (outpoints.empty() && serials.empty()) continue;
 
-        // read block
-        CBlock bl;
-        if (!ReadBlockFromDisk(bl, pindexFork)) {
+        const std::shared_ptr<const BlockSpends> spends = GetBlockSpends(pindexFork);
+        if (!spends) {
             return error("%s: block %s not on disk", __func__, pindexFork->GetBlockHash().GetHex());
         }
-        // Loop through every tx of this block
-        // (reversed because we first check spent outpoints, and then remove created ones)
-        for (auto it = bl.vtx.rbegin(); it != bl.vtx.rend(); ++it) {
-            CTransactionRef tx = *it;
-            // Loop through every input of this tx
-            for (const CTxIn& in: tx->vin) {
-                // check if any of the provided outpoints/serials is being spent
-                if (!in.IsZerocoinSpend()) {
-                    // regular utxo
-                    if (outpoints.find(in.prevout) != outpoints.end()) {
-                        return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputs-spent-fork-post-split");
-                    }
-                } else {
-                    // zerocoin serial
-                    const CBigNum& s = ZPIVModule::TxInToZerocoinSpend(in).getCoinSerialNumber();
-                    if (serials.find(s) != serials.end()) {
-                        return state.DoS(100, false, REJECT_INVALID, "bad-txns-serials-spent-fork-post-split");
-                    }
+        // Check if any of the provided outpoints/serials is spent by the block, looking up the
+        // smaller set in the larger. A tx can't spend the outputs of a later one in the block, so
+        // the spends of the whole block are checked before removing the coins it created.
+        if (outpoints.size() <= spends->spentOutpoints.size()) {
+            for (const COutPoint& out : outpoints) {
+                if (spends->spentOutpoints.count(out)) {
+                    return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputs-spent-fork-post-split");
                 }
             }
-            // Then remove from the outpoints set, any coin created by this tx
-            const uint256& txid = tx->GetHash();
-            for (size_t i = 0; i < tx->vout.size(); i++) {
+        } else {
+            for (const COutPoint& out : spends->spentOutpoints) {
+                if (outpoints.count(out)) {
+                    return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputs-spent-fork-post-split");
+                }
+            }
+        }
+        for (const CBigNum& s : spends->spentSerials) {
+            if (serials.count(s)) {
+                return state.DoS(100, false, REJECT_INVALID, "bad-txns-serials-spent-fork-post-split");
+            }
+        }
+        // Then remove from the outpoints set, any coin created by the block
+        for (const auto& created : spends->createdOutputs) {
+            for (uint32_t i = 0; i < created.second && !outpoints.empty(); i++) {
                 // erase if present (no-op if not)
-                outpoints.erase(COutPoint(txid, i));
+                outpoints.erase(COutPoint(created.first, i));
             }
         }
     }
@@ -3241,18 +4201,24 @@ static bool IsSpentOnActiveChain(std::unordered_set<COutPoint, SaltedOutpointHas
 
     // Go upwards on the active chain till the tip
     for (int height = height_start; height <= height_end && !outpoints.empty(); height++) {
-        // read block
-        const CBlockIndex* pindex = mapBlockIndex.at(chainActive[height]->GetBlockHash());
-        CBlock bl;
-        if (!ReadBlockFromDisk(bl, pindex)) {
+        const CBlockIndex* pindex = chainActive[height];
+        const std::shared_ptr<const BlockSpends> spends = GetBlockSpends(pindex);
+        if (!spends) {
             return error("%s: block %s not on disk", __func__, pindex->GetBlockHash().GetHex());
         }
-        // Loop through every tx of this block
-        for (const auto& tx : bl.vtx) {
-            // Loop through every input of this tx
-            for (const CTxIn& in: tx->vin) {
+        // Remove the outpoints spent by the block (the smaller set looked up in the larger)
+        if (outpoints.size() <= spends->spentOutpoints.size()) {
+            for (auto it = outpoints.begin(); it != outpoints.end(); ) {
+                if (spends->spentOutpoints.count(*it)) {
+                    it = outpoints.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        } else {
+            for (const COutPoint& out : spends->spentOutpoints) {
                 // erase if present (no-op if not)
-                outpoints.erase(in.prevout);
+                outpoints.erase(out);
             }
         }
     }
@@ -3294,6 +4260,10 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockInde
         return true;
     }
 
+    // Header received first
+    if (pindex->pprev && pindex->vStakeModifier.empty())
+        SetBlockStakeModifier(pindex, block);
+
     if (!CheckBlock(block, state) || !ContextualCheckBlock(block, state, pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -3385,6 +4355,11 @@ static bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockInde
             }
         }
 
+        // Keep the spends of the block for the checks of the next blocks on a fork from here
+        // (while syncing, they are read from disk the first time a fork needs them)
+        if (!IsInitialBlockDownload()) {
+            CacheBlockSpends(block.GetHash(), MakeBlockSpends(block, nHeight));
+        }
     }
 
     // Write block to history file
@@ -3433,6 +4408,7 @@ bool ProcessNewBlock(const std::shared_ptr<const CBlock>& pblock, const FlatFile
             return error("%s : AcceptBlock FAILED", __func__);
         }
         newHeight = pindex->nHeight;
+        if (!IsInitialBlockDownload()) AddRecentBlock(pindex, pblock, nullptr);
     }
 
     CValidationState state; // Only used to report errors, not invalidity - ignore it
@@ -3517,7 +4493,7 @@ CBlockIndex* InsertBlockIndex(const uint256& hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = blockIndexArena.New();
     mi = mapBlockIndex.emplace(hash, pindexNew).first;
 
     pindexNew->phashBlock = &((*mi).first);
@@ -3552,8 +4528,11 @@ bool static LoadBlockIndexDB(std::string& strError) EXCLUSIVE_LOCKS_REQUIRED(cs_
 
         CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
+        pindex->SetChainTransparentValue();
         pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
-        if (pindex->nStatus & BLOCK_HAVE_DATA) {
+        // We can link the chain of blocks for which we've received transactions at some point.
+        // Pruned nodes may have deleted the block.
+        if (pindex->nTx > 0) {
             if (pindex->pprev) {
                 if (pindex->pprev->nChainTx) {
                     pindex->nChainTx = pindex->pprev->nChainTx + pindex->nTx;
@@ -3580,7 +4559,8 @@ bool static LoadBlockIndexDB(std::string& strError) EXCLUSIVE_LOCKS_REQUIRED(cs_
             pindexBestInvalid = pindex;
         if (pindex->pprev)
             pindex->BuildSkip();
-        if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
+        if (pindex->IsValid(BLOCK_VALID_TREE) && ((pindex->nStatus & BLOCK_HAVE_DATA) || IsCheckedHeader(pindex)) &&
+                (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
     }
 
@@ -3601,6 +4581,11 @@ bool static LoadBlockIndexDB(std::string& strError) EXCLUSIVE_LOCKS_REQUIRED(cs_
         }
     }
 
+    // Check whether we have ever pruned block & undo files
+    pblocktree->ReadFlag("prunedblockfiles", fHavePruned);
+    if (fHavePruned)
+        LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
+
     // Check presence of blk files
     LogPrintf("Checking all blk files are present...\n");
     std::set<int> setBlkDataFiles;
@@ -3627,10 +4612,6 @@ bool static LoadBlockIndexDB(std::string& strError) EXCLUSIVE_LOCKS_REQUIRED(cs_
     pblocktree->ReadReindexing(fReindexing);
     if (fReindexing) fReindex = true;
 
-    // Check whether we have a transaction index
-    pblocktree->ReadFlag("txindex", fTxIndex);
-    LogPrintf("LoadBlockIndexDB(): transaction index %s\n", fTxIndex ? "enabled" : "disabled");
-
     // If this is written true before the next client init, then we know the shutdown process failed
     pblocktree->WriteFlag("shutdown", false);
 
@@ -3659,6 +4640,7 @@ bool LoadChainTip(const CChainParams& chainparams)
         return false;
     }
     chainActive.SetTip(pindex);
+    PublishChainTipSnapshot(pindex);
 
     PruneBlockIndexCandidates();
 
@@ -3671,6 +4653,19 @@ bool LoadChainTip(const CChainParams& chainparams)
     return true;
 }
 
+void LoadMoneySupply()
+{
+    AssertLockHeld(cs_main);
+    CBlockIndex* pindexTip = chainActive.Tip();
+    if (!pindexTip) return;
+    if (!pindexTip->nChainTransparentValue) {
+        // Some blocks were connected before their supply change was kept:
+        // anchor the running total on the value of the coins
+        pindexTip->nChainTransparentValue = pcoinsTip->GetTotalAmount();
+    }
+    MoneySupply.Update(*pindexTip->nChainTransparentValue, pindexTip->nHeight);
+}
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks..."), 0);
@@ -3684,6 +4679,7 @@ CVerifyDB::~CVerifyDB()
 bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth)
 {
     LOCK(cs_main);
+    DBVerifyScansScope verifyScans;
     if (chainActive.Tip() == nullptr || chainActive.Tip()->pprev == nullptr)
         return true;
 
@@ -3717,6 +4713,11 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
         uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
         if (pindex->nHeight < chainHeight - nCheckDepth)
             break;
+        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // If pruning, only go back as far as we have data.
+            LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
+            break;
+        }
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(block, pindex))
@@ -3884,6 +4885,7 @@ void UnloadBlockIndex()
     chainActive.SetTip(nullptr);
     pindexBestInvalid = nullptr;
     pindexBestHeader = nullptr;
+    ResetChainTipSnapshot();
     mempool.clear();
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
@@ -3893,9 +4895,23 @@ void UnloadBlockIndex()
     setDirtyFileInfo.clear();
 
     for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
+        if (!blockIndexArena.Contains(entry.second)) delete entry.second;
     }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
+
+    WITH_LOCK(cs_block_read_cache, blockReadCache.clear());
+    g_block_spends.clear();
+    g_finalized_height = -1;
+    ClearRecentBlocks();
+    blockFileReader.Clear();
+    undoFileReader.Clear();
+    const bool fSynced = blockFileWriter.Sync();
+    if (!undoFileWriter.Sync() || !fSynced) {
+        LogPrintf("%s: writing the block files to disk failed\n", __func__);
+    }
+    blockFileWriter.Close();
+    undoFileWriter.Close();
 }
 
 bool LoadBlockIndex(std::string& strError)
@@ -3917,9 +4933,6 @@ bool LoadBlockIndex(std::string& strError)
         // needs_init.
 
         LogPrintf("Initializing databases...\n");
-        // Use the provided setting for -txindex in the new database
-        fTxIndex = gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX);
-        pblocktree->WriteFlag("txindex", fTxIndex);
     }
     return true;
 }
@@ -3968,98 +4981,178 @@ bool LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
     stateCatcher.registerEvent();
 
     int nLoaded = 0;
-    try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++;         // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+    // Blocks read ahead (and their disk positions), pre-validated together and then processed in order.
+    // Returns false when a block fails validation (the import stops there).
+    std::vector<std::shared_ptr<const CBlock>> vPending;
+    std::vector<FlatFilePos> vPendingPos;
+    auto processPending = [&]() {
+        PreValidateBlocks(vPending);
+        std::vector<std::shared_ptr<const CBlock>> vBlocks;
+        std::vector<FlatFilePos> vBlocksPos;
+        vBlocks.swap(vPending);
+        vBlocksPos.swap(vPendingPos);
+        for (size_t i = 0; i < vBlocks.size(); i++) {
+            const std::shared_ptr<const CBlock>& block_ptr = vBlocks[i];
+            FlatFilePos* pos = dbp ? &vBlocksPos[i] : nullptr;
+            const uint256& hash = block_ptr->GetHash();
+            CBlockIndex* pindex{nullptr};
+            {
+                LOCK(cs_main);
+                // detect out of order blocks, and store them for later
+                if (hash != Params().GetConsensus().hashGenesisBlock && !LookupBlockIndex(block_ptr->hashPrevBlock)) {
+                    LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
+                            hash.ToString(), block_ptr->hashPrevBlock.ToString());
+                    if (pos)
+                        mapBlocksUnknownParent.emplace(block_ptr->hashPrevBlock, *pos);
                     continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
+                }
+
+                pindex = LookupBlockIndex(hash);
             }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
-                CBlockIndex* pindex{nullptr};
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != Params().GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
-                                hash.ToString(), block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.emplace(block.hashPrevBlock, *dbp);
-                        continue;
-                    }
 
-                    pindex = LookupBlockIndex(hash);
+            // process in case the block isn't known yet
+            if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+                stateCatcher.setBlockHash(hash);
+                if (ProcessNewBlock(block_ptr, pos)) {
+                    nLoaded++;
+                }
+                if (stateCatcher.stateErrorFound()) {
+                    return false;
                 }
+            } else if (hash != Params().GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+                LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+            }
 
-                // process in case the block isn't known yet
-                if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    std::shared_ptr<const CBlock> block_ptr = std::make_shared<const CBlock>(block);
-                    stateCatcher.setBlockHash(block_ptr->GetHash());
-                    if (ProcessNewBlock(block_ptr, dbp)) {
-                        nLoaded++;
-                    }
-                    if (stateCatcher.stateErrorFound()) {
-                        break;
+            // Recursively process earlier encountered successors of this block
+            std::deque<uint256> queue;
+            queue.push_back(hash);
+            while (!queue.empty()) {
+                uint256 head = queue.front();
+                queue.pop_front();
+                std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                while (range.first != range.second) {
+                    std::multimap<uint256, FlatFilePos>::iterator it = range.first;
+                    CBlock block;
+                    if (ReadBlockFromDisk(block, it->second)) {
+                        LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
+                            head.ToString());
+                        std::shared_ptr<const CBlock> child_ptr = std::make_shared<const CBlock>(block);
+                        if (ProcessNewBlock(child_ptr, &it->second)) {
+                            nLoaded++;
+                            queue.emplace_back(block.GetHash());
+                        }
                     }
-                } else if (hash != Params().GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                    LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+                    range.first++;
+                    mapBlocksUnknownParent.erase(it);
                 }
+            }
+        }
+        return true;
+    };
 
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second)) {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
-                                head.ToString());
-                            std::shared_ptr<const CBlock> block_ptr = std::make_shared<const CBlock>(block);
-                            if (ProcessNewBlock(block_ptr, &it->second)) {
-                                nLoaded++;
-                                queue.emplace_back(block.GetHash());
-                            }
+    // The file is read, and its blocks deserialized by the workers, a batch ahead of the validation
+    ctpl::thread_pool workerPool(std::max(1, GetNumCores() - 1));
+    RenameThreadPool(workerPool, "pivx-loadblk");
+
+    try {
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
+        uint64_t nRewind = blkdat.GetPos();
+
+        struct ImportBatch {
+            std::vector<std::shared_ptr<const CBlock>> vBlocks;
+            std::vector<FlatFilePos> vPos;
+            bool fEnd{false};
+        };
+        auto readBatch = [&]() {
+            ImportBatch batch;
+            std::vector<CDataStream> vRaw;
+            std::vector<FlatFilePos> vRawPos;
+            while (vRaw.size() < BLOCK_PREVALIDATION_BATCH && !blkdat.eof()) {
+                blkdat.SetPos(nRewind);
+                nRewind++;         // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+                    blkdat.FindByte(Params().MessageStart()[0]);
+                    nRewind = blkdat.GetPos()+1;
+                    blkdat >> buf;
+                    if (memcmp(buf, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    batch.fEnd = true;
+                    break;
+                }
+                try {
+                    // read block
+                    uint64_t nBlockPos = blkdat.GetPos();
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    blkdat.SetPos(nBlockPos);
+                    CDataStream ss(SER_DISK, CLIENT_VERSION);
+                    ss.resize(nSize);
+                    blkdat.read(ss.data(), nSize);
+                    nRewind = blkdat.GetPos();
+
+                    vRaw.emplace_back(std::move(ss));
+                    vRawPos.emplace_back(dbp ? dbp->nFile : -1, nBlockPos);
+                } catch (const std::exception& e) {
+                    LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+                }
+            }
+            batch.fEnd |= blkdat.eof();
+
+            // Deserialize the blocks (and hash their transactions) on the workers, in contiguous shards
+            std::vector<std::shared_ptr<const CBlock>> vBlocks(vRaw.size());
+            const size_t nShardSize = (vRaw.size() + workerPool.size() - 1) / workerPool.size();
+            std::vector<std::future<void>> futures;
+            for (size_t begin = 0; begin < vRaw.size(); begin += nShardSize) {
+                const size_t end = std::min(begin + nShardSize, vRaw.size());
+                futures.emplace_back(workerPool.push([&vRaw, &vBlocks, begin, end](int threadId) {
+                    for (size_t i = begin; i < end; i++) {
+                        try {
+                            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                            vRaw[i] >> *pblock;
+                            vBlocks[i] = std::move(pblock);
+                        } catch (const std::exception& e) {
+                            LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
                         }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
                     }
-                }
-            } catch (const std::exception& e) {
-                LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+                }));
+            }
+            for (auto& f : futures) {
+                f.get();
+            }
+            for (size_t i = 0; i < vBlocks.size(); i++) {
+                if (!vBlocks[i]) continue;
+                batch.vBlocks.emplace_back(std::move(vBlocks[i]));
+                batch.vPos.emplace_back(vRawPos[i]);
+            }
+            return batch;
+        };
+
+        std::future<ImportBatch> nextBatch = std::async(std::launch::async, readBatch);
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            ImportBatch batch = nextBatch.get();
+            if (!batch.fEnd) {
+                nextBatch = std::async(std::launch::async, readBatch);
+            }
+            vPending = std::move(batch.vBlocks);
+            vPendingPos = std::move(batch.vPos);
+            if (!vPending.empty() && !processPending()) {
+                break;
+            }
+            if (batch.fEnd) {
+                break;
             }
         }
     } catch (const std::runtime_error& e) {
@@ -4106,6 +5199,7 @@ void static CheckBlockIndex()
     int nHeight = 0;
     CBlockIndex* pindexFirstInvalid = nullptr;         // Oldest ancestor of pindex which is invalid.
     CBlockIndex* pindexFirstMissing = nullptr;         // Oldest ancestor of pindex which does not have BLOCK_HAVE_DATA.
+    CBlockIndex* pindexFirstNeverProcessed = nullptr;  // Oldest ancestor of pindex for which nTx == 0.
     CBlockIndex* pindexFirstNotTreeValid = nullptr;    // Oldest ancestor of pindex which does not have BLOCK_VALID_TREE (regardless of being valid or not).
     CBlockIndex* pindexFirstNotChainValid = nullptr;   // Oldest ancestor of pindex which does not have BLOCK_VALID_CHAIN (regardless of being valid or not).
     CBlockIndex* pindexFirstNotScriptsValid = nullptr; // Oldest ancestor of pindex which does not have BLOCK_VALID_SCRIPTS (regardless of being valid or not).
@@ -4113,6 +5207,7 @@ void static CheckBlockIndex()
         nNodes++;
         if (pindexFirstInvalid == nullptr && pindex->nStatus & BLOCK_FAILED_VALID) pindexFirstInvalid = pindex;
         if (pindexFirstMissing == nullptr && !(pindex->nStatus & BLOCK_HAVE_DATA)) pindexFirstMissing = pindex;
+        if (pindexFirstNeverProcessed == nullptr && pindex->nTx == 0) pindexFirstNeverProcessed = pindex;
         if (pindex->pprev != nullptr && pindexFirstNotTreeValid == nullptr && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_TREE) pindexFirstNotTreeValid = pindex;
         if (pindex->pprev != nullptr && pindexFirstNotChainValid == nullptr && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_CHAIN) pindexFirstNotChainValid = pindex;
         if (pindex->pprev != nullptr && pindexFirstNotScriptsValid == nullptr && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) pindexFirstNotScriptsValid = pindex;
@@ -4123,12 +5218,21 @@ void static CheckBlockIndex()
             assert(pindex->GetBlockHash() == Params().GetConsensus().hashGenesisBlock); // Genesis block's hash must match.
             assert(pindex == chainActive.Genesis());                       // The current active chain's genesis block must be this block.
         }
-        // HAVE_DATA is equivalent to VALID_TRANSACTIONS and equivalent to nTx > 0 (we stored the number of transactions in the block)
-        assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
-        assert(((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS) == (pindex->nTx > 0));
         if (pindex->nChainTx == 0) assert(pindex->nSequenceId == 0); // nSequenceId can't be set for blocks that aren't linked
-        // All parents having data is equivalent to all parents being VALID_TRANSACTIONS, which is equivalent to nChainTx being set.
-        assert((pindexFirstMissing != nullptr) == (pindex->nChainTx == 0));                                             // nChainTx == 0 is used to signal that all parent block's transaction data is available.
+        // VALID_TRANSACTIONS is equivalent to nTx > 0 for all nodes (whether or not pruning has occurred).
+        // HAVE_DATA is only equivalent to nTx > 0 (or VALID_TRANSACTIONS) if no pruning has occurred.
+        if (!fHavePruned) {
+            // If we've never pruned, then HAVE_DATA should be equivalent to nTx > 0
+            assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
+            assert(pindexFirstMissing == pindexFirstNeverProcessed);
+        } else {
+            // If we have pruned, then we can only say that HAVE_DATA implies nTx > 0
+            if (pindex->nStatus & BLOCK_HAVE_DATA) assert(pindex->nTx > 0);
+        }
+        if (pindex->nStatus & BLOCK_HAVE_UNDO) assert(pindex->nStatus & BLOCK_HAVE_DATA);
+        assert(((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS) == (pindex->nTx > 0));
+        // All parents having had data (at some point) is equivalent to all parents being VALID_TRANSACTIONS, which is equivalent to nChainTx being set.
+        assert((pindexFirstNeverProcessed != nullptr) == (pindex->nChainTx == 0));                                      // nChainTx != 0 is used to signal that all parent blocks have been processed (but may have been pruned).
         assert(pindex->nHeight == nHeight);                                                                          // nHeight must be consistent.
         assert(pindex->pprev == nullptr || pindex->nChainWork >= pindex->pprev->nChainWork);                            // For every block except the genesis block, the chainwork must be larger than the parent's.
         assert(nHeight < 2 || (pindex->pskip && (pindex->pskip->nHeight < nHeight)));                                // The pskip pointer must point back for all but the first 2 blocks.
@@ -4140,11 +5244,20 @@ void static CheckBlockIndex()
             // Checks for not-invalid blocks.
             assert((pindex->nStatus & BLOCK_FAILED_MASK) == 0); // The failed mask cannot be set for blocks without invalid parents.
         }
-        if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && pindexFirstMissing == nullptr) {
-            if (pindexFirstInvalid == nullptr) { // If this block sorts at least as good as the current tip and is valid, it must be in setBlockIndexCandidates.
-                assert(setBlockIndexCandidates.count(pindex));
+        if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && pindexFirstNeverProcessed == nullptr) {
+            if (pindexFirstInvalid == nullptr) {
+                // If this block sorts at least as good as the current tip and
+                // is valid and we have all data for its parents, it must be in
+                // setBlockIndexCandidates.  chainActive.Tip() must also be there
+                // even if some data has been pruned.
+                if (pindexFirstMissing == nullptr || pindex == chainActive.Tip()) {
+                    assert(setBlockIndexCandidates.count(pindex));
+                }
+                // If some parent is missing, then it could be that this block was in
+                // setBlockIndexCandidates but had to be removed because of the missing data.
+                // In this case it must be in mapBlocksUnlinked -- see test below.
             }
-        } else { // If this block sorts worse than the current tip, it cannot be in setBlockIndexCandidates.
+        } else { // If this block sorts worse than the current tip or some ancestor's block has never been seen, it cannot be in setBlockIndexCandidates.
             assert(setBlockIndexCandidates.count(pindex) == 0);
         }
         // Check whether this block is in mapBlocksUnlinked.
@@ -4158,12 +5271,28 @@ void static CheckBlockIndex()
             }
             rangeUnlinked.first++;
         }
-        if (pindex->pprev && pindex->nStatus & BLOCK_HAVE_DATA && pindexFirstMissing != nullptr) {
-            if (pindexFirstInvalid == nullptr) { // If this block has block data available, some parent doesn't, and has no invalid parents, it must be in mapBlocksUnlinked.
-                assert(foundInUnlinked);
+        if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed != nullptr && pindexFirstInvalid == nullptr) {
+            // If this block has block data available, some parent was never received, and has no invalid parents, it must be in mapBlocksUnlinked.
+            assert(foundInUnlinked);
+        }
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) assert(!foundInUnlinked); // Can't be in mapBlocksUnlinked if we don't HAVE_DATA
+        if (pindexFirstMissing == nullptr) assert(!foundInUnlinked);          // We aren't missing data for any parent -- cannot be in mapBlocksUnlinked.
+        if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed == nullptr && pindexFirstMissing != nullptr) {
+            // We HAVE_DATA for this block, have received data for all parents at some point, but we're currently missing data for some parent.
+            assert(fHavePruned); // We must have pruned.
+            // This block may have entered mapBlocksUnlinked if:
+            //  - it has a descendant that at some point had more work than the
+            //    tip, and
+            //  - we tried switching to that descendant but were missing
+            //    data for some intermediate block between chainActive and the
+            //    tip.
+            // So if this block is itself better than chainActive.Tip() and it wasn't in
+            // setBlockIndexCandidates, then it must be in mapBlocksUnlinked.
+            if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && setBlockIndexCandidates.count(pindex) == 0) {
+                if (pindexFirstInvalid == nullptr) {
+                    assert(foundInUnlinked);
+                }
             }
-        } else { // If this block does not have block data available, or all parents do, it cannot be in mapBlocksUnlinked.
-            assert(!foundInUnlinked);
         }
         // assert(pindex->GetBlockHash() == pindex->GetBlockHeader().GetHash()); // Perhaps too slow
         // End: actual consistency checks.
@@ -4183,6 +5312,7 @@ void static CheckBlockIndex()
             // If pindex was the first with a certain property, unset the corresponding variable.
             if (pindex == pindexFirstInvalid) pindexFirstInvalid = nullptr;
             if (pindex == pindexFirstMissing) pindexFirstMissing = nullptr;
+            if (pindex == pindexFirstNeverProcessed) pindexFirstNeverProcessed = nullptr;
             if (pindex == pindexFirstNotTreeValid) pindexFirstNotTreeValid = nullptr;
             if (pindex == pindexFirstNotChainValid) pindexFirstNotChainValid = nullptr;
             if (pindex == pindexFirstNotScriptsValid) pindexFirstNotScriptsValid = nullptr;
@@ -4241,6 +5371,8 @@ CBlockFileInfo* GetBlockFileInfo(size_t n)
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+// Number of txs of mempool.dat read and accepted under a single cs_main lock
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 100;
 
 bool LoadMempool(CTxMemPool& pool)
 {
@@ -4265,29 +5397,48 @@ bool LoadMempool(CTxMemPool& pool)
         }
         uint64_t num;
         file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+        while (num) {
+            // Read a batch of txs, then accept them at once: the mempool is limited, and the
+            // coins cache flushed if needed, once per batch instead of once per tx.
+            std::vector<std::pair<CTransactionRef, int64_t>> vBatch;
+            while (num && vBatch.size() < MEMPOOL_LOAD_BATCH_SIZE) {
+                num--;
+                CTransactionRef tx;
+                int64_t nTime;
+                int64_t nFeeDelta;
+                file >> tx;
+                file >> nTime;
+                file >> nFeeDelta;
+
+                CAmount amountdelta = nFeeDelta;
+                if (amountdelta) {
+                    pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+                }
+                if (nTime + nExpiryTimeout > nNow) {
+                    vBatch.emplace_back(tx, nTime);
+                } else {
+                    ++skipped;
+                }
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
+
+            if (!vBatch.empty()) {
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(pool, state, tx, true, nullptr, nTime);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    ++failed;
+                for (const auto& it : vBatch) {
+                    CValidationState state;
+                    std::vector<COutPoint> coins_to_uncache;
+                    if (AcceptToMemoryPoolWorker(pool, state, it.first, true, nullptr, it.second,
+                                                 true /* fOverrideMempoolLimit */, false, false, coins_to_uncache)) {
+                        ++count;
+                    } else {
+                        ++failed;
+                        for (const COutPoint& outpoint : coins_to_uncache) {
+                            pcoinsTip->Uncache(outpoint);
+                        }
+                    }
                 }
-            } else {
-                ++skipped;
+                LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, nExpiryTimeout);
+                CValidationState stateDummy;
+                FlushStateToDisk(stateDummy, FLUSH_STATE_PERIODIC);
             }
             if (ShutdownRequested())
                 return false;
@@ -4307,6 +5458,47 @@ bool LoadMempool(CTxMemPool& pool)
     return true;
 }
 
+ValidationTimings GetValidationTimings()
+{
+    AssertLockHeld(cs_main);
+    ValidationTimings timings;
+    timings.nBlocksConnected = nBlocksConnected;
+    timings.nTimeReadFromDisk = nTimeReadFromDisk;
+    timings.nTimeConnect = nTimeConnect;
+    timings.nTimeVerify = nTimeVerify;
+    timings.nTimeProcessSpecial = nTimeProcessSpecial;
+    timings.nTimeIndex = nTimeIndex;
+    timings.nTimeConnectTotal = nTimeConnectTotal;
+    timings.nTimeFlush = nTimeFlush;
+    timings.nTimeChainState = nTimeChainState;
+    timings.nTimePostConnect = nTimePostConnect;
+    timings.nTimeTotal = nTimeTotal;
+    return timings;
+}
+
+std::vector<BlockValidationProfile> GetBlockValidationProfiles()
+{
+    AssertLockHeld(cs_main);
+    return std::vector<BlockValidationProfile>(g_block_profiles.begin(), g_block_profiles.end());
+}
+
+const std::vector<std::pair<const char*, int64_t BlockValidationProfile::*>> vBlockProfileSteps = {
+    {"read_from_disk", &BlockValidationProfile::nTimeReadFromDisk},
+    {"check_block", &BlockValidationProfile::nTimeCheckBlock},
+    {"connect", &BlockValidationProfile::nTimeConnect},
+    {"payments", &BlockValidationProfile::nTimePayments},
+    {"verify", &BlockValidationProfile::nTimeVerify},
+    {"sapling_proofs", &BlockValidationProfile::nTimeSaplingProofs},
+    {"process_special", &BlockValidationProfile::nTimeProcessSpecial},
+    {"quorums", &BlockValidationProfile::nTimeQuorums},
+    {"index", &BlockValidationProfile::nTimeIndex},
+    {"connect_total", &BlockValidationProfile::nTimeConnectTotal},
+    {"flush", &BlockValidationProfile::nTimeFlush},
+    {"chainstate", &BlockValidationProfile::nTimeChainState},
+    {"post_connect", &BlockValidationProfile::nTimePostConnect},
+    {"total", &BlockValidationProfile::nTimeTotal},
+};
+
 bool DumpMempool(const CTxMemPool& pool)
 {
     int64_t start = GetTimeMicros();
@@ -4371,8 +5563,9 @@ public:
         // block headers
         BlockMap::iterator it1 = mapBlockIndex.begin();
         for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
+            if (!blockIndexArena.Contains((*it1).second)) delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
     }
 } instance_of_cmaincleanup;
 
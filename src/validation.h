@@ -40,8 +40,10 @@
 class AccumulatorCache;
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CBudgetManager;
 class CCoinsViewDB;
+class CFrozenSerialIndex;
 class CZerocoinDB;
 class CSporkDB;
 class CBloomFilter;
@@ -49,6 +51,7 @@ class CInv;
 class CConnman;
 class CNode;
 class CScriptCheck;
+namespace SaplingValidation { class BatchValidator; }
 
 struct PrecomputedTransactionData;
 
@@ -66,8 +69,12 @@ static const unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
 static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 101;
 /** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
 static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 72;
+/** Default for -mempoolclustereviction */
+static const bool DEFAULT_MEMPOOL_CLUSTER_EVICTION = false;
 /** Default for -txindex */
 static const bool DEFAULT_TXINDEX = true;
+/** Maximum number of blocks, connected but not indexed yet, that GetTransaction scans when the txindex misses */
+static const int TXINDEX_MAX_PENDING_SCAN = 16;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 /** The maximum size for transactions we're willing to relay/mine */
 static const unsigned int MAX_STANDARD_TX_SIZE = 100000;
@@ -87,6 +94,14 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Number of threads reading the inputs of a block from the coins database at once, before connecting it */
+static const int COINS_PREFETCH_THREADS = 8;
+/** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
+static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
+/** Require that user allocate at least 550MiB for block & undo files (blk???.dat and rev???.dat) */
+static const uint64_t MIN_DISK_SPACE_FOR_BLOCK_FILES = 550 * 1024 * 1024;
+/** Number of blocks read ahead by the block import, to verify their signatures in parallel */
+static const unsigned int BLOCK_PREVALIDATION_BATCH = 16;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -94,6 +109,10 @@ static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached their tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 2000;
+/** Number of the branches of PoS header-only entries a peer can fork off the block index. */
+static const int MAX_HEADERS_BRANCHES_PER_PEER = 8;
+/** Number of PoS header-only entries a branch can have off the chain of headers a peer extends. */
+static const int MAX_HEADERS_BRANCH_LENGTH = MAX_HEADERS_RESULTS;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
@@ -103,6 +122,10 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Minimum time between the writes of the coins cache when blocks are chainlocked, in seconds */
+static const unsigned int FINALIZED_FLUSH_INTERVAL = 10 * 60;
+/** Default for -chainlockfinality */
+static const bool DEFAULT_CHAINLOCK_FINALITY = true;
 /** Average delay between local address broadcasts */
 static constexpr std::chrono::hours AVG_LOCAL_ADDRESS_BROADCAST_INTERVAL{24};
 /** Average delay between peer address broadcasts */
@@ -111,6 +134,8 @@ static constexpr std::chrono::seconds AVG_ADDRESS_BROADCAST_INTERVAL{30};
 static const unsigned int DEFAULT_SHIELDEDTXFEE_K = 100;
 /** Enable bloom filter */
  static const bool DEFAULT_PEERBLOOMFILTERS = true;
+/** Serve the compact block filters (BIP 157) */
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
 /** If the tip is older than this (in seconds), the node is considered to be in initial block download. */
 static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 /** Maximum age of our tip in seconds for us to be considered current for fee estimation */
@@ -140,9 +165,16 @@ extern int64_t g_best_block_time;
 extern std::atomic<bool> fImporting;
 extern std::atomic<bool> fReindex;
 extern int nScriptCheckThreads;
-extern bool fTxIndex;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
+/** True if any block files have ever been pruned. */
+extern bool fHavePruned;
+/** True if we're running in -prune mode. */
+extern bool fPruneMode;
+/** Number of MiB of block files that we're trying to stay below. */
+extern uint64_t nPruneTarget;
+/** Block hash whose ancestors we will assume to have valid scripts and Sapling proofs without checking them. */
+extern uint256 hashAssumeValid;
 extern size_t nCoinCacheUsage;
 extern CFeeRate minRelayTxFee;
 extern int64_t nMaxTipAge;
@@ -190,6 +222,8 @@ bool LoadGenesisBlock();
 bool LoadBlockIndex(std::string& strError) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Update the chain tip based on database information. */
 bool LoadChainTip(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/** Set MoneySupply to the transparent supply of the chain tip, computing it from the coins if unknown */
+void LoadMoneySupply() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Unload database information */
 void UnloadBlockIndex();
 /** See whether the protocol update is enforced for connected nodes */
@@ -215,7 +249,21 @@ CAmount GetBlockValue(int nHeight);
 CBlockIndex* InsertBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
+/** Prune block files and flush state to disk. */
+void PruneAndFlush();
 
+/** Calculate the amount of disk space the block & undo files currently use */
+uint64_t CalculateCurrentUsage();
+/** Mark one block file as pruned: its blocks lose their data and undo in the block index */
+void PruneOneBlockFile(const int fileNumber) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/** Actually unlink the specified files */
+void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
+/** The depth below the tip under which the blocks can be pruned: enough to disconnect any block of a reorg */
+int GetPruneKeepDepth();
+
+
+/** Expire the transactions older than age seconds, and trim the mempool below limit bytes */
+void LimitMempoolSize(CTxMemPool& pool, size_t limit, unsigned long age) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransactionRef& tx, bool fLimitFree,
@@ -227,6 +275,19 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
                                 bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit = false,
                                 bool fRejectInsaneFee = false, bool ignoreFees = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** Maximum number of transactions in a package submitted with AcceptPackageToMemoryPool */
+static const unsigned int MAX_PACKAGE_COUNT = DEFAULT_ANCESTOR_LIMIT;
+
+/**
+ * (try to) add a package of transactions to memory pool, in a single pass under cs_main.
+ * The package must be sorted: the parents of a transaction come before it. The state is set
+ * for the failures of the whole package (in which case nothing is accepted), vTxStates holds
+ * the result of each transaction. The transactions already in the mempool are left there.
+ * Returns true if every transaction is in the mempool.
+ */
+bool AcceptPackageToMemoryPool(CTxMemPool& pool, CValidationState& state, const std::vector<CTransactionRef>& package,
+                               std::vector<CValidationState>& vTxStates, bool fRejectInsaneFee = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 CAmount GetMinRelayFee(const CTransaction& tx, const CTxMemPool& pool, unsigned int nBytes);
 CAmount GetMinRelayFee(unsigned int nBytes);
 /**
@@ -256,6 +317,9 @@ bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsVi
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight, bool fSkipInvalid = false);
 
+/** Whether the fraudulent outputs (see invalid.h) are kept out of the UTXO set for a block at nHeight */
+bool SkipInvalidUTXOS(int nHeight);
+
 /**
  * Check if transaction will be final in the next block to be created.
  *
@@ -308,11 +372,147 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the batch verification of the Sapling proofs of
+ * a set of transactions (see SaplingValidation::BatchValidator).
+ */
+class CSaplingProofCheck
+{
+private:
+    std::shared_ptr<SaplingValidation::BatchValidator> batch;
+
+public:
+    CSaplingProofCheck() {}
+    explicit CSaplingProofCheck(std::shared_ptr<SaplingValidation::BatchValidator> batchIn) : batch(std::move(batchIn)) {}
+
+    bool operator()();
+
+    void swap(CSaplingProofCheck& check)
+    {
+        std::swap(batch, check.batch);
+    }
+};
+
+/**
+ * Closure representing the verification of the signature of a PoS block,
+ * storing it in the signature cache (see PreValidateBlocks).
+ */
+class CBlockSignatureCheck
+{
+private:
+    std::shared_ptr<const CBlock> block;
+
+public:
+    CBlockSignatureCheck() {}
+    explicit CBlockSignatureCheck(std::shared_ptr<const CBlock> blockIn) : block(std::move(blockIn)) {}
+
+    bool operator()();
+
+    void swap(CBlockSignatureCheck& check)
+    {
+        std::swap(block, check.block);
+    }
+};
+
+/**
+ * Check run by the parallel block verification queue:
+ * a script check, a Sapling proof batch check or a block signature check.
+ */
+class CBlockCheck
+{
+private:
+    enum class Type {SCRIPT, SAPLING, BLOCK_SIGNATURE};
+
+    CScriptCheck scriptCheck;
+    CSaplingProofCheck saplingCheck;
+    CBlockSignatureCheck blockSignatureCheck;
+    Type type{Type::SCRIPT};
+
+public:
+    CBlockCheck() {}
+    explicit CBlockCheck(CScriptCheck& check) { scriptCheck.swap(check); }
+    explicit CBlockCheck(CSaplingProofCheck& check) : type(Type::SAPLING) { saplingCheck.swap(check); }
+    explicit CBlockCheck(CBlockSignatureCheck& check) : type(Type::BLOCK_SIGNATURE) { blockSignatureCheck.swap(check); }
+
+    bool operator()()
+    {
+        switch (type) {
+            case Type::SAPLING: return saplingCheck();
+            case Type::BLOCK_SIGNATURE: return blockSignatureCheck();
+            default: return scriptCheck();
+        }
+    }
+
+    void swap(CBlockCheck& check)
+    {
+        scriptCheck.swap(check.scriptCheck);
+        saplingCheck.swap(check.saplingCheck);
+        blockSignatureCheck.swap(check.blockSignatureCheck);
+        std::swap(type, check.type);
+    }
+};
+
+/**
+ * Verify, on the script check threads, the signatures of the PoS blocks of vBlocks
+ * and of their coinstake inputs (when the stake prevout is in the batch or in the
+ * coins of the tip), to have them in the signature cache when the blocks are processed.
+ * If fSaplingProofs, the Sapling proofs of the blocks are verified too, and stored in
+ * the proof cache.
+ * This only warms the caches: ProcessNewBlock still runs every check, in order.
+ */
+void PreValidateBlocks(const std::vector<std::shared_ptr<const CBlock>>& vBlocks, bool fSaplingProofs = false);
+
+/**
+ * Load in the coins cache the inputs and the sapling nullifiers of the blocks, read from the
+ * coins database without holding cs_main (e.g. while the previous blocks are connected).
+ * The outputs created by the blocks themselves are skipped.
+ */
+void PrefetchBlocksInputs(const std::vector<std::shared_ptr<const CBlock>>& vBlocks);
+
+
+/** Default for -asyncblockwrites */
+static const bool DEFAULT_ASYNC_BLOCK_WRITES = true;
+/**
+ * Start the threads writing the block and undo files (-asyncblockwrites): WriteBlockToDisk and the
+ * undo writes of ConnectBlock queue the data then, read from the queues until it is written, and the
+ * flushes of the block files wait for it. Otherwise the data is written right away.
+ */
+void StartBlockFileWriters();
+/** Write the data left in the queues, then stop the threads */
+void StopBlockFileWriters();
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos);
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/** Read the serialized block at pos, written or still in the write queue */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const FlatFilePos& pos);
+/**
+ * Read the block of pindex, kept in the cache of the recent blocks shared by the peers, RPC, REST and ZMQ
+ * (nullptr on failure). ReadBlockFromDisk also finds the blocks of the cache, but doesn't add to it.
+ */
+std::shared_ptr<const CBlock> ReadSharedBlockFromDisk(const CBlockIndex* pindex);
+/** Read the block of pindex as serialized in the block file, through the same cache (nullptr on failure) */
+std::shared_ptr<const std::vector<unsigned char>> ReadRawBlockFromDisk(const CBlockIndex* pindex);
+/** Read the undo data at pos of the block on top of hashBlock (its previous block) */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const FlatFilePos& pos, const uint256& hashBlock);
+
+/**
+ * Number of the recent blocks kept in memory, out of the initial download: the last connected ones
+ * with their undo data, and the ones received on the other chains. ReadBlockFromDisk,
+ * ReadSharedBlockFromDisk and the disconnection of the blocks find them there.
+ */
+static const size_t RECENT_BLOCKS_RING_SIZE = 16;
+/** Serialized size of the recent blocks and of their undo data */
+size_t RecentBlocksMemoryUsage();
+void ClearRecentBlocks();
+/**
+ * The block pindex of the active chain is chainlocked: it and its ancestors can't be disconnected
+ * anymore (-chainlockfinality). Drops the undo data of the recent blocks up to it, the recent blocks
+ * of the other chains below it and the spends kept for the fork checks, then writes the dirty coins
+ * back if the cache is large.
+ */
+void FinalizeChainLockedBlock(const CBlockIndex* pindex);
 
 
 /** Functions for validating blocks and updating the block tree */
@@ -330,6 +530,9 @@ bool TestBlockValidity(CValidationState& state, const CBlock& block, CBlockIndex
 
 bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex** ppindex = nullptr, CBlockIndex* pindexPrev = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** Returns the highest checkpoint in the block index, or nullptr */
+const CBlockIndex* GetLastCheckpoint() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 
 /** RAII wrapper for VerifyDB: Verify consistency of the block and coin databases */
 class CVerifyDB
@@ -377,6 +580,9 @@ extern std::unique_ptr<CZerocoinDB> zerocoinDB;
 /** In-memory cache for the zerocoin accumulators */
 extern std::unique_ptr<AccumulatorCache> accumulatorCache;
 
+/** Read-only index of the zPIV spends, once the zerocoin era is final (protected by cs_main) */
+extern std::unique_ptr<CFrozenSerialIndex> frozenSerials;
+
 /** Global variable that points to the spork database (protected by cs_main) */
 extern std::unique_ptr<CSporkDB> pSporkDB;
 
@@ -407,6 +613,58 @@ static const unsigned int REJECT_CONFLICT = 0x102;
 /** Get block file info entry for one block file */
 CBlockFileInfo* GetBlockFileInfo(size_t n);
 
+/** The cumulated durations of the steps of the block connections, in microseconds */
+struct ValidationTimings
+{
+    int64_t nBlocksConnected{0};
+    int64_t nTimeReadFromDisk{0};
+    int64_t nTimeConnect{0};      //! transactions connected, scripts checks queued
+    int64_t nTimeVerify{0};       //! connect and script checks
+    int64_t nTimeProcessSpecial{0};
+    int64_t nTimeIndex{0};
+    int64_t nTimeConnectTotal{0};
+    int64_t nTimeFlush{0};
+    int64_t nTimeChainState{0};
+    int64_t nTimePostConnect{0};
+    int64_t nTimeTotal{0};
+};
+
+/** The timings of the block connections since the start */
+ValidationTimings GetValidationTimings() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/** Number of the last connected blocks whose validation profile is kept */
+static const size_t BLOCK_PROFILE_HISTORY = 100;
+
+/** The durations of the steps of the connection of a block to the tip, in microseconds */
+struct BlockValidationProfile
+{
+    uint256 hash;
+    int nHeight{0};
+    int64_t nTimeConnected{0};    //! unix time of the connection
+    unsigned int nTx{0};
+    int nInputs{0};
+    int64_t nTimeReadFromDisk{0}; //! block and inputs loaded
+    int64_t nTimeCheckBlock{0};   //! context-free checks, with the PoS block signature
+    int64_t nTimeConnect{0};      //! transactions connected, scripts checks queued
+    int64_t nTimePayments{0};     //! block value, masternode/budget payee and coinbase checks
+    int64_t nTimeVerify{0};       //! connect, payments and the wait for the script and Sapling checks
+    int64_t nTimeSaplingProofs{0};//! Sapling proofs verification, summed over the workers
+    int64_t nTimeProcessSpecial{0};
+    int64_t nTimeQuorums{0};      //! LLMQ commitments, part of the special txes
+    int64_t nTimeIndex{0};
+    int64_t nTimeConnectTotal{0};
+    int64_t nTimeFlush{0};
+    int64_t nTimeChainState{0};
+    int64_t nTimePostConnect{0};
+    int64_t nTimeTotal{0};
+};
+
+/** The validation profiles of the last connected blocks, the most recent last */
+std::vector<BlockValidationProfile> GetBlockValidationProfiles() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/** The steps of the block validation profiles, by name */
+extern const std::vector<std::pair<const char*, int64_t BlockValidationProfile::*>> vBlockProfileSteps;
+
 /** Dump the mempool to disk. */
 bool DumpMempool(const CTxMemPool& pool);
 
@@ -6,44 +6,155 @@
 
 #include "validationinterface.h"
 
+#include "budget/budgetvote.h"
+#include "budget/finalizedbudgetvote.h"
 #include "chain.h"
 #include "consensus/validation.h"
 #include "evo/deterministicmns.h"
+#include "llmq/quorums_chainlocks.h"
+#include "llmq/quorums_signing.h"
 #include "logging.h"
 #include "scheduler.h"
+#include "util/system.h"
 #include "util/validation.h"
 #include "validation.h" // cs_main
 
+#include <deque>
 #include <future>
 #include <list>
+#include <thread>
 #include <unordered_map>
 #include <boost/signals2/signal.hpp>
 
 struct ValidationInterfaceConnections {
     boost::signals2::scoped_connection AcceptedBlockHeader;
     boost::signals2::scoped_connection UpdatedBlockTip;
-    boost::signals2::scoped_connection TransactionAddedToMempool;
-    boost::signals2::scoped_connection BlockConnected;
+    boost::signals2::scoped_connection TransactionsAddedToMempool;
+    boost::signals2::scoped_connection BlocksConnected;
     boost::signals2::scoped_connection BlockDisconnected;
     boost::signals2::scoped_connection TransactionRemovedFromMempool;
     boost::signals2::scoped_connection SetBestChain;
     boost::signals2::scoped_connection Broadcast;
     boost::signals2::scoped_connection BlockChecked;
     boost::signals2::scoped_connection NotifyMasternodeListChanged;
+    boost::signals2::scoped_connection NotifyChainLock;
+    boost::signals2::scoped_connection NotifyRecoveredSig;
+    boost::signals2::scoped_connection NotifyProposalVote;
+    boost::signals2::scoped_connection NotifyFinalizedBudgetVote;
 };
 
+/**
+ * The queue of the callbacks of a subscriber registered with its own queue, run in order on its
+ * own thread: the background scheduler thread only hands the notifications over, so that a slow
+ * subscriber (a wallet) delays neither the other subscribers nor the next notifications, and
+ * several of them process the notifications in parallel.
+ * The callbacks pending when the thread wakes up are run as a batch, in which a SetBestChain
+ * notification superseded by a later one is skipped: the subscribers only persist the last locator.
+ */
+class SubscriberQueue
+{
+private:
+    struct Callback {
+        std::function<void()> func;
+        bool fSetBestChain;
+    };
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Callback> m_callbacks GUARDED_BY(m_mutex);
+    bool m_running GUARDED_BY(m_mutex){false};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+
+    void Run()
+    {
+        while (true) {
+            std::deque<Callback> batch;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_running = false;
+                m_cond.notify_all();
+                m_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_callbacks.empty(); });
+                if (m_callbacks.empty()) return;
+                batch.swap(m_callbacks);
+                m_running = true;
+            }
+            bool fLaterSetBestChain = false;
+            for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+                if (it->fSetBestChain) {
+                    if (fLaterSetBestChain) it->func = nullptr;
+                    fLaterSetBestChain = true;
+                }
+            }
+            for (const Callback& callback : batch) {
+                if (callback.func) callback.func();
+            }
+        }
+    }
+
+public:
+    explicit SubscriberQueue(const std::string& name)
+    {
+        m_thread = std::thread(&TraceThread<std::function<void()>>, name, std::bind(&SubscriberQueue::Run, this));
+    }
+
+    ~SubscriberQueue() { Stop(); }
+
+    // Runs the pending callbacks, and joins the thread. The callbacks added later are dropped.
+    // The connections of the signals hold the queue too, so it must not wait for its destruction.
+    void Stop()
+    {
+        assert(std::this_thread::get_id() != m_thread.get_id());
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_cond.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    void Add(std::function<void()> func, bool fSetBestChain = false)
+    {
+        {
+            LOCK(m_mutex);
+            if (m_stop) return;
+            m_callbacks.push_back({std::move(func), fSetBestChain});
+        }
+        m_cond.notify_all();
+    }
+
+    size_t CallbacksPending()
+    {
+        LOCK(m_mutex);
+        return m_callbacks.size() + (m_running ? 1 : 0);
+    }
+
+    // Blocks until the callbacks added before the call have run
+    void Sync()
+    {
+        if (std::this_thread::get_id() == m_thread.get_id()) return;
+        WAIT_LOCK(m_mutex, lock);
+        m_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_callbacks.empty() && !m_running; });
+    }
+};
+
+//! Maximum number of blocks, and of transactions, delivered in one batch
+static const size_t MAX_BATCHED_BLOCKS = 32;
+static const size_t MAX_BATCHED_TRANSACTIONS = 1000;
+
+//! The lowest of two fork blocks, they are both on the chain of the last tip (nullptr with no common block)
+static const CBlockIndex* LowestFork(const CBlockIndex* pindexA, const CBlockIndex* pindexB)
+{
+    if (!pindexA || !pindexB) return nullptr;
+    return pindexA->nHeight <= pindexB->nHeight ? pindexA : pindexB;
+}
+
 struct MainSignalsInstance {
     /** Notifies listeners of accepted block header */
     boost::signals2::signal<void(const CBlockIndex*)> AcceptedBlockHeader;
     /** Notifies listeners of updated block chain tip */
     boost::signals2::signal<void (const CBlockIndex *, const CBlockIndex *, bool fInitialDownload)> UpdatedBlockTip;
-    /** Notifies listeners of a transaction having been added to mempool. */
-    boost::signals2::signal<void (const CTransactionRef &)> TransactionAddedToMempool;
-    /**
-     * Notifies listeners of a block being connected.
-     * Provides a vector of transactions evicted from the mempool as a result.
-     */
-    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex)> BlockConnected;
+    /** Notifies listeners of a batch of transactions having been added to mempool. */
+    boost::signals2::signal<void (const std::vector<CTransactionRef>&)> TransactionsAddedToMempool;
+    /** Notifies listeners of a batch of blocks being connected. */
+    boost::signals2::signal<void (const std::vector<ConnectedBlock>&)> BlocksConnected;
     /** Notifies listeners of a block being disconnected */
     boost::signals2::signal<void (const std::shared_ptr<const CBlock> &, const uint256& blockHash, int nBlockHeight, int64_t blockTime)> BlockDisconnected;
     /** Notifies listeners of a transaction removal from the mempool */
@@ -56,15 +167,57 @@ struct MainSignalsInstance {
     boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
     /** Notifies listeners of updated deterministic masternode list */
     boost::signals2::signal<void (bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)> NotifyMasternodeListChanged;
+    /** Notifies listeners of a new best chainlock */
+    boost::signals2::signal<void (const CBlockIndex* pindex, const llmq::CChainLockSig& clsig)> NotifyChainLock;
+    /** Notifies listeners of a new recovered LLMQ signature */
+    boost::signals2::signal<void (const std::shared_ptr<const llmq::CRecoveredSig>& recoveredSig)> NotifyRecoveredSig;
+    /** Notifies listeners of a vote on a budget proposal */
+    boost::signals2::signal<void (const CBudgetVote& vote)> NotifyProposalVote;
+    /** Notifies listeners of a vote on a finalized budget */
+    boost::signals2::signal<void (const CFinalizedBudgetVote& vote)> NotifyFinalizedBudgetVote;
 
     std::unordered_map<CValidationInterface*, ValidationInterfaceConnections> m_connMainSignals;
 
+    /** The queues of the subscribers registered with their own queue */
+    Mutex m_mutex_queues;
+    std::unordered_map<CValidationInterface*, std::shared_ptr<SubscriberQueue>> m_subscriberQueues GUARDED_BY(m_mutex_queues);
+
+    std::vector<std::shared_ptr<SubscriberQueue>> GetSubscriberQueues()
+    {
+        LOCK(m_mutex_queues);
+        std::vector<std::shared_ptr<SubscriberQueue>> vQueues;
+        for (const auto& it : m_subscriberQueues) vQueues.emplace_back(it.second);
+        return vQueues;
+    }
+
     // We are not allowed to assume the scheduler only runs in one thread,
     // but must ensure all callbacks happen in-order, so we end up creating
     // our own queue here :(
     SingleThreadedSchedulerClient m_schedulerClient;
 
+    /**
+     * The state of the queued events that later ones can join: the last queued batch of connected
+     * blocks, or of transactions added to the mempool, while it is not delivered, and the last
+     * queued tip, superseded by the next one when they are both in the initial block download.
+     */
+    Mutex m_mutex_pending;
+    std::shared_ptr<std::vector<ConnectedBlock>> m_openBlocks GUARDED_BY(m_mutex_pending);
+    std::shared_ptr<std::vector<CTransactionRef>> m_openTransactions GUARDED_BY(m_mutex_pending);
+    std::shared_ptr<bool> m_lastTipSuperseded GUARDED_BY(m_mutex_pending);
+    bool m_fLastTipInIBD GUARDED_BY(m_mutex_pending){false};
+    //! The lowest fork block of the skipped tips, handed over to the next delivered one
+    bool m_fSkippedTip GUARDED_BY(m_mutex_pending){false};
+    const CBlockIndex* m_pindexSkippedFork GUARDED_BY(m_mutex_pending){nullptr};
+
     explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+
+    // Queue an event, the open batches can't be joined anymore, to keep the events in order
+    void Enqueue(std::function<void()> func) EXCLUSIVE_LOCKS_REQUIRED(m_mutex_pending)
+    {
+        m_openBlocks.reset();
+        m_openTransactions.reset();
+        m_schedulerClient.AddToProcessQueue(std::move(func));
+    }
 };
 
 static CMainSignals g_signals;
@@ -81,12 +234,24 @@ void CMainSignals::UnregisterBackgroundSignalScheduler() {
 void CMainSignals::FlushBackgroundCallbacks() {
     if (m_internals) {
         m_internals->m_schedulerClient.EmptyQueue();
+        SyncSubscriberQueues();
+    }
+}
+
+void CMainSignals::SyncSubscriberQueues() {
+    if (!m_internals) return;
+    for (const auto& queue : m_internals->GetSubscriberQueues()) {
+        queue->Sync();
     }
 }
 
 size_t CMainSignals::CallbacksPending() {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    size_t nPending = m_internals->m_schedulerClient.CallbacksPending();
+    for (const auto& queue : m_internals->GetSubscriberQueues()) {
+        nPending += queue->CallbacksPending();
+    }
+    return nPending;
 }
 
 CMainSignals& GetMainSignals()
@@ -94,25 +259,82 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
-void RegisterValidationInterface(CValidationInterface* pwalletIn)
+void RegisterValidationInterface(CValidationInterface* pwalletIn, bool fOwnQueue)
 {
     ValidationInterfaceConnections& conns = g_signals.m_internals->m_connMainSignals[pwalletIn];
+    if (fOwnQueue) {
+        // The background notifications are handed over to the queue of the subscriber, the
+        // synchronous ones are still delivered on the calling thread.
+        std::shared_ptr<SubscriberQueue> queue = std::make_shared<SubscriberQueue>("notify");
+        WITH_LOCK(g_signals.m_internals->m_mutex_queues, g_signals.m_internals->m_subscriberQueues[pwalletIn] = queue);
+        conns.AcceptedBlockHeader = g_signals.m_internals->AcceptedBlockHeader.connect([queue, pwalletIn](const CBlockIndex* pindexNew) {
+            queue->Add([pwalletIn, pindexNew] { pwalletIn->AcceptedBlockHeader(pindexNew); });
+        });
+        conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect([queue, pwalletIn](const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) {
+            queue->Add([pwalletIn, pindexNew, pindexFork, fInitialDownload] { pwalletIn->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload); });
+        });
+        conns.TransactionsAddedToMempool = g_signals.m_internals->TransactionsAddedToMempool.connect([queue, pwalletIn](const std::vector<CTransactionRef>& vtx) {
+            queue->Add([pwalletIn, vtx] { pwalletIn->TransactionsAddedToMempool(vtx); });
+        });
+        conns.BlocksConnected = g_signals.m_internals->BlocksConnected.connect([queue, pwalletIn](const std::vector<ConnectedBlock>& blocks) {
+            queue->Add([pwalletIn, blocks] { pwalletIn->BlocksConnected(blocks); });
+        });
+        conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect([queue, pwalletIn](const std::shared_ptr<const CBlock>& pblock, const uint256& blockHash, int nBlockHeight, int64_t blockTime) {
+            queue->Add([pwalletIn, pblock, blockHash, nBlockHeight, blockTime] { pwalletIn->BlockDisconnected(pblock, blockHash, nBlockHeight, blockTime); });
+        });
+        conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect([queue, pwalletIn](const CTransactionRef& ptx, MemPoolRemovalReason reason) {
+            queue->Add([pwalletIn, ptx, reason] { pwalletIn->TransactionRemovedFromMempool(ptx, reason); });
+        });
+        conns.SetBestChain = g_signals.m_internals->SetBestChain.connect([queue, pwalletIn](const CBlockLocator& locator) {
+            queue->Add([pwalletIn, locator] { pwalletIn->SetBestChain(locator); }, true);
+        });
+        conns.Broadcast = g_signals.m_internals->Broadcast.connect(std::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, std::placeholders::_1));
+        conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+        conns.NotifyMasternodeListChanged = g_signals.m_internals->NotifyMasternodeListChanged.connect(std::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+        conns.NotifyChainLock = g_signals.m_internals->NotifyChainLock.connect([queue, pwalletIn](const CBlockIndex* pindex, const llmq::CChainLockSig& clsig) {
+            queue->Add([pwalletIn, pindex, clsig] { pwalletIn->NotifyChainLock(pindex, clsig); });
+        });
+        conns.NotifyRecoveredSig = g_signals.m_internals->NotifyRecoveredSig.connect([queue, pwalletIn](const std::shared_ptr<const llmq::CRecoveredSig>& recoveredSig) {
+            queue->Add([pwalletIn, recoveredSig] { pwalletIn->NotifyRecoveredSig(recoveredSig); });
+        });
+        conns.NotifyProposalVote = g_signals.m_internals->NotifyProposalVote.connect([queue, pwalletIn](const CBudgetVote& vote) {
+            queue->Add([pwalletIn, vote] { pwalletIn->NotifyProposalVote(vote); });
+        });
+        conns.NotifyFinalizedBudgetVote = g_signals.m_internals->NotifyFinalizedBudgetVote.connect([queue, pwalletIn](const CFinalizedBudgetVote& vote) {
+            queue->Add([pwalletIn, vote] { pwalletIn->NotifyFinalizedBudgetVote(vote); });
+        });
+        return;
+    }
     conns.AcceptedBlockHeader = g_signals.m_internals->AcceptedBlockHeader.connect(std::bind(&CValidationInterface::AcceptedBlockHeader, pwalletIn, std::placeholders::_1));
     conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, std::placeholders::_1));
-    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(std::bind(&CValidationInterface::BlockConnected, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+    conns.TransactionsAddedToMempool = g_signals.m_internals->TransactionsAddedToMempool.connect(std::bind(&CValidationInterface::TransactionsAddedToMempool, pwalletIn, std::placeholders::_1));
+    conns.BlocksConnected = g_signals.m_internals->BlocksConnected.connect(std::bind(&CValidationInterface::BlocksConnected, pwalletIn, std::placeholders::_1));
     conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
     conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, std::placeholders::_1, std::placeholders::_2));
     conns.SetBestChain = g_signals.m_internals->SetBestChain.connect(std::bind(&CValidationInterface::SetBestChain, pwalletIn, std::placeholders::_1));
     conns.Broadcast = g_signals.m_internals->Broadcast.connect(std::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, std::placeholders::_1));
     conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
     conns.NotifyMasternodeListChanged = g_signals.m_internals->NotifyMasternodeListChanged.connect(std::bind(&CValidationInterface::NotifyMasternodeListChanged, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    conns.NotifyChainLock = g_signals.m_internals->NotifyChainLock.connect(std::bind(&CValidationInterface::NotifyChainLock, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+    conns.NotifyRecoveredSig = g_signals.m_internals->NotifyRecoveredSig.connect(std::bind(&CValidationInterface::NotifyRecoveredSig, pwalletIn, std::placeholders::_1));
+    conns.NotifyProposalVote = g_signals.m_internals->NotifyProposalVote.connect(std::bind(&CValidationInterface::NotifyProposalVote, pwalletIn, std::placeholders::_1));
+    conns.NotifyFinalizedBudgetVote = g_signals.m_internals->NotifyFinalizedBudgetVote.connect(std::bind(&CValidationInterface::NotifyFinalizedBudgetVote, pwalletIn, std::placeholders::_1));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn)
 {
     if (g_signals.m_internals) {
         g_signals.m_internals->m_connMainSignals.erase(pwalletIn);
+        // The pending callbacks run before the queue of the subscriber stops, none after it returns
+        std::shared_ptr<SubscriberQueue> queue;
+        {
+            LOCK(g_signals.m_internals->m_mutex_queues);
+            auto it = g_signals.m_internals->m_subscriberQueues.find(pwalletIn);
+            if (it == g_signals.m_internals->m_subscriberQueues.end()) return;
+            queue = std::move(it->second);
+            g_signals.m_internals->m_subscriberQueues.erase(it);
+        }
+        queue->Stop();
     }
 }
 
@@ -122,10 +344,16 @@ void UnregisterAllValidationInterfaces()
         return;
     }
     g_signals.m_internals->m_connMainSignals.clear();
+    std::unordered_map<CValidationInterface*, std::shared_ptr<SubscriberQueue>> queues;
+    WITH_LOCK(g_signals.m_internals->m_mutex_queues, queues.swap(g_signals.m_internals->m_subscriberQueues));
+    for (const auto& it : queues) {
+        it.second->Stop();
+    }
 }
 
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func) {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    LOCK(g_signals.m_internals->m_mutex_pending);
+    g_signals.m_internals->Enqueue(std::move(func));
 }
 
 void SyncWithValidationInterfaceQueue() {
@@ -139,6 +367,9 @@ void SyncWithValidationInterfaceQueue() {
         promise.set_value();
     });
     promise.get_future().wait();
+
+    // ...and then the queues of the subscribers, to which it handed the notifications over
+    g_signals.SyncSubscriberQueues();
 }
 
 // Use a macro instead of a function for conditional logging to prevent
@@ -149,7 +380,8 @@ void SyncWithValidationInterfaceQueue() {
     do {                                                       \
         auto local_name = (name);                              \
         LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);  \
-        m_internals->m_schedulerClient.AddToProcessQueue([=] { \
+        LOCK(m_internals->m_mutex_pending);                    \
+        m_internals->Enqueue([=] {                             \
             LOG_EVENT(fmt, local_name, __VA_ARGS__);           \
             event();                                           \
         });                                                    \
@@ -171,8 +403,30 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    auto event = [pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
+    auto fSuperseded = std::make_shared<bool>(false);
+    {
+        LOCK(m_internals->m_mutex_pending);
+        if (fInitialDownload && m_internals->m_fLastTipInIBD) *m_internals->m_lastTipSuperseded = true;
+        m_internals->m_lastTipSuperseded = fSuperseded;
+        m_internals->m_fLastTipInIBD = fInitialDownload;
+    }
+    auto event = [pindexNew, pindexFork, fInitialDownload, fSuperseded, this] {
+        const CBlockIndex* pindexForkNotify = pindexFork;
+        {
+            LOCK(m_internals->m_mutex_pending);
+            if (*fSuperseded) {
+                // Superseded by a later tip in the initial download, that will be notified from the lowest fork
+                m_internals->m_pindexSkippedFork = m_internals->m_fSkippedTip ? LowestFork(m_internals->m_pindexSkippedFork, pindexFork) : pindexFork;
+                m_internals->m_fSkippedTip = true;
+                return;
+            }
+            if (m_internals->m_fSkippedTip) {
+                pindexForkNotify = LowestFork(pindexForkNotify, m_internals->m_pindexSkippedFork);
+                m_internals->m_fSkippedTip = false;
+                m_internals->m_pindexSkippedFork = nullptr;
+            }
+        }
+        m_internals->UpdatedBlockTip(pindexNew, pindexForkNotify, fInitialDownload);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: new block hash=%s, fork block hash=%s (in IBD=%s)", __func__,
                           pindexNew->GetBlockHash().ToString(),
@@ -181,10 +435,24 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockInd
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef &ptx) {
-    auto event = [ptx, this] {
-        m_internals->TransactionAddedToMempool(ptx);
-    };
-    ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s", __func__, ptx->GetHash().ToString());
+    LOG_EVENT("Enqueuing %s: txid=%s", __func__, ptx->GetHash().ToString());
+    LOCK(m_internals->m_mutex_pending);
+    if (m_internals->m_openTransactions && m_internals->m_openTransactions->size() < MAX_BATCHED_TRANSACTIONS) {
+        m_internals->m_openTransactions->emplace_back(ptx);
+        return;
+    }
+    auto batch = std::make_shared<std::vector<CTransactionRef>>(1, ptx);
+    m_internals->Enqueue([batch, this] {
+        std::vector<CTransactionRef> vtx;
+        {
+            LOCK(m_internals->m_mutex_pending);
+            if (m_internals->m_openTransactions == batch) m_internals->m_openTransactions.reset();
+            vtx.swap(*batch);
+        }
+        LOG_EVENT("%s: %d txs, last txid=%s", "TransactionsAddedToMempool", vtx.size(), vtx.back()->GetHash().ToString());
+        m_internals->TransactionsAddedToMempool(vtx);
+    });
+    m_internals->m_openTransactions = batch;
 }
 
 void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& ptx, MemPoolRemovalReason reason) {
@@ -195,11 +463,26 @@ void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& ptx, Mem
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex) {
-    auto event = [pblock, pindex, this] {
-        m_internals->BlockConnected(pblock, pindex);
-    };
-    ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s, block height=%d", __func__,
-                          pblock->GetHash().ToString(), pindex->nHeight);
+    LOG_EVENT("Enqueuing %s: block hash=%s, block height=%d", __func__,
+              pblock->GetHash().ToString(), pindex->nHeight);
+    LOCK(m_internals->m_mutex_pending);
+    if (m_internals->m_openBlocks && m_internals->m_openBlocks->size() < MAX_BATCHED_BLOCKS) {
+        m_internals->m_openBlocks->emplace_back(pblock, pindex);
+        return;
+    }
+    auto batch = std::make_shared<std::vector<ConnectedBlock>>(1, ConnectedBlock(pblock, pindex));
+    m_internals->Enqueue([batch, this] {
+        std::vector<ConnectedBlock> blocks;
+        {
+            LOCK(m_internals->m_mutex_pending);
+            if (m_internals->m_openBlocks == batch) m_internals->m_openBlocks.reset();
+            blocks.swap(*batch);
+        }
+        LOG_EVENT("%s: %d blocks, last block hash=%s, block height=%d", "BlocksConnected", blocks.size(),
+                  blocks.back().first->GetHash().ToString(), blocks.back().second->nHeight);
+        m_internals->BlocksConnected(blocks);
+    });
+    m_internals->m_openBlocks = batch;
 }
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock> &pblock, const uint256& blockHash, int nBlockHeight, int64_t blockTime) {
@@ -237,3 +520,35 @@ void CMainSignals::NotifyMasternodeListChanged(bool undo, const CDeterministicMN
               diff.updatedMNs.size(),
               diff.removedMns.size());
 }
+
+void CMainSignals::NotifyChainLock(const CBlockIndex* pindex, const llmq::CChainLockSig& clsig) {
+    auto event = [pindex, clsig, this] {
+        m_internals->NotifyChainLock(pindex, clsig);
+    };
+    ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s, height=%d", __func__,
+                          clsig.blockHash.ToString(), clsig.nHeight);
+}
+
+void CMainSignals::NotifyRecoveredSig(const std::shared_ptr<const llmq::CRecoveredSig>& recoveredSig) {
+    auto event = [recoveredSig, this] {
+        m_internals->NotifyRecoveredSig(recoveredSig);
+    };
+    ENQUEUE_AND_LOG_EVENT(event, "%s: id=%s, msgHash=%s", __func__,
+                          recoveredSig->id.ToString(), recoveredSig->msgHash.ToString());
+}
+
+void CMainSignals::NotifyProposalVote(const CBudgetVote& vote) {
+    auto event = [vote, this] {
+        m_internals->NotifyProposalVote(vote);
+    };
+    ENQUEUE_AND_LOG_EVENT(event, "%s: vote=%s, proposal=%s", __func__,
+                          vote.GetHash().ToString(), vote.GetProposalHash().ToString());
+}
+
+void CMainSignals::NotifyFinalizedBudgetVote(const CFinalizedBudgetVote& vote) {
+    auto event = [vote, this] {
+        m_internals->NotifyFinalizedBudgetVote(vote);
+    };
+    ENQUEUE_AND_LOG_EVENT(event, "%s: vote=%s, budget=%s", __func__,
+                          vote.GetHash().ToString(), vote.GetBudgetHash().ToString());
+}
@@ -13,9 +13,12 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 class CBlock;
 struct CBlockLocator;
+class CBudgetVote;
+class CFinalizedBudgetVote;
 class CBlockIndex;
 class CConnman;
 class CDeterministicMNList;
@@ -26,10 +29,21 @@ class uint256;
 class CScheduler;
 enum class MemPoolRemovalReason;
 
+/** A connected block, with its index, as delivered in a batch */
+typedef std::pair<std::shared_ptr<const CBlock>, const CBlockIndex*> ConnectedBlock;
+
+namespace llmq {
+class CChainLockSig;
+class CRecoveredSig;
+} // namespace llmq
+
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
+/**
+ * Register a wallet to receive updates from core. With fOwnQueue, the background notifications
+ * are processed on a thread of the subscriber, instead of the background scheduler thread.
+ */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, bool fOwnQueue = false);
 /** Unregister a wallet from core */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
@@ -69,6 +83,12 @@ void SyncWithValidationInterfaceQueue();
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
  * ValidationInterface() subscribers.
+ *
+ * The consecutive BlockConnected() and TransactionAddedToMempool() events,
+ * queued before the first one is delivered, are delivered as one batch to
+ * BlocksConnected() and TransactionsAddedToMempool(). These call the single
+ * event callbacks by default, a subscriber overrides them to process a batch
+ * at once (e.g. to take its locks once).
  */
 class CValidationInterface {
 public:
@@ -82,6 +102,8 @@ protected:
      * When multiple blocks are connected at once, UpdatedBlockTip will be called on the final tip
      * but may not be called on every intermediate tip. If the latter behavior is desired,
      * subscribe to BlockConnected() instead.
+     * During the initial block download, a tip superseded by a later one, queued before it was
+     * delivered, is skipped: the later tip is delivered with the lowest fork block of the two.
      *
      * Called on a background thread.
      */
@@ -92,6 +114,15 @@ protected:
      * Called on a background thread.
      */
     virtual void TransactionAddedToMempool(const CTransactionRef &ptxn) {}
+    /**
+     * Notifies listeners of a batch of transactions having been added to mempool, in order.
+     *
+     * Called on a background thread.
+     */
+    virtual void TransactionsAddedToMempool(const std::vector<CTransactionRef>& vtx)
+    {
+        for (const CTransactionRef& ptx : vtx) TransactionAddedToMempool(ptx);
+    }
     /**
      * Notifies listeners of a transaction leaving mempool.
      *
@@ -132,6 +163,15 @@ protected:
      * Called on a background thread.
      */
     virtual void BlockConnected(const std::shared_ptr<const CBlock> &block, const CBlockIndex *pindex) {}
+    /**
+     * Notifies listeners of a batch of blocks being connected, in order.
+     *
+     * Called on a background thread.
+     */
+    virtual void BlocksConnected(const std::vector<ConnectedBlock>& blocks)
+    {
+        for (const ConnectedBlock& block : blocks) BlockConnected(block.first, block.second);
+    }
     /**
      * Notifies listeners of a block being disconnected
      *
@@ -147,11 +187,35 @@ protected:
     /** Tells listeners to broadcast their data. */
     virtual void ResendWalletTransactions(CConnman* connman) {}
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, bool);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     /** Notifies listeners of updated deterministic masternode list */
     virtual void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) {}
+    /**
+     * Notifies listeners of a new best chainlock, once its block is known.
+     *
+     * Called on a background thread.
+     */
+    virtual void NotifyChainLock(const CBlockIndex* pindex, const llmq::CChainLockSig& clsig) {}
+    /**
+     * Notifies listeners of a new recovered LLMQ signature.
+     *
+     * Called on a background thread.
+     */
+    virtual void NotifyRecoveredSig(const std::shared_ptr<const llmq::CRecoveredSig>& recoveredSig) {}
+    /**
+     * Notifies listeners of a new or updated vote on a budget proposal.
+     *
+     * Called on a background thread.
+     */
+    virtual void NotifyProposalVote(const CBudgetVote& vote) {}
+    /**
+     * Notifies listeners of a new or updated vote on a finalized budget.
+     *
+     * Called on a background thread.
+     */
+    virtual void NotifyFinalizedBudgetVote(const CFinalizedBudgetVote& vote) {}
 };
 
 struct MainSignalsInstance;
@@ -159,7 +223,7 @@ class CMainSignals {
 private:
     std::unique_ptr<MainSignalsInstance> m_internals;
 
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, bool);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
@@ -171,6 +235,8 @@ public:
     void UnregisterBackgroundSignalScheduler();
     /** Call any remaining callbacks on the calling thread */
     void FlushBackgroundCallbacks();
+    /** Block until the callbacks handed over to the queues of the subscribers have run */
+    void SyncSubscriberQueues();
 
     size_t CallbacksPending();
 
@@ -184,6 +250,10 @@ public:
     void Broadcast(CConnman* connman);
     void BlockChecked(const CBlock&, const CValidationState&);
     void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff);
+    void NotifyChainLock(const CBlockIndex* pindex, const llmq::CChainLockSig& clsig);
+    void NotifyRecoveredSig(const std::shared_ptr<const llmq::CRecoveredSig>& recoveredSig);
+    void NotifyProposalVote(const CBudgetVote& vote);
+    void NotifyFinalizedBudgetVote(const CFinalizedBudgetVote& vote);
 };
 
 CMainSignals& GetMainSignals();
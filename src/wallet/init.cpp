@@ -8,6 +8,7 @@
 
 #include "guiinterfaceutil.h"
 #include "net.h"
+#include "sapling/transaction_builder.h"
 #include "util/system.h"
 #include "utilmoneystr.h"
 #include "validation.h"
@@ -26,6 +27,7 @@ std::string GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf("Fee (in %s/kB) to add to transactions you send (default: %s)", CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-rescan", "Rescan the block chain for missing wallet transactions on startup");
     strUsage += HelpMessageOpt("-salvagewallet", "Attempt to recover private keys from a corrupt wallet file on startup");
+    strUsage += HelpMessageOpt("-saplingprovethreads=<n>", strprintf("Set the number of threads creating the Sapling proofs of a shielded transaction (%d to %d, 0 = auto, <0 = leave that many cores free, default: %d)", -GetNumCores(), MAX_SAPLING_PROVE_THREADS, DEFAULT_SAPLING_PROVE_THREADS));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf("Spend unconfirmed change when sending transactions (default: %u)", DEFAULT_SPEND_ZEROCONF_CHANGE));
     strUsage += HelpMessageOpt("-txconfirmtarget=<n>", strprintf("If paytxfee is not set, include enough fee so transactions begin confirmation on average within n blocks (default: %u)", 1));
     strUsage += HelpMessageOpt("-upgradewallet", "Upgrade wallet to latest format on startup");
@@ -40,6 +42,7 @@ std::string GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf("Set the number of threads for coin generation if enabled (-1 = all cores, default: %d)", DEFAULT_GENERATE_PROCLIMIT));
     strUsage += HelpMessageOpt("-minstakesplit=<amt>", strprintf("Minimum positive amount (in PIV) allowed by GUI and RPC for the stake split threshold (default: %s)", FormatMoney(DEFAULT_MIN_STAKE_SPLIT_THRESHOLD)));
     strUsage += HelpMessageOpt("-staking=<n>", strprintf("Enable staking functionality (0-1, default: %u)", DEFAULT_STAKING));
+    strUsage += HelpMessageOpt("-stakingthreads=<n>", strprintf("Set the number of threads hashing stake kernels, shared by the staking wallets (%d to %d, 0 = auto, <0 = leave that many cores free, default: %d)", -GetNumCores(), MAX_STAKING_THREADS, DEFAULT_STAKING_THREADS));
     if (showDebug) {
         strUsage += HelpMessageGroup("Wallet debugging/testing options:");
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf("Flush database activity from memory pool to disk log every <n> megabytes (default: %u)", DEFAULT_WALLET_DBLOGSIZE));
@@ -53,6 +56,10 @@ std::string GetWalletHelpString(bool showDebug)
 bool WalletParameterInteraction()
 {
     if (gArgs.GetBoolArg("-disablewallet", DEFAULT_DISABLE_WALLET)) {
+        // Without wallet, the node only needs the verifying keys
+        if (gArgs.SoftSetBoolArg("-lazysaplingparams", true)) {
+            LogPrintf("%s: parameter interaction: -disablewallet=1 -> setting -lazysaplingparams=1\n", __func__);
+        }
         return true;
     }
 
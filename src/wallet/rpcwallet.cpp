@@ -2343,19 +2343,10 @@ UniValue getunconfirmedbalance(const JSONRPCRequest& request)
 /*
  * Only used for t->t transactions (via sendmany RPC)
  */
-static UniValue legacy_sendmany(CWallet* const pwallet, const UniValue& sendTo, int nMinDepth, std::string comment, bool fIncludeDelegated, const UniValue& subtractFeeFromAmount)
+// Parses the transparent recipients of sendTo into vecSend, returning their total amount
+static CAmount ParseLegacyRecipients(const UniValue& sendTo, const UniValue& subtractFeeFromAmount, std::vector<CRecipient>& vecSend)
 {
-    LOCK2(cs_main, pwallet->cs_wallet);
-
-    if (!g_connman)
-        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
-
-    isminefilter filter = ISMINE_SPENDABLE | (fIncludeDelegated ? ISMINE_SPENDABLE_DELEGATED : ISMINE_NO);
-
-    CTransactionRef txNew;
     std::set<CTxDestination> setAddress;
-    std::vector<CRecipient> vecSend;
-
     CAmount totalAmount = 0;
     std::vector<std::string> keys = sendTo.getKeys();
     for (const std::string& name_ : keys) {
@@ -2384,6 +2375,21 @@ static UniValue legacy_sendmany(CWallet* const pwallet, const UniValue& sendTo,
 
         vecSend.emplace_back(scriptPubKey, nAmount, fSubtractFeeFromAmount);
     }
+    return totalAmount;
+}
+
+static UniValue legacy_sendmany(CWallet* const pwallet, const UniValue& sendTo, int nMinDepth, std::string comment, bool fIncludeDelegated, const UniValue& subtractFeeFromAmount)
+{
+    LOCK2(cs_main, pwallet->cs_wallet);
+
+    if (!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    isminefilter filter = ISMINE_SPENDABLE | (fIncludeDelegated ? ISMINE_SPENDABLE_DELEGATED : ISMINE_NO);
+
+    CTransactionRef txNew;
+    std::vector<CRecipient> vecSend;
+    const CAmount totalAmount = ParseLegacyRecipients(sendTo, subtractFeeFromAmount, vecSend);
 
     // Check funds
     if (totalAmount > pwallet->GetLegacyBalance(filter, nMinDepth)) {
@@ -2510,6 +2516,109 @@ UniValue sendmany(const JSONRPCRequest& request)
     return legacy_sendmany(pwallet, sendTo, nMinDepth, comment, fIncludeDelegated, subtractFeeFromAmount);
 }
 
+UniValue sendmanybatch(const JSONRPCRequest& request)
+{
+    CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
+
+    if (!EnsureWalletIsAvailable(pwallet, request.fHelp))
+        return NullUniValue;
+
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            "sendmanybatch [{\"address\":amount,...},...] ( minconf include_delegated )\n"
+            "\nSend a batch of payouts, creating a transaction for each of the amounts objects. Recipients are transparent PIVX addresses.\n"
+            "The transactions are funded from a single snapshot of the wallet coins (so that they don't spend each other's change),\n"
+            "signed in parallel, and written to the wallet in a single database transaction.\n"
+            + HelpRequiringPassphrase(pwallet) + "\n"
+
+            "\nArguments:\n"
+            "1. \"payouts\"             (array, required) A json array of json objects with addresses and amounts\n"
+            "    [\n"
+            "      {\n"
+            "        \"address\":amount (numeric) The transparent pivx address is the key, the numeric amount in PIV is the value\n"
+            "        ,...\n"
+            "      }\n"
+            "      ,...\n"
+            "    ]\n"
+            "2. minconf                 (numeric, optional, default=1) Only use the balance confirmed at least this many times.\n"
+            "3. include_delegated       (bool, optional, default=false) Also include balance delegated to cold stakers\n"
+
+            "\nResult:\n"
+            "[                          (array) The result of each payout, in the order of the payouts\n"
+            "  {\n"
+            "    \"txid\": \"transactionid\"   (string) The transaction id, if the payout was sent\n"
+            "    \"error\": \"message\"        (string) The reason of the failure, if the payout was not sent\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n"
+            "\nSend two payouts:\n" +
+            HelpExampleCli("sendmanybatch", "\"[{\\\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\\\":0.01},{\\\"DAD3Y6ivr8nPQLT1NEPX84DxGCw9jz9Jvg\\\":0.02}]\"") +
+            "\nAs a json rpc call\n" +
+            HelpExampleRpc("sendmanybatch", "\"[{\\\"DMJRSsuU9zfyrvxVaAEFQqK4MxZg6vgeS6\\\":0.01},{\\\"DAD3Y6ivr8nPQLT1NEPX84DxGCw9jz9Jvg\\\":0.02}]\", 6")
+        );
+
+    EnsureWalletIsUnlocked(pwallet);
+
+    // Make sure the results are valid at least up to the most recent block
+    // the user could have gotten from another RPC command prior to now
+    pwallet->BlockUntilSyncedToCurrentChain();
+
+    const UniValue& payouts = request.params[0].get_array();
+    const int nMinDepth = request.params.size() > 1 ? request.params[1].get_int() : 1;
+    const bool fIncludeDelegated = (request.params.size() > 2 && request.params[2].get_bool());
+    if (payouts.empty()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, payouts array is empty");
+    }
+
+    LOCK2(cs_main, pwallet->cs_wallet);
+
+    if (!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    std::vector<std::vector<CRecipient>> vecSends(payouts.size());
+    CAmount totalAmount = 0;
+    for (size_t i = 0; i < payouts.size(); i++) {
+        for (const std::string& key : payouts[i].get_obj().getKeys()) {
+            bool isStaking = false, isExchange = false, isShielded = false;
+            Standard::DecodeDestination(key, isStaking, isExchange, isShielded);
+            if (isShielded) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, std::string("Shield addresses are not supported in a batch: ") + key);
+            }
+        }
+        totalAmount += ParseLegacyRecipients(payouts[i].get_obj(), UniValue(UniValue::VARR), vecSends[i]);
+    }
+
+    // Check funds
+    const isminefilter filter = ISMINE_SPENDABLE | (fIncludeDelegated ? ISMINE_SPENDABLE_DELEGATED : ISMINE_NO);
+    if (totalAmount > pwallet->GetLegacyBalance(filter, nMinDepth)) {
+        throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, "Wallet has insufficient funds");
+    }
+
+    // Send
+    std::vector<CTransactionRef> vtx;
+    std::vector<std::unique_ptr<CReserveKey>> vReserveKeys;
+    std::string strFailReason;
+    if (!pwallet->CreateTransactions(vecSends, vtx, vReserveKeys, strFailReason, fIncludeDelegated, nMinDepth)) {
+        throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, strFailReason);
+    }
+    const std::vector<CWallet::CommitResult>& vResults = pwallet->CommitTransactions(vtx, vReserveKeys, g_connman.get());
+
+    // A failed payout doesn't hide the ones already broadcast
+    UniValue ret(UniValue::VARR);
+    for (const CWallet::CommitResult& res : vResults) {
+        UniValue entry(UniValue::VOBJ);
+        if (res.status == CWallet::CommitStatus::OK) {
+            entry.pushKV("txid", res.hashTx.GetHex());
+        } else {
+            entry.pushKV("error", res.ToString());
+        }
+        ret.push_back(entry);
+    }
+    return ret;
+}
+
 // Defined in rpc/misc.cpp
 extern CScript _createmultisig_redeemScript(CWallet* const pwallet, const UniValue& params);
 
@@ -2952,39 +3061,41 @@ UniValue listcoldutxos(const JSONRPCRequest& request)
         fExcludeWhitelisted = request.params[0].get_bool();
     UniValue results(UniValue::VARR);
 
-    for (const auto& entry : pwallet->mapWallet) {
-        const uint256& wtxid = entry.first;
-        const CWalletTx* pcoin = &entry.second;
-        if (!CheckFinalTx(pcoin->tx) || !pcoin->IsTrusted())
+    const CWalletTx* pcoin = nullptr;
+    bool fSkipTx = false;
+    for (const COutPoint& outpoint : pwallet->GetP2CSOutpoints()) {
+        const uint256& wtxid = outpoint.hash;
+        const unsigned int i = outpoint.n;
+        if (!pcoin || pcoin->GetHash() != wtxid) {
+            pcoin = pwallet->GetWalletTx(wtxid);
+            // if this tx has no unspent P2CS outputs for us, skip it
+            fSkipTx = !CheckFinalTx(pcoin->tx) || !pcoin->IsTrusted() ||
+                      (pcoin->GetColdStakingCredit() == 0 && pcoin->GetStakeDelegationCredit() == 0);
+        }
+        if (fSkipTx)
             continue;
 
-        // if this tx has no unspent P2CS outputs for us, skip it
-        if(pcoin->GetColdStakingCredit() == 0 && pcoin->GetStakeDelegationCredit() == 0)
+        const CTxOut& out = pcoin->tx->vout[i];
+        isminetype mine = pwallet->IsMine(out);
+        if (!bool(mine & ISMINE_COLD) && !bool(mine & ISMINE_SPENDABLE_DELEGATED))
             continue;
-
-        for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
-            const CTxOut& out = pcoin->tx->vout[i];
-            isminetype mine = pwallet->IsMine(out);
-            if (!bool(mine & ISMINE_COLD) && !bool(mine & ISMINE_SPENDABLE_DELEGATED))
-                continue;
-            txnouttype type;
-            std::vector<CTxDestination> addresses;
-            int nRequired;
-            if (!ExtractDestinations(out.scriptPubKey, type, addresses, nRequired))
-                continue;
-            const bool fWhitelisted = pwallet->HasAddressBook(addresses[1]) > 0;
-            if (fExcludeWhitelisted && fWhitelisted)
-                continue;
-            UniValue entry(UniValue::VOBJ);
-            entry.pushKV("txid", wtxid.GetHex());
-            entry.pushKV("txidn", (int)i);
-            entry.pushKV("amount", ValueFromAmount(out.nValue));
-            entry.pushKV("confirmations", pcoin->GetDepthInMainChain());
-            entry.pushKV("cold-staker", EncodeDestination(addresses[0], CChainParams::STAKING_ADDRESS));
-            entry.pushKV("coin-owner", EncodeDestination(addresses[1]));
-            entry.pushKV("whitelisted", fWhitelisted ? "true" : "false");
-            results.push_back(entry);
-        }
+        txnouttype type;
+        std::vector<CTxDestination> addresses;
+        int nRequired;
+        if (!ExtractDestinations(out.scriptPubKey, type, addresses, nRequired))
+            continue;
+        const bool fWhitelisted = pwallet->HasAddressBook(addresses[1]) > 0;
+        if (fExcludeWhitelisted && fWhitelisted)
+            continue;
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("txid", wtxid.GetHex());
+        entry.pushKV("txidn", (int)i);
+        entry.pushKV("amount", ValueFromAmount(out.nValue));
+        entry.pushKV("confirmations", pcoin->GetDepthInMainChain());
+        entry.pushKV("cold-staker", EncodeDestination(addresses[0], CChainParams::STAKING_ADDRESS));
+        entry.pushKV("coin-owner", EncodeDestination(addresses[1]));
+        entry.pushKV("whitelisted", fWhitelisted ? "true" : "false");
+        results.push_back(entry);
     }
 
     return results;
@@ -4318,6 +4429,13 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
             "  \"paytxfee\": x.xxxx                       (numeric) the transaction fee configuration, set in PIV/kB\n"
             "  \"hdseedid\": \"<hash160>\"                (string, optional) the Hash160 of the HD seed (only present when HD is enabled)\n"
             "  \"last_processed_block\": xxxxx,          (numeric) the last block processed block height\n"
+            "  \"scanning\":                             (json object) current scanning details, or false if no scan is in progress\n"
+            "  {\n"
+            "    \"duration\": xxxx,                      (numeric) elapsed seconds since scan start\n"
+            "    \"progress\": x.xxxx,                    (numeric) scanning progress percentage [0.0, 1.0]\n"
+            "    \"blocks\": xxxx,                        (numeric) blocks scanned so far\n"
+            "    \"blocks_per_second\": x.xx,             (numeric) blocks scanned per second\n"
+            "  }\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -4367,6 +4485,18 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
         obj.pushKV("unlocked_until", pwallet->nRelockTime);
     obj.pushKV("paytxfee", ValueFromAmount(payTxFee.GetFeePerK()));
     obj.pushKV("last_processed_block", pwallet->GetLastBlockHeight());
+    if (pwallet->IsScanning()) {
+        const int64_t nDuration = pwallet->ScanningDuration();
+        const int nBlocks = pwallet->ScanningBlocks();
+        UniValue scanning(UniValue::VOBJ);
+        scanning.pushKV("duration", nDuration / 1000);
+        scanning.pushKV("progress", pwallet->ScanningProgress());
+        scanning.pushKV("blocks", nBlocks);
+        scanning.pushKV("blocks_per_second", nDuration > 0 ? nBlocks * 1000.0 / nDuration : 0.0);
+        obj.pushKV("scanning", scanning);
+    } else {
+        obj.pushKV("scanning", false);
+    }
     return obj;
 }
 
@@ -4464,6 +4594,84 @@ UniValue getstakingstatus(const JSONRPCRequest& request)
     }
 }
 
+UniValue getstakingperf(const JSONRPCRequest& request)
+{
+    CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
+
+    if (!EnsureWalletIsAvailable(pwallet, request.fHelp))
+        return NullUniValue;
+
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getstakingperf ( reset )\n"
+            "\nReturns timings and counters of the staking of this wallet, since startup or the last reset.\n"
+
+            "\nArguments:\n"
+            "1. reset                   (boolean, optional, default=false) Reset the counters after returning them\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"slots\": n,                  (numeric) number of time slots attempted\n"
+            "  \"missed_slots\": n,           (numeric) number of time slots skipped between two attempts\n"
+            "  \"kernels\": n,                (numeric) number of kernels hashed\n"
+            "  \"lastslot_kernels\": n,       (numeric) number of kernels hashed during the last attempted slot\n"
+            "  \"kernels_per_second\": d,     (numeric) kernels hashed per second spent in the kernel search\n"
+            "  \"blocks\": n,                 (numeric) number of staked blocks accepted\n"
+            "  \"timings\": {                 (json object) time spent in each step\n"
+            "    \"step\": {                  (json object) one of stakeablecoins, blocktemplate, kernelsearch,\n"
+            "                                  signcoinstake, signblock, processblock\n"
+            "      \"count\": n,              (numeric) number of times the step ran\n"
+            "      \"total_ms\": d,           (numeric) total time, in milliseconds\n"
+            "      \"avg_ms\": d,             (numeric) average time, in milliseconds\n"
+            "      \"max_ms\": d,             (numeric) maximum time, in milliseconds\n"
+            "      \"histogram\": [n,...]     (array) number of runs taking less than 0.1, 1, 10, 100, 1000 ms, and more\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getstakingperf", "") + HelpExampleCli("getstakingperf", "true") +
+            HelpExampleRpc("getstakingperf", "false"));
+
+    CStakerStatus* ss = pwallet->pStakerStatus;
+    if (!ss)
+        throw JSONRPCError(RPC_IN_WARMUP, "Try again after active chain is loaded");
+
+    const bool fReset = !request.params[0].isNull() && request.params[0].get_bool();
+    const CStakerStats stats = ss->GetStats();
+    if (fReset) ss->ResetStats();
+
+    static const std::array<std::string, (size_t)StakingStep::COUNT> stepNames{{
+        "stakeablecoins", "blocktemplate", "kernelsearch", "signcoinstake", "signblock", "processblock"
+    }};
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("slots", (uint64_t)stats.nSlots);
+    obj.pushKV("missed_slots", (uint64_t)stats.nMissedSlots);
+    obj.pushKV("kernels", (uint64_t)stats.nKernels);
+    obj.pushKV("lastslot_kernels", stats.nLastSlotKernels);
+    const CStakingTimer& searchTimer = stats.vTimers[(size_t)StakingStep::KERNEL_SEARCH];
+    obj.pushKV("kernels_per_second", searchTimer.nTotalMicros > 0 ? 1e6 * stats.nKernels / searchTimer.nTotalMicros : 0.0);
+    obj.pushKV("blocks", (uint64_t)stats.nBlocks);
+    UniValue timings(UniValue::VOBJ);
+    for (size_t i = 0; i < stats.vTimers.size(); i++) {
+        const CStakingTimer& timer = stats.vTimers[i];
+        UniValue step(UniValue::VOBJ);
+        step.pushKV("count", (uint64_t)timer.nCount);
+        step.pushKV("total_ms", timer.nTotalMicros / 1000.0);
+        step.pushKV("avg_ms", timer.nCount > 0 ? timer.nTotalMicros / 1000.0 / timer.nCount : 0.0);
+        step.pushKV("max_ms", timer.nMaxMicros / 1000.0);
+        UniValue histogram(UniValue::VARR);
+        for (uint64_t n : timer.vBuckets) {
+            histogram.push_back((uint64_t)n);
+        }
+        step.pushKV("histogram", histogram);
+        timings.pushKV(stepNames[i], step);
+    }
+    obj.pushKV("timings", timings);
+    return obj;
+}
+
 UniValue setstakesplitthreshold(const JSONRPCRequest& request)
 {
     CWallet * const pwallet = GetWalletForJSONRPCRequest(request);
@@ -4794,6 +5002,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "getunconfirmedbalance",    &getunconfirmedbalance,    false, {} },
     { "wallet",             "getwalletinfo",            &getwalletinfo,            false, {} },
     { "wallet",             "getstakingstatus",         &getstakingstatus,         false, {} },
+    { "wallet",             "getstakingperf",           &getstakingperf,           false, {"reset"} },
     { "wallet",             "importprivkey",            &importprivkey,            true,  {"privkey","label","rescan","is_staking_address"} },
     { "wallet",             "importwallet",             &importwallet,             true,  {"filename"} },
     { "wallet",             "importaddress",            &importaddress,            true,  {"address","label","rescan","p2sh"} },
@@ -4813,6 +5022,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "lockunspent",              &lockunspent,              true,  {"unlock", "transparent", "transactions"} },
     { "wallet",             "rawdelegatestake",         &rawdelegatestake,         false, {"staking_addr","amount","owner_addr","ext_owner","include_delegated","from_shield","force"} },
     { "wallet",             "sendmany",                 &sendmany,                 false, {"dummy","amounts","minconf","comment","include_delegated","subtract_fee_from"} },
+    { "wallet",             "sendmanybatch",            &sendmanybatch,            false, {"payouts","minconf","include_delegated"} },
     { "wallet",             "sendtoaddress",            &sendtoaddress,            false, {"address","amount","comment","comment-to","subtract_fee"} },
     { "wallet",             "settxfee",                 &settxfee,                 true,  {"amount"} },
     { "wallet",             "setstakesplitthreshold",   &setstakesplitthreshold,   false, {"value"} },
@@ -5,8 +5,19 @@
 
 #include "wallet/scriptpubkeyman.h"
 #include "crypter.h"
+#include "ctpl_stl.h"
 #include "script/standard.h"
 
+#include <future>
+
+// For now only one account.
+static const uint32_t HD_ACCOUNT_NUMBER = 0;
+// Below this number of keys, the keypool keys are derived one by one on the calling thread
+static const int64_t MIN_PARALLEL_KEYPOOL_DERIVATION = 64;
+// The keys derived in parallel before adding them to the wallet, which bounds the secrets waiting in memory
+static const int64_t KEYPOOL_DERIVATION_BATCH = 1000;
+static const int MAX_KEYPOOL_DERIVATION_THREADS = 8;
+
 bool ScriptPubKeyMan::SetupGeneration(bool newKeypool, bool force, bool memOnly)
 {
     if (CanGenerateKeys() && !force) {
@@ -224,9 +235,12 @@ bool ScriptPubKeyMan::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool,
 
 void ScriptPubKeyMan::KeepDestination(int64_t nIndex)
 {
-    // Remove from key pool
-    WalletBatch batch(wallet->GetDBHandle());
-    batch.ErasePool(nIndex);
+    // Remove from key pool, in the transaction of the batch tunneled by CWallet::CommitTransactions if any
+    if (wallet->encrypted_batch) {
+        wallet->encrypted_batch->ErasePool(nIndex);
+    } else {
+        WalletBatch(wallet->GetDBHandle()).ErasePool(nIndex);
+    }
     CPubKey pubkey;
     bool have_pk = wallet->GetPubKey(m_index_to_reserved_key.at(nIndex), pubkey);
     assert(have_pk);
@@ -393,10 +407,22 @@ bool ScriptPubKeyMan::TopUp(unsigned int kpSize)
             missingStaking = 0;
         }
 
+        // The keys, their metadata, the keypool entries and the HD chain are written in a single
+        // transaction, instead of committing and flushing the database for each key.
         WalletBatch batch(wallet->GetDBHandle());
-        GeneratePool(batch, missingExternal, HDChain::ChangeType::EXTERNAL);
-        GeneratePool(batch, missingInternal, HDChain::ChangeType::INTERNAL);
-        GeneratePool(batch, missingStaking, HDChain::ChangeType::STAKING);
+        const bool fTxn = batch.TxnBegin();
+        try {
+            GeneratePool(batch, missingExternal, HDChain::ChangeType::EXTERNAL);
+            GeneratePool(batch, missingInternal, HDChain::ChangeType::INTERNAL);
+            GeneratePool(batch, missingStaking, HDChain::ChangeType::STAKING);
+        } catch (...) {
+            // Keep the keys generated so far, which are already in memory, as they were written one by one
+            if (fTxn) batch.TxnCommit();
+            throw;
+        }
+        if (fTxn && !batch.TxnCommit()) {
+            throw std::runtime_error(std::string(__func__) + ": committing the new keys failed");
+        }
 
         if (missingInternal + missingExternal > 0) {
             LogPrintf("keypool added %d keys (%d internal), size=%u (%u internal), \n", missingInternal + missingExternal, missingInternal, setInternalKeyPool.size() + setExternalKeyPool.size() + set_pre_split_keypool.size(), setInternalKeyPool.size());
@@ -412,12 +438,66 @@ bool ScriptPubKeyMan::TopUp(unsigned int kpSize)
 
 void ScriptPubKeyMan::GeneratePool(WalletBatch& batch, int64_t targetSize, const uint8_t& type)
 {
+    if (IsHDEnabled() && targetSize >= MIN_PARALLEL_KEYPOOL_DERIVATION) {
+        GenerateHDPool(batch, targetSize, type);
+        return;
+    }
     for (int64_t i = targetSize; i--;) {
         CPubKey pubkey(GenerateNewKey(batch, type));
         AddKeypoolPubkeyWithDB(pubkey, type, batch);
     }
 }
 
+void ScriptPubKeyMan::GenerateHDPool(WalletBatch& batch, int64_t targetSize, const uint8_t& changeType)
+{
+    AssertLockHeld(wallet->cs_wallet);
+    if (wallet->CanSupportFeature(FEATURE_COMPRPUBKEY)) {
+        wallet->SetMinVersion(FEATURE_COMPRPUBKEY, &batch);
+    }
+
+    // The chain key is derived once, instead of once per key
+    CExtKey changeKey;
+    CKeyID masterId;
+    DeriveChangeKey(changeType, changeKey, masterId);
+
+    // The workers derive the child keys and their public keys, the costly part, in batches of
+    // consecutive indexes. The keys are added to the wallet and to the keypool on this thread,
+    // in order of index, skipping the ones already known to the wallet.
+    ctpl::thread_pool derivationPool(std::max(1, std::min(GetNumCores(), MAX_KEYPOOL_DERIVATION_THREADS)));
+    RenameThreadPool(derivationPool, "pivx-keypool");
+    uint32_t& chainCounter = hdChain.GetChainCounter(changeType);
+    while (targetSize > 0) {
+        std::vector<std::future<std::pair<CKey, CPubKey>>> vDerived;
+        const int64_t nBatch = std::min(targetSize, KEYPOOL_DERIVATION_BATCH);
+        for (int64_t i = 0; i < nBatch; i++) {
+            const uint32_t index = chainCounter + i;
+            vDerived.emplace_back(derivationPool.push([&changeKey, index](int) {
+                CExtKey childKey;
+                changeKey.Derive(childKey, index | BIP32_HARDENED_KEY_LIMIT);
+                const CPubKey pubkey = childKey.key.GetPubKey();
+                assert(childKey.key.VerifyPubKey(pubkey));
+                return std::make_pair(childKey.key, pubkey);
+            }));
+        }
+
+        const int64_t nCreationTime = GetTime();
+        for (auto& derived : vDerived) {
+            const std::pair<CKey, CPubKey> key = derived.get();
+            const uint32_t index = chainCounter++;
+            if (wallet->HaveKey(key.second.GetID())) continue;
+            CKeyMetadata metadata(nCreationTime);
+            SetHDKeyOrigin(metadata, masterId, changeType, index);
+            AddGeneratedKey(batch, key.first, key.second, metadata);
+            AddKeypoolPubkeyWithDB(key.second, changeType, batch);
+            targetSize--;
+        }
+
+        // update the chain model in the database
+        if (!batch.WriteHDChain(hdChain))
+            throw std::runtime_error(std::string(__func__) + ": Writing HD chain model failed");
+    }
+}
+
 void ScriptPubKeyMan::AddKeypoolPubkeyWithDB(const CPubKey& pubkey, const uint8_t& type, WalletBatch &batch)
 {
     LOCK(wallet->cs_wallet);
@@ -462,22 +542,28 @@ CPubKey ScriptPubKeyMan::GenerateNewKey(WalletBatch &batch, const uint8_t& type)
 
     // Compressed public keys were introduced in version 0.6.0
     if (fCompressed) {
-        wallet->SetMinVersion(FEATURE_COMPRPUBKEY);
+        wallet->SetMinVersion(FEATURE_COMPRPUBKEY, &batch);
     }
 
     CPubKey pubkey = secret.GetPubKey();
     assert(secret.VerifyPubKey(pubkey));
 
+    AddGeneratedKey(batch, secret, pubkey, metadata);
+    return pubkey;
+}
+
+void ScriptPubKeyMan::AddGeneratedKey(WalletBatch& batch, const CKey& secret, const CPubKey& pubkey, const CKeyMetadata& metadata)
+{
+    AssertLockHeld(wallet->cs_wallet);
     wallet->mapKeyMetadata[pubkey.GetID()] = metadata;
-    UpdateTimeFirstKey(nCreationTime);
+    UpdateTimeFirstKey(metadata.nCreateTime);
 
     if (!AddKeyPubKeyWithDB(batch, secret, pubkey)) {
         throw std::runtime_error(std::string(__func__) + ": AddKey failed");
     }
-    return pubkey;
 }
 
-void ScriptPubKeyMan::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, const uint8_t& changeType)
+void ScriptPubKeyMan::DeriveChangeKey(const uint8_t& changeType, CExtKey& changeKey, CKeyID& masterId)
 {
     AssertLockHeld(wallet->cs_wallet);
     // Use BIP44 keypath scheme i.e. m / purpose' / coin_type' / account' / change / address_index
@@ -486,11 +572,6 @@ void ScriptPubKeyMan::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metada
     CExtKey purposeKey;            //key at m/purpose' --> key at m/44'
     CExtKey cointypeKey;           //key at m/purpose'/coin_type'  --> key at m/44'/119'
     CExtKey accountKey;            //key at m/purpose'/coin_type'/account' ---> key at m/44'/119'/account_num'
-    CExtKey changeKey;             //key at m/purpose'/coin_type'/account'/change ---> key at m/44'/119'/account_num'/change', external = 0' or internal = 1'.
-    CExtKey childKey;              //key at m/purpose'/coin_type'/account'/change/address_index ---> key at m/44'/119'/account_num'/change'/<n>'
-
-    // For now only one account.
-    int nAccountNumber = 0;
 
     // try to get the seed
     if (!wallet->GetKey(hdChain.GetID(), seed))
@@ -504,33 +585,47 @@ void ScriptPubKeyMan::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metada
     // derive m/purpose'/coin_type'
     purposeKey.Derive(cointypeKey, 119 | BIP32_HARDENED_KEY_LIMIT);
     // derive m/purpose'/coin_type'/account' // Hardcoded to account 0 for now.
-    cointypeKey.Derive(accountKey, nAccountNumber | BIP32_HARDENED_KEY_LIMIT);
+    cointypeKey.Derive(accountKey, HD_ACCOUNT_NUMBER | BIP32_HARDENED_KEY_LIMIT);
     // derive m/purpose'/coin_type'/account'/change'
     accountKey.Derive(changeKey,  changeType | BIP32_HARDENED_KEY_LIMIT);
 
+    masterId = masterKey.key.GetPubKey().GetID();
+}
+
+void ScriptPubKeyMan::SetHDKeyOrigin(CKeyMetadata& metadata, const CKeyID& masterId, const uint8_t& changeType, uint32_t index) const
+{
+    // m/44'/119'/account_num/change'/<n>'
+    metadata.key_origin.path = {44 | BIP32_HARDENED_KEY_LIMIT,
+                                119 | BIP32_HARDENED_KEY_LIMIT,
+                                HD_ACCOUNT_NUMBER | BIP32_HARDENED_KEY_LIMIT,
+                                changeType | BIP32_HARDENED_KEY_LIMIT,
+                                index | BIP32_HARDENED_KEY_LIMIT};
+    metadata.hd_seed_id = hdChain.GetID();
+    std::copy(masterId.begin(), masterId.begin() + 4, metadata.key_origin.fingerprint);
+}
+
+void ScriptPubKeyMan::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, const uint8_t& changeType)
+{
+    AssertLockHeld(wallet->cs_wallet);
+    CExtKey changeKey;             //key at m/purpose'/coin_type'/account'/change ---> key at m/44'/119'/account_num'/change', external = 0' or internal = 1'.
+    CExtKey childKey;              //key at m/purpose'/coin_type'/account'/change/address_index ---> key at m/44'/119'/account_num'/change'/<n>'
+    CKeyID masterId;
+    DeriveChangeKey(changeType, changeKey, masterId);
+
     // derive child key at next index, skip keys already known to the wallet
+    uint32_t index;
     do {
         // always derive hardened keys
         // childIndex | BIP32_HARDENED_KEY_LIMIT = derive childIndex in hardened child-index-range
         // example: 1 | BIP32_HARDENED_KEY_LIMIT == 0x80000001 == 2147483649
 
-        // m/44'/119'/account_num/change'/<n>'
-        metadata.key_origin.path.push_back(44 | BIP32_HARDENED_KEY_LIMIT);
-        metadata.key_origin.path.push_back(119 | BIP32_HARDENED_KEY_LIMIT);
-        metadata.key_origin.path.push_back(nAccountNumber | BIP32_HARDENED_KEY_LIMIT);
         // Child chain counter
-        uint32_t& chainCounter = hdChain.GetChainCounter(changeType);
-        changeKey.Derive(childKey, chainCounter | BIP32_HARDENED_KEY_LIMIT);
-        metadata.key_origin.path.push_back( changeType | BIP32_HARDENED_KEY_LIMIT);
-        metadata.key_origin.path.push_back(chainCounter | BIP32_HARDENED_KEY_LIMIT);
-        chainCounter++;
-
+        index = hdChain.GetChainCounter(changeType)++;
+        changeKey.Derive(childKey, index | BIP32_HARDENED_KEY_LIMIT);
     } while (wallet->HaveKey(childKey.key.GetPubKey().GetID()));
 
     secret = childKey.key;
-    metadata.hd_seed_id = hdChain.GetID();
-    CKeyID master_id = masterKey.key.GetPubKey().GetID();
-    std::copy(master_id.begin(), master_id.begin() + 4, metadata.key_origin.fingerprint);
+    SetHDKeyOrigin(metadata, masterId, changeType, index);
     // update the chain model in the database
     if (!batch.WriteHDChain(hdChain))
         throw std::runtime_error(std::string(__func__) + ": Writing HD chain model failed");
@@ -584,18 +679,18 @@ bool ScriptPubKeyMan::AddKeyPubKeyWithDB(WalletBatch& batch, const CKey& secret,
     // Make sure we aren't adding private keys to private key disabled wallets
     //assert(!m_storage.IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS));
 
-    // FillableSigningProvider has no concept of wallet databases, but calls AddCryptedKey
-    // which is overridden below.  To avoid flushes, the database handle is
-    // tunneled through to it.
-    bool needsDB = !encrypted_batch;
+    // The keystore has no concept of wallet databases, but calls CWallet::AddKeyPubKey and
+    // CWallet::AddCryptedKey, which write the key. To avoid flushes, and to keep the writes
+    // in the transaction of the batch, the database handle is tunneled through to them.
+    bool needsDB = !wallet->encrypted_batch;
     if (needsDB) {
-        encrypted_batch = &batch;
+        wallet->encrypted_batch = &batch;
     }
     if (!AddKeyPubKeyInner(secret, pubkey)) {
-        if (needsDB) encrypted_batch = nullptr;
+        if (needsDB) wallet->encrypted_batch = nullptr;
         return false;
     }
-    if (needsDB) encrypted_batch = nullptr;
+    if (needsDB) wallet->encrypted_batch = nullptr;
     return true;
 }
 
@@ -129,9 +129,6 @@ private:
     /* the HD chain data model (external/internal chain counters) */
     CHDChain hdChain;
 
-    /* TODO: This has not been implemented yet.. */
-    WalletBatch *encrypted_batch = nullptr;
-
     // Key pool maps
     std::set<int64_t> setInternalKeyPool;
     std::set<int64_t> setExternalKeyPool;
@@ -149,7 +146,15 @@ private:
     /* Complete me */
     void AddKeypoolPubkeyWithDB(const CPubKey& pubkey, const uint8_t& type, WalletBatch& batch);
     void GeneratePool(WalletBatch& batch, int64_t targetSize, const uint8_t& type);
-
+    /* Generate targetSize keys of the HD chain into the keypool, deriving them in parallel */
+    void GenerateHDPool(WalletBatch& batch, int64_t targetSize, const uint8_t& changeType);
+    /* Add a new key, with its metadata, to the store and to disk */
+    void AddGeneratedKey(WalletBatch& batch, const CKey& secret, const CPubKey& pubkey, const CKeyMetadata& metadata);
+
+    /* HD derive the key of the internal, external or staking chain, and the id of the master key */
+    void DeriveChangeKey(const uint8_t& changeType, CExtKey& changeKey, CKeyID& masterId);
+    /* Set the HD key path of the child key at index of the chain, and its seed */
+    void SetHDKeyOrigin(CKeyMetadata& metadata, const CKeyID& masterId, const uint8_t& changeType, uint32_t index) const;
     /* HD derive new child key (on internal or external chain) */
     void DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey& secret, const uint8_t& type = HDChain::ChangeType::EXTERNAL);
 
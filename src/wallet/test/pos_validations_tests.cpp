@@ -194,6 +194,232 @@ static COutput GetUnspentCoin(CWallet* pwallet, std::initializer_list<std::share
     throw std::runtime_error("Unspent coin not found");
 }
 
+// A payout batch spends distinct coins, and all its txs are signed and accepted to the mempool
+BOOST_FIXTURE_TEST_CASE(create_transactions_batch_tests, TestPoSChainSetup)
+{
+    // Enough inputs to sign them on the signing pool
+    const size_t nPayouts = 20;
+    std::vector<std::vector<CRecipient>> vecSends(nPayouts);
+    for (auto& vecSend : vecSends) {
+        CKey key;
+        key.MakeNewKey(true);
+        vecSend.emplace_back(GetScriptForDestination(key.GetPubKey().GetID()), 1 * COIN, false);
+    }
+
+    std::vector<CTransactionRef> vtx;
+    std::vector<std::unique_ptr<CReserveKey>> vReserveKeys;
+    std::string strFailReason;
+    BOOST_CHECK(pwalletMain->CreateTransactions(vecSends, vtx, vReserveKeys, strFailReason));
+    BOOST_CHECK_EQUAL(vtx.size(), nPayouts);
+    BOOST_CHECK_EQUAL(vReserveKeys.size(), nPayouts);
+
+    std::set<COutPoint> setSpent;
+    for (const CTransactionRef& tx : vtx) {
+        for (const CTxIn& in : tx->vin) {
+            BOOST_CHECK(setSpent.insert(in.prevout).second);
+        }
+    }
+
+    const std::vector<CWallet::CommitResult>& vResults = pwalletMain->CommitTransactions(vtx, vReserveKeys, nullptr);
+    BOOST_CHECK_EQUAL(vResults.size(), nPayouts);
+    for (size_t i = 0; i < vResults.size(); i++) {
+        BOOST_CHECK_EQUAL(vResults[i].status, CWallet::CommitStatus::OK);
+        BOOST_CHECK(vResults[i].hashTx == vtx[i]->GetHash());
+        BOOST_CHECK(WITH_LOCK(pwalletMain->cs_wallet, return pwalletMain->GetWalletTx(vtx[i]->GetHash()) != nullptr));
+        BOOST_CHECK(mempool.exists(vtx[i]->GetHash()));
+    }
+
+    // An empty batch is rejected
+    BOOST_CHECK(!pwalletMain->CreateTransactions({}, vtx, vReserveKeys, strFailReason));
+    BOOST_CHECK(vtx.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(kernel_search_tests, TestPoSChainSetup)
+{
+    const CBlockIndex* pindexPrev = WITH_LOCK(cs_main, return chainActive.Tip());
+    BOOST_CHECK(Params().GetConsensus().NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_V3_4));
+    std::vector<CStakeableOutput> availableCoins;
+    BOOST_CHECK(pwalletMain->StakeableCoins(&availableCoins));
+    BOOST_CHECK(!availableCoins.empty());
+
+    // The cached kernels must give the same hashes, and the same results, as CStakeKernel.
+    // The second nBits is an easy target, so that some of the kernels are found.
+    CStakeKernelSearch kernelSearch;
+    int nFound = 0;
+    for (unsigned int nBits : {pindexPrev->nBits, 0x207fffffu}) {
+        for (int nTimeTx = pindexPrev->nTime + 1; nTimeTx < (int)pindexPrev->nTime + 200; nTimeTx += 15) {
+            for (const CStakeableOutput& out : availableCoins) {
+                CPivStake stakeInput(out.tx->tx->vout[out.i], COutPoint(out.tx->GetHash(), out.i), out.pindex);
+                CStakeKernel stakeKernel(pindexPrev, &stakeInput, nBits, nTimeTx);
+                BOOST_CHECK(kernelSearch.GetHash(pindexPrev, &stakeInput, nBits, nTimeTx) == stakeKernel.GetHash());
+                const bool res = stakeKernel.CheckKernelHash(true);
+                BOOST_CHECK_EQUAL(kernelSearch.CheckKernelHash(pindexPrev, &stakeInput, nBits, nTimeTx), res);
+                if (res) nFound++;
+            }
+        }
+    }
+    BOOST_CHECK(nFound > 0);
+
+    // A different parent resets the cache
+    const CBlockIndex* pindexOther = pindexPrev->pprev;
+    const CStakeableOutput& out = availableCoins.front();
+    CPivStake stakeInput(out.tx->tx->vout[out.i], COutPoint(out.tx->GetHash(), out.i), out.pindex);
+    const int nTimeTx = pindexPrev->nTime + 1;
+    BOOST_CHECK(kernelSearch.GetHash(pindexPrev, &stakeInput, pindexPrev->nBits, nTimeTx) !=
+                kernelSearch.GetHash(pindexOther, &stakeInput, pindexPrev->nBits, nTimeTx));
+    BOOST_CHECK(kernelSearch.GetHash(pindexPrev, &stakeInput, pindexPrev->nBits, nTimeTx) ==
+                CStakeKernel(pindexPrev, &stakeInput, pindexPrev->nBits, nTimeTx).GetHash());
+}
+
+static std::set<COutPoint> GetStakeableOutpoints(CWallet* pwallet)
+{
+    std::vector<CStakeableOutput> availableCoins;
+    pwallet->StakeableCoins(&availableCoins);
+    std::set<COutPoint> ret;
+    for (const CStakeableOutput& out : availableCoins) {
+        ret.emplace(out.tx->GetHash(), out.i);
+    }
+    return ret;
+}
+
+BOOST_FIXTURE_TEST_CASE(stakeable_coins_index_tests, TestPoSChainSetup)
+{
+    // Going through the index again, or refilling it, doesn't change the result
+    const std::set<COutPoint> coins = GetStakeableOutpoints(pwalletMain.get());
+    BOOST_CHECK(!coins.empty());
+    BOOST_CHECK(GetStakeableOutpoints(pwalletMain.get()) == coins);
+    pwalletMain->MarkDirty();
+    BOOST_CHECK(GetStakeableOutpoints(pwalletMain.get()) == coins);
+
+    // The coin spent by a coinstake is dropped from the index...
+    std::shared_ptr<CBlock> pblock = CreateBlockInternal(pwalletMain.get());
+    BOOST_CHECK(pblock->IsProofOfStake());
+    const COutPoint stakedCoin = pblock->vtx[1]->vin[0].prevout;
+    BOOST_CHECK(coins.count(stakedCoin));
+    BOOST_CHECK(ProcessNewBlock(pblock, nullptr));
+    SyncWithValidationInterfaceQueue();
+    CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainActive.Tip());
+    BOOST_CHECK(pindexTip->GetBlockHash() == pblock->GetHash());
+    BOOST_CHECK(!GetStakeableOutpoints(pwalletMain.get()).count(stakedCoin));
+
+    // ...and disconnecting the block gives it back
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), pindexTip));
+        BOOST_CHECK(state.IsValid());
+    }
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(WITH_LOCK(cs_main, return chainActive.Tip()) == pindexTip->pprev);
+    BOOST_CHECK(GetStakeableOutpoints(pwalletMain.get()).count(stakedCoin));
+}
+
+BOOST_FIXTURE_TEST_CASE(stake_template_tests, TestPoSChainSetup)
+{
+    CBlockIndex* pindexPrev = WITH_LOCK(cs_main, return chainActive.Tip());
+    std::unique_ptr<CBlockTemplate> stakeTemplate = BlockAssembler(Params(), false).CreateStakeTemplate(pindexPrev);
+    BOOST_CHECK(stakeTemplate);
+    BOOST_CHECK(stakeTemplate->block.hashPrevBlock == pindexPrev->GetBlockHash());
+    BOOST_CHECK_EQUAL(stakeTemplate->block.vtx.size(), stakeTemplate->vTxFees.size());
+
+    // Completing the template gives a valid PoS block
+    std::vector<CStakeableOutput> availableCoins;
+    BOOST_CHECK(pwalletMain->StakeableCoins(&availableCoins));
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(Params(), false).CreateNewStakeBlock(*stakeTemplate, pwalletMain.get(), &availableCoins);
+    BOOST_CHECK(pblocktemplate);
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(pblocktemplate->block);
+    BOOST_CHECK(pblock->IsProofOfStake());
+    BOOST_CHECK_EQUAL(pblock->vtx.size(), stakeTemplate->block.vtx.size() + 2);
+    BOOST_CHECK(pblock->hashFinalSaplingRoot == stakeTemplate->block.hashFinalSaplingRoot);
+    BOOST_CHECK(ProcessNewBlock(pblock, nullptr));
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash()) == pblock->GetHash());
+
+    // A template on top of the previous tip is stale
+    BOOST_CHECK(pwalletMain->StakeableCoins(&availableCoins));
+    BOOST_CHECK(!BlockAssembler(Params(), false).CreateNewStakeBlock(*stakeTemplate, pwalletMain.get(), &availableCoins));
+
+    // Updating the stale template rebuilds it on top of the new tip, then keeps its txs
+    CBlockIndex* pindexTip = WITH_LOCK(cs_main, return chainActive.Tip());
+    stakeTemplate = BlockAssembler(Params(), false).UpdateStakeTemplate(std::move(stakeTemplate), pindexTip);
+    BOOST_REQUIRE(stakeTemplate);
+    BOOST_CHECK(stakeTemplate->block.hashPrevBlock == pindexTip->GetBlockHash());
+    const size_t nTemplateTxes = stakeTemplate->block.vtx.size();
+    const uint256 hashSaplingRoot = stakeTemplate->block.hashFinalSaplingRoot;
+    stakeTemplate = BlockAssembler(Params(), false).UpdateStakeTemplate(std::move(stakeTemplate), pindexTip);
+    BOOST_REQUIRE(stakeTemplate);
+    BOOST_CHECK_EQUAL(stakeTemplate->block.vtx.size(), nTemplateTxes);
+    BOOST_CHECK_EQUAL(stakeTemplate->vTxFees.size(), nTemplateTxes);
+    BOOST_CHECK(stakeTemplate->block.hashFinalSaplingRoot == hashSaplingRoot);
+}
+
+BOOST_FIXTURE_TEST_CASE(staking_stats_tests, TestPoSChainSetup)
+{
+    CStakerStatus* ss = pwalletMain->pStakerStatus;
+    BOOST_CHECK(ss);
+    ss->ResetStats();
+
+    // Staking a block times the kernel search and the signatures
+    std::shared_ptr<CBlock> pblock = CreateBlockInternal(pwalletMain.get());
+    CStakerStats stats = ss->GetStats();
+    BOOST_CHECK_EQUAL(stats.nSlots, 1);
+    BOOST_CHECK(stats.nKernels > 0);
+    BOOST_CHECK_EQUAL(stats.nLastSlotKernels, (int)stats.nKernels);
+    BOOST_CHECK_EQUAL(stats.vTimers[(size_t)StakingStep::KERNEL_SEARCH].nCount, 1);
+    BOOST_CHECK_EQUAL(stats.vTimers[(size_t)StakingStep::SIGN_COINSTAKE].nCount, 1);
+    BOOST_CHECK_EQUAL(stats.vTimers[(size_t)StakingStep::SIGN_BLOCK].nCount, 1);
+    BOOST_CHECK_EQUAL(stats.vTimers[(size_t)StakingStep::PROCESS_BLOCK].nCount, 0);
+
+    // Slots and missed slots
+    ss->ResetStats();
+    const int64_t nSlotLength = Params().GetConsensus().nTimeSlotLength;
+    const int64_t nSlot = GetTimeSlot(GetTime());
+    ss->AddStakeAttempt(nSlot, 10);
+    ss->AddStakeAttempt(nSlot, 5);                      // same slot, new tip
+    ss->AddStakeAttempt(nSlot + nSlotLength, 10);
+    ss->AddStakeAttempt(nSlot + 4 * nSlotLength, 10);   // two slots missed
+    stats = ss->GetStats();
+    BOOST_CHECK_EQUAL(stats.nSlots, 3);
+    BOOST_CHECK_EQUAL(stats.nMissedSlots, 2);
+    BOOST_CHECK_EQUAL(stats.nKernels, 35);
+    BOOST_CHECK_EQUAL(stats.nLastSlotKernels, 10);
+
+    // Histogram buckets
+    ss->AddStakingTime(StakingStep::BLOCK_TEMPLATE, 50);
+    ss->AddStakingTime(StakingStep::BLOCK_TEMPLATE, 100);
+    ss->AddStakingTime(StakingStep::BLOCK_TEMPLATE, 5000000);
+    stats = ss->GetStats();
+    const CStakingTimer& timer = stats.vTimers[(size_t)StakingStep::BLOCK_TEMPLATE];
+    BOOST_CHECK_EQUAL(timer.nCount, 3);
+    BOOST_CHECK_EQUAL(timer.nTotalMicros, 5000150);
+    BOOST_CHECK_EQUAL(timer.nMaxMicros, 5000000);
+    BOOST_CHECK_EQUAL(timer.vBuckets[0], 1);
+    BOOST_CHECK_EQUAL(timer.vBuckets[1], 1);
+    BOOST_CHECK_EQUAL(timer.vBuckets.back(), 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(block_prevalidation_tests, TestPoSChainSetup)
+{
+    std::shared_ptr<CBlock> pblock = CreateBlockInternal(pwalletMain.get());
+    BOOST_CHECK(pblock->IsProofOfStake());
+    CBlockSignatureCheck sigCheck(pblock);
+    BOOST_CHECK(CBlockCheck(sigCheck)());
+
+    // A bad signature fails, even after pre-validating its block
+    std::shared_ptr<CBlock> pblockBadSig = std::make_shared<CBlock>(*pblock);
+    pblockBadSig->vchBlockSig.back() ^= 1;
+    CBlockSignatureCheck badSigCheck(pblockBadSig);
+    BOOST_CHECK(!CBlockCheck(badSigCheck)());
+    PreValidateBlocks({pblockBadSig});
+    BOOST_CHECK(!CheckBlockSignature(*pblockBadSig));
+
+    // The pre-validated block is processed as usual
+    PreValidateBlocks({pblock});
+    BOOST_CHECK(ProcessNewBlock(pblock, nullptr));
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(WITH_LOCK(cs_main, return chainActive.Tip()->GetBlockHash()) == pblock->GetHash());
+}
+
 BOOST_FIXTURE_TEST_CASE(created_on_fork_tests, TestPoSChainSetup)
 {
     // Let's create few more PoS blocks
@@ -249,7 +475,7 @@ BOOST_FIXTURE_TEST_CASE(created_on_fork_tests, TestPoSChainSetup)
 
     // Ensure that the coin does not exist in the main chain
     const Coin& utxo = pcoinsTip->AccessCoin(COutPoint(d1Tx.GetHash(), 0));
-    BOOST_CHECK(utxo.out.IsNull());
+    BOOST_CHECK(utxo.IsSpent());
 
     // Create valid block E
     auto eTx = CreateAndCommitTx(pwalletMain.get(), *dest, 200 * COIN);
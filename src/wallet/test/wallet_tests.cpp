@@ -654,4 +654,197 @@ BOOST_AUTO_TEST_CASE(cached_balances_tests)
 
 }
 
+// The cached amounts of a tx are only broken by the events that change them
+BOOST_AUTO_TEST_CASE(cached_amounts_invalidation_tests)
+{
+    CWallet wallet("testWallet6", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.SetMinVersion(FEATURE_PRE_SPLIT_KEYPOOL);
+    wallet.SetupSPKM(false);
+    wallet.SetLastBlockProcessed(chainActive.Tip());
+
+    auto res = wallet.getNewAddress("receiving_address");
+    BOOST_ASSERT(res);
+    const CTxOut creditOut(10 * COIN, GetScriptForDestination(*res.getObjResult()));
+    CWalletTx& wtxCredit = ReceiveBalanceWith({creditOut, creditOut}, wallet);
+    CheckBalances(wtxCredit, 20 * COIN, 20 * COIN, 20 * COIN, 0, 0);
+
+    // A confirmation status update keeps the cached amounts, and the available credit is still gated by the depth
+    CWalletTx wtxConfirmed(wtxCredit);
+    SimpleFakeMine(wtxConfirmed, wallet);
+    BOOST_CHECK(wallet.AddToWallet(wtxConfirmed));
+    BOOST_CHECK(wtxCredit.isConfirmed());
+    BOOST_CHECK(wtxCredit.IsAmountCached(CWalletTx::CREDIT, ISMINE_SPENDABLE));
+    BOOST_CHECK(wtxCredit.IsAmountCached(CWalletTx::DEBIT, ISMINE_SPENDABLE));
+    BOOST_CHECK(wtxCredit.IsAmountCached(CWalletTx::AVAILABLE_CREDIT, ISMINE_SPENDABLE));
+    BOOST_CHECK_EQUAL(wtxCredit.GetAvailableCredit(), 20 * COIN);
+
+    // Spending an output only breaks the available credit of the parent
+    CKey key;
+    key.MakeNewKey(true);
+    CMutableTransaction mtxDebit;
+    mtxDebit.vin.emplace_back(COutPoint(wtxCredit.GetHash(), 0));
+    mtxDebit.vout.emplace_back(10 * COIN, GetScriptForDestination(key.GetPubKey().GetID()));
+    wallet.TransactionAddedToMempool(MakeTransactionRef(mtxDebit));
+    BOOST_CHECK(wallet.mapWallet.count(mtxDebit.GetHash()));
+    BOOST_CHECK(wtxCredit.IsAmountCached(CWalletTx::CREDIT, ISMINE_SPENDABLE));
+    BOOST_CHECK(wtxCredit.IsAmountCached(CWalletTx::DEBIT, ISMINE_SPENDABLE));
+    BOOST_CHECK(!wtxCredit.IsAmountCached(CWalletTx::AVAILABLE_CREDIT, ISMINE_SPENDABLE));
+    BOOST_CHECK_EQUAL(wtxCredit.GetAvailableCredit(), 10 * COIN);
+    BOOST_CHECK_EQUAL(wtxCredit.GetCredit(ISMINE_SPENDABLE), 20 * COIN);
+}
+
+// The wallet balances are cached until a wallet tx, or its state, changes
+BOOST_AUTO_TEST_CASE(wallet_balance_cache_tests)
+{
+    CWallet wallet("testWallet3", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.SetMinVersion(FEATURE_PRE_SPLIT_KEYPOOL);
+    wallet.SetupSPKM(false);
+    wallet.SetLastBlockProcessed(chainActive.Tip());
+
+    auto res = wallet.getNewAddress("receiving_address");
+    BOOST_ASSERT(res);
+    const CTxOut creditOut(10 * COIN, GetScriptForDestination(*res.getObjResult()));
+    isminefilter filter = ISMINE_SPENDABLE_ALL;
+
+    CWalletTx& wtx1 = ReceiveBalanceWith({creditOut}, wallet);
+    CBlockIndex* pindex = SimpleFakeMine(wtx1, wallet);
+    BOOST_CHECK_EQUAL(wallet.GetBalance().m_mine_trusted, 10 * COIN);
+    BOOST_CHECK_EQUAL(wallet.GetAvailableBalance(filter, true, 0), 10 * COIN);
+
+    // A new tx refreshes the cached balances
+    CWalletTx& wtx2 = ReceiveBalanceWith({creditOut, creditOut}, wallet);
+    SimpleFakeMine(wtx2, wallet, pindex);
+    BOOST_CHECK_EQUAL(wallet.GetBalance().m_mine_trusted, 30 * COIN);
+    BOOST_CHECK_EQUAL(wallet.GetAvailableBalance(filter, true, 0), 30 * COIN);
+    // ...and so does its removal
+    wallet.EraseFromWallet(wtx2.GetHash());
+    BOOST_CHECK_EQUAL(wallet.GetBalance().m_mine_trusted, 10 * COIN);
+    BOOST_CHECK_EQUAL(wallet.GetAvailableBalance(filter, true, 0), 10 * COIN);
+}
+
+// AvailableCoins finds the outputs of the coin candidates, until they are spent in the chain
+BOOST_AUTO_TEST_CASE(available_coins_candidates_tests)
+{
+    CWallet wallet("testWallet4", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.SetMinVersion(FEATURE_PRE_SPLIT_KEYPOOL);
+    wallet.SetupSPKM(false);
+    wallet.SetLastBlockProcessed(chainActive.Tip());
+
+    auto res = wallet.getNewAddress("receiving_address");
+    BOOST_ASSERT(res);
+    const CTxOut creditOut(10 * COIN, GetScriptForDestination(*res.getObjResult()));
+    CWalletTx& wtxCredit = ReceiveBalanceWith({creditOut, creditOut}, wallet);
+    CBlockIndex* pindex = SimpleFakeMine(wtxCredit, wallet);
+    std::vector<COutput> vCoins;
+    BOOST_CHECK(wallet.AvailableCoins(&vCoins));
+    BOOST_CHECK_EQUAL(vCoins.size(), 2);
+    BOOST_CHECK(wallet.AvailableCoins(nullptr));
+
+    // Spend both outputs, in the chain, to an external key
+    CKey key;
+    key.MakeNewKey(true);
+    const std::vector<CTxIn> vin = {CTxIn(COutPoint(wtxCredit.GetHash(), 0)), CTxIn(COutPoint(wtxCredit.GetHash(), 1))};
+    CWalletTx& wtxDebit = BuildAndLoadTxToWallet(vin, {CTxOut(19 * COIN, GetScriptForDestination(key.GetPubKey().GetID()))}, wallet);
+    SimpleFakeMine(wtxDebit, wallet, pindex);
+    BOOST_CHECK(!wallet.AvailableCoins(&vCoins));
+    BOOST_CHECK(vCoins.empty());
+    BOOST_CHECK(!wallet.AvailableCoins(nullptr));
+}
+
+BOOST_AUTO_TEST_CASE(p2cs_index_tests)
+{
+    CWallet wallet("testWallet2", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK2(cs_main, wallet.cs_wallet);
+    wallet.SetMinVersion(FEATURE_PRE_SPLIT_KEYPOOL);
+    wallet.SetupSPKM(false);
+    wallet.SetLastBlockProcessed(chainActive.Tip());
+
+    // Delegate two outputs from a wallet address to an external staker
+    auto res = wallet.getNewAddress("owner_address");
+    BOOST_ASSERT(res);
+    const CKeyID ownerId = *boost::get<CKeyID>(&(*res.getObjResult()));
+    CKey stakerKey;
+    stakerKey.MakeNewKey(true);
+    const CKeyID stakerId = stakerKey.GetPubKey().GetID();
+    CTxOut delegationOut(10 * COIN, GetScriptForStakeDelegation(stakerId, ownerId));
+    CTxOut plainOut(10 * COIN, GetScriptForDestination(ownerId));
+    CWalletTx& wtx = ReceiveBalanceWith({delegationOut, plainOut, delegationOut}, wallet);
+    const std::set<COutPoint> expected = {COutPoint(wtx.GetHash(), 0), COutPoint(wtx.GetHash(), 2)};
+
+    // Only the P2CS outputs are indexed, under both keys
+    BOOST_CHECK(wallet.GetP2CSOutpoints() == expected);
+    BOOST_CHECK(wallet.GetP2CSOutpointsByStaker(stakerId) == expected);
+    BOOST_CHECK(wallet.GetP2CSOutpointsByOwner(ownerId) == expected);
+    BOOST_CHECK(wallet.GetP2CSOutpointsByStaker(ownerId).empty());
+    BOOST_CHECK(wallet.GetP2CSOutpointsByOwner(stakerId).empty());
+
+    std::vector<COutput> vCoins;
+    wallet.GetAvailableP2CSCoins(vCoins);
+    BOOST_CHECK_EQUAL(vCoins.size(), 2);
+
+    // Erasing the tx drops its outputs from the index
+    wallet.EraseFromWallet(wtx.GetHash());
+    BOOST_CHECK(wallet.GetP2CSOutpoints().empty());
+    BOOST_CHECK(wallet.GetP2CSOutpointsByStaker(stakerId).empty());
+    BOOST_CHECK(wallet.GetP2CSOutpointsByOwner(ownerId).empty());
+    wallet.GetAvailableP2CSCoins(vCoins);
+    BOOST_CHECK(vCoins.empty());
+}
+
+// The keypool keys derived in parallel are the keys of the HD chain at consecutive indexes,
+// skipping the ones already in the wallet
+BOOST_AUTO_TEST_CASE(keypool_parallel_derivation_tests)
+{
+    CWallet wallet("testWallet5", WalletDatabase::CreateMock());
+    bool fFirstRun;
+    BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+    LOCK(wallet.cs_wallet);
+    wallet.SetMinVersion(FEATURE_PRE_SPLIT_KEYPOOL);
+    wallet.SetupSPKM(false);
+    ScriptPubKeyMan* spk_man = wallet.GetScriptPubKeyMan();
+    BOOST_CHECK_EQUAL(spk_man->KeypoolCountExternalKeys(), 0);
+
+    // m/44'/119'/0'/0'
+    CKey seed;
+    BOOST_CHECK(wallet.GetKey(spk_man->GetHDChain().GetID(), seed));
+    CExtKey masterKey, purposeKey, cointypeKey, accountKey, externalKey;
+    masterKey.SetSeed(seed.begin(), seed.size());
+    masterKey.Derive(purposeKey, 44 | BIP32_HARDENED_KEY_LIMIT);
+    purposeKey.Derive(cointypeKey, 119 | BIP32_HARDENED_KEY_LIMIT);
+    cointypeKey.Derive(accountKey, BIP32_HARDENED_KEY_LIMIT);
+    accountKey.Derive(externalKey, HDChain::ChangeType::EXTERNAL | BIP32_HARDENED_KEY_LIMIT);
+    std::vector<CKey> vKeys(301);
+    for (uint32_t i = 0; i < vKeys.size(); i++) {
+        CExtKey childKey;
+        externalKey.Derive(childKey, i | BIP32_HARDENED_KEY_LIMIT);
+        vKeys[i] = childKey.key;
+    }
+
+    // The key at index 5 is already in the wallet
+    BOOST_CHECK(wallet.AddKeyPubKey(vKeys[5], vKeys[5].GetPubKey()));
+    BOOST_CHECK(wallet.TopUpKeyPool(300));
+    BOOST_CHECK_EQUAL(spk_man->KeypoolCountExternalKeys(), 300);
+    CHDChain chain = spk_man->GetHDChain();
+    BOOST_CHECK_EQUAL(chain.GetChainCounter(HDChain::ChangeType::EXTERNAL), 301);
+    for (uint32_t i = 0; i < vKeys.size(); i++) {
+        const CKeyID keyID = vKeys[i].GetPubKey().GetID();
+        BOOST_CHECK(wallet.HaveKey(keyID));
+        if (i == 5) continue;
+        const std::vector<uint32_t>& path = wallet.mapKeyMetadata.at(keyID).key_origin.path;
+        BOOST_CHECK_EQUAL(path.size(), 5);
+        BOOST_CHECK_EQUAL(path.back(), i | BIP32_HARDENED_KEY_LIMIT);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -15,6 +15,7 @@
 
 #include "checkpoints.h"
 #include "coincontrol.h"
+#include "ctpl_stl.h"
 #include "evo/providertx.h"
 #include "guiinterfaceutil.h"
 #include "policy/policy.h"
@@ -24,9 +25,12 @@
 #include "shutdown.h"
 #include "spork.h"
 #include "util/validation.h"
+#include "util/threadnames.h"
 #include "utilmoneystr.h"
 #include "wallet/fees.h"
 
+#include <atomic>
+#include <deque>
 #include <future>
 #include <boost/algorithm/string/replace.hpp>
 
@@ -268,10 +272,10 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey& pubkey)
     }
 
     if (!IsCrypted()) {
-        return WalletBatch(*database).WriteKey(
-                pubkey,
-                secret.GetPrivKey(),
-                mapKeyMetadata[pubkey.GetID()]);
+        if (encrypted_batch)
+            return encrypted_batch->WriteKey(pubkey, secret.GetPrivKey(), mapKeyMetadata[pubkey.GetID()]);
+        else
+            return WalletBatch(*database).WriteKey(pubkey, secret.GetPrivKey(), mapKeyMetadata[pubkey.GetID()]);
     }
     return true;
 }
@@ -362,6 +366,9 @@ bool CWallet::RemoveWatchOnly(const CScript& dest)
         return false;
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
+    // Within the transaction of the batch adding a key, if any
+    if (encrypted_batch)
+        return encrypted_batch->EraseWatchOnly(dest);
     if (!WalletBatch(*database).EraseWatchOnly(dest))
         return false;
 
@@ -737,11 +744,130 @@ bool CWallet::IsSpent(const COutPoint& outpoint) const
     return false;
 }
 
+void CWallet::ForEachCoinCandidate(const std::function<bool(const uint256&, const CWalletTx*)>& method) const
+{
+    AssertLockHeld(cs_wallet);
+    for (auto cit = setCoinCandidates.begin(); cit != setCoinCandidates.end();) {
+        const uint256& wtxid = *cit;
+        auto it = mapWallet.find(wtxid);
+        if (it == mapWallet.end()) {
+            // erased from the wallet
+            cit = setCoinCandidates.erase(cit);
+            continue;
+        }
+        const CWalletTx* pcoin = &(it->second);
+
+        // Drop the tx if none of its outputs can ever be spent (unless a block is disconnected)
+        bool fCandidate = false;
+        for (unsigned int index = 0; index < pcoin->tx->vout.size() && !fCandidate; index++) {
+            fCandidate = IsMine(*pcoin->tx, index) != ISMINE_NO && !IsSpentInChain(COutPoint(wtxid, index));
+        }
+        if (!fCandidate) {
+            cit = setCoinCandidates.erase(cit);
+            continue;
+        }
+        cit++;
+
+        if (!method(wtxid, pcoin)) return;
+    }
+}
+
 bool CWallet::IsSpent(const uint256& hash, unsigned int n) const
 {
     return IsSpent(COutPoint(hash, n));
 }
 
+bool CWallet::IsSpentInChain(const COutPoint& outpoint) const
+{
+    AssertLockHeld(cs_wallet);
+    std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
+    range = mapTxSpends.equal_range(outpoint);
+    for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+        const uint256& wtxid = it->second;
+        auto mit = mapWallet.find(wtxid);
+        if (mit != mapWallet.end() && mit->second.GetDepthInMainChain() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The staker and owner key ids of a P2CS script
+static bool ExtractP2CSKeys(const CScript& script, CKeyID& stakerId, CKeyID& ownerId)
+{
+    CTxDestination stakerDest, ownerDest;
+    if (!script.IsPayToColdStaking() ||
+        !ExtractDestination(script, stakerDest, true) ||
+        !ExtractDestination(script, ownerDest, false)) {
+        return false;
+    }
+    const CKeyID* pStakerId = boost::get<CKeyID>(&stakerDest);
+    const CKeyID* pOwnerId = boost::get<CKeyID>(&ownerDest);
+    if (!pStakerId || !pOwnerId) return false;
+    stakerId = *pStakerId;
+    ownerId = *pOwnerId;
+    return true;
+}
+
+void CWallet::AddToP2CSIndex(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    if (!wtx.tx->HasP2CSOutputs()) return;
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        CKeyID stakerId, ownerId;
+        if (ExtractP2CSKeys(wtx.tx->vout[i].scriptPubKey, stakerId, ownerId)) {
+            const COutPoint outpoint(wtx.GetHash(), i);
+            mapP2CSByStaker[stakerId].emplace(outpoint);
+            mapP2CSByOwner[ownerId].emplace(outpoint);
+        }
+    }
+}
+
+void CWallet::RemoveFromP2CSIndex(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    if (!wtx.tx->HasP2CSOutputs()) return;
+    auto eraseFrom = [](std::map<CKeyID, std::set<COutPoint>>& index, const CKeyID& keyId, const COutPoint& outpoint) {
+        auto it = index.find(keyId);
+        if (it == index.end()) return;
+        it->second.erase(outpoint);
+        if (it->second.empty()) index.erase(it);
+    };
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        CKeyID stakerId, ownerId;
+        if (ExtractP2CSKeys(wtx.tx->vout[i].scriptPubKey, stakerId, ownerId)) {
+            const COutPoint outpoint(wtx.GetHash(), i);
+            eraseFrom(mapP2CSByStaker, stakerId, outpoint);
+            eraseFrom(mapP2CSByOwner, ownerId, outpoint);
+        }
+    }
+}
+
+std::set<COutPoint> CWallet::GetP2CSOutpoints() const
+{
+    LOCK(cs_wallet);
+    std::set<COutPoint> ret;
+    // every P2CS output has exactly one staker
+    for (const auto& it : mapP2CSByStaker) {
+        ret.insert(it.second.begin(), it.second.end());
+    }
+    return ret;
+}
+
+std::set<COutPoint> CWallet::GetP2CSOutpointsByStaker(const CKeyID& stakerId) const
+{
+    LOCK(cs_wallet);
+    auto it = mapP2CSByStaker.find(stakerId);
+    return it != mapP2CSByStaker.end() ? it->second : std::set<COutPoint>();
+}
+
+std::set<COutPoint> CWallet::GetP2CSOutpointsByOwner(const CKeyID& ownerId) const
+{
+    LOCK(cs_wallet);
+    auto it = mapP2CSByOwner.find(ownerId);
+    return it != mapP2CSByOwner.end() ? it->second : std::set<COutPoint>();
+}
+
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.emplace(outpoint, wtxid);
@@ -893,33 +1019,42 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
-        for (std::pair<const uint256, CWalletTx> & item : mapWallet)
+        for (std::pair<const uint256, CWalletTx> & item : mapWallet) {
             item.second.MarkDirty();
+            // outputs can be mine now
+            setCoinCandidates.emplace_hint(setCoinCandidates.end(), item.first);
+        }
     }
 }
 
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 {
     LOCK(cs_wallet);
-    WalletBatch batch(*database, "r+", fFlushOnClose);
+    // Write in the transaction of the batch tunneled by CommitTransactions, if any
+    std::unique_ptr<WalletBatch> local_batch;
+    if (!encrypted_batch) local_batch.reset(new WalletBatch(*database, "r+", fFlushOnClose));
+    WalletBatch& batch = encrypted_batch ? *encrypted_batch : *local_batch;
     const uint256& hash = wtxIn.GetHash();
 
     // Inserts only if not already there, returns tx inserted or tx found
     std::pair<std::map<uint256, CWalletTx>::iterator, bool> ret = mapWallet.emplace(hash, wtxIn);
     CWalletTx& wtx = (*ret.first).second;
-    wtx.BindWallet(this);
+    bool fInsertedNew = ret.second;
+    if (fInsertedNew) wtx.BindWallet(this);
     // Sapling
     m_sspk_man->UpdateNullifierNoteMapWithTx(wtx);
-    bool fInsertedNew = ret.second;
     if (fInsertedNew) {
         wtx.nTimeReceived = GetAdjustedTime();
         wtx.nOrderPos = IncOrderPosNext(&batch);
         wtxOrdered.emplace(wtx.nOrderPos, &wtx);
         wtx.UpdateTimeSmart();
         AddToSpends(hash);
+        AddToP2CSIndex(wtx);
+        setCoinCandidates.emplace(hash);
     }
 
     bool fUpdated = false;
+    bool fAmountsUpdated = false;
     if (!fInsertedNew) {
         if (wtxIn.m_confirm.status != wtx.m_confirm.status) {
             wtx.m_confirm.status = wtxIn.m_confirm.status;
@@ -935,12 +1070,15 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         }
         if (HasSaplingSPKM() && m_sspk_man->UpdatedNoteData(wtxIn, wtx)) {
             fUpdated = true;
+            fAmountsUpdated = true;
         }
         if (wtxIn.fFromMe && wtxIn.fFromMe != wtx.fFromMe) {
             wtx.fFromMe = wtxIn.fFromMe;
             fUpdated = true;
+            fAmountsUpdated = true;
         }
     }
+    m_sspk_man->AddToSaplingNotesIndex(wtx);
 
     //// debug print
     LogPrintf("AddToWallet %s  %s%s\n", wtxIn.GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
@@ -951,8 +1089,14 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
             return false;
     }
 
-    // Break debit/credit balance caches:
-    wtx.MarkDirty();
+    // Break debit/credit balance caches. The cached amounts of the tx don't depend on its
+    // confirmation status (the immature and available credits are gated by the depth outside
+    // of the cache), so a status-only update just breaks the wallet balances.
+    if (fInsertedNew || fAmountsUpdated) {
+        wtx.MarkDirty();
+    } else {
+        MarkBalancesDirty();
+    }
 
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -1009,8 +1153,11 @@ bool CWallet::LoadToWallet(CWalletTx& wtxIn)
     wtx.BindWallet(this);
     // Sapling
     m_sspk_man->UpdateNullifierNoteMapWithTx(wtx);
+    m_sspk_man->AddToSaplingNotesIndex(wtx);
     wtxOrdered.emplace(wtx.nOrderPos, &wtx);
     AddToSpends(hash);
+    AddToP2CSIndex(wtx);
+    setCoinCandidates.emplace(hash);
     for (const CTxIn& txin : wtx.tx->vin) {
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
@@ -1191,7 +1338,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             for (const CTxIn& txin : wtx.tx->vin) {
                 auto _it = mapWallet.find(txin.prevout.hash);
                 if (_it != mapWallet.end()) {
-                    _it->second.MarkDirty();
+                    _it->second.MarkAvailableCreditDirty();
                 }
             }
         }
@@ -1250,7 +1397,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, int conflicting_height, c
             for (const CTxIn& txin : wtx.tx->vin) {
                 auto _it = mapWallet.find(txin.prevout.hash);
                 if (_it != mapWallet.end()) {
-                    _it->second.MarkDirty();
+                    _it->second.MarkAvailableCreditDirty();
                 }
             }
         }
@@ -1275,6 +1422,15 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx)
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = true;
+        MarkBalancesDirty();
+    }
+}
+
+void CWallet::TransactionsAddedToMempool(const std::vector<CTransactionRef>& vtx)
+{
+    LOCK(cs_wallet);
+    for (const CTransactionRef& ptx : vtx) {
+        TransactionAddedToMempool(ptx);
     }
 }
 
@@ -1283,6 +1439,7 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx, MemPoolR
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = false;
+        MarkBalancesDirty();
     }
     // Handle transactions that were removed from the mempool because they
     // conflict with transactions in a newly connected block.
@@ -1318,45 +1475,59 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx, MemPoolR
 
 void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex)
 {
+    BlocksConnected({ConnectedBlock(pblock, pindex)});
+}
+
+void CWallet::BlocksConnected(const std::vector<ConnectedBlock>& blocks)
+{
+    bool fAutoCombine = false;
     {
         LOCK2(cs_main, cs_wallet);
-
-        m_last_block_processed = pindex->GetBlockHash();
-        m_last_block_processed_time = pindex->GetBlockTime();
-        m_last_block_processed_height = pindex->nHeight;
-        for (size_t index = 0; index < pblock->vtx.size(); index++) {
-            CWalletTx::Confirmation confirm(CWalletTx::Status::CONFIRMED, m_last_block_processed_height,
-                                            m_last_block_processed, index);
-            SyncTransaction(pblock->vtx[index], confirm);
-            TransactionRemovedFromMempool(pblock->vtx[index], MemPoolRemovalReason::BLOCK);
-        }
-
-        // Sapling: notify about the connected block
-        // Get prev block tree anchor
-        CBlockIndex* pprev = pindex->pprev;
-        SaplingMerkleTree oldSaplingTree;
-        bool isSaplingActive = (pprev) != nullptr &&
-                               Params().GetConsensus().NetworkUpgradeActive(pprev->nHeight,
-                                                                            Consensus::UPGRADE_V5_0);
-        if (isSaplingActive) {
-            assert(pcoinsTip->GetSaplingAnchorAt(pprev->hashFinalSaplingRoot, oldSaplingTree));
-        } else {
-            assert(pcoinsTip->GetSaplingAnchorAt(SaplingMerkleTree::empty_root(), oldSaplingTree));
+        for (const ConnectedBlock& block : blocks) {
+            SyncConnectedBlock(block.first, block.second);
+            fAutoCombine |= fCombineDust && block.second->nHeight % frequency == 0;
         }
-
-        // Sapling: Update cached incremental witnesses
-        ChainTipAdded(pindex, pblock.get(), oldSaplingTree);
     } // cs_wallet lock end
 
     // Auto-combine functionality
     // If turned on Auto Combine will scan wallet for dust to combine
     // Outside of the cs_wallet lock because requires cs_main for now
     // due CreateTransaction/CommitTransaction dependency.
-    if (fCombineDust && pindex->nHeight % frequency == 0) {
+    if (fAutoCombine) {
         AutoCombineDust(g_connman.get());
     }
 }
 
+void CWallet::SyncConnectedBlock(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
+{
+    m_last_block_processed = pindex->GetBlockHash();
+    m_last_block_processed_time = pindex->GetBlockTime();
+    m_last_block_processed_height = pindex->nHeight;
+    MarkBalancesDirty();
+    for (size_t index = 0; index < pblock->vtx.size(); index++) {
+        CWalletTx::Confirmation confirm(CWalletTx::Status::CONFIRMED, m_last_block_processed_height,
+                                        m_last_block_processed, index);
+        SyncTransaction(pblock->vtx[index], confirm);
+        TransactionRemovedFromMempool(pblock->vtx[index], MemPoolRemovalReason::BLOCK);
+    }
+
+    // Sapling: notify about the connected block
+    // Get prev block tree anchor
+    CBlockIndex* pprev = pindex->pprev;
+    SaplingMerkleTree oldSaplingTree;
+    bool isSaplingActive = (pprev) != nullptr &&
+                           Params().GetConsensus().NetworkUpgradeActive(pprev->nHeight,
+                                                                        Consensus::UPGRADE_V5_0);
+    if (isSaplingActive) {
+        assert(pcoinsTip->GetSaplingAnchorAt(pprev->hashFinalSaplingRoot, oldSaplingTree));
+    } else {
+        assert(pcoinsTip->GetSaplingAnchorAt(SaplingMerkleTree::empty_root(), oldSaplingTree));
+    }
+
+    // Sapling: Update cached incremental witnesses
+    ChainTipAdded(pindex, pblock.get(), oldSaplingTree);
+}
+
 void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const uint256& blockHash, int nBlockHeight, int64_t blockTime)
 {
     LOCK(cs_wallet);
@@ -1368,9 +1539,16 @@ void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, con
     m_last_block_processed_height = nBlockHeight - 1;
     m_last_block_processed_time = blockTime;
     m_last_block_processed = blockHash;
+    MarkBalancesDirty();
     for (const CTransactionRef& ptx : pblock->vtx) {
         CWalletTx::Confirmation confirm(CWalletTx::Status::UNCONFIRMED, /* block_height */ 0, {}, /* nIndex */ 0);
         SyncTransaction(ptx, confirm);
+        // the outputs spent by this tx are not spent in the chain anymore
+        for (const CTxIn& txin : ptx->vin) {
+            if (mapWallet.count(txin.prevout.hash)) {
+                setCoinCandidates.emplace(txin.prevout.hash);
+            }
+        }
     }
 
     if (Params().GetConsensus().NetworkUpgradeActive(nBlockHeight, Consensus::UPGRADE_V5_0)) {
@@ -1414,7 +1592,7 @@ void CWallet::MarkAffectedTransactionsDirty(const CTransaction& tx)
         if (!txin.IsZerocoinSpend()) {
             auto it = mapWallet.find(txin.prevout.hash);
             if (it != mapWallet.end()) {
-                it->second.MarkDirty();
+                it->second.MarkAvailableCreditDirty();
             }
         }
     }
@@ -1427,7 +1605,7 @@ void CWallet::MarkAffectedTransactionsDirty(const CTransaction& tx)
             if (nit != m_sspk_man->mapSaplingNullifiersToNotes.end()) {
                 auto it = mapWallet.find(nit->second.hash);
                 if (it != mapWallet.end()) {
-                    it->second.MarkDirty();
+                    it->second.MarkAvailableCreditDirty();
                 }
             }
         }
@@ -1438,8 +1616,13 @@ void CWallet::EraseFromWallet(const uint256& hash)
 {
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        auto it = mapWallet.find(hash);
+        if (it != mapWallet.end()) {
+            RemoveFromP2CSIndex(it->second);
+            mapWallet.erase(it);
+            MarkBalancesDirty();
             WalletBatch(*database).EraseTx(hash);
+        }
         LogPrintf("%s: Erased wtx %s from wallet\n", __func__, hash.GetHex());
     }
     return;
@@ -1548,15 +1731,17 @@ void CWalletTx::UpdateTimeSmart()
 CAmount CWalletTx::GetCachableAmount(AmountType type, const isminefilter& filter, bool recalculate) const
 {
     auto& amount = m_amounts[type];
-    if (recalculate || !amount.m_cached[filter]) {
-        amount.Set(filter, type == DEBIT ? pwallet->GetDebit(tx, filter) : pwallet->GetCredit(*this, filter));
+    CAmount value;
+    if (recalculate || !amount.Get(filter, value)) {
+        value = type == DEBIT ? pwallet->GetDebit(tx, filter) : pwallet->GetCredit(*this, filter);
+        amount.Set(filter, value);
     }
-    return amount.m_value[filter];
+    return value;
 }
 
 bool CWalletTx::IsAmountCached(AmountType type, const isminefilter& filter) const
 {
-    return m_amounts[type].m_cached[filter];
+    return m_amounts[type].IsCached(filter);
 }
 
 //! filter decides which addresses will count towards the debit
@@ -1640,11 +1825,11 @@ CAmount CWalletTx::GetAvailableCredit(bool fUseCache, const isminefilter& filter
     if (GetBlocksToMaturity() > 0)
         return 0;
 
-    if (fUseCache && allow_cache && m_amounts[AVAILABLE_CREDIT].m_cached[filter]) {
-        return m_amounts[AVAILABLE_CREDIT].m_value[filter];
+    CAmount nCredit = 0;
+    if (fUseCache && allow_cache && m_amounts[AVAILABLE_CREDIT].Get(filter, nCredit)) {
+        return nCredit;
     }
 
-    CAmount nCredit = 0;
     // If the filter is only for shielded amounts, do not calculate the regular outputs
     if (filter != ISMINE_SPENDABLE_SHIELDED && filter != ISMINE_WATCH_ONLY_SHIELDED) {
 
@@ -1676,11 +1861,15 @@ CAmount CWalletTx::GetAvailableCredit(bool fUseCache, const isminefilter& filter
 
 CAmount CWalletTx::GetColdStakingCredit(bool fUseCache) const
 {
+    // only P2CS outputs can be ISMINE_COLD
+    if (!tx->HasP2CSOutputs()) return 0;
     return GetAvailableCredit(fUseCache, ISMINE_COLD);
 }
 
 CAmount CWalletTx::GetStakeDelegationCredit(bool fUseCache) const
 {
+    // only P2CS outputs can be ISMINE_SPENDABLE_DELEGATED
+    if (!tx->HasP2CSOutputs()) return 0;
     return GetAvailableCredit(fUseCache, ISMINE_SPENDABLE_DELEGATED);
 }
 
@@ -1769,7 +1958,7 @@ void CWalletTx::GetAmounts(std::list<COutputEntry>& listReceived,
     bool hasZerocoinSpends = tx->HasZerocoinSpendInputs();
     for (unsigned int i = 0; i < tx->vout.size(); ++i) {
         const CTxOut& txout = tx->vout[i];
-        isminetype fIsMine = pwallet->IsMine(txout);
+        isminetype fIsMine = pwallet->IsMine(*tx, i);
         // Only need to handle txouts if AT LEAST one of these is true:
         //   1) they debit from us (sent)
         //   2) the output is to us (received)
@@ -1785,7 +1974,7 @@ void CWalletTx::GetAmounts(std::list<COutputEntry>& listReceived,
         CTxDestination address;
         if (txout.IsZerocoinMint()) {
             address = CNoDestination();
-        } else if (!ExtractDestination(txout.scriptPubKey, address, fColdStake)) {
+        } else if (!ExtractDestination(GetOutputSolutions(*tx)[i], address, fColdStake)) {
             if (!IsCoinStake() && !IsCoinBase()) {
                 LogPrintf("CWalletTx::GetAmounts: Unknown transaction type found, txid %s\n", this->GetHash().ToString());
             }
@@ -1876,9 +2065,16 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
  * the main chain after to the addition of any new keys you want to detect
  * transactions for.
  */
+// Blocks read ahead of the one being scanned, by the rescan readers
+static const unsigned int RESCAN_PREFETCH_BLOCKS = 64;
+static const int MAX_RESCAN_READERS = 8;
+
 CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlockIndex* pindexStop, const WalletRescanReserver& reserver, bool fUpdate, bool fromStartup)
 {
     int64_t nNow = GetTime();
+    m_scanning_start = GetTimeMillis();
+    m_scanning_progress = 0;
+    m_scanning_blocks = 0;
 
     assert(reserver.isReserved());
     if (pindexStop) {
@@ -1899,11 +2095,36 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
             dProgressTip = Checkpoints::GuessVerificationProgress(tip, false);
         }
 
+        // The blocks are read from disk, and deserialized and hashed, by the readers up to RESCAN_PREFETCH_BLOCKS
+        // ahead, while they are scanned in order. The scan itself stays sequential: the keys used by a block
+        // top up the keypool, and its notes add viewing keys, that the following blocks are checked against.
+        ctpl::thread_pool readerPool(std::max(1, std::min(GetNumCores(), MAX_RESCAN_READERS)));
+        RenameThreadPool(readerPool, "pivx-rescan");
+        std::deque<std::pair<CBlockIndex*, std::future<std::shared_ptr<const CBlock>>>> vPrefetched;
+        CBlockIndex* pindexNextRead = pindex;
+        auto prefetchBlocks = [&]() {
+            while (pindexNextRead && vPrefetched.size() < RESCAN_PREFETCH_BLOCKS) {
+                CBlockIndex* pindexRead = pindexNextRead;
+                vPrefetched.emplace_back(pindexRead, readerPool.push([pindexRead](int threadId) -> std::shared_ptr<const CBlock> {
+                    auto pblock = std::make_shared<CBlock>();
+                    if (!ReadBlockFromDisk(*pblock, pindexRead)) return nullptr;
+                    return pblock;
+                }));
+                pindexNextRead = (pindexRead == pindexStop) ? nullptr : WITH_LOCK(cs_main, return chainActive.Next(pindexRead));
+            }
+        };
+
         std::vector<uint256> myTxHashes;
-        while (pindex && !fAbortRescan) {
+        prefetchBlocks();
+        while (!vPrefetched.empty() && !fAbortRescan) {
+            pindex = vPrefetched.front().first;
+            std::shared_ptr<const CBlock> pblock = vPrefetched.front().second.get();
+            vPrefetched.pop_front();
+
             double gvp = 0;
             if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0) {
                 gvp = WITH_LOCK(cs_main, return Checkpoints::GuessVerificationProgress(pindex, false); );
+                m_scanning_progress = std::max(0.0, std::min(1.0, (gvp - dProgressStart) / (dProgressTip - dProgressStart)));
                 ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((gvp - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
             }
             if (GetTime() >= nNow + 60) {
@@ -1914,8 +2135,8 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                 break;
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex)) {
+            if (pblock) {
+                const CBlock& block = *pblock;
                 LOCK2(cs_main, cs_wallet);
                 if (pindex && !chainActive.Contains(pindex)) {
                      // Abort scan if current block is no longer active, to prevent
@@ -1938,28 +2159,38 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, CBlock
                     if (Params().GetConsensus().NetworkUpgradeActive(pindex->pprev->nHeight, Consensus::UPGRADE_V5_0)) {
                         SaplingMerkleTree saplingTree;
                         assert(pcoinsTip->GetSaplingAnchorAt(pindex->pprev->hashFinalSaplingRoot, saplingTree));
-                        // Increment note witness caches
-                        ChainTipAdded(pindex, &block, saplingTree);
+                        // Increment note witness caches. Blocks too deep to be part of the
+                        // cache are appended to the witnesses in ranges.
+                        if (tip && tip->nHeight - pindex->nHeight >= (int) WITNESS_CACHE_SIZE) {
+                            m_sspk_man->IncrementNoteWitnessesRange(pindex, &block, saplingTree);
+                            m_sspk_man->UpdateSaplingNullifierNoteMapForBlock(&block);
+                        } else {
+                            ChainTipAdded(pindex, &block, saplingTree);
+                        }
                     }
                 }
             } else {
                 ret = pindex;
             }
+            m_scanning_blocks++;
             if (pindex == pindexStop) {
                 break;
             }
             {
                 LOCK(cs_main);
-                pindex = chainActive.Next(pindex);
                 if (tip != chainActive.Tip()) {
                     tip = chainActive.Tip();
                     // in case the tip has changed, update progress max
                     dProgressTip = Checkpoints::GuessVerificationProgress(tip, false);
                 }
             }
+            prefetchBlocks();
         }
 
         // Sapling
+        // Bring the witnesses up to the last scanned block
+        m_sspk_man->FlushNoteWitnessesRange();
+
         // After rescanning, persist Sapling note data that might have changed, e.g. nullifiers.
         // Do not flush the wallet here for performance reasons.
         WalletBatch batch(*database, "r+", false);
@@ -2096,12 +2327,43 @@ void CWallet::ResendWalletTransactions(CConnman* connman)
  * @{
  */
 
+void CWallet::SyncBalanceCache() const
+{
+    AssertLockHeld(cs_wallet);
+    const uint64_t nEpoch = m_balance_epoch;
+    if (m_balance_cache_epoch != nEpoch) {
+        m_balance_cache.clear();
+        m_balance_struct_cache.clear();
+        m_balance_cache_epoch = nEpoch;
+    }
+}
+
+CAmount CWallet::GetCachedBalance(const BalanceCacheKey& key, const std::function<CAmount()>& compute) const
+{
+    AssertLockHeld(cs_wallet);
+    if (std::get<0>(key) == BALANCE_UNCACHED) {
+        return compute();
+    }
+    SyncBalanceCache();
+    auto it = m_balance_cache.find(key);
+    if (it != m_balance_cache.end()) {
+        return it->second;
+    }
+    const CAmount nTotal = compute();
+    m_balance_cache.emplace(key, nTotal);
+    return nTotal;
+}
+
 CWallet::Balance CWallet::GetBalance(const int min_depth) const
 {
     Balance ret;
     {
         LOCK(cs_wallet);
-        std::set<uint256> trusted_parents;
+        SyncBalanceCache();
+        auto it = m_balance_struct_cache.find(min_depth);
+        if (it != m_balance_struct_cache.end()) {
+            return it->second;
+        }
         for (const auto& entry : mapWallet) {
             const CWalletTx& wtx = entry.second;
             const bool is_trusted{wtx.IsTrusted()};
@@ -2121,20 +2383,37 @@ CWallet::Balance CWallet::GetBalance(const int min_depth) const
             }
             ret.m_mine_immature += wtx.GetImmatureCredit();
         }
+        m_balance_struct_cache.emplace(min_depth, ret);
     }
     return ret;
 }
 
-CAmount CWallet::loopTxsBalance(const std::function<void(const uint256&, const CWalletTx&, CAmount&)>& method) const
+CAmount CWallet::loopTxsBalance(const BalanceCacheKey& key, const std::function<void(const uint256&, const CWalletTx&, CAmount&)>& method) const
 {
-    CAmount nTotal = 0;
-    {
-        LOCK(cs_wallet);
+    LOCK(cs_wallet);
+    return GetCachedBalance(key, [&]() {
+        CAmount nTotal = 0;
         for (const auto& it : mapWallet) {
             method(it.first, it.second, nTotal);
         }
-    }
-    return nTotal;
+        return nTotal;
+    });
+}
+
+CAmount CWallet::loopP2CSTxsBalance(const BalanceCacheKey& key, const std::function<void(const uint256&, const CWalletTx&, CAmount&)>& method) const
+{
+    LOCK(cs_wallet);
+    return GetCachedBalance(key, [&]() {
+        CAmount nTotal = 0;
+        std::set<uint256> setTxs;
+        for (const auto& it : mapP2CSByStaker) {
+            for (const COutPoint& outpoint : it.second) setTxs.emplace(outpoint.hash);
+        }
+        for (const uint256& txid : setTxs) {
+            method(txid, mapWallet.at(txid), nTotal);
+        }
+        return nTotal;
+    });
 }
 
 CAmount CWallet::GetAvailableBalance(bool fIncludeDelegated, bool fIncludeShielded) const
@@ -2154,7 +2433,8 @@ CAmount CWallet::GetAvailableBalance(bool fIncludeDelegated, bool fIncludeShield
 
 CAmount CWallet::GetAvailableBalance(isminefilter& filter, bool useCache, int minDepth) const
 {
-    return loopTxsBalance([filter, useCache, minDepth](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal){
+    const BalanceCacheKey key{useCache ? BALANCE_AVAILABLE : BALANCE_UNCACHED, filter, minDepth};
+    return loopTxsBalance(key, [filter, useCache, minDepth](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal){
         bool fConflicted;
         int depth;
         if (pcoin.IsTrusted(depth, fConflicted) && depth >= minDepth) {
@@ -2165,15 +2445,15 @@ CAmount CWallet::GetAvailableBalance(isminefilter& filter, bool useCache, int mi
 
 CAmount CWallet::GetColdStakingBalance() const
 {
-    return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
-        if (pcoin.tx->HasP2CSOutputs() && pcoin.IsTrusted())
+    return loopP2CSTxsBalance({BALANCE_COLD_STAKING, ISMINE_NO, 0}, [](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
+        if (pcoin.IsTrusted())
             nTotal += pcoin.GetColdStakingCredit();
     });
 }
 
 CAmount CWallet::GetStakingBalance(const bool fIncludeColdStaking) const
 {
-    return std::max(CAmount(0), loopTxsBalance(
+    return std::max(CAmount(0), loopTxsBalance({BALANCE_STAKING, ISMINE_NO, fIncludeColdStaking},
             [fIncludeColdStaking](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
         if (pcoin.IsTrusted() && pcoin.GetDepthInMainChain() >= Params().GetConsensus().nStakeMinDepth) {
             nTotal += pcoin.GetAvailableCredit();       // available coins
@@ -2187,8 +2467,8 @@ CAmount CWallet::GetStakingBalance(const bool fIncludeColdStaking) const
 
 CAmount CWallet::GetDelegatedBalance() const
 {
-    return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
-            if (pcoin.tx->HasP2CSOutputs() && pcoin.IsTrusted())
+    return loopP2CSTxsBalance({BALANCE_DELEGATED, ISMINE_NO, 0}, [](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
+            if (pcoin.IsTrusted())
                 nTotal += pcoin.GetStakeDelegationCredit();
     });
 }
@@ -2235,7 +2515,7 @@ CAmount CWallet::GetLockedShieldCoins() const
 
 CAmount CWallet::GetUnconfirmedBalance(isminetype filter) const
 {
-    return loopTxsBalance([filter](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
+    return loopTxsBalance({BALANCE_UNCONFIRMED, filter, 0}, [filter](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             if (!pcoin.IsTrusted() && pcoin.GetDepthInMainChain() == 0 && pcoin.InMempool())
                 nTotal += pcoin.GetCredit(filter);
     });
@@ -2243,28 +2523,28 @@ CAmount CWallet::GetUnconfirmedBalance(isminetype filter) const
 
 CAmount CWallet::GetImmatureBalance() const
 {
-    return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
+    return loopTxsBalance({BALANCE_IMMATURE, ISMINE_NO, 0}, [](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             nTotal += pcoin.GetImmatureCredit(false);
     });
 }
 
 CAmount CWallet::GetImmatureColdStakingBalance() const
 {
-    return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
+    return loopP2CSTxsBalance({BALANCE_IMMATURE_COLD_STAKING, ISMINE_NO, 0}, [](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             nTotal += pcoin.GetImmatureCredit(false, ISMINE_COLD);
     });
 }
 
 CAmount CWallet::GetImmatureDelegatedBalance() const
 {
-    return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
+    return loopP2CSTxsBalance({BALANCE_IMMATURE_DELEGATED, ISMINE_NO, 0}, [](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             nTotal += pcoin.GetImmatureCredit(false, ISMINE_SPENDABLE_DELEGATED);
     });
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
 {
-    return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
+    return loopTxsBalance({BALANCE_WATCH_ONLY, ISMINE_NO, 0}, [](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             if (pcoin.IsTrusted())
                 nTotal += pcoin.GetAvailableWatchOnlyCredit();
     });
@@ -2272,7 +2552,7 @@ CAmount CWallet::GetWatchOnlyBalance() const
 
 CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 {
-    return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
+    return loopTxsBalance({BALANCE_UNCONFIRMED_WATCH_ONLY, ISMINE_NO, 0}, [](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             if (!pcoin.IsTrusted() && pcoin.GetDepthInMainChain() == 0 && pcoin.InMempool())
                 nTotal += pcoin.GetAvailableWatchOnlyCredit();
     });
@@ -2280,7 +2560,7 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
 
 CAmount CWallet::GetImmatureWatchOnlyBalance() const
 {
-    return loopTxsBalance([](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
+    return loopTxsBalance({BALANCE_IMMATURE_WATCH_ONLY, ISMINE_NO, 0}, [](const uint256& id, const CWalletTx& pcoin, CAmount& nTotal) {
             nTotal += pcoin.GetImmatureWatchOnlyCredit();
     });
 }
@@ -2308,10 +2588,11 @@ CAmount CWallet::GetLegacyBalance(const isminefilter& filter, int minDepth) cons
         // treat change outputs specially, as part of the amount debited.
         CAmount debit = wtx.GetDebit(filter);
         const bool outgoing = debit > 0;
-        for (const CTxOut& out : wtx.tx->vout) {
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+            const CTxOut& out = wtx.tx->vout[i];
             if (outgoing && IsChange(out)) {
                 debit -= out.nValue;
-            } else if (IsMine(out) & filter && depth >= minDepth) {
+            } else if (IsMine(*wtx.tx, i) & filter && depth >= minDepth) {
                 balance += out.nValue;
             }
         }
@@ -2341,34 +2622,27 @@ void CWallet::GetAvailableP2CSCoins(std::vector<COutput>& vCoins) const {
     vCoins.clear();
     {
         LOCK(cs_wallet);
-        for (const auto& it : mapWallet) {
-            const uint256& wtxid = it.first;
-            const CWalletTx* pcoin = &it.second;
-
-            bool fConflicted;
-            int nDepth = pcoin->GetDepthAndMempool(fConflicted);
-
-            if (fConflicted || nDepth < 0)
+        // Outpoints are sorted by tx: the tx checks are done once per tx
+        const CWalletTx* pcoin = nullptr;
+        bool fSkipTx = false;
+        bool fSafe = false;
+        for (const COutPoint& outpoint : GetP2CSOutpoints()) {
+            if (!pcoin || pcoin->GetHash() != outpoint.hash) {
+                pcoin = GetWalletTx(outpoint.hash);
+                assert(pcoin);
+                bool fConflicted;
+                int nDepth = pcoin->GetDepthAndMempool(fConflicted);
+                fSkipTx = fConflicted || nDepth < 0;
+                fSafe = !fSkipTx && pcoin->IsTrusted();
+            }
+            if (fSkipTx || IsSpent(outpoint))
                 continue;
 
-            bool fSafe = pcoin->IsTrusted();
-
-            if (pcoin->tx->HasP2CSOutputs()) {
-                for (int i = 0; i < (int) pcoin->tx->vout.size(); i++) {
-                    const auto &utxo = pcoin->tx->vout[i];
-
-                    if (IsSpent(wtxid, i))
-                        continue;
-
-                    if (utxo.scriptPubKey.IsPayToColdStaking()) {
-                        isminetype mine = IsMine(utxo);
-                        bool isMineSpendable = mine & ISMINE_SPENDABLE_DELEGATED;
-                        if (mine & ISMINE_COLD || isMineSpendable)
-                            // Depth and solvability members are not used, no need waste resources and set them for now.
-                            vCoins.emplace_back(pcoin, i, 0, isMineSpendable, true, fSafe);
-                    }
-                }
-            }
+            isminetype mine = IsMine(*pcoin->tx, outpoint.n);
+            bool isMineSpendable = mine & ISMINE_SPENDABLE_DELEGATED;
+            if (mine & ISMINE_COLD || isMineSpendable)
+                // Depth and solvability members are not used, no need waste resources and set them for now.
+                vCoins.emplace_back(pcoin, (int) outpoint.n, 0, isMineSpendable, true, fSafe);
         }
     }
 
@@ -2487,7 +2761,7 @@ bool CWallet::GetMasternodeVinAndKeys(CPubKey& pubKeyRet,
 }
 
 CWallet::OutputAvailabilityResult CWallet::CheckOutputAvailability(
-        const CTxOut& output,
+        const CTransaction& tx,
         const unsigned int outIndex,
         const uint256& wtxid,
         const CCoinControl* coinControl,
@@ -2501,7 +2775,8 @@ CWallet::OutputAvailabilityResult CWallet::CheckOutputAvailability(
     // Check if the utxo was spent.
     if (IsSpent(wtxid, outIndex)) return res;
 
-    isminetype mine = IsMine(output);
+    const CTxOut& output = tx.vout[outIndex];
+    isminetype mine = IsMine(tx, outIndex);
 
     // Check If not mine
     if (mine == ISMINE_NO) return res;
@@ -2543,18 +2818,16 @@ bool CWallet::AvailableCoins(std::vector<COutput>* pCoins,      // --> populates
     {
         LOCK(cs_wallet);
         CAmount nTotal = 0;
-        for (const auto& entry : mapWallet) {
-            const uint256& wtxid = entry.first;
-            const CWalletTx* pcoin = &entry.second;
-
+        bool fFound = false;
+        ForEachCoinCandidate([&](const uint256& wtxid, const CWalletTx* pcoin) {
             // Check if the tx is selectable
             int nDepth = 0;
             bool safeTx = false;
             if (!CheckTXAvailability(pcoin, coinsFilter.fOnlySafe, nDepth, safeTx, m_last_block_processed_height))
-                continue;
+                return true;
 
             // Check min depth filtering requirements
-            if (nDepth < coinsFilter.minDepth) continue;
+            if (nDepth < coinsFilter.minDepth) return true;
 
             for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
                 const auto& output = pcoin->tx->vout[i];
@@ -2570,14 +2843,14 @@ bool CWallet::AvailableCoins(std::vector<COutput>* pCoins,      // --> populates
                 // Filter by specific destinations if needed
                 if (coinsFilter.onlyFilteredDest && !coinsFilter.onlyFilteredDest->empty()) {
                     CTxDestination address;
-                    if (!ExtractDestination(output.scriptPubKey, address) || !coinsFilter.onlyFilteredDest->count(address)) {
+                    if (!ExtractDestination(GetOutputSolutions(*pcoin->tx)[i], address) || !coinsFilter.onlyFilteredDest->count(address)) {
                         continue;
                     }
                 }
 
                 // Now check for chain availability
                 auto res = CheckOutputAvailability(
-                        output,
+                        *pcoin->tx,
                         i,
                         wtxid,
                         coinControl,
@@ -2590,7 +2863,8 @@ bool CWallet::AvailableCoins(std::vector<COutput>* pCoins,      // --> populates
                 if (coinsFilter.fOnlySpendable && !res.spendable) continue;
 
                 // found valid coin
-                if (!pCoins) return true;
+                fFound = true;
+                if (!pCoins) return false;
                 pCoins->emplace_back(pcoin, (int) i, nDepth, res.spendable, res.solvable, safeTx);
 
                 // Checks the sum amount of all UTXO's.
@@ -2598,17 +2872,18 @@ bool CWallet::AvailableCoins(std::vector<COutput>* pCoins,      // --> populates
                     nTotal += output.nValue;
 
                     if (nTotal >= coinsFilter.nMinimumSumAmount) {
-                        return true;
+                        return false;
                     }
                 }
 
                 // Checks the maximum number of UTXO's.
                 if (coinsFilter.nMaximumCount > 0 && pCoins->size() >= coinsFilter.nMaximumCount) {
-                    return true;
+                    return false;
                 }
             }
-        }
-        return (pCoins && !pCoins->empty());
+            return true;
+        });
+        return pCoins ? !pCoins->empty() : fFound;
     }
 }
 
@@ -2626,7 +2901,8 @@ std::map<CTxDestination , std::vector<COutput> > CWallet::AvailableCoinsByAddres
     for (const COutput& out : vCoins) {
         CTxDestination address;
         bool fColdStakeAddr = false;
-        if (!ExtractDestination(out.tx->tx->vout[out.i].scriptPubKey, address, fColdStakeAddr)) {
+        const CScriptSolution& solution = GetOutputSolutions(*out.tx->tx)[out.i];
+        if (!ExtractDestination(solution, address, fColdStakeAddr)) {
             bool isP2CS = out.tx->tx->vout[out.i].scriptPubKey.IsPayToColdStaking();
             if (isP2CS && !fIncludeColdStaking) {
                 // It must never happen as the coin filtering process shouldn't had added the P2CS in the first place
@@ -2634,7 +2910,7 @@ std::map<CTxDestination , std::vector<COutput> > CWallet::AvailableCoinsByAddres
             }
             // if this is a P2CS we don't have the owner key - check if we have the staking key
             fColdStakeAddr = true;
-            if (!isP2CS || !ExtractDestination(out.tx->tx->vout[out.i].scriptPubKey, address, fColdStakeAddr) )
+            if (!isP2CS || !ExtractDestination(solution, address, fColdStakeAddr) )
                 continue;
         }
 
@@ -2692,24 +2968,22 @@ bool CWallet::StakeableCoins(std::vector<CStakeableOutput>* pCoins)
     if (pCoins) pCoins->clear();
 
     LOCK2(cs_main, cs_wallet);
-    for (const auto& it : mapWallet) {
-        const uint256& wtxid = it.first;
-        const CWalletTx* pcoin = &(it).second;
-
+    bool fFound = false;
+    ForEachCoinCandidate([&](const uint256& wtxid, const CWalletTx* pcoin) {
         // Check if the tx is selectable
         int nDepth = 0;
         bool safeTx = false;
         if (!CheckTXAvailability(pcoin, true, nDepth, safeTx))
-            continue;
+            return true;
 
         // Check min depth requirement for stake inputs
-        if (nDepth < Params().GetConsensus().nStakeMinDepth) continue;
+        if (nDepth < Params().GetConsensus().nStakeMinDepth) return true;
 
         const CBlockIndex* pindex = nullptr;
         for (unsigned int index = 0; index < pcoin->tx->vout.size(); index++) {
 
             auto res = CheckOutputAvailability(
-                    pcoin->tx->vout[index],
+                    *pcoin->tx,
                     index,
                     wtxid,
                     nullptr, // coin control
@@ -2721,15 +2995,17 @@ bool CWallet::StakeableCoins(std::vector<CStakeableOutput>* pCoins)
             if (!res.available || !res.spendable) continue;
 
             // found valid coin
-            if (!pCoins) return true;
+            fFound = true;
+            if (!pCoins) return false;
             if (!pindex) pindex = mapBlockIndex.at(pcoin->m_confirm.hashBlock);
             pCoins->emplace_back(pcoin, (int) index, nDepth, pindex);
         }
-    }
-    return (pCoins && !pCoins->empty());
+        return true;
+    });
+    return pCoins ? !pCoins->empty() : fFound;
 }
 
-bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const
+bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, const std::vector<COutput>& vCoins, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const
 {
     setCoinsRet.clear();
     nValueRet = 0;
@@ -2741,9 +3017,16 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
     std::vector<std::pair<CAmount, std::pair<const CWalletTx*, unsigned int> > > vValue;
     CAmount nTotalLower = 0;
 
-    Shuffle(vCoins.begin(), vCoins.end(), FastRandomContext());
-
+    // Shuffle the pointers to the coins, not the coins
+    std::vector<const COutput*> vpCoins;
+    vpCoins.reserve(vCoins.size());
     for (const COutput& output : vCoins) {
+        vpCoins.emplace_back(&output);
+    }
+    Shuffle(vpCoins.begin(), vpCoins.end(), FastRandomContext());
+
+    for (const COutput* pOutput : vpCoins) {
+        const COutput& output = *pOutput;
         if (!output.fSpendable)
             continue;
 
@@ -2823,11 +3106,10 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
 bool CWallet::SelectCoinsToSpend(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl) const
 {
     // Note: this function should never be used for "always free" tx types like dstx
-    std::vector<COutput> vCoins(vAvailableCoins);
 
     // coin control -> return all selected outputs (we want all selected to go into the transaction for sure)
     if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs) {
-        for (const COutput& out : vCoins) {
+        for (const COutput& out : vAvailableCoins) {
             if (!out.fSpendable)
                 continue;
 
@@ -2857,13 +3139,15 @@ bool CWallet::SelectCoinsToSpend(const std::vector<COutput>& vAvailableCoins, co
             return false; // TODO: Allow non-wallet inputs
     }
 
-    // remove preset inputs from vCoins
-    for (std::vector<COutput>::iterator it = vCoins.begin(); it != vCoins.end() && coinControl && coinControl->HasSelected();) {
-        if (setPresetCoins.count(std::make_pair(it->tx, it->i)))
-            it = vCoins.erase(it);
-        else
-            ++it;
+    // remove preset inputs from the coins, copying them only when there are preset inputs
+    std::vector<COutput> vCoinsNoPreset;
+    if (!setPresetCoins.empty()) {
+        vCoinsNoPreset.reserve(vAvailableCoins.size());
+        for (const COutput& out : vAvailableCoins) {
+            if (!setPresetCoins.count(std::make_pair(out.tx, out.i))) vCoinsNoPreset.emplace_back(out);
+        }
     }
+    const std::vector<COutput>& vCoins = setPresetCoins.empty() ? vAvailableCoins : vCoinsNoPreset;
 
     size_t nMaxChainLength = std::min(gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT), gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT));
 
@@ -3015,20 +3299,40 @@ std::vector<COutput> CWallet::GetOutputsFromCoinControl(const CCoinControl* coin
     return vCoinsRet;
 }
 
-bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend,
-    CTransactionRef& txRet,
+// Ensures that tx will pass the mempool's chain limits
+static bool CheckMempoolChainLimits(const CTransactionRef& tx, std::string& strFailReason)
+{
+    CTxMemPoolEntry entry(tx, 0, 0, 0, false, 0);
+    CTxMemPool::setEntries setAncestors;
+    size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
+    size_t nLimitAncestorSize = gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
+    size_t nLimitDescendants = gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
+    size_t nLimitDescendantSize = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
+    std::string errString;
+    if (!mempool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
+        strFailReason = _("Transaction has too long of a mempool chain");
+        return false;
+    }
+
+    return true;
+}
+
+bool CWallet::FundTransactionFromCoins(const std::vector<CRecipient>& vecSend,
+    const std::vector<COutput>& vAvailableCoins,
+    CMutableTransaction& txNew,
+    std::set<std::pair<const CWalletTx*, unsigned int>>& setCoins,
     CReserveKey& reservekey,
     CAmount& nFeeRet,
     int& nChangePosInOut,
     std::string& strFailReason,
     const CCoinControl* coinControl,
-    bool sign,
     CAmount nFeePay,
-    bool fIncludeDelegated,
     bool* fStakeDelegationVoided,
-    int nExtraSize,
-    int nMinDepth)
+    int nExtraSize)
 {
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
     CAmount nValue = 0;
     int nChangePosRequest = nChangePosInOut;
     unsigned int nSubtractFeeFromAmount = 0;
@@ -3046,244 +3350,384 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend,
         return false;
     }
 
-    CMutableTransaction txNew;
     CScript scriptChange;
 
-    CWallet::AvailableCoinsFilter coinFilter;
-    coinFilter.fOnlySpendable = true;
-    coinFilter.fIncludeDelegated = fIncludeDelegated;
-    coinFilter.minDepth = nMinDepth;
-
-    {
-        std::set<std::pair<const CWalletTx*,unsigned int> > setCoins;
-        LOCK2(cs_main, cs_wallet);
-        {
-            std::vector<COutput> vAvailableCoins;
-            if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs) {
-                // Select only the outputs that the caller pre-selected.
-                vAvailableCoins = GetOutputsFromCoinControl(coinControl);
-            } else {
-                // Regular selection
-                AvailableCoins(&vAvailableCoins, coinControl, coinFilter);
-            }
-
-            nFeeRet = 0;
-            if (nFeePay > 0) nFeeRet = nFeePay;
-            while (true) {
-                nChangePosInOut = nChangePosRequest;
-                txNew.vin.clear();
-                txNew.vout.clear();
-                bool fFirst = true;
-
-                CAmount nValueToSelect = nValue;
-                if (nSubtractFeeFromAmount == 0)
-                    nValueToSelect += nFeeRet;
-
-                // Fill outputs
-                for (const CRecipient& rec : vecSend) {
-                    CTxOut txout(rec.nAmount, rec.scriptPubKey);
-                    if (rec.fSubtractFeeFromAmount) {
-                        assert(nSubtractFeeFromAmount != 0);
-                        txout.nValue -= nFeeRet / nSubtractFeeFromAmount; // Subtract fee equally from each selected recipient
-
-                        if (fFirst) {
-                            // first receiver pays the remainder not divisible by output count
-                            fFirst = false;
-                            txout.nValue -= nFeeRet % nSubtractFeeFromAmount;
-                        }
-                    }
-                    if (IsDust(txout, dustRelayFee)) {
-                        strFailReason = _("Transaction amount too small");
-                        return false;
-                    }
-                    txNew.vout.emplace_back(txout);
+    nFeeRet = 0;
+    if (nFeePay > 0) nFeeRet = nFeePay;
+    while (true) {
+        nChangePosInOut = nChangePosRequest;
+        txNew.vin.clear();
+        txNew.vout.clear();
+        bool fFirst = true;
+
+        CAmount nValueToSelect = nValue;
+        if (nSubtractFeeFromAmount == 0)
+            nValueToSelect += nFeeRet;
+
+        // Fill outputs
+        for (const CRecipient& rec : vecSend) {
+            CTxOut txout(rec.nAmount, rec.scriptPubKey);
+            if (rec.fSubtractFeeFromAmount) {
+                assert(nSubtractFeeFromAmount != 0);
+                txout.nValue -= nFeeRet / nSubtractFeeFromAmount; // Subtract fee equally from each selected recipient
+
+                if (fFirst) {
+                    // first receiver pays the remainder not divisible by output count
+                    fFirst = false;
+                    txout.nValue -= nFeeRet % nSubtractFeeFromAmount;
                 }
+            }
+            if (IsDust(txout, dustRelayFee)) {
+                strFailReason = _("Transaction amount too small");
+                return false;
+            }
+            txNew.vout.emplace_back(txout);
+        }
 
-                // Choose coins to use
-                CAmount nValueIn = 0;
-                setCoins.clear();
-
-                if (!SelectCoinsToSpend(vAvailableCoins, nValueToSelect, setCoins, nValueIn, coinControl)) {
-                    strFailReason = _("Insufficient funds.");
-                    return false;
-                }
+        // Choose coins to use
+        CAmount nValueIn = 0;
+        setCoins.clear();
 
-                // Change
-                CAmount nChange = nValueIn - nValueToSelect;
-                if (nChange > 0) {
-                    // Fill a vout to ourself
-                    // TODO: pass in scriptChange instead of reservekey so
-                    // change transaction isn't always pay-to-pivx-address
-                    bool combineChange = false;
-
-                    // coin control: send change to custom address
-                    if (coinControl && IsValidDestination(coinControl->destChange)) {
-                        scriptChange = GetScriptForDestination(coinControl->destChange);
-
-                        std::vector<CTxOut>::iterator it = txNew.vout.begin();
-                        while (it != txNew.vout.end()) {
-                            if (scriptChange == it->scriptPubKey) {
-                                it->nValue += nChange;
-                                nChange = 0;
-                                reservekey.ReturnKey();
-                                combineChange = true;
-                                break;
-                            }
-                            ++it;
-                        }
-                    }
+        if (!SelectCoinsToSpend(vAvailableCoins, nValueToSelect, setCoins, nValueIn, coinControl)) {
+            strFailReason = _("Insufficient funds.");
+            return false;
+        }
 
-                    // no coin control: send change to newly generated address
-                    else {
-                        // Note: We use a new key here to keep it from being obvious which side is the change.
-                        //  The drawback is that by not reusing a previous key, the change may be lost if a
-                        //  backup is restored, if the backup doesn't have the new private key for the change.
-                        //  If we reused the old key, it would be possible to add code to look for and
-                        //  rediscover unknown transactions that were written with keys of ours to recover
-                        //  post-backup change.
-
-                        // Reserve a new key pair from key pool. If it fails, provide a dummy
-                        CPubKey vchPubKey;
-                        if (!reservekey.GetReservedKey(vchPubKey, true)) {
-                            strFailReason = _("Can't generate a change-address key. Please call keypoolrefill first.");
-                            scriptChange = CScript();
-                        } else {
-                            scriptChange = GetScriptForDestination(vchPubKey.GetID());
-                        }
+        // Change
+        CAmount nChange = nValueIn - nValueToSelect;
+        if (nChange > 0) {
+            // Fill a vout to ourself
+            // TODO: pass in scriptChange instead of reservekey so
+            // change transaction isn't always pay-to-pivx-address
+            bool combineChange = false;
+
+            // coin control: send change to custom address
+            if (coinControl && IsValidDestination(coinControl->destChange)) {
+                scriptChange = GetScriptForDestination(coinControl->destChange);
+
+                std::vector<CTxOut>::iterator it = txNew.vout.begin();
+                while (it != txNew.vout.end()) {
+                    if (scriptChange == it->scriptPubKey) {
+                        it->nValue += nChange;
+                        nChange = 0;
+                        reservekey.ReturnKey();
+                        combineChange = true;
+                        break;
                     }
+                    ++it;
+                }
+            }
 
-                    if (!combineChange) {
-                        CTxOut newTxOut(nChange, scriptChange);
-
-                        // Never create dust outputs; if we would, just
-                        // add the dust to the fee.
-                        if (IsDust(newTxOut, dustRelayFee)) {
-                            nFeeRet += nChange;
-                            nChange = 0;
-                            reservekey.ReturnKey();
-                            nChangePosInOut = -1;
-                        } else {
-                            if (nChangePosInOut == -1) {
-                                // Insert change txn at random position:
-                                nChangePosInOut = GetRandInt(txNew.vout.size()+1);
-                            } else if (nChangePosInOut < 0 || (unsigned int) nChangePosInOut > txNew.vout.size()) {
-                                strFailReason = _("Change index out of range");
-                                return false;
-                            }
-                            std::vector<CTxOut>::iterator position = txNew.vout.begin() + nChangePosInOut;
-                            txNew.vout.insert(position, newTxOut);
-                        }
-                    }
+            // no coin control: send change to newly generated address
+            else {
+                // Note: We use a new key here to keep it from being obvious which side is the change.
+                //  The drawback is that by not reusing a previous key, the change may be lost if a
+                //  backup is restored, if the backup doesn't have the new private key for the change.
+                //  If we reused the old key, it would be possible to add code to look for and
+                //  rediscover unknown transactions that were written with keys of ours to recover
+                //  post-backup change.
+
+                // Reserve a new key pair from key pool. If it fails, provide a dummy
+                CPubKey vchPubKey;
+                if (!reservekey.GetReservedKey(vchPubKey, true)) {
+                    strFailReason = _("Can't generate a change-address key. Please call keypoolrefill first.");
+                    scriptChange = CScript();
                 } else {
-                    reservekey.ReturnKey();
-                    nChangePosInOut = -1;
+                    scriptChange = GetScriptForDestination(vchPubKey.GetID());
                 }
+            }
 
-                // Fill vin
-                for (const std::pair<const CWalletTx*, unsigned int>& coin : setCoins) {
-                    if(fStakeDelegationVoided && coin.first->tx->vout[coin.second].scriptPubKey.IsPayToColdStaking()) {
-                        *fStakeDelegationVoided = true;
-                    }
-                    txNew.vin.emplace_back(coin.first->GetHash(), coin.second);
-                }
+            if (!combineChange) {
+                CTxOut newTxOut(nChange, scriptChange);
 
-                // Fill in dummy signatures for fee calculation.
-                int nIn = 0;
-                for (const auto & coin : setCoins) {
-                    const CScript& scriptPubKey = coin.first->tx->vout[coin.second].scriptPubKey;
-                    SignatureData sigdata;
-                    if (!ProduceSignature(DummySignatureCreator(this), scriptPubKey, sigdata, txNew.GetRequiredSigVersion(), false)) {
-                        strFailReason = _("Signing transaction failed");
+                // Never create dust outputs; if we would, just
+                // add the dust to the fee.
+                if (IsDust(newTxOut, dustRelayFee)) {
+                    nFeeRet += nChange;
+                    nChange = 0;
+                    reservekey.ReturnKey();
+                    nChangePosInOut = -1;
+                } else {
+                    if (nChangePosInOut == -1) {
+                        // Insert change txn at random position:
+                        nChangePosInOut = GetRandInt(txNew.vout.size()+1);
+                    } else if (nChangePosInOut < 0 || (unsigned int) nChangePosInOut > txNew.vout.size()) {
+                        strFailReason = _("Change index out of range");
                         return false;
-                    } else {
-                        UpdateTransaction(txNew, nIn, sigdata);
                     }
-                    nIn++;
+                    std::vector<CTxOut>::iterator position = txNew.vout.begin() + nChangePosInOut;
+                    txNew.vout.insert(position, newTxOut);
                 }
+            }
+        } else {
+            reservekey.ReturnKey();
+            nChangePosInOut = -1;
+        }
 
-                // account for additional payloads in fee calculation
-                const unsigned int nBytes = ::GetSerializeSize(txNew, PROTOCOL_VERSION) + nExtraSize;
-                CAmount nFeeNeeded = std::max(nFeePay, GetMinimumFee(nBytes, nTxConfirmTarget, mempool));
+        // Fill vin
+        for (const std::pair<const CWalletTx*, unsigned int>& coin : setCoins) {
+            if(fStakeDelegationVoided && coin.first->tx->vout[coin.second].scriptPubKey.IsPayToColdStaking()) {
+                *fStakeDelegationVoided = true;
+            }
+            txNew.vin.emplace_back(coin.first->GetHash(), coin.second);
+        }
 
-                // Remove scriptSigs to eliminate the fee calculation dummy signatures
-                for (CTxIn& vin : txNew.vin) {
-                    vin.scriptSig = CScript();
-                }
+        // Fill in dummy signatures for fee calculation.
+        int nIn = 0;
+        for (const auto & coin : setCoins) {
+            const CScript& scriptPubKey = coin.first->tx->vout[coin.second].scriptPubKey;
+            SignatureData sigdata;
+            if (!ProduceSignature(DummySignatureCreator(this), scriptPubKey, sigdata, txNew.GetRequiredSigVersion(), false)) {
+                strFailReason = _("Signing transaction failed");
+                return false;
+            } else {
+                UpdateTransaction(txNew, nIn, sigdata);
+            }
+            nIn++;
+        }
 
-                if (coinControl && nFeeNeeded > 0 && coinControl->nMinimumTotalFee > nFeeNeeded) {
-                    nFeeNeeded = coinControl->nMinimumTotalFee;
-                }
-                if (coinControl && coinControl->fOverrideFeeRate)
-                    nFeeNeeded = coinControl->nFeeRate.GetFee(nBytes);
+        // account for additional payloads in fee calculation
+        const unsigned int nBytes = ::GetSerializeSize(txNew, PROTOCOL_VERSION) + nExtraSize;
+        CAmount nFeeNeeded = std::max(nFeePay, GetMinimumFee(nBytes, nTxConfirmTarget, mempool));
 
-                // If we made it here and we aren't even able to meet the relay fee on the next pass, give up
-                // because we must be at the maximum allowed fee.
-                if (nFeeNeeded < ::minRelayTxFee.GetFee(nBytes)) {
-                    strFailReason = _("Transaction too large for fee policy");
-                    return false;
-                }
+        // Remove scriptSigs to eliminate the fee calculation dummy signatures
+        for (CTxIn& vin : txNew.vin) {
+            vin.scriptSig = CScript();
+        }
 
-                if (nFeeRet >= nFeeNeeded) // Done, enough fee included
-                    break;
+        if (coinControl && nFeeNeeded > 0 && coinControl->nMinimumTotalFee > nFeeNeeded) {
+            nFeeNeeded = coinControl->nMinimumTotalFee;
+        }
+        if (coinControl && coinControl->fOverrideFeeRate)
+            nFeeNeeded = coinControl->nFeeRate.GetFee(nBytes);
 
-                // Include more fee and try again.
-                nFeeRet = nFeeNeeded;
-                continue;
-            }
+        // If we made it here and we aren't even able to meet the relay fee on the next pass, give up
+        // because we must be at the maximum allowed fee.
+        if (nFeeNeeded < ::minRelayTxFee.GetFee(nBytes)) {
+            strFailReason = _("Transaction too large for fee policy");
+            return false;
+        }
+
+        if (nFeeRet >= nFeeNeeded) // Done, enough fee included
+            break;
+
+        // Include more fee and try again.
+        nFeeRet = nFeeNeeded;
+        continue;
+    }
+
+    // Give up if change keypool ran out and we failed to find a solution without change:
+    if (scriptChange.empty() && nChangePosInOut != -1) {
+        return false;
+    }
+
+    return true;
+}
 
-            // Give up if change keypool ran out and we failed to find a solution without change:
-            if (scriptChange.empty() && nChangePosInOut != -1) {
+//! Upper limit of the threads signing the transaction inputs
+static const int MAX_SIGNING_THREADS = 8;
+//! Below this many inputs per thread, the signing is not split
+static const size_t MIN_SIGNING_SHARD_INPUTS = 8;
+
+static ctpl::thread_pool& GetSigningPool()
+{
+    static ctpl::thread_pool signingPool;
+    static std::once_flag startFlag;
+    std::call_once(startFlag, [] {
+        signingPool.resize(std::max(1, std::min(GetNumCores(), MAX_SIGNING_THREADS)));
+        RenameThreadPool(signingPool, "pivx-wallet-sign");
+    });
+    return signingPool;
+}
+
+bool CWallet::SignTransactions(std::vector<CMutableTransaction>& vTx,
+                               const std::vector<std::set<std::pair<const CWalletTx*, unsigned int>>>& vSetCoins) const
+{
+    assert(vTx.size() == vSetCoins.size());
+    struct SigningInput {
+        size_t nTx;
+        unsigned int nIn;
+        const CTxOut* prevout;
+        bool fColdStake;
+        SignatureData sigdata;
+    };
+
+    // The inputs are listed, and the cached amounts of the coins read, on this thread:
+    // the signing jobs only read the unsigned txs, their precomputed hashes and the keystore.
+    std::vector<CTransactionRef> vTxConst;
+    std::vector<PrecomputedTransactionData> vTxData;
+    std::vector<SigningInput> vInputs;
+    vTxConst.reserve(vTx.size());
+    vTxData.reserve(vTx.size());
+    for (size_t i = 0; i < vTx.size(); i++) {
+        vTxConst.emplace_back(MakeTransactionRef(vTx[i]));
+        vTxData.emplace_back(*vTxConst.back());
+        unsigned int nIn = 0;
+        for (const auto& coin : vSetCoins[i]) {
+            const bool haveKey = coin.first->GetStakeDelegationCredit() > 0;
+            vInputs.push_back({i, nIn++, &coin.first->tx->vout[coin.second], !haveKey, SignatureData()});
+        }
+    }
+
+    auto signInputs = [this, &vInputs, &vTxConst, &vTxData](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; j++) {
+            SigningInput& input = vInputs[j];
+            const CTransaction& txConst = *vTxConst[input.nTx];
+            if (!ProduceSignature(
+                    TransactionSignatureCreator(this, &txConst, input.nIn, input.prevout->nValue, SIGHASH_ALL, &vTxData[input.nTx]),
+                    input.prevout->scriptPubKey,
+                    input.sigdata,
+                    txConst.GetRequiredSigVersion(),
+                    input.fColdStake)) {
                 return false;
             }
         }
+        return true;
+    };
+
+    bool fSigned = true;
+    const size_t nShards = vInputs.size() < 2 * MIN_SIGNING_SHARD_INPUTS ? 1 :
+            std::min((size_t)GetSigningPool().size(), vInputs.size() / MIN_SIGNING_SHARD_INPUTS);
+    if (nShards > 1) {
+        const size_t shardSize = (vInputs.size() + nShards - 1) / nShards;
+        std::vector<std::future<bool>> vResults;
+        for (size_t begin = 0; begin < vInputs.size(); begin += shardSize) {
+            const size_t end = std::min(begin + shardSize, vInputs.size());
+            vResults.emplace_back(GetSigningPool().push([&signInputs, begin, end](int) { return signInputs(begin, end); }));
+        }
+        for (auto& result : vResults) {
+            if (!result.get()) fSigned = false;
+        }
+    } else {
+        fSigned = signInputs(0, vInputs.size());
+    }
+    if (!fSigned) {
+        return false;
+    }
 
-        if (sign) {
-            CTransaction txNewConst(txNew);
-            int nIn = 0;
-            for (const auto& coin : setCoins) {
-                const CScript& scriptPubKey = coin.first->tx->vout[coin.second].scriptPubKey;
-                SignatureData sigdata;
-                bool haveKey = coin.first->GetStakeDelegationCredit() > 0;
-
-                if (!ProduceSignature(
-                        TransactionSignatureCreator(this, &txNewConst, nIn, coin.first->tx->vout[coin.second].nValue, SIGHASH_ALL),
-                        scriptPubKey,
-                        sigdata,
-                        txNewConst.GetRequiredSigVersion(),
-                        !haveKey    // fColdStake
-                        )) {
-                    strFailReason = _("Signing transaction failed");
-                    return false;
-                } else {
-                    UpdateTransaction(txNew, nIn, sigdata);
-                }
-                nIn++;
-            }
+    for (SigningInput& input : vInputs) {
+        UpdateTransaction(vTx[input.nTx], input.nIn, input.sigdata);
+    }
+    return true;
+}
+
+bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend,
+    CTransactionRef& txRet,
+    CReserveKey& reservekey,
+    CAmount& nFeeRet,
+    int& nChangePosInOut,
+    std::string& strFailReason,
+    const CCoinControl* coinControl,
+    bool sign,
+    CAmount nFeePay,
+    bool fIncludeDelegated,
+    bool* fStakeDelegationVoided,
+    int nExtraSize,
+    int nMinDepth)
+{
+    CWallet::AvailableCoinsFilter coinFilter;
+    coinFilter.fOnlySpendable = true;
+    coinFilter.fIncludeDelegated = fIncludeDelegated;
+    coinFilter.minDepth = nMinDepth;
+
+    {
+        LOCK2(cs_main, cs_wallet);
+        std::vector<COutput> vAvailableCoins;
+        if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs) {
+            // Select only the outputs that the caller pre-selected.
+            vAvailableCoins = GetOutputsFromCoinControl(coinControl);
+        } else {
+            // Regular selection
+            AvailableCoins(&vAvailableCoins, coinControl, coinFilter);
+        }
+
+        std::vector<CMutableTransaction> vTxNew(1);
+        std::vector<std::set<std::pair<const CWalletTx*, unsigned int>>> vSetCoins(1);
+        if (!FundTransactionFromCoins(vecSend, vAvailableCoins, vTxNew[0], vSetCoins[0], reservekey, nFeeRet,
+                                      nChangePosInOut, strFailReason, coinControl, nFeePay, fStakeDelegationVoided, nExtraSize)) {
+            return false;
+        }
+
+        if (sign && !SignTransactions(vTxNew, vSetCoins)) {
+            strFailReason = _("Signing transaction failed");
+            return false;
         }
 
         // Limit size
-        if (::GetSerializeSize(txNew, PROTOCOL_VERSION) >= MAX_STANDARD_TX_SIZE) {
+        if (::GetSerializeSize(vTxNew[0], PROTOCOL_VERSION) >= MAX_STANDARD_TX_SIZE) {
             strFailReason = _("Transaction too large");
             return false;
         }
 
         // Embed the constructed transaction data in wtxNew.
-        txRet = MakeTransactionRef(std::move(txNew));
+        txRet = MakeTransactionRef(std::move(vTxNew[0]));
     }
 
-    // Lastly, ensure this tx will pass the mempool's chain limits
-    CTxMemPoolEntry entry(txRet, 0, 0, 0, false, 0);
-    CTxMemPool::setEntries setAncestors;
-    size_t nLimitAncestors = gArgs.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
-    size_t nLimitAncestorSize = gArgs.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
-    size_t nLimitDescendants = gArgs.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
-    size_t nLimitDescendantSize = gArgs.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
-    std::string errString;
-    if (!mempool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
-        strFailReason = _("Transaction has too long of a mempool chain");
+    return CheckMempoolChainLimits(txRet, strFailReason);
+}
+
+bool CWallet::CreateTransactions(const std::vector<std::vector<CRecipient>>& vecSends,
+    std::vector<CTransactionRef>& vTxRet,
+    std::vector<std::unique_ptr<CReserveKey>>& vReserveKeys,
+    std::string& strFailReason,
+    bool fIncludeDelegated,
+    int nMinDepth)
+{
+    vTxRet.clear();
+    vReserveKeys.clear();
+    if (vecSends.empty()) {
+        strFailReason = _("Transaction must have at least one recipient");
+        return false;
+    }
+
+    CWallet::AvailableCoinsFilter coinFilter;
+    coinFilter.fOnlySpendable = true;
+    coinFilter.fIncludeDelegated = fIncludeDelegated;
+    coinFilter.minDepth = nMinDepth;
+
+    LOCK2(cs_main, cs_wallet);
+    std::vector<COutput> vAvailableCoins;
+    AvailableCoins(&vAvailableCoins, nullptr, coinFilter);
+
+    std::vector<CMutableTransaction> vTxNew(vecSends.size());
+    std::vector<std::set<std::pair<const CWalletTx*, unsigned int>>> vSetCoins(vecSends.size());
+    for (size_t i = 0; i < vecSends.size(); i++) {
+        vReserveKeys.emplace_back(new CReserveKey(this));
+        CAmount nFeeRet = 0;
+        int nChangePosInOut = -1;
+        if (!FundTransactionFromCoins(vecSends[i], vAvailableCoins, vTxNew[i], vSetCoins[i], *vReserveKeys[i], nFeeRet,
+                                      nChangePosInOut, strFailReason, nullptr, 0, nullptr, 0)) {
+            strFailReason = strprintf(_("Transaction %d: %s"), i, strFailReason);
+            vReserveKeys.clear();
+            return false;
+        }
+        // The coins spent by this transaction are not available to the next ones of the batch
+        const auto& setCoins = vSetCoins[i];
+        vAvailableCoins.erase(std::remove_if(vAvailableCoins.begin(), vAvailableCoins.end(), [&setCoins](const COutput& out) {
+            return setCoins.count(std::make_pair(out.tx, (unsigned int)out.i)) != 0;
+        }), vAvailableCoins.end());
+    }
+
+    if (!SignTransactions(vTxNew, vSetCoins)) {
+        strFailReason = _("Signing transaction failed");
+        vReserveKeys.clear();
         return false;
     }
 
+    for (CMutableTransaction& txNew : vTxNew) {
+        if (::GetSerializeSize(txNew, PROTOCOL_VERSION) >= MAX_STANDARD_TX_SIZE) {
+            strFailReason = strprintf(_("Transaction %d: %s"), vTxRet.size(), _("Transaction too large"));
+            vTxRet.clear();
+            vReserveKeys.clear();
+            return false;
+        }
+        vTxRet.emplace_back(MakeTransactionRef(std::move(txNew)));
+        if (!CheckMempoolChainLimits(vTxRet.back(), strFailReason)) {
+            vTxRet.clear();
+            vReserveKeys.clear();
+            return false;
+        }
+    }
     return true;
 }
 
@@ -3342,6 +3786,87 @@ bool CWallet::CreateCoinstakeOuts(const CPivStake& stakeInput, std::vector<CTxOu
     return true;
 }
 
+constexpr std::array<int64_t, 5> CStakingTimerBounds::VALUES;
+
+void CStakerStatus::AddStakingTime(StakingStep step, int64_t nMicros)
+{
+    LOCK(cs_stats);
+    stats.vTimers[(size_t)step].Add(nMicros);
+}
+
+void CStakerStatus::AddStakeAttempt(int64_t nSlot, int nKernels)
+{
+    LOCK(cs_stats);
+    stats.nKernels += nKernels;
+    if (nSlot == stats.nLastSlot) {
+        // new tip within the same slot
+        stats.nLastSlotKernels += nKernels;
+        return;
+    }
+    const int nSlotLength = Params().GetConsensus().nTimeSlotLength;
+    if (stats.nLastSlot != 0 && nSlot > stats.nLastSlot + nSlotLength) {
+        stats.nMissedSlots += (nSlot - stats.nLastSlot) / nSlotLength - 1;
+    }
+    stats.nSlots++;
+    stats.nLastSlot = nSlot;
+    stats.nLastSlotKernels = nKernels;
+}
+
+void CStakerStatus::AddStakedBlock()
+{
+    LOCK(cs_stats);
+    stats.nBlocks++;
+}
+
+CStakerStats CStakerStatus::GetStats() const
+{
+    LOCK(cs_stats);
+    return stats;
+}
+
+void CStakerStatus::ResetStats()
+{
+    LOCK(cs_stats);
+    stats = CStakerStats();
+}
+
+static ctpl::thread_pool& GetStakingPool()
+{
+    static ctpl::thread_pool stakingPool;
+    static std::once_flag startFlag;
+    std::call_once(startFlag, [] {
+        // -stakingthreads=0 means autodetect, <0 leaves that many cores free
+        int nThreads = gArgs.GetArg("-stakingthreads", DEFAULT_STAKING_THREADS);
+        if (nThreads <= 0) {
+            nThreads += GetNumCores();
+        }
+        stakingPool.resize(std::max(1, std::min(nThreads, MAX_STAKING_THREADS)));
+        RenameThreadPool(stakingPool, "pivx-stake-search");
+    });
+    return stakingPool;
+}
+
+// Hashes the kernels of coins[begin, end) until one of the shards finds a kernel,
+// setting vKernelTimes[i] to the block time of each kernel found. Returns the number of attempts.
+static int SearchKernelsShard(const CBlockIndex* pindexPrev, unsigned int nBits,
+                              const std::vector<CStakeableOutput>& coins, size_t begin, size_t end,
+                              CStakeKernelSearch& kernelSearch, std::vector<int64_t>& vKernelTimes,
+                              std::atomic<bool>& fFound)
+{
+    int nAttempts = 0;
+    for (size_t i = begin; i < end && !fFound; i++) {
+        const CStakeableOutput& coin = coins[i];
+        CPivStake stakeInput(coin.tx->tx->vout[coin.i], COutPoint(coin.tx->GetHash(), coin.i), coin.pindex);
+        int64_t nTimeTx = 0;
+        nAttempts++;
+        if (Stake(pindexPrev, &stakeInput, nBits, nTimeTx, kernelSearch)) {
+            vKernelTimes[i] = nTimeTx;
+            fFound = true;
+        }
+    }
+    return nAttempts;
+}
+
 bool CWallet::CreateCoinStake(
         const CBlockIndex* pindexPrev,
         unsigned int nBits,
@@ -3363,6 +3888,7 @@ bool CWallet::CreateCoinStake(
     // update staker status (hash)
     pStakerStatus->SetLastTip(pindexPrev);
     pStakerStatus->SetLastCoins((int) availableCoins->size());
+    StakingStepTimer timer(pStakerStatus, StakingStep::KERNEL_SEARCH);
 
     // Kernel Search
     CAmount nCredit;
@@ -3370,7 +3896,41 @@ bool CWallet::CreateCoinStake(
     CScript scriptPubKeyKernel;
     bool fKernelFound = false;
     int nAttempts = 0;
+
+    // With enough coins, hash the kernels on the staking pool first (shards race
+    // for the same time slot), then only go through the coins with a kernel.
+    const size_t nShards = std::min((size_t)GetStakingPool().size(), availableCoins->size() / MIN_STAKING_SHARD_COINS);
+    const bool fParallelSearch = nShards > 1;
+    std::vector<int64_t> vKernelTimes;
+    if (fParallelSearch) {
+        if (IsLocked() || ShutdownRequested()) return false;
+        vKernelTimes.assign(availableCoins->size(), 0);
+        std::atomic<bool> fFound{false};
+        const size_t shardSize = (availableCoins->size() + nShards - 1) / nShards;
+        std::vector<std::future<int>> futures;
+        futures.reserve(nShards);
+        for (size_t nShard = 0; nShard < nShards; nShard++) {
+            const size_t begin = nShard * shardSize;
+            const size_t end = std::min(begin + shardSize, availableCoins->size());
+            CStakeKernelSearch& kernelSearch = pStakerStatus->GetKernelSearch(nShard);
+            futures.emplace_back(GetStakingPool().push([&, begin, end](int threadId) {
+                return SearchKernelsShard(pindexPrev, nBits, *availableCoins, begin, end, kernelSearch, vKernelTimes, fFound);
+            }));
+        }
+        for (auto& f : futures) {
+            nAttempts += f.get();
+        }
+        pStakerStatus->SetLastTime(Params().IsRegTestNet() ? GetAdjustedTime() : GetCurrentTimeSlot());
+        pStakerStatus->SetLastTries(nAttempts);
+    }
+
     for (auto it = availableCoins->begin(); it != availableCoins->end();) {
+        const size_t nCoin = it - availableCoins->begin();
+        if (fParallelSearch && vKernelTimes[nCoin] == 0) {
+            it++;
+            continue;
+        }
+
         COutPoint outPoint = COutPoint(it->tx->GetHash(), it->i);
         CPivStake stakeInput(it->tx->tx->vout[it->i],
                              outPoint,
@@ -3386,17 +3946,23 @@ bool CWallet::CreateCoinStake(
         if (WITH_LOCK(cs_wallet, return IsSpent(outPoint))) {
             // remove it from the available coins
             it = availableCoins->erase(it);
+            if (fParallelSearch) vKernelTimes.erase(vKernelTimes.begin() + nCoin);
             continue;
         }
 
         nCredit = 0;
 
-        nAttempts++;
-        fKernelFound = Stake(pindexPrev, &stakeInput, nBits, nTxNewTime);
+        if (fParallelSearch) {
+            fKernelFound = true;
+            nTxNewTime = vKernelTimes[nCoin];
+        } else {
+            nAttempts++;
+            fKernelFound = Stake(pindexPrev, &stakeInput, nBits, nTxNewTime, pStakerStatus->GetKernelSearch());
 
-        // update staker status (time, attempts)
-        pStakerStatus->SetLastTime(nTxNewTime);
-        pStakerStatus->SetLastTries(nAttempts);
+            // update staker status (time, attempts)
+            pStakerStatus->SetLastTime(nTxNewTime);
+            pStakerStatus->SetLastTries(nAttempts);
+        }
 
         if (!fKernelFound) {
             it++;
@@ -3446,6 +4012,7 @@ bool CWallet::CreateCoinStake(
         break;
     }
     LogPrint(BCLog::STAKING, "%s: attempted staking %d times\n", __func__, nAttempts);
+    pStakerStatus->AddStakeAttempt(GetCurrentTimeSlot(), nAttempts);
 
     return fKernelFound;
 }
@@ -3466,7 +4033,9 @@ bool CWallet::SignCoinStake(CMutableTransaction& txNew) const
 
 std::string CWallet::CommitResult::ToString() const
 {
-    std::string strErrRet = strprintf(_("Failed to accept tx in the memory pool (reason: %s)\n"), FormatStateMessage(state));
+    std::string strErrRet = state.IsError() ?
+            strprintf(_("Failed to write tx to the wallet (reason: %s)\n"), FormatStateMessage(state)) :
+            strprintf(_("Failed to accept tx in the memory pool (reason: %s)\n"), FormatStateMessage(state));
 
     switch (status) {
         case CWallet::CommitStatus::OK:
@@ -3490,12 +4059,10 @@ CWallet::CommitResult CWallet::CommitTransaction(CTransactionRef tx, CReserveKey
     return CommitTransaction(std::move(tx), &opReservekey, connman);
 }
 
-/**
- * Call after CreateTransaction unless you want to abort
- */
-CWallet::CommitResult CWallet::CommitTransaction(CTransactionRef tx, CReserveKey* opReservekey, CConnman* connman, mapValue_t* extras)
+void CWallet::AddSentTransaction(CTransactionRef tx, CReserveKey* opReservekey, mapValue_t* extras)
 {
-    CommitResult res;
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
     CWalletTx wtxNew(this, std::move(tx));
     wtxNew.fTimeReceivedIsTxTime = true;
@@ -3504,61 +4071,122 @@ CWallet::CommitResult CWallet::CommitTransaction(CTransactionRef tx, CReserveKey
     wtxNew.fStakeDelegationVoided = wtxNew.tx->HasP2CSOutputs();
     if (extras) wtxNew.mapValue.insert(extras->begin(), extras->end());
 
-    {
-        LOCK2(cs_main, cs_wallet);
-        LogPrintf("%s:\n%s", __func__, wtxNew.tx->ToString());
-        {
-            // Take key pair from key pool so it won't be used again
-            if (opReservekey) opReservekey->KeepKey();
-
-            // Add tx to wallet, because if it has change it's also ours,
-            // otherwise just for transaction history.
-            AddToWallet(wtxNew);
-
-            // Notify that old coins are spent
-            if (!wtxNew.tx->HasZerocoinSpendInputs()) {
-                std::set<uint256> updated_hashes;
-                for (const CTxIn& txin : wtxNew.tx->vin) {
-                    // notify only once
-                    if (updated_hashes.find(txin.prevout.hash) != updated_hashes.end()) continue;
-
-                    CWalletTx& coin = mapWallet.at(txin.prevout.hash);
-                    coin.BindWallet(this);
-                    NotifyTransactionChanged(this, txin.prevout.hash, CT_UPDATED);
-                    updated_hashes.insert(txin.prevout.hash);
-                }
-            }
-        }
+    LogPrintf("%s:\n%s", __func__, wtxNew.tx->ToString());
 
-        res.hashTx = wtxNew.GetHash();
+    // Take key pair from key pool so it won't be used again
+    if (opReservekey) opReservekey->KeepKey();
 
-        // Get the inserted-CWalletTx from mapWallet so that the
-        // fInMempool flag is cached properly
-        CWalletTx& wtx = mapWallet.at(wtxNew.GetHash());
+    // Add tx to wallet, because if it has change it's also ours,
+    // otherwise just for transaction history.
+    AddToWallet(wtxNew);
 
-        // Try ATMP. This must not fail. The transaction has already been signed and recorded.
-        CValidationState state;
-        if (!wtx.AcceptToMemoryPool(state)) {
-            res.state = state;
-            // Abandon the transaction
-            if (AbandonTransaction(res.hashTx)) {
-                res.status = CWallet::CommitStatus::Abandoned;
-                // Return the change key
-                if (opReservekey) opReservekey->ReturnKey();
-            }
+    // Notify that old coins are spent
+    if (!wtxNew.tx->HasZerocoinSpendInputs()) {
+        std::set<uint256> updated_hashes;
+        for (const CTxIn& txin : wtxNew.tx->vin) {
+            // notify only once
+            if (updated_hashes.find(txin.prevout.hash) != updated_hashes.end()) continue;
 
-            LogPrintf("%s: ERROR: %s\n", __func__, res.ToString());
-            return res;
+            CWalletTx& coin = mapWallet.at(txin.prevout.hash);
+            coin.BindWallet(this);
+            NotifyTransactionChanged(this, txin.prevout.hash, CT_UPDATED);
+            updated_hashes.insert(txin.prevout.hash);
         }
+    }
+}
 
-        res.status = CWallet::CommitStatus::OK;
+CWallet::CommitResult CWallet::SubmitSentTransaction(const uint256& hashTx, CReserveKey* opReservekey, CConnman* connman)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
-        // Broadcast
-        wtx.RelayWalletTransaction(connman);
+    CommitResult res;
+    res.hashTx = hashTx;
+
+    // Get the inserted-CWalletTx from mapWallet so that the
+    // fInMempool flag is cached properly
+    CWalletTx& wtx = mapWallet.at(hashTx);
+
+    // Try ATMP. This must not fail. The transaction has already been signed and recorded.
+    CValidationState state;
+    if (!wtx.AcceptToMemoryPool(state)) {
+        res.state = state;
+        // Abandon the transaction
+        if (AbandonTransaction(res.hashTx)) {
+            res.status = CWallet::CommitStatus::Abandoned;
+            // Return the change key
+            if (opReservekey) opReservekey->ReturnKey();
+        }
+
+        LogPrintf("%s: ERROR: %s\n", __func__, res.ToString());
+        return res;
     }
+
+    res.status = CWallet::CommitStatus::OK;
+
+    // Broadcast
+    wtx.RelayWalletTransaction(connman);
     return res;
 }
 
+/**
+ * Call after CreateTransaction unless you want to abort
+ */
+CWallet::CommitResult CWallet::CommitTransaction(CTransactionRef tx, CReserveKey* opReservekey, CConnman* connman, mapValue_t* extras)
+{
+    LOCK2(cs_main, cs_wallet);
+    const uint256 hashTx = tx->GetHash();
+    AddSentTransaction(std::move(tx), opReservekey, extras);
+    return SubmitSentTransaction(hashTx, opReservekey, connman);
+}
+
+std::vector<CWallet::CommitResult> CWallet::CommitTransactions(const std::vector<CTransactionRef>& vtx,
+                                                               std::vector<std::unique_ptr<CReserveKey>>& vReserveKeys,
+                                                               CConnman* connman)
+{
+    assert(vtx.size() == vReserveKeys.size());
+    LOCK2(cs_main, cs_wallet);
+
+    // The change keys are kept, and the txs written, in a single database transaction:
+    // the batch is tunneled through to AddToWallet and ScriptPubKeyMan::KeepDestination.
+    bool fCommitted = true;
+    {
+        WalletBatch batch(*database);
+        const bool fTxn = batch.TxnBegin();
+        assert(!encrypted_batch);
+        encrypted_batch = &batch;
+        for (size_t i = 0; i < vtx.size(); i++) {
+            AddSentTransaction(vtx[i], vReserveKeys[i].get(), nullptr);
+        }
+        encrypted_batch = nullptr;
+        if (fTxn && !batch.TxnCommit()) {
+            LogPrintf("%s: ERROR: failed to commit the wallet transactions to the database\n", __func__);
+            fCommitted = false;
+        }
+    }
+
+    std::vector<CommitResult> vResults;
+    vResults.reserve(vtx.size());
+    if (!fCommitted) {
+        // Nothing was broadcast: abandon the whole batch, so that its inputs can be spent again.
+        // The change keys stay out of the keypool, they may have been handed out already.
+        for (const CTransactionRef& tx : vtx) {
+            CommitResult res;
+            res.hashTx = tx->GetHash();
+            res.state.Error("wallet-db-commit-failed");
+            if (AbandonTransaction(res.hashTx)) {
+                res.status = CWallet::CommitStatus::Abandoned;
+            }
+            vResults.emplace_back(res);
+        }
+        return vResults;
+    }
+    for (size_t i = 0; i < vtx.size(); i++) {
+        vResults.emplace_back(SubmitSentTransaction(vtx[i]->GetHash(), vReserveKeys[i].get(), connman));
+    }
+    return vResults;
+}
+
 DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
 {
     LOCK2(cs_main, cs_wallet);
@@ -3761,10 +4389,11 @@ std::map<CTxDestination, CAmount> CWallet::GetAddressBalances()
 
             for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
                 CTxDestination addr;
-                if (!IsMine(pcoin->tx->vout[i]))
+                if (!IsMine(*pcoin->tx, i))
                     continue;
-                if ( !ExtractDestination(pcoin->tx->vout[i].scriptPubKey, addr) &&
-                        !ExtractDestination(pcoin->tx->vout[i].scriptPubKey, addr, true) )
+                const CScriptSolution& solution = GetOutputSolutions(*pcoin->tx)[i];
+                if ( !ExtractDestination(solution, addr) &&
+                        !ExtractDestination(solution, addr, true) )
                     continue;
 
                 CAmount n = IsSpent(walletEntry.first, i) ? 0 : pcoin->tx->vout[i].nValue;
@@ -3819,9 +4448,9 @@ std::set<std::set<CTxDestination> > CWallet::GetAddressGroupings()
 
         // group lone addrs by themselves
         for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++)
-            if (IsMine(pcoin->tx->vout[i])) {
+            if (IsMine(*pcoin->tx, i)) {
                 CTxDestination address;
-                if (!ExtractDestination(pcoin->tx->vout[i].scriptPubKey, address))
+                if (!ExtractDestination(GetOutputSolutions(*pcoin->tx)[i], address))
                     continue;
                 grouping.insert(address);
                 groupings.insert(grouping);
@@ -3927,36 +4556,42 @@ void CWallet::LockCoin(const COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.insert(output);
+    MarkBalancesDirty();
 }
 
 void CWallet::LockNote(const SaplingOutPoint& op)
 {
     AssertLockHeld(cs_wallet); // setLockedNotes
     setLockedNotes.insert(op);
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockCoin(const COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.erase(output);
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockNote(const SaplingOutPoint& op)
 {
     AssertLockHeld(cs_wallet); // setLockedNotes
     setLockedNotes.erase(op);
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.clear();
+    MarkBalancesDirty();
 }
 
 void CWallet::UnlockAllNotes()
 {
     AssertLockHeld(cs_wallet); // setLockedNotes
     setLockedNotes.clear();
+    MarkBalancesDirty();
 }
 
 bool CWallet::IsLockedCoin(const uint256& hash, unsigned int n) const
@@ -4366,10 +5001,24 @@ CWallet* CWallet::CreateWalletFromFile(const std::string& name, const fs::path&
             walletInstance->m_last_block_processed_time = tip->GetBlockTime();
         }
     }
-    RegisterValidationInterface(walletInstance);
+    RegisterValidationInterface(walletInstance, true);
 
     if (chainActive.Tip() && chainActive.Tip() != pindexRescan) {
         uiInterface.InitMessage(_("Rescanning..."));
+        //We can't rescan beyond non-pruned blocks, stop and throw an error
+        //this might happen if a user uses an old wallet within a pruned node
+        // or if he ran -disablewallet for a longer time, then decided to re-enable
+        if (fPruneMode) {
+            CBlockIndex* block = chainActive.Tip();
+            while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA) && block->pprev->nTx > 0 && pindexRescan != block)
+                block = block->pprev;
+
+            if (pindexRescan != block) {
+                UIError(_("Prune: last wallet synchronisation goes beyond pruned data. You need to -reindex (download the whole blockchain again in case of pruned node)"));
+                return nullptr;
+            }
+        }
+
         LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
 
         // no need to read and scan block, if block was created before
@@ -4493,6 +5142,7 @@ bool CWalletTx::AcceptToMemoryPool(CValidationState& state)
     bool fMissingInputs;
     bool fAccepted = ::AcceptToMemoryPool(mempool, state, tx, true, &fMissingInputs, false, true, false);
     fInMempool = fAccepted;
+    pwallet->MarkBalancesDirty();
     if (!fAccepted) {
         if (fMissingInputs) {
             // For now, "missing inputs" error is not returning the proper state, so need to set it manually here.
@@ -4578,6 +5228,15 @@ isminetype CWallet::IsMine(const CTxOut& txout) const
     return ::IsMine(*this, txout.scriptPubKey);
 }
 
+isminetype CWallet::IsMine(const CTransaction& tx, unsigned int n) const
+{
+    // Parse the outputs only once one of them may be ours
+    if (!IsMineCandidate(tx.vout[n].scriptPubKey)) {
+        return ISMINE_NO;
+    }
+    return ::IsMine(*this, tx.vout[n].scriptPubKey, GetOutputSolutions(tx)[n]);
+}
+
 CAmount CWallet::GetCredit(const CTxOut& txout, const isminefilter& filter) const
 {
     if (!Params().GetConsensus().MoneyRange(txout.nValue))
@@ -4594,8 +5253,8 @@ CAmount CWallet::GetChange(const CTxOut& txout) const
 
 bool CWallet::IsMine(const CTransactionRef& tx) const
 {
-    for (const CTxOut& txout : tx->vout)
-        if (IsMine(txout))
+    for (unsigned int i = 0; i < tx->vout.size(); i++)
+        if (IsMine(*tx, i))
             return true;
     return false;
 }
@@ -4640,7 +5299,10 @@ CAmount CWallet::GetCredit(const CWalletTx& tx, const isminefilter& filter) cons
 {
     CAmount nCredit = 0;
     for (unsigned int i = 0; i < tx.tx->vout.size(); i++) {
-        nCredit += GetCredit(tx.tx->vout[i], filter);
+        const CTxOut& txout = tx.tx->vout[i];
+        if (!Params().GetConsensus().MoneyRange(txout.nValue))
+            throw std::runtime_error("CWallet::GetCredit() : value out of range");
+        if (IsMine(*tx.tx, i) & filter) nCredit += txout.nValue;
     }
 
     // Shielded credit
@@ -4819,6 +5481,13 @@ void CWalletTx::MarkDirty()
     nShieldedChangeCached = 0;
     fShieldedChangeCached = false;
     fStakeDelegationVoided = false;
+    if (pwallet) pwallet->MarkBalancesDirty();
+}
+
+void CWalletTx::MarkAvailableCreditDirty()
+{
+    m_amounts[AVAILABLE_CREDIT].Reset();
+    if (pwallet) pwallet->MarkBalancesDirty();
 }
 
 void CWalletTx::BindWallet(CWallet* pwalletIn)
@@ -24,6 +24,7 @@
 #include "primitives/transaction.h"
 #include "sapling/address.h"
 #include "guiinterface.h"
+#include "histogram.h"
 #include "util/system.h"
 #include "utilstrencodings.h"
 #include "validationinterface.h"
@@ -34,12 +35,15 @@
 #include "wallet/walletdb.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -78,6 +82,11 @@ static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 static const bool DEFAULT_STAKING = true;
 //! Default for -coldstaking
 static const bool DEFAULT_COLDSTAKING = true;
+//! -stakingthreads default and upper limit
+static const int DEFAULT_STAKING_THREADS = 1;
+static const int MAX_STAKING_THREADS = 16;
+//! Below this many stakeable coins per thread, the kernel search is not split
+static const size_t MIN_STAKING_SHARD_COINS = 500;
 //! Defaults for -gen and -genproclimit
 static const bool DEFAULT_GENERATE = false;
 static const unsigned int DEFAULT_GENERATE_PROCLIMIT = 1;
@@ -175,11 +184,45 @@ public:
     }
 };
 
+/** Steps of the staking hot path timed in CStakerStats */
+enum class StakingStep {
+    STAKEABLE_COINS,    // StakeableCoins, once per block
+    BLOCK_TEMPLATE,     // BlockAssembler::CreateStakeTemplate
+    KERNEL_SEARCH,      // CWallet::CreateCoinStake, once per time slot
+    SIGN_COINSTAKE,     // CWallet::SignCoinStake
+    SIGN_BLOCK,         // SignBlock
+    PROCESS_BLOCK,      // ProcessNewBlock of a staked block
+    COUNT
+};
+
+struct CStakingTimerBounds
+{
+    // under 0.1, 1, 10, 100 and 1000 ms
+    static constexpr std::array<int64_t, 5> VALUES{{99, 999, 9999, 99999, 999999}};
+};
+
+/** Time spent in a staking step, with a histogram of the durations */
+typedef FixedHistogram<CStakingTimerBounds> CStakingTimer;
+
+/** Staking telemetry (see getstakingperf) */
+struct CStakerStats
+{
+    std::array<CStakingTimer, (size_t)StakingStep::COUNT> vTimers;
+    uint64_t nSlots{0};             // time slots attempted
+    uint64_t nMissedSlots{0};       // time slots skipped between two attempts
+    uint64_t nKernels{0};           // kernels hashed
+    int nLastSlotKernels{0};        // kernels hashed during the last attempted slot
+    int64_t nLastSlot{0};           // last attempted time slot
+    uint64_t nBlocks{0};            // staked blocks accepted
+};
+
 /** Record info about last stake attempt:
  *  - tipBlock       index of the block on top of which last stake attempt was made
  *  - nTime          time slot of last attempt
  *  - nTries         number of UTXOs hashed during last attempt
  *  - nCoins         number of stakeable utxos during last attempt
+ *  - vKernelSearch  kernel hashing state reused by the attempts on the same tip (one per search shard)
+ *  - stats          staking telemetry since startup (or the last reset)
 **/
 class CStakerStatus
 {
@@ -188,6 +231,9 @@ private:
     int64_t nTime{0};
     int nTries{0};
     int nCoins{0};
+    std::vector<std::unique_ptr<CStakeKernelSearch>> vKernelSearch;
+    mutable Mutex cs_stats;
+    CStakerStats stats GUARDED_BY(cs_stats);
 
 public:
     // Get
@@ -197,6 +243,11 @@ public:
     int GetLastCoins() const { return nCoins; }
     int GetLastTries() const { return nTries; }
     int64_t GetLastTime() const { return nTime; }
+    CStakeKernelSearch& GetKernelSearch(const size_t nShard = 0)
+    {
+        while (vKernelSearch.size() <= nShard) vKernelSearch.emplace_back(std::make_unique<CStakeKernelSearch>());
+        return *vKernelSearch[nShard];
+    }
     // Set
     void SetLastCoins(const int coins) { nCoins = coins; }
     void SetLastTries(const int tries) { nTries = tries; }
@@ -208,9 +259,33 @@ public:
         SetLastTries(0);
         SetLastTip(nullptr);
         SetLastTime(0);
+        vKernelSearch.clear();
     }
     // Check whether staking status is active (last attempt earlier than 30 seconds ago)
     bool IsActive() const { return (nTime + 30) >= GetTime(); }
+    // Telemetry
+    void AddStakingTime(StakingStep step, int64_t nMicros);
+    void AddStakeAttempt(int64_t nSlot, int nKernels);
+    void AddStakedBlock();
+    CStakerStats GetStats() const;
+    void ResetStats();
+};
+
+/** Add the time spent in its scope to a step of the staking telemetry of pStakerStatus (if any) */
+class StakingStepTimer
+{
+private:
+    CStakerStatus* pStakerStatus;
+    const StakingStep step;
+    const int64_t nStart;
+
+public:
+    StakingStepTimer(CStakerStatus* _pStakerStatus, StakingStep _step) :
+        pStakerStatus(_pStakerStatus), step(_step), nStart(GetTimeMicros()) {}
+    ~StakingStepTimer()
+    {
+        if (pStakerStatus) pStakerStatus->AddStakingTime(step, GetTimeMicros() - nStart);
+    }
 };
 
 class CRecipientBase {
@@ -461,6 +536,8 @@ public:
 
     //! make sure balances are recalculated
     void MarkDirty();
+    //! an output of the tx was spent or unspent: only the available credit must be recalculated
+    void MarkAvailableCreditDirty();
 
     void BindWallet(CWallet* pwalletIn);
 
@@ -579,6 +656,9 @@ private:
     static std::atomic<bool> fFlushScheduled;
     std::atomic<bool> fAbortRescan;
     std::atomic<bool> fScanningWallet; //controlled by WalletRescanReserver
+    std::atomic<int64_t> m_scanning_start{0};
+    std::atomic<double> m_scanning_progress{0};
+    std::atomic<int> m_scanning_blocks{0};
     std::mutex mutexScanning;
     friend class WalletRescanReserver;
 
@@ -639,12 +719,36 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Txs that may have spendable or stakeable outputs: every wallet tx enters the set, and
+     * the coin searches drop the ones whose outputs are all either not mine or spent
+     * in the main chain. Disconnected blocks put back the txs they were spending from,
+     * and MarkDirty() (keys imported) refills it, so AvailableCoins and StakeableCoins
+     * don't walk mapWallet.
+     */
+    mutable std::set<uint256> setCoinCandidates GUARDED_BY(cs_wallet);
+    bool IsSpentInChain(const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    //! Runs method on the txs of setCoinCandidates, in txid order, until it returns false
+    void ForEachCoinCandidate(const std::function<bool(const uint256&, const CWalletTx*)>& method) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /**
+     * P2CS outputs of the wallet txs by staker and by owner key id, whether the keys are
+     * ours or not (they can be imported later). Kept on tx add and erase, so the cold
+     * staking lookups and balances don't inspect every script of mapWallet.
+     */
+    std::map<CKeyID, std::set<COutPoint>> mapP2CSByStaker GUARDED_BY(cs_wallet);
+    std::map<CKeyID, std::set<COutPoint>> mapP2CSByOwner GUARDED_BY(cs_wallet);
+    void AddToP2CSIndex(const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void RemoveFromP2CSIndex(const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, int conflicting_height, const uint256& hashTx);
 
     template <class T>
     void SyncMetaData(std::pair<typename TxSpendMap<T>::iterator, typename TxSpendMap<T>::iterator> range);
     void ChainTipAdded(const CBlockIndex *pindex, const CBlock *pblock, SaplingMerkleTree saplingTree);
+    /* Sync the transactions and the Sapling witnesses with a connected block */
+    void SyncConnectedBlock(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
 
     /* Used by TransactionAddedToMemorypool/BlockConnected/Disconnected */
     void SyncTransaction(const CTransactionRef& tx, const CWalletTx::Confirmation& confirm);
@@ -658,7 +762,7 @@ private:
         bool spendable{false};
     };
 
-    OutputAvailabilityResult CheckOutputAvailability(const CTxOut& output,
+    OutputAvailabilityResult CheckOutputAvailability(const CTransaction& tx,
                                                      const unsigned int outIndex,
                                                      const uint256& wtxid,
                                                      const CCoinControl* coinControl,
@@ -700,6 +804,7 @@ public:
         m_last_block_processed_height = pindex->nHeight;
         m_last_block_processed = pindex->GetBlockHash();
         m_last_block_processed_time = pindex->GetBlockTime();
+        MarkBalancesDirty();
     };
 
     /* SPKM Helpers */
@@ -720,6 +825,8 @@ public:
 
     bool fWalletUnlockStaking;
 
+    //! The batch the keys are written with while encrypting the wallet, or while adding a key
+    //! through ScriptPubKeyMan::AddKeyPubKeyWithDB, and the txs by CommitTransactions.
     WalletBatch* encrypted_batch;
 
     std::map<CKeyID, CKeyMetadata> mapKeyMetadata;
@@ -833,11 +940,15 @@ public:
      * Select coins until nTargetValue is reached. Return the actual value
      * and the corresponding coin set.
      */
-    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
+    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, const std::vector<COutput>& vCoins, std::set<std::pair<const CWalletTx*, unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
     //! >> Available coins (staking)
     bool StakeableCoins(std::vector<CStakeableOutput>* pCoins = nullptr);
     //! >> Available coins (P2CS)
     void GetAvailableP2CSCoins(std::vector<COutput>& vCoins) const;
+    //! P2CS outpoints of the wallet txs: all of them, or the ones of a staker or owner key
+    std::set<COutPoint> GetP2CSOutpoints() const;
+    std::set<COutPoint> GetP2CSOutpointsByStaker(const CKeyID& stakerId) const;
+    std::set<COutPoint> GetP2CSOutpointsByOwner(const CKeyID& ownerId) const;
 
     std::map<CTxDestination, std::vector<COutput> > AvailableCoinsByAddress(bool fConfirmed, CAmount maxCoinValue, bool fIncludeColdStaking);
 
@@ -884,6 +995,12 @@ public:
     void AbortRescan() { fAbortRescan = true; }
     bool IsAbortingRescan() { return fAbortRescan; }
     bool IsScanning() { return fScanningWallet; }
+    //! Milliseconds since the start of the current rescan, 0 if not scanning
+    int64_t ScanningDuration() const { return fScanningWallet ? GetTimeMillis() - m_scanning_start : 0; }
+    //! Verification progress of the current rescan, from 0 to 1
+    double ScanningProgress() const { return fScanningWallet ? (double) m_scanning_progress : 0; }
+    //! Blocks processed by the current rescan
+    int ScanningBlocks() const { return fScanningWallet ? (int) m_scanning_blocks : 0; }
 
     /*
      * Stake Split threshold
@@ -1026,7 +1143,9 @@ public:
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose = true);
     bool LoadToWallet(CWalletTx& wtxIn);
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
+    void TransactionsAddedToMempool(const std::vector<CTransactionRef>& vtx) override;
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex *pindex) override;
+    void BlocksConnected(const std::vector<ConnectedBlock>& blocks) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const uint256& blockHash, int nBlockHeight, int64_t blockTime) override;
     bool AddToWalletIfInvolvingMe(const CTransactionRef& tx, const CWalletTx::Confirmation& confirm, bool fUpdate);
     void EraseFromWallet(const uint256& hash);
@@ -1053,7 +1172,6 @@ public:
     };
     Balance GetBalance(int min_depth = 0) const;
 
-    CAmount loopTxsBalance(const std::function<void(const uint256&, const CWalletTx&, CAmount&)>&method) const;
     CAmount GetAvailableBalance(bool fIncludeDelegated = true, bool fIncludeShielded = true) const;
     CAmount GetAvailableBalance(isminefilter& filter, bool useCache = false, int minDepth = 1) const;
     CAmount GetColdStakingBalance() const;  // delegated coins for which we have the staking key
@@ -1069,6 +1187,68 @@ public:
     CAmount GetUnconfirmedWatchOnlyBalance() const;
     CAmount GetImmatureWatchOnlyBalance() const;
     CAmount GetLegacyBalance(const isminefilter& filter, int minDepth) const;
+    //! Invalidates the cached balances: called on every change of the wallet txs, of their chain or
+    //! mempool state, of the last block processed and of the locked coins.
+    void MarkBalancesDirty() const { ++m_balance_epoch; }
+
+private:
+    //! The balance getters whose results are cached
+    enum BalanceQuery : uint8_t {
+        BALANCE_UNCACHED,
+        BALANCE_AVAILABLE,
+        BALANCE_COLD_STAKING,
+        BALANCE_IMMATURE_COLD_STAKING,
+        BALANCE_STAKING,
+        BALANCE_DELEGATED,
+        BALANCE_IMMATURE_DELEGATED,
+        BALANCE_UNCONFIRMED,
+        BALANCE_IMMATURE,
+        BALANCE_WATCH_ONLY,
+        BALANCE_UNCONFIRMED_WATCH_ONLY,
+        BALANCE_IMMATURE_WATCH_ONLY,
+    };
+    //! Query, filter and depth (or flag) argument of a balance getter
+    typedef std::tuple<BalanceQuery, isminefilter, int> BalanceCacheKey;
+
+    /**
+     * Balances computed since the last MarkBalancesDirty(), so that the polls of the GUI, RPC and staker
+     * don't loop mapWallet while nothing changed. m_balance_epoch is bumped without the wallet lock,
+     * the cached values are dropped by SyncBalanceCache() when their epoch is stale.
+     */
+    mutable std::atomic<uint64_t> m_balance_epoch{1};
+    mutable uint64_t m_balance_cache_epoch GUARDED_BY(cs_wallet){0};
+    mutable std::map<BalanceCacheKey, CAmount> m_balance_cache GUARDED_BY(cs_wallet);
+    mutable std::map<int, Balance> m_balance_struct_cache GUARDED_BY(cs_wallet);
+    void SyncBalanceCache() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    //! Returns the cached balance of key, or computes and caches it
+    CAmount GetCachedBalance(const BalanceCacheKey& key, const std::function<CAmount()>& compute) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    //! Runs method on each wallet tx
+    CAmount loopTxsBalance(const BalanceCacheKey& key, const std::function<void(const uint256&, const CWalletTx&, CAmount&)>& method) const;
+    //! Runs method on each wallet tx with P2CS outputs
+    CAmount loopP2CSTxsBalance(const BalanceCacheKey& key, const std::function<void(const uint256&, const CWalletTx&, CAmount&)>& method) const;
+
+    /**
+     * Select the coins of vAvailableCoins paying the recipients and the fee of txNew, returned in
+     * setCoins, and add the change output, when needed. The inputs of txNew are left unsigned.
+     */
+    bool FundTransactionFromCoins(const std::vector<CRecipient>& vecSend,
+        const std::vector<COutput>& vAvailableCoins,
+        CMutableTransaction& txNew,
+        std::set<std::pair<const CWalletTx*, unsigned int>>& setCoins,
+        CReserveKey& reservekey,
+        CAmount& nFeeRet,
+        int& nChangePosInOut,
+        std::string& strFailReason,
+        const CCoinControl* coinControl,
+        CAmount nFeePay,
+        bool* fStakeDelegationVoided,
+        int nExtraSize) EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+    //! Sign the inputs of vTx[i], spending the coins of vSetCoins[i]. With enough inputs, they are signed in parallel.
+    bool SignTransactions(std::vector<CMutableTransaction>& vTx,
+                          const std::vector<std::set<std::pair<const CWalletTx*, unsigned int>>>& vSetCoins) const;
+
+public:
     bool FundTransaction(CMutableTransaction& tx, CAmount &nFeeRet, bool overrideEstimatedFeeRate, const CFeeRate& specificFeeRate, int& nChangePosInOut, std::string& strFailReason, bool includeWatching, bool lockUnspents, const std::set<int>& setSubtractFeeFromOutputs, const CTxDestination& destChange = CNoDestination());
     /**
      * Create a new transaction paying the recipients with a set of coins
@@ -1091,6 +1271,18 @@ public:
 
     bool CreateTransaction(CScript scriptPubKey, const CAmount& nValue, CTransactionRef& tx, CReserveKey& reservekey, CAmount& nFeeRet, std::string& strFailReason, const CCoinControl* coinControl = nullptr, CAmount nFeePay = 0, bool fIncludeDelegated = false, bool* fStakeDelegationVoided = nullptr, int nExtraSize = 0, int nMinDepth = 0);
 
+    /**
+     * Create a batch of signed transactions, the i-th paying the recipients of vecSends[i], from a single
+     * snapshot of the available coins: the coins selected for a transaction are not available to the next
+     * ones. vReserveKeys are the change keys of the transactions. On failure, no transaction is returned.
+     */
+    bool CreateTransactions(const std::vector<std::vector<CRecipient>>& vecSends,
+        std::vector<CTransactionRef>& vTxRet,
+        std::vector<std::unique_ptr<CReserveKey>>& vReserveKeys,
+        std::string& strFailReason,
+        bool fIncludeDelegated = false,
+        int nMinDepth = 0);
+
     // enumeration for CommitResult (return status of CommitTransaction)
     enum CommitStatus
     {
@@ -1109,6 +1301,18 @@ public:
     };
     CWallet::CommitResult CommitTransaction(CTransactionRef tx, CReserveKey& opReservekey, CConnman* connman);
     CWallet::CommitResult CommitTransaction(CTransactionRef tx, CReserveKey* reservekey, CConnman* connman, mapValue_t* extraValues=nullptr);
+    //! Commit a batch created by CreateTransactions: the txs are written in a single database transaction
+    std::vector<CWallet::CommitResult> CommitTransactions(const std::vector<CTransactionRef>& vtx,
+                                                          std::vector<std::unique_ptr<CReserveKey>>& vReserveKeys,
+                                                          CConnman* connman);
+
+private:
+    //! Add a tx created by the wallet, keeping its change key
+    void AddSentTransaction(CTransactionRef tx, CReserveKey* opReservekey, mapValue_t* extras) EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+    //! Accept to the mempool, and relay, a tx added with AddSentTransaction. It is abandoned if rejected.
+    CommitResult SubmitSentTransaction(const uint256& hashTx, CReserveKey* opReservekey, CConnman* connman) EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+
+public:
 
     bool CreateCoinstakeOuts(const CPivStake& stakeInput, std::vector<CTxOut>& vout, CAmount nTotal) const;
     bool CreateCoinStake(const CBlockIndex* pindexPrev,
@@ -1145,6 +1349,8 @@ public:
     isminetype IsMine(const CTxIn& txin) const;
     CAmount GetDebit(const CTxIn& txin, const isminefilter& filter) const;
     isminetype IsMine(const CTxOut& txout) const;
+    //! IsMine of the output n of tx, with the Solver results of its outputs kept with the transaction
+    isminetype IsMine(const CTransaction& tx, unsigned int n) const;
     CAmount GetCredit(const CTxOut& txout, const isminefilter& filter) const;
     bool IsChange(const CTxOut& txout) const;
     bool IsChange(const CTxDestination& address) const;
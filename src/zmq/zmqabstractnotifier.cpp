@@ -11,7 +11,7 @@ CZMQAbstractNotifier::~CZMQAbstractNotifier()
     assert(!psocket);
 }
 
-bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/)
+bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/, const CBlock * /*CBlock*/)
 {
     return true;
 }
@@ -21,3 +21,37 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
     return true;
 }
 
+bool CZMQAbstractNotifier::NotifyTransactionRemoval(const CTransaction &/*transaction*/, MemPoolRemovalReason /*reason*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyChainLock(const CBlockIndex * /*pindex*/, const llmq::CChainLockSig &/*clsig*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyRecoveredSig(const llmq::CRecoveredSig &/*recoveredSig*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyMasternodeListDiff(bool /*undo*/, const uint256 &/*oldListBlockHash*/, const CDeterministicMNListDiff &/*diff*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyProposalVote(const CBudgetVote &/*vote*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyFinalizedBudgetVote(const CFinalizedBudgetVote &/*vote*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::Flush()
+{
+    return true;
+}
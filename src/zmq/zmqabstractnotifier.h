@@ -7,11 +7,24 @@
 
 #include "zmqconfig.h"
 
+class CBlock;
 class CBlockIndex;
+class CBudgetVote;
+class CDeterministicMNListDiff;
+class CFinalizedBudgetVote;
 class CZMQAbstractNotifier;
+enum class MemPoolRemovalReason;
+
+namespace llmq {
+class CChainLockSig;
+class CRecoveredSig;
+} // namespace llmq
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
+//! -zmqpub<type>hwm default: the outbound message high water mark of the socket
+static const int DEFAULT_ZMQ_SNDHWM = 1000;
+
 class CZMQAbstractNotifier
 {
 public:
@@ -32,13 +45,29 @@ public:
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
-    virtual bool NotifyBlock(const CBlockIndex *pindex);
+    // pblock is the block of pindex when it is in memory, or null
+    virtual bool NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyTransactionRemoval(const CTransaction &transaction, MemPoolRemovalReason reason);
+    virtual bool NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig &clsig);
+    virtual bool NotifyRecoveredSig(const llmq::CRecoveredSig &recoveredSig);
+    virtual bool NotifyMasternodeListDiff(bool undo, const uint256 &oldListBlockHash, const CDeterministicMNListDiff &diff);
+    virtual bool NotifyProposalVote(const CBudgetVote &vote);
+    virtual bool NotifyFinalizedBudgetVote(const CFinalizedBudgetVote &vote);
+
+    // Send the messages held back for a batch, called at the end of each notification
+    virtual bool Flush();
+
+    void SetBatchSize(size_t n) { nBatchSize = n; }
+    int GetOutboundMessageHighWaterMark() const { return outbound_message_high_water_mark; }
+    void SetOutboundMessageHighWaterMark(int sndhwm) { if (sndhwm >= 0) outbound_message_high_water_mark = sndhwm; }
 
 protected:
     void *psocket;
     std::string type;
     std::string address;
+    size_t nBatchSize{1}; // messages sent as a single multipart message
+    int outbound_message_high_water_mark{DEFAULT_ZMQ_SNDHWM}; // aka SNDHWM
 };
 
 #endif // BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
@@ -5,6 +5,11 @@
 #include "zmqnotificationinterface.h"
 #include "zmqpublishnotifier.h"
 
+#include "budget/budgetvote.h"
+#include "budget/finalizedbudgetvote.h"
+#include "evo/deterministicmns.h"
+#include "llmq/quorums_chainlocks.h"
+#include "llmq/quorums_signing.h"
 #include "version.h"
 #include "streams.h"
 #include "util/system.h"
@@ -38,6 +43,16 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubhashtxremoved"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionRemovalNotifier>;
+    factories["pubhashchainlock"] = CZMQAbstractNotifier::Create<CZMQPublishHashChainLockNotifier>;
+    factories["pubrawchainlocksig"] = CZMQAbstractNotifier::Create<CZMQPublishRawChainLockSigNotifier>;
+    factories["pubrawrecoveredsig"] = CZMQAbstractNotifier::Create<CZMQPublishRawRecoveredSigNotifier>;
+    factories["pubrawmnlistdiff"] = CZMQAbstractNotifier::Create<CZMQPublishRawMNListDiffNotifier>;
+    factories["pubrawbudgetvote"] = CZMQAbstractNotifier::Create<CZMQPublishRawBudgetVoteNotifier>;
+    factories["pubrawfinalbudgetvote"] = CZMQAbstractNotifier::Create<CZMQPublishRawFinalizedBudgetVoteNotifier>;
+
+    const int64_t nBatchSize = std::max<int64_t>(gArgs.GetArg("-zmqbatchsize", DEFAULT_ZMQ_BATCH_SIZE), 1);
+    const int64_t nQueueSize = std::max<int64_t>(gArgs.GetArg("-zmqqueuesize", DEFAULT_ZMQ_QUEUE_SIZE), 1);
 
     for (const auto& entry : factories)
     {
@@ -49,6 +64,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
             CZMQAbstractNotifier *notifier = factory();
             notifier->SetType(entry.first);
             notifier->SetAddress(address);
+            notifier->SetBatchSize(nBatchSize);
+            notifier->SetOutboundMessageHighWaterMark(gArgs.GetArg(arg + "hwm", DEFAULT_ZMQ_SNDHWM));
             notifiers.push_back(notifier);
         }
     }
@@ -57,6 +74,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     {
         notificationInterface = new CZMQNotificationInterface();
         notificationInterface->notifiers = notifiers;
+        notificationInterface->nMaxQueueSize = nQueueSize;
 
         if (!notificationInterface->Initialize())
         {
@@ -102,6 +120,7 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    publisherThread = std::thread(&TraceThread<std::function<void()>>, "zmqpub", std::bind(&CZMQNotificationInterface::ThreadPublisher, this));
     return true;
 }
 
@@ -109,6 +128,14 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint(BCLog::ZMQ, "Shutdown notification interface\n");
+    if (publisherThread.joinable())
+    {
+        // The notifications already queued are sent before the thread stops
+        WITH_LOCK(cs_queue, fStopPublisher = true);
+        condQueue.notify_all();
+        publisherThread.join();
+        if (nDropped > 0) LogPrintf("ZMQ notifications dropped, the publisher queue being full: %d\n", nDropped);
+    }
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
@@ -123,36 +150,50 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+void CZMQNotificationInterface::ThreadPublisher()
 {
-    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
-        return;
+    while (true) {
+        std::function<void()> func;
+        {
+            WAIT_LOCK(cs_queue, lock);
+            condQueue.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(cs_queue) { return fStopPublisher || !queue.empty(); });
+            if (queue.empty()) return;
+            func = std::move(queue.front());
+            queue.pop_front();
+        }
+        func();
+    }
+}
 
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+void CZMQNotificationInterface::Enqueue(std::function<void()> func)
+{
     {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindexNew))
-        {
-            i++;
+        LOCK(cs_queue);
+        if (queue.size() >= nMaxQueueSize) {
+            // Subscribers detect the loss with the gap in the sequence numbers
+            if (!fDropping) {
+                LogPrintf("ZMQ publisher queue full (%d notifications), dropping notifications\n", queue.size());
+                fDropping = true;
+            }
+            nDropped++;
+            return;
         }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+        if (fDropping && queue.empty()) {
+            LogPrintf("ZMQ publisher queue drained, %d notifications dropped so far\n", nDropped);
+            fDropping = false;
         }
+        queue.emplace_back(std::move(func));
     }
+    condQueue.notify_one();
 }
 
-void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx)
+template <typename Function>
+void CZMQNotificationInterface::TryForEachAndRemoveFailed(const Function& func)
 {
-    // Used by BlockConnected and BlockDisconnected as well, because they're
-    // all the same external callback.
-    const CTransaction& tx = *ptx;
-
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
+        if (func(notifier))
         {
             i++;
         }
@@ -164,18 +205,131 @@ void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef&
     }
 }
 
+void CZMQNotificationInterface::FlushAll()
+{
+    TryForEachAndRemoveFailed([](CZMQAbstractNotifier* notifier) {
+        return notifier->Flush();
+    });
+}
+
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    // The new tip is the last block connected, unless it was connected before a restart
+    std::shared_ptr<const CBlock> pblock = pindexNew == pindexLastConnected ? pblockLastConnected : nullptr;
+    pindexLastConnected = nullptr;
+    pblockLastConnected.reset();
+
+    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
+        return;
+
+    Enqueue([this, pindexNew, pblock] {
+        TryForEachAndRemoveFailed([pindexNew, &pblock](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyBlock(pindexNew, pblock.get());
+        });
+        FlushAll();
+    });
+}
+
+void CZMQNotificationInterface::NotifyTransaction(const CTransaction& tx)
+{
+    TryForEachAndRemoveFailed([&tx](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyTransaction(tx);
+    });
+}
+
+void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx)
+{
+    Enqueue([this, ptx] {
+        NotifyTransaction(*ptx);
+        FlushAll();
+    });
+}
+
 void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected)
 {
-    for (const CTransactionRef& ptx : pblock->vtx) {
-        // Do a normal notify for each transaction added in the block
-        TransactionAddedToMempool(ptx);
-    }
+    pindexLastConnected = pindexConnected;
+    pblockLastConnected = pblock;
+
+    Enqueue([this, pblock] {
+        for (const CTransactionRef& ptx : pblock->vtx) {
+            // Do a normal notify for each transaction added in the block
+            NotifyTransaction(*ptx);
+        }
+        // The transactions of the block are batched together
+        FlushAll();
+    });
 }
 
 void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const uint256& blockHash, int nBlockHeight, int64_t blockTime)
 {
-    for (const CTransactionRef& ptx : pblock->vtx) {
-        // Do a normal notify for each transaction removed in block disconnection
-        TransactionAddedToMempool(ptx);
-    }
+    Enqueue([this, pblock] {
+        for (const CTransactionRef& ptx : pblock->vtx) {
+            // Do a normal notify for each transaction removed in block disconnection
+            NotifyTransaction(*ptx);
+        }
+        FlushAll();
+    });
+}
+
+void CZMQNotificationInterface::TransactionRemovedFromMempool(const CTransactionRef& ptx, MemPoolRemovalReason reason)
+{
+    Enqueue([this, ptx, reason] {
+        TryForEachAndRemoveFailed([&ptx, reason](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyTransactionRemoval(*ptx, reason);
+        });
+        FlushAll();
+    });
+}
+
+void CZMQNotificationInterface::NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff)
+{
+    // Also notified in IBD, so that a subscriber can follow the list from its start.
+    // Called with cs_main held: the diff is copied, and serialized on the publisher thread.
+    const uint256 oldListBlockHash = oldMNList.GetBlockHash();
+    Enqueue([this, undo, oldListBlockHash, diff] {
+        TryForEachAndRemoveFailed([undo, &oldListBlockHash, &diff](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyMasternodeListDiff(undo, oldListBlockHash, diff);
+        });
+        FlushAll();
+    });
+}
+
+void CZMQNotificationInterface::NotifyChainLock(const CBlockIndex* pindex, const llmq::CChainLockSig& clsig)
+{
+    Enqueue([this, pindex, clsig] {
+        TryForEachAndRemoveFailed([pindex, &clsig](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyChainLock(pindex, clsig);
+        });
+        FlushAll();
+    });
+}
+
+void CZMQNotificationInterface::NotifyRecoveredSig(const std::shared_ptr<const llmq::CRecoveredSig>& recoveredSig)
+{
+    Enqueue([this, recoveredSig] {
+        TryForEachAndRemoveFailed([&recoveredSig](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyRecoveredSig(*recoveredSig);
+        });
+        FlushAll();
+    });
+}
+
+void CZMQNotificationInterface::NotifyProposalVote(const CBudgetVote& vote)
+{
+    Enqueue([this, vote] {
+        TryForEachAndRemoveFailed([&vote](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyProposalVote(vote);
+        });
+        FlushAll();
+    });
+}
+
+void CZMQNotificationInterface::NotifyFinalizedBudgetVote(const CFinalizedBudgetVote& vote)
+{
+    Enqueue([this, vote] {
+        TryForEachAndRemoveFailed([&vote](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyFinalizedBudgetVote(vote);
+        });
+        FlushAll();
+    });
 }
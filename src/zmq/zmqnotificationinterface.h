@@ -5,14 +5,25 @@
 #ifndef BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
+#include "sync.h"
 #include "validationinterface.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <string>
 #include <map>
 #include <list>
+#include <thread>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+//! -zmqbatchsize default: each message is sent on its own
+static const int64_t DEFAULT_ZMQ_BATCH_SIZE = 1;
+//! -zmqqueuesize default: notifications waiting for the publisher thread, beyond which they are dropped
+static const int64_t DEFAULT_ZMQ_QUEUE_SIZE = 1000;
+
 class CZMQNotificationInterface : public CValidationInterface
 {
 public:
@@ -20,6 +31,9 @@ public:
 
     static CZMQNotificationInterface* Create();
 
+    // The notifications dropped because the queue of the publisher thread was full
+    uint64_t GetDroppedNotifications() const { return nDropped; }
+
 protected:
     bool Initialize();
     void Shutdown();
@@ -29,12 +43,46 @@ protected:
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const uint256& blockHash, int nBlockHeight, int64_t blockTime) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    void TransactionRemovedFromMempool(const CTransactionRef& ptx, MemPoolRemovalReason reason) override;
+    void NotifyMasternodeListChanged(bool undo, const CDeterministicMNList& oldMNList, const CDeterministicMNListDiff& diff) override;
+    void NotifyChainLock(const CBlockIndex* pindex, const llmq::CChainLockSig& clsig) override;
+    void NotifyRecoveredSig(const std::shared_ptr<const llmq::CRecoveredSig>& recoveredSig) override;
+    void NotifyProposalVote(const CBudgetVote& vote) override;
+    void NotifyFinalizedBudgetVote(const CFinalizedBudgetVote& vote) override;
 
 private:
     CZMQNotificationInterface();
 
+    // Calls func on each notifier, and shuts down the ones failing
+    template <typename Function>
+    void TryForEachAndRemoveFailed(const Function& func);
+    // Sends the batches of the notification, called at the end of each callback
+    void FlushAll();
+    void NotifyTransaction(const CTransaction& tx);
+
+    // Hands a notification over to the publisher thread, or drops it if the queue is full
+    void Enqueue(std::function<void()> func);
+    void ThreadPublisher();
+
     void *pcontext;
+    // Only used by the publisher thread once it is started
     std::list<CZMQAbstractNotifier*> notifiers;
+
+    // The notifications are serialized and sent on the publisher thread, so that the
+    // validation interface callbacks only queue them
+    Mutex cs_queue;
+    std::condition_variable condQueue;
+    std::deque<std::function<void()>> queue GUARDED_BY(cs_queue);
+    bool fStopPublisher GUARDED_BY(cs_queue){false};
+    bool fDropping GUARDED_BY(cs_queue){false};
+    size_t nMaxQueueSize{DEFAULT_ZMQ_QUEUE_SIZE};
+    std::atomic<uint64_t> nDropped{0};
+    std::thread publisherThread;
+
+    // The last block connected, published with the new tip without reading it from disk.
+    // Only used by the validation interface callbacks, which are not run concurrently.
+    const CBlockIndex* pindexLastConnected{nullptr};
+    std::shared_ptr<const CBlock> pblockLastConnected;
 };
 
 #endif // BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
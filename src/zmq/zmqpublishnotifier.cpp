@@ -4,9 +4,15 @@
 
 #include "zmqpublishnotifier.h"
 
+#include "budget/budgetvote.h"
+#include "budget/finalizedbudgetvote.h"
 #include "chainparams.h"
+#include "evo/deterministicmns.h"
+#include "llmq/quorums_chainlocks.h"
+#include "llmq/quorums_signing.h"
 #include "util/system.h"
 #include "crypto/common.h"
+#include "txmempool.h"      // MemPoolRemovalReason
 #include "validation.h"     // cs_main
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
@@ -15,6 +21,13 @@ static const char *MSG_HASHBLOCK  = "hashblock";
 static const char *MSG_HASHTX     = "hashtx";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
+static const char *MSG_HASHTXREMOVED    = "hashtxremoved";
+static const char *MSG_HASHCHAINLOCK    = "hashchainlock";
+static const char *MSG_RAWCHAINLOCKSIG  = "rawchainlocksig";
+static const char *MSG_RAWRECOVEREDSIG  = "rawrecoveredsig";
+static const char *MSG_RAWMNLISTDIFF    = "rawmnlistdiff";
+static const char *MSG_RAWBUDGETVOTE    = "rawbudgetvote";
+static const char *MSG_RAWFINALBUDGETVOTE = "rawfinalbudgetvote";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -59,6 +72,31 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
     return 0;
 }
 
+// Internal function to send a part of a multipart message
+static bool zmq_send_part(void *sock, const void* data, size_t size, bool fMore)
+{
+    zmq_msg_t msg;
+    if (zmq_msg_init_size(&msg, size) != 0) {
+        zmqError("Unable to initialize ZMQ msg");
+        return false;
+    }
+    memcpy(zmq_msg_data(&msg), data, size);
+    if (zmq_msg_send(&msg, sock, fMore ? ZMQ_SNDMORE : 0) == -1) {
+        zmqError("Unable to send ZMQ msg");
+        zmq_msg_close(&msg);
+        return false;
+    }
+    zmq_msg_close(&msg);
+    return true;
+}
+
+// The hashes are published in the byte order they are displayed in
+static void WriteReversedHash(const uint256& hash, char* data)
+{
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+}
+
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 {
     assert(!psocket);
@@ -75,7 +113,17 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
             return false;
         }
 
-        int rc = zmq_bind(psocket, address.c_str());
+        LogPrint(BCLog::ZMQ, "Outbound message high water mark for %s at %s is %d\n", type, address, outbound_message_high_water_mark);
+
+        int rc = zmq_setsockopt(psocket, ZMQ_SNDHWM, &outbound_message_high_water_mark, sizeof(outbound_message_high_water_mark));
+        if (rc != 0)
+        {
+            zmqError("Failed to set outbound message high water mark");
+            zmq_close(psocket);
+            return false;
+        }
+
+        rc = zmq_bind(psocket, address.c_str());
         if (rc!=0)
         {
             zmqError("Failed to bind address");
@@ -132,6 +180,15 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
 {
     assert(psocket);
 
+    if (nBatchSize > 1) {
+        if (pendingCommand && strcmp(pendingCommand, command) != 0 && !Flush())
+            return false;
+        pendingCommand = command;
+        const unsigned char* pdata = static_cast<const unsigned char*>(data);
+        vPendingData.emplace_back(pdata, pdata + size);
+        return vPendingData.size() < nBatchSize || Flush();
+    }
+
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
     WriteLE32(&msgseq[0], nSequence);
@@ -145,7 +202,34 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
-bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQAbstractPublishNotifier::Flush()
+{
+    if (vPendingData.empty())
+        return true;
+    assert(psocket);
+
+    /* send the command, the data of each message & the LE 4byte sequence number of the first one */
+    const size_t nMessages = vPendingData.size();
+    bool fSent = zmq_send_part(psocket, pendingCommand, strlen(pendingCommand), true);
+    for (size_t i = 0; fSent && i < nMessages; i++) {
+        fSent = zmq_send_part(psocket, vPendingData[i].data(), vPendingData[i].size(), true);
+    }
+    unsigned char msgseq[sizeof(uint32_t)];
+    WriteLE32(&msgseq[0], nSequence);
+    fSent = fSent && zmq_send_part(psocket, msgseq, sizeof(uint32_t), false);
+
+    vPendingData.clear();
+    pendingCommand = nullptr;
+    if (!fSent)
+        return false;
+
+    /* each message of the batch takes a sequence number */
+    nSequence += nMessages;
+
+    return true;
+}
+
+bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock)
 {
     uint256 hash = pindex->GetBlockHash();
     LogPrint(BCLog::ZMQ, "Publish hashblock %s\n", hash.GetHex());
@@ -165,24 +249,23 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     return SendMessage(MSG_HASHTX, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock)
 {
     LogPrint(BCLog::ZMQ, "Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
+    if (pblock) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << *pblock;
+        return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    }
 
-        ss << block;
+    std::shared_ptr<const std::vector<unsigned char>> pblockRaw = ReadRawBlockFromDisk(pindex);
+    if (!pblockRaw) {
+        zmqError("Can't read block from disk");
+        return false;
     }
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, pblockRaw->data(), pblockRaw->size());
 }
 
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -193,3 +276,64 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishHashTransactionRemovalNotifier::NotifyTransactionRemoval(const CTransaction &transaction, MemPoolRemovalReason reason)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint(BCLog::ZMQ, "Publish hashtxremoved %s\n", hash.GetHex());
+    /* the txid & a byte with the removal reason */
+    char data[33];
+    WriteReversedHash(hash, data);
+    data[32] = static_cast<char>(reason);
+    return SendMessage(MSG_HASHTXREMOVED, data, 33);
+}
+
+bool CZMQPublishHashChainLockNotifier::NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig &clsig)
+{
+    uint256 hash = pindex->GetBlockHash();
+    LogPrint(BCLog::ZMQ, "Publish hashchainlock %s\n", hash.GetHex());
+    char data[32];
+    WriteReversedHash(hash, data);
+    return SendMessage(MSG_HASHCHAINLOCK, data, 32);
+}
+
+bool CZMQPublishRawChainLockSigNotifier::NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig &clsig)
+{
+    LogPrint(BCLog::ZMQ, "Publish rawchainlocksig %s\n", pindex->GetBlockHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << clsig;
+    return SendMessage(MSG_RAWCHAINLOCKSIG, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawRecoveredSigNotifier::NotifyRecoveredSig(const llmq::CRecoveredSig &recoveredSig)
+{
+    LogPrint(BCLog::ZMQ, "Publish rawrecoveredsig %s\n", recoveredSig.id.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << recoveredSig;
+    return SendMessage(MSG_RAWRECOVEREDSIG, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawMNListDiffNotifier::NotifyMasternodeListDiff(bool undo, const uint256 &oldListBlockHash, const CDeterministicMNListDiff &diff)
+{
+    LogPrint(BCLog::ZMQ, "Publish rawmnlistdiff %s (undo=%d)\n", oldListBlockHash.GetHex(), undo);
+    /* the undo flag, the block hash of the list the diff applies to & the diff */
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << undo << oldListBlockHash << diff;
+    return SendMessage(MSG_RAWMNLISTDIFF, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawBudgetVoteNotifier::NotifyProposalVote(const CBudgetVote &vote)
+{
+    LogPrint(BCLog::ZMQ, "Publish rawbudgetvote %s\n", vote.GetHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << vote;
+    return SendMessage(MSG_RAWBUDGETVOTE, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawFinalizedBudgetVoteNotifier::NotifyFinalizedBudgetVote(const CFinalizedBudgetVote &vote)
+{
+    LogPrint(BCLog::ZMQ, "Publish rawfinalbudgetvote %s\n", vote.GetHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << vote;
+    return SendMessage(MSG_RAWFINALBUDGETVOTE, &(*ss.begin()), ss.size());
+}
@@ -7,6 +7,8 @@
 
 #include "zmqabstractnotifier.h"
 
+#include <vector>
+
 class CBlockIndex;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
@@ -14,6 +16,10 @@ class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 private:
     uint32_t nSequence{0}; // upcounting per message sequence number
 
+    // The messages held back for a batch, all of the same command
+    const char *pendingCommand{nullptr};
+    std::vector<std::vector<unsigned char>> vPendingData;
+
 public:
 
     /* send zmq multipart message
@@ -21,35 +27,83 @@ public:
           * command
           * data
           * message sequence number
+       with a batch size n > 1, up to n messages of a notification are sent as one:
+          * command
+          * data (one part per message)
+          * sequence number of the first message
     */
     bool SendMessage(const char *command, const void* data, size_t size);
 
-    bool Initialize(void *pcontext);
-    void Shutdown();
+    bool Flush() override;
+
+    bool Initialize(void *pcontext) override;
+    void Shutdown() override;
 };
 
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock) override;
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlock(const CBlockIndex *pindex, const CBlock *pblock) override;
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool NotifyTransaction(const CTransaction &transaction) override;
+};
+
+class CZMQPublishHashTransactionRemovalNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransactionRemoval(const CTransaction &transaction, MemPoolRemovalReason reason) override;
+};
+
+class CZMQPublishHashChainLockNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig &clsig) override;
+};
+
+class CZMQPublishRawChainLockSigNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyChainLock(const CBlockIndex *pindex, const llmq::CChainLockSig &clsig) override;
+};
+
+class CZMQPublishRawRecoveredSigNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyRecoveredSig(const llmq::CRecoveredSig &recoveredSig) override;
+};
+
+class CZMQPublishRawMNListDiffNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyMasternodeListDiff(bool undo, const uint256 &oldListBlockHash, const CDeterministicMNListDiff &diff) override;
+};
+
+class CZMQPublishRawBudgetVoteNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyProposalVote(const CBudgetVote &vote) override;
+};
+
+class CZMQPublishRawFinalizedBudgetVoteNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyFinalizedBudgetVote(const CFinalizedBudgetVote &vote) override;
 };
 
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
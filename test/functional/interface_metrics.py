@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the /metrics HTTP path."""
+
+import http.client
+import urllib.parse
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import assert_equal, assert_greater_than, str_to_b64str
+
+
+def parse_metrics(text):
+    """The samples of the text exposition format, keyed by name and labels"""
+    samples = {}
+    for line in text.splitlines():
+        if not line or line.startswith('#'):
+            continue
+        key, value = line.rsplit(' ', 1)
+        samples[key] = float(value)
+    return samples
+
+
+class MetricsTest(PivxTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.extra_args = [["-metrics", "-lockprofiler"], []]
+
+    def get_metrics(self, node, authpair=None):
+        url = urllib.parse.urlparse(self.nodes[node].url)
+        if authpair is None:
+            authpair = url.username + ':' + url.password
+        headers = {"Authorization": "Basic " + str_to_b64str(authpair)} if authpair else {}
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', '/metrics', headers=headers)
+        return conn.getresponse()
+
+    def run_test(self):
+        self.log.info("Check that the metrics are served with -metrics only")
+        assert_equal(self.get_metrics(1).status, 404)
+        response = self.get_metrics(0)
+        assert_equal(response.status, 200)
+        assert response.getheader('Content-Type').startswith('text/plain')
+
+        self.log.info("Check that the metrics require the RPC credentials")
+        assert_equal(self.get_metrics(0, authpair="").status, 401)
+        assert_equal(self.get_metrics(0, authpair="user:wrongpassword").status, 401)
+
+        self.log.info("Check the RPC and validation metrics")
+        self.nodes[0].generate(3)
+        self.nodes[0].getblockcount()
+        try:
+            self.nodes[0].getblockhash(1000)
+        except Exception:
+            pass
+        text = self.get_metrics(0).read().decode('utf-8')
+        samples = parse_metrics(text)
+        assert_equal(samples['pivx_rpc_calls_total{method="getblockhash"}'], 1)
+        assert_equal(samples['pivx_rpc_errors_total{method="getblockhash"}'], 1)
+        assert_equal(samples['pivx_rpc_errors_total{method="getblockcount"}'], 0)
+        assert_equal(samples['pivx_rpc_duration_seconds_count{method="getblockcount"}'],
+                     samples['pivx_rpc_duration_seconds_bucket{method="getblockcount",le="+Inf"}'])
+        assert_equal(samples['pivx_chain_height'], self.nodes[0].getblockcount())
+        assert_greater_than(samples['pivx_blocks_connected_total'], 2)
+        assert_equal(samples['pivx_block_connect_duration_seconds_count'], samples['pivx_blocks_connected_total'])
+        assert 'pivx_http_queue_depth{priority="normal"}' in samples
+        assert '# TYPE pivx_lock_wait_seconds_total counter' in text
+        assert 'pivx_lock_contentions_total{lock="cs_main"}' in samples
+        assert_equal(samples['pivx_mempool_transactions'], 0)
+
+
+if __name__ == '__main__':
+    MetricsTest().main()
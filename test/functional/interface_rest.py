@@ -318,6 +318,38 @@ class RESTTest (PivxTestFramework):
         for tx in txs:
             assert_equal(tx in json_obj['tx'], True)
 
+        # check the block hash by height
+        height = self.nodes[0].getblockcount()
+        json_string = http_get_call(url.hostname, url.port, '/rest/blockhashbyheight/'+str(height)+self.FORMAT_SEPARATOR+'json')
+        assert_equal(json.loads(json_string)['blockhash'], newblockhash[0])
+        hex_string = http_get_call(url.hostname, url.port, '/rest/blockhashbyheight/'+str(height)+self.FORMAT_SEPARATOR+'hex')
+        assert_equal(hex_string.rstrip(), newblockhash[0])
+        response = http_get_call(url.hostname, url.port, '/rest/blockhashbyheight/'+str(height + 1)+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+
+        # the range of blocks is the concatenation of the raw blocks
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height - 2)+'/5'+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        blocks_bin = response.read()
+        expected = b''
+        for h in range(height - 2, height + 1):
+            expected += http_get_call(url.hostname, url.port, '/rest/block/'+self.nodes[0].getblockhash(h)+self.FORMAT_SEPARATOR+'bin', True).read()
+        assert_equal(blocks_bin, expected)
+        hex_string = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height - 2)+'/3'+self.FORMAT_SEPARATOR+'hex')
+        assert_equal(hex_string.rstrip(), encode(expected, "hex_codec").decode('ascii'))
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height)+'/1001'+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 400)
+
+        # the outputs spent by the 3 txs of the block
+        json_string = http_get_call(url.hostname, url.port, '/rest/spenttxouts/'+newblockhash[0]+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string, parse_float=Decimal)
+        assert_equal(len(json_obj), 3)
+        for tx_prevouts in json_obj:
+            assert_greater_than(len(tx_prevouts), 0)
+            for prevout in tx_prevouts:
+                assert_greater_than(prevout['value'], 0)
+                assert 'hex' in prevout['scriptPubKey']
+
         #test rest bestblock
         bb_hash = self.nodes[0].getbestblockhash()
 
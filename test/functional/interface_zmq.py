@@ -4,37 +4,22 @@
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 """Test the ZMQ notification interface."""
 
-import configparser
+from decimal import Decimal
 from io import BytesIO
-import os
-import struct
 import time
 
 from test_framework.messages import CTransaction
 from test_framework.test_framework import PivxTestFramework, SkipTest
 from test_framework.util import (
     assert_equal,
-    hash256
+    connect_nodes,
+    disconnect_nodes,
+    hash256,
 )
+from test_framework.zmq_util import get_zmq, subscribe, zmq_address
 
-
-class ZMQSubscriber:
-    def __init__(self, socket, topic):
-        self.sequence = 0
-        self.socket = socket
-        self.topic = topic
-
-        import zmq
-        self.socket.setsockopt(zmq.SUBSCRIBE, self.topic)
-
-    def receive(self):
-        topic, body, seq = self.socket.recv_multipart()
-        # Topic should match the subscriber topic.
-        assert_equal(topic, self.topic)
-        # Sequence should be incremental.
-        assert_equal(struct.unpack('<I', seq)[-1], self.sequence)
-        self.sequence += 1
-        return body
+# MemPoolRemovalReason::CONFLICT
+REMOVAL_REASON_CONFLICT = 5
 
 
 class ZMQTest (PivxTestFramework):
@@ -42,43 +27,31 @@ class ZMQTest (PivxTestFramework):
         self.num_nodes = 2
 
     def setup_nodes(self):
-        # Try to import python3-zmq. Skip this test if the import fails.
-        try:
-            import zmq
-        except ImportError:
-            raise SkipTest("python3-zmq module not available.")
-
-        # Check that pivx has been built with ZMQ enabled.
-        config = configparser.ConfigParser()
-        if not self.options.configfile:
-            self.options.configfile = os.path.abspath(os.path.join(os.path.dirname(__file__), "../config.ini"))
-        config.read_file(open(self.options.configfile))
-
-        if not config["components"].getboolean("ENABLE_ZMQ"):
-            raise SkipTest("pivxd has not been built with zmq enabled.")
-
-        # Initialize ZMQ context and socket.
-        # All messages are received in the same socket which means
-        # that this test fails if the publishing order changes.
-        # Note that the publishing order is not defined in the documentation and
-        # is subject to change.
-        address = "tcp://127.0.0.1:28332"
-        self.zmq_context = zmq.Context()
-        socket = self.zmq_context.socket(zmq.SUB)
-        socket.set(zmq.RCVTIMEO, 60000)
-        socket.connect(address)
+        zmq = get_zmq(self.options.configfile)
+        if zmq is None:
+            raise SkipTest("python3-zmq module not available, or pivxd has not been built with zmq enabled.")
 
-        # Subscribe to all available topics.
-        self.hashblock = ZMQSubscriber(socket, b"hashblock")
-        self.hashtx = ZMQSubscriber(socket, b"hashtx")
-        self.rawblock = ZMQSubscriber(socket, b"rawblock")
-        self.rawtx = ZMQSubscriber(socket, b"rawtx")
+        # Initialize the ZMQ context, with a socket for each topic:
+        # the publishing order of the topics is not defined.
+        self.zmq_context = zmq.Context()
+        self.address = zmq_address(0)
+        self.subscribe_all()
 
-        self.extra_args = [["-zmqpub%s=%s" % (sub.topic.decode(), address) for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx]], []]
+        self.extra_args = [["-zmqpub%s=%s" % (topic, self.address) for topic in self.topics()], []]
         self.add_nodes(self.num_nodes, self.extra_args)
         self.start_nodes()
         time.sleep(10)
 
+    def topics(self):
+        return ["hashblock", "hashtx", "rawblock", "rawtx", "hashtxremoved"]
+
+    def subscribe_all(self):
+        self.hashblock = subscribe(self.zmq_context, self.address, b"hashblock")
+        self.hashtx = subscribe(self.zmq_context, self.address, b"hashtx")
+        self.rawblock = subscribe(self.zmq_context, self.address, b"rawblock")
+        self.rawtx = subscribe(self.zmq_context, self.address, b"rawtx")
+        self.hashtxremoved = subscribe(self.zmq_context, self.address, b"hashtxremoved")
+
     def run_test(self):
         try:
             self._zmq_test()
@@ -126,5 +99,88 @@ class ZMQTest (PivxTestFramework):
         hex = self.rawtx.receive()
         assert_equal(payment_txid, hash256(hex).hex())
 
+        self.log.info("Mine the tx")
+        blockhash = self.nodes[0].generate(1)[0]
+        self.sync_all()
+
+        # Should receive the txs of the block in order, and then the block.
+        coinbase_txid = self.hashtx.receive().hex()
+        assert_equal(coinbase_txid, hash256(self.rawtx.receive()).hex())
+        assert_equal(payment_txid, self.hashtx.receive().hex())
+        assert_equal(payment_txid, hash256(self.rawtx.receive()).hex())
+        assert_equal(blockhash, self.hashblock.receive().hex())
+        assert_equal(blockhash, hash256(self.rawblock.receive()[:80]).hex())
+
+        self._zmq_test_removal()
+        self._zmq_test_batch()
+
+    def _zmq_test_removal(self):
+        self.log.info("Remove a mempool tx for its conflict with a block")
+        node0, node1 = self.nodes
+        utxo = node0.listunspent()[0]
+        inputs = [{"txid": utxo["txid"], "vout": utxo["vout"]}]
+        amount = utxo["amount"] - Decimal("0.01")
+        tx_removed = node0.signrawtransaction(node0.createrawtransaction(inputs, {node0.getnewaddress(): amount}))["hex"]
+        tx_mined = node0.signrawtransaction(node0.createrawtransaction(inputs, {node1.getnewaddress(): amount}))["hex"]
+
+        disconnect_nodes(node0, 1)
+        txid_removed = node0.sendrawtransaction(tx_removed)
+        assert_equal(txid_removed, self.hashtx.receive().hex())
+        assert_equal(txid_removed, hash256(self.rawtx.receive()).hex())
+        txid_mined = node1.sendrawtransaction(tx_mined)
+        blockhash = node1.generate(1)[0]
+        connect_nodes(node0, 1)
+        self.sync_blocks()
+        assert txid_removed not in node0.getrawmempool()
+
+        # The tx is notified with the reason of its removal, the inclusion in a block is not
+        removal = self.hashtxremoved.receive()
+        assert_equal(len(removal), 33)
+        assert_equal(txid_removed, removal[:32].hex())
+        assert_equal(REMOVAL_REASON_CONFLICT, removal[32])
+        self.hashtx.receive()  # the coinbase
+        assert_equal(txid_mined, self.hashtx.receive().hex())
+        for _ in range(2):
+            self.rawtx.receive()
+        assert_equal(blockhash, self.hashblock.receive().hex())
+        assert_equal(blockhash, hash256(self.rawblock.receive()[:80]).hex())
+
+    def _zmq_test_batch(self):
+        batch_size = 3
+        self.log.info("Batch the notifications with -zmqbatchsize=%d" % batch_size)
+        # The sequence numbers start again with the new notifiers
+        for sub in [self.hashblock, self.hashtx, self.rawblock, self.rawtx, self.hashtxremoved]:
+            sub.socket.close()
+        self.subscribe_all()
+        self.restart_node(0, self.extra_args[0] + ["-zmqbatchsize=%d" % batch_size])
+        connect_nodes(self.nodes[0], 1)
+        time.sleep(10)
+
+        # A message alone is sent as without batching
+        payment_txids = []
+        for _ in range(batch_size - 1):
+            payment_txids.append(self.nodes[1].sendtoaddress(self.nodes[0].getnewaddress(), 1.0))
+            self.sync_mempools()
+            assert_equal([bytes.fromhex(payment_txids[-1])], self.hashtx.receive_batch())
+            assert_equal(payment_txids[-1], hash256(self.rawtx.receive_batch()[0]).hex())
+
+        # The txs of a block are sent together
+        blockhash = self.nodes[1].generate(1)[0]
+        self.sync_blocks()
+        block_txids = self.nodes[0].getblock(blockhash)["tx"]
+        assert_equal(len(block_txids), batch_size)
+        assert_equal(sorted(block_txids[1:]), sorted(payment_txids))
+        assert_equal(block_txids, [txid.hex() for txid in self.hashtx.receive_batch()])
+        assert_equal(block_txids, [hash256(raw).hex() for raw in self.rawtx.receive_batch()])
+        assert_equal(self.hashtx.sequence, batch_size * 2 - 1)
+        assert_equal([bytes.fromhex(blockhash)], self.hashblock.receive_batch())
+
+        # Up to batch_size messages each
+        num_blocks = 5
+        genhashes = self.nodes[0].generate(num_blocks)
+        self.sync_blocks()
+        for x in range(num_blocks):
+            assert_equal(genhashes[x], self.hashblock.receive().hex())
+
 if __name__ == '__main__':
     ZMQTest().main()
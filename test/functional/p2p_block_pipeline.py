@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Test the block pipeline (-blockpipeline) of the headers first sync.
+
+The blocks up to a checkpoint (-checkpoint, regtest-only) are synced headers
+first, and connected by the pipeline. A node without the pipeline syncs the
+same chain, and both go on with the blocks past the checkpoint.
+"""
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import assert_equal, assert_greater_than, connect_nodes, wait_until
+
+CHECKPOINT_HEIGHT = 150
+
+
+class BlockPipelineTest(PivxTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 3
+
+    def setup_network(self):
+        self.setup_nodes()
+
+    def run_test(self):
+        self.nodes[0].generate(CHECKPOINT_HEIGHT + 50)
+        checkpoint = "-checkpoint=%d:%s" % (CHECKPOINT_HEIGHT, self.nodes[0].getblockhash(CHECKPOINT_HEIGHT))
+        self.restart_node(1, extra_args=[checkpoint, "-blockpipeline=1"])
+        self.restart_node(2, extra_args=[checkpoint, "-blockpipeline=0"])
+
+        self.log.info("Syncing headers first with and without the pipeline...")
+        connect_nodes(self.nodes[1], 0)
+        connect_nodes(self.nodes[2], 0)
+        self.sync_blocks()
+
+        # the stats of a stage are updated once its blocks are done
+        def pipeline_done():
+            stages = self.nodes[1].getblockpipelineinfo()["stages"]
+            return all(stage["queued"] == 0 and stage["blocks"] == stages[0]["blocks"] for stage in stages)
+        wait_until(pipeline_done, timeout=30)
+        info = self.nodes[1].getblockpipelineinfo()
+        assert info["running"]
+        assert_equal([stage["name"] for stage in info["stages"]], ["receive", "precheck", "prefetch", "connect"])
+        assert_greater_than(info["stages"][0]["blocks"], 0)
+
+        info = self.nodes[2].getblockpipelineinfo()
+        assert not info["running"]
+        assert_equal(info["stages"][-1]["blocks"], 0)
+
+        self.log.info("Syncing the blocks past the checkpoint...")
+        self.nodes[0].generate(10)
+        self.sync_blocks()
+        assert_equal(self.nodes[1].getbestblockhash(), self.nodes[0].getbestblockhash())
+        assert_equal(self.nodes[2].getbestblockhash(), self.nodes[0].getbestblockhash())
+
+
+if __name__ == '__main__':
+    BlockPipelineTest().main()
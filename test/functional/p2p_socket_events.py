@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Test the socket event loop (epoll on Linux, poll elsewhere).
+
+- many connections served at once,
+- a burst of replies larger than what a single send can take, which needs
+  the socket to be waited for again until it is writable,
+- the node to node block relay,
+- the peers closing their connection.
+"""
+
+from test_framework.messages import CInv, MSG_BLOCK, msg_getdata
+from test_framework.mininode import P2PInterface
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import assert_equal, wait_until
+
+NUM_PEERS = 12
+REQUEST_ROUNDS = 5
+
+
+class SocketEventsTest(PivxTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        self.log.info("Serving %d peers at once..." % NUM_PEERS)
+        peers = [node.add_p2p_connection(P2PInterface()) for _ in range(NUM_PEERS)]
+        for peer in peers:
+            peer.sync_with_ping()
+        assert_equal(node.getconnectioncount(), NUM_PEERS + 1)
+
+        self.log.info("Sending a burst of blocks to a peer...")
+        height = node.getblockcount()
+        invs = [CInv(MSG_BLOCK, int(node.getblockhash(h), 16)) for h in range(1, height + 1)]
+        for _ in range(REQUEST_ROUNDS):
+            peers[0].send_message(msg_getdata(invs))
+        peers[0].wait_until(lambda: peers[0].message_count["block"] == REQUEST_ROUNDS * height, timeout=120)
+        # the other peers are still served
+        for peer in peers[1:]:
+            peer.sync_with_ping()
+
+        self.log.info("Relaying new blocks to the other node...")
+        self.nodes[1].generate(20)
+        self.sync_blocks()
+        assert_equal(node.getbestblockhash(), self.nodes[1].getbestblockhash())
+
+        self.log.info("Closing the connections of the peers...")
+        node.disconnect_p2ps()
+        wait_until(lambda: node.getconnectioncount() == 1, timeout=30)
+        # the node keeps serving the new connections
+        node.add_p2p_connection(P2PInterface()).sync_with_ping()
+        assert_equal(node.getconnectioncount(), 2)
+
+
+if __name__ == '__main__':
+    SocketEventsTest().main()
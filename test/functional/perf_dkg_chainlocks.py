@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Performance of the DKG and chainlock rounds of a regtest masternode network.
+
+Measured steps:
+- dkg:        the DKG sessions, each until its final commitment is mined,
+- chainlocks: single blocks, each until it is chainlocked on all the nodes.
+The DKG phases are driven by the framework (with its fixed waits between them),
+so its time mostly tracks the number of the rounds; its cpu time doesn't.
+Run it with test_runner.py --perf (or directly with --perf) to record the results.
+"""
+
+import time
+
+from test_framework.test_framework import PivxDMNTestFramework
+from test_framework.util import assert_equal
+
+
+class PerfDKGChainLocksTest(PivxDMNTestFramework):
+
+    def set_test_params(self):
+        self.set_base_test_params()
+        self.extra_args = [["-nuparams=v5_shield:1", "-nuparams=PIVX_v5.5:130", "-nuparams=v6_evo:130"]] * self.num_nodes
+        self.extra_args[0].append("-sporkkey=932HEevBSujW2ud7RfB1YF91AFygbBRQj3de3LyaCRqNzKKgWXi")
+
+    def add_options(self, parser):
+        parser.add_option("--dkgrounds", dest="dkgrounds", default=3, type="int",
+                          help="Number of DKG sessions (default: %default)")
+        parser.add_option("--chainlocks", dest="chainlocks", default=20, type="int",
+                          help="Number of chainlocked blocks (default: %default)")
+
+    def wait_for_chainlock_all_nodes(self, block_hash):
+        def is_chainlocked(node):
+            try:
+                return node.getblock(block_hash)["chainlock"]
+            except Exception:
+                # block might not be on the node yet
+                return False
+        # polled more often than wait_until does, the latency is measured here
+        timeout = time.time() + 60
+        while not all(is_chainlocked(node) for node in self.nodes):
+            if time.time() > timeout:
+                raise AssertionError("wait_for_chainlock_all_nodes timed out")
+            time.sleep(0.05)
+
+    def run_test(self):
+        miner = self.nodes[self.minerPos]
+        self.perf.set_params(dkgrounds=self.options.dkgrounds, chainlocks=self.options.chainlocks)
+
+        self.log.info("Starting the masternodes...")
+        self.setup_test()
+        assert_equal(len(self.mns), 6)
+
+        with self.perf.measure("dkg") as step:
+            for i in range(self.options.dkgrounds):
+                self.log.info("DKG session %d" % (i + 1))
+                self.mine_quorum()
+            step["count"] = self.options.dkgrounds
+
+        # signing sessions look for quorums mined at most at chaintip - 8 blocks
+        miner.generate(10)
+        self.sync_all()
+        self.wait_for_chainlock_all_nodes(miner.getbestblockhash())
+
+        self.log.info("Chainlocking %d blocks..." % self.options.chainlocks)
+        latencies = []
+        with self.perf.measure("chainlocks") as step:
+            for _ in range(self.options.chainlocks):
+                start = time.time()
+                block_hash = miner.generate(1)[0]
+                self.wait_for_chainlock_all_nodes(block_hash)
+                latencies.append(time.time() - start)
+            step["count"] = self.options.chainlocks
+            latencies.sort()
+            step["latency_median"] = round(latencies[len(latencies) // 2], 3)
+            step["latency_max"] = round(latencies[-1], 3)
+
+
+if __name__ == '__main__':
+    PerfDKGChainLocksTest().main()
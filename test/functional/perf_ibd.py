@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Performance of the initial block download of a generated regtest chain.
+
+The miner builds a chain with transparent, shielded (shielding and fully
+shielded) and ProReg transactions, then a fresh node downloads it from the
+miner and finally reindexes it from its own block files.
+Run it with test_runner.py --perf (or directly with --perf) to record the results.
+"""
+
+from decimal import Decimal
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import (
+    assert_equal,
+    connect_nodes,
+    create_new_dmn,
+    wait_until,
+)
+
+EXTRA_ARGS = ["-nuparams=v5_shield:1", "-nuparams=v6_evo:130"]
+
+
+class PerfIBDTest(PivxTestFramework):
+
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+        self.extra_args = [EXTRA_ARGS, EXTRA_ARGS]
+
+    def add_options(self, parser):
+        parser.add_option("--blocks", dest="blocks", default=1000, type="int",
+                          help="Length of the generated chain (default: %default)")
+        parser.add_option("--shieldtxs", dest="shieldtxs", default=100, type="int",
+                          help="Number of shielding and of fully shielded transactions (default: %default)")
+        parser.add_option("--protxs", dest="protxs", default=20, type="int",
+                          help="Number of ProReg transactions (default: %default)")
+
+    def setup_network(self):
+        # the syncing node is connected once the chain is built
+        self.setup_nodes()
+
+    def build_chain(self, miner):
+        miner.generate(250)
+
+        self.log.info("Shielding %d notes..." % self.options.shieldtxs)
+        z_addr = miner.getnewshieldaddress()
+        for i in range(self.options.shieldtxs):
+            miner.shieldsendmany("from_transparent", [{"address": z_addr, "amount": Decimal("10")}])
+            if (i + 1) % 10 == 0:
+                miner.generate(1)
+        miner.generate(1)
+
+        self.log.info("Sending %d fully shielded transactions..." % self.options.shieldtxs)
+        for i in range(self.options.shieldtxs):
+            miner.shieldsendmany(z_addr, [{"address": miner.getnewshieldaddress(), "amount": Decimal("5")}])
+            # the notes of the change are spent in the next ones
+            miner.generate(1)
+
+        self.log.info("Registering %d masternodes..." % self.options.protxs)
+        for i in range(self.options.protxs):
+            collateral_addr = miner.getnewaddress()
+            dmn = create_new_dmn(self.num_nodes + i, miner, collateral_addr, None)
+            miner.protx_register_fund(collateral_addr, dmn.ipport, dmn.owner,
+                                      dmn.operator_pk, dmn.voting, dmn.payee)
+            if (i + 1) % 5 == 0:
+                miner.generate(1)
+        miner.generate(1)
+        assert_equal(len(miner.listmasternodes()), self.options.protxs)
+
+        # transparent payments in the rest of the blocks
+        while miner.getblockcount() < self.options.blocks:
+            miner.sendmany("", {miner.getnewaddress(): Decimal("1") for _ in range(10)})
+            miner.generate(1)
+
+    def run_test(self):
+        miner, node = self.nodes
+        self.perf.set_params(blocks=self.options.blocks, shieldtxs=self.options.shieldtxs, protxs=self.options.protxs)
+        assert self.options.blocks >= 250 + 2 * self.options.shieldtxs + self.options.protxs
+
+        self.log.info("Building a chain of %d blocks..." % self.options.blocks)
+        with self.perf.measure("build") as step:
+            self.build_chain(miner)
+            step["count"] = miner.getblockcount()
+        tip = miner.getbestblockhash()
+        height = miner.getblockcount()
+
+        self.log.info("Downloading the chain...")
+        with self.perf.measure("ibd") as step:
+            connect_nodes(node, 0)
+            wait_until(lambda: node.getbestblockhash() == tip, timeout=3600)
+            step["count"] = height
+        assert_equal(len(node.listmasternodes()), self.options.protxs)
+
+        self.log.info("Reindexing the chain...")
+        with self.perf.measure("reindex") as step:
+            self.restart_node(1, extra_args=EXTRA_ARGS + ["-reindex", "-connect=0"])
+            wait_until(lambda: node.getblockcount() == height, timeout=3600)
+            step["count"] = height
+        assert_equal(node.getbestblockhash(), tip)
+
+
+if __name__ == '__main__':
+    PerfIBDTest().main()
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Performance of a large mempool flood.
+
+The transactions are created and signed beforehand, so the measured steps are:
+- accept: the miner accepting them through sendrawtransaction,
+- relay:  the relay to its peer, until both mempools are equal,
+- mine:   the blocks that empty the mempool, connected by both nodes.
+Run it with test_runner.py --perf (or directly with --perf) to record the results.
+"""
+
+from decimal import Decimal
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than_or_equal,
+    satoshi_round,
+)
+
+FEE = Decimal("0.001")
+
+
+class PerfMempoolFloodTest(PivxTestFramework):
+
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+        self.extra_args = [["-maxmempool=1000"], ["-maxmempool=1000"]]
+
+    def add_options(self, parser):
+        parser.add_option("--txs", dest="txs", default=5000, type="int",
+                          help="Number of transactions in the flood (default: %default)")
+        parser.add_option("--chainlength", dest="chainlength", default=5, type="int",
+                          help="Length of the chains of unconfirmed transactions in the flood (default: %default)")
+
+    def create_utxos(self, miner, count):
+        # 100 outputs per transaction
+        while len(miner.listunspent()) < count:
+            miner.sendmany("", {miner.getnewaddress(): Decimal("1") for _ in range(100)})
+            miner.generate(1)
+        return miner.listunspent()
+
+    def create_chain(self, miner, utxo, length):
+        """Signed transactions spending utxo and each its parent"""
+        txs = []
+        prevout = {"txid": utxo["txid"], "vout": utxo["vout"]}
+        script = utxo["scriptPubKey"]
+        amount = utxo["amount"]
+        for _ in range(length):
+            addr = miner.getnewaddress()
+            amount_out = satoshi_round(amount - FEE)
+            raw = miner.createrawtransaction([prevout], {addr: amount_out})
+            # the parents are not in the mempool yet
+            signed = miner.signrawtransaction(raw, [dict(prevout, scriptPubKey=script, amount=amount)])
+            assert signed["complete"]
+            txs.append(signed["hex"])
+            prevout = {"txid": miner.decoderawtransaction(signed["hex"])["txid"], "vout": 0}
+            script = miner.getaddressinfo(addr)["scriptPubKey"]
+            amount = amount_out
+        return txs
+
+    def run_test(self):
+        miner, peer = self.nodes
+        num_chains = self.options.txs // self.options.chainlength
+        self.perf.set_params(txs=self.options.txs, chainlength=self.options.chainlength)
+
+        self.log.info("Creating %d utxos..." % num_chains)
+        miner.generate(101)
+        utxos = self.create_utxos(miner, num_chains)
+        assert_greater_than_or_equal(len(utxos), num_chains)
+        self.sync_blocks()
+
+        self.log.info("Signing %d transactions..." % (num_chains * self.options.chainlength))
+        txs = []
+        for utxo in utxos[:num_chains]:
+            txs.extend(self.create_chain(miner, utxo, self.options.chainlength))
+
+        self.log.info("Flooding the mempool...")
+        with self.perf.measure("accept") as step:
+            for tx in txs:
+                miner.sendrawtransaction(tx)
+            step["count"] = len(txs)
+        assert_equal(miner.getmempoolinfo()["size"], len(txs))
+
+        with self.perf.measure("relay") as step:
+            self.sync_mempools(timeout=3600)
+            step["count"] = len(txs)
+
+        self.log.info("Mining the mempool...")
+        with self.perf.measure("mine") as step:
+            blocks = 0
+            while miner.getmempoolinfo()["size"] > 0:
+                miner.generate(1)
+                blocks += 1
+            self.sync_blocks(timeout=3600)
+            step["count"] = len(txs)
+        assert_equal(peer.getmempoolinfo()["size"], 0)
+        self.log.info("%d transactions mined in %d blocks" % (len(txs), blocks))
+
+
+if __name__ == '__main__':
+    PerfMempoolFloodTest().main()
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Performance of the rescan of a large wallet.
+
+The miner pays many transparent and shielded addresses of the wallet node, then
+the measured steps are:
+- rescanblockchain: the rescan RPC, from the genesis,
+- startup_rescan:   a restart of the wallet node with -rescan.
+Run it with test_runner.py --perf (or directly with --perf) to record the results.
+"""
+
+from decimal import Decimal
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import assert_equal
+
+EXTRA_ARGS = ["-nuparams=v5_shield:1"]
+
+
+class PerfWalletRescanTest(PivxTestFramework):
+
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+        self.extra_args = [EXTRA_ARGS, EXTRA_ARGS + ["-keypool=100"]]
+
+    def add_options(self, parser):
+        parser.add_option("--addresses", dest="addresses", default=2000, type="int",
+                          help="Number of transparent addresses of the wallet paid by the miner (default: %default)")
+        parser.add_option("--shieldaddresses", dest="shieldaddresses", default=200, type="int",
+                          help="Number of shielded addresses of the wallet paid by the miner (default: %default)")
+
+    def run_test(self):
+        miner, wallet = self.nodes
+        self.perf.set_params(addresses=self.options.addresses, shieldaddresses=self.options.shieldaddresses)
+        miner.generate(150)
+        self.sync_all()
+
+        self.log.info("Paying %d transparent addresses..." % self.options.addresses)
+        addresses = [wallet.getnewaddress() for _ in range(self.options.addresses)]
+        for i in range(0, len(addresses), 100):
+            miner.sendmany("", {addr: Decimal("0.1") for addr in addresses[i:i + 100]})
+            miner.generate(1)
+
+        self.log.info("Paying %d shielded addresses..." % self.options.shieldaddresses)
+        shield_addresses = [wallet.getnewshieldaddress() for _ in range(self.options.shieldaddresses)]
+        for i in range(0, len(shield_addresses), 10):
+            miner.shieldsendmany("from_transparent", [{"address": addr, "amount": Decimal("0.1")}
+                                                      for addr in shield_addresses[i:i + 10]])
+            miner.generate(1)
+        # blocks without wallet transactions
+        miner.generate(100)
+        self.sync_all()
+        balance = wallet.getbalance()
+        assert_equal(balance, Decimal("0.1") * (self.options.addresses + self.options.shieldaddresses))
+
+        self.log.info("Rescanning the wallet...")
+        with self.perf.measure("rescanblockchain") as step:
+            height = wallet.getblockcount()
+            wallet.rescanblockchain(0)
+            step["count"] = height
+        assert_equal(wallet.getbalance(), balance)
+
+        self.log.info("Restarting the wallet node with -rescan...")
+        with self.perf.measure("startup_rescan") as step:
+            # the rescan is done before the RPC server is up
+            self.restart_node(1, extra_args=self.extra_args[1] + ["-rescan"])
+            step["count"] = height
+        assert_equal(wallet.getbalance(), balance)
+
+
+if __name__ == '__main__':
+    PerfWalletRescanTest().main()
@@ -13,6 +13,7 @@ Test the following RPCs:
     - getblockheader
     - getchaintxstats
     - getnetworkhashps
+    - getrpccacheinfo
     - verifychain
 
 Tests correspond to code in rpc/blockchain.cpp.
@@ -38,6 +39,7 @@ class BlockchainTest(PivxTestFramework):
         self._test_gettxoutsetinfo()
         self._test_getblockheader()
         self._test_getblock()
+        self._test_rpc_cache()
         #self._test_getdifficulty()
         self.nodes[0].verifychain(0)
 
@@ -121,6 +123,26 @@ class BlockchainTest(PivxTestFramework):
         assert_is_hash_string(node.getblock(besthash, True)['tx'][0])
         assert_is_hex_string(node.getblock(besthash, 2)['tx'][0]['vin'][0]['coinbase'])
 
+    def _test_rpc_cache(self):
+        self.log.info("Test the cache of the RPC results")
+        node = self.nodes[0]
+
+        besthash = node.getbestblockhash()
+        prevhash = node.getblockheader(besthash)['previousblockhash']
+        info = node.getrpccacheinfo()
+        block = node.getblock(prevhash)
+        assert_equal(node.getblock(prevhash), block)
+        assert_equal(node.getrpccacheinfo()['hits'], info['hits'] + 1)
+        assert_equal(block['nextblockhash'], besthash)
+
+        # A tip change invalidates the cached results
+        node.invalidateblock(besthash)
+        block_after = node.getblock(prevhash)
+        assert 'nextblockhash' not in block_after
+        assert_equal(block_after['confirmations'], block['confirmations'] - 1)
+        node.reconsiderblock(besthash)
+        assert_equal(node.getblock(prevhash), block)
+
 
 if __name__ == '__main__':
     BlockchainTest().main()
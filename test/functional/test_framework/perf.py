@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Performance recording for the functional tests.
+
+A test measures the steps of its workload with PerfRecorder.measure():
+
+    with self.perf.measure("ibd") as step:
+        ...
+        step["count"] = blocks
+
+which records, for each step
+- wall_time:  seconds spent in the step
+- cpu_time:   seconds of CPU used by the running pivxds during the step
+- max_rss_kb: peak resident memory of the largest pivxd (over its lifetime)
+- disk_bytes: size of the datadirs (without the logs) at the end of the step
+- count/rate: the number of items processed, if the test sets it, and per second
+
+With --perf, the framework writes the results to <perfdir>/<test>.json and, with
+--perfbaseline, compares them to the results of the same test in that directory.
+"""
+
+import json
+import os
+import platform
+import time
+from contextlib import contextmanager
+
+# The metrics compared to the baseline, with the smallest increase counted as a
+# regression (so that the noise of the short steps doesn't fail the test).
+COMPARED_METRICS = {
+    "wall_time": 1.0,
+    "cpu_time": 1.0,
+    "max_rss_kb": 16 * 1024,
+    "disk_bytes": 1024 * 1024,
+}
+
+
+def get_process_cpu_time(pid):
+    """User + system CPU seconds of a process (0 where /proc is not available)"""
+    try:
+        with open("/proc/%d/stat" % pid, encoding="utf8") as f:
+            # the fields after the command name (which can contain spaces)
+            fields = f.read().rsplit(")", 1)[1].split()
+        return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+    except (OSError, IndexError, ValueError):
+        return 0.0
+
+
+def get_process_max_rss(pid):
+    """Peak resident memory of a process, in kB (0 where /proc is not available)"""
+    try:
+        with open("/proc/%d/status" % pid, encoding="utf8") as f:
+            for line in f:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1])
+    except (OSError, IndexError, ValueError):
+        pass
+    return 0
+
+
+def get_dir_size(path):
+    size = 0
+    for root, _, files in os.walk(path):
+        for name in files:
+            # the logs grow with the debug categories, not with the workload
+            if name == "debug.log":
+                continue
+            try:
+                size += os.path.getsize(os.path.join(root, name))
+            except OSError:
+                # removed while walking (e.g. a temporary file)
+                pass
+    return size
+
+
+class PerfRecorder():
+    """Records the timing and resource usage of the steps of a test workload."""
+
+    def __init__(self, test_name, nodes):
+        self.test_name = test_name
+        # the list of the framework, so that the nodes added later are sampled too
+        self.nodes = nodes
+        self.params = {}
+        self.steps = []
+
+    def set_params(self, **kwargs):
+        """Workload parameters: results are only compared to a baseline with the same ones."""
+        self.params.update(kwargs)
+
+    def _running_pids(self):
+        return [node.process.pid for node in self.nodes if node is not None and node.process is not None]
+
+    @contextmanager
+    def measure(self, name):
+        assert name not in [s["name"] for s in self.steps], "step %s measured twice" % name
+        step = {"name": name}
+        cpu_start = {pid: get_process_cpu_time(pid) for pid in self._running_pids()}
+        time_start = time.time()
+        yield step
+        step["wall_time"] = round(time.time() - time_start, 3)
+        # the nodes started during the step count from zero, the ones stopped are lost
+        pids = self._running_pids()
+        step["cpu_time"] = round(sum(get_process_cpu_time(pid) - cpu_start.get(pid, 0.0) for pid in pids), 3)
+        step["max_rss_kb"] = max([get_process_max_rss(pid) for pid in pids] + [0])
+        step["disk_bytes"] = sum(get_dir_size(node.datadir) for node in self.nodes if node is not None)
+        if "count" in step and step["wall_time"] > 0:
+            step["rate"] = round(step["count"] / step["wall_time"], 3)
+        self.steps.append(step)
+
+    def get_results(self):
+        return {
+            "test": self.test_name,
+            "params": self.params,
+            "environment": {
+                "platform": platform.platform(),
+                "python": platform.python_version(),
+                "cpus": os.cpu_count(),
+            },
+            "date": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+            "steps": self.steps,
+        }
+
+    def write(self, path):
+        with open(path, "w", encoding="utf8") as f:
+            json.dump(self.get_results(), f, indent=4, sort_keys=True)
+            f.write("\n")
+
+    def compare(self, baseline, tolerance):
+        """Return the regressions against the baseline results: the metrics of a step
+        more than `tolerance` (a fraction) above the baseline ones."""
+        if baseline.get("params") != self.params:
+            return ["workload parameters %s differ from the baseline ones %s" % (self.params, baseline.get("params"))]
+        regressions = []
+        steps = {s["name"]: s for s in self.steps}
+        for base in baseline.get("steps", []):
+            step = steps.get(base["name"])
+            if step is None:
+                regressions.append("step %s is not measured anymore" % base["name"])
+                continue
+            for metric, min_increase in COMPARED_METRICS.items():
+                if metric not in base:
+                    continue
+                if step[metric] > base[metric] * (1 + tolerance) and step[metric] - base[metric] > min_increase:
+                    regressions.append("%s %s: %s (baseline %s, +%.1f%%)" % (
+                        base["name"], metric, step[metric], base[metric],
+                        100.0 * (step[metric] - base[metric]) / base[metric] if base[metric] else float("inf")))
+        return regressions
+
+    def format_steps(self):
+        lines = ["%-24s %10s %10s %12s %14s %10s" % ("STEP", "WALL (s)", "CPU (s)", "MAXRSS (kB)", "DISK (bytes)", "RATE (/s)")]
+        for s in self.steps:
+            lines.append("%-24s %10.3f %10.3f %12d %14d %10s" % (
+                s["name"], s["wall_time"], s["cpu_time"], s["max_rss_kb"], s["disk_bytes"], s.get("rate", "-")))
+        return "\n".join(lines)
@@ -6,6 +6,7 @@
 
 from enum import Enum
 from io import BytesIO
+import json
 import logging
 import optparse
 import os
@@ -24,6 +25,7 @@ from .blocktools import (
     create_transaction_from_outpoint,
 )
 from .key import ECKey
+from .perf import PerfRecorder
 from .messages import (
     COIN,
     COutPoint,
@@ -99,6 +101,7 @@ class PivxTestFramework():
         self.rpc_timewait = 600  # Wait for up to 600 seconds for the RPC server to respond
         self.supports_cli = False
         self.bind_to_localhost_only = True
+        self.perf = None
         self.set_test_params()
 
         assert hasattr(self, "num_nodes"), "Test must set self.num_nodes in set_test_params()"
@@ -136,6 +139,14 @@ class PivxTestFramework():
                           help="Attach a python debugger if test fails")
         parser.add_option("--usecli", dest="usecli", default=False, action="store_true",
                           help="use pivx-cli instead of RPC for all commands")
+        parser.add_option("--perf", dest="perf", default=False, action="store_true",
+                          help="Write the timing and resource usage of the measured steps of the test to perfdir")
+        parser.add_option("--perfdir", dest="perfdir", default=os.path.normpath(os.path.dirname(os.path.realpath(__file__)) + "/../../perf"),
+                          help="Directory for the --perf results (default: %default)")
+        parser.add_option("--perfbaseline", dest="perfbaseline",
+                          help="Directory with the --perf results to compare to. The test fails if a step regressed beyond perftolerance")
+        parser.add_option("--perftolerance", dest="perftolerance", default=25.0, type='float',
+                          help="Regression tolerated against perfbaseline, in percent (default: %default)")
         self.add_options(parser)
         (self.options, self.args) = parser.parse_args()
 
@@ -154,6 +165,7 @@ class PivxTestFramework():
         else:
             self.options.tmpdir = tempfile.mkdtemp(prefix=TMPDIR_PREFIX)
         self._start_logging()
+        self.perf = PerfRecorder(os.path.splitext(os.path.basename(sys.argv[0]))[0], self.nodes)
 
         self.log.debug('Setting up network thread')
         self.network_thread = NetworkThread()
@@ -167,6 +179,8 @@ class PivxTestFramework():
             self.setup_chain()
             self.setup_network()
             self.run_test()
+            if self.options.perf:
+                self._write_perf_results()
             success = TestStatus.PASSED
         except JSONRPCException:
             self.log.exception("JSONRPC error")
@@ -422,6 +436,26 @@ class PivxTestFramework():
 
     # Private helper methods. These should not be accessed by the subclass test scripts.
 
+    def _write_perf_results(self):
+        self.log.info("Performance of %s:\n%s" % (self.perf.test_name, self.perf.format_steps()))
+        os.makedirs(self.options.perfdir, exist_ok=True)
+        results_path = os.path.join(self.options.perfdir, self.perf.test_name + ".json")
+        self.perf.write(results_path)
+        self.log.info("Performance results written to %s" % results_path)
+        if self.options.perfbaseline is None:
+            return
+        baseline_path = os.path.join(self.options.perfbaseline, self.perf.test_name + ".json")
+        if not os.path.isfile(baseline_path):
+            self.log.warning("No baseline at %s, not compared" % baseline_path)
+            return
+        with open(baseline_path, encoding="utf8") as f:
+            baseline = json.load(f)
+        regressions = self.perf.compare(baseline, self.options.perftolerance / 100)
+        for r in regressions:
+            self.log.error("Performance regression: %s" % r)
+        assert len(regressions) == 0, "%d performance regressions against %s" % (len(regressions), baseline_path)
+        self.log.info("No performance regression against %s" % baseline_path)
+
     def _start_logging(self):
         # Add logger and logging handlers
         self.log = logging.getLogger('TestFramework')
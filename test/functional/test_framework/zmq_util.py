@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The PIVX Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or https://www.opensource.org/licenses/mit-license.php .
+"""Helpers for the tests of the ZMQ notifications."""
+
+import configparser
+import os
+import struct
+
+from .util import assert_equal, zmq_port
+
+
+def get_zmq(configfile):
+    """The python3-zmq module, or None if it isn't available or pivxd was built without zmq"""
+    try:
+        import zmq
+    except ImportError:
+        return None
+    if not configfile:
+        configfile = os.path.abspath(os.path.join(os.path.dirname(__file__), "../../config.ini"))
+    config = configparser.ConfigParser()
+    with open(configfile, encoding="utf8") as f:
+        config.read_file(f)
+    if not config["components"].getboolean("ENABLE_ZMQ"):
+        return None
+    return zmq
+
+
+class ZMQSubscriber:
+    def __init__(self, socket, topic):
+        self.sequence = 0
+        self.socket = socket
+        self.topic = topic
+
+        import zmq
+        self.socket.setsockopt(zmq.SUBSCRIBE, self.topic)
+
+    def receive(self):
+        topic, body, seq = self.socket.recv_multipart()
+        # Topic should match the subscriber topic.
+        assert_equal(topic, self.topic)
+        # Sequence should be incremental.
+        assert_equal(struct.unpack('<I', seq)[-1], self.sequence)
+        self.sequence += 1
+        return body
+
+    def receive_batch(self):
+        """The messages of a batch (-zmqbatchsize): one part each, then the sequence number of the first one"""
+        parts = self.socket.recv_multipart()
+        assert_equal(parts[0], self.topic)
+        assert_equal(struct.unpack('<I', parts[-1])[-1], self.sequence)
+        bodies = parts[1:-1]
+        self.sequence += len(bodies)
+        return bodies
+
+
+def zmq_address(n):
+    return "tcp://127.0.0.1:%d" % zmq_port(n)
+
+
+def subscribe(zmq_context, address, topic):
+    """A subscriber to a single topic, on its own socket: the order of the topics doesn't matter"""
+    import zmq
+    socket = zmq_context.socket(zmq.SUB)
+    socket.set(zmq.RCVTIMEO, 60000)
+    socket.connect(address)
+    return ZMQSubscriber(socket, topic)
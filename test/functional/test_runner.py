@@ -141,8 +141,11 @@ BASE_SCRIPTS= [
     'wallet_autocombine.py',                    # ~ 49 sec
     'mining_v5_upgrade.py',                     # ~ 48 sec
     'p2p_timeouts.py',
+    'p2p_socket_events.py',
+    'p2p_block_pipeline.py',
     'p2p_mempool.py',                           # ~ 46 sec
     'rpc_named_arguments.py',                   # ~ 45 sec
+    'interface_metrics.py',
     'feature_help.py',                          # ~ 30 sec
     'feature_shutdown.py',
 
@@ -254,6 +257,15 @@ LEGACY_SKIP_TESTS = [
 # Place the lists with the longest tests (on average) first
 ALL_SCRIPTS = EXTENDED_SCRIPTS + TIERTWO_SCRIPTS + SAPLING_SCRIPTS + BASE_SCRIPTS
 
+PERF_SCRIPTS = [
+    # These tests are only run with --perf, one at a time, to record their
+    # timing and resource usage (and to compare it with --perfbaseline).
+    'perf_dkg_chainlocks.py',
+    'perf_ibd.py',
+    'perf_wallet_rescan.py',
+    'perf_mempool_flood.py',
+]
+
 NON_SCRIPTS = [
     # These are python files that live in the functional tests directory, but are not test scripts.
     "combine_logs.py",
@@ -283,6 +295,7 @@ def main():
     parser.add_argument('--legacywallet', '-w', action='store_true', help='create pre-HD wallets only')
     parser.add_argument('--tiertwo', '-m', action='store_true', help='run tier two tests only')
     parser.add_argument('--sapling', '-z', action='store_true', help='run sapling tests only')
+    parser.add_argument('--perf', action='store_true', help='run the performance tests only, one at a time. Pass --perfdir, --perfbaseline\nand --perftolerance to the tests to choose where the results go and what they are compared to')
     parser.add_argument('--tmpdirprefix', '-t', default=tempfile.gettempdir(), help="Root directory for datadirs")
     args, unknown_args = parser.parse_known_args()
 
@@ -302,6 +315,10 @@ def main():
         passon_args.append("--tiertwo")
     if args.sapling:
         passon_args.append("--sapling")
+    if args.perf:
+        passon_args.append("--perf")
+        # run them alone, so that they don't compete for the cpu
+        args.jobs = 1
 
     # Set up logging
     logging_level = logging.INFO if args.quiet else logging.DEBUG
@@ -338,12 +355,14 @@ def main():
             tests = [re.sub(r"\.py$", "", t) + ".py" for t in tests]
             test_list = []
             for t in tests:
-                if t in ALL_SCRIPTS:
+                if t in ALL_SCRIPTS or (args.perf and t in PERF_SCRIPTS):
                     test_list.append(t)
                 else:
                     print("{}WARNING!{} Test '{}' not found in full test list.".format(BOLD[1], BOLD[0], t))
         else:
             test_list = []
+            if args.perf:
+                test_list += PERF_SCRIPTS
             if args.tiertwo:
                 test_list += TIERTWO_SCRIPTS
             if args.sapling:
@@ -633,8 +652,8 @@ def check_script_prefixes():
     # convention don't immediately cause the tests to fail.
     LEEWAY = 10
 
-    good_prefixes_re = re.compile("(example|feature|interface|mempool|mining|p2p|rpc|wallet|sapling|tiertwo)_")
-    bad_script_names = [script for script in ALL_SCRIPTS if good_prefixes_re.match(script) is None]
+    good_prefixes_re = re.compile("(example|feature|interface|mempool|mining|p2p|rpc|wallet|sapling|tiertwo|perf)_")
+    bad_script_names = [script for script in ALL_SCRIPTS + PERF_SCRIPTS if good_prefixes_re.match(script) is None]
 
     if len(bad_script_names) > 0:
         print("INFO: %d tests not meeting naming conventions:" % (len(bad_script_names)))
@@ -649,7 +668,7 @@ def check_script_list(src_dir):
     not being run by pull-tester.py."""
     script_dir = src_dir + '/test/functional/'
     python_files = set([t for t in os.listdir(script_dir) if t[-3:] == ".py"])
-    missed_tests = list(python_files - set(map(lambda x: x.split()[0], ALL_SCRIPTS + NON_SCRIPTS)))
+    missed_tests = list(python_files - set(map(lambda x: x.split()[0], ALL_SCRIPTS + PERF_SCRIPTS + NON_SCRIPTS)))
     if len(missed_tests) != 0:
         print("%sWARNING!%s The following scripts are not being run: %s. Check the test lists in test_runner.py." % (BOLD[1], BOLD[0], str(missed_tests)))
         if os.getenv('TRAVIS') == 'true':
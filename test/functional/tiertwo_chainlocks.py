@@ -9,6 +9,8 @@ from test_framework.util import (
     assert_equal,
     connect_nodes,
 )
+from test_framework.zmq_util import get_zmq, subscribe, zmq_address
+import struct
 import time
 
 '''
@@ -23,7 +25,65 @@ class ChainLocksTest(PivxDMNTestFramework):
         self.extra_args = [["-nuparams=v5_shield:1", "-nuparams=PIVX_v5.5:130", "-nuparams=v6_evo:130", "-debug=llmq", "-debug=dkg", "-debug=net"]] * self.num_nodes
         self.extra_args[0].append("-sporkkey=932HEevBSujW2ud7RfB1YF91AFygbBRQj3de3LyaCRqNzKKgWXi")
 
+    def setup_nodes(self):
+        # The tier-two ZMQ notifications are checked too, when pivxd has been built with zmq
+        self.zmq = get_zmq(self.options.configfile)
+        if self.zmq is not None:
+            self.zmq_context = self.zmq.Context()
+            # The chainlocks and the masternode list on the miner
+            self.hashchainlock = subscribe(self.zmq_context, zmq_address(0), b"hashchainlock")
+            self.rawchainlocksig = subscribe(self.zmq_context, zmq_address(0), b"rawchainlocksig")
+            self.rawmnlistdiff = subscribe(self.zmq_context, zmq_address(0), b"rawmnlistdiff")
+            zmq_args = [["-zmqpub%s=%s" % (topic, zmq_address(0)) for topic in ["hashchainlock", "rawchainlocksig", "rawmnlistdiff"]], []]
+            # The recovered signatures on the masternodes, not all of them take part in a signing session
+            mn_range = range(2, self.num_nodes)
+            self.rawrecoveredsig = [subscribe(self.zmq_context, zmq_address(i), b"rawrecoveredsig") for i in mn_range]
+            zmq_args += [["-zmqpubrawrecoveredsig=%s" % zmq_address(i)] for i in mn_range]
+            self.extra_args = [args + zmq_args[i] for i, args in enumerate(self.extra_args)]
+        super().setup_nodes()
+
     def run_test(self):
+        try:
+            self.chainlocks_test()
+        finally:
+            if self.zmq is not None:
+                self.zmq_context.destroy(linger=None)
+
+    def check_zmq(self):
+        tip = self.nodes[0].getbestblockhash()
+        self.log.info("Check the ZMQ notifications of chainlock %s" % tip)
+        # The masternodes registered in setup_test: undo flag, block hash of the old list, diff
+        diff = self.rawmnlistdiff.receive()
+        assert_equal(diff[0], 0)
+        assert len(diff) > 33
+
+        # The tip is the last chainlock
+        chainlocks = []
+        while not chainlocks or chainlocks[-1] != tip:
+            chainlocks.append(self.hashchainlock.receive().hex())
+        for blockhash in chainlocks:
+            clsig = self.rawchainlocksig.receive()
+            # nHeight, blockHash, sig
+            assert_equal(len(clsig), 4 + 32 + 96)
+            assert_equal(clsig[4:36][::-1].hex(), blockhash)
+            assert_equal(struct.unpack('<i', clsig[:4])[0], self.nodes[0].getblock(blockhash)["height"])
+
+        # The chainlock of the tip was recovered by the members of its quorum
+        recovered = False
+        for sub in self.rawrecoveredsig:
+            sub.socket.set(self.zmq.RCVTIMEO, 1000)
+            while True:
+                try:
+                    recsig = sub.receive()
+                except self.zmq.Again:
+                    break
+                # llmqType, quorumHash, id, msgHash, sig
+                assert_equal(len(recsig), 1 + 32 * 3 + 96)
+                if recsig[65:97][::-1].hex() == tip:
+                    recovered = True
+        assert recovered
+
+    def chainlocks_test(self):
         miner = self.nodes[self.minerPos]
 
         # initialize and start masternodes
@@ -52,6 +112,8 @@ class ChainLocksTest(PivxDMNTestFramework):
         for h in range(1, self.nodes[0].getblockcount()):
             block = self.nodes[0].getblock(self.nodes[0].getblockhash(h))
             assert block['chainlock']
+        if self.zmq is not None:
+            self.check_zmq()
 
         # Isolate node, mine on another, and reconnect
         self.nodes[0].setnetworkactive(False)
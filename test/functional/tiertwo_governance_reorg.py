@@ -15,6 +15,7 @@ from test_framework.util import (
     p2p_port,
     set_node_times,
 )
+from test_framework.zmq_util import get_zmq, subscribe, zmq_address
 
 
 class GovernanceReorgTest(PivxTestFramework):
@@ -44,7 +45,34 @@ class GovernanceReorgTest(PivxTestFramework):
         self.mnOnePrivkey = "9247iC59poZmqBYt9iDh9wDam6v9S1rW5XekjLGyPnDhrDkP4AK"
         self.mnTwoPrivkey = "92Hkebp3RHdDidGZ7ARgS4orxJAGyFUPDXNqtsYsiwho1HGVRbF"
 
+    def setup_nodes(self):
+        # The ZMQ notifications of the votes are checked too, when pivxd has been built with zmq
+        self.zmq = get_zmq(self.options.configfile)
+        if self.zmq is not None:
+            self.zmq_context = self.zmq.Context()
+            self.rawbudgetvote = subscribe(self.zmq_context, zmq_address(self.minerBPos), b"rawbudgetvote")
+            self.rawfinalbudgetvote = subscribe(self.zmq_context, zmq_address(self.minerBPos), b"rawfinalbudgetvote")
+            self.extra_args[self.minerBPos] = self.extra_args[self.minerBPos] + ["-zmqpub%s=%s" % (topic, zmq_address(self.minerBPos)) for topic in ["rawbudgetvote", "rawfinalbudgetvote"]]
+        super().setup_nodes()
+
     def run_test(self):
+        try:
+            self.governance_reorg_test()
+        finally:
+            if self.zmq is not None:
+                self.zmq_context.destroy(linger=None)
+
+    def check_zmq_votes(self, sub, voted_hash):
+        # vin (collateral outpoint, empty scriptSig, nSequence), then the hash of the proposal or the budget
+        voters = set()
+        for _ in range(2):
+            vote = sub.receive()
+            assert_equal(vote[36], 0)
+            assert_equal(vote[41:73][::-1].hex(), voted_hash)
+            voters.add(vote[:32][::-1].hex())
+        assert_equal(voters, {self.mnOneCollateral.hash, self.mnTwoCollateral.hash})
+
+    def governance_reorg_test(self):
         minerA = self.nodes[self.minerAPos]     # also controller of mn1 and mn2
         minerB = self.nodes[self.minerBPos]
         mn1 = self.nodes[self.remoteOnePos]
@@ -116,6 +144,8 @@ class GovernanceReorgTest(PivxTestFramework):
         assert_equal(projection["Name"], "test1")
         assert_equal(projection["Hash"], proposalHash)
         assert_equal(projection["Yeas"], 2)
+        if self.zmq is not None:
+            self.check_zmq_votes(self.rawbudgetvote, proposalHash)
 
         # Create the finalized budget and vote on it
         self.log.info("Finalizing the budget...")
@@ -131,6 +161,8 @@ class GovernanceReorgTest(PivxTestFramework):
         budFin = minerB.mnfinalbudget("show")
         budget = budFin[next(iter(budFin))]
         assert_equal(budget["VoteCount"], 2)
+        if self.zmq is not None:
+            self.check_zmq_votes(self.rawfinalbudgetvote, budgetFinHash)
 
         # Stake up until the block before the superblock.
         skip_blocks = next_superblock - minerA.getblockcount() - 1